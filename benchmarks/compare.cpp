@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include "performance_baseline.h"
+
+/** \brief Compare two JSON baselines as written by benchmarks or 
+ * superpixel_bench --json and report statistically significant slowdowns.
+ * 
+ * Entries are matched by key; for each entry, the medians, their ratio and
+ * the one-sided p-value are printed. Entries are reported as slowdown if the
+ * p-value is below --alpha and the ratio above --threshold. Returns 2 if
+ * at least one slowdown was found such that it can be used in scripts.
+ * 
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/benchmarks_compare --help
+ *   Allowed options:
+ *     --reference arg          reference JSON baseline
+ *     --current arg            current JSON baseline
+ *     --alpha arg (=0.01)      significance level
+ *     --threshold arg (=1.05)  minimum ratio of medians to report a slowdown
+ *     --all                    print all entries, not only slowdowns
+ *     --help                   produce help message
+ * \endcode
+ * \author David Stutz
+ */
+int main(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("reference", boost::program_options::value<std::string>(), "reference JSON baseline")
+        ("current", boost::program_options::value<std::string>(), "current JSON baseline")
+        ("alpha", boost::program_options::value<double>()->default_value(0.01), "significance level")
+        ("threshold", boost::program_options::value<double>()->default_value(1.05), "minimum ratio of medians to report a slowdown")
+        ("all", "print all entries, not only slowdowns")
+        ("help", "produce help message");
+
+    boost::program_options::positional_options_description positionals;
+    positionals.add("reference", 1);
+    positionals.add("current", 1);
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end() 
+            || parameters.find("reference") == parameters.end()
+            || parameters.find("current") == parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path reference_file(parameters["reference"].as<std::string>());
+    PerformanceBaseline reference;
+    if (!reference.read(reference_file)) {
+        std::cout << "Could not read " << reference_file << "." << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path current_file(parameters["current"].as<std::string>());
+    PerformanceBaseline current;
+    if (!current.read(current_file)) {
+        std::cout << "Could not read " << current_file << "." << std::endl;
+        return 1;
+    }
+    
+    if (reference.host != current.host) {
+        std::cout << "Warning: comparing baselines of different hosts (" 
+                << reference.host << ", " << current.host << ")." << std::endl;
+    }
+    
+    double alpha = parameters["alpha"].as<double>();
+    double threshold = parameters["threshold"].as<double>();
+    bool all = parameters.find("all") != parameters.end();
+    
+    std::vector<PerformanceBaseline::Comparison> comparisons;
+    PerformanceBaseline::compare(reference, current, alpha, threshold, comparisons);
+    
+    std::cout << "Reference: " << reference.commit << " (" << reference.date << ")" << std::endl;
+    std::cout << "Current: " << current.commit << " (" << current.date << ")" << std::endl;
+    
+    int slowdowns = 0;
+    for (unsigned int i = 0; i < comparisons.size(); ++i) {
+        if (comparisons[i].slowdown) {
+            ++slowdowns;
+        }
+        
+        if (comparisons[i].slowdown || all) {
+            std::cout << (comparisons[i].slowdown ? "SLOWDOWN " : "         ")
+                    << comparisons[i].key << ": " 
+                    << comparisons[i].reference_median*1000 << "ms -> " 
+                    << comparisons[i].median*1000 << "ms (x" 
+                    << std::setprecision(3) << comparisons[i].ratio 
+                    << ", p = " << comparisons[i].p << ")" 
+                    << std::setprecision(6) << std::endl;
+        }
+    }
+    
+    std::cout << slowdowns << " of " << comparisons.size() 
+            << " entries significantly slower." << std::endl;
+    
+    return (slowdowns > 0) ? 2 : 0;
+}
@@ -0,0 +1,496 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include "io_util.h"
+#include "superpixel_tools.h"
+#include "evaluation.h"
+#include "runtime_harness.h"
+#include "performance_baseline.h"
+#include "thread_pool.h"
+
+#ifdef BENCHMARKS_SLIC
+#include "slic_opencv.h"
+#endif
+#ifdef BENCHMARKS_SEEDS
+#include "seeds2.h"
+#endif
+#ifdef BENCHMARKS_DASP
+#include <set>
+#include <memory>
+#include "graphseg.hpp"
+#endif
+
+/** \brief Synthetic input of a benchmark, deterministic for a given size. */
+struct Input {
+    /** \brief Image, piecewise constant on the ground truth segments plus noise. */
+    cv::Mat image;
+    /** \brief Ground truth segmentation with roughly 30 segments. */
+    cv::Mat gt;
+    /** \brief Superpixel segmentation with the requested number of superpixels. */
+    cv::Mat labels;
+    /** \brief Requested number of superpixels. */
+    int superpixels;
+};
+
+/** \brief A benchmark measured on all inputs. */
+struct Benchmark {
+    /** \brief Name used for --filter and in the output. */
+    std::string name;
+    /** \brief Function to measure, called with the input. */
+    std::function<void(const Input&)> function;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// computeVoronoi
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Compute a Voronoi segmentation of randomly jittered grid seeds,
+ * resembling a superpixel segmentation.
+ * \param[in] rows number of rows
+ * \param[in] cols number of columns
+ * \param[in] segments approximate number of segments
+ * \param[in] generator random generator
+ * \param[out] labels labels as CV_32SC1
+ */
+static void computeVoronoi(int rows, int cols, int segments, 
+        std::mt19937 &generator, cv::Mat &labels) {
+    
+    int step = std::max(1, (int) (0.5f + std::sqrt(rows*cols / (float) segments)));
+    int grid_rows = (rows + step - 1)/step;
+    int grid_cols = (cols + step - 1)/step;
+    
+    std::uniform_real_distribution<float> jitter(0.f, (float) step);
+    std::vector<float> seed_y(grid_rows*grid_cols);
+    std::vector<float> seed_x(grid_rows*grid_cols);
+    for (int gi = 0; gi < grid_rows; ++gi) {
+        for (int gj = 0; gj < grid_cols; ++gj) {
+            seed_y[gi*grid_cols + gj] = gi*step + jitter(generator);
+            seed_x[gi*grid_cols + gj] = gj*step + jitter(generator);
+        }
+    }
+    
+    // The nearest seed is among the seeds of the 3x3 neighboring cells.
+    labels.create(rows, cols, CV_32SC1);
+    for (int i = 0; i < rows; ++i) {
+        int* labels_i = labels.ptr<int>(i);
+        for (int j = 0; j < cols; ++j) {
+            int gi = i/step;
+            int gj = j/step;
+            
+            float best = std::numeric_limits<float>::max();
+            for (int di = std::max(0, gi - 1); di <= std::min(grid_rows - 1, gi + 1); ++di) {
+                for (int dj = std::max(0, gj - 1); dj <= std::min(grid_cols - 1, gj + 1); ++dj) {
+                    int k = di*grid_cols + dj;
+                    float distance = (seed_y[k] - i)*(seed_y[k] - i) 
+                            + (seed_x[k] - j)*(seed_x[k] - j);
+                    
+                    if (distance < best) {
+                        best = distance;
+                        labels_i[j] = k;
+                    }
+                }
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// createInput
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Create the synthetic input for the given size.
+ * \param[in] rows number of rows
+ * \param[in] cols number of columns
+ * \param[in] superpixels number of superpixels
+ * \param[out] input input
+ */
+static void createInput(int rows, int cols, int superpixels, Input &input) {
+    std::mt19937 generator(rows*7919 + cols*31 + superpixels);
+    
+    computeVoronoi(rows, cols, 30, generator, input.gt);
+    computeVoronoi(rows, cols, superpixels, generator, input.labels);
+    input.superpixels = superpixels;
+    
+    std::uniform_int_distribution<int> color(0, 255);
+    std::normal_distribution<float> noise(0.f, 8.f);
+    
+    double max = 0;
+    cv::minMaxLoc(input.gt, NULL, &max);
+    std::vector<cv::Vec3b> colors(((int) max) + 1);
+    for (unsigned int k = 0; k < colors.size(); ++k) {
+        colors[k] = cv::Vec3b(color(generator), color(generator), color(generator));
+    }
+    
+    input.image.create(rows, cols, CV_8UC3);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            const cv::Vec3b &mean = colors[input.gt.at<int>(i, j)];
+            for (int c = 0; c < 3; ++c) {
+                input.image.at<cv::Vec3b>(i, j)[c] = cv::saturate_cast<uchar>(mean[c] + noise(generator));
+            }
+        }
+    }
+}
+
+#ifdef BENCHMARKS_DASP
+////////////////////////////////////////////////////////////////////////////////
+// computeSuperpixelGraph
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Compute the weighted superpixel graph as used for spectral 
+ * segmentation in DASP, weights decrease with the color distance of the
+ * superpixels and are modulated depending on the frame.
+ * \param[in] input input
+ * \param[in] frame frame index, consecutive frames differ slightly
+ * \param[out] graph graph
+ */
+static void computeSuperpixelGraph(const Input &input, int frame, 
+        graphseg::SpectralGraph &graph) {
+    
+    double max = 0;
+    cv::minMaxLoc(input.labels, NULL, &max);
+    int superpixels = ((int) max) + 1;
+    
+    std::vector<cv::Vec3f> means(superpixels);
+    std::vector<int> sizes(superpixels, 0);
+    std::set< std::pair<int, int> > edges;
+    
+    for (int i = 0; i < input.labels.rows; ++i) {
+        for (int j = 0; j < input.labels.cols; ++j) {
+            int label = input.labels.at<int>(i, j);
+            const cv::Vec3b &color = input.image.at<cv::Vec3b>(i, j);
+            means[label] += cv::Vec3f(color[0], color[1], color[2]);
+            sizes[label]++;
+            
+            if (i + 1 < input.labels.rows && input.labels.at<int>(i + 1, j) != label) {
+                int other = input.labels.at<int>(i + 1, j);
+                edges.insert(std::make_pair(std::min(label, other), std::max(label, other)));
+            }
+            if (j + 1 < input.labels.cols && input.labels.at<int>(i, j + 1) != label) {
+                int other = input.labels.at<int>(i, j + 1);
+                edges.insert(std::make_pair(std::min(label, other), std::max(label, other)));
+            }
+        }
+    }
+    
+    graph = graphseg::SpectralGraph(superpixels);
+    for (int k = 0; k < superpixels; ++k) {
+        means[k] = means[k]/std::max(1, sizes[k]);
+    }
+    
+    for (std::set< std::pair<int, int> >::const_iterator it = edges.begin(); 
+            it != edges.end(); ++it) {
+        int k = it->first;
+        int l = it->second;
+        float distance = cv::norm(means[k] - means[l]);
+        float modulation = 1 + 0.05f*std::sin(0.1f*(k + l) + frame);
+        
+        graphseg::SpectralGraph::edge_descriptor edge = boost::add_edge(k, l, graph).first;
+        graph[edge] = modulation*std::exp(-distance/25.f);
+    }
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// createBenchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Create all available benchmarks.
+ * \param[in] csv_file temporary CSV file for I/O benchmarks, holds the 
+ * superpixel segmentation of the current input
+ * \param[in] threads number of threads for the kernels that take one
+ * \param[out] benchmarks benchmarks
+ */
+static void createBenchmarks(const boost::filesystem::path &csv_file,
+        int threads, std::vector<Benchmark> &benchmarks) {
+    
+    benchmarks.push_back(Benchmark{"intersection_matrix", [](const Input &input) {
+        cv::Mat intersection_matrix;
+        std::vector<int> superpixel_sizes;
+        std::vector<int> gt_sizes;
+        Evaluation::computeIntersectionMatrix(input.labels, input.gt, 
+                intersection_matrix, superpixel_sizes, gt_sizes);
+    }});
+    
+    benchmarks.push_back(Benchmark{"sparse_intersection_matrix", [](const Input &input) {
+        Evaluation::SparseIntersectionMatrix intersections;
+        std::vector<int> superpixel_sizes;
+        std::vector<int> gt_sizes;
+        Evaluation::computeSparseIntersectionMatrix(input.labels, input.gt, 
+                intersections, superpixel_sizes, gt_sizes);
+    }});
+    
+    benchmarks.push_back(Benchmark{"boundary_recall", [](const Input &input) {
+        Evaluation::computeBoundaryRecall(input.labels, input.gt);
+    }});
+    
+    benchmarks.push_back(Benchmark{"boundary_precision", [](const Input &input) {
+        Evaluation::computeBoundaryPrecision(input.labels, input.gt);
+    }});
+    
+    benchmarks.push_back(Benchmark{"relabel_connected", [threads](const Input &input) {
+        cv::Mat labels = input.labels.clone();
+        SuperpixelTools::relabelConnectedSuperpixels(labels, threads);
+    }});
+    
+    benchmarks.push_back(Benchmark{"write_csv", [csv_file](const Input &input) {
+        IOUtil::writeMatCSV<int>(csv_file, input.labels);
+    }});
+    
+    benchmarks.push_back(Benchmark{"read_csv", [csv_file](const Input &input) {
+        cv::Mat labels;
+        IOUtil::readMatCSVInt(csv_file, input.labels.rows, input.labels.cols, labels);
+    }});
+    
+#ifdef BENCHMARKS_SLIC
+    // A single iteration is dominated by the assignment step.
+    benchmarks.push_back(Benchmark{"slic_assignment", [threads](const Input &input) {
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(input.image, 
+                input.superpixels);
+        cv::Mat labels;
+        SLIC_OpenCV::computeSuperpixels(input.image, region_size, 40., 1, false, 
+                1, labels, threads);
+    }});
+#endif
+
+#ifdef BENCHMARKS_SEEDS
+    // Block and pixel updates are dominated by histogram intersections.
+    benchmarks.push_back(Benchmark{"seeds_iterate", [threads](const Input &input) {
+        int region_height = 2;
+        int region_width = 2;
+        int levels = 2;
+        SuperpixelTools::computeHeightWidthLevelsFromSuperpixels(input.image, 
+                input.superpixels, region_height, region_width, levels);
+        
+        SEEDS seeds(input.image.cols, input.image.rows, input.image.channels(), 
+                5, 0, 0.1, true, true, 1);
+        seeds.set_threads(threads);
+        seeds.initialize(input.image, region_width, region_height, levels);
+        seeds.iterate(2);
+    }});
+#endif
+
+#ifdef BENCHMARKS_DASP
+    // Spectral segmentation of the superpixel graph using 24 eigenvectors;
+    // the dense solver is cubic in the number of superpixels. The warm started
+    // solver sees a slightly changed graph in each run, as for consecutive frames.
+    benchmarks.push_back(Benchmark{"dasp_spectral_eigen", [](const Input &input) {
+        graphseg::SpectralGraph graph;
+        computeSuperpixelGraph(input, 0, graph);
+        graphseg::SolveSpectral(graph, 24, graphseg::SpectralMethod::Eigen);
+    }});
+    
+    benchmarks.push_back(Benchmark{"dasp_spectral_lanczos", [](const Input &input) {
+        graphseg::SpectralGraph graph;
+        computeSuperpixelGraph(input, 0, graph);
+        graphseg::SolveSpectral(graph, 24, graphseg::SpectralMethod::Lanczos);
+    }});
+    
+    std::shared_ptr<graphseg::SpectralSolver> solver = std::make_shared<graphseg::SpectralSolver>();
+    std::shared_ptr<int> frame = std::make_shared<int>(0);
+    benchmarks.push_back(Benchmark{"dasp_spectral_lanczos_warm", [solver, frame](const Input &input) {
+        graphseg::SpectralGraph graph;
+        computeSuperpixelGraph(input, ++(*frame), graph);
+        solver->solve(graph, 24);
+    }});
+#endif
+}
+
+/** \brief Microbenchmarks of evaluation and algorithm kernels on synthetic 
+ * inputs of several sizes and numbers of superpixels.
+ * 
+ * Each benchmark is measured using RuntimeHarness; the results can be written
+ * as CSV file with one line per benchmark and input, or as JSON baseline
+ * (see PerformanceBaseline) to be compared against a reference using 
+ * benchmarks_compare.
+ * 
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/benchmarks --help
+ *   Allowed options:
+ *     --sizes arg (=240x320 480x640 1080x1920)
+ *                                     image sizes as rowsxcols
+ *     --superpixels arg (=400 1600 6400)
+ *                                     numbers of superpixels
+ *     --filter arg                    only run benchmarks whose name contains 
+ *                                     this string
+ *     --warmup arg (=1)               number of untimed runs
+ *     --repetitions arg (=5)          number of timed runs
+ *     -j [ --threads ] arg (=1)       number of threads for relabel_connected,
+ *                                     slic_assignment and seeds_iterate;
+ *                                     appended to the baseline keys if > 1
+ *     --output arg                    CSV file to write the results to
+ *     --json arg                      JSON baseline to write the results to
+ *     --commit arg                    commit stored in the JSON baseline, 
+ *                                     defaults to the commit built from
+ *     --list                          list the benchmarks
+ *     --help                          produce help message
+ * \endcode
+ * \author David Stutz
+ */
+int main(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("sizes", boost::program_options::value< std::vector<std::string> >()->multitoken()->default_value(std::vector<std::string>{"240x320", "480x640", "1080x1920"}, "240x320 480x640 1080x1920"), "image sizes as rowsxcols")
+        ("superpixels", boost::program_options::value< std::vector<int> >()->multitoken()->default_value(std::vector<int>{400, 1600, 6400}, "400 1600 6400"), "numbers of superpixels")
+        ("filter", boost::program_options::value<std::string>()->default_value(""), "only run benchmarks whose name contains this string")
+        ("warmup", boost::program_options::value<int>()->default_value(1), "number of untimed runs")
+        ("repetitions", boost::program_options::value<int>()->default_value(5), "number of timed runs")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads for relabel_connected, slic_assignment and seeds_iterate; appended to the baseline keys if > 1")
+        ("output", boost::program_options::value<std::string>()->default_value(""), "CSV file to write the results to")
+        ("json", boost::program_options::value<std::string>()->default_value(""), "JSON baseline to write the results to")
+        ("commit", boost::program_options::value<std::string>()->default_value(""), "commit stored in the JSON baseline, defaults to the commit built from")
+        ("list", "list the benchmarks")
+        ("help", "produce help message");
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
+    boost::filesystem::path directory = boost::filesystem::temp_directory_path() 
+            / boost::filesystem::unique_path("benchmarks-%%%%-%%%%");
+    boost::filesystem::create_directories(directory);
+    
+    boost::filesystem::path csv_file = directory / boost::filesystem::path("labels.csv");
+    std::vector<Benchmark> benchmarks;
+    createBenchmarks(csv_file, threads, benchmarks);
+    
+    if (parameters.find("list") != parameters.end()) {
+        for (unsigned int b = 0; b < benchmarks.size(); ++b) {
+            std::cout << benchmarks[b].name << std::endl;
+        }
+        
+        boost::filesystem::remove_all(directory);
+        return 0;
+    }
+    
+    std::vector<std::string> sizes = parameters["sizes"].as< std::vector<std::string> >();
+    std::vector<int> superpixels = parameters["superpixels"].as< std::vector<int> >();
+    std::string filter = parameters["filter"].as<std::string>();
+    
+    int warmup = parameters["warmup"].as<int>();
+    int repetitions = parameters["repetitions"].as<int>();
+    if (warmup < 0 || repetitions <= 0) {
+        std::cout << "Number of repetitions needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    std::stringstream csv;
+    csv << "benchmark,rows,cols,superpixels,repetitions,min,median,p95" << std::endl;
+    
+    PerformanceBaseline baseline;
+    if (!parameters["commit"].as<std::string>().empty()) {
+        baseline.commit = parameters["commit"].as<std::string>();
+    }
+    
+    for (unsigned int s = 0; s < sizes.size(); ++s) {
+        int rows = 0;
+        int cols = 0;
+        if (sscanf(sizes[s].c_str(), "%dx%d", &rows, &cols) != 2 || rows <= 0 || cols <= 0) {
+            std::cout << "Invalid size: " << sizes[s] << "." << std::endl;
+            return 1;
+        }
+        
+        for (unsigned int k = 0; k < superpixels.size(); ++k) {
+            Input input;
+            createInput(rows, cols, superpixels[k], input);
+            IOUtil::writeMatCSV<int>(csv_file, input.labels);
+            
+            RuntimeHarness harness(warmup, repetitions);
+            for (unsigned int b = 0; b < benchmarks.size(); ++b) {
+                if (benchmarks[b].name.find(filter) == std::string::npos) {
+                    continue;
+                }
+                
+                RuntimeHarness::Record record = harness.measure(benchmarks[b].name, 
+                        std::bind(benchmarks[b].function, std::cref(input)));
+                
+                std::cout << benchmarks[b].name << " " << rows << "x" << cols 
+                        << " " << superpixels[k] << ": median " << record.median*1000 
+                        << "ms, min " << record.min*1000 << "ms, p95 " 
+                        << record.p95*1000 << "ms" << std::endl;
+                
+                csv << benchmarks[b].name << "," << rows << "," << cols << "," 
+                        << superpixels[k] << "," << record.times.size() << "," 
+                        << record.min << "," << record.median << "," 
+                        << record.p95 << std::endl;
+                
+                std::stringstream key;
+                key << benchmarks[b].name << "/" << rows << "x" << cols << "/" << superpixels[k];
+                if (threads > 1) {
+                    key << "/j" << threads;
+                }
+                baseline.add(key.str(), record.times, false);
+            }
+        }
+    }
+    
+    boost::filesystem::remove_all(directory);
+    
+    boost::filesystem::path output_file(parameters["output"].as<std::string>());
+    if (!output_file.empty()) {
+        std::ofstream output(output_file.string());
+        output << csv.str();
+    }
+    
+    boost::filesystem::path json_file(parameters["json"].as<std::string>());
+    if (!json_file.empty() && !baseline.write(json_file)) {
+        std::cout << "Could not write " << json_file << "." << std::endl;
+        return 1;
+    }
+    
+    return 0;
+}
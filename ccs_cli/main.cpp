@@ -33,10 +33,12 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "ccs_opencv.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
+#include "thread_pool.h"
 #include "visualization.h"
 
 /** \brief Command line tool for running CCS.
@@ -53,6 +55,12 @@
  *    -o [ --csv ] arg                save segmentation as CSV file
  *    -v [ --vis ] arg                visualize contours
  *    -x [ --prefix ] arg             output file prefix
+ *    --memory                        write per image allocations and peak
+ *                                    memory to memory.csv next to runtime.txt
+ *    --png                           write segmentations as 16-bit PNG
+ *                                    instead of CSV
+ *    -j [ --threads ] arg (=1)       number of threads to relabel connected
+ *                                    components on the shared pool
  *    -w [ --wordy ]                  verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -70,6 +78,9 @@ int main(int argc, const char** argv) {
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads to relabel connected components on the shared pool")
         ("wordy,w", "verbose/wordy/debug");
 
     boost::program_options::positional_options_description positionals;
@@ -84,6 +95,14 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -105,6 +124,7 @@ int main(int argc, const char** argv) {
     }
         
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
@@ -127,22 +147,26 @@ int main(int argc, const char** argv) {
     IOUtil::readDirectory(input_dir, extensions, images);
     
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for(std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         cv::Mat labels;
         
         int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
                 superpixels);
         
-        boost::timer timer;
+        RuntimeHarness::Timer timer;
         CCS_OpenCV::computeSuperpixels(image, region_size,
                 iterations, compactness, lab, labels);
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
-        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels, threads);
         int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
         merged_components += SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
         
@@ -154,9 +178,9 @@ int main(int argc, const char** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
         }
         
         if (!vis_dir.empty()) {
@@ -178,6 +202,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
@@ -33,9 +33,10 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "cis_opencv.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -54,9 +55,14 @@
  *                                     smoother boundaries
  *     -g [ --sigma ] arg (=2)         sigma for gaussian kernel of edge weights
  *     -r [ --color-space ] arg (=0)   0 = GRAY, >0 = RGB
+ *     -j [ --threads ] arg (=1)       number of threads per image
  *     -o [ --csv ] arg                save segmentation as CSV file
  *     -v [ --vis ] arg                visualize contours
  *     -x [ --prefix ] arg             output file prefix
+ *     --memory                        write per image allocations and peak
+ *                                     memory to memory.csv next to runtime.txt
+ *     --png                           write segmentations as 16-bit PNG
+ *                                     instead of CSV
  *     -w [ --wordy ]                  verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -73,9 +79,12 @@ int main (int argc, char ** argv) {
         ("lambda,l", boost::program_options::value<int>()->default_value(5), "lambda only influences constant intensity superpixels; larger lambda results in smoother boundaries")
         ("sigma,g", boost::program_options::value<float>()->default_value(2.f), "sigma for gaussian kernel of edge weights")
         ("color-space,r", boost::program_options::value<int>()->default_value(0), "0 = GRAY, >0 = RGB")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads per image")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
         ("wordy,w", "verbose/wordy/debug");
     
     boost::program_options::positional_options_description positionals;
@@ -111,6 +120,7 @@ int main (int argc, char ** argv) {
     }
     
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
@@ -124,6 +134,12 @@ int main (int argc, char ** argv) {
     int color_int = parameters["color-space"].as<int>();
     bool color = color_int > 0 ? true : false;
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
     int type = 1;
     if (parameters.find("compact") != parameters.end()) {
         type = 0;
@@ -135,9 +151,12 @@ int main (int argc, char ** argv) {
     IOUtil::readDirectory(input_dir, extensions, images);
     
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         cv::Mat labels;
         
@@ -145,11 +164,12 @@ int main (int argc, char ** argv) {
         int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
                 superpixels);
         
-        boost::timer timer;
+        RuntimeHarness::Timer timer;
         CIS_OpenCV::computeSuperpixels(image, region_size, lambda, iterations, 
-                type, sigma, color, labels);
+                type, sigma, color, labels, threads);
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
         int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
 //        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
@@ -164,9 +184,9 @@ int main (int argc, char ** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
         }
         
         if (!vis_dir.empty()) {
@@ -188,6 +208,11 @@ int main (int argc, char ** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
@@ -33,9 +33,10 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "crs_opencv.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -53,12 +54,20 @@
  *                                           direct clique cost
  *     -t [ --iterations ] arg (=3)          number of iterations to perform
  *     -r [ --color-space ] arg (=0)         color space: 0 = YCrCb, 1 = RGB
+ *     -n [ --threads ] arg (=1)             number of threads, more than one 
+ *                                           relaxes pixels in parallel color 
+ *                                           phases
  *     -f [ --fair ]                         for a fair comparison with other 
  *                                           algorithms, quadratic blocks are used 
  *                                           for initialization
  *     -o [ --csv ] arg                      save segmentation as CSV file
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
+ *     --memory                              write per image allocations and
+ *                                           peak memory to memory.csv next to
+ *                                           runtime.txt
+ *     --png                                 write segmentations as 16-bit
+ *                                           PNG instead of CSV
  *     -w [ --wordy ]                        verbose/wordy/debug
  * \encode
  * \author David Stutz
@@ -74,10 +83,13 @@ int main(int argc, const char** argv) {
         ("clique-cost,l", boost::program_options::value<double>()->default_value(0.3),  "direct clique cost")
         ("iterations,t", boost::program_options::value<int>()->default_value(3), "number of iterations to perform")
         ("color-space,r", boost::program_options::value<int>()->default_value(0), "color space: 0 = YCrCb, 1 = RGB")
+        ("threads,n", boost::program_options::value<int>()->default_value(1), "number of threads, more than one relaxes pixels in parallel color phases")
         ("fair,f", "for a fair comparison with other algorithms, quadratic blocks are used for initialization")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
         ("wordy,w", "verbose/wordy/debug");
 
     boost::program_options::positional_options_description positionals;
@@ -113,6 +125,7 @@ int main(int argc, const char** argv) {
     }
         
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
@@ -124,21 +137,30 @@ int main(int argc, const char** argv) {
     double compactness = parameters["compactness"].as<double>();
     int iterations = parameters["iterations"].as<int>();
     int color_space = parameters["color-space"].as<int>();
+    int threads = parameters["threads"].as<int>();
     
     if (color_space < 0 || color_space > 1) {
         std::cout << "Invalid color space." << std::endl;
         return 1;
     }
     
+    if (threads < 1) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(input_dir, extensions, images);
     
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         cv::Mat labels;
         
@@ -154,11 +176,12 @@ int main(int argc, const char** argv) {
             region_height = region_width;
         }
         
-        boost::timer timer;
+        RuntimeHarness::Timer timer;
         CRS_OpenCV::computeSuperpixels(image, region_height, region_width, clique_cost, 
-                compactness, iterations, color_space, labels);
+                compactness, iterations, color_space, labels, threads);
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
         int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
 //        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
@@ -173,9 +196,9 @@ int main(int argc, const char** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
         }
         
         if (!vis_dir.empty()) {
@@ -197,6 +220,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
@@ -33,9 +33,12 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "compact_watershed.h"
+#include "image_loader.h"
 #include "io_util.h"
+#include "frame_stream.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -50,9 +53,35 @@
  *     -c [ --compactness ] arg (=1)   compactness
  *     -f [ --fair ]                   for a fair comparison with other algorithms, 
  *                                     quadratic blocks are used for initialization
+ *     -l [ --labels-only ]            take the labels from the watershed instead of 
+ *                                     computing them from the boundary map
+ *     -t [ --video ]                  the images are consecutive frames: seeds are 
+ *                                     the centroids of the previous frame, 
+ *                                     unchanged frames keep their labels
+ *     -j [ --threads ] arg (=1)       number of threads per image, with more 
+ *                                     than one blocks of seed cells are flooded
+ *                                     concurrently
  *     -o [ --csv ] arg                save segmentation as CSV file
  *     -v [ --vis ] arg                visualize contours
  *     -x [ --prefix ] arg             output file prefix
+ *     --memory                        write per image allocations and peak
+ *                                     memory to memory.csv next to runtime.txt
+ *     --png                           write segmentations as 16-bit PNG
+ *                                     instead of CSV
+ *     --hierarchy arg                 numbers of superpixels derived by merging
+ *                                     superpixels hierarchically, written to
+ *                                     one subdirectory of --csv per number
+ *     --reduce arg (=1)               decode images at 1/2, 1/4 or 1/8
+ *                                     resolution, labels are upsampled
+ *     --prefetch arg (=0)             number of images decoded ahead on
+ *                                     background threads
+ *     --stream arg                    read raw BGR frames of size WIDTHxHEIGHT
+ *                                     instead of images and write label maps
+ *                                     in the binary label format
+ *     --stream-input arg (=-)         frames: - for stdin or shm:name for a
+ *                                     shared memory ring
+ *     --stream-output arg (=-)        label maps: - for stdout or shm:name for
+ *                                     a shared memory ring
  *     -w [ --wordy ]                  verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -66,9 +95,20 @@ int main(int argc, const char** argv) {
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "superpiels")
         ("compactness,c", boost::program_options::value<float>()->default_value(1.0f), "compactness")
         ("fair,f", "for a fair comparison with other algorithms, quadratic blocks are used for initialization")
+        ("labels-only,l", "take the labels from the watershed instead of computing them from the boundary map")
+        ("video,t", "the images are consecutive frames: seeds are the centroids of the previous frame, unchanged frames keep their labels")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads per image, with more than one blocks of seed cells are flooded concurrently")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("hierarchy", boost::program_options::value<std::vector<int>>()->multitoken(), "numbers of superpixels derived by merging superpixels hierarchically, written to one subdirectory of --csv per number")
+        ("reduce", boost::program_options::value<int>()->default_value(1), "decode images at 1/2, 1/4 or 1/8 resolution, labels are upsampled")
+        ("prefetch", boost::program_options::value<int>()->default_value(0), "number of images decoded ahead on background threads")
+        ("stream", boost::program_options::value<std::string>(), "read raw BGR frames of size WIDTHxHEIGHT instead of images and write label maps in the binary label format")
+        ("stream-input", boost::program_options::value<std::string>()->default_value("-"), "frames: - for stdin or shm:name for a shared memory ring")
+        ("stream-output", boost::program_options::value<std::string>()->default_value("-"), "label maps: - for stdout or shm:name for a shared memory ring")
         ("wordy,w", "verbose/wordy/debug");
     
     boost::program_options::positional_options_description positionals;
@@ -97,37 +137,216 @@ int main(int argc, const char** argv) {
         }
     }
     
-    boost::filesystem::path input_dir(parameters["input"].as<std::string>());
-    if (!boost::filesystem::is_directory(input_dir)) {
+    // Frames are read from --stream-input instead of the image directory.
+    bool stream_frames = (parameters.find("stream") != parameters.end());
+    
+    boost::filesystem::path input_dir;
+    if (parameters.find("input") != parameters.end()) {
+        input_dir = boost::filesystem::path(parameters["input"].as<std::string>());
+    }
+    
+    if (!stream_frames && !boost::filesystem::is_directory(input_dir)) {
         std::cout << "Image directory not found ..." << std::endl;
         return 1;
     }
     
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
         wordy = true;
     }
     
+    std::vector<int> hierarchy;
+    if (parameters.find("hierarchy") != parameters.end()) {
+        hierarchy = parameters["hierarchy"].as<std::vector<int>>();
+    }
+    
+    for (unsigned int k = 0; k < hierarchy.size(); ++k) {
+        if (hierarchy[k] <= 0) {
+            std::cout << "Numbers of superpixels for --hierarchy need to be positive." << std::endl;
+            return 1;
+        }
+        
+        if (!output_dir.empty() && !boost::filesystem::is_directory(output_dir / std::to_string(hierarchy[k]))) {
+            boost::filesystem::create_directories(output_dir / std::to_string(hierarchy[k]));
+        }
+    }
+    
+    int reduction = parameters["reduce"].as<int>();
+    if (!ImageLoader::isValidReduction(reduction)) {
+        std::cout << "Reduction needs to be 1, 2, 4 or 8 ..." << std::endl;
+        return 1;
+    }
+    
+    int prefetch = parameters["prefetch"].as<int>();
+    if (prefetch < 0) {
+        std::cout << "Number of prefetched images cannot be negative ..." << std::endl;
+        return 1;
+    }
+    
     int superpixels = parameters["superpixels"].as<int>();
     float compactness = parameters["compactness"].as<float>();
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    bool labels_only = false;
+    if (parameters.find("labels-only") != parameters.end()) {
+        labels_only = true;
+    }
+    
+    bool video = false;
+    if (parameters.find("video") != parameters.end()) {
+        video = true;
+    }
+    
+    if (stream_frames) {
+        if (reduction != 1) {
+            std::cout << "--reduce cannot be combined with --stream." << std::endl;
+            return 1;
+        }
+        
+        cv::Size frame_size;
+        if (!FrameStream::parseSize(parameters["stream"].as<std::string>(), frame_size)) {
+            std::cout << "Frame size for --stream needs to be given as WIDTHxHEIGHT." << std::endl;
+            return 1;
+        }
+        
+        std::string stream_input = parameters["stream-input"].as<std::string>();
+        std::string stream_output = parameters["stream-output"].as<std::string>();
+        
+        FrameStream stream;
+        if (!stream.open(stream_input, stream_output, frame_size)) {
+            std::cout << "Could not open " << stream_input << " or " << stream_output << "." << std::endl;
+            return 1;
+        }
+        
+        // Label maps may go to stdout, so messages go to stderr.
+        std::ostream &log = (FrameStream::isStdout(stream_output) ? std::cerr : std::cout);
+        
+        // As in video mode, the frames are consecutive; the frame buffer is
+        // reused by the stream, so the previous frame is copied.
+        cv::Mat previous_frame;
+        cv::Mat previous_labels;
+        cv::Mat tracked_seeds;
+        
+        float stream_total = 0;
+        cv::Mat frame;
+        while (stream.read(frame)) {
+            cv::Mat labels;
+            cv::Mat seeds;
+            cv::Mat boundaries;
+            
+            bool tracked = video && !previous_frame.empty();
+            if (tracked) {
+                seeds = tracked_seeds;
+            }
+            
+            int region_height;
+            int region_width;
+            SuperpixelTools::computeHeightWidthFromSuperpixels(frame, superpixels,
+                    region_height, region_width);
+            
+            if (parameters.find("fair") != parameters.end()) {
+                region_width = SuperpixelTools::computeRegionSizeFromSuperpixels(frame, 
+                        superpixels);
+                region_height = region_width;
+            }
+            
+            RuntimeHarness::Timer timer;
+            bool static_frame = tracked && cv::norm(frame, previous_frame, cv::NORM_INF) == 0;
+            if (static_frame) {
+                previous_labels.copyTo(labels);
+            }
+            else if (labels_only) {
+                compact_watershed_labels(frame, labels, region_height, region_width, 
+                        compactness, seeds, threads);
+            }
+            else {
+                compact_watershed(frame, boundaries, region_height, region_width, 
+                        compactness, seeds, threads);
+            }
+            float elapsed = timer.elapsed();
+            stream_total += elapsed;
+            
+            if (!labels_only && !static_frame) {
+                boundaries.convertTo(boundaries, CV_32S);
+                SuperpixelTools::computeLabelsFromBoundaries(frame, boundaries, labels);
+            }
+            
+            SuperpixelTools::relabelConnectedSuperpixels(labels);
+            
+            if (video) {
+                if (!static_frame) {
+                    compact_watershed_centroids(labels, tracked_seeds);
+                }
+                
+                frame.copyTo(previous_frame);
+                labels.copyTo(previous_labels);
+            }
+            
+            if (!stream.write(labels)) {
+                log << "Could not write labels of frame " << stream.getCount() << "." << std::endl;
+                return 1;
+            }
+            
+            if (wordy) {
+                log << SuperpixelTools::countSuperpixels(labels) << " superpixels for frame " 
+                        << stream.getCount() << " (" << elapsed << ")." << std::endl;
+            }
+        }
+        
+        if (wordy && stream.getCount() > 0) {
+            log << "Average time: " << stream_total / stream.getCount() << "." << std::endl;
+        }
+        
+        return 0;
+    }
+    
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(input_dir, extensions, images);
     
+    std::vector<std::string> files;
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
+            it != images.end(); ++it) {
+        files.push_back(it->first);
+    }
+    
+    // Images are returned in the order of images.
+    ImageLoader loader(files, reduction, prefetch);
+    
+    // Video mode: previous frame, its labels and their centroids.
+    cv::Mat previous_image;
+    cv::Mat previous_labels;
+    cv::Mat tracked_seeds;
+    
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
-        cv::Mat image = cv::imread(it->first);
+        memory_profile.begin(prefix + it->second.stem().string());
+        
+        cv::Mat image;
+        cv::Size size;
+        loader.next(image, size);
         
         cv::Mat labels;
         cv::Mat seeds;
         cv::Mat boundaries;
         
+        bool same_size = !previous_image.empty() && previous_image.size() == image.size();
+        if (video && same_size) {
+            seeds = tracked_seeds;
+        }
+        
         int region_height;
         int region_width;
         SuperpixelTools::computeHeightWidthFromSuperpixels(image, superpixels,
@@ -140,17 +359,40 @@ int main(int argc, const char** argv) {
             region_height = region_width;
         }
         
-        boost::timer timer;
-        compact_watershed(image, boundaries, region_height, region_width, 
-                compactness, seeds);
+        RuntimeHarness::Timer timer;
+        bool static_frame = video && same_size 
+                && cv::norm(image, previous_image, cv::NORM_INF) == 0;
+        if (static_frame) {
+            previous_labels.copyTo(labels);
+        }
+        else if (labels_only) {
+            compact_watershed_labels(image, labels, region_height, region_width, 
+                    compactness, seeds, threads);
+        }
+        else {
+            compact_watershed(image, boundaries, region_height, region_width, 
+                    compactness, seeds, threads);
+        }
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
-        boundaries.convertTo(boundaries, CV_32S);
-        SuperpixelTools::computeLabelsFromBoundaries(image, boundaries, labels);
+        if (!labels_only && !static_frame) {
+            boundaries.convertTo(boundaries, CV_32S);
+            SuperpixelTools::computeLabelsFromBoundaries(image, boundaries, labels);
+        }
         
         int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
         
+        if (video) {
+            if (!static_frame) {
+                compact_watershed_centroids(labels, tracked_seeds);
+            }
+            
+            previous_image = image;
+            labels.copyTo(previous_labels);
+        }
+        
         if (wordy) {
             std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
                     << " (" << unconnected_components << " not connected; " 
@@ -158,9 +400,25 @@ int main(int argc, const char** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            
+            cv::Mat output_labels;
+            ImageLoader::upsampleLabels(labels, size, output_labels);
+            IOUtil::writeLabels(label_file, output_labels);
+            
+            if (!hierarchy.empty()) {
+                std::vector<cv::Mat> hierarchy_labels;
+                SuperpixelTools::computeHierarchy(image, labels, hierarchy, hierarchy_labels);
+                
+                for (unsigned int k = 0; k < hierarchy.size(); ++k) {
+                    boost::filesystem::path hierarchy_file(output_dir / std::to_string(hierarchy[k])
+                            / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+                    
+                    ImageLoader::upsampleLabels(hierarchy_labels[k], size, hierarchy_labels[k]);
+                    IOUtil::writeLabels(hierarchy_file, hierarchy_labels[k]);
+                }
+            }
         }
         
         if (!vis_dir.empty()) {
@@ -182,6 +440,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
@@ -32,11 +32,11 @@
 #include <fstream>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/timer.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "dasp_opencv.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -72,10 +72,17 @@
  *     -n [ --normal-weight ] arg (=0.200000003)
  *                                           normal weight
  *     -t [ --iterations ] arg (=5)          iterations
+ *     -j [ --threads ] arg (=1)             number of threads, the labels do 
+ *                                           not depend on it
  *     -o [ --csv ] arg                      specify the output directory (default 
  *                                           is ./output)
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
+ *     --memory                              write per image allocations and
+ *                                           peak memory to memory.csv next to
+ *                                           runtime.txt
+ *     --png                                 write segmentations as 16-bit
+ *                                           PNG instead of CSV
  *     -w [ --wordy ]                        verbose/wordy/debug
  * \endcode 
  * \author David Stutz
@@ -99,9 +106,12 @@ int main(int argc, const char** argv) {
 //        ("color-weight,c", boost::program_options::value<float>()->default_value(2.0f), "color weight")
         ("normal-weight,n", boost::program_options::value<float>()->default_value(0.2f), "normal weight")
         ("iterations,t", boost::program_options::value<int>()->default_value(5), "iterations")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads, the labels do not depend on it")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "specify the output directory (default is ./output)")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
         ("wordy,w", "verbose/wordy/debug");
 
     boost::program_options::positional_options_description positionals;
@@ -145,6 +155,7 @@ int main(int argc, const char** argv) {
 
     boost::filesystem::path intrinsics_dir(parameters["intrinsics"].as<std::string>());
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
@@ -164,6 +175,7 @@ int main(int argc, const char** argv) {
     int superpixels = parameters["superpixels"].as<int>();
     int seed_mode = parameters["seed-mode"].as<int>();
     int iterations = parameters["iterations"].as<int>();
+    int threads = parameters["threads"].as<int>();
     
     if (spatial_weight < 0 || spatial_weight > 1) {
         std::cout << "Invalid spatial weight, select spatial weight in [0,1]." << std::endl;
@@ -180,15 +192,23 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(image_dir, extensions, images);
     
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         
         boost::filesystem::path depth_file = depth_dir 
@@ -236,12 +256,13 @@ int main(int argc, const char** argv) {
             camera.z_slope = 0.001f;
         }
         
-        boost::timer timer;
+        RuntimeHarness::Timer timer;
         cv::Mat labels;
         DASP_OpenCV::computeSuperpixels(image, depth, superpixels, spatial_weight, 
-                normal_weight, seed_mode, iterations, camera, labels);
+                normal_weight, seed_mode, iterations, camera, labels, threads);
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
         int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
         int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
@@ -256,9 +277,9 @@ int main(int argc, const char** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
         }
         
         if (!vis_dir.empty()) {
@@ -280,6 +301,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
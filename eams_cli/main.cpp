@@ -0,0 +1,240 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include "eams_opencv.h"
+#include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
+#include "superpixel_tools.h"
+#include "thread_pool.h"
+#include "visualization.h"
+
+/** \brief Command line tool for running EAMS, the C++ counterpart of eams_cli.m.
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/eams_cli --help
+ *   Allowed options:
+ *     -h [ --help ]                     produce help message
+ *     -i [ --input ] arg                the folder to process (can also be passed 
+ *                                       as positional argument)
+ *     -b [ --bandwidth ] arg (=1)       spatial bandwidth
+ *     -r [ --range-bandwidth ] arg (=6.5) feature space bandwidth
+ *     -m [ --minimum-size ] arg (=20)   minimum size of superpixels
+ *     -c [ --rgb ] arg (=0)             use RGB instead of Luv
+ *     -u [ --speedup ] arg (=2)         speedup level, 1 (none), 2 (medium) or 3 
+ *                                       (high)
+ *     -p [ --parallel ]                 filter bands of rows in parallel (the 
+ *                                       speedups are restricted to the bands)
+ *     -g [ --graph-fusion ]             fuse and prune regions in one pass on a 
+ *                                       region adjacency graph
+ *     -o [ --csv ] arg                  specify the output directory (default is 
+ *                                       ./output)
+ *     -v [ --vis ] arg                  visualize contours
+ *     -x [ --prefix ] arg               output file prefix
+ *     --memory                          write per image allocations and peak
+ *                                       memory to memory.csv next to
+ *                                       runtime.txt
+ *     --png                             write segmentations as 16-bit PNG
+ *                                       instead of CSV
+ *     -j [ --threads ] arg (=1)         number of threads to relabel connected
+ *                                       components on the shared pool
+ *     -w [ --wordy ]                    verbose/wordy/debug
+ * \endcode
+ * \author David Stutz
+ */
+int main(int argc, const char** argv) {
+
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("input,i", boost::program_options::value<std::string>(), "the folder to process (can also be passed as positional argument)")
+        ("bandwidth,b", boost::program_options::value<int>()->default_value(1), "spatial bandwidth")
+        ("range-bandwidth,r", boost::program_options::value<float>()->default_value(6.5), "feature space bandwidth")
+        ("minimum-size,m", boost::program_options::value<int>()->default_value(20), "minimum size of superpixels")
+        ("rgb,c", boost::program_options::value<int>()->default_value(0), "use RGB instead of Luv")
+        ("speedup,u", boost::program_options::value<int>()->default_value(2), "speedup level, 1 (none), 2 (medium) or 3 (high)")
+        ("parallel,p", "filter bands of rows in parallel (the speedups are restricted to the bands)")
+        ("graph-fusion,g", "fuse and prune regions in one pass on a region adjacency graph")
+        ("csv,o", boost::program_options::value<std::string>()->default_value(""), "specify the output directory (default is ./output)")
+        ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
+        ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads to relabel connected components on the shared pool")
+        ("wordy,w", "verbose/wordy/debug");
+        
+    boost::program_options::positional_options_description positionals;
+    positionals.add("input", 1);
+
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+
+    boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
+    if (!output_dir.empty()) {
+        if (!boost::filesystem::is_directory(output_dir)) {
+            boost::filesystem::create_directories(output_dir);
+        }
+    }
+    
+    boost::filesystem::path vis_dir(parameters["vis"].as<std::string>());
+    if (!vis_dir.empty()) {
+        if (!boost::filesystem::is_directory(vis_dir)) {
+            boost::filesystem::create_directories(vis_dir);
+        }
+    }
+    
+    boost::filesystem::path input_dir(parameters["input"].as<std::string>());
+    if (!boost::filesystem::is_directory(input_dir)) {
+        std::cout << "Image directory not found ..." << std::endl;
+        return 1;
+    }
+
+    std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
+    
+    bool wordy = false;
+    if (parameters.find("wordy") != parameters.end()) {
+        wordy = true;
+    }
+    
+    int bandwidth = parameters["bandwidth"].as<int>();
+    float range_bandwidth = parameters["range-bandwidth"].as<float>();
+    int minimum_size = parameters["minimum-size"].as<int>();
+    int rgb_int = parameters["rgb"].as<int>();
+    bool rgb = rgb_int > 0 ? true : false;
+    
+    int speedup = parameters["speedup"].as<int>();
+    if (speedup < 1 || speedup > 3) {
+        std::cout << "Speedup level needs to be 1, 2 or 3 ..." << std::endl;
+        return 1;
+    }
+    
+    if (bandwidth <= 0 || range_bandwidth <= 0) {
+        std::cout << "Bandwidths need to be positive ..." << std::endl;
+        return 1;
+    }
+    
+    bool parallel = false;
+    if (parameters.find("parallel") != parameters.end()) {
+        parallel = true;
+    }
+    
+    bool graph_fusion = false;
+    if (parameters.find("graph-fusion") != parameters.end()) {
+        graph_fusion = true;
+    }
+    
+    std::multimap<std::string, boost::filesystem::path> images;
+    std::vector<std::string> extensions;
+    IOUtil::getImageExtensions(extensions);
+    IOUtil::readDirectory(input_dir, extensions, images);
+    
+    float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
+            it != images.end(); ++it) {
+        
+        memory_profile.begin(prefix + it->second.stem().string());
+        
+        cv::Mat image = cv::imread(it->first);
+        cv::Mat labels;
+        
+        RuntimeHarness::Timer timer;
+        EAMS_OpenCV::computeSuperpixels(image, bandwidth, range_bandwidth, 
+                minimum_size, rgb, speedup, parallel, graph_fusion, labels);
+        float elapsed = timer.elapsed();
+        total += elapsed;
+        memory_profile.end();
+        
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels, threads);
+//        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
+        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
+        SuperpixelTools::relabelSuperpixels(labels);
+        
+        if (wordy) {
+            std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
+                    << " (" << unconnected_components << " not connected; " 
+                    << merged_components << " merged; "
+                    << elapsed <<")." << std::endl;
+        }
+        
+        if (!output_dir.empty()) {
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
+        }
+        
+        if (!vis_dir.empty()) {
+            boost::filesystem::path contours_file(vis_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + ".png"));
+            cv::Mat image_contours;
+            Visualization::drawContours(image, labels, image_contours);
+            cv::imwrite(contours_file.string(), image_contours);
+        }
+    }
+    
+    if (wordy) {
+        std::cout << "Average time: " << total / images.size() << "." << std::endl;
+    }
+    
+    if (!output_dir.empty()) {
+        std::ofstream runtime_file(output_dir.string() + "/" + prefix + "runtime.txt", 
+                std::ofstream::out | std::ofstream::app);
+        
+        runtime_file << total / images.size() << "\n";
+        runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
+    }
+    
+    return 0;
+}
@@ -32,12 +32,15 @@
 #include <fstream>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/timer.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "ergc_opencv.h"
+#include "ergc_video_opencv.h"
+#include "image_loader.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
+#include "thread_pool.h"
 #include "visualization.h"
 
 /** \brief Command line tool for running ERGC.
@@ -53,9 +56,28 @@
  *     -c [ --compacity ] arg (=0)     compacity
  *     -f [ --fair ]                   for a fair comparison with other algorithms, 
  *                                     quadratic blocks are used for initialization
+ *     -t [ --supervoxels ]            the images are the frames of one video, 
+ *                                     compute supervoxels (in chunks of frames)
+ *     -z [ --temporal-step ] arg (=5) supervoxels: frames between seeds
+ *     -k [ --chunk ] arg (=20)        supervoxels: frames segmented at once
+ *     -l [ --overlap ] arg (=2)       supervoxels: frames of the previous chunk 
+ *                                     continuing its supervoxels
+ *     --refine arg (=0)               number of seeds added after the initial
+ *                                     segmentation where the geodesic distance
+ *                                     is largest
  *     -o [ --csv ] arg                save segmentation as CSV file
  *     -v [ --vis ] arg                visualize contours
  *     -x [ --prefix ] arg             output file prefix
+ *     --memory                        write per image allocations and peak
+ *                                     memory to memory.csv next to runtime.txt
+ *     --png                           write segmentations as 16-bit PNG
+ *                                     instead of CSV
+ *     --reduce arg (=1)               decode images at 1/2, 1/4 or 1/8
+ *                                     resolution, labels are upsampled
+ *     --prefetch arg (=0)             number of images decoded ahead on
+ *                                     background threads
+ *     -j [ --threads ] arg (=1)       number of threads to relabel connected
+ *                                     components on the shared pool
  *     -w [ --wordy ]                  verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -71,9 +93,19 @@ int main(int argc, const char** argv) {
         ("perturb-seeds,p", boost::program_options::value<int>()->default_value(1), ">0 for perturbing seeds")
         ("compacity,c", boost::program_options::value<int>()->default_value(0), "compacity")
         ("fair,f", "for a fair comparison with other algorithms, quadratic blocks are used for initialization")
+        ("supervoxels,t", "the images are the frames of one video, compute supervoxels (in chunks of frames)")
+        ("temporal-step,z", boost::program_options::value<int>()->default_value(5), "supervoxels: frames between seeds")
+        ("chunk,k", boost::program_options::value<int>()->default_value(20), "supervoxels: frames segmented at once")
+        ("overlap,l", boost::program_options::value<int>()->default_value(2), "supervoxels: frames of the previous chunk continuing its supervoxels")
+        ("refine", boost::program_options::value<int>()->default_value(0), "number of seeds added after the initial segmentation where the geodesic distance is largest")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("reduce", boost::program_options::value<int>()->default_value(1), "decode images at 1/2, 1/4 or 1/8 resolution, labels are upsampled")
+        ("prefetch", boost::program_options::value<int>()->default_value(0), "number of images decoded ahead on background threads")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads to relabel connected components on the shared pool")
         ("wordy,w", "verbose/wordy/debug");
 
     boost::program_options::positional_options_description positionals;
@@ -88,6 +120,14 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -109,12 +149,25 @@ int main(int argc, const char** argv) {
     }
     
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
         wordy = true;
     }
     
+    int reduction = parameters["reduce"].as<int>();
+    if (!ImageLoader::isValidReduction(reduction)) {
+        std::cout << "Reduction needs to be 1, 2, 4 or 8 ..." << std::endl;
+        return 1;
+    }
+    
+    int prefetch = parameters["prefetch"].as<int>();
+    if (prefetch < 0) {
+        std::cout << "Number of prefetched images cannot be negative ..." << std::endl;
+        return 1;
+    }
+    
     int superpixels = parameters["superpixels"].as<int>();
     int color_space = parameters["color-space"].as<int>();
     
@@ -131,16 +184,158 @@ int main(int argc, const char** argv) {
     
     int compacity = parameters["compacity"].as<int>();
     
+    int refine = parameters["refine"].as<int>();
+    if (refine < 0) {
+        std::cout << "Number of refinement seeds cannot be negative." << std::endl;
+        return 1;
+    }
+    
+    int temporal_step = parameters["temporal-step"].as<int>();
+    if (temporal_step <= 0) {
+        std::cout << "Temporal step needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    int chunk = parameters["chunk"].as<int>();
+    if (chunk <= 0) {
+        std::cout << "Chunk size needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    int overlap = parameters["overlap"].as<int>();
+    if (overlap < 0) {
+        std::cout << "Overlap cannot be negative." << std::endl;
+        return 1;
+    }
+    
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(input_dir, extensions, images);
     
+    std::vector<std::string> files;
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
+            it != images.end(); ++it) {
+        files.push_back(it->first);
+    }
+    
+    // Images are returned in the order of images.
+    ImageLoader loader(files, reduction, prefetch);
+    
+    if (parameters.find("supervoxels") != parameters.end()) {
+        
+        // Frames are kept until their chunk is segmented (for the outputs).
+        std::vector<std::multimap<std::string, boost::filesystem::path>::iterator> pending;
+        std::vector<cv::Mat> pending_images;
+        std::vector<cv::Size> pending_sizes;
+        std::vector<cv::Mat> frame_labels;
+        
+        SVStream stream;
+        float total = 0;
+        MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
+        
+        for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
+                it != images.end(); ++it) {
+            
+            memory_profile.begin(prefix + it->second.stem().string());
+            
+            cv::Mat image;
+            cv::Size size;
+            loader.next(image, size);
+            
+            if (it == images.begin()) {
+                int region_width;
+                int region_height;
+                SuperpixelTools::computeHeightWidthFromSuperpixels(image, superpixels, 
+                        region_height, region_width);
+
+                // If a fair comparison is requested:
+                if (parameters.find("fair") != parameters.end()) {
+                    region_width = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                            superpixels);
+                    region_height = region_width;
+                }
+                
+                ERGCVideo_OpenCV::initialize(image.rows, image.cols, region_height, 
+                        region_width, temporal_step, chunk, overlap, perturb_seeds, 
+                        compacity, stream);
+            }
+            
+            pending.push_back(it);
+            pending_images.push_back(image);
+            pending_sizes.push_back(size);
+            
+            RuntimeHarness::Timer timer;
+            ERGCVideo_OpenCV::addFrame(image, lab, stream, frame_labels);
+            
+            std::multimap<std::string, boost::filesystem::path>::iterator next = it;
+            ++next;
+            if (next == images.end()) {
+                ERGCVideo_OpenCV::flush(stream, frame_labels);
+            }
+            total += timer.elapsed();
+            memory_profile.end();
+            
+            for (unsigned int k = 0; k < frame_labels.size(); k++) {
+                if (wordy) {
+                    std::cout << SuperpixelTools::countSuperpixels(frame_labels[k]) 
+                            << " supervoxels in " << pending[k]->first << "." << std::endl;
+                }
+                
+                if (!output_dir.empty()) {
+                    boost::filesystem::path label_file(output_dir 
+                            / boost::filesystem::path(prefix + pending[k]->second.stem().string() + label_extension));
+                    
+                    cv::Mat output_labels;
+                    ImageLoader::upsampleLabels(frame_labels[k], pending_sizes[k], output_labels);
+                    IOUtil::writeLabels(label_file, output_labels);
+                }
+
+                if (!vis_dir.empty()) {
+                    boost::filesystem::path contours_file(vis_dir 
+                            / boost::filesystem::path(prefix + pending[k]->second.stem().string() + ".png"));
+                    cv::Mat image_contours;
+                    Visualization::drawContours(pending_images[k], frame_labels[k], image_contours);
+                    cv::imwrite(contours_file.string(), image_contours);
+                }
+            }
+            
+            pending.erase(pending.begin(), pending.begin() + frame_labels.size());
+            pending_images.erase(pending_images.begin(), pending_images.begin() + frame_labels.size());
+            pending_sizes.erase(pending_sizes.begin(), pending_sizes.begin() + frame_labels.size());
+            frame_labels.clear();
+        }
+        
+        if (wordy) {
+            std::cout << "Average time: " << total / images.size() << "." << std::endl;
+        }
+
+        if (!output_dir.empty()) {
+            std::ofstream runtime_file(output_dir.string() + "/" + prefix + "runtime.txt", 
+                    std::ofstream::out | std::ofstream::app);
+
+            runtime_file << total / images.size() << "\n";
+            runtime_file.close();
+            
+            if (memory_profile.isEnabled()) {
+                MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                        memory_profile.getRecords());
+            }
+        }
+        
+        return 0;
+    }
+    
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
-        cv::Mat image = cv::imread(it->first);
+        memory_profile.begin(prefix + it->second.stem().string());
+        
+        cv::Mat image;
+        cv::Size size;
+        loader.next(image, size);
         
         int region_width;
         int region_height;
@@ -155,14 +350,15 @@ int main(int argc, const char** argv) {
         }
         
         
-        boost::timer timer;
+        RuntimeHarness::Timer timer;
         cv::Mat labels;
         ERGC_OpenCV::computeSuperpixels(image, region_height, region_width, 
-                lab, perturb_seeds, compacity, labels);
+                lab, perturb_seeds, compacity, labels, refine);
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
-        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels, threads);
         
         if (wordy) {
             std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
@@ -171,9 +367,12 @@ int main(int argc, const char** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            
+            cv::Mat output_labels;
+            ImageLoader::upsampleLabels(labels, size, output_labels);
+            IOUtil::writeLabels(label_file, output_labels);
         }
         
         if (!vis_dir.empty()) {
@@ -195,6 +394,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
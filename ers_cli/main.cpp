@@ -32,12 +32,13 @@
 #include <fstream>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/timer.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "ers_opencv.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
+#include "thread_pool.h"
 #include "visualization.h"
 
 /** \brief Command line tool for running ERS.
@@ -50,10 +51,18 @@
  *     -l [ --lambda ] arg (=0.5)      lambda
  *     -g [ --sigma ] arg (=5)         sigma
  *     -f [ --eight-connected ]        use 8-connected
- *     -s [ --superpixels ] arg (=400) number of superpixels
+ *     -s [ --superpixels ] arg (=400) numbers of superpixels, computed from
+ *                                     a single run; with several numbers the
+ *                                     outputs go to one subdirectory per number
  *     -o [ --csv ] arg                save segmentation as CSV file
  *     -v [ --vis ] arg                visualize contours
  *     -x [ --prefix ] arg             output file prefix
+ *     --memory                        write per image allocations and peak
+ *                                     memory to memory.csv next to runtime.txt
+ *     --png                           write segmentations as 16-bit PNG
+ *                                     instead of CSV
+ *     -j [ --threads ] arg (=1)       number of threads to relabel connected
+ *                                     components on the shared pool
  *     -w [ --wordy ]                  verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -67,10 +76,13 @@ int main(int argc, const char** argv) {
         ("lambda,l", boost::program_options::value<double>()->default_value(0.5), "lambda")
         ("sigma,g", boost::program_options::value<double>()->default_value(5.0), "sigma")
         ("eight-connected,f", "use 8-connected")
-        ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixels")
+        ("superpixels,s", boost::program_options::value<std::vector<int>>()->multitoken()->default_value(std::vector<int>{400}, "400"), "numbers of superpixels, computed from a single run; with several numbers the outputs go to one subdirectory per number")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads to relabel connected components on the shared pool")
         ("wordy,w", "verbose/wordy/debug");
 
     boost::program_options::positional_options_description positionals;
@@ -85,6 +97,14 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -106,6 +126,7 @@ int main(int argc, const char** argv) {
     }
     
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
@@ -117,7 +138,30 @@ int main(int argc, const char** argv) {
         four_connected = 0;
     }
     
-    int superpixels = parameters["superpixels"].as<int>();
+    std::vector<int> superpixels = parameters["superpixels"].as<std::vector<int>>();
+    for (unsigned int k = 0; k < superpixels.size(); ++k) {
+        if (superpixels[k] <= 0) {
+            std::cout << "Number of superpixels needs to be positive." << std::endl;
+            return 1;
+        }
+    }
+    
+    // A single number keeps the flat output layout
+    std::vector<std::string> sub_dirs(superpixels.size(), "");
+    if (superpixels.size() > 1) {
+        for (unsigned int k = 0; k < superpixels.size(); ++k) {
+            sub_dirs[k] = std::to_string(superpixels[k]);
+            
+            if (!output_dir.empty() && !boost::filesystem::is_directory(output_dir / sub_dirs[k])) {
+                boost::filesystem::create_directories(output_dir / sub_dirs[k]);
+            }
+            
+            if (!vis_dir.empty() && !boost::filesystem::is_directory(vis_dir / sub_dirs[k])) {
+                boost::filesystem::create_directories(vis_dir / sub_dirs[k]);
+            }
+        }
+    }
+    
     double lambda = parameters["lambda"].as<double>();
     double sigma = parameters["sigma"].as<double>();
     
@@ -127,42 +171,48 @@ int main(int argc, const char** argv) {
     IOUtil::readDirectory(input_dir, extensions, images);
     
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         
-        boost::timer timer;
-        cv::Mat labels;
+        RuntimeHarness::Timer timer;
+        std::vector<cv::Mat> labels;
         ERS_OpenCV::computeSuperpixels(image, superpixels, lambda, sigma, 
                 four_connected, labels);
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
-        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
-//        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
-//        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
-//        SuperpixelTools::relabelSuperpixels(labels);
+        for (unsigned int k = 0; k < labels.size(); ++k) {
+            int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels[k], threads);
+//            int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels[k], 5);
+//            int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels[k], unconnected_components);
+//            SuperpixelTools::relabelSuperpixels(labels[k]);
 
-        if (wordy) {
-            std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
-                    << " (" << unconnected_components << " not connected; " 
-//                    << merged_components << " merged; "
-                    << elapsed <<")." << std::endl;
-        }
-        
-        if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
-        }
-        
-        if (!vis_dir.empty()) {
-            boost::filesystem::path contours_file(vis_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".png"));
-            cv::Mat image_contours;
-            Visualization::drawContours(image, labels, image_contours);
-            cv::imwrite(contours_file.string(), image_contours);
+            if (wordy) {
+                std::cout << SuperpixelTools::countSuperpixels(labels[k]) << " superpixels for " << it->first 
+                        << " (" << unconnected_components << " not connected; " 
+//                        << merged_components << " merged; "
+                        << elapsed <<")." << std::endl;
+            }
+
+            if (!output_dir.empty()) {
+                boost::filesystem::path label_file(output_dir / sub_dirs[k]
+                        / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+                IOUtil::writeLabels(label_file, labels[k]);
+            }
+
+            if (!vis_dir.empty()) {
+                boost::filesystem::path contours_file(vis_dir / sub_dirs[k]
+                        / boost::filesystem::path(prefix + it->second.stem().string() + ".png"));
+                cv::Mat image_contours;
+                Visualization::drawContours(image, labels[k], image_contours);
+                cv::imwrite(contours_file.string(), image_contours);
+            }
         }
     }
     
@@ -176,6 +226,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
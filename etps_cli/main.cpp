@@ -32,11 +32,11 @@
 #include <fstream>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/timer.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "etps_opencv.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -53,9 +53,25 @@
  *     -l [ --length-weight ] arg (=1)       length weight
  *     -n [ --size-weight ] arg (=1)         size weight
  *     -t [ --iterations ] arg (=1)          number of iterations
+ *     -j [ --threads ] arg (=1)             number of threads for pixel moves
+ *     -r [ --warm-start ]                   treat the images as video frames, 
+ *                                           initializing each frame with the 
+ *                                           superpixels of the previous frame
  *     -o [ --csv ] arg                      save segmentation as CSV file
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
+ *     -p [ --performance ] arg              append per image timings of all 
+ *                                           phases and levels as JSON lines to 
+ *                                           this file
+ *     --memory                              write per image allocations and
+ *                                           peak memory to memory.csv next to
+ *                                           runtime.txt
+ *     --png                                 write segmentations as 16-bit
+ *                                           PNG instead of CSV
+ *     --hierarchy arg                       numbers of superpixels derived by
+ *                                           merging superpixels hierarchically,
+ *                                           written to one subdirectory of
+ *                                           --csv per number
  *     -w [ --wordy ]                        verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -71,9 +87,15 @@ int main(int argc, const char** argv) {
         ("length-weight,l", boost::program_options::value<double>()->default_value(1.0), "length weight")
         ("size-weight,n", boost::program_options::value<double>()->default_value(1.0), "size weight")
         ("iterations,t", boost::program_options::value<int>()->default_value(1), "number of iterations")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads for pixel moves")
+        ("warm-start,r", "treat the images as video frames, initializing each frame with the superpixels of the previous frame")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("performance,p", boost::program_options::value<std::string>()->default_value(""), "append per image timings of all phases and levels as JSON lines to this file")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("hierarchy", boost::program_options::value<std::vector<int>>()->multitoken(), "numbers of superpixels derived by merging superpixels hierarchically, written to one subdirectory of --csv per number")
         ("wordy,w", "verbose/wordy/debug");
 
     boost::program_options::positional_options_description positionals;
@@ -109,42 +131,107 @@ int main(int argc, const char** argv) {
     }
     
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
+    
+    std::string performance_path = parameters["performance"].as<std::string>();
+    std::ofstream performance_file;
+    if (!performance_path.empty()) {
+        performance_file.open(performance_path.c_str(), std::ofstream::out | std::ofstream::app);
+        if (!performance_file.is_open()) {
+            std::cout << "Could not open performance file ..." << std::endl;
+            return 1;
+        }
+    }
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
         wordy = true;
     }
     
+    std::vector<int> hierarchy;
+    if (parameters.find("hierarchy") != parameters.end()) {
+        hierarchy = parameters["hierarchy"].as<std::vector<int>>();
+    }
+    
+    for (unsigned int k = 0; k < hierarchy.size(); ++k) {
+        if (hierarchy[k] <= 0) {
+            std::cout << "Numbers of superpixels for --hierarchy need to be positive." << std::endl;
+            return 1;
+        }
+        
+        if (!output_dir.empty() && !boost::filesystem::is_directory(output_dir / std::to_string(hierarchy[k]))) {
+            boost::filesystem::create_directories(output_dir / std::to_string(hierarchy[k]));
+        }
+    }
+    
     int superpixels = parameters["superpixels"].as<int>();
     double regularization_weight = parameters["regularization-weight"].as<double>();
     double length_weight = parameters["length-weight"].as<double>();
     double size_weight = parameters["size-weight"].as<double>();
     int iterations = parameters["iterations"].as<int>();
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    bool warm_start = false;
+    if (parameters.find("warm-start") != parameters.end()) {
+        warm_start = true;
+    }
+    
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(input_dir, extensions, images);
     
+    // Only used for warm starts; the region size is fixed by the first frame.
+    ETPS_OpenCV* etps = NULL;
+    
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         
         // Same conversion for all algorithms.
         int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
                 superpixels);
         
-        boost::timer timer;
+        RuntimeHarness::Timer timer;
         cv::Mat labels;
-        ETPS_OpenCV::computeSuperpixels(image, region_size, regularization_weight, 
-                length_weight, size_weight, iterations, labels);
+        std::string performance;
+        std::string* performance_ptr = performance_file.is_open() ? &performance : NULL;
+        if (warm_start) {
+            if (etps == NULL) {
+                etps = new ETPS_OpenCV(region_size, regularization_weight, 
+                        length_weight, size_weight, iterations, threads);
+            }
+            
+            etps->computeNextSuperpixels(image, labels, performance_ptr);
+        }
+        else {
+            ETPS_OpenCV::computeSuperpixels(image, region_size, regularization_weight, 
+                    length_weight, size_weight, iterations, labels, threads, 
+                    performance_ptr);
+        }
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
         int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
         
+        if (performance_file.is_open()) {
+            performance_file << "{\"image\": \"" << it->second.stem().string() 
+                    << "\", \"region_size\": " << region_size 
+                    << ", \"time\": " << elapsed 
+                    << ", \"etps\": " << performance << "}" << std::endl;
+        }
+        
         if (wordy) {
             std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
                     << " (" << unconnected_components << " not connected; " 
@@ -152,9 +239,20 @@ int main(int argc, const char** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
+            
+            if (!hierarchy.empty()) {
+                std::vector<cv::Mat> hierarchy_labels;
+                SuperpixelTools::computeHierarchy(image, labels, hierarchy, hierarchy_labels);
+                
+                for (unsigned int k = 0; k < hierarchy.size(); ++k) {
+                    boost::filesystem::path hierarchy_file(output_dir / std::to_string(hierarchy[k])
+                            / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+                    IOUtil::writeLabels(hierarchy_file, hierarchy_labels[k]);
+                }
+            }
         }
         
         if (!vis_dir.empty()) {
@@ -166,6 +264,8 @@ int main(int argc, const char** argv) {
         }
     }
     
+    delete etps;
+    
     if (wordy) {
         std::cout << "Average time: " << total / images.size() << "." << std::endl;
     }
@@ -176,6 +276,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
@@ -38,19 +38,92 @@
 #include <glog/logging.h>
 
 #include "io_util.h"
+#include "thread_pool.h"
 #include "evaluation.h"
 
+/** \brief Metrics read from a single CSV summary file. */
+struct SummaryAverages {
+    /** \brief Number of superpixels. */
+    std::vector<float> superpixels;
+    /** \brief Boundary recall for each number of superpixels. */
+    std::vector<float> rec;
+    /** \brief 1 - undersegmentation error for each number of superpixels. */
+    std::vector<float> ue;
+    /** \brief Explained variation for each number of superpixels. */
+    std::vector<float> ev;
+    /** \brief Average boundary recall. */
+    float avg_rec;
+    /** \brief Average 1 - undersegmentation error. */
+    float avg_ue;
+    /** \brief Average explained variation. */
+    float avg_ev;
+};
+
+/** \brief Read a CSV summary file and compute the average metrics.
+ * \param[in] summary_file CSV summary file
+ * \param[out] averages metrics and their averages
+ */
+void computeAverages(const boost::filesystem::path &summary_file, SummaryAverages &averages) {
+    
+    std::vector<std::string> row_headers;
+    std::vector<std::string> col_headers;
+    cv::Mat data;
+    
+    IOUtil::readCSVSummary(summary_file, row_headers, col_headers, data);
+    
+    std::string rec_key = "rec";
+    std::string rec_statistic = "mean_min";
+    
+    std::string ue_key = "ue_np";
+    std::string ue_statistic = "mean_max";
+    
+    std::string ev_key = "ev";
+    std::string ev_statistic = "mean_min";
+    
+    for (int i = 0; i < data.rows; i++) {
+        for (int j = 0; j < data.cols; j++) {
+            if (col_headers[j + 1] == rec_statistic && row_headers[i + 1] == rec_key) {
+                averages.rec.push_back(data.at<float>(i, j));
+            }
+            if (col_headers[j + 1] == ue_statistic && row_headers[i + 1] == ue_key) {
+                averages.ue.push_back(1 - data.at<float>(i, j));
+            }
+            if (col_headers[j + 1] == ev_statistic && row_headers[i + 1] == ev_key) {
+                averages.ev.push_back(data.at<float>(i, j));
+            }
+            if (col_headers[j + 1] == "mean_min" && row_headers[i + 1] == "sp") {
+                averages.superpixels.push_back(data.at<float>(i, j));
+            }
+        }
+    }
+    
+    LOG_IF(FATAL, averages.superpixels.size() != averages.rec.size() 
+            || averages.superpixels.size() != averages.ue.size() 
+            || averages.superpixels.size() != averages.ev.size())
+            << "Read invalid number of values from " << summary_file.string() << ".";
+    
+    averages.avg_rec = Evaluation::computeAverageMetric(averages.rec, averages.superpixels);
+    averages.avg_ue = Evaluation::computeAverageMetric(averages.ue, averages.superpixels);
+    averages.avg_ev = Evaluation::computeAverageMetric(averages.ev, averages.superpixels);
+}
+
 /** \brief Compute average metrics given a CSV file containing several evaluation summaries.
  * Use evaluation_summary_cli with the --append-file option to gather multiple
  * summaries in one file.
  * 
+ * Given multiple CSV summary files, e.g. one per algorithm, they are read in
+ * parallel and a single table of average metrics with one row per file is
+ * created.
+ * 
  * Usage:
  * \code[sh]
  * $ ../bin/eval_average_cli --help
  * Allowed options:
- *   --summary-file arg                    CSV summary file
+ *   --summary-file arg                    CSV summary file(s)
  *   -o [ --output-file ] arg (=average.csv)
  *                                         output file
+ *   --threads arg (=1)                    number of threads to read summary 
+ *                                         files in parallel
  *   --help                                produce help message
  * \endcode
  * \author David Stutz
@@ -59,12 +132,13 @@ int main(int argc, const char** argv) {
     
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
-        ("summary-file", boost::program_options::value<std::string>(), "CSV summary file")
+        ("summary-file", boost::program_options::value< std::vector<std::string> >()->multitoken(), "CSV summary file(s)")
         ("output-file,o", boost::program_options::value<std::string>()->default_value("average.csv"), "output file")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of threads to read summary files in parallel")
         ("help", "produce help message");
 
     boost::program_options::positional_options_description positionals;
-    positionals.add("summary-file", 1);
+    positionals.add("summary-file", -1);
     
     boost::program_options::variables_map parameters;
     boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
@@ -75,75 +149,80 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
-    boost::filesystem::path summary_file(parameters["summary-file"].as<std::string>());
-    if (!boost::filesystem::is_regular_file(summary_file)) {
-        std::cout << "CSV summary file not found." << std::endl;
+    if (parameters.find("summary-file") == parameters.end()) {
+        std::cout << "No CSV summary file given." << std::endl;
         return 1;
     }
     
-    std::vector<std::string> row_headers;
-    std::vector<std::string> col_headers;
-    cv::Mat data;
+    std::vector<std::string> summary_file_names = parameters["summary-file"].as< std::vector<std::string> >();
+    std::vector<boost::filesystem::path> summary_files;
     
-    IOUtil::readCSVSummary(summary_file, row_headers, col_headers, data);
+    for (unsigned int n = 0; n < summary_file_names.size(); ++n) {
+        boost::filesystem::path summary_file(summary_file_names[n]);
+        if (!boost::filesystem::is_regular_file(summary_file)) {
+            std::cout << "CSV summary file not found: " << summary_file.string() << "." << std::endl;
+            return 1;
+        }
+        
+        summary_files.push_back(summary_file);
+    }
     
-    std::string rec_key = "rec";
-    std::string rec_statistic = "mean_min";
-    std::vector<float> rec;
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
     
-    std::string ue_key = "ue_np";
-    std::string ue_statistic = "mean_max";
-    std::vector<float> ue;
+    ThreadPool::setGlobalThreads(threads);
     
-    std::string ev_key = "ev";
-    std::string ev_statistic = "mean_min";
-    std::vector<float> ev;
+    int N = summary_files.size();
+    std::vector<SummaryAverages> averages(N);
     
-    std::vector<float> superpixels;
-    for (int i = 0; i < data.rows; i++) {
-        for (int j = 0; j < data.cols; j++) {
-            if (col_headers[j + 1] == rec_statistic && row_headers[i + 1] == rec_key) {
-                rec.push_back(data.at<float>(i, j));
-            }
-            if (col_headers[j + 1] == ue_statistic && row_headers[i + 1] == ue_key) {
-                ue.push_back(1 - data.at<float>(i, j));
-            }
-            if (col_headers[j + 1] == ev_statistic && row_headers[i + 1] == ev_key) {
-                ev.push_back(data.at<float>(i, j));
-            }
-            if (col_headers[j + 1] == "mean_min" && row_headers[i + 1] == "sp") {
-                superpixels.push_back(data.at<float>(i, j));
-            }
-        }
-    }
-    
-    LOG_IF(FATAL, superpixels.size() != rec.size() || superpixels.size() != ue.size() || superpixels.size() != ev.size())
-            << "Read invalid number of values.";
+    ThreadPool::parallelFor(0, N, [&](int n) {
+        computeAverages(summary_files[n], averages[n]);
+    });
     
     std::string output_file = parameters["output-file"].as<std::string>();
     std::ofstream file_stream(output_file.c_str());
     std::setprecision(5);
     
-    file_stream << "K" << "," << "Rec" << "," << "1 - UE" << "," << "EV" << "\n";
-    std::cout << std::setw(10) << "K" << " " << std::setw(10) << "Rec" << " " 
-            << std::setw(10) << "1 - UE" << " " << std::setw(10) << "EV" << std::endl;
-    
-    for (unsigned int i = 0; i < rec.size(); i++) {
-        std::cout << std::setw(10) << superpixels[i] << " " 
-                << std::setw(10) << rec[i] << " " << std::setw(10) 
-                << ue[i] << " " << std::setw(10) << ev[i] << std::endl;
-        file_stream << superpixels[i] << "," << rec[i] 
-                << "," << ue[i] << "," << ev[i] << "\n";
+    if (N == 1) {
+        const SummaryAverages &average = averages[0];
+        
+        file_stream << "K" << "," << "Rec" << "," << "1 - UE" << "," << "EV" << "\n";
+        std::cout << std::setw(10) << "K" << " " << std::setw(10) << "Rec" << " " 
+                << std::setw(10) << "1 - UE" << " " << std::setw(10) << "EV" << std::endl;
+
+        for (unsigned int i = 0; i < average.rec.size(); i++) {
+            std::cout << std::setw(10) << average.superpixels[i] << " " 
+                    << std::setw(10) << average.rec[i] << " " << std::setw(10) 
+                    << average.ue[i] << " " << std::setw(10) << average.ev[i] << std::endl;
+            file_stream << average.superpixels[i] << "," << average.rec[i] 
+                    << "," << average.ue[i] << "," << average.ev[i] << "\n";
+        }
+
+        std::cout << "---------- ---------- ---------- ----------" << std::endl;
+        std::cout << "           " << std::setw(10) << average.avg_rec << " " 
+                << std::setw(10) << average.avg_ue << " " << std::setw(10) << average.avg_ev << std::endl;
+        file_stream << "," << average.avg_rec << "," << average.avg_ue << "," << average.avg_ev << "\n";
     }
+    else {
         
-    float avgRec = Evaluation::computeAverageMetric(rec, superpixels);
-    float avgUe = Evaluation::computeAverageMetric(ue, superpixels);
-    float avgEv = Evaluation::computeAverageMetric(ev, superpixels);
-    
-    std::cout << "---------- ---------- ---------- ----------" << std::endl;
-    std::cout << "           " << std::setw(10) << avgRec << " " 
-            << std::setw(10) << avgUe << " " << std::setw(10) << avgEv << std::endl;
-    file_stream << "," << avgRec << "," << avgUe << "," << avgEv << "\n";
+        // One row of average metrics per summary file.
+        file_stream << "file" << "," << "Rec" << "," << "1 - UE" << "," << "EV" << "\n";
+        std::cout << std::setw(10) << "Rec" << " " << std::setw(10) << "1 - UE" << " " 
+                << std::setw(10) << "EV" << " " << "file" << std::endl;
+        
+        for (int n = 0; n < N; ++n) {
+            std::cout << std::setw(10) << averages[n].avg_rec << " " 
+                    << std::setw(10) << averages[n].avg_ue << " " 
+                    << std::setw(10) << averages[n].avg_ev << " " 
+                    << summary_files[n].string() << std::endl;
+            file_stream << summary_files[n].string() << "," << averages[n].avg_rec 
+                    << "," << averages[n].avg_ue << "," << averages[n].avg_ev << "\n";
+        }
+    }
+    
     file_stream.close();
     
     return 0;
@@ -29,12 +29,14 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
  
+#include <mutex>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 #include <glog/logging.h>
 #include "superpixel_tools.h"
 #include "io_util.h"
+#include "thread_pool.h"
 
 /** \brief Convert boundaries, as generated by TP, to superpixel labels.
  * Usage:
@@ -47,6 +49,7 @@
  *                                process
  *     -r [ --overwrite ]         Overwrite original files
  *     -o [ --csv ] arg (=output) save segmentation as CSV file
+ *     --threads arg (=1)         number of files to convert in parallel
  *     -w [ --wordy ]             wordy/verbose
  * \endcode
  * \author David Stutz
@@ -60,6 +63,7 @@ int main (int argc, char ** argv) {
         ("input-images,m", boost::program_options::value<std::string>(), "folder containing the corresponding images to process")
         ("overwrite,r", "Overwrite original files")
         ("csv,o", boost::program_options::value<std::string>()->default_value("output"), "save segmentation as CSV file")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of files to convert in parallel")
         ("wordy,w", "wordy/verbose");
     
     boost::program_options::positional_options_description positionals;
@@ -104,19 +108,35 @@ int main (int argc, char ** argv) {
         wordy = true;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     std::multimap<std::string, boost::filesystem::path> boundaries;
     std::vector<std::string> extensions;
     IOUtil::getCSVExtensions(extensions);
     IOUtil::readDirectory(boundaries_dir, extensions, boundaries);
     
+    std::vector<std::string> files;
+    std::vector<boost::filesystem::path> paths;
     for(std::multimap<std::string, boost::filesystem::path>::iterator it = boundaries.begin(); 
             it != boundaries.end(); ++it) {
-        
+        files.push_back(it->first);
+        paths.push_back(it->second);
+    }
+    
+    // Files are independent; each is read, converted and written by one thread.
+    std::mutex output_mutex;
+    auto convert = [&](int n) {
         boost::filesystem::path image_file = images_dir / 
-                boost::filesystem::path(it->second.stem().string() + ".png");
+                boost::filesystem::path(paths[n].stem().string() + ".png");
         if (!boost::filesystem::is_regular_file(image_file)) {
             image_file = images_dir / 
-                    boost::filesystem::path(it->second.stem().string() + ".jpg");
+                    boost::filesystem::path(paths[n].stem().string() + ".jpg");
         }
         
         LOG_IF(FATAL, !boost::filesystem::is_regular_file(image_file)) 
@@ -126,25 +146,28 @@ int main (int argc, char ** argv) {
         
         cv::Mat boundaries;
         cv::Mat labels;
-        IOUtil::readMatCSVInt(it->second, boundaries);
+        IOUtil::readMatCSVInt(paths[n], boundaries);
         SuperpixelTools::computeLabelsFromBoundaries(image, boundaries, labels);
         int superpixels = SuperpixelTools::countSuperpixels(labels);
         
         if (wordy) {
-            std::cout << superpixels << " superpixels for " << it->first << "." << std::endl;
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::cout << superpixels << " superpixels for " << files[n] << "." << std::endl;
         }
         
         if (parameters.find("overwrite") != parameters.end()) {
             boost::filesystem::path label_file(boundaries_dir 
-                    / boost::filesystem::path(it->second.stem().string() + ".csv"));
+                    / boost::filesystem::path(paths[n].stem().string() + ".csv"));
             IOUtil::writeMatCSV<int>(label_file, labels);
         }
         else {
             boost::filesystem::path label_file(output_dir 
-                    / boost::filesystem::path(it->second.stem().string() + ".csv"));
+                    / boost::filesystem::path(paths[n].stem().string() + ".csv"));
             IOUtil::writeMatCSV<int>(label_file, labels);
         }
-    }
+    };
+    
+    ThreadPool::parallelFor(0, files.size(), convert);
     
     return 0;
 }
@@ -29,12 +29,14 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
  
+#include <mutex>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 #include <glog/logging.h>
 #include "superpixel_tools.h"
 #include "io_util.h"
+#include "thread_pool.h"
 
 /** \brief Relabel superpixels in order to be connected.
  * Usage:
@@ -47,6 +49,8 @@
  *     -m [ --input-images ] arg  dummy option!
  *     -r [ --overwrite ]         Overwrite original files
  *     -o [ --csv ] arg (=output) save segmentation as CSV file
+ *     --threads arg (=1)         number of threads to process files and 
+ *                                relabel each segmentation
  *     -w [ --wordy ]             wordy/verbose
  * \endcode
  * \author David Stutz
@@ -60,6 +64,7 @@ int main (int argc, char ** argv) {
         ("input-images,m", boost::program_options::value<std::string>()->default_value(""), "dummy option!")
         ("overwrite,r", "Overwrite original files")
         ("csv,o", boost::program_options::value<std::string>()->default_value("output"), "save segmentation as CSV file")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of threads to process files and relabel each segmentation")
         ("wordy,w", "wordy/verbose");
     
     boost::program_options::positional_options_description positionals;
@@ -92,6 +97,14 @@ int main (int argc, char ** argv) {
         return 1;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
         wordy = true;
@@ -99,36 +112,60 @@ int main (int argc, char ** argv) {
     
     std::multimap<std::string, boost::filesystem::path> labels;
     std::vector<std::string> extensions;
-    IOUtil::getCSVExtensions(extensions);
+    IOUtil::getLabelExtensions(extensions);
     IOUtil::readDirectory(labels_dir, extensions, labels);
     
+    std::vector<std::string> files;
+    std::vector<boost::filesystem::path> paths;
     for(std::multimap<std::string, boost::filesystem::path>::iterator it = labels.begin(); 
             it != labels.end(); ++it) {
-        
+        files.push_back(it->first);
+        paths.push_back(it->second);
+    }
+    
+    bool overwrite = (parameters.find("overwrite") != parameters.end());
+    
+    // With the input directory as output directory, connected segmentations
+    // are left untouched as with --overwrite.
+    bool copy = !overwrite && !boost::filesystem::equivalent(output_dir, labels_dir);
+    
+    // Files are independent; each is read, relabeled and written by one thread,
+    // the relabeling itself uses the remaining threads of the pool.
+    std::mutex output_mutex;
+    auto relabel = [&](int n) {
         cv::Mat labels;
-        IOUtil::readMatCSVInt(it->second, labels);
+        IOUtil::readMatCSVInt(paths[n], labels);
         
         int superpixels = SuperpixelTools::countSuperpixels(labels);
-        int components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+        int components = SuperpixelTools::relabelConnectedSuperpixels(labels, threads);
         
         if (wordy) {
+            std::lock_guard<std::mutex> lock(output_mutex);
             std::cout << superpixels << " superpixels / " 
-                    << components << " new components for " << it->first << "." << std::endl; 
+                    << components << " new components for " << files[n] << "." << std::endl; 
         }
         
+        // Segmentations that are already connected are not rewritten, only
+        // copied to a separate output directory.
+        boost::filesystem::path label_file(overwrite ? labels_dir : output_dir);
+        label_file /= paths[n].filename();
+        
         if (components > 0) {
-            if (parameters.find("overwrite") != parameters.end()) {
-                boost::filesystem::path label_file(labels_dir 
-                        / boost::filesystem::path(it->second.stem().string() + ".csv"));
-                IOUtil::writeMatCSV<int>(label_file, labels);
+            IOUtil::writeLabels(label_file, labels);
+        }
+        else if (copy) {
+            // Exceptions must not leave the pool's tasks.
+            try {
+                boost::filesystem::copy_file(paths[n], label_file, 
+                        boost::filesystem::copy_option::overwrite_if_exists);
             }
-            else {
-                boost::filesystem::path label_file(output_dir 
-                        / boost::filesystem::path(it->second.stem().string() + ".csv"));
-                IOUtil::writeMatCSV<int>(label_file, labels);
+            catch (const boost::filesystem::filesystem_error &e) {
+                LOG(ERROR) << "Could not copy " << paths[n].string() << ": " << e.what();
             }
         }
-    }
+    };
+    
+    ThreadPool::parallelFor(0, files.size(), relabel);
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+ 
+ 
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <glog/logging.h>
+
+#include "evaluation_summary.h"
+#include "parameter_optimization_tool.h"
+#include "thread_pool.h"
+
+/** \brief Merge the results of sharded evaluations, i.e. the checkpoint files
+ * of eval_summary_cli or the parameter optimization files of
+ * eval_parameter_optimization_cli run with --shard.
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/eval_merge_cli --help
+ *   Allowed options:
+ *     --checkpoints arg             checkpoint files of all shards
+ *     --parameter-optimization arg  parameter_optimization-<i>.csv files of all 
+ *                                   shards, ordered by shard
+ *     --output-directory arg        directory to write the merged results to
+ *     --append-file arg             append file
+ *     --min-rec arg (=0)            minimum Boundary Recall for the fastest 
+ *                                   parameters (fast_best)
+ *     --max-ue arg (=1)             maximum Undersegmentation Error for the 
+ *                                   fastest parameters (fast_best)
+ *     --threads arg (=1)            number of threads to summarize the merged
+ *                                   checkpoints
+ *     --help                        produce help message
+ * \endcode
+ * \author David Stutz
+ */
+int main(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("checkpoints", boost::program_options::value< std::vector<std::string> >()->multitoken(), "checkpoint files of all shards")
+        ("parameter-optimization", boost::program_options::value< std::vector<std::string> >()->multitoken(), "parameter_optimization-<i>.csv files of all shards, ordered by shard")
+        ("output-directory", boost::program_options::value<std::string>(), "directory to write the merged results to")
+        ("append-file", boost::program_options::value<std::string>()->default_value(""), "append file")
+        ("min-rec", boost::program_options::value<float>()->default_value(0), "minimum Boundary Recall for the fastest parameters (fast_best)")
+        ("max-ue", boost::program_options::value<float>()->default_value(1), "maximum Undersegmentation Error for the fastest parameters (fast_best)")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of threads to summarize the merged checkpoints")
+        ("help", "produce help message");
+
+    boost::program_options::positional_options_description positionals;
+    positionals.add("checkpoints", -1);
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
+    if (parameters.find("output-directory") == parameters.end()) {
+        std::cout << "No output directory given." << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path output_directory(parameters["output-directory"].as<std::string>());
+    if (!boost::filesystem::is_directory(output_directory)) {
+        boost::filesystem::create_directories(output_directory);
+    }
+    
+    if (parameters.find("checkpoints") == parameters.end()
+            && parameters.find("parameter-optimization") == parameters.end()) {
+        std::cout << "No checkpoint or parameter optimization files given." << std::endl;
+        return 1;
+    }
+    
+    if (parameters.find("checkpoints") != parameters.end()) {
+        
+        // All images are taken from the checkpoints, so the output directory
+        // should not contain superpixel segmentations itself.
+        EvaluationSummary::EvaluationMetrics metrics;
+        EvaluationSummary::EvaluationStatistics statistics;
+        EvaluationSummary::SuperpixelVisualizations visualizations;
+        EvaluationSummary summary(output_directory, output_directory, output_directory,
+                metrics, statistics, visualizations);
+        summary.setComputeCorrelation(true);
+        summary.setThreads(threads);
+        
+        boost::filesystem::path append_file(parameters["append-file"].as<std::string>());
+        if (!append_file.empty()) {
+            summary.setAppendFile(append_file);
+        }
+        
+        std::vector<std::string> checkpoints = parameters["checkpoints"].as< std::vector<std::string> >();
+        for (unsigned int i = 0; i < checkpoints.size(); ++i) {
+            if (!boost::filesystem::is_regular_file(checkpoints[i])) {
+                std::cout << "Checkpoint file not found: " << checkpoints[i] << "." << std::endl;
+                return 1;
+            }
+            
+            int count = summary.addCheckpointFile(checkpoints[i]);
+            std::cout << "Read " << count << " results from " << checkpoints[i] << "." << std::endl;
+        }
+        
+        int gt_max = 0;
+        summary.computeSummary(gt_max);
+    }
+    
+    if (parameters.find("parameter-optimization") != parameters.end()) {
+        
+        std::vector<std::string> files = parameters["parameter-optimization"].as< std::vector<std::string> >();
+        std::vector<boost::filesystem::path> shard_files;
+        for (unsigned int i = 0; i < files.size(); ++i) {
+            if (!boost::filesystem::is_regular_file(files[i])) {
+                std::cout << "Parameter optimization file not found: " << files[i] << "." << std::endl;
+                return 1;
+            }
+            
+            shard_files.push_back(boost::filesystem::path(files[i]));
+        }
+        
+        ParameterOptimizationTool::mergeShards(shard_files, 
+                output_directory / boost::filesystem::path("parameter_optimization.csv"),
+                parameters["min-rec"].as<float>(), parameters["max-ue"].as<float>());
+    }
+    
+    return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+ 
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <glog/logging.h>
+#include "dataset_pack.h"
+
+/** \brief Pack images and ground truths into a single memory-mapped file,
+ * see DatasetPack; superpixel_bench accepts the pack instead of the image 
+ * and ground truth directories.
+ * 
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/eval_pack_cli --help
+ *   Allowed options:
+ *     --img-directory arg   image directory
+ *     --gt-directory arg    ground truth directory, images only if not given
+ *     -o [ --output ] arg   pack file to write (.spds)
+ *     -w [ --wordy ]        wordy/verbose
+ *     --help                produce help message
+ * \endcode
+ * \author David Stutz
+ */
+int main(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("img-directory", boost::program_options::value<std::string>(), "image directory")
+        ("gt-directory", boost::program_options::value<std::string>()->default_value(""), "ground truth directory, images only if not given")
+        ("output,o", boost::program_options::value<std::string>(), "pack file to write (.spds)")
+        ("wordy,w", "wordy/verbose")
+        ("help", "produce help message");
+
+    boost::program_options::positional_options_description positionals;
+    positionals.add("img-directory", 1);
+    positionals.add("gt-directory", 1);
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()
+            || parameters.find("img-directory") == parameters.end()
+            || parameters.find("output") == parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path img_directory(parameters["img-directory"].as<std::string>());
+    if (!boost::filesystem::is_directory(img_directory)) {
+        std::cout << "Image directory does not exist." << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path gt_directory(parameters["gt-directory"].as<std::string>());
+    if (!gt_directory.empty() && !boost::filesystem::is_directory(gt_directory)) {
+        std::cout << "Ground truth directory does not exist." << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path output_file(parameters["output"].as<std::string>());
+    if (!DatasetPack::isPackFile(output_file)) {
+        std::cout << "Pack file needs the .spds extension." << std::endl;
+        return 1;
+    }
+    
+    int samples = DatasetPack::pack(img_directory, gt_directory, output_file);
+    if (samples < 0) {
+        std::cout << "Could not write " << output_file << "." << std::endl;
+        return 1;
+    }
+    
+    if (parameters.find("wordy") != parameters.end()) {
+        std::cout << "Packed " << samples << " images into " << output_file 
+                << " (" << boost::filesystem::file_size(output_file) << " bytes)." << std::endl;
+    }
+    
+    return 0;
+}
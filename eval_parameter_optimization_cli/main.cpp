@@ -29,6 +29,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
  
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/timer.hpp>
@@ -36,13 +37,45 @@
 #include <glog/logging.h>
 
 #include "io_util.h"
+#include "superpixel_tools.h"
 #include "parameter_optimization_tool.h"
+#include "result_cache.h"
+
+#ifdef PARAMETER_OPTIMIZATION_SLIC
+#include "slic_opencv.h"
+#endif
 
 // Dirty but simple ...
 std::string FAIR = "-f ";
 std::string RELATIVE_PATH = ".";
 std::string MATLAB_EXECUTABLE = "/home/david/MATLAB/R2014b/bin/matlab";
 std::string JAVA_EXECUTABLE = "/home/david/jdk-1.8.0_45/release/java";
+int THREADS = 1;
+bool IN_PROCESS = false;
+int SEARCH_STRATEGY = ParameterOptimizationTool::GRID_SEARCH;
+int SEARCH_BUDGET = 0;
+unsigned int SEED = 0;
+int SHARD = 0;
+int SHARDS = 1;
+float SCREENING_SCALE = 1;
+int EARLY_REJECT = 0;
+float MIN_REC = 0;
+float MAX_UE = 1;
+ResultCache* RESULT_CACHE = NULL;
+
+/** \brief Apply the options shared by all connectors.
+ * 
+ * \param[in,out] tool parameter optimization tool to configure
+ */
+void configureTool(ParameterOptimizationTool &tool) {
+    tool.setThreads(THREADS);
+    tool.setSearchStrategy(SEARCH_STRATEGY, SEARCH_BUDGET, SEED);
+    tool.setScreeningScale(SCREENING_SCALE);
+    tool.setEarlyReject(EARLY_REJECT);
+    tool.setShard(SHARD, SHARDS);
+    tool.setQualityThresholds(MIN_REC, MAX_UE);
+    tool.setResultCache(RESULT_CACHE);
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // CCS
@@ -63,6 +96,7 @@ void connector_CCS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory, 
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/ccs_cli", "");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("compactness", "--compactness", std::vector<int>{25, 50, 100, 250, 500}); // 5
@@ -92,6 +126,7 @@ void connector_CIS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory, 
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/cis_cli", "");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("lambda", "--lambda", std::vector<int>{1, 3, 5, 7, 10}); // 5
@@ -122,6 +157,7 @@ void connector_CRS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/crs_cli", FAIR);
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("compactness", "--compactness", std::vector<float>{0.001f, 0.005f, 0.01f, 0.05f, 0.1f}); // 5
@@ -152,6 +188,7 @@ void connector_CW(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/cw_cli", FAIR);
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("compactness", "--compactness", std::vector<float>{0.01f, 0.05f, 0.1f, 0.5f, 1.0f, 5.0f, 10.0f}); // 7
@@ -182,6 +219,7 @@ void connector_DASP(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/dasp_cli", "");
+        configureTool(tool);
         tool.useDepth(depth_directory);
 
         if (!intrinsics_directory.empty()) {
@@ -219,10 +257,12 @@ void connector_EAMS(boost::filesystem::path img_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/eams_cli/eams_dispatcher.sh", 
                 "-e " + MATLAB_EXECUTABLE + " -a " + RELATIVE_PATH + "/eams_cli > /dev/null");
+        configureTool(tool);
         tool.addSuperpixelTolerance(superpixels[k], superpixel_tolerances[k]);
 
         tool.addIntegerParameter("bandwidth", "-b", std::vector<int>{1, 3, 5, 9, 13}); // 5
         tool.addIntegerParameter("minimum-size", "-m", std::vector<int>{10, 25, 50, 250}); // 4
+        tool.scaleWithResolution("minimum-size", 2);
         tool.addIntegerParameter("color-space", "-r", std::vector<int>{0, 1}); // 2
 
         tool.optimize();
@@ -248,6 +288,7 @@ void connector_ERGC(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/ergc_cli", FAIR);
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("perturb-seeds", "--perturb-seeds", std::vector<int>{0, 1}); // 2
@@ -277,6 +318,7 @@ void connector_ERS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/ers_cli", "");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("lambda", "--lambda", std::vector<float>{0.1f, 0.5f, 1.0f, 2.5f, 5.0f, 10.0f}); // 6
@@ -305,6 +347,7 @@ void connector_ETPS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/etps_cli", "");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{400});
         tool.addFloatParameter("regularization-weight", "--regularization-weight", std::vector<float>{0.01f, 0.05f, 0.1f, 0.5f, 1.f, 5.f, 10.f}); // 7
@@ -332,9 +375,11 @@ void connector_FH(boost::filesystem::path img_directory,
     
     ParameterOptimizationTool tool(img_directory, gt_directory, base_directory,
             RELATIVE_PATH + "/bin/fh_cli", "");
+    configureTool(tool);
 
     tool.addFloatParameter("sigma", "--sigma", std::vector<float>{0.0f, 1.0f, 2.0f}); // 3
     tool.addIntegerParameter("minimum-size", "--minimum-size", std::vector<int>{10, 15, 30, 60, 90, 120, 180}); // 7
+    tool.scaleWithResolution("minimum-size", 2);
     tool.addFloatParameter("threshold", "--threshold", std::vector<float>{5, 10, 15, 30, 60, 90}); // 6
 
     tool.optimize();
@@ -359,9 +404,11 @@ void connector_MSS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory, 
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/mss_cli", "");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("structure-size", "--structure-size", std::vector<int>{3,7,11,15}); // 4
+        tool.scaleWithResolution("structure-size");
         tool.addFloatParameter("noise", "--noise", std::vector<float>{1.0f, 2.5f, 5.0f, 10.0f, 25.0f, 50.0f}); // 6
         tool.addFloatParameter("tolerance", "--tolerance", std::vector<float>{1.0f, 5.0f, 10.0f, 25.0f}); // 4
         tool.addIntegerParameter("iterations", "--iterations", std::vector<int>{1});
@@ -389,6 +436,7 @@ void connector_PB(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/pb_cli", "");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("sigma", "--sigma", std::vector<float>{1.0f, 2.5f, 5.0f, 7.5f, 10.0f, 20.0f}); // 6
@@ -418,6 +466,7 @@ void connector_POISE(boost::filesystem::path img_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/poise_cli/poise_dispatcher.sh", 
                 "-e " + MATLAB_EXECUTABLE + " -a " + RELATIVE_PATH + "/poise_cli/ > /dev/null");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "-s", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("sigma", "-g", std::vector<float>{0.1f, 0.5f, 2.5f, 5.f}); // 4
@@ -448,6 +497,7 @@ void connector_preSLIC(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/preslic_cli", "");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("compactness", "--compactness", std::vector<float>{1.0f, 5.0f, 10.0f, 20.0f, 40.0f, 80.0f, 160.0f}); // 9
@@ -480,6 +530,7 @@ void connector_reSEEDS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
             RELATIVE_PATH + "/bin/reseeds_cli", FAIR);
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("bins", "--bins", std::vector<int>{1, 3, 5, 7}); // 4
@@ -513,6 +564,7 @@ void connector_SEAW(boost::filesystem::path img_directory,
                     base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/seaw_cli/seaw_dispatcher.sh", 
                 "-e " + MATLAB_EXECUTABLE + " -a " + RELATIVE_PATH + "/seaw_cli/ > /dev/null");
+        configureTool(tool);
 
         if (superpixels[k] < 800) {
             tool.addIntegerParameter("level", "-l", std::vector<int>{5}); // 2
@@ -550,6 +602,7 @@ void connector_SEEDS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/seeds_cli", FAIR);
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("bins", "--bins", std::vector<int>{1, 3, 5, 7, 9}); // 5
@@ -582,6 +635,7 @@ void connector_SLIC(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/slic_cli", "");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("compactness", "--compactness", std::vector<float>{1.0f, 5.0f, 10.0f, 20.0f, 40.0f, 80.0f, 160.0f}); // 9
@@ -589,6 +643,21 @@ void connector_SLIC(boost::filesystem::path img_directory,
         tool.addIntegerParameter("perturb-seeds", "--perturb-seeds", std::vector<int>{0, 1}); // 2
         tool.addIntegerParameter("color-space", "--color-space", std::vector<int>{0, 1}); // 2
 
+#ifdef PARAMETER_OPTIMIZATION_SLIC
+        // Same as slic_cli, with parameters in the order added above.
+        if (IN_PROCESS) {
+            tool.setSegmentationFunction([](const cv::Mat &image, 
+                    const std::vector<float> &values, cv::Mat &labels) {
+                int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                        values[0]);
+                
+                SLIC_OpenCV::computeSuperpixels(image, region_size, values[1], 
+                        values[2], values[3] > 0, values[4], labels);
+                SuperpixelTools::relabelConnectedSuperpixels(labels);
+            });
+        }
+#endif
+        
         tool.optimize();
     }
 }
@@ -613,6 +682,7 @@ void connector_TP(boost::filesystem::path img_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/tp_cli/tp_dispatcher.sh", 
                 "-e " + MATLAB_EXECUTABLE + " -a " + RELATIVE_PATH + "/tp_cli/ > /dev/null");
+        configureTool(tool);
         tool.addPostProcessingCommandLine(RELATIVE_PATH + "/bin/boundaries_to_labels_cli --overwrite");
 
         tool.addIntegerParameter("superpixels", "-s", std::vector<int>{superpixels[k]});
@@ -644,6 +714,7 @@ void connector_TPS(boost::filesystem::path img_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/tps_cli/tps_dispatcher.sh", 
                 FAIR + "-e " + MATLAB_EXECUTABLE + " -a " + RELATIVE_PATH + "/tps_cli/ > /dev/null");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "-s", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("type", "-t", std::vector<int>{0, 1, 2}); // 3
@@ -673,9 +744,11 @@ void connector_vlSLIC(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/vlslic_cli", "");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("minimum-region-size", "--minimum-region-size", std::vector<int>{20});
+        tool.scaleWithResolution("minimum-region-size", 2);
         tool.addFloatParameter("compactness", "--compactness", std::vector<float>{1.0f, 5.0f, 10.0f, 20.0f, 40.0f, 80.0f, 160.0f}); // 9
         tool.addIntegerParameter("iterations", "--iterations", std::vector<int>{1, 5, 10, 25, 50}); // 5
 
@@ -702,6 +775,7 @@ void connector_W(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/w_cli", "");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
 
@@ -728,6 +802,7 @@ void connector_WP(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/wp_cli/wp_dispatcher.sh", "> /dev/null");
+        configureTool(tool);
         tool.addPostProcessingCommandLine(RELATIVE_PATH + "/bin/connected_relabel_cli --overwrite");
 
         tool.addIntegerParameter("superpixels", "-s", std::vector<int>{superpixels[k]});
@@ -757,6 +832,7 @@ void connector_PF(boost::filesystem::path img_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/pf_cli/pf_dispatcher.sh", 
                 "-e " + JAVA_EXECUTABLE + " -j " + RELATIVE_PATH + "/lib_pf/PathFinder.jar");
+        configureTool(tool);
         tool.addPostProcessingCommandLine(RELATIVE_PATH + "/bin/connected_relabel_cli --overwrite");
 
         tool.addIntegerParameter("superpixels", "-s", std::vector<int>{superpixels[k]});
@@ -787,6 +863,7 @@ void connector_LSC(boost::filesystem::path img_directory,
                 RELATIVE_PATH + "/bin/lsc_cli", FAIR);      
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
+        configureTool(tool);
         tool.addFloatParameter("ratio", "--ratio", std::vector<float>{0.0f, 0.01f, 0.05f, 0.1f, 0.25f, 0.5f}); // 6
         tool.addIntegerParameter("iterations", "--iterations", std::vector<int>{1, 5, 10 ,25, 50}); // 5
         tool.addIntegerParameter("threshold", "--threshold", std::vector<int>{10}); // 1
@@ -816,6 +893,7 @@ void connector_RW(boost::filesystem::path img_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/rw_cli/rw_dispatcher.sh", 
                 FAIR + "-e " + MATLAB_EXECUTABLE + " -a " + RELATIVE_PATH + "/rw_cli > /dev/null");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "-s", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("beta", "-b", std::vector<float>{1, 5, 25, 50, 100, 250}); // 6
@@ -845,6 +923,7 @@ void connector_QS(boost::filesystem::path img_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/qs_cli/qs_dispatcher.sh",
                 "-e " + MATLAB_EXECUTABLE + " -a " + RELATIVE_PATH + "/qs_cli > /dev/null");
+        configureTool(tool);
         tool.addSuperpixelTolerance(superpixels[k], superpixel_tolerances[k]);
 
         tool.addFloatParameter("ratio", "-c", std::vector<float>{0.0f, 0.5f, 1.0f}); // 3
@@ -876,6 +955,7 @@ void connector_NC(boost::filesystem::path img_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/nc_cli/nc_dispatcher.sh",
                 "-e " + MATLAB_EXECUTABLE + " -a " + RELATIVE_PATH + "/nc_cli > /dev/null");
+        configureTool(tool);
 
         tool.addIntegerParameter("superpixels", "-s", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("coarse-superpixels", "-c", std::vector<int>{0, superpixels[k]/4, superpixels[k]/2}); // 3
@@ -907,6 +987,7 @@ void connector_VCCS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/vccs_cli", "");
+        configureTool(tool);
         tool.useDepth(depth_directory);
 
         if (!intrinsics_directory.empty()) {
@@ -954,6 +1035,7 @@ void connector_VC(boost::filesystem::path img_directory,
                 RELATIVE_PATH + "/bin/vc_cli", "");      
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
+        configureTool(tool);
         tool.addFloatParameter("weight", "--weight", std::vector<float>{10, 25, 50, 100, 250}); // 5
         tool.addIntegerParameter("radius", "--radius", std::vector<int>{3, 15}); // 2
         tool.addIntegerParameter("threshold", "--threshold", std::vector<int>{10});
@@ -980,6 +1062,25 @@ void connector_VC(boost::filesystem::path img_directory,
  *     --java-executable arg (=../../jdk-1.8.0_45/release/java)
  *                                           java executable
  *     --not-fair                            do not use fair parameters
+ *     --threads arg (=1)                    number of parameter combinations to 
+ *                                           evaluate in parallel
+ *     --in-process                          run supported C++ algorithms (SLIC) 
+ *                                           in-process
+ *     --search arg (=grid)                  search strategy: grid, random, 
+ *                                           coordinate, halving, tpe, hyperband
+ *     --budget arg (=0)                     number of evaluations for search 
+ *                                           strategies other than grid
+ *     --seed arg (=0)                       random seed
+ *     --screening-scale arg (=1)            scale of the images used on subsets
+ *                                           by halving and hyperband
+ *     --early-reject arg (=0)               number of images to check the 
+ *                                           superpixel tolerance on first
+ *     --shard arg (=0/1)                    shard i/N of the grid to evaluate, 
+ *                                           merged using eval_merge_cli
+ *     --min-rec arg (=0)                    minimum Boundary Recall for the 
+ *                                           fastest parameters (fast_best)
+ *     --max-ue arg (=1)                     maximum Undersegmentation Error for 
+ *                                           the fastest parameters (fast_best)
  *     --help                                produce help message
  * \endcode
  * \author David Stutz
@@ -997,6 +1098,18 @@ int main(int argc, const char** argv) {
         ("matlab-executable", boost::program_options::value<std::string>()->default_value("../../MATLAB/R2014b/release/matlab"), "matlab executable path")
         ("java-executable", boost::program_options::value<std::string>()->default_value("../../jdk-1.8.0_45/release/java"), "java executable")
         ("not-fair", "do not use fair parameters")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of parameter combinations to evaluate in parallel")
+        ("in-process", "run supported C++ algorithms (SLIC) in-process")
+        ("search", boost::program_options::value<std::string>()->default_value("grid"), "search strategy: grid, random, coordinate, halving, tpe, hyperband")
+        ("budget", boost::program_options::value<int>()->default_value(0), "number of evaluations for search strategies other than grid")
+        ("seed", boost::program_options::value<unsigned int>()->default_value(0), "random seed")
+        ("screening-scale", boost::program_options::value<float>()->default_value(1), "scale of the images used on subsets by halving and hyperband")
+        ("early-reject", boost::program_options::value<int>()->default_value(0), "number of images to check the superpixel tolerance on first")
+        ("shard", boost::program_options::value<std::string>()->default_value("0/1"), "shard i/N of the grid to evaluate, merged using eval_merge_cli")
+        ("min-rec", boost::program_options::value<float>()->default_value(0), "minimum Boundary Recall for the fastest parameters (fast_best)")
+        ("max-ue", boost::program_options::value<float>()->default_value(1), "maximum Undersegmentation Error for the fastest parameters (fast_best)")
+        ("cache-directory", boost::program_options::value<std::string>()->default_value(""), "directory to cache per-image results in across runs")
+        ("cache-version", boost::program_options::value<std::string>()->default_value(""), "version string to invalidate cached results")
         ("help", "produce help message");
 
     boost::program_options::positional_options_description positionals;
@@ -1053,6 +1166,85 @@ int main(int argc, const char** argv) {
     if (parameters.find("not-fair") != parameters.end()) {
         FAIR = "";
     }
+    
+    THREADS = parameters["threads"].as<int>();
+    if (THREADS <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    if (parameters.find("in-process") != parameters.end()) {
+        IN_PROCESS = true;
+    }
+    
+    std::string search = parameters["search"].as<std::string>();
+    if (search == "grid") {
+        SEARCH_STRATEGY = ParameterOptimizationTool::GRID_SEARCH;
+    }
+    else if (search == "random") {
+        SEARCH_STRATEGY = ParameterOptimizationTool::RANDOM_SEARCH;
+    }
+    else if (search == "coordinate") {
+        SEARCH_STRATEGY = ParameterOptimizationTool::COORDINATE_DESCENT;
+    }
+    else if (search == "halving") {
+        SEARCH_STRATEGY = ParameterOptimizationTool::SUCCESSIVE_HALVING;
+    }
+    else if (search == "tpe") {
+        SEARCH_STRATEGY = ParameterOptimizationTool::TPE_SEARCH;
+    }
+    else if (search == "hyperband") {
+        SEARCH_STRATEGY = ParameterOptimizationTool::HYPERBAND;
+    }
+    else {
+        std::cout << "Invalid search strategy." << std::endl;
+        return 1;
+    }
+    
+    SEARCH_BUDGET = parameters["budget"].as<int>();
+    if (SEARCH_BUDGET < 0) {
+        std::cout << "Search budget needs to be non-negative." << std::endl;
+        return 1;
+    }
+    
+    SEED = parameters["seed"].as<unsigned int>();
+    
+    SCREENING_SCALE = parameters["screening-scale"].as<float>();
+    if (SCREENING_SCALE <= 0 || SCREENING_SCALE > 1) {
+        std::cout << "Screening scale needs to be in (0,1]." << std::endl;
+        return 1;
+    }
+    
+    EARLY_REJECT = parameters["early-reject"].as<int>();
+    if (EARLY_REJECT < 0) {
+        std::cout << "Number of images for early rejection needs to be non-negative." << std::endl;
+        return 1;
+    }
+    
+    if (!IOUtil::parseShard(parameters["shard"].as<std::string>(), SHARD, SHARDS)) {
+        std::cout << "Shard needs to be given as i/N with 0 <= i < N." << std::endl;
+        return 1;
+    }
+    
+    if (SHARDS > 1 && SEARCH_STRATEGY != ParameterOptimizationTool::GRID_SEARCH) {
+        std::cout << "Sharding is only supported for grid search." << std::endl;
+        return 1;
+    }
+    
+    MIN_REC = parameters["min-rec"].as<float>();
+    MAX_UE = parameters["max-ue"].as<float>();
+    if (MIN_REC < 0 || MIN_REC > 1 || MAX_UE < 0 || MAX_UE > 1) {
+        std::cout << "Quality thresholds need to be in [0,1]." << std::endl;
+        return 1;
+    }
+    
+    std::unique_ptr<ResultCache> result_cache;
+    boost::filesystem::path cache_directory(parameters["cache-directory"].as<std::string>());
+    if (!cache_directory.empty()) {
+        result_cache.reset(new ResultCache(cache_directory, 
+                parameters["cache-version"].as<std::string>()));
+        RESULT_CACHE = result_cache.get();
+    }
         
     std::string algorithm = parameters["algorithm"].as<std::string>();
     std::transform(algorithm.begin(), algorithm.end(), algorithm.begin(), 
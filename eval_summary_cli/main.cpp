@@ -29,6 +29,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
  
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/timer.hpp>
@@ -36,6 +37,9 @@
 #include <glog/logging.h>
 
 #include "io_util.h"
+#include "thread_pool.h"
+#include "ground_truth_cache.h"
+#include "gpu_evaluation.h"
 #include "parameter_optimization_tool.h"
 
 /** \brief Compute an evaluation summary.
@@ -44,9 +48,32 @@
  *   $ ../bin/eval_summary_cli --help
  *   Allowed options:
  *     --sp-directory arg    superpixel segmentation directory
+ *     --sp-directories arg  further superpixel segmentation directories on the 
+ *                           same images; images and ground truths are read 
+ *                           once for all directories
  *     --img-directory arg   image directory
  *     --gt-directory arg    ground truth directory
  *     --append-file arg     append file
+ *     --memory-file arg     memory.csv written by the algorithm with --memory; 
+ *                           adds peak memory per image to results and summary
+ *     --gt-cache arg        directory to cache parsed ground truths and their 
+ *                           boundary maps in; filled on first use
+ *     --threads arg (=1)    number of threads to evaluate images in parallel
+ *     --numa                spread the threads over the NUMA nodes, each 
+ *                           working on memory of its node where possible
+ *     --online              summarize in one pass with bounded memory 
+ *                           (approximate median and quartiles)
+ *     --gpu                 compute color moments and intersections on the GPU,
+ *                           batching all directories per image (requires 
+ *                           lib_eval built with EVAL_OPENCL)
+ *     --timings             write the total time per metric, reading, 
+ *                           visualization and writing to timing.csv
+ *     --checkpoint-file arg checkpoint file to append the results of each image 
+ *                           to; images found in it are not evaluated again
+ *     --checkpoints arg     checkpoint files of other shards to include
+ *     --shard arg (=0/1)    shard i/N to evaluate, i.e. every N-th segmentation 
+ *                           starting with the i-th; with multiple shards only 
+ *                           the checkpoint file is written
  *     --vis                 visualize results
  *     --help                produce help message
  * \endcode
@@ -57,9 +84,20 @@ int main(int argc, const char** argv) {
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
         ("sp-directory", boost::program_options::value<std::string>(), "superpixel segmentation directory")
+        ("sp-directories", boost::program_options::value< std::vector<std::string> >()->multitoken(), "further superpixel segmentation directories on the same images; images and ground truths are read once for all directories")
         ("img-directory", boost::program_options::value<std::string>(), "image directory")
         ("gt-directory", boost::program_options::value<std::string>(), "ground truth directory")
         ("append-file", boost::program_options::value<std::string>()->default_value(""), "append file")
+        ("memory-file", boost::program_options::value<std::string>()->default_value(""), "memory.csv written by the algorithm with --memory; adds peak memory per image to results and summary")
+        ("gt-cache", boost::program_options::value<std::string>()->default_value(""), "directory to cache parsed ground truths and their boundary maps in; filled on first use")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of threads to evaluate images in parallel")
+        ("numa", "spread the threads over the NUMA nodes, each working on memory of its node where possible")
+        ("online", "summarize in one pass with bounded memory (approximate median and quartiles)")
+        ("gpu", "compute color moments and intersections on the GPU, batching all directories per image (requires lib_eval built with EVAL_OPENCL)")
+        ("timings", "write the total time per metric, reading, visualization and writing to timing.csv")
+        ("checkpoint-file", boost::program_options::value<std::string>()->default_value(""), "checkpoint file to append the results of each image to; images found in it are not evaluated again")
+        ("checkpoints", boost::program_options::value< std::vector<std::string> >()->multitoken(), "checkpoint files of other shards to include")
+        ("shard", boost::program_options::value<std::string>()->default_value("0/1"), "shard i/N to evaluate, i.e. every N-th segmentation starting with the i-th; with multiple shards only the checkpoint file is written")
         ("vis", "visualize results")
         ("help", "produce help message");
 
@@ -77,12 +115,29 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
-    boost::filesystem::path sp_directory(parameters["sp-directory"].as<std::string>());
-    if (!boost::filesystem::is_directory(sp_directory)) {
-        std::cout << "Superpixel segmentation directory does not exist." << std::endl;
+    std::vector<boost::filesystem::path> sp_directories;
+    if (parameters.find("sp-directory") != parameters.end()) {
+        sp_directories.push_back(boost::filesystem::path(parameters["sp-directory"].as<std::string>()));
+    }
+    
+    if (parameters.find("sp-directories") != parameters.end()) {
+        std::vector<std::string> directories = parameters["sp-directories"].as< std::vector<std::string> >();
+        sp_directories.insert(sp_directories.end(), directories.begin(), directories.end());
+    }
+    
+    if (sp_directories.empty()) {
+        std::cout << "No superpixel segmentation directory given." << std::endl;
         return 1;
     }
     
+    for (unsigned int d = 0; d < sp_directories.size(); ++d) {
+        if (!boost::filesystem::is_directory(sp_directories[d])) {
+            std::cout << "Superpixel segmentation directory does not exist: " 
+                    << sp_directories[d] << "." << std::endl;
+            return 1;
+        }
+    }
+    
     boost::filesystem::path img_directory(parameters["img-directory"].as<std::string>());
     if (!boost::filesystem::is_directory(img_directory)) {
         std::cout << "Image directory does not exist." << std::endl;
@@ -107,17 +162,107 @@ int main(int argc, const char** argv) {
         visualizations.perturbed_mean = true;
     }
     
-    EvaluationSummary summary(sp_directory, gt_directory, img_directory,
-            metrics, statistics, visualizations);
-    summary.setComputeCorrelation(true);
+    // Memory files, checkpoints and shards refer to a single directory.
+    bool multiple = (sp_directories.size() > 1);
+    if (multiple && (!parameters["memory-file"].as<std::string>().empty() 
+            || !parameters["checkpoint-file"].as<std::string>().empty()
+            || parameters.find("checkpoints") != parameters.end()
+            || parameters["shard"].as<std::string>() != "0/1")) {
+        std::cout << "Memory file, checkpoints and shards are not supported with multiple superpixel directories." << std::endl;
+        return 1;
+    }
+    
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads, parameters.find("numa") != parameters.end());
+    
+    // The cache is shared by all evaluated algorithms on the same dataset.
+    boost::filesystem::path gt_cache_directory(parameters["gt-cache"].as<std::string>());
+    std::unique_ptr<GroundTruthCache> ground_truth_cache;
+    if (!gt_cache_directory.empty()) {
+        ground_truth_cache.reset(new GroundTruthCache(gt_cache_directory));
+    }
+    
+    bool gpu = parameters.find("gpu") != parameters.end();
+    if (gpu && !GPUEvaluation::available()) {
+        std::cout << "No GPU available, build lib_eval with EVAL_OPENCL." << std::endl;
+        return 1;
+    }
     
     boost::filesystem::path append_file(parameters["append-file"].as<std::string>());
-    if (!append_file.empty()) {
-        summary.setAppendFile(append_file);
+    
+    std::vector< std::unique_ptr<EvaluationSummary> > summaries(sp_directories.size());
+    for (unsigned int d = 0; d < sp_directories.size(); ++d) {
+        summaries[d].reset(new EvaluationSummary(sp_directories[d], gt_directory, 
+                img_directory, metrics, statistics, visualizations));
+        summaries[d]->setComputeCorrelation(true);
+        summaries[d]->setThreads(threads);
+        summaries[d]->setGPUEvaluation(gpu);
+        summaries[d]->setTimings(parameters.find("timings") != parameters.end());
+        
+        if (!append_file.empty()) {
+            summaries[d]->setAppendFile(append_file);
+        }
+        
+        if (ground_truth_cache) {
+            summaries[d]->setGroundTruthCache(ground_truth_cache.get());
+        }
+        
+        if (parameters.find("online") != parameters.end()) {
+            summaries[d]->setOnlineStatistics(true);
+        }
     }
     
     int gt_max = 0;
+    if (multiple) {
+        std::vector<EvaluationSummary*> pointers(summaries.size());
+        for (unsigned int d = 0; d < summaries.size(); ++d) {
+            pointers[d] = summaries[d].get();
+        }
+        
+        EvaluationSummary::computeSummaries(pointers, gt_max);
+        return 0;
+    }
+    
+    EvaluationSummary &summary = *summaries[0];
+    
+    boost::filesystem::path memory_file(parameters["memory-file"].as<std::string>());
+    if (!memory_file.empty() && !summary.setMemoryFile(memory_file)) {
+        std::cout << "Could not read memory file." << std::endl;
+        return 1;
+    }
+    
+    int shard = 0;
+    int shards = 1;
+    if (!IOUtil::parseShard(parameters["shard"].as<std::string>(), shard, shards)) {
+        std::cout << "Shard needs to be given as i/N with 0 <= i < N." << std::endl;
+        return 1;
+    }
+    
+    summary.setShard(shard, shards);
+    
+    boost::filesystem::path checkpoint_file(parameters["checkpoint-file"].as<std::string>());
+    if (!checkpoint_file.empty()) {
+        summary.setCheckpointFile(checkpoint_file);
+    }
+    
+    if (parameters.find("checkpoints") != parameters.end()) {
+        std::vector<std::string> checkpoints = parameters["checkpoints"].as< std::vector<std::string> >();
+        for (unsigned int i = 0; i < checkpoints.size(); ++i) {
+            if (!boost::filesystem::is_regular_file(checkpoints[i])) {
+                std::cout << "Checkpoint file not found: " << checkpoints[i] << "." << std::endl;
+                return 1;
+            }
+            
+            summary.addCheckpointFile(checkpoints[i]);
+        }
+    }
+    
     summary.computeSummary(gt_max);
     
     return 0;
-}
\ No newline at end of file
+}
@@ -36,6 +36,7 @@
 #include <glog/logging.h>
 #include "visualization.h"
 #include "io_util.h"
+#include "thread_pool.h"
 
 /** \brief Visualize segmentations.
  * Usage:
@@ -52,6 +53,7 @@
  *     --random                   randomly color
  *     -v [ --vis ] arg (=output) output folder
  *     -x [ --prefix ] arg        input and output file prefix
+ *     --threads arg (=1)         number of files to visualize in parallel
  *     -w [ --wordy ]             verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -70,6 +72,7 @@ int main(int argc, const char** argv) {
         ("random", "randomly color")
         ("vis,v", boost::program_options::value<std::string>()->default_value("output"), "output folder")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "input and output file prefix")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of files to visualize in parallel")
         ("wordy,w", "verbose/wordy/debug");
 
     boost::program_options::positional_options_description positionals;
@@ -110,9 +113,17 @@ int main(int argc, const char** argv) {
         wordy = true;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     std::multimap<std::string, boost::filesystem::path> files;
     std::vector<std::string> extensions;
-    IOUtil::getCSVExtensions(extensions);
+    IOUtil::getLabelExtensions(extensions);
     std::vector<std::string> exclude;
     exclude.push_back("correlation");
     exclude.push_back("results");
@@ -123,14 +134,21 @@ int main(int argc, const char** argv) {
         std::cout << "Found " << files.size() << " files." << std::endl;
     }
     
+    std::vector<std::string> names;
+    std::vector<boost::filesystem::path> paths;
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = files.begin(); 
             it != files.end(); it++) {
-        
+        names.push_back(it->first);
+        paths.push_back(it->second);
+    }
+    
+    // Files are independent; each is read, visualized and written by one thread.
+    auto visualize = [&](int n) {
         cv::Mat sp_segmentation;
-        IOUtil::readMatCSVInt(it->second, sp_segmentation);
+        IOUtil::readMatCSVInt(paths[n], sp_segmentation);
         
-        std::string filename = it->second.stem().string().substr(prefix.length(), 
-                it->second.stem().string().length() - prefix.length() + 1);
+        std::string filename = paths[n].stem().string().substr(prefix.length(), 
+                paths[n].stem().string().length() - prefix.length() + 1);
         boost::filesystem::path image_file = image_dir / 
                 boost::filesystem::path(filename + ".png");
         if (!boost::filesystem::is_regular_file(image_file)) {
@@ -139,36 +157,40 @@ int main(int argc, const char** argv) {
         }
         
         LOG_IF (FATAL, !boost::filesystem::is_regular_file(image_file) && !image_dir.empty())
-                << "Image file not found for: " << it->first << ".";
+                << "Image file not found for: " << names[n] << ".";
         
         cv::Mat image;
         if (!image_dir.empty()) {
             image = cv::imread(image_file.string());
         }
         
+        // Boundaries and means are shared by all visualizations.
+        bool means = !image.empty() && (parameters.find("means") != parameters.end()
+                || parameters.find("perturbed-means") != parameters.end());
+        Visualization::Context context;
+        Visualization::computeContext(image, sp_segmentation, context, means);
+        
         if (parameters.find("contours") != parameters.end()
                 && !image.empty()) {
             
             cv::Mat contours;
-            Visualization::drawContours(image, sp_segmentation, contours);
+            Visualization::drawContours(context, contours);
             
             // Prefix already included!
             boost::filesystem::path contours_file = out_dir / 
-                    boost::filesystem::path(it->second.stem().string() + "_contours.png");
+                    boost::filesystem::path(paths[n].stem().string() + "_contours.png");
             cv::imwrite(contours_file.string(), contours);
         }
 
         if (parameters.find("contours-on-white") != parameters.end()) {
             
-            cv::Mat white_image(sp_segmentation.rows, sp_segmentation.cols, 
+            cv::Mat contours(sp_segmentation.rows, sp_segmentation.cols, 
                     CV_8UC3, cv::Scalar(255, 255, 255));
-            
-            cv::Mat contours;
-            Visualization::drawContours(white_image, sp_segmentation, contours);
+            Visualization::overlayContours(context, contours);
             
             // Prefix already included!
             boost::filesystem::path contours_file = out_dir / 
-                    boost::filesystem::path(it->second.stem().string() + "_contours_white.png");
+                    boost::filesystem::path(paths[n].stem().string() + "_contours_white.png");
             cv::imwrite(contours_file.string(), contours);
         }
         
@@ -176,20 +198,20 @@ int main(int argc, const char** argv) {
                 && !image.empty()) {
             
             cv::Mat means;
-            Visualization::drawMeans(image, sp_segmentation, means);
+            Visualization::drawMeans(context, means);
             
             // Prefix already included!
             boost::filesystem::path means_file = out_dir / 
-                    boost::filesystem::path(it->second.stem().string() + "_means.png");
+                    boost::filesystem::path(paths[n].stem().string() + "_means.png");
             cv::imwrite(means_file.string(), means);
         }
         
         if (parameters.find("random") != parameters.end()) {
             cv::Mat random;
-            Visualization::drawRandom(sp_segmentation, random);
+            Visualization::drawRandom(context, random);
             
             boost::filesystem::path random_file = out_dir / 
-                    boost::filesystem::path(it->second.stem().string() + "_random.png");
+                    boost::filesystem::path(paths[n].stem().string() + "_random.png");
             cv::imwrite(random_file.string(), random);
         }
         
@@ -197,13 +219,15 @@ int main(int argc, const char** argv) {
                 && !image.empty()) {
             
             cv::Mat perturbed_means;
-            Visualization::drawPerturbedMeans(image, sp_segmentation, perturbed_means);
+            Visualization::drawPerturbedMeans(context, perturbed_means);
             
             boost::filesystem::path perturbed_means_file = out_dir / 
-                    boost::filesystem::path(it->second.stem().string() + "_perturbed_means.png");
+                    boost::filesystem::path(paths[n].stem().string() + "_perturbed_means.png");
             cv::imwrite(perturbed_means_file.string(), perturbed_means);
         }
-    }
+    };
+    
+    ThreadPool::parallelFor(0, paths.size(), visualize);
     
     return 0;
 }
\ No newline at end of file
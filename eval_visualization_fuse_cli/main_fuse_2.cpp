@@ -31,11 +31,50 @@
  
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/timer.hpp>
 #include <boost/program_options.hpp>
 #include <glog/logging.h>
 #include "visualization.h"
 #include "io_util.h"
+#include "thread_pool.h"
+
+/** \brief First column of row i that is not above the line starting at row start
+ * with the given (negative) slope, i.e. the first column j with
+ * i >= j*slope + start.
+ * \param[in] i row
+ * \param[in] cols number of columns
+ * \param[in] start row of the line in the first column
+ * \param[in] slope slope of the line
+ * \return first column not above the line, cols if there is none
+ */
+int splitColumn(int i, int cols, int start, float slope) {
+    int low = 0;
+    int high = cols;
+    while (low < high) {
+        int j = (low + high)/2;
+        if (i < j*slope + start) {
+            low = j + 1;
+        }
+        else {
+            high = j;
+        }
+    }
+    
+    return low;
+}
+
+/** \brief Copy columns [begin, end) of row i from source to target.
+ * \param[in] source source image
+ * \param[out] target target image of the same size
+ * \param[in] i row
+ * \param[in] begin first column
+ * \param[in] end end column
+ */
+void copyRow(const cv::Mat &source, cv::Mat &target, int i, int begin, int end) {
+    if (begin < end) {
+        cv::Mat target_part = target(cv::Rect(begin, i, end - begin, 1));
+        source(cv::Rect(begin, i, end - begin, 1)).copyTo(target_part);
+    }
+}
 
 /** \brief Combine several visualizations into a single image.
  * Usage:
@@ -50,6 +89,7 @@
  *     --suffix1 arg              input and output file suffix
  *     --suffix2 arg              input and output file suffix
  *     --exclude arg              file name part to exclude
+ *     --threads arg (=1)         number of files to fuse in parallel
  *     -w [ --wordy ]             verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -66,6 +106,7 @@ int main(int argc, const char** argv) {
         ("suffix1", boost::program_options::value<std::string>()->default_value(""), "input and output file suffix")
         ("suffix2", boost::program_options::value<std::string>()->default_value(""), "input and output file suffix")
         ("exclude", boost::program_options::value<std::string>()->default_value(""), "file name part to exclude")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of files to fuse in parallel")
         ("wordy,w", "verbose/wordy/debug");
 
     boost::program_options::positional_options_description positionals;
@@ -112,6 +153,14 @@ int main(int argc, const char** argv) {
         wordy = true;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     std::multimap<std::string, boost::filesystem::path> files1;
     std::multimap<std::string, boost::filesystem::path> files2;
     
@@ -136,30 +185,34 @@ int main(int argc, const char** argv) {
         std::cout << "Found " << files1.size() << " files in the first directory." << std::endl;
     }
     
+    std::vector<boost::filesystem::path> paths1;
+    std::vector<boost::filesystem::path> paths2;
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = files1.begin(), it2 = files2.begin(); 
             it != files1.end() && it2 != files2.end(); it++, it2++) {
+        paths1.push_back(it->second);
+        paths2.push_back(it2->second);
+    }
+    
+    // Files are independent; the buffers of each thread are reused across files
+    // of the same size.
+    auto fuse = [&](int n) {
+        static thread_local cv::Mat image1;
+        static thread_local cv::Mat image2;
+        static thread_local cv::Mat image_raw;
+        static thread_local cv::Mat image;
         
-        cv::Mat image1_raw = cv::imread(it->second.string());
-        cv::Mat image2_raw = cv::imread(it2->second.string());
+        cv::Mat image1_raw = cv::imread(paths1[n].string());
+        cv::Mat image2_raw = cv::imread(paths2[n].string());
         
         LOG_IF(FATAL, image1_raw.rows != image2_raw.rows || image1_raw.cols != image2_raw.cols) 
                 << "Image do not have same dimensions!";
         
+        // Landscape images are transposed such that the line runs along the
+        // longer side.
         bool rotated = false;
-        cv::Mat image1;
-        cv::Mat image2;
-        
         if (image1_raw.rows < image1_raw.cols) {
-            
-            image1.create (image1_raw.cols, image1_raw.rows, CV_8UC3);
-            image2.create (image2_raw.cols, image2_raw.rows, CV_8UC3);
-            
-            for (int i = 0; i < image1.rows; i++) {
-                for (int j = 0; j < image2.cols; j++) {
-                    image1.at<cv::Vec3b>(i, j) = image1_raw.at<cv::Vec3b>(j, i);
-                    image2.at<cv::Vec3b>(i, j) = image2_raw.at<cv::Vec3b>(j, i);
-                }
-            }
+            cv::transpose(image1_raw, image1);
+            cv::transpose(image2_raw, image2);
             
             // !
             rotated = true;
@@ -176,16 +229,15 @@ int main(int argc, const char** argv) {
         int line_row_end = rows/2 - 0.45*rows;
         float slope = (line_row_end - line_row_start) / (float) cols;
         
-        cv::Mat image_raw (rows, cols, CV_8UC3, cv::Scalar(255, 255, 255));
+        // The line falls from left to right, so in each row the pixels left of
+        // the line are taken from image1 and the remaining ones from image2;
+        // each part is copied as a whole.
+        image_raw.create(rows, cols, CV_8UC3);
         for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {
-                if (i < j*slope + line_row_start) {
-                    image_raw.at<cv::Vec3b>(i, j) = image1.at<cv::Vec3b>(i, j);
-                }
-                else {
-                    image_raw.at<cv::Vec3b>(i, j) = image2.at<cv::Vec3b>(i, j);
-                }
-            }
+            int split = splitColumn(i, cols, line_row_start, slope);
+            
+            copyRow(image1, image_raw, i, 0, split);
+            copyRow(image2, image_raw, i, split, cols);
         }
         
         cv::line(image_raw, cv::Point(0, line_row_start), cv::Point(cols - 1, line_row_end), 
@@ -195,26 +247,19 @@ int main(int argc, const char** argv) {
 //        cv::line(image_raw, cv::Point(0, line_row_start - 3), cv::Point(cols - 1, line_row_end - 3), 
 //                cv::Scalar(0, 0, 0), 2);
         
-        cv::Mat image;
         if (rotated) {
-            image.create(image_raw.cols, image_raw.rows, CV_8UC3);
-            
-            for (int i = 0; i < image.rows; i++) {
-                for (int j = 0; j < image.cols; j++) {
-                    image.at<cv::Vec3b>(i, j) = image_raw.at<cv::Vec3b>(j, i);
-                }
-            }
+            cv::transpose(image_raw, image);
         }
         else {
             image = image_raw;
         }
         
         boost::filesystem::path out_file = out_dir 
-            / boost::filesystem::path(it->second.stem().string() + ".png");
+            / boost::filesystem::path(paths1[n].stem().string() + ".png");
         cv::imwrite(out_file.string(), image);
-        
-        
-    }
+    };
+    
+    ThreadPool::parallelFor(0, paths1.size(), fuse);
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,50 @@
+#!/bin/sh
+# Copyright (c) 2016, David Stutz
+# Contact: david.stutz@rwth-aachen.de, davidstutz.de
+# All rights reserved.
+# 
+# Redistribution and use in source and binary forms, with or without modification,
+# are permitted provided that the following conditions are met:
+# 
+# 1. Redistributions of source code must retain the above copyright notice,
+#    this list of conditions and the following disclaimer.
+# 
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+# 
+# 3. Neither the name of the copyright holder nor the names of its contributors
+#    may be used to endorse or promote products derived from this software
+#    without specific prior written permission.
+# 
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+# THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Example of measuring the runtime of the mean shift filter of EAMS
+# for the different speedup levels on the BSDS500.
+# Supposed to be run from within examples/.
+
+# ../bin/eams_cli appends the average time per image to runtime.txt in the
+# output directory. Speedup level 1 uses the vectorized lattice filter for
+# color images; the bandwidths cover small and large spatial windows.
+
+BANDWIDTHS=("2" "4" "8" "16")
+SPEEDUPS=("1" "2" "3")
+
+for BANDWIDTH in "${BANDWIDTHS[@]}"
+do
+    for SPEEDUP in "${SPEEDUPS[@]}"
+    do
+        ../bin/eams_cli ../data/BSDS500/images/test/ -b $BANDWIDTH -r 6.5 -m 50 -u $SPEEDUP -o ../output/eams_benchmark/$BANDWIDTH/$SPEEDUP
+        echo "bandwidth $BANDWIDTH speedup $SPEEDUP: $(tail -n 1 ../output/eams_benchmark/$BANDWIDTH/$SPEEDUP/runtime.txt)"
+        find ../output/eams_benchmark/$BANDWIDTH/$SPEEDUP -type f -name '*.csv' -delete
+    done
+done
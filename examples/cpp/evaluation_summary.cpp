@@ -91,7 +91,7 @@ int main(int argc, char** argv) {
     EvaluationSummary::SuperpixelVisualizations visualizations;
     visualizations.contour = true;
     
-    // All metrics are true by default.
+    // All metrics except edge recall are true by default.
     EvaluationSummary::EvaluationMetrics metrics;
     metrics.ue = false;
     metrics.oe = false;
@@ -105,6 +105,7 @@ int main(int argc, char** argv) {
     metrics.co = false;
     metrics.ev = false;
     metrics.mde = false;
+    metrics.er = false;
     metrics.icv = false;
     metrics.cd = false;
     metrics.reg = false;
@@ -33,9 +33,9 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include <bitset>
 #include "io_util.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -144,7 +144,7 @@ int main(int argc, const char** argv) {
 
         cv::Mat labels;
         
-        boost::timer timer;
+        RuntimeHarness::Timer timer;
         cv::watershed(image, markers);
         SuperpixelTools::assignBoundariesToSuperpixels(image, markers, labels);    
         float elapsed = timer.elapsed();
@@ -33,10 +33,12 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "fh_opencv.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
+#include "thread_pool.h"
 #include "visualization.h"
 
 /** \brief Command line tool for running FH.
@@ -50,9 +52,17 @@
  *                                     zero)
  *     -t [ --threshold ] arg (=20)    constant for threshold function
  *     -m [ --minimum-size ] arg (=10) minimum component size
+ *     -s [ --tile-size ] arg (=0)     segment tiles of this size in parallel and 
+ *                                     merge them (approximate; 0 = exact)
  *     -o [ --csv ] arg                save segmentation as CSV file
  *     -v [ --vis ] arg                visualize contours
  *     -x [ --prefix ] arg             output file prefix
+ *     --memory                        write per image allocations and peak
+ *                                     memory to memory.csv next to runtime.txt
+ *     --png                           write segmentations as 16-bit PNG
+ *                                     instead of CSV
+ *     -j [ --threads ] arg (=1)       number of threads to relabel connected
+ *                                     components on the shared pool
  *     -w [ --wordy ]                  verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -66,9 +76,13 @@ int main(int argc, const char** argv) {
         ("sigma,g", boost::program_options::value<float>()->default_value(0.0f), "sigma used for smoothing (no smoothing if zero)")
         ("threshold,t", boost::program_options::value<float>()->default_value(20.0f), "constant for threshold function")
         ("minimum-size,m", boost::program_options::value<int>()->default_value(10), "minimum component size")
+        ("tile-size,s", boost::program_options::value<int>()->default_value(0), "segment tiles of this size in parallel and merge them (approximate; 0 = exact)")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads to relabel connected components on the shared pool")
         ("wordy,w", "verbose/wordy/debug");
     
     boost::program_options::positional_options_description positionals;
@@ -83,6 +97,14 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -104,6 +126,7 @@ int main(int argc, const char** argv) {
     }
     
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
@@ -114,25 +137,35 @@ int main(int argc, const char** argv) {
     float threshold = parameters["threshold"].as<float>();
     int minimum_size = parameters["minimum-size"].as<int>();
     
+    int tile_size = parameters["tile-size"].as<int>();
+    if (tile_size < 0) {
+        std::cout << "Tile size cannot be negative." << std::endl;
+        return 1;
+    }
+    
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(input_dir, extensions, images);
     
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         
-        boost::timer timer;
+        RuntimeHarness::Timer timer;
         cv::Mat labels;
         FH_OpenCV::computeSuperpixels(image, sigma, threshold, minimum_size, 
-                labels);
+                labels, tile_size);
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
-        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels, threads);
         
         if (wordy) {
             std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
@@ -141,9 +174,9 @@ int main(int argc, const char** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
         }
         
         if (!vis_dir.empty()) {
@@ -165,6 +198,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
@@ -2,26 +2,387 @@
 // All rights reserved.
 
 #include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer/timer.hpp>
 #include <boost/chrono.hpp>
+#include <boost/chrono/thread_clock.hpp>
 #include <bitset>
 #include "io_util.h"
+#include "dataset_manifest.h"
+#include "frame_stream.h"
+#include "numa_topology.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 #include "hhts.h"
 
 using namespace cv;
 
+/**
+ * Blocking queue with a fixed capacity connecting two pipeline stages.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(std::size_t capacity) : capacity(capacity), closed(false)
+    {
+    }
+
+    /**
+     * Add an item, waiting while the queue is full.
+     */
+    void push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+    }
+
+    /**
+     * Take the next item, waiting while the queue is empty.
+     * Returns false once the queue is closed and empty.
+     */
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty())
+        {
+            return false;
+        }
+
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * Signal that no more items will be added.
+     */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+private:
+    std::size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
+
+/**
+ * Wall times in seconds of the stages of processing a single image.
+ */
+struct StageTimes
+{
+    double decode = 0;
+    double segmentation = 0;
+    double relabel = 0;
+    double write = 0;
+    double visualization = 0;
+};
+
+/**
+ * Adds the wall time of its scope to the given target; does nothing if the
+ * target is null, so disabled timers do not even read the clock.
+ */
+class ScopedStageTimer
+{
+public:
+    explicit ScopedStageTimer(double *target) : target(target)
+    {
+        if (target)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedStageTimer()
+    {
+        if (target)
+        {
+            *target += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+private:
+    double *target;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * Image passed from the decoder to the segmentation stage.
+ */
+struct DecodedImage
+{
+    int index;
+    std::string name;
+    cv::Mat image;
+    cv::Mat mask;
+    StageTimes times;
+};
+
+/**
+ * Selects the color spaces worth evaluating splits on for a single image.
+ * Color spaces are visited by decreasing mean entropy of their channel
+ * histograms (normalized by log(bins)); each is scored by this entropy times
+ * one minus the mean absolute correlation of its channels with the channels
+ * selected so far, and skipped if the score is below the threshold. The most
+ * informative color space is always kept. Statistics are estimated on a copy
+ * downsampled to at most 128 pixels per side.
+ */
+int selectColorChannels(const Mat &image, int colorChannels, int bins, double threshold)
+{
+    const int spaces[3] = {HHTS::ColorChannel::RGB, HHTS::ColorChannel::HSV, HHTS::ColorChannel::LAB};
+
+    double scale = std::min(1.0, 128.0 / std::max(image.rows, image.cols));
+    Mat small;
+    resize(image, small, Size(), scale, scale, INTER_AREA);
+
+    Mat converted[3];
+    converted[0] = small;
+    if (colorChannels & HHTS::ColorChannel::HSV)
+    {
+        cvtColor(small, converted[1], CV_BGR2HSV);
+    }
+    if (colorChannels & HHTS::ColorChannel::LAB)
+    {
+        cvtColor(small, converted[2], CV_BGR2Lab);
+    }
+
+    int n = small.rows * small.cols;
+    double entropy[3] = {0, 0, 0};
+    vector<Mat> channels[3];
+    vector<int> order;
+    for (int s = 0; s < 3; ++s)
+    {
+        if (!(colorChannels & spaces[s]))
+        {
+            continue;
+        }
+
+        vector<Mat> planes;
+        split(converted[s], planes);
+        for (int c = 0; c < 3; ++c)
+        {
+            // 8-bit hue is given in [0, 180).
+            int range = (s == 1 && c == 0) ? 180 : 256;
+            vector<int> histogram(bins, 0);
+            for (int i = 0; i < planes[c].rows; ++i)
+            {
+                const uchar *row = planes[c].ptr<uchar>(i);
+                for (int j = 0; j < planes[c].cols; ++j)
+                {
+                    histogram[std::min(bins - 1, row[j] * bins / range)]++;
+                }
+            }
+
+            for (int b = 0; b < bins; ++b)
+            {
+                if (histogram[b] > 0)
+                {
+                    double p = histogram[b] / (double) n;
+                    entropy[s] -= p * std::log(p) / std::log((double) bins) / 3;
+                }
+            }
+
+            Mat channel;
+            planes[c].convertTo(channel, CV_32F);
+            channels[s].push_back(channel);
+        }
+
+        order.push_back(s);
+    }
+
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return entropy[a] > entropy[b]; });
+
+    int selected = 0;
+    vector<Mat> keptChannels;
+    for (int s : order)
+    {
+        double redundancy = 0;
+        for (int c = 0; c < 3 && !keptChannels.empty(); ++c)
+        {
+            double maxCorrelation = 0;
+            for (const Mat &kept : keptChannels)
+            {
+                Scalar meanA, stddevA, meanB, stddevB;
+                meanStdDev(channels[s][c], meanA, stddevA);
+                meanStdDev(kept, meanB, stddevB);
+                if (stddevA[0] > 0 && stddevB[0] > 0)
+                {
+                    double covariance = channels[s][c].dot(kept) / n - meanA[0] * meanB[0];
+                    maxCorrelation = std::max(maxCorrelation, std::abs(covariance / (stddevA[0] * stddevB[0])));
+                }
+            }
+            redundancy += maxCorrelation / 3;
+        }
+
+        if (selected == 0 || entropy[s] * (1 - redundancy) >= threshold)
+        {
+            selected |= spaces[s];
+            keptChannels.insert(keptChannels.end(), channels[s].begin(), channels[s].end());
+        }
+    }
+
+    return selected;
+}
+
+/**
+ * Segmentation passed from the segmentation stage to the writer.
+ */
+struct SegmentedImage
+{
+    int index;
+    int combination = 0;
+    std::string name;
+    cv::Mat image;
+    vector<Mat> labels;
+    /** Descriptors per level and color space, see computeDescriptors. */
+    vector<vector<SuperpixelTools::Features>> descriptors;
+    vector<std::string> descriptorSpaces;
+    StageTimes times;
+};
+
+/**
+ * Computes per-superpixel descriptors (mean, histogram, centroid, bounding
+ * box and neighbors) of all levels in each of the given color spaces. Each
+ * color space is converted once per image; hue is given in [0, 180).
+ */
+void computeDescriptors(SegmentedImage &segmented, int colorChannels, int bins)
+{
+    const int spaces[3] = {HHTS::ColorChannel::RGB, HHTS::ColorChannel::HSV, HHTS::ColorChannel::LAB};
+    const char *names[3] = {"rgb", "hsv", "lab"};
+
+    segmented.descriptors.assign(segmented.labels.size(), vector<SuperpixelTools::Features>());
+    segmented.descriptorSpaces.clear();
+    for (int s = 0; s < 3; ++s)
+    {
+        if (!(colorChannels & spaces[s]))
+        {
+            continue;
+        }
+
+        Mat converted = segmented.image;
+        if (s == 1)
+        {
+            cvtColor(segmented.image, converted, CV_BGR2HSV);
+        }
+        else if (s == 2)
+        {
+            cvtColor(segmented.image, converted, CV_BGR2Lab);
+        }
+
+        segmented.descriptorSpaces.push_back(names[s]);
+        for (int i = 0; i < segmented.labels.size(); ++i)
+        {
+            SuperpixelTools::Features features;
+            SuperpixelTools::computeFeatures(converted, segmented.labels[i], bins, features);
+            segmented.descriptors[i].push_back(std::move(features));
+        }
+    }
+}
+
+/**
+ * Parameters of one point of a parameter sweep; the directory is relative to
+ * the output directories and empty when not sweeping.
+ */
+struct SweepCombination
+{
+    int bins;
+    int minSize;
+    double splitThreshold;
+    bool blur;
+    int colorChannels;
+    std::string directory;
+};
+
+/**
+ * Parses color spaces given as names joined by '+', e.g. "rgb+lab".
+ * Returns 0 if a name is unknown.
+ */
+int parseColorChannels(const std::string &channels)
+{
+    int colorChannels = 0;
+    std::stringstream stream(channels);
+    std::string name;
+    while (std::getline(stream, name, '+'))
+    {
+        if (name == "rgb")
+        {
+            colorChannels |= HHTS::ColorChannel::RGB;
+        }
+        else if (name == "hsv")
+        {
+            colorChannels |= HHTS::ColorChannel::HSV;
+        }
+        else if (name == "lab")
+        {
+            colorChannels |= HHTS::ColorChannel::LAB;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    return colorChannels;
+}
+
+/**
+ * Formats color spaces as parsed by parseColorChannels.
+ */
+std::string formatColorChannels(int colorChannels)
+{
+    std::string channels;
+    if (colorChannels & HHTS::ColorChannel::RGB)
+    {
+        channels += "+rgb";
+    }
+    if (colorChannels & HHTS::ColorChannel::HSV)
+    {
+        channels += "+hsv";
+    }
+    if (colorChannels & HHTS::ColorChannel::LAB)
+    {
+        channels += "+lab";
+    }
+
+    return channels.empty() ? channels : channels.substr(1);
+}
+
 int main(int argc, const char **argv)
 {
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
     ("help,h", "produce help message")
-    ("input,i", boost::program_options::value<std::string>(), "the folder to process (can also be passed as positional argument)")
+    ("input,i", boost::program_options::value<std::string>(), "the folder to process, or a manifest (.txt) listing the images relative to it which is read while processing (can also be passed as positional argument)")
+    ("video", boost::program_options::value<std::string>()->default_value(""), "process the frames of a video file or camera index in order instead of a folder")
+    ("maxFrames", boost::program_options::value<int>()->default_value(0), "maximum number of video frames to process (0 for all)")
+    ("mask", boost::program_options::value<std::string>()->default_value(""), "mask image, or folder of masks named as the images, restricting the segmentation to non-zero pixels")
     ("superpixels,s", boost::program_options::value<vector<int>>()->multitoken(), "numbers of superpixels")
+    ("adaptive", boost::program_options::value<double>()->default_value(0.0), "per image, use between this fraction of the numbers of superpixels (simple images) and the numbers themselves (complex images), written to superpixels.csv next to runtime.txt; directories keep the requested numbers (0 for fixed numbers)")
     ("splitThreshold,t", boost::program_options::value<double>()->default_value(0.0), "min stddev * histWidth of superpixles")
     ("nrgb", "do not use rgb channel")
     ("nhsv", "do not use hsv channel")
@@ -29,9 +390,26 @@ int main(int argc, const char **argv)
     ("blur", "apply blur to channels")
     ("bins,b", boost::program_options::value<int>()->default_value(32), "number of histogram bins")
     ("minSize,m", boost::program_options::value<int>()->default_value(64), "minimum size of segments")
+    ("channelThreshold", boost::program_options::value<double>()->default_value(0.0), "per image, skip color spaces whose entropy times non-redundancy is below this threshold (0 to use all enabled)")
     ("csv,o", boost::program_options::value<std::string>()->default_value(""), "specify the output directory (default is ./output)")
+    ("binary", "write segmentations as binary label files (.lbl) instead of CSV")
+    ("png", "write segmentations as 16-bit PNG instead of CSV")
+    ("descriptors", "write per-superpixel histograms, mean colors, centroids, bounding boxes and neighbors for each used color space as binary files (.spft, see IOUtil::writeSuperpixelFeatures) next to the segmentations")
     ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
     ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+    ("sweepBins", boost::program_options::value<vector<int>>()->multitoken(), "sweep: numbers of histogram bins (default --bins)")
+    ("sweepMinSize", boost::program_options::value<vector<int>>()->multitoken(), "sweep: minimum sizes of segments (default --minSize)")
+    ("sweepSplitThreshold", boost::program_options::value<vector<double>>()->multitoken(), "sweep: split thresholds (default --splitThreshold)")
+    ("sweepBlur", boost::program_options::value<vector<int>>()->multitoken(), "sweep: 0 or 1 for without or with blur (default --blur)")
+    ("sweepChannels", boost::program_options::value<vector<std::string>>()->multitoken(), "sweep: color spaces as names joined by +, e.g. rgb+hsv lab (default --nrgb, --nhsv, --nlab)")
+    ("threads,j", boost::program_options::value<int>()->default_value(1), "number of images to process in parallel")
+    ("shard", boost::program_options::value<std::string>()->default_value("0/1"), "shard i/N to process, i.e. every N-th image starting with the i-th")
+    ("numaNode", boost::program_options::value<int>()->default_value(-1), "run all threads on this NUMA node such that images, planes and label maps stay in its memory; with --shard, one instance per node (-1 for any node)")
+    ("stageTimes", "write per-image stage timings to stage_times.csv next to runtime.txt (summarized with --wordy)")
+    ("memory", "write allocations and peak memory of the whole run to memory.csv next to runtime.txt (images are pipelined)")
+    ("stream", boost::program_options::value<std::string>(), "read raw BGR frames of size WIDTHxHEIGHT instead of images and write label maps in the binary label format, one per number of superpixels")
+    ("stream-input", boost::program_options::value<std::string>()->default_value("-"), "frames: - for stdin or shm:name for a shared memory ring")
+    ("stream-output", boost::program_options::value<std::string>()->default_value("-"), "label maps: - for stdout or shm:name for a shared memory ring")
     ("wordy,w", "verbose/wordy/debug");
 
     boost::program_options::positional_options_description positionals;
@@ -65,11 +443,103 @@ int main(int argc, const char **argv)
         }
     }
 
-    boost::filesystem::path input_dir(parameters["input"].as<std::string>());
-    if (!boost::filesystem::is_directory(input_dir))
+    // Frames are named after the video file or camera and their index.
+    std::string video = parameters["video"].as<std::string>();
+    int maxFrames = parameters["maxFrames"].as<int>();
+    cv::VideoCapture capture;
+    std::string videoName;
+    if (!video.empty())
     {
-        std::cout << "Image directory not found ..." << std::endl;
-        return 1;
+        if (video.find_first_not_of("0123456789") == std::string::npos)
+        {
+            capture.open(std::stoi(video));
+            videoName = "camera" + video;
+        }
+        else
+        {
+            capture.open(video);
+            videoName = boost::filesystem::path(video).stem().string();
+        }
+
+        if (!capture.isOpened())
+        {
+            std::cout << "Video could not be opened ..." << std::endl;
+            return 1;
+        }
+    }
+
+    // Raw frames are read from --stream-input, named like video frames.
+    bool streamFrames = (parameters.find("stream") != parameters.end());
+    std::string streamOutput = parameters["stream-output"].as<std::string>();
+    FrameStream frameStream;
+    if (streamFrames)
+    {
+        if (!video.empty())
+        {
+            std::cout << "--stream cannot be combined with --video ..." << std::endl;
+            return 1;
+        }
+
+        cv::Size frameSize;
+        if (!FrameStream::parseSize(parameters["stream"].as<std::string>(), frameSize))
+        {
+            std::cout << "Frame size for --stream needs to be given as WIDTHxHEIGHT ..." << std::endl;
+            return 1;
+        }
+
+        if (!frameStream.open(parameters["stream-input"].as<std::string>(), streamOutput, frameSize))
+        {
+            std::cout << "Stream could not be opened ..." << std::endl;
+            return 1;
+        }
+    }
+
+    // Label maps may go to stdout, so messages go to stderr.
+    std::ostream &out = (streamFrames && FrameStream::isStdout(streamOutput) ? std::cerr : std::cout);
+
+    // Large datasets are given as manifest, which is read while processing
+    // instead of listing the directory upfront.
+    boost::filesystem::path input_dir;
+    boost::filesystem::path manifestFile;
+    if (video.empty() && !streamFrames)
+    {
+        if (parameters.find("input") == parameters.end())
+        {
+            std::cout << "Image directory not given ..." << std::endl;
+            return 1;
+        }
+
+        input_dir = boost::filesystem::path(parameters["input"].as<std::string>());
+        if (boost::filesystem::is_regular_file(input_dir) && DatasetManifest::isManifestFile(input_dir))
+        {
+            manifestFile = input_dir;
+        }
+        else if (!boost::filesystem::is_directory(input_dir))
+        {
+            std::cout << "Image directory not found ..." << std::endl;
+            return 1;
+        }
+    }
+
+    // Either a single mask used for all images or a folder of masks.
+    boost::filesystem::path mask_path(parameters["mask"].as<std::string>());
+    cv::Mat fixedMask;
+    if (!mask_path.empty())
+    {
+        if (boost::filesystem::is_regular_file(mask_path))
+        {
+            fixedMask = cv::imread(mask_path.string(), CV_LOAD_IMAGE_GRAYSCALE);
+            if (fixedMask.empty())
+            {
+                std::cout << "Mask could not be read ..." << std::endl;
+                return 1;
+            }
+        }
+        else if (!boost::filesystem::is_directory(mask_path))
+        {
+            std::cout << "Mask not found ..." << std::endl;
+            return 1;
+        }
     }
 
     std::string prefix = parameters["prefix"].as<std::string>();
@@ -80,18 +550,38 @@ int main(int argc, const char **argv)
         wordy = true;
     }
 
+    bool stageTimes = false;
+    if (parameters.find("stageTimes") != parameters.end())
+    {
+        stageTimes = true;
+    }
+
+    bool descriptors = false;
+    if (parameters.find("descriptors") != parameters.end())
+    {
+        if (output_dir.empty())
+        {
+            std::cout << "Descriptors require an output directory (--csv) ..." << std::endl;
+            return 1;
+        }
+
+        descriptors = true;
+    }
+
+    std::string labelExtension = ".csv";
+    if (parameters.find("binary") != parameters.end())
+    {
+        labelExtension = ".lbl";
+    }
+    else if (parameters.find("png") != parameters.end())
+    {
+        labelExtension = ".png";
+    }
+
     vector<int> superpixels{};
     if (parameters.find("superpixels") != parameters.end())
     {
         superpixels = parameters["superpixels"].as<vector<int>>();
-        for (int sp : superpixels)
-        {
-            boost::filesystem::path spPath = output_dir / to_string(sp);
-            if (!boost::filesystem::is_directory(spPath))
-            {
-                boost::filesystem::create_directories(spPath);
-            }
-        }
     }
     double splitThreshold = 0.0;
     if (parameters.find("splitThreshold") != parameters.end())
@@ -121,80 +611,628 @@ int main(int argc, const char **argv)
     {
         bins = parameters["bins"].as<int>();
     }
+    double channelThreshold = parameters["channelThreshold"].as<double>();
+    double adaptive = parameters["adaptive"].as<double>();
+    if (adaptive < 0 || adaptive > 1)
+    {
+        std::cout << "Adaptive fraction needs to be in [0,1] ..." << std::endl;
+        return 1;
+    }
     int minSegmentSize = 64;
     if (parameters.find("minSize") != parameters.end())
     {
         minSegmentSize = parameters["minSize"].as<int>();
     }
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0)
+    {
+        std::cout << "Number of threads needs to be positive ..." << std::endl;
+        return 1;
+    }
+    // Threads started from here on inherit the affinity, and memory is
+    // placed on the node of the thread touching it first.
+    int numaNode = parameters["numaNode"].as<int>();
+    if (numaNode >= NumaTopology::getNodes())
+    {
+        std::cout << "NUMA node needs to be below " << NumaTopology::getNodes() << " ..." << std::endl;
+        return 1;
+    }
+    if (numaNode >= 0 && !NumaTopology::pinThreadToNode(numaNode))
+    {
+        out << "Could not pin to NUMA node " << numaNode << ", running on any node ..." << std::endl;
+    }
+    int shard = 0;
+    int shards = 1;
+    if (!IOUtil::parseShard(parameters["shard"].as<std::string>(), shard, shards))
+    {
+        std::cout << "Shard needs to be given as i/N with 0 <= i < N ..." << std::endl;
+        return 1;
+    }
+
+    DatasetManifest manifest;
+    if (!manifestFile.empty() && !manifest.open(manifestFile, shard, shards))
+    {
+        std::cout << "Manifest could not be opened ..." << std::endl;
+        return 1;
+    }
 
     std::multimap<std::string, boost::filesystem::path> images;
-    std::vector<std::string> extensions;
-    IOUtil::getImageExtensions(extensions);
-    IOUtil::readDirectory(input_dir, extensions, images);
+    if (video.empty() && !streamFrames && manifestFile.empty())
+    {
+        std::vector<std::string> extensions;
+        IOUtil::getImageExtensions(extensions);
+        IOUtil::readDirectory(input_dir, extensions, images);
+        IOUtil::selectShard(images, shard, shards);
+    }
 
-    double totalWall = 0;
-    double total = 0;
-    int count = 0;
+    std::vector<boost::filesystem::path> imagePaths;
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin();
          it != images.end(); ++it)
     {
+        imagePaths.push_back(it->second);
+    }
 
-        cv::Mat image = cv::imread(it->first);
+    int colorChannels = 0;
+    if (rgb)
+    {
+        colorChannels |= HHTS::ColorChannel::RGB;
+    }
+    if (hsv)
+    {
+        colorChannels |= HHTS::ColorChannel::HSV;
+    }
+    if (lab)
+    {
+        colorChannels |= HHTS::ColorChannel::LAB;
+    }
 
-        // set params
-        vector<Mat> labels;
-        vector<int> labelCounts;
-        int colorChannels = 0;
-        if (rgb)
+    // With any sweep option, all combinations are segmented per decoded
+    // image; combinations sharing color spaces, blur and bins are adjacent.
+    vector<int> sweepBins{bins};
+    vector<int> sweepMinSizes{minSegmentSize};
+    vector<double> sweepSplitThresholds{splitThreshold};
+    vector<int> sweepBlurs{applyBlur ? 1 : 0};
+    vector<int> sweepChannels{colorChannels};
+    bool sweep = false;
+    if (parameters.find("sweepBins") != parameters.end())
+    {
+        sweepBins = parameters["sweepBins"].as<vector<int>>();
+        sweep = true;
+    }
+    if (parameters.find("sweepMinSize") != parameters.end())
+    {
+        sweepMinSizes = parameters["sweepMinSize"].as<vector<int>>();
+        sweep = true;
+    }
+    if (parameters.find("sweepSplitThreshold") != parameters.end())
+    {
+        sweepSplitThresholds = parameters["sweepSplitThreshold"].as<vector<double>>();
+        sweep = true;
+    }
+    if (parameters.find("sweepBlur") != parameters.end())
+    {
+        sweepBlurs = parameters["sweepBlur"].as<vector<int>>();
+        sweep = true;
+    }
+    if (parameters.find("sweepChannels") != parameters.end())
+    {
+        sweepChannels.clear();
+        for (const std::string &channels : parameters["sweepChannels"].as<vector<std::string>>())
         {
-            colorChannels |= HHTS::ColorChannel::RGB;
+            int parsed = parseColorChannels(channels);
+            if (parsed == 0)
+            {
+                std::cout << "Invalid color spaces " << channels << ", use rgb, hsv and lab joined by + ..." << std::endl;
+                return 1;
+            }
+            sweepChannels.push_back(parsed);
         }
-        if (hsv)
+        sweep = true;
+    }
+
+    if (sweep && streamFrames)
+    {
+        std::cout << "Sweeps cannot be combined with --stream ..." << std::endl;
+        return 1;
+    }
+
+    vector<SweepCombination> combinations;
+    for (int channels : sweepChannels)
+    {
+        for (int blur : sweepBlurs)
         {
-            colorChannels |= HHTS::ColorChannel::HSV;
+            for (int b : sweepBins)
+            {
+                for (int minSize : sweepMinSizes)
+                {
+                    for (double threshold : sweepSplitThresholds)
+                    {
+                        SweepCombination combination;
+                        combination.bins = b;
+                        combination.minSize = minSize;
+                        combination.splitThreshold = threshold;
+                        combination.blur = (blur > 0);
+                        combination.colorChannels = channels;
+                        if (sweep)
+                        {
+                            std::stringstream directory;
+                            directory << "bins" << b << "_minSize" << minSize << "_splitThreshold" << threshold
+                                      << "_blur" << (blur > 0 ? 1 : 0) << "_" << formatColorChannels(channels);
+                            combination.directory = directory.str();
+                        }
+                        combinations.push_back(combination);
+                    }
+                }
+            }
         }
-        if (lab)
+    }
+
+    for (const SweepCombination &combination : combinations)
+    {
+        for (int sp : superpixels)
         {
-            colorChannels |= HHTS::ColorChannel::LAB;
+            boost::filesystem::path spPath = output_dir / combination.directory / to_string(sp);
+            if (!boost::filesystem::is_directory(spPath))
+            {
+                boost::filesystem::create_directories(spPath);
+            }
+
+            boost::filesystem::path visPath = vis_dir / combination.directory / to_string(sp);
+            if (sweep && !vis_dir.empty() && !boost::filesystem::is_directory(visPath))
+            {
+                boost::filesystem::create_directories(visPath);
+            }
+        }
+    }
+
+    if (sweep && !output_dir.empty())
+    {
+        std::ofstream sweep_file(output_dir.string() + "/" + prefix + "sweep.csv");
+        sweep_file << "directory,bins,minSize,splitThreshold,blur,channels\n";
+        for (const SweepCombination &combination : combinations)
+        {
+            sweep_file << combination.directory << "," << combination.bins << "," << combination.minSize
+                       << "," << combination.splitThreshold << "," << (combination.blur ? 1 : 0)
+                       << "," << formatColorChannels(combination.colorChannels) << "\n";
         }
+        sweep_file.close();
+    }
 
-        boost::timer::cpu_timer timer;
-        labelCounts = HHTS::hhts(image, labels, superpixels, splitThreshold, bins, minSegmentSize, colorChannels, applyBlur, noArray());
+    // Timings are stored per image and summed in order afterwards; the
+    // number of video frames is only known once the stream ends.
+    std::atomic<int> count(imagePaths.size());
+    std::vector<double> elapsedTimes(imagePaths.size(), 0);
+    std::vector<double> elapsedWallTimes(imagePaths.size(), 0);
+    std::vector<StageTimes> imageStageTimes(imagePaths.size());
+    std::vector<std::string> imageNames(imagePaths.size());
+    std::vector<int> imageColorSpaces(imagePaths.size(), 0);
+    std::vector<std::string> adaptiveNames(imagePaths.size());
+    std::vector<float> imageComplexities(imagePaths.size(), 0);
+    std::vector<vector<int>> imageSuperpixels(imagePaths.size());
+    std::vector<std::vector<double>> combinationTimes(combinations.size(), std::vector<double>(imagePaths.size(), 0));
+    std::vector<std::vector<double>> combinationWallTimes(combinations.size(), std::vector<double>(imagePaths.size(), 0));
+    std::mutex timesMutex;
 
-        boost::chrono::duration<double> secondsWall = boost::chrono::nanoseconds(timer.elapsed().wall);
-        boost::chrono::duration<double> seconds = boost::chrono::nanoseconds(timer.elapsed().user + timer.elapsed().system);
-        double elapsedWall = secondsWall.count();
-        totalWall += elapsedWall;
-        double elapsed = seconds.count();
-        total += elapsed;
-        count++;
+    std::vector<std::string> maskExtensions;
+    IOUtil::getImageExtensions(maskExtensions);
+    auto readMask = [&](const std::string &name, const cv::Mat &image)
+    {
+        cv::Mat mask = fixedMask;
+        if (mask.empty() && !mask_path.empty())
+        {
+            for (int e = 0; e < maskExtensions.size() && mask.empty(); ++e)
+            {
+                boost::filesystem::path mask_file = mask_path / boost::filesystem::path(name + maskExtensions[e]);
+                if (boost::filesystem::is_regular_file(mask_file))
+                {
+                    mask = cv::imread(mask_file.string(), CV_LOAD_IMAGE_GRAYSCALE);
+                }
+            }
 
-        for (int i = 0; i < labels.size(); ++i)
+            if (mask.empty())
+            {
+                out << "No mask found for " << name << ", segmenting the whole image ..." << std::endl;
+            }
+        }
+
+        if (!mask.empty() && (mask.rows != image.rows || mask.cols != image.cols))
         {
-            int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels[i]);
+            out << "Mask does not match the size of " << name << ", segmenting the whole image ..." << std::endl;
+            mask = cv::Mat();
         }
 
-        for (int i = 0; i < labels.size(); ++i)
+        return mask;
+    };
+
+    // Decoding, segmentation and writing run as a pipeline connected by
+    // bounded queues such that I/O overlaps with segmentation.
+    BoundedQueue<DecodedImage> decodedImages(2 * threads);
+    BoundedQueue<SegmentedImage> segmentedImages(2 * threads);
+
+    auto decoder = [&]()
+    {
+        if (!manifestFile.empty())
         {
-            if (!output_dir.empty())
+            // Unreadable images are skipped such that indices stay contiguous.
+            int n = 0;
+            boost::filesystem::path imagePath;
+            while (manifest.next(imagePath))
             {
-                boost::filesystem::path csv_file(output_dir / to_string(superpixels[i]) / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-                IOUtil::writeMatCSV<int>(csv_file, labels[i]);
+                DecodedImage decoded;
+                decoded.name = imagePath.stem().string();
+                {
+                    ScopedStageTimer timer(stageTimes ? &decoded.times.decode : nullptr);
+                    decoded.image = cv::imread(imagePath.string());
+                    if (!decoded.image.empty())
+                    {
+                        decoded.mask = readMask(decoded.name, decoded.image);
+                    }
+                }
+
+                if (decoded.image.empty())
+                {
+                    std::cout << "Could not read " << imagePath.string() << ", skipping ..." << std::endl;
+                    continue;
+                }
+                decoded.index = n++;
+                decodedImages.push(std::move(decoded));
             }
+            count = n;
+        }
+        else if (streamFrames)
+        {
+            int n = 0;
+            for (; maxFrames <= 0 || n < maxFrames; ++n)
+            {
+                DecodedImage decoded;
+                decoded.index = n;
+
+                std::stringstream name;
+                name << "stream_" << std::setw(6) << std::setfill('0') << n;
+                decoded.name = name.str();
 
-            if (!vis_dir.empty())
+                bool read = false;
+                {
+                    ScopedStageTimer timer(stageTimes ? &decoded.times.decode : nullptr);
+                    cv::Mat frame;
+                    read = frameStream.read(frame);
+                    if (read)
+                    {
+                        // The stream reuses its buffer for the next frame.
+                        decoded.image = frame.clone();
+                        decoded.mask = readMask(decoded.name, decoded.image);
+                    }
+                }
+
+                if (!read)
+                {
+                    break;
+                }
+                decodedImages.push(std::move(decoded));
+            }
+            count = n;
+        }
+        else if (video.empty())
+        {
+            for (int n = 0; n < imagePaths.size(); ++n)
             {
-                boost::filesystem::path contours_file(vis_dir / to_string(superpixels[i]) / boost::filesystem::path(prefix + it->second.stem().string() + ".png"));
-                cv::Mat image_contours;
-                Visualization::drawContours(image, labels[i], image_contours);
-                cv::imwrite(contours_file.string(), image_contours);
+                DecodedImage decoded;
+                decoded.index = n;
+                decoded.name = imagePaths[n].stem().string();
+                {
+                    ScopedStageTimer timer(stageTimes ? &decoded.times.decode : nullptr);
+                    decoded.image = cv::imread(imagePaths[n].string());
+                    decoded.mask = readMask(decoded.name, decoded.image);
+                }
+                decodedImages.push(std::move(decoded));
             }
         }
+        else
+        {
+            int n = 0;
+            for (; maxFrames <= 0 || n < maxFrames; ++n)
+            {
+                DecodedImage decoded;
+                decoded.index = n;
+
+                std::stringstream name;
+                name << videoName << "_" << std::setw(6) << std::setfill('0') << n;
+                decoded.name = name.str();
+
+                bool read = false;
+                {
+                    ScopedStageTimer timer(stageTimes ? &decoded.times.decode : nullptr);
+                    read = capture.read(decoded.image) && !decoded.image.empty();
+                    if (read)
+                    {
+                        decoded.mask = readMask(decoded.name, decoded.image);
+                    }
+                }
+
+                if (!read)
+                {
+                    break;
+                }
+                decodedImages.push(std::move(decoded));
+            }
+            count = n;
+        }
+        decodedImages.close();
+    };
+
+    // Only the segmentation itself is timed, so runtimes stay comparable.
+    std::atomic<int> activeSegmenters(threads);
+    auto segmenter = [&]()
+    {
+        DecodedImage decoded;
+        while (decodedImages.pop(decoded))
+        {
+            // The decoded image, its mask and the channel selection are shared
+            // by all combinations of a sweep.
+            int selectedChannels = -1;
+            int selectedBins = -1;
+            int imageColorChannels = colorChannels;
+            vector<int> decodedSuperpixels = superpixels;
+            float complexity = 0;
+            for (int c = 0; c < combinations.size(); ++c)
+            {
+                const SweepCombination &combination = combinations[c];
+
+                SegmentedImage segmented;
+                segmented.index = decoded.index;
+                segmented.combination = c;
+                segmented.name = decoded.name;
+                segmented.image = decoded.image;
+                if (c == 0)
+                {
+                    segmented.times = decoded.times;
+                }
+
+                vector<int> labelCounts;
+
+                // CPU time is measured per thread as images may be processed in parallel.
+                boost::chrono::thread_clock::time_point start = boost::chrono::thread_clock::now();
+                RuntimeHarness::Timer timer;
+
+                // The numbers of superpixels are chosen once per image, as
+                // part of the timed segmentation.
+                if (adaptive > 0 && c == 0)
+                {
+                    complexity = SuperpixelTools::computeComplexity(segmented.image);
+                    for (int i = 0; i < superpixels.size(); ++i)
+                    {
+                        decodedSuperpixels[i] = SuperpixelTools::computeAdaptiveSuperpixels(superpixels[i], adaptive, complexity);
+                    }
+                }
+
+                // Channel selection is part of the timed segmentation such that
+                // runtimes reflect the actual speedup.
+                if (combination.colorChannels != selectedChannels || combination.bins != selectedBins)
+                {
+                    selectedChannels = combination.colorChannels;
+                    selectedBins = combination.bins;
+                    imageColorChannels = selectedChannels;
+                    if (channelThreshold > 0)
+                    {
+                        imageColorChannels = selectColorChannels(segmented.image, selectedChannels, selectedBins, channelThreshold);
+                    }
+                }
+
+                if (decoded.mask.empty())
+                {
+                    labelCounts = HHTS::hhts(segmented.image, segmented.labels, decodedSuperpixels, combination.splitThreshold, combination.bins, combination.minSize, imageColorChannels, combination.blur, noArray());
+                }
+                else
+                {
+                    labelCounts = HHTS::hhts(segmented.image, segmented.labels, decodedSuperpixels, combination.splitThreshold, combination.bins, combination.minSize, imageColorChannels, combination.blur, decoded.mask);
+                }
+
+                boost::chrono::duration<double> secondsWall(timer.elapsed());
+                boost::chrono::duration<double> seconds = boost::chrono::thread_clock::now() - start;
+                {
+                    std::lock_guard<std::mutex> lock(timesMutex);
+                    if (segmented.index >= elapsedTimes.size())
+                    {
+                        elapsedTimes.resize(segmented.index + 1, 0);
+                        elapsedWallTimes.resize(segmented.index + 1, 0);
+                        imageColorSpaces.resize(segmented.index + 1, 0);
+                        adaptiveNames.resize(segmented.index + 1);
+                        imageComplexities.resize(segmented.index + 1, 0);
+                        imageSuperpixels.resize(segmented.index + 1);
+                    }
+                    if (segmented.index >= combinationTimes[c].size())
+                    {
+                        combinationTimes[c].resize(segmented.index + 1, 0);
+                        combinationWallTimes[c].resize(segmented.index + 1, 0);
+                    }
+                    elapsedWallTimes[segmented.index] += secondsWall.count();
+                    elapsedTimes[segmented.index] += seconds.count();
+                    combinationWallTimes[c][segmented.index] = secondsWall.count();
+                    combinationTimes[c][segmented.index] = seconds.count();
+                    adaptiveNames[segmented.index] = segmented.name;
+                    imageComplexities[segmented.index] = complexity;
+                    imageSuperpixels[segmented.index] = decodedSuperpixels;
+                    imageColorSpaces[segmented.index] = ((imageColorChannels & HHTS::ColorChannel::RGB) ? 1 : 0)
+                                                        + ((imageColorChannels & HHTS::ColorChannel::HSV) ? 1 : 0)
+                                                        + ((imageColorChannels & HHTS::ColorChannel::LAB) ? 1 : 0);
+                }
+                segmented.times.segmentation = secondsWall.count();
+
+                {
+                    ScopedStageTimer timer(stageTimes ? &segmented.times.relabel : nullptr);
+                    for (int i = 0; i < segmented.labels.size(); ++i)
+                    {
+                        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(segmented.labels[i]);
+                    }
+                }
+
+                if (descriptors)
+                {
+                    computeDescriptors(segmented, imageColorChannels, combination.bins);
+                }
+
+                segmentedImages.push(std::move(segmented));
+            }
+        }
+
+        if (--activeSegmenters == 0)
+        {
+            segmentedImages.close();
+        }
+    };
+
+    // Frames are segmented in parallel but streamed in order: label maps
+    // wait until those of all previous frames are written.
+    std::map<int, vector<Mat>> pendingLabels;
+    int nextStreamIndex = 0;
+    std::mutex streamMutex;
+
+    auto writer = [&]()
+    {
+        SegmentedImage segmented;
+        while (segmentedImages.pop(segmented))
+        {
+            if (streamFrames)
+            {
+                ScopedStageTimer timer(stageTimes ? &segmented.times.write : nullptr);
+                std::lock_guard<std::mutex> lock(streamMutex);
+                pendingLabels[segmented.index] = segmented.labels;
+                for (auto it = pendingLabels.find(nextStreamIndex); it != pendingLabels.end(); it = pendingLabels.find(nextStreamIndex))
+                {
+                    for (const Mat &labels : it->second)
+                    {
+                        if (!frameStream.write(labels))
+                        {
+                            out << "Could not write labels of " << segmented.name << " ..." << std::endl;
+                        }
+                    }
+                    pendingLabels.erase(it);
+                    nextStreamIndex++;
+                }
+            }
+
+            for (int i = 0; i < segmented.labels.size(); ++i)
+            {
+                if (!output_dir.empty())
+                {
+                    ScopedStageTimer timer(stageTimes ? &segmented.times.write : nullptr);
+                    boost::filesystem::path labelFile(output_dir / combinations[segmented.combination].directory / to_string(superpixels[i]) / boost::filesystem::path(prefix + segmented.name + labelExtension));
+                    IOUtil::writeLabels(labelFile, segmented.labels[i]);
+
+                    for (int s = 0; s < segmented.descriptorSpaces.size(); ++s)
+                    {
+                        boost::filesystem::path descriptorFile(output_dir / combinations[segmented.combination].directory / to_string(superpixels[i])
+                                                               / boost::filesystem::path(prefix + segmented.name + "_" + segmented.descriptorSpaces[s] + ".spft"));
+                        IOUtil::writeSuperpixelFeatures(descriptorFile, segmented.descriptors[i][s]);
+                    }
+                }
+
+                if (!vis_dir.empty())
+                {
+                    ScopedStageTimer timer(stageTimes ? &segmented.times.visualization : nullptr);
+                    boost::filesystem::path contours_file(vis_dir / combinations[segmented.combination].directory / to_string(superpixels[i]) / boost::filesystem::path(prefix + segmented.name + ".png"));
+                    cv::Mat image_contours;
+                    Visualization::drawContours(segmented.image, segmented.labels[i], image_contours);
+                    cv::imwrite(contours_file.string(), image_contours);
+                }
+            }
+
+            if (stageTimes)
+            {
+                std::lock_guard<std::mutex> lock(timesMutex);
+                if (segmented.index >= imageStageTimes.size())
+                {
+                    imageStageTimes.resize(segmented.index + 1);
+                    imageNames.resize(segmented.index + 1);
+                }
+                // Stages of all combinations of a sweep are added up.
+                imageStageTimes[segmented.index].decode += segmented.times.decode;
+                imageStageTimes[segmented.index].segmentation += segmented.times.segmentation;
+                imageStageTimes[segmented.index].relabel += segmented.times.relabel;
+                imageStageTimes[segmented.index].write += segmented.times.write;
+                imageStageTimes[segmented.index].visualization += segmented.times.visualization;
+                imageNames[segmented.index] = segmented.name;
+            }
+        }
+    };
+
+    // Images are decoded, segmented and written concurrently, so memory is
+    // only attributed to the run as a whole.
+    MemoryProfile memoryProfile(parameters.find("memory") != parameters.end());
+    memoryProfile.begin(prefix + "run");
+
+    RuntimeHarness::Timer runTimer;
+    if (video.empty() && !streamFrames && manifestFile.empty())
+    {
+        threads = std::max(1, std::min(threads, (int) imagePaths.size()));
+    }
+    activeSegmenters = threads;
+
+    // One decoder, and as many writers as segmentation threads as encoding
+    // CSV files is about as expensive as decoding images.
+    // The stages block on the bounded queues for the whole run, so each needs
+    // a dedicated thread; on the shared ThreadPool a waiting task may run
+    // another stage on its stack and deadlock the pipeline.
+    std::vector<std::thread> stages;
+    stages.push_back(std::thread(decoder));
+    for (int t = 0; t < threads; ++t)
+    {
+        stages.push_back(std::thread(segmenter));
+        stages.push_back(std::thread(writer));
+    }
+
+    for (std::thread &stage : stages)
+    {
+        stage.join();
+    }
+    frameStream.close();
+    double runWall = runTimer.elapsed();
+    memoryProfile.end();
+
+    double totalWall = 0;
+    double total = 0;
+    for (int n = 0; n < count; ++n)
+    {
+        totalWall += elapsedWallTimes[n];
+        total += elapsedTimes[n];
+    }
+
+    StageTimes averageStageTimes;
+    if (stageTimes)
+    {
+        for (int n = 0; n < count; ++n)
+        {
+            averageStageTimes.decode += imageStageTimes[n].decode / count;
+            averageStageTimes.segmentation += imageStageTimes[n].segmentation / count;
+            averageStageTimes.relabel += imageStageTimes[n].relabel / count;
+            averageStageTimes.write += imageStageTimes[n].write / count;
+            averageStageTimes.visualization += imageStageTimes[n].visualization / count;
+        }
     }
 
     if (wordy)
     {
-        std::cout << "Average time: " << total / count << " - " << totalWall / count << "." << std::endl;
+        out << "Average time: " << totalWall / count << " (CPU " << total / count << ")." << std::endl;
+        out << "Total wall time: " << runWall << " (" << threads << " threads)." << std::endl;
+
+        if (channelThreshold > 0)
+        {
+            double colorSpaces = 0;
+            for (int n = 0; n < count; ++n)
+            {
+                colorSpaces += imageColorSpaces[n] / (double) count;
+            }
+            out << "Average color spaces: " << colorSpaces << " of " << (rgb + hsv + lab) << "." << std::endl;
+        }
+
+        if (stageTimes)
+        {
+            out << "Average stage times: decode " << averageStageTimes.decode
+                      << ", segmentation " << averageStageTimes.segmentation
+                      << ", relabel " << averageStageTimes.relabel
+                      << ", write " << averageStageTimes.write
+                      << ", visualization " << averageStageTimes.visualization << "." << std::endl;
+        }
     }
 
     if (!output_dir.empty())
@@ -202,8 +1240,69 @@ int main(int argc, const char **argv)
         std::ofstream runtime_file(output_dir.string() + "/" + prefix + "runtime.txt",
                                    std::ofstream::out | std::ofstream::app);
 
-        runtime_file << total / count << " " << totalWall / count << "\n";
+        // Average wall and CPU time per image, followed by the wall time of the whole run.
+        runtime_file << totalWall / count << " " << total / count << " " << runWall << "\n";
         runtime_file.close();
+
+        // Each combination of a sweep gets its own runtime.txt, without run time.
+        for (int c = 0; sweep && c < combinations.size(); ++c)
+        {
+            double combinationTotal = 0;
+            double combinationTotalWall = 0;
+            for (int n = 0; n < count; ++n)
+            {
+                combinationTotal += combinationTimes[c][n];
+                combinationTotalWall += combinationWallTimes[c][n];
+            }
+
+            std::ofstream combination_runtime_file((output_dir / combinations[c].directory).string() + "/" + prefix + "runtime.txt",
+                                                   std::ofstream::out | std::ofstream::app);
+            combination_runtime_file << combinationTotalWall / count << " " << combinationTotal / count << "\n";
+            combination_runtime_file.close();
+        }
+
+        if (adaptive > 0)
+        {
+            // One column per requested number of superpixels.
+            std::ofstream superpixels_file(output_dir.string() + "/" + prefix + "superpixels.csv");
+            superpixels_file << "name,complexity";
+            for (int sp : superpixels)
+            {
+                superpixels_file << "," << sp;
+            }
+            superpixels_file << "\n";
+            for (int n = 0; n < count; ++n)
+            {
+                superpixels_file << adaptiveNames[n] << "," << imageComplexities[n];
+                for (int sp : imageSuperpixels[n])
+                {
+                    superpixels_file << "," << sp;
+                }
+                superpixels_file << "\n";
+            }
+            superpixels_file.close();
+        }
+
+        if (stageTimes)
+        {
+            std::ofstream stage_times_file(output_dir.string() + "/" + prefix + "stage_times.csv");
+            stage_times_file << "name,decode,segmentation,relabel,write,visualization\n";
+            for (int n = 0; n < count; ++n)
+            {
+                stage_times_file << imageNames[n] << "," << imageStageTimes[n].decode
+                                 << "," << imageStageTimes[n].segmentation
+                                 << "," << imageStageTimes[n].relabel
+                                 << "," << imageStageTimes[n].write
+                                 << "," << imageStageTimes[n].visualization << "\n";
+            }
+            stage_times_file.close();
+        }
+
+        if (memoryProfile.isEnabled())
+        {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"),
+                                        memoryProfile.getRecords());
+        }
     }
 
     return 0;
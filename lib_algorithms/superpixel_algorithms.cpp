@@ -0,0 +1,567 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "superpixel_tools.h"
+#include "superpixel_algorithms.h"
+#include "tiled_segmentation.h"
+
+#ifdef SUPERPIXEL_ALGORITHMS_ETPS
+#include "etps_opencv.h"
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_SLIC
+#include "slic_opencv.h"
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_ERS
+#include "ers_opencv.h"
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_PB
+#include "pb_opencv.h"
+#include "QPBO_MaxFlow.h"
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_QS
+#include "qs_opencv.h"
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_EAMS
+#include "eams_opencv.h"
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_CIS
+#include "cis_opencv.h"
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_CCS
+#include "ccs_opencv.h"
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_VLSLIC
+#include "vlslic_opencv.h"
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_SEAW
+#include "seaw_opencv.h"
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_RW
+#include "rw_opencv.h"
+#endif
+
+typedef SuperpixelAlgorithm::Parameters Parameters;
+
+#ifdef SUPERPIXEL_ALGORITHMS_ETPS
+////////////////////////////////////////////////////////////////////////////////
+// ETPS
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief ETPS; with "warm-start", consecutive images of the same size are
+ * initialized from the previous segmentation, see ETPS_OpenCV.
+ */
+class ETPSAlgorithm : public SuperpixelAlgorithm {
+public:
+    
+    ETPSAlgorithm(const Parameters &parameters) : etps(NULL) {
+        superpixels = getInt(parameters, "superpixels", 400);
+        regularization_weight = getDouble(parameters, "regularization-weight", 1.0);
+        length_weight = getDouble(parameters, "length-weight", 1.0);
+        size_weight = getDouble(parameters, "size-weight", 1.0);
+        iterations = getInt(parameters, "iterations", 1);
+        threads = getInt(parameters, "threads", 1);
+        warm_start = getBool(parameters, "warm-start", false);
+    }
+    
+    ~ETPSAlgorithm() {
+        delete etps;
+    }
+    
+    void segment(const cv::Mat &image, cv::Mat &labels) {
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                superpixels);
+        
+        if (warm_start) {
+            // The region size is fixed by the first image.
+            if (etps == NULL) {
+                etps = new ETPS_OpenCV(region_size, regularization_weight, 
+                        length_weight, size_weight, iterations, threads);
+            }
+            
+            etps->computeNextSuperpixels(image, labels);
+        }
+        else {
+            ETPS_OpenCV::computeSuperpixels(image, region_size, regularization_weight, 
+                    length_weight, size_weight, iterations, labels, threads);
+        }
+    }
+    
+private:
+    
+    int superpixels;
+    double regularization_weight;
+    double length_weight;
+    double size_weight;
+    int iterations;
+    int threads;
+    bool warm_start;
+    ETPS_OpenCV* etps;
+    
+};
+#endif
+
+#ifdef SUPERPIXEL_ALGORITHMS_SLIC
+////////////////////////////////////////////////////////////////////////////////
+// SLIC
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief SLIC, see SLIC_OpenCV::computeSuperpixels.
+ */
+class SLICAlgorithm : public SuperpixelAlgorithm {
+public:
+    
+    SLICAlgorithm(const Parameters &parameters) {
+        superpixels = getInt(parameters, "superpixels", 400);
+        compactness = getDouble(parameters, "compactness", 40.);
+        perturb_seeds = getBool(parameters, "perturb-seeds", true);
+        iterations = getInt(parameters, "iterations", 10);
+        tolerance = getDouble(parameters, "tolerance", 0.f);
+        label_tolerance = getDouble(parameters, "label-tolerance", 0.01f);
+        preemption = getDouble(parameters, "preemption", 0.f);
+        color_space = getInt(parameters, "color-space", 1);
+        threads = getInt(parameters, "threads", 1);
+    }
+    
+    void segment(const cv::Mat &image, cv::Mat &labels) {
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                superpixels);
+        
+        SLIC_OpenCV::computeSuperpixels(image, region_size, compactness, 
+                iterations, perturb_seeds, color_space, labels, threads, 
+                tolerance, label_tolerance, NULL, preemption);
+    }
+    
+private:
+    
+    int superpixels;
+    double compactness;
+    bool perturb_seeds;
+    int iterations;
+    float tolerance;
+    float label_tolerance;
+    float preemption;
+    int color_space;
+    int threads;
+    
+};
+#endif
+
+#ifdef SUPERPIXEL_ALGORITHMS_ERS
+////////////////////////////////////////////////////////////////////////////////
+// ERS
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief ERS, see ERS_OpenCV::computeSuperpixels.
+ */
+class ERSAlgorithm : public SuperpixelAlgorithm {
+public:
+    
+    ERSAlgorithm(const Parameters &parameters) {
+        superpixels = getInt(parameters, "superpixels", 400);
+        lambda = getDouble(parameters, "lambda", 0.5);
+        sigma = getDouble(parameters, "sigma", 5.0);
+        four_connected = getBool(parameters, "eight-connected", false) ? 0 : 1;
+    }
+    
+    void segment(const cv::Mat &image, cv::Mat &labels) {
+        ERS_OpenCV::computeSuperpixels(image, superpixels, lambda, sigma, 
+                four_connected, labels);
+    }
+    
+private:
+    
+    int superpixels;
+    double lambda;
+    double sigma;
+    int four_connected;
+    
+};
+#endif
+
+#ifdef SUPERPIXEL_ALGORITHMS_PB
+////////////////////////////////////////////////////////////////////////////////
+// PB
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief PB; with "max-flow" the graphs of the solvers are reused across
+ * images of the same size, with "warm-start" also the flows.
+ */
+class PBAlgorithm : public SuperpixelAlgorithm {
+public:
+    
+    PBAlgorithm(const Parameters &parameters) {
+        superpixels = getInt(parameters, "superpixels", 400);
+        sigma = getDouble(parameters, "sigma", 20);
+        max_flow = getBool(parameters, "max-flow", false);
+        warm_start = getBool(parameters, "warm-start", false);
+        threads = getInt(parameters, "threads", 1);
+    }
+    
+    void segment(const cv::Mat &image, cv::Mat &labels) {
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                superpixels);
+        
+        if (max_flow) {
+            PB_OpenCV::computeSuperpixels(image, region_size, sigma, horizontal, 
+                    vertical, warm_start, labels, threads);
+        }
+        else {
+            PB_OpenCV::computeSuperpixels(image, region_size, sigma, max_flow, 
+                    labels, threads);
+        }
+    }
+    
+private:
+    
+    int superpixels;
+    float sigma;
+    bool max_flow;
+    bool warm_start;
+    int threads;
+    MaxFlowQPBOSolver horizontal;
+    MaxFlowQPBOSolver vertical;
+    
+};
+#endif
+
+#ifdef SUPERPIXEL_ALGORITHMS_QS
+////////////////////////////////////////////////////////////////////////////////
+// QS
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief QS, see QS_OpenCV::computeSuperpixels.
+ */
+class QSAlgorithm : public SuperpixelAlgorithm {
+public:
+    
+    QSAlgorithm(const Parameters &parameters) {
+        ratio = getDouble(parameters, "ratio", 0.5);
+        kernel_size = getDouble(parameters, "kernel-size", 5);
+        max_distance = getDouble(parameters, "max-distance", 10);
+        rgb = getBool(parameters, "rgb", false);
+        fast = getBool(parameters, "fast", false);
+    }
+    
+    void segment(const cv::Mat &image, cv::Mat &labels) {
+        QS_OpenCV::computeSuperpixels(image, ratio, kernel_size, max_distance, 
+                rgb, fast, labels);
+    }
+    
+private:
+    
+    double ratio;
+    double kernel_size;
+    double max_distance;
+    bool rgb;
+    bool fast;
+    
+};
+#endif
+
+#ifdef SUPERPIXEL_ALGORITHMS_EAMS
+////////////////////////////////////////////////////////////////////////////////
+// EAMS
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief EAMS, see EAMS_OpenCV::computeSuperpixels.
+ */
+class EAMSAlgorithm : public SuperpixelAlgorithm {
+public:
+    
+    EAMSAlgorithm(const Parameters &parameters) {
+        bandwidth = getInt(parameters, "bandwidth", 1);
+        range_bandwidth = getDouble(parameters, "range-bandwidth", 6.5);
+        minimum_size = getInt(parameters, "minimum-size", 20);
+        rgb = getBool(parameters, "rgb", false);
+        speedup = getInt(parameters, "speedup", 2);
+        parallel = getBool(parameters, "parallel", false);
+        graph_fusion = getBool(parameters, "graph-fusion", false);
+    }
+    
+    void segment(const cv::Mat &image, cv::Mat &labels) {
+        EAMS_OpenCV::computeSuperpixels(image, bandwidth, range_bandwidth, 
+                minimum_size, rgb, speedup, parallel, graph_fusion, labels);
+    }
+    
+private:
+    
+    int bandwidth;
+    float range_bandwidth;
+    int minimum_size;
+    bool rgb;
+    int speedup;
+    bool parallel;
+    bool graph_fusion;
+    
+};
+#endif
+
+#ifdef SUPERPIXEL_ALGORITHMS_CIS
+////////////////////////////////////////////////////////////////////////////////
+// CIS
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief CIS, see CIS_OpenCV::computeSuperpixels.
+ */
+class CISAlgorithm : public SuperpixelAlgorithm {
+public:
+    
+    CISAlgorithm(const Parameters &parameters) {
+        superpixels = getInt(parameters, "superpixels", 400);
+        type = getBool(parameters, "compact", false) ? 0 : 1;
+        iterations = getInt(parameters, "iterations", 2);
+        lambda = getInt(parameters, "lambda", 5);
+        sigma = getDouble(parameters, "sigma", 2.f);
+        color = getInt(parameters, "color-space", 0) > 0;
+        threads = getInt(parameters, "threads", 1);
+    }
+    
+    void segment(const cv::Mat &image, cv::Mat &labels) {
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                superpixels);
+        
+        CIS_OpenCV::computeSuperpixels(image, region_size, lambda, iterations, 
+                type, sigma, color, labels, threads);
+    }
+    
+private:
+    
+    int superpixels;
+    int type;
+    int iterations;
+    int lambda;
+    float sigma;
+    bool color;
+    int threads;
+    
+};
+#endif
+
+#ifdef SUPERPIXEL_ALGORITHMS_CCS
+////////////////////////////////////////////////////////////////////////////////
+// CCS
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief CCS, see CCS_OpenCV::computeSuperpixels.
+ */
+class CCSAlgorithm : public SuperpixelAlgorithm {
+public:
+    
+    CCSAlgorithm(const Parameters &parameters) {
+        superpixels = getInt(parameters, "superpixels", 400);
+        compactness = getInt(parameters, "compactness", 500);
+        iterations = getInt(parameters, "iterations", 20);
+        lab = getInt(parameters, "color-space", 0) > 0;
+    }
+    
+    void segment(const cv::Mat &image, cv::Mat &labels) {
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                superpixels);
+        
+        CCS_OpenCV::computeSuperpixels(image, region_size, iterations, 
+                compactness, lab, labels);
+    }
+    
+private:
+    
+    int superpixels;
+    int compactness;
+    int iterations;
+    bool lab;
+    
+};
+#endif
+
+#ifdef SUPERPIXEL_ALGORITHMS_VLSLIC
+////////////////////////////////////////////////////////////////////////////////
+// vlSLIC
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief vlSLIC, see VLSLIC_OpenCV::computeSuperpixels.
+ */
+class VLSLICAlgorithm : public SuperpixelAlgorithm {
+public:
+    
+    VLSLICAlgorithm(const Parameters &parameters) {
+        superpixels = getInt(parameters, "superpixels", 400);
+        minimum_region_size = getInt(parameters, "minimum-region-size", 1);
+        compactness = getDouble(parameters, "compactness", 40.0);
+        iterations = getInt(parameters, "iterations", 10);
+        preemption = getDouble(parameters, "preemption", 0.);
+    }
+    
+    void segment(const cv::Mat &image, cv::Mat &labels) {
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                superpixels);
+        
+        VLSLIC_OpenCV::computeSuperpixels(image, region_size, compactness, 
+                minimum_region_size, iterations, labels, preemption);
+    }
+    
+private:
+    
+    int superpixels;
+    int minimum_region_size;
+    double compactness;
+    int iterations;
+    double preemption;
+    
+};
+#endif
+
+#ifdef SUPERPIXEL_ALGORITHMS_SEAW
+////////////////////////////////////////////////////////////////////////////////
+// SEAW
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief SEAW, see SEAW_OpenCV::computeSuperpixels.
+ */
+class SEAWAlgorithm : public SuperpixelAlgorithm {
+public:
+    
+    SEAWAlgorithm(const Parameters &parameters) {
+        level = getInt(parameters, "level", 4);
+        dist_func = getInt(parameters, "dist-func", 1);
+        sigma = getDouble(parameters, "sigma", 1);
+        threads = getInt(parameters, "threads", 1);
+    }
+    
+    void segment(const cv::Mat &image, cv::Mat &labels) {
+        SEAW_OpenCV::computeSuperpixels(image, level, dist_func, sigma, 
+                labels, threads);
+    }
+    
+private:
+    
+    int level;
+    int dist_func;
+    double sigma;
+    int threads;
+    
+};
+#endif
+
+#ifdef SUPERPIXEL_ALGORITHMS_RW
+////////////////////////////////////////////////////////////////////////////////
+// RW
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief RW, see RW_OpenCV::computeSuperpixels.
+ */
+class RWAlgorithm : public SuperpixelAlgorithm {
+public:
+    
+    RWAlgorithm(const Parameters &parameters) {
+        superpixels = getInt(parameters, "superpixels", 400);
+        beta = getDouble(parameters, "beta", 5);
+        fair = getBool(parameters, "fair", false);
+        threads = getInt(parameters, "threads", 1);
+    }
+    
+    void segment(const cv::Mat &image, cv::Mat &labels) {
+        int region_height = 0;
+        int region_width = 0;
+        SuperpixelTools::computeHeightWidthFromSuperpixels(image, 
+                superpixels, region_height, region_width);
+        
+        if (fair) {
+            region_height = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                    superpixels);
+            region_width = region_height;
+        }
+        
+        RW_OpenCV::computeSuperpixels(image, region_height, region_width, beta, 
+                labels, threads);
+    }
+    
+private:
+    
+    int superpixels;
+    double beta;
+    bool fair;
+    int threads;
+    
+};
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// create
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Factory for the given adapter.
+ * \param[in] parameters parameters
+ * \return algorithm
+ */
+template<class T>
+static SuperpixelAlgorithm* create(const Parameters &parameters) {
+    return new T(parameters);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// registerAll
+////////////////////////////////////////////////////////////////////////////////
+
+void SuperpixelAlgorithms::registerAll() {
+#ifdef SUPERPIXEL_ALGORITHMS_ETPS
+    SuperpixelAlgorithmRegistry::add("etps", create<ETPSAlgorithm>);
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_SLIC
+    SuperpixelAlgorithmRegistry::add("slic", create<SLICAlgorithm>);
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_ERS
+    SuperpixelAlgorithmRegistry::add("ers", create<ERSAlgorithm>);
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_PB
+    SuperpixelAlgorithmRegistry::add("pb", create<PBAlgorithm>);
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_QS
+    SuperpixelAlgorithmRegistry::add("qs", create<QSAlgorithm>);
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_EAMS
+    SuperpixelAlgorithmRegistry::add("eams", create<EAMSAlgorithm>);
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_CIS
+    SuperpixelAlgorithmRegistry::add("cis", create<CISAlgorithm>);
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_CCS
+    SuperpixelAlgorithmRegistry::add("ccs", create<CCSAlgorithm>);
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_VLSLIC
+    SuperpixelAlgorithmRegistry::add("vlslic", create<VLSLICAlgorithm>);
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_SEAW
+    SuperpixelAlgorithmRegistry::add("seaw", create<SEAWAlgorithm>);
+#endif
+#ifdef SUPERPIXEL_ALGORITHMS_RW
+    SuperpixelAlgorithmRegistry::add("rw", create<RWAlgorithm>);
+#endif
+    SuperpixelAlgorithmRegistry::add("tiled", TiledSegmentation::create);
+}
@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SUPERPIXEL_ALGORITHMS_H
+#define	SUPERPIXEL_ALGORITHMS_H
+
+#include "superpixel_algorithm.h"
+
+/** \brief Adapters of the *_OpenCV wrappers to the SuperpixelAlgorithm interface.
+ * 
+ * Only the algorithms enabled in CMake (BUILD_ETPS, BUILD_SLIC etc.) and
+ * provided as library are registered. The number of superpixels is given as
+ * "superpixels" and converted per image using SuperpixelTools, as done by 
+ * the command line tools; all other parameters are named after the long
+ * options of the command line tools and default to the same values.
+ * 
+ * Usage:
+ * 
+ *     SuperpixelAlgorithms::registerAll();
+ *     SuperpixelAlgorithm* algorithm = SuperpixelAlgorithmRegistry::create("etps", 
+ *             SuperpixelAlgorithm::parseParameters("superpixels=800,warm-start"));
+ * 
+ * \author David Stutz
+ */
+class SuperpixelAlgorithms {
+public:
+    
+    /** \brief Register all algorithms built with the benchmark in 
+     * SuperpixelAlgorithmRegistry; can be called multiple times.
+     */
+    static void registerAll();
+    
+};
+
+#endif	/* SUPERPIXEL_ALGORITHMS_H */
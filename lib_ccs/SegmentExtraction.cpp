@@ -7,6 +7,9 @@
 #include <algorithm>
 #include <cmath> 
 #include "opencv2/opencv.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -25,10 +28,22 @@ SegmentExtraction::SegmentExtraction()
 	BorderList = new DynamicList[1];
 	EdgeList   = new DynamicList[1];
 	ThickBorderList = new DynamicList[1];
+	SegListK = NULL;
+	mSegmentIndexK = NULL;
+	BorderMask = NULL;
+	mBorderList = NULL;
 }
 SegmentExtraction::~SegmentExtraction()
 {
-
+	delete [] SegList;
+	delete [] SegData;
+	delete [] BorderList;
+	delete [] EdgeList;
+	delete [] ThickBorderList;
+	delete [] SegListK;
+	free(mSegmentIndexK);
+	free(BorderMask);
+	free(mBorderList);
 }
 
 void SegmentExtraction::get_data(int Width,int Height, std::vector< uchar *> ImArray,int index,int *Segno)
@@ -41,12 +56,85 @@ void SegmentExtraction::get_data(int Width,int Height, std::vector< uchar *> ImA
 	mIterNo = Segno[1];
 	mOutput_Choice = 1; // always show boundary
 	mCompactness = Segno[2];
+	free(mSegmentIndexK);
+	free(BorderMask);
+	free(mBorderList);
 	mSegmentIndexK = (int*)calloc((mH*mW),sizeof(int));
 	BorderMask = (int*)calloc((mH*mW),sizeof(int));
 	mBorderList = (int*)calloc((2*mH*mW),sizeof(int));
 	mBorderCount = 0;
 }
 void SegmentExtraction::KmeansOverSeg(uchar * Im,uchar * Im_out,int frame_no)
+{
+	compute_Kmeans(Im,frame_no);
+
+	/////////   Fill the output Image
+	int dx8[8] = {-1, -1,  0,  1, 1, 1, 0, -1};
+	int dy8[8] = { 0, -1, -1, -1, 0, 1, 1,  1};
+
+	sz = mW*mH;
+
+	vector<bool> istaken(sz, false);
+
+	int mainindex(0);
+	for( int j = 0; j < mH; j++ )
+	{
+		for( int k = 0; k < mW; k++ )
+		{
+			int np(0);
+			for( int i = 0; i < 8; i++ )
+			{
+				int x = k + dx8[i];
+				int y = j + dy8[i];
+
+				if( (x >= 0 && x < mW) && (y >= 0 && y < mH) )
+				{
+					int index = y*mW + x;
+
+					if( false == istaken[index] )//comment this to obtain internal contours
+					{
+						if( mSegmentIndexK[mainindex] != mSegmentIndexK[index] ) np++;
+					}
+				}
+			}
+			Im_out[3*mainindex] = Im[3*mainindex];
+			Im_out[3*mainindex+1] = Im[3*mainindex+1];
+			Im_out[3*mainindex+2] = Im[3*mainindex+2];
+			if( np > 1 )//change to 2 or 3 for thinner lines
+			{
+				Im_out[3*mainindex] = 0;
+				Im_out[3*mainindex+1] = 0;
+				Im_out[3*mainindex+2] = 255;
+				istaken[mainindex] = true;
+			}
+			mainindex++;
+		}
+	}
+
+	delete [] SegListK;
+	SegListK = new DynamicList[mSegmentNoK];
+	for(int j=0;j<mH;j++)
+	{
+		for(int i=0;i<mW;i++)
+		{
+			A.xL = i;A.yL = j;
+			int index = mSegmentIndexK[i+mW*j];
+			
+			SegListK[index].push_back(A);
+
+		}
+	}
+}
+// Same segmentation as KmeansOverSeg, written to Labels (mW*mH entries)
+// without the output image and the per-segment pixel lists.
+void SegmentExtraction::KmeansOverSegLabels(const uchar * Im,int * Labels)
+{
+	int* SegmentIndex = mSegmentIndexK;
+	mSegmentIndexK = Labels;
+	compute_Kmeans(Im,0);
+	mSegmentIndexK = SegmentIndex;
+}
+void SegmentExtraction::compute_Kmeans(const uchar * Im,int frame_no)
 {
 	clock_t start,end,FullS,FullE;
 	clock_t start1,end1,start2,end2;
@@ -184,42 +272,43 @@ void SegmentExtraction::KmeansOverSeg(uchar * Im,uchar * Im_out,int frame_no)
 
 	dif2 = 0;
 	dif3 = 0;
-	// Visit only Boundary Pixels
+	// Visit only Boundary Pixels; the means and candidates are fixed during
+	// an iteration, so the best segment of every boundary pixel is found in
+	// parallel and the changes are applied in the order of mBorderList.
+	int *BestSegment = (int*)malloc((mW*mH)*sizeof(int));
 	for(int iter =0;iter<mIterNo;iter++)
 	{
 		count = 0;
 		
 		memset(mSegChange,0,mSegmentNoK*sizeof(bool));
+#pragma omp parallel for schedule(static, 1024)
 		for(int c=0;c<mBorderCount;c++)
 		{
 			int i = mBorderList[2*c];
 			int j = mBorderList[2*c+1];
 
-			Pindex = i+j*mW;
+			int Pindex = i+j*mW;
 			int segInd = mSegmentIndexK[Pindex];
 
 			int Xmean = X_mean[segInd];
 			int Ymean = Y_mean[segInd];
-			//Rval = im_Lab[3*(i+mW*j)];Gval = im_Lab[3*(i+mW*j)+1];Bval = im_Lab[3*(i+mW*j)+2];
-			Rval = Im[3*Pindex];Gval = Im[3*Pindex+1];Bval = Im[3*Pindex+2];	
+			int Rval = Im[3*Pindex], Gval = Im[3*Pindex+1], Bval = Im[3*Pindex+2];
 
-			cost1 = abs(R_mean[segInd] - Rval) + abs(G_mean[segInd] - Gval) + abs(B_mean[segInd] - Bval);
-			costP1 = (i - Xmean)*(i - Xmean) + (j - Ymean)*(j - Ymean);
+			int cost1 = abs(R_mean[segInd] - Rval) + abs(G_mean[segInd] - Gval) + abs(B_mean[segInd] - Bval);
+			int costP1 = (i - Xmean)*(i - Xmean) + (j - Ymean)*(j - Ymean);
 
-			MinCost = cost1 + costP1*compactness;
-			Mindex = segInd;
+			int MinCost = cost1 + costP1*compactness;
+			int Mindex = segInd;
 
-			for(int ii=0;ii<CandidateList[Pindex];ii++)
+			for(int ii=0;ii<CandidateList[9*Pindex];ii++)
 			{
-				//index = CandidateList[i + mW*j+(ii+1)*mW*mH];
-				index = CandidateList[9*(Pindex)+(ii+1)];
+				int index = CandidateList[9*(Pindex)+(ii+1)];
 				Xmean = X_mean[index];
 				Ymean = Y_mean[index];
 
-				cost = abs(R_mean[index] - Rval) + abs(G_mean[index] - Gval) + abs(B_mean[index] - Bval);
-				costP = (i - Xmean)*(i - Xmean) + (j - Ymean)*(j - Ymean);
+				int cost = abs(R_mean[index] - Rval) + abs(G_mean[index] - Gval) + abs(B_mean[index] - Bval);
+				int costP = (i - Xmean)*(i - Xmean) + (j - Ymean)*(j - Ymean);
 				
-
 				cost = cost + costP*compactness;
 
 				if(cost<MinCost)
@@ -228,8 +317,20 @@ void SegmentExtraction::KmeansOverSeg(uchar * Im,uchar * Im_out,int frame_no)
 					Mindex = index;
 				}
 			}
+			BestSegment[c] = Mindex;
+		}
+
+		for(int c=0;c<mBorderCount;c++)
+		{
+			int i = mBorderList[2*c];
+			int j = mBorderList[2*c+1];
+
+			Pindex = i+j*mW;
+			int segInd = mSegmentIndexK[Pindex];
+			Mindex = BestSegment[c];
 			if(Mindex != segInd)
 			{
+				Rval = Im[3*Pindex];Gval = Im[3*Pindex+1];Bval = Im[3*Pindex+2];
 				mSegChange[segInd] = true;
 				mSegChange[Mindex] = true;
 				if(Count_mean[segInd])
@@ -266,6 +367,7 @@ void SegmentExtraction::KmeansOverSeg(uchar * Im,uchar * Im_out,int frame_no)
 
 		//printf ("Number of Border Pixels = %d\n", mBorderCount);
 	}
+	free(BestSegment);
 
 	end = clock();
 	dif1 = end - start;
@@ -278,251 +380,7 @@ void SegmentExtraction::KmeansOverSeg(uchar * Im,uchar * Im_out,int frame_no)
 //	printf ("It took  %f seconds for BoundaryDetection \n", dif3/(CLOCKS_PER_SEC));
 
 	total_time += dif1/CLOCKS_PER_SEC;
-	/////////   Fill the output Image
-	int dx8[8] = {-1, -1,  0,  1, 1, 1, 0, -1};
-	int dy8[8] = { 0, -1, -1, -1, 0, 1, 1,  1};
-
-	sz = mW*mH;
-
-	vector<bool> istaken(sz, false);
-
-	int mainindex(0);
-	for( int j = 0; j < mH; j++ )
-	{
-		for( int k = 0; k < mW; k++ )
-		{
-			int np(0);
-			for( int i = 0; i < 8; i++ )
-			{
-				int x = k + dx8[i];
-				int y = j + dy8[i];
-
-				if( (x >= 0 && x < mW) && (y >= 0 && y < mH) )
-				{
-					int index = y*mW + x;
-
-					if( false == istaken[index] )//comment this to obtain internal contours
-					{
-						if( mSegmentIndexK[mainindex] != mSegmentIndexK[index] ) np++;
-					}
-				}
-			}
-			/*Im_out[3*mainindex] = R_mean[mSegmentIndexK[mainindex]];
-			Im_out[3*mainindex+1] = G_mean[mSegmentIndexK[mainindex]];
-			Im_out[3*mainindex+2] = B_mean[mSegmentIndexK[mainindex]];*/
-			Im_out[3*mainindex] = Im[3*mainindex];
-			Im_out[3*mainindex+1] = Im[3*mainindex+1];
-			Im_out[3*mainindex+2] = Im[3*mainindex+2];
-			if( np > 1 )//change to 2 or 3 for thinner lines
-			{
-				Im_out[3*mainindex] = 0;
-				Im_out[3*mainindex+1] = 0;
-				Im_out[3*mainindex+2] = 255;
-				istaken[mainindex] = true;
-			}
-			mainindex++;
-		}
-	}
-
-	/// Kutalm�� Format�
-	//int SegID,Rvalue,Gvalue,Bvalue;
-	//for( int j = 0; j < mH; j++ )
-	//{
-	//	for( int k = 0; k < mW; k++ )
-	//	{
-	//		mainindex = j*mW + k;
-	//		SegID = mSegmentIndexK[mainindex];
-	//		Rvalue = SegID % (255*255);
-	//		Gvalue = Rvalue / (255);
-	//		Rvalue = Rvalue % 255;
-	//		Bvalue = SegID / (255*255);
-	//		/*Im_out[3*mainindex] = R_mean[mSegmentIndexK[mainindex]];
-	//		Im_out[3*mainindex+1] = G_mean[mSegmentIndexK[mainindex]];
-	//		Im_out[3*mainindex+2] = B_mean[mSegmentIndexK[mainindex]];*/
-	//		Im_out[3*mainindex+2] = Rvalue;
-	//		Im_out[3*mainindex+1] = Gvalue;
-	//		Im_out[3*mainindex] = Bvalue;
-	//	}
-	//}
 
-	/*for(int iter=0;iter<2;iter++)
-	{
-		for(int j=1;j<mH-1;j++)
-		{
-			for(int i=1;i<mW-1;i++)
-			{
-				if(iter==0)
-				{
-					Im_out[3*(i + mW*j)] = Im[3*(i + mW*j)];
-					Im_out[3*(i + mW*j)+1] = Im[3*(i + mW*j)+1];
-					Im_out[3*(i + mW*j)+2] = Im[3*(i + mW*j)+2];
-
-					if(mOutput_Choice==1)
-					{
-						if(BorderMask[i + j*mW]==1 && BorderMask[i + (j+1)*mW]==1)
-						{
-							Im_out[3*(i + mW*j)] = 0;
-							Im_out[3*(i + mW*j)+1] = 0;
-							Im_out[3*(i + mW*j)+2] = 255;
-							continue;
-						}
-						else
-							BorderMask[i + j*mW] = 0;
-					}
-				}
-			}
-		}
-		for(int j=1;j<mH-1;j++)
-		{
-			for(int i=1;i<mW-1;i++)
-			{
-				Im_out[3*(i + mW*j)] = Im_out[3*(i + mW*j)];
-				Im_out[3*(i + mW*j)+1] = Im_out[3*(i + mW*j)+1];
-				Im_out[3*(i + mW*j)+2] = Im_out[3*(i + mW*j)+2];
-
-				if(j==11 && i==11)
-					i=i;
-
-				if(Im_out[3*(i + mW*j)] == 0 && Im_out[3*(i + mW*j)+1] == 0 && Im_out[3*(i + mW*j)+2] ==255)
-				{
-					if(BorderMask[i + j*mW]==1 && BorderMask[i+1 + j*mW]==0)
-					{
-						Im_out[3*(i + mW*j)] = Im[3*(i + mW*j)];
-						Im_out[3*(i + mW*j)+1] = Im[3*(i + mW*j)+1];
-						Im_out[3*(i + mW*j)+2] = Im[3*(i + mW*j)+2];
-						continue;
-					}
-						
-				}
-			}
-		}
-	}*/
-
-	/*for(int i=0;i<mSegmentNoK;i++)
-	{
-		int XX = (int)X_mean[i];
-		int YY = (int)Y_mean[i];
-		
-		Im_out[3*(XX + mW*YY)] = 0;
-		Im_out[3*(XX + mW*YY)+1] = 255;
-		Im_out[3*(XX + mW*YY)+2] = 255;
-	}*/
-
-	//Segment_wrt_Variance(Im,Im_out);
-
-	SegListK = new DynamicList[SegNo];
-	for(int j=0;j<mH;j++)
-	{
-		for(int i=0;i<mW;i++)
-		{
-			A.xL = i;A.yL = j;
-			int index = mSegmentIndexK[i+mW*j];
-			
-			SegListK[index].push_back(A);
-
-		}
-	}
-
-	int mm;
-	//for(int i=0;i<SegNo;i++)
-	//{
-	//	AA = SegDataK[i].at(0);
-	//	for(int j=0;j<SegListK[i].size();j++)
-	//	{
-	//		A = SegListK[i].at(j);
-
-	//		//if(A.xL+A.yL<1700 || A.xL+A.yL>2900)
-	//		//{
-	//		//	Im_out[3*(A.xL + mW*A.yL)] = 0;
-	//		//	Im_out[3*(A.xL + mW*A.yL)+1] = 0;
-	//		//	Im_out[3*(A.xL + mW*A.yL)+2] = 0;
-	//		//	continue;
-	//		//}
-	//		
-	//		//if(CandidateList[A.xL + mW*A.yL].size() > 1 ) continue;
-	//		/*Im_out[3*(A.xL + mW*A.yL)] = AA.ImeanR;
-	//		Im_out[3*(A.xL + mW*A.yL)+1] = AA.ImeanG;
-	//		Im_out[3*(A.xL + mW*A.yL)+2] = AA.ImeanB;*/
-	//		if(mOutput_Choice==1)
-	//		{
-	//			Im_out[3*(A.xL + mW*A.yL)] = Im[3*(A.xL + mW*A.yL)];
-	//			Im_out[3*(A.xL + mW*A.yL)+1] = Im[3*(A.xL + mW*A.yL)+1];
-	//			Im_out[3*(A.xL + mW*A.yL)+2] = Im[3*(A.xL + mW*A.yL)+2];
-	//			if(BorderMask[A.xL + A.yL*mW]==1)
-	//			{
-	//				Im_out[3*(A.xL + mW*A.yL)] = 0;
-	//				Im_out[3*(A.xL + mW*A.yL)+1] = 0;
-	//				Im_out[3*(A.xL + mW*A.yL)+2] = 255;
-	//				mSegmentIndexK[A.xL+mW*A.yL] = i;
-	//				continue;
-	//			}
-	//		}
-	//		else
-	//		{
-	//			Im_out[3*(A.xL + mW*A.yL)] = AA.ImeanR;
-	//			Im_out[3*(A.xL + mW*A.yL)+1] = AA.ImeanG;
-	//			Im_out[3*(A.xL + mW*A.yL)+2] = AA.ImeanB;
-	//		}
-	//	}
-	//}
-	
-	/*for(int i=1;i<mW-1;i++)
-	{
-		for(int j=1;j<mH-1;j++)
-		{
-			if((BorderMask[i + j*mW]==1) && (BorderMask[i+1 + j*mW]==1) && (BorderMask[i + (j+1)*mW]==1))
-				continue;
-
-			else 
-			{
-				Im_out[3*(i + mW*j)] = Im[3*(i + mW*j)];
-				Im_out[3*(i+ mW*j)+1] = Im[3*(i + mW*j)+1];
-				Im_out[3*(i+ mW*j)+2] = Im[3*(i + mW*j)+2];
-			}
-		}
-	}*/
-	/*int *checker = new int[mW*mH];
-	int cc=0;
-	for(int i=0;i<mW*mH;i++)
-		checker[i] = BorderMask[i];
-
-	for(int i=1;i<mW-1;i++)
-	{
-		for(int j=1;j<mH-1;j++)
-		{	
-			if(BorderMask[i+j*mW]==1)
-			{
-				for(int ii=-1;ii<1;ii++)
-				{
-					for(int jj=-1;jj<1;jj++)
-					{
-						if(BorderMask[i+ii+(j+jj)*mW]==0)
-						{
-							checker[i+j*mW]=0;
-							break;
-						}
-					}
-				}
-			}
-
-		}
-	}
-
-	for(int i=1;i<mW-1;i++)
-	{
-		for(int j=1;j<mH-1;j++)
-		{
-			if(checker[i + j*mW]==1)
-			{
-				Im_out[3*(i + mW*j)] = 0;
-				Im_out[3*(i + mW*j)+1] = 0;
-				Im_out[3*(i + mW*j)+2] = 255;
-			}
-		}
-	}
-	delete [] BorderMask;
-	delete [] CandidateList;
-	delete [] checker;*/
 	//free(EdgeMap);
 	free(X_mean);
 	free(Y_mean);
@@ -534,111 +392,74 @@ void SegmentExtraction::KmeansOverSeg(uchar * Im,uchar * Im_out,int frame_no)
 	free(one_over_size);
 	free(CandidateList);
 	free(Count_mean);
+	free(mSegChange);
 	//free(im_Lab);
 }
 
 void SegmentExtraction::find_borders_Kmeans(int *CandidateList)
 {
-	int checkin,segInd,count;
-
+	find_borders(CandidateList,false);
+}
+void SegmentExtraction::find_borders_Kmeans2(int *CandidateList,int ind)
+{
+	find_borders(CandidateList,true);
+}
+// Marks the border pixels (of changed segments only if changed_only), stores
+// their number of differing 8-neighbors at CandidateList[9*p] and the
+// neighbors' segments at CandidateList[9*p+1..8]; rows are processed in
+// parallel and mBorderList is filled in raster order.
+void SegmentExtraction::find_borders(int *CandidateList,bool changed_only)
+{
 	memset(BorderMask,0, mW*mH*sizeof(int));
 
-	mBorderCount = 0;
+	vector<int> RowCount(mH + 1, 0);
 
+#pragma omp parallel for schedule(dynamic, 8)
 	for(int j=1;j<mH-1;j++)
 	{
 		for(int i=1;i<mW-1;i++)
 		{
-			segInd = mSegmentIndexK[j*mW + i];
+			int segInd = mSegmentIndexK[j*mW + i];
 
-			count =0;
+			if(changed_only && mSegChange[segInd]==false) continue;
+
+			int count =0;
 			for(int k=-1;k<2;k++)
 			{
 				for(int m =-1;m<2;m++)
 				{
-					checkin = mSegmentIndexK[(j+k)*mW + i+m];
+					int checkin = mSegmentIndexK[(j+k)*mW + i+m];
 					
 					if(checkin==segInd) continue;
 					
 					BorderMask[i + j*mW] = 1;
 					count +=1;
 					
-					//CandidateList[i + j*mW+count*mW*mH] = checkin;
 					CandidateList[(i + j*mW)*9+count] = checkin;
 				}
 			}
 			
-			CandidateList[i + j*mW] = count;
+			CandidateList[(i + j*mW)*9] = count;
 
-			if(BorderMask[i + j*mW]){
-				mBorderList[2*mBorderCount] = i;
-				mBorderList[2*mBorderCount+1] = j;
-				mBorderCount++;}
+			if(BorderMask[i + j*mW])
+				RowCount[j+1]++;
 		}
 	}
-}
-void SegmentExtraction::find_borders_Kmeans2(int *CandidateList,int ind)
-{
-	int checkin,segInd,count;
-
-	memset(BorderMask,0, mW*mH*sizeof(int));
 
-	mBorderCount = 0;
-	//int listX[4];
-	//int listY[4];
-	//if(ind%2==0){
-	//listX[0] = -1;listX[1] = 0;listX[2] = 1;listX[3] = -1;
-	//listY[0] = -1;listY[1] = -1;listY[2] = -1;listY[3] = 0;
-	//}
-	//else{
-	//listX[0] = 1;listX[1] = 0;listX[2] = -1;listX[3] = 1;
-	//listY[0] = 1;listY[1] = 1;listY[2] = 1;listY[3] = 0;
-	//}
+	for(int j=1;j<=mH;j++)
+		RowCount[j] += RowCount[j-1];
+	mBorderCount = RowCount[mH];
 
+#pragma omp parallel for schedule(dynamic, 8)
 	for(int j=1;j<mH-1;j++)
 	{
+		int c = RowCount[j];
 		for(int i=1;i<mW-1;i++)
 		{
-			segInd = mSegmentIndexK[j*mW + i];
-
-			if(mSegChange[segInd]==false) continue;
-
-			count =0;
-		/*	for(int k=0;k<4;k++)
-			{
-				int x = listX[k];
-				int y = listY[k];
-				checkin = mSegmentIndexK[(j+y)*mW + x+i];
-
-				if(checkin==segInd) continue;
-
-				BorderMask[i + j*mW] = 1;
-				count +=1;
-
-				CandidateList[(i + j*mW)*9+count] = checkin;
-			}*/
-			for(int k=-1;k<2;k++)
-			{
-				for(int m =-1;m<2;m++)
-				{
-					checkin = mSegmentIndexK[(j+k)*mW + i+m];
-					
-					if(checkin==segInd) continue;
-					
-					BorderMask[i + j*mW] = 1;
-					count +=1;
-					
-					//CandidateList[i + j*mW+count*mW*mH] = checkin;
-					CandidateList[(i + j*mW)*9+count] = checkin;
-				}
-			}
-			
-			CandidateList[i + j*mW] = count;
-
 			if(BorderMask[i + j*mW]){
-				mBorderList[2*mBorderCount] = i;
-				mBorderList[2*mBorderCount+1] = j;
-				mBorderCount++;}
+				mBorderList[2*c] = i;
+				mBorderList[2*c+1] = j;
+				c++;}
 		}
 	}
 }
@@ -1448,6 +1269,7 @@ void SegmentExtraction::smooth_saliency(IplImage * Im)
 }
 void SegmentExtraction::transfer_data(int* labelMap,int segNo)
 {
+	delete [] SegListK;
 	SegListK = new DynamicList[segNo];
 	mSegmentNoK = segNo;
 	for(int j=0;j<mH;j++)
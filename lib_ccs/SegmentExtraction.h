@@ -31,8 +31,11 @@ public:
 	 void update_segments_with_depth(uchar * DepthMap);
 	 //// Kmeans Oversegmetnation
 	 void KmeansOverSeg(uchar * Im,uchar * Im_out,int frame_no);
+	 void KmeansOverSegLabels(const uchar * Im,int * Labels);
+	 void compute_Kmeans(const uchar * Im,int frame_no);
 	 void find_borders_Kmeans(int *CandidateList);
 	 void find_borders_Kmeans2(int *CandidateList,int ind);
+	 void find_borders(int *CandidateList,bool changed_only);
 	 template <class T> void update_segments(T * Im,float* one_over_size);
 	 void smooth_image(uchar * Im);
 	 //// Segmentation Evaluation
@@ -42,7 +42,12 @@ void CCS_OpenCV::computeSuperpixels(const cv::Mat& mat, int region_size,
         cv::cvtColor(mat, image, CV_BGR2Lab);
     }
     else {
-        image = mat.clone();
+        image = mat;
+    }
+    
+    // KmeansOverSegLabels reads the interleaved 3-channel pixels directly.
+    if (!image.isContinuous()) {
+        image = image.clone();
     }
     
     int* s_index = new int[5];
@@ -60,36 +65,15 @@ void CCS_OpenCV::computeSuperpixels(const cv::Mat& mat, int region_size,
     // s_index[3] method choice 1:ConvexRGB
 
     SegmentExtraction SE;
-    DynamicSegList *SegData;
     SE.total_time = 0;
     
     //cvSmooth(imgIn, imgIn,CV_MEDIAN,3,0 );
     
-    IplImage* img;
-    IplImage* img2;
-    
-    CvSize newSize;
-    newSize.height = rows;
-    newSize.width = cols;
-    
-    img = cvCreateImage(newSize, IPL_DEPTH_8U, image.channels());
-    img2 = cvCreateImage(newSize, IPL_DEPTH_8U, image.channels());
-
-    uchar* Image = new uchar[3*rows*cols];
-    uchar* ImageSeg = new uchar[3*rows*cols];
-    
-    cv::Mat image_clone = image.clone();
-    Mat2uchar_Nomem(&image_clone, Image);
-    
     vector<uchar*> Seg_Image_Array;
-    SE.get_data(img->width, img->height, Seg_Image_Array, 0, s_index);
-
-    SE.KmeansOverSeg(Image, ImageSeg, 0);	
+    SE.get_data(cols, rows, Seg_Image_Array, 0, s_index);
     
     labels.create(rows, cols, CV_32SC1);
-    int2Mat(SE.mSegmentIndexK, &labels);
+    SE.KmeansOverSegLabels(image.ptr<uchar>(0), labels.ptr<int>(0));
     
-    free(Image);
-    cvReleaseImage(&img);
-    cvReleaseImage(&img2);
+    delete[] s_index;
 }
\ No newline at end of file
@@ -32,6 +32,8 @@
 #ifndef CIS_OPENCV_H
 #define	CIS_OPENCV_H
 
+#include <atomic>
+#include <thread>
 #include <opencv2/opencv.hpp>
 #include "superpixels.h"
 
@@ -49,9 +51,12 @@ public:
      * \param[in] sigma sigma parameter, see paper
      * \param[in] color whether to use color
      * \param[out] labels superpixel labels
+     * \param[in] threads number of threads; with more than one thread, patches
+     * that do not overlap are expanded concurrently, see colorPatches
      */
     static void computeSuperpixels(const cv::Mat &mat, int region_size, 
-        int lambda, int iterations, int type, float sigma, bool color, cv::Mat &labels) {
+        int lambda, int iterations, int type, float sigma, bool color, cv::Mat &labels,
+        int threads = 1) {
         
         cv::Mat image_gray;
         cv::cvtColor(mat, image_gray, CV_BGR2GRAY);
@@ -156,6 +161,29 @@ public:
             order[i] = i;
         }
 
+        // Expansions only read and write the labels within the patch
+        // around the seed, see getBounds.
+        auto expand = [&](int label) {
+            if (color) {
+                expandOnLabelColor(label, width, height, num_pixels, 
+                        Seeds, numSeeds, labeling, weights_horizontal,
+                        weights_vertical, lambda, weights_diagonal_1, 
+                        weights_diagonal_2, region_size, changeMask,
+                        changeMaskNew, I, type, variance);
+            }
+            else {
+                expandOnLabel(label, width, height, num_pixels, Seeds, 
+                        numSeeds, labeling, weights_horizontal, weights_vertical, 
+                        lambda, weights_diagonal_1, weights_diagonal_2, region_size, 
+                        changeMask, changeMaskNew, I_gray, type, variance);
+            }
+        };
+        
+        std::vector<std::vector<int> > groups;
+        if (threads > 1) {
+            colorPatches(width, height, Seeds, order, region_size, groups);
+        }
+        
         int j = 0;
         //purturbSeeds(order,numSeeds);
 
@@ -181,19 +209,28 @@ public:
 
             oldEnergy = newEnergy;
 
-            for (int i = 0; i < numSeeds; i++) {
-                if (color) {
-                    expandOnLabelColor(order[i], width, height, num_pixels, 
-                            Seeds, numSeeds, labeling, weights_horizontal,
-                            weights_vertical, lambda, weights_diagonal_1, 
-                            weights_diagonal_2, region_size, changeMask,
-                            changeMaskNew, I, type, variance);
+            if (threads > 1) {
+                for (unsigned int g = 0; g < groups.size(); g++) {
+                    std::atomic<int> next(0);
+                    auto work = [&]() {
+                        for (int i = next++; i < (int) groups[g].size(); i = next++) {
+                            expand(groups[g][i]);
+                        }
+                    };
+                    
+                    std::vector<std::thread> workers;
+                    for (int t = 1; t < threads; t++) {
+                        workers.push_back(std::thread(work));
+                    }
+                    work();
+                    for (unsigned int t = 0; t < workers.size(); t++) {
+                        workers[t].join();
+                    }
                 }
-                else {
-                    expandOnLabel(order[i], width, height, num_pixels, Seeds, 
-                            numSeeds, labeling, weights_horizontal, weights_vertical, 
-                            lambda, weights_diagonal_1, weights_diagonal_2, region_size, 
-                            changeMask, changeMaskNew, I_gray, type, variance);
+            }
+            else {
+                for (int i = 0; i < numSeeds; i++) {
+                    expand(order[i]);
                 }
             }
 
@@ -221,6 +258,78 @@ public:
         delete I_y;
     }
     
+private:
+    
+    /** \brief Greedily color the patches of the seeds such that patches of the
+     * same color do not overlap; each color is a group of patches that can be
+     * expanded concurrently. The groups keep the given order.
+     * \param[in] width image width
+     * \param[in] height image height
+     * \param[in] Seeds seeds as pixel indices
+     * \param[in] order order of the seeds
+     * \param[in] region_size patch size as used in expansion
+     * \param[out] groups seeds of each color
+     */
+    static void colorPatches(int width, int height, std::vector<int> &Seeds,
+            const std::vector<int> &order, int region_size, 
+            std::vector<std::vector<int> > &groups) {
+        
+        int numSeeds = order.size();
+        std::vector<int> startX(numSeeds), startY(numSeeds);
+        std::vector<int> endX(numSeeds), endY(numSeeds);
+        int cell_width = 1;
+        int cell_height = 1;
+        
+        for (int label = 0; label < numSeeds; label++) {
+            int seedX, seedY;
+            getBounds(width, height, Seeds, &seedX, &seedY, &startX[label], 
+                    &startY[label], &endX[label], &endY[label], label, region_size);
+            
+            cell_width = std::max(cell_width, endX[label] - startX[label] + 1);
+            cell_height = std::max(cell_height, endY[label] - startY[label] + 1);
+        }
+        
+        // Patches are bucketed by their upper left corner in cells as large as
+        // the largest patch, so overlapping patches are in neighboring cells.
+        int cells_x = width/cell_width + 1;
+        int cells_y = height/cell_height + 1;
+        std::vector<std::vector<int> > cells(cells_x*cells_y);
+        std::vector<int> colors(numSeeds, -1);
+        
+        groups.clear();
+        for (int i = 0; i < numSeeds; i++) {
+            int label = order[i];
+            int cx = startX[label]/cell_width;
+            int cy = startY[label]/cell_height;
+            
+            std::vector<bool> used(groups.size() + 1, false);
+            for (int y = std::max(0, cy - 1); y <= std::min(cells_y - 1, cy + 1); y++) {
+                for (int x = std::max(0, cx - 1); x <= std::min(cells_x - 1, cx + 1); x++) {
+                    for (unsigned int k = 0; k < cells[y*cells_x + x].size(); k++) {
+                        int other = cells[y*cells_x + x][k];
+                        if (startX[label] <= endX[other] && startX[other] <= endX[label]
+                                && startY[label] <= endY[other] && startY[other] <= endY[label]) {
+                            used[colors[other]] = true;
+                        }
+                    }
+                }
+            }
+            
+            int color = 0;
+            while (used[color]) {
+                color++;
+            }
+            
+            if (color == (int) groups.size()) {
+                groups.push_back(std::vector<int>());
+            }
+            
+            groups[color].push_back(label);
+            colors[label] = color;
+            cells[cy*cells_x + cx].push_back(label);
+        }
+    }
+    
 };
 
 #endif	/* CIS_OPENCV_H */
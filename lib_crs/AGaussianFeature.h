@@ -48,6 +48,17 @@ class AGaussianFeature : public IFeature<TLabelImage>
             TLabelImage const& oldLabel, TLabelImage const& pretendLabel, std::vector<TLabelImage> const& neighbourLabels,
             std::vector<LabelStatisticsGauss> const& labelStatistics, cv::Mat const& data) const;
 
+        template <typename TData>
+        void calculateGaussianCosts(cv::Point2i const& curPixelCoords,
+            TLabelImage const& oldLabel, std::vector<TLabelImage> const& neighbourLabels,
+            std::vector<LabelStatisticsGauss> const& labelStatistics, std::vector<double> const& labelCosts,
+            cv::Mat const& data, double* out_costs) const;
+
+        void initializeGaussianLabelCosts(std::vector<LabelStatisticsGauss> const& labelStatistics,
+            std::vector<double>& out_labelCosts) const;
+
+        static double calculateGaussianLabelCost(LabelStatisticsGauss const& labelStats);
+
 
     public:
 
@@ -194,28 +205,136 @@ double AGaussianFeature<TLabelImage>::calculateGaussianCost(cv::Point2i const& c
             curLabelStats = &labelStatsPretendLabel;
         }
 
-        // If a label completely vanished, disregard it (can happen to old label of pixel_index).
-        if (curLabelStats->pixelCount == 0)
+        // Add the cost of the current region.
+        featureCost += calculateGaussianLabelCost(*curLabelStats);
+    }
+
+    return featureCost;
+}
+
+
+/**
+ * @brief Calculate the costs of calculateGaussianCost for all labels in the 8-neighbourhood as assumed new label at once.
+ * Only the costs of the old label and of the assumed new label change, so the unchanged label costs are taken from
+ * labelCosts and only the costs with the pixel added (removed for the old label) are computed, once per label.
+ * The label costs are summed in the same order as in calculateGaussianCost.
+ * @param curPixelCoords coordinates of the regarded pixel
+ * @param oldLabel old label of the regarded pixel
+ * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
+ * @param labelStatistics label statistics of all labels in the image
+ * @param labelCosts costs of all labels in the image, as computed by calculateGaussianLabelCost from labelStatistics
+ * @param data observed data of the modelled Gaussian distributions
+ * @param out_costs will contain the cost for each label in neighbourLabels as assumed new label
+ */
+template <typename TLabelImage>
+template <typename TData>
+void AGaussianFeature<TLabelImage>::calculateGaussianCosts(cv::Point2i const& curPixelCoords,
+    TLabelImage const& oldLabel, std::vector<TLabelImage> const& neighbourLabels,
+    std::vector<LabelStatisticsGauss> const& labelStatistics, std::vector<double> const& labelCosts,
+    cv::Mat const& data, double* out_costs) const
+{
+    assert(curPixelCoords.inside(cv::Rect(0, 0, data.cols, data.rows)));
+    assert(data.type() == cv::DataType<TData>::type);
+    assert(labelCosts.size() == labelStatistics.size());
+    assert(neighbourLabels.size() <= 9);
+
+    int const numLabels = neighbourLabels.size();
+
+    // Cost of the old label with the pixel removed.
+    LabelStatisticsGauss labelStatsOldLabel(labelStatistics[oldLabel]);
+    LabelStatisticsGauss labelStatsPretendLabel(labelStatistics[oldLabel]);
+    updateGaussianStatistics<TData>(curPixelCoords, labelStatsOldLabel, labelStatsPretendLabel, data);
+
+    double const oldLabelCost = calculateGaussianLabelCost(labelStatsOldLabel);
+
+    // Costs of all labels with unchanged statistics, and with the pixel added (removed for the old label).
+    double unchangedCosts[9];
+    double changedCosts[9];
+
+    for (int i = 0; i < numLabels; ++i)
+    {
+        unchangedCosts[i] = labelCosts[neighbourLabels[i]];
+
+        if (neighbourLabels[i] == oldLabel)
+        {
+            changedCosts[i] = oldLabelCost;
+        }
+        else
+        {
+            labelStatsOldLabel = labelStatistics[oldLabel];
+            labelStatsPretendLabel = labelStatistics[neighbourLabels[i]];
+            updateGaussianStatistics<TData>(curPixelCoords, labelStatsOldLabel, labelStatsPretendLabel, data);
+
+            changedCosts[i] = calculateGaussianLabelCost(labelStatsPretendLabel);
+        }
+    }
+
+    for (int j = 0; j < numLabels; ++j)
+    {
+        double featureCost = 0;
+
+        // Without label change all costs are unchanged, else the old label and the assumed new label change.
+        for (int i = 0; i < numLabels; ++i)
         {
-            continue;
+            if (neighbourLabels[j] != oldLabel && (i == j || neighbourLabels[i] == oldLabel))
+            {
+                featureCost += changedCosts[i];
+            }
+            else
+            {
+                featureCost += unchangedCosts[i];
+            }
         }
 
-        // Compute the variance of the Gaussian distribution of the current label.
-        // Cast the numerator of both divisions to double so that we get double precision in the result,
-        // because the statistics are most likely stored as integers.
-        double variance = (curLabelStats->squareValueSum / curLabelStats->pixelCount)
-            - pow(curLabelStats->valueSum / curLabelStats->pixelCount, 2.0);
+        out_costs[j] = featureCost;
+    }
+}
 
-        // Ensure variance is bigger than zero, else we could get -infinity
-        // cost which screws up everything. Could happen to labels with only
-        // a few pixels which all have the exact same grayvalue (or a label
-        // with just one pixel).
-        variance = std::max(variance, featuresMinVariance);
 
-        // Add the cost of the current region.
-        featureCost += (static_cast<double>(curLabelStats->pixelCount) / 2 * log(2 * M_PI * variance))
-            + (static_cast<double>(curLabelStats->pixelCount) / 2);
+/**
+ * @brief Compute the cost of each label from its Gaussian statistics, for use with calculateGaussianCosts.
+ * @param labelStatistics label statistics of all labels in the image
+ * @param out_labelCosts will be created and contain the cost for each label in labelStatistics
+ */
+template <typename TLabelImage>
+void AGaussianFeature<TLabelImage>::initializeGaussianLabelCosts(std::vector<LabelStatisticsGauss> const& labelStatistics,
+    std::vector<double>& out_labelCosts) const
+{
+    out_labelCosts.resize(labelStatistics.size());
+
+    for (typename std::vector<LabelStatisticsGauss>::size_type i = 0; i < labelStatistics.size(); ++i)
+    {
+        out_labelCosts[i] = calculateGaussianLabelCost(labelStatistics[i]);
     }
+}
 
-    return featureCost;
+
+/**
+ * @brief Calculate the cost of a single label from its Gaussian statistics.
+ * @param labelStats statistics of the label
+ * @return negative log-likelihood (or cost) of the label, zero for an empty label
+ */
+template <typename TLabelImage>
+double AGaussianFeature<TLabelImage>::calculateGaussianLabelCost(LabelStatisticsGauss const& labelStats)
+{
+    // If a label completely vanished, disregard it (can happen to old label of pixel_index).
+    if (labelStats.pixelCount == 0)
+    {
+        return 0;
+    }
+
+    // Compute the variance of the Gaussian distribution of the current label.
+    // Cast the numerator of both divisions to double so that we get double precision in the result,
+    // because the statistics are most likely stored as integers.
+    double variance = (labelStats.squareValueSum / labelStats.pixelCount)
+        - pow(labelStats.valueSum / labelStats.pixelCount, 2.0);
+
+    // Ensure variance is bigger than zero, else we could get -infinity
+    // cost which screws up everything. Could happen to labels with only
+    // a few pixels which all have the exact same grayvalue (or a label
+    // with just one pixel).
+    variance = std::max(variance, featuresMinVariance);
+
+    return (static_cast<double>(labelStats.pixelCount) / 2 * log(2 * M_PI * variance))
+        + (static_cast<double>(labelStats.pixelCount) / 2);
 }
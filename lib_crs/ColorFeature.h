@@ -41,6 +41,9 @@ class ColorFeature : public AGaussianFeature<TLabelImage>
         std::vector<LabelStatisticsGauss> labelStatisticsChan1; ///< Gaussian label statistics of the first channel
         std::vector<LabelStatisticsGauss> labelStatisticsChan2; ///< Gaussian label statistics of the second channel
         std::vector<LabelStatisticsGauss> labelStatisticsChan3; ///< Gaussian label statistics of the third channel
+        std::vector<double> labelCostsChan1; ///< costs of all labels in the first channel, kept up to date with labelStatisticsChan1
+        std::vector<double> labelCostsChan2; ///< costs of all labels in the second channel, kept up to date with labelStatisticsChan2
+        std::vector<double> labelCostsChan3; ///< costs of all labels in the third channel, kept up to date with labelStatisticsChan3
         cv::Mat channel1; ///< observed data of the first channel
         cv::Mat channel2; ///< observed data of the second channel
         cv::Mat channel3; ///< observed data of the third channel
@@ -55,6 +58,9 @@ class ColorFeature : public AGaussianFeature<TLabelImage>
         double calculateCost(cv::Point2i const& curPixelCoords,
             TLabelImage const& oldLabel, TLabelImage const& pretendLabel, std::vector<TLabelImage> const& neighbourLabels) const;
 
+        void calculateCosts(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel,
+            std::vector<TLabelImage> const& neighbourLabels, double* out_costs) const;
+
         void updateStatistics(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel, TLabelImage const& newLabel);
 
         void generateRegionMeanImage(cv::Mat const& labelImage, cv::Mat& out_regionMeanImage) const;
@@ -93,6 +99,9 @@ void ColorFeature<TLabelImage>::initializeStatistics(cv::Mat const& labelImage)
     this->template initializeGaussianStatistics<TColorData>(labelImage, channel1, labelStatisticsChan1);
     this->template initializeGaussianStatistics<TColorData>(labelImage, channel2, labelStatisticsChan2);
     this->template initializeGaussianStatistics<TColorData>(labelImage, channel3, labelStatisticsChan3);
+    this->initializeGaussianLabelCosts(labelStatisticsChan1, labelCostsChan1);
+    this->initializeGaussianLabelCosts(labelStatisticsChan2, labelCostsChan2);
+    this->initializeGaussianLabelCosts(labelStatisticsChan3, labelCostsChan3);
 }
 
 
@@ -120,6 +129,34 @@ double ColorFeature<TLabelImage>::calculateCost(cv::Point2i const& curPixelCoord
 }
 
 
+/**
+ * @brief Calculate the costs of calculateCost for all labels in the 8-neighbourhood as assumed new label at once.
+ * @param curPixelCoords coordinates of the regarded pixel
+ * @param oldLabel old label of the regarded pixel
+ * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
+ * @param out_costs will contain the cost for each label in neighbourLabels as assumed new label
+ */
+template <typename TLabelImage>
+void ColorFeature<TLabelImage>::calculateCosts(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel,
+    std::vector<TLabelImage> const& neighbourLabels, double* out_costs) const
+{
+    double costsChan2[9];
+    double costsChan3[9];
+
+    this->template calculateGaussianCosts<TColorData>(curPixelCoords, oldLabel, neighbourLabels,
+        labelStatisticsChan1, labelCostsChan1, channel1, out_costs);
+    this->template calculateGaussianCosts<TColorData>(curPixelCoords, oldLabel, neighbourLabels,
+        labelStatisticsChan2, labelCostsChan2, channel2, costsChan2);
+    this->template calculateGaussianCosts<TColorData>(curPixelCoords, oldLabel, neighbourLabels,
+        labelStatisticsChan3, labelCostsChan3, channel3, costsChan3);
+
+    for (typename std::vector<TLabelImage>::size_type i = 0; i < neighbourLabels.size(); ++i)
+    {
+        out_costs[i] = out_costs[i] + costsChan2[i] + costsChan3[i];
+    }
+}
+
+
 /**
  * @brief Update the saved label statistics to reflect a label change of the given pixel.
  * @param curPixelCoords coordinates of the pixel whose label changes
@@ -137,6 +174,13 @@ void ColorFeature<TLabelImage>::updateStatistics(cv::Point2i const& curPixelCoor
         labelStatisticsChan2[newLabel], channel2);
     this->template updateGaussianStatistics<TColorData>(curPixelCoords, labelStatisticsChan3[oldLabel],
         labelStatisticsChan3[newLabel], channel3);
+
+    labelCostsChan1[oldLabel] = this->calculateGaussianLabelCost(labelStatisticsChan1[oldLabel]);
+    labelCostsChan1[newLabel] = this->calculateGaussianLabelCost(labelStatisticsChan1[newLabel]);
+    labelCostsChan2[oldLabel] = this->calculateGaussianLabelCost(labelStatisticsChan2[oldLabel]);
+    labelCostsChan2[newLabel] = this->calculateGaussianLabelCost(labelStatisticsChan2[newLabel]);
+    labelCostsChan3[oldLabel] = this->calculateGaussianLabelCost(labelStatisticsChan3[oldLabel]);
+    labelCostsChan3[newLabel] = this->calculateGaussianLabelCost(labelStatisticsChan3[newLabel]);
 }
 
 
@@ -52,6 +52,9 @@ class CompactnessFeature : public IFeature<TLabelImage>
         double calculateCost(cv::Point2i const& curPixelCoords,
             TLabelImage const& oldLabel, TLabelImage const& pretendLabel, std::vector<TLabelImage> const& neighbourLabels) const;
 
+        void calculateCosts(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel,
+            std::vector<TLabelImage> const& neighbourLabels, double* out_costs) const;
+
         void updateStatistics(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel, TLabelImage const& newLabel);
 };
 
@@ -237,6 +240,88 @@ double CompactnessFeature<TLabelImage>::calculateCost(cv::Point2i const& curPixe
 }
 
 
+/**
+ * @brief Calculate the costs of calculateCost for all labels in the 8-neighbourhood as assumed new label at once.
+ * @param curPixelCoords coordinates of the regarded pixel
+ * @param oldLabel old label of the regarded pixel
+ * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
+ * @param out_costs will contain the weighted cost for each label in neighbourLabels as assumed new label
+ *
+ * Only the costs of the old label and of the assumed new label change, so each label cost is computed once for the
+ * unchanged statistics and once with the pixel added (removed for the old label). The label costs are summed in the
+ * same order as in calculateCost.
+ */
+template <typename TLabelImage>
+void CompactnessFeature<TLabelImage>::calculateCosts(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel,
+    std::vector<TLabelImage> const& neighbourLabels, double* out_costs) const
+{
+    assert(neighbourLabels.size() <= 9);
+
+    int const numLabels = neighbourLabels.size();
+
+    // Costs in x and y of all labels with unchanged statistics, with the pixel added,
+    // and of the old label with the pixel removed. Vanished labels have no cost.
+    double unchangedCostsPosX[9];
+    double unchangedCostsPosY[9];
+    double changedCostsPosX[9];
+    double changedCostsPosY[9];
+
+    for (int i = 0; i < numLabels; ++i)
+    {
+        LabelStatisticsGauss const& labelStatsPosX = labelStatisticsPosX[neighbourLabels[i]];
+        LabelStatisticsGauss const& labelStatsPosY = labelStatisticsPosY[neighbourLabels[i]];
+
+        unchangedCostsPosX[i] = (labelStatsPosX.pixelCount == 0) ? 0
+            : labelStatsPosX.squareValueSum - (pow(labelStatsPosX.valueSum, 2) / labelStatsPosX.pixelCount);
+        unchangedCostsPosY[i] = (labelStatsPosX.pixelCount == 0) ? 0
+            : labelStatsPosY.squareValueSum - (pow(labelStatsPosY.valueSum, 2) / labelStatsPosY.pixelCount);
+
+        LabelStatisticsGauss labelStatsPosXOldLabel(labelStatisticsPosX[oldLabel]);
+        LabelStatisticsGauss labelStatsPosXPretendLabel(labelStatsPosX);
+        LabelStatisticsGauss labelStatsPosYOldLabel(labelStatisticsPosY[oldLabel]);
+        LabelStatisticsGauss labelStatsPosYPretendLabel(labelStatsPosY);
+
+        updateStatistics(curPixelCoords, labelStatsPosXOldLabel, labelStatsPosXPretendLabel,
+                         labelStatsPosYOldLabel, labelStatsPosYPretendLabel);
+
+        LabelStatisticsGauss const* changedLabelStatsPosX = &labelStatsPosXPretendLabel;
+        LabelStatisticsGauss const* changedLabelStatsPosY = &labelStatsPosYPretendLabel;
+        if (neighbourLabels[i] == oldLabel)
+        {
+            changedLabelStatsPosX = &labelStatsPosXOldLabel;
+            changedLabelStatsPosY = &labelStatsPosYOldLabel;
+        }
+
+        changedCostsPosX[i] = (changedLabelStatsPosX->pixelCount == 0) ? 0
+            : changedLabelStatsPosX->squareValueSum - (pow(changedLabelStatsPosX->valueSum, 2) / changedLabelStatsPosX->pixelCount);
+        changedCostsPosY[i] = (changedLabelStatsPosX->pixelCount == 0) ? 0
+            : changedLabelStatsPosY->squareValueSum - (pow(changedLabelStatsPosY->valueSum, 2) / changedLabelStatsPosY->pixelCount);
+    }
+
+    for (int j = 0; j < numLabels; ++j)
+    {
+        double featureCost = 0;
+
+        // Without label change all costs are unchanged, else the old label and the assumed new label change.
+        for (int i = 0; i < numLabels; ++i)
+        {
+            if (neighbourLabels[j] != oldLabel && (i == j || neighbourLabels[i] == oldLabel))
+            {
+                featureCost += changedCostsPosX[i];
+                featureCost += changedCostsPosY[i];
+            }
+            else
+            {
+                featureCost += unchangedCostsPosX[i];
+                featureCost += unchangedCostsPosY[i];
+            }
+        }
+
+        out_costs[j] = featureWeight * featureCost;
+    }
+}
+
+
 /**
  * @brief Update label statistics to reflect a label change of the given pixel.
  * @param curPixelCoords coordinates of the pixel changing its label
@@ -31,8 +31,13 @@
 #include <assert.h>
 #include <vector>
 #include <algorithm>
+#include <functional>
 #include <math.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 /**
  * @class ContourRelaxation
@@ -58,14 +63,36 @@ class ContourRelaxation
         std::vector< boost::shared_ptr< IFeature<TLabelImage> > > allFeatures; ///< Vector of pointers to all enabled feature objects.
         typedef typename std::vector< boost::shared_ptr< IFeature<TLabelImage> > >::const_iterator FeatureIterator; ///< Shorthand for const_iterator over vector of feature pointers.
 
-        std::vector<TLabelImage> getNeighbourLabels(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords) const;
+        /**
+         * @brief Label change of a single pixel, recorded during a color phase of the parallel relaxation.
+         */
+        struct LabelChange
+        {
+            cv::Point2i coords; ///< coordinates of the pixel
+            TLabelImage oldLabel; ///< label of the pixel before the change
+            TLabelImage newLabel; ///< label of the pixel after the change
+        };
+
+        void relaxSequential(double const& directCliqueCost, double const& diagonalCliqueCost,
+            unsigned int const& numIterations, cv::Mat& labelImage, cv::Mat& boundaryMap) const;
+
+        void relaxParallel(double const& directCliqueCost, double const& diagonalCliqueCost,
+            unsigned int const& numIterations, unsigned int const& numThreads, cv::Mat& labelImage, cv::Mat& boundaryMap) const;
+
+        bool findBestLabel(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords,
+            double const& directCliqueCost, double const& diagonalCliqueCost,
+            std::vector<TLabelImage>& neighbourLabels, TLabelImage& out_bestLabel) const;
 
-        double calculateCost(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords,
-            TLabelImage const& pretendLabel, std::vector<TLabelImage> const& neighbourLabels,
-            double const& directCliqueCost, double const& diagonalCliqueCost) const;
+        void getNeighbourLabels(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords,
+            std::vector<TLabelImage>& out_neighbourLabels) const;
 
-        double calculateCliqueCost(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords, TLabelImage const& pretendLabel,
-            double const& directCliqueCost, double const& diagonalCliqueCost) const;
+        void calculateCosts(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords,
+            std::vector<TLabelImage> const& neighbourLabels,
+            double const& directCliqueCost, double const& diagonalCliqueCost, double* out_costs) const;
+
+        void calculateCliqueCosts(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords,
+            std::vector<TLabelImage> const& neighbourLabels,
+            double const& directCliqueCost, double const& diagonalCliqueCost, double* out_costs) const;
 
         void computeBoundaryMap(cv::Mat const& labelImage, cv::Mat& out_boundaryMap) const;
 
@@ -77,7 +104,8 @@ class ContourRelaxation
         ContourRelaxation(std::vector<FeatureType> features);
 
         void relax(cv::Mat const& labelImage, double const& directCliqueCost, double const& diagonalCliqueCost,
-            unsigned int const& numIterations, cv::Mat& out_labelImage, cv::Mat& out_regionMeanImage) const;
+            unsigned int const& numIterations, cv::Mat& out_labelImage, cv::Mat& out_regionMeanImage,
+            unsigned int const& numThreads = 1) const;
 
         void setGrayvalueData(cv::Mat const& grayvalueImage);
 
@@ -157,6 +185,7 @@ ContourRelaxation<TLabelImage>::ContourRelaxation(std::vector<FeatureType> featu
  * @param numIterations number of iterations of Contour Relaxation to be performed (one iteration can include multiple passes)
  * @param out_labelImage the resulting label image after Contour Relaxation, will be (re)allocated if necessary
  * @param out_regionMeanImage the region mean image of the resulting label image (if grayvalue or color feature enabled, else an empty matrix header)
+ * @param numThreads number of threads, 1 for the sequential relaxation, more for the parallel relaxation (see relaxParallel)
  *
  * One iteration of Contour Relaxation may pass over the image multiple times, in changing directions, in order to
  * mitigate the dependency of the result on the chosen order in which pixels are processed. This dependency comes from
@@ -164,11 +193,13 @@ ContourRelaxation<TLabelImage>::ContourRelaxation(std::vector<FeatureType> featu
  */
 template <typename TLabelImage>
 void ContourRelaxation<TLabelImage>::relax(cv::Mat const& labelImage, double const& directCliqueCost, double const& diagonalCliqueCost,
-    unsigned int const& numIterations, cv::Mat& out_labelImage, cv::Mat& out_regionMeanImage) const
+    unsigned int const& numIterations, cv::Mat& out_labelImage, cv::Mat& out_regionMeanImage,
+    unsigned int const& numThreads) const
 {
     assert(labelImage.type() == cv::DataType<TLabelImage>::type);
     assert(directCliqueCost >= 0);
     assert(diagonalCliqueCost >= 0);
+    assert(numThreads >= 1);
 
     // Copy the label image to the output variable. From then on, always work on the output label image!
     // Changes to the input label image are impossible anyway since it's const, but we also need to read
@@ -185,86 +216,313 @@ void ContourRelaxation<TLabelImage>::relax(cv::Mat const& labelImage, double con
     cv::Mat boundaryMap;
     computeBoundaryMap(out_labelImage, boundaryMap);
 
-    // Create a traversion generator object, which will give us all the pixel coordinates in the current image
-    // in all traversion orders specified inside that class. We will just need to loop over the coordinates
-    // we receive by this object.
-    TraversionGenerator traversionGen;
+    if (numThreads > 1)
+    {
+        relaxParallel(directCliqueCost, diagonalCliqueCost, numIterations, numThreads, out_labelImage, boundaryMap);
+    }
+    else
+    {
+        relaxSequential(directCliqueCost, diagonalCliqueCost, numIterations, out_labelImage, boundaryMap);
+    }
+
+    // Generate an image which represents all pixels by the mean grayvalue of their label.
+    if (colorFeatureEnabled == true)
+    {
+        colorFeature->generateRegionMeanImage(out_labelImage, out_regionMeanImage);
+    }
+    else if (grayvalueFeatureEnabled == true)
+    {
+        grayvalueFeature->generateRegionMeanImage(out_labelImage, out_regionMeanImage);
+    }
+    else
+    {
+        out_regionMeanImage = cv::Mat();
+    }
+}
+
+
+/**
+ * @brief Relax the label image sequentially, one pixel at a time in the orders of the TraversionGenerator.
+ * @param directCliqueCost Markov clique cost for one clique in horizontal or vertical direction
+ * @param diagonalCliqueCost Markov clique cost for one clique in diagonal direction
+ * @param numIterations number of iterations of Contour Relaxation to be performed
+ * @param labelImage the current label image, will be relaxed in place
+ * @param boundaryMap the boundary map of the current label image, will be kept up to date
+ *
+ * The label statistics of all features are updated after each label change.
+ *
+ * Only active pixels are visited. In the first pass all boundary pixels are active; afterwards a pixel is active
+ * if it or one of its 8 neighbours changed its label in the previous pass, since only then its neighbourhood differs.
+ * Pixels whose neighbourhood is unchanged are not revisited even though the label statistics may have changed
+ * slightly in the meantime. Relaxation stops early once no pixel is active.
+ */
+template <typename TLabelImage>
+void ContourRelaxation<TLabelImage>::relaxSequential(double const& directCliqueCost, double const& diagonalCliqueCost,
+    unsigned int const& numIterations, cv::Mat& labelImage, cv::Mat& boundaryMap) const
+{
+    int const numPixels = labelImage.rows * labelImage.cols;
+    int const numPasses = 4;
+
+    // Active pixels as indices into the image in row-major order, and a map marking the pixels
+    // already queued for the next pass.
+    std::vector<int> activePixels;
+    std::vector<int> nextActivePixels;
+    std::vector<unsigned char> activeMap(numPixels, 0);
 
-    // Loop over specified number of iterations.
+    for (int row = 0; row < labelImage.rows; ++row)
+    {
+        unsigned char const* const boundaryMapRowPtr = boundaryMap.ptr<unsigned char>(row);
+
+        for (int col = 0; col < labelImage.cols; ++col)
+        {
+            if (boundaryMapRowPtr[col] != 0)
+            {
+                activePixels.push_back(row * labelImage.cols + col);
+            }
+        }
+    }
+
+    // Labels in the neighbourhood of the current pixel, reused for all pixels.
+    std::vector<TLabelImage> neighbourLabels;
+
+    // Loop over specified number of iterations, each with one pass per traversion order
+    // (left-right, right-left, top-down, bottom-up, see TraversionGenerator).
     for (unsigned int curIteration = 0; curIteration < numIterations; ++curIteration)
     {
-        // Loop over all coordinates received by the traversion generator.
-        // It is important to start with begin() here, which does not only set the correct image size,
-        // but also resets all internal counters.
-        for (cv::Point2i curPixelCoords = traversionGen.begin(labelImage.size()); curPixelCoords != traversionGen.end();
-            curPixelCoords = traversionGen.nextPixel())
+        for (int curPass = 0; curPass < numPasses; ++curPass)
         {
-            if (boundaryMap.at<unsigned char>(curPixelCoords) == 0)
+            if (activePixels.empty())
             {
-                // We are not at a boundary pixel, no further processing necessary.
-                continue;
+                // All contours have converged.
+                return;
             }
 
-            // Get all neighbouring labels. This vector also contains the label of the current pixel itself.
-            std::vector<TLabelImage> const neighbourLabels = getNeighbourLabels(out_labelImage, curPixelCoords);
+            // Bring the active pixels into the traversion order of this pass. For the column-wise
+            // orders, sort by the index in column-major order instead.
+            bool const columnWise = (curPass >= 2);
 
-            // If we have more than one label in the neighbourhood, the current pixel is a boundary pixel
-            // and optimization will be carried out. Else, the neighbourhood only contains the label of the
-            // pixel itself (since this label will definitely be there, and there is only one), so we don't
-            // have a boundary pixel.
-            if (neighbourLabels.size() > 1)
+            if (columnWise)
+            {
+                for (std::vector<int>::iterator it = activePixels.begin(); it != activePixels.end(); ++it)
+                {
+                    *it = (*it % labelImage.cols) * labelImage.rows + *it / labelImage.cols;
+                }
+            }
+
+            if (curPass % 2 == 0)
+            {
+                std::sort(activePixels.begin(), activePixels.end());
+            }
+            else
             {
-                std::vector<double> costs(neighbourLabels.size());
-                std::vector<double>::iterator it_costs = costs.begin();
+                std::sort(activePixels.begin(), activePixels.end(), std::greater<int>());
+            }
 
-                for (typename std::vector<TLabelImage>::const_iterator it_neighbourLabel = neighbourLabels.begin();
-                    it_neighbourLabel != neighbourLabels.end(); ++it_neighbourLabel, ++it_costs)
+            if (columnWise)
+            {
+                for (std::vector<int>::iterator it = activePixels.begin(); it != activePixels.end(); ++it)
                 {
-                    *it_costs = calculateCost(out_labelImage, curPixelCoords, *it_neighbourLabel,
-                                                neighbourLabels, directCliqueCost, diagonalCliqueCost);
+                    *it = (*it % labelImage.rows) * labelImage.cols + *it / labelImage.rows;
                 }
+            }
+
+            nextActivePixels.clear();
 
-                // Find the minimum cost.
-                std::vector<double>::iterator const it_minCost = std::min_element(costs.begin(), costs.end());
+            for (std::vector<int>::const_iterator it_pixel = activePixels.begin(); it_pixel != activePixels.end(); ++it_pixel)
+            {
+                activeMap[*it_pixel] = 0;
+            }
+
+            for (std::vector<int>::const_iterator it_pixel = activePixels.begin(); it_pixel != activePixels.end(); ++it_pixel)
+            {
+                cv::Point2i const curPixelCoords(*it_pixel % labelImage.cols, *it_pixel / labelImage.cols);
 
-                // Get the index of the minimum cost in the costs vector, which is also the index of the associated label in the neighbourhood.
-                std::vector<double>::size_type const minCostIndex = std::distance(costs.begin(), it_minCost);
+                if (boundaryMap.at<unsigned char>(curPixelCoords) == 0)
+                {
+                    // We are not at a boundary pixel, no further processing necessary.
+                    continue;
+                }
 
-                // Get the label associated with the minimum cost.
-                TLabelImage bestLabel = neighbourLabels[minCostIndex];
+                TLabelImage bestLabel;
 
                 // If we have found a better label for the pixel, update the statistics for all features
                 // and change the label of the pixel.
-                if (bestLabel != out_labelImage.at<TLabelImage>(curPixelCoords))
+                if (findBestLabel(labelImage, curPixelCoords, directCliqueCost, diagonalCliqueCost, neighbourLabels, bestLabel))
                 {
                     for (FeatureIterator it_curFeature = allFeatures.begin(); it_curFeature != allFeatures.end(); ++it_curFeature)
                     {
-                        (*it_curFeature)->updateStatistics(curPixelCoords, out_labelImage.at<TLabelImage>(curPixelCoords),
+                        (*it_curFeature)->updateStatistics(curPixelCoords, labelImage.at<TLabelImage>(curPixelCoords),
                             bestLabel);
                     }
 
-                    out_labelImage.at<TLabelImage>(curPixelCoords) = bestLabel;
+                    labelImage.at<TLabelImage>(curPixelCoords) = bestLabel;
 
                     // We also need to update the boundary map around the current pixel.
-                    updateBoundaryMap(out_labelImage, curPixelCoords, boundaryMap);
+                    updateBoundaryMap(labelImage, curPixelCoords, boundaryMap);
+
+                    // The neighbourhood of the pixel and its neighbours changed, visit them again in the next pass.
+                    for (int row = std::max(curPixelCoords.y - 1, 0); row <= std::min(curPixelCoords.y + 1, labelImage.rows - 1); ++row)
+                    {
+                        for (int col = std::max(curPixelCoords.x - 1, 0); col <= std::min(curPixelCoords.x + 1, labelImage.cols - 1); ++col)
+                        {
+                            int const index = row * labelImage.cols + col;
+
+                            if (activeMap[index] == 0)
+                            {
+                                activeMap[index] = 1;
+                                nextActivePixels.push_back(index);
+                            }
+                        }
+                    }
                 }
             }
+
+            activePixels.swap(nextActivePixels);
         }
     }
+}
 
-    // Generate an image which represents all pixels by the mean grayvalue of their label.
-    if (colorFeatureEnabled == true)
-    {
-        colorFeature->generateRegionMeanImage(out_labelImage, out_regionMeanImage);
-    }
-    else if (grayvalueFeatureEnabled == true)
+
+/**
+ * @brief Relax the label image in parallel, processing the pixels in four color phases per pass.
+ * @param directCliqueCost Markov clique cost for one clique in horizontal or vertical direction
+ * @param diagonalCliqueCost Markov clique cost for one clique in diagonal direction
+ * @param numIterations number of iterations of Contour Relaxation to be performed
+ * @param numThreads number of threads to use
+ * @param labelImage the current label image, will be relaxed in place
+ * @param boundaryMap the boundary map of the current label image, will be kept up to date
+ *
+ * The pixels are colored by the parity of their row and column. Pixels of one color do not share a clique
+ * or an 8-neighbourhood, so all pixels of a color can be relaxed concurrently. During a color phase the
+ * label statistics stay fixed; each thread records its label changes, and the changes are applied to the
+ * statistics and the boundary map at the end of the phase, in row-major order. The result therefore does not
+ * depend on the number of threads, but differs from the sequential relaxation. Each iteration performs as many
+ * passes as the TraversionGenerator has traversion orders, alternating the order of the colors.
+ */
+template <typename TLabelImage>
+void ContourRelaxation<TLabelImage>::relaxParallel(double const& directCliqueCost, double const& diagonalCliqueCost,
+    unsigned int const& numIterations, unsigned int const& numThreads, cv::Mat& labelImage, cv::Mat& boundaryMap) const
+{
+    int const numPasses = 4;
+    int const numColors = 4;
+
+    // Label changes of the current color phase, per thread.
+    std::vector< std::vector<LabelChange> > threadChanges(numThreads);
+
+    for (unsigned int curIteration = 0; curIteration < numIterations; ++curIteration)
     {
-        grayvalueFeature->generateRegionMeanImage(out_labelImage, out_regionMeanImage);
+        for (int curPass = 0; curPass < numPasses; ++curPass)
+        {
+            for (int curPhase = 0; curPhase < numColors; ++curPhase)
+            {
+                int const curColor = (curPass % 2 == 0) ? curPhase : numColors - 1 - curPhase;
+                int const rowParity = curColor / 2;
+                int const colParity = curColor % 2;
+
+#pragma omp parallel num_threads(numThreads)
+                {
+#ifdef _OPENMP
+                    std::vector<LabelChange>& changes = threadChanges[omp_get_thread_num()];
+#else
+                    std::vector<LabelChange>& changes = threadChanges[0];
+#endif
+                    changes.clear();
+
+                    // Labels in the neighbourhood of the current pixel, reused for all pixels of this thread.
+                    std::vector<TLabelImage> neighbourLabels;
+
+                    // Static scheduling assigns consecutive rows to consecutive threads, so the changes
+                    // of all threads concatenated in thread order are in row-major order.
+#pragma omp for schedule(static)
+                    for (int row = rowParity; row < labelImage.rows; row += 2)
+                    {
+                        for (int col = colParity; col < labelImage.cols; col += 2)
+                        {
+                            cv::Point2i const curPixelCoords(col, row);
+
+                            if (boundaryMap.at<unsigned char>(curPixelCoords) == 0)
+                            {
+                                continue;
+                            }
+
+                            LabelChange change;
+
+                            if (findBestLabel(labelImage, curPixelCoords, directCliqueCost, diagonalCliqueCost,
+                                neighbourLabels, change.newLabel))
+                            {
+                                // No other pixel of this color reads this label, so it can be changed right away.
+                                change.coords = curPixelCoords;
+                                change.oldLabel = labelImage.at<TLabelImage>(curPixelCoords);
+                                labelImage.at<TLabelImage>(curPixelCoords) = change.newLabel;
+
+                                changes.push_back(change);
+                            }
+                        }
+                    }
+                }
+
+                // Merge the changes of all threads into the statistics and the boundary map.
+                for (unsigned int t = 0; t < numThreads; ++t)
+                {
+                    for (typename std::vector<LabelChange>::const_iterator it_change = threadChanges[t].begin();
+                        it_change != threadChanges[t].end(); ++it_change)
+                    {
+                        for (FeatureIterator it_curFeature = allFeatures.begin(); it_curFeature != allFeatures.end(); ++it_curFeature)
+                        {
+                            (*it_curFeature)->updateStatistics(it_change->coords, it_change->oldLabel, it_change->newLabel);
+                        }
+
+                        updateBoundaryMap(labelImage, it_change->coords, boundaryMap);
+                    }
+                }
+            }
+        }
     }
-    else
+}
+
+
+/**
+ * @brief Find the label with minimum cost for a pixel among the labels in its 8-neighbourhood.
+ * @param labelImage the current label image, contains one label identifier per pixel
+ * @param curPixelCoords coordinates of the regarded pixel
+ * @param directCliqueCost Markov clique cost for one clique in horizontal or vertical direction
+ * @param diagonalCliqueCost Markov clique cost for one clique in diagonal direction
+ * @param neighbourLabels buffer for the labels in the neighbourhood, reused between calls
+ * @param out_bestLabel will contain the label with minimum cost, if it differs from the current label
+ * @return true if the label with minimum cost differs from the current label of the pixel
+ */
+template <typename TLabelImage>
+bool ContourRelaxation<TLabelImage>::findBestLabel(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords,
+    double const& directCliqueCost, double const& diagonalCliqueCost,
+    std::vector<TLabelImage>& neighbourLabels, TLabelImage& out_bestLabel) const
+{
+    // Get all neighbouring labels. This vector also contains the label of the current pixel itself.
+    getNeighbourLabels(labelImage, curPixelCoords, neighbourLabels);
+
+    // If we have more than one label in the neighbourhood, the current pixel is a boundary pixel
+    // and optimization will be carried out. Else, the neighbourhood only contains the label of the
+    // pixel itself (since this label will definitely be there, and there is only one), so we don't
+    // have a boundary pixel.
+    if (neighbourLabels.size() <= 1)
     {
-        out_regionMeanImage = cv::Mat();
+        return false;
     }
+
+    // Total costs for each label in the neighbourhood as assumed new label (at most 9 labels).
+    double costs[9];
+
+    calculateCosts(labelImage, curPixelCoords, neighbourLabels, directCliqueCost, diagonalCliqueCost, costs);
+
+    // Find the minimum cost.
+    double const* const it_minCost = std::min_element(costs, costs + neighbourLabels.size());
+
+    // Get the index of the minimum cost in the costs array, which is also the index of the associated label in the neighbourhood.
+    std::ptrdiff_t const minCostIndex = it_minCost - costs;
+
+    // Get the label associated with the minimum cost.
+    out_bestLabel = neighbourLabels[minCostIndex];
+
+    return out_bestLabel != labelImage.at<TLabelImage>(curPixelCoords);
 }
 
 
@@ -272,11 +530,11 @@ void ContourRelaxation<TLabelImage>::relax(cv::Mat const& labelImage, double con
  * @brief Get all labels in the 8-neighbourhood of a pixel, including the label of the center pixel itself.
  * @param labelImage the current label image, contains one label identifier per pixel
  * @param curPixelCoords the coordinates of the regarded pixel
- * @return a vector containing all labels in the neighbourhood, each only once, sorted in ascending order
+ * @param out_neighbourLabels will contain all labels in the neighbourhood, each only once, sorted in ascending order
  */
 template <typename TLabelImage>
-std::vector<TLabelImage> ContourRelaxation<TLabelImage>::getNeighbourLabels(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords)
-    const
+void ContourRelaxation<TLabelImage>::getNeighbourLabels(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords,
+    std::vector<TLabelImage>& out_neighbourLabels) const
 {
     assert(labelImage.type() == cv::DataType<TLabelImage>::type);
     assert(curPixelCoords.inside(cv::Rect(0, 0, labelImage.cols, labelImage.rows)));
@@ -290,10 +548,10 @@ std::vector<TLabelImage> ContourRelaxation<TLabelImage>::getNeighbourLabels(cv::
     // Get a new matrix header to the relevant neighbourhood in the label image.
     cv::Mat const neighbourhoodLabelImage = labelImage(croppedNeighbourhoodRect);
 
-    // Push all labels in the neighbourhood into a vector.
-    // Reserve enough space for the maximum of 9 labels in the neighbourhood.
-    // Making this one big allocation is extremely faster than making multiple small allocations when pushing elements.
-    std::vector<TLabelImage> neighbourLabels;
+    // Push all labels in the neighbourhood into the vector.
+    // The vector is reused between pixels, so its capacity for the maximum of 9 labels is only allocated once.
+    std::vector<TLabelImage>& neighbourLabels = out_neighbourLabels;
+    neighbourLabels.clear();
     neighbourLabels.reserve(9);
 
     for (int row = 0; row < neighbourhoodLabelImage.rows; ++row)
@@ -311,132 +569,120 @@ std::vector<TLabelImage> ContourRelaxation<TLabelImage>::getNeighbourLabels(cv::
     std::sort(neighbourLabels.begin(), neighbourLabels.end());
     typename std::vector<TLabelImage>::iterator newVecEnd = std::unique(neighbourLabels.begin(), neighbourLabels.end());
     neighbourLabels.resize(newVecEnd - neighbourLabels.begin());
-
-    return neighbourLabels;
 }
 
 
 /**
- * @brief Calculate the total cost of all labels in the 8-neighbourhood of a pixel, assuming the pixel would change its label.
+ * @brief Calculate the total cost of all labels in the 8-neighbourhood of a pixel, for each neighbouring label as assumed new label.
  * @param labelImage the current label image, contains one label identifier per pixel
  * @param curPixelCoords coordinates of the regarded pixel
- * @param pretendLabel assumed new label of the regarded pixel
  * @param neighbourLabels all labels in the neighbourhood of the regarded pixel, including the label of the pixel itself
  * @param directCliqueCost Markov clique cost for one clique in horizontal or vertical direction
  * @param diagonalCliqueCost Markov clique cost for one clique in diagonal direction
- * @return the total cost, summed over all labels in the neighbourhood and all enabled features, plus the Markov clique costs
+ * @param out_costs will contain, for each label in neighbourLabels as assumed new label, the total cost summed over
+ * all labels in the neighbourhood and all enabled features, plus the Markov clique costs
  */
 template <typename TLabelImage>
-double ContourRelaxation<TLabelImage>::calculateCost(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords,
-    TLabelImage const& pretendLabel, std::vector<TLabelImage> const& neighbourLabels,
-    double const& directCliqueCost, double const& diagonalCliqueCost) const
+void ContourRelaxation<TLabelImage>::calculateCosts(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords,
+    std::vector<TLabelImage> const& neighbourLabels,
+    double const& directCliqueCost, double const& diagonalCliqueCost, double* out_costs) const
 {
     assert(labelImage.type() == cv::DataType<TLabelImage>::type);
     assert(curPixelCoords.inside(cv::Rect(0, 0, labelImage.cols, labelImage.rows)));
+    assert(neighbourLabels.size() <= 9);
+
+    int const numLabels = neighbourLabels.size();
 
-    // Calculate clique cost.
-    double cost = calculateCliqueCost(labelImage, curPixelCoords, pretendLabel, directCliqueCost, diagonalCliqueCost);
+    // Calculate clique costs.
+    calculateCliqueCosts(labelImage, curPixelCoords, neighbourLabels, directCliqueCost, diagonalCliqueCost, out_costs);
 
-    // Calculate and add up the costs of all features.
+    // Calculate and add up the costs of all features, for all labels at once.
     TLabelImage const oldLabel = labelImage.at<TLabelImage>(curPixelCoords);
+    double featureCosts[9];
 
     for (FeatureIterator it_curFeature = allFeatures.begin(); it_curFeature != allFeatures.end(); ++it_curFeature)
     {
-        cost += (*it_curFeature)->calculateCost(curPixelCoords, oldLabel, pretendLabel, neighbourLabels);
-    }
+        (*it_curFeature)->calculateCosts(curPixelCoords, oldLabel, neighbourLabels, featureCosts);
 
-    return cost;
+        for (int i = 0; i < numLabels; ++i)
+        {
+            out_costs[i] += featureCosts[i];
+        }
+    }
 }
 
 
 /**
- * @brief Calculate the Markov clique cost of a pixel, assuming it would change its label.
+ * @brief Calculate the Markov clique costs of a pixel, for each neighbouring label as assumed new label.
  * @param labelImage the current label image, contains one label identifier per pixel
  * @param curPixelCoords coordinates of the regarded pixel
- * @param pretendLabel assumed new label of the regarded pixel
+ * @param neighbourLabels all labels in the neighbourhood of the regarded pixel, including the label of the pixel itself
  * @param directCliqueCost Markov clique cost for one clique in horizontal or vertical direction
  * @param diagonalCliqueCost Markov clique cost for one clique in diagonal direction
- * @return the total Markov clique cost for the given label at the given pixel coordinates
+ * @param out_costs will contain the total Markov clique cost for each label in neighbourLabels as assumed new label
  */
 template <typename TLabelImage>
-double ContourRelaxation<TLabelImage>::calculateCliqueCost(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords,
-    TLabelImage const& pretendLabel, double const& directCliqueCost, double const& diagonalCliqueCost) const
+void ContourRelaxation<TLabelImage>::calculateCliqueCosts(cv::Mat const& labelImage, cv::Point2i const& curPixelCoords,
+    std::vector<TLabelImage> const& neighbourLabels,
+    double const& directCliqueCost, double const& diagonalCliqueCost, double* out_costs) const
 {
     assert(labelImage.type() == cv::DataType<TLabelImage>::type);
     assert(curPixelCoords.inside(cv::Rect(0, 0, labelImage.cols, labelImage.rows)));
 
     // Find number of (direct / diagonal) cliques around pixelIndex, pretending the pixel at
-    // curPixelCoords belongs to pretendLabel. Then calculate and return the associated combined cost.
+    // curPixelCoords belongs to each of the neighbouring labels. Then calculate the associated combined costs.
 
-    // Create a rectangle spanning the image area. This will be used to check if points are inside the image area.
-    cv::Rect boundaryRect(0, 0, labelImage.cols, labelImage.rows);
+    // Differences in coordinates of all direct and diagonal cliques in reference to the central pixel.
+    static int const directCoordDiffs[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+    static int const diagonalCoordDiffs[4][2] = { {-1, -1}, {-1, 1}, {1, -1}, {1, 1} };
 
-    // Direct cliques.
+    // Read the labels of the direct and diagonal neighbours inside the image area once.
+    TLabelImage directLabels[4];
+    TLabelImage diagonalLabels[4];
+    int numDirectNeighbours = 0;
+    int numDiagonalNeighbours = 0;
 
-    // Store the differences in coordinates of all direct cliques in reference to the central pixel.
-    // Fill this static vector on the first function call, the elements will never change.
-    static std::vector<cv::Point2i> directCoordDiffs;
-
-    if (directCoordDiffs.size() == 0)
+    for (int k = 0; k < 4; ++k)
     {
-        directCoordDiffs.push_back(cv::Point2i(-1, 0));
-        directCoordDiffs.push_back(cv::Point2i(1, 0));
-        directCoordDiffs.push_back(cv::Point2i(0, -1));
-        directCoordDiffs.push_back(cv::Point2i(0, 1));
-    }
+        int const col = curPixelCoords.x + directCoordDiffs[k][0];
+        int const row = curPixelCoords.y + directCoordDiffs[k][1];
 
-    int numDirectCliques = 0;
+        if (col >= 0 && col < labelImage.cols && row >= 0 && row < labelImage.rows)
+        {
+            directLabels[numDirectNeighbours++] = labelImage.at<TLabelImage>(row, col);
+        }
+    }
 
-    // Loop over all direct clique coordinate differences.
-    // Translate the central pixel by the current difference.
-    // If the resulting coordinates are inside the image area, and the label there differs from the pretended label of the
-    // central pixel, increase the number of direct cliques.
-    for (std::vector<cv::Point2i>::const_iterator it_coordDiff = directCoordDiffs.begin(); it_coordDiff != directCoordDiffs.end(); ++it_coordDiff)
+    for (int k = 0; k < 4; ++k)
     {
-        cv::Point2i comparisonCoords = curPixelCoords + *it_coordDiff;
+        int const col = curPixelCoords.x + diagonalCoordDiffs[k][0];
+        int const row = curPixelCoords.y + diagonalCoordDiffs[k][1];
 
-        if (comparisonCoords.inside(boundaryRect) &&
-            labelImage.at<TLabelImage>(comparisonCoords) != pretendLabel)
+        if (col >= 0 && col < labelImage.cols && row >= 0 && row < labelImage.rows)
         {
-            ++numDirectCliques;
+            diagonalLabels[numDiagonalNeighbours++] = labelImage.at<TLabelImage>(row, col);
         }
     }
 
-
-    // Diagonal cliques.
-
-    // Store the differences in coordinates of all diagonal cliques in reference to the central pixel.
-    // Fill this static vector on the first function call, the elements will never change.
-    static std::vector<cv::Point2i> diagonalCoordDiffs;
-
-    if (diagonalCoordDiffs.size() == 0)
+    // For each pretended label, count the neighbours with a different label (one clique each).
+    for (typename std::vector<TLabelImage>::size_type i = 0; i < neighbourLabels.size(); ++i)
     {
-        diagonalCoordDiffs.push_back(cv::Point2i(-1, -1));
-        diagonalCoordDiffs.push_back(cv::Point2i(-1, 1));
-        diagonalCoordDiffs.push_back(cv::Point2i(1, -1));
-        diagonalCoordDiffs.push_back(cv::Point2i(1, 1));
-    }
+        int numDirectCliques = 0;
+        int numDiagonalCliques = 0;
 
-    int numDiagonalCliques = 0;
-
-    // Loop over all diagonal clique coordinate differences.
-    // Translate the central pixel by the current difference.
-    // If the resulting coordinates are inside the image area, and the label there differs from the pretended label of the
-    // central pixel, increase the number of diagonal cliques.
-    for (std::vector<cv::Point2i>::const_iterator it_coordDiff = diagonalCoordDiffs.begin(); it_coordDiff != diagonalCoordDiffs.end(); ++it_coordDiff)
-    {
-        cv::Point2i comparisonCoords = curPixelCoords + *it_coordDiff;
+        for (int k = 0; k < numDirectNeighbours; ++k)
+        {
+            numDirectCliques += (directLabels[k] != neighbourLabels[i]);
+        }
 
-        if (comparisonCoords.inside(boundaryRect) &&
-            labelImage.at<TLabelImage>(comparisonCoords) != pretendLabel)
+        for (int k = 0; k < numDiagonalNeighbours; ++k)
         {
-            ++numDiagonalCliques;
+            numDiagonalCliques += (diagonalLabels[k] != neighbourLabels[i]);
         }
-    }
 
-    // Calculate and return the combined clique cost.
-    double cost = numDirectCliques * directCliqueCost + numDiagonalCliques * diagonalCliqueCost;
-    return cost;
+        // Calculate the combined clique cost.
+        out_costs[i] = numDirectCliques * directCliqueCost + numDiagonalCliques * diagonalCliqueCost;
+    }
 }
 
 
@@ -29,6 +29,7 @@ class DepthFeature : public AGaussianFeature<TLabelImage>
 
         double featureWeight;
         std::vector<LabelStatisticsGauss> labelStatistics; ///< Gaussian label statistics of the first channel
+        std::vector<double> labelCosts; ///< costs of all labels, kept up to date with labelStatistics
         cv::Mat depth; ///< observed data of the first channel
 
     public:
@@ -40,6 +41,9 @@ class DepthFeature : public AGaussianFeature<TLabelImage>
         double calculateCost(cv::Point2i const& curPixelCoords,
             TLabelImage const& oldLabel, TLabelImage const& pretendLabel, std::vector<TLabelImage> const& neighbourLabels) const;
 
+        void calculateCosts(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel,
+            std::vector<TLabelImage> const& neighbourLabels, double* out_costs) const;
+
         void updateStatistics(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel, TLabelImage const& newLabel);
 
         void generateRegionMeanImage(cv::Mat const& labelImage, cv::Mat& out_regionMeanImage) const;
@@ -71,6 +75,7 @@ void DepthFeature<TLabelImage>::initializeStatistics(cv::Mat const& labelImage)
 {
     // Use the provided initialization method for gaussian statistics from AGaussianFeature.
     this->template initializeGaussianStatistics<TDepthData>(labelImage, depth, labelStatistics);
+    this->initializeGaussianLabelCosts(labelStatistics, labelCosts);
 }
 
 
@@ -94,6 +99,28 @@ double DepthFeature<TLabelImage>::calculateCost(cv::Point2i const& curPixelCoord
 }
 
 
+/**
+ * @brief Calculate the costs of calculateCost for all labels in the 8-neighbourhood as assumed new label at once.
+ * @param curPixelCoords coordinates of the regarded pixel
+ * @param oldLabel old label of the regarded pixel
+ * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
+ * @param out_costs will contain the cost for each label in neighbourLabels as assumed new label
+ */
+template <typename TLabelImage>
+void DepthFeature<TLabelImage>::calculateCosts(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel,
+    std::vector<TLabelImage> const& neighbourLabels, double* out_costs) const
+{
+    // Use the provided cost calculation method for gaussian statistics from AGaussianFeature.
+    this->template calculateGaussianCosts<TDepthData>(curPixelCoords, oldLabel, neighbourLabels,
+        this->labelStatistics, this->labelCosts, this->depth, out_costs);
+
+    for (typename std::vector<TLabelImage>::size_type i = 0; i < neighbourLabels.size(); ++i)
+    {
+        out_costs[i] = featureWeight * out_costs[i];
+    }
+}
+
+
 /**
  * @brief Update the saved label statistics to reflect a label change of the given pixel.
  * @param curPixelCoords coordinates of the pixel whose label changes
@@ -106,6 +133,9 @@ void DepthFeature<TLabelImage>::updateStatistics(cv::Point2i const& curPixelCoor
 {
     this->template updateGaussianStatistics<TDepthData>(curPixelCoords, this->labelStatistics[oldLabel],
         this->labelStatistics[newLabel], this->depth);
+
+    this->labelCosts[oldLabel] = this->calculateGaussianLabelCost(this->labelStatistics[oldLabel]);
+    this->labelCosts[newLabel] = this->calculateGaussianLabelCost(this->labelStatistics[newLabel]);
 }
 
 
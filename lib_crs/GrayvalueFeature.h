@@ -39,6 +39,7 @@ class GrayvalueFeature : public AGaussianFeature<TLabelImage>
         typedef uchar TGrayvalueData; ///< the type of the used grayvalue images
 
         std::vector<LabelStatisticsGauss> labelStatistics; ///< Gaussian label statistics of the grayvalue image
+        std::vector<double> labelCosts; ///< costs of all labels, kept up to date with labelStatistics
         cv::Mat grayvalImage; ///< the observed grayvalue data
 
 
@@ -51,6 +52,9 @@ class GrayvalueFeature : public AGaussianFeature<TLabelImage>
         double calculateCost(cv::Point2i const& curPixelCoords,
             TLabelImage const& oldLabel, TLabelImage const& pretendLabel, std::vector<TLabelImage> const& neighbourLabels) const;
 
+        void calculateCosts(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel,
+            std::vector<TLabelImage> const& neighbourLabels, double* out_costs) const;
+
         void updateStatistics(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel, TLabelImage const& newLabel);
 
         void generateRegionMeanImage(cv::Mat const& labelImage, cv::Mat& out_regionMeanImage) const;
@@ -79,6 +83,7 @@ void GrayvalueFeature<TLabelImage>::initializeStatistics(cv::Mat const& labelIma
 {
     // Use the provided initialization method for gaussian statistics from AGaussianFeature.
     this->template initializeGaussianStatistics<TGrayvalueData>(labelImage, grayvalImage, labelStatistics);
+    this->initializeGaussianLabelCosts(labelStatistics, labelCosts);
 }
 
 
@@ -100,6 +105,23 @@ double GrayvalueFeature<TLabelImage>::calculateCost(cv::Point2i const& curPixelC
 }
 
 
+/**
+ * @brief Calculate the costs of calculateCost for all labels in the 8-neighbourhood as assumed new label at once.
+ * @param curPixelCoords coordinates of the regarded pixel
+ * @param oldLabel old label of the regarded pixel
+ * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
+ * @param out_costs will contain the cost for each label in neighbourLabels as assumed new label
+ */
+template <typename TLabelImage>
+void GrayvalueFeature<TLabelImage>::calculateCosts(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel,
+    std::vector<TLabelImage> const& neighbourLabels, double* out_costs) const
+{
+    // Use the provided cost calculation method for gaussian statistics from AGaussianFeature.
+    this->template calculateGaussianCosts<TGrayvalueData>(curPixelCoords, oldLabel, neighbourLabels,
+        labelStatistics, labelCosts, grayvalImage, out_costs);
+}
+
+
 /**
  * @brief Update the saved label statistics to reflect a label change of the given pixel.
  * @param curPixelCoords coordinates of the pixel whose label changes
@@ -113,6 +135,9 @@ void GrayvalueFeature<TLabelImage>::updateStatistics(cv::Point2i const& curPixel
     // Use the provided update method for gaussian statistics from AGaussianFeature.
     this->template updateGaussianStatistics<TGrayvalueData>(curPixelCoords, labelStatistics[oldLabel],
         labelStatistics[newLabel], grayvalImage);
+
+    labelCosts[oldLabel] = this->calculateGaussianLabelCost(labelStatistics[oldLabel]);
+    labelCosts[newLabel] = this->calculateGaussianLabelCost(labelStatistics[newLabel]);
 }
 
 
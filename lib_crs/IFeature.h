@@ -19,6 +19,7 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <vector>
 
 
 /**
@@ -53,6 +54,23 @@ class IFeature
                                      TLabelImage const& oldLabel, TLabelImage const& pretendLabel,
                                      std::vector<TLabelImage> const& neighbourLabels) const = 0;
 
+        /**
+         * @brief Calculate the costs of calculateCost for all labels in the 8-neighbourhood as assumed new label at once.
+         * Features should override this to share the work between the candidate labels.
+         * @param curPixelCoords coordinates of the regarded pixel
+         * @param oldLabel old label of the regarded pixel
+         * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
+         * @param out_costs will contain the cost for each label in neighbourLabels as assumed new label, needs space for neighbourLabels.size() costs
+         */
+        virtual void calculateCosts(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel,
+                                    std::vector<TLabelImage> const& neighbourLabels, double* out_costs) const
+        {
+            for (typename std::vector<TLabelImage>::size_type i = 0; i < neighbourLabels.size(); ++i)
+            {
+                out_costs[i] = calculateCost(curPixelCoords, oldLabel, neighbourLabels[i], neighbourLabels);
+            }
+        }
+
         /**
          * @brief Update the saved label statistics to reflect a label change of the given pixel.
          * @param curPixelCoords coordinates of the pixel whose label changes
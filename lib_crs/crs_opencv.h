@@ -51,10 +51,11 @@ public:
      * \param[in] iterations number of iterations
      * \param[in] color_space color space to use, 0 for YCrCb, 1 for RGB
      * \param[in] labels superpixel labels
+     * \param[in] threads number of threads, more than one for the parallel relaxation
      */
     static void computeSuperpixels(const cv::Mat &image, int region_height, 
             int region_width, double clique_cost, double compactness, 
-            int iterations, int color_space, cv::Mat &labels) {
+            int iterations, int color_space, cv::Mat &labels, int threads = 1) {
         
         double diagonal_cost = clique_cost/std::sqrt(2);
         
@@ -108,7 +109,7 @@ public:
         cv::Mat mean_image;
         
         contour_relaxation.relax(label_image, clique_cost, diagonal_cost, 
-                iterations, relaxed_label_image, mean_image);
+                iterations, relaxed_label_image, mean_image, threads);
         
         labels.create(image.rows, image.cols, CV_32SC1);
         for (int i = 0; i < image.rows; i++) {
@@ -68,6 +68,10 @@
 
 #include "compact_watershed.h"
 #include <cxmisc.h>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 /****************************************************************************************\
 *                                Compact Watershed                                      *
@@ -82,50 +86,32 @@ namespace cws
 {
   typedef struct CvWSNode
   {
-      struct CvWSNode* next;
       int mask_ofs;
       int img_ofs;
       float compVal;
   }
   CvWSNode;
 
+  // Bucket of the priority queue: a FIFO array of nodes, reset when emptied
+  // so its memory is re-used by the following pushes.
   typedef struct CvWSQueue
   {
-      CvWSNode* first;
-      CvWSNode* last;
+      std::vector<CvWSNode> nodes;
+      size_t first;
   }
   CvWSQueue;
 
-  static CvWSNode* icvAllocWSNodes( CvMemStorage* storage )
-  {
-      CvWSNode* n = 0;
-      
-      int i, count = (storage->block_size - sizeof(CvMemBlock))/sizeof(*n) - 1;
-
-      n = (CvWSNode*)cvMemStorageAlloc( storage, count*sizeof(*n) );
-      for( i = 0; i < count-1; i++ )
-          n[i].next = n + i + 1;
-      n[count-1].next = 0;
-
-      return n;
-  }
-
 
   void  cvWatershed( const CvArr* srcarr, CvArr* dstarr, float compValStep)
   {
-      if(compValStep>5)
-          printf("cws::cvWatershed Warning: Large compValStep values can cause seg faults");
-      
       const int IN_QUEUE = -2;
       const int WSHED = -1;
       const int NQ = 1024;
-      cv::Ptr<CvMemStorage> storage;
       
       CvMat sstub, *src;
       CvMat dstub, *dst;
       CvSize size;
-      CvWSNode* free_node = 0, *node;
-      CvWSQueue q[NQ];
+      std::vector<CvWSQueue> q(NQ);
       int active_queue;
       int i, j;
       int db, dg, dr;
@@ -139,34 +125,29 @@ namespace cws
       // MIN(a,b) = a - MAX(a-b,0)
       #define ws_min(a,b) ((a) - subs_tab[(a)-(b)+NQ])
 
+      // priorities above NQ-1 are queued in the last bucket
       #define ws_push(idx,mofs,iofs,cV)  \
       {                               \
-          if( !free_node )            \
-              free_node = icvAllocWSNodes( storage );\
-          node = free_node;           \
-          free_node = free_node->next;\
-          node->next = 0;             \
-          node->mask_ofs = mofs;      \
-          node->img_ofs = iofs;       \
-          node->compVal = cV;    \
-          if( q[idx].last )           \
-              q[idx].last->next=node; \
-          else                        \
-              q[idx].first = node;    \
-          q[idx].last = node;         \
+          CvWSNode n;                 \
+          n.mask_ofs = mofs;          \
+          n.img_ofs = iofs;           \
+          n.compVal = cV;             \
+          q[std::min(idx, NQ-1)].nodes.push_back(n); \
       }
 
+      #define ws_empty(idx) ( q[idx].first == q[idx].nodes.size() )
+
       #define ws_pop(idx,mofs,iofs,cV)   \
       {                               \
-          node = q[idx].first;        \
-          q[idx].first = node->next;  \
-          if( !node->next )           \
-              q[idx].last = 0;        \
-          node->next = free_node;     \
-          free_node = node;           \
-          mofs = node->mask_ofs;      \
-          iofs = node->img_ofs;       \
-          cV = node->compVal;       \
+          const CvWSNode& n = q[idx].nodes[q[idx].first++]; \
+          mofs = n.mask_ofs;          \
+          iofs = n.img_ofs;           \
+          cV = n.compVal;             \
+          if( ws_empty(idx) )         \
+          {                           \
+              q[idx].nodes.clear();   \
+              q[idx].first = 0;       \
+          }                           \
       }
 
       #define c_diff(ptr1,ptr2,diff)      \
@@ -193,14 +174,14 @@ namespace cws
           CV_Error( CV_StsUnmatchedSizes, "The input and output images must have the same size" );
 
       size = cvGetMatSize(src);
-      storage = cvCreateMemStorage();
 
       istep = src->step;
       img = src->data.ptr;
       mstep = dst->step / sizeof(mask[0]);
       mask = dst->data.i;
 
-      memset( q, 0, NQ*sizeof(q[0]) );
+      for( i = 0; i < NQ; i++ )
+          q[i].first = 0;
 
       for( i = 0; i < NQ; i++ )
           subs_tab[i] = 0;
@@ -244,7 +225,7 @@ namespace cws
                       idx = ws_min( idx, t );
                   }
                   assert( 0 <= idx && idx <= NQ-1 );
-                  ws_push( idx, i*mstep + j, i*istep + j*3, 0.0);
+                  ws_push( idx, i*mstep + j, i*istep + j*3, 0.0f );
                   m[0] = IN_QUEUE;
               }
           }
@@ -252,7 +233,7 @@ namespace cws
 
       // find the first non-empty queue
       for( i = 0; i < NQ; i++ )
-          if( q[i].first )
+          if( !ws_empty(i) )
               break;
 
       // if there is no markers, exit immediately
@@ -272,10 +253,10 @@ namespace cws
           uchar* ptr;
           
           // search for next queue
-          if( q[active_queue].first == 0 )
+          if( ws_empty(active_queue) )
           {
               for( i = active_queue+1; i < NQ; i++ )
-                  if( q[i].first )
+                  if( !ws_empty(i) )
                       break;
               if( i == NQ )
                   break;
@@ -361,18 +342,12 @@ namespace cws
   }
 } // namespace cws
 
-void compact_watershed(Mat& img, Mat& B, float n, float compValStep, Mat& seeds)
+// place grid markers (every dy rows and dx cols) or the given seeds, labels start at 1
+static void initialize_markers(Mat& img, float dy, float dx, Mat& seeds, Mat& markers)
 {
-  Mat markers = Mat::zeros(img.rows, img.cols, CV_32SC1);
+  markers = Mat::zeros(img.rows, img.cols, CV_32SC1);
   if( seeds.empty() )
-  {
-    // distribute initial markers
-    float ny = sqrt( (n*img.rows) / img.cols);
-    float nx = n/ny;
-
-    float dx = img.cols / nx;
-    float dy = img.rows / ny;
-    
+  {    
     int labelIdx=1;
     for(float i=dy/2; i<markers.rows; i+=dy)
     {
@@ -394,69 +369,126 @@ void compact_watershed(Mat& img, Mat& B, float n, float compValStep, Mat& seeds)
       labelIdx++;      
     }
   }
+}
+
+// flood the markers like cws::compact_watershed, but block-wise using the given
+// number of threads: the image is partitioned into blocks of seed cells and each
+// block is flooded independently together with a halo of one cell (the basins
+// are bounded by the compactness term). Pixels of the inner halo on which
+// neighboring blocks disagree are flooded again in a final sequential pass.
+static void compact_watershed_blocks(Mat& img, Mat& markers, float dy, float dx, float compValStep, int threads)
+{
+  const int halo = (int) ceil(std::max(dy, dx));
+  const int margin = std::max(1, halo/2);
   
-  // run compact watershed
-  cws::compact_watershed( img, markers, compValStep);
-  
-  // create boundary map
-  B = markers<0;
+  // about one block per thread, each at least two cells wide
+  float cells = std::sqrt((img.rows/dy)*(img.cols/dx)/threads);
+  cells = std::max(2.f, cells);
+  const int bh = std::max(1, (int) round(cells*dy));
+  const int bw = std::max(1, (int) round(cells*dx));
   
-  // extend boundary map to image borders
-  for(int i=0; i<B.cols; i++)
+  vector<Rect> cores;
+  vector<Rect> extended;
+  for(int y=0; y<img.rows; y+=bh)
   {
-    if(B.at<uchar>(1,i))
-      B.at<uchar>(0,i) = 255;      
-    else
-      B.at<uchar>(0,i) = 0;      
-    if(B.at<uchar>(B.rows-2,i))
-      B.at<uchar>(B.rows-1,i) = 255;
-    else
-      B.at<uchar>(B.rows-1,i) = 0;
+    for(int x=0; x<img.cols; x+=bw)
+    {
+      Rect core(x, y, std::min(bw, img.cols - x), std::min(bh, img.rows - y));
+      int x0 = std::max(0, x - halo);
+      int y0 = std::max(0, y - halo);
+      int x1 = std::min(img.cols, core.x + core.width + halo);
+      int y1 = std::min(img.rows, core.y + core.height + halo);
+      cores.push_back(core);
+      extended.push_back(Rect(x0, y0, x1 - x0, y1 - y0));
+    }
   }
   
-  for(int i=0; i<B.rows; i++)
+  vector<Mat> flooded(cores.size());
+  std::atomic<int> next(0);
+  auto worker = [&]()
   {
-    if(B.at<uchar>(i,1))
-      B.at<uchar>(i,0) = 255;   
-    else
-      B.at<uchar>(i,0) = 0;     
-    if(B.at<uchar>(i, B.cols-2))
-      B.at<uchar>(i, B.cols-1) = 255;
-    else
-      B.at<uchar>(i, B.cols-1) = 0;
+    for(int b = next++; b < (int) cores.size(); b = next++)
+    {
+      Mat block = img(extended[b]);
+      markers(extended[b]).copyTo(flooded[b]);
+      cws::compact_watershed(block, flooded[b], compValStep);
+    }
+  };
+  
+  const int n_threads = std::min(threads, (int) cores.size());
+  vector<std::thread> workers;
+  for(int i=1; i<n_threads; i++)
+    workers.push_back(std::thread(worker));
+  worker();
+  for(int i=0; i<(int) workers.size(); i++)
+    workers[i].join();
+  
+  // each pixel is taken from the block whose core contains it
+  for(int b=0; b<(int) cores.size(); b++)
+  {
+    Rect local(cores[b].x - extended[b].x, cores[b].y - extended[b].y, cores[b].width, cores[b].height);
+    Mat target = markers(cores[b]);
+    flooded[b](local).copyTo(target);
   }
-}
-
-void compact_watershed(Mat& img, Mat& B, float dy, float dx, float compValStep, Mat& seeds)
-{
-  Mat markers = Mat::zeros(img.rows, img.cols, CV_32SC1);
-  if( seeds.empty() )
-  {    
-    int labelIdx=1;
-    for(float i=dy/2; i<markers.rows; i+=dy)
+  
+  // compare the inner halo of each block with the neighboring cores
+  Mat conflicts = Mat::zeros(img.rows, img.cols, CV_8UC1);
+  for(int b=0; b<(int) cores.size(); b++)
+  {
+    const Rect& core = cores[b];
+    const Rect& ext = extended[b];
+    int y0 = std::max(ext.y, core.y - margin);
+    int y1 = std::min(ext.y + ext.height, core.y + core.height + margin);
+    int x0 = std::max(ext.x, core.x - margin);
+    int x1 = std::min(ext.x + ext.width, core.x + core.width + margin);
+    for(int i=y0; i<y1; i++)
     {
-      for(float j=dx/2; j<markers.cols; j+=dx)
+      const int* frow = flooded[b].ptr<int>(i - ext.y);
+      const int* mrow = markers.ptr<int>(i);
+      uchar* crow = conflicts.ptr<uchar>(i);
+      bool inside = (i >= core.y && i < core.y + core.height);
+      for(int j=x0; j<x1; j++)
       {
-        markers.at<int>(floor(i),floor(j)) = labelIdx;
-        labelIdx++;
+        if( inside && j >= core.x && j < core.x + core.width )
+          continue;
+        if( frow[j - ext.x] != mrow[j] )
+          crow[j] = 1;
       }
     }
   }
-  else
+  
+  bool any = false;
+  for(int i=0; i<img.rows; i++)
   {
-    // use given seeds
-    int labelIdx=1;
-    for(int i=0; i<seeds.cols; i++)
+    int* mrow = markers.ptr<int>(i);
+    const uchar* crow = conflicts.ptr<uchar>(i);
+    for(int j=0; j<img.cols; j++)
     {
-      //cout << "set "<<round(seeds.at<float>(0,i))<< " "<<round(seeds.at<float>(1,i))<<" to "<<labelIdx<<endl;
-      markers.at<int>(round(seeds.at<float>(0,i)),round(seeds.at<float>(1,i))) = labelIdx;
-      labelIdx++;      
+      if( crow[j] )
+      {
+        mrow[j] = 0;
+        any = true;
+      }
     }
   }
   
-  // run compact watershed
-  cws::compact_watershed( img, markers, compValStep);
-  
+  // the sequential pass only floods the unassigned (and watershed) pixels
+  if( any )
+    cws::compact_watershed( img, markers, compValStep);
+}
+
+// flood the markers, sequentially or block-wise
+static void flood_markers(Mat& img, Mat& markers, float dy, float dx, float compValStep, int threads)
+{
+  if( threads > 1 )
+    compact_watershed_blocks(img, markers, dy, dx, compValStep, threads);
+  else
+    cws::compact_watershed( img, markers, compValStep);
+}
+
+// boundary map of the watershed markers, extended to the image borders
+static void markers_to_boundaries(Mat& markers, Mat& B)
+{
   // create boundary map
   B = markers<0;
   
@@ -486,4 +518,131 @@ void compact_watershed(Mat& img, Mat& B, float dy, float dx, float compValStep,
   }
 }
 
+void compact_watershed(Mat& img, Mat& B, float n, float compValStep, Mat& seeds)
+{
+  // distribute initial markers
+  float ny = sqrt( (n*img.rows) / img.cols);
+  float nx = n/ny;
 
+  float dx = img.cols / nx;
+  float dy = img.rows / ny;
+  
+  Mat markers;
+  initialize_markers(img, dy, dx, seeds, markers);
+  
+  // run compact watershed
+  cws::compact_watershed( img, markers, compValStep);
+  
+  markers_to_boundaries(markers, B);
+}
+
+void compact_watershed(Mat& img, Mat& B, float dy, float dx, float compValStep, Mat& seeds, int threads)
+{
+  Mat markers;
+  initialize_markers(img, dy, dx, seeds, markers);
+  
+  // run compact watershed
+  flood_markers(img, markers, dy, dx, compValStep, threads);
+  
+  markers_to_boundaries(markers, B);
+}
+
+void compact_watershed_labels(Mat& img, Mat& labels, float dy, float dx, float compValStep, Mat& seeds, int threads)
+{
+  initialize_markers(img, dy, dx, seeds, labels);
+  
+  // run compact watershed
+  flood_markers(img, labels, dy, dx, compValStep, threads);
+  
+  // assign watershed pixels (and the image border) to the 4-neighbor basin
+  // with the most similar color, repeated for pixels without labeled neighbor
+  const int ni[] = {-1, 1, 0, 0};
+  const int nj[] = {0, 0, -1, 1};
+  bool changed = true;
+  bool remaining = true;
+  while( changed && remaining )
+  {
+    changed = false;
+    remaining = false;
+    for(int i=0; i<labels.rows; i++)
+    {
+      int* lrow = labels.ptr<int>(i);
+      const uchar* irow = img.ptr<uchar>(i);
+      for(int j=0; j<labels.cols; j++)
+      {
+        if( lrow[j] > 0 )
+          continue;
+        
+        int best = 0;
+        int bestDiff = 256;
+        for(int k=0; k<4; k++)
+        {
+          int ii = i + ni[k];
+          int jj = j + nj[k];
+          if( ii < 0 || ii >= labels.rows || jj < 0 || jj >= labels.cols )
+            continue;
+          int lab = labels.at<int>(ii, jj);
+          if( lab <= 0 )
+            continue;
+          
+          const uchar* p = img.ptr<uchar>(ii) + 3*jj;
+          int diff = std::max(abs(irow[3*j] - p[0]), std::max(abs(irow[3*j+1] - p[1]), abs(irow[3*j+2] - p[2])));
+          if( diff < bestDiff )
+          {
+            bestDiff = diff;
+            best = lab;
+          }
+        }
+        
+        if( best > 0 )
+        {
+          lrow[j] = best;
+          changed = true;
+        }
+        else
+          remaining = true;
+      }
+    }
+  }
+}
+
+void compact_watershed_centroids(const Mat& labels, Mat& seeds)
+{
+  double maxLabel = 0;
+  minMaxLoc(labels, 0, &maxLabel);
+  int numLabels = (int)maxLabel + 1;
+  
+  vector<double> sumI(numLabels, 0);
+  vector<double> sumJ(numLabels, 0);
+  vector<int> count(numLabels, 0);
+  for(int i=0; i<labels.rows; i++)
+  {
+    const int* lrow = labels.ptr<int>(i);
+    for(int j=0; j<labels.cols; j++)
+    {
+      if( lrow[j] < 0 )
+        continue;
+      sumI[lrow[j]] += i;
+      sumJ[lrow[j]] += j;
+      count[lrow[j]]++;
+    }
+  }
+  
+  int numSeeds = 0;
+  for(int k=0; k<numLabels; k++)
+    if( count[k] > 0 )
+      numSeeds++;
+  
+  seeds.create(2, numSeeds, CV_32FC1);
+  int s = 0;
+  for(int k=0; k<numLabels; k++)
+  {
+    if( count[k] == 0 )
+      continue;
+    float i = sumI[k] / count[k];
+    float j = sumJ[k] / count[k];
+    seeds.at<float>(0, s) = std::min(std::max(i, 1.f), (float)(labels.rows-2));
+    seeds.at<float>(1, s) = std::min(std::max(j, 1.f), (float)(labels.cols-2));
+    s++;
+  }
+}
@@ -53,8 +53,38 @@ Peer Neubert and Peter Protzel, ICPR 2014
 @param nx appr number of superpixels in y direction
 @param compValStep input parameter for the desired compactness
 @param seeds matrix of initial seeds, CV_32FC1, each col: [i; j], if empty, use grid like initialization
+@param threads number of threads; with more than one, blocks of seed cells are flooded
+concurrently (each with a halo of one cell) and disagreeing halo pixels are flooded
+again sequentially, which may differ slightly from the sequential result
 
 */
-void compact_watershed(cv::Mat& img, cv::Mat& B, float ny, float nx, float compValStep, cv::Mat& seeds);
+void compact_watershed(cv::Mat& img, cv::Mat& B, float ny, float nx, float compValStep, cv::Mat& seeds, int threads = 1);
+
+/**
+Compact watershed returning labels directly, without allocating a boundary map.
+Watershed pixels (and the image border) are assigned to the adjacent superpixel
+with the most similar color.
+
+@param img input image CV_8UC3
+@param labels output labels, CV_32SC1, starting at 1
+@param ny appr number of superpixels in y direction
+@param nx appr number of superpixels in y direction
+@param compValStep input parameter for the desired compactness
+@param seeds matrix of initial seeds, CV_32FC1, each col: [i; j], if empty, use grid like initialization
+@param threads number of threads, see compact_watershed
+
+*/
+void compact_watershed_labels(cv::Mat& img, cv::Mat& labels, float ny, float nx, float compValStep, cv::Mat& seeds, int threads = 1);
+
+/**
+Centroids of the superpixels as seeds for compact_watershed, e.g. to track the
+superpixels of the previous frame in a video. Centroids are moved off the
+one pixel image border (which the watershed reserves for boundaries).
+
+@param labels input labels CV_32SC1, non-negative
+@param seeds output seeds, CV_32FC1, each col: [i; j], one per non-empty label
+
+*/
+void compact_watershed_centroids(const cv::Mat& labels, cv::Mat& seeds);
 
 #endif
\ No newline at end of file
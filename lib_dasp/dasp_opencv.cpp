@@ -41,7 +41,8 @@
 
 void DASP_OpenCV::computeSuperpixels(const cv::Mat &image, const cv::Mat &depth, 
         int desired_superpixels, float spatial_weight, float normal_weight, 
-        int seed_mode, int iterations, dasp::Camera camera, cv::Mat &labels) {
+        int seed_mode, int iterations, dasp::Camera camera, cv::Mat &labels,
+        int threads) {
     
     dasp::Parameters opt;
     opt.camera = camera;
@@ -76,17 +77,21 @@ void DASP_OpenCV::computeSuperpixels(const cv::Mat &image, const cv::Mat &depth,
 
     // Convert OpenCV images to SLImage images.
     for (int i = 0; i < image.rows; ++i) {
+        const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+        const unsigned short* depth_row = depth.ptr<unsigned short>(i);
+        
         for (int j = 0; j < image.cols; ++j) {
             const auto& pixel = slimage_color(j, i);
-            pixel[0] = image.at<cv::Vec3b>(i, j)[0];
-            pixel[1] = image.at<cv::Vec3b>(i, j)[1];
-            pixel[2] = image.at<cv::Vec3b>(i, j)[2];
+            pixel[0] = image_row[j][0];
+            pixel[1] = image_row[j][1];
+            pixel[2] = image_row[j][2];
 
-            slimage_depth(j, i) = (uint16_t) depth.at<unsigned short>(i, j);
+            slimage_depth(j, i) = (uint16_t) depth_row[j];
         }
     }
         
     superpixels.opt = opt;
+    superpixels.threadopt = slimage::ThreadingOptions::UseThreads(threads);
     dasp::ComputeSuperpixelsIncremental(superpixels, slimage_color, slimage_depth);
     slimage_labels = superpixels.ComputeLabels();
 
@@ -102,8 +107,9 @@ void DASP_OpenCV::computeSuperpixels(const cv::Mat &image, const cv::Mat &depth,
 
     labels.create(image.rows, image.cols, CV_32SC1);
     for (int i = 0; i < image.rows; ++i) {
+        int* labels_row = labels.ptr<int>(i);
         for (int j = 0; j < image.cols; ++j) {
-            labels.at<int>(i, j) = slimage_labels(j, i) + abs(min_label);
+            labels_row[j] = slimage_labels(j, i) + abs(min_label);
         }
     }
 }
\ No newline at end of file
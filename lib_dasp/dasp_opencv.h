@@ -57,10 +57,12 @@ public:
      * \param[in] iterations number of iterations
      * \param[in] camera dasp::Camera object specifying camera parameters, see dasp_cli/main.cpp and lib_eval/depth_tools.h for details
      * \param[out] labels superpixel labels
+     * \param[in] threads number of threads for points, density and clustering, the labels do not depend on it
      */
     static void computeSuperpixels(const cv::Mat &image, const cv::Mat &depth, 
             int superpixels, float spatial_weight, float normal_weight, 
-            int seed_mode, int iterations, dasp::Camera camera, cv::Mat &labels);
+            int seed_mode, int iterations, dasp::Camera camera, cv::Mat &labels,
+            int threads = 1);
 };
 
 #endif	/* DASP_OPENCV_H */
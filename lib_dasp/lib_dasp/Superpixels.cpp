@@ -246,6 +246,7 @@ void Cluster::ComputeExt(const ImagePoints& points, const Parameters& opt)
 //------------------------------------------------------------------------------
 
 Superpixels::Superpixels()
+: threadopt(slimage::ThreadingOptions::Single())
 {
 
 }
@@ -305,84 +306,88 @@ void Superpixels::CreatePoints(const slimage::Image3ub& image, const slimage::Im
 		&& (opt.clip_y_min < opt.clip_y_max)
 		&& (opt.clip_z_min < opt.clip_z_max);
 
-	unsigned int i=0;
-	for(unsigned int y=0; y<height; y++) {
-		for(unsigned int x=0; x<width; x++, i++) {
-			Point& p = points[i];
-			// write point pixel coordinate
-			p.px = x;
-			p.py = y;
-			// convert color
-			{
-				const auto& cub = image[i];
-				// p.color[0] = float(cub[0]) / 255.0f;
-				// p.color[1] = float(cub[1]) / 255.0f;
-				// p.color[2] = float(cub[2]) / 255.0f;
-				p.color = Eigen::Vector3f(
-					float(cub[0]),
-					float(cub[1]),
-					float(cub[2])) / 255.0f;
-				if(opt.color_space != ColorSpaces::RGB)
-					p.color = ColorFromRGB(p.color);
-			}
-			// clip points which are outside of 2D ROI
-			if(is_clipping_2d) {
-				if(    x < opt.roi_2d_x_min || opt.roi_2d_x_max < x
-					|| y < opt.roi_2d_y_min || opt.roi_2d_y_max < y
-				) {
-					// point is clipped
-					p.is_valid = false;
-					goto label_pixel_invalid_omg;
-				}
-			}
-			if(opt.density_mode == DensityModes::ASP_RGB) {
-				p.is_valid = true;
-				p.position = Eigen::Vector3f::Zero();
-				p.cluster_radius_px = 0.0f;
-			}
-			else {
-				// p.pixel[0] = static_cast<float>(x);
-				// p.pixel[1] = py;
-				p.is_valid = false;
-				// get depth and compute z/f
-				const uint16_t depth_i16 = depth[i];
-				const float z_over_f = opt.camera.convertKinectToMeter(depth_i16) / opt.camera.focal;
-				// if depth is 0 the point is invalid
-				p.is_valid = (depth_i16 != 0);
-				if(!p.is_valid) goto label_pixel_invalid_omg;
-				// compute position
-				p.position = opt.camera.unprojectImpl(
-					static_cast<float>(p.px), static_cast<float>(p.py),
-					z_over_f); // will give 0 if depth==0
-				// clip points which are outside of 3D ROI
-				if(is_clipping_3d) {
-					if(    p.position.x() < opt.clip_x_min || opt.clip_x_max < p.position.x()
-						|| p.position.y() < opt.clip_y_min || opt.clip_y_max < p.position.y()
-						|| p.position.z() < opt.clip_z_min || opt.clip_z_max < p.position.z()
-					) {
-						// point is clipped
+	// rows are independent, each thread converts a block of rows
+	slimage::ParallelProcessRange(height,
+		[&](unsigned int ybegin, unsigned int yend) {
+			for(unsigned int y=ybegin; y<yend; y++) {
+				unsigned int i = y*width;
+				for(unsigned int x=0; x<width; x++, i++) {
+					Point& p = points[i];
+					// write point pixel coordinate
+					p.px = x;
+					p.py = y;
+					// convert color
+					{
+						const auto& cub = image[i];
+						// p.color[0] = float(cub[0]) / 255.0f;
+						// p.color[1] = float(cub[1]) / 255.0f;
+						// p.color[2] = float(cub[2]) / 255.0f;
+						p.color = Eigen::Vector3f(
+							float(cub[0]),
+							float(cub[1]),
+							float(cub[2])) / 255.0f;
+						if(opt.color_space != ColorSpaces::RGB)
+							p.color = ColorFromRGB(p.color);
+					}
+					// clip points which are outside of 2D ROI
+					if(is_clipping_2d) {
+						if(    x < opt.roi_2d_x_min || opt.roi_2d_x_max < x
+							|| y < opt.roi_2d_y_min || opt.roi_2d_y_max < y
+						) {
+							// point is clipped
+							p.is_valid = false;
+							goto label_pixel_invalid_omg;
+						}
+					}
+					if(opt.density_mode == DensityModes::ASP_RGB) {
+						p.is_valid = true;
+						p.position = Eigen::Vector3f::Zero();
+						p.cluster_radius_px = 0.0f;
+					}
+					else {
+						// p.pixel[0] = static_cast<float>(x);
+						// p.pixel[1] = py;
 						p.is_valid = false;
-						goto label_pixel_invalid_omg;
+						// get depth and compute z/f
+						const uint16_t depth_i16 = depth[i];
+						const float z_over_f = opt.camera.convertKinectToMeter(depth_i16) / opt.camera.focal;
+						// if depth is 0 the point is invalid
+						p.is_valid = (depth_i16 != 0);
+						if(!p.is_valid) goto label_pixel_invalid_omg;
+						// compute position
+						p.position = opt.camera.unprojectImpl(
+							static_cast<float>(p.px), static_cast<float>(p.py),
+							z_over_f); // will give 0 if depth==0
+						// clip points which are outside of 3D ROI
+						if(is_clipping_3d) {
+							if(    p.position.x() < opt.clip_x_min || opt.clip_x_max < p.position.x()
+								|| p.position.y() < opt.clip_y_min || opt.clip_y_max < p.position.y()
+								|| p.position.z() < opt.clip_z_min || opt.clip_z_max < p.position.z()
+							) {
+								// point is clipped
+								p.is_valid = false;
+								goto label_pixel_invalid_omg;
+							}
+						}
+						// compute cluster radius [px]
+						p.cluster_radius_px = opt.base_radius / z_over_f;
+						// compute normal
+						{
+							// FIXME in count mode the gradient is computed using a default radius of 0.02
+							// FIXME regardless of the radius chosen later
+							Eigen::Vector2f gradient = LocalDepthGradient(depth, x, y, z_over_f, 0.5f*p.cluster_radius_px, opt.camera);
+							p.setNormalFromGradient(gradient);
+							// limit minimal circularity such that the maximum angle is 80 deg
+							// FIXME limit normal angle
+						}
+						continue;
 					}
+label_pixel_invalid_omg:
+					p.cluster_radius_px = 0.0f; // FIXME why do we have to set this?
+					p.normal = Eigen::Vector3f(0,0,-1);
 				}
-				// compute cluster radius [px]
-				p.cluster_radius_px = opt.base_radius / z_over_f;
-				// compute normal
-				{
-					// FIXME in count mode the gradient is computed using a default radius of 0.02
-					// FIXME regardless of the radius chosen later
-					Eigen::Vector2f gradient = LocalDepthGradient(depth, x, y, z_over_f, 0.5f*p.cluster_radius_px, opt.camera);
-					p.setNormalFromGradient(gradient);
-					// limit minimal circularity such that the maximum angle is 80 deg
-					// FIXME limit normal angle
-				}
-				continue;
 			}
-label_pixel_invalid_omg:
-			p.cluster_radius_px = 0.0f; // FIXME why do we have to set this?
-			p.normal = Eigen::Vector3f(0,0,-1);
-		}
-	}
+		}, threadopt);
 
 	DANVIL_BENCHMARK_START(density)
 	if(opt.density_mode == DensityModes::ASP_RGB || opt.density_mode == DensityModes::ASP_RGBD) {
@@ -415,7 +420,7 @@ label_pixel_invalid_omg:
 	}
 	else if(opt.density_mode == DensityModes::DASP) {
 		// compute depth-adaptive density
-		density = ComputeDepthDensity(points, opt);
+		density = ComputeDepthDensity(points, opt, threadopt);
 		// depth-adaptive smooth
 		if(opt.is_smooth_density) {
 			density = density::DensityAdaptiveSmooth(density);
@@ -920,15 +925,15 @@ void Superpixels::MoveClusters()
 	// FIXME metric needs central place!
 	if(opt.density_mode == DensityModes::ASP_RGB) {
 		DensityAdaptiveMetric_UxRGB metric(opt.weight_spatial, opt.weight_color);
-		labels = dasp::IterateClusters(cluster, points, opt, metric);
+		labels = dasp::IterateClusters(cluster, points, opt, metric, threadopt);
 	}
 	else if(opt.density_mode == DensityModes::ASP_RGBD) {
 		DensityAdaptiveMetric_UxRGBxD metric(opt.weight_spatial, opt.weight_color, opt.weight_normal);
-		labels = dasp::IterateClusters(cluster, points, opt, metric);
+		labels = dasp::IterateClusters(cluster, points, opt, metric, threadopt);
 	}
 	else if(opt.density_mode == DensityModes::DASP) {
 		DepthAdaptiveMetric metric(opt.weight_spatial, opt.weight_color, opt.weight_normal, opt.base_radius);
-		labels = dasp::IterateClusters(cluster, points, opt, metric);
+		labels = dasp::IterateClusters(cluster, points, opt, metric, threadopt);
 	}
 	else {
 		// error!
@@ -950,9 +955,12 @@ void Superpixels::MoveClusters()
 	// remove invalid clusters
 	PurgeInvalidClusters();
 	// update remaining (valid) clusters
-	for(Cluster& c : cluster) {
-		c.UpdateCenter(points, opt);
-	}
+	slimage::ParallelProcessRange(cluster.size(),
+		[this](unsigned int kbegin, unsigned int kend) {
+			for(unsigned int k=kbegin; k<kend; k++) {
+				cluster[k].UpdateCenter(points, opt);
+			}
+		}, threadopt);
 }
 
 ClusterGroupInfo Superpixels::ComputeClusterGroupInfo(unsigned int n, float max_thick)
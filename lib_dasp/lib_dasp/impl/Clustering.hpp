@@ -12,6 +12,7 @@
 #include "../Parameters.hpp"
 #include "../Metric.hpp"
 #include <Slimage/Slimage.hpp>
+#include <Slimage/Parallel.h>
 #include <Eigen/Dense>
 #include <iostream>
 
@@ -47,39 +48,47 @@ namespace dasp
 		return edges;
 	}
 
+	/** Assigns each point to the closest cluster
+	 * The image is split into blocks of rows processed in parallel. Each block
+	 * visits the clusters in the same order, so the labels do not depend on
+	 * the number of threads.
+	 */
 	template<typename METRIC>
-	slimage::Image1i IterateClusters(const std::vector<Cluster>& clusters, const ImagePoints& points, const Parameters& opt, const METRIC& mf)
+	slimage::Image1i IterateClusters(const std::vector<Cluster>& clusters, const ImagePoints& points, const Parameters& opt, const METRIC& mf, slimage::ThreadingOptions threadopt = slimage::ThreadingOptions::Single())
 	{
 		slimage::Image1i labels(points.width(), points.height(), slimage::Pixel1i{-1});
 		std::vector<float> v_dist(points.size(), 1e9);
-		// for each cluster check possible points
-		for(unsigned int j=0; j<clusters.size(); j++) {
-			const Cluster& c = clusters[j];
-			int cx = c.center.px;
-			int cy = c.center.py;
-			int R = static_cast<int>(c.center.cluster_radius_px * opt.coverage + 0.5f);
-			R = std::max<int>(2,R);
-			const unsigned int xmin = std::max<int>(0, cx - R);
-			const unsigned int xmax = std::min<int>(static_cast<int>(points.width())-1, cx + R);
-			const unsigned int ymin = std::max<int>(0, cy - R);
-			const unsigned int ymax = std::min<int>(static_cast<int>(points.height())-1, cy + R);
-			for(unsigned int y=ymin; y<=ymax; y++) {
-				for(unsigned int x=xmin; x<=xmax; x++/*, pnt_index++*/) {
-					unsigned int pnt_index = points.index(x, y);
-					const Point& p = points[pnt_index];
-					if(!p.is_valid) {
-						// omit invalid points
-						continue;
-					}
-					float dist = mf(p, c.center);
-					float& v_dist_best = v_dist[pnt_index];
-					if(dist < v_dist_best) {
-						v_dist_best = dist;
-						labels[pnt_index] = j;
+		slimage::ParallelProcessRange(points.height(),
+			[&](unsigned int ybegin, unsigned int yend) {
+				// for each cluster check possible points
+				for(unsigned int j=0; j<clusters.size(); j++) {
+					const Cluster& c = clusters[j];
+					int cx = c.center.px;
+					int cy = c.center.py;
+					int R = static_cast<int>(c.center.cluster_radius_px * opt.coverage + 0.5f);
+					R = std::max<int>(2,R);
+					const unsigned int xmin = std::max<int>(0, cx - R);
+					const unsigned int xmax = std::min<int>(static_cast<int>(points.width())-1, cx + R);
+					const int ymin = std::max<int>(ybegin, cy - R);
+					const int ymax = std::min<int>(static_cast<int>(yend)-1, cy + R);
+					for(int y=ymin; y<=ymax; y++) {
+						for(unsigned int x=xmin; x<=xmax; x++/*, pnt_index++*/) {
+							unsigned int pnt_index = points.index(x, y);
+							const Point& p = points[pnt_index];
+							if(!p.is_valid) {
+								// omit invalid points
+								continue;
+							}
+							float dist = mf(p, c.center);
+							float& v_dist_best = v_dist[pnt_index];
+							if(dist < v_dist_best) {
+								v_dist_best = dist;
+								labels[pnt_index] = j;
+							}
+						}
 					}
 				}
-			}
-		}
+			}, threadopt);
 		return labels;
 	}
 
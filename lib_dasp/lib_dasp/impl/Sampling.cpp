@@ -100,29 +100,32 @@ void DebugMipmapDelta(const std::vector<Eigen::MatrixXf>& mipmaps, const std::st
 
 #endif
 
-Eigen::MatrixXf ComputeDepthDensity(const ImagePoints& points, const Parameters& opt)
+Eigen::MatrixXf ComputeDepthDensity(const ImagePoints& points, const Parameters& opt, slimage::ThreadingOptions threadopt)
 {
 	constexpr float NZ_MIN = 0.174f; // = std::sin(80 deg)
 
 	Eigen::MatrixXf density(points.width(), points.height());
 	float* p_density = density.data();
-	for(unsigned int i=0; i<points.size(); i++) {
-		const Point& p = points[i];
-		/** Estimated number of super pixels at this point
-		 * We assume circular superpixels. So the area A of a superpixel at
-		 * point location is R*R*pi and the superpixel density is 1/A.
-		 * If the depth information is invalid, the density is 0.
-		 */
-		float cnt = 0.0f;
-		if(p.is_valid) {
-			cnt = 1.0f / (M_PI * p.cluster_radius_px * p.cluster_radius_px);
-			// Additionally the local gradient has to be considered.
-			if(opt.gradient_adaptive_density) {
-				cnt /= std::max(NZ_MIN, p.computeCircularity());
+	slimage::ParallelProcessRange(points.size(),
+		[&](unsigned int ibegin, unsigned int iend) {
+			for(unsigned int i=ibegin; i<iend; i++) {
+				const Point& p = points[i];
+				/** Estimated number of super pixels at this point
+				 * We assume circular superpixels. So the area A of a superpixel at
+				 * point location is R*R*pi and the superpixel density is 1/A.
+				 * If the depth information is invalid, the density is 0.
+				 */
+				float cnt = 0.0f;
+				if(p.is_valid) {
+					cnt = 1.0f / (M_PI * p.cluster_radius_px * p.cluster_radius_px);
+					// Additionally the local gradient has to be considered.
+					if(opt.gradient_adaptive_density) {
+						cnt /= std::max(NZ_MIN, p.computeCircularity());
+					}
+				}
+				p_density[i] = cnt;
 			}
-		}
-		p_density[i] = cnt;
-	}
+		}, threadopt);
 	return density;
 }
 
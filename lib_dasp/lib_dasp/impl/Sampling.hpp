@@ -10,12 +10,13 @@
 
 #include "../Point.hpp"
 #include "../Seed.hpp"
+#include <Slimage/Parallel.h>
 #include <Eigen/Dense>
 #include <vector>
 
 namespace dasp
 {
-	Eigen::MatrixXf ComputeDepthDensity(const ImagePoints& points, const Parameters& opt);
+	Eigen::MatrixXf ComputeDepthDensity(const ImagePoints& points, const Parameters& opt, slimage::ThreadingOptions threadopt = slimage::ThreadingOptions::Single());
 
 	Eigen::MatrixXf ComputeSaliency(const ImagePoints& points, const Parameters& opt);
 
@@ -12,7 +12,7 @@ namespace graphseg
 {
 	SpectralGraph SolveSpectral(const SpectralGraph& graph, unsigned int num_ev)
 	{
-		return SolveSpectral(graph, num_ev, SpectralMethod::Eigen);
+		return SolveSpectral(graph, num_ev, SpectralMethod::Lanczos);
 	}
 
 	SpectralGraph SolveSpectral(const SpectralGraph& graph, unsigned int num_ev, SpectralMethod method)
@@ -20,6 +20,21 @@ namespace graphseg
 		return detail::graphseg_spectral(graph, boost::get(boost::edge_bundle, graph), num_ev, method);
 	}
 
+	SpectralSolver::SpectralSolver(SpectralMethod method)
+	:	method_(method),
+		workspace_(std::make_shared<detail::LanczosWorkspace>())
+	{}
+
+	SpectralGraph SpectralSolver::solve(const SpectralGraph& graph, unsigned int num_ev)
+	{
+		return detail::graphseg_spectral(graph, boost::get(boost::edge_bundle, graph), num_ev, method_, workspace_.get());
+	}
+
+	void SpectralSolver::reset()
+	{
+		*workspace_ = detail::LanczosWorkspace();
+	}
+
 	SpectralGraph SolveMCL(const SpectralGraph& graph, float p, unsigned int iterations)
 	{
 		typedef Eigen::MatrixXf Mat;
@@ -9,6 +9,7 @@
 #define GRAPHSEG_HPP
 
 #include "Common.hpp"
+#include <memory>
 
 namespace graphseg
 {
@@ -16,12 +17,15 @@ namespace graphseg
 	namespace detail
 	{
 		extern bool cVerbose;
+		struct LanczosWorkspace;
 	}
 
 	enum class SpectralMethod
 	{
 		Eigen
+#ifdef USE_SOLVER_ARPACKPP
 		,ArpackPP
+#endif
 		,Lapack
 #ifdef USE_SOLVER_MAGMA
 		,Magma
@@ -29,6 +33,7 @@ namespace graphseg
 #ifdef USE_SOLVER_IETL
 		,Ietl
 #endif
+		,Lanczos
 	};
 
 	/** Applies spectral graph theory fu to a weighted, undirected graph */
@@ -37,6 +42,28 @@ namespace graphseg
 	/** Like SolveSpectral, but with fastest available solver */
 	SpectralGraph SolveSpectral(const SpectralGraph& graph, unsigned int num_ev);
 
+	/** Spectral solver keeping its state between calls, e.g. for consecutive frames:
+	 * with SpectralMethod::Lanczos the sparse matrix structure is reused as long as
+	 * the graph does not change and the iteration starts from the previous eigenvectors.
+	 */
+	class SpectralSolver
+	{
+	public:
+		SpectralSolver(SpectralMethod method=SpectralMethod::Lanczos);
+
+		SpectralMethod method() const { return method_; }
+
+		/** Like SolveSpectral with the method of the solver */
+		SpectralGraph solve(const SpectralGraph& graph, unsigned int num_ev);
+
+		/** Forgets the previous matrix and eigenvectors */
+		void reset();
+
+	private:
+		SpectralMethod method_;
+		std::shared_ptr<detail::LanczosWorkspace> workspace_;
+	};
+
 	/** Applies MCL graph segmentation to a weighted, undirected graph */
 	SpectralGraph SolveMCL(const SpectralGraph& graph, float p, unsigned int iterations);
 
@@ -0,0 +1,208 @@
+/*
+ * lanczos.cpp
+ *
+ * Sparse thick-restart Lanczos solver using Eigen only.
+ */
+
+#include "solver.hpp"
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <cmath>
+#ifdef SPECTRAL_VERBOSE
+#	include <iostream>
+#endif
+
+namespace graphseg { namespace detail {
+
+/** Maximal residual norm of a converged eigenpair */
+constexpr double c_lanczos_tolerance = 1e-5;
+
+/** Number of additional eigenpairs which need to converge, makes it less
+ * likely that an eigenvalue close to the largest wanted one is missed */
+constexpr unsigned int c_lanczos_guard = 8;
+
+/** Maximal number of restarts */
+constexpr unsigned int c_lanczos_max_restarts = 200;
+
+/** Checks if the compressed matrix has the sparsity pattern of the entries */
+bool lanczos_same_pattern(const Eigen::SparseMatrix<double>& M, const SparseMatrix& A)
+{
+	if(M.rows() != static_cast<Eigen::Index>(A.dim)
+		|| M.nonZeros() != static_cast<Eigen::Index>(A.entries.size())) {
+		return false;
+	}
+	// entries are sorted by column then by row just like the compressed storage
+	const int* outer = M.outerIndexPtr();
+	const int* inner = M.innerIndexPtr();
+	for(std::size_t k=0; k<A.entries.size(); k++) {
+		const SparseEntry& e = A.entries[k];
+		if(inner[k] != static_cast<int>(e.i)
+			|| static_cast<int>(k) < outer[e.j] || static_cast<int>(k) >= outer[e.j + 1]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Copies the entries into the workspace matrix, reusing its structure if possible */
+void lanczos_assemble(const SparseMatrix& A, Eigen::SparseMatrix<double>& M)
+{
+	if(lanczos_same_pattern(M, A)) {
+		double* values = M.valuePtr();
+		for(std::size_t k=0; k<A.entries.size(); k++) {
+			values[k] = A.entries[k].weight;
+		}
+		return;
+	}
+	std::vector<Eigen::Triplet<double>> triplets;
+	triplets.reserve(A.entries.size());
+	for(const SparseEntry& e : A.entries) {
+		triplets.push_back(Eigen::Triplet<double>(e.i, e.j, e.weight));
+	}
+	M = Eigen::SparseMatrix<double>(A.dim, A.dim);
+	M.setFromTriplets(triplets.begin(), triplets.end());
+	M.makeCompressed();
+}
+
+std::vector<EigenComponent> solver_lanczos(const SparseMatrix& A, unsigned int num_ev, LanczosWorkspace& workspace)
+{
+	typedef Eigen::MatrixXd Mat;
+	typedef Eigen::VectorXd Vec;
+
+	const unsigned int n = A.dim;
+	const unsigned int k = std::min(num_ev, n);
+	std::vector<EigenComponent> solution(k);
+	if(k == 0) {
+		return solution;
+	}
+
+	lanczos_assemble(A, workspace.A);
+	const auto M = workspace.A.selfadjointView<Eigen::Lower>();
+
+	// number of converged eigenpairs, size of the search space and number of
+	// Ritz vectors kept on restart
+	const unsigned int nev = std::min(n, k + c_lanczos_guard);
+	const unsigned int m = std::min(n, std::max(2*nev + 32, 3*nev));
+	const unsigned int keep = nev + (m - nev)/2;
+
+	Mat X;
+	Vec theta;
+	if(m == n) {
+		// the search space would be the whole space anyway
+		Eigen::SparseMatrix<double> full = M;
+		const Mat dense = full;
+		Eigen::SelfAdjointEigenSolver<Mat> solver(dense);
+		X = solver.eigenvectors().leftCols(k);
+		theta = solver.eigenvalues().head(k);
+	}
+	else {
+		// orthonormal basis V of the search space and AV = A V
+		Mat V(n, m);
+		Mat AV(n, m);
+		unsigned int cols = 0;
+
+		// appends the part of w orthogonal to the basis (classical Gram-Schmidt, twice)
+		auto append = [&](Vec w) -> bool {
+			const double norm = w.norm();
+			if(norm == 0.0) {
+				return false;
+			}
+			for(int pass=0; pass<2; pass++) {
+				w -= V.leftCols(cols) * (V.leftCols(cols).transpose() * w);
+			}
+			const double rest = w.norm();
+			if(rest < 1e-8 * norm) {
+				return false;
+			}
+			V.col(cols) = w / rest;
+			AV.col(cols) = M * V.col(cols);
+			cols++;
+			return true;
+		};
+
+		std::mt19937 generator(n);
+		std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+		auto random_vector = [&]() -> Vec {
+			Vec w(n);
+			for(unsigned int i=0; i<n; i++) {
+				w[i] = uniform(generator);
+			}
+			return w;
+		};
+
+		// warm start with the sum of the eigenvectors of the previous call,
+		// some noise keeps components of eigenvectors which were not wanted before
+		Vec start = Vec::Zero(n);
+		for(const Vec& ev : workspace.eigenvectors) {
+			if(ev.size() == n) {
+				start += ev;
+			}
+		}
+		const Vec noise = random_vector();
+		start += 0.1 * std::max(1.0, start.norm()) / noise.norm() * noise;
+		append(start);
+
+		Vec next = AV.col(cols - 1);
+		for(unsigned int restart=0; ; restart++) {
+			if(cols >= nev) {
+				// Rayleigh-Ritz on the search space
+				Mat H = V.leftCols(cols).transpose() * AV.leftCols(cols);
+				H = 0.5 * (H + H.transpose()).eval();
+				Eigen::SelfAdjointEigenSolver<Mat> solver(H);
+				X = V.leftCols(cols) * solver.eigenvectors().leftCols(nev);
+				theta = solver.eigenvalues().head(nev);
+				Mat R = AV.leftCols(cols) * solver.eigenvectors().leftCols(nev) - X * theta.asDiagonal();
+
+				unsigned int worst = 0;
+				double residual = 0.0;
+				for(unsigned int i=0; i<nev; i++) {
+					const double r = R.col(i).norm();
+					if(r > residual) {
+						residual = r;
+						worst = i;
+					}
+				}
+#ifdef SPECTRAL_VERBOSE
+				std::cout << "DEBUG: solver_lanczos restart " << restart << " residual " << residual << std::endl;
+#endif
+				if(residual < c_lanczos_tolerance || restart == c_lanczos_max_restarts) {
+					break;
+				}
+
+				// thick restart with the smallest Ritz vectors
+				if(cols > keep) {
+					const Mat Y = solver.eigenvectors().leftCols(keep);
+					V.leftCols(keep) = (V.leftCols(cols) * Y).eval();
+					AV.leftCols(keep) = (AV.leftCols(cols) * Y).eval();
+					cols = keep;
+				}
+				// continue with the residual which is orthogonal to the search space
+				next = R.col(worst);
+			}
+
+			// extend the Krylov space
+			while(cols < m) {
+				if(!append(next) && !append(random_vector())) {
+					break;
+				}
+				next = AV.col(cols - 1);
+			}
+		}
+	}
+
+	workspace.eigenvectors.resize(k);
+	for(unsigned int i=0; i<k; i++) {
+		workspace.eigenvectors[i] = X.col(i);
+		solution[i].eigenvalue = static_cast<float>(theta[i]);
+		solution[i].eigenvector = X.col(i).cast<float>();
+#ifdef SPECTRAL_VERBOSE
+		std::cout << "DEBUG:\teigenvalue #" << i << "=" << solution[i].eigenvalue << std::endl;
+#endif
+	}
+	return solution;
+}
+
+}}
@@ -9,6 +9,7 @@
 #define GRAPHSEG_SPECTRAL_SOLVER_HPP_
 
 #include "../Common.hpp"
+#include <Eigen/Sparse>
 #include <vector>
 
 namespace graphseg {
@@ -22,12 +23,29 @@ namespace detail {
 	std::vector<EigenComponent> solver_magma(const Eigen::MatrixXf& A, unsigned int num_ev);
 #endif
 
+#ifdef USE_SOLVER_ARPACKPP
 	std::vector<EigenComponent> solver_arpackpp(const SparseMatrix& A, unsigned int num_ev);
+#endif
 
 #ifdef USE_SOLVER_IETL
 	std::vector<EigenComponent> solver_ietl(const SparseMatrix& A, unsigned int num_ev);
 #endif
 
+	/** State of the Lanczos solver kept between calls */
+	struct LanczosWorkspace
+	{
+		/** Compressed lower triangle of the matrix; the values are replaced
+		 * in place as long as the sparsity pattern does not change */
+		Eigen::SparseMatrix<double> A;
+
+		/** Eigenvectors of the previous call, used as initial basis */
+		std::vector<Eigen::VectorXd> eigenvectors;
+	};
+
+	/** Thick-restart Lanczos solver for the num_ev smallest eigenvalues;
+	 * starts from the eigenvectors stored in the workspace if the dimension matches */
+	std::vector<EigenComponent> solver_lanczos(const SparseMatrix& A, unsigned int num_ev, LanczosWorkspace& workspace);
+
 }}
 
 #endif
@@ -14,9 +14,12 @@
 
 namespace graphseg { namespace detail {
 
-	/** Computes n smallest eigenvalues/-vectors for a graph */
+	/** Computes n smallest eigenvalues/-vectors for a graph
+	 * The workspace keeps the state of the Lanczos solver between calls
+	 */
 	template<typename Graph, typename EdgeWeightMap>
-	std::vector<EigenComponent> solve(const Graph& graph, EdgeWeightMap edge_weights, unsigned int num_ev, SpectralMethod method)
+	std::vector<EigenComponent> solve(const Graph& graph, EdgeWeightMap edge_weights, unsigned int num_ev, SpectralMethod method,
+		LanczosWorkspace* workspace=0)
 	{
 	using namespace std::placeholders;
 		// pick one eigenvalue more because the first one is omitted
@@ -29,12 +32,19 @@ namespace graphseg { namespace detail {
 			case SpectralMethod::Magma:
 				return detail::solve_dense(graph, edge_weights, std::bind(&solver_magma, _1, num_ev + 1));
 #endif
+#ifdef USE_SOLVER_ARPACKPP
 			case SpectralMethod::ArpackPP:
 				return detail::solve_sparse(graph, edge_weights, std::bind(&solver_arpackpp, _1, num_ev + 1));
+#endif
 #ifdef USE_SOLVER_IETL
 			case SpectralMethod::Ietl:
 				return detail::solve_sparse(graph, edge_weights, std::bind(&solver_ietl, _1, num_ev + 1));
 #endif
+			case SpectralMethod::Lanczos: {
+				LanczosWorkspace local;
+				return detail::solve_sparse(graph, edge_weights,
+					std::bind(&solver_lanczos, _1, num_ev + 1, std::ref(workspace ? *workspace : local)));
+			}
 			default:
 				std::cerr << "ERROR: Solver not available!" << std::endl;
 				return {};
@@ -43,9 +53,10 @@ namespace graphseg { namespace detail {
 
 	/** Applies graphseg graph theory fu to a weighted undirected graph */
 	template<typename Graph, typename EdgeWeightMap>
-	Graph graphseg_spectral(const Graph& graph, EdgeWeightMap edge_weights, unsigned int num_ev, SpectralMethod method)
+	Graph graphseg_spectral(const Graph& graph, EdgeWeightMap edge_weights, unsigned int num_ev, SpectralMethod method,
+		LanczosWorkspace* workspace=0)
 	{
-		std::vector<EigenComponent> solution = solve(graph, edge_weights, num_ev, method);
+		std::vector<EigenComponent> solution = solve(graph, edge_weights, num_ev, method, workspace);
 		Eigen::VectorXf weights = ev_to_graph_weights(graph, solution);
 		Graph result = graph;
 		// FIXME proper edge indexing
@@ -177,7 +177,7 @@ SparseGEVT<K> sparse_graph_entries(const Graph& graph, EdgeWeightMap edge_weight
 
 	// also collect diagonal entries
 	Eigen::VectorXf& diag = sgevt.D_inv_sqrt;
-	diag = Eigen::VectorXf(n);
+	diag = Eigen::VectorXf::Zero(n);
 
 	// no collect entries
 	for(auto eid : as_range(boost::edges(graph))) {
@@ -203,7 +203,7 @@ SparseGEVT<K> sparse_graph_entries(const Graph& graph, EdgeWeightMap edge_weight
 		if(ea < eb) {
 			std::swap(ea, eb);
 		}
-		entries.push_back(SparseEntry{ea, eb, ew});
+		entries.push_back(SparseEntry{static_cast<unsigned int>(ea), static_cast<unsigned int>(eb), ew});
 		diag[ea] += ew;
 		diag[eb] += ew;
 	}
@@ -31,6 +31,10 @@ struct ThreadingOptions
 		return ThreadingOptions{ Danvil::CpuCount(), 0 };
 	}
 
+	static ThreadingOptions UseThreads(unsigned int thread_count) {
+		return ThreadingOptions{ (thread_count == 0) ? 1 : thread_count, 0 };
+	}
+
 	static ThreadingOptions UsePool(unsigned int pool_id) {
 		return ThreadingOptions{ Danvil::CpuCount(), pool_id };
 	}
@@ -148,6 +152,36 @@ namespace detail
 		Process(img1.begin(), img1.end(), img2.begin(), img3.begin(), f);
 	}
 
+	template<typename F>
+	void ProcessRange(index_t begin, index_t end, F f)
+	{
+		f(begin, end);
+	}
+
+}
+
+/** Calls f(begin, end) on consecutive ranges covering [0, n), one range per thread */
+template<typename F>
+void ParallelProcessRange(index_t n, F f, ThreadingOptions opt)
+{
+	if(opt.threads() == 1 || n < opt.threads()) {
+		// do everything in this thread
+		f(0, n);
+	}
+	else {
+		detail::ThreadPoolManager pool(opt.pool());
+		// create threads
+		index_t D = n / opt.threads();
+		for(unsigned int i=0; i<opt.threads(); i++) {
+			index_t ibegin = i*D;
+			index_t iend = ibegin + D;
+			if(i + 1 == opt.threads()) {
+				// last thread must do the rest
+				iend = n;
+			}
+			pool().schedule(boost::bind(&detail::ProcessRange<F>, ibegin, iend, f));
+		}
+	}
 }
 
 template<typename T1, typename F>
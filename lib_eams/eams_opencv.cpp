@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include "segm/msImageProcessor.h"
+#include "edge/BgImage.h"
+#include "edge/BgDefaults.h"
+#include "edge/BgEdge.h"
+#include "edge/BgEdgeList.h"
+#include "edge/BgEdgeDetect.h"
+#include "eams_opencv.h"
+
+/** \brief Used by msSysPrompt.cpp, disables the progress prompt.
+ */
+bool CmCDisplayProgress = false;
+
+/** \brief RGB2Luv.m for RGB values in [0,1].
+ */
+void rgb2luv(float R, float G, float B, float &L, float &u, float &v) {
+    
+    const float Lt = 0.008856f;
+    const float Up = 0.19784977571475f;
+    const float Vp = 0.46834507665248f;
+    
+    float x = 0.4125f*R + 0.3576f*G + 0.1804f*B;
+    float y = 0.2125f*R + 0.7154f*G + 0.0721f*B;
+    float z = 0.0193f*R + 0.1192f*G + 0.9502f*B;
+    
+    if (y > Lt) {
+        L = 116*std::pow(y, 1.f/3.f) - 16;
+    }
+    else {
+        L = 903.3f*y;
+    }
+    
+    float c = x + 15*y + 3*z;
+    float u_prime = 4;
+    float v_prime = 9.f/15.f;
+    if (c != 0) {
+        u_prime = 4*x/c;
+        v_prime = 9*y/c;
+    }
+    
+    u = 13*L*(u_prime - Up);
+    v = 13*L*(v_prime - Vp);
+}
+
+void EAMS_OpenCV::computeSuperpixels(const cv::Mat &image, int bandwidth, 
+        float range_bandwidth, int minimum_size, bool rgb, int speedup, 
+        bool parallel, bool graph_fusion, cv::Mat &labels) {
+    
+    assert(image.channels() == 3);
+    assert(speedup >= 1 && speedup <= 3);
+    
+    // Defaults of edison_wrapper.m for the synergistic segmentation.
+    const int gradient_window_radius = 2;
+    const float mixture = 0.3f;
+    const float edge_threshold = 0.3f;
+    
+    const int rows = image.rows;
+    const int cols = image.cols;
+    
+    // Row major and interleaved, as edison_wrapper_mex.cpp after permuting.
+    std::vector<unsigned char> rgb_data(3*rows*cols);
+    std::vector<float> features(3*rows*cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            const cv::Vec3b &bgr = image.at<cv::Vec3b>(i, j);
+            const int k = 3*(i*cols + j);
+            
+            rgb_data[k] = bgr[2];
+            rgb_data[k + 1] = bgr[1];
+            rgb_data[k + 2] = bgr[0];
+            
+            if (rgb) {
+                features[k] = bgr[2];
+                features[k + 1] = bgr[1];
+                features[k + 2] = bgr[0];
+            }
+            else {
+                rgb2luv(bgr[2]/255.f, bgr[1]/255.f, bgr[0]/255.f, 
+                        features[k], features[k + 1], features[k + 2]);
+            }
+        }
+    }
+    
+    msImageProcessor ms;
+    ms.DefineLInput(&features[0], rows, cols, 3);
+    assert(ms.ErrorStatus != EL_ERROR);
+    
+    kernelType kernel[2] = {Uniform, Uniform};
+    int P[2] = {2, 3};
+    float h[2] = {1, 1};
+    ms.DefineKernel(kernel, h, P, 2);
+    assert(ms.ErrorStatus != EL_ERROR);
+    
+    std::vector<float> confidence(rows*cols);
+    std::vector<float> gradient(rows*cols);
+    std::vector<float> weights(rows*cols);
+    
+    BgImage bg_image;
+    bg_image.SetImage(&rgb_data[0], cols, rows, true);
+    BgEdgeDetect edge_detector(gradient_window_radius);
+    edge_detector.ComputeEdgeInfo(&bg_image, &confidence[0], &gradient[0]);
+    
+    for (int k = 0; k < rows*cols; k++) {
+        weights[k] = (gradient[k] > 0.002f) 
+                ? mixture*gradient[k] + (1 - mixture)*confidence[k] : 0;
+    }
+    
+    ms.SetWeightMap(&weights[0], edge_threshold);
+    assert(ms.ErrorStatus != EL_ERROR);
+    
+    SpeedUpLevel levels[3] = {NO_SPEEDUP, MED_SPEEDUP, HIGH_SPEEDUP};
+    ms.SetParallelFilter(parallel);
+    ms.Filter(bandwidth, range_bandwidth, levels[speedup - 1]);
+    assert(ms.ErrorStatus != EL_ERROR);
+    
+    ms.SetGraphFusion(graph_fusion);
+    ms.FuseRegions(range_bandwidth, minimum_size);
+    assert(ms.ErrorStatus != EL_ERROR);
+    
+    int* region_labels;
+    float* modes;
+    int* counts;
+    ms.GetRegions(&region_labels, &modes, &counts);
+    
+    labels.create(rows, cols, CV_32SC1);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            labels.at<int>(i, j) = region_labels[i*cols + j];
+        }
+    }
+    
+    delete[] region_labels;
+    delete[] modes;
+    delete[] counts;
+}
@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EAMS_OPENCV_H
+#define	EAMS_OPENCV_H
+
+#include <opencv2/opencv.hpp>
+
+/** \brief Wrapper for running EAMS (EDISON mean shift) on OpenCV images,
+ * following edison_wrapper.m with synergistic segmentation and region fusion.
+ * \author David Stutz
+ */
+class EAMS_OpenCV {
+public:
+    /** \brief Compute superpixels using EAMS.
+     * \param[in] image image to compute superpixels on
+     * \param[in] bandwidth spatial bandwidth
+     * \param[in] range_bandwidth feature space bandwidth
+     * \param[in] minimum_size minimum region area
+     * \param[in] rgb whether to use RGB instead of Luv
+     * \param[in] speedup speedup level, 1 (none), 2 (medium) or 3 (high)
+     * \param[in] parallel whether to filter bands of rows in parallel
+     * \param[in] graph_fusion whether to fuse and prune regions in one pass
+     * on a region adjacency graph instead of rebuilding it in every pass
+     * \param[out] labels superpixel labels
+     */
+    static void computeSuperpixels(const cv::Mat &image, int bandwidth, 
+            float range_bandwidth, int minimum_size, bool rgb, int speedup, 
+            bool parallel, bool graph_fusion, cv::Mat &labels);
+};
+
+#endif	/* EAMS_OPENCV_H */
@@ -42,6 +42,9 @@ Implemented by Chris M. Christoudias, Bogdan Georgescu
 #include	<assert.h>
 #include	<string.h>
 #include	<stdlib.h>
+#include	<algorithm>
+#include	<queue>
+#include	<vector>
 
 /*@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@*/
 /*@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@*/
@@ -70,6 +73,12 @@ msImageProcessor::msImageProcessor( void )
 	pointList			= NULL;
 	pointCount			= 0;
 
+	//filter sequentially by default
+	parallelFilter		= false;
+
+	//fuse regions by repeatedly rebuilding the RAM by default
+	graphFusion			= false;
+
 	//initialize region list
 	regionList			= NULL;
 
@@ -105,6 +114,9 @@ msImageProcessor::msImageProcessor( void )
 
 
    LUV_treshold = 1.0;
+
+   //default of the EDISON system, used by the high speedup filter
+   speedThreshold = 0.1;
 }
 
 /*******************************************************/
@@ -399,7 +411,8 @@ void msImageProcessor::Filter(int sigmaS, float sigmaR, SpeedUpLevel speedUpLeve
 	//no speedup...
 	case NO_SPEEDUP:	
       //NonOptimizedFilter((float)(sigmaS), sigmaR);	break;
-      NewNonOptimizedFilter((float)(sigmaS), sigmaR);	break;
+      //NewNonOptimizedFilter((float)(sigmaS), sigmaR);	break;
+      LatticeFilter((float)(sigmaS), sigmaR);	break;
 	//medium speedup
 	case MED_SPEEDUP:	
       //OptimizedFilter1((float)(sigmaS), sigmaR);		break;
@@ -591,69 +604,86 @@ void msImageProcessor::FuseRegions(float sigmaS, int minRegion)
 		return;
 	}
 
+	if(graphFusion)
+	{
+		//transitive closure and pruning in one pass on a region
+		//adjacency graph that is built once
 #ifdef PROMPT
-	msSys.Prompt("Applying transitive closure...");
-	msSys.StartTimer();
+		msSys.Prompt("Fusing regions             ...");
+		msSys.StartTimer();
+#endif
+		GraphFusion(minRegion);
+#ifdef PROMPT
+		double timer	= msSys.ElapsedTime();
+		msSys.Prompt("done. (%6.2f seconds, numRegions = %6d)\n", timer, regionCount);
+#endif
+	}
+	else
+	{
+#ifdef PROMPT
+		msSys.Prompt("Applying transitive closure...");
+		msSys.StartTimer();
 #endif
 
-	//allocate memory visit table
-	visitTable = new unsigned char [L];
-
-	//Apply transitive closure iteratively to the regions classified
-	//by the RAM updating labels and modes until the color of each neighboring
-	//region is within sqrt(rR2) of one another.
-	rR2 = (float)(h[1]*h[1]*0.25);
-	TransitiveClosure();
-	int oldRC = regionCount;
-	int deltaRC, counter = 0;
-	do {
-		TransitiveClosure();
-		deltaRC = oldRC-regionCount;
-		oldRC = regionCount;
-		counter++;
-	} while ((deltaRC <= 0)&&(counter < 10));
-
-	//de-allocate memory for visit table
-	delete [] visitTable;
-	visitTable	= NULL;
+		//allocate memory visit table
+		visitTable = new unsigned char [L];
 
-	//Check to see if the algorithm is to be halted, if so then
-	//destroy output and region adjacency matrix and exit
-	if((ErrorStatus = msSys.Progress((float)(1.0))) == EL_HALT)
-	{
-		DestroyRAM();
-		DestroyOutput();
-		return;
-	}
+		//Apply transitive closure iteratively to the regions classified
+		//by the RAM updating labels and modes until the color of each neighboring
+		//region is within sqrt(rR2) of one another.
+		rR2 = (float)(h[1]*h[1]*0.25);
+		TransitiveClosure();
+		int oldRC = regionCount;
+		int deltaRC, counter = 0;
+		do {
+			TransitiveClosure();
+			deltaRC = oldRC-regionCount;
+			oldRC = regionCount;
+			counter++;
+		} while ((deltaRC <= 0)&&(counter < 10));
+
+		//de-allocate memory for visit table
+		delete [] visitTable;
+		visitTable	= NULL;
+
+		//Check to see if the algorithm is to be halted, if so then
+		//destroy output and region adjacency matrix and exit
+		if((ErrorStatus = msSys.Progress((float)(1.0))) == EL_HALT)
+		{
+			DestroyRAM();
+			DestroyOutput();
+			return;
+		}
 
 #ifdef PROMPT
-	double timer	= msSys.ElapsedTime();
-	msSys.Prompt("done. (%6.2f seconds, numRegions = %6d)\nPruning spurious regions   ...", timer, regionCount);
-	msSys.StartTimer();
+		double timer	= msSys.ElapsedTime();
+		msSys.Prompt("done. (%6.2f seconds, numRegions = %6d)\nPruning spurious regions   ...", timer, regionCount);
+		msSys.StartTimer();
 #endif
 
-	//Prune spurious regions (regions whose area is under
-	//minRegion) using RAM
-	Prune(minRegion);
+		//Prune spurious regions (regions whose area is under
+		//minRegion) using RAM
+		Prune(minRegion);
 
 #ifdef PROMPT
-	timer	= msSys.ElapsedTime();
-	msSys.Prompt("done. (%6.2f seconds, numRegions = %6d)\n", timer, regionCount);
-	msSys.StartTimer();
+		timer	= msSys.ElapsedTime();
+		msSys.Prompt("done. (%6.2f seconds, numRegions = %6d)\n", timer, regionCount);
+		msSys.StartTimer();
 #endif
 
-	//Check to see if the algorithm is to be halted, if so then
-	//destroy output and region adjacency matrix and exit
-	if((ErrorStatus = msSys.Progress((float)(1.0))) == EL_HALT)
-	{
+		//Check to see if the algorithm is to be halted, if so then
+		//destroy output and region adjacency matrix and exit
+		if((ErrorStatus = msSys.Progress((float)(1.0))) == EL_HALT)
+		{
+			DestroyRAM();
+			DestroyOutput();
+			return;
+		}
+
+		//de-allocate memory for region adjacency matrix
 		DestroyRAM();
-		DestroyOutput();
-		return;
 	}
 
-	//de-allocate memory for region adjacency matrix
-	DestroyRAM();
-
 	//output to msRawData
 	int i, j, label;
 	for(i = 0; i < L; i++)
@@ -729,69 +759,86 @@ void msImageProcessor::Segment(int sigmaS, float sigmaR, int minRegion, SpeedUpL
 		return;
 	}
 
+	if(graphFusion)
+	{
+		//transitive closure and pruning in one pass on a region
+		//adjacency graph that is built once
 #ifdef PROMPT
-	msSys.Prompt("Applying transitive closure...");
-	msSys.StartTimer();
+		msSys.Prompt("Fusing regions             ...");
+		msSys.StartTimer();
+#endif
+		GraphFusion(minRegion);
+#ifdef PROMPT
+		double timer	= msSys.ElapsedTime();
+		msSys.Prompt("done. (%6.2f seconds, numRegions = %6d)\n", timer, regionCount);
+#endif
+	}
+	else
+	{
+#ifdef PROMPT
+		msSys.Prompt("Applying transitive closure...");
+		msSys.StartTimer();
 #endif
 
-	//allocate memory visit table
-	visitTable = new unsigned char [L];
-
-	//Apply transitive closure iteratively to the regions classified
-	//by the RAM updating labels and modes until the color of each neighboring
-	//region is within sqrt(rR2) of one another.
-	rR2 = (float)(h[1]*h[1]*0.25);
-	TransitiveClosure();
-	int oldRC = regionCount;
-	int deltaRC, counter = 0;
-	do {
-		TransitiveClosure();
-		deltaRC = oldRC-regionCount;
-		oldRC = regionCount;
-		counter++;
-	} while ((deltaRC <= 0)&&(counter < 10));
-
-	//de-allocate memory for visit table
-	delete [] visitTable;
-	visitTable	= NULL;
+		//allocate memory visit table
+		visitTable = new unsigned char [L];
 
-	//Check to see if the algorithm is to be halted, if so then
-	//destroy output and regions adjacency matrix and exit
-	if((ErrorStatus = msSys.Progress((float)(0.95))) == EL_HALT)
-	{
-		DestroyRAM();
-		DestroyOutput();
-		return;
-	}
+		//Apply transitive closure iteratively to the regions classified
+		//by the RAM updating labels and modes until the color of each neighboring
+		//region is within sqrt(rR2) of one another.
+		rR2 = (float)(h[1]*h[1]*0.25);
+		TransitiveClosure();
+		int oldRC = regionCount;
+		int deltaRC, counter = 0;
+		do {
+			TransitiveClosure();
+			deltaRC = oldRC-regionCount;
+			oldRC = regionCount;
+			counter++;
+		} while ((deltaRC <= 0)&&(counter < 10));
+
+		//de-allocate memory for visit table
+		delete [] visitTable;
+		visitTable	= NULL;
+
+		//Check to see if the algorithm is to be halted, if so then
+		//destroy output and regions adjacency matrix and exit
+		if((ErrorStatus = msSys.Progress((float)(0.95))) == EL_HALT)
+		{
+			DestroyRAM();
+			DestroyOutput();
+			return;
+		}
 
 #ifdef PROMPT
-	double timer	= msSys.ElapsedTime();
-	msSys.Prompt("done. (%6.2f seconds, numRegions = %6d).\nPruning spurious regions\t... ", timer, regionCount);
-	msSys.StartTimer();
+		double timer	= msSys.ElapsedTime();
+		msSys.Prompt("done. (%6.2f seconds, numRegions = %6d).\nPruning spurious regions\t... ", timer, regionCount);
+		msSys.StartTimer();
 #endif
 
-	//Prune spurious regions (regions whose area is under
-	//minRegion) using RAM
-	Prune(minRegion);
+		//Prune spurious regions (regions whose area is under
+		//minRegion) using RAM
+		Prune(minRegion);
 
 #ifdef PROMPT
-	timer	= msSys.ElapsedTime();
-	msSys.Prompt("done. (%6.2f seconds, numRegions = %6d)\nPruning spurious regions    ...", timer, regionCount);
-	msSys.StartTimer();
+		timer	= msSys.ElapsedTime();
+		msSys.Prompt("done. (%6.2f seconds, numRegions = %6d)\nPruning spurious regions    ...", timer, regionCount);
+		msSys.StartTimer();
 #endif
 
-	//Check to see if the algorithm is to be halted, if so then
-	//destroy output and regions adjacency matrix and exit
-	if((ErrorStatus = msSys.Progress(1.0)) == EL_HALT)
-	{
+		//Check to see if the algorithm is to be halted, if so then
+		//destroy output and regions adjacency matrix and exit
+		if((ErrorStatus = msSys.Progress(1.0)) == EL_HALT)
+		{
+			DestroyRAM();
+			DestroyOutput();
+			return;
+		}
+
+		//de-allocate memory for region adjacency matrix
 		DestroyRAM();
-		DestroyOutput();
-		return;
 	}
 
-	//de-allocate memory for region adjacency matrix
-	DestroyRAM();
-
 	//output to msRawData
 	int j, i, label;
 	for(i = 0; i < L; i++)
@@ -2968,6 +3015,330 @@ void msImageProcessor::Prune(int minRegion)
 	
 }
 
+/*******************************************************/
+/*Graph Fusion                                         */
+/*******************************************************/
+/*Applies transitive closure and pruning in one pass   */
+/*on a region adjacency graph that is built once.      */
+/*Regions are joined using union-find: neighbors in    */
+/*the order of the distance of their modes, spurious   */
+/*regions in the order of their area. Modes, point     */
+/*counts and edge strengths of joined regions are      */
+/*accumulated instead of re-computing the RAM after    */
+/*each pass.                                           */
+/*******************************************************/
+/*Pre:                                                 */
+/*      - the classification data structure has been   */
+/*        constructed.                                 */
+/*      - minRegion is the minimum allowable pixel de- */
+/*        nsity a region may have without being pruned */
+/*        from the image                               */
+/*Post:                                                */
+/*      - neighboring regions whose modes are within   */
+/*        the range window and whose edge strength is  */
+/*        below epsilon have been joined.              */
+/*      - regions whose pixel density is less than     */
+/*        minRegion have been joined with the neigh-   */
+/*        bor having the closest mode.                 */
+/*      - labels, modes, modePointCounts and region-   */
+/*        Count have been updated accordingly.         */
+/*******************************************************/
+
+namespace {
+
+// edge of the region adjacency graph, strengths are accumulated over
+// the boundary pixels as in ComputeEdgeStrengths
+struct FusionEdge
+{
+	int		label;
+	float	strengthSum;
+	int		pixelCount;
+};
+
+// queued pair of regions (closure) or region (pruning, b = -1); the
+// stamps identify the modes the key was computed with
+struct FusionCandidate
+{
+	float	key;
+	int		a, b;
+	int		stampA, stampB;
+
+	bool operator<(const FusionCandidate &other) const
+	{
+		// std::priority_queue pops the largest element
+		return key > other.key;
+	}
+};
+
+// adds an edge to an adjacency list, successive pixels along a boundary
+// usually see the same neighbor so these are combined right away
+void AddFusionEdge(std::vector<FusionEdge> &edges, const FusionEdge &edge)
+{
+	if((!edges.empty())&&(edges.back().label == edge.label))
+	{
+		edges.back().strengthSum	+= edge.strengthSum;
+		edges.back().pixelCount		+= edge.pixelCount;
+	}
+	else
+		edges.push_back(edge);
+}
+
+}
+
+void msImageProcessor::GraphFusion(int minRegion)
+{
+
+	//Step (1):
+
+	//Build the region adjacency graph looking to the right of
+	//and below each pixel, accumulating edge strengths (excluding
+	//the image boundary)
+	int		i, j, k, dp, curLabel, rightLabel, bottomLabel;
+	std::vector<std::vector<FusionEdge> > adjacency(regionCount);
+	for(i = 0; i < height; i++)
+	{
+		for(j = 0; j < width; j++)
+		{
+			dp			= i*width + j;
+			curLabel	= labels[dp];
+			bool interior	= (i > 0)&&(i < height-1)&&(j > 0)&&(j < width-1);
+
+			rightLabel	= (j < width-1) ? labels[dp+1] : curLabel;
+			bottomLabel	= (i < height-1) ? labels[dp+width] : curLabel;
+
+			if(curLabel != rightLabel)
+			{
+				FusionEdge edge = {rightLabel, 0, 0};
+				if(interior)
+				{
+					edge.strengthSum	= weightMap[dp] + weightMap[dp+1];
+					edge.pixelCount		= 2;
+				}
+				AddFusionEdge(adjacency[curLabel], edge);
+				edge.label	= curLabel;
+				AddFusionEdge(adjacency[rightLabel], edge);
+			}
+
+			if(curLabel != bottomLabel)
+			{
+				FusionEdge edge = {bottomLabel, 0, 0};
+				if(interior)
+				{
+					edge.strengthSum	= weightMap[dp+width];
+					edge.pixelCount		= 1;
+					if(curLabel == rightLabel)
+					{
+						edge.strengthSum   += weightMap[dp];
+						edge.pixelCount++;
+					}
+				}
+				AddFusionEdge(adjacency[curLabel], edge);
+				edge.label	= curLabel;
+				AddFusionEdge(adjacency[bottomLabel], edge);
+			}
+		}
+	}
+
+	//disjoint sets, accumulated modes and the stamp of each region
+	//which is incremented whenever its mode changes
+	std::vector<int>	parent(regionCount), size(regionCount), stamp(regionCount, 0);
+	std::vector<double>	modeSums(N*regionCount);
+	for(i = 0; i < regionCount; i++)
+	{
+		parent[i]	= i;
+		size[i]		= modePointCounts[i];
+		for(k = 0; k < N; k++)
+			modeSums[N*i+k]	= (double) size[i]*modes[N*i+k];
+	}
+
+	auto find = [&parent](int x) -> int
+	{
+		while(parent[x] != x)
+		{
+			parent[x]	= parent[parent[x]];
+			x			= parent[x];
+		}
+		return x;
+	};
+
+	//combines edges to the same (canonical) neighbor, removing edges
+	//to the region itself
+	std::vector<int> slot(regionCount, -1);
+	auto compact = [&](int x)
+	{
+		std::vector<FusionEdge> &edges = adjacency[x];
+		std::size_t count = 0;
+		for(std::size_t e = 0; e < edges.size(); e++)
+		{
+			int neighbor = find(edges[e].label);
+			if(neighbor == x)
+				continue;
+
+			if(slot[neighbor] < 0)
+			{
+				slot[neighbor]		= count;
+				edges[count]		= edges[e];
+				edges[count].label	= neighbor;
+				count++;
+			}
+			else
+			{
+				edges[slot[neighbor]].strengthSum	+= edges[e].strengthSum;
+				edges[slot[neighbor]].pixelCount	+= edges[e].pixelCount;
+			}
+		}
+		edges.resize(count);
+		for(std::size_t e = 0; e < count; e++)
+			slot[edges[e].label]	= -1;
+	};
+
+	//joins two canonical elements, the one with the longer adjacency
+	//list becomes the canonical element of the joint region
+	auto join = [&](int x, int y) -> int
+	{
+		if(adjacency[x].size() < adjacency[y].size())
+			std::swap(x, y);
+
+		parent[y]	= x;
+		size[x]	   += size[y];
+		for(int p = 0; p < N; p++)
+		{
+			modeSums[N*x+p]	+= modeSums[N*y+p];
+			modes[N*x+p]	 = (float) (modeSums[N*x+p]/size[x]);
+		}
+		stamp[x]++;
+
+		adjacency[x].insert(adjacency[x].end(), adjacency[y].begin(), adjacency[y].end());
+		std::vector<FusionEdge>().swap(adjacency[y]);
+		compact(x);
+		return x;
+	};
+
+	auto strength = [this](const FusionEdge &edge) -> float
+	{
+		//without weight map the edge strengths remain zero
+		if((!weightMapDefined)||(edge.pixelCount == 0))
+			return 0;
+		return edge.strengthSum/edge.pixelCount;
+	};
+
+	//Step (2):
+
+	//Transitive closure: join neighboring regions in the order of the
+	//distance of their modes; only pairs which may be joined are queued,
+	//after each join the edges of the joint region are queued again
+	//using its new mode
+	std::priority_queue<FusionCandidate> queue;
+	auto enqueue = [&](int x, int minNeighbor)
+	{
+		for(std::size_t e = 0; e < adjacency[x].size(); e++)
+		{
+			const FusionEdge &edge = adjacency[x][e];
+			if((edge.label > minNeighbor)&&(strength(edge) < epsilon)&&(InWindow(x, edge.label)))
+			{
+				FusionCandidate candidate = {SqDistance(x, edge.label), x, edge.label,
+					stamp[x], stamp[edge.label]};
+				queue.push(candidate);
+			}
+		}
+	};
+
+	for(i = 0; i < regionCount; i++)
+	{
+		compact(i);
+		enqueue(i, i);
+	}
+
+	while(!queue.empty())
+	{
+		FusionCandidate candidate = queue.top();
+		queue.pop();
+
+		//skip pairs whose regions have been joined or whose modes
+		//have changed since, these have been queued again
+		if((parent[candidate.a] != candidate.a)||(parent[candidate.b] != candidate.b)
+			||(stamp[candidate.a] != candidate.stampA)||(stamp[candidate.b] != candidate.stampB))
+			continue;
+
+		enqueue(join(candidate.a, candidate.b), -1);
+	}
+
+	//Step (3):
+
+	//Pruning: join regions whose area is less than minRegion, smallest
+	//first, with the neighbor having the closest mode
+	for(i = 0; i < regionCount; i++)
+	{
+		if((parent[i] == i)&&(size[i] < minRegion))
+		{
+			FusionCandidate candidate = {(float) size[i], i, -1, stamp[i], 0};
+			queue.push(candidate);
+		}
+	}
+
+	while(!queue.empty())
+	{
+		FusionCandidate candidate = queue.top();
+		queue.pop();
+
+		int x = candidate.a;
+		if((parent[x] != x)||(stamp[x] != candidate.stampA))
+			continue;
+
+		//select the candidate region, the neighbors are canonical as
+		//adjacency lists are compacted after each join
+		compact(x);
+		int		neighbor = -1;
+		float	minSqDistance = 0, neighborDistance;
+		for(std::size_t e = 0; e < adjacency[x].size(); e++)
+		{
+			neighborDistance = SqDistance(x, adjacency[x][e].label);
+			if((neighbor < 0)||(neighborDistance < minSqDistance))
+			{
+				minSqDistance	= neighborDistance;
+				neighbor		= adjacency[x][e].label;
+			}
+		}
+
+		//a region without neighbors covers the whole image
+		if(neighbor < 0)
+			continue;
+
+		x = join(x, neighbor);
+		if(size[x] < minRegion)
+		{
+			FusionCandidate next = {(float) size[x], x, -1, stamp[x], 0};
+			queue.push(next);
+		}
+	}
+
+	//Step (4):
+
+	//Re-label the regions in the order of their first pixel, computing
+	//their modes and point counts
+	std::vector<int> label_buffer(regionCount, -1);
+	int label = -1;
+	for(i = 0; i < regionCount; i++)
+	{
+		int iCanEl = find(i);
+		if(label_buffer[iCanEl] < 0)
+		{
+			label_buffer[iCanEl]	= ++label;
+			for(k = 0; k < N; k++)
+				modes[(N*label)+k]	= (float) (modeSums[N*iCanEl+k]/size[iCanEl]);
+			modePointCounts[label]	= size[iCanEl];
+		}
+	}
+
+	regionCount	= label+1;
+	for(i = 0; i < height*width; i++)
+		labels[i]	= label_buffer[find(labels[i])];
+
+	//done.
+	return;
+
+}
+
 /*******************************************************/
 /*Define Boundaries                                    */
 /*******************************************************/
@@ -3351,11 +3722,6 @@ void msImageProcessor::NewOptimizedFilter1(float sigmaS, float sigmaR)
 	// Traverse each data point applying mean shift
 	// to each data point
 	
-	// Allcocate memory for yk
-	double	*yk		= new double [lN];
-	
-	// Allocate memory for Mh
-	double	*Mh		= new double [lN];
 
    // let's use some temporary data
    float* sdata;
@@ -3468,7 +3834,29 @@ void msImageProcessor::NewOptimizedFilter1(float sigmaS, float sigmaR)
 #endif
 
 
-	for(i = 0; i < L; i++)
+	// With parallelFilter the image is split into bands of FILTER_BAND_ROWS
+	// rows that are filtered in parallel; the basin of attraction of a band
+	// is restricted to its own pixels such that the result does not depend
+	// on the number of threads.
+	int bandRows	= parallelFilter ? FILTER_BAND_ROWS : height;
+	int bandCount	= (height + bandRows - 1)/bandRows;
+	int band;
+
+#pragma omp parallel for schedule(dynamic) if(parallelFilter) private(iterationCount, i, j, k, modeCandidateX, modeCandidateY, modeCandidate_i, mvAbs, diff, el, idxs, idxd, cBuck1, cBuck2, cBuck3, cBuck, wsuml, weight)
+	for(band = 0; band < bandCount; band++)
+	{
+	int bandBegin	= band*bandRows*width;
+	int bandEnd		= (bandBegin + bandRows*width < L) ? bandBegin + bandRows*width : L;
+	int *bandPointList	= pointList + bandBegin;
+	int bandPointCount	= 0;
+
+	// Allcocate memory for yk
+	double	*yk		= new double [lN];
+	
+	// Allocate memory for Mh
+	double	*Mh		= new double [lN];
+
+	for(i = bandBegin; i < bandEnd; i++)
 	{
 		// if a mode was already assigned to this data point
 		// then skip this point, otherwise proceed to
@@ -3477,7 +3865,7 @@ void msImageProcessor::NewOptimizedFilter1(float sigmaS, float sigmaR)
 			continue;
 
 		// initialize point list...
-		pointCount = 0;
+		bandPointCount = 0;
 
 		// Assign window center (window centers are
 		// initialized by createLattice to be the point
@@ -3596,7 +3984,8 @@ void msImageProcessor::NewOptimizedFilter1(float sigmaS, float sigmaR)
 			//     to (modeTable[basin_i] = 1), so assign to
 			//     this data point the same mode as that of basin_i
 
-			if ((modeTable[modeCandidate_i] != 2) && (modeCandidate_i != i))
+			if ((modeCandidate_i >= bandBegin) && (modeCandidate_i < bandEnd)
+				&& (modeTable[modeCandidate_i] != 2) && (modeCandidate_i != i))
 			{
 				// obtain the data point at basin_i to
 				// see if it is within h*TC_DIST_FACTOR of
@@ -3623,7 +4012,7 @@ void msImageProcessor::NewOptimizedFilter1(float sigmaS, float sigmaR)
 					{
 						// no mode associated yet so associate
 						// it with this one...
-						pointList[pointCount++]		= modeCandidate_i;
+						bandPointList[bandPointCount++]		= modeCandidate_i;
 						modeTable[modeCandidate_i]	= 2;
 
 					} else
@@ -3756,11 +4145,11 @@ void msImageProcessor::NewOptimizedFilter1(float sigmaS, float sigmaR)
 		// associate the data point indexed by
 		// the point list with the mode stored
 		// by yk
-		for (j = 0; j < pointCount; j++)
+		for (j = 0; j < bandPointCount; j++)
 		{
 			// obtain the point location from the
 			// point list
-			modeCandidate_i = pointList[j];
+			modeCandidate_i = bandPointList[j];
 
 			// update the mode table for this point
 			modeTable[modeCandidate_i] = 1;
@@ -3776,14 +4165,21 @@ void msImageProcessor::NewOptimizedFilter1(float sigmaS, float sigmaR)
 
 		// Prompt user on progress
 #ifdef SHOW_PROGRESS
+		if(!parallelFilter)
+		{
 		percent_complete = (float)(i/(float)(L))*100;
 		msSys.Prompt("\r%2d%%", (int)(percent_complete + 0.5));
+		}
 #endif
 	
 		// Check to see if the algorithm has been halted
-		if((i%PROGRESS_RATE == 0)&&((ErrorStatus = msSys.Progress((float)(i/(float)(L))*(float)(0.8)))) == EL_HALT)
+		if(!parallelFilter&&(i%PROGRESS_RATE == 0)&&((ErrorStatus = msSys.Progress((float)(i/(float)(L))*(float)(0.8)))) == EL_HALT)
 			break;		
 	}
+
+	delete [] yk;
+	delete [] Mh;
+	}
 	
 	// Prompt user that filtering is completed
 #ifdef PROMPT
@@ -3796,9 +4192,6 @@ void msImageProcessor::NewOptimizedFilter1(float sigmaS, float sigmaR)
    delete [] buckets;
    delete [] slist;
    delete [] sdata;
-
-	delete [] yk;
-	delete [] Mh;
 	
 	// done.
 	return;
@@ -3833,11 +4226,6 @@ void msImageProcessor::NewOptimizedFilter2(float sigmaS, float sigmaR)
 	// Traverse each data point applying mean shift
 	// to each data point
 	
-	// Allcocate memory for yk
-	double	*yk		= new double [lN];
-	
-	// Allocate memory for Mh
-	double	*Mh		= new double [lN];
 
    // let's use some temporary data
    float* sdata;
@@ -3950,7 +4338,29 @@ void msImageProcessor::NewOptimizedFilter2(float sigmaS, float sigmaR)
 #endif
 
 
-	for(i = 0; i < L; i++)
+	// With parallelFilter the image is split into bands of FILTER_BAND_ROWS
+	// rows that are filtered in parallel; the basin of attraction of a band
+	// is restricted to its own pixels such that the result does not depend
+	// on the number of threads.
+	int bandRows	= parallelFilter ? FILTER_BAND_ROWS : height;
+	int bandCount	= (height + bandRows - 1)/bandRows;
+	int band;
+
+#pragma omp parallel for schedule(dynamic) if(parallelFilter) private(iterationCount, i, j, k, modeCandidateX, modeCandidateY, modeCandidate_i, mvAbs, diff, el, idxs, idxd, cBuck1, cBuck2, cBuck3, cBuck, wsuml, weight)
+	for(band = 0; band < bandCount; band++)
+	{
+	int bandBegin	= band*bandRows*width;
+	int bandEnd		= (bandBegin + bandRows*width < L) ? bandBegin + bandRows*width : L;
+	int *bandPointList	= pointList + bandBegin;
+	int bandPointCount	= 0;
+
+	// Allcocate memory for yk
+	double	*yk		= new double [lN];
+	
+	// Allocate memory for Mh
+	double	*Mh		= new double [lN];
+
+	for(i = bandBegin; i < bandEnd; i++)
 	{
 		// if a mode was already assigned to this data point
 		// then skip this point, otherwise proceed to
@@ -3959,7 +4369,7 @@ void msImageProcessor::NewOptimizedFilter2(float sigmaS, float sigmaR)
 			continue;
 
 		// initialize point list...
-		pointCount = 0;
+		bandPointCount = 0;
 
 		// Assign window center (window centers are
 		// initialized by createLattice to be the point
@@ -4018,11 +4428,11 @@ void msImageProcessor::NewOptimizedFilter2(float sigmaS, float sigmaR)
                   wsuml += weight;
 
       				//set basin of attraction mode table
-                  if (diff < speedThreshold)
+                  if ((diff < speedThreshold) && (idxd >= bandBegin) && (idxd < bandEnd))
                   {
 				         if(modeTable[idxd] == 0)
 				         {
-         					pointList[pointCount++]	= idxd;
+         					bandPointList[bandPointCount++]	= idxd;
 					         modeTable[idxd]	= 2;
       				   }
                   }
@@ -4088,7 +4498,8 @@ void msImageProcessor::NewOptimizedFilter2(float sigmaS, float sigmaR)
 			//     to (modeTable[basin_i] = 1), so assign to
 			//     this data point the same mode as that of basin_i
 
-			if ((modeTable[modeCandidate_i] != 2) && (modeCandidate_i != i))
+			if ((modeCandidate_i >= bandBegin) && (modeCandidate_i < bandEnd)
+				&& (modeTable[modeCandidate_i] != 2) && (modeCandidate_i != i))
 			{
 				// obtain the data point at basin_i to
 				// see if it is within h*TC_DIST_FACTOR of
@@ -4115,7 +4526,7 @@ void msImageProcessor::NewOptimizedFilter2(float sigmaS, float sigmaR)
 					{
 						// no mode associated yet so associate
 						// it with this one...
-						pointList[pointCount++]		= modeCandidate_i;
+						bandPointList[bandPointCount++]		= modeCandidate_i;
 						modeTable[modeCandidate_i]	= 2;
 
 					} else
@@ -4197,11 +4608,11 @@ void msImageProcessor::NewOptimizedFilter2(float sigmaS, float sigmaR)
                      wsuml += weight;
 
          				//set basin of attraction mode table
-                     if (diff < speedThreshold)
+                     if ((diff < speedThreshold) && (idxd >= bandBegin) && (idxd < bandEnd))
                      {
    				         if(modeTable[idxd] == 0)
 				            {
-            					pointList[pointCount++]	= idxd;
+            					bandPointList[bandPointCount++]	= idxd;
 					            modeTable[idxd]	= 2;
       				      }
                      }
@@ -4259,11 +4670,11 @@ void msImageProcessor::NewOptimizedFilter2(float sigmaS, float sigmaR)
 		// associate the data point indexed by
 		// the point list with the mode stored
 		// by yk
-		for (j = 0; j < pointCount; j++)
+		for (j = 0; j < bandPointCount; j++)
 		{
 			// obtain the point location from the
 			// point list
-			modeCandidate_i = pointList[j];
+			modeCandidate_i = bandPointList[j];
 
 			// update the mode table for this point
 			modeTable[modeCandidate_i] = 1;
@@ -4279,14 +4690,21 @@ void msImageProcessor::NewOptimizedFilter2(float sigmaS, float sigmaR)
 
 		// Prompt user on progress
 #ifdef SHOW_PROGRESS
+		if(!parallelFilter)
+		{
 		percent_complete = (float)(i/(float)(L))*100;
 		msSys.Prompt("\r%2d%%", (int)(percent_complete + 0.5));
+		}
 #endif
 	
 		// Check to see if the algorithm has been halted
-		if((i%PROGRESS_RATE == 0)&&((ErrorStatus = msSys.Progress((float)(i/(float)(L))*(float)(0.8)))) == EL_HALT)
+		if(!parallelFilter&&(i%PROGRESS_RATE == 0)&&((ErrorStatus = msSys.Progress((float)(i/(float)(L))*(float)(0.8)))) == EL_HALT)
 			break;		
 	}
+
+	delete [] yk;
+	delete [] Mh;
+	}
 	
 	// Prompt user that filtering is completed
 #ifdef PROMPT
@@ -4299,9 +4717,6 @@ void msImageProcessor::NewOptimizedFilter2(float sigmaS, float sigmaR)
    delete [] buckets;
    delete [] slist;
    delete [] sdata;
-
-	delete [] yk;
-	delete [] Mh;
 	
 	// done.
 	return;
@@ -4336,11 +4751,6 @@ void msImageProcessor::NewNonOptimizedFilter(float sigmaS, float sigmaR)
 	// Traverse each data point applying mean shift
 	// to each data point
 	
-	// Allcocate memory for yk
-	double	*yk		= new double [lN];
-	
-	// Allocate memory for Mh
-	double	*Mh		= new double [lN];
 
    // let's use some temporary data
    double* sdata;
@@ -4448,7 +4858,25 @@ void msImageProcessor::NewNonOptimizedFilter(float sigmaS, float sigmaR)
 #endif
 #endif
 
-	for(i = 0; i < L; i++)
+	// With parallelFilter the image is split into bands of FILTER_BAND_ROWS
+	// rows that are filtered in parallel.
+	int bandRows	= parallelFilter ? FILTER_BAND_ROWS : height;
+	int bandCount	= (height + bandRows - 1)/bandRows;
+	int band;
+
+#pragma omp parallel for schedule(dynamic) if(parallelFilter) private(iterationCount, i, j, k, mvAbs, diff, el, idxs, idxd, cBuck1, cBuck2, cBuck3, cBuck, wsuml, weight)
+	for(band = 0; band < bandCount; band++)
+	{
+	int bandBegin	= band*bandRows*width;
+	int bandEnd		= (bandBegin + bandRows*width < L) ? bandBegin + bandRows*width : L;
+
+	// Allcocate memory for yk
+	double	*yk		= new double [lN];
+	
+	// Allocate memory for Mh
+	double	*Mh		= new double [lN];
+
+	for(i = bandBegin; i < bandEnd; i++)
 	{
 
 		// Assign window center (window centers are
@@ -4632,14 +5060,21 @@ void msImageProcessor::NewNonOptimizedFilter(float sigmaS, float sigmaR)
 
 		// Prompt user on progress
 #ifdef SHOW_PROGRESS
+		if(!parallelFilter)
+		{
 		percent_complete = (float)(i/(float)(L))*100;
 		msSys.Prompt("\r%2d%%", (int)(percent_complete + 0.5));
+		}
 #endif
 	
 		// Check to see if the algorithm has been halted
-		if((i%PROGRESS_RATE == 0)&&((ErrorStatus = msSys.Progress((float)(i/(float)(L))*(float)(0.8)))) == EL_HALT)
+		if(!parallelFilter&&(i%PROGRESS_RATE == 0)&&((ErrorStatus = msSys.Progress((float)(i/(float)(L))*(float)(0.8)))) == EL_HALT)
 			break;
 	}
+
+	delete [] yk;
+	delete [] Mh;
+	}
 	
 	// Prompt user that filtering is completed
 #ifdef PROMPT
@@ -4654,8 +5089,244 @@ void msImageProcessor::NewNonOptimizedFilter(float sigmaS, float sigmaR)
    delete [] slist;
    delete [] sdata;
 
-	delete [] yk;
-	delete [] Mh;
+	// done.
+	return;
+
+}
+
+/*******************************************************/
+/*Lattice Filter                                       */
+/*******************************************************/
+/*Performs mean shift filtering on the lattice like    */
+/*NewNonOptimizedFilter, without the bucket lists.     */
+/*******************************************************/
+/*Pre:                                                 */
+/*      - sigmaS is the spatial radius, sigmaR the     */
+/*        range radius; gray images are passed on to   */
+/*        NewNonOptimizedFilter                        */
+/*Post:                                                */
+/*      - the image is filtered and stored into        */
+/*        msRawData.                                   */
+/*******************************************************/
+/*The spatial window is scanned row by row, each row   */
+/*restricted to the columns inside the window. The     */
+/*range data is stored per channel (structure of       */
+/*arrays) such that spatial and range kernel are       */
+/*evaluated in vectorized loops over the columns. The  */
+/*mean shift vector is accumulated in float relative   */
+/*to the window center, results differ from            */
+/*NewNonOptimizedFilter only by rounding.              */
+/*******************************************************/
+
+void msImageProcessor::LatticeFilter(float sigmaS, float sigmaR)
+{
+
+	//make sure that a lattice height and width have
+	//been defined...
+	if(!height)
+	{
+		ErrorHandler("msImageProcessor", "LFilter", "Lattice height and width are undefined.");
+		return;
+	}
+
+	//re-assign bandwidths to sigmaS and sigmaR
+	if(((h[0] = sigmaS) <= 0)||((h[1] = sigmaR) <= 0))
+	{
+		ErrorHandler("msImageProcessor", "Segment", "sigmaS and/or sigmaR is zero or negative.");
+		return;
+	}
+
+	//for gray images the bucket lists of NewNonOptimizedFilter prune most
+	//of the spatial window by range and are faster
+	if(N != 3)
+	{
+		NewNonOptimizedFilter(sigmaS, sigmaR);
+		return;
+	}
+
+	//define input data dimension with lattice
+	int lN	= N + 2;
+
+	// scaled range data, one plane per channel
+	float *planes	= new float [N*L];
+	int i, j, k;
+	for(i = 0; i < L; i++)
+	{
+		for(k = 0; k < N; k++)
+			planes[k*L+i] = data[i*N+k]/sigmaR;
+	}
+	float *plane0	= planes;
+	float *plane1	= planes + L;
+	float *plane2	= planes + 2*L;
+
+	// scaled lattice coordinates
+	float *xs	= new float [width];
+	float *ys	= new float [height];
+	for(i = 0; i < width; i++)
+		xs[i] = i/sigmaS;
+	for(i = 0; i < height; i++)
+		ys[i] = i/sigmaS;
+
+	double hiLTr = 80.0/sigmaR;
+
+	// proceed ...
+#ifdef PROMPT
+	msSys.Prompt("done.\nApplying mean shift (Using Lattice)... ");
+#ifdef SHOW_PROGRESS
+	msSys.Prompt("\n 0%%");
+#endif
+#endif
+
+	// With parallelFilter the image is split into bands of FILTER_BAND_ROWS
+	// rows that are filtered in parallel.
+	int bandRows	= parallelFilter ? FILTER_BAND_ROWS : height;
+	int bandCount	= (height + bandRows - 1)/bandRows;
+	int band;
+
+#pragma omp parallel for schedule(dynamic) if(parallelFilter) private(i, j, k)
+	for(band = 0; band < bandCount; band++)
+	{
+	int bandBegin	= band*bandRows*width;
+	int bandEnd		= (bandBegin + bandRows*width < L) ? bandBegin + bandRows*width : L;
+
+	double	yk[5], Mh[5];
+	double	mvAbs;
+	int		iterationCount;
+
+	for(i = bandBegin; i < bandEnd; i++)
+	{
+		// Assign window center
+		yk[0] = xs[i%width];
+		yk[1] = ys[i/width];
+		for(j = 0; j < N; j++)
+			yk[j+2] = planes[j*L+i];
+
+		iterationCount = 0;
+		do
+		{
+			// Shift window location
+			if(iterationCount > 0)
+			{
+				for(j = 0; j < lN; j++)
+					yk[j] += Mh[j];
+			}
+
+			// Calculate the mean shift vector over the rows of the
+			// spatial window
+			float cx		= (float) yk[0];
+			float cy		= (float) yk[1];
+			float c0		= (float) yk[2];
+			float c1		= (float) yk[3];
+			float c2		= (float) yk[4];
+			float factor0	= (yk[2] > hiLTr) ? 4.0f : 1.0f;
+			double	wsum = 0, msum[5] = {0, 0, 0, 0, 0};
+
+			// rows of the spatial window (all pixels with a scaled
+			// distance below one are inside), clamped to the image
+			int rowMin	= (int) floor(sigmaS*cy - sigmaS);
+			int rowMax	= (int) ceil(sigmaS*cy + sigmaS);
+			rowMin		= (rowMin < 0) ? 0 : rowMin;
+			rowMax		= (rowMax > height - 1) ? height - 1 : rowMax;
+
+			for(int row = rowMin; row <= rowMax; row++)
+			{
+				const float dy	= ys[row] - cy;
+				const float dy2	= dy*dy;
+				if(dy2 >= 1.0f)
+					continue;
+
+				// columns of the spatial window in this row
+				float half	= sigmaS*sqrtf(1.0f - dy2);
+				int colMin	= (int) floor(sigmaS*cx - half);
+				int colMax	= (int) ceil(sigmaS*cx + half);
+				colMin		= (colMin < 0) ? 0 : colMin;
+				colMax		= (colMax > width - 1) ? width - 1 : colMax;
+
+				const float *p0	= plane0 + row*width;
+				const float *p1	= plane1 + row*width;
+				const float *p2	= plane2 + row*width;
+				const float *wm	= weightMap + row*width;
+				float sumW = 0, sumX = 0, sum0 = 0, sum1 = 0, sum2 = 0;
+#pragma omp simd reduction(+:sumW, sumX, sum0, sum1, sum2)
+				for(int col = colMin; col <= colMax; col++)
+				{
+					float dx	= xs[col] - cx;
+					float e0	= p0[col] - c0;
+					float e1	= p1[col] - c1;
+					float e2	= p2[col] - c2;
+					float rd	= factor0*e0*e0 + e1*e1 + e2*e2;
+					bool inside	= (dx*dx + dy2 < 1.0f) & (rd < 1.0f);
+					float wc	= inside ? 1 - wm[col] : 0.0f;
+					sumW	+= wc;
+					sumX	+= wc*dx;
+					sum0	+= wc*e0;
+					sum1	+= wc*e1;
+					sum2	+= wc*e2;
+				}
+
+				wsum	+= sumW;
+				msum[0]	+= sumX;
+				msum[1]	+= sumW*dy;
+				msum[2]	+= sum0;
+				msum[3]	+= sum1;
+				msum[4]	+= sum2;
+			}
+
+			if(wsum > 0)
+			{
+				for(j = 0; j < lN; j++)
+					Mh[j] = msum[j]/wsum;
+			}
+			else
+			{
+				for(j = 0; j < lN; j++)
+					Mh[j] = 0;
+			}
+
+			// Calculate its magnitude squared, as in NewNonOptimizedFilter
+			// the first iteration is not scaled by the bandwidths
+			if(iterationCount == 0)
+			{
+				mvAbs = 0;
+				for(j = 0; j < lN; j++)
+					mvAbs += Mh[j]*Mh[j];
+			}
+			else
+			{
+				mvAbs = (Mh[0]*Mh[0]+Mh[1]*Mh[1])*sigmaS*sigmaS
+					+ (Mh[2]*Mh[2]+Mh[3]*Mh[3]+Mh[4]*Mh[4])*sigmaR*sigmaR;
+			}
+
+			iterationCount++;
+		}
+		// Keep shifting window center until the magnitude squared of the
+		// mean shift vector is under EPSILON
+		while((mvAbs >= EPSILON)&&(iterationCount < LIMIT));
+
+		// Shift window location
+		for(j = 0; j < lN; j++)
+			yk[j] += Mh[j];
+
+		//store result into msRawData...
+		for(j = 0; j < N; j++)
+			msRawData[N*i+j] = (float)(yk[j+2]*sigmaR);
+
+		// Check to see if the algorithm has been halted
+		if(!parallelFilter&&(i%PROGRESS_RATE == 0)&&((ErrorStatus = msSys.Progress((float)(i/(float)(L))*(float)(0.8)))) == EL_HALT)
+			break;
+	}
+
+	}
+
+	// Prompt user that filtering is completed
+#ifdef PROMPT
+	msSys.Prompt("done.");
+#endif
+
+	// de-allocate memory
+	delete [] planes;
+	delete [] xs;
+	delete [] ys;
 
 	// done.
 	return;
@@ -4667,6 +5338,16 @@ void msImageProcessor::SetSpeedThreshold(float speedUpThreshold)
    speedThreshold = speedUpThreshold;
 }
 
+void msImageProcessor::SetParallelFilter(bool parallel)
+{
+   parallelFilter = parallel;
+}
+
+void msImageProcessor::SetGraphFusion(bool graph)
+{
+   graphFusion = graph;
+}
+
 /*@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@*/
 /*@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@*/
 /*@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ END OF CLASS DEFINITION @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@*/
@@ -57,6 +57,9 @@ Implemented by Chris M. Christoudias, Bogdan Georgescu
 #define BIG_NUM				0xffffffff	//BIG_NUM = 2^32-1
 #define NODE_MULTIPLE		10
 
+	//parallel filtering
+#define FILTER_BAND_ROWS	32	//rows of the bands filtered in parallel
+
 	//data space conversion...
 const double Xn			= 0.95050;
 const double Yn			= 1.00000;
@@ -619,6 +622,14 @@ public:
 
 
   void SetSpeedThreshold(float);
+
+  //filter bands of FILTER_BAND_ROWS rows in parallel (OpenMP), the basin
+  //of attraction speedups are restricted to the bands
+  void SetParallelFilter(bool);
+
+  //apply transitive closure and pruning in one pass on a region adjacency
+  //graph using union-find instead of rebuilding the RAM in every pass
+  void SetGraphFusion(bool);
 private:
 
   //========================
@@ -633,6 +644,8 @@ private:
 											// Advantage	: most accurate
 											// Disadvantage	: time expensive
    void NewNonOptimizedFilter(float, float);
+   void LatticeFilter(float, float);		// NewNonOptimizedFilter on row runs of the spatial
+											// window with vectorized range kernel evaluation
 
 	void OptimizedFilter1(float, float);	// filters the image using previous mode information
 											// to avoid re-applying mean shift to some data points
@@ -684,6 +697,10 @@ private:
 											// whose area is less than minRegion pixels, where minRegion is
 											// an argument of this method)
 
+	//Usage: GraphFusion(minRegion)
+	void GraphFusion(int);					// applies transitive closure and pruning in one pass on a
+											// persistent region adjacency graph using union-find
+
 	/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
 	/*  Region Boundary Detection */
 	/*\/\/\/\/\/\/\/\/\/\/\/\/\/\/*/
@@ -793,6 +810,8 @@ private:
 											//together, thus defining image regions
 
    float speedThreshold; // the % of window radius used in new optimized filter 2.
+   bool parallelFilter; // whether the new filters process bands of rows in parallel.
+   bool graphFusion; // whether regions are fused in one pass on a region adjacency graph.
 };
 
 #endif
\ No newline at end of file
@@ -3,5 +3,6 @@
 
 #include "HeapL.h"
 #include "HeapG.h"
+#include "HeapIL.h"
 
 #endif
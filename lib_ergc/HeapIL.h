@@ -0,0 +1,159 @@
+#ifndef __HEAPIL_H_
+#define __HEAPIL_H_
+#include <iostream>
+
+template <typename U>
+  class HeapIL{
+ private:
+  int _size;
+  int _nitem;
+  int *_data; // heap of element indices
+  int *_pos;  // position of each element in the heap, -1 if not in the heap
+  U *_key;    // key of each element
+
+  // not copyable
+  HeapIL( const HeapIL& );
+  HeapIL& operator=( const HeapIL& );
+
+  void MoveUp(int child, int item, U pkey) {
+    int parent=(child-1)/2;
+
+    while (child>0 && (pkey<_key[_data[parent]] || (pkey==_key[_data[parent]] ))) {
+      _data[child]=_data[parent];
+      _pos[_data[child]]=child;
+      child=parent;
+      parent=(parent-1)/2;
+    }
+    _data[child]=item;
+    _pos[item]=child;
+  }
+
+  void MoveDown(int parent, int item) {
+    U pkey=_key[item];
+    int child=parent*2+1;
+
+    while (child<_nitem) {
+      if (child+1<_nitem && (_key[_data[child+1]]<_key[_data[child]] || (_key[_data[child+1]]==_key[_data[child]] )))
+	child++;
+
+      if (pkey<_key[_data[child]] || (pkey==_key[_data[child]] ))
+	break;
+      // Move up child as parent.
+      _data[parent]=_data[child];
+      _pos[_data[parent]]=parent;
+      parent=child;
+      child=child*2+1;
+    }
+    _data[parent]=item;
+    _pos[item]=parent;
+  }
+
+ public:
+
+  /**
+   * Creates a new <code>HeapIL</code> for the elements 0..n-1, e.g. the
+   * indices of the pixels of an image. Each element is at most once in the
+   * heap, so the heap never needs more than n slots.
+   * @param n	the number of elements.
+   */
+ HeapIL( int n=0 ): _size(0), _nitem(0),_data(0),_pos(0),_key(0) {
+    Resize(n);
+  }
+
+  ~HeapIL(){ delete[] _data; delete[] _pos; delete[] _key; }
+
+  /**
+   * Empties the heap and changes the number of elements, memory is only
+   * re-allocated if the number changes.
+   * @param n	the number of elements.
+   */
+  void Resize( int n ) {
+    if (n<0) {
+      std::cerr<<"Error: negative heap size...not allocated"<<std::endl;
+      return;
+    }
+    if (n!=_size) {
+      delete[] _data; delete[] _pos; delete[] _key;
+      _data=0; _pos=0; _key=0;
+      _size=n;
+      if (n>0) {
+        _data=new int[n];
+        _pos=new int[n];
+        _key=new U[n];
+      }
+    }
+    for (int i=0; i<n; i++) _pos[i]=-1;
+    _nitem=0;
+  }
+
+  /**
+   * Checks whether the heap is empty.
+   * @return true if the heap empty.
+   */
+  bool Empty() { return _nitem==0; }
+
+  /**
+   * Returns the current number of elements if the heap.
+   * @return the current size of the heap
+   */
+  int Nrank() { return _nitem; }
+
+  /**
+   * Checks whether the element is in the heap.
+   * @param item	the element index.
+   * @return true if the element is in the heap.
+   */
+  bool Contains( int item ) { return _pos[item]!=-1; }
+
+  /**
+   * Resets the heap (-> Nrank() = 0).
+   */
+  void Reset() {
+    for (int i=0; i<_nitem; i++) _pos[_data[i]]=-1;
+    _nitem=0;
+  }
+
+  /**
+   * Inserts a new element in the heap with the specified key, or changes
+   * the key of the element if it is already in the heap.
+   * @param item	the element index, in 0..n-1.
+   * @param pkey	the primary key of the element.
+   */
+  void Push( int item, U pkey ) {
+    if (_pos[item]==-1) {
+      _key[item]=pkey;
+      MoveUp(_nitem++,item,pkey);
+    } else if (pkey<_key[item] || pkey==_key[item]) {
+      _key[item]=pkey;
+      MoveUp(_pos[item],item,pkey);
+    } else {
+      _key[item]=pkey;
+      MoveDown(_pos[item],item);
+    }
+  }
+
+  /**
+   * Removes and returns the next element with the minimum key value.
+   * @param pkey	use to return the value of the primary key of the next element.
+   * @return	the element index.
+   */
+  int Pop( U *pkey=NULL ) {
+    if (Empty()) {
+      std::cerr<<"Warning: heap empty..." << std::endl;
+      return _data[0];
+    }
+
+    // Get top of the heap.
+    int item=_data[0];
+    if (pkey) *pkey=_key[item];
+    _pos[item]=-1;
+
+    --_nitem;
+    if (_nitem>0) MoveDown(0,_data[_nitem]);
+    return item;
+  }
+};
+
+
+
+#endif
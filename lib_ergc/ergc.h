@@ -37,6 +37,24 @@ struct point3d{
   int x,y,z;
   point3d(int xx, int yy, int zz) {x=xx; y=yy; z=zz;}
 };
+//////////////////////////////////
+struct SVStream { // supervoxels of a sequence computed on temporal windows
+  int W,H,nc;
+  int dx,dy,dz; // seeds sampling (dz along time, in global frame indices)
+  int chunk; // number of new frames per window
+  int overlap; // number of frames of the previous window kept in the next one
+  int m;
+  bool perturb;
+
+  CImg<> im; // window: overlap frames followed by the new frames
+  CImg<int> carried; // labels of the overlap frames, indices into carriedIds
+  vector<int> carriedIds; // global labels of the supervoxels in the overlap frames
+  vector<point3d> carriedSeeds; // and their seeds (z is a global frame index)
+  int noverlap; // current number of overlap frames
+  int nnew; // current number of new frames
+  int first; // global index of the first new frame
+  int nlabels; // number of global labels used so far
+};
 
 
 //////////////////////////////////////////////////////
@@ -63,6 +81,11 @@ vector<SP*> initialize_superpixels(CImg<> &ims, CImg<int> &inlabels);
 vector<SP*> initialize_regions(CImg<> &ims, CImg<int> &inlabels);
 void initialize_images(CImg<int> &inlabels, CImg<> &Dist, CImg<int> &S);
 
+void initialize_stream(SVStream &st, int W, int H, int nc, int dx, int dy, int dz, int chunk, int overlap, int m, bool perturb);
+int stream_add_frame(SVStream &st, CImg<> &frame, CImg<int> &outLabels);
+int stream_flush(SVStream &st, CImg<int> &outLabels);
+int process_stream_window(SVStream &st, CImg<int> &outLabels);
+
 //////////////////////////////////////////////////////
 //////////////////////////////////////////////////////
 
@@ -113,25 +136,22 @@ void fmm2d(CImg<> &D, CImg<int> &imLabels, CImg<int> &S, CImg<> &im, vector<SP*>
 
   //////////////////////////////
   // initialize heap
-  HeapL<point2d*, float> tas(10000000);
+  // (indexed by pixel, each narrow band point is in the heap once with its current distance)
+  HeapIL<float> tas(W*H);
   cimg_forXY(S,x,y)
-    if(S(x,y)==0) {
-      point2d* pt=new point2d(x,y);
-      tas.Push(pt,D(x,y));
-    }
+    if(S(x,y)==0)
+      tas.Push(y*W+x,D(x,y));
 
   ////////////////////////////////
   // let's go
   bool ok=false;
-  point2d *pt;
+  int pt;
   CImg<> v;
   while(!ok) {
     // current point2d
     pt=tas.Pop();
-    x=pt->x;
-    y=pt->y;
-
-    delete pt;
+    x=pt%W;
+    y=pt/W;
 
     if(S(x,y)!=-1) { // consider only non fixed point2d
       S(x,y)=-1; // fix it !
@@ -186,8 +206,7 @@ void fmm2d(CImg<> &D, CImg<int> &imLabels, CImg<int> &S, CImg<> &im, vector<SP*>
 	      // update distance
 	      D(xx,yy)=A1;
 	      imLabels(xx,yy)=imLabels(x,y);
-	      point2d* pt1=new point2d(xx,yy);
-	      tas.Push(pt1,A1);
+	      tas.Push(yy*W+xx,A1);
 	    }
 	  } else {
 	    if(S(xx,yy)==1) {
@@ -195,8 +214,7 @@ void fmm2d(CImg<> &D, CImg<int> &imLabels, CImg<int> &S, CImg<> &im, vector<SP*>
 	      S(xx,yy)=0;
 	      D(xx,yy)=A1;
 	      imLabels(xx,yy)=imLabels(x,y);
-	      point2d* pt1=new point2d(xx,yy);
-	      tas.Push(pt1,A1);
+	      tas.Push(yy*W+xx,A1);
 	    }
 	  }
 	}
@@ -229,27 +247,24 @@ void fmm3d(CImg<> &Dist, CImg<int> &imLabels, CImg<int> &S, CImg<> &im, vector<S
 
   //////////////////////////////
   // initialize heap
-  HeapL<point3d*, float> tas(10000000);
+  // (indexed by voxel, each narrow band point is in the heap once with its current distance)
+  HeapIL<float> tas(W*H*D);
   cimg_forXYZ(S,x,y,z)
-    if(S(x,y,z)==0) {
-      point3d* pt=new point3d(x,y,z);
-      tas.Push(pt,Dist(x,y,z));
-    }
+    if(S(x,y,z)==0)
+      tas.Push((z*H+y)*W+x,Dist(x,y,z));
 
 
   ////////////////////////////////
   // let's go
   bool ok=false;
-  point3d *pt;
+  int pt;
   CImg<> v;
   while(!ok) {
     // current point3d
     pt=tas.Pop();
-    x=pt->x;
-    y=pt->y;
-    z=pt->z;
-
-    delete pt;
+    x=pt%W;
+    y=(pt/W)%H;
+    z=pt/(W*H);
 
     if(S(x,y,z)!=-1) { // consider only non fixed point3d
       S(x,y,z)=-1; // fix it !
@@ -327,8 +342,7 @@ void fmm3d(CImg<> &Dist, CImg<int> &imLabels, CImg<int> &S, CImg<> &im, vector<S
 	      // update distance
 	      Dist(xx,yy,zz)=A1;
 	      imLabels(xx,yy,zz)=imLabels(x,y,z);
-	      point3d* pt1=new point3d(xx,yy,zz);
-	      tas.Push(pt1,A1);
+	      tas.Push((zz*H+yy)*W+xx,A1);
 	    }
 	  } else {
 	    if(S(xx,yy,zz)==1) {
@@ -336,8 +350,7 @@ void fmm3d(CImg<> &Dist, CImg<int> &imLabels, CImg<int> &S, CImg<> &im, vector<S
 	      S(xx,yy,zz)=0;
 	      Dist(xx,yy,zz)=A1;
 	      imLabels(xx,yy,zz)=imLabels(x,y,z);
-	      point3d* pt1=new point3d(xx,yy,zz);
-	      tas.Push(pt1,A1);
+	      tas.Push((zz*H+yy)*W+xx,A1);
 	    }
 	  }
 	}
@@ -791,3 +804,149 @@ CImg<> compute_gradient(CImg<> &im) {
   gradient.sqrt();
   return gradient;
 }
+
+
+//////////////////////////////////
+// streaming supervoxels
+//////////////////////////////////
+// fmm3d on long sequences: frames are added one by one and each window of
+// chunk new frames is processed together with the last overlap frames of the
+// previous window. The overlap frames keep their labels and are the initial
+// narrow band of their supervoxels, so supervoxels continue across windows
+// with the same global label. Memory only depends on W*H*(chunk+overlap).
+// chunk and dz must be >= 1, overlap >= 0 (0: independent windows).
+void initialize_stream(SVStream &st, int W, int H, int nc, int dx, int dy, int dz, int chunk, int overlap, int m, bool perturb) {
+  st.W=W; st.H=H; st.nc=nc;
+  st.dx=dx; st.dy=dy; st.dz=dz;
+  st.chunk=chunk;
+  st.overlap=overlap;
+  st.m=m;
+  st.perturb=perturb;
+
+  st.im.assign(W,H,overlap+chunk,nc).fill(0);
+  st.carried.assign(W,H,overlap).fill(-1);
+  st.carriedIds.clear();
+  st.carriedSeeds.clear();
+  st.noverlap=0;
+  st.nnew=0;
+  st.first=0;
+  st.nlabels=0;
+}
+
+// adds a frame (W x H x 1 x nc), returns the number of frames labeled in
+// outLabels (0, or chunk once the window is complete)
+int stream_add_frame(SVStream &st, CImg<> &frame, CImg<int> &outLabels) {
+  int z=st.noverlap+st.nnew;
+  cimg_forXYC(frame,x,y,c)
+    st.im(x,y,z,c)=frame(x,y,0,c);
+  st.nnew++;
+
+  if(st.nnew==st.chunk)
+    return process_stream_window(st,outLabels);
+  return 0;
+}
+
+// processes the remaining frames at the end of the sequence
+int stream_flush(SVStream &st, CImg<int> &outLabels) {
+  if(st.nnew==0)
+    return 0;
+  return process_stream_window(st,outLabels);
+}
+
+int process_stream_window(SVStream &st, CImg<int> &outLabels) {
+  int W=st.W;
+  int H=st.H;
+  int O=st.noverlap;
+  int T=st.nnew;
+  int D=O+T;
+  int K=st.carriedIds.size();
+  int z0=st.first-O; // global index of the first frame of the window
+
+  CImg<> win;
+  if(D==st.im.depth())
+    win.assign(st.im,true);
+  else
+    win=st.im.get_crop(0,0,0,0,W-1,H-1,D-1,st.nc-1);
+
+  // grid seeds in the new frames, numbered after the carried supervoxels
+  // (same order as placeSeedsOnCustomGrid3d)
+  CImg<int> seeds(W,H,D,1,-1);
+  int nseeds=K;
+  for(int x=st.dx/2;x<W;x+=st.dx)
+    for(int y=st.dy/2;y<H;y+=st.dy)
+      for(int z=O;z<D;z++)
+	if((z0+z)%st.dz==st.dz/2)
+	  seeds(x,y,z)=nseeds++;
+  if(nseeds==0) // nothing to diffuse from (short window without seed frame)
+    for(int x=st.dx/2;x<W;x+=st.dx)
+      for(int y=st.dy/2;y<H;y+=st.dy)
+	seeds(x,y,O+T/2)=nseeds++;
+
+  CImg<int> labels;
+  if(st.perturb) {
+    CImg<> gradient=compute_gradient(win);
+    // seeds must not move into the overlap frames
+    cimg_forXYZ(gradient,x,y,z)
+      if(z<O)
+	gradient(x,y,z)=1000000;
+    perturbSeeds3d(seeds,gradient,labels);
+  } else
+    labels=seeds;
+
+  vector<SP*> SVs=initialize_superpixels(win,labels);
+  while((int)SVs.size()<K)
+    SVs.push_back(new SP(-1,-1,0,st.nc));
+  for(int k=0;k<K;k++) {
+    SVs[k]->xs=st.carriedSeeds[k].x;
+    SVs[k]->ys=st.carriedSeeds[k].y;
+    SVs[k]->zs=st.carriedSeeds[k].z-z0;
+  }
+
+  // the overlap frames keep the labels of the previous window
+  for(int z=0;z<O;z++)
+    cimg_forXY(labels,x,y)
+      labels(x,y,z)=st.carried(x,y,z);
+
+  CImg<> Dist;
+  CImg<int> S;
+  initialize_images(labels,Dist,S);
+  fmm3d(Dist,labels,S,win,SVs,st.m);
+
+  // global labels, new supervoxels are numbered in order of appearance
+  vector<int> ids(SVs.size(),-1);
+  for(int k=0;k<K;k++)
+    ids[k]=st.carriedIds[k];
+  outLabels.assign(W,H,T);
+  cimg_forXYZ(outLabels,x,y,z) {
+    int lab=labels(x,y,O+z);
+    if(ids[lab]==-1)
+      ids[lab]=st.nlabels++;
+    outLabels(x,y,z)=ids[lab];
+  }
+
+  // the last frames become the overlap of the next window
+  int On=(st.overlap<D)?st.overlap:D;
+  vector<int> index(SVs.size(),-1);
+  st.carriedIds.clear();
+  st.carriedSeeds.clear();
+  for(int z=0;z<On;z++)
+    cimg_forXY(labels,x,y) {
+      int lab=labels(x,y,D-On+z);
+      if(index[lab]==-1) {
+	index[lab]=st.carriedIds.size();
+	st.carriedIds.push_back(ids[lab]);
+	st.carriedSeeds.push_back(point3d(SVs[lab]->xs,SVs[lab]->ys,SVs[lab]->zs+z0));
+      }
+      st.carried(x,y,z)=index[lab];
+      cimg_forC(win,c)
+	st.im(x,y,z,c)=win(x,y,D-On+z,c);
+    }
+
+  for(unsigned int k=0;k<SVs.size();k++)
+    delete SVs[k];
+
+  st.noverlap=On;
+  st.first+=T;
+  st.nnew=0;
+  return T;
+}
@@ -0,0 +1,617 @@
+#ifndef __ERGC_MAT_H
+#define __ERGC_MAT_H
+#include <opencv2/opencv.hpp>
+#include <cmath>
+#include <vector>
+#include "HeapIL.h"
+
+// Native cv::Mat versions of the 2d functions of ergc.h, without CImg.
+// Images are CV_32FC(n) (interleaved channels), labels, seeds and states
+// CV_32SC1 and distances CV_32FC1; all of them may be views (ROIs) into
+// larger matrices. The results are the same as with the CImg versions.
+
+
+//////////////////////////////////
+// structures declaration
+//////////////////////////////////
+struct SPMat { // superpixel structure
+  int xs,ys; // seed coords
+  int count;
+
+  std::vector<float> meanColor;
+
+  SPMat(): xs(-1), ys(-1), count(0) {}
+};
+//////////////////////////////////
+// buffers of computeSuperpixels in ergc_opencv.h, keep one per video to
+// avoid allocations per frame (re-allocated only if the frame size changes)
+struct ERGCWorkspace {
+  cv::Mat im; // image, converted to float (and Lab)
+  cv::Mat gradient; // gradient norm used to perturb the seeds
+  cv::Mat seeds; // seeds before perturbation
+  cv::Mat labels; // seeds, then labels after fast marching
+  cv::Mat distances;
+  cv::Mat states;
+  std::vector<SPMat> SPs;
+  HeapIL<float> heap;
+};
+
+
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// prototypes of functions
+void fmm2d(cv::Mat &D, cv::Mat &imLabels, cv::Mat &S, const cv::Mat &im, std::vector<SPMat> &SPs, int m, HeapIL<float> &tas);
+
+void addNewSeed(cv::Mat &D, cv::Mat &imLabels, cv::Mat &S, const cv::Mat &im, std::vector<SPMat> &SPs);
+void addNewSeedLocal(cv::Mat &D, cv::Mat &imLabels, cv::Mat &S, const cv::Mat &im, std::vector<SPMat> &SPs, int m, HeapIL<float> &tas);
+
+int placeSeedsOnCustomGrid2d(int W, int H, int dx, int dy, cv::Mat &outseeds);
+void perturbSeeds2d(const cv::Mat &initialSeeds, const cv::Mat &perturbMap, cv::Mat &outputSeeds);
+
+void initialize_superpixels(const cv::Mat &ims, const cv::Mat &inlabels, std::vector<SPMat> &SPs);
+void initialize_images(const cv::Mat &inlabels, cv::Mat &Dist, cv::Mat &S);
+
+void RGBtoLab(cv::Mat &im);
+void compute_gradient(const cv::Mat &im, cv::Mat &gradient);
+
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+
+
+//////////////////////////////////
+// fast marching functions
+//////////////////////////////////
+inline void fmm2d(cv::Mat &D, cv::Mat &imLabels, cv::Mat &S, const cv::Mat &im, std::vector<SPMat> &SPs, int m, HeapIL<float> &tas) {
+  /* states S:
+   * -1: OK
+   *  0: NB
+   *  1: FA
+   */
+  int W=im.cols;
+  int H=im.rows;
+  int nc=im.channels();
+
+  float INF=100000;
+
+  int v4x[] ={-1,0,1,0};
+  int v4y[] ={0,1,0,-1};
+  int x,y,xx,yy,k,c;
+  float P,a1,a2,A1,delta;
+
+  float Sz=(float)W*H/(float)SPs.size();
+
+  //////////////////////////////
+  // initialize heap
+  // (indexed by pixel, each narrow band point is in the heap once with its current distance)
+  tas.Resize(W*H);
+  for(y=0;y<H;y++)
+    for(x=0;x<W;x++)
+      if(S.at<int>(y,x)==0)
+	tas.Push(y*W+x,D.at<float>(y,x));
+
+  ////////////////////////////////
+  // let's go
+  bool ok=tas.Empty();
+  int pt;
+  while(!ok) {
+    // current point
+    pt=tas.Pop();
+    x=pt%W;
+    y=pt/W;
+
+    if(S.at<int>(y,x)!=-1) { // consider only non fixed point
+      S.at<int>(y,x)=-1; // fix it !
+
+      // update the mean color of the SP
+      int lab=imLabels.at<int>(y,x);
+      const float *imPtr=im.ptr<float>(y)+x*nc;
+      float *meanColor=&SPs[lab].meanColor[0];
+      for(c=0;c<nc;c++)
+	meanColor[c] = meanColor[c] * SPs[lab].count + imPtr[c];
+      SPs[lab].count++;
+      for(c=0;c<nc;c++)
+	meanColor[c] /= SPs[lab].count;
+
+      // go for the neighborhood investigation
+      for(k=0;k<4;k++) {
+	xx=x+v4x[k];
+	yy=y+v4y[k];
+
+	if((xx<W) && (xx>=0) && (yy>=0) && (yy<H)) {
+	  const float *imPtr1=im.ptr<float>(yy)+xx*nc;
+	  P=0;
+	  for(c=0;c<nc;c++)
+	    P += (meanColor[c]-imPtr1[c])*(meanColor[c]-imPtr1[c]);
+
+	  if(m>0) {
+	    float dxy=(SPs[lab].xs-xx)*(SPs[lab].xs-xx);
+	    dxy+=(SPs[lab].ys-yy)*(SPs[lab].ys-yy);
+	    P=sqrt(P*P + dxy*dxy*m*m/(Sz*Sz));
+	  }
+	  // compute its neighboring values
+	  a1=INF;
+	  if(xx<W-1)
+	    a1=D.at<float>(yy,xx+1);
+	  if(xx>0)
+	    a1=(a1<D.at<float>(yy,xx-1))?a1:D.at<float>(yy,xx-1);
+
+	  a2=INF;
+	  if(yy<H-1)
+	    a2=D.at<float>(yy+1,xx);
+	  if(yy>0)
+	    a2=(a2<D.at<float>(yy-1,xx))?a2:D.at<float>(yy-1,xx);
+
+	  if(a1>a2) { float tmp=a1; a1=a2; a2=tmp; }
+
+	  // update its distance
+	  // now the equation is   (a-a1)^2+(a-a2)^2 = P, with a >= a2 >= a1.
+	  A1=0;
+	  if(P*P > (a2-a1)*(a2-a1) ) {
+	    delta=2*P*P-(a2-a1)*(a2-a1);
+	    A1 = (a1+a2+sqrt(delta))/2.0;
+	  } else {
+	    A1 = a1 + P;
+	  }
+	  if(S.at<int>(yy,xx)==0) {
+	    if(A1<D.at<float>(yy,xx)) {
+	      // update distance
+	      D.at<float>(yy,xx)=A1;
+	      imLabels.at<int>(yy,xx)=lab;
+	      tas.Push(yy*W+xx,A1);
+	    }
+	  } else {
+	    if(S.at<int>(yy,xx)==1) {
+	      // add new point
+	      S.at<int>(yy,xx)=0;
+	      D.at<float>(yy,xx)=A1;
+	      imLabels.at<int>(yy,xx)=lab;
+	      tas.Push(yy*W+xx,A1);
+	    }
+	  }
+	}
+      }
+    }
+    if(tas.Empty()) ok=true;
+  }
+}
+
+
+//////////////////////////////////
+// refining functions
+//////////////////////////////////
+inline void addNewSeed(cv::Mat &D, cv::Mat &imLabels, cv::Mat &S, const cv::Mat &im, std::vector<SPMat> &SPs) {
+  int v4x[] ={-1,0,1,0};
+  int v4y[] ={0,1,0,-1};
+
+  int W=im.cols;
+  int H=im.rows;
+  int nc=im.channels();
+
+  float INF=100000;
+  float max=0;
+  int xmax=-1, ymax=-1, xx, yy, k, c;
+  for(int y=1;y<H-1;y++)
+    for(int x=1;x<W-1;x++)
+      if(D.at<float>(y,x)>max) {
+	max=D.at<float>(y,x);
+	xmax=x;
+	ymax=y;
+      }
+  SPMat new_SP;
+  new_SP.xs=xmax;
+  new_SP.ys=ymax;
+  new_SP.meanColor.assign(nc,0);
+  SPs.push_back(new_SP);
+
+  // find adjacent regions of the old region that contains (xmax,ymax)
+  int oldRegion=imLabels.at<int>(ymax,xmax);
+  std::vector<unsigned char> adjacentRegions(SPs.size(),0);
+  adjacentRegions[SPs.size()-1]=1; // add indice of the new region
+  adjacentRegions[oldRegion]=1; // add indice of the old region
+  // look for all the indices that are adjacent to the old region
+  for(int y=1;y<H-1;y++)
+    for(int x=1;x<W-1;x++)
+      if(imLabels.at<int>(y,x)==oldRegion) {
+	for(k=0;k<4;k++) {
+	  xx=x+v4x[k];
+	  yy=y+v4y[k];
+	  if(imLabels.at<int>(yy,xx)!=oldRegion)
+	    adjacentRegions[imLabels.at<int>(yy,xx)]=1;
+	}
+      }
+
+  // compute new initial S, imLabels, D
+  for(int y=0;y<H;y++)
+    for(int x=0;x<W;x++) {
+      int lab=imLabels.at<int>(y,x);
+      if(adjacentRegions[lab]==0) { // not to be refined
+	S.at<int>(y,x)=-1;
+      } else { // to refine
+	S.at<int>(y,x)=1;
+	imLabels.at<int>(y,x)=-1;
+      }
+    }
+  for(unsigned int sp=0;sp<SPs.size();sp++) {
+    if(adjacentRegions[sp]==1) { // re-initialization of adjacent SP
+      S.at<int>(SPs[sp].ys,SPs[sp].xs)=0;
+      imLabels.at<int>(SPs[sp].ys,SPs[sp].xs)=sp; // the label of a SP is its indice in the list SPs
+      const float *imPtr=im.ptr<float>(SPs[sp].ys)+SPs[sp].xs*nc;
+      for(c=0;c<nc;c++)
+	SPs[sp].meanColor[c] = imPtr[c];
+      SPs[sp].count=1;
+      for(k=0;k<4;k++) {
+	xx=SPs[sp].xs+v4x[k];
+	yy=SPs[sp].ys+v4y[k];
+	if((xx>=0) && (xx<W) && (yy>=0) && (yy<H)) {
+	  const float *imPtr1=im.ptr<float>(yy)+xx*nc;
+	  for(c=0;c<nc;c++)
+	    SPs[sp].meanColor[c] += imPtr1[c];
+	  SPs[sp].count++;
+	}
+      }
+      for(c=0;c<nc;c++)
+	SPs[sp].meanColor[c] /= SPs[sp].count;
+    }
+  }
+  // re-initialization of distance map
+  for(int y=0;y<H;y++)
+    for(int x=0;x<W;x++) {
+      if(S.at<int>(y,x)!=-1)
+	D.at<float>(y,x)=INF;
+      if(S.at<int>(y,x)==0)
+	D.at<float>(y,x)=0;
+    }
+}
+
+// Same seed placement as addNewSeed, but instead of re-initializing the
+// adjacent regions for a new call of fmm2d, fast marching is run from the new
+// seed only and stops wherever the existing distance D is already smaller.
+// The cost is proportional to the region taken from the old superpixels
+// (plus one scan for the largest distance). The mean colors of the superpixels
+// losing pixels are updated incrementally. D, imLabels and S are expected to
+// be the result of fmm2d (all states fixed) and tas the heap used by fmm2d;
+// S is left in that state.
+inline void addNewSeedLocal(cv::Mat &D, cv::Mat &imLabels, cv::Mat &S, const cv::Mat &im, std::vector<SPMat> &SPs, int m, HeapIL<float> &tas) {
+  /* states S during marching:
+   * -1: OK (fixed by an earlier fast marching)
+   *  0: NB (narrow band of the new seed)
+   *  2: fixed by the new seed
+   */
+  int v4x[] ={-1,0,1,0};
+  int v4y[] ={0,1,0,-1};
+
+  int W=im.cols;
+  int H=im.rows;
+  int nc=im.channels();
+
+  float INF=100000;
+  float max=0;
+  int xmax=-1, ymax=-1, x, y, xx, yy, k, c;
+  for(y=1;y<H-1;y++)
+    for(x=1;x<W-1;x++)
+      if(D.at<float>(y,x)>max) {
+	max=D.at<float>(y,x);
+	xmax=x;
+	ymax=y;
+      }
+  if(xmax<0) // all distances are zero
+    return;
+
+  int lab=SPs.size();
+  SPMat new_SP;
+  new_SP.xs=xmax;
+  new_SP.ys=ymax;
+  new_SP.meanColor.assign(nc,0);
+  SPs.push_back(new_SP);
+
+  // the new seed initializes its color with its neighbors as in addNewSeed,
+  // but only takes pixels once they are fixed
+  std::vector<float> initColor(nc,0);
+  int initCount=0;
+  for(k=-1;k<4;k++) {
+    xx=(k<0)?xmax:xmax+v4x[k];
+    yy=(k<0)?ymax:ymax+v4y[k];
+    if((xx>=0) && (xx<W) && (yy>=0) && (yy<H)) {
+      const float *imPtr=im.ptr<float>(yy)+xx*nc;
+      for(c=0;c<nc;c++)
+	initColor[c] += imPtr[c];
+      initCount++;
+    }
+  }
+  float *meanColor=&SPs[lab].meanColor[0];
+  for(c=0;c<nc;c++)
+    meanColor[c] = initColor[c]/initCount;
+
+  float Sz=(float)W*H/(float)SPs.size();
+  float P,a1,a2,A1,delta;
+
+  tas.Reset(); // the heap is expected to be sized by fmm2d
+  std::vector<int> fixed;
+  D.at<float>(ymax,xmax)=0;
+  S.at<int>(ymax,xmax)=0;
+  tas.Push(ymax*W+xmax,0);
+  while(!tas.Empty()) {
+    int pt=tas.Pop();
+    x=pt%W;
+    y=pt/W;
+
+    if(S.at<int>(y,x)==2)
+      continue;
+    S.at<int>(y,x)=2; // fix it !
+    fixed.push_back(pt);
+
+    // take the pixel from its old superpixel
+    const float *imPtr=im.ptr<float>(y)+x*nc;
+    int old=imLabels.at<int>(y,x);
+    if(old>=0 && old!=lab && SPs[old].count>1) {
+      float *oldColor=&SPs[old].meanColor[0];
+      for(c=0;c<nc;c++)
+	oldColor[c] = (oldColor[c] * SPs[old].count - imPtr[c]) / (SPs[old].count - 1);
+      SPs[old].count--;
+    }
+    imLabels.at<int>(y,x)=lab;
+
+    // update the mean color of the new SP (keeping the initialization
+    // for the seed itself)
+    if(SPs[lab].count>0) {
+      for(c=0;c<nc;c++)
+	meanColor[c] = meanColor[c] * SPs[lab].count + imPtr[c];
+      SPs[lab].count++;
+      for(c=0;c<nc;c++)
+	meanColor[c] /= SPs[lab].count;
+    } else {
+      SPs[lab].count=initCount;
+    }
+
+    // go for the neighborhood investigation
+    for(k=0;k<4;k++) {
+      xx=x+v4x[k];
+      yy=y+v4y[k];
+
+      if((xx<W) && (xx>=0) && (yy>=0) && (yy<H) && S.at<int>(yy,xx)!=2) {
+	const float *imPtr1=im.ptr<float>(yy)+xx*nc;
+	P=0;
+	for(c=0;c<nc;c++)
+	  P += (meanColor[c]-imPtr1[c])*(meanColor[c]-imPtr1[c]);
+
+	if(m>0) {
+	  float dxy=(xmax-xx)*(xmax-xx);
+	  dxy+=(ymax-yy)*(ymax-yy);
+	  P=sqrt(P*P + dxy*dxy*m*m/(Sz*Sz));
+	}
+	// neighboring values, only those of the new seed count
+	a1=INF;
+	if(xx<W-1 && S.at<int>(yy,xx+1)==2)
+	  a1=D.at<float>(yy,xx+1);
+	if(xx>0 && S.at<int>(yy,xx-1)==2)
+	  a1=(a1<D.at<float>(yy,xx-1))?a1:D.at<float>(yy,xx-1);
+
+	a2=INF;
+	if(yy<H-1 && S.at<int>(yy+1,xx)==2)
+	  a2=D.at<float>(yy+1,xx);
+	if(yy>0 && S.at<int>(yy-1,xx)==2)
+	  a2=(a2<D.at<float>(yy-1,xx))?a2:D.at<float>(yy-1,xx);
+
+	if(a1>a2) { float tmp=a1; a1=a2; a2=tmp; }
+
+	A1=0;
+	if(P*P > (a2-a1)*(a2-a1) ) {
+	  delta=2*P*P-(a2-a1)*(a2-a1);
+	  A1 = (a1+a2+sqrt(delta))/2.0;
+	} else {
+	  A1 = a1 + P;
+	}
+	// stop where the existing distance is already smaller
+	if(A1<D.at<float>(yy,xx)) {
+	  D.at<float>(yy,xx)=A1;
+	  S.at<int>(yy,xx)=0;
+	  tas.Push(yy*W+xx,A1);
+	}
+      }
+    }
+  }
+
+  for(unsigned int i=0;i<fixed.size();i++)
+    S.at<int>(fixed[i]/W,fixed[i]%W)=-1;
+}
+
+
+//////////////////////////////////
+// seeds location initialization functions
+//////////////////////////////////
+inline int placeSeedsOnCustomGrid2d(int W, int H, int dx, int dy, cv::Mat &outseeds) {
+  outseeds.create(H,W,CV_32SC1);
+  outseeds.setTo(-1);
+
+  int xoff=dx/2;
+  int yoff=dy/2;
+
+  int x=xoff,y;
+  int c=0;
+  while(x<W) {
+    y=yoff;
+    while(y<H) {
+      outseeds.at<int>(y,x)=c++;
+      y += dy;
+    }
+    x += dx;
+  }
+  return c;
+}
+// perturb seeds according to a perturbMap (gradient map for example)
+inline void perturbSeeds2d(const cv::Mat &initialSeeds, const cv::Mat &perturbMap, cv::Mat &outputSeeds) {
+  // only works for grid seeds
+  int v8x []={-1, 0, 1, 0, -1, -1, 1, 1};
+  int v8y []={0 ,-1, 0, 1, -1, 1, 1, -1};
+
+  int W=initialSeeds.cols;
+  int H=initialSeeds.rows;
+
+  outputSeeds.create(H,W,CV_32SC1);
+  outputSeeds.setTo(-1);
+
+  float v=0;
+  int xx,yy,k,lab,xmin,ymin;
+  for(int y=0;y<H;y++)
+    for(int x=0;x<W;x++) {
+      if(initialSeeds.at<int>(y,x)!=-1) {
+	v=perturbMap.at<float>(y,x);
+	xmin=x;
+	ymin=y;
+	lab=initialSeeds.at<int>(y,x);
+	for(k=0;k<8;k++) {
+	  xx=x+v8x[k];
+	  yy=y+v8y[k];
+	  if((xx>=0) && (xx<W))
+	    if((yy>=0) && (yy<H))
+	      if(perturbMap.at<float>(yy,xx)<v) {
+		v=perturbMap.at<float>(yy,xx);
+		xmin=xx;
+		ymin=yy;
+	      }
+	}
+	outputSeeds.at<int>(ymin,xmin)=lab;
+      }
+    }
+}
+
+
+//////////////////////////////////
+// superpixels initialization functions (for grid seeds)
+//////////////////////////////////
+inline void initialize_superpixels(const cv::Mat &ims, const cv::Mat &inlabels, std::vector<SPMat> &SPs) {
+  int v4x[] ={-1,0,1,0};
+  int v4y[] ={0,1,0,-1};
+
+  int W=ims.cols;
+  int H=ims.rows;
+  int nc=ims.channels();
+
+  // we (re-)create the vector of superpixels
+  int nseeds=0;
+  for(int y=0;y<H;y++)
+    for(int x=0;x<W;x++)
+      nseeds=std::max(nseeds,inlabels.at<int>(y,x)+1);
+
+  SPs.resize(nseeds);
+  for(int k=0;k<nseeds;k++) {
+    SPs[k].xs=-1;
+    SPs[k].ys=-1;
+    SPs[k].count=0;
+    SPs[k].meanColor.assign(nc,0);
+  }
+
+  int lab,k,c,xx,yy;
+  for(int y=0;y<H;y++)
+    for(int x=0;x<W;x++) {
+      lab=inlabels.at<int>(y,x);
+      if(lab!=-1) { // seed
+	SPs[lab].xs=x;
+	SPs[lab].ys=y;
+	const float *imPtr=ims.ptr<float>(y)+x*nc;
+	for(c=0;c<nc;c++)
+	  SPs[lab].meanColor[c] = imPtr[c];
+	SPs[lab].count++;
+	for(k=0;k<4;k++) { // initialization with neighbors too
+	  xx=x+v4x[k];
+	  yy=y+v4y[k];
+	  if((xx>=0) && (xx<W) && (yy>=0) && (yy<H))
+	    if(inlabels.at<int>(yy,xx)==-1) {
+	      const float *imPtr1=ims.ptr<float>(yy)+xx*nc;
+	      for(c=0;c<nc;c++)
+		SPs[lab].meanColor[c] += imPtr1[c];
+	      SPs[lab].count++;
+	    }
+	}
+	for(c=0;c<nc;c++)
+	  SPs[lab].meanColor[c] /= SPs[lab].count;
+      }
+    }
+}
+
+
+//////////////////////////////////
+// function that initializes distances and states images
+//////////////////////////////////
+inline void initialize_images(const cv::Mat &inlabels, cv::Mat &Dist, cv::Mat &S) {
+  Dist.create(inlabels.rows,inlabels.cols,CV_32FC1);
+  S.create(inlabels.rows,inlabels.cols,CV_32SC1);
+  for(int y=0;y<inlabels.rows;y++)
+    for(int x=0;x<inlabels.cols;x++)
+      if(inlabels.at<int>(y,x)!=-1) {
+	Dist.at<float>(y,x)=0;
+	S.at<int>(y,x)=0;
+      } else {
+	Dist.at<float>(y,x)=1000000;
+	S.at<int>(y,x)=1;
+      }
+}
+
+
+//////////////////////////////////
+// color conversion function (as CImg<>::RGBtoLab, D65 white point)
+//////////////////////////////////
+inline void RGBtoLab(cv::Mat &im) {
+  const float Xw=(float)(0.4124564 + 0.3575761 + 0.1804375);
+  const float Yw=(float)(0.2126729 + 0.7151522 + 0.0721750);
+  const float Zw=(float)(0.0193339 + 0.1191920 + 0.9503041);
+
+  for(int y=0;y<im.rows;y++) {
+    float *imPtr=im.ptr<float>(y);
+    for(int x=0;x<im.cols;x++,imPtr+=3) {
+      const float
+	R=imPtr[0]/255,
+	G=imPtr[1]/255,
+	B=imPtr[2]/255;
+      const float
+	X=(float)(0.4124564*R + 0.3575761*G + 0.1804375*B)/Xw,
+	Y=(float)(0.2126729*R + 0.7151522*G + 0.0721750*B)/Yw,
+	Z=(float)(0.0193339*R + 0.1191920*G + 0.9503041*B)/Zw;
+      const float
+	fX=(24389*X>216)?std::cbrt(X):(24389*X/27 + 16)/116,
+	fY=(24389*Y>216)?std::cbrt(Y):(24389*Y/27 + 16)/116,
+	fZ=(24389*Z>216)?std::cbrt(Z):(24389*Z/27 + 16)/116;
+      const float L=116*fY - 16;
+      imPtr[0]=(L<0)?0:((L>100)?100:L);
+      imPtr[1]=500*(fX - fY);
+      imPtr[2]=200*(fY - fZ);
+    }
+  }
+}
+
+
+//////////////////////////////////
+// gradient norm function (rotation invariant kernel, as CImg<>::get_gradient)
+//////////////////////////////////
+inline void compute_gradient(const cv::Mat &im, cv::Mat &gradient) {
+  const float a=(float)(0.25f*(2 - std::sqrt(2.0f))), b=(float)(0.5f*(std::sqrt(2.0f) - 1));
+
+  int W=im.cols;
+  int H=im.rows;
+  int nc=im.channels();
+
+  gradient.create(H,W,CV_32FC1);
+  for(int y=0;y<H;y++) {
+    // neighbors with Neumann boundary conditions
+    const float *prow=im.ptr<float>(std::max(y-1,0));
+    const float *crow=im.ptr<float>(y);
+    const float *nrow=im.ptr<float>(std::min(y+1,H-1));
+    for(int x=0;x<W;x++) {
+      int xp=std::max(x-1,0)*nc, xc=x*nc, xn=std::min(x+1,W-1)*nc;
+      // squared x-derivatives of all channels first, then the y-derivatives
+      float g=0;
+      for(int c=0;c<nc;c++) {
+	float d=-a*prow[xp+c] - b*crow[xp+c] - a*nrow[xp+c] + a*prow[xn+c] + b*crow[xn+c] + a*nrow[xn+c];
+	g+=d*d;
+      }
+      for(int c=0;c<nc;c++) {
+	float d=-a*prow[xp+c] - b*prow[xc+c] - a*prow[xn+c] + a*nrow[xp+c] + b*nrow[xc+c] + a*nrow[xn+c];
+	g+=d*d;
+      }
+      gradient.at<float>(y,x)=std::sqrt(g);
+    }
+  }
+}
+
+#endif  // __ERGC_MAT_H
@@ -32,9 +32,8 @@
 #ifndef ERGC_OPENCV_H
 #define	ERGC_OPENCV_H
 
-#include <CImg.h>
 #include <opencv2/opencv.hpp>
-#include "ergc.h"
+#include "ergc_mat.h"
 
 /** \brief Wrapper for running ERGC on OpenCV images.
  * \author David Stutz
@@ -49,67 +48,72 @@ public:
      * \param[in] perturb_seeds whether to perturb seeds to increase performance
      * \param[in] m m parameter, see paper
      * \param[out] labels superpixel labels
+     * \param[in] new_seeds number of seeds added afterwards where the geodesic distance is largest
      */
     static void computeSuperpixels(const cv::Mat &image, int region_height, int region_width, 
-            bool lab, bool perturb_seeds, int m, cv::Mat &labels) {
+            bool lab, bool perturb_seeds, int m, cv::Mat &labels, int new_seeds = 0) {
+        
+        ERGCWorkspace workspace;
+        computeSuperpixels(image, region_height, region_width, lab, perturb_seeds,
+                m, workspace, labels, new_seeds);
+    }
+    
+    /** \brief Computer superpixels using ERGC, re-using the buffers of a workspace.
+     * Keep the workspace between the frames of a video to avoid allocations per frame.
+     * \param[in] image image to computer superpixels on
+     * \param[in] region_height horizontal step between superpixel centers, implicitly defining the number of superpixels
+     * \param[in] region_width vertical step between superpixel centers, implicitly defining the number of superpixels
+     * \param[in] lab whether to use Lab color space
+     * \param[in] perturb_seeds whether to perturb seeds to increase performance
+     * \param[in] m m parameter, see paper
+     * \param[in,out] workspace buffers, (re-)allocated if the image size changes
+     * \param[out] labels superpixel labels
+     * \param[in] new_seeds number of seeds added afterwards where the geodesic distance is largest
+     */
+    static void computeSuperpixels(const cv::Mat &image, int region_height, int region_width, 
+            bool lab, bool perturb_seeds, int m, ERGCWorkspace &workspace, cv::Mat &labels,
+            int new_seeds = 0) {
         
         int dx = region_width; // Seeds sampling wrt axis x (for custom grids)
         int dy = region_height; // Seeds sampling wrt axis y (for custom grids)
         // int m = 0; // Compacity value
-
-        /////////////////////////////////////////////////////////
-        /////////////////////////////////////////////////////////
-        CImg<> im(image.cols, image.rows, 1, 3);
-        for (int i = 0; i < image.rows; i++) {
-            for (int j = 0; j < image.cols; j++) {
-                im(j, i, 0, 0) = image.at<cv::Vec3b>(i, j)[0];
-                im(j, i, 0, 1) = image.at<cv::Vec3b>(i, j)[1];
-                im(j, i, 0, 2) = image.at<cv::Vec3b>(i, j)[2];
-            }
-        }
         
-        // useful variables
-        CImg<> distances;
-        CImg<int> states, seeds;
-        vector<SP*> SPs;
+        image.convertTo(workspace.im, CV_32FC3);
 
         // convert to Lab if needed (better superpixels with color images)
         if (lab) {
-            im.RGBtoLab();
+            RGBtoLab(workspace.im);
         }
 
-        CImg<> gradient;
         if (perturb_seeds) {
-            gradient = compute_gradient(im);
+            compute_gradient(workspace.im, workspace.gradient);
         }
 
-        placeSeedsOnCustomGrid2d(im.width(), im.height(), dx, dy, seeds);
+        placeSeedsOnCustomGrid2d(image.cols, image.rows, dx, dy, workspace.seeds);
 
         if (perturb_seeds) {
-            CImg<int> perturbedSeeds;
-            if (im.depth() == 1) {
-                perturbSeeds2d(seeds, gradient, perturbedSeeds);
-            }
-            else {
-                perturbSeeds3d(seeds, gradient, perturbedSeeds);
-            }
-            
-            seeds = perturbedSeeds;
+            perturbSeeds2d(workspace.seeds, workspace.gradient, workspace.labels);
+        }
+        else {
+            workspace.seeds.copyTo(workspace.labels);
         }
 
-        initialize_images(seeds, distances, states);
-        SPs = initialize_superpixels(im, seeds);
+        initialize_images(workspace.labels, workspace.distances, workspace.states);
+        initialize_superpixels(workspace.im, workspace.labels, workspace.SPs);
 
-        fmm3d(distances, seeds, states, im, SPs, m);
+        fmm2d(workspace.distances, workspace.labels, workspace.states, workspace.im,
+                workspace.SPs, m, workspace.heap);
 
-        labels.create(image.rows, image.cols, CV_32SC1);
-        for (int i = 0; i < image.rows; i++) {
-            for (int j = 0; j < image.cols; j++) {
-                labels.at<int>(i, j) = seeds(j, i, 0, 0);
-            }
+        // refinement, each new seed only re-marches the region it takes over
+        for (int i = 0; i < new_seeds; i++) {
+            addNewSeedLocal(workspace.distances, workspace.labels, workspace.states,
+                    workspace.im, workspace.SPs, m, workspace.heap);
         }
+
+        workspace.labels.copyTo(labels);
     }
 };
 
 #endif	/* ERGC_OPENCV_H */
 
+
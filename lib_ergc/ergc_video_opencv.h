@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ERGC_VIDEO_OPENCV_H
+#define	ERGC_VIDEO_OPENCV_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "ergc.h"
+
+/** \brief Wrapper for computing ERGC supervoxels on videos given frame by frame.
+ * 3D fast marching runs on chunks of frames overlapping the previous chunk;
+ * supervoxels keep their labels across chunks and memory only depends on the
+ * chunk size, see SVStream in ergc.h.
+ */
+class ERGCVideo_OpenCV {
+public:
+    /** \brief Initialize the stream for a video.
+     * \param[in] rows height of the frames
+     * \param[in] cols width of the frames
+     * \param[in] region_height vertical step between supervoxel seeds
+     * \param[in] region_width horizontal step between supervoxel seeds
+     * \param[in] region_depth temporal step between supervoxel seeds (in frames)
+     * \param[in] chunk number of frames segmented at once
+     * \param[in] overlap number of frames of the previous chunk used to continue its supervoxels
+     * \param[in] perturb_seeds whether to perturb seeds to increase performance
+     * \param[in] m m parameter, see paper
+     * \param[out] stream stream to pass to addFrame and flush
+     */
+    static void initialize(int rows, int cols, int region_height, int region_width, 
+            int region_depth, int chunk, int overlap, bool perturb_seeds, int m, 
+            SVStream &stream) {
+        
+        initialize_stream(stream, cols, rows, 3, region_width, region_height, 
+                region_depth, chunk, overlap, m, perturb_seeds);
+    }
+    
+    /** \brief Add the next frame, segments a chunk once it is complete.
+     * \param[in] image frame to add
+     * \param[in] lab whether to use Lab color space
+     * \param[in,out] stream stream
+     * \param[out] labels labels of the segmented frames are appended
+     * \return number of frames appended to labels
+     */
+    static int addFrame(const cv::Mat &image, bool lab, SVStream &stream, 
+            std::vector<cv::Mat> &labels) {
+        
+        CImg<> im(image.cols, image.rows, 1, 3);
+        for (int i = 0; i < image.rows; i++) {
+            for (int j = 0; j < image.cols; j++) {
+                im(j, i, 0, 0) = image.at<cv::Vec3b>(i, j)[0];
+                im(j, i, 0, 1) = image.at<cv::Vec3b>(i, j)[1];
+                im(j, i, 0, 2) = image.at<cv::Vec3b>(i, j)[2];
+            }
+        }
+        
+        // convert to Lab if needed (better superpixels with color images)
+        if (lab) {
+            im.RGBtoLab();
+        }
+        
+        CImg<int> chunk_labels;
+        int frames = stream_add_frame(stream, im, chunk_labels);
+        appendLabels(chunk_labels, frames, labels);
+        
+        return frames;
+    }
+    
+    /** \brief Segment the remaining frames at the end of the video.
+     * \param[in,out] stream stream
+     * \param[out] labels labels of the segmented frames are appended
+     * \return number of frames appended to labels
+     */
+    static int flush(SVStream &stream, std::vector<cv::Mat> &labels) {
+        CImg<int> chunk_labels;
+        int frames = stream_flush(stream, chunk_labels);
+        appendLabels(chunk_labels, frames, labels);
+        
+        return frames;
+    }
+    
+private:
+    /** \brief Convert the frames of chunk labels to CV_32SC1 label images.
+     * \param[in] chunk_labels labels of a chunk
+     * \param[in] frames number of frames in chunk_labels
+     * \param[out] labels label images are appended
+     */
+    static void appendLabels(CImg<int> &chunk_labels, int frames, 
+            std::vector<cv::Mat> &labels) {
+        
+        for (int k = 0; k < frames; k++) {
+            cv::Mat frame_labels(chunk_labels.height(), chunk_labels.width(), CV_32SC1);
+            for (int i = 0; i < frame_labels.rows; i++) {
+                for (int j = 0; j < frame_labels.cols; j++) {
+                    frame_labels.at<int>(i, j) = chunk_labels(j, i, k);
+                }
+            }
+            
+            labels.push_back(frame_labels);
+        }
+    }
+};
+
+#endif	/* ERGC_VIDEO_OPENCV_H */
+
@@ -29,7 +29,8 @@ MERCDisjointSet::MERCDisjointSet(int nElements)
 	nVertices_ = nElements_;
 	p_ = new int [nElements_];
 	size_ = new int [nElements_];
-	lists_ = new MList<int> [nElements_];
+	next_ = new int [nElements_];
+	last_ = new int [nElements_];
 
 
 	int reservedSize = (int)std::sqrt( 1.0*nElements );
@@ -38,7 +39,8 @@ MERCDisjointSet::MERCDisjointSet(int nElements)
 	{
 		p_[i] = i;
 		size_[i] = 1;
-		lists_[i].PushBack(i);
+		next_[i] = -1;
+		last_[i] = i;
 	}
 }
   
@@ -51,10 +53,12 @@ void MERCDisjointSet::Release()
 {
 	delete [] p_;
 	delete [] size_;
-	delete [] lists_;
+	delete [] next_;
+	delete [] last_;
 	p_ = NULL;
 	size_ = NULL;
-	lists_ = NULL;
+	next_ = NULL;
+	last_ = NULL;
 
 }
 
@@ -94,10 +98,10 @@ int MERCDisjointSet::Join(int x, int y)
 	size_[newID] = aSize+bSize;
 	size_[delID] = 0;
 
-	MListNode<int> *iter;
-	for(iter=lists_[delID].first_;iter!=NULL;iter=iter->next_)
-		p_[iter->data_] = newID;
-	lists_[newID].Append(lists_[delID]);
+	for(int iter=delID;iter!=-1;iter=next_[iter])
+		p_[iter] = newID;
+	next_[last_[newID]] = delID;
+	last_[newID] = last_[delID];
 
 	nElements_--;
 	return newID;
@@ -27,7 +27,6 @@ OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <vector>
 #include <cmath>
 #include <stack>
-#include "MList.h"
 
 
 class MERCDisjointSet
@@ -59,7 +58,9 @@ private:
 
 	int *p_;
 	int *size_;
-	MList<int> *lists_;
+	// the members of a cluster form a list starting at the cluster ID
+	int *next_;
+	int *last_;
 	int nElements_;
 	int nVertices_;
 };
@@ -45,11 +45,13 @@ void MERCFunctions::NormalizeEdgeWeight(MERCInput &edges,double *loop,double wT)
 {
 	int nEdges = edges.nEdges_;
 	int nVertices = edges.nNodes_;
+	#pragma omp parallel for
 	for(int i=0;i<nEdges;i++)
 	{
 		edges.edges_[i].w_ /= wT;
 	}
 
+	#pragma omp parallel for
 	for(int i=0;i<nVertices;i++)
 	{
 		loop[i] /= wT;
@@ -111,6 +113,7 @@ void MERCFunctions::ComputeSimilarityGaussian(MERCInput &edges,double sigma)
 
 	double twoSigmaSquare = 2*sigma*sigma;
 
+	#pragma omp parallel for
 	for(int i=0;i<nEdges;i++)
 	{
 		edges.edges_[i].w_ = exp( -(edges.edges_[i].w_*edges.edges_[i].w_)/twoSigmaSquare );
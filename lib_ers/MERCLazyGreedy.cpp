@@ -21,6 +21,8 @@ AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
 OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE. 
 */
 #include "MERCLazyGreedy.h"
+#include <vector>
+#include <algorithm>
 
 MERCDisjointSet* MERCLazyGreedy::ClusteringTree(int nVertices,MERCInput &edges,int kernel,double sigma,double lambda,int nC)
 {
@@ -31,6 +33,8 @@ MERCDisjointSet* MERCLazyGreedy::ClusteringTree(int nVertices,MERCInput &edges,i
 
 	int nEdges = edges.nEdges_;
 	MERCDisjointSet *u = new MERCDisjointSet(nVertices);
+	merges_.clear();
+	merges_.reserve(std::max(nVertices-nC,0));
 
 	MERCFunctions::ComputeSimilarity(edges,sigma,kernel);
 	double *loop = MERCFunctions::ComputeLoopWeight(nVertices,edges);
@@ -40,25 +44,34 @@ MERCDisjointSet* MERCLazyGreedy::ClusteringTree(int nVertices,MERCInput &edges,i
 	//
 	// Compute initial gain and decide the weighting on the balancing term
 	//
-	double *erGainArr = new double [nEdges];// gain in entropy rate term
-	double *bGainArr = new double [nEdges];	// gain in balancing term
+	// The edges are gathered into separate arrays such that the gains can be
+	// computed in parallel on contiguous data. As the disjoint set is new,
+	// all clusters have size one and the balancing gain is the same for all
+	// edges which are not loops.
+	std::vector<int> edgeA(nEdges), edgeB(nEdges);
+	std::vector<double> edgeW(nEdges), erGainArr(nEdges);	// gain in entropy rate term
+	const double bGainInit = MERCFunctions::ComputeBGain(nVertices, 1, 1);	// gain in balancing term
 	double maxERGain=0,maxBGain=1e-20;
+
+	#pragma omp parallel for
 	for(int i=0;i<nEdges;i++)
 	{
-		erGainArr[i] = MERCFunctions::ComputeERGain( 
-			edges.edges_[i].w_, 
-			loop[edges.edges_[i].a_]-edges.edges_[i].w_,
-			loop[edges.edges_[i].b_]-edges.edges_[i].w_);
-		int a = u->Find(  edges.edges_[i].a_ );
-		int b = u->Find(  edges.edges_[i].b_ );
-		if(a!=b)
-			bGainArr[i] = MERCFunctions::ComputeBGain(nVertices, u->rSize(a), u->rSize(b) );
-		else
-			bGainArr[i] = 0;
+		edgeA[i] = edges.edges_[i].a_;
+		edgeB[i] = edges.edges_[i].b_;
+		edgeW[i] = edges.edges_[i].w_;
+	}
+
+	#pragma omp parallel for reduction(max:maxERGain,maxBGain)
+	for(int i=0;i<nEdges;i++)
+	{
+		erGainArr[i] = MERCFunctions::ComputeERGain(
+			edgeW[i],
+			loop[edgeA[i]]-edgeW[i],
+			loop[edgeB[i]]-edgeW[i]);
 		if(erGainArr[i]>maxERGain)
 			maxERGain = erGainArr[i];
-		if(bGainArr[i]>maxBGain)
-			maxBGain = bGainArr[i];
+		if(edgeA[i]!=edgeB[i] && bGainInit>maxBGain)
+			maxBGain = bGainInit;
 	}
 	double balancing = lambda*maxERGain/std::abs(maxBGain);
 	//double balancing = lambda* log( 1.0*nVertices )/ log( 1.0*nC );
@@ -71,13 +84,11 @@ MERCDisjointSet* MERCLazyGreedy::ClusteringTree(int nVertices,MERCInput &edges,i
 	std::cout<<"Balancing gain = "<<balancing<<std::endl;
 	*/
 
+	#pragma omp parallel for
 	for(int i=0;i<nEdges;i++)
 	{
-		edges.edges_[i].gain_ = erGainArr[i]+balancing*bGainArr[i];
+		edges.edges_[i].gain_ = erGainArr[i]+balancing*(edgeA[i]!=edgeB[i] ? bGainInit : 0);
 	}
-		
-	delete [] erGainArr;
-	delete [] bGainArr;
 
 
 	// Heap
@@ -110,6 +121,7 @@ MERCDisjointSet* MERCLazyGreedy::ClusteringTree(int nVertices,MERCInput &edges,i
 		if(a!=b)
 		{
 			u->Join(a,b);
+			merges_.push_back(make_pair(bestEdge.a_,bestEdge.b_));
 			cc--;
 			loop[bestEdge.a_] -= bestEdge.w_;
 			loop[bestEdge.b_] -= bestEdge.w_;
@@ -125,4 +137,15 @@ MERCDisjointSet* MERCLazyGreedy::ClusteringTree(int nVertices,MERCInput &edges,i
 	//std::cout<<std::fixed<<"[TIME] "<<(t2.QuadPart - t1.QuadPart)/(f.QuadPart*1.0)<<" sec."<<std::endl;
 	
 	return u;
-}
\ No newline at end of file
+}
+
+MERCDisjointSet* MERCLazyGreedy::ClusteringAt(int nVertices,int nC) const
+{
+	MERCDisjointSet *u = new MERCDisjointSet(nVertices);
+	int nMerges = std::min(std::max(nVertices-nC,0),(int)merges_.size());
+
+	for(int i=0;i<nMerges;i++)
+		u->Join(merges_[i].first,merges_[i].second);
+
+	return u;
+}
@@ -24,6 +24,7 @@ OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #define _m_erclustering_lazy_greedy_h_
 
 #include "MERCClustering.h"
+#include <utility>
 
 class MERCLazyGreedy: public MERCClustering
 {
@@ -31,6 +32,13 @@ public:
 
 	// clustering with the cylce-free constraint
 	MERCDisjointSet* ClusteringTree(int nVertices,MERCInput &edges,int kernel,double sigma,double lambda,int nC);
+
+	// clustering with nC clusters (nC >= the nC used in ClusteringTree) obtained
+	// by replaying the recorded merges, the same as stopping the greedy loop at nC
+	MERCDisjointSet* ClusteringAt(int nVertices,int nC) const;
+
+	// the joined vertex pairs in the order of the greedy merges (the dendrogram)
+	vector<pair<int,int> > merges_;
 };
 
 #endif
\ No newline at end of file
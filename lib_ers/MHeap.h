@@ -206,53 +206,43 @@ void MHeap<T>::BuildMaxHeap()
 template <class T>
 void MHeap<T>::MinHeapify(int i)
 {
-	int left,right,smallest;
+	// Sift the element down, moving the hole instead of swapping at every
+	// level; the left child is taken on ties as before.
+	T elem = array_[i];
+	int child = Left(i);
 
-	left = Left(i);
-	right = Right(i);
-
-	if( left <= HeapSize() && array_[left]<array_[i] )
-		smallest = left;
-	else
-		smallest = i;
-
-	if( right <= HeapSize() && array_[right]<array_[smallest] )
-		smallest = right;
-
-	if( smallest != i )
+	while( child <= HeapSize() )
 	{
-		T tmp;
-		tmp = array_[i];
-		array_[i] = array_[smallest];
-		array_[smallest] = tmp;
-		MinHeapify(smallest);
+		if( child+1 <= HeapSize() && array_[child+1]<array_[child] )
+			child++;
+		if( !(array_[child]<elem) )
+			break;
+		array_[i] = array_[child];
+		i = child;
+		child = Left(i);
 	}
+	array_[i] = elem;
 }
 
 template <class T>
 void MHeap<T>::MaxHeapify(int i)
 {
-	int left,right,largest;
+	// Sift the element down, moving the hole instead of swapping at every
+	// level; the left child is taken on ties as before.
+	T elem = array_[i];
+	int child = Left(i);
 
-	left = Left(i);
-	right = Right(i);
-
-	if( left <= HeapSize() && array_[left]>array_[i] )
-		largest = left;
-	else
-		largest = i;
-
-	if( right <= HeapSize() && array_[right]>array_[largest] )
-		largest = right;
-
-	if( largest != i )
+	while( child <= HeapSize() )
 	{
-		T tmp;
-		tmp = array_[i];
-		array_[i] = array_[largest];
-		array_[largest] = tmp;
-		MaxHeapify(largest);
+		if( child+1 <= HeapSize() && array_[child+1]>array_[child] )
+			child++;
+		if( !(array_[child]>elem) )
+			break;
+		array_[i] = array_[child];
+		i = child;
+		child = Left(i);
 	}
+	array_[i] = elem;
 }
 
 
@@ -29,6 +29,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include "MERCLazyGreedy.h"
 #include "MERCInputImage.h"
 #include "MERCOutputImage.h"
@@ -36,14 +37,10 @@
 #include "ImageIO.h"
 #include "ers_opencv.h"
 
-void ERS_OpenCV::computeSuperpixels(const cv::Mat& image, int superpixels, 
-        double lambda, double sigma, int four_connected, cv::Mat& labels) {
+static void convertImage(const cv::Mat& image, int four_connected, 
+        MERCInputImage<RGBMap>& input) {
     
-    int kernel = 0;
-    MERCLazyGreedy merc;
     Image<RGBMap> input_image;
-    MERCInputImage<RGBMap> input;
-
     input_image.Resize(image.cols, image.rows, false);
 
     for (int i = 0; i < image.rows; ++i) {
@@ -56,16 +53,55 @@ void ERS_OpenCV::computeSuperpixels(const cv::Mat& image, int superpixels,
     }
 
     input.ReadImage(&input_image, 1 - four_connected);
+}
+
+static void convertLabels(MERCDisjointSet* disjoint_set, int rows, int cols, 
+        cv::Mat& labels) {
+    
+    vector<int> label = MERCOutputImage::DisjointSetToLabel(disjoint_set);
+
+    labels.create(rows, cols, CV_32SC1);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            labels.at<int>(i, j) = label[j + i*cols];
+        }
+    }
+}
+
+void ERS_OpenCV::computeSuperpixels(const cv::Mat& image, int superpixels, 
+        double lambda, double sigma, int four_connected, cv::Mat& labels) {
+    
+    int kernel = 0;
+    MERCLazyGreedy merc;
+    MERCInputImage<RGBMap> input;
+    convertImage(image, four_connected, input);
 
     merc.ClusteringTreeIF(input.nNodes_, input, kernel, sigma*image.channels(), 
             lambda*1.0*superpixels, superpixels);
 
-    vector<int> label = MERCOutputImage::DisjointSetToLabel(merc.disjointSet_);
+    convertLabels(merc.disjointSet_, image.rows, image.cols, labels);
+}
 
-    labels.create(image.rows, image.cols, CV_32SC1);
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            labels.at<int>(i, j) = label[j + i*image.cols];
-        }
+void ERS_OpenCV::computeSuperpixels(const cv::Mat& image, const std::vector<int>& superpixels, 
+        double lambda, double sigma, int four_connected, std::vector<cv::Mat>& labels) {
+    
+    labels.resize(superpixels.size());
+    if (superpixels.empty()) {
+        return;
+    }
+    
+    int kernel = 0;
+    int min_superpixels = *std::min_element(superpixels.begin(), superpixels.end());
+    MERCLazyGreedy merc;
+    MERCInputImage<RGBMap> input;
+    convertImage(image, four_connected, input);
+
+    merc.ClusteringTreeIF(input.nNodes_, input, kernel, sigma*image.channels(), 
+            lambda*1.0*min_superpixels, min_superpixels);
+
+    for (unsigned int k = 0; k < superpixels.size(); ++k) {
+        MERCDisjointSet* disjoint_set = merc.ClusteringAt(input.nNodes_, superpixels[k]);
+        convertLabels(disjoint_set, image.rows, image.cols, labels[k]);
+        delete disjoint_set;
     }
-}
\ No newline at end of file
+}
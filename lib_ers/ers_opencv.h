@@ -32,6 +32,7 @@
 #ifndef ERS_OPENCV_H
 #define	ERS_OPENCV_H
 
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 /** \brief Wrapper for running ERS on OpenCV images.
@@ -49,6 +50,24 @@ public:
      */
     static void computeSuperpixels(const cv::Mat &image, int superpixels, 
             double lambda, double sigma, int four_connected, cv::Mat &labels);
+    
+    /** \brief Compute superpixels for several numbers of superpixels from a
+     * single run of ERS; the greedy merges are recorded and replayed up to
+     * each number of superpixels.
+     * 
+     * The balancing term is weighted for the smallest number of superpixels,
+     * i.e. the labels for this number equal computeSuperpixels, the others
+     * equal computeSuperpixels with the same balancing weight.
+     * 
+     * \param[in] image image to compute superpixels on
+     * \param[in] superpixels numbers of superpixels
+     * \param[in] lambda lambda parameter, see paper
+     * \param[in] sigma sigma parameter, see paper
+     * \param[in] four_connected 1 to use four connected graph, 0 for eight-connected
+     * \param[out] labels superpixel labels, one per number of superpixels
+     */
+    static void computeSuperpixels(const cv::Mat &image, const std::vector<int> &superpixels, 
+            double lambda, double sigma, int four_connected, std::vector<cv::Mat> &labels);
 };
 
 #endif	/* ERS_OPENCV_H */
@@ -153,16 +153,11 @@ void SGMStereo::allocateDataBuffer() {
 	halfPixelRightMin_ = reinterpret_cast<unsigned char*>(_mm_malloc(halfPixelRightBufferSize*sizeof(unsigned char), 16));
 	halfPixelRightMax_ = reinterpret_cast<unsigned char*>(_mm_malloc(halfPixelRightBufferSize*sizeof(unsigned char), 16));
 
-	pathRowBufferTotal_ = 2;
 	disparitySize_ = disparityTotal_ + 16;
-	pathTotal_ = 8;
-	pathDisparitySize_ = pathTotal_*disparitySize_;
 
 	costSumBufferRowSize_ = width_*disparityTotal_;
 	costSumBufferSize_ = costSumBufferRowSize_*height_;
-	pathMinCostBufferSize_ = (width_ + 2)*pathTotal_;
-	pathCostBufferSize_ = pathMinCostBufferSize_*disparitySize_;
-	totalBufferSize_ = (pathMinCostBufferSize_ + pathCostBufferSize_)*pathRowBufferTotal_ + costSumBufferSize_ + 16;
+	totalBufferSize_ = costSumBufferSize_ + 16;
 
 	sgmBuffer_ = reinterpret_cast<short*>(_mm_malloc(totalBufferSize_*sizeof(short), 16));
 }
@@ -266,6 +261,7 @@ void SGMStereo::computeCappedSobelImage(const unsigned char* image, const bool h
 }
 
 void SGMStereo::computeCensusImage(const unsigned char* image, int* censusImage) const {
+	#pragma omp parallel for
 	for (int y = 0; y < height_; ++y) {
 		for (int x = 0; x < width_; ++x) {
 			unsigned char centerValue = image[width_*y + x];
@@ -549,6 +545,7 @@ void SGMStereo::addPixelwiseHamming(const int* leftCensusRow, const int* rightCe
 void SGMStereo::computeRightCostImage() {
 	const int widthStepCost = width_*disparityTotal_;
 
+	#pragma omp parallel for
 	for (int y = 0; y < height_; ++y) {
 		unsigned short* leftCostRow = leftCostImage_ + widthStepCost*y;
 		unsigned short* rightCostRow = rightCostImage_ + widthStepCost*y;
@@ -586,155 +583,173 @@ void SGMStereo::computeRightCostImage() {
 	}
 }
 
+// Aggregates the cost of one path at one pixel, the previous path costs need costMax at [-1] and [disparityTotal].
+// The path costs are added to the cost sums, returns the minimum of the new path costs.
+static inline short aggregatePathCost(const unsigned short* pixelCost, const short* previousPathCosts, const int previousPathMin,
+									  const int disparityTotal, const __m128i regPenaltySmall, short* pathCosts, short* costSums)
+{
+	__m128i regPathMin = _mm_set1_epi16(static_cast<short>(previousPathMin));
+	__m128i regNewPathMin = _mm_set1_epi16(SHRT_MAX);
+
+	for (int d = 0; d < disparityTotal; d += 8) {
+		__m128i regPixelCost = _mm_load_si128(reinterpret_cast<const __m128i*>(pixelCost + d));
+
+		__m128i regPathCost = _mm_load_si128(reinterpret_cast<const __m128i*>(previousPathCosts + d));
+		regPathCost = _mm_min_epi16(regPathCost,
+									_mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts + d - 1)),
+									regPenaltySmall));
+		regPathCost = _mm_min_epi16(regPathCost,
+									_mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts + d + 1)),
+									regPenaltySmall));
+		regPathCost = _mm_min_epi16(regPathCost, regPathMin);
+		regPathCost = _mm_adds_epi16(_mm_subs_epi16(regPathCost, regPathMin), regPixelCost);
+
+		_mm_store_si128(reinterpret_cast<__m128i*>(pathCosts + d), regPathCost);
+		regNewPathMin = _mm_min_epi16(regNewPathMin, regPathCost);
+
+		__m128i regCostSum = _mm_load_si128(reinterpret_cast<const __m128i*>(costSums + d));
+		regCostSum = _mm_adds_epi16(regCostSum, regPathCost);
+		_mm_store_si128(reinterpret_cast<__m128i*>(costSums + d), regCostSum);
+	}
+
+	regNewPathMin = _mm_min_epi16(regNewPathMin, _mm_srli_si128(regNewPathMin, 8));
+	regNewPathMin = _mm_min_epi16(regNewPathMin, _mm_srli_si128(regNewPathMin, 4));
+	regNewPathMin = _mm_min_epi16(regNewPathMin, _mm_srli_si128(regNewPathMin, 2));
+	return static_cast<short>(_mm_extract_epi16(regNewPathMin, 0));
+}
+
 void SGMStereo::performSGM(unsigned short* costImage, unsigned short* disparityImage) {
 	const short costMax = SHRT_MAX;
+	const int stripWidth = 64;
 
 	int widthStepCostImage = width_*disparityTotal_;
 
 	short* costSums = sgmBuffer_;
 	memset(costSums, 0, costSumBufferSize_*sizeof(short));
 
-	short** pathCosts = new short*[pathRowBufferTotal_];
-	short** pathMinCosts = new short*[pathRowBufferTotal_];
-
-	const int processPassTotal = 2;
-	for (int processPassCount = 0; processPassCount < processPassTotal; ++processPassCount) {
-		int startX, endX, stepX;
-		int startY, endY, stepY;
-		if (processPassCount == 0) {
-			startX = 0; endX = width_; stepX = 1;
-			startY = 0; endY = height_; stepY = 1;
-		} else {
-			startX = width_ - 1; endX = -1; stepX = -1;
-			startY = height_ - 1; endY = -1; stepY = -1;
-		}
+	__m128i regPenaltySmall = _mm_set1_epi16(static_cast<short>(smoothnessPenaltySmall_));
 
-		for (int i = 0; i < pathRowBufferTotal_; ++i) {
-			pathCosts[i] = costSums + costSumBufferSize_ + pathCostBufferSize_*i + pathDisparitySize_ + 8;
-			memset(pathCosts[i] - pathDisparitySize_ - 8, 0, pathCostBufferSize_*sizeof(short));
-			pathMinCosts[i] = costSums + costSumBufferSize_ + pathCostBufferSize_*pathRowBufferTotal_
-				+ pathMinCostBufferSize_*i + pathTotal_*2;
-			memset(pathMinCosts[i] - pathTotal_, 0, pathMinCostBufferSize_*sizeof(short));
-		}
+	// Horizontal paths (both directions), rows are independent
+	#pragma omp parallel
+	{
+		short* pathCostBuffer = reinterpret_cast<short*>(_mm_malloc(2*disparitySize_*sizeof(short), 16));
 
-		for (int y = startY; y != endY; y += stepY) {
-			unsigned short* pixelCostRow = costImage + widthStepCostImage*y;
+		#pragma omp for schedule(dynamic)
+		for (int y = 0; y < height_; ++y) {
+			const unsigned short* pixelCostRow = costImage + widthStepCostImage*y;
 			short* costSumRow = costSums + costSumBufferRowSize_*y;
 
-			memset(pathCosts[0] - pathDisparitySize_ - 8, 0, pathDisparitySize_*sizeof(short));
-			memset(pathCosts[0] + width_*pathDisparitySize_ - 8, 0, pathDisparitySize_*sizeof(short));
-			memset(pathMinCosts[0] - pathTotal_, 0, pathTotal_*sizeof(short));
-			memset(pathMinCosts[0] + width_*pathTotal_, 0, pathTotal_*sizeof(short));
-
-			for (int x = startX; x != endX; x += stepX) {
-				int pathMinX = x*pathTotal_;
-				int pathX = pathMinX*disparitySize_;
-
-				int previousPathMin0 = pathMinCosts[0][pathMinX - stepX*pathTotal_] + smoothnessPenaltyLarge_;
-				int previousPathMin2 = pathMinCosts[1][pathMinX + 2] + smoothnessPenaltyLarge_;
-
-				short* previousPathCosts0 = pathCosts[0] + pathX - stepX*pathDisparitySize_;
-				short* previousPathCosts2 = pathCosts[1] + pathX + disparitySize_*2;
-
-				previousPathCosts0[-1] = previousPathCosts0[disparityTotal_] = costMax;
-				previousPathCosts2[-1] = previousPathCosts2[disparityTotal_] = costMax;
-
-				short* pathCostCurrent = pathCosts[0] + pathX;
-				const unsigned short* pixelCostCurrent = pixelCostRow + disparityTotal_*x;
-				short* costSumCurrent = costSumRow + disparityTotal_*x;
-
-				__m128i regPenaltySmall = _mm_set1_epi16(static_cast<short>(smoothnessPenaltySmall_));
-
-				__m128i regPathMin0, regPathMin2;
-				regPathMin0 = _mm_set1_epi16(static_cast<short>(previousPathMin0));
-				regPathMin2 = _mm_set1_epi16(static_cast<short>(previousPathMin2));
-				__m128i regNewPathMin = _mm_set1_epi16(costMax);
-
-				for (int d = 0; d < disparityTotal_; d += 8) {
-					__m128i regPixelCost = _mm_load_si128(reinterpret_cast<const __m128i*>(pixelCostCurrent + d));
-
-					__m128i regPathCost0, regPathCost2;
-					regPathCost0 = _mm_load_si128(reinterpret_cast<const __m128i*>(previousPathCosts0 + d));
-					regPathCost2 = _mm_load_si128(reinterpret_cast<const __m128i*>(previousPathCosts2 + d));
-
-					regPathCost0 = _mm_min_epi16(regPathCost0,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts0 + d - 1)),
-												 regPenaltySmall));
-					regPathCost0 = _mm_min_epi16(regPathCost0,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts0 + d + 1)),
-												 regPenaltySmall));
-					regPathCost2 = _mm_min_epi16(regPathCost2,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts2 + d - 1)),
-												 regPenaltySmall));
-					regPathCost2 = _mm_min_epi16(regPathCost2,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts2 + d + 1)),
-												 regPenaltySmall));
+			for (int stepX = 1; stepX >= -1; stepX -= 2) {
+				int startX = (stepX > 0) ? 0 : width_ - 1;
+				int endX = (stepX > 0) ? width_ : -1;
+
+				short* previousPathCosts = pathCostBuffer + 8;
+				short* pathCosts = pathCostBuffer + disparitySize_ + 8;
+				memset(pathCostBuffer, 0, 2*disparitySize_*sizeof(short));
+				int previousPathMin = 0;
+
+				for (int x = startX; x != endX; x += stepX) {
+					previousPathCosts[-1] = previousPathCosts[disparityTotal_] = costMax;
+					previousPathMin = aggregatePathCost(pixelCostRow + disparityTotal_*x, previousPathCosts,
+														previousPathMin + smoothnessPenaltyLarge_, disparityTotal_, regPenaltySmall,
+														pathCosts, costSumRow + disparityTotal_*x);
+					std::swap(previousPathCosts, pathCosts);
+				}
+			}
+		}
 
-					regPathCost0 = _mm_min_epi16(regPathCost0, regPathMin0);
-					regPathCost0 = _mm_adds_epi16(_mm_subs_epi16(regPathCost0, regPathMin0), regPixelCost);
-					regPathCost2 = _mm_min_epi16(regPathCost2, regPathMin2);
-					regPathCost2 = _mm_adds_epi16(_mm_subs_epi16(regPathCost2, regPathMin2), regPixelCost);
+		_mm_free(pathCostBuffer);
+	}
 
-					_mm_store_si128(reinterpret_cast<__m128i*>(pathCostCurrent + d), regPathCost0);
-					_mm_store_si128(reinterpret_cast<__m128i*>(pathCostCurrent + d + disparitySize_*2), regPathCost2);
+	// Vertical paths (both directions), strips of columns are independent
+	const int stripTotal = (width_ + stripWidth - 1)/stripWidth;
+	#pragma omp parallel
+	{
+		short* pathCostBuffer = reinterpret_cast<short*>(_mm_malloc(2*stripWidth*disparitySize_*sizeof(short), 16));
+		short* pathMinBuffer = new short[2*stripWidth];
+
+		#pragma omp for schedule(dynamic)
+		for (int strip = 0; strip < stripTotal; ++strip) {
+			int stripStartX = strip*stripWidth;
+			int stripEndX = std::min(width_, stripStartX + stripWidth);
+
+			for (int stepY = 1; stepY >= -1; stepY -= 2) {
+				int startY = (stepY > 0) ? 0 : height_ - 1;
+				int endY = (stepY > 0) ? height_ : -1;
+
+				short* previousPathCostRow = pathCostBuffer + 8;
+				short* pathCostRow = pathCostBuffer + stripWidth*disparitySize_ + 8;
+				short* previousPathMins = pathMinBuffer;
+				short* pathMins = pathMinBuffer + stripWidth;
+				memset(pathCostBuffer, 0, 2*stripWidth*disparitySize_*sizeof(short));
+				memset(pathMinBuffer, 0, 2*stripWidth*sizeof(short));
+
+				for (int y = startY; y != endY; y += stepY) {
+					const unsigned short* pixelCostRow = costImage + widthStepCostImage*y;
+					short* costSumRow = costSums + costSumBufferRowSize_*y;
+
+					for (int x = stripStartX; x < stripEndX; ++x) {
+						int stripX = x - stripStartX;
+						short* previousPathCosts = previousPathCostRow + disparitySize_*stripX;
+
+						previousPathCosts[-1] = previousPathCosts[disparityTotal_] = costMax;
+						pathMins[stripX] = aggregatePathCost(pixelCostRow + disparityTotal_*x, previousPathCosts,
+															 previousPathMins[stripX] + smoothnessPenaltyLarge_, disparityTotal_, regPenaltySmall,
+															 pathCostRow + disparitySize_*stripX, costSumRow + disparityTotal_*x);
+					}
 
-					__m128i regMin02 = _mm_min_epi16(_mm_unpacklo_epi16(regPathCost0, regPathCost2),
-													 _mm_unpackhi_epi16(regPathCost0, regPathCost2));
-					regMin02 = _mm_min_epi16(_mm_unpacklo_epi16(regMin02, regMin02),
-											 _mm_unpackhi_epi16(regMin02, regMin02));
-					regNewPathMin = _mm_min_epi16(regNewPathMin, regMin02);
+					std::swap(previousPathCostRow, pathCostRow);
+					std::swap(previousPathMins, pathMins);
+				}
+			}
+		}
 
-					__m128i regCostSum = _mm_load_si128(reinterpret_cast<const __m128i*>(costSumCurrent + d));
+		delete[] pathMinBuffer;
+		_mm_free(pathCostBuffer);
+	}
 
-					regCostSum = _mm_adds_epi16(regCostSum, regPathCost0);
-					regCostSum = _mm_adds_epi16(regCostSum, regPathCost2);
+	// Winner takes all with subpixel refinement
+	const __m128i regSignFlip = _mm_set1_epi16(static_cast<short>(0x8000));
+	#pragma omp parallel for
+	for (int y = 0; y < height_; ++y) {
+		short* costSumRow = costSums + costSumBufferRowSize_*y;
+		unsigned short* disparityRow = disparityImage + width_*y;
 
-					_mm_store_si128(reinterpret_cast<__m128i*>(costSumCurrent + d), regCostSum);
+		for (int x = 0; x < width_; ++x) {
+			short* costSumCurrent = costSumRow + disparityTotal_*x;
+
+			// minpos works on unsigned values, flipping the sign bit keeps the order;
+			// the first disparity with the minimum cost wins
+			int bestSumCost = INT_MAX;
+			int bestDisparity = 0;
+			for (int d = 0; d < disparityTotal_; d += 8) {
+				__m128i regCostSum = _mm_xor_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(costSumCurrent + d)), regSignFlip);
+				__m128i regMinPos = _mm_minpos_epu16(regCostSum);
+				int blockMinCost = _mm_extract_epi16(regMinPos, 0);
+				if (blockMinCost < bestSumCost) {
+					bestSumCost = blockMinCost;
+					bestDisparity = d + _mm_extract_epi16(regMinPos, 1);
 				}
-
-				regNewPathMin = _mm_min_epi16(regNewPathMin, _mm_srli_si128(regNewPathMin, 8));
-				_mm_storel_epi64(reinterpret_cast<__m128i*>(&pathMinCosts[0][pathMinX]), regNewPathMin);
 			}
 
-			if (processPassCount == processPassTotal - 1) {
-				unsigned short* disparityRow = disparityImage + width_*y;
-
-				for (int x = 0; x < width_; ++x) {
-					short* costSumCurrent = costSumRow + disparityTotal_*x;
-					int bestSumCost = costSumCurrent[0];
-					int bestDisparity = 0;
-					for (int d = 1; d < disparityTotal_; ++d) {
-						if (costSumCurrent[d] < bestSumCost) {
-							bestSumCost = costSumCurrent[d];
-							bestDisparity = d;
-						}
-					}
-
-					if (bestDisparity > 0 && bestDisparity < disparityTotal_ - 1) {
-						int centerCostValue = costSumCurrent[bestDisparity];
-						int leftCostValue = costSumCurrent[bestDisparity - 1];
-						int rightCostValue = costSumCurrent[bestDisparity + 1];
-						if (rightCostValue < leftCostValue) {
-							bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
-															 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - leftCostValue)/2.0*disparityFactor_ + 0.5);
-						} else {
-							bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
-															 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - rightCostValue)/2.0*disparityFactor_ + 0.5);
-						}
-					} else {
-						bestDisparity = static_cast<int>(bestDisparity*disparityFactor_);
-					}
-
-					disparityRow[x] = static_cast<unsigned short>(bestDisparity);
+			if (bestDisparity > 0 && bestDisparity < disparityTotal_ - 1) {
+				int centerCostValue = costSumCurrent[bestDisparity];
+				int leftCostValue = costSumCurrent[bestDisparity - 1];
+				int rightCostValue = costSumCurrent[bestDisparity + 1];
+				if (rightCostValue < leftCostValue) {
+					bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
+													 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - leftCostValue)/2.0*disparityFactor_ + 0.5);
+				} else {
+					bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
+													 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - rightCostValue)/2.0*disparityFactor_ + 0.5);
 				}
+			} else {
+				bestDisparity = static_cast<int>(bestDisparity*disparityFactor_);
 			}
 
-			std::swap(pathCosts[0], pathCosts[1]);
-			std::swap(pathMinCosts[0], pathMinCosts[1]);
+			disparityRow[x] = static_cast<unsigned short>(bestDisparity);
 		}
 	}
-	delete[] pathCosts;
-	delete[] pathMinCosts;
 
 	speckleFilter(100, static_cast<int>(2*disparityFactor_), disparityImage);
 }
@@ -85,14 +85,9 @@ private:
 	unsigned short* rowAggregatedCost_;
 	unsigned char* halfPixelRightMin_;
 	unsigned char* halfPixelRightMax_;
-	int pathRowBufferTotal_;
 	int disparitySize_;
-	int pathTotal_;
-	int pathDisparitySize_;
 	int costSumBufferRowSize_;
 	int costSumBufferSize_;
-	int pathMinCostBufferSize_;
-	int pathCostBufferSize_;
 	int totalBufferSize_;
 	short* sgmBuffer_;
 };
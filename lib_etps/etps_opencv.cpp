@@ -36,8 +36,10 @@
 #include "SGMStereo.h"
 #include "etps_opencv.h"
 
-void ETPS_OpenCV::computeSuperpixels(const cv::Mat &image, int region_size, 
-        double regularization_weight, double length_weight, double size_weight, int iterations, cv::Mat &labels) {
+// Parameters used by both the static and the warm started interface.
+static SPSegmentationParameters createParameters(int region_size, 
+        double regularization_weight, double length_weight, double size_weight, 
+        int iterations, int threads) {
     
     SPSegmentationParameters params;
     params.superpixelNum = 0; // Do not set both superpixelNum and gridSize to greater zero!
@@ -69,14 +71,67 @@ void ETPS_OpenCV::computeSuperpixels(const cv::Mat &image, int region_size,
     params.inpaint = false;
     params.debugOutput = false;
     params.timingOutput = false;
+    params.threads = threads;
     
     time_t  timev;
     params.randomSeed = time(&timev);
     
+    return params;
+}
+
+void ETPS_OpenCV::computeSuperpixels(const cv::Mat &image, int region_size, 
+        double regularization_weight, double length_weight, double size_weight, int iterations, cv::Mat &labels,
+        int threads, std::string* performance) {
+    
+    SPSegmentationParameters params = createParameters(region_size, 
+            regularization_weight, length_weight, size_weight, iterations, threads);
+    
     SPSegmentationEngine engine(params, image);
     engine.ProcessImage();
+    
+    if (performance != NULL) {
+        *performance = engine.GetPerformanceInfoJSON();
+    }
 
     // Returns unsigned short!
     labels = engine.GetSegmentation();
     labels.convertTo(labels, CV_32S);
 }
+
+ETPS_OpenCV::ETPS_OpenCV(int region_size_, double regularization_weight_, 
+        double length_weight_, double size_weight_, int iterations_, int threads_) :
+        region_size(region_size_), regularization_weight(regularization_weight_),
+        length_weight(length_weight_), size_weight(size_weight_), 
+        iterations(iterations_), threads(threads_), engine(NULL) {
+    
+}
+
+ETPS_OpenCV::~ETPS_OpenCV() {
+    delete engine;
+}
+
+void ETPS_OpenCV::computeNextSuperpixels(const cv::Mat &image, cv::Mat &labels,
+        std::string* performance) {
+    
+    if (engine != NULL && engine_size == image.size()) {
+        engine->ProcessNextImage(image);
+    }
+    else {
+        delete engine;
+        
+        SPSegmentationParameters params = createParameters(region_size, 
+                regularization_weight, length_weight, size_weight, iterations, threads);
+        
+        engine = new SPSegmentationEngine(params, image);
+        engine->ProcessImage();
+        engine_size = image.size();
+    }
+    
+    if (performance != NULL) {
+        *performance = engine->GetPerformanceInfoJSON();
+    }
+    
+    // Returns unsigned short!
+    labels = engine->GetSegmentation();
+    labels.convertTo(labels, CV_32S);
+}
@@ -32,11 +32,40 @@
 #ifndef ETPS_OPENCV_H
 #define	ETPS_OPENCV_H
 
+#include <string>
+
+class SPSegmentationEngine;
+
 /** \brief Wrapper for running ETPS on OpenCV images.
+ * 
+ * Besides the static computeSuperpixels, an instance can be used to process
+ * the frames of a video: the engine of the previous frame, including pixel grid,
+ * superpixels and labels, is used as initialization and only the finest level
+ * is iterated.
  * \author David Stutz
  */
 class ETPS_OpenCV {
 public:
+    /** \brief Constructor, see computeSuperpixels for the parameters.
+     */
+    ETPS_OpenCV(int region_size, double regularization_weight, 
+            double length_weight, double size_weight, int iterations,
+            int threads = 1);
+    
+    /** \brief Destructor.
+     */
+    ~ETPS_OpenCV();
+    
+    /** \brief Compute superpixels on the next frame; warm started from the 
+     * previous frame if it has the same size.
+     * \param[in] image image to compute superpixels on
+     * \param[out] labels superpixel labels
+     * \param[out] performance if not NULL, per phase/level timings as JSON object
+     */
+    void computeNextSuperpixels(const cv::Mat &image, cv::Mat &labels,
+            std::string* performance = NULL);
+    
+
     /** \brief Compute superpixels using ETPS.
      * \param[in] image image to compute superpixels on
      * \param[in] region_size step size between superpixel centers, implicitly defining the number of superpixels
@@ -44,10 +73,31 @@ public:
      * \param[in] size_weight size weight
      * \param[in] iterations number of iterations
      * \param[out] labels superpixel labels
+     * \param[in] threads number of threads used for the pixel moves
+     * \param[out] performance if not NULL, per phase/level timings as JSON object
      */
     static void computeSuperpixels(const cv::Mat &image, int region_size,
             double regularization_weight, double length_weight, 
-            double size_weight, int iterations, cv::Mat &labels);
+            double size_weight, int iterations, cv::Mat &labels,
+            int threads = 1, std::string* performance = NULL);
+    
+private:
+    
+    ETPS_OpenCV(const ETPS_OpenCV&);
+    ETPS_OpenCV& operator=(const ETPS_OpenCV&);
+    
+    /** \brief Parameters of the engine. */
+    int region_size;
+    double regularization_weight;
+    double length_weight;
+    double size_weight;
+    int iterations;
+    int threads;
+    
+    /** \brief Engine of the previous frame, NULL before the first frame. */
+    SPSegmentationEngine* engine;
+    /** \brief Size of the previous frame. */
+    cv::Size engine_size;
 };
 
 #endif	/* ETPS_OPENCV_H */
@@ -158,7 +158,7 @@ static ConnectivityCache connectivityCache;
 
 ostream& operator<<(ostream& os, const Timer& t)
 {
-    os << ((double)(t.time) / CLOCKS_PER_SEC);
+    os << std::chrono::duration<double>(t.time).count();
     return os;
 }
 
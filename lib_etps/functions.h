@@ -2,50 +2,53 @@
 
 #include "stdafx.h"
 #include "structures.h"
+#include <chrono>
 
+// Wall clock timer (clock() would add up the time of all threads)
 class Timer {
 private:
-    clock_t startTime, time;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::duration time;
     bool running;
 public:
     Timer(bool run = true)
     { 
         if (run) Reset();
         else {
-            startTime = time = 0;
+            time = std::chrono::steady_clock::duration::zero();
             running = false;
         }
     }
 
     void Reset() 
     { 
-        time = 0;
-        startTime = clock();
+        time = std::chrono::steady_clock::duration::zero();
+        startTime = std::chrono::steady_clock::now();
         running = true;
     }
 
     void Stop() 
     { 
         if (running) {
-            time += clock() - startTime;
+            time += std::chrono::steady_clock::now() - startTime;
             running = false;
         }
     }
 
     void Resume()
     {
-        startTime = clock();
+        startTime = std::chrono::steady_clock::now();
         running = true;
     }
 
-    clock_t GetTime()
+    std::chrono::steady_clock::duration GetTime()
     {
         return time;
     }
 
     double GetTimeInSec()
     {
-        return (double)time / CLOCKS_PER_SEC;
+        return std::chrono::duration<double>(time).count();
     }
 
     friend ostream& operator<<(ostream& os, const Timer& t);
@@ -2,6 +2,7 @@
 
 #include <cstdlib>
 #include <algorithm>
+#include <atomic>
 #include "sallocator.h"
 
 // memory allocation
@@ -10,33 +11,117 @@
 // mem_allocator
 //////////////////
 
-MemAllocator::MemAllocator(size_t slotSize_, size_t slotCount_, const string& name_) :
+static atomic<size_t> allocatorCount(0);
+
+const size_t MemAllocator::cacheSize;
+
+// Slots hold the free list pointer and must keep the objects aligned
+static size_t AlignedSlotSize(size_t size)
+{
+    const size_t alignment = max(sizeof(void*), sizeof(double));
+
+    return (max(size, sizeof(void*)) + alignment - 1)/alignment*alignment;
+}
+
+MemAllocator::MemAllocator(size_t slotSize_, size_t slotCount_, const string& name_, size_t expandSize_) :
     name(name_),
-    memPool(nullptr), 
-    slotSize(max(slotSize_, sizeof(void*))), 
-    slotCount(max(slotCount_, (size_t)1))
-{ 
-    InitMemPool();
-    freeSlot = memPool;
+    slab(0),
+    freeSlot(nullptr),
+    slotSize(AlignedSlotSize(slotSize_)),
+    slotCount(max(slotCount_, (size_t)1)),
+    expandSize(expandSize_ > 0 ? expandSize_ : max(slotCount_, (size_t)1)),
+    generation(0),
+    id(allocatorCount++)
+{
+    void* memPool = malloc(slotCount*slotSize);
+
+    if (memPool == nullptr) throw MemAllocatorException();
+    slabs.push_back(memPool);
+    nextSlot = (char*)memPool;
+    slabEnd = nextSlot + slotCount*slotSize;
 }
 
 MemAllocator::~MemAllocator()
 {
-    free(memPool);
+    for (void* memPool : slabs) free(memPool);
+}
+
+void MemAllocator::Reset()
+{
+    slab = 0;
+    nextSlot = (char*)slabs[0];
+    slabEnd = nextSlot + slotCount*slotSize;
+    freeSlot = nullptr;
+    generation++;
 }
 
-void MemAllocator::InitMemPool()
+// Moves up to cacheSize slots from the shared list to the thread cache, takes
+// unused slots from the slabs (adding slabs if needed) if the shared list is empty.
+void MemAllocator::Refill(ThreadCache& tc)
 {
-    memPool = malloc(slotCount*slotSize);
+    unique_lock<mutex> lck(m);
+
+    if (freeSlot != nullptr) {
+        void* last = freeSlot;
+        size_t n = 1;
 
-    char* ptr = (char*)memPool;
+        while (n < cacheSize && ((InfoBlock*)last)->nextFree != nullptr) {
+            last = ((InfoBlock*)last)->nextFree;
+            n++;
+        }
+        tc.freeSlot = freeSlot;
+        freeSlot = ((InfoBlock*)last)->nextFree;
+        ((InfoBlock*)last)->nextFree = nullptr;
+        tc.count = n;
+    } else {
+        if (nextSlot == slabEnd) NextSlab();
 
-    for (int i = 1; i < slotCount; i++) {
-        char* nextPtr = ptr + slotSize;
-        ((InfoBlock*)ptr)->nextFree = nextPtr;
-        ptr = nextPtr;
+        size_t n = min(cacheSize, (size_t)(slabEnd - nextSlot)/slotSize);
+        char* ptr = nextSlot;
+
+        for (size_t i = 1; i < n; i++) {
+            char* nextPtr = ptr + slotSize;
+            ((InfoBlock*)ptr)->nextFree = nextPtr;
+            ptr = nextPtr;
+        }
+        ((InfoBlock*)ptr)->nextFree = nullptr;
+        tc.freeSlot = nextSlot;
+        tc.count = n;
+        nextSlot += n*slotSize;
     }
-    ((InfoBlock*)ptr)->nextFree = nullptr;
 }
 
+// Moves cacheSize slots from the thread cache back to the shared list.
+void MemAllocator::Flush(ThreadCache& tc)
+{
+    void* first = tc.freeSlot;
+    void* last = first;
+
+    for (size_t i = 1; i < cacheSize; i++) last = ((InfoBlock*)last)->nextFree;
+    tc.freeSlot = ((InfoBlock*)last)->nextFree;
+    tc.count -= cacheSize;
+
+    unique_lock<mutex> lck(m);
+
+    ((InfoBlock*)last)->nextFree = freeSlot;
+    freeSlot = first;
+}
+
+// Continues with the next slab, allocates it if it does not exist yet
+// (slabs are kept across Reset).
+void MemAllocator::NextSlab()
+{
+    slab++;
+    if (slab == slabs.size()) {
+        void* memPool = malloc(expandSize*slotSize);
+
+        if (memPool == nullptr) {
+            slab--;
+            throw MemAllocatorException();
+        }
+        slabs.push_back(memPool);
+    }
+    nextSlot = (char*)slabs[slab];
+    slabEnd = nextSlot + expandSize*slotSize;
+}
 
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <mutex>
 
 using namespace std;
 
@@ -8,13 +10,21 @@ using namespace std;
 // MemAllocator
 ///////////////////////////////////////////////////////////////////////////////
 
+// - Fixed size slot allocator, growing in slabs (chunks of slots)
+// - Free slots form an intrusive list (first word of each free slot)
+// - Each thread has a small cache of free slots per allocator, the shared
+//   list is only locked when a cache runs empty or overflows
+// - Reset releases all slots at once (while no other thread uses the
+//   allocator); objects are not destructed
+
 #define CLASS_ALLOCATION()\
     private:\
         static MemAllocator _allocator;\
     public:\
         void* operator new(size_t count) { return _allocator.Allocate(); }\
-        void operator delete(void* object) { _allocator.Free(object); }
-        
+        void operator delete(void* object) { _allocator.Free(object); }\
+        static void ResetAllocator() { _allocator.Reset(); }
+
 #define DEFINE_CLASS_ALLOCATOR(_class) MemAllocator _class::_allocator(sizeof(_class), 1024, #_class);
 #define DEFINE_CLASS_ALLOCATOR_2(_class, _size) MemAllocator _class::_allocator(sizeof(_class), _size, #_class);
 
@@ -28,44 +38,78 @@ protected:
         void* nextFree;
     };
 
+    struct ThreadCache {
+        ThreadCache() : freeSlot(nullptr), count(0), generation(0) { }
+        void* freeSlot;     // thread local list of free slots
+        size_t count;       // number of slots in the list
+        size_t generation;  // generation of the allocator the slots belong to
+    };
+
     string name;        // name of the allocator, for debug purposes...
-    void* memPool;      // pointer to memory pool
-    void* freeSlot;     // pointer to free slot 
+    vector<void*> slabs;// memory pool, slabs[0] has slotCount slots, the others expandSize
+    size_t slab;        // slab used for new slots
+    char* nextSlot;     // next unused slot in slab
+    char* slabEnd;      // end of slab
+    void* freeSlot;     // shared list of free slots
     size_t slotSize;    // size of slot (size of structure using this as its allocator)
-    size_t slotCount;   // number of slots
-    size_t memSize;     // size of memory
+    size_t slotCount;   // number of slots in the first slab
     size_t expandSize;  // number of slots added to the size of the pool when
-                        // re-alloaction is needed. If 0, MemAllocatorException
-                        // is thrown Not used (re-allocation not implemented)
+                        // re-alloaction is needed.
+    size_t generation;  // incremented by Reset, invalidates thread caches
+    size_t id;          // index of the allocator in the thread caches
+    mutex m;
+
+    static const size_t cacheSize = 64; // slots moved between cache and shared list at once
 public:
-    MemAllocator(size_t slotSize_, size_t slotCount_, const string& name_);
+    MemAllocator(size_t slotSize_, size_t slotCount_, const string& name_, size_t expandSize_ = 0);
 
 	virtual ~MemAllocator();
 
 	void* Allocate()
 	{
-        if (freeSlot == nullptr) throw MemAllocatorException();
-
-        InfoBlock* ib = (InfoBlock*)freeSlot;
-        if (ib->nextFree == nullptr) {
-            throw MemAllocatorException(); 
-            // extend to allow re-allocation
-        } else {
-            void* result = freeSlot;
-            freeSlot = ib->nextFree;
-            return result;
-        }
+        ThreadCache& tc = GetThreadCache();
+
+        if (tc.freeSlot == nullptr) Refill(tc);
+
+        void* result = tc.freeSlot;
+        tc.freeSlot = ((InfoBlock*)result)->nextFree;
+        tc.count--;
+        return result;
     }
 
     void Free(void* p)
     {
+        ThreadCache& tc = GetThreadCache();
+
         InfoBlock* ib = (InfoBlock*)p;
-        ib->nextFree = freeSlot;
-        freeSlot = p;
+        ib->nextFree = tc.freeSlot;
+        tc.freeSlot = p;
+        tc.count++;
+        if (tc.count > 2*cacheSize) Flush(tc);
 	}
 
+    // Releases all slots in O(1), the slabs are kept for re-use. Must not be
+    // called while other threads allocate or free.
+    void Reset();
+
 protected:
-    void InitMemPool();  
+    ThreadCache& GetThreadCache()
+    {
+        static thread_local vector<ThreadCache> caches;
+
+        if (caches.size() <= id) caches.resize(id + 1);
+
+        ThreadCache& tc = caches[id];
+        if (tc.generation != generation) {
+            tc = ThreadCache();
+            tc.generation = generation;
+        }
+        return tc;
+    }
+
+    void Refill(ThreadCache& tc);
+    void Flush(ThreadCache& tc);
+    void NextSlab();
 };
 
 
@@ -6,9 +6,11 @@
 #include <unordered_map>
 #include <fstream>   
 #include <thread>
+#include <atomic>
 #include <stdexcept>
 #include <cmath>
 #include <iomanip>
+#include <sstream>
 
 #define PRINT_LEVEL_PARAM_DOUBLE(field) \
     cout << "*" << #field << ": " << setprecision(4) << field << endl;
@@ -54,7 +56,7 @@ double TotalEnergyDelta(const SPSegmentationParameters& params, PixelMoveData* p
 void UpdateHingeBoundaryData(const Pixel* r, byte sideFlag, const Pixel* sideP, SuperpixelStereo* sp, SuperpixelStereo* sq,
     const cv::Mat1d& depthImg, double inlierThresh,
     BorderDataMap& bcdp, BorderDataMap& bcdq,
-    unordered_set<SuperpixelStereo*>& nbsps)
+    SmallSet<SuperpixelStereo*, 4>& nbsps)
 {
     if (r == nullptr || sideP == nullptr) return;
 
@@ -119,13 +121,13 @@ void EstimateBorderType(const SPSegmentationParameters& params, SuperpixelStereo
 
 // On-the-fly re-estimation
 void CalcBorderChangeDataStereo(const Matrix<Pixel>& pixelsImg, const cv::Mat1d& depthImg, 
-    const SPSegmentationParameters& params, Pixel* p, Pixel* q, BorderDataMap& bcdp, BorderDataMap& bcdq, unordered_set<SuperpixelStereo*>& prem)
+    const SPSegmentationParameters& params, Pixel* p, Pixel* q, BorderDataMap& bcdp, BorderDataMap& bcdq, vector<SuperpixelStereo*>& prem)
 {
     // Move p from sp -> sq
     SuperpixelStereo* sp = (SuperpixelStereo*)p->superPixel;
     SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel;
     const Pixel* r;
-    unordered_set<SuperpixelStereo*> nbsps;    // Neighbors of p (other than sp and sq), make something more lightwight
+    SmallSet<SuperpixelStereo*, 4> nbsps;      // Neighbors of p (other than sp and sq), at most one per side
 
     // Make copy
     bcdp = sp->boundaryData;
@@ -169,7 +171,7 @@ void CalcBorderChangeDataStereo(const Matrix<Pixel>& pixelsImg, const cv::Mat1d&
 
     // Remove "neighbors" of sp with length 0
     for (auto& bdIter : bcdp) {
-        if (bdIter.second.length <= 0) prem.insert(bdIter.first);
+        if (bdIter.second.length <= 0) prem.push_back(bdIter.first);
     }
     for (SuperpixelStereo* sr : prem) {
         bcdp.erase(sr);
@@ -268,6 +270,7 @@ void SPSegmentationParameters::SetLevelParams(int level)
         PRINT_PARAM(iterations);
         PRINT_PARAM(inlierThreshold);
         PRINT_PARAM(maxUpdates);
+        PRINT_PARAM(threads);
         PRINT_PARAM(minPixelSize);
         PRINT_PARAM(maxPixelSize);
         PRINT_PARAM(updateThreshold);
@@ -297,7 +300,7 @@ void UpdateFromNode(bool& val, const FileNode& node)
 
 
 SPSegmentationEngine::SPSegmentationEngine(SPSegmentationParameters params, Mat im, Mat depthIm) :
-    params(params), origImg(im)
+    params(params), origImg(im), initialMaxPixelSize(0), finestLevel(0), finestMaxPixelSize(0)
 {
     planeSmoothWeight = 1;   // Calculated from params in initialization
     planeSmoothWeightCo = 0.1;
@@ -516,18 +519,30 @@ void SPSegmentationEngine::ProcessImage()
 
         performanceInfo.levelMaxPixelSize.push_back(maxPixelSize);
         performanceInfo.levelIterations.push_back(0);
+        performanceInfo.levelMoves.push_back(0);
         for (int iteration = 0; iteration < params.iterations; iteration++) {
-            int iters = IterateMoves(level);
+            int iters = IterateMoves(level, performanceInfo.levelMoves.back());
             if (iters > performanceInfo.levelIterations.back())
                 performanceInfo.levelIterations.back() = iters;
         }
+        t2.Stop();
+        performanceInfo.levelIterateTimes.push_back(t2.GetTimeInSec());
+        t2.Resume();
+
+        Timer t3;
+
         if (maxPixelSize <= params.minPixelSize) splitted = false;
         else splitted = SplitPixels(maxPixelSize);
         level--;
 
+        t3.Stop();
+        performanceInfo.levelSplitTimes.push_back(t3.GetTimeInSec());
+
         t2.Stop();
         performanceInfo.levelTimes.push_back(t2.GetTimeInSec());
     } while (splitted);
+    finestLevel = level + 1;
+    finestMaxPixelSize = performanceInfo.levelMaxPixelSize.back();
 
     t0.Stop();
     t1.Stop();
@@ -535,6 +550,58 @@ void SPSegmentationEngine::ProcessImage()
     performanceInfo.imgproc = t1.GetTimeInSec();
 }
 
+// Warm start for the next frame of a video (non-stereo only, see ProcessImage):
+// the pixel grid (at the finest level), the superpixels and the labels of the 
+// previous image are re-used as initialization, only the colors of the 
+// superpixels are recomputed and only the finest level is iterated.
+void SPSegmentationEngine::ProcessNextImage(Mat im)
+{
+    CV_Assert(!superpixels.empty() && !params.stereo);
+    CV_Assert(im.rows == origImg.rows && im.cols == origImg.cols);
+
+    Timer t0;
+
+    performanceInfo = PerformanceInfo();
+    origImg = im;
+    img = ConvertRGBToLab(im);
+
+    PixelData pd;
+
+    for (Superpixel* sp : superpixels) {
+        sp->ClearColorSums();
+    }
+    for (Pixel& p : pixelsImg) {
+        p.CalcRGBSum(img, pd.sumR, pd.sumR2, pd.sumG, pd.sumG2, pd.sumB, pd.sumB2);
+        p.superPixel->AddColorSums(pd);
+    }
+    for (Superpixel* sp : superpixels) {
+        sp->RecalculateEnergies();
+    }
+
+    t0.Stop();
+    performanceInfo.init = t0.GetTimeInSec();
+    t0.Resume();
+
+    Timer t1;
+
+    performanceInfo.levelMaxPixelSize.push_back(finestMaxPixelSize);
+    performanceInfo.levelIterations.push_back(0);
+    performanceInfo.levelMoves.push_back(0);
+    for (int iteration = 0; iteration < params.iterations; iteration++) {
+        int iters = IterateMoves(finestLevel, performanceInfo.levelMoves.back());
+        if (iters > performanceInfo.levelIterations.back())
+            performanceInfo.levelIterations.back() = iters;
+    }
+
+    t0.Stop();
+    t1.Stop();
+    performanceInfo.levelTimes.push_back(t1.GetTimeInSec());
+    performanceInfo.levelIterateTimes.push_back(t1.GetTimeInSec());
+    performanceInfo.levelSplitTimes.push_back(0);
+    performanceInfo.total = t0.GetTimeInSec();
+    performanceInfo.imgproc = t1.GetTimeInSec();
+}
+
 void SPSegmentationEngine::ProcessImageStereo()
 {
     Timer t0;
@@ -555,17 +622,31 @@ void SPSegmentationEngine::ProcessImageStereo()
 
         performanceInfo.levelMaxPixelSize.push_back(maxPixelSize);
         performanceInfo.levelIterations.push_back(0);
+        performanceInfo.levelMoves.push_back(0);
+        performanceInfo.levelIterateTimes.push_back(0);
         for (int iteration = 0; iteration < params.iterations; iteration++) {
-            int iters = IterateMoves(level);
+            Timer t3;
+
+            int iters = IterateMoves(level, performanceInfo.levelMoves.back());
             if (iters > performanceInfo.levelIterations.back())
                 performanceInfo.levelIterations.back() = iters;
+
+            t3.Stop();
+            performanceInfo.levelIterateTimes.back() += t3.GetTimeInSec();
+
             ReEstimatePlaneParameters();
         }
+
+        Timer t4;
+
         if (maxPixelSize <= params.minPixelSize) splitted = false;
         else splitted = SplitPixels(maxPixelSize);
 
         level--;
 
+        t4.Stop();
+        performanceInfo.levelSplitTimes.push_back(t4.GetTimeInSec());
+
         t2.Stop();
         performanceInfo.levelTimes.push_back(t2.GetTimeInSec());
     } while (splitted);
@@ -578,6 +659,8 @@ void SPSegmentationEngine::ProcessImageStereo()
 
 void SPSegmentationEngine::ReEstimatePlaneParameters()
 {
+    Timer t;
+
     UpdateBoundaryData2();
     UpdateInlierSums();
     for (int s = 0; s < params.reSteps; s++) {
@@ -585,6 +668,9 @@ void SPSegmentationEngine::ReEstimatePlaneParameters()
         UpdateBoundaryData2();
     }
     UpdateDispSums();
+
+    t.Stop();
+    performanceInfo.reestimation += t.GetTimeInSec();
 }
 
 void SPSegmentationEngine::UpdatePlaneParameters()
@@ -722,6 +808,7 @@ void SPSegmentationEngine::UpdateDispSums()
 // Called in initialization and in re-estimation between layers.
 void SPSegmentationEngine::UpdateBoundaryData()
 {
+    Timer t;
     const int directions[2][3] = { { 0, 1, BLeftFlag }, { 1, 0, BTopFlag } };
 
     // clear neighbors
@@ -759,9 +846,11 @@ void SPSegmentationEngine::UpdateBoundaryData()
         }
     }
 
-    //#pragma omp parallel
-    for (Superpixel* s : superpixels) {
-        SuperpixelStereo* sp = (SuperpixelStereo*)s;
+    // Each superpixel only writes its own boundary data, the boundary
+    // data maps themselves are not modified in this loop.
+    #pragma omp parallel for
+    for (int i = 0; i < superpixels.size(); i++) {
+        SuperpixelStereo* sp = (SuperpixelStereo*)superpixels[i];
         
         for (auto& bdIter : sp->boundaryData) {
             BInfo& bInfo = bdIter.second;
@@ -795,12 +884,15 @@ void SPSegmentationEngine::UpdateBoundaryData()
         }
     }
 
+    t.Stop();
+    performanceInfo.boundary += t.GetTimeInSec();
 }
 
 // Called in initialization and in re-estimation between layers.
 // Version which *does not* check for inliers.
 void SPSegmentationEngine::UpdateBoundaryData2()
 {
+    Timer t;
     const int directions[2][3] = { { 0, 1, BLeftFlag }, { 1, 0, BTopFlag } };
 
     // clear neighbors
@@ -838,9 +930,11 @@ void SPSegmentationEngine::UpdateBoundaryData2()
         }
     }
 
-    //#pragma omp parallel
-    for (Superpixel* s : superpixels) {
-        SuperpixelStereo* sp = (SuperpixelStereo*)s;
+    // Each superpixel only writes its own boundary data, the boundary
+    // data maps themselves are not modified in this loop.
+    #pragma omp parallel for
+    for (int i = 0; i < superpixels.size(); i++) {
+        SuperpixelStereo* sp = (SuperpixelStereo*)superpixels[i];
 
         for (auto& bdIter : sp->boundaryData) {
             BInfo& bInfo = bdIter.second;
@@ -874,6 +968,8 @@ void SPSegmentationEngine::UpdateBoundaryData2()
         }
     }
 
+    t.Stop();
+    performanceInfo.boundary += t.GetTimeInSec();
 }
 
 // Called in re-estimation between updates "Stereo Sums"
@@ -953,6 +1049,21 @@ void SPSegmentationEngine::UpdateHingeStereoSums()
 
 }
 
+// Re-accumulates the sums of all superpixels from the (double) block sums,
+// bounds the drift of float statistics after many moves
+void SPSegmentationEngine::RefreshSuperpixelSums()
+{
+    PixelData pd;
+
+    for (Superpixel* sp : superpixels) {
+        sp->ClearSums();
+    }
+    for (Pixel& p : pixelsImg) {
+        p.CalcPixelData(img, pd);
+        p.superPixel->AddSums(pd);
+    }
+}
+
 // Return true if pixels were actually split.
 bool SPSegmentationEngine::SplitPixels(int& newMaxPixelSize)
 {
@@ -1022,6 +1133,9 @@ bool SPSegmentationEngine::SplitPixels(int& newMaxPixelSize)
     }
     pixelsImg = newPixelsImg;
 
+#ifdef ETPS_FLOAT_STATISTICS
+    RefreshSuperpixelSums();
+#endif
     for (Superpixel* sp : superpixels) {
         sp->RecalculateEnergies();
     }
@@ -1036,13 +1150,18 @@ bool SPSegmentationEngine::SplitPixels(int& newMaxPixelSize)
 }
 
 // Lock function for non-stereo iterations
-// These are neighbors of p
+// These are the superpixels of the 3x3 patch around p: TryMovePixel reads the
+// whole patch (connectivity check) and MovePixel changes the border flags of 
+// the 4-neighbors. As long as these superpixels are locked, no other thread can
+// move a pixel of the patch or move a pixel into one of these superpixels.
 void LockNonStereo(Pixel*& p, unordered_set<Superpixel*>& toLock, const Matrix<Pixel>& pixelsImg)
 {
-    for (int m = 0; m < 5; m++) {
-        const Pixel* q = PixelAt(pixelsImg, p->row + nDeltas0[m][0], p->col + nDeltas0[m][1]);
-        if (q != nullptr) 
-            toLock.insert(q->superPixel);
+    for (int dr = -1; dr <= 1; dr++) {
+        for (int dc = -1; dc <= 1; dc++) {
+            const Pixel* q = PixelAt(pixelsImg, p->row + dr, p->col + dc);
+            if (q != nullptr) 
+                toLock.insert(q->superPixel);
+        }
     }
 }
 
@@ -1062,11 +1181,50 @@ void LockStereo(Pixel*& p, unordered_set<Superpixel*>& toLock, const Matrix<Pixe
 
 static int dbgImageNum = 0;
 
-int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList)
+// Evaluates moving p to each of the neighboring superpixels, returns the best 
+// allowed move (pointer into tryMoveData) or nullptr
+PixelMoveData* SPSegmentationEngine::FindBestMove(Pixel* p, PixelMoveData tryMoveData[4])
 {
-    PixelMoveData tryMoveData[4];
     Superpixel* nbsp[5];
     int nbspSize;
+    PixelData pd;
+    bool pdValid = false;
+
+    nbsp[0] = p->superPixel;
+    nbspSize = 1;
+    for (int m = 0; m < 4; m++) {
+        Pixel* q = PixelAt(pixelsImg, p->row + nDeltas[m][0], p->col + nDeltas[m][1]);
+
+        if (q == nullptr) tryMoveData[m].allowed = false;
+        else {
+            bool newNeighbor = true;
+
+            for (int i = 0; i < nbspSize; i++) {
+                if (q->superPixel == nbsp[i]) {
+                    newNeighbor = false;
+                    break;
+                }
+            }
+            if (!newNeighbor) tryMoveData[m].allowed = false;
+            else {
+                // Sums over p do not depend on q, compute them once for all candidates
+                if (!pdValid) {
+                    p->CalcPixelData(img, pd);
+                    pdValid = true;
+                }
+                if (params.stereo) TryMovePixelStereo(p, q, pd, tryMoveData[m]);
+                else TryMovePixel(p, q, pd, tryMoveData[m]);
+                nbsp[nbspSize++] = q->superPixel;
+            }
+        }
+    }
+
+    return FindBestMoveData(params, tryMoveData);
+}
+
+int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList, int& moves)
+{
+    PixelMoveData tryMoveData[4];
     int popCount = 0;
 
     while (!list.Empty() && popCount < params.maxUpdates) {
@@ -1078,31 +1236,8 @@ int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList)
             continue;
         
         inList(p->row, p->col) = false;
-        nbsp[0] = p->superPixel;
-        nbspSize = 1;
-        for (int m = 0; m < 4; m++) {
-            Pixel* q = PixelAt(pixelsImg, p->row + nDeltas[m][0], p->col + nDeltas[m][1]);
-
-            if (q == nullptr) tryMoveData[m].allowed = false;
-            else {
-                bool newNeighbor = true;
 
-                for (int i = 0; i < nbspSize; i++) {
-                    if (q->superPixel == nbsp[i]) {
-                        newNeighbor = false;
-                        break;
-                    }
-                }
-                if (!newNeighbor) tryMoveData[m].allowed = false;
-                else {
-                    if (params.stereo) TryMovePixelStereo(p, q, tryMoveData[m]);
-                    else TryMovePixel(p, q, tryMoveData[m]);
-                    nbsp[nbspSize++] = q->superPixel;
-                }
-            }
-        }
-
-        PixelMoveData* bestMoveData = FindBestMoveData(params, tryMoveData);
+        PixelMoveData* bestMoveData = FindBestMove(p, tryMoveData);
 
         if (bestMoveData != nullptr) {
             if (params.stereo) {
@@ -1138,6 +1273,7 @@ int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList)
             } else {
                 MovePixel(pixelsImg, *bestMoveData);
             }
+            moves++;
 
             list.PushBack(p);
             for (int m = 0; m < 4; m++) {
@@ -1152,6 +1288,58 @@ int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList)
     return popCount;
 }
 
+// Parallel version of Iterate (non-stereo only), params.threads workers pop 
+// boundary pixels from the deque; a pixel is only popped if none of the 
+// superpixels of its 3x3 patch (see LockNonStereo) is locked by another 
+// worker, so concurrent moves never touch the same superpixels or pixels.
+// inList(r, c) is only written by the worker holding the lock on the 
+// superpixel of (r, c). The order of moves, and hence the result, depends 
+// on scheduling.
+int SPSegmentationEngine::IterateParallel(ParallelDeque<Pixel*, Superpixel*>& list, Matrix<bool>& inList, int& moves)
+{
+    std::atomic<int> popCount(0);
+    std::atomic<int> moveCount(0);
+
+    #pragma omp parallel num_threads(params.threads)
+    {
+        PixelMoveData tryMoveData[4];
+
+        while (popCount < params.maxUpdates) {
+            Pixel* p = list.PopAndLock();
+
+            if (p == nullptr) {
+                // Either done or all remaining pixels are locked by other workers
+                if (list.Idle()) break;
+                std::this_thread::yield();
+                continue;
+            }
+
+            popCount++;
+            inList(p->row, p->col) = false;
+
+            PixelMoveData* bestMoveData = FindBestMove(p, tryMoveData);
+
+            if (bestMoveData != nullptr) {
+                MovePixel(pixelsImg, *bestMoveData);
+                moveCount++;
+
+                list.PushBack(p);
+                for (int m = 0; m < 4; m++) {
+                    Pixel* qq = PixelAt(pixelsImg, p->row + nDeltas[m][0], p->col + nDeltas[m][1]);
+                    if (qq != nullptr && p->superPixel != qq->superPixel && !inList(qq->row, qq->col)) {
+                        list.PushBack(qq);
+                        inList(qq->row, qq->col) = true;
+                    }
+                }
+            }
+
+            list.Release(p);
+        }
+    }
+    moves += moveCount;
+    return popCount;
+}
+
 // Returns number of iterations
 //int SPSegmentationEngine::IterateMoves(int level)
 //{
@@ -1255,15 +1443,9 @@ int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList)
 //    return count;
 //}
 
-int SPSegmentationEngine::IterateMoves(int level)
+// Initialize pixel (block) border list 
+template <typename L> static void InitializeBorderList(Matrix<Pixel>& pixelsImg, L& list, Matrix<bool>& inList)
 {
-    params.SetLevelParams(level);
-
-    Deque<Pixel*> list(pixelsImg.rows * pixelsImg.cols);
-    Matrix<bool> inList(pixelsImg.rows, pixelsImg.cols);
-
-    // Initialize pixel (block) border list 
-    fill(inList.begin(), inList.end(), false);
     for (Pixel& p : pixelsImg) {
         Pixel* q;
 
@@ -1276,8 +1458,32 @@ int SPSegmentationEngine::IterateMoves(int level)
             }
         }
     }
+}
+
+// Returns number of pixels popped from the list, moves is increased by the 
+// number of pixels actually moved
+int SPSegmentationEngine::IterateMoves(int level, int& moves)
+{
+    params.SetLevelParams(level);
+
+    Matrix<bool> inList(pixelsImg.rows, pixelsImg.cols);
+
+    fill(inList.begin(), inList.end(), false);
+    if (params.threads > 1 && !params.stereo) {
+        ParallelDeque<Pixel*, Superpixel*> list(pixelsImg.rows * pixelsImg.cols);
+
+        list.SetEmptyVal(nullptr);
+        list.SetLockFunction([&](Pixel*& p, unordered_set<Superpixel*>& toLock) { LockNonStereo(p, toLock, pixelsImg); });
+
+        InitializeBorderList(pixelsImg, list, inList);
+        return IterateParallel(list, inList, moves);
+    }
 
-    int nIterations = Iterate(list, inList);
+    Deque<Pixel*> list(pixelsImg.rows * pixelsImg.cols);
+
+    InitializeBorderList(pixelsImg, list, inList);
+
+    int nIterations = Iterate(list, inList, moves);
 
     return nIterations;
 }
@@ -1521,6 +1727,8 @@ void SPSegmentationEngine::PrintPerformanceInfo()
         cout << "No. of superpixels: " << GetNoOfSuperpixels() << endl;
         cout << "Initialization time: " << performanceInfo.init << " sec." << endl;
         cout << "Ransac time: " << performanceInfo.ransac << " sec." << endl;
+        cout << "Boundary update time: " << performanceInfo.boundary << " sec." << endl;
+        cout << "Re-estimation time: " << performanceInfo.reestimation << " sec." << endl;
         cout << "Time of image processing: " << performanceInfo.imgproc << " sec." << endl;
         cout << "Total time: " << performanceInfo.total << " sec." << endl;
         cout << "Times for each level (in sec.): ";
@@ -1531,6 +1739,10 @@ void SPSegmentationEngine::PrintPerformanceInfo()
         for (double& t : performanceInfo.levelMaxEDelta)
             cout << t << ' ';
         cout << endl;
+        cout << "Moves for each level: ";
+        for (int& c : performanceInfo.levelMoves)
+            cout << c << ' ';
+        cout << endl;
         cout << "Iterations for each level: ";
         for (int& c : performanceInfo.levelIterations)
             cout << c << ' ';
@@ -1557,6 +1769,32 @@ void SPSegmentationEngine::PrintPerformanceInfo()
     }
 }
 
+// Performance info as JSON object (times in sec.), one entry per level
+string SPSegmentationEngine::GetPerformanceInfoJSON() const
+{
+    stringstream ss;
+
+    ss << "{\"superpixels\": " << GetNoOfSuperpixels()
+        << ", \"init\": " << performanceInfo.init
+        << ", \"ransac\": " << performanceInfo.ransac
+        << ", \"boundary\": " << performanceInfo.boundary
+        << ", \"reestimation\": " << performanceInfo.reestimation
+        << ", \"imgproc\": " << performanceInfo.imgproc
+        << ", \"total\": " << performanceInfo.total
+        << ", \"levels\": [";
+    for (int l = 0; l < performanceInfo.levelTimes.size(); l++) {
+        if (l > 0) ss << ", ";
+        ss << "{\"max_pixel_size\": " << performanceInfo.levelMaxPixelSize[l]
+            << ", \"time\": " << performanceInfo.levelTimes[l]
+            << ", \"iterate\": " << performanceInfo.levelIterateTimes[l]
+            << ", \"split\": " << performanceInfo.levelSplitTimes[l]
+            << ", \"iterations\": " << performanceInfo.levelIterations[l]
+            << ", \"moves\": " << performanceInfo.levelMoves[l] << "}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
 void SPSegmentationEngine::UpdateInlierSums()
 {
     for (Superpixel* sp : superpixels) {
@@ -1593,9 +1831,10 @@ void SPSegmentationEngine::UpdateInlierSums()
 
 // Try to move Pixel p to Superpixel containing Pixel q with coordinates (qRow, qCol)
 // Note: pixel q is must be neighbor of p and p->superPixel != q->superPixel
+// pd must hold the pixel data of p (see Pixel::CalcPixelData)
 // Fills psd, returns psd.allowed
 // Note: energy deltas in psd are "energy_before - energy_after"
-bool SPSegmentationEngine::TryMovePixel(Pixel* p, Pixel* q, PixelMoveData& psd)
+bool SPSegmentationEngine::TryMovePixel(Pixel* p, Pixel* q, const PixelData& pd, PixelMoveData& psd)
 {
     Superpixel* sp = p->superPixel;
     Superpixel* sq = q->superPixel;
@@ -1611,10 +1850,8 @@ bool SPSegmentationEngine::TryMovePixel(Pixel* p, Pixel* q, PixelMoveData& psd)
 
     PixelChangeData pcd;
     PixelChangeData qcd;
-    PixelData pd;
     int spbl, sqbl, sobl;
 
-    p->CalcPixelData(img, pd);
     sp->GetRemovePixelData(pd, pcd);
     sq->GetAddPixelData(pd, qcd);
     CalcSuperpixelBoundaryLength(pixelsImg, p, sp, sq, spbl, sqbl, sobl);
@@ -1631,7 +1868,7 @@ bool SPSegmentationEngine::TryMovePixel(Pixel* p, Pixel* q, PixelMoveData& psd)
     return true;
 }
 
-bool SPSegmentationEngine::TryMovePixelStereo(Pixel* p, Pixel* q, PixelMoveData& psd)
+bool SPSegmentationEngine::TryMovePixelStereo(Pixel* p, Pixel* q, const PixelData& pdp, PixelMoveData& psd)
 {
     SuperpixelStereo* sp = (SuperpixelStereo*)p->superPixel;
     SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel;
@@ -1651,10 +1888,12 @@ bool SPSegmentationEngine::TryMovePixelStereo(Pixel* p, Pixel* q, PixelMoveData&
 
     PixelChangeDataStereo pcd;
     PixelChangeDataStereo qcd;
-    PixelData pd;
+    PixelData pd = pdp;
     int spbl, sqbl, sobl;
 
-    p->CalcPixelDataStereo(img, depthImg, sp->plane, sq->plane, params.inlierThreshold, params.noDisp, pd);
+    // Only the disparity sums depend on the planes of sp and sq
+    pd.sumDispP = p->CalcDispSum(depthImg, sp->plane, params.inlierThreshold, params.noDisp);
+    pd.sumDispQ = p->CalcDispSum(depthImg, sq->plane, params.inlierThreshold, params.noDisp);
     sp->GetRemovePixelDataStereo(pd, pcd);
     sq->GetAddPixelDataStereo(pd, qcd);
     if (params.instantBoundary) CalcBorderChangeDataStereo(pixelsImg, depthImg, params, p, q, psd.bDataP, psd.bDataQ, psd.prem);
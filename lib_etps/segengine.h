@@ -74,7 +74,8 @@ struct SPSegmentationParameters {
         inpaint(false),           // use opencv's inpaint method to fill gaps in
         debugOutput(false),
         timingOutput(true),
-        randomSeed(0) {};
+        randomSeed(0),
+        threads(1) {};
     
     int superpixelNum;        // Number of superpixels (the actual number can be different)
     int gridSize;
@@ -110,6 +111,7 @@ struct SPSegmentationParameters {
     bool debugOutput;
     bool timingOutput;
     int randomSeed;
+    int threads;            // Threads for pixel moves (non-stereo only)
 
     vector<pair<string, vector<double>>> levelParamsDouble;
     vector<pair<string, vector<int>>> levelParamsInt;
@@ -149,6 +151,7 @@ struct SPSegmentationParameters {
         UpdateFromNode(debugOutput, node["debugOutput"]);
         UpdateFromNode(timingOutput, node["timingOutput"]);
         UpdateFromNode(randomSeed, node["randomSeed"]);
+        UpdateFromNode(threads, node["threads"]);
         SetLevelParams(0);
     }
 
@@ -204,12 +207,18 @@ private:
 class SPSegmentationEngine {
 private:
     struct PerformanceInfo {
-        PerformanceInfo() : init(0.0), imgproc(0.0), ransac(0.0), total(0.0) {}
+        PerformanceInfo() : init(0.0), imgproc(0.0), ransac(0.0), boundary(0.0), 
+            reestimation(0.0), total(0.0) {}
         double init;
         double imgproc;
         double ransac;
+        double boundary;        // UpdateBoundaryData(2), also part of reestimation
+        double reestimation;    // ReEstimatePlaneParameters (stereo)
         vector<double> levelTimes;
+        vector<double> levelIterateTimes;
+        vector<double> levelSplitTimes;
         vector<int> levelIterations;
+        vector<int> levelMoves;
         double total;
         vector<double> levelMaxEDelta;
         vector<int> levelMaxPixelSize;
@@ -223,6 +232,8 @@ private:
     double planeSmoothWeightCo;
     double planeSmoothWeightHi;
     int initialMaxPixelSize;        // Calculated in initialization
+    int finestLevel;                // Last level and pixel size of ProcessImage,
+    int finestMaxPixelSize;         // used by ProcessNextImage
 
     // Original image to process
     Mat origImg;
@@ -243,6 +254,7 @@ public:
     virtual ~SPSegmentationEngine();
 
     void ProcessImage();
+    void ProcessNextImage(Mat im);
     void ProcessImageStereo();
     Mat GetSegmentedImage();
     Mat GetSegmentedImagePlain();
@@ -254,6 +266,7 @@ public:
     void PrintDebugInfo2();
     void PrintDebugInfoStereo();
     void PrintPerformanceInfo();
+    string GetPerformanceInfoJSON() const;
     int GetNoOfSuperpixels() const;
     double ProcessingTime() { return performanceInfo.total; }
 private:
@@ -262,10 +275,11 @@ private:
     void InitializeStereoEnergies();
     void InitializePPImage();
     void UpdatePPImage();
-    int IterateMoves(int level);
+    int IterateMoves(int level, int& moves);
     void ReEstimatePlaneParameters();
     void EstimatePlaneParameters();
     bool SplitPixels(int& newMaxPixelSize);
+    void RefreshSuperpixelSums();
     void Reset();
     void UpdateBoundaryData();
     void UpdateBoundaryData2();
@@ -279,10 +293,12 @@ private:
     void DebugBoundary();
     void DebugDispSums();
 
-    bool TryMovePixel(Pixel* p, Pixel* q, PixelMoveData& psd);
-    bool TryMovePixelStereo(Pixel* p, Pixel* q, PixelMoveData& psd);
+    bool TryMovePixel(Pixel* p, Pixel* q, const PixelData& pd, PixelMoveData& psd);
+    bool TryMovePixelStereo(Pixel* p, Pixel* q, const PixelData& pd, PixelMoveData& psd);
 
-    int Iterate(Deque<Pixel*>& list, Matrix<bool>& inList);
+    PixelMoveData* FindBestMove(Pixel* p, PixelMoveData tryMoveData[4]);
+    int Iterate(Deque<Pixel*>& list, Matrix<bool>& inList, int& moves);
+    int IterateParallel(ParallelDeque<Pixel*, Superpixel*>& list, Matrix<bool>& inList, int& moves);
 };
 
 
@@ -16,6 +16,14 @@ typedef std::int16_t sint;
 typedef std::uint8_t byte;
 typedef cv::Point3d Plane_d;
 
+// Precision of the running sums of a superpixel; per-block sums (PixelData)
+// and energies are always computed in double (see ETPS_FLOAT_STATISTICS)
+#ifdef ETPS_FLOAT_STATISTICS
+typedef float stat_t;
+#else
+typedef double stat_t;
+#endif
+
 // Constants
 //////////////
 
@@ -161,6 +169,43 @@ template <typename T> struct Matrix {
 };
 
 
+// SmallSet -- set with fixed inline capacity, no heap allocation
+///////////////////////////////////////////////////////////////////
+
+template <typename T, int N> struct SmallSet {
+    T items[N];
+    int size;
+
+    SmallSet() : size(0) { }
+
+    void clear() { size = 0; }
+
+    // Returns false if item is already in the set; capacity must not be exceeded
+    bool insert(const T& item)
+    {
+        for (int i = 0; i < size; i++) {
+            if (items[i] == item) return false;
+        }
+        CV_DbgAssert(size < N);
+        items[size++] = item;
+        return true;
+    }
+
+    void erase(const T& item)
+    {
+        for (int i = 0; i < size; i++) {
+            if (items[i] == item) {
+                items[i] = items[--size];
+                return;
+            }
+        }
+    }
+
+    const T* begin() const { return items; }
+    const T* end() const { return items + size; }
+};
+
+
 // Pixel/Superpixel
 /////////////////////
 
@@ -199,8 +244,8 @@ struct PixelMoveData {
     int pSize;          // superpixel of p size
     int qSize;          // superpixel of q size
     PixelData pixelData;
-    BorderDataMap bDataP, bDataQ;
-    unordered_set<SuperpixelStereo*> prem;  // neighbors of superpixel sp which need to be removed
+    BorderDataMap bDataP, bDataQ;           // re-used between candidate moves, assignment keeps the buckets
+    vector<SuperpixelStereo*> prem;         // neighbors of superpixel sp which need to be removed (distinct)
 };
 
 struct PixelChangeData {
@@ -237,21 +282,21 @@ struct Pixel { // : public custom_alloc {
         superPixel = nullptr;
     }
 
+    // Closed form of the sums over the block, i.e. sum_i sum_j i, i*i, j, j*j and i*j
     void CalcRowColSum(double& sumRow, double& sumRow2, double& sumCol, double& sumCol2, double& sumRowCol) const
     {
-        sumRow = 0.0; sumRow2 = 0.0;
-        sumCol = 0.0; sumCol2 = 0.0;
-        sumRowCol = 0.0;
+        double rows = lrr - ulr, cols = lrc - ulc;
+        double sumI = 0.0, sumI2 = 0.0, sumJ = 0.0, sumJ2 = 0.0;
+
         for (int i = ulr; i < (int)lrr; i++) {
-            for (int j = ulc; j < (int)lrc; j++) {
-                sumRow += i; sumCol += j;
-                sumRowCol += i*j;
-                sumRow2 += i*i; sumCol2 += j*j;
-                if (sumCol2 < 0) {
-                    exit(0);
-                }
-            }
+            sumI += i; sumI2 += (double)i*i;
+        }
+        for (int j = ulc; j < (int)lrc; j++) {
+            sumJ += j; sumJ2 += (double)j*j;
         }
+        sumRow = cols*sumI; sumRow2 = cols*sumI2;
+        sumCol = rows*sumJ; sumCol2 = rows*sumJ2;
+        sumRowCol = sumI*sumJ;
     }
 
     void CalcRGBSum(const cv::Mat& img, double& sumR, double& sumR2, double& sumG, double& sumG2,
@@ -260,10 +305,12 @@ struct Pixel { // : public custom_alloc {
         sumR = 0; sumR2 = 0;
         sumG = 0; sumG2 = 0;
         sumB = 0; sumB2 = 0;
+        // Row pointers and plain accumulators so that the inner loop can be vectorized
         for (int i = ulr; i < (int)lrr; i++) {
-            for (int j = ulc; j < (int)lrc; j++) {
-                const cv::Vec3d val = img.at<cv::Vec3d>(i, j);
-                double b = val[0], g = val[1], r = val[2];
+            const double* row = img.ptr<double>(i) + 3*ulc;
+            const int n = 3*(lrc - ulc);
+            for (int k = 0; k < n; k += 3) {
+                double b = row[k], g = row[k + 1], r = row[k + 2];
                 sumR += r; sumR2 += r*r;
                 sumG += g; sumG2 += g*g;
                 sumB += b; sumB2 += b*b;
@@ -613,11 +660,11 @@ class Superpixel {
 public:
     int id;                                 // id (index) of superpixel
     int borderLength;                   // length of border (in img pixels)
-    double sumRow, sumCol;          // sum of row, column indices
-    double sumRowCol;                   // sum of row * column indices
-    double sumRow2, sumCol2;        // sum or row, column squares of indices
-    double sumR, sumG, sumB;    // sum of colors
-    double sumR2, sumG2, sumB2; // sum of squares of colors
+    stat_t sumRow, sumCol;          // sum of row, column indices
+    stat_t sumRowCol;                   // sum of row * column indices
+    stat_t sumRow2, sumCol2;        // sum or row, column squares of indices
+    stat_t sumR, sumG, sumB;    // sum of colors
+    stat_t sumR2, sumG2, sumB2; // sum of squares of colors
     double eApp;
     double eReg;
     int size;                           // number of (image) pixels
@@ -728,6 +775,43 @@ public:
         eReg = CalcRegEnergy(sumRow, sumCol, sumRow2, sumCol2, size, numP);
     }
 
+    // Used to re-use the superpixel on the next image (warm start): only the
+    // sums of colors change, energies must be recalculated afterwards.
+    void ClearColorSums()
+    {
+        sumR = 0; sumG = 0; sumB = 0;
+        sumR2 = 0; sumG2 = 0; sumB2 = 0;
+    }
+
+    void AddColorSums(const PixelData& pd)
+    {
+        sumR += pd.sumR;
+        sumG += pd.sumG;
+        sumB += pd.sumB;
+        sumR2 += pd.sumR2;
+        sumG2 += pd.sumG2;
+        sumB2 += pd.sumB2;
+    }
+
+    // Used to re-accumulate all sums from the blocks (e.g. to remove the drift
+    // of float sums), size and numP are left unchanged.
+    void ClearSums()
+    {
+        sumRow = 0; sumCol = 0; sumRowCol = 0;
+        sumRow2 = 0; sumCol2 = 0;
+        ClearColorSums();
+    }
+
+    void AddSums(const PixelData& pd)
+    {
+        sumRow += pd.sumRow;
+        sumCol += pd.sumCol;
+        sumRowCol += pd.sumRowCol;
+        sumRow2 += pd.sumRow2;
+        sumCol2 += pd.sumCol2;
+        AddColorSums(pd);
+    }
+
     void SetBorderLength(int bl) { borderLength = bl; }
 
     void AddToBorderLength(int bld) { borderLength += bld; }
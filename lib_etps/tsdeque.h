@@ -2,6 +2,9 @@
 
 #include <vector>
 #include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+#include <cassert>
 #include <mutex>
 #include <functional>
 
@@ -16,6 +19,8 @@
 //      and locks it
 //    * Release releases element (removes it from forbidden list)
 //    * PushBack adds an element to the end of the deque.
+//    * Idle is true if the deque is empty and no element is locked, i.e.
+//      no further elements can be pushed by the workers
 
 
 template <typename T, typename S> class ParallelDeque {
@@ -58,6 +63,13 @@ public:
 
     void Clear() { start = end = listSize = 0; }
 
+    bool Idle()
+    {
+        std::unique_lock<std::mutex> lck(m);
+
+        return listSize == 0 && lockMap.empty();
+    }
+
     void PushBack(const T& value)
     {
         std::unique_lock<std::mutex> lck(m);
@@ -79,7 +91,7 @@ public:
             if (result != emptyVal) {
                 lockSet.clear();
                 lockFun(result, lockSet);
-                if (find_if(lockSet.begin(), lockSet.end(), [&](const S& s) { return locked.find(s) != locked.end(); }) == lockSet.end()) {
+                if (std::find_if(lockSet.begin(), lockSet.end(), [&](const S& s) { return locked.find(s) != locked.end(); }) == lockSet.end()) {
                     vector[i] = emptyVal;
                     if (i == start) {
                         do {
@@ -120,9 +132,10 @@ private:
             std::copy(vector.begin() + start, vector.end(), newVector.begin());
             std::copy(vector.begin(), vector.begin() + end, newVector.begin() + vector.size() - start);
         }
+        // Popped elements may leave holes, so end is not necessarily listSize
+        end = (end + vector.size() - start) % vector.size();
         std::swap(vector, newVector);
         start = 0;
-        end = listSize;
     }
 };
 
@@ -0,0 +1,206 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COLOR_CONVERSION_H
+#define	COLOR_CONVERSION_H
+
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+/** \brief RGB to CIELAB conversion shared by the algorithms converting colors
+ * themselves (SLIC, SEEDS and LSC).
+ * 
+ * The sRGB gamma is looked up in a table of all 256 intensities and cube roots
+ * are computed using cubeRoot instead of pow. Table and transfer function are
+ * templated on the floating point type such that float and double
+ * implementations are reproduced. The class is header-only such that the
+ * algorithm libraries can use it without linking against lib_eval.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   const float* linear = ColorConversion::getLinearRGBTable<float>();
+ *   float fx = ColorConversion::labTransfer<float>(x);
+ * \endcode
+ * \author David Stutz
+ */
+class ColorConversion {
+public:
+    /** \brief Get the linearized (inverse sRGB gamma) values of all 8-bit
+     * intensities; the table is computed once.
+     * \return table of 256 values in [0,1]
+     */
+    template<typename T>
+    static const T* getLinearRGBTable() {
+        static const std::vector<T> table = computeLinearRGBTable<T>();
+        return table.data();
+    }
+    
+    /** \brief Cube root of a non-negative value.
+     * 
+     * The exponent is divided by three on the bit representation, followed by
+     * Halley iterations; the result agrees with pow(x, 1.0/3.0) up to the last
+     * bits of a double.
+     * 
+     * \param[in] x value
+     * \return cube root of x
+     */
+    static double cubeRoot(double x) {
+        if (x <= 0) {
+            return (x == 0 ? 0 : -cubeRoot(-x));
+        }
+        
+        uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(double));
+        bits = bits/3 + 0x2A9F7893782DA1CEULL;
+        
+        double y;
+        std::memcpy(&y, &bits, sizeof(double));
+        
+        for (int i = 0; i < 3; ++i) {
+            double y3 = y*y*y;
+            y = y*(y3 + 2*x)/(2*y3 + x);
+        }
+        
+        return y;
+    }
+    
+    /** \brief CIELAB transfer function f(t) applied to normalized X, Y and Z.
+     * \param[in] t normalized coordinate, e.g. X/Xr
+     * \return cube root of t above the CIE threshold, linear approximation below
+     */
+    template<typename T>
+    static T labTransfer(T t) {
+        T epsilon = 0.008856;
+        T kappa = 903.3;
+        
+        if (t > epsilon) {
+            return cubeRoot(t);
+        }
+        
+        return (kappa*t + 16.0)/116.0;
+    }
+    
+    /** \brief Convert packed 0x00RRGGBB pixels to CIELAB (D65, sRGB).
+     * 
+     * Same as SLIC::RGB2LAB per pixel.
+     * 
+     * \param[in] rgb packed pixels
+     * \param[in] size number of pixels
+     * \param[out] L lightness per pixel
+     * \param[out] A a channel per pixel
+     * \param[out] B b channel per pixel
+     */
+    static void convertRGBToLAB(const unsigned int* rgb, int size, 
+            float* L, float* A, float* B) {
+        
+        const float* linear = getLinearRGBTable<float>();
+        for (int j = 0; j < size; ++j) {
+            convertPixelToLAB(linear[(rgb[j] >> 16) & 0xFF], linear[(rgb[j] >> 8) & 0xFF], 
+                    linear[rgb[j] & 0xFF], L[j], A[j], B[j]);
+        }
+    }
+    
+    /** \brief Convert interleaved 8-bit BGR pixels, e.g. a row of a CV_8UC3
+     * image, to CIELAB (D65, sRGB).
+     * 
+     * Same as convertRGBToLAB on the packed pixels.
+     * 
+     * \param[in] bgr interleaved pixels, three bytes per pixel
+     * \param[in] size number of pixels
+     * \param[out] L lightness per pixel
+     * \param[out] A a channel per pixel
+     * \param[out] B b channel per pixel
+     */
+    static void convertBGRToLAB(const unsigned char* bgr, int size, 
+            float* L, float* A, float* B) {
+        
+        const float* linear = getLinearRGBTable<float>();
+        for (int j = 0; j < size; ++j) {
+            convertPixelToLAB(linear[bgr[3*j + 2]], linear[bgr[3*j + 1]], 
+                    linear[bgr[3*j]], L[j], A[j], B[j]);
+        }
+    }
+    
+private:
+    
+    /** \brief Convert a linearized RGB pixel to CIELAB.
+     * \param[in] r linearized red
+     * \param[in] g linearized green
+     * \param[in] b linearized blue
+     * \param[out] L lightness
+     * \param[out] A a channel
+     * \param[out] B b channel
+     */
+    static void convertPixelToLAB(float r, float g, float b, 
+            float &L, float &A, float &B) {
+        
+        float Xr = 0.950456;
+        float Yr = 1.0;
+        float Zr = 1.088754;
+        
+        float X = r*0.4124564 + g*0.3575761 + b*0.1804375;
+        float Y = r*0.2126729 + g*0.7151522 + b*0.0721750;
+        float Z = r*0.0193339 + g*0.1191920 + b*0.9503041;
+        
+        float fx = labTransfer<float>(X/Xr);
+        float fy = labTransfer<float>(Y/Yr);
+        float fz = labTransfer<float>(Z/Zr);
+        
+        L = 116.0*fy - 16.0;
+        A = 500.0*(fx - fy);
+        B = 200.0*(fy - fz);
+    }
+    
+    /** \brief Compute the table returned by getLinearRGBTable.
+     * \return table of 256 values
+     */
+    template<typename T>
+    static std::vector<T> computeLinearRGBTable() {
+        std::vector<T> table(256);
+        for (int v = 0; v < 256; ++v) {
+            T c = v/255.0;
+            
+            if (c <= 0.04045) {
+                table[v] = c/12.92;
+            }
+            else {
+                table[v] = std::pow((c + 0.055)/1.055, 2.4);
+            }
+        }
+        
+        return table;
+    }
+    
+};
+
+#endif	/* COLOR_CONVERSION_H */
@@ -60,8 +60,10 @@ private:
 	return true;
     }
     int new_label() {
-	if(highest_label+1 > labels.size())
-	    labels.reserve(highest_label*2);
+	// grow geometrically, reserving exactly twice the label count on
+	// every new label would re-allocate for each of them
+	if(highest_label+1 > labels.capacity())
+	    labels.reserve(2*(highest_label+1));
 	labels.resize(highest_label+1);
 	labels[highest_label] = Similarity(highest_label);
 	return highest_label++;
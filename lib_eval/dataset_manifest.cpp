@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <glog/logging.h>
+#include "dataset_manifest.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DatasetManifest
+////////////////////////////////////////////////////////////////////////////////
+
+DatasetManifest::DatasetManifest() : shard(0), shards(1), entry(0), count(0) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// isManifestFile
+////////////////////////////////////////////////////////////////////////////////
+
+bool DatasetManifest::isManifestFile(const boost::filesystem::path &file) {
+    std::string extension = file.extension().string();
+    return extension == ".txt" || extension == ".TXT" 
+            || extension == ".lst" || extension == ".LST";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// open
+////////////////////////////////////////////////////////////////////////////////
+
+bool DatasetManifest::open(const boost::filesystem::path &file, int shard_, int shards_) {
+    LOG_IF(FATAL, shards_ <= 0 || shard_ < 0 || shard_ >= shards_) 
+            << "Invalid shard: " << shard_ << "/" << shards_ << ".";
+    
+    if (stream.is_open()) {
+        stream.close();
+    }
+    
+    stream.clear();
+    stream.open(file.c_str(), std::ifstream::in);
+    
+    directory = file.parent_path();
+    shard = shard_;
+    shards = shards_;
+    entry = 0;
+    count = 0;
+    
+    return stream.is_open();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// next
+////////////////////////////////////////////////////////////////////////////////
+
+bool DatasetManifest::next(boost::filesystem::path &file) {
+    
+    while (stream.is_open() && std::getline(stream, line)) {
+        
+        // Also accept manifests written on Windows.
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+        }
+        
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        
+        int index = entry++;
+        if (index % shards != shard) {
+            continue;
+        }
+        
+        file = boost::filesystem::path(line);
+        if (file.is_relative()) {
+            file = directory / file;
+        }
+        
+        ++count;
+        return true;
+    }
+    
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCount
+////////////////////////////////////////////////////////////////////////////////
+
+int DatasetManifest::getCount() const {
+    return count;
+}
@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DATASET_MANIFEST_H
+#define	DATASET_MANIFEST_H
+
+#include <string>
+#include <fstream>
+#include <boost/filesystem.hpp>
+
+/** \brief A manifest listing the images of a dataset, read one entry at a
+ * time instead of listing a directory.
+ * 
+ * The manifest is a text file with one path per line, relative to the
+ * directory of the manifest (absolute paths are used as given); empty lines 
+ * and lines starting with # are skipped. Entries are read while processing,
+ * such that processing starts immediately and memory does not depend on the
+ * number of images, which especially helps for large datasets on network file
+ * systems. As for IOUtil::selectShard, shard i/N yields every N-th entry 
+ * starting with the i-th.
+ * 
+ * A manifest can be created using, for example:
+ * \code{sh}
+ *   $ cd data/images && find . -name "*.jpg" -printf "%P\n" > manifest.txt
+ * \endcode
+ * 
+ * Usage:
+ * \code{cpp}
+ *   DatasetManifest manifest;
+ *   manifest.open("data/images/manifest.txt");
+ *   
+ *   boost::filesystem::path file;
+ *   while (manifest.next(file)) {
+ *       cv::Mat image = cv::imread(file.string());
+ *   }
+ * \endcode
+ * \author David Stutz
+ */
+class DatasetManifest {
+public:
+    
+    /** \brief Constructor. */
+    DatasetManifest();
+    
+    /** \brief Check whether the file is a manifest based on its extension
+     * (.txt or .lst).
+     * \param[in] file path to file
+     * \return whether the file is a manifest
+     */
+    static bool isManifestFile(const boost::filesystem::path &file);
+    
+    /** \brief Open a manifest, closing a previously opened one.
+     * \param[in] file manifest file
+     * \param[in] shard index of the shard to read
+     * \param[in] shards number of shards
+     * \return whether the manifest could be opened
+     */
+    bool open(const boost::filesystem::path &file, int shard = 0, int shards = 1);
+    
+    /** \brief Read the next entry of the shard.
+     * \param[out] file path of the entry
+     * \return whether an entry was read, false at the end of the manifest
+     */
+    bool next(boost::filesystem::path &file);
+    
+    /** \brief Get the number of entries read so far.
+     * \return number of entries read
+     */
+    int getCount() const;
+    
+private:
+    
+    /** \brief Manifest file stream. */
+    std::ifstream stream;
+    /** \brief Directory relative paths are resolved against. */
+    boost::filesystem::path directory;
+    /** \brief Index of the shard. */
+    int shard;
+    /** \brief Number of shards. */
+    int shards;
+    /** \brief Index of the next entry across all shards. */
+    int entry;
+    /** \brief Number of entries read. */
+    int count;
+    /** \brief Line buffer, reused across entries. */
+    std::string line;
+    
+};
+
+#endif	/* DATASET_MANIFEST_H */
@@ -0,0 +1,383 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <map>
+#include <fstream>
+#include <glog/logging.h>
+#include "io_util.h"
+#include "evaluation_summary.h"
+#include "dataset_pack.h"
+
+/** \brief Header at the start of a pack file. */
+struct DatasetPackHeader {
+    /** \brief Magic, always "SPDS". */
+    char magic[4];
+    /** \brief Version of the format. */
+    uint32_t version;
+    /** \brief Number of samples. */
+    uint32_t samples;
+    /** \brief Number of ground truths of all samples. */
+    uint32_t gts;
+    /** \brief Offset of the sample entries. */
+    uint64_t samples_offset;
+    /** \brief Offset of the ground truth entries. */
+    uint64_t gts_offset;
+    /** \brief Offset of the string table. */
+    uint64_t strings_offset;
+    /** \brief Size of the string table in bytes. */
+    uint64_t strings_size;
+};
+
+/** \brief Index entry of a sample. */
+struct DatasetPackSample {
+    /** \brief Offset of the name in the string table. */
+    uint32_t name_offset;
+    /** \brief Length of the name. */
+    uint32_t name_size;
+    /** \brief Rows of image and ground truths. */
+    int32_t rows;
+    /** \brief Columns of image and ground truths. */
+    int32_t cols;
+    /** \brief Offset of the image. */
+    uint64_t image_offset;
+    /** \brief Whether a single ground truth of the same name was packed. */
+    uint32_t single_gt;
+    /** \brief Number of ground truths. */
+    uint32_t gts;
+    /** \brief Index of the first ground truth entry. */
+    uint32_t gt_first;
+    /** \brief Reserved, always 0. */
+    uint32_t reserved;
+};
+
+/** \brief Index entry of a ground truth. */
+struct DatasetPackGroundTruth {
+    /** \brief Offset of the file name in the string table. */
+    uint32_t name_offset;
+    /** \brief Length of the file name. */
+    uint32_t name_size;
+    /** \brief Index of the ground truth, e.g. 0 to 4 for the BSDS500. */
+    int32_t index;
+    /** \brief Reserved, always 0. */
+    int32_t reserved;
+    /** \brief Offset of the ground truth. */
+    uint64_t offset;
+};
+
+const char DATASET_PACK_MAGIC[4] = {'S', 'P', 'D', 'S'};
+const uint32_t DATASET_PACK_VERSION = 1;
+const uint64_t DATASET_PACK_ALIGNMENT = 64;
+
+/** \brief Pad the stream with zeros to the pack alignment.
+ * \param[in] stream stream to pad
+ * \param[in,out] offset current offset, aligned afterwards
+ */
+static void padDatasetPack(std::ofstream &stream, uint64_t &offset) {
+    static const char zeros[DATASET_PACK_ALIGNMENT] = {0};
+    
+    uint64_t padding = (DATASET_PACK_ALIGNMENT - offset % DATASET_PACK_ALIGNMENT) % DATASET_PACK_ALIGNMENT;
+    stream.write(zeros, padding);
+    offset += padding;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DatasetPack
+////////////////////////////////////////////////////////////////////////////////
+
+DatasetPack::DatasetPack() 
+        : data(NULL), size(0), samples(0) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ~DatasetPack
+////////////////////////////////////////////////////////////////////////////////
+
+DatasetPack::~DatasetPack() {
+    close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// pack
+////////////////////////////////////////////////////////////////////////////////
+
+int DatasetPack::pack(const boost::filesystem::path &img_directory,
+        const boost::filesystem::path &gt_directory,
+        const boost::filesystem::path &file) {
+    
+    std::multimap<std::string, boost::filesystem::path> images;
+    std::vector<std::string> extensions;
+    IOUtil::getImageExtensions(extensions);
+    IOUtil::readDirectory(img_directory, extensions, images);
+    
+    std::ofstream stream(file.c_str(), std::ofstream::out | std::ofstream::binary);
+    if (!stream.is_open()) {
+        return -1;
+    }
+    
+    DatasetPackHeader header;
+    memset(&header, 0, sizeof(header));
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    
+    uint64_t offset = sizeof(header);
+    padDatasetPack(stream, offset);
+    
+    std::vector<DatasetPackSample> sample_entries;
+    std::vector<DatasetPackGroundTruth> gt_entries;
+    std::string strings;
+    
+    // Images and ground truths are written one at a time to bound memory.
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
+            it != images.end(); ++it) {
+        
+        cv::Mat image = cv::imread(it->first, CV_LOAD_IMAGE_COLOR);
+        LOG_IF(FATAL, image.rows <= 0 || image.cols <= 0) 
+                << "Could not read image: " << it->first << ".";
+        
+        DatasetPackSample sample_entry;
+        memset(&sample_entry, 0, sizeof(sample_entry));
+        sample_entry.name_offset = strings.size();
+        sample_entry.name_size = it->second.stem().string().size();
+        sample_entry.rows = image.rows;
+        sample_entry.cols = image.cols;
+        sample_entry.image_offset = offset;
+        sample_entry.gt_first = gt_entries.size();
+        strings += it->second.stem().string();
+        
+        for (int i = 0; i < image.rows; ++i) {
+            stream.write(image.ptr<char>(i), image.cols*3);
+        }
+        
+        offset += (uint64_t) image.rows*image.cols*3;
+        padDatasetPack(stream, offset);
+        
+        if (!gt_directory.empty()) {
+            std::vector<boost::filesystem::path> gt_files;
+            std::vector<int> gt_indices;
+            boost::filesystem::path sp_file(it->second.stem().string() + ".csv");
+            sample_entry.single_gt = EvaluationSummary::findGroundTruths(gt_directory, 
+                    sp_file, gt_files, gt_indices);
+            
+            for (unsigned int k = 0; k < gt_files.size(); ++k) {
+                cv::Mat gt;
+                IOUtil::readMatCSVInt(gt_files[k], image.rows, image.cols, gt);
+                
+                LOG_IF(FATAL, gt.rows != image.rows || gt.cols != image.cols) 
+                        << "Ground truth does not match image size: " << gt_files[k] << ".";
+                
+                DatasetPackGroundTruth gt_entry;
+                gt_entry.name_offset = strings.size();
+                gt_entry.name_size = gt_files[k].filename().string().size();
+                gt_entry.index = gt_indices[k];
+                gt_entry.reserved = 0;
+                gt_entry.offset = offset;
+                strings += gt_files[k].filename().string();
+                
+                for (int i = 0; i < gt.rows; ++i) {
+                    stream.write(gt.ptr<char>(i), gt.cols*sizeof(int32_t));
+                }
+                
+                offset += (uint64_t) gt.rows*gt.cols*sizeof(int32_t);
+                padDatasetPack(stream, offset);
+                gt_entries.push_back(gt_entry);
+            }
+            
+            sample_entry.gts = gt_files.size();
+        }
+        
+        sample_entries.push_back(sample_entry);
+    }
+    
+    memcpy(header.magic, DATASET_PACK_MAGIC, 4);
+    header.version = DATASET_PACK_VERSION;
+    header.samples = sample_entries.size();
+    header.gts = gt_entries.size();
+    
+    header.samples_offset = offset;
+    stream.write(reinterpret_cast<const char*>(sample_entries.data()), 
+            sample_entries.size()*sizeof(DatasetPackSample));
+    offset += sample_entries.size()*sizeof(DatasetPackSample);
+    
+    header.gts_offset = offset;
+    stream.write(reinterpret_cast<const char*>(gt_entries.data()), 
+            gt_entries.size()*sizeof(DatasetPackGroundTruth));
+    offset += gt_entries.size()*sizeof(DatasetPackGroundTruth);
+    
+    header.strings_offset = offset;
+    header.strings_size = strings.size();
+    stream.write(strings.data(), strings.size());
+    
+    stream.seekp(0);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    
+    if (!stream) {
+        return -1;
+    }
+    
+    stream.close();
+    return sample_entries.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// isPackFile
+////////////////////////////////////////////////////////////////////////////////
+
+bool DatasetPack::isPackFile(const boost::filesystem::path &file) {
+    return file.extension().string() == ".spds" || file.extension().string() == ".SPDS";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// open
+////////////////////////////////////////////////////////////////////////////////
+
+bool DatasetPack::open(const boost::filesystem::path &file) {
+    close();
+    
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || (size_t) file_stat.st_size < sizeof(DatasetPackHeader)) {
+        ::close(fd);
+        return false;
+    }
+    
+    // Private mapping: writes to the matrices are copy-on-write.
+    size = file_stat.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    
+    if (mapping == MAP_FAILED) {
+        size = 0;
+        return false;
+    }
+    
+    data = static_cast<char*>(mapping);
+    
+    const DatasetPackHeader* header = reinterpret_cast<const DatasetPackHeader*>(data);
+    bool valid = memcmp(header->magic, DATASET_PACK_MAGIC, 4) == 0
+            && header->version == DATASET_PACK_VERSION
+            && header->samples_offset + header->samples*sizeof(DatasetPackSample) <= header->gts_offset
+            && header->gts_offset + header->gts*sizeof(DatasetPackGroundTruth) <= header->strings_offset
+            && header->strings_offset + header->strings_size <= size;
+    
+    // Validate the index once such that getSample does not need to.
+    for (uint32_t i = 0; valid && i < header->samples; ++i) {
+        const DatasetPackSample* sample = reinterpret_cast<const DatasetPackSample*>(
+                data + header->samples_offset) + i;
+        
+        valid = sample->name_offset + (uint64_t) sample->name_size <= header->strings_size
+                && sample->rows >= 0 && sample->cols >= 0
+                && sample->image_offset + (uint64_t) sample->rows*sample->cols*3 <= header->samples_offset
+                && sample->gt_first + (uint64_t) sample->gts <= header->gts;
+        
+        for (uint32_t k = 0; valid && k < sample->gts; ++k) {
+            const DatasetPackGroundTruth* gt = reinterpret_cast<const DatasetPackGroundTruth*>(
+                    data + header->gts_offset) + sample->gt_first + k;
+            
+            valid = gt->name_offset + (uint64_t) gt->name_size <= header->strings_size
+                    && gt->offset + (uint64_t) sample->rows*sample->cols*sizeof(int32_t) <= header->samples_offset;
+        }
+    }
+    
+    if (!valid) {
+        close();
+        return false;
+    }
+    
+    samples = header->samples;
+    
+    // Samples are usually read in order.
+    madvise(data, size, MADV_SEQUENTIAL);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// close
+////////////////////////////////////////////////////////////////////////////////
+
+void DatasetPack::close() {
+    if (data != NULL) {
+        munmap(data, size);
+    }
+    
+    data = NULL;
+    size = 0;
+    samples = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getSize
+////////////////////////////////////////////////////////////////////////////////
+
+int DatasetPack::getSize() const {
+    return samples;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getSample
+////////////////////////////////////////////////////////////////////////////////
+
+void DatasetPack::getSample(int i, Sample &sample) const {
+    LOG_IF(FATAL, i < 0 || i >= samples) << "Invalid sample index " << i << ".";
+    
+    const DatasetPackHeader* header = reinterpret_cast<const DatasetPackHeader*>(data);
+    const DatasetPackSample* sample_entry = reinterpret_cast<const DatasetPackSample*>(
+            data + header->samples_offset) + i;
+    const char* strings = data + header->strings_offset;
+    
+    sample.name = std::string(strings + sample_entry->name_offset, sample_entry->name_size);
+    sample.image = cv::Mat(sample_entry->rows, sample_entry->cols, CV_8UC3, 
+            data + sample_entry->image_offset);
+    sample.single_gt = (sample_entry->single_gt != 0);
+    
+    sample.gt_names.resize(sample_entry->gts);
+    sample.gt_indices.resize(sample_entry->gts);
+    sample.gt_segmentations.resize(sample_entry->gts);
+    
+    for (uint32_t k = 0; k < sample_entry->gts; ++k) {
+        const DatasetPackGroundTruth* gt_entry = reinterpret_cast<const DatasetPackGroundTruth*>(
+                data + header->gts_offset) + sample_entry->gt_first + k;
+        
+        sample.gt_names[k] = std::string(strings + gt_entry->name_offset, gt_entry->name_size);
+        sample.gt_indices[k] = gt_entry->index;
+        sample.gt_segmentations[k] = cv::Mat(sample_entry->rows, sample_entry->cols, 
+                CV_32SC1, data + gt_entry->offset);
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DATASET_PACK_H
+#define	DATASET_PACK_H
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+
+/** \brief A dataset (images and ground truths) packed into a single file which
+ * is memory-mapped for reading.
+ * 
+ * Images are stored decoded as CV_8UC3 and ground truths as CV_32SC1, each
+ * block aligned to 64 bytes, followed by an index of all samples and their
+ * ground truths as well as a string table of names. Opening a pack maps the
+ * file once; samples are returned as matrices referencing the mapping such 
+ * that iterating a dataset requires neither decoding nor parsing nor further
+ * system calls, which especially helps on network file systems. The mapping
+ * is private, i.e. writing to the matrices does not modify the file.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   DatasetPack::pack("data/BSDS500/images/test", 
+ *           "data/BSDS500/csv_groundTruth/test", "bsds500_test.spds");
+ * 
+ *   DatasetPack pack;
+ *   pack.open("bsds500_test.spds");
+ *   for (int i = 0; i < pack.getSize(); ++i) {
+ *       DatasetPack::Sample sample;
+ *       pack.getSample(i, sample);
+ *   }
+ * \endcode
+ * \author David Stutz
+ */
+class DatasetPack {
+public:
+    
+    /** \brief A sample, all matrices reference the mapped file. */
+    struct Sample {
+        /** \brief Name of the image without extension. */
+        std::string name;
+        /** \brief Image as CV_8UC3. */
+        cv::Mat image;
+        /** \brief Whether a single ground truth of the same name was packed,
+         * see EvaluationSummary::findGroundTruths. */
+        bool single_gt;
+        /** \brief File names of the ground truths, e.g. "100007-0.csv". */
+        std::vector<std::string> gt_names;
+        /** \brief Index of each ground truth. */
+        std::vector<int> gt_indices;
+        /** \brief Ground truths as CV_32SC1. */
+        std::vector<cv::Mat> gt_segmentations;
+    };
+    
+    /** \brief Constructor. */
+    DatasetPack();
+    
+    /** \brief Destructor, unmaps the file. */
+    ~DatasetPack();
+    
+    /** \brief Pack all images of a directory and their ground truths.
+     * \param[in] img_directory image directory
+     * \param[in] gt_directory ground truth directory, ground truths are found 
+     * as by EvaluationSummary::findGroundTruths; may be empty to pack images only
+     * \param[in] file pack file to write
+     * \return number of samples packed, -1 if the file could not be written
+     */
+    static int pack(const boost::filesystem::path &img_directory,
+            const boost::filesystem::path &gt_directory,
+            const boost::filesystem::path &file);
+    
+    /** \brief Check whether the file is a pack based on its extension (.spds).
+     * \param[in] file path to file
+     * \return whether the file is a pack
+     */
+    static bool isPackFile(const boost::filesystem::path &file);
+    
+    /** \brief Map a pack file, closing a previously opened one.
+     * \param[in] file pack file
+     * \return whether the file is a valid pack
+     */
+    bool open(const boost::filesystem::path &file);
+    
+    /** \brief Unmap the file; matrices of samples must no longer be used. */
+    void close();
+    
+    /** \brief Get the number of samples.
+     * \return number of samples
+     */
+    int getSize() const;
+    
+    /** \brief Get a sample referencing the mapped file.
+     * \param[in] i index of the sample
+     * \param[out] sample sample
+     */
+    void getSample(int i, Sample &sample) const;
+    
+private:
+    
+    /** \brief Start of the mapping. */
+    char* data;
+    /** \brief Size of the mapping in bytes. */
+    size_t size;
+    /** \brief Number of samples. */
+    int samples;
+    
+};
+
+#endif	/* DATASET_PACK_H */
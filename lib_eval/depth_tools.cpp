@@ -80,6 +80,23 @@ int DepthTools::Camera::backprojectY(float y, float depth, float factor) const {
     return round(y*focal_y*factor/depth + principal_y - cropping_y);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Rays
+////////////////////////////////////////////////////////////////////////////////
+
+DepthTools::Rays::Rays(const DepthTools::Camera &camera, int rows, int cols, 
+        float factor_) : x(cols), y(rows), focal_x(camera.focal_x), 
+        focal_y(camera.focal_y), factor(factor_) {
+    
+    for (int j = 0; j < cols; ++j) {
+        x[j] = ((float) j + camera.cropping_x) - camera.principal_x;
+    }
+    
+    for (int i = 0; i < rows; ++i) {
+        y[i] = ((float) i + camera.cropping_y) - camera.principal_y;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // computeCloudFromDepth
 ////////////////////////////////////////////////////////////////////////////////
@@ -87,16 +104,56 @@ int DepthTools::Camera::backprojectY(float y, float depth, float factor) const {
 void DepthTools::computeCloudFromDepth(const cv::Mat &depth, const DepthTools::Camera &camera,
         cv::Mat &cloud) {
     
+    DepthTools::Rays rays(camera, depth.rows, depth.cols);
+    computeCloudFromDepth(depth, rays, cloud);
+}
+
+void DepthTools::computeCloudFromDepth(const cv::Mat &depth, const DepthTools::Rays &rays,
+        cv::Mat &cloud, const cv::Mat &mask) {
+    
+    LOG_IF(FATAL, depth.type() != CV_16UC1) << "Depth needs to be unsigned short.";
+    LOG_IF(FATAL, (int) rays.x.size() != depth.cols || (int) rays.y.size() != depth.rows)
+            << "Rays do not match the depth size.";
+    LOG_IF(FATAL, !mask.empty() && (mask.type() != CV_8UC1 
+            || mask.rows != depth.rows || mask.cols != depth.cols)) 
+            << "Invalid mask.";
+    
+    // The coordinates are finite for any unsigned short depth as long as the
+    // focal lengths are finite and non-zero.
+    LOG_IF(FATAL, rays.focal_x == 0 || std::isinf(1.f/rays.focal_x)
+            || rays.focal_y == 0 || std::isinf(1.f/rays.focal_y)) 
+            << "Infinite cloud value!";
+    
     cloud.create(depth.rows, depth.cols, CV_32FC3);
+    
+    const float* ray_x = &rays.x[0];
+    const float focal_x = rays.focal_x;
+    const float factor = rays.factor;
     for (int i = 0; i < depth.rows; ++i) {
-        for (int j = 0; j < depth.cols; ++j) {
-            cloud.at<cv::Vec3f>(i, j)[0] = camera.projectX<int>(j, depth.at<unsigned short>(i, j));
-            cloud.at<cv::Vec3f>(i, j)[1] = camera.projectY<int>(i, depth.at<unsigned short>(i, j));
-            cloud.at<cv::Vec3f>(i, j)[2] = camera.projectZ(depth.at<unsigned short>(i, j));
-            
-            LOG_IF (FATAL, std::isinf(cloud.at<cv::Vec3f>(i, j)[0])) << "Infinite cloud value!";
-            LOG_IF (FATAL, std::isinf(cloud.at<cv::Vec3f>(i, j)[1])) << "Infinite cloud value!";
-            LOG_IF (FATAL, std::isinf(cloud.at<cv::Vec3f>(i, j)[2])) << "Infinite cloud value!";
+        const unsigned short* depth_row = depth.ptr<unsigned short>(i);
+        const unsigned char* mask_row = mask.empty() ? NULL : mask.ptr<unsigned char>(i);
+        float* cloud_row = cloud.ptr<float>(i);
+        
+        const float ray_y = rays.y[i];
+        const float focal_y = rays.focal_y;
+        
+        // Same operations and order as Camera::projectX/Y/Z, such that the
+        // result is bit-identical.
+        if (mask_row == NULL) {
+            for (int j = 0; j < depth.cols; ++j) {
+                const float z = ((float) depth_row[j])/factor;
+                cloud_row[3*j + 0] = ray_x[j]*z/focal_x;
+                cloud_row[3*j + 1] = ray_y*z/focal_y;
+                cloud_row[3*j + 2] = z;
+            }
+        }
+        else {
+            for (int j = 0; j < depth.cols; ++j) {
+                const float z = (mask_row[j] > 0) ? ((float) depth_row[j])/factor : 0.f;
+                cloud_row[3*j + 0] = ray_x[j]*z/focal_x;
+                cloud_row[3*j + 1] = ray_y*z/focal_y;
+                cloud_row[3*j + 2] = z;
+            }
         }
     }
-}
\ No newline at end of file
+}
@@ -32,6 +32,7 @@
 #ifndef DEPTH_TOOLS_H
 #define	DEPTH_TOOLS_H
 
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 /** \brief Tools for using depth information.
@@ -104,6 +105,33 @@ public:
         float focal_y;
     };
     
+    /** \brief Viewing rays of a camera for a fixed image size: the offsets from 
+     * the principal point per column and per row. Computed once, the projection
+     * of a pixel reduces to two multiplications and divisions by the focal lengths
+     * with the same rounding as Camera::projectX and Camera::projectY.
+     */
+    struct Rays {
+        
+        /** \brief Compute the rays of the given camera.
+         * \param[in] camera camera object, see above
+         * \param[in] rows number of rows
+         * \param[in] cols number of columns
+         * \param[in] factor factor to divide depth by
+         */
+        Rays(const Camera &camera, int rows, int cols, float factor = 1000.f);
+        
+        /** \brief Offset ((float) x + cropping_x) - principal_x per column. */
+        std::vector<float> x;
+        /** \brief Offset ((float) y + cropping_y) - principal_y per row. */
+        std::vector<float> y;
+        /** \brief Focal length in x. */
+        float focal_x;
+        /** \brief Focal length in y. */
+        float focal_y;
+        /** \brief Factor to divide depth by. */
+        float factor;
+    };
+    
     /** \brief Compute a point cloud stored as three channel float image from the given
      * depth map and the intrinsic parameters.
      * \param[in] depth depth as unsigned short image
@@ -112,6 +140,18 @@ public:
      */
     static void computeCloudFromDepth(const cv::Mat &depth, const Camera &camera,
             cv::Mat &cloud);
+    
+    /** \brief Compute a point cloud stored as three channel float image from the given
+     * depth map and precomputed rays; the rays can be reused for all depth maps
+     * of the same size and camera.
+     * \param[in] depth depth as unsigned short image
+     * \param[in] rays rays of the camera for the size of depth
+     * \param[out] cloud point cloud as three-channel image
+     * \param[in] mask optional CV_8UC1 mask, pixels where the mask is zero are 
+     * skipped and get the point (0, 0, 0) like pixels with zero depth
+     */
+    static void computeCloudFromDepth(const cv::Mat &depth, const Rays &rays,
+            cv::Mat &cloud, const cv::Mat &mask = cv::Mat());
 };
 
 #endif	/* DEPTH_TOOLS_H */
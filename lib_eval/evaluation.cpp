@@ -30,16 +30,18 @@
  */
 
 #include <limits>
+#include <algorithm>
 #include <glog/logging.h>
 #include "io_util.h"
 #include "evaluation.h"
+#include "evaluation_arena.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // computeBoundaryRecall
 ////////////////////////////////////////////////////////////////////////////////
 
 float Evaluation::computeBoundaryRecall(const cv::Mat &labels, 
-        const cv::Mat &gt, float d) {
+        const cv::Mat &gt, float d, bool dilate) {
     
     LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
             << "Superpixel segmentation does not match ground truth size.";
@@ -48,23 +50,43 @@ float Evaluation::computeBoundaryRecall(const cv::Mat &labels,
     int W = gt.cols;
     
     int r = std::round(d*std::sqrt(H*H + W*W));
-   
+    
+    cv::Mat boundaries;
+    cv::Mat gt_boundaries;
+    computeBoundaryMap(labels, boundaries);
+    computeBoundaryMap(gt, gt_boundaries);
+    
+    return computeBoundaryRecall(boundaries, gt_boundaries, r, dilate);
+}
+
+float Evaluation::computeBoundaryRecall(const cv::Mat &boundaries, 
+        const cv::Mat &gt_boundaries, int r, bool dilate) {
+    
+    int H = gt_boundaries.rows;
+    int W = gt_boundaries.cols;
+    
+    cv::Mat dilated;
+    if (dilate) {
+        dilateBoundaryMap(boundaries, r, dilated);
+    }
+    
     float tp = 0;
     float fn = 0;
 
     for (int i = 0; i < H; i++) {
+        const unsigned char* gt_boundaries_i = gt_boundaries.ptr<unsigned char>(i);
+        
         for (int j = 0; j < W; j++) {
-            if (is4ConnectedBoundaryPixel(gt, i, j)) {
-
+            if (gt_boundaries_i[j] > 0) {
+                
                 bool pos = false;
-                for (int k = std::max(0, i - r); k < std::min(H - 1, i + r) + 1; k++) {
-                    for (int l = std::max(0, j - r); l < std::min(W - 1, j + r) + 1; l++) {
-                        if (is4ConnectedBoundaryPixel(labels, k, l)) {
-                            pos = true;
-                        }
-                    }
+                if (dilate) {
+                    pos = (dilated.ptr<unsigned char>(i)[j] > 0);
                 }
-
+                else {
+                    pos = hasBoundaryPixel(boundaries, i, j, r);
+                }
+                
                 if (pos) {
                     tp++;
                 }
@@ -87,7 +109,7 @@ float Evaluation::computeBoundaryRecall(const cv::Mat &labels,
 ////////////////////////////////////////////////////////////////////////////////
 
 float Evaluation::computeBoundaryPrecision(const cv::Mat &labels, 
-        const cv::Mat &gt, float d) {
+        const cv::Mat &gt, float d, bool dilate) {
     
     LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
             << "Superpixel segmentation does not match ground truth size.";
@@ -96,37 +118,60 @@ float Evaluation::computeBoundaryPrecision(const cv::Mat &labels,
     int W = gt.cols;
     
     int r = std::round(d*std::sqrt(H*H + W*W));
-        
+    
+    cv::Mat boundaries;
+    cv::Mat gt_boundaries;
+    computeBoundaryMap(labels, boundaries);
+    computeBoundaryMap(gt, gt_boundaries);
+    
+    return computeBoundaryPrecision(boundaries, gt_boundaries, r, dilate);
+}
+
+float Evaluation::computeBoundaryPrecision(const cv::Mat &boundaries, 
+        const cv::Mat &gt_boundaries, int r, bool dilate) {
+    
+    int H = gt_boundaries.rows;
+    int W = gt_boundaries.cols;
+    
+    cv::Mat dilated;
+    cv::Mat gt_dilated;
+    if (dilate) {
+        dilateBoundaryMap(boundaries, r, dilated);
+        dilateBoundaryMap(gt_boundaries, r, gt_dilated);
+    }
+    
     float tp = 0;
     float fp = 0;
 
     for (int i = 0; i < H; i++) {
+        const unsigned char* boundaries_i = boundaries.ptr<unsigned char>(i);
+        const unsigned char* gt_boundaries_i = gt_boundaries.ptr<unsigned char>(i);
+        
         for (int j = 0; j < W; j++) {
-            if (is4ConnectedBoundaryPixel(gt, i, j)) {
-
+            if (gt_boundaries_i[j] > 0) {
+                
+                // Search for boundary pixel in the superpixel segmentation.
                 bool pos = false;
-                // Search for boundary pixel in the supervoxel segmentation.
-                for (int k = std::max(0, i - r); k < std::min(H - 1, i + r) + 1; k++) {
-                    for (int l = std::max(0, j - r); l < std::min(W - 1, j + r) + 1; l++) {
-                        if (is4ConnectedBoundaryPixel(labels, k, l)) {
-                            pos = true;
-                        }
-                    }
+                if (dilate) {
+                    pos = (dilated.ptr<unsigned char>(i)[j] > 0);
+                }
+                else {
+                    pos = hasBoundaryPixel(boundaries, i, j, r);
                 }
 
                 if (pos) {
                     tp++;
                 }
             }
-            else if (is4ConnectedBoundaryPixel(labels, i, j)) {
+            else if (boundaries_i[j] > 0) {
+                
+                // Search for boundary pixel in the ground truth segmentation.
                 bool pos = false;
-                // Search for boundary pixel in the supervoxel segmentation.
-                for (int k = std::max(0, i - r); k < std::min(H - 1, i + r) + 1; k++) {
-                    for (int l = std::max(0, j - r); l < std::min(W - 1, j + r) + 1; l++) {
-                        if (is4ConnectedBoundaryPixel(gt, k, l)) {
-                            pos = true;
-                        }
-                    }
+                if (dilate) {
+                    pos = (gt_dilated.ptr<unsigned char>(i)[j] > 0);
+                }
+                else {
+                    pos = hasBoundaryPixel(gt_boundaries, i, j, r);
                 }
 
                 if (!pos) {
@@ -153,32 +198,34 @@ float Evaluation::computeUndersegmentationError(const cv::Mat &labels,
     LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
             << "Superpixel segmentation does not match ground truth size.";
     
-    int H = gt.rows;
-    int W = gt.cols;
-    int N = H*W;
-
-    cv::Mat intersection_matrix;
+    SparseIntersectionMatrix intersections;
     std::vector<int> superpixel_sizes;
     std::vector<int> gt_sizes;
     
-    Evaluation::computeIntersectionMatrix(labels, gt, intersection_matrix, 
+    Evaluation::computeSparseIntersectionMatrix(labels, gt, intersections, 
             superpixel_sizes, gt_sizes);
 
-    float error = 0;
-    for (int j = 0; j < intersection_matrix.cols; ++j) {
-
-        int min = std::numeric_limits<int>::max();
-        for (int i = 0; i < intersection_matrix.rows; ++i) {
-            int superpixel_j_minus_gt_i = superpixel_sizes[j]
-                    - intersection_matrix.at<int>(i, j);
+    return computeUndersegmentationError(intersections, superpixel_sizes, 
+            gt.rows*gt.cols);
+}
 
-            LOG_IF(FATAL, superpixel_j_minus_gt_i < 0) << "Set difference is negative.";
-            if (superpixel_j_minus_gt_i < min) {
-                min = superpixel_j_minus_gt_i;
+float Evaluation::computeUndersegmentationError(const SparseIntersectionMatrix &intersections,
+        const std::vector<int> &superpixel_sizes, int N) {
+    
+    // The minimum of |S_j - G_i| over all G_i is attained at the ground truth
+    // segment with maximum intersection; segments not intersecting S_j give |S_j|.
+    float error = 0;
+    for (unsigned int j = 0; j < intersections.size(); ++j) {
+        
+        int max = 0;
+        for (unsigned int k = 0; k < intersections[j].size(); ++k) {
+            if (intersections[j][k].second > max) {
+                max = intersections[j][k].second;
             }
         }
-
-        error += min;
+        
+        LOG_IF(FATAL, superpixel_sizes[j] - max < 0) << "Set difference is negative.";
+        error += superpixel_sizes[j] - max;
     }
 
     return error/N;
@@ -194,35 +241,35 @@ float Evaluation::computeOversegmentationError(const cv::Mat &labels,
     LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
             << "Superpixel segmentation does not match ground truth size.";
     
-    int H = gt.rows;
-    int W = gt.cols;
-    int N = H*W;
-        
-    cv::Mat intersection_matrix;
+    SparseIntersectionMatrix intersections;
     std::vector<int> superpixel_sizes;
     std::vector<int> gt_sizes;
     
-    Evaluation::computeIntersectionMatrix(labels, gt, intersection_matrix, 
+    Evaluation::computeSparseIntersectionMatrix(labels, gt, intersections, 
             superpixel_sizes, gt_sizes);
     
-    float error = 0;
-    for (int i = 0; i < intersection_matrix.rows; ++i) {
-
-        int min = std::numeric_limits<int>::max();
-        for (int j = 0; j < intersection_matrix.cols; ++j) {
-            int gt_i_minus_superpixel_j = gt_sizes[i]
-                    - intersection_matrix.at<int>(i, j);
+    return computeOversegmentationError(intersections, gt_sizes, gt.rows*gt.cols);
+}
 
-            LOG_IF(FATAL, gt_i_minus_superpixel_j < 0) << "Set difference is negative.";
-            if (gt_i_minus_superpixel_j < min) {
-                min = gt_i_minus_superpixel_j;
+float Evaluation::computeOversegmentationError(const SparseIntersectionMatrix &intersections,
+        const std::vector<int> &gt_sizes, int N) {
+    
+    std::vector<int> max(gt_sizes.size(), 0);
+    for (unsigned int j = 0; j < intersections.size(); ++j) {
+        for (unsigned int k = 0; k < intersections[j].size(); ++k) {
+            if (intersections[j][k].second > max[intersections[j][k].first]) {
+                max[intersections[j][k].first] = intersections[j][k].second;
             }
         }
-
-        error += min;
     }
     
-    return error /= N;
+    float error = 0;
+    for (unsigned int i = 0; i < gt_sizes.size(); ++i) {
+        LOG_IF(FATAL, gt_sizes[i] - max[i] < 0) << "Set difference is negative.";
+        error += gt_sizes[i] - max[i];
+    }
+    
+    return error/N;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -235,25 +282,29 @@ float Evaluation::computeNPUndersegmentationError(const cv::Mat &labels,
     LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
             << "Superpixel segmentation does not match ground truth size.";
     
-    int N = gt.rows*gt.cols;
-        
-    cv::Mat intersection_matrix;
+    SparseIntersectionMatrix intersections;
     std::vector<int> superpixel_sizes;
     std::vector<int> gt_sizes;
 
-    Evaluation::computeIntersectionMatrix(labels, gt, 
-            intersection_matrix, superpixel_sizes, gt_sizes);
+    Evaluation::computeSparseIntersectionMatrix(labels, gt, intersections, 
+            superpixel_sizes, gt_sizes);
+    
+    return computeNPUndersegmentationError(intersections, superpixel_sizes, 
+            gt.rows*gt.cols);
+}
+
+float Evaluation::computeNPUndersegmentationError(const SparseIntersectionMatrix &intersections,
+        const std::vector<int> &superpixel_sizes, int N) {
     
     float error = 0;
-    for (int i = 0; i < intersection_matrix.rows; ++i) {
-        for (int j = 0; j < intersection_matrix.cols; ++j) {
-            if (intersection_matrix.at<int>(i, j) > 0) {
-                LOG_IF (ERROR, superpixel_sizes[j] - intersection_matrix.at<int>(i, j) < 0)
-                        << "Invalid intersection computed, set difference is negative!";
-                
-                error += std::min(intersection_matrix.at<int>(i, j), 
-                        superpixel_sizes[j] - intersection_matrix.at<int>(i, j));
-            }
+    for (unsigned int j = 0; j < intersections.size(); ++j) {
+        for (unsigned int k = 0; k < intersections[j].size(); ++k) {
+            int intersection = intersections[j][k].second;
+            
+            LOG_IF (ERROR, superpixel_sizes[j] - intersection < 0)
+                    << "Invalid intersection computed, set difference is negative!";
+            
+            error += std::min(intersection, superpixel_sizes[j] - intersection);
         }
     }
 
@@ -267,23 +318,31 @@ float Evaluation::computeNPUndersegmentationError(const cv::Mat &labels,
 float Evaluation::computeLevinUndersegmentationError(const cv::Mat &labels, 
         const cv::Mat &gt) {
     
-    cv::Mat intersection_matrix;
+    SparseIntersectionMatrix intersections;
     std::vector<int> superpixel_sizes;
     std::vector<int> gt_sizes;
 
-    Evaluation::computeIntersectionMatrix(labels, gt, 
-            intersection_matrix, superpixel_sizes, gt_sizes);
+    Evaluation::computeSparseIntersectionMatrix(labels, gt, intersections, 
+            superpixel_sizes, gt_sizes);
     
-    float error = 0;
-    for (int i = 0; i < intersection_matrix.rows; i++) {
-        
-        float gt_error = 0;
-        for (int j = 0; j < intersection_matrix.cols; j++) {
-            if (intersection_matrix.at<int>(i, j) > 0) {
-                gt_error += superpixel_sizes[j];
-            }
+    return computeLevinUndersegmentationError(intersections, superpixel_sizes, 
+            gt_sizes);
+}
+
+float Evaluation::computeLevinUndersegmentationError(const SparseIntersectionMatrix &intersections,
+        const std::vector<int> &superpixel_sizes, const std::vector<int> &gt_sizes) {
+    
+    std::vector<float> gt_errors(gt_sizes.size(), 0);
+    for (unsigned int j = 0; j < intersections.size(); ++j) {
+        for (unsigned int k = 0; k < intersections[j].size(); ++k) {
+            gt_errors[intersections[j][k].first] += superpixel_sizes[j];
         }
+    }
+    
+    float error = 0;
+    for (unsigned int i = 0; i < gt_sizes.size(); i++) {
         
+        float gt_error = gt_errors[i];
         gt_error -= gt_sizes[i];
         
         if (gt_sizes[i] > 0) {
@@ -305,24 +364,26 @@ float Evaluation::computeAchievableSegmentationAccuracy(const cv::Mat &labels,
     LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
             << "Superpixel segmentation does not match ground truth size.";
     
-    int H = gt.rows;
-    int W = gt.cols;
-    int N = H*W;
-        
-    cv::Mat intersection_matrix;
+    SparseIntersectionMatrix intersections;
     std::vector<int> superpixel_sizes;
     std::vector<int> gt_sizes;
 
-    Evaluation::computeIntersectionMatrix(labels, gt, 
-            intersection_matrix, superpixel_sizes, gt_sizes);
+    Evaluation::computeSparseIntersectionMatrix(labels, gt, intersections, 
+            superpixel_sizes, gt_sizes);
+
+    return computeAchievableSegmentationAccuracy(intersections, gt.rows*gt.cols);
+}
 
+float Evaluation::computeAchievableSegmentationAccuracy(const SparseIntersectionMatrix &intersections,
+        int N) {
+    
     float accuracy = 0;
-    for (int j = 0; j < intersection_matrix.cols; ++j) {
+    for (unsigned int j = 0; j < intersections.size(); ++j) {
 
         int max = 0;
-        for (int i = 0; i < intersection_matrix.rows; ++i) {
-            if (intersection_matrix.at<int>(i, j) > max) {
-                max = intersection_matrix.at<int>(i, j);
+        for (unsigned int k = 0; k < intersections[j].size(); ++k) {
+            if (intersections[j][k].second > max) {
+                max = intersections[j][k].second;
             }
         }
 
@@ -339,49 +400,29 @@ float Evaluation::computeAchievableSegmentationAccuracy(const cv::Mat &labels,
 float Evaluation::computeSumOfSquaredErrorRGB(const cv::Mat &labels,
         const cv::Mat &image) {
     
-    LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported.";
-    LOG_IF(FATAL, labels.rows != image.rows || labels.cols != image.cols) 
-            << "Superpixel segmentation does not match image size.";
-    
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
+    std::vector<ColorMoments> moments;
+    computeColorMoments(labels, image, moments);
     
-    std::vector<cv::Vec3f> mean(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<int> count(superpixels, 0);
-    
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                mean[labels.at<int>(i, j)][c] += image.at<cv::Vec3b>(i, j)[c];
-            }
-            
-            count[labels.at<int>(i, j)]++;
-        }
-    }
+    return computeSumOfSquaredErrorRGB(moments);
+}
+
+float Evaluation::computeSumOfSquaredErrorRGB(const std::vector<ColorMoments> &moments) {
     
-    for (int k = 0; k < superpixels; k++) {
-        mean[k] /= count[k];
-    }
+    double squared_sum = 0;
+    int N = 0;
     
-    float squared_sum = 0;
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                squared_sum += (mean[labels.at<int>(i, j)][c] - image.at<cv::Vec3b>(i, j)[c])
-                        * (mean[labels.at<int>(i, j)][c] - image.at<cv::Vec3b>(i, j)[c]);
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        if (moments[k].count > 0) {
+            for (int c = 0; c < 3; ++c) {
+                squared_sum += moments[k].squared_color[c] 
+                        - moments[k].color[c]*moments[k].color[c]/moments[k].count;
             }
         }
+        
+        N += moments[k].count;
     }
     
-    return squared_sum/(image.rows*image.cols);
+    return squared_sum/N;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -391,47 +432,29 @@ float Evaluation::computeSumOfSquaredErrorRGB(const cv::Mat &labels,
 float Evaluation::computeSumOfSquaredErrorXY(const cv::Mat &labels,
         const cv::Mat &image) {
     
-    LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported.";
-    LOG_IF(FATAL, labels.rows != image.rows || labels.cols != image.cols) 
-            << "Superpixel segmentation does not match image size.";
-    
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
+    std::vector<ColorMoments> moments;
+    computeColorMoments(labels, image, moments);
     
-    std::vector<cv::Vec2f> mean(superpixels, cv::Vec2f(0, 0));
-    std::vector<int> count(superpixels, 0);
+    return computeSumOfSquaredErrorXY(moments);
+}
+
+float Evaluation::computeSumOfSquaredErrorXY(const std::vector<ColorMoments> &moments) {
     
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            mean[labels.at<int>(i, j)][0] += i;
-            mean[labels.at<int>(i, j)][1] += j;
-            count[labels.at<int>(i, j)]++;
-        }
-    }
+    double squared_sum = 0;
+    int N = 0;
     
-    for (int k = 0; k < superpixels; k++) {
-        mean[k] /= count[k];
-    }
-    
-    float squared_sum = 0;
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            squared_sum += (mean[labels.at<int>(i, j)][0] - i)
-                    * (mean[labels.at<int>(i, j)][0] - i);
-            squared_sum += (mean[labels.at<int>(i, j)][1] - j)
-                    * (mean[labels.at<int>(i, j)][1] - j);
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        if (moments[k].count > 0) {
+            for (int d = 0; d < 2; ++d) {
+                squared_sum += moments[k].squared_position[d] 
+                        - moments[k].position[d]*moments[k].position[d]/moments[k].count;
+            }
         }
+        
+        N += moments[k].count;
     }
     
-    return squared_sum/(image.rows*image.cols);
+    return squared_sum/N;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -441,59 +464,45 @@ float Evaluation::computeSumOfSquaredErrorXY(const cv::Mat &labels,
 float Evaluation::computeExplainedVariation(const cv::Mat &labels,
         const cv::Mat &image) {
     
-    LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported.";
-    LOG_IF(FATAL, labels.rows != image.rows || labels.cols != image.cols) 
-            << "Superpixel segmentation does not match image size.";
-    
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
+    std::vector<ColorMoments> moments;
+    computeColorMoments(labels, image, moments);
     
-    superpixels++;
+    return computeExplainedVariation(moments);
+}
+
+float Evaluation::computeExplainedVariation(const std::vector<ColorMoments> &moments) {
     
-    std::vector<cv::Vec3f> mean(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<cv::Vec3f> squared_mean(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<int> count(superpixels, 0);
+    double overall_mean[3] = {0, 0, 0};
+    int N = 0;
     
-    cv::Vec3f overall_mean = 0;
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                mean[labels.at<int>(i, j)][c] += image.at<cv::Vec3b>(i, j)[c];
-                overall_mean[c] += image.at<cv::Vec3b>(i, j)[c];
-            }
-            
-            count[labels.at<int>(i, j)]++;
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        for (int c = 0; c < 3; ++c) {
+            overall_mean[c] += moments[k].color[c];
         }
+        
+        N += moments[k].count;
     }
     
-    for (int i = 0; i < superpixels; ++i) {
-        for (int c = 0; c < image.channels(); ++c) {
-            mean[i][c] /= count[i];
-        }
+    for (int c = 0; c < 3; ++c) {
+        overall_mean[c] /= N;
     }
     
-    overall_mean /= image.rows*image.cols;
+    // The total variation is split into the variation explained by the
+    // superpixel means and the variation within superpixels.
+    double sum_top = 0;
+    double sum_within = 0;
     
-    float sum_top = 0;
-    float sum_bottom = 0;
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                sum_top += (mean[labels.at<int>(i, j)][c] - overall_mean[c])
-                        *(mean[labels.at<int>(i, j)][c] - overall_mean[c]);
-                sum_bottom += (image.at<cv::Vec3b>(i, j)[c] - overall_mean[c])
-                        *(image.at<cv::Vec3b>(i, j)[c] - overall_mean[c]);
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        if (moments[k].count > 0) {
+            for (int c = 0; c < 3; ++c) {
+                double mean = moments[k].color[c]/moments[k].count;
+                sum_top += moments[k].count*(mean - overall_mean[c])*(mean - overall_mean[c]);
+                sum_within += moments[k].squared_color[c] - moments[k].color[c]*mean;
             }
         }
     }
     
-    return sum_top/sum_bottom;
+    return sum_top/(sum_top + sum_within);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -506,30 +515,35 @@ float Evaluation::computeMeanDistanceToEdge(const cv::Mat &labels,
     LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
             << "Superpixel segmentation does not match ground truth size.";
     
-    cv::Mat boundary(labels.rows, labels.cols, CV_8UC1, cv::Scalar(1));
-    cv::Mat gt_boundary(gt.rows, gt.cols, CV_8UC1, cv::Scalar(0));
+    cv::Mat boundaries;
+    cv::Mat gt_boundaries;
+    computeBoundaryMap(labels, boundaries);
+    computeBoundaryMap(gt, gt_boundaries);
     
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (is4ConnectedBoundaryPixel(labels, i, j)) {
-                boundary.at<unsigned char>(i, j) = 0;
-            }
-            if (is4ConnectedBoundaryPixel(gt, i, j)) {
-                gt_boundary.at<unsigned char>(i, j) = 1;
-            }
-        }
-    }
+    return computeMeanDistanceToEdgeOnBoundaryMaps(boundaries, gt_boundaries);
+}
+
+float Evaluation::computeMeanDistanceToEdgeOnBoundaryMaps(const cv::Mat &boundaries,
+        const cv::Mat &gt_boundaries) {
+    
+    LOG_IF(FATAL, boundaries.rows != gt_boundaries.rows || boundaries.cols != gt_boundaries.cols) 
+            << "Superpixel boundaries do not match ground truth boundaries size.";
     
+    // Zero on boundary pixels such that the distance to the boundary is computed.
+    cv::Mat inverse_boundaries = 1 - boundaries;
     cv::Mat distance;
-    cv::distanceTransform(boundary, distance, CV_DIST_L2, 3);
+    cv::distanceTransform(inverse_boundaries, distance, CV_DIST_L2, 3);
     
     float mean_distance_edge = 0;
     int count = 0;
     
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (gt_boundary.at<unsigned char>(i, j) > 0) {
-                mean_distance_edge += distance.at<float>(i, j);
+    for (int i = 0; i < boundaries.rows; ++i) {
+        const unsigned char* gt_boundaries_i = gt_boundaries.ptr<unsigned char>(i);
+        const float* distance_i = distance.ptr<float>(i);
+        
+        for (int j = 0; j < boundaries.cols; ++j) {
+            if (gt_boundaries_i[j] > 0) {
+                mean_distance_edge += distance_i[j];
                 count++;
             }
         }
@@ -545,69 +559,155 @@ float Evaluation::computeMeanDistanceToEdge(const cv::Mat &labels,
 float Evaluation::computeIntraClusterVariation(const cv::Mat &labels, 
         const cv::Mat &image) {
     
+    std::vector<ColorMoments> moments;
+    computeColorMoments(labels, image, moments);
+    
+    return computeIntraClusterVariation(moments);
+}
+
+float Evaluation::computeIntraClusterVariation(const std::vector<ColorMoments> &moments) {
+    
+    double sum = 0;
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        if (moments[k].count > 0) {
+            double variance = 0;
+            for (int c = 0; c < 3; ++c) {
+                double mean = moments[k].color[c]/moments[k].count;
+                variance += moments[k].squared_color[c]/moments[k].count - mean*mean;
+            }
+            
+            sum += std::sqrt(std::max(0., variance));
+        }
+    }
+    
+    if (moments.size() > 0) {
+        return sum/moments.size();
+    }
+    
+    return sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeColorMoments
+////////////////////////////////////////////////////////////////////////////////
+
+void Evaluation::computeColorMoments(const cv::Mat &labels, const cv::Mat &image,
+        std::vector<ColorMoments> &moments) {
+    
     LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported.";
     LOG_IF(FATAL, labels.rows != image.rows || labels.cols != image.cols) 
             << "Superpixel segmentation does not match image size.";
     
     int superpixels = 0;
     for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        
         for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
+            superpixels = std::max(superpixels, labels_i[j]);
         }
     }
     
     superpixels++;
     
-    std::vector<cv::Vec3f> mean(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<int> count(superpixels, 0);
+    ColorMoments zero = {0, {0, 0, 0}, {0, 0, 0}, {0, 0}, {0, 0}};
+    moments.assign(superpixels, zero);
     
     for (int i = 0; i < image.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        const cv::Vec3b* image_i = image.ptr<cv::Vec3b>(i);
+        
         for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                mean[labels.at<int>(i, j)][c] += image.at<cv::Vec3b>(i, j)[c];
+            ColorMoments &moment = moments[labels_i[j]];
+            
+            for (int c = 0; c < 3; ++c) {
+                double value = image_i[j][c];
+                moment.color[c] += value;
+                moment.squared_color[c] += value*value;
             }
             
-            ++count[labels.at<int>(i, j)];
+            moment.position[0] += i;
+            moment.position[1] += j;
+            moment.squared_position[0] += ((double) i)*i;
+            moment.squared_position[1] += ((double) j)*j;
+            moment.count++;
         }
     }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeShapeStatistics
+////////////////////////////////////////////////////////////////////////////////
+
+void Evaluation::computeShapeStatistics(const cv::Mat &labels, 
+        ShapeStatistics &statistics, cv::Mat &boundaries) {
     
-    for (int i = 0; i < superpixels; ++i) {
-        for (int c = 0; c < image.channels(); ++c) {
-            if (count[i] > 0) {
-                mean[i][c] /= count[i];
-            }
-        }
-    }
+    int H = labels.rows;
+    int W = labels.cols;
     
-    std::vector<float> variance(superpixels, 0);
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                variance[labels.at<int>(i, j)] += (image.at<cv::Vec3b>(i, j)[c] - mean[labels.at<int>(i, j)][c])
-                        * (image.at<cv::Vec3b>(i, j)[c] - mean[labels.at<int>(i, j)][c]);
-            }
+    int superpixels = 0;
+    for (int i = 0; i < H; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        
+        for (int j = 0; j < W; ++j) {
+            superpixels = std::max(superpixels, labels_i[j]);
         }
     }
     
-    for (int i = 0; i < superpixels; ++i) {
-        if (count[i] > 0) {
-            variance[i] /= count[i];
-            variance[i] = std::sqrt(variance[i]);
-        }
-    }
+    superpixels++;
     
-    float sum = 0;
-    for (int i = 0; i < superpixels; ++i) {
-        sum += variance[i];
-    }
+    statistics.rows = H;
+    statistics.cols = W;
+    statistics.areas.assign(superpixels, 0);
+    statistics.perimeters.assign(superpixels, 0);
+    statistics.boundary_count = 0;
     
-    if (superpixels > 0) {
-        return sum/superpixels;
+    EvaluationArena &arena = EvaluationArena::getThreadLocal();
+    EvaluationArena::Scope scope(arena);
+    
+    int* min_i = arena.allocate<int>(superpixels, H);
+    int* max_i = arena.allocate<int>(superpixels, -1);
+    int* min_j = arena.allocate<int>(superpixels, W);
+    int* max_j = arena.allocate<int>(superpixels, -1);
+    
+    boundaries.create(H, W, CV_8UC1);
+    
+    for (int i = 0; i < H; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        const int* labels_above = labels.ptr<int>(std::max(0, i - 1));
+        const int* labels_below = labels.ptr<int>(std::min(H - 1, i + 1));
+        unsigned char* boundaries_i = boundaries.ptr<unsigned char>(i);
+        
+        // The image border counts towards the perimeter, see computeCompactness.
+        int border_i = (i == 0 ? 1 : 0) + (i == H - 1 ? 1 : 0);
+        
+        for (int j = 0; j < W; ++j) {
+            int label = labels_i[j];
+            
+            int differing = (label != labels_above[j]) + (label != labels_below[j])
+                    + (j > 0 && label != labels_i[j - 1]) 
+                    + (j < W - 1 && label != labels_i[j + 1]);
+            int border = border_i + (j == 0 ? 1 : 0) + (j == W - 1 ? 1 : 0);
+            
+            statistics.areas[label]++;
+            statistics.perimeters[label] += differing + border;
+            
+            min_i[label] = std::min(min_i[label], i);
+            max_i[label] = std::max(max_i[label], i);
+            min_j[label] = std::min(min_j[label], j);
+            max_j[label] = std::max(max_j[label], j);
+            
+            boundaries_i[j] = (differing > 0) ? 1 : 0;
+            statistics.boundary_count += boundaries_i[j];
+        }
     }
     
-    return sum;
+    statistics.bounding_boxes.assign(statistics.areas.size(), cv::Rect());
+    for (unsigned int k = 0; k < statistics.areas.size(); ++k) {
+        if (statistics.areas[k] > 0) {
+            statistics.bounding_boxes[k] = cv::Rect(min_j[k], min_i[k], 
+                    max_j[k] - min_j[k] + 1, max_i[k] - min_i[k] + 1);
+        }
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -616,78 +716,25 @@ float Evaluation::computeIntraClusterVariation(const cv::Mat &labels,
 
 float Evaluation::computeCompactness(const cv::Mat &labels) {
     
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
-    
-    std::vector<float> perimeter(superpixels, 0);
-//    std::vector<float> old_perimeter(superpixels, 0);
-    std::vector<float> area(superpixels, 0); // = number of pixels!
+    ShapeStatistics statistics;
+    cv::Mat boundaries;
+    computeShapeStatistics(labels, statistics, boundaries);
     
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            
-            int count = 0;
-            if (i > 0) {
-                if (labels.at<int>(i, j) != labels.at<int>(i - 1, j)) {
-                    count++;
-                }
-            }
-            else {
-                count++;
-            }
-
-            if (i < labels.rows - 1) {
-                if (labels.at<int>(i, j) != labels.at<int>(i + 1, j)) {
-                    count++;
-                }
-            }
-            else {
-                count++;
-            }
-
-            if (j > 0) {
-                if (labels.at<int>(i, j) != labels.at<int>(i, j - 1)) {
-                    count++;
-                }
-            }
-            else {
-                count++;
-            }
+    return computeCompactness(statistics);
+}
 
-            if (j < labels.cols - 1) {
-                if (labels.at<int>(i, j) != labels.at<int>(i, j + 1)) {
-                    count++;
-                }
-            }
-            else {
-                count++;
-            }
-            
-            perimeter[labels.at<int>(i, j)] += count;
-            area[labels.at<int>(i, j)] += 1;
-        }
-    }
+float Evaluation::computeCompactness(const ShapeStatistics &statistics) {
     
     float compactness = 0;
-//    float old_compactness = 0;
-    
-    for (int i = 0; i < superpixels; ++i) {
-        if (perimeter[i] > 0) {
-            compactness += area[i] * (4*M_PI*area[i])/(perimeter[i]*perimeter[i]);
+    for (unsigned int k = 0; k < statistics.areas.size(); ++k) {
+        if (statistics.perimeters[k] > 0) {
+            float area = statistics.areas[k];
+            float perimeter = statistics.perimeters[k];
+            compactness += area * (4*M_PI*area)/(perimeter*perimeter);
         }
-//        old_compactness += area[i] * (4*M_PI*area[i])/(old_perimeter[i]*old_perimeter[i]);
     }
     
-    compactness /= labels.rows*labels.cols;
-//    old_compactness /= labels.rows*labels.cols;
+    compactness /= statistics.rows*statistics.cols;
     LOG_IF (ERROR, compactness > 1.0f) 
             << "Invalid compactness: " << compactness;
     
@@ -700,23 +747,25 @@ float Evaluation::computeCompactness(const cv::Mat &labels) {
 
 float Evaluation::computeContourDensity(const cv::Mat &labels) {
     
-    int contour = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (is4ConnectedBoundaryPixel(labels, i, j)) {
-                ++contour;
-            }
-        }
-    }
+    cv::Mat boundaries;
+    computeBoundaryMap(labels, boundaries);
     
-    return contour/((float) (labels.rows*labels.cols));
+    return computeContourDensityOnBoundaryMap(boundaries);
+}
+
+float Evaluation::computeContourDensity(const ShapeStatistics &statistics) {
+    return statistics.boundary_count/((float) (statistics.rows*statistics.cols));
+}
+
+float Evaluation::computeContourDensityOnBoundaryMap(const cv::Mat &boundaries) {
+    return cv::countNonZero(boundaries)/((float) (boundaries.rows*boundaries.cols));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // computeGradientMagnitude
 ////////////////////////////////////////////////////////////////////////////////
 
-void computeGradientMagnitude(const cv::Mat &image, cv::Mat &gradient_magnitude) {
+void Evaluation::computeGradientMagnitude(const cv::Mat &image, cv::Mat &gradient_magnitude) {
     cv::Mat image_gray;
     if (image.channels() == 3) {
         cv::cvtColor(image, image_gray, CV_BGR2GRAY);
@@ -734,7 +783,8 @@ void computeGradientMagnitude(const cv::Mat &image, cv::Mat &gradient_magnitude)
     cv::Sobel(image_gray,grad_y, CV_32F, 0, 1, 3);
     cv::convertScaleAbs(grad_y, grad_y);
 
-    cv::addWeighted(grad_x, 0.5, grad_y, 0.5, 0, gradient_magnitude);
+    // The absolute gradients are 8 bit, the normalized magnitude is float.
+    cv::addWeighted(grad_x, 0.5, grad_y, 0.5, 0, gradient_magnitude, CV_32F);
     
     float max = 0;
     for (int i = 0; i < gradient_magnitude.rows; ++i) {
@@ -745,14 +795,16 @@ void computeGradientMagnitude(const cv::Mat &image, cv::Mat &gradient_magnitude)
         }
     }
     
-    gradient_magnitude /= max;
+    if (max > 0) {
+        gradient_magnitude /= max;
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // computeCannyEdges
 ////////////////////////////////////////////////////////////////////////////////
 
-void computeCannyEdges(const cv::Mat &image, float threshold, cv::Mat &canny) {
+void Evaluation::computeCannyEdges(const cv::Mat &image, float threshold, cv::Mat &canny) {
     cv::Mat image_gray;
     if (image.channels() == 3) {
         cv::cvtColor(image, image_gray, CV_BGR2GRAY);
@@ -770,36 +822,27 @@ void computeCannyEdges(const cv::Mat &image, float threshold, cv::Mat &canny) {
 
 float Evaluation::computeRegularity(const cv::Mat &labels) {
     
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
+    ShapeStatistics statistics;
+    cv::Mat boundaries;
+    computeShapeStatistics(labels, statistics, boundaries);
     
-    superpixels++;
+    return computeRegularity(statistics);
+}
+
+float Evaluation::computeRegularity(const ShapeStatistics &statistics) {
     
-    int H = labels.rows;
-    int W = labels.rows;
-    int region_size = std::sqrt((labels.rows*labels.cols)/superpixels);
+    int superpixels = statistics.areas.size();
+    
+    // Note that the number of rows is also used as width.
+    int H = statistics.rows;
+    int W = statistics.rows;
+    int region_size = std::sqrt((statistics.rows*statistics.cols)/superpixels);
     
     int number_H = H/region_size;
     int number_W = W/region_size;
     
     int boundary_grid = number_H*W + number_W*H - number_H*number_W;
-    
-    int boundary_sp = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (is4ConnectedBoundaryPixel(labels, i, j)) {
-                ++boundary_sp;
-            }
-        }
-    }
-    
-    return boundary_grid/((float) boundary_sp);
+    return boundary_grid/((float) statistics.boundary_count);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -901,34 +944,49 @@ float Evaluation::computeEdgeRecall(const cv::Mat &labels, const cv::Mat &edges,
     int W = edges.cols;
     
     int r = std::round(d*std::sqrt(H*H + W*W));
-   
+    
+    cv::Mat boundaries;
+    computeBoundaryMap(labels, boundaries);
+    
+    return computeEdgeRecall(boundaries, edges, r, true);
+}
+
+float Evaluation::computeEdgeRecall(const cv::Mat &boundaries, const cv::Mat &edges,
+        int r, bool dilate) {
+    
+    LOG_IF(FATAL, boundaries.rows != edges.rows || boundaries.cols != edges.cols) 
+            << "Superpixel boundaries do not match edge map size.";
+    
+    int H = edges.rows;
+    int W = edges.cols;
+    
+    cv::Mat dilated;
+    if (dilate) {
+        dilateBoundaryMap(boundaries, r, dilated);
+    }
+    
     float tp = 0;
     float fn = 0;
-
-//    double min;
-//    double max;
-//    cv::minMaxLoc(edges, &min, &max);
     
     for (int i = 0; i < H; i++) {
+        const unsigned char* edges_i = edges.ptr<unsigned char>(i);
+        
         for (int j = 0; j < W; j++) {
-            if (edges.at<unsigned char>(i, j) > 100) {
-
+            if (edges_i[j] > 100) {
+                
                 bool pos = false;
-                for (int k = std::max(0, i - r); k < std::min(H - 1, i + r) + 1; k++) {
-                    for (int l = std::max(0, j - r); l < std::min(W - 1, j + r) + 1; l++) {
-                        if (is4ConnectedBoundaryPixel(labels, k, l)) {
-                            pos = true;
-                        }
-                    }
+                if (dilate) {
+                    pos = (dilated.ptr<unsigned char>(i)[j] > 0);
                 }
-
+                else {
+                    pos = hasBoundaryPixel(boundaries, i, j, r);
+                }
+                
                 if (pos) {
                     tp++;
-//                    tp += pos/255;
                 }
                 else {
-//                    fn++;
-                    fn += ((float) edges.at<unsigned char>(i, j))/255;
+                    fn += ((float) edges_i[j])/255;
                 }
             }
         }
@@ -1042,10 +1100,13 @@ void Evaluation::computeBoundingBoxes(const cv::Mat &labels,
     
     superpixels++;
     
-    std::vector<int> min_i(superpixels, std::numeric_limits<int>::max());
-    std::vector<int> max_i(superpixels, std::numeric_limits<int>::min());
-    std::vector<int> min_j(superpixels, std::numeric_limits<int>::max());
-    std::vector<int> max_j(superpixels, std::numeric_limits<int>::min());
+    EvaluationArena &arena = EvaluationArena::getThreadLocal();
+    EvaluationArena::Scope scope(arena);
+    
+    int* min_i = arena.allocate<int>(superpixels, std::numeric_limits<int>::max());
+    int* max_i = arena.allocate<int>(superpixels, std::numeric_limits<int>::min());
+    int* min_j = arena.allocate<int>(superpixels, std::numeric_limits<int>::max());
+    int* max_j = arena.allocate<int>(superpixels, std::numeric_limits<int>::min());
     
     for (int i = 0; i < labels.rows; ++i) {
         for (int j = 0; j < labels.cols; ++j) {
@@ -1127,6 +1188,207 @@ void Evaluation::computeIntersectionMatrix(const cv::Mat &labels, const cv::Mat
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// computeSparseIntersectionMatrix
+////////////////////////////////////////////////////////////////////////////////
+
+void Evaluation::computeSparseIntersectionMatrix(const cv::Mat &labels, const cv::Mat &gt,
+        SparseIntersectionMatrix &intersections, std::vector<int> &superpixel_sizes, 
+        std::vector<int> &gt_sizes) {
+    
+    std::vector<SparseIntersectionMatrix> batch_intersections;
+    std::vector< std::vector<int> > batch_gt_sizes;
+    computeSparseIntersectionMatrices(labels, std::vector<cv::Mat>(1, gt), 
+            batch_intersections, superpixel_sizes, batch_gt_sizes);
+    
+    intersections.swap(batch_intersections[0]);
+    gt_sizes.swap(batch_gt_sizes[0]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSparseIntersectionMatrices
+////////////////////////////////////////////////////////////////////////////////
+
+void Evaluation::computeSparseIntersectionMatrices(const cv::Mat &labels, 
+        const std::vector<cv::Mat> &gts, std::vector<SparseIntersectionMatrix> &intersections, 
+        std::vector<int> &superpixel_sizes, std::vector< std::vector<int> > &gt_sizes) {
+    
+    for (unsigned int t = 0; t < gts.size(); ++t) {
+        LOG_IF(FATAL, labels.rows != gts[t].rows || labels.cols != gts[t].cols) 
+                << "Superpixel segmentation does not match ground truth size.";
+    }
+    
+    int superpixels = 0;
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            if (labels_i[j] > superpixels) {
+                superpixels = labels_i[j];
+            }
+        }
+    }
+    
+    superpixels++;
+    
+    // Lists are cleared instead of reallocated such that repeated calls, e.g.
+    // from a reused FusedEvaluation, keep their capacity.
+    intersections.resize(gts.size());
+    superpixel_sizes.assign(superpixels, 0);
+    gt_sizes.resize(gts.size());
+    
+    for (unsigned int t = 0; t < gts.size(); ++t) {
+        int gt_segments = 0;
+        for (int i = 0; i < gts[t].rows; ++i) {
+            const int* gt_i = gts[t].ptr<int>(i);
+            
+            for (int j = 0; j < gts[t].cols; ++j) {
+                if (gt_i[j] > gt_segments) {
+                    gt_segments = gt_i[j];
+                }
+            }
+        }
+        
+        intersections[t].resize(superpixels);
+        for (int k = 0; k < superpixels; ++k) {
+            intersections[t][k].clear();
+        }
+        
+        gt_sizes[t].assign(gt_segments + 1, 0);
+    }
+    
+    // Each row of the superpixel segmentation is read once and intersected
+    // with the corresponding row of all ground truth segmentations.
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            superpixel_sizes[labels_i[j]]++;
+        }
+        
+        for (unsigned int t = 0; t < gts.size(); ++t) {
+            const int* gt_i = gts[t].ptr<int>(i);
+            SparseIntersectionMatrix &intersections_t = intersections[t];
+            std::vector<int> &gt_sizes_t = gt_sizes[t];
+            
+            // Neighboring pixels usually share both labels, so remember the 
+            // last pair to avoid searching the list.
+            int last_label = -1;
+            int last_gt_label = -1;
+            int last_k = -1;
+            
+            for (int j = 0; j < labels.cols; ++j) {
+                int label = labels_i[j];
+                int gt_label = gt_i[j];
+                
+                gt_sizes_t[gt_label]++;
+                
+                if (label != last_label || gt_label != last_gt_label) {
+                    std::vector< std::pair<int, int> > &intersection = intersections_t[label];
+                    
+                    last_k = -1;
+                    for (unsigned int k = 0; k < intersection.size(); ++k) {
+                        if (intersection[k].first == gt_label) {
+                            last_k = k;
+                            break;
+                        }
+                    }
+                    
+                    if (last_k < 0) {
+                        intersection.push_back(std::pair<int, int>(gt_label, 0));
+                        last_k = intersection.size() - 1;
+                    }
+                    
+                    last_label = label;
+                    last_gt_label = gt_label;
+                }
+                
+                intersections_t[label][last_k].second++;
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeBoundaryMap
+////////////////////////////////////////////////////////////////////////////////
+
+int Evaluation::computeBoundaryMap(const cv::Mat &labels, cv::Mat &boundaries) {
+    
+    int H = labels.rows;
+    int W = labels.cols;
+    
+    int count = 0;
+    boundaries.create(H, W, CV_8UC1);
+    
+    // Each row is compared against the shifted rows and its shifted self;
+    // the loops are branch-free such that they are vectorized by the compiler.
+    // At the image border, the row itself is used as neighbor, which never differs.
+    for (int i = 0; i < H; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        const int* labels_above = labels.ptr<int>(std::max(0, i - 1));
+        const int* labels_below = labels.ptr<int>(std::min(H - 1, i + 1));
+        unsigned char* boundaries_i = boundaries.ptr<unsigned char>(i);
+        
+        for (int j = 0; j < W; ++j) {
+            boundaries_i[j] = (labels_i[j] != labels_above[j]) 
+                    | (labels_i[j] != labels_below[j]);
+        }
+        
+        for (int j = 0; j < W - 1; ++j) {
+            boundaries_i[j] |= (labels_i[j] != labels_i[j + 1]);
+        }
+        
+        for (int j = 1; j < W; ++j) {
+            boundaries_i[j] |= (labels_i[j] != labels_i[j - 1]);
+        }
+        
+        int count_i = 0;
+        for (int j = 0; j < W; ++j) {
+            count_i += boundaries_i[j];
+        }
+        
+        count += count_i;
+    }
+    
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// dilateBoundaryMap
+////////////////////////////////////////////////////////////////////////////////
+
+void Evaluation::dilateBoundaryMap(const cv::Mat &boundaries, int r, cv::Mat &dilated) {
+    
+    // The default border value of cv::dilate ignores pixels outside of the image,
+    // which corresponds to the clipped windows in hasBoundaryPixel.
+    cv::Mat element = cv::getStructuringElement(cv::MORPH_RECT, 
+            cv::Size(2*r + 1, 2*r + 1), cv::Point(r, r));
+    cv::dilate(boundaries, dilated, element);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hasBoundaryPixel
+////////////////////////////////////////////////////////////////////////////////
+
+bool Evaluation::hasBoundaryPixel(const cv::Mat &boundaries, int i, int j, int r) {
+    
+    int H = boundaries.rows;
+    int W = boundaries.cols;
+    
+    for (int k = std::max(0, i - r); k < std::min(H - 1, i + r) + 1; k++) {
+        const unsigned char* boundaries_k = boundaries.ptr<unsigned char>(k);
+        
+        for (int l = std::max(0, j - r); l < std::min(W - 1, j + r) + 1; l++) {
+            if (boundaries_k[l] > 0) {
+                return true;
+            }
+        }
+    }
+    
+    return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // is4ConnectedBoundaryPixel
 ////////////////////////////////////////////////////////////////////////////////
@@ -39,7 +39,67 @@
  */
 class Evaluation {
     friend class Visualization;
+    friend class FusedEvaluation;
+    friend class GroundTruthCache;
 public:
+    /** \brief Sparse intersection matrix between a superpixel segmentation and a
+     * ground truth segmentation: for each superpixel \f$S_j\f$ the list of
+     * pairs \f$(i, |G_i \cap S_j|)\f$ with non-empty intersection.
+     */
+    typedef std::vector< std::vector< std::pair<int, int> > > SparseIntersectionMatrix;
+    
+    /** \brief Sums and sums of squares of color and position of a superpixel,
+     * from which the color based metrics are computed.
+     */
+    struct ColorMoments {
+        /** \brief Number of pixels. */
+        int count;
+        /** \brief Sum of colors per channel. */
+        double color[3];
+        /** \brief Sum of squared colors per channel. */
+        double squared_color[3];
+        /** \brief Sum of row and column. */
+        double position[2];
+        /** \brief Sum of squared row and column. */
+        double squared_position[2];
+    };
+    
+    /** \brief Shape statistics of all superpixels, from which compactness,
+     * contour density and regularity are computed.
+     */
+    struct ShapeStatistics {
+        /** \brief Number of rows of the segmentation. */
+        int rows;
+        /** \brief Number of columns of the segmentation. */
+        int cols;
+        /** \brief Number of pixels for each label up to the maximum label. */
+        std::vector<int> areas;
+        /** \brief Perimeter for each label, i.e. the number of pixel sides on
+         * superpixel or image boundaries. */
+        std::vector<int> perimeters;
+        /** \brief Bounding box for each label, empty for unused labels. */
+        std::vector<cv::Rect> bounding_boxes;
+        /** \brief Number of 4-connected boundary pixels. */
+        int boundary_count;
+    };
+    
+    /** \brief Per-superpixel statistics gathered in a single pass over the
+     * pixels, e.g. by GPUEvaluation for a batch of segmentations, see
+     * FusedEvaluation::setPixelStatistics.
+     */
+    struct PixelStatistics {
+        /** \brief Color and position moments of each superpixel, see computeColorMoments;
+         * empty if not computed. */
+        std::vector<ColorMoments> moments;
+        /** \brief Intersection matrices with all ground truths, see computeSparseIntersectionMatrices;
+         * empty if not computed. */
+        std::vector<SparseIntersectionMatrix> intersections;
+        /** \brief Superpixel sizes. */
+        std::vector<int> superpixel_sizes;
+        /** \brief Ground truth segment sizes for all ground truths. */
+        std::vector< std::vector<int> > gt_sizes;
+    };
+    
     /** \brief Compute the Undersegmentation error as follows:
      * 
      *  \f$UE(G, S) = \frac{1}{N} = \sum_{S_j \in S} \min_{G_i} \{|G_i - S_j|\}\f$
@@ -74,13 +134,19 @@ public:
      * pixel in S is allowed to deviate by a euclidean distance of d times the
      * image diagonal.
      * 
+     * By default, the boundaries are dilated using a \f$(2r + 1) \times (2r + 1)\f$
+     * rectangle such that the runtime is independent of the tolerance; 
+     * alternatively the window around each boundary pixel is scanned. Both
+     * give identical results.
+     * 
      * \param[in] labels superpixel labels as int image
      * \param[in] gt ground truth segmentation as int image
      * \param[in] d fraction of the diagonal to use as tolerance
+     * \param[in] dilate whether to use dilated boundary maps instead of scanning windows
      * \return Rec(labels, gt)
      */
     static float computeBoundaryRecall(const cv::Mat &labels, 
-            const cv::Mat &gt, float d = 0.0025);
+            const cv::Mat &gt, float d = 0.0025, bool dilate = true);
     
     /** \brief Compute boundary precision:
      * 
@@ -93,13 +159,16 @@ public:
      * pixel in S is allowed to deviate by a euclidean distance of d times the
      * image diagonal.
      * 
+     * See computeBoundaryRecall for the dilate option.
+     * 
      * \param[in] labels superpixel labels as int image
      * \pram[in] gt ground truth segmentation as int image
      * \param[in] d fraction of the diagonal to use as tolerance
+     * \param[in] dilate whether to use dilated boundary maps instead of scanning windows
      * \return Pre(labels, gt)
      */
     static float computeBoundaryPrecision(const cv::Mat &labels, 
-            const cv::Mat &gt, float d = 0.0025);
+            const cv::Mat &gt, float d = 0.0025, bool dilate = true);
     
     /** \brief Compute the explained variation of the given segmentation.
      * \param[in] labels superpixel labels as int image
@@ -241,6 +310,21 @@ public:
     static float computeEdgeRecall(const cv::Mat &labels, const cv::Mat &edges,
             float d = 0.0025);    
     
+    /** \brief Compute the normalized gradient magnitude of the gray image; may
+     * be computed once per image and shared across superpixel segmentations.
+     * \param[in] image image, converted to gray if it has three channels
+     * \param[out] gradient_magnitude gradient magnitude in [0,1] as float image
+     */
+    static void computeGradientMagnitude(const cv::Mat &image, cv::Mat &gradient_magnitude);
+    
+    /** \brief Compute a Canny edge map of the gray image as used for edge recall;
+     * may be computed once per image and shared across superpixel segmentations.
+     * \param[in] image image, converted to gray if it has three channels
+     * \param[in] threshold lower hysteresis threshold, the upper one is twice as large
+     * \param[out] canny edge map as unsigned char image
+     */
+    static void computeCannyEdges(const cv::Mat &image, float threshold, cv::Mat &canny);
+    
     /** \brief Computes the average of a metric, i.e. computes the
      * integral of the metric in the given superpixel range using the trapezoidal
      * rule.
@@ -252,13 +336,6 @@ public:
     static float computeAverageMetric(const std::vector<float>& values, const std::vector<float>& superpixels,
         int min_superpixels = 200, int max_superpixels = 5200);
     
-private:
-    /** \brief Compute bounding boxes for all superpixels as cv::Rect.
-     * \param[in] labels superpixel labels as int image
-     * \param[out] rectangles vector of cv::Rect for each superpixel
-     */
-    static void computeBoundingBoxes(const cv::Mat &labels, std::vector<cv::Rect> &rectangles);
-    
     /** \brief Compute the intersection matrix for a superpixel and a groudn truth
      * segmentation. Element (i, j) contains the number of pixels in the
      * intersection of \f$G_i\f$ and \f$S_j\f$.
@@ -271,6 +348,213 @@ private:
     static void computeIntersectionMatrix(const cv::Mat &labels, const cv::Mat &gt,
             cv::Mat &intersection_matrix, std::vector<int> &superpixel_sizes, std::vector<int> &gt_sizes);
     
+    /** \brief Compute the sparse intersection matrix for a superpixel and a ground truth
+     * segmentation; memory and runtime scale with the number of non-empty
+     * intersections instead of the number of superpixels times the number of
+     * ground truth segments.
+     * \param[in] labels superpixel labels as int
+     * \param[in] gt ground truth segmentation as int
+     * \param[out] intersections non-empty intersections for each superpixel
+     * \param[out] superpixel_sizes size of each superpixel
+     * \param[out] gt_sizes sizes of each ground truth segment
+     */
+    static void computeSparseIntersectionMatrix(const cv::Mat &labels, const cv::Mat &gt,
+            SparseIntersectionMatrix &intersections, std::vector<int> &superpixel_sizes, 
+            std::vector<int> &gt_sizes);
+    
+private:
+    /** \brief Compute bounding boxes for all superpixels as cv::Rect.
+     * \param[in] labels superpixel labels as int image
+     * \param[out] rectangles vector of cv::Rect for each superpixel
+     */
+    static void computeBoundingBoxes(const cv::Mat &labels, std::vector<cv::Rect> &rectangles);
+    
+    /** \brief Compute the sparse intersection matrices for a superpixel segmentation
+     * and multiple ground truth segmentations in a single pass over the superpixel
+     * segmentation, see computeSparseIntersectionMatrix.
+     * \param[in] labels superpixel labels as int
+     * \param[in] gts ground truth segmentations as int
+     * \param[out] intersections non-empty intersections for each ground truth and superpixel
+     * \param[out] superpixel_sizes size of each superpixel
+     * \param[out] gt_sizes sizes of each ground truth segment for each ground truth
+     */
+    static void computeSparseIntersectionMatrices(const cv::Mat &labels, 
+            const std::vector<cv::Mat> &gts, std::vector<SparseIntersectionMatrix> &intersections, 
+            std::vector<int> &superpixel_sizes, std::vector< std::vector<int> > &gt_sizes);
+    
+    /** \brief Undersegmentation Error from a sparse intersection matrix.
+     * \param[in] intersections sparse intersection matrix
+     * \param[in] superpixel_sizes size of each superpixel
+     * \param[in] N number of pixels
+     * \return UE
+     */
+    static float computeUndersegmentationError(const SparseIntersectionMatrix &intersections,
+            const std::vector<int> &superpixel_sizes, int N);
+    
+    /** \brief Oversegmentation Error from a sparse intersection matrix.
+     * \param[in] intersections sparse intersection matrix
+     * \param[in] gt_sizes size of each ground truth segment
+     * \param[in] N number of pixels
+     * \return OE
+     */
+    static float computeOversegmentationError(const SparseIntersectionMatrix &intersections,
+            const std::vector<int> &gt_sizes, int N);
+    
+    /** \brief Undersegmentation Error (Neubert, Protzel) from a sparse intersection matrix.
+     * \param[in] intersections sparse intersection matrix
+     * \param[in] superpixel_sizes size of each superpixel
+     * \param[in] N number of pixels
+     * \return UE_NP
+     */
+    static float computeNPUndersegmentationError(const SparseIntersectionMatrix &intersections,
+            const std::vector<int> &superpixel_sizes, int N);
+    
+    /** \brief Undersegmentation Error (Levinshtein et al.) from a sparse intersection matrix.
+     * \param[in] intersections sparse intersection matrix
+     * \param[in] superpixel_sizes size of each superpixel
+     * \param[in] gt_sizes size of each ground truth segment
+     * \return UE_Levin
+     */
+    static float computeLevinUndersegmentationError(const SparseIntersectionMatrix &intersections,
+            const std::vector<int> &superpixel_sizes, const std::vector<int> &gt_sizes);
+    
+    /** \brief Achievable Segmentation Accuracy from a sparse intersection matrix.
+     * \param[in] intersections sparse intersection matrix
+     * \param[in] N number of pixels
+     * \return ASA
+     */
+    static float computeAchievableSegmentationAccuracy(const SparseIntersectionMatrix &intersections,
+            int N);
+    
+    /** \brief Compute the color and position moments of all superpixels in a
+     * single pass.
+     * \param[in] labels superpixel labels as int image
+     * \param[in] image image corresponding to the superpixel labels
+     * \param[out] moments moments for each label up to the maximum label
+     */
+    static void computeColorMoments(const cv::Mat &labels, const cv::Mat &image,
+            std::vector<ColorMoments> &moments);
+    
+    /** \brief Sum-of-Squared Error on RGB from color moments.
+     * \param[in] moments color moments of all superpixels
+     * \return sum-of-squared error on RGB
+     */
+    static float computeSumOfSquaredErrorRGB(const std::vector<ColorMoments> &moments);
+    
+    /** \brief Sum-of-Squared Error on XY from color moments.
+     * \param[in] moments color moments of all superpixels
+     * \return sum-of-squared error on XY
+     */
+    static float computeSumOfSquaredErrorXY(const std::vector<ColorMoments> &moments);
+    
+    /** \brief Explained Variation from color moments.
+     * \param[in] moments color moments of all superpixels
+     * \return explained variation
+     */
+    static float computeExplainedVariation(const std::vector<ColorMoments> &moments);
+    
+    /** \brief Intra-Cluster Variation from color moments.
+     * \param[in] moments color moments of all superpixels
+     * \return intra-cluster variation
+     */
+    static float computeIntraClusterVariation(const std::vector<ColorMoments> &moments);
+    
+    /** \brief Compute area, perimeter and bounding box of all superpixels and
+     * the 4-connected boundary map in a single pass.
+     * \param[in] labels superpixel labels as int image
+     * \param[out] statistics shape statistics
+     * \param[out] boundaries boundary map as unsigned char image, 1 on boundaries
+     */
+    static void computeShapeStatistics(const cv::Mat &labels, ShapeStatistics &statistics,
+            cv::Mat &boundaries);
+    
+    /** \brief Compactness from shape statistics.
+     * \param[in] statistics shape statistics of all superpixels
+     * \return compactness
+     */
+    static float computeCompactness(const ShapeStatistics &statistics);
+    
+    /** \brief Contour Density from shape statistics.
+     * \param[in] statistics shape statistics of all superpixels
+     * \return contour density
+     */
+    static float computeContourDensity(const ShapeStatistics &statistics);
+    
+    /** \brief Regularity from shape statistics.
+     * \param[in] statistics shape statistics of all superpixels
+     * \return regularity
+     */
+    static float computeRegularity(const ShapeStatistics &statistics);
+    
+    /** \brief Compute the 4-connected boundary map of the given labels.
+     * \param[in] labels labels as int image
+     * \param[out] boundaries boundary map as unsigned char image, 1 on boundaries
+     * \return number of boundary pixels
+     */
+    static int computeBoundaryMap(const cv::Mat &labels, cv::Mat &boundaries);
+    
+    /** \brief Dilate a boundary map using a (2r + 1) x (2r + 1) rectangle, i.e.
+     * a pixel is set if the corresponding window contains a boundary pixel;
+     * pixels outside of the image are ignored.
+     * \param[in] boundaries boundary map as unsigned char image
+     * \param[in] r radius of the window
+     * \param[out] dilated dilated boundary map
+     */
+    static void dilateBoundaryMap(const cv::Mat &boundaries, int r, cv::Mat &dilated);
+    
+    /** \brief Compute boundary recall on the given boundary maps.
+     * \param[in] boundaries superpixel boundary map
+     * \param[in] gt_boundaries ground truth boundary map
+     * \param[in] r radius of the tolerance window
+     * \param[in] dilate whether to use dilated boundary maps instead of scanning windows
+     * \return boundary recall
+     */
+    static float computeBoundaryRecall(const cv::Mat &boundaries, 
+            const cv::Mat &gt_boundaries, int r, bool dilate);
+    
+    /** \brief Compute boundary precision on the given boundary maps.
+     * \param[in] boundaries superpixel boundary map
+     * \param[in] gt_boundaries ground truth boundary map
+     * \param[in] r radius of the tolerance window
+     * \param[in] dilate whether to use dilated boundary maps instead of scanning windows
+     * \return boundary precision
+     */
+    static float computeBoundaryPrecision(const cv::Mat &boundaries, 
+            const cv::Mat &gt_boundaries, int r, bool dilate);
+    
+    /** \brief Compute edge recall on the given boundary map.
+     * \param[in] boundaries superpixel boundary map
+     * \param[in] edges edge map as unsigned char image
+     * \param[in] r radius of the tolerance window
+     * \param[in] dilate whether to use the dilated boundary map instead of scanning windows
+     * \return edge recall
+     */
+    static float computeEdgeRecall(const cv::Mat &boundaries, const cv::Mat &edges,
+            int r, bool dilate);
+    
+    /** \brief Compute Mean Distance to Edge on the given boundary maps.
+     * \param[in] boundaries superpixel boundary map
+     * \param[in] gt_boundaries ground truth boundary map
+     * \return MDE
+     */
+    static float computeMeanDistanceToEdgeOnBoundaryMaps(const cv::Mat &boundaries,
+            const cv::Mat &gt_boundaries);
+    
+    /** \brief Compute Contour Density on the given boundary map.
+     * \param[in] boundaries superpixel boundary map
+     * \return CD
+     */
+    static float computeContourDensityOnBoundaryMap(const cv::Mat &boundaries);
+    
+    /** \brief Check whether a boundary pixel is found within the given window.
+     * \param[in] boundaries boundary map
+     * \param[in] i i coordinate
+     * \param[in] j j coordinate
+     * \param[in] r radius of the window
+     * \return whether a boundary pixel was found
+     */
+    static bool hasBoundaryPixel(const cv::Mat &boundaries, int i, int j, int r);
+    
     /** \brief Is a boundary pixel in the 4-connected sense.
      * \param[in] labels superpixel labels as int image
      * \param[in] i i coordinate
@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdlib>
+#include <stdint.h>
+#include <glog/logging.h>
+#include "evaluation_arena.h"
+
+/** \brief Minimum size of a block in bytes. */
+const size_t EVALUATION_ARENA_MIN_BLOCK = 1 << 16;
+/** \brief Page size assumed when touching new blocks. */
+const size_t EVALUATION_ARENA_PAGE = 4096;
+
+////////////////////////////////////////////////////////////////////////////////
+// Scope
+////////////////////////////////////////////////////////////////////////////////
+
+EvaluationArena::Scope::Scope(EvaluationArena &arena) 
+        : arena(arena), block(arena.block), offset(arena.offset) {
+    
+    arena.scopes++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ~Scope
+////////////////////////////////////////////////////////////////////////////////
+
+EvaluationArena::Scope::~Scope() {
+    arena.scopes--;
+    arena.block = block;
+    arena.offset = offset;
+    
+    // Merge blocks once the outermost scope ends such that the next image
+    // fits into a single block.
+    if (arena.scopes == 0) {
+        arena.reset();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EvaluationArena
+////////////////////////////////////////////////////////////////////////////////
+
+EvaluationArena::EvaluationArena(size_t capacity) 
+        : block(0), offset(0), scopes(0), heap_allocations(0) {
+    
+    if (capacity > 0) {
+        addBlock(capacity);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ~EvaluationArena
+////////////////////////////////////////////////////////////////////////////////
+
+EvaluationArena::~EvaluationArena() {
+    for (unsigned int b = 0; b < blocks.size(); ++b) {
+        std::free(blocks[b]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// allocate
+////////////////////////////////////////////////////////////////////////////////
+
+void* EvaluationArena::allocate(size_t bytes, size_t alignment) {
+    while (true) {
+        if (block < blocks.size()) {
+            uintptr_t address = reinterpret_cast<uintptr_t>(blocks[block]) + offset;
+            size_t padding = (alignment - address % alignment) % alignment;
+            
+            if (offset + padding + bytes <= sizes[block]) {
+                offset += padding + bytes;
+                return reinterpret_cast<void*>(address + padding);
+            }
+            
+            // Blocks after the current one are left from earlier scopes.
+            if (block + 1 < blocks.size()) {
+                block++;
+                offset = 0;
+                continue;
+            }
+        }
+        
+        size_t last = sizes.empty() ? 0 : sizes.back();
+        addBlock(std::max(2*last, bytes + alignment));
+        block = blocks.size() - 1;
+        offset = 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// allocateMat
+////////////////////////////////////////////////////////////////////////////////
+
+cv::Mat EvaluationArena::allocateMat(int rows, int cols, int type) {
+    size_t bytes = (size_t) rows*cols*CV_ELEM_SIZE(type);
+    return cv::Mat(rows, cols, type, allocate(bytes));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// reset
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationArena::reset() {
+    LOG_IF(FATAL, scopes > 0) << "Cannot reset an arena within a scope.";
+    
+    if (blocks.size() > 1) {
+        size_t capacity = getCapacity();
+        
+        for (unsigned int b = 0; b < blocks.size(); ++b) {
+            std::free(blocks[b]);
+        }
+        
+        blocks.clear();
+        sizes.clear();
+        addBlock(capacity);
+    }
+    
+    block = 0;
+    offset = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCapacity
+////////////////////////////////////////////////////////////////////////////////
+
+size_t EvaluationArena::getCapacity() const {
+    size_t capacity = 0;
+    for (unsigned int b = 0; b < sizes.size(); ++b) {
+        capacity += sizes[b];
+    }
+    
+    return capacity;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getHeapAllocations
+////////////////////////////////////////////////////////////////////////////////
+
+int EvaluationArena::getHeapAllocations() const {
+    return heap_allocations;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getThreadLocal
+////////////////////////////////////////////////////////////////////////////////
+
+EvaluationArena& EvaluationArena::getThreadLocal() {
+    static thread_local EvaluationArena arena;
+    return arena;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// addBlock
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationArena::addBlock(size_t bytes) {
+    bytes = std::max(bytes, EVALUATION_ARENA_MIN_BLOCK);
+    
+    char* memory = static_cast<char*>(std::malloc(bytes));
+    LOG_IF(FATAL, memory == NULL) << "Could not allocate " << bytes << " bytes.";
+    
+    // Touch every page such that the block is placed on the NUMA node of the
+    // thread owning the arena now, and the page faults are not attributed
+    // to the first kernel using the block.
+    for (size_t i = 0; i < bytes; i += EVALUATION_ARENA_PAGE) {
+        memory[i] = 0;
+    }
+    
+    blocks.push_back(memory);
+    sizes.push_back(bytes);
+    heap_allocations++;
+}
@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVALUATION_ARENA_H
+#define	EVALUATION_ARENA_H
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <opencv2/opencv.hpp>
+
+/** \brief Monotonic scratch memory for the temporaries of evaluation kernels.
+ * 
+ * Allocations bump a pointer in the current block and are released all at
+ * once when the enclosing Scope ends (or on reset). If a block runs out, a 
+ * larger one is added; once all scopes are closed, the blocks are merged into
+ * a single block of the combined size. After the first image, evaluation
+ * therefore does not allocate scratch memory from the heap. Only trivially
+ * destructible types can be allocated, as no destructors are run.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   EvaluationArena &arena = EvaluationArena::getThreadLocal();
+ *   EvaluationArena::Scope scope(arena);
+ *   
+ *   int* counts = arena.allocate<int>(superpixels, 0);
+ *   cv::Mat mask = arena.allocateMat(labels.rows, labels.cols, CV_8UC1);
+ * \endcode
+ * \author David Stutz
+ */
+class EvaluationArena {
+public:
+    
+    /** \brief Releases all allocations made during its lifetime. */
+    class Scope {
+    public:
+        
+        /** \brief Constructor.
+         * \param[in] arena arena to release allocations of
+         */
+        Scope(EvaluationArena &arena);
+        
+        /** \brief Destructor, releases the allocations. */
+        ~Scope();
+        
+    private:
+        
+        /** \brief Arena. */
+        EvaluationArena &arena;
+        /** \brief Block at construction. */
+        unsigned int block;
+        /** \brief Offset in the block at construction. */
+        size_t offset;
+    };
+    
+    /** \brief Constructor.
+     * \param[in] capacity initial capacity in bytes
+     */
+    EvaluationArena(size_t capacity = 0);
+    
+    /** \brief Destructor. */
+    ~EvaluationArena();
+    
+    /** \brief Allocate uninitialized memory.
+     * \param[in] bytes number of bytes
+     * \param[in] alignment alignment, a power of two
+     * \return memory, valid until the enclosing scope ends
+     */
+    void* allocate(size_t bytes, size_t alignment = 64);
+    
+    /** \brief Allocate an uninitialized array.
+     * \param[in] n number of elements
+     * \return array, valid until the enclosing scope ends
+     */
+    template<typename T>
+    T* allocate(size_t n);
+    
+    /** \brief Allocate an array initialized to the given value.
+     * \param[in] n number of elements
+     * \param[in] value initial value
+     * \return array, valid until the enclosing scope ends
+     */
+    template<typename T>
+    T* allocate(size_t n, const T &value);
+    
+    /** \brief Allocate an uninitialized, continuous matrix.
+     * \param[in] rows number of rows
+     * \param[in] cols number of columns
+     * \param[in] type OpenCV type
+     * \return matrix referencing the arena, valid until the enclosing scope ends
+     */
+    cv::Mat allocateMat(int rows, int cols, int type);
+    
+    /** \brief Release all allocations and merge the blocks; must not be called
+     * within a scope.
+     */
+    void reset();
+    
+    /** \brief Get the capacity of all blocks.
+     * \return capacity in bytes
+     */
+    size_t getCapacity() const;
+    
+    /** \brief Get the number of blocks allocated from the heap so far.
+     * \return number of heap allocations
+     */
+    int getHeapAllocations() const;
+    
+    /** \brief Get the arena of the calling thread.
+     * \return arena
+     */
+    static EvaluationArena& getThreadLocal();
+    
+private:
+    
+    /** \brief Add a block of at least the given size.
+     * \param[in] bytes minimum size in bytes
+     */
+    void addBlock(size_t bytes);
+    
+    /** \brief Blocks. */
+    std::vector<char*> blocks;
+    /** \brief Size of each block. */
+    std::vector<size_t> sizes;
+    /** \brief Block allocations are taken from. */
+    unsigned int block;
+    /** \brief Offset in the current block. */
+    size_t offset;
+    /** \brief Number of open scopes. */
+    int scopes;
+    /** \brief Number of blocks allocated from the heap. */
+    int heap_allocations;
+    
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// allocate
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+T* EvaluationArena::allocate(size_t n) {
+    static_assert(std::is_trivially_destructible<T>::value, 
+            "Only trivially destructible types can be allocated from an arena.");
+    
+    return static_cast<T*>(allocate(n*sizeof(T), std::max<size_t>(alignof(T), 64)));
+}
+
+template<typename T>
+T* EvaluationArena::allocate(size_t n, const T &value) {
+    T* array = allocate<T>(n);
+    std::fill(array, array + n, value);
+    
+    return array;
+}
+
+#endif	/* EVALUATION_ARENA_H */
@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <cstdio>
+#include "evaluation_memo.h"
+
+/** \brief Multiplier used for hashing, the 64-bit FNV prime. */
+static const uint64_t MEMO_PRIME = 1099511628211ULL;
+/** \brief Initial hash, the 64-bit FNV offset basis. */
+static const uint64_t MEMO_OFFSET = 14695981039346656037ULL;
+
+/** \brief Update a hash with the given bytes; eight bytes are consumed at
+ * once, which is considerably faster than byte-wise FNV-1a on label buffers.
+ * \param[in] hash current hash
+ * \param[in] data data to hash
+ * \param[in] size number of bytes
+ * \return updated hash
+ */
+static uint64_t updateHash(uint64_t hash, const unsigned char* data, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        
+        hash = (hash ^ word)*MEMO_PRIME;
+        hash ^= hash >> 32;
+    }
+    
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i])*MEMO_PRIME;
+    }
+    
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EvaluationMemo
+////////////////////////////////////////////////////////////////////////////////
+
+EvaluationMemo::EvaluationMemo() : hits(0), misses(0) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hashMat
+////////////////////////////////////////////////////////////////////////////////
+
+std::string EvaluationMemo::hashMat(const cv::Mat &mat) {
+    
+    int header[3] = {mat.rows, mat.cols, mat.type()};
+    uint64_t hash = updateHash(MEMO_OFFSET, (const unsigned char*) header, sizeof(header));
+    
+    size_t row_size = mat.cols*mat.elemSize();
+    for (int i = 0; i < mat.rows; ++i) {
+        hash = updateHash(hash, mat.ptr<unsigned char>(i), row_size);
+    }
+    
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long) hash);
+    return std::string(buffer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// read
+////////////////////////////////////////////////////////////////////////////////
+
+bool EvaluationMemo::read(const std::string &key, cv::Mat &data, std::string &csv) {
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    std::map<std::string, Entry>::const_iterator it = entries.find(key);
+    if (it == entries.end()) {
+        ++misses;
+        return false;
+    }
+    
+    data = it->second.data.clone();
+    csv = it->second.csv;
+    ++hits;
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// write
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationMemo::write(const std::string &key, const cv::Mat &data, 
+        const std::string &csv) {
+    
+    Entry entry;
+    entry.data = data.clone();
+    entry.csv = csv;
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[key] = entry;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getHits
+////////////////////////////////////////////////////////////////////////////////
+
+int EvaluationMemo::getHits() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getMisses
+////////////////////////////////////////////////////////////////////////////////
+
+int EvaluationMemo::getMisses() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVALUATION_MEMO_H
+#define	EVALUATION_MEMO_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+
+/** \brief In-memory memoization of per-ground truth evaluation results.
+ * 
+ * Identical superpixel segmentations recur frequently, e.g. when parameters
+ * saturate during parameter optimization. Entries are keyed by the contents
+ * of the superpixel segmentation, the image, the ground truth segmentation
+ * and the metrics used, such that the metric computation can be skipped
+ * for duplicates. A memo may be shared by several EvaluationSummary instances
+ * and threads.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   EvaluationMemo memo;
+ *   EvaluationSummary summary(sp_directory, gt_directory, img_directory);
+ *   summary.setEvaluationMemo(&memo);
+ *   summary.computeSummary(gt_max);
+ * \endcode
+ * \author David Stutz
+ */
+class EvaluationMemo {
+public:
+    
+    /** \brief Constructor. */
+    EvaluationMemo();
+    
+    /** \brief Hash the size, type and contents of a matrix.
+     * \param[in] mat matrix to hash
+     * \return hash as hexadecimal string
+     */
+    static std::string hashMat(const cv::Mat &mat);
+    
+    /** \brief Read an entry.
+     * \param[in] key key of the entry
+     * \param[out] data cached row of metrics
+     * \param[out] csv cached metrics as CSV, without file names
+     * \return whether the entry was found
+     */
+    bool read(const std::string &key, cv::Mat &data, std::string &csv);
+    
+    /** \brief Write an entry, replacing existing entries.
+     * \param[in] key key of the entry
+     * \param[in] data row of metrics
+     * \param[in] csv metrics as CSV, without file names
+     */
+    void write(const std::string &key, const cv::Mat &data, const std::string &csv);
+    
+    /** \brief Get the number of successful reads.
+     * \return number of hits
+     */
+    int getHits();
+    
+    /** \brief Get the number of failed reads.
+     * \return number of misses
+     */
+    int getMisses();
+    
+private:
+    
+    /** \brief A memoized result. */
+    struct Entry {
+        /** \brief Row of metrics. */
+        cv::Mat data;
+        /** \brief Metrics as CSV. */
+        std::string csv;
+    };
+    
+    /** \brief Entries by key. */
+    std::map<std::string, Entry> entries;
+    /** \brief Number of hits. */
+    int hits;
+    /** \brief Number of misses. */
+    int misses;
+    /** \brief Mutex protecting entries and counters. */
+    std::mutex mutex;
+    
+};
+
+#endif	/* EVALUATION_MEMO_H */
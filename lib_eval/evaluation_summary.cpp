@@ -32,24 +32,79 @@
 #include <sstream>
 #include <fstream>
 #include <limits>
+#include <set>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <glog/logging.h>
 #include "visualization.h"
 #include "evaluation.h"
+#include "fused_evaluation.h"
+#include "gpu_evaluation.h"
+#include "evaluation_memo.h"
+#include "result_cache.h"
 #include "io_util.h"
+#include "thread_pool.h"
+#include "memory_profile.h"
 #include "evaluation_summary.h"
 
+////////////////////////////////////////////////////////////////////////////////
+// TimingScope
+////////////////////////////////////////////////////////////////////////////////
+
+class EvaluationSummary::TimingScope {
+public:
+    
+    /** \brief Constructor; does not read the clock if timings are disabled.
+     * \param[in] summary summary to add the timing to
+     * \param[in] name name of the metric or stage
+     */
+    TimingScope(EvaluationSummary* summary, const char* name) 
+            : summary(summary->timings ? summary : NULL), name(name) {
+        if (this->summary != NULL) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+    
+    /** \brief Destructor, adds the elapsed wall time. */
+    ~TimingScope() {
+        if (summary != NULL) {
+            double seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+            
+            std::lock_guard<std::mutex> lock(summary->timing_mutex);
+            summary->timing_seconds[name] += seconds;
+            summary->timing_counts[name]++;
+        }
+    }
+    
+private:
+    
+    /** \brief Summary, NULL if timings are disabled. */
+    EvaluationSummary* summary;
+    /** \brief Name of the metric or stage. */
+    const char* name;
+    /** \brief Start of the scope. */
+    std::chrono::steady_clock::time_point start;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
 ////////////////////////////////////////////////////////////////////////////////
 
 EvaluationSummary::EvaluationSummary(boost::filesystem::path sp_directory, 
         boost::filesystem::path gt_directory, boost::filesystem::path img_directory)
-        : compute_correlation(false), sp_directory(sp_directory), gt_directory(gt_directory), 
-        img_directory(img_directory) {
+        : compute_correlation(false), threads(1), online_statistics(false), gpu_evaluation(false), timings(false), evaluation_memo(NULL), ground_truth_cache(NULL), shard(0), shards(1), sp_directory(sp_directory), 
+        gt_directory(gt_directory), img_directory(img_directory) {
     
     results_file = sp_directory / boost::filesystem::path("results.csv");
     correlation_file = sp_directory / boost::filesystem::path("correlation.csv");
     summary_file = sp_directory / boost::filesystem::path("summary.csv");
+    timing_file = sp_directory / boost::filesystem::path("timing.csv");
     vis_directory = sp_directory / boost::filesystem::path("vis/");
     
     if (!boost::filesystem::is_directory(vis_directory) && !vis_directory.empty()
@@ -62,12 +117,13 @@ EvaluationSummary::EvaluationSummary(boost::filesystem::path sp_directory,
         boost::filesystem::path gt_directory, boost::filesystem::path img_directory,
         EvaluationMetrics evaluation_metrics, EvaluationStatistics evaluation_statistics)
         : evaluation_metrics(evaluation_metrics), evaluation_statistics(evaluation_statistics), 
-        compute_correlation(false), sp_directory(sp_directory), gt_directory(gt_directory), 
-        img_directory(img_directory) {
+        compute_correlation(false), threads(1), online_statistics(false), gpu_evaluation(false), timings(false), evaluation_memo(NULL), ground_truth_cache(NULL), shard(0), shards(1), sp_directory(sp_directory), 
+        gt_directory(gt_directory), img_directory(img_directory) {
     
     results_file = sp_directory / boost::filesystem::path("results.csv");
     correlation_file = sp_directory / boost::filesystem::path("correlation.csv");
     summary_file = sp_directory / boost::filesystem::path("summary.csv");
+    timing_file = sp_directory / boost::filesystem::path("timing.csv");
     vis_directory = sp_directory / boost::filesystem::path("vis/");
     
     if (!boost::filesystem::is_directory(vis_directory) && !vis_directory.empty()
@@ -82,11 +138,12 @@ EvaluationSummary::EvaluationSummary(boost::filesystem::path sp_directory,
         SuperpixelVisualizations superpixel_visualizations)
         : evaluation_metrics(evaluation_metrics), evaluation_statistics(evaluation_statistics),
         superpixel_visualizations(superpixel_visualizations), compute_correlation(false),
-        sp_directory(sp_directory), gt_directory(gt_directory), img_directory(img_directory){
+        threads(1), online_statistics(false), gpu_evaluation(false), timings(false), evaluation_memo(NULL), ground_truth_cache(NULL), shard(0), shards(1), sp_directory(sp_directory), gt_directory(gt_directory), img_directory(img_directory){
     
     results_file = sp_directory / boost::filesystem::path("results.csv");
     correlation_file = sp_directory / boost::filesystem::path("correlation.csv");
     summary_file = sp_directory / boost::filesystem::path("summary.csv");
+    timing_file = sp_directory / boost::filesystem::path("timing.csv");
     vis_directory = sp_directory / boost::filesystem::path("vis/");
     
     if (!boost::filesystem::is_directory(vis_directory) && !vis_directory.empty()
@@ -138,6 +195,9 @@ int EvaluationSummary::countMetrics() {
     if (evaluation_metrics.mde) {
         ++count;
     }
+    if (evaluation_metrics.er) {
+        ++count;
+    }
     if (evaluation_metrics.icv) {
         ++count;
     }
@@ -154,10 +214,35 @@ int EvaluationSummary::countMetrics() {
         ++count; // average
         ++count; // variance
     }
+    if (!peak_memory.empty()) {
+        ++count;
+    }
     
     return count;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// requiresImage
+////////////////////////////////////////////////////////////////////////////////
+
+bool EvaluationSummary::requiresImage() {
+    return evaluation_metrics.sse_rgb || evaluation_metrics.sse_xy 
+            || evaluation_metrics.ev || evaluation_metrics.icv
+            || evaluation_metrics.er || superpixel_visualizations.any();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// requiresGroundTruth
+////////////////////////////////////////////////////////////////////////////////
+
+bool EvaluationSummary::requiresGroundTruth() {
+    return evaluation_metrics.ue || evaluation_metrics.oe 
+            || evaluation_metrics.rec || evaluation_metrics.pre 
+            || evaluation_metrics.ue_np || evaluation_metrics.ue_levin
+            || evaluation_metrics.asa || evaluation_metrics.mde
+            || superpixel_visualizations.any();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // evaluateHeader
 ////////////////////////////////////////////////////////////////////////////////
@@ -215,6 +300,10 @@ void EvaluationSummary::evaluateHeader(std::stringstream &output,
         output << "," << "mde";
         metric_order.push_back("mde");
     }
+    if (evaluation_metrics.er) {
+        output << "," << "er";
+        metric_order.push_back("er");
+    }
     if (evaluation_metrics.icv) {
         output << "," << "icv";
         metric_order.push_back("icv");
@@ -236,6 +325,10 @@ void EvaluationSummary::evaluateHeader(std::stringstream &output,
         metric_order.push_back("sp_size");
         metric_order.push_back("sp_size_variation");
     }
+    if (!peak_memory.empty()) {
+        output << "," << "peak_memory";
+        metric_order.push_back("peak_memory");
+    }
     
     output << "\n";
 }
@@ -247,14 +340,30 @@ void EvaluationSummary::evaluateHeader(std::stringstream &output,
 void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &gt_segmentation, 
         const cv::Mat &image, cv::Mat &data, std::stringstream &output) {
     
+    FusedEvaluation fused(sp_segmentation, image);
+    evaluate(fused, gt_segmentation, data, output);
+}
+
+void EvaluationSummary::evaluate(FusedEvaluation &fused, const cv::Mat &gt_segmentation, 
+        cv::Mat &data, std::stringstream &output) {
+    
+    fused.setGroundTruth(gt_segmentation);
+    evaluate(fused, data, output);
+}
+
+void EvaluationSummary::evaluate(FusedEvaluation &fused, cv::Mat &data, 
+        std::stringstream &output, float memory) {
+    
     int i = 0;
     cv::Mat row(1, countMetrics(), CV_32FC1, cv::Scalar(0));
     
     std::string separator = "";
     if (evaluation_metrics.ue) {
 //        LOG(INFO) << "... Computing Undersegmentation Error.";
-        row.at<float>(0, i) = Evaluation::computeUndersegmentationError(sp_segmentation, 
-                gt_segmentation);
+        {
+            TimingScope timing(this, "ue");
+            row.at<float>(0, i) = fused.computeUndersegmentationError();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -262,8 +371,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.oe) {
 //        LOG(INFO) << "... Computing Oversegmentation Error.";
-        row.at<float>(0, i) = Evaluation::computeOversegmentationError(sp_segmentation, 
-                gt_segmentation);
+        {
+            TimingScope timing(this, "oe");
+            row.at<float>(0, i) = fused.computeOversegmentationError();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -271,8 +382,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.rec) {
 //        LOG(INFO) << "... Computing Boundary Recall.";
-        row.at<float>(0, i) = Evaluation::computeBoundaryRecall(sp_segmentation, 
-                gt_segmentation);
+        {
+            TimingScope timing(this, "rec");
+            row.at<float>(0, i) = fused.computeBoundaryRecall();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -280,8 +393,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.pre) {
 //        LOG(INFO) << "... Computing Boundary Precision.";
-        row.at<float>(0, i) = Evaluation::computeBoundaryPrecision(sp_segmentation, 
-                gt_segmentation);
+        {
+            TimingScope timing(this, "pre");
+            row.at<float>(0, i) = fused.computeBoundaryPrecision();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -289,8 +404,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.ue_np) {
 //        LOG(INFO) << "... Computing NP Undersegmentation Error.";
-        row.at<float>(0, i) = Evaluation::computeNPUndersegmentationError(sp_segmentation, 
-                gt_segmentation);
+        {
+            TimingScope timing(this, "ue_np");
+            row.at<float>(0, i) = fused.computeNPUndersegmentationError();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -298,8 +415,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.ue_levin) {
 //        LOG(INFO) << "... Computing Levin Undersegmentation Error.";
-        row.at<float>(0, i) = Evaluation::computeLevinUndersegmentationError(sp_segmentation, 
-                gt_segmentation);
+        {
+            TimingScope timing(this, "ue_levin");
+            row.at<float>(0, i) = fused.computeLevinUndersegmentationError();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -307,8 +426,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.asa) {
 //        LOG(INFO) << "... Computing Achievable Segmentation Accuracy.";
-        row.at<float>(0, i) = Evaluation::computeAchievableSegmentationAccuracy(sp_segmentation, 
-                gt_segmentation);
+        {
+            TimingScope timing(this, "asa");
+            row.at<float>(0, i) = fused.computeAchievableSegmentationAccuracy();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -316,8 +437,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.sse_rgb) {
 //        LOG(INFO) << "... Computing Sum-Of-Squared Error RGB.";
-        row.at<float>(0, i) = Evaluation::computeSumOfSquaredErrorRGB(sp_segmentation, 
-                image);
+        {
+            TimingScope timing(this, "sse_rgb");
+            row.at<float>(0, i) = fused.computeSumOfSquaredErrorRGB();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -325,8 +448,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.sse_xy) {
 //        LOG(INFO) << "... Computing Sum-Of-Squared Error XY.";
-        row.at<float>(0, i) = Evaluation::computeSumOfSquaredErrorXY(sp_segmentation,
-                image);
+        {
+            TimingScope timing(this, "sse_xy");
+            row.at<float>(0, i) = fused.computeSumOfSquaredErrorXY();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -334,7 +459,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.co) {
 //        LOG(INFO) << "... Computing Compactness.";
-        row.at<float>(0, i) = Evaluation::computeCompactness(sp_segmentation);
+        {
+            TimingScope timing(this, "co");
+            row.at<float>(0, i) = fused.computeCompactness();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -342,8 +470,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.ev) {
 //        LOG(INFO) << "... Computing Explained Variation.";
-        row.at<float>(0, i) = Evaluation::computeExplainedVariation(sp_segmentation, 
-                image);
+        {
+            TimingScope timing(this, "ev");
+            row.at<float>(0, i) = fused.computeExplainedVariation();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -351,8 +481,21 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.mde) {
 //        LOG(INFO) << "... Computing Mean Distance To Edge.";
-        row.at<float>(0, i) = Evaluation::computeMeanDistanceToEdge(sp_segmentation, 
-                gt_segmentation);
+        {
+            TimingScope timing(this, "mde");
+            row.at<float>(0, i) = fused.computeMeanDistanceToEdge();
+        }
+        
+        output << separator << row.at<float>(0, i);
+        separator = ",";
+        ++i;
+    }
+    if (evaluation_metrics.er) {
+//        LOG(INFO) << "... Computing Edge Recall.";
+        {
+            TimingScope timing(this, "er");
+            row.at<float>(0, i) = fused.computeEdgeRecall();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -360,8 +503,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.icv) {
 //        LOG(INFO) << "... Computing Intra Cluster Variation.";
-        row.at<float>(0, i) = Evaluation::computeIntraClusterVariation(sp_segmentation, 
-                image);
+        {
+            TimingScope timing(this, "icv");
+            row.at<float>(0, i) = fused.computeIntraClusterVariation();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -369,7 +514,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.cd) {
 //        LOG(INFO) << "... Computing Contour Density.";
-        row.at<float>(0, i) = Evaluation::computeContourDensity(sp_segmentation);
+        {
+            TimingScope timing(this, "cd");
+            row.at<float>(0, i) = fused.computeContourDensity();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -377,7 +525,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.reg) {
 //        LOG(INFO) << "... Computing Regularity.";
-        row.at<float>(0, i) = Evaluation::computeRegularity(sp_segmentation);
+        {
+            TimingScope timing(this, "reg");
+            row.at<float>(0, i) = fused.computeRegularity();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -385,7 +536,10 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.sp) {
 //        LOG(INFO) << "... Computing Superpixels.";
-        row.at<float>(0, i) = Evaluation::computeSuperpixels(sp_segmentation);
+        {
+            TimingScope timing(this, "sp");
+            row.at<float>(0, i) = fused.computeSuperpixels();
+        }
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -398,8 +552,11 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
         int min_size;
         int max_size;
         float size_variation;
-        Evaluation::computeSuperpixelSizes(sp_segmentation, 
-                average_size, min_size, max_size, size_variation);
+        {
+            TimingScope timing(this, "sp_size");
+            fused.computeSuperpixelSizes(average_size, min_size, 
+                    max_size, size_variation);
+        }
         
         row.at<float>(0, i) = average_size;
         output << separator << row.at<float>(0, i);
@@ -411,6 +568,13 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
         
         separator = ",";
     }
+    if (!peak_memory.empty()) {
+        row.at<float>(0, i) = memory;
+        
+        output << separator << row.at<float>(0, i);
+        separator = ",";
+        ++i;
+    }
     
     output << "\n";
 //    if (data.empty()) {
@@ -426,29 +590,31 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
 // visualize
 ////////////////////////////////////////////////////////////////////////////////
 
-void EvaluationSummary::visualize(const cv::Mat &sp_segmentation, const cv::Mat &gt_segmentation,
-        const cv::Mat &image, std::string name, int t) {
+void EvaluationSummary::visualize(const Visualization::Context &context, 
+        const cv::Mat &gt_segmentation, std::string name, int t) {
+    
+    TimingScope timing(this, "visualization");
     
     if (t == 0) {
         if (superpixel_visualizations.contour) {
             cv::Mat contours;
-            Visualization::drawContours(image, sp_segmentation, contours);
+            Visualization::drawContours(context, contours);
             cv::imwrite(vis_directory.string() + name + "_contour.png", contours);
         }
         if (superpixel_visualizations.mean) {
             cv::Mat means;
-            Visualization::drawMeans(image, sp_segmentation, means);
+            Visualization::drawMeans(context, means);
             cv::imwrite(vis_directory.string() + name + "_mean.png", means);
         }
         if (superpixel_visualizations.random) {
             cv::Mat random;
-            Visualization::drawRandom(sp_segmentation, random);
+            Visualization::drawRandom(context, random);
 
             cv::imwrite(vis_directory.string() + name + "_random.png", random);
         }
         if (superpixel_visualizations.perturbed_mean) {
             cv::Mat perturbed_mean;
-            Visualization::drawPerturbedMeans(image, sp_segmentation, perturbed_mean);
+            Visualization::drawPerturbedMeans(context, perturbed_mean);
 
             cv::imwrite(vis_directory.string() + name + "_perturbed_means.png", perturbed_mean);
         }
@@ -456,16 +622,14 @@ void EvaluationSummary::visualize(const cv::Mat &sp_segmentation, const cv::Mat
     
     if (superpixel_visualizations.pre_rec) {
         cv::Mat pre_rec;
-            Visualization::drawContours(image, sp_segmentation, pre_rec);
-        Visualization::drawPrecisionRecall(pre_rec, sp_segmentation, 
-                gt_segmentation, pre_rec);
+        Visualization::drawContours(context, pre_rec);
+        Visualization::overlayPrecisionRecall(context, gt_segmentation, pre_rec);
         cv::imwrite(vis_directory.string() + name + "-" + std::to_string(t) + "_pre_rec.png", pre_rec);
     }
     if (superpixel_visualizations.ue) {
-        cv::Mat ue;
-        Visualization::drawUndersegmentationError(image, sp_segmentation, 
-                gt_segmentation, ue);
-        Visualization::drawContours(ue, sp_segmentation, ue);
+        cv::Mat ue = context.image.clone();
+        Visualization::overlayUndersegmentationError(context, gt_segmentation, ue);
+        Visualization::overlayContours(context, ue);
         
         cv::imwrite(vis_directory.string() + name + "-" + std::to_string(t) + "_ue.png", ue);
     }
@@ -481,52 +645,51 @@ void EvaluationSummary::correlate(const cv::Mat &mat_results, const std::vector<
     LOG_IF(FATAL, mat_results.cols != (int) metric_order.size()) 
             << "Invalid metric order:" << mat_results.cols << " != " << metric_order.size();
     
-    std::vector<float> sums(mat_results.cols, 0);
-    std::vector< std::vector<float> > squared_sums(mat_results.cols);
-    for (int j = 0; j < mat_results.cols; j++) {
-        squared_sums[j].resize(mat_results.cols, 0);
-    }
+    LOG_IF(FATAL, mat_results.rows == 0) << "No results to correlate.";
     
-    for (int i = 0; i < mat_results.rows; i++) {
-        for (int j = 0; j < mat_results.cols; j++) {
-            sums[j] += mat_results.at<float>(i, j);
-            
-            for (int jj = 0; jj < mat_results.cols; jj++) {
-                squared_sums[j][jj] += mat_results.at<float>(i, j)*mat_results.at<float>(i, jj);
-            }
-        }
-    }
+    // The results are centered once and multiplied with their transpose in a
+    // single (symmetric) matrix product, in double precision.
+    cv::Mat mat_covariance;
+    cv::Mat mat_mean;
+    cv::calcCovarMatrix(mat_results, mat_covariance, mat_mean, 
+            CV_COVAR_NORMAL | CV_COVAR_ROWS | CV_COVAR_SCALE, CV_64F);
     
+    std::vector< std::vector<float> > covariance(mat_results.cols);
     for (int j = 0; j < mat_results.cols; j++) {
-        sums[j] /= mat_results.rows;
+        const double* covariance_j = mat_covariance.ptr<double>(j);
+        covariance[j].assign(covariance_j, covariance_j + mat_results.cols);
     }
     
-    for (int j = 0; j < mat_results.cols; j++) {
-        for (int jj = 0; jj < mat_results.cols; jj++) {
-            squared_sums[j][jj] /= mat_results.rows;
-            squared_sums[j][jj] -= sums[j]*sums[jj];
-        }
-    }
+    correlate(covariance, metric_order, mat_correlation, csv_correlation);
+}
+
+void EvaluationSummary::correlate(const std::vector< std::vector<float> > &covariance, 
+        const std::vector<std::string> &metric_order, cv::Mat &mat_correlation, 
+        std::string &csv_correlation) {
     
-    for (int j = 0; j < mat_results.cols; j++) {
-        for (int jj = 0; jj < mat_results.cols; jj++) {
-            LOG_IF(ERROR, squared_sums[j][jj] != squared_sums[jj][j] || std::isnan(squared_sums[j][jj])) << squared_sums[j][jj] << " != " << squared_sums[jj][j];
+    int cols = covariance.size();
+    LOG_IF(FATAL, cols != (int) metric_order.size()) 
+            << "Invalid metric order:" << cols << " != " << metric_order.size();
+    
+    for (int j = 0; j < cols; j++) {
+        for (int jj = 0; jj < cols; jj++) {
+            LOG_IF(ERROR, covariance[j][jj] != covariance[jj][j] || std::isnan(covariance[j][jj])) << covariance[j][jj] << " != " << covariance[jj][j];
         }
     }
     
     csv_correlation = "";
-    for (int j = 0; j < mat_results.cols; j++) {
+    for (int j = 0; j < cols; j++) {
         csv_correlation += "," + metric_order[j];
     }
     
     csv_correlation += "\n";
     
-    mat_correlation.create(mat_results.cols, mat_results.cols, CV_32FC1);
-    for (int j = 0; j < mat_results.cols; j++) {
+    mat_correlation.create(cols, cols, CV_32FC1);
+    for (int j = 0; j < cols; j++) {
         csv_correlation += metric_order[j];
         
-        for (int jj = 0; jj < mat_results.cols; jj++) {
-            mat_correlation.at<float>(j, jj) = squared_sums[j][jj] / (std::sqrt(squared_sums[j][j])*std::sqrt(squared_sums[jj][jj]));
+        for (int jj = 0; jj < cols; jj++) {
+            mat_correlation.at<float>(j, jj) = covariance[j][jj] / (std::sqrt(covariance[j][j])*std::sqrt(covariance[jj][jj]));
             csv_correlation += "," + std::to_string(mat_correlation.at<float>(j, jj));
         }
         
@@ -534,6 +697,21 @@ void EvaluationSummary::correlate(const cv::Mat &mat_results, const std::vector<
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// writeCorrelation
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::writeCorrelation(const cv::Mat &mat_correlation, 
+        const std::string &csv_correlation) {
+    
+    std::ofstream csv_correlation_file(correlation_file.string());
+    csv_correlation_file << csv_correlation;
+    csv_correlation_file.close();
+    
+    boost::filesystem::path correlation_mat_file(correlation_file.string() + ".txt");
+    IOUtil::writeMat(correlation_mat_file, mat_correlation);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // countStatistics
 ////////////////////////////////////////////////////////////////////////////////
@@ -802,6 +980,76 @@ void EvaluationSummary::summarize(const std::vector<int> &gt, const cv::Mat &dat
     mat_summary.push_back(row);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// summarizeOnline
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::summarizeOnline(const std::vector<OnlineStatistics> &statistics, 
+        const OnlineStatistics &image_min, const OnlineStatistics &image_max,
+        int gt_max, cv::Mat &mat_summary, std::stringstream &output) {
+    
+    LOG_IF(FATAL, (int) statistics.size() < gt_max + 1) << "Missing statistics for some ground truth segmentations.";
+    
+    int k = 0;
+    cv::Mat row(1, countStatistics(gt_max + 1), CV_32FC1, cv::Scalar(0));
+    
+    std::string separator = "";
+    auto append = [&](float value) {
+        output << separator << value;
+        row.at<float>(0, k) = value;
+        separator = ",";
+        ++k;
+    };
+    
+    if (evaluation_statistics.mean) {
+        for (int t = 0; t < gt_max + 1; ++t) {
+            append(statistics[t].getMean());
+        }
+        
+        append(image_min.getMean());
+        append(image_max.getMean());
+        
+        if (evaluation_statistics.std) {
+            for (int t = 0; t < gt_max + 1; ++t) {
+                append(statistics[t].getStandardDeviation());
+            }
+            
+            append(image_min.getStandardDeviation());
+            append(image_max.getStandardDeviation());
+        }
+    }
+    if (evaluation_statistics.median_and_quartiles) {
+        for (int t = 0; t < gt_max + 1; ++t) {
+            append(statistics[t].getQuantile(0.5f));
+            append(statistics[t].getQuantile(0.25f));
+            append(statistics[t].getQuantile(0.75f));
+        }
+        
+        append(image_min.getQuantile(0.5f));
+        append(image_min.getQuantile(0.25f));
+        append(image_min.getQuantile(0.75f));
+        
+        append(image_max.getQuantile(0.5f));
+        append(image_max.getQuantile(0.25f));
+        append(image_max.getQuantile(0.75f));
+    }
+    if (evaluation_statistics.min_and_max) {
+        for (int t = 0; t < gt_max + 1; ++t) {
+            append(statistics[t].getMin());
+            append(statistics[t].getMax());
+        }
+        
+        append(image_min.getMin());
+        append(image_min.getMax());
+        
+        append(image_max.getMin());
+        append(image_max.getMax());
+    }
+    
+    output << "\n";
+    mat_summary.push_back(row);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // computeMean
 ////////////////////////////////////////////////////////////////////////////////
@@ -1131,209 +1379,961 @@ float EvaluationSummary::computeStandardDeviation(const std::vector<int> gt, con
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// computeSummary
+// evaluateImage
 ////////////////////////////////////////////////////////////////////////////////
 
-void EvaluationSummary::computeSummary(int &gt_max) {
+void EvaluationSummary::evaluateImage(const boost::filesystem::path &sp_file, 
+        int i, int n, cv::Mat &data, std::string &output, std::vector<int> &gt) {
+    
+    LOG_IF(FATAL, !boost::filesystem::is_regular_file(sp_file)) 
+            << "Superpixel segmentation does not exist (which is weird): "
+            << sp_file.string() << ".";
+    
+    // Only the inputs needed by the enabled metrics are read; metrics on the
+    // superpixel segmentation alone do not need image or ground truth.
+    cv::Mat image;
+    if (requiresImage()) {
+        readImage(sp_file, image);
+    }
+    
+    cv::Mat sp_segmentation;
+    readSegmentation(sp_file, image, sp_segmentation);
+    
+    std::vector<boost::filesystem::path> gt_files;
+    std::vector<int> gt_indices;
+    std::vector<cv::Mat> gt_segmentations;
+    std::vector<GroundTruthCache::Entry> gt_entries;
+    bool single_gt = readGroundTruths(sp_file, sp_segmentation.rows, sp_segmentation.cols,
+            requiresGroundTruth(), gt_files, gt_indices, gt_segmentations, gt_entries);
+    
+    // Without batching, the GPU computes the statistics of a single segmentation.
+    std::vector<Evaluation::PixelStatistics> pixel_statistics;
+    if (gpu_evaluation) {
+        std::vector<cv::Mat> batch(1, sp_segmentation);
+        if (!GPUEvaluation::computeStatistics(batch, image, 
+                (requiresGroundTruth() ? gt_segmentations : std::vector<cv::Mat>()), 
+                pixel_statistics)) {
+            pixel_statistics.clear();
+        }
+    }
     
-    // Get all superpixel segmentations.
-    std::multimap<std::string, boost::filesystem::path> sp_files;
-    std::vector<std::string> csv_extensions;
-    IOUtil::getCSVExtensions(csv_extensions);
-    std::vector<std::string> exclude;
-    exclude.push_back("correlation");
-    exclude.push_back("results");
-    exclude.push_back("summary");
-    IOUtil::readDirectory(sp_directory, csv_extensions, sp_files, "", "", exclude);
+    ImageResult image_result;
+    evaluateSegmentation(sp_file, image, sp_segmentation, gt_files, gt_indices, 
+            gt_segmentations, single_gt, image_result, 
+            (!gt_entries.empty() ? &gt_entries : NULL), NULL,
+            (!pixel_statistics.empty() ? &pixel_statistics[0] : NULL));
     
-    // Ground truth indices for statistic computation.
-    std::vector<int> gt;
-//    cv::Mat mat_results(1, countMetrics(), CV_32FC1, cv::Scalar(0));
-    cv::Mat mat_results;
+    data.push_back(image_result.data);
+    output = image_result.csv;
+    gt.insert(gt.end(), image_result.gt.begin(), image_result.gt.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readImage
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::readImage(const boost::filesystem::path &sp_file, cv::Mat &image) {
     
-    std::stringstream csv_results;
-    std::vector<std::string> metric_order;
-    evaluateHeader(csv_results, metric_order);
+    TimingScope timing(this, "read_image");
     
-//    LOG(INFO) << "Computing evaluation metrics.";
+    boost::filesystem::path img_file = img_directory / 
+            boost::filesystem::path(sp_file.stem().string() + ".png");
+    if (!boost::filesystem::is_regular_file(img_file)) {
+        img_file = img_directory / 
+            boost::filesystem::path(sp_file.stem().string() + ".jpg");
+    }
+    if (!boost::filesystem::is_regular_file(img_file)) {
+        img_file = img_directory / 
+            boost::filesystem::path(sp_file.stem().string() + ".jpeg");
+    }
+
+    LOG_IF(FATAL, !boost::filesystem::is_regular_file(img_file)) 
+            << "Image does not exist (tried .png, .jpg, .jpeg): " 
+            << img_file.string() << ".";
+
+    image = cv::imread(img_file.string(), CV_LOAD_IMAGE_COLOR);
+
+    LOG_IF(FATAL, image.rows <= 0 || image.cols <= 0) << "Could not read image: " 
+            << img_file.string() << ".";
+    LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported: " 
+            << image.channels() << " (" << img_file.string() << ").";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readSegmentation
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::readSegmentation(const boost::filesystem::path &sp_file, 
+        const cv::Mat &image, cv::Mat &sp_segmentation) {
     
-    int i = 0;
-    for (std::multimap<std::string, boost::filesystem::path>::iterator it = sp_files.begin();
-            it != sp_files.end(); it++) {
-        
-        // Exclude created files.
-        if (it->second.stem().string() == "results"
-                || it->second.stem().string() == "summary") {
-            continue;
-        }
-        
-        boost::filesystem::path img_file = img_directory / 
-                boost::filesystem::path(it->second.stem().string() + ".png");
-        if (!boost::filesystem::is_regular_file(img_file)) {
-            img_file = img_directory / 
-                boost::filesystem::path(it->second.stem().string() + ".jpg");
-        }
-        if (!boost::filesystem::is_regular_file(img_file)) {
-            img_file = img_directory / 
-                boost::filesystem::path(it->second.stem().string() + ".jpeg");
-        }
-        
-        LOG_IF(FATAL, !boost::filesystem::is_regular_file(img_file)) 
-                << "Image does not exist (tried .png, .jpg, .jpeg): " 
-                << img_file.string() << ".";
-        LOG_IF(FATAL, !boost::filesystem::is_regular_file(it->second)) 
-                << "Superpixel segmentation does not exist (which is weird): "
-                << it->second.string() << ".";
-        
-        cv::Mat sp_segmentation;
-//        IOUtil::readMatCSVInt(it->second, sp_segmentation, image.rows, image.cols);
-        IOUtil::readMatCSVInt(it->second, sp_segmentation);
-        cv::Mat image = cv::imread(img_file.string(), CV_LOAD_IMAGE_COLOR);
-        
-//        cv::namedWindow("Image");
-//        cv::imshow("Image", image);
-//        
-//        cv::waitKey(0);
-        
-        LOG_IF(FATAL, image.rows <= 0 || image.cols <= 0) << "Could not read image: " 
-                << img_file.string() << ".";
-        LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported: " 
-                << image.channels() << " (" << img_file.string() << ").";
+    TimingScope timing(this, "read_segmentation");
+    
+    // If the image size is known, the segmentations are read into
+    // preallocated matrices.
+    if (!image.empty()) {
+        IOUtil::readMatCSVInt(sp_file, image.rows, image.cols, sp_segmentation);
         LOG_IF(FATAL, sp_segmentation.rows != image.rows || sp_segmentation.cols != image.cols) 
                 << "Superpixel segmentation does not match image size: (" 
                 << sp_segmentation.rows << "," << sp_segmentation.cols << ") != (" 
                 << image.rows << "," << image.cols << ").";
+    }
+    else {
+        IOUtil::readMatCSVInt(sp_file, sp_segmentation);
+        LOG_IF(FATAL, sp_segmentation.rows <= 0 || sp_segmentation.cols <= 0) 
+                << "Could not read superpixel segmentation: " << sp_file.string() << ".";
+    }
+}
 
-        // Find at least one ground truth file.
-        boost::filesystem::path gt_file = gt_directory / it->second.filename();
-        if (boost::filesystem::is_regular_file(gt_file)) {
-//            LOG(INFO) << "[" << i << "] One ground truth found for file " 
-//                    << i << "/" << sp_files.size() << ".";
-            
-            // Only one gt_file.
-            cv::Mat gt_segmentation;
-            IOUtil::readMatCSVInt(gt_file, gt_segmentation);
-            
-            LOG_IF(FATAL, gt_segmentation.rows != image.rows || gt_segmentation.cols != image.cols) 
-                    << "Ground truth does not match image size.";
-            
-            csv_results << it->second.stem() << ",";
-            csv_results << gt_file.stem() << ",";
-            
-            evaluate(sp_segmentation, gt_segmentation, image, mat_results, csv_results);
-            gt.push_back(0);
-            
-            // Visualizations.
-            visualize(sp_segmentation, gt_segmentation, image, it->second.stem().string());
+////////////////////////////////////////////////////////////////////////////////
+// readGroundTruths
+////////////////////////////////////////////////////////////////////////////////
+
+bool EvaluationSummary::readGroundTruths(const boost::filesystem::path &sp_file, 
+        int rows, int cols, bool ground_truth,
+        std::vector<boost::filesystem::path> &gt_files, std::vector<int> &gt_indices,
+        std::vector<cv::Mat> &gt_segmentations, 
+        std::vector<GroundTruthCache::Entry> &gt_entries) {
+    
+    TimingScope timing(this, "read_ground_truth");
+    
+    // The names of the ground truths are always needed as one row is
+    // written per ground truth.
+    bool single_gt = findGroundTruths(gt_directory, sp_file, gt_files, gt_indices);
+    
+    // All ground truth segmentations are evaluated as a batch, i.e. their
+    // intersections with the superpixels are computed in a single pass.
+    // With a ground truth cache, parsing and boundary maps are shared across
+    // all evaluated algorithms.
+    gt_segmentations.clear();
+    gt_segmentations.resize(gt_files.size());
+    gt_entries.clear();
+    if (ground_truth && ground_truth_cache != NULL) {
+        gt_entries.resize(gt_files.size());
+    }
+    
+    for (unsigned int k = 0; k < gt_files.size() && ground_truth; ++k) {
+        if (ground_truth_cache != NULL) {
+            ground_truth_cache->load(gt_files[k], rows, cols, gt_entries[k]);
+            gt_segmentations[k] = gt_entries[k].labels;
         }
         else {
-            for (int t = 0; t < 5; ++t) {
-//                LOG(INFO) << "[" << i << "] Processing ground truth " << (t + 1) 
-//                        << " found for file " << i << "/" << sp_files.size() << ".";
-                
-                boost::filesystem::path gt_file_t = gt_directory / 
-                        boost::filesystem::path(it->second.stem().string() + "-" + std::to_string(t) + ".csv");
-                LOG_IF(ERROR, !boost::filesystem::is_regular_file(gt_file_t)) << "[" << i << "] Ground truth " << (t + 1)
-                        << " not found for file " << i << "/" << sp_files.size() << ".";
-                
-                if (boost::filesystem::is_regular_file(gt_file_t)) {
-                    // Found a ground truth file.
-                    
-                    cv::Mat gt_segmentation;
-                    IOUtil::readMatCSVInt(gt_file_t, gt_segmentation);
-
-                    LOG_IF(FATAL, gt_segmentation.rows != image.rows || gt_segmentation.cols != image.cols) 
-                            << "Ground truth does not match image size.";
-
-                    csv_results << it->second.stem() << ",";
-                    csv_results << gt_file_t.stem() << ",";
-
-                    evaluate(sp_segmentation, gt_segmentation, image, mat_results, csv_results);
-                    gt.push_back(t);
-                    
-                    // Visualizations.
-                    visualize(sp_segmentation, gt_segmentation, image, it->second.stem().string(), t);
-                }
-            }
+            IOUtil::readMatCSVInt(gt_files[k], rows, cols, gt_segmentations[k]);
         }
         
-        ++i;
+        LOG_IF(FATAL, gt_segmentations[k].rows != rows || gt_segmentations[k].cols != cols) 
+                << "Ground truth does not match image size.";
     }
     
-    LOG_IF(FATAL, gt.size() == 0) << "No superpixel segmentation files found!";
-    gt_max = *std::max_element(gt.begin(), gt.end());
+    return single_gt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findGroundTruths
+////////////////////////////////////////////////////////////////////////////////
+
+bool EvaluationSummary::findGroundTruths(const boost::filesystem::path &gt_directory,
+        const boost::filesystem::path &sp_file,
+        std::vector<boost::filesystem::path> &gt_files,
+        std::vector<int> &gt_indices) {
     
-    // Save output as CSV file, and save data as cv::Mat.
-    std::ofstream csv_results_file(results_file.string());
-    csv_results_file << csv_results.str();
-    csv_results_file.close();
+    // Ground truth may be stored as CSV or binary label file,
+    // independent of the format of the superpixel segmentation.
+    std::vector<std::string> label_extensions;
+    IOUtil::getLabelExtensions(label_extensions);
     
-    boost::filesystem::path results_mat_file(results_file.string() + ".txt");
-    IOUtil::writeMat(results_mat_file, mat_results);
+    // Find at least one ground truth file.
+    gt_files.clear();
+    gt_indices.clear();
     
-    // Compute correlation if requested.
-    if (compute_correlation) {
-        cv::Mat mat_correlation;
-        std::string csv_correlation;
-        correlate(mat_results, metric_order, mat_correlation, 
-                csv_correlation);
-        
-        std::ofstream csv_correlation_file(correlation_file.string());
-        csv_correlation_file << csv_correlation;
-        csv_correlation_file.close();
-        
-        boost::filesystem::path correlation_mat_file(correlation_file.string() + ".txt");
-        IOUtil::writeMat(correlation_mat_file, mat_correlation);
+    boost::filesystem::path gt_file = gt_directory / sp_file.filename();
+    for (unsigned int k = 0; k < label_extensions.size() 
+            && !boost::filesystem::is_regular_file(gt_file); ++k) {
+        gt_file = gt_directory / boost::filesystem::path(sp_file.stem().string() 
+                + label_extensions[k]);
     }
     
-    validateStatistics();
-    std::stringstream csv_summary_header;
-    summaryHeader(gt, csv_summary_header);
-    
-    cv::Mat mat_summary;
-    
-//    LOG(INFO) << "Summarizing results.";
-    std::stringstream csv_summary;
-    for (int j = 0; j < mat_results.cols; ++j) {
-        csv_summary << metric_order[j] << ",";
-        
-//        LOG(INFO) << "[" << j << "] Summarizing metric " << (j + 1) << "/" << mat_results.cols << ".";
-        summarize(gt, mat_results, j, mat_summary, csv_summary);
+    bool single_gt = boost::filesystem::is_regular_file(gt_file);
+    if (single_gt) {
+        gt_files.push_back(gt_file);
+        gt_indices.push_back(0);
     }
-    
-    std::ofstream csv_summary_file(summary_file.string());
-    csv_summary_file << csv_summary_header.str() << csv_summary.str();
-    csv_summary_file.close();
-    
-    boost::filesystem::path summary_mat_file(summary_file.string() + ".txt");
-    IOUtil::writeMat(summary_mat_file, mat_summary);
-    
-    if (!append_file.empty()) {
-        
-        bool exists = boost::filesystem::is_regular_file(append_file);
-        std::ofstream csv_append_file(append_file.string(), 
-                std::ofstream::out | std::ofstream::app);
-        
-        if (!exists) {
-            // Add header.
-            std::ofstream csv_append_file(append_file.string());
-            csv_append_file << csv_summary_header.str();
+    else {
+        for (int t = 0; t < 5; ++t) {
+            boost::filesystem::path gt_file_t = gt_directory / 
+                    boost::filesystem::path(sp_file.stem().string() + "-" + std::to_string(t) + ".csv");
+            for (unsigned int k = 0; k < label_extensions.size() 
+                    && !boost::filesystem::is_regular_file(gt_file_t); ++k) {
+                gt_file_t = gt_directory / boost::filesystem::path(sp_file.stem().string() 
+                        + "-" + std::to_string(t) + label_extensions[k]);
+            }
+            
+            LOG_IF(ERROR, !boost::filesystem::is_regular_file(gt_file_t)) << "Ground truth " << (t + 1)
+                    << " not found for " << sp_file.stem().string() << ".";
+            
+            if (boost::filesystem::is_regular_file(gt_file_t)) {
+                gt_files.push_back(gt_file_t);
+                gt_indices.push_back(t);
+            }
         }
-        
-        csv_append_file << csv_summary.str();
-        csv_append_file.close();
     }
+    
+    return single_gt;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// setAppendFile
+// evaluateSegmentation
 ////////////////////////////////////////////////////////////////////////////////
 
-void EvaluationSummary::setAppendFile(const boost::filesystem::path &append_file_) {
-    append_file = append_file_;
-}
-
-////////////////////////////////////////////////////////////////////////////////
+void EvaluationSummary::evaluateSegmentation(const boost::filesystem::path &sp_file,
+        const cv::Mat &image, const cv::Mat &sp_segmentation,
+        const std::vector<boost::filesystem::path> &gt_files,
+        const std::vector<int> &gt_indices,
+        const std::vector<cv::Mat> &gt_segmentations, bool single_gt,
+        ImageResult &image_result, 
+        const std::vector<GroundTruthCache::Entry> *gt_entries,
+        const cv::Mat *edges, Evaluation::PixelStatistics *pixel_statistics) {
+    
+    std::stringstream csv_output;
+    
+    image_result.name = sp_file.filename().string();
+    image_result.data.release();
+    image_result.gt.clear();
+    
+    // Statistics of the superpixel segmentation are shared across all
+    // ground truth segmentations; the instance of each thread is reused across
+    // images to avoid reallocating its buffers.
+    static thread_local FusedEvaluation fused;
+    fused.reset(sp_segmentation, image);
+    
+    // The edge map only depends on the image; callers evaluating several
+    // segmentations of the same image pass it in to compute it once.
+    if (evaluation_metrics.er) {
+        if (edges != NULL) {
+            fused.setEdges(*edges);
+        }
+        else {
+            static thread_local cv::Mat image_edges;
+            computeEdges(image, image_edges);
+            fused.setEdges(image_edges);
+        }
+    }
+    
+    float memory = 0;
+    if (!peak_memory.empty()) {
+        std::map<std::string, float>::const_iterator it = peak_memory.find(sp_file.stem().string());
+        LOG_IF(FATAL, it == peak_memory.end()) << "No memory record for " 
+                << sp_file.stem().string() << ".";
+        
+        memory = it->second;
+    }
+    
+    // Without ground truth metrics, the ground truths may not have been read;
+    // the results are then the same for all of them.
+    bool ground_truth = requiresGroundTruth();
+    if (!gt_segmentations.empty() && ground_truth) {
+        fused.setGroundTruths(gt_segmentations);
+        
+        if (gt_entries != NULL) {
+            std::vector<cv::Mat> gt_boundaries(gt_entries->size());
+            std::vector<cv::Mat> gt_dilated_boundaries(gt_entries->size());
+            int gt_dilation_radius = (gt_entries->empty() ? -1 : (*gt_entries)[0].dilation_radius);
+            
+            for (unsigned int k = 0; k < gt_entries->size(); ++k) {
+                gt_boundaries[k] = (*gt_entries)[k].boundaries;
+                gt_dilated_boundaries[k] = (*gt_entries)[k].dilated_boundaries;
+            }
+            
+            fused.setGroundTruthBoundaries(gt_boundaries, gt_dilated_boundaries, 
+                    gt_dilation_radius);
+        }
+    }
+    
+    if (pixel_statistics != NULL) {
+        if (gt_segmentations.empty() || !ground_truth) {
+            pixel_statistics->intersections.clear();
+        }
+        
+        fused.setPixelStatistics(*pixel_statistics);
+    }
+    
+    // Memoized results depend on the segmentation, the image, the ground truth
+    // and the metrics; visualizations always require the segmentation.
+    bool memoize = (evaluation_memo != NULL && !superpixel_visualizations.any());
+    std::string memo_key;
+    if (memoize) {
+        std::stringstream metrics_header;
+        std::vector<std::string> metric_order;
+        evaluateHeader(metrics_header, metric_order);
+        
+        memo_key = EvaluationMemo::hashMat(sp_segmentation) + ":" 
+                + EvaluationMemo::hashMat(image) + ":" + metrics_header.str();
+        if (!peak_memory.empty()) {
+            memo_key += ":" + std::to_string(memory);
+        }
+    }
+    
+    // Boundaries and means are computed once for the visualizations of all
+    // ground truths.
+    Visualization::Context visualization_context;
+    if (superpixel_visualizations.any()) {
+        bool means = superpixel_visualizations.mean || superpixel_visualizations.perturbed_mean;
+        float d = (superpixel_visualizations.pre_rec ? 0.0025f : 0.f);
+        Visualization::computeContext(image, sp_segmentation, visualization_context, 
+                means, d);
+    }
+    
+    for (unsigned int k = 0; k < gt_segmentations.size(); ++k) {
+        csv_output << sp_file.stem() << ",";
+        csv_output << gt_files[k].stem() << ",";
+        
+        if (memoize) {
+            std::string key = memo_key + ":" + EvaluationMemo::hashMat(gt_segmentations[k]);
+            
+            cv::Mat memo_data;
+            std::string memo_csv;
+            if (!evaluation_memo->read(key, memo_data, memo_csv)) {
+                std::stringstream metrics_output;
+                
+                if (ground_truth) {
+                    fused.selectGroundTruth(k);
+                }
+                
+                evaluate(fused, memo_data, metrics_output, memory);
+                
+                memo_csv = metrics_output.str();
+                evaluation_memo->write(key, memo_data, memo_csv);
+            }
+            
+            image_result.data.push_back(memo_data);
+            csv_output << memo_csv;
+        }
+        else {
+            if (ground_truth) {
+                fused.selectGroundTruth(k);
+            }
+            
+            evaluate(fused, image_result.data, csv_output, memory);
+        }
+        
+        image_result.gt.push_back(gt_indices[k]);
+        
+        // Visualizations.
+        if (single_gt) {
+            visualize(visualization_context, gt_segmentations[k], sp_file.stem().string());
+        }
+        else {
+            visualize(visualization_context, gt_segmentations[k], sp_file.stem().string(), gt_indices[k]);
+        }
+    }
+    
+    image_result.csv = csv_output.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeEdges
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::computeEdges(const cv::Mat &image, cv::Mat &edges) {
+    Evaluation::computeCannyEdges(image, 50, edges);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSummary
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::computeSummary(int &gt_max) {
+    
+    // Resume from the checkpoint file; newly evaluated images are appended.
+    if (!checkpoint_file.empty()) {
+        if (boost::filesystem::is_regular_file(checkpoint_file)) {
+            int count = readCheckpointFile(checkpoint_file, true);
+            LOG(INFO) << "Resuming with " << count << " results from " 
+                    << checkpoint_file.string() << ".";
+        }
+        
+        checkpoint_stream.open(checkpoint_file.string(), 
+                std::ofstream::out | std::ofstream::app | std::ofstream::binary);
+        LOG_IF(FATAL, !checkpoint_stream.is_open()) << "Could not open checkpoint file "
+                << checkpoint_file.string() << ".";
+    }
+    
+    // Get all superpixel segmentations.
+    std::multimap<std::string, boost::filesystem::path> sp_files;
+    listSegmentations(sp_files);
+    
+    // Shards are assigned independent of the results added or resumed.
+    IOUtil::selectShard(sp_files, shard, shards);
+    
+    // Ground truth indices for statistic computation.
+    std::vector<int> gt;
+//    cv::Mat mat_results(1, countMetrics(), CV_32FC1, cv::Scalar(0));
+    cv::Mat mat_results;
+    
+    std::stringstream csv_results;
+    std::vector<std::string> metric_order;
+    evaluateHeader(csv_results, metric_order);
+    
+//    LOG(INFO) << "Computing evaluation metrics.";
+    
+    // Collect the superpixel segmentations to evaluate; segmentations with
+    // added results do not need to be evaluated again.
+    std::set<std::string> added_names;
+    for (unsigned int i = 0; i < added_results.size(); ++i) {
+        added_names.insert(added_results[i].name);
+    }
+    
+    std::vector<boost::filesystem::path> sp_paths;
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = sp_files.begin();
+            it != sp_files.end(); it++) {
+        
+        // Exclude created files.
+        if (it->second.stem().string() == "results"
+                || it->second.stem().string() == "summary") {
+            continue;
+        }
+        
+        if (added_names.find(it->second.filename().string()) != added_names.end()) {
+            continue;
+        }
+        
+        sp_paths.push_back(it->second);
+    }
+    
+    if (online_statistics && shards == 1) {
+        computeOnlineSummary(sp_paths, csv_results.str(), metric_order, gt_max);
+        checkpoint_stream.close();
+        return;
+    }
+    
+    // Images are evaluated independently; results are gathered per image and
+    // concatenated in the original order afterwards.
+    int n = sp_paths.size();
+    image_results.clear();
+    image_results.resize(n);
+    
+    for (int i = 0; i < n; ++i) {
+        image_results[i].name = sp_paths[i].filename().string();
+    }
+    
+    ThreadPool::parallelFor(0, n, [&](int i) {
+        evaluateImage(sp_paths[i], i, n, image_results[i].data, 
+                image_results[i].csv, image_results[i].gt);
+        writeCheckpoint(image_results[i]);
+    }, threads);
+    
+    checkpoint_stream.close();
+    
+    // Added results are merged by file name, which is the order the
+    // segmentations would have been read from the directory.
+    if (!added_results.empty()) {
+        image_results.insert(image_results.end(), added_results.begin(), added_results.end());
+        std::stable_sort(image_results.begin(), image_results.end(), 
+                [](const ImageResult &a, const ImageResult &b) {
+                    return a.name < b.name;
+                });
+    }
+    
+    for (unsigned int i = 0; i < image_results.size(); ++i) {
+        mat_results.push_back(image_results[i].data);
+        csv_results << image_results[i].csv;
+        gt.insert(gt.end(), image_results[i].gt.begin(), image_results[i].gt.end());
+    }
+    
+    LOG_IF(FATAL, gt.size() == 0) << "No superpixel segmentation files found!";
+    gt_max = *std::max_element(gt.begin(), gt.end());
+    
+    // The summary of a single shard would be partial.
+    if (shards > 1) {
+        return;
+    }
+    
+    // Save output as CSV file, and save data as cv::Mat.
+    {
+        TimingScope timing(this, "write");
+        std::ofstream csv_results_file(results_file.string());
+        csv_results_file << csv_results.str();
+        csv_results_file.close();
+        
+        boost::filesystem::path results_mat_file(results_file.string() + ".txt");
+        IOUtil::writeMat(results_mat_file, mat_results);
+    }
+    
+    // Compute correlation if requested.
+    if (compute_correlation) {
+        cv::Mat mat_correlation;
+        std::string csv_correlation;
+        correlate(mat_results, metric_order, mat_correlation, 
+                csv_correlation);
+        writeCorrelation(mat_correlation, csv_correlation);
+    }
+    
+    validateStatistics();
+    std::stringstream csv_summary_header;
+    summaryHeader(gt, csv_summary_header);
+    
+    cv::Mat mat_summary;
+    
+//    LOG(INFO) << "Summarizing results.";
+    
+    // Metrics are summarized independently and concatenated in order.
+    int cols = mat_results.cols;
+    std::vector<cv::Mat> mat_summaries(cols);
+    std::vector<std::string> csv_summaries(cols);
+    
+    ThreadPool::parallelFor(0, cols, [&](int j) {
+        std::stringstream csv_summary_j;
+        summarize(gt, mat_results, j, mat_summaries[j], csv_summary_j);
+        csv_summaries[j] = csv_summary_j.str();
+    }, threads);
+    
+    std::stringstream csv_summary;
+    for (int j = 0; j < cols; ++j) {
+        csv_summary << metric_order[j] << "," << csv_summaries[j];
+        mat_summary.push_back(mat_summaries[j]);
+    }
+    
+    writeSummary(csv_summary_header, csv_summary, mat_summary);
+    writeTimings();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSummaries
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::computeSummaries(const std::vector<EvaluationSummary*> &summaries, 
+        int &gt_max) {
+    
+    LOG_IF(FATAL, summaries.empty()) << "No evaluation summaries given.";
+    
+    EvaluationSummary* first = summaries[0];
+    bool image_required = false;
+    bool ground_truth_required = false;
+    bool edges_required = false;
+    
+    for (unsigned int s = 0; s < summaries.size(); ++s) {
+        LOG_IF(FATAL, summaries[s]->img_directory != first->img_directory 
+                || summaries[s]->gt_directory != first->gt_directory) 
+                << "Evaluation summaries need to share image and ground truth directory.";
+        LOG_IF(FATAL, !summaries[s]->checkpoint_file.empty() || summaries[s]->shards > 1) 
+                << "Checkpoints and shards are not supported for multiple summaries.";
+        
+        image_required = image_required || summaries[s]->requiresImage();
+        ground_truth_required = ground_truth_required || summaries[s]->requiresGroundTruth();
+        edges_required = edges_required || summaries[s]->evaluation_metrics.er;
+    }
+    
+    // Group the superpixel segmentations of all summaries by image; results
+    // already added are not evaluated again.
+    std::map< std::string, std::vector< std::pair<int, boost::filesystem::path> > > images;
+    std::vector< std::vector<ImageResult> > results(summaries.size());
+    
+    for (unsigned int s = 0; s < summaries.size(); ++s) {
+        std::set<std::string> added_names;
+        for (unsigned int i = 0; i < summaries[s]->added_results.size(); ++i) {
+            added_names.insert(summaries[s]->added_results[i].name);
+        }
+        
+        std::multimap<std::string, boost::filesystem::path> sp_files;
+        summaries[s]->listSegmentations(sp_files);
+        
+        for (std::multimap<std::string, boost::filesystem::path>::iterator it = sp_files.begin();
+                it != sp_files.end(); it++) {
+            if (it->second.stem().string() == "results"
+                    || it->second.stem().string() == "summary") {
+                continue;
+            }
+            
+            if (added_names.find(it->second.filename().string()) != added_names.end()) {
+                continue;
+            }
+            
+            images[it->second.stem().string()].push_back(
+                    std::pair<int, boost::filesystem::path>(s, it->second));
+        }
+    }
+    
+    // Index of the result of each segmentation.
+    std::vector< std::vector< std::pair<int, boost::filesystem::path> > > groups;
+    std::vector< std::vector<int> > indices;
+    for (std::map< std::string, std::vector< std::pair<int, boost::filesystem::path> > >::iterator it = images.begin();
+            it != images.end(); ++it) {
+        
+        groups.push_back(it->second);
+        indices.push_back(std::vector<int>(it->second.size()));
+        
+        for (unsigned int k = 0; k < it->second.size(); ++k) {
+            int s = it->second[k].first;
+            indices.back()[k] = results[s].size();
+            results[s].push_back(ImageResult());
+        }
+    }
+    
+    // Each image and its ground truths are read once; the segmentations of
+    // all summaries are then evaluated in parallel.
+    int threads = first->threads;
+    ThreadPool::parallelFor(0, groups.size(), [&](int i) {
+        const std::vector< std::pair<int, boost::filesystem::path> > &group = groups[i];
+        
+        cv::Mat image;
+        if (image_required) {
+            first->readImage(group[0].second, image);
+        }
+        
+        // Without image, the size is taken from the first segmentation.
+        int rows = image.rows;
+        int cols = image.cols;
+        if (image.empty()) {
+            cv::Mat sp_segmentation;
+            first->readSegmentation(group[0].second, image, sp_segmentation);
+            rows = sp_segmentation.rows;
+            cols = sp_segmentation.cols;
+        }
+        
+        std::vector<boost::filesystem::path> gt_files;
+        std::vector<int> gt_indices;
+        std::vector<cv::Mat> gt_segmentations;
+        std::vector<GroundTruthCache::Entry> gt_entries;
+        bool single_gt = first->readGroundTruths(group[0].second, rows, cols, 
+                ground_truth_required, gt_files, gt_indices, gt_segmentations, gt_entries);
+        
+        cv::Mat edges;
+        if (edges_required) {
+            computeEdges(image, edges);
+        }
+        
+        std::vector<cv::Mat> sp_segmentations(group.size());
+        ThreadPool::parallelFor(0, group.size(), [&](int k) {
+            summaries[group[k].first]->readSegmentation(group[k].second, image, 
+                    sp_segmentations[k]);
+            LOG_IF(FATAL, sp_segmentations[k].rows != rows || sp_segmentations[k].cols != cols) 
+                    << "Superpixel segmentation does not match ground truth size: "
+                    << group[k].second.string() << ".";
+        }, threads);
+        
+        // All segmentations of the image are a single batch on the GPU.
+        std::vector<Evaluation::PixelStatistics> pixel_statistics;
+        if (first->gpu_evaluation) {
+            if (!GPUEvaluation::computeStatistics(sp_segmentations, image, 
+                    (ground_truth_required ? gt_segmentations : std::vector<cv::Mat>()), 
+                    pixel_statistics)) {
+                pixel_statistics.clear();
+            }
+        }
+        
+        ThreadPool::parallelFor(0, group.size(), [&](int k) {
+            EvaluationSummary* summary = summaries[group[k].first];
+            
+            ImageResult &image_result = results[group[k].first][indices[i][k]];
+            summary->evaluateSegmentation(group[k].second, image, sp_segmentations[k], 
+                    gt_files, gt_indices, gt_segmentations, single_gt, image_result,
+                    (!gt_entries.empty() ? &gt_entries : NULL),
+                    (!edges.empty() ? &edges : NULL),
+                    (!pixel_statistics.empty() ? &pixel_statistics[k] : NULL));
+        }, threads);
+    }, threads);
+    
+    // All segmentations are evaluated, such that summarizing only writes
+    // the files of each summary.
+    gt_max = 0;
+    for (unsigned int s = 0; s < summaries.size(); ++s) {
+        for (unsigned int i = 0; i < results[s].size(); ++i) {
+            summaries[s]->addImageResult(results[s][i]);
+        }
+        
+        int gt_max_s = 0;
+        summaries[s]->computeSummary(gt_max_s);
+        gt_max = std::max(gt_max, gt_max_s);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// listSegmentations
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::listSegmentations(std::multimap<std::string, boost::filesystem::path> &sp_files) {
+    
+    std::vector<std::string> csv_extensions;
+    IOUtil::getLabelExtensions(csv_extensions);
+    std::vector<std::string> exclude;
+    exclude.push_back("correlation");
+    exclude.push_back("results");
+    exclude.push_back("summary");
+    IOUtil::readDirectory(sp_directory, csv_extensions, sp_files, "", "", exclude);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeOnlineSummary
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::computeOnlineSummary(const std::vector<boost::filesystem::path> &sp_paths,
+        const std::string &csv_header, const std::vector<std::string> &metric_order,
+        int &gt_max) {
+    
+    // Superpixel segmentations and added results are merged by file name;
+    // indices >= n refer to added results.
+    int n = sp_paths.size();
+    std::vector< std::pair<std::string, int> > order;
+    for (int i = 0; i < n; ++i) {
+        order.push_back(std::pair<std::string, int>(sp_paths[i].filename().string(), i));
+    }
+    for (unsigned int i = 0; i < added_results.size(); ++i) {
+        order.push_back(std::pair<std::string, int>(added_results[i].name, n + i));
+    }
+    
+    std::stable_sort(order.begin(), order.end(), 
+            [](const std::pair<std::string, int> &a, const std::pair<std::string, int> &b) {
+                return a.first < b.first;
+            });
+    
+    image_results.clear();
+    
+    int cols = metric_order.size();
+    std::vector< std::vector<OnlineStatistics> > statistics(cols);
+    std::vector<OnlineStatistics> image_min(cols);
+    std::vector<OnlineStatistics> image_max(cols);
+    
+    // Sums and cross products for the correlation computation.
+    int rows = 0;
+    std::vector<double> sums(cols, 0);
+    std::vector< std::vector<double> > squared_sums(cols, std::vector<double>(cols, 0));
+    
+    gt_max = -1;
+    std::ofstream csv_results_file(results_file.string());
+    csv_results_file << csv_header;
+    
+    auto produce = [&](int i, ImageResult &result) {
+        int k = order[i].second;
+        if (k < n) {
+            evaluateImage(sp_paths[k], k, n, result.data, result.csv, result.gt);
+            result.name = order[i].first;
+            writeCheckpoint(result);
+        }
+        else {
+            result = added_results[k - n];
+        }
+    };
+    
+    auto consume = [&](const ImageResult &result) {
+        csv_results_file << result.csv;
+        
+        if (result.data.rows == 0) {
+            return;
+        }
+        
+        LOG_IF(FATAL, result.data.cols != cols) << "Invalid number of metrics for " << result.name << ".";
+        LOG_IF(FATAL, (int) result.gt.size() != result.data.rows) << "The ground truth indices do not match the number of values for " << result.name << ".";
+        
+        for (int r = 0; r < result.data.rows; ++r) {
+            int t = result.gt[r];
+            gt_max = std::max(gt_max, t);
+            
+            for (int j = 0; j < cols; ++j) {
+                float value = result.data.at<float>(r, j);
+                
+                if ((int) statistics[j].size() <= t) {
+                    statistics[j].resize(t + 1);
+                }
+                statistics[j][t].add(value);
+                
+                if (compute_correlation) {
+                    sums[j] += value;
+                    for (int jj = 0; jj < cols; ++jj) {
+                        squared_sums[j][jj] += value*result.data.at<float>(r, jj);
+                    }
+                }
+            }
+            
+            ++rows;
+        }
+        
+        for (int j = 0; j < cols; ++j) {
+            double min, max;
+            cv::minMaxLoc(result.data.col(j), &min, &max);
+            
+            image_min[j].add(min);
+            image_max[j].add(max);
+        }
+    };
+    
+    // Images are evaluated in parallel while the results are consumed in
+    // order; at most window results are pending at any time.
+    int N = order.size();
+    int n_threads = std::max(1, std::min(threads, N));
+    if (n_threads <= 1) {
+        for (int i = 0; i < N; ++i) {
+            ImageResult result;
+            produce(i, result);
+            consume(result);
+        }
+    }
+    else {
+        int window = 4*n_threads;
+        int consumed = 0;
+        std::map<int, ImageResult> pending;
+        std::mutex mutex;
+        std::condition_variable condition;
+        
+        std::atomic<int> next(0);
+        std::vector<std::thread> workers;
+        
+        for (int k = 0; k < n_threads; ++k) {
+            workers.push_back(std::thread([&]() {
+                for (int i = next++; i < N; i = next++) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        condition.wait(lock, [&]() { return i < consumed + window; });
+                    }
+                    
+                    ImageResult result;
+                    produce(i, result);
+                    
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        pending[i] = result;
+                    }
+                    condition.notify_all();
+                }
+            }));
+        }
+        
+        for (int i = 0; i < N; ++i) {
+            ImageResult result;
+            
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&]() { return pending.find(i) != pending.end(); });
+                
+                result = pending[i];
+                pending.erase(i);
+                consumed = i + 1;
+            }
+            condition.notify_all();
+            
+            consume(result);
+        }
+        
+        for (unsigned int k = 0; k < workers.size(); ++k) {
+            workers[k].join();
+        }
+    }
+    
+    csv_results_file.close();
+    
+    LOG_IF(FATAL, rows == 0) << "No superpixel segmentation files found!";
+    
+    for (int j = 0; j < cols; ++j) {
+        statistics[j].resize(gt_max + 1);
+    }
+    
+    // Compute correlation if requested.
+    if (compute_correlation) {
+        std::vector< std::vector<float> > covariance(cols, std::vector<float>(cols, 0));
+        for (int j = 0; j < cols; ++j) {
+            for (int jj = 0; jj < cols; ++jj) {
+                covariance[j][jj] = squared_sums[j][jj]/rows - (sums[j]/rows)*(sums[jj]/rows);
+            }
+        }
+        
+        cv::Mat mat_correlation;
+        std::string csv_correlation;
+        correlate(covariance, metric_order, mat_correlation, csv_correlation);
+        writeCorrelation(mat_correlation, csv_correlation);
+    }
+    
+    validateStatistics();
+    std::stringstream csv_summary_header;
+    summaryHeader(std::vector<int>(1, gt_max), csv_summary_header);
+    
+    cv::Mat mat_summary;
+    std::stringstream csv_summary;
+    for (int j = 0; j < cols; ++j) {
+        csv_summary << metric_order[j] << ",";
+        summarizeOnline(statistics[j], image_min[j], image_max[j], gt_max, 
+                mat_summary, csv_summary);
+    }
+    
+    writeSummary(csv_summary_header, csv_summary, mat_summary);
+    writeTimings();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeSummary
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::writeSummary(const std::stringstream &csv_summary_header, 
+        const std::stringstream &csv_summary, const cv::Mat &mat_summary) {
+    
+    TimingScope timing(this, "write");
+    
+    std::ofstream csv_summary_file(summary_file.string());
+    csv_summary_file << csv_summary_header.str() << csv_summary.str();
+    csv_summary_file.close();
+    
+    boost::filesystem::path summary_mat_file(summary_file.string() + ".txt");
+    IOUtil::writeMat(summary_mat_file, mat_summary);
+    
+    if (!append_file.empty()) {
+        
+        bool exists = boost::filesystem::is_regular_file(append_file);
+        std::ofstream csv_append_file(append_file.string(), 
+                std::ofstream::out | std::ofstream::app);
+        
+        if (!exists) {
+            // Add header.
+            std::ofstream csv_append_file(append_file.string());
+            csv_append_file << csv_summary_header.str();
+        }
+        
+        csv_append_file << csv_summary.str();
+        csv_append_file.close();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// addImageResult
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::addImageResult(const ImageResult &image_result) {
+    added_results.push_back(image_result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getImageResults
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::getImageResults(std::vector<ImageResult> &image_results_) {
+    image_results_ = image_results;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setAppendFile
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::setAppendFile(const boost::filesystem::path &append_file_) {
+    append_file = append_file_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setMemoryFile
+////////////////////////////////////////////////////////////////////////////////
+
+bool EvaluationSummary::setMemoryFile(const boost::filesystem::path &memory_file) {
+    
+    std::vector<MemoryProfile::Record> records;
+    if (!MemoryProfile::readRecords(memory_file, records)) {
+        return false;
+    }
+    
+    // Later records, e.g. from repeated runs, replace earlier ones.
+    peak_memory.clear();
+    for (unsigned int i = 0; i < records.size(); ++i) {
+        peak_memory[records[i].name] = records[i].peak_rss/1024.f;
+    }
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
 // setEvaluationStatistics
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -1396,3 +2396,197 @@ void EvaluationSummary::setComputeCorrelation(bool compute_correlation_) {
 bool EvaluationSummary::getComputeCorrelation() {
     return compute_correlation;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// setThreads
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::setThreads(int threads_) {
+    LOG_IF(FATAL, threads_ <= 0) << "Number of threads needs to be positive.";
+    threads = threads_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getThreads
+////////////////////////////////////////////////////////////////////////////////
+
+int EvaluationSummary::getThreads() {
+    return threads;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setOnlineStatistics
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::setOnlineStatistics(bool online_statistics_) {
+    online_statistics = online_statistics_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getOnlineStatistics
+////////////////////////////////////////////////////////////////////////////////
+
+bool EvaluationSummary::getOnlineStatistics() {
+    return online_statistics;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setGPUEvaluation
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::setGPUEvaluation(bool gpu_evaluation_) {
+    gpu_evaluation = gpu_evaluation_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getGPUEvaluation
+////////////////////////////////////////////////////////////////////////////////
+
+bool EvaluationSummary::getGPUEvaluation() {
+    return gpu_evaluation;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setTimings
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::setTimings(bool timings_) {
+    timings = timings_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getTimings
+////////////////////////////////////////////////////////////////////////////////
+
+bool EvaluationSummary::getTimings() {
+    return timings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeTimings
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::writeTimings() {
+    if (!timings) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(timing_mutex);
+    
+    std::ofstream csv_timing_file(timing_file.string());
+    csv_timing_file << "name,total,count,average" << "\n";
+    for (std::map<std::string, double>::const_iterator it = timing_seconds.begin();
+            it != timing_seconds.end(); ++it) {
+        int count = timing_counts[it->first];
+        csv_timing_file << it->first << "," << it->second << "," << count 
+                << "," << (count > 0 ? it->second/count : 0) << "\n";
+    }
+    csv_timing_file.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setEvaluationMemo
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::setEvaluationMemo(EvaluationMemo* evaluation_memo_) {
+    evaluation_memo = evaluation_memo_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setGroundTruthCache
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::setGroundTruthCache(GroundTruthCache* ground_truth_cache_) {
+    ground_truth_cache = ground_truth_cache_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setCheckpointFile
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::setCheckpointFile(const boost::filesystem::path &checkpoint_file_) {
+    checkpoint_file = checkpoint_file_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// addCheckpointFile
+////////////////////////////////////////////////////////////////////////////////
+
+int EvaluationSummary::addCheckpointFile(const boost::filesystem::path &checkpoint_file_) {
+    LOG_IF(FATAL, !boost::filesystem::is_regular_file(checkpoint_file_)) 
+            << "Checkpoint file not found: " << checkpoint_file_.string() << ".";
+    
+    return readCheckpointFile(checkpoint_file_, false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setShard
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::setShard(int shard_, int shards_) {
+    LOG_IF(FATAL, shards_ <= 0) << "Number of shards needs to be positive.";
+    LOG_IF(FATAL, shard_ < 0 || shard_ >= shards_) << "Invalid shard: " << shard_ << ".";
+    
+    shard = shard_;
+    shards = shards_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readCheckpointFile
+////////////////////////////////////////////////////////////////////////////////
+
+int EvaluationSummary::readCheckpointFile(const boost::filesystem::path &checkpoint_file_,
+        bool truncate) {
+    
+    std::ifstream file_stream(checkpoint_file_.c_str(), std::ifstream::in | std::ifstream::binary);
+    LOG_IF(FATAL, !file_stream.is_open()) << "Could not read checkpoint file " 
+            << checkpoint_file_.string() << ".";
+    
+    std::set<std::string> added_names;
+    for (unsigned int i = 0; i < added_results.size(); ++i) {
+        added_names.insert(added_results[i].name);
+    }
+    
+    int count = 0;
+    std::streamoff valid_size = 0;
+    
+    ImageResult image_result;
+    while (ResultCache::readImageResult(file_stream, image_result)) {
+        valid_size = file_stream.tellg();
+        
+        if (added_names.find(image_result.name) == added_names.end()) {
+            added_names.insert(image_result.name);
+            added_results.push_back(image_result);
+            ++count;
+        }
+    }
+    
+    file_stream.close();
+    
+    uintmax_t size = boost::filesystem::file_size(checkpoint_file_);
+    if (size != (uintmax_t) valid_size) {
+        LOG(WARNING) << "Discarding " << (size - valid_size) << " bytes of incomplete "
+                << "results in " << checkpoint_file_.string() << ".";
+        
+        if (truncate) {
+            boost::filesystem::resize_file(checkpoint_file_, valid_size);
+        }
+    }
+    
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeCheckpoint
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::writeCheckpoint(const ImageResult &image_result) {
+    
+    std::lock_guard<std::mutex> lock(checkpoint_mutex);
+    if (!checkpoint_stream.is_open()) {
+        return;
+    }
+    
+    ResultCache::writeImageResult(checkpoint_stream, image_result);
+    checkpoint_stream.flush();
+}
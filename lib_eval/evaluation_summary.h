@@ -33,8 +33,18 @@
 #define	EVALUATION_SUMMARY_H
 
 #include <vector>
+#include <map>
+#include <fstream>
+#include <mutex>
 #include <boost/filesystem.hpp>
 #include <opencv2/opencv.hpp>
+#include "online_statistics.h"
+#include "visualization.h"
+#include "ground_truth_cache.h"
+#include "evaluation.h"
+
+class FusedEvaluation;
+class EvaluationMemo;
 
 /** \brief Given a directory of superpixel segmentations and a directory of
  * ground truth segmentations, this class is used to generate a CSV file of 
@@ -76,7 +86,7 @@ public:
     struct EvaluationMetrics {
         EvaluationMetrics() : ue(true), oe(true), rec(true), pre(true),
                 ue_np(true), ue_levin(true), asa(true), sse_rgb(true), sse_xy(true),
-                co(true), ev(true), mde(true), icv(true), cd(true),
+                co(true), ev(true), mde(true), er(false), icv(true), cd(true),
                 reg(true), sp(true), sp_size(true) {};
         
         /** \brief Whether to use Undersegmentation Error. */
@@ -103,6 +113,8 @@ public:
         bool ev;
         /** \brief Whether to use Mean Distance to Edge. */
         bool mde;
+        /** \brief Whether to use Edge Recall on the Canny edges of the image, see computeEdges. */
+        bool er;
         /** \brief Whether to use Intra-Cluster Variation. */
         bool icv;
         /** \brief Whether to use Contour Density. */
@@ -134,6 +146,19 @@ public:
         bool std;
     };
     
+    /** \brief Evaluation results of a single superpixel segmentation.
+     */
+    struct ImageResult {
+        /** \brief File name of the superpixel segmentation. */
+        std::string name;
+        /** \brief One row of metrics per ground truth segmentation. */
+        cv::Mat data;
+        /** \brief Corresponding lines of the results CSV file. */
+        std::string csv;
+        /** \brief Ground truth index of each row. */
+        std::vector<int> gt;
+    };
+    
     /** \brief Create an evaluation summary for the given directory.
      * 
      * The directory is assumed to contain several superpixel segmentations as
@@ -181,11 +206,96 @@ public:
      */
     void computeSummary(int &gt_max);
     
+    /** \brief Summarize several superpixel directories evaluated on the same
+     * images and ground truths, e.g. different algorithms or numbers of superpixels.
+     * 
+     * Each image and its ground truths are read once and the corresponding
+     * segmentations of all summaries are evaluated in parallel, using the threads
+     * of the first summary; the files written are the same as when calling
+     * computeSummary on each summary. Checkpoints and shards are not supported.
+     * 
+     * \param[in] summaries summaries sharing image and ground truth directory
+     * \param[out] gt_max the maxmimum number of ground truth used over all summaries
+     */
+    static void computeSummaries(const std::vector<EvaluationSummary*> &summaries, 
+            int &gt_max);
+    
+    /** \brief Add the results of a superpixel segmentation evaluated earlier,
+     * e.g. taken from a ResultCache.
+     * 
+     * The results are summarized as if the segmentation was found in the
+     * superpixel directory; a file of the same name is not evaluated again.
+     * 
+     * \param[in] image_result results to add
+     */
+    void addImageResult(const ImageResult &image_result);
+    
+    /** \brief Get the results of all superpixel segmentations summarized by
+     * the last call to computeSummary, in the order they were summarized.
+     * \param[out] image_results results
+     */
+    void getImageResults(std::vector<ImageResult> &image_results);
+
+    /** \brief Find the ground truth segmentations of a superpixel segmentation,
+     * i.e. either a single ground truth of the same name or up to five
+     * ground truths suffixed with -0 to -4 (as for the BSDS500).
+     * \param[in] gt_directory directory containing ground truth segmentations
+     * \param[in] sp_file superpixel segmentation or image, only the name is used
+     * \param[out] gt_files ground truth files found
+     * \param[out] gt_indices index of each ground truth file
+     * \return whether a single ground truth of the same name was found
+     */
+    static bool findGroundTruths(const boost::filesystem::path &gt_directory,
+            const boost::filesystem::path &sp_file,
+            std::vector<boost::filesystem::path> &gt_files,
+            std::vector<int> &gt_indices);
+
+    /** \brief Evaluate a superpixel segmentation held in memory, e.g. computed
+     * in-process; the result can be summarized using addImageResult.
+     * \param[in] sp_file name of the superpixel segmentation as if it was read
+     * from the superpixel directory
+     * \param[in] image corresponding image
+     * \param[in] sp_segmentation superpixel segmentation
+     * \param[in] gt_files ground truth files, only the names are used
+     * \param[in] gt_indices index of each ground truth file
+     * \param[in] gt_segmentations ground truth segmentations
+     * \param[in] single_gt whether a single ground truth of the same name is used
+     * \param[out] image_result results
+     * \param[in] gt_entries cached boundary maps of the ground truths, if available
+     * \param[in] edges edge map of the image as computed by computeEdges, if available;
+     * allows to share it across all segmentations of the same image
+     * \param[in,out] pixel_statistics precomputed color moments and intersections,
+     * e.g. by GPUEvaluation, if available; moved into the evaluation
+     */
+    void evaluateSegmentation(const boost::filesystem::path &sp_file,
+            const cv::Mat &image, const cv::Mat &sp_segmentation,
+            const std::vector<boost::filesystem::path> &gt_files,
+            const std::vector<int> &gt_indices,
+            const std::vector<cv::Mat> &gt_segmentations, bool single_gt,
+            ImageResult &image_result, 
+            const std::vector<GroundTruthCache::Entry> *gt_entries = NULL,
+            const cv::Mat *edges = NULL, 
+            Evaluation::PixelStatistics *pixel_statistics = NULL);
+    
+    /** \brief Compute the edge map of an image used for Edge Recall.
+     * \param[in] image image
+     * \param[out] edges Canny edge map as unsigned char image
+     */
+    static void computeEdges(const cv::Mat &image, cv::Mat &edges);
+
     /** \brief Add CSV file to append CSV output to.
      * \param[in] append_file path to CSV file to append to
      */
     void setAppendFile(const boost::filesystem::path &append_file);
     
+    /** \brief Read the peak memory of each image from memory.csv as written by
+     * the command line tools with --memory, see MemoryProfile; adds the metric
+     * peak_memory (peak resident set size in MiB) to results and summary.
+     * \param[in] memory_file path to memory.csv
+     * \return whether the file could be read
+     */
+    bool setMemoryFile(const boost::filesystem::path &memory_file);
+    
     /** \brief Set the evaluation statistics to compute.
      * \param[in] evaluation_statistics evaluation statistics to compute
      */
@@ -226,13 +336,137 @@ public:
      */
     bool getComputeCorrelation();
     
+    /** \brief Set the number of threads used to evaluate images in parallel.
+     * 
+     * Images are evaluated independently; the results are still written
+     * in the order of the superpixel segmentation files. The statistics of
+     * the individual metrics are also summarized in parallel. Threads are
+     * taken from the global ThreadPool.
+     * 
+     * \param[in] threads number of threads, 1 for serial evaluation
+     */
+    void setThreads(int threads);
+    
+    /** \brief Get the number of threads used.
+     * \return number of threads
+     */
+    int getThreads();
+    
+    /** \brief Set whether to summarize in a single pass with bounded memory.
+     * 
+     * Results are streamed to the results CSV file and summarized using
+     * OnlineStatistics per metric and ground truth; means, standard deviations,
+     * minima and maxima are exact while median and quartiles are approximated.
+     * The results matrix (results.csv.txt) is not written and getImageResults
+     * returns no results.
+     * 
+     * \param[in] online_statistics whether to compute online statistics
+     */
+    void setOnlineStatistics(bool online_statistics);
+    
+    /** \brief Get whether online statistics are computed.
+     * \return whether to compute online statistics
+     */
+    bool getOnlineStatistics();
+    
+    /** \brief Set whether to compute color moments and intersections with the
+     * ground truths on the GPU, see GPUEvaluation; computeSummaries batches all
+     * segmentations of an image. Falls back to the CPU if no GPU is available.
+     * \param[in] gpu_evaluation whether to use the GPU
+     */
+    void setGPUEvaluation(bool gpu_evaluation);
+    
+    /** \brief Get whether the GPU is used.
+     * \return whether to use the GPU
+     */
+    bool getGPUEvaluation();
+    
+    /** \brief Set whether to time each metric, reading images, segmentations
+     * and ground truths, visualizations and writing results.
+     * 
+     * Wall times are added up over all evaluated images (and threads) and
+     * written to timing.csv next to results.csv together with the summary.
+     * Statistics shared by several metrics, e.g. the intersection with the
+     * ground truth, are attributed to the first metric using them.
+     * 
+     * \param[in] timings whether to time the evaluation
+     */
+    void setTimings(bool timings);
+    
+    /** \brief Get whether the evaluation is timed.
+     * \return whether to time the evaluation
+     */
+    bool getTimings();
+    
+    /** \brief Memoize the results per superpixel segmentation, image and ground
+     * truth, such that duplicate segmentations are not evaluated again; not
+     * used if visualizations are computed.
+     * \param[in] evaluation_memo memo to use, needs to outlive the summary
+     */
+    void setEvaluationMemo(EvaluationMemo* evaluation_memo);
+    
+    /** \brief Load ground truth segmentations and their boundary maps from a
+     * persistent cache instead of parsing them for each evaluated algorithm.
+     * \param[in] ground_truth_cache cache to use, needs to outlive the summary
+     */
+    void setGroundTruthCache(GroundTruthCache* ground_truth_cache);
+    
+    /** \brief Set a checkpoint file the results of each evaluated image are
+     * appended to, and flushed, as soon as they are available.
+     * 
+     * If the file exists when computeSummary is called, the images found in it
+     * are not evaluated again, i.e. an interrupted evaluation is resumed;
+     * an incomplete last record, e.g. after a crash, is discarded.
+     * 
+     * \param[in] checkpoint_file path to the checkpoint file
+     */
+    void setCheckpointFile(const boost::filesystem::path &checkpoint_file);
+    
+    /** \brief Add the results of a checkpoint file written by another run, e.g.
+     * by another shard, as if added using addImageResult; results of images
+     * already added are ignored.
+     * \param[in] checkpoint_file path to the checkpoint file
+     * \return number of results added
+     */
+    int addCheckpointFile(const boost::filesystem::path &checkpoint_file);
+    
+    /** \brief Only evaluate every shards-th superpixel segmentation, starting
+     * with the shard-th one, in the order of the directory listing.
+     * 
+     * If multiple shards are used, only the checkpoint file is written while
+     * results, correlation, summary and append file are not; the summary is
+     * computed by a final run adding the checkpoint files of all shards.
+     * 
+     * \param[in] shard index of the shard
+     * \param[in] shards number of shards, 1 to evaluate all segmentations
+     */
+    void setShard(int shard, int shards);
+    
 protected:
     
+    /** \brief Adds the wall time of its scope to the timings, see setTimings. */
+    class TimingScope;
+    
+    /** \brief Write the timings to the timing file, if enabled. */
+    void writeTimings();
+    
     /** \brief Count number of metrics used.
      * \return number of metrics to compute
      */
     int countMetrics();
     
+    /** \brief Whether the enabled metrics or visualizations need the image;
+     * otherwise images are not read.
+     * \return whether the image is required
+     */
+    bool requiresImage();
+    
+    /** \brief Whether the enabled metrics or visualizations need the ground
+     * truth segmentations; otherwise only their names are used.
+     * \return whether the ground truth is required
+     */
+    bool requiresGroundTruth();
+    
     /** \brief Add header to output.
      * \param[in] output the header of the CSV file to create
      * \param[out] metric_order the order of the metrics
@@ -249,15 +483,95 @@ protected:
     void evaluate(const cv::Mat &sp_segmentation, const cv::Mat &gt_segmentation, 
             const cv::Mat &image, cv::Mat &data, std::stringstream &output);
     
+    /** \brief Actually do the evaluation using a fused evaluation, i.e. intermediate
+     * results only depending on the superpixel segmentation are shared across
+     * ground truth segmentations.
+     * \param[in] fused fused evaluation of the superpixel segmentation and image
+     * \param[in] gt_segmentation ground truth segmentation as int image
+     * \param[in] data data matrix to append results to
+     * \param[in] output CSV file stream to append results to
+     */
+    void evaluate(FusedEvaluation &fused, const cv::Mat &gt_segmentation, 
+            cv::Mat &data, std::stringstream &output);
+    
+    /** \brief Actually do the evaluation using a fused evaluation against its
+     * selected ground truth segmentation, see FusedEvaluation::selectGroundTruth.
+     * \param[in] fused fused evaluation of the superpixel segmentation and image
+     * \param[in] data data matrix to append results to
+     * \param[in] output CSV file stream to append results to
+     * \param[in] memory peak memory of the segmentation in MiB, only used if a
+     * memory file is set
+     */
+    void evaluate(FusedEvaluation &fused, cv::Mat &data, std::stringstream &output,
+            float memory = 0);
+    
+    /** \brief Evaluate a single superpixel segmentation against all corresponding
+     * ground truth segmentations.
+     * \param[in] sp_file path to the superpixel segmentation
+     * \param[in] i index of the superpixel segmentation, for logging
+     * \param[in] n number of superpixel segmentations, for logging
+     * \param[out] data data matrix to append results to, one row per ground truth
+     * \param[out] output CSV rows of the results
+     * \param[out] gt ground truth indices used
+     */
+    void evaluateImage(const boost::filesystem::path &sp_file, int i, int n,
+            cv::Mat &data, std::string &output, std::vector<int> &gt);
+    
+    /** \brief List the superpixel segmentations in the superpixel directory.
+     * \param[out] sp_files superpixel segmentations by path
+     */
+    void listSegmentations(std::multimap<std::string, boost::filesystem::path> &sp_files);
+    
+    /** \brief Read the image of a superpixel segmentation as PNG or JPEG.
+     * \param[in] sp_file superpixel segmentation, only the name is used
+     * \param[out] image image
+     */
+    void readImage(const boost::filesystem::path &sp_file, cv::Mat &image);
+    
+    /** \brief Read a superpixel segmentation.
+     * \param[in] sp_file path to the superpixel segmentation
+     * \param[in] image corresponding image to check the size against, may be empty
+     * \param[out] sp_segmentation superpixel segmentation
+     */
+    void readSegmentation(const boost::filesystem::path &sp_file, const cv::Mat &image,
+            cv::Mat &sp_segmentation);
+    
+    /** \brief Find and read the ground truth segmentations of a superpixel segmentation.
+     * \param[in] sp_file superpixel segmentation, only the name is used
+     * \param[in] rows expected number of rows
+     * \param[in] cols expected number of columns
+     * \param[in] ground_truth whether to read the segmentations or only find their names
+     * \param[out] gt_files ground truth files found
+     * \param[out] gt_indices index of each ground truth file
+     * \param[out] gt_segmentations ground truth segmentations, empty if not read
+     * \param[out] gt_entries cached boundary maps of the ground truths, if a cache is set
+     * \return whether a single ground truth of the same name was found
+     */
+    bool readGroundTruths(const boost::filesystem::path &sp_file, int rows, int cols,
+            bool ground_truth, std::vector<boost::filesystem::path> &gt_files, 
+            std::vector<int> &gt_indices, std::vector<cv::Mat> &gt_segmentations,
+            std::vector<GroundTruthCache::Entry> &gt_entries);
+    
+    /** \brief Read the results from a checkpoint file into added_results.
+     * \param[in] checkpoint_file path to checkpoint file
+     * \param[in] truncate whether to discard an invalid or incomplete tail
+     * \return number of results added
+     */
+    int readCheckpointFile(const boost::filesystem::path &checkpoint_file, bool truncate);
+    
+    /** \brief Append the results of an image to the checkpoint file, if open.
+     * \param[in] image_result results of the image
+     */
+    void writeCheckpoint(const ImageResult &image_result);
+    
     /** \brief Visualize given segmentation.
-     * \param[in] sp_segmentation superpixel labels as int image
+     * \param[in] context boundaries and means of the segmentation and the image, shared by all ground truths
      * \param[in] gt_segmentation ground truth segmentation as int image
-     * \param[in] image corresponding image
      * \param[in] name name or identifier of image to visualize
      * \param[in] t ground truth number
      */
-    void visualize(const cv::Mat &sp_segmentation, const cv::Mat &gt_segmentation,
-            const cv::Mat &image, std::string name, int t = 0);
+    void visualize(const Visualization::Context &context, const cv::Mat &gt_segmentation,
+            std::string name, int t = 0);
     
     /** \brief Compute correlation between all metrics.
      * \param[in] mat_results matrix containing results in order to compute correlatiom
@@ -268,6 +582,22 @@ protected:
     void correlate(const cv::Mat &mat_results, const std::vector<std::string> &metric_order,
             cv::Mat &mat_correlation, std::string &csv_correlation);
     
+    /** \brief Compute correlation between all metrics from their covariance.
+     * \param[in] covariance covariance matrix of the metrics
+     * \param[in] metric_order order of metrix used in covariance
+     * \param[out] mat_correlation correlation matrix
+     * \param[out] csv_correlation correlation matrix as CSV string
+     */
+    void correlate(const std::vector< std::vector<float> > &covariance, 
+            const std::vector<std::string> &metric_order, cv::Mat &mat_correlation, 
+            std::string &csv_correlation);
+    
+    /** \brief Write correlation matrix to the correlation file.
+     * \param[in] mat_correlation correlation matrix
+     * \param[in] csv_correlation correlation matrix as CSV string
+     */
+    void writeCorrelation(const cv::Mat &mat_correlation, const std::string &csv_correlation);
+    
     /** \brief Count the number of statistics to be used.
      * \param[in] gt_max maximum number of ground truth segmentations to consider
      * \return number of statistics
@@ -294,6 +624,38 @@ protected:
     void summarize(const std::vector<int> &gt, const cv::Mat &data, 
             int j, cv::Mat &mat_summary, std::stringstream &output);
     
+    /** \brief Summarize a metric from online statistics, using the same columns
+     * as summarize.
+     * \param[in] statistics statistics for each ground truth segmentation
+     * \param[in] image_min statistics of the per-image minimum over ground truth segmentations
+     * \param[in] image_max statistics of the per-image maximum over ground truth segmentations
+     * \param[in] gt_max maximum ground truth index
+     * \param[out] mat_summary summary as matrix
+     * \param[out] output summary as CSV string
+     */
+    void summarizeOnline(const std::vector<OnlineStatistics> &statistics, 
+            const OnlineStatistics &image_min, const OnlineStatistics &image_max,
+            int gt_max, cv::Mat &mat_summary, std::stringstream &output);
+    
+    /** \brief Summarize the given superpixel segmentations and added results in
+     * a single pass, see setOnlineStatistics.
+     * \param[in] sp_paths superpixel segmentations to evaluate
+     * \param[in] csv_header header of the results CSV file
+     * \param[in] metric_order the order of the metrics
+     * \param[out] gt_max the maxmimum number of ground truth used
+     */
+    void computeOnlineSummary(const std::vector<boost::filesystem::path> &sp_paths,
+            const std::string &csv_header, const std::vector<std::string> &metric_order,
+            int &gt_max);
+    
+    /** \brief Write the summary to the summary file and, if set, the append file.
+     * \param[in] csv_summary_header header of the summary
+     * \param[in] csv_summary summary as CSV string
+     * \param[in] mat_summary summary as matrix
+     */
+    void writeSummary(const std::stringstream &csv_summary_header, 
+            const std::stringstream &csv_summary, const cv::Mat &mat_summary);
+    
     /** \brief Compute mean statistic.
      * \param[in] gt ground truth indices to determine the number of ground truth segmentations
      * \param[in] data data to summarize
@@ -372,6 +734,40 @@ protected:
     
     /** \brief Whether to compute correlation. */
     bool compute_correlation;
+    /** \brief Number of threads used to evaluate images. */
+    int threads;
+    /** \brief Whether to summarize using online statistics. */
+    bool online_statistics;
+    /** \brief Whether to compute color moments and intersections on the GPU. */
+    bool gpu_evaluation;
+    /** \brief Whether to time the evaluation. */
+    bool timings;
+    /** \brief Total wall time in seconds by metric or stage. */
+    std::map<std::string, double> timing_seconds;
+    /** \brief Number of timed calls by metric or stage. */
+    std::map<std::string, int> timing_counts;
+    /** \brief Mutex protecting timing_seconds and timing_counts. */
+    std::mutex timing_mutex;
+    /** \brief Memo of evaluation results, if set. */
+    EvaluationMemo* evaluation_memo;
+    /** \brief Cache of ground truth segmentations, if set. */
+    GroundTruthCache* ground_truth_cache;
+    /** \brief Index of the shard to evaluate. */
+    int shard;
+    /** \brief Number of shards. */
+    int shards;
+    
+    /** \brief Checkpoint file, if set. */
+    boost::filesystem::path checkpoint_file;
+    /** \brief Stream to the checkpoint file while computing the summary. */
+    std::ofstream checkpoint_stream;
+    /** \brief Mutex protecting checkpoint_stream. */
+    std::mutex checkpoint_mutex;
+    
+    /** \brief Results added using addImageResult. */
+    std::vector<ImageResult> added_results;
+    /** \brief Results of the last call to computeSummary. */
+    std::vector<ImageResult> image_results;
     
     /** \brief Directory of superpixel segmentations. */
     boost::filesystem::path sp_directory;
@@ -385,10 +781,14 @@ protected:
     boost::filesystem::path correlation_file;
     /** \brief Path to summary file. */
     boost::filesystem::path summary_file;
+    /** \brief Path to timing file. */
+    boost::filesystem::path timing_file;
     /** \brief Path to visualization directory. */
     boost::filesystem::path vis_directory;
     /** \brief Path to file to append summary to. */
     boost::filesystem::path append_file;
+    /** \brief Peak memory in MiB by segmentation name, see setMemoryFile. */
+    std::map<std::string, float> peak_memory;
 };
 
 #endif	/* EVALUATION_SUMMARY_H */
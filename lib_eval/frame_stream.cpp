@@ -0,0 +1,365 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <glog/logging.h>
+#include "io_util.h"
+#include "frame_stream.h"
+
+const char FRAME_RING_MAGIC[4] = {'S', 'P', 'R', 'G'};
+const uint32_t FRAME_RING_VERSION = 1;
+
+/** \brief Offset of the first slot, keeps the counters and the slots on
+ * separate cache lines. */
+const size_t FRAME_RING_OFFSET = (sizeof(FrameRing::Header) + 63)/64*64;
+
+/** \brief Polling interval while waiting for the other process. */
+const std::chrono::microseconds FRAME_RING_POLL(100);
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+        "FrameRing needs lock-free atomics to be shared across processes.");
+
+////////////////////////////////////////////////////////////////////////////////
+// FrameRing
+////////////////////////////////////////////////////////////////////////////////
+
+FrameRing::FrameRing() : header(NULL), size(0), producer(false) {
+    
+}
+
+FrameRing::~FrameRing() {
+    close();
+}
+
+bool FrameRing::map(int fd, size_t map_size) {
+    void* mapping = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    
+    header = static_cast<Header*>(mapping);
+    size = map_size;
+    return true;
+}
+
+bool FrameRing::create(const std::string &name, size_t message_size, int slots) {
+    close();
+    
+    if (slots <= 0) {
+        return false;
+    }
+    
+    std::string shm_name = "/" + name;
+    shm_unlink(shm_name.c_str());
+    
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    
+    size_t slot_size = (sizeof(uint64_t) + message_size + 63)/64*64;
+    size_t map_size = FRAME_RING_OFFSET + slot_size*slots;
+    
+    if (ftruncate(fd, map_size) != 0 || !map(fd, map_size)) {
+        shm_unlink(shm_name.c_str());
+        return false;
+    }
+    
+    // The memory is zero after ftruncate; the magic is written last such that
+    // a consumer does not see a partially initialized header.
+    header->version = FRAME_RING_VERSION;
+    header->slot_size = slot_size;
+    header->slots = slots;
+    header->written.store(0);
+    header->read.store(0);
+    header->closed.store(0);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, FRAME_RING_MAGIC, 4);
+    
+    producer = true;
+    return true;
+}
+
+bool FrameRing::open(const std::string &name) {
+    close();
+    
+    std::string shm_name = "/" + name;
+    int fd = -1;
+    
+    // The producer may be started after the consumer.
+    struct stat shm_stat;
+    while (true) {
+        fd = shm_open(shm_name.c_str(), O_RDWR, 0600);
+        if (fd >= 0) {
+            if (fstat(fd, &shm_stat) != 0) {
+                ::close(fd);
+                return false;
+            }
+            
+            if ((size_t) shm_stat.st_size >= FRAME_RING_OFFSET) {
+                break;
+            }
+            
+            ::close(fd);
+        }
+        
+        std::this_thread::sleep_for(FRAME_RING_POLL);
+    }
+    
+    if (!map(fd, shm_stat.st_size)) {
+        return false;
+    }
+    
+    while (memcmp(header->magic, FRAME_RING_MAGIC, 4) != 0) {
+        std::this_thread::sleep_for(FRAME_RING_POLL);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    
+    if (header->version != FRAME_RING_VERSION || header->slots == 0
+            || header->slot_size <= sizeof(uint64_t)
+            || FRAME_RING_OFFSET + header->slot_size*header->slots > size) {
+        close();
+        return false;
+    }
+    
+    producer = false;
+    return true;
+}
+
+bool FrameRing::write(const void* data, size_t message_size) {
+    LOG_IF(FATAL, header == NULL || !producer) << "Ring not created.";
+    
+    if (message_size > getMessageSize()) {
+        return false;
+    }
+    
+    uint64_t written = header->written.load(std::memory_order_relaxed);
+    while (written - header->read.load(std::memory_order_acquire) >= header->slots) {
+        std::this_thread::sleep_for(FRAME_RING_POLL);
+    }
+    
+    char* slot = reinterpret_cast<char*>(header) + FRAME_RING_OFFSET 
+            + (written % header->slots)*header->slot_size;
+    
+    uint64_t slot_message_size = message_size;
+    memcpy(slot, &slot_message_size, sizeof(uint64_t));
+    memcpy(slot + sizeof(uint64_t), data, message_size);
+    
+    header->written.store(written + 1, std::memory_order_release);
+    return true;
+}
+
+bool FrameRing::read(std::vector<char> &message) {
+    LOG_IF(FATAL, header == NULL || producer) << "Ring not opened.";
+    
+    uint64_t read = header->read.load(std::memory_order_relaxed);
+    while (header->written.load(std::memory_order_acquire) == read) {
+        // Written is checked again as the last message may have been written
+        // right before closing.
+        if (header->closed.load(std::memory_order_acquire) != 0
+                && header->written.load(std::memory_order_acquire) == read) {
+            return false;
+        }
+        
+        std::this_thread::sleep_for(FRAME_RING_POLL);
+    }
+    
+    const char* slot = reinterpret_cast<const char*>(header) + FRAME_RING_OFFSET 
+            + (read % header->slots)*header->slot_size;
+    
+    uint64_t message_size;
+    memcpy(&message_size, slot, sizeof(uint64_t));
+    message_size = std::min<uint64_t>(message_size, getMessageSize());
+    
+    message.resize(message_size);
+    memcpy(message.data(), slot + sizeof(uint64_t), message_size);
+    
+    header->read.store(read + 1, std::memory_order_release);
+    return true;
+}
+
+void FrameRing::close() {
+    if (header != NULL) {
+        if (producer) {
+            header->closed.store(1, std::memory_order_release);
+        }
+        
+        munmap(header, size);
+    }
+    
+    header = NULL;
+    size = 0;
+    producer = false;
+}
+
+size_t FrameRing::getMessageSize() const {
+    if (header == NULL) {
+        return 0;
+    }
+    
+    return header->slot_size - sizeof(uint64_t);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FrameStream
+////////////////////////////////////////////////////////////////////////////////
+
+bool FrameStream::parseSize(const std::string &size_string, cv::Size &size) {
+    int width = 0;
+    int height = 0;
+    char trailing = 0;
+    
+    if (sscanf(size_string.c_str(), "%dx%d%c", &width, &height, &trailing) != 2
+            || width <= 0 || height <= 0) {
+        return false;
+    }
+    
+    size = cv::Size(width, height);
+    return true;
+}
+
+bool FrameStream::isStdout(const std::string &output) {
+    return output == "-";
+}
+
+FrameStream::FrameStream() : input_stdin(true), output_stdout(true), count(0) {
+    
+}
+
+bool FrameStream::open(const std::string &input, const std::string &output, 
+        const cv::Size &frame_size, int slots) {
+    close();
+    
+    size = frame_size;
+    count = 0;
+    
+    const std::string shm_prefix = "shm:";
+    
+    input_stdin = (input == "-");
+    if (!input_stdin) {
+        if (input.compare(0, shm_prefix.size(), shm_prefix) != 0
+                || !input_ring.open(input.substr(shm_prefix.size()))) {
+            return false;
+        }
+        
+        if (input_ring.getMessageSize() < (size_t) size.area()*3) {
+            close();
+            return false;
+        }
+    }
+    
+    output_stdout = isStdout(output);
+    if (!output_stdout) {
+        // Binary label maps are never larger than the raw 32-bit labels
+        // plus header.
+        if (output.compare(0, shm_prefix.size(), shm_prefix) != 0
+                || !output_ring.create(output.substr(shm_prefix.size()), 
+                        (size_t) size.area()*sizeof(int32_t) + 64, slots)) {
+            close();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool FrameStream::read(cv::Mat &frame) {
+    size_t frame_size = (size_t) size.area()*3;
+    
+    if (input_stdin) {
+        buffer.resize(frame_size);
+        
+        size_t read = 0;
+        while (read < frame_size) {
+            size_t bytes = fread(buffer.data() + read, 1, frame_size - read, stdin);
+            if (bytes == 0) {
+                // A partial frame at the end of the stream is dropped.
+                return false;
+            }
+            
+            read += bytes;
+        }
+    }
+    else {
+        do {
+            if (!input_ring.read(buffer)) {
+                return false;
+            }
+            
+            LOG_IF(WARNING, buffer.size() != frame_size) << "Skipping frame of "
+                    << buffer.size() << " bytes, expected " << frame_size << " bytes.";
+        } while (buffer.size() != frame_size);
+    }
+    
+    // No copy, the frame points into the buffer.
+    frame = cv::Mat(size, CV_8UC3, buffer.data());
+    count++;
+    
+    return true;
+}
+
+bool FrameStream::write(const cv::Mat &labels) {
+    std::vector<char> encoded;
+    IOUtil::encodeMatBinaryInt(labels, encoded);
+    
+    if (output_stdout) {
+        if (fwrite(encoded.data(), 1, encoded.size(), stdout) != encoded.size()) {
+            return false;
+        }
+        
+        // Downstream processes the label maps live.
+        return fflush(stdout) == 0;
+    }
+    
+    return output_ring.write(encoded.data(), encoded.size());
+}
+
+void FrameStream::close() {
+    input_ring.close();
+    output_ring.close();
+    
+    if (output_stdout) {
+        fflush(stdout);
+    }
+}
+
+int FrameStream::getCount() const {
+    return count;
+}
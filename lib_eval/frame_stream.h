@@ -0,0 +1,257 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FRAME_STREAM_H
+#define	FRAME_STREAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/** \brief Single producer, single consumer ring buffer of messages in POSIX
+ * shared memory (see shm_open), e.g. to pass frames between processes
+ * without pipes.
+ * 
+ * The shared memory object starts with a FrameRing::Header followed by
+ * the slots; each slot starts with the size of its message as 64-bit
+ * integer followed by the message. The producer writes slot written % slots
+ * and increments written, the consumer reads slot read % slots and
+ * increments read; the producer waits while written - read == slots, the
+ * consumer waits while written == read. After the last message the producer
+ * sets closed. The producer creates the ring, an existing ring of the same
+ * name is replaced; the ring is not removed when closing such that the
+ * consumer may attach late, it is up to the consumer to remove it using
+ * shm_unlink (or rm /dev/shm/name).
+ * 
+ * Usage:
+ * \code{cpp}
+ *   // Producer.
+ *   FrameRing ring;
+ *   ring.create("frames", 640*480*3, 4);
+ *   ring.write(frame.data, 640*480*3);
+ *   ring.close();
+ *   
+ *   // Consumer.
+ *   FrameRing ring;
+ *   ring.open("frames");
+ *   std::vector<char> message;
+ *   while (ring.read(message)) {
+ *       // ...
+ *   }
+ * \endcode
+ * \author David Stutz
+ */
+class FrameRing {
+public:
+    
+    /** \brief Header at the start of the shared memory object. */
+    struct Header {
+        /** \brief Magic, always "SPRG". */
+        char magic[4];
+        /** \brief Version of the layout. */
+        uint32_t version;
+        /** \brief Size of a slot in bytes, including the 64-bit size. */
+        uint64_t slot_size;
+        /** \brief Number of slots. */
+        uint64_t slots;
+        /** \brief Number of messages written. */
+        std::atomic<uint64_t> written;
+        /** \brief Number of messages read. */
+        std::atomic<uint64_t> read;
+        /** \brief Set to 1 by the producer after the last message. */
+        std::atomic<uint32_t> closed;
+    };
+    
+    /** \brief Constructor. */
+    FrameRing();
+    
+    /** \brief Destructor, closes the ring. */
+    ~FrameRing();
+    
+    /** \brief Create a ring as producer, closing a previously opened one.
+     * \param[in] name name of the shared memory object, without leading /
+     * \param[in] message_size maximum size of a message in bytes
+     * \param[in] slots number of slots
+     * \return whether the ring could be created
+     */
+    bool create(const std::string &name, size_t message_size, int slots);
+    
+    /** \brief Open an existing ring as consumer, closing a previously opened one;
+     * waits for the ring to be created.
+     * \param[in] name name of the shared memory object, without leading /
+     * \return whether the ring could be opened
+     */
+    bool open(const std::string &name);
+    
+    /** \brief Write a message, waits while the ring is full.
+     * \param[in] data message
+     * \param[in] size size of the message in bytes
+     * \return whether the message was written, false if it does not fit into a slot
+     */
+    bool write(const void* data, size_t size);
+    
+    /** \brief Read the next message, waits while the ring is empty.
+     * \param[out] message message
+     * \return whether a message was read, false if the ring is closed and empty
+     */
+    bool read(std::vector<char> &message);
+    
+    /** \brief Unmap the ring; as producer, the ring is marked closed first. */
+    void close();
+    
+    /** \brief Get the maximum size of a message.
+     * \return maximum size of a message in bytes
+     */
+    size_t getMessageSize() const;
+    
+private:
+    
+    /** \brief Map the shared memory object.
+     * \param[in] fd file descriptor of the shared memory object
+     * \param[in] size size to map in bytes
+     * \return whether the object could be mapped
+     */
+    bool map(int fd, size_t size);
+    
+    /** \brief Mapped shared memory, NULL if closed. */
+    Header* header;
+    /** \brief Size of the mapping in bytes. */
+    size_t size;
+    /** \brief Whether this is the producer. */
+    bool producer;
+    
+};
+
+/** \brief Raw frames read from stdin or a FrameRing and label maps written 
+ * to stdout or a FrameRing, such that the command line tools can be used
+ * in live pipelines without writing and decoding image files.
+ * 
+ * Frames are BGR images of fixed size, 3 bytes per pixel in row-major order
+ * without any header (for ffmpeg, -f rawvideo -pix_fmt bgr24). Label maps
+ * are written in the binary label format, see IOUtil::encodeMatBinaryInt,
+ * which is self-delimiting through its header. Endpoints are given as - for
+ * stdin/stdout or shm:name for a shared memory ring; the input ring is
+ * created by the producer of the frames, one message per frame, the
+ * output ring is created here with one message per label map. For example:
+ * \code{sh}
+ *   $ ffmpeg -i video.mp4 -f rawvideo -pix_fmt bgr24 - | ../bin/slic_cli --stream 640x480 > labels.bin
+ * \endcode
+ * 
+ * Usage:
+ * \code{cpp}
+ *   cv::Size size;
+ *   FrameStream::parseSize("640x480", size);
+ *   
+ *   FrameStream stream;
+ *   stream.open("-", "shm:labels", size);
+ *   
+ *   cv::Mat frame;
+ *   while (stream.read(frame)) {
+ *       cv::Mat labels;
+ *       // ...
+ *       stream.write(labels);
+ *   }
+ * \endcode
+ * \author David Stutz
+ */
+class FrameStream {
+public:
+    
+    /** \brief Parse a frame size given as WIDTHxHEIGHT.
+     * \param[in] size_string frame size, e.g. 640x480
+     * \param[out] size parsed frame size
+     * \return whether the frame size is valid
+     */
+    static bool parseSize(const std::string &size_string, cv::Size &size);
+    
+    /** \brief Check whether the endpoint writes to stdout, i.e. other output
+     * needs to go to stderr.
+     * \param[in] output output endpoint
+     * \return whether output is stdout
+     */
+    static bool isStdout(const std::string &output);
+    
+    /** \brief Constructor. */
+    FrameStream();
+    
+    /** \brief Open the endpoints, closing previously opened ones.
+     * \param[in] input - for stdin or shm:name
+     * \param[in] output - for stdout or shm:name
+     * \param[in] size frame size
+     * \param[in] slots number of slots of the output ring
+     * \return whether both endpoints could be opened
+     */
+    bool open(const std::string &input, const std::string &output, 
+            const cv::Size &size, int slots = 4);
+    
+    /** \brief Read the next frame.
+     * \param[out] frame frame as CV_8UC3, the memory is reused across frames
+     * \return whether a frame was read, false at the end of the stream
+     */
+    bool read(cv::Mat &frame);
+    
+    /** \brief Write a label map.
+     * \param[in] labels label map as CV_32SC1 or CV_16UC1
+     * \return whether the label map was written
+     */
+    bool write(const cv::Mat &labels);
+    
+    /** \brief Close the endpoints, marking the output ring closed. */
+    void close();
+    
+    /** \brief Get the number of frames read so far.
+     * \return number of frames read
+     */
+    int getCount() const;
+    
+private:
+    
+    /** \brief Frame size. */
+    cv::Size size;
+    /** \brief Input ring, if not reading from stdin. */
+    FrameRing input_ring;
+    /** \brief Output ring, if not writing to stdout. */
+    FrameRing output_ring;
+    /** \brief Whether to read from stdin. */
+    bool input_stdin;
+    /** \brief Whether to write to stdout. */
+    bool output_stdout;
+    /** \brief Number of frames read. */
+    int count;
+    /** \brief Message buffer, reused across frames. */
+    std::vector<char> buffer;
+    
+};
+
+#endif	/* FRAME_STREAM_H */
@@ -0,0 +1,729 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <limits>
+#include <glog/logging.h>
+#include "evaluation.h"
+#include "evaluation_arena.h"
+#include "superpixel_tools.h"
+#include "fused_evaluation.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+FusedEvaluation::FusedEvaluation()
+        : segmentation_statistics(false), superpixels(0), 
+        color_statistics(false), sse_rgb(0), sse_xy(0), ev(0), icv(0), 
+        distance_transform(false), ground_truth(0), batch_statistics(false), 
+        intersection_statistics(false), gt_boundary_statistics(false),
+        dilation_radius(-1), gt_dilation_radius(-1), 
+        precomputed_gt_dilation_radius(-1) {
+    
+}
+
+FusedEvaluation::FusedEvaluation(const cv::Mat &labels, const cv::Mat &image)
+        : FusedEvaluation() {
+    
+    reset(labels, image);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// reset
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::reset(const cv::Mat &labels_, const cv::Mat &image_) {
+    
+    LOG_IF(FATAL, labels_.type() != CV_32SC1 && labels_.type() != CV_16UC1) 
+            << "Invalid label type.";
+    LOG_IF(FATAL, !image_.empty() && (labels_.rows != image_.rows || labels_.cols != image_.cols)) 
+            << "Superpixel segmentation does not match image size.";
+    
+    // 16-bit labels are widened into a reused buffer as the evaluation
+    // functions expect int labels.
+    if (labels_.type() == CV_16UC1) {
+        SuperpixelTools::widenLabels(labels_, wide_labels);
+        labels = wide_labels;
+    }
+    else {
+        labels = labels_;
+    }
+    
+    image = image_;
+    edges.release();
+    
+    // Move the statistics of the selected ground truth back such that all
+    // intersection lists are reused.
+    if (intersection_statistics) {
+        intersections.swap(batch_intersections[ground_truth]);
+        gt_sizes.swap(batch_gt_sizes[ground_truth]);
+    }
+    
+    ground_truths.clear();
+    precomputed_gt_boundaries.clear();
+    precomputed_gt_dilated_boundaries.clear();
+    precomputed_gt_dilation_radius = -1;
+    gt.release();
+    ground_truth = 0;
+    
+    segmentation_statistics = false;
+    superpixels = 0;
+    color_statistics = false;
+    distance_transform = false;
+    batch_statistics = false;
+    intersection_statistics = false;
+    gt_boundary_statistics = false;
+    dilation_radius = -1;
+    gt_dilation_radius = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setGroundTruth
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::setGroundTruth(const cv::Mat &gt_) {
+    setGroundTruths(std::vector<cv::Mat>(1, gt_));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setGroundTruths
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::setGroundTruths(const std::vector<cv::Mat> &gts) {
+    
+    LOG_IF(FATAL, gts.empty()) << "No ground truth given.";
+    for (unsigned int t = 0; t < gts.size(); ++t) {
+        LOG_IF(FATAL, labels.rows != gts[t].rows || labels.cols != gts[t].cols) 
+                << "Superpixel segmentation does not match ground truth size.";
+    }
+    
+    // Intersection lists are kept and reused by computeIntersectionStatistics.
+    if (intersection_statistics) {
+        intersections.swap(batch_intersections[ground_truth]);
+        gt_sizes.swap(batch_gt_sizes[ground_truth]);
+    }
+    
+    ground_truths = gts;
+    ground_truth = 0;
+    batch_statistics = false;
+    
+    precomputed_gt_boundaries.clear();
+    precomputed_gt_dilated_boundaries.clear();
+    precomputed_gt_dilation_radius = -1;
+    
+    gt = ground_truths[0];
+    intersection_statistics = false;
+    gt_boundary_statistics = false;
+    gt_dilation_radius = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setGroundTruthBoundaries
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::setGroundTruthBoundaries(const std::vector<cv::Mat> &boundaries,
+        const std::vector<cv::Mat> &dilated_boundaries, int r) {
+    
+    LOG_IF(FATAL, boundaries.size() != ground_truths.size() 
+            || dilated_boundaries.size() != ground_truths.size()) 
+            << "Boundary maps do not match ground truths.";
+    for (unsigned int t = 0; t < boundaries.size(); ++t) {
+        LOG_IF(FATAL, boundaries[t].rows != labels.rows || boundaries[t].cols != labels.cols
+                || dilated_boundaries[t].rows != labels.rows 
+                || dilated_boundaries[t].cols != labels.cols) 
+                << "Boundary maps do not match ground truth size.";
+    }
+    
+    precomputed_gt_boundaries = boundaries;
+    precomputed_gt_dilated_boundaries = dilated_boundaries;
+    precomputed_gt_dilation_radius = r;
+    
+    gt_boundary_statistics = false;
+    gt_dilation_radius = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setEdges
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::setEdges(const cv::Mat &edges_) {
+    
+    LOG_IF(FATAL, edges_.rows != labels.rows || edges_.cols != labels.cols) 
+            << "Edge map does not match superpixel segmentation size.";
+    LOG_IF(FATAL, edges_.type() != CV_8UC1) << "Invalid edge map type.";
+    
+    edges = edges_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setPixelStatistics
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::setPixelStatistics(Evaluation::PixelStatistics &statistics) {
+    
+    if (!statistics.moments.empty()) {
+        LOG_IF(FATAL, image.empty()) << "No image set.";
+        
+        moments.swap(statistics.moments);
+        
+        sse_rgb = Evaluation::computeSumOfSquaredErrorRGB(moments);
+        sse_xy = Evaluation::computeSumOfSquaredErrorXY(moments);
+        ev = Evaluation::computeExplainedVariation(moments);
+        icv = Evaluation::computeIntraClusterVariation(moments);
+        
+        color_statistics = true;
+    }
+    
+    if (!statistics.intersections.empty()) {
+        LOG_IF(FATAL, statistics.intersections.size() != ground_truths.size()
+                || statistics.gt_sizes.size() != ground_truths.size()) 
+                << "Intersection matrices do not match ground truths.";
+        LOG_IF(FATAL, intersection_statistics) << "Intersection statistics already computed.";
+        
+        batch_intersections.swap(statistics.intersections);
+        batch_gt_sizes.swap(statistics.gt_sizes);
+        intersection_superpixel_sizes.swap(statistics.superpixel_sizes);
+        batch_statistics = true;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// selectGroundTruth
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::selectGroundTruth(int t) {
+    
+    LOG_IF(FATAL, t < 0 || t >= (int) ground_truths.size()) 
+            << "Invalid ground truth index: " << t << ".";
+    
+    if (t == ground_truth) {
+        return;
+    }
+    
+    // Move the statistics of the previously selected ground truth back.
+    if (intersection_statistics) {
+        intersections.swap(batch_intersections[ground_truth]);
+        gt_sizes.swap(batch_gt_sizes[ground_truth]);
+    }
+    
+    ground_truth = t;
+    gt = ground_truths[t];
+    intersection_statistics = false;
+    gt_boundary_statistics = false;
+    gt_dilation_radius = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSegmentationStatistics
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::computeSegmentationStatistics() {
+    
+    if (segmentation_statistics) {
+        return;
+    }
+    
+    Evaluation::computeShapeStatistics(labels, shape_statistics, boundaries);
+    superpixels = shape_statistics.areas.size();
+    
+    segmentation_statistics = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeColorStatistics
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::computeColorStatistics() {
+    
+    if (color_statistics) {
+        return;
+    }
+    
+    LOG_IF(FATAL, image.empty()) << "No image set.";
+    Evaluation::computeColorMoments(labels, image, moments);
+    
+    sse_rgb = Evaluation::computeSumOfSquaredErrorRGB(moments);
+    sse_xy = Evaluation::computeSumOfSquaredErrorXY(moments);
+    ev = Evaluation::computeExplainedVariation(moments);
+    icv = Evaluation::computeIntraClusterVariation(moments);
+    
+    color_statistics = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeDistanceTransform
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::computeDistanceTransform() {
+    
+    if (distance_transform) {
+        return;
+    }
+    
+    computeSegmentationStatistics();
+    
+    // Zero on boundary pixels such that the distance to the boundary is computed.
+    EvaluationArena &arena = EvaluationArena::getThreadLocal();
+    EvaluationArena::Scope scope(arena);
+    
+    cv::Mat inverse_boundaries = arena.allocateMat(boundaries.rows, boundaries.cols, CV_8UC1);
+    cv::subtract(cv::Scalar(1), boundaries, inverse_boundaries);
+    cv::distanceTransform(inverse_boundaries, distance, CV_DIST_L2, 3);
+    
+    distance_transform = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeIntersectionStatistics
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::computeIntersectionStatistics() {
+    
+    LOG_IF(FATAL, gt.empty()) << "No ground truth set.";
+    
+    if (intersection_statistics) {
+        return;
+    }
+    
+    computeSegmentationStatistics();
+    
+    if (!batch_statistics) {
+        Evaluation::computeSparseIntersectionMatrices(labels, ground_truths, 
+                batch_intersections, intersection_superpixel_sizes, batch_gt_sizes);
+        batch_statistics = true;
+    }
+    
+    intersections.swap(batch_intersections[ground_truth]);
+    gt_sizes.swap(batch_gt_sizes[ground_truth]);
+    intersection_statistics = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeGroundTruthBoundaries
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::computeGroundTruthBoundaries() {
+    
+    LOG_IF(FATAL, gt.empty()) << "No ground truth set.";
+    
+    if (gt_boundary_statistics) {
+        return;
+    }
+    
+    // Precomputed maps are copied such that they are never written in place
+    // when the buffer is reused for ground truths without precomputed maps.
+    if (!precomputed_gt_boundaries.empty()) {
+        precomputed_gt_boundaries[ground_truth].copyTo(gt_boundaries);
+    }
+    else {
+        Evaluation::computeBoundaryMap(gt, gt_boundaries);
+    }
+    
+    gt_boundary_statistics = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeDilatedBoundaries
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::computeDilatedBoundaries(int r) {
+    
+    computeSegmentationStatistics();
+    computeGroundTruthBoundaries();
+    
+    if (dilation_radius != r) {
+        Evaluation::dilateBoundaryMap(boundaries, r, dilated_boundaries);
+        dilation_radius = r;
+    }
+    
+    if (gt_dilation_radius != r) {
+        if (!precomputed_gt_dilated_boundaries.empty() && precomputed_gt_dilation_radius == r) {
+            precomputed_gt_dilated_boundaries[ground_truth].copyTo(gt_dilated_boundaries);
+        }
+        else {
+            Evaluation::dilateBoundaryMap(gt_boundaries, r, gt_dilated_boundaries);
+        }
+        
+        gt_dilation_radius = r;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeUndersegmentationError
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeUndersegmentationError() {
+    
+    computeIntersectionStatistics();
+    return Evaluation::computeUndersegmentationError(intersections, 
+            shape_statistics.areas, labels.rows*labels.cols);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeOversegmentationError
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeOversegmentationError() {
+    
+    computeIntersectionStatistics();
+    return Evaluation::computeOversegmentationError(intersections, 
+            gt_sizes, labels.rows*labels.cols);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeBoundaryRecall
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeBoundaryRecall(float d, bool dilate) {
+    
+    computeSegmentationStatistics();
+    computeGroundTruthBoundaries();
+    
+    int H = gt.rows;
+    int W = gt.cols;
+    
+    int r = std::round(d*std::sqrt(H*H + W*W));
+    
+    if (!dilate) {
+        return Evaluation::computeBoundaryRecall(boundaries, gt_boundaries, r, false);
+    }
+    
+    computeDilatedBoundaries(r);
+    
+    float tp = 0;
+    float fn = 0;
+
+    for (int i = 0; i < H; i++) {
+        const unsigned char* gt_boundaries_i = gt_boundaries.ptr<unsigned char>(i);
+        const unsigned char* dilated_boundaries_i = dilated_boundaries.ptr<unsigned char>(i);
+        
+        for (int j = 0; j < W; j++) {
+            if (gt_boundaries_i[j] > 0) {
+                if (dilated_boundaries_i[j] > 0) {
+                    tp++;
+                }
+                else {
+                    fn++;
+                }
+            }
+        }
+    }
+    
+    if (tp + fn > 0) {
+        return tp/(tp + fn);
+    }
+    
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeBoundaryPrecision
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeBoundaryPrecision(float d, bool dilate) {
+    
+    computeSegmentationStatistics();
+    computeGroundTruthBoundaries();
+    
+    int H = gt.rows;
+    int W = gt.cols;
+    
+    int r = std::round(d*std::sqrt(H*H + W*W));
+    
+    if (!dilate) {
+        return Evaluation::computeBoundaryPrecision(boundaries, gt_boundaries, r, false);
+    }
+    
+    computeDilatedBoundaries(r);
+    
+    float tp = 0;
+    float fp = 0;
+
+    for (int i = 0; i < H; i++) {
+        const unsigned char* boundaries_i = boundaries.ptr<unsigned char>(i);
+        const unsigned char* gt_boundaries_i = gt_boundaries.ptr<unsigned char>(i);
+        const unsigned char* dilated_boundaries_i = dilated_boundaries.ptr<unsigned char>(i);
+        const unsigned char* gt_dilated_boundaries_i = gt_dilated_boundaries.ptr<unsigned char>(i);
+        
+        for (int j = 0; j < W; j++) {
+            if (gt_boundaries_i[j] > 0) {
+                if (dilated_boundaries_i[j] > 0) {
+                    tp++;
+                }
+            }
+            else if (boundaries_i[j] > 0) {
+                if (gt_dilated_boundaries_i[j] == 0) {
+                    fp++;
+                }
+            }
+        }
+    }
+
+    if (tp + fp > 0) {
+        return tp/(tp + fp);
+    }
+    
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeEdgeRecall
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeEdgeRecall(float d) {
+    
+    LOG_IF(FATAL, edges.empty()) << "No edge map set.";
+    
+    computeSegmentationStatistics();
+    
+    int H = edges.rows;
+    int W = edges.cols;
+    
+    int r = std::round(d*std::sqrt(H*H + W*W));
+    
+    // Only the superpixel boundaries are dilated, the ground truth may not be set.
+    if (dilation_radius != r) {
+        Evaluation::dilateBoundaryMap(boundaries, r, dilated_boundaries);
+        dilation_radius = r;
+    }
+    
+    float tp = 0;
+    float fn = 0;
+    
+    for (int i = 0; i < H; i++) {
+        const unsigned char* edges_i = edges.ptr<unsigned char>(i);
+        const unsigned char* dilated_boundaries_i = dilated_boundaries.ptr<unsigned char>(i);
+        
+        for (int j = 0; j < W; j++) {
+            if (edges_i[j] > 100) {
+                if (dilated_boundaries_i[j] > 0) {
+                    tp++;
+                }
+                else {
+                    fn += ((float) edges_i[j])/255;
+                }
+            }
+        }
+    }
+    
+    if (tp + fn > 0) {
+        return tp/(tp + fn);
+    }
+    
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeNPUndersegmentationError
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeNPUndersegmentationError() {
+    
+    computeIntersectionStatistics();
+    return Evaluation::computeNPUndersegmentationError(intersections, 
+            shape_statistics.areas, labels.rows*labels.cols);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeLevinUndersegmentationError
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeLevinUndersegmentationError() {
+    
+    computeIntersectionStatistics();
+    return Evaluation::computeLevinUndersegmentationError(intersections, 
+            shape_statistics.areas, gt_sizes);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeAchievableSegmentationAccuracy
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeAchievableSegmentationAccuracy() {
+    
+    computeIntersectionStatistics();
+    return Evaluation::computeAchievableSegmentationAccuracy(intersections, 
+            labels.rows*labels.cols);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSumOfSquaredErrorRGB
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeSumOfSquaredErrorRGB() {
+    computeColorStatistics();
+    return sse_rgb;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSumOfSquaredErrorXY
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeSumOfSquaredErrorXY() {
+    computeColorStatistics();
+    return sse_xy;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeExplainedVariation
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeExplainedVariation() {
+    computeColorStatistics();
+    return ev;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeIntraClusterVariation
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeIntraClusterVariation() {
+    computeColorStatistics();
+    return icv;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeMeanDistanceToEdge
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeMeanDistanceToEdge() {
+    
+    computeDistanceTransform();
+    computeGroundTruthBoundaries();
+    
+    float mean_distance_edge = 0;
+    int count = 0;
+    
+    for (int i = 0; i < labels.rows; ++i) {
+        const unsigned char* gt_boundaries_i = gt_boundaries.ptr<unsigned char>(i);
+        const float* distance_i = distance.ptr<float>(i);
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            if (gt_boundaries_i[j] > 0) {
+                mean_distance_edge += distance_i[j];
+                count++;
+            }
+        }
+    }
+    
+    return mean_distance_edge/count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeCompactness
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeCompactness() {
+    
+    computeSegmentationStatistics();
+    return Evaluation::computeCompactness(shape_statistics);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeContourDensity
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeContourDensity() {
+    
+    computeSegmentationStatistics();
+    return Evaluation::computeContourDensity(shape_statistics);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeRegularity
+////////////////////////////////////////////////////////////////////////////////
+
+float FusedEvaluation::computeRegularity() {
+    
+    computeSegmentationStatistics();
+    return Evaluation::computeRegularity(shape_statistics);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSuperpixels
+////////////////////////////////////////////////////////////////////////////////
+
+int FusedEvaluation::computeSuperpixels() {
+    
+    computeSegmentationStatistics();
+    
+    int sum = 0;
+    for (int k = 0; k < superpixels; ++k) {
+        if (shape_statistics.areas[k] > 0) {
+            ++sum;
+        }
+    }
+    
+    return sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSuperpixelSizes
+////////////////////////////////////////////////////////////////////////////////
+
+void FusedEvaluation::computeSuperpixelSizes(float &average_size, int &min_size, 
+        int &max_size, float &size_variation) {
+    
+    computeSegmentationStatistics();
+    
+    unsigned long long int sum = 0;
+    unsigned long long int squared_sum = 0;
+    int count = 0;
+    
+    min_size = std::numeric_limits<int>::max();
+    max_size = 0;
+    
+    for (int k = 0; k < superpixels; ++k) {
+        unsigned long long int size = shape_statistics.areas[k];
+        
+        if (size > 0) {
+            count++;
+            
+            sum += size;
+            squared_sum += size*size;
+            
+            if (shape_statistics.areas[k] < min_size) {
+                min_size = shape_statistics.areas[k];
+            }
+            if (shape_statistics.areas[k] > max_size) {
+                max_size = shape_statistics.areas[k];
+            }
+        }
+    }
+    
+    if (count > 0) {
+        average_size = (double) sum / count;
+        
+        float variance = (double) squared_sum / count - (double) sum / count * (double) sum / count;
+        LOG_IF(ERROR, variance < 0) << "Invalid variance: " << variance <<  " " << squared_sum << " " << sum << " " << count;
+        size_variation = std::sqrt(variance);
+    }
+}
@@ -0,0 +1,327 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FUSED_EVALUATION_H
+#define	FUSED_EVALUATION_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "evaluation.h"
+
+/** \brief Evaluates all metrics of Evaluation on a single superpixel segmentation
+ * while sharing intermediate results between metrics.
+ * 
+ * Statistics only depending on the superpixel segmentation (superpixel sizes,
+ * color moments, boundary map, distance transform) are computed once and
+ * reused for all ground truth segmentations; the intersection matrices with
+ * all ground truth segmentations given to setGroundTruths are computed in a
+ * single pass, the ground truth boundary map once per ground truth.
+ * All intermediate results are computed lazily, i.e. only when a metric
+ * requiring it is requested. The results match the corresponding
+ * Evaluation::compute* methods.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   FusedEvaluation fused(labels, image);
+ *   fused.setGroundTruth(gt);
+ *   float ue = fused.computeUndersegmentationError();
+ *   float rec = fused.computeBoundaryRecall();
+ * \endcode
+ * 
+ * An instance can be reused for further images using reset; buffers keep
+ * their capacity such that evaluating images of similar size does not
+ * allocate memory.
+ * \author David Stutz
+ */
+class FusedEvaluation {
+public:
+    /** \brief Constructor, reset needs to be called before evaluation. */
+    FusedEvaluation();
+    
+    /** \brief Constructor.
+     * \param[in] labels superpixel labels as int image
+     * \param[in] image image corresponding to the superpixel labels
+     */
+    FusedEvaluation(const cv::Mat &labels, const cv::Mat &image);
+    
+    /** \brief Evaluate a new superpixel segmentation; invalidates all statistics
+     * and the ground truths while keeping allocated buffers.
+     * \param[in] labels superpixel labels as CV_32SC1 or CV_16UC1 image
+     * \param[in] image image corresponding to the superpixel labels, may be empty
+     * if no color based metric is computed
+     */
+    void reset(const cv::Mat &labels, const cv::Mat &image);
+    
+    /** \brief Set the ground truth segmentation to evaluate against; invalidates
+     * all ground truth dependent statistics.
+     * \param[in] gt ground truth segmentation as int image
+     */
+    void setGroundTruth(const cv::Mat &gt);
+    
+    /** \brief Set multiple ground truth segmentations to evaluate against, e.g.
+     * from different annotators, and select the first one; the intersection
+     * matrices with all of them are computed in a single pass.
+     * \param[in] gts ground truth segmentations as int images
+     */
+    void setGroundTruths(const std::vector<cv::Mat> &gts);
+    
+    /** \brief Set precomputed boundary maps of the ground truth segmentations
+     * given to setGroundTruths, e.g. from a GroundTruthCache.
+     * \param[in] boundaries boundary maps, one per ground truth segmentation
+     * \param[in] dilated_boundaries dilated boundary maps, one per ground truth segmentation
+     * \param[in] r radius used for dilated_boundaries
+     */
+    void setGroundTruthBoundaries(const std::vector<cv::Mat> &boundaries,
+            const std::vector<cv::Mat> &dilated_boundaries, int r);
+    
+    /** \brief Set the edge map of the image used for edge recall, e.g. computed
+     * once per image using Evaluation::computeCannyEdges; needs to be set
+     * again after reset.
+     * \param[in] edges edge map as unsigned char image
+     */
+    void setEdges(const cv::Mat &edges);
+    
+    /** \brief Use color moments and intersection matrices computed elsewhere,
+     * e.g. on the GPU by GPUEvaluation; needs to be called after reset and
+     * setGroundTruths, the statistics are moved.
+     * \param[in,out] statistics statistics of the segmentation given to reset
+     */
+    void setPixelStatistics(Evaluation::PixelStatistics &statistics);
+    
+    /** \brief Select one of the ground truth segmentations given to setGroundTruths;
+     * statistics of previously selected ground truths are kept.
+     * \param[in] t index of the ground truth segmentation
+     */
+    void selectGroundTruth(int t);
+    
+    /** \brief Undersegmentation Error, see Evaluation::computeUndersegmentationError.
+     * \return UE(gt, labels)
+     */
+    float computeUndersegmentationError();
+    
+    /** \brief Oversegmentation Error, see Evaluation::computeOversegmentationError.
+     * \return OE(gt, labels)
+     */
+    float computeOversegmentationError();
+    
+    /** \brief Boundary Recall, see Evaluation::computeBoundaryRecall.
+     * \param[in] d fraction of the diagonal to use as tolerance
+     * \param[in] dilate whether to use dilated boundary maps instead of scanning windows
+     * \return Rec(labels, gt)
+     */
+    float computeBoundaryRecall(float d = 0.0025, bool dilate = true);
+    
+    /** \brief Boundary Precision, see Evaluation::computeBoundaryPrecision.
+     * \param[in] d fraction of the diagonal to use as tolerance
+     * \param[in] dilate whether to use dilated boundary maps instead of scanning windows
+     * \return Pre(labels, gt)
+     */
+    float computeBoundaryPrecision(float d = 0.0025, bool dilate = true);
+    
+    /** \brief Undersegmentation Error (Neubert, Protzel), see Evaluation::computeNPUndersegmentationError.
+     * \return UE_NP(labels, gt)
+     */
+    float computeNPUndersegmentationError();
+    
+    /** \brief Undersegmentation Error (Levinshtein et al.), see Evaluation::computeLevinUndersegmentationError.
+     * \return UE_Levin(labels, gt)
+     */
+    float computeLevinUndersegmentationError();
+    
+    /** \brief Achievable Segmentation Accuracy, see Evaluation::computeAchievableSegmentationAccuracy.
+     * \return ASA(gt, labels)
+     */
+    float computeAchievableSegmentationAccuracy();
+    
+    /** \brief Sum-of-Squared Error on RGB, see Evaluation::computeSumOfSquaredErrorRGB.
+     * \return sum-of-squared error on RGB
+     */
+    float computeSumOfSquaredErrorRGB();
+    
+    /** \brief Sum-of-Squared Error on XY, see Evaluation::computeSumOfSquaredErrorXY.
+     * \return sum-of-squared error on XY
+     */
+    float computeSumOfSquaredErrorXY();
+    
+    /** \brief Explained Variation, see Evaluation::computeExplainedVariation.
+     * \return explained variation
+     */
+    float computeExplainedVariation();
+    
+    /** \brief Mean Distance to Edge, see Evaluation::computeMeanDistanceToEdge.
+     * \return MDE(labels, gt)
+     */
+    float computeMeanDistanceToEdge();
+    
+    /** \brief Edge Recall on the edge map given to setEdges, see Evaluation::computeEdgeRecall.
+     * \param[in] d fraction of the diagonal to use as tolerance
+     * \return edge recall
+     */
+    float computeEdgeRecall(float d = 0.0025);
+    
+    /** \brief Intra-Cluster Variation, see Evaluation::computeIntraClusterVariation.
+     * \return intra-cluster variation
+     */
+    float computeIntraClusterVariation();
+    
+    /** \brief Compactness, see Evaluation::computeCompactness.
+     * \return CO(labels)
+     */
+    float computeCompactness();
+    
+    /** \brief Contour Density, see Evaluation::computeContourDensity.
+     * \return CD(labels)
+     */
+    float computeContourDensity();
+    
+    /** \brief Regularity, see Evaluation::computeRegularity.
+     * \return regularity
+     */
+    float computeRegularity();
+    
+    /** \brief Number of superpixels, see Evaluation::computeSuperpixels.
+     * \return number of superpixels
+     */
+    int computeSuperpixels();
+    
+    /** \brief Superpixel size statistics, see Evaluation::computeSuperpixelSizes.
+     * \param[out] average_size average size of superpixels
+     * \param[out] min_size minimum size of superpixels
+     * \param[out] max_size maximum size of superpixels
+     * \param[out] size_variation standard deviation of superpixel sizes
+     */
+    void computeSuperpixelSizes(float &average_size, int &min_size, 
+            int &max_size, float &size_variation);
+    
+private:
+    /** \brief Compute superpixel sizes, the superpixel boundary map and perimeters. */
+    void computeSegmentationStatistics();
+    
+    /** \brief Compute mean color and mean position of all superpixels as well
+     * as the color based errors (SSE RGB, SSE XY, EV, ICV). */
+    void computeColorStatistics();
+    
+    /** \brief Compute the distance transform of the superpixel boundaries. */
+    void computeDistanceTransform();
+    
+    /** \brief Compute the sparse intersection matrix with the ground truth. */
+    void computeIntersectionStatistics();
+    
+    /** \brief Compute the 4-connected ground truth boundary map. */
+    void computeGroundTruthBoundaries();
+    
+    /** \brief Dilate the superpixel and ground truth boundary maps.
+     * \param[in] r radius of the window
+     */
+    void computeDilatedBoundaries(int r);
+    
+    /** \brief Superpixel labels. */
+    cv::Mat labels;
+    /** \brief Buffer for widened CV_16UC1 superpixel labels. */
+    cv::Mat wide_labels;
+    /** \brief Image. */
+    cv::Mat image;
+    /** \brief Edge map of the image, empty if not set. */
+    cv::Mat edges;
+    /** \brief Ground truth segmentation. */
+    cv::Mat gt;
+    
+    /** \brief Whether superpixel sizes, boundaries and perimeters are computed. */
+    bool segmentation_statistics;
+    /** \brief Maximum label plus one. */
+    int superpixels;
+    /** \brief Size, perimeter and bounding box of each superpixel. */
+    Evaluation::ShapeStatistics shape_statistics;
+    /** \brief 4-connected boundary map of the superpixels. */
+    cv::Mat boundaries;
+    
+    /** \brief Whether the color statistics are computed. */
+    bool color_statistics;
+    /** \brief Color and position moments of each superpixel. */
+    std::vector<Evaluation::ColorMoments> moments;
+    /** \brief Sum-of-squared error on RGB. */
+    float sse_rgb;
+    /** \brief Sum-of-squared error on XY. */
+    float sse_xy;
+    /** \brief Explained variation. */
+    float ev;
+    /** \brief Intra-cluster variation. */
+    float icv;
+    
+    /** \brief Whether the distance transform is computed. */
+    bool distance_transform;
+    /** \brief Distance transform of the superpixel boundaries. */
+    cv::Mat distance;
+    
+    /** \brief All ground truth segmentations. */
+    std::vector<cv::Mat> ground_truths;
+    /** \brief Index of the selected ground truth segmentation. */
+    int ground_truth;
+    /** \brief Whether the intersection matrices with all ground truths are computed. */
+    bool batch_statistics;
+    /** \brief Intersection matrices with all ground truths; the one of the selected
+     * ground truth is moved to intersections while intersection_statistics is set. */
+    std::vector<Evaluation::SparseIntersectionMatrix> batch_intersections;
+    /** \brief Ground truth segment sizes for all ground truths, see batch_intersections. */
+    std::vector< std::vector<int> > batch_gt_sizes;
+    /** \brief Superpixel sizes as computed with the intersection matrices. */
+    std::vector<int> intersection_superpixel_sizes;
+    
+    /** \brief Whether the intersection matrix is computed. */
+    bool intersection_statistics;
+    /** \brief Sparse intersection matrix, see Evaluation::computeSparseIntersectionMatrix. */
+    Evaluation::SparseIntersectionMatrix intersections;
+    /** \brief Size of each ground truth segment. */
+    std::vector<int> gt_sizes;
+    
+    /** \brief Whether the ground truth boundaries are computed. */
+    bool gt_boundary_statistics;
+    /** \brief 4-connected boundary map of the ground truth. */
+    cv::Mat gt_boundaries;
+    
+    /** \brief Radius used for the dilated superpixel boundaries, -1 if not computed. */
+    int dilation_radius;
+    /** \brief Dilated superpixel boundary map. */
+    cv::Mat dilated_boundaries;
+    /** \brief Radius used for the dilated ground truth boundaries, -1 if not computed. */
+    int gt_dilation_radius;
+    /** \brief Dilated ground truth boundary map. */
+    cv::Mat gt_dilated_boundaries;
+    
+    /** \brief Precomputed ground truth boundary maps, empty if not set. */
+    std::vector<cv::Mat> precomputed_gt_boundaries;
+    /** \brief Precomputed dilated ground truth boundary maps. */
+    std::vector<cv::Mat> precomputed_gt_dilated_boundaries;
+    /** \brief Radius of the precomputed dilated ground truth boundary maps. */
+    int precomputed_gt_dilation_radius;
+};
+
+#endif	/* FUSED_EVALUATION_H */
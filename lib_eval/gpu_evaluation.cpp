@@ -0,0 +1,537 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+#include <glog/logging.h>
+#include "gpu_evaluation.h"
+
+#ifdef EVAL_OPENCL
+#define CL_USE_DEPRECATED_OPENCL_1_2_APIS
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+namespace {
+
+/** \brief Kernel computing the statistics of all segmentations of a batch;
+ * one work item per pixel and segmentation.
+ * 
+ * Moments are stored as 11 integers per superpixel (count, color, squared 
+ * color, position, squared position); per pair of superpixel and ground
+ * truth segment the intersection size and the first pixel in raster order
+ * are stored such that the sparse lists can be ordered as on the CPU.
+ */
+const char* GPU_EVALUATION_KERNELS =
+"#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable\n"
+"\n"
+"__kernel void pixel_statistics(__global const int* labels, __global const uchar* image,\n"
+"        __global const int* gts, const int width, const int height, const int batch,\n"
+"        const int has_image, const int gt_count, __global const int* moment_offsets,\n"
+"        __global const int* intersection_offsets, __global const int* gt_segments,\n"
+"        __global ulong* moments, __global uint* counts, __global int* firsts)\n"
+"{\n"
+"    const int j = get_global_id(0);\n"
+"    const int i = get_global_id(1);\n"
+"    const int b = get_global_id(2);\n"
+"    if (j >= width || i >= height || b >= batch) return;\n"
+"\n"
+"    const int p = i*width + j;\n"
+"    const int label = labels[b*width*height + p];\n"
+"\n"
+"    if (has_image) {\n"
+"        __global ulong* moment = moments + 11*(moment_offsets[b] + label);\n"
+"        atom_inc(moment);\n"
+"        for (int c = 0; c < 3; c++) {\n"
+"            const ulong value = image[3*p + c];\n"
+"            atom_add(moment + 1 + c, value);\n"
+"            atom_add(moment + 4 + c, value*value);\n"
+"        }\n"
+"        atom_add(moment + 7, (ulong) i);\n"
+"        atom_add(moment + 8, (ulong) j);\n"
+"        atom_add(moment + 9, ((ulong) i)*i);\n"
+"        atom_add(moment + 10, ((ulong) j)*j);\n"
+"    }\n"
+"\n"
+"    for (int t = 0; t < gt_count; t++) {\n"
+"        const int gt_label = gts[t*width*height + p];\n"
+"        const int k = intersection_offsets[b*gt_count + t] + label*gt_segments[t] + gt_label;\n"
+"        atomic_inc(counts + k);\n"
+"        atomic_min(firsts + k, p);\n"
+"    }\n"
+"}\n";
+
+/** \brief Context, queue and kernel, shared by all threads and created on
+ * first use; launches are serialized.
+ */
+struct GPUEvaluationState {
+    GPUEvaluationState() : initialized(false), available(false), context(0),
+            queue(0), program(0), kernel(0), max_alloc(0) {};
+    
+    bool initialized;
+    bool available;
+    cl_context context;
+    cl_command_queue queue;
+    cl_program program;
+    cl_kernel kernel;
+    cl_ulong max_alloc;
+    std::mutex mutex;
+};
+
+GPUEvaluationState& getGPUEvaluationState() {
+    static GPUEvaluationState state;
+    return state;
+}
+
+/** \brief Picks the first GPU supporting 64-bit atomics and builds the kernel;
+ * requires state.mutex to be locked.
+ */
+bool initializeGPUEvaluation(GPUEvaluationState &state) {
+    
+    if (state.initialized) {
+        return state.available;
+    }
+    
+    state.initialized = true;
+    
+    cl_uint num_platforms = 0;
+    if (clGetPlatformIDs(0, NULL, &num_platforms) != CL_SUCCESS || num_platforms == 0) {
+        return false;
+    }
+    
+    std::vector<cl_platform_id> platforms(num_platforms);
+    clGetPlatformIDs(num_platforms, platforms.data(), NULL);
+    
+    cl_device_id device = 0;
+    for (cl_uint p = 0; p < num_platforms && device == 0; ++p) {
+        cl_uint num_devices = 0;
+        if (clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_GPU, 0, NULL, &num_devices) != CL_SUCCESS
+                || num_devices == 0) {
+            continue;
+        }
+        
+        std::vector<cl_device_id> devices(num_devices);
+        clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_GPU, num_devices, devices.data(), NULL);
+        
+        for (cl_uint d = 0; d < num_devices && device == 0; ++d) {
+            size_t length = 0;
+            clGetDeviceInfo(devices[d], CL_DEVICE_EXTENSIONS, 0, NULL, &length);
+            std::string extensions(length, ' ');
+            clGetDeviceInfo(devices[d], CL_DEVICE_EXTENSIONS, length, &extensions[0], NULL);
+            
+            if (extensions.find("cl_khr_int64_base_atomics") != std::string::npos) {
+                device = devices[d];
+            }
+        }
+    }
+    
+    if (device == 0) {
+        return false;
+    }
+    
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &state.max_alloc, NULL);
+    
+    cl_int error = CL_SUCCESS;
+    state.context = clCreateContext(NULL, 1, &device, NULL, NULL, &error);
+    if (error != CL_SUCCESS) {
+        return false;
+    }
+    
+    state.queue = clCreateCommandQueue(state.context, device, 0, &error);
+    if (error != CL_SUCCESS) {
+        return false;
+    }
+    
+    state.program = clCreateProgramWithSource(state.context, 1, &GPU_EVALUATION_KERNELS, NULL, &error);
+    if (error != CL_SUCCESS) {
+        return false;
+    }
+    
+    if (clBuildProgram(state.program, 1, &device, NULL, NULL, NULL) != CL_SUCCESS) {
+        size_t length = 0;
+        clGetProgramBuildInfo(state.program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &length);
+        std::string log(length, ' ');
+        clGetProgramBuildInfo(state.program, device, CL_PROGRAM_BUILD_LOG, length, &log[0], NULL);
+        LOG(ERROR) << "Building OpenCL kernels failed:" << std::endl << log;
+        return false;
+    }
+    
+    state.kernel = clCreateKernel(state.program, "pixel_statistics", &error);
+    if (error != CL_SUCCESS) {
+        return false;
+    }
+    
+    state.available = true;
+    return true;
+}
+
+/** \brief Maximum label plus one, -1 for negative labels.
+ */
+int countLabels(const cv::Mat &labels) {
+    
+    int max = 0;
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            if (labels_i[j] < 0) {
+                return -1;
+            }
+            
+            max = std::max(max, labels_i[j]);
+        }
+    }
+    
+    return max + 1;
+}
+
+/** \brief Copy int images into consecutive planes.
+ */
+void copyPlanes(const std::vector<cv::Mat> &mats, std::vector<int> &planes) {
+    
+    int rows = mats[0].rows;
+    int cols = mats[0].cols;
+    planes.resize(mats.size()*rows*cols);
+    
+    for (unsigned int b = 0; b < mats.size(); ++b) {
+        for (int i = 0; i < rows; ++i) {
+            std::copy(mats[b].ptr<int>(i), mats[b].ptr<int>(i) + cols, 
+                    planes.begin() + (b*rows + i)*cols);
+        }
+    }
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// available
+////////////////////////////////////////////////////////////////////////////////
+
+bool GPUEvaluation::available() {
+    GPUEvaluationState &state = getGPUEvaluationState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return initializeGPUEvaluation(state);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeStatistics
+////////////////////////////////////////////////////////////////////////////////
+
+bool GPUEvaluation::computeStatistics(const std::vector<cv::Mat> &labels, 
+        const cv::Mat &image, const std::vector<cv::Mat> &gts, 
+        std::vector<Evaluation::PixelStatistics> &statistics) {
+    
+    if (labels.empty() || (image.empty() && gts.empty())) {
+        return false;
+    }
+    
+    int rows = labels[0].rows;
+    int cols = labels[0].cols;
+    int batch = labels.size();
+    int gt_count = gts.size();
+    
+    // 16-bit labels are left to the CPU.
+    for (int b = 0; b < batch; ++b) {
+        if (labels[b].type() != CV_32SC1) {
+            return false;
+        }
+        
+        LOG_IF(FATAL, labels[b].rows != rows || labels[b].cols != cols) 
+                << "Superpixel segmentations do not have the same size.";
+    }
+    for (int t = 0; t < gt_count; ++t) {
+        LOG_IF(FATAL, gts[t].type() != CV_32SC1) << "Invalid ground truth type.";
+        LOG_IF(FATAL, gts[t].rows != rows || gts[t].cols != cols) 
+                << "Superpixel segmentation does not match ground truth size.";
+    }
+    LOG_IF(FATAL, !image.empty() && image.type() != CV_8UC3) 
+            << "Currently only 3-channel images are supported.";
+    LOG_IF(FATAL, !image.empty() && (image.rows != rows || image.cols != cols)) 
+            << "Superpixel segmentation does not match image size.";
+    
+    // Offsets of the moments and intersections of each segmentation; the
+    // ground truth sizes are the same for all segmentations.
+    std::vector<int> superpixels(batch);
+    std::vector<int> moment_offsets(batch);
+    int64_t moment_count = 0;
+    for (int b = 0; b < batch; ++b) {
+        superpixels[b] = countLabels(labels[b]);
+        if (superpixels[b] < 0) {
+            return false;
+        }
+        
+        moment_offsets[b] = moment_count;
+        moment_count += superpixels[b];
+    }
+    
+    std::vector<int> gt_segments(std::max(1, gt_count), 0);
+    std::vector< std::vector<int> > gt_sizes(gt_count);
+    for (int t = 0; t < gt_count; ++t) {
+        gt_segments[t] = countLabels(gts[t]);
+        if (gt_segments[t] < 0) {
+            return false;
+        }
+        
+        gt_sizes[t].assign(gt_segments[t], 0);
+        for (int i = 0; i < rows; ++i) {
+            const int* gt_i = gts[t].ptr<int>(i);
+            for (int j = 0; j < cols; ++j) {
+                gt_sizes[t][gt_i[j]]++;
+            }
+        }
+    }
+    
+    std::vector<int> intersection_offsets(std::max(1, batch*gt_count), 0);
+    int64_t intersection_count = 0;
+    for (int b = 0; b < batch; ++b) {
+        for (int t = 0; t < gt_count; ++t) {
+            intersection_offsets[b*gt_count + t] = intersection_count;
+            intersection_count += ((int64_t) superpixels[b])*gt_segments[t];
+        }
+    }
+    
+    if (image.empty()) {
+        moment_count = 0;
+    }
+    
+    GPUEvaluationState &state = getGPUEvaluationState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!initializeGPUEvaluation(state)) {
+        return false;
+    }
+    
+    // Batches not fitting into a single allocation are left to the CPU.
+    int64_t sz = ((int64_t) rows)*cols;
+    if (intersection_count >= std::numeric_limits<int>::max()
+            || 11*moment_count >= std::numeric_limits<int>::max()
+            || moment_count*11*sizeof(cl_ulong) > state.max_alloc
+            || intersection_count*sizeof(cl_uint) > state.max_alloc
+            || batch*sz*sizeof(cl_int) > state.max_alloc
+            || gt_count*sz*sizeof(cl_int) > state.max_alloc) {
+        return false;
+    }
+    
+    std::vector<int> label_planes;
+    copyPlanes(labels, label_planes);
+    
+    std::vector<int> gt_planes(1, 0);
+    if (gt_count > 0) {
+        copyPlanes(gts, gt_planes);
+    }
+    
+    std::vector<unsigned char> image_data(1, 0);
+    if (!image.empty()) {
+        image_data.resize(3*sz);
+        for (int i = 0; i < rows; ++i) {
+            std::copy(image.ptr<unsigned char>(i), image.ptr<unsigned char>(i) + 3*cols, 
+                    image_data.begin() + 3*i*cols);
+        }
+    }
+    
+    // Empty buffers are not allowed, unused ones get a single element.
+    const size_t sizes[9] = {
+        label_planes.size()*sizeof(cl_int), 
+        image_data.size(), 
+        gt_planes.size()*sizeof(cl_int),
+        moment_offsets.size()*sizeof(cl_int), 
+        intersection_offsets.size()*sizeof(cl_int), 
+        gt_segments.size()*sizeof(cl_int),
+        std::max<size_t>(1, 11*moment_count)*sizeof(cl_ulong),
+        std::max<size_t>(1, intersection_count)*sizeof(cl_uint),
+        std::max<size_t>(1, intersection_count)*sizeof(cl_int)
+    };
+    void* data[6] = {label_planes.data(), image_data.data(), gt_planes.data(),
+        moment_offsets.data(), intersection_offsets.data(), gt_segments.data()};
+    
+    cl_int error = CL_SUCCESS;
+    cl_mem buffers[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 9 && error == CL_SUCCESS; ++i) {
+        cl_mem_flags flags = (i < 6 ? CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR : CL_MEM_READ_WRITE);
+        buffers[i] = clCreateBuffer(state.context, flags, sizes[i], (i < 6 ? data[i] : NULL), &error);
+    }
+    
+    const cl_ulong zero = 0;
+    const cl_int first = std::numeric_limits<int>::max();
+    if (error == CL_SUCCESS) {
+        error = clEnqueueFillBuffer(state.queue, buffers[6], &zero, sizeof(cl_ulong), 0, sizes[6], 0, NULL, NULL);
+    }
+    if (error == CL_SUCCESS) {
+        error = clEnqueueFillBuffer(state.queue, buffers[7], &zero, sizeof(cl_uint), 0, sizes[7], 0, NULL, NULL);
+    }
+    if (error == CL_SUCCESS) {
+        error = clEnqueueFillBuffer(state.queue, buffers[8], &first, sizeof(cl_int), 0, sizes[8], 0, NULL, NULL);
+    }
+    
+    int has_image = (image.empty() ? 0 : 1);
+    if (error == CL_SUCCESS) {
+        clSetKernelArg(state.kernel, 0, sizeof(cl_mem), &buffers[0]);
+        clSetKernelArg(state.kernel, 1, sizeof(cl_mem), &buffers[1]);
+        clSetKernelArg(state.kernel, 2, sizeof(cl_mem), &buffers[2]);
+        clSetKernelArg(state.kernel, 3, sizeof(int), &cols);
+        clSetKernelArg(state.kernel, 4, sizeof(int), &rows);
+        clSetKernelArg(state.kernel, 5, sizeof(int), &batch);
+        clSetKernelArg(state.kernel, 6, sizeof(int), &has_image);
+        clSetKernelArg(state.kernel, 7, sizeof(int), &gt_count);
+        clSetKernelArg(state.kernel, 8, sizeof(cl_mem), &buffers[3]);
+        clSetKernelArg(state.kernel, 9, sizeof(cl_mem), &buffers[4]);
+        clSetKernelArg(state.kernel, 10, sizeof(cl_mem), &buffers[5]);
+        clSetKernelArg(state.kernel, 11, sizeof(cl_mem), &buffers[6]);
+        clSetKernelArg(state.kernel, 12, sizeof(cl_mem), &buffers[7]);
+        clSetKernelArg(state.kernel, 13, sizeof(cl_mem), &buffers[8]);
+        
+        const size_t local[3] = {16, 16, 1};
+        const size_t global[3] = {
+            (size_t) (cols + 15)/16*16,
+            (size_t) (rows + 15)/16*16,
+            (size_t) batch
+        };
+        
+        error = clEnqueueNDRangeKernel(state.queue, state.kernel, 3, NULL, global, local, 0, NULL, NULL);
+    }
+    
+    std::vector<cl_ulong> moments(sizes[6]/sizeof(cl_ulong));
+    std::vector<cl_uint> counts(sizes[7]/sizeof(cl_uint));
+    std::vector<cl_int> firsts(sizes[8]/sizeof(cl_int));
+    if (error == CL_SUCCESS) {
+        error = clEnqueueReadBuffer(state.queue, buffers[6], CL_TRUE, 0, sizes[6], moments.data(), 0, NULL, NULL);
+    }
+    if (error == CL_SUCCESS) {
+        error = clEnqueueReadBuffer(state.queue, buffers[7], CL_TRUE, 0, sizes[7], counts.data(), 0, NULL, NULL);
+    }
+    if (error == CL_SUCCESS) {
+        error = clEnqueueReadBuffer(state.queue, buffers[8], CL_TRUE, 0, sizes[8], firsts.data(), 0, NULL, NULL);
+    }
+    
+    for (int i = 0; i < 9; ++i) {
+        if (buffers[i]) {
+            clReleaseMemObject(buffers[i]);
+        }
+    }
+    
+    if (error != CL_SUCCESS) {
+        LOG(WARNING) << "OpenCL error " << error << ", falling back to the CPU.";
+        return false;
+    }
+    
+    // The sparse lists are ordered by the first pixel of each intersection,
+    // i.e. in the order Evaluation::computeSparseIntersectionMatrices creates them.
+    statistics.resize(batch);
+    std::vector< std::pair<int, std::pair<int, int> > > entries;
+    
+    for (int b = 0; b < batch; ++b) {
+        Evaluation::PixelStatistics &statistics_b = statistics[b];
+        
+        statistics_b.moments.clear();
+        if (has_image) {
+            statistics_b.moments.resize(superpixels[b]);
+            for (int k = 0; k < superpixels[b]; ++k) {
+                const cl_ulong* moment = &moments[11*(moment_offsets[b] + k)];
+                Evaluation::ColorMoments &moment_k = statistics_b.moments[k];
+                
+                moment_k.count = moment[0];
+                for (int c = 0; c < 3; ++c) {
+                    moment_k.color[c] = moment[1 + c];
+                    moment_k.squared_color[c] = moment[4 + c];
+                }
+                for (int d = 0; d < 2; ++d) {
+                    moment_k.position[d] = moment[7 + d];
+                    moment_k.squared_position[d] = moment[9 + d];
+                }
+            }
+        }
+        
+        statistics_b.intersections.resize(gt_count);
+        statistics_b.gt_sizes = gt_sizes;
+        statistics_b.superpixel_sizes.assign(superpixels[b], 0);
+        
+        for (int t = 0; t < gt_count; ++t) {
+            Evaluation::SparseIntersectionMatrix &intersections = statistics_b.intersections[t];
+            intersections.resize(superpixels[b]);
+            
+            for (int k = 0; k < superpixels[b]; ++k) {
+                int offset = intersection_offsets[b*gt_count + t] + k*gt_segments[t];
+                
+                entries.clear();
+                for (int l = 0; l < gt_segments[t]; ++l) {
+                    if (counts[offset + l] > 0) {
+                        entries.push_back(std::make_pair(firsts[offset + l], 
+                                std::make_pair(l, (int) counts[offset + l])));
+                    }
+                }
+                
+                std::sort(entries.begin(), entries.end());
+                
+                intersections[k].clear();
+                for (unsigned int e = 0; e < entries.size(); ++e) {
+                    intersections[k].push_back(entries[e].second);
+                    
+                    if (t == 0) {
+                        statistics_b.superpixel_sizes[k] += entries[e].second.second;
+                    }
+                }
+            }
+        }
+        
+        if (gt_count == 0) {
+            statistics_b.intersections.clear();
+            statistics_b.gt_sizes.clear();
+        }
+    }
+    
+    return true;
+}
+
+#else
+
+////////////////////////////////////////////////////////////////////////////////
+// available
+////////////////////////////////////////////////////////////////////////////////
+
+bool GPUEvaluation::available() {
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeStatistics
+////////////////////////////////////////////////////////////////////////////////
+
+bool GPUEvaluation::computeStatistics(const std::vector<cv::Mat> &labels, 
+        const cv::Mat &image, const std::vector<cv::Mat> &gts, 
+        std::vector<Evaluation::PixelStatistics> &statistics) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPU_EVALUATION_H
+#define	GPU_EVALUATION_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "evaluation.h"
+
+/** \brief Computes the per-pixel passes of FusedEvaluation, i.e. color
+ * moments and intersection matrices with the ground truths, on the GPU using
+ * OpenCL for a batch of superpixel segmentations of the same image.
+ * 
+ * All segmentations of a batch are processed by a single kernel launch using
+ * 64-bit integer atomics, such that the results match 
+ * Evaluation::computeColorMoments and Evaluation::computeSparseIntersectionMatrices
+ * exactly; boundary maps, shape statistics and distance transforms remain on
+ * the CPU. Only available if lib_eval is built with EVAL_OPENCL, otherwise
+ * (or without GPU) computeStatistics returns false and the statistics are
+ * computed on the CPU as usual.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   std::vector<Evaluation::PixelStatistics> statistics;
+ *   if (GPUEvaluation::computeStatistics(labels, image, gts, statistics)) {
+ *       fused.reset(labels[0], image);
+ *       fused.setGroundTruths(gts);
+ *       fused.setPixelStatistics(statistics[0]);
+ *   }
+ * \endcode
+ * \author David Stutz
+ */
+class GPUEvaluation {
+public:
+    
+    /** \brief Whether an OpenCL GPU with 64-bit atomics is available.
+     * \return whether computeStatistics can be used
+     */
+    static bool available();
+    
+    /** \brief Compute color moments and intersection matrices of a batch of
+     * superpixel segmentations of the same image.
+     * \param[in] labels superpixel segmentations as int images
+     * \param[in] image image, may be empty to skip the color moments
+     * \param[in] gts ground truth segmentations, may be empty to skip the intersections
+     * \param[out] statistics statistics of each segmentation
+     * \return whether the statistics were computed, false if no GPU is available,
+     * the batch does not fit into GPU memory or an OpenCL error occurred
+     */
+    static bool computeStatistics(const std::vector<cv::Mat> &labels, const cv::Mat &image,
+            const std::vector<cv::Mat> &gts, std::vector<Evaluation::PixelStatistics> &statistics);
+    
+};
+
+#endif	/* GPU_EVALUATION_H */
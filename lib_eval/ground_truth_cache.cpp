@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <fstream>
+#include <stdint.h>
+#include <glog/logging.h>
+#include "io_util.h"
+#include "evaluation.h"
+#include "result_cache.h"
+#include "ground_truth_cache.h"
+
+/** \brief Magic number at the start of each entry. */
+const char GROUND_TRUTH_CACHE_MAGIC[4] = {'S', 'P', 'G', 'T'};
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+GroundTruthCache::GroundTruthCache(boost::filesystem::path directory) 
+        : directory(directory) {
+    
+    boost::system::error_code error;
+    boost::filesystem::create_directories(directory, error);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// load
+////////////////////////////////////////////////////////////////////////////////
+
+bool GroundTruthCache::load(const boost::filesystem::path &gt_file, int rows, int cols, 
+        Entry &entry) {
+    
+    std::string hash = ResultCache::hashFile(gt_file);
+    if (hash.empty()) {
+        return false;
+    }
+    
+    std::string key = hash + "-" + std::to_string(VERSION);
+    if (read(key, entry) && entry.labels.rows == rows && entry.labels.cols == cols) {
+        return true;
+    }
+    
+    IOUtil::readMatCSVInt(gt_file, rows, cols, entry.labels);
+    if (entry.labels.rows != rows || entry.labels.cols != cols) {
+        return false;
+    }
+    
+    compute(entry);
+    write(key, entry);
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// read
+////////////////////////////////////////////////////////////////////////////////
+
+bool GroundTruthCache::read(const std::string &key, Entry &entry) {
+    
+    std::ifstream file_stream(getFile(key).c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!file_stream.is_open()) {
+        return false;
+    }
+    
+    char magic[4];
+    int32_t header[3];
+    uint64_t labels_size;
+    file_stream.read(magic, sizeof(magic));
+    file_stream.read(reinterpret_cast<char*>(header), sizeof(header));
+    file_stream.read(reinterpret_cast<char*>(&labels_size), sizeof(labels_size));
+    
+    if (!file_stream || std::string(magic, 4) != std::string(GROUND_TRUTH_CACHE_MAGIC, 4)
+            || header[0] <= 0 || header[1] <= 0 || labels_size > (uint64_t) 1 << 32) {
+        return false;
+    }
+    
+    int rows = header[0];
+    int cols = header[1];
+    
+    std::vector<char> buffer(labels_size);
+    file_stream.read(buffer.data(), buffer.size());
+    if (!file_stream || IOUtil::decodeMatBinaryInt(buffer.data(), buffer.size(), entry.labels) < 0
+            || entry.labels.rows != rows || entry.labels.cols != cols) {
+        return false;
+    }
+    
+    entry.dilation_radius = header[2];
+    entry.boundaries.create(rows, cols, CV_8UC1);
+    entry.dilated_boundaries.create(rows, cols, CV_8UC1);
+    
+    for (int i = 0; i < rows; ++i) {
+        file_stream.read(entry.boundaries.ptr<char>(i), cols);
+    }
+    for (int i = 0; i < rows; ++i) {
+        file_stream.read(entry.dilated_boundaries.ptr<char>(i), cols);
+    }
+    
+    return (bool) file_stream;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// write
+////////////////////////////////////////////////////////////////////////////////
+
+void GroundTruthCache::write(const std::string &key, const Entry &entry) {
+    
+    LOG_IF(FATAL, entry.labels.type() != CV_32SC1) << "Invalid label type.";
+    LOG_IF(FATAL, entry.boundaries.rows != entry.labels.rows 
+            || entry.dilated_boundaries.rows != entry.labels.rows) 
+            << "Boundary maps do not match ground truth.";
+    
+    boost::filesystem::path file = getFile(key);
+    boost::system::error_code error;
+    boost::filesystem::create_directories(file.parent_path(), error);
+    
+    // Write to a unique temporary file first; renaming is atomic such that
+    // concurrent readers never see partial entries.
+    boost::filesystem::path tmp_file = boost::filesystem::unique_path(
+            file.parent_path() / boost::filesystem::path(key + "-%%%%-%%%%.tmp"));
+    
+    std::ofstream file_stream(tmp_file.c_str(), std::ofstream::out | std::ofstream::binary);
+    if (!file_stream.is_open()) {
+        LOG(ERROR) << "Could not write ground truth cache entry (" << file.string() << ").";
+        return;
+    }
+    
+    std::vector<char> buffer;
+    IOUtil::encodeMatBinaryInt(entry.labels, buffer);
+    
+    int32_t header[3] = {entry.labels.rows, entry.labels.cols, entry.dilation_radius};
+    uint64_t labels_size = buffer.size();
+    file_stream.write(GROUND_TRUTH_CACHE_MAGIC, sizeof(GROUND_TRUTH_CACHE_MAGIC));
+    file_stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file_stream.write(reinterpret_cast<const char*>(&labels_size), sizeof(labels_size));
+    file_stream.write(buffer.data(), buffer.size());
+    
+    for (int i = 0; i < entry.boundaries.rows; ++i) {
+        file_stream.write(entry.boundaries.ptr<char>(i), entry.boundaries.cols);
+    }
+    for (int i = 0; i < entry.dilated_boundaries.rows; ++i) {
+        file_stream.write(entry.dilated_boundaries.ptr<char>(i), entry.dilated_boundaries.cols);
+    }
+    
+    bool success = (bool) file_stream;
+    file_stream.close();
+    
+    if (success) {
+        boost::filesystem::rename(tmp_file, file, error);
+        success = !error;
+    }
+    
+    if (!success) {
+        LOG(ERROR) << "Could not write ground truth cache entry (" << file.string() << ").";
+        boost::filesystem::remove(tmp_file, error);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// compute
+////////////////////////////////////////////////////////////////////////////////
+
+void GroundTruthCache::compute(Entry &entry) {
+    
+    int H = entry.labels.rows;
+    int W = entry.labels.cols;
+    
+    // Same radius as the default of Evaluation::computeBoundaryRecall.
+    float d = 0.0025;
+    entry.dilation_radius = std::round(d*std::sqrt(H*H + W*W));
+    
+    Evaluation::computeBoundaryMap(entry.labels, entry.boundaries);
+    Evaluation::dilateBoundaryMap(entry.boundaries, entry.dilation_radius, 
+            entry.dilated_boundaries);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getFile
+////////////////////////////////////////////////////////////////////////////////
+
+boost::filesystem::path GroundTruthCache::getFile(const std::string &key) {
+    return directory / boost::filesystem::path(key.substr(0, 2)) 
+            / boost::filesystem::path(key + ".gtc");
+}
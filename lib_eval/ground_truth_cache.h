@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GROUND_TRUTH_CACHE_H
+#define	GROUND_TRUTH_CACHE_H
+
+#include <string>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+
+/** \brief Persistent cache of parsed ground truth segmentations and their
+ * boundary maps, shared by all evaluations on the same dataset.
+ * 
+ * Entries are keyed by the hash of the ground truth file, such that changed
+ * ground truths are recomputed, and hold the labels, the 4-connected boundary
+ * map and the boundary map dilated with the radius Boundary Recall and 
+ * Boundary Precision use by default. Missing entries are computed and written
+ * on first use; entries are written atomically, such that the cache can be
+ * shared between threads and processes.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   GroundTruthCache cache(gt_directory / "cache");
+ *   GroundTruthCache::Entry entry;
+ *   cache.load(gt_file, image.rows, image.cols, entry);
+ * \endcode
+ * \author David Stutz
+ */
+class GroundTruthCache {
+public:
+    
+    /** \brief Version of the entry format and derived data. */
+    static const int VERSION = 1;
+    
+    /** \brief Ground truth segmentation and derived data. */
+    struct Entry {
+        /** \brief Ground truth segmentation as int image. */
+        cv::Mat labels;
+        /** \brief 4-connected boundary map, see Evaluation::computeBoundaryMap. */
+        cv::Mat boundaries;
+        /** \brief Radius of dilated_boundaries. */
+        int dilation_radius;
+        /** \brief Dilated boundary map, see Evaluation::dilateBoundaryMap. */
+        cv::Mat dilated_boundaries;
+    };
+    
+    /** \brief Constructor.
+     * \param[in] directory directory to store the cache in, created if necessary
+     */
+    GroundTruthCache(boost::filesystem::path directory);
+    
+    /** \brief Load a ground truth segmentation from the cache, or read it and
+     * add it to the cache.
+     * \param[in] gt_file ground truth segmentation as CSV or binary label file
+     * \param[in] rows expected number of rows
+     * \param[in] cols expected number of columns
+     * \param[out] entry ground truth and derived data
+     * \return whether the ground truth could be loaded
+     */
+    bool load(const boost::filesystem::path &gt_file, int rows, int cols, Entry &entry);
+    
+    /** \brief Read an entry.
+     * \param[in] key key of the entry, i.e. the hash of the ground truth file
+     * \param[out] entry cached entry
+     * \return whether the entry was found and is valid
+     */
+    bool read(const std::string &key, Entry &entry);
+    
+    /** \brief Write an entry, replacing existing entries.
+     * \param[in] key key of the entry
+     * \param[in] entry entry to write
+     */
+    void write(const std::string &key, const Entry &entry);
+    
+    /** \brief Compute boundary map and dilated boundary map of entry.labels.
+     * \param[in,out] entry entry with labels set
+     */
+    static void compute(Entry &entry);
+    
+private:
+    
+    /** \brief Get the file of an entry.
+     * \param[in] key key of the entry
+     * \return path to file
+     */
+    boost::filesystem::path getFile(const std::string &key);
+    
+    /** \brief Directory of the cache. */
+    boost::filesystem::path directory;
+    
+};
+
+#endif	/* GROUND_TRUTH_CACHE_H */
@@ -0,0 +1,291 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <algorithm>
+#include <glog/logging.h>
+#include "image_loader.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// ImageLoader
+////////////////////////////////////////////////////////////////////////////////
+
+ImageLoader::ImageLoader(const std::vector<std::string> &files_, int reduction_, 
+        int prefetch_) : files(files_), reduction(reduction_), 
+        prefetch(std::max(0, prefetch_)), current(0), scheduled(0), stop(false) {
+    
+    LOG_IF(FATAL, !isValidReduction(reduction)) << "Invalid reduction: " 
+            << reduction << " (supported are 1, 2, 4 and 8).";
+    
+    if (prefetch > 0) {
+        slots.resize(prefetch);
+        for (unsigned int k = 0; k < slots.size(); k++) {
+            slots[k].done = false;
+        }
+        
+        int count = std::min(prefetch, (int) std::max(1u, std::thread::hardware_concurrency()));
+        for (int t = 0; t < count; t++) {
+            threads.push_back(std::thread(&ImageLoader::work, this));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ~ImageLoader
+////////////////////////////////////////////////////////////////////////////////
+
+ImageLoader::~ImageLoader() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stop = true;
+    }
+    
+    condition.notify_all();
+    for (unsigned int t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// next
+////////////////////////////////////////////////////////////////////////////////
+
+bool ImageLoader::next(cv::Mat &image, cv::Size &size) {
+    if (current >= (int) files.size()) {
+        return false;
+    }
+    
+    if (prefetch == 0) {
+        decode(files[current], reduction, buffer, image, size);
+        current++;
+        return true;
+    }
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    Slot &slot = slots[current % prefetch];
+    condition.wait(lock, [&slot] { return slot.done; });
+    
+    image = slot.image;
+    size = slot.size;
+    slot.image.release();
+    slot.done = false;
+    current++;
+    
+    lock.unlock();
+    condition.notify_all();
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// work
+////////////////////////////////////////////////////////////////////////////////
+
+void ImageLoader::work() {
+    std::vector<char> thread_buffer;
+    
+    while (true) {
+        int index = 0;
+        
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] {
+                return stop || scheduled >= (int) files.size() 
+                        || scheduled < current + prefetch;
+            });
+            
+            if (stop || scheduled >= (int) files.size()) {
+                return;
+            }
+            
+            index = scheduled;
+            scheduled++;
+        }
+        
+        cv::Mat image;
+        cv::Size size;
+        decode(files[index], reduction, thread_buffer, image, size);
+        
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            Slot &slot = slots[index % prefetch];
+            slot.image = image;
+            slot.size = size;
+            slot.done = true;
+        }
+        
+        condition.notify_all();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// isValidReduction
+////////////////////////////////////////////////////////////////////////////////
+
+bool ImageLoader::isValidReduction(int reduction) {
+    return reduction == 1 || reduction == 2 || reduction == 4 || reduction == 8;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// decode
+////////////////////////////////////////////////////////////////////////////////
+
+void ImageLoader::decode(const std::string &file, int reduction, 
+        std::vector<char> &buffer, cv::Mat &image, cv::Size &size) {
+    
+    image.release();
+    size = cv::Size(0, 0);
+    
+    std::ifstream stream(file.c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!stream.is_open()) {
+        return;
+    }
+    
+    stream.seekg(0, std::ifstream::end);
+    std::streamoff length = stream.tellg();
+    stream.seekg(0, std::ifstream::beg);
+    
+    if (length <= 0) {
+        return;
+    }
+    
+    // Keeps the capacity of previous images.
+    buffer.resize(length);
+    stream.read(&buffer[0], length);
+    if (!stream) {
+        return;
+    }
+    
+#if CV_MAJOR_VERSION >= 3
+    if (reduction > 1 && readJPEGSize(buffer, size)) {
+        int flags = cv::IMREAD_REDUCED_COLOR_2;
+        if (reduction == 4) {
+            flags = cv::IMREAD_REDUCED_COLOR_4;
+        }
+        else if (reduction == 8) {
+            flags = cv::IMREAD_REDUCED_COLOR_8;
+        }
+        
+        image = cv::imdecode(buffer, flags);
+        return;
+    }
+#endif
+    
+    image = cv::imdecode(buffer, CV_LOAD_IMAGE_COLOR);
+    size = cv::Size(image.cols, image.rows);
+    
+    if (reduction > 1 && !image.empty()) {
+        // Same size as reduced decoding, i.e. rounded up.
+        cv::Mat reduced;
+        cv::resize(image, reduced, cv::Size((image.cols + reduction - 1)/reduction, 
+                (image.rows + reduction - 1)/reduction), 0, 0, cv::INTER_AREA);
+        image = reduced;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readJPEGSize
+////////////////////////////////////////////////////////////////////////////////
+
+bool ImageLoader::readJPEGSize(const std::vector<char> &buffer, cv::Size &size) {
+    size_t length = buffer.size();
+    if (length < 4) {
+        return false;
+    }
+    
+    const unsigned char* data = (const unsigned char*) &buffer[0];
+    if (data[0] != 0xFF || data[1] != 0xD8) {
+        return false;
+    }
+    
+    size_t i = 2;
+    while (i + 4 <= length) {
+        if (data[i] != 0xFF) {
+            return false;
+        }
+        
+        unsigned char marker = data[i + 1];
+        if (marker == 0xFF) {
+            // Fill byte.
+            i++;
+            continue;
+        }
+        
+        // Markers without segment.
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            i += 2;
+            continue;
+        }
+        
+        if (marker == 0xD9 || marker == 0xDA) {
+            return false;
+        }
+        
+        size_t segment = (data[i + 2] << 8) | data[i + 3];
+        
+        // SOF0 to SOF15 except DHT, JPG and DAC.
+        if (marker >= 0xC0 && marker <= 0xCF 
+                && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            
+            if (i + 9 > length) {
+                return false;
+            }
+            
+            size.height = (data[i + 5] << 8) | data[i + 6];
+            size.width = (data[i + 7] << 8) | data[i + 8];
+            return size.height > 0 && size.width > 0;
+        }
+        
+        i += 2 + segment;
+    }
+    
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// upsampleLabels
+////////////////////////////////////////////////////////////////////////////////
+
+void ImageLoader::upsampleLabels(const cv::Mat &labels, const cv::Size &size, 
+        cv::Mat &upsampled) {
+    
+    if (labels.cols == size.width && labels.rows == size.height) {
+        if (upsampled.data != labels.data) {
+            labels.copyTo(upsampled);
+        }
+        
+        return;
+    }
+    
+    cv::Mat resized;
+    cv::resize(labels, resized, size, 0, 0, cv::INTER_NEAREST);
+    upsampled = resized;
+}
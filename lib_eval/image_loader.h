@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IMAGE_LOADER_H
+#define	IMAGE_LOADER_H
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+
+/** \brief Loads the images of a command line tool in order, optionally at
+ * reduced resolution and prefetching the next images on background threads.
+ * 
+ * For a reduction of 2, 4 or 8, JPEG images are decoded at reduced 
+ * resolution directly by the decoder (cv::IMREAD_REDUCED_COLOR_*, OpenCV 3 
+ * and later), which is considerably cheaper than decoding at full resolution;
+ * other formats are decoded at full resolution and resized. The original
+ * size is reported such that labels can be upsampled using upsampleLabels
+ * and are comparable to the ground truth. With prefetching, up to the given
+ * number of images is decoded ahead while the current image is segmented;
+ * file buffers are reused across images.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   ImageLoader loader(files, 2, 4);
+ *   
+ *   cv::Mat image;
+ *   cv::Size size;
+ *   while (loader.next(image, size)) {
+ *       // Segment image, then:
+ *       ImageLoader::upsampleLabels(labels, size, labels);
+ *   }
+ * \endcode
+ * \author David Stutz
+ */
+class ImageLoader {
+public:
+    
+    /** \brief Constructor, starts the prefetching threads.
+     * \param[in] files images to load, in order
+     * \param[in] reduction reduction factor, 1, 2, 4 or 8
+     * \param[in] prefetch number of images to decode ahead, 0 to decode on
+     * the calling thread
+     */
+    ImageLoader(const std::vector<std::string> &files, int reduction = 1, 
+            int prefetch = 0);
+    
+    /** \brief Destructor, stops the prefetching threads. */
+    ~ImageLoader();
+    
+    /** \brief Get the next image; an image that cannot be read is returned
+     * empty, as for cv::imread.
+     * \param[out] image image, at reduced resolution
+     * \param[out] size original size of the image
+     * \return whether an image was loaded, false after the last image
+     */
+    bool next(cv::Mat &image, cv::Size &size);
+    
+    /** \brief Check whether the reduction factor is supported.
+     * \param[in] reduction reduction factor
+     * \return whether reduction is 1, 2, 4 or 8
+     */
+    static bool isValidReduction(int reduction);
+    
+    /** \brief Read and decode a single image.
+     * \param[in] file path to image
+     * \param[in] reduction reduction factor, 1, 2, 4 or 8
+     * \param[in,out] buffer file buffer, reused across calls
+     * \param[out] image image, at reduced resolution
+     * \param[out] size original size of the image
+     */
+    static void decode(const std::string &file, int reduction, 
+            std::vector<char> &buffer, cv::Mat &image, cv::Size &size);
+    
+    /** \brief Read the size of a JPEG image from its frame header without
+     * decoding it.
+     * \param[in] buffer encoded image
+     * \param[out] size size of the image
+     * \return whether buffer is a JPEG image with a frame header
+     */
+    static bool readJPEGSize(const std::vector<char> &buffer, cv::Size &size);
+    
+    /** \brief Upsample labels computed at reduced resolution to the original
+     * size using nearest neighbor interpolation.
+     * \param[in] labels labels at reduced resolution
+     * \param[in] size original size
+     * \param[out] upsampled labels at original size, may be labels
+     */
+    static void upsampleLabels(const cv::Mat &labels, const cv::Size &size, 
+            cv::Mat &upsampled);
+    
+private:
+    
+    /** \brief A decoded image waiting to be returned. */
+    struct Slot {
+        /** \brief Image at reduced resolution. */
+        cv::Mat image;
+        /** \brief Original size. */
+        cv::Size size;
+        /** \brief Whether the image was decoded. */
+        bool done;
+    };
+    
+    /** \brief Loop of the prefetching threads. */
+    void work();
+    
+    /** \brief Images to load. */
+    std::vector<std::string> files;
+    /** \brief Reduction factor. */
+    int reduction;
+    /** \brief Number of images to decode ahead. */
+    int prefetch;
+    /** \brief Index of the next image to return. */
+    int current;
+    /** \brief Index of the next image to decode. */
+    int scheduled;
+    /** \brief Whether the threads are asked to stop. */
+    bool stop;
+    /** \brief Decoded images, indexed modulo prefetch. */
+    std::vector<Slot> slots;
+    /** \brief File buffer used without prefetching. */
+    std::vector<char> buffer;
+    /** \brief Prefetching threads. */
+    std::vector<std::thread> threads;
+    /** \brief Guards current, scheduled, stop and slots. */
+    std::mutex mutex;
+    /** \brief Signals decoded images and free slots. */
+    std::condition_variable condition;
+    
+};
+
+#endif	/* IMAGE_LOADER_H */
@@ -30,6 +30,12 @@
  */
 
 #include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
+#include <limits>
 #include <iomanip>
 #include <fstream>
 #include <glog/logging.h>
@@ -103,6 +109,49 @@ template int IOUtil::writeArrayCSV<unsigned char>(boost::filesystem::path, unsig
 // writeMatCSV
 ////////////////////////////////////////////////////////////////////////////////
 
+/** \brief Format a single cell into the buffer.
+ * \param[in] value value to format
+ * \param[in] precision precision, only used for floating point values
+ * \param[out] buffer buffer to append to
+ */
+static inline void formatCSVCell(int value, int precision, std::string &buffer) {
+    char digits[12];
+    int n = 0;
+    
+    // Use unsigned arithmetic to also handle the minimum int.
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int) value : (unsigned int) value;
+    do {
+        digits[n++] = '0' + magnitude%10;
+        magnitude /= 10;
+    } while (magnitude > 0);
+    
+    if (value < 0) {
+        buffer += '-';
+    }
+    
+    while (n > 0) {
+        buffer += digits[--n];
+    }
+}
+
+static inline void formatCSVCell(unsigned short value, int precision, std::string &buffer) {
+    formatCSVCell((int) value, precision, buffer);
+}
+
+static inline void formatCSVCell(unsigned char value, int precision, std::string &buffer) {
+    
+    // Same as std::ostream, which writes unsigned char as character.
+    buffer += (char) value;
+}
+
+static inline void formatCSVCell(float value, int precision, std::string &buffer) {
+    
+    // Same formatting as std::setprecision on a default std::ostream.
+    char digits[64];
+    int n = snprintf(digits, sizeof(digits), "%.*g", precision, value);
+    buffer.append(digits, n);
+}
+
 template<typename T>
 int IOUtil::writeMatCSV(boost::filesystem::path file, const cv::Mat& mat, 
         std::string separator, int precision) {
@@ -111,22 +160,30 @@ int IOUtil::writeMatCSV(boost::filesystem::path file, const cv::Mat& mat,
     LOG_IF(FATAL, precision <= 0) << "Invalid precision.";
     LOG_IF(FATAL, separator.empty()) << "Cannot use empty separator.";
     
-    std::ofstream file_stream(file.c_str());
+    // Format everything into a single buffer and write once.
+    std::string buffer;
+    buffer.reserve(mat.rows*mat.cols*(separator.size() + 4));
+    
     for (int i = 0; i < mat.rows; i++) {
+        const T* mat_i = mat.ptr<T>(i);
+        
         for (int j = 0; j < mat.cols; j++) {
-            file_stream << std::setprecision(precision) << mat.at<T>(i, j);
+            formatCSVCell(mat_i[j], precision, buffer);
             
             if (j < mat.cols - 1) {
-                file_stream << separator;
+                buffer += separator;
             }
         }
         
         if (i < mat.rows  - 1) {
-            file_stream << "\n";
+            buffer += '\n';
         }
     }
     
+    std::ofstream file_stream(file.c_str(), std::ofstream::out | std::ofstream::binary);
+    file_stream.write(buffer.data(), buffer.size());
     file_stream.close();
+    
     return mat.rows;
 }
 
@@ -136,6 +193,32 @@ template int IOUtil::writeMatCSV<float>(boost::filesystem::path,
         const cv::Mat&, std::string, int);
 template int IOUtil::writeMatCSV<unsigned char>(boost::filesystem::path, 
         const cv::Mat&, std::string, int);
+template int IOUtil::writeMatCSV<unsigned short>(boost::filesystem::path, 
+        const cv::Mat&, std::string, int);
+
+////////////////////////////////////////////////////////////////////////////////
+// writeMatCSVAsync
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+std::future<int> IOUtil::writeMatCSVAsync(boost::filesystem::path file, const cv::Mat& mat, 
+        std::string separator, int precision) {
+    
+    // The matrix is copied such that the caller may reuse or modify it.
+    cv::Mat mat_copy = mat.clone();
+    return std::async(std::launch::async, [file, mat_copy, separator, precision]() {
+        return IOUtil::writeMatCSV<T>(file, mat_copy, separator, precision);
+    });
+}
+
+template std::future<int> IOUtil::writeMatCSVAsync<int>(boost::filesystem::path, 
+        const cv::Mat&, std::string, int);
+template std::future<int> IOUtil::writeMatCSVAsync<float>(boost::filesystem::path, 
+        const cv::Mat&, std::string, int);
+template std::future<int> IOUtil::writeMatCSVAsync<unsigned char>(boost::filesystem::path, 
+        const cv::Mat&, std::string, int);
+template std::future<int> IOUtil::writeMatCSVAsync<unsigned short>(boost::filesystem::path, 
+        const cv::Mat&, std::string, int);
 
 ////////////////////////////////////////////////////////////////////////////////
 // listSubdirectories
@@ -258,6 +341,53 @@ void IOUtil::readDirectory(boost::filesystem::path directory,
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// parseShard
+////////////////////////////////////////////////////////////////////////////////
+
+bool IOUtil::parseShard(const std::string &shard_string, int &shard, int &shards) {
+    
+    size_t separator = shard_string.find('/');
+    if (separator == std::string::npos || separator == 0 
+            || separator == shard_string.size() - 1) {
+        return false;
+    }
+    
+    std::string shard_part = shard_string.substr(0, separator);
+    std::string shards_part = shard_string.substr(separator + 1);
+    if (shard_part.find_first_not_of("0123456789") != std::string::npos
+            || shards_part.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    
+    shard = atoi(shard_part.c_str());
+    shards = atoi(shards_part.c_str());
+    
+    return (shards > 0 && shard >= 0 && shard < shards);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// selectShard
+////////////////////////////////////////////////////////////////////////////////
+
+void IOUtil::selectShard(std::multimap<std::string, boost::filesystem::path> &files,
+        int shard, int shards) {
+    
+    LOG_IF(FATAL, shards <= 0 || shard < 0 || shard >= shards) 
+            << "Invalid shard: " << shard << "/" << shards << ".";
+    
+    int index = 0;
+    std::multimap<std::string, boost::filesystem::path>::iterator it = files.begin();
+    while (it != files.end()) {
+        if ((index++)%shards != shard) {
+            it = files.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // getImageExtensions
 ////////////////////////////////////////////////////////////////////////////////
@@ -295,111 +425,754 @@ void IOUtil::getCSVExtensions(std::vector<std::string> &extensions) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// readMatCSVInt
+// getBinaryExtensions
 ////////////////////////////////////////////////////////////////////////////////
 
-int IOUtil::readMatCSVInt(boost::filesystem::path file, cv::Mat &result) {
+void IOUtil::getBinaryExtensions(std::vector<std::string> &extensions) {
+    extensions.clear();
+    extensions.push_back(".lbl");
+    extensions.push_back(".LBL");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getPNGExtensions
+////////////////////////////////////////////////////////////////////////////////
+
+void IOUtil::getPNGExtensions(std::vector<std::string> &extensions) {
+    extensions.clear();
+    extensions.push_back(".png");
+    extensions.push_back(".PNG");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getLabelExtensions
+////////////////////////////////////////////////////////////////////////////////
+
+void IOUtil::getLabelExtensions(std::vector<std::string> &extensions) {
+    std::vector<std::string> binary_extensions;
+    getBinaryExtensions(binary_extensions);
+    std::vector<std::string> png_extensions;
+    getPNGExtensions(png_extensions);
+    
+    getCSVExtensions(extensions);
+    extensions.insert(extensions.end(), binary_extensions.begin(), 
+            binary_extensions.end());
+    extensions.insert(extensions.end(), png_extensions.begin(), 
+            png_extensions.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// isBinaryFile
+////////////////////////////////////////////////////////////////////////////////
+
+bool IOUtil::isBinaryFile(boost::filesystem::path file) {
+    std::vector<std::string> extensions;
+    getBinaryExtensions(extensions);
+    
+    std::string extension = file.extension().string();
+    for (unsigned int k = 0; k < extensions.size(); ++k) {
+        if (extensions[k] == extension) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// isPNGFile
+////////////////////////////////////////////////////////////////////////////////
+
+bool IOUtil::isPNGFile(boost::filesystem::path file) {
+    std::vector<std::string> extensions;
+    getPNGExtensions(extensions);
+    
+    std::string extension = file.extension().string();
+    for (unsigned int k = 0; k < extensions.size(); ++k) {
+        if (extensions[k] == extension) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeMatPNGInt
+////////////////////////////////////////////////////////////////////////////////
+
+int IOUtil::writeMatPNGInt(boost::filesystem::path file, const cv::Mat &mat) {
+    LOG_IF(FATAL, mat.type() != CV_32SC1 && mat.type() != CV_16UC1) 
+            << "Can only write CV_32SC1 or CV_16UC1 matrices as PNG label map.";
+    
+    cv::Mat labels = mat;
+    if (mat.type() == CV_32SC1) {
+        labels.create(mat.rows, mat.cols, CV_16UC1);
+        
+        for (int i = 0; i < mat.rows; ++i) {
+            const int* mat_i = mat.ptr<int>(i);
+            unsigned short* labels_i = labels.ptr<unsigned short>(i);
+            
+            for (int j = 0; j < mat.cols; ++j) {
+                LOG_IF(FATAL, mat_i[j] < 0 || mat_i[j] > std::numeric_limits<unsigned short>::max())
+                        << "Label " << mat_i[j] << " exceeds the 16-bit range of PNG label maps ("
+                        << file.string() << ").";
+                labels_i[j] = mat_i[j];
+            }
+        }
+    }
+    
+    // Low compression levels are considerably faster while label maps
+    // still compress well.
+    std::vector<int> parameters;
+    parameters.push_back(CV_IMWRITE_PNG_COMPRESSION);
+    parameters.push_back(1);
+    
+    bool success = cv::imwrite(file.string(), labels, parameters);
+    LOG_IF(FATAL, !success) << "Could not write PNG label map: " << file.string() << ".";
+    
+    return mat.rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readMatPNGInt
+////////////////////////////////////////////////////////////////////////////////
+
+int IOUtil::readMatPNGInt(boost::filesystem::path file, cv::Mat &result) {
     LOG_IF(FATAL, !boost::filesystem::is_regular_file(file)) 
             << "File does not exist: " << file.string() << ".";
     
-    std::ifstream file_stream(file.c_str());
+    cv::Mat labels = cv::imread(file.string(), CV_LOAD_IMAGE_ANYDEPTH);
+    LOG_IF(FATAL, labels.empty()) << "Could not read PNG label map: " << file.string() << ".";
+    LOG_IF(FATAL, labels.type() != CV_16UC1 && labels.type() != CV_8UC1) 
+            << "PNG label maps need to be 8- or 16-bit single-channel: " 
+            << file.string() << ".";
     
-    int i = 0;
-    int cols = 0; // To be determined.
+    labels.convertTo(result, CV_32SC1);
+    return result.rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeLabels
+////////////////////////////////////////////////////////////////////////////////
+
+int IOUtil::writeLabels(boost::filesystem::path file, const cv::Mat &labels) {
+    if (isBinaryFile(file)) {
+        return writeMatBinaryInt(file, labels);
+    }
     
-    std::string line;
-    while (std::getline(file_stream, line, '\n')) {
-        
-        std::stringstream line_stream(line);
-        std::string cell;
+    if (isPNGFile(file)) {
+        return writeMatPNGInt(file, labels);
+    }
+    
+    if (labels.type() == CV_16UC1) {
+        return writeMatCSV<unsigned short>(file, labels);
+    }
+    
+    return writeMatCSV<int>(file, labels);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// encodeMatBinaryInt
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Header of the binary label format, see IOUtil::writeMatBinaryInt. */
+struct BinaryLabelHeader {
+    /** \brief Magic, always "SPLB". */
+    char magic[4];
+    /** \brief Version of the format. */
+    uint8_t version;
+    /** \brief Encoding, 0 for raw labels and 1 for run-length encoding. */
+    uint8_t encoding;
+    /** \brief Reserved, always 0. */
+    uint16_t reserved;
+    /** \brief Number of rows. */
+    int32_t rows;
+    /** \brief Number of columns. */
+    int32_t cols;
+    /** \brief OpenCV type of the label map. */
+    int32_t type;
+    /** \brief Number of labels, i.e. maximum label plus one. */
+    int32_t labels;
+    /** \brief Number of 32-bit words following the header. */
+    uint32_t words;
+};
+
+const char BINARY_LABEL_MAGIC[4] = {'S', 'P', 'L', 'B'};
+const uint8_t BINARY_LABEL_VERSION = 1;
+const uint8_t BINARY_LABEL_VERSION_16U = 2;
+const uint8_t BINARY_LABEL_RAW = 0;
+const uint8_t BINARY_LABEL_RLE = 1;
+
+/** \brief Compute label range and runs of a label map.
+ * \param[in] mat label map
+ * \param[out] min_label minimum label
+ * \param[out] max_label maximum label
+ * \param[in] compress whether to compute the runs
+ * \param[out] runs (label, length) pairs
+ */
+template<typename T>
+static void computeBinaryLabelRuns(const cv::Mat &mat, int &min_label, int &max_label,
+        bool compress, std::vector<int32_t> &runs) {
+    
+    for (int i = 0; i < mat.rows; ++i) {
+        const T* mat_i = mat.ptr<T>(i);
         
-        std::vector<std::string> data;
-        while(std::getline(line_stream, cell, ',')) {
-            data.push_back(cell);
+        for (int j = 0; j < mat.cols; ++j) {
+            int label = mat_i[j];
+            min_label = std::min(min_label, label);
+            max_label = std::max(max_label, label);
+            
+            if (compress) {
+                if (!runs.empty() && runs[runs.size() - 2] == label) {
+                    runs[runs.size() - 1]++;
+                }
+                else {
+                    runs.push_back(label);
+                    runs.push_back(1);
+                }
+            }
+        }
+    }
+}
+
+void IOUtil::encodeMatBinaryInt(const cv::Mat &mat, std::vector<char> &buffer,
+        bool compress) {
+    
+    LOG_IF(FATAL, mat.type() != CV_32SC1 && mat.type() != CV_16UC1) 
+            << "Can only encode CV_32SC1 or CV_16UC1 matrices in binary label format.";
+    
+    int min_label = 0;
+    int max_label = -1;
+    std::vector<int32_t> runs;
+    
+    if (mat.type() == CV_16UC1) {
+        computeBinaryLabelRuns<unsigned short>(mat, min_label, max_label, compress, runs);
+    }
+    else {
+        computeBinaryLabelRuns<int>(mat, min_label, max_label, compress, runs);
+    }
+    
+    // Raw labels are stored using 16 bit whenever they fit, halving the
+    // file size; such files use version 2 such that older readers reject them.
+    bool narrow = (min_label >= 0 && max_label <= std::numeric_limits<unsigned short>::max());
+    int N = mat.rows*mat.cols;
+    
+    BinaryLabelHeader header;
+    memcpy(header.magic, BINARY_LABEL_MAGIC, 4);
+    header.version = (narrow ? BINARY_LABEL_VERSION_16U : BINARY_LABEL_VERSION);
+    header.encoding = BINARY_LABEL_RAW;
+    header.reserved = 0;
+    header.rows = mat.rows;
+    header.cols = mat.cols;
+    header.type = (narrow ? CV_16UC1 : CV_32SC1);
+    header.labels = max_label + 1;
+    header.words = (narrow ? (N + 1)/2 : N);
+    
+    if (compress && runs.size() < header.words) {
+        header.encoding = BINARY_LABEL_RLE;
+        header.words = runs.size();
+    }
+    
+    buffer.assign(sizeof(header) + header.words*sizeof(int32_t), 0);
+    memcpy(buffer.data(), &header, sizeof(header));
+    
+    char* data = buffer.data() + sizeof(header);
+    if (header.encoding == BINARY_LABEL_RLE) {
+        memcpy(data, runs.data(), runs.size()*sizeof(int32_t));
+    }
+    else if (narrow) {
+        uint16_t* data_16u = reinterpret_cast<uint16_t*>(data);
+        for (int i = 0; i < mat.rows; ++i) {
+            if (mat.type() == CV_16UC1) {
+                memcpy(data_16u + i*mat.cols, mat.ptr<char>(i), mat.cols*sizeof(uint16_t));
+            }
+            else {
+                const int* mat_i = mat.ptr<int>(i);
+                std::copy(mat_i, mat_i + mat.cols, data_16u + i*mat.cols);
+            }
+        }
+    }
+    else {
+        for (int i = 0; i < mat.rows; ++i) {
+            memcpy(data + i*mat.cols*sizeof(int32_t), mat.ptr<char>(i), 
+                    mat.cols*sizeof(int32_t));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// decodeMatBinaryInt
+////////////////////////////////////////////////////////////////////////////////
+
+int IOUtil::decodeMatBinaryInt(const char* data, size_t size, cv::Mat &result) {
+    BinaryLabelHeader header;
+    if (size < sizeof(header)) {
+        return -1;
+    }
+    
+    memcpy(&header, data, sizeof(header));
+    bool narrow = (header.version == BINARY_LABEL_VERSION_16U && header.type == CV_16UC1);
+    if (memcmp(header.magic, BINARY_LABEL_MAGIC, 4) != 0 
+            || (header.version != BINARY_LABEL_VERSION && !narrow)
+            || (header.version == BINARY_LABEL_VERSION && header.type != CV_32SC1)
+            || header.rows < 0 || header.cols < 0
+            || size != sizeof(header) + header.words*sizeof(int32_t)) {
+        return -1;
+    }
+    
+    data += sizeof(header);
+    result.create(header.rows, header.cols, CV_32SC1);
+    
+    if (header.encoding == BINARY_LABEL_RLE) {
+        if (header.words % 2 != 0) {
+            return -1;
         }
         
-        // Intialize output matrix.
-        if (i == 0) {
-            cols = data.size();
-            result.create(0, cols, CV_32SC1);
+        std::vector<int32_t> runs(header.words);
+        memcpy(runs.data(), data, runs.size()*sizeof(int32_t));
+        
+        // Runs may cross rows as the matrix is filled in row-major order.
+        int n = 0;
+        int N = header.rows*header.cols;
+        int* result_data = result.ptr<int>(0);
+        
+        for (unsigned int k = 0; k < runs.size(); k += 2) {
+            if (runs[k + 1] < 0 || n + runs[k + 1] > N) {
+                return -1;
+            }
             
-//            LOG(INFO) << "Reading CSV file with " << cols << " columns (" 
-//                    << file.string() << ").";
+            std::fill(result_data + n, result_data + n + runs[k + 1], runs[k]);
+            n += runs[k + 1];
         }
         
-        LOG_IF (FATAL, data.size() != cols) << "Invalid CSV file: " << cols << "!=" 
-                << data.size() << " " << i << "(" << file.string() << ").";;
+        if (n != N) {
+            return -1;
+        }
+    }
+    else if (narrow) {
+        int N = header.rows*header.cols;
+        if (header.encoding != BINARY_LABEL_RAW || header.words != (uint32_t) (N + 1)/2) {
+            return -1;
+        }
         
-        cv::Mat result_row(1, cols, CV_32SC1, cv::Scalar(0));
-    
-        for (int j = 0; j < cols; j++) {
-            result_row.at<int>(0, j) = atoi(data[j].c_str());
+        std::vector<uint16_t> labels(N);
+        memcpy(labels.data(), data, N*sizeof(uint16_t));
+        std::copy(labels.begin(), labels.end(), result.ptr<int>(0));
+    }
+    else {
+        if (header.encoding != BINARY_LABEL_RAW 
+                || header.words != (uint32_t) (header.rows*header.cols)) {
+            return -1;
         }
         
-        result.push_back(result_row);
-        i++;
+        memcpy(result.ptr<char>(0), data, header.words*sizeof(int32_t));
     }
     
-//    LOG(INFO) << "Read CSV file with " << i << " rows (" 
-//            << file.string() << ").";
+    return result.rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readFileBuffer
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Read the whole file into a buffer using a single read.
+ * \param[in] file path to file
+ * \param[out] buffer file contents
+ */
+static void readFileBuffer(boost::filesystem::path file, std::vector<char> &buffer) {
+    std::ifstream file_stream(file.c_str(), std::ifstream::in | std::ifstream::binary);
+    LOG_IF(FATAL, !file_stream.is_open()) << "Could not open file: " << file.string() << ".";
+    
+    file_stream.seekg(0, std::ifstream::end);
+    std::streamoff size = file_stream.tellg();
+    file_stream.seekg(0, std::ifstream::beg);
+    
+    buffer.resize(size);
+    if (size > 0) {
+        file_stream.read(buffer.data(), size);
+    }
+    
+    LOG_IF(FATAL, !file_stream) << "Could not read file: " << file.string() << ".";
+    file_stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeMatBinaryInt
+////////////////////////////////////////////////////////////////////////////////
+
+int IOUtil::writeMatBinaryInt(boost::filesystem::path file, const cv::Mat &mat,
+        bool compress) {
     
+    std::vector<char> buffer;
+    encodeMatBinaryInt(mat, buffer, compress);
+    
+    std::ofstream file_stream(file.c_str(), std::ofstream::out | std::ofstream::binary);
+    LOG_IF(FATAL, !file_stream.is_open()) << "Could not open file: " << file.string() << ".";
+    
+    file_stream.write(buffer.data(), buffer.size());
     file_stream.close();
     
-    return i;
+    return mat.rows;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// readMatCSVFloat
+// readMatBinaryInt
 ////////////////////////////////////////////////////////////////////////////////
 
-int IOUtil::readMatCSVFloat(boost::filesystem::path file, cv::Mat &result) {
+int IOUtil::readMatBinaryInt(boost::filesystem::path file, cv::Mat &result) {
     LOG_IF(FATAL, !boost::filesystem::is_regular_file(file)) 
             << "File does not exist: " << file.string() << ".";
     
-    std::ifstream file_stream(file.c_str());
+    std::vector<char> buffer;
+    readFileBuffer(file, buffer);
     
-    int i = 0;
-    int cols = 0; // To be determined.
+    int rows = decodeMatBinaryInt(buffer.data(), buffer.size(), result);
+    LOG_IF(FATAL, rows < 0) << "Invalid binary label file (" << file.string() << ").";
     
-    std::string line;
-    while (std::getline(file_stream, line, '\n')) {
-        
-        std::stringstream line_stream(line);
-        std::string cell;
+    return rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeSuperpixelFeatures
+////////////////////////////////////////////////////////////////////////////////
+
+const char SUPERPIXEL_FEATURES_MAGIC[4] = {'S', 'P', 'F', 'T'};
+const int32_t SUPERPIXEL_FEATURES_VERSION = 1;
+
+/** \brief Append an array to a buffer.
+ * \param[in] values array to append
+ * \param[in,out] buffer buffer to append to
+ */
+template<typename T>
+static void appendFeatureArray(const std::vector<T> &values, std::vector<char> &buffer) {
+    const char* data = reinterpret_cast<const char*>(values.data());
+    buffer.insert(buffer.end(), data, data + values.size()*sizeof(T));
+}
+
+int IOUtil::writeSuperpixelFeatures(boost::filesystem::path file, 
+        const SuperpixelTools::Features &features) {
+    
+    int S = features.superpixels;
+    LOG_IF(FATAL, features.areas.size() != S || features.mean_colors.size() != 3*S
+            || features.centroids.size() != 2*S || features.bounding_boxes.size() != S
+            || features.histograms.size() != 3*features.bins*S 
+            || features.offsets.size() != S + 1) << "Inconsistent superpixel features.";
+    
+    int32_t header[5] = {0, SUPERPIXEL_FEATURES_VERSION, S, features.bins, 
+        (int32_t) features.neighbors.size()};
+    memcpy(header, SUPERPIXEL_FEATURES_MAGIC, 4);
+    
+    std::vector<int32_t> bounding_boxes(4*S);
+    for (int k = 0; k < S; ++k) {
+        bounding_boxes[4*k + 0] = features.bounding_boxes[k].x;
+        bounding_boxes[4*k + 1] = features.bounding_boxes[k].y;
+        bounding_boxes[4*k + 2] = features.bounding_boxes[k].width;
+        bounding_boxes[4*k + 3] = features.bounding_boxes[k].height;
+    }
+    
+    std::vector<char> buffer(reinterpret_cast<const char*>(header), 
+            reinterpret_cast<const char*>(header) + sizeof(header));
+    appendFeatureArray(features.areas, buffer);
+    appendFeatureArray(features.mean_colors, buffer);
+    appendFeatureArray(features.centroids, buffer);
+    appendFeatureArray(bounding_boxes, buffer);
+    appendFeatureArray(features.histograms, buffer);
+    appendFeatureArray(features.offsets, buffer);
+    appendFeatureArray(features.neighbors, buffer);
+    
+    std::ofstream file_stream(file.c_str(), std::ofstream::out | std::ofstream::binary);
+    LOG_IF(FATAL, !file_stream.is_open()) << "Could not open file: " << file.string() << ".";
+    
+    file_stream.write(buffer.data(), buffer.size());
+    file_stream.close();
+    
+    return S;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readSuperpixelFeatures
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Read an array from a buffer.
+ * \param[in,out] data position in the buffer, advanced past the array
+ * \param[in] size number of elements
+ * \param[out] values array read
+ */
+template<typename T>
+static void readFeatureArray(const char* &data, int size, std::vector<T> &values) {
+    values.resize(size);
+    memcpy(values.data(), data, size*sizeof(T));
+    data += size*sizeof(T);
+}
+
+int IOUtil::readSuperpixelFeatures(boost::filesystem::path file, 
+        SuperpixelTools::Features &features) {
+    LOG_IF(FATAL, !boost::filesystem::is_regular_file(file)) 
+            << "File does not exist: " << file.string() << ".";
+    
+    std::vector<char> buffer;
+    readFileBuffer(file, buffer);
+    
+    int32_t header[5];
+    LOG_IF(FATAL, buffer.size() < sizeof(header)) 
+            << "Invalid superpixel feature file (" << file.string() << ").";
+    memcpy(header, buffer.data(), sizeof(header));
+    
+    int S = header[2];
+    int B = header[3];
+    int E = header[4];
+    size_t size = sizeof(header) + sizeof(int32_t)*(S + 4*S + S + 1 + E) 
+            + sizeof(float)*(3*S + 2*S + 3*B*S);
+    LOG_IF(FATAL, memcmp(header, SUPERPIXEL_FEATURES_MAGIC, 4) != 0
+            || header[1] != SUPERPIXEL_FEATURES_VERSION || S < 0 || B < 0 || E < 0
+            || buffer.size() != size) 
+            << "Invalid superpixel feature file (" << file.string() << ").";
+    
+    features.superpixels = S;
+    features.bins = B;
+    
+    std::vector<int32_t> bounding_boxes;
+    const char* data = buffer.data() + sizeof(header);
+    readFeatureArray(data, S, features.areas);
+    readFeatureArray(data, 3*S, features.mean_colors);
+    readFeatureArray(data, 2*S, features.centroids);
+    readFeatureArray(data, 4*S, bounding_boxes);
+    readFeatureArray(data, 3*B*S, features.histograms);
+    readFeatureArray(data, S + 1, features.offsets);
+    readFeatureArray(data, E, features.neighbors);
+    
+    features.bounding_boxes.resize(S);
+    for (int k = 0; k < S; ++k) {
+        features.bounding_boxes[k] = cv::Rect(bounding_boxes[4*k + 0], bounding_boxes[4*k + 1],
+                bounding_boxes[4*k + 2], bounding_boxes[4*k + 3]);
+    }
+    
+    return S;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// countCSVDimensions
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Determine the number of rows and the number of columns of the first
+ * row of a CSV file in memory.
+ * \param[in] begin begin of the buffer
+ * \param[in] end end of the buffer
+ * \param[out] rows number of rows
+ * \param[out] cols number of columns of the first row
+ */
+static void countCSVDimensions(const char* begin, const char* end, int &rows, int &cols) {
+    rows = 0;
+    cols = 0;
+    
+    if (begin == end) {
+        return;
+    }
+    
+    const char* first_end = std::find(begin, end, '\n');
+    cols = std::count(begin, first_end, ',') + 1;
+    
+    rows = std::count(begin, end, '\n');
+    if (*(end - 1) != '\n') {
+        rows++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// parseCSVCell
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Parse a single integer, equivalent to atoi on the cell.
+ * \param[in,out] p current position, moved behind the number
+ * \param[in] end end of the buffer
+ * \return parsed value
+ */
+static inline int parseCSVCell(const char* &p, const char* end, int) {
+    while (p != end && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+    
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+    
+    int value = 0;
+    while (p != end && (unsigned char) (*p - '0') < 10) {
+        value = 10*value + (*p - '0');
+        ++p;
+    }
+    
+    return negative ? -value : value;
+}
+
+/** \brief Parse a single float, equivalent to atof on the cell.
+ * \param[in,out] p current position, moved behind the number
+ * \param[in] end end of the buffer
+ * \return parsed value
+ */
+static inline float parseCSVCell(const char* &p, const char* end, float) {
+    while (p != end && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+    
+    // Empty cells are not passed to strtod as it would skip line breaks.
+    if (p == end || *p == ',' || *p == '\n' || *p == '\r') {
+        return 0;
+    }
+    
+    // The buffer is terminated by '\0', so strtod cannot run past its end.
+    char* number_end;
+    float value = strtod(p, &number_end);
+    p = number_end;
+    
+    return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// parseCSV
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Parse a CSV file in memory into a preallocated matrix.
+ * 
+ * Characters following a number up to the next separator are ignored, as
+ * with atoi/atof; lines with a different number of cells are rejected.
+ * 
+ * \param[in] begin begin of the buffer, terminated by '\0'
+ * \param[in] end end of the buffer
+ * \param[out] result preallocated matrix, rows of the file beyond result.rows are ignored
+ * \param[in] file path of the file, for error messages
+ * \return number of rows read
+ */
+template<typename T>
+int parseCSV(const char* begin, const char* end, cv::Mat &result, 
+        boost::filesystem::path file) {
+    
+    const char* p = begin;
+    for (int i = 0; i < result.rows; ++i) {
+        LOG_IF(FATAL, p == end) << "Invalid CSV file: expected " << result.rows 
+                << " rows, found " << i << " (" << file.string() << ").";
         
-        std::vector<std::string> data;
-        while(std::getline(line_stream, cell, ',')) {
-            data.push_back(cell);
-        }
+        T* result_i = result.ptr<T>(i);
         
-        // Intialize output matrix.
-        if (i == 0) {
-            cols = data.size();
-            result.create(0, cols, CV_32SC1);
+        int j = 0;
+        while (true) {
+            T value = parseCSVCell(p, end, T());
             
-//            LOG(INFO) << "Reading CSV file with " << cols << " columns (" 
-//                    << file.string() << ").";
+            // Skip whatever remains of the cell.
+            while (p != end && *p != ',' && *p != '\n') {
+                ++p;
+            }
+            
+            LOG_IF(FATAL, j >= result.cols) << "Invalid CSV file: " << result.cols << "!=" 
+                    << (j + 1) << " " << i << "(" << file.string() << ").";
+            result_i[j] = value;
+            ++j;
+            
+            if (p == end || *p == '\n') {
+                break;
+            }
+            
+            ++p;
         }
         
-        LOG_IF (FATAL, data.size() != cols) << "Invalid CSV file: " << cols << "!=" 
-                << data.size() << " " << i << "(" << file.string() << ").";;
+        LOG_IF(FATAL, j != result.cols) << "Invalid CSV file: " << result.cols << "!=" 
+                << j << " " << i << "(" << file.string() << ").";
         
-        cv::Mat result_row(1, cols, CV_32SC1, cv::Scalar(0));
+        if (p != end) {
+            ++p;
+        }
+    }
     
-        for (int j = 0; j < cols; j++) {
-            result_row.at<float>(0, j) = atof(data[j].c_str());
+    return result.rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readMatCSVInt
+////////////////////////////////////////////////////////////////////////////////
+
+int IOUtil::readMatCSVInt(boost::filesystem::path file, cv::Mat &result) {
+    LOG_IF(FATAL, !boost::filesystem::is_regular_file(file)) 
+            << "File does not exist: " << file.string() << ".";
+    
+    if (isBinaryFile(file)) {
+        return readMatBinaryInt(file, result);
+    }
+    
+    if (isPNGFile(file)) {
+        return readMatPNGInt(file, result);
+    }
+    
+    std::vector<char> buffer;
+    readFileBuffer(file, buffer);
+    
+    int rows = 0;
+    int cols = 0;
+    countCSVDimensions(buffer.data(), buffer.data() + buffer.size(), rows, cols);
+    
+//    LOG(INFO) << "Reading CSV file with " << cols << " columns (" 
+//            << file.string() << ").";
+    
+    buffer.push_back('\0');
+    result.create(rows, cols, CV_32SC1);
+    
+    return parseCSV<int>(buffer.data(), buffer.data() + buffer.size() - 1, result, file);
+}
+
+int IOUtil::readMatCSVInt(boost::filesystem::path file, int rows, int cols, cv::Mat &result) {
+    LOG_IF(FATAL, !boost::filesystem::is_regular_file(file)) 
+            << "File does not exist: " << file.string() << ".";
+    LOG_IF(FATAL, rows < 0 || cols <= 0) << "Invalid dimensions: (" 
+            << rows << "," << cols << ").";
+    
+    if (isBinaryFile(file) || isPNGFile(file)) {
+        if (isBinaryFile(file)) {
+            readMatBinaryInt(file, result);
+        }
+        else {
+            readMatPNGInt(file, result);
         }
         
-        result.push_back(result_row);
-        i++;
+        LOG_IF(FATAL, result.rows < rows || result.cols != cols) 
+                << "Invalid label file: (" << result.rows << "," << result.cols 
+                << ") != (" << rows << "," << cols << ") (" << file.string() << ").";
+        
+        result = result.rowRange(0, rows);
+        return rows;
     }
     
-//    LOG(INFO) << "Read CSV file with " << i << " rows (" 
-//            << file.string() << ").";
+    std::vector<char> buffer;
+    readFileBuffer(file, buffer);
+    buffer.push_back('\0');
     
-    file_stream.close();
+    result.create(rows, cols, CV_32SC1);
+    return parseCSV<int>(buffer.data(), buffer.data() + buffer.size() - 1, result, file);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readMatCSVFloat
+////////////////////////////////////////////////////////////////////////////////
+
+int IOUtil::readMatCSVFloat(boost::filesystem::path file, cv::Mat &result) {
+    LOG_IF(FATAL, !boost::filesystem::is_regular_file(file)) 
+            << "File does not exist: " << file.string() << ".";
     
-    return i;
+    std::vector<char> buffer;
+    readFileBuffer(file, buffer);
+    
+    int rows = 0;
+    int cols = 0;
+    countCSVDimensions(buffer.data(), buffer.data() + buffer.size(), rows, cols);
+    
+    buffer.push_back('\0');
+    
+    // Note that the values are stored as float in a CV_32SC1 matrix as
+    // callers access them using at<float>.
+    result.create(rows, cols, CV_32SC1);
+    
+    return parseCSV<float>(buffer.data(), buffer.data() + buffer.size() - 1, result, file);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
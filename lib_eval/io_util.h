@@ -35,8 +35,10 @@
 #include <vector>
 #include <map> 
 #include <string>
+#include <future>
 #include <boost/filesystem.hpp>
 #include <opencv2/opencv.hpp>
+#include "superpixel_tools.h"
 
 #ifndef DIRECTORY_SEPARATOR
     #if defined(WIN32) || defined(_WIN32)
@@ -98,7 +100,28 @@ public:
     static int writeMatCSV(boost::filesystem::path file, const cv::Mat& mat, 
             std::string separator = ",", int precision = 6);
     
+    /** \brief Write the content of a cv::Mat to a CSV file in the background,
+     * see writeMatCSV.
+     * 
+     * The matrix is copied, the caller is free to modify it afterwards. The
+     * returned future needs to be waited on before the file is used.
+     * 
+     * \param[in] file path to file to write
+     * \param[in] mat matrix to write
+     * \param[in] separator separator to use for CSV
+     * \param[in] precision
+     * \return future holding the number of rows written
+     */
+    template<typename T>
+    static std::future<int> writeMatCSVAsync(boost::filesystem::path file, const cv::Mat& mat, 
+            std::string separator = ",", int precision = 6);
+    
     /** \brief Read CSV file into matrix.
+     * 
+     * Files with a binary label extension, see getBinaryExtensions, are
+     * read using readMatBinaryInt instead; PNG label maps, see 
+     * getPNGExtensions, using readMatPNGInt.
+     * 
      * \param[in] file path to file
      * \param[out] result matrix read
      * \return number of rows read
@@ -121,6 +144,107 @@ public:
      */
     static int readMatCSVFloat(boost::filesystem::path file, cv::Mat &result);
     
+    /** \brief Write an integer label map in the binary label format.
+     * 
+     * The file starts with a header of the magic "SPLB", version, encoding,
+     * rows, cols, OpenCV type and number of labels (maximum label plus one),
+     * followed by the labels in row-major order in native byte order. If
+     * requested, the labels are run-length encoded as (label, length) pairs
+     * whenever this is smaller than the raw labels. Raw labels within 
+     * [0, 65535] are stored using 16 bit (version 2, type CV_16UC1), padded
+     * to 32-bit words.
+     * 
+     * \param[in] file path to file to write
+     * \param[in] mat label map to write as CV_32SC1 or CV_16UC1
+     * \param[in] compress whether to use run-length encoding if beneficial
+     * \return number of rows written
+     */
+    static int writeMatBinaryInt(boost::filesystem::path file, const cv::Mat &mat,
+            bool compress = true);
+    
+    /** \brief Encode an integer label map in the binary label format in memory,
+     * see writeMatBinaryInt.
+     * \param[in] mat label map to encode as CV_32SC1 or CV_16UC1
+     * \param[out] buffer encoded label map, header followed by labels
+     * \param[in] compress whether to use run-length encoding if beneficial
+     */
+    static void encodeMatBinaryInt(const cv::Mat &mat, std::vector<char> &buffer,
+            bool compress = true);
+    
+    /** \brief Decode an integer label map in the binary label format from memory.
+     * \param[in] data encoded label map as written by encodeMatBinaryInt
+     * \param[in] size size of data in bytes
+     * \param[out] result label map decoded as CV_32SC1
+     * \return number of rows decoded, -1 if the data is invalid
+     */
+    static int decodeMatBinaryInt(const char* data, size_t size, cv::Mat &result);
+    
+    /** \brief Read an integer label map in the binary label format, see writeMatBinaryInt.
+     * \param[in] file path to file
+     * \param[out] result label map read as CV_32SC1
+     * \return number of rows read
+     */
+    static int readMatBinaryInt(boost::filesystem::path file, cv::Mat &result);
+    
+    /** \brief Write superpixel features in a binary format.
+     * 
+     * The file starts with the magic "SPFT", a 32-bit version, the number of 
+     * superpixels S, the number of bins B and the number of neighbor entries E
+     * as 32-bit integers, followed by the arrays of SuperpixelTools::Features
+     * in native byte order: areas (S int32), mean colors (3S float), centroids
+     * (2S float), bounding boxes as x, y, width, height (4S int32), histograms
+     * (3BS float), offsets (S + 1 int32) and neighbors (E int32).
+     * 
+     * \param[in] file path to file to write
+     * \param[in] features features to write
+     * \return number of superpixels written
+     */
+    static int writeSuperpixelFeatures(boost::filesystem::path file, 
+            const SuperpixelTools::Features &features);
+    
+    /** \brief Read superpixel features, see writeSuperpixelFeatures.
+     * \param[in] file path to file
+     * \param[out] features features read
+     * \return number of superpixels read
+     */
+    static int readSuperpixelFeatures(boost::filesystem::path file, 
+            SuperpixelTools::Features &features);
+    
+    /** \brief Check whether the file uses the binary label format based on its extension.
+     * \param[in] file path to file
+     * \return whether the file is a binary label file
+     */
+    static bool isBinaryFile(boost::filesystem::path file);
+    
+    /** \brief Write a label map as 16-bit single-channel PNG using fast 
+     * compression; labels need to be within [0, 65535].
+     * \param[in] file path to file to write
+     * \param[in] mat label map to write as CV_32SC1 or CV_16UC1
+     * \return number of rows written
+     */
+    static int writeMatPNGInt(boost::filesystem::path file, const cv::Mat &mat);
+    
+    /** \brief Read a label map stored as 8- or 16-bit single-channel PNG.
+     * \param[in] file path to file
+     * \param[out] result label map read as CV_32SC1
+     * \return number of rows read
+     */
+    static int readMatPNGInt(boost::filesystem::path file, cv::Mat &result);
+    
+    /** \brief Check whether the file is a PNG label map based on its extension.
+     * \param[in] file path to file
+     * \return whether the file is a PNG label map
+     */
+    static bool isPNGFile(boost::filesystem::path file);
+    
+    /** \brief Write a label map in the format given by the extension of the
+     * file: binary label format (.lbl), 16-bit PNG (.png) or CSV otherwise.
+     * \param[in] file path to file to write
+     * \param[in] labels label map to write as CV_32SC1 or CV_16UC1
+     * \return number of rows written
+     */
+    static int writeLabels(boost::filesystem::path file, const cv::Mat &labels);
+    
     /** \brief Read header of CSV file into string array.
      * \param[in] file path to file
      * \param[out] header header strings as vector
@@ -171,6 +295,24 @@ public:
         std::multimap<std::string, boost::filesystem::path> &files,
         std::string prefix = "", std::string suffix = "");
     
+    /** \brief Parse a shard given as "i/N", i.e. the i-th of N shards.
+     * \param[in] shard_string shard as string
+     * \param[out] shard index of the shard
+     * \param[out] shards number of shards
+     * \return whether the shard is valid, i.e. 0 <= i < N
+     */
+    static bool parseShard(const std::string &shard_string, int &shard, int &shards);
+    
+    /** \brief Keep every shards-th file, starting with the shard-th one, of
+     * the ordered files as read by readDirectory; this partitions the files
+     * deterministically across shards.
+     * \param[in,out] files files to select the shard from
+     * \param[in] shard index of the shard
+     * \param[in] shards number of shards
+     */
+    static void selectShard(std::multimap<std::string, boost::filesystem::path> &files,
+        int shard, int shards);
+    
     /** \brief Gets a vector containing common extensions for images
      * \param[out] extensions image extensions
      */
@@ -186,6 +328,21 @@ public:
      */
     static void getCSVExtensions(std::vector<std::string> &extensions);
     
+    /** \brief Get a vector of binary label file extensions, see writeMatBinaryInt.
+     * \param[out] extensions binary label extensions
+     */
+    static void getBinaryExtensions(std::vector<std::string> &extensions);
+    
+    /** \brief Get a vector of PNG label map extensions, see writeMatPNGInt.
+     * \param[out] extensions PNG label extensions
+     */
+    static void getPNGExtensions(std::vector<std::string> &extensions);
+    
+    /** \brief Get a vector of all label map extensions, i.e. CSV, binary and PNG.
+     * \param[out] extensions label map extensions
+     */
+    static void getLabelExtensions(std::vector<std::string> &extensions);
+    
 };
 
 #endif	/* IO_UTIL_H */
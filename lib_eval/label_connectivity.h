@@ -0,0 +1,203 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LABEL_CONNECTIVITY_H
+#define	LABEL_CONNECTIVITY_H
+
+#include <algorithm>
+#include <vector>
+
+/** \brief Connectivity enforcement shared by SLIC and preSLIC: every connected
+ * component gets its own label and components of at most a quarter of the
+ * expected superpixel size are merged into an adjacent component.
+ * 
+ * Components are found using a scanline flood fill. All buffers live in a
+ * Workspace which keeps its capacity across calls, so running on one
+ * frame after the other does not allocate once the first frame is done.
+ * The class is header-only such that the algorithm libraries can use it
+ * without linking against lib_eval.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   LabelConnectivity::Workspace workspace;
+ *   LabelConnectivity::enforce(labels, width, height, K, labels, numlabels, workspace);
+ * \endcode
+ * \author David Stutz
+ */
+class LabelConnectivity {
+public:
+    /** \brief Buffers reused across calls. */
+    struct Workspace {
+        /** \brief Copy of the input labels for in-place enforcement. */
+        std::vector<int> labels;
+        /** \brief Pixels still to be filled. */
+        std::vector<int> stack;
+        /** \brief First and last pixel of the row spans of the current component. */
+        std::vector<int> spans;
+    };
+    
+    /** \brief Enforce connectivity, same as SLIC::EnforceLabelConnectivity.
+     * 
+     * Components are numbered in the raster order of their first pixel; a
+     * small component takes the label of the last labeled 4-neighbor (left,
+     * top, right, bottom) of its first pixel.
+     * 
+     * \param[in] labels labels, may be the same as nlabels
+     * \param[in] width width of the labels
+     * \param[in] height height of the labels
+     * \param[in] K number of superpixels desired, defining the expected size
+     * \param[out] nlabels connected labels
+     * \param[out] numlabels number of connected labels
+     * \param[in,out] workspace buffers
+     */
+    static void enforce(const int* labels, int width, int height, int K, 
+            int* nlabels, int &numlabels, Workspace &workspace) {
+        
+        const int dx4[4] = {-1,  0,  1,  0};
+        const int dy4[4] = { 0, -1,  0,  1};
+        
+        const int size = width*height;
+        const int max_merged_size = (size/K) >> 2;
+        
+        if (labels == nlabels) {
+            workspace.labels.assign(labels, labels + size);
+            labels = workspace.labels.data();
+        }
+        
+        std::fill(nlabels, nlabels + size, -1);
+        
+        int label = 0;
+        int adjacent_label = 0;
+        for (int j = 0; j < height; ++j) {
+            for (int k = 0; k < width; ++k) {
+                int index = j*width + k;
+                if (nlabels[index] >= 0) {
+                    continue;
+                }
+                
+                for (int n = 0; n < 4; ++n) {
+                    int x = k + dx4[n];
+                    int y = j + dy4[n];
+                    if (x >= 0 && x < width && y >= 0 && y < height 
+                            && nlabels[y*width + x] >= 0) {
+                        adjacent_label = nlabels[y*width + x];
+                    }
+                }
+                
+                int count = fill(labels, width, height, index, label, nlabels, workspace);
+                if (count <= max_merged_size) {
+                    for (unsigned int s = 0; s < workspace.spans.size(); s += 2) {
+                        std::fill(nlabels + workspace.spans[s], 
+                                nlabels + workspace.spans[s + 1] + 1, adjacent_label);
+                    }
+                }
+                else {
+                    ++label;
+                }
+            }
+        }
+        
+        numlabels = label;
+    }
+    
+private:
+    
+    /** \brief Label the component of the given pixel, recording its row spans
+     * in workspace.spans.
+     * \param[in] labels labels
+     * \param[in] width width of the labels
+     * \param[in] height height of the labels
+     * \param[in] start first pixel of the component
+     * \param[in] label label to assign
+     * \param[in,out] nlabels connected labels, -1 for unlabeled pixels
+     * \param[in,out] workspace buffers
+     * \return size of the component
+     */
+    static int fill(const int* labels, int width, int height, int start, 
+            int label, int* nlabels, Workspace &workspace) {
+        
+        const int value = labels[start];
+        
+        workspace.stack.clear();
+        workspace.spans.clear();
+        workspace.stack.push_back(start);
+        
+        int count = 0;
+        while (!workspace.stack.empty()) {
+            int index = workspace.stack.back();
+            workspace.stack.pop_back();
+            
+            if (nlabels[index] >= 0) {
+                continue;
+            }
+            
+            int y = index/width;
+            int row = y*width;
+            int x1 = index - row;
+            int x2 = x1;
+            
+            while (x1 > 0 && nlabels[row + x1 - 1] < 0 && labels[row + x1 - 1] == value) {
+                --x1;
+            }
+            while (x2 < width - 1 && nlabels[row + x2 + 1] < 0 && labels[row + x2 + 1] == value) {
+                ++x2;
+            }
+            
+            std::fill(nlabels + row + x1, nlabels + row + x2 + 1, label);
+            workspace.spans.push_back(row + x1);
+            workspace.spans.push_back(row + x2);
+            count += x2 - x1 + 1;
+            
+            // Push the first pixel of each run to continue above and below.
+            for (int yy = y - 1; yy <= y + 1; yy += 2) {
+                if (yy < 0 || yy >= height) {
+                    continue;
+                }
+                
+                int neighbor_row = yy*width;
+                bool inside = false;
+                for (int x = x1; x <= x2; ++x) {
+                    bool match = nlabels[neighbor_row + x] < 0 
+                            && labels[neighbor_row + x] == value;
+                    if (match && !inside) {
+                        workspace.stack.push_back(neighbor_row + x);
+                    }
+                    inside = match;
+                }
+            }
+        }
+        
+        return count;
+    }
+    
+};
+
+#endif	/* LABEL_CONNECTIVITY_H */
@@ -0,0 +1,281 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <glog/logging.h>
+#ifdef __linux__
+#include <malloc.h>
+#endif
+#include "runtime_harness.h"
+#include "memory_profile.h"
+
+/** \brief Whether allocations are counted. */
+static std::atomic<bool> memory_profile_counting(false);
+/** \brief Number of counted allocations. */
+static std::atomic<long> memory_profile_allocations(0);
+/** \brief Total size of counted allocations in bytes. */
+static std::atomic<long> memory_profile_allocated(0);
+/** \brief Size of allocations in use in bytes. */
+static std::atomic<long> memory_profile_heap(0);
+/** \brief Peak of memory_profile_heap. */
+static std::atomic<long> memory_profile_peak_heap(0);
+
+/** \brief Count an allocation.
+ * \param[in] memory allocated memory
+ * \param[in] size requested size in bytes
+ */
+static void countAllocation(void* memory, std::size_t size) {
+    memory_profile_allocations.fetch_add(1, std::memory_order_relaxed);
+    memory_profile_allocated.fetch_add(size, std::memory_order_relaxed);
+    
+#ifdef __linux__
+    long heap = memory_profile_heap.fetch_add(malloc_usable_size(memory), 
+            std::memory_order_relaxed) + malloc_usable_size(memory);
+    
+    long peak = memory_profile_peak_heap.load(std::memory_order_relaxed);
+    while (heap > peak && !memory_profile_peak_heap.compare_exchange_weak(peak, heap,
+            std::memory_order_relaxed)) {
+        
+    }
+#endif
+}
+
+/** \brief Count a deallocation.
+ * \param[in] memory memory to be freed
+ */
+static void countDeallocation(void* memory) {
+#ifdef __linux__
+    memory_profile_heap.fetch_sub(malloc_usable_size(memory), std::memory_order_relaxed);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// operator new
+////////////////////////////////////////////////////////////////////////////////
+
+void* operator new(std::size_t size) {
+    if (size == 0) {
+        size = 1;
+    }
+    
+    void* memory;
+    while ((memory = std::malloc(size)) == NULL) {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == NULL) {
+            throw std::bad_alloc();
+        }
+        
+        handler();
+    }
+    
+    if (memory_profile_counting.load(std::memory_order_relaxed)) {
+        countAllocation(memory, size);
+    }
+    
+    return memory;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// operator delete
+////////////////////////////////////////////////////////////////////////////////
+
+void operator delete(void* memory) noexcept {
+    if (memory != NULL && memory_profile_counting.load(std::memory_order_relaxed)) {
+        countDeallocation(memory);
+    }
+    
+    std::free(memory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+MemoryProfile::MemoryProfile(bool enabled) 
+        : enabled(enabled), started(false), base_heap(0) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+////////////////////////////////////////////////////////////////////////////////
+
+MemoryProfile::~MemoryProfile() {
+    if (started) {
+        memory_profile_counting.store(false);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// isEnabled
+////////////////////////////////////////////////////////////////////////////////
+
+bool MemoryProfile::isEnabled() const {
+    return enabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// begin
+////////////////////////////////////////////////////////////////////////////////
+
+void MemoryProfile::begin(const std::string &name) {
+    if (!enabled) {
+        return;
+    }
+    
+    LOG_IF(FATAL, started) << "Record " << records.back().name << " not ended.";
+    
+    // Allocations for sampling the resident set size are not counted.
+    Record record;
+    record.name = name;
+    RuntimeHarness::resetPeakRSS();
+    record.rss = RuntimeHarness::getRSS();
+    records.push_back(record);
+    
+    memory_profile_allocations.store(0);
+    memory_profile_allocated.store(0);
+    base_heap = memory_profile_heap.load();
+    memory_profile_peak_heap.store(base_heap);
+    
+    started = true;
+    memory_profile_counting.store(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// end
+////////////////////////////////////////////////////////////////////////////////
+
+void MemoryProfile::end() {
+    if (!enabled) {
+        return;
+    }
+    
+    LOG_IF(FATAL, !started) << "No record started.";
+    
+    memory_profile_counting.store(false);
+    started = false;
+    
+    Record &record = records.back();
+    record.allocations = memory_profile_allocations.load();
+    record.allocated = memory_profile_allocated.load()/1024;
+    record.peak_rss = RuntimeHarness::getPeakRSS();
+    
+#ifdef __linux__
+    record.peak_heap = (memory_profile_peak_heap.load() - base_heap)/1024;
+#else
+    record.peak_heap = -1;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getRecords
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<MemoryProfile::Record>& MemoryProfile::getRecords() const {
+    return records;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeRecords
+////////////////////////////////////////////////////////////////////////////////
+
+bool MemoryProfile::writeRecords(const boost::filesystem::path &file, 
+        const std::vector<Record> &records) {
+    
+    std::ofstream stream(file.string());
+    if (!stream.is_open()) {
+        return false;
+    }
+    
+    stream << "name,allocations,allocated,peak_heap,rss,peak_rss\n";
+    for (unsigned int i = 0; i < records.size(); ++i) {
+        stream << records[i].name << "," << records[i].allocations << "," 
+                << records[i].allocated << "," << records[i].peak_heap << "," 
+                << records[i].rss << "," << records[i].peak_rss << "\n";
+    }
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readRecords
+////////////////////////////////////////////////////////////////////////////////
+
+bool MemoryProfile::readRecords(const boost::filesystem::path &file, 
+        std::vector<Record> &records) {
+    
+    std::ifstream stream(file.string());
+    if (!stream.is_open()) {
+        return false;
+    }
+    
+    records.clear();
+    
+    std::string line;
+    std::getline(stream, line); // Header.
+    
+    while (std::getline(stream, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        
+        // Names may contain commas, the numbers never do.
+        Record record;
+        std::vector<long> values(5, 0);
+        for (int k = 4; k >= 0; --k) {
+            size_t comma = line.rfind(',');
+            if (comma == std::string::npos) {
+                return false;
+            }
+            
+            std::istringstream value(line.substr(comma + 1));
+            if (!(value >> values[k])) {
+                return false;
+            }
+            
+            line.erase(comma);
+        }
+        
+        record.name = line;
+        record.allocations = values[0];
+        record.allocated = values[1];
+        record.peak_heap = values[2];
+        record.rss = values[3];
+        record.peak_rss = values[4];
+        records.push_back(record);
+    }
+    
+    return true;
+}
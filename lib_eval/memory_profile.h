@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MEMORY_PROFILE_H
+#define	MEMORY_PROFILE_H
+
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+/** \brief Opt-in memory instrumentation of the command line tools.
+ * 
+ * Between begin and end, allocations through the global operator new are 
+ * counted (number, total size and peak size in use), and the resident set 
+ * size is sampled; the peak resident set size is reset at begin where
+ * supported, see RuntimeHarness::resetPeakRSS. The counters also include
+ * the matrices allocated by OpenCV only through the resident set size, as
+ * these are allocated using malloc. Counters and resident set size are 
+ * process-wide, i.e. images should be processed one at a time.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
+ *   for (...) {
+ *       memory_profile.begin(prefix + it->second.stem().string());
+ *       // Read image and compute superpixels ...
+ *       memory_profile.end();
+ *   }
+ *   
+ *   MemoryProfile::writeRecords(output_dir / "memory.csv", memory_profile.getRecords());
+ * \endcode
+ * \author David Stutz
+ */
+class MemoryProfile {
+public:
+    
+    /** \brief Memory used for a single image. */
+    struct Record {
+        /** \brief Name of the record, e.g. the image. */
+        std::string name;
+        /** \brief Number of allocations. */
+        long allocations;
+        /** \brief Total size of all allocations in KiB. */
+        long allocated;
+        /** \brief Peak size of allocations in use, relative to begin, in KiB; -1 if unknown. */
+        long peak_heap;
+        /** \brief Resident set size at begin in KiB, -1 if unknown. */
+        long rss;
+        /** \brief Peak resident set size in KiB, -1 if unknown. */
+        long peak_rss;
+    };
+    
+    /** \brief Constructor.
+     * \param[in] enabled whether to record, otherwise begin and end do nothing
+     */
+    MemoryProfile(bool enabled = true);
+    
+    /** \brief Destructor, stops counting. */
+    ~MemoryProfile();
+    
+    /** \brief Whether the profile records.
+     * \return enabled
+     */
+    bool isEnabled() const;
+    
+    /** \brief Start a record.
+     * \param[in] name name of the record
+     */
+    void begin(const std::string &name);
+    
+    /** \brief End the current record. */
+    void end();
+    
+    /** \brief Get all records so far.
+     * \return records
+     */
+    const std::vector<Record>& getRecords() const;
+    
+    /** \brief Write records as CSV file with one line per record.
+     * \param[in] file CSV file to write
+     * \param[in] records records to write
+     * \return whether the file could be written
+     */
+    static bool writeRecords(const boost::filesystem::path &file, 
+            const std::vector<Record> &records);
+    
+    /** \brief Read records written by writeRecords.
+     * \param[in] file CSV file to read
+     * \param[out] records read records
+     * \return whether the file could be read
+     */
+    static bool readRecords(const boost::filesystem::path &file, 
+            std::vector<Record> &records);
+    
+private:
+    
+    /** \brief Whether to record. */
+    bool enabled;
+    /** \brief Whether a record is started. */
+    bool started;
+    /** \brief Size of allocations in use at begin in bytes. */
+    long base_heap;
+    /** \brief Records. */
+    std::vector<Record> records;
+    
+};
+
+#endif	/* MEMORY_PROFILE_H */
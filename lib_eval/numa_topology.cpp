@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <boost/filesystem.hpp>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "numa_topology.h"
+
+/** \brief Parse a CPU list as in sysfs, e.g. 0-3,8-11.
+ * \param[in] list CPU list
+ * \param[out] cpus indices of the CPUs
+ */
+static void parseCPUList(const std::string &list, std::vector<int> &cpus) {
+    std::stringstream stream(list);
+    std::string range;
+    
+    while (std::getline(stream, range, ',')) {
+        int first = -1;
+        int last = -1;
+        
+        int read = sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (read == 1) {
+            last = first;
+        }
+        
+        for (int cpu = first; read >= 1 && cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getTopology
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<std::vector<int> >& NumaTopology::getTopology() {
+    static std::vector<std::vector<int> > topology = []() {
+        std::vector<std::vector<int> > nodes;
+        
+        // Nodes are numbered consecutively, memory-only nodes without CPUs
+        // are skipped.
+        boost::filesystem::path node_dir("/sys/devices/system/node");
+        for (int node = 0; boost::filesystem::is_directory(node_dir 
+                / ("node" + std::to_string(node))); ++node) {
+            
+            std::ifstream cpulist_file((node_dir / ("node" + std::to_string(node)) 
+                    / "cpulist").string());
+            std::string cpulist;
+            std::getline(cpulist_file, cpulist);
+            
+            std::vector<int> cpus;
+            parseCPUList(cpulist, cpus);
+            
+            if (!cpus.empty()) {
+                nodes.push_back(cpus);
+            }
+        }
+        
+        if (nodes.empty()) {
+            nodes.push_back(std::vector<int>());
+            for (unsigned int cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+                nodes[0].push_back(cpu);
+            }
+        }
+        
+        return nodes;
+    }();
+    
+    return topology;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getNodes
+////////////////////////////////////////////////////////////////////////////////
+
+int NumaTopology::getNodes() {
+    return getTopology().size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCPUs
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<int>& NumaTopology::getCPUs(int node) {
+    static const std::vector<int> none;
+    
+    const std::vector<std::vector<int> > &topology = getTopology();
+    if (node < 0 || node >= (int) topology.size()) {
+        return none;
+    }
+    
+    return topology[node];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// pinThreadToNode
+////////////////////////////////////////////////////////////////////////////////
+
+bool NumaTopology::pinThreadToNode(int node) {
+#ifdef __linux__
+    const std::vector<int> &cpus = getCPUs(node);
+    if (cpus.empty()) {
+        return false;
+    }
+    
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned int i = 0; i < cpus.size(); ++i) {
+        if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE) {
+            CPU_SET(cpus[i], &set);
+        }
+    }
+    
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NUMA_TOPOLOGY_H
+#define	NUMA_TOPOLOGY_H
+
+#include <vector>
+
+/** \brief NUMA nodes (i.e. sockets) of the machine and their CPUs, used to
+ * keep threads and the memory they touch on the same node.
+ * 
+ * The topology is read once from /sys/devices/system/node; without NUMA
+ * support (or on other systems than Linux), all CPUs form a single node.
+ * Memory is placed on the node of the thread touching it first (the default
+ * policy of Linux), so pinning a thread to a node before it allocates and
+ * initializes its images, planes and label maps keeps them local; no further
+ * placement is done, and libnuma is not needed.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   // Run the calling thread, and threads started by it, on the last node.
+ *   NumaTopology::pinThreadToNode(NumaTopology::getNodes() - 1);
+ * \endcode
+ * \author David Stutz
+ */
+class NumaTopology {
+public:
+    
+    /** \brief Get the number of NUMA nodes.
+     * \return number of nodes, at least one
+     */
+    static int getNodes();
+    
+    /** \brief Get the CPUs of a node.
+     * \param[in] node index of node
+     * \return indices of the CPUs, empty for invalid nodes
+     */
+    static const std::vector<int>& getCPUs(int node);
+    
+    /** \brief Pin the calling thread to the CPUs of a node; threads started
+     * afterwards by the calling thread inherit the affinity. Only supported on
+     * Linux.
+     * \param[in] node index of node
+     * \return whether the thread was pinned
+     */
+    static bool pinThreadToNode(int node);
+    
+private:
+    
+    /** \brief CPUs of all nodes, read on first use.
+     * \return CPUs per node
+     */
+    static const std::vector<std::vector<int> >& getTopology();
+    
+};
+
+#endif	/* NUMA_TOPOLOGY_H */
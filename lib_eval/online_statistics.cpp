@@ -0,0 +1,215 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <glog/logging.h>
+#include "online_statistics.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+OnlineStatistics::OnlineStatistics(int k) 
+        : k(k), count(0), mean(0), m2(0), min(0), max(0), 
+        levels(1), size(0), compactions(0) {
+    
+    LOG_IF(FATAL, k < 2) << "Sketch size needs to be at least 2.";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// add
+////////////////////////////////////////////////////////////////////////////////
+
+void OnlineStatistics::add(float value) {
+    
+    if (count == 0) {
+        min = value;
+        max = value;
+    }
+    
+    min = std::min(min, value);
+    max = std::max(max, value);
+    
+    ++count;
+    double delta = value - mean;
+    mean += delta/count;
+    m2 += delta*(value - mean);
+    
+    levels[0].push_back(value);
+    ++size;
+    
+    int capacity = 0;
+    for (unsigned int h = 0; h < levels.size(); ++h) {
+        capacity += getCapacity(h);
+    }
+    
+    if (size > capacity) {
+        compact();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCapacity
+////////////////////////////////////////////////////////////////////////////////
+
+int OnlineStatistics::getCapacity(int level) const {
+    
+    // Capacities decrease geometrically from the top level downwards.
+    int depth = levels.size() - level - 1;
+    return std::max(2, (int) std::ceil(k*std::pow(2./3., depth)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// compact
+////////////////////////////////////////////////////////////////////////////////
+
+void OnlineStatistics::compact() {
+    
+    for (unsigned int h = 0; h < levels.size(); ++h) {
+        if ((int) levels[h].size() < getCapacity(h)) {
+            continue;
+        }
+        
+        if (h + 1 == levels.size()) {
+            levels.push_back(std::vector<float>());
+        }
+        
+        std::vector<float> &level = levels[h];
+        std::sort(level.begin(), level.end());
+        
+        // Keep a single value in this level if the number of values is odd.
+        float odd = 0;
+        bool has_odd = level.size()%2 == 1;
+        if (has_odd) {
+            odd = level.back();
+            level.pop_back();
+        }
+        
+        int offset = compactions%2;
+        for (unsigned int i = offset; i < level.size(); i += 2) {
+            levels[h + 1].push_back(level[i]);
+        }
+        
+        size -= level.size()/2;
+        level.clear();
+        
+        if (has_odd) {
+            level.push_back(odd);
+        }
+        
+        ++compactions;
+        return;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCount
+////////////////////////////////////////////////////////////////////////////////
+
+int OnlineStatistics::getCount() const {
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getMean
+////////////////////////////////////////////////////////////////////////////////
+
+float OnlineStatistics::getMean() const {
+    return mean;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getStandardDeviation
+////////////////////////////////////////////////////////////////////////////////
+
+float OnlineStatistics::getStandardDeviation() const {
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    return std::sqrt(m2/count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getMin
+////////////////////////////////////////////////////////////////////////////////
+
+float OnlineStatistics::getMin() const {
+    return min;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getMax
+////////////////////////////////////////////////////////////////////////////////
+
+float OnlineStatistics::getMax() const {
+    return max;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getQuantile
+////////////////////////////////////////////////////////////////////////////////
+
+float OnlineStatistics::getQuantile(float p) const {
+    
+    LOG_IF(FATAL, p > 1 || p < 0) << "Cannot compute p-quantile for p > 1 or p < 0.";
+    
+    if (size == 0) {
+        return 0;
+    }
+    
+    std::vector< std::pair<float, long> > weighted;
+    weighted.reserve(size);
+    
+    long total = 0;
+    for (unsigned int h = 0; h < levels.size(); ++h) {
+        for (unsigned int i = 0; i < levels[h].size(); ++i) {
+            weighted.push_back(std::make_pair(levels[h][i], 1L << h));
+            total += 1L << h;
+        }
+    }
+    
+    std::sort(weighted.begin(), weighted.end());
+    
+    // Smallest value whose cumulative weight reaches the requested rank.
+    double rank = p*total;
+    long cumulative = 0;
+    for (unsigned int i = 0; i < weighted.size(); ++i) {
+        cumulative += weighted[i].second;
+        if (cumulative >= rank) {
+            return weighted[i].first;
+        }
+    }
+    
+    return weighted.back().first;
+}
@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ONLINE_STATISTICS_H
+#define	ONLINE_STATISTICS_H
+
+#include <vector>
+
+/** \brief Single pass statistics of a stream of values with bounded memory.
+ * 
+ * Mean and standard deviation are accumulated using Welford's algorithm,
+ * minimum and maximum exactly; quantiles are approximated using a KLL sketch,
+ * i.e. a hierarchy of compactors where each level halves the number of values
+ * by keeping every other sorted value with twice the weight. Quantiles are
+ * exact as long as fewer values than the sketch size were added.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   OnlineStatistics statistics;
+ *   for (int i = 0; i < n; ++i) {
+ *       statistics.add(values[i]);
+ *   }
+ *   float median = statistics.getQuantile(0.5);
+ * \endcode
+ * \author David Stutz
+ */
+class OnlineStatistics {
+public:
+    /** \brief Constructor.
+     * \param[in] k sketch size, the rank error of quantiles is roughly 1.7/k
+     */
+    OnlineStatistics(int k = 200);
+    
+    /** \brief Add a value.
+     * \param[in] value value to add
+     */
+    void add(float value);
+    
+    /** \brief Get the number of values added.
+     * \return count
+     */
+    int getCount() const;
+    
+    /** \brief Get the mean, zero if no values were added.
+     * \return mean
+     */
+    float getMean() const;
+    
+    /** \brief Get the (population) standard deviation, zero if no values were added.
+     * \return standard deviation
+     */
+    float getStandardDeviation() const;
+    
+    /** \brief Get the minimum, zero if no values were added.
+     * \return minimum
+     */
+    float getMin() const;
+    
+    /** \brief Get the maximum, zero if no values were added.
+     * \return maximum
+     */
+    float getMax() const;
+    
+    /** \brief Get an approximate quantile, zero if no values were added.
+     * \param[in] p quantile in [0, 1], e.g. 0.5 for the median
+     * \return p-quantile
+     */
+    float getQuantile(float p) const;
+    
+private:
+    /** \brief Get the capacity of a compactor level.
+     * \param[in] level level
+     * \return capacity
+     */
+    int getCapacity(int level) const;
+    
+    /** \brief Compact the lowest full level into the next one. */
+    void compact();
+    
+    /** \brief Sketch size. */
+    int k;
+    /** \brief Number of values. */
+    int count;
+    /** \brief Running mean. */
+    double mean;
+    /** \brief Running sum of squared differences from the mean. */
+    double m2;
+    /** \brief Minimum. */
+    float min;
+    /** \brief Maximum. */
+    float max;
+    /** \brief Compactors, values in level h have weight 2^h. */
+    std::vector< std::vector<float> > levels;
+    /** \brief Number of values currently in the sketch. */
+    int size;
+    /** \brief Number of compactions, used to alternate the kept values. */
+    int compactions;
+};
+
+#endif	/* ONLINE_STATISTICS_H */
@@ -30,13 +30,23 @@
  */
 
 #include <ctime>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <glog/logging.h>
 #include <sys/time.h>
 #include "io_util.h"
+#include "evaluation.h"
 #include "evaluation_summary.h"
+#include "fused_evaluation.h"
 #include "parameter_optimization_tool.h"
 
 #define TUPLE(tuple, i) std::get<i>(tuple)
@@ -64,6 +74,7 @@ ParameterOptimizationTool::ParameterOptimizationTool(boost::filesystem::path img
     evaluation_metrics.co = true; // Compactness 
     evaluation_metrics.ev = false; // Explained Variation
     evaluation_metrics.mde = false; // Mean Distance to Edge
+    evaluation_metrics.er = false; // Edge Recall
     evaluation_metrics.icv = false; // Intra-Cluster Variation
     evaluation_metrics.cd = false; // Contour Density
     evaluation_metrics.reg = false; // Regularity
@@ -78,6 +89,24 @@ ParameterOptimizationTool::ParameterOptimizationTool(boost::filesystem::path img
     
     superpixels_min = 0;
     superpixels_max = std::numeric_limits<int>::max();
+    
+    early_reject_images = 0;
+    early_reject_margin = 0.25f;
+    
+    rec_min = 0;
+    ue_np_max = 1;
+    
+    threads = 1;
+    
+    search_strategy = GRID_SEARCH;
+    search_budget = 0;
+    random_seed = 0;
+    
+    shard = 0;
+    shards = 1;
+    screening_scale = 1;
+    
+    result_cache = NULL;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -97,6 +126,18 @@ void ParameterOptimizationTool::addSuperpixelTolerance(int superpixels, int tole
     superpixels_max = superpixels + tolerance;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// setEarlyReject
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setEarlyReject(int images, float margin) {
+    LOG_IF(FATAL, images < 0) << "Invalid number of images for early rejection.";
+    LOG_IF(FATAL, margin < 0) << "Invalid margin for early rejection.";
+    
+    early_reject_images = images;
+    early_reject_margin = margin;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // addFloatParamteer
 ////////////////////////////////////////////////////////////////////////////////
@@ -130,83 +171,1386 @@ void ParameterOptimizationTool::addFloatParameter(std::string name, std::string
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// addIntegerParameter
+// addIntegerParameter
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool:: addIntegerParameter(std::string name, std::string parameter, 
+        std::vector<int> values) {
+    
+    LOG_IF(FATAL, values.size() == 0) << "Not enough values.";
+    
+    // @see http://stackoverflow.com/questions/5391973/undefined-reference-to-static-const-int
+    int type = INTEGER_PARAMETER;
+    std::tuple<std::string, std::string, int, int> parameter_tuple(name, parameter, 
+            type, integer_parameters.size());
+    
+    parameters.push_back(parameter_tuple);
+    
+//    std::tuple<std::vector<int>, int, int> integer_parameter = std::make_tuple<std::vector<int>, int, int>(values, 0, values[0]);
+    integer_parameters.push_back(std::make_tuple(values, 0, values[0], values[0]));
+    
+    std::cout << "Added integer parameter " << parameter << ": ";
+    for (unsigned int i = 0; i < values.size(); i++) {
+        std::cout << values[i];
+        
+        if (i < values.size() - 1) {
+            std::cout << ",";
+        }
+        else {
+            std::cout << std::endl;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// useDepth
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::useDepth(boost::filesystem::path depth_directory_) {
+    depth_directory = depth_directory_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// useIntrinsics
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::useIntrinsics(boost::filesystem::path intrinsics_directory_) {
+    intrinsics_directory = intrinsics_directory_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// optimize
+////////////////////////////////////////////////////////////////////////////////
+
+int ParameterOptimizationTool::numCombinations() {
+    
+    int combinations = 1;
+    for (unsigned int p = 0; p < parameters.size(); ++p) {
+        std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
+        
+        switch (std::get<2>(parameter_tuple)) {
+            case FLOAT_PARAMETER:
+            {
+                int float_parameter = std::get<3>(parameter_tuple);
+                combinations *= TUPLE(float_parameters[float_parameter], 0).size();
+                break;
+            }
+            case INTEGER_PARAMETER:
+            {
+                int integer_parameter = std::get<3>(parameter_tuple);
+                combinations *= TUPLE(integer_parameters[integer_parameter], 0).size();
+                break;
+            }
+            default:
+                LOG(FATAL) << "Invalid parameter type.";
+                break;
+        }
+    }
+    
+    return combinations;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setThreads
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setThreads(int threads_) {
+    LOG_IF(FATAL, threads_ <= 0) << "Number of threads needs to be positive.";
+    threads = threads_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setSegmentationFunction
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setSegmentationFunction(SegmentationFunction segmentation_function_) {
+    segmentation_function = segmentation_function_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setResultCache
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setResultCache(ResultCache* result_cache_) {
+    result_cache = result_cache_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// decodeCombination
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::decodeCombination(int k, std::vector<int> &indices) {
+    
+    // The last parameter changes fastest.
+    indices.resize(parameters.size());
+    for (int p = parameters.size() - 1; p >= 0; --p) {
+        
+        std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
+        int size = 0;
+        
+        switch (std::get<2>(parameter_tuple)) {
+            case FLOAT_PARAMETER:
+                size = TUPLE(float_parameters[std::get<3>(parameter_tuple)], 0).size();
+                break;
+            case INTEGER_PARAMETER:
+                size = TUPLE(integer_parameters[std::get<3>(parameter_tuple)], 0).size();
+                break;
+            default:
+                LOG(FATAL) << "[" << k << "] Invalid parameter type (parameter update).";
+                break;
+        }
+        
+        indices[p] = k%size;
+        k /= size;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getParameterValues
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::getParameterValues(const std::vector<int> &indices, 
+        std::vector<float> &values, float scale) {
+    
+    values.resize(parameters.size());
+    for (unsigned int p = 0; p < parameters.size(); ++p) {
+        
+        std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
+        switch (std::get<2>(parameter_tuple)) {
+            case FLOAT_PARAMETER:
+                values[p] = TUPLE(float_parameters[std::get<3>(parameter_tuple)], 0)[indices[p]];
+                break;
+            case INTEGER_PARAMETER:
+                values[p] = TUPLE(integer_parameters[std::get<3>(parameter_tuple)], 0)[indices[p]];
+                break;
+            default:
+                LOG(FATAL) << "Invalid parameter type.";
+                break;
+        }
+        
+        values[p] = scaleParameterValue(p, values[p], scale);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// scaleParameterValue
+////////////////////////////////////////////////////////////////////////////////
+
+float ParameterOptimizationTool::scaleParameterValue(int p, float value, float scale) {
+    
+    std::map<std::string, int>::const_iterator it = scaled_parameters.find(TUPLE(parameters[p], 0));
+    if (scale == 1 || it == scaled_parameters.end()) {
+        return value;
+    }
+    
+    value *= std::pow(scale, it->second);
+    if (TUPLE(parameters[p], 2) == INTEGER_PARAMETER) {
+        value = std::max(1.f, std::round(value));
+    }
+    
+    return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// buildCommandLine
+////////////////////////////////////////////////////////////////////////////////
+
+std::string ParameterOptimizationTool::buildCommandLine(const std::vector<int> &indices, 
+        const boost::filesystem::path &img_directory_k, const boost::filesystem::path &sp_directory,
+        float scale) {
+    
+    std::string command_line_k = command_line + " -i " + img_directory_k.string();
+
+    if (!depth_directory.empty()) {
+        command_line_k += " -d " + depth_directory.string();
+    }
+
+    // When using different intrinsics, we assume this to be SUNRGBD data
+    // - those images have not been cropped!
+    if (!intrinsics_directory.empty()) {
+        command_line_k += " --intrinsics " + intrinsics_directory.string();
+        command_line_k += " --cropping-x 0";
+        command_line_k += " --cropping-y 0";
+    }
+
+    command_line_k += " -o " + sp_directory.string();
+
+    for (unsigned p = 0; p < parameters.size(); ++p) {
+        std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
+
+        command_line_k += " " + std::get<1>(parameter_tuple);
+        switch (std::get<2>(parameter_tuple)) {
+            case FLOAT_PARAMETER:
+            {
+                int float_parameter = std::get<3>(parameter_tuple);
+                std::vector<float> float_parameter_values = TUPLE(float_parameters[float_parameter], 0);
+
+                std::stringstream float_parameter_ss;
+                float_parameter_ss << std::setprecision(6) 
+                        << scaleParameterValue(p, float_parameter_values[indices[p]], scale);
+
+                command_line_k += " " + float_parameter_ss.str();
+                break;
+            }
+            case INTEGER_PARAMETER:
+            {
+                int integer_parameter = std::get<3>(parameter_tuple);
+                std::vector<int> integer_parameter_values = TUPLE(integer_parameters[integer_parameter], 0);
+
+                std::stringstream integer_parameter_ss;
+                integer_parameter_ss << std::setprecision(6) 
+                        << (int) scaleParameterValue(p, integer_parameter_values[indices[p]], scale);
+
+                command_line_k += " " + integer_parameter_ss.str();
+                break;
+            }
+            default:
+                LOG(FATAL) << "Invalid parameter type.";
+                break;
+        }
+    }
+
+    if (!command_line_parameters.empty()) {
+        command_line_k += " " + command_line_parameters;
+    }
+    
+    return command_line_k;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// rejectEarly
+////////////////////////////////////////////////////////////////////////////////
+
+bool ParameterOptimizationTool::rejectEarly(int k, const std::vector<int> &indices, 
+        const boost::filesystem::path &img_directory_k, CombinationResult &result) {
+    
+    // Counts the superpixels as EvaluationSummary does, but without
+    // reading ground truths or computing any other metric.
+    std::vector<int> superpixels;
+    if (segmentation_function) {
+        std::vector<float> values;
+        getParameterValues(indices, values);
+        
+        int N = std::min(early_reject_images, (int) images.size());
+        for (int m = 0; m < N; ++m) {
+            cv::Mat labels;
+            segmentation_function(images[image_order[m]], values, labels);
+            superpixels.push_back(Evaluation::computeSuperpixels(labels));
+        }
+    }
+    else {
+        boost::filesystem::path sp_directory = base_directory / boost::filesystem::path(
+                "early_" + std::to_string(time(NULL)) + "_" + std::to_string(k));
+        runCommandLine(indices, img_directory_k, sp_directory);
+        
+        std::multimap<std::string, boost::filesystem::path> sp_files;
+        std::vector<std::string> label_extensions;
+        IOUtil::getLabelExtensions(label_extensions);
+        IOUtil::readDirectory(sp_directory, label_extensions, sp_files);
+        
+        for (std::multimap<std::string, boost::filesystem::path>::iterator it = sp_files.begin();
+                it != sp_files.end(); ++it) {
+            cv::Mat labels;
+            IOUtil::readMatCSVInt(it->second, labels);
+            superpixels.push_back(Evaluation::computeSuperpixels(labels));
+        }
+        
+        boost::filesystem::remove_all(sp_directory);
+    }
+    
+    if (superpixels.empty()) {
+        return false;
+    }
+    
+    float sp_average = std::accumulate(superpixels.begin(), superpixels.end(), 0.f)
+            /superpixels.size();
+    if (sp_average >= (1 - early_reject_margin)*superpixels_min
+            && sp_average <= (1 + early_reject_margin)*superpixels_max) {
+        return false;
+    }
+    
+    result.rec_average = 0;
+    result.ue_np_average = 1;
+    result.co_average = 0;
+    result.sp_average = sp_average;
+    result.runtime_average = -1;
+    result.sp_directory = "rejected_" + std::to_string(k);
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// runCommandLine
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::runCommandLine(const std::vector<int> &indices, 
+        const boost::filesystem::path &img_directory_k, const boost::filesystem::path &sp_directory,
+        float scale) {
+    
+    std::string command_line_k = buildCommandLine(indices, img_directory_k, sp_directory, scale);
+    
+//    LOG(INFO) << command_line_k;
+
+    // Run.
+    int status = system(command_line_k.c_str());
+
+    if (status != 0) {
+        LOG(FATAL) << "Command line was not successful: " << command_line_k;
+    }
+
+    // Post processing:
+    if (!post_processing_command_line.empty()) {
+        std::string post_processing_command_line_k = post_processing_command_line 
+                + " -i " + sp_directory.string() + " -m " + img_directory_k.string();
+
+        int status = system(post_processing_command_line_k.c_str());
+
+        if (status != 0) {
+            LOG(FATAL) << "Post processing command line was not successful: " << post_processing_command_line_k;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// evaluateCommandLine
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::evaluateCommandLine(int k, const std::vector<int> &indices, 
+        const boost::filesystem::path &img_directory_k, const boost::filesystem::path &gt_directory_k,
+        float scale, CombinationResult &result) {
+    
+    // The combination index keeps directories of concurrent runs apart.
+    boost::filesystem::path sp_directory = base_directory / 
+            boost::filesystem::path(std::to_string(time(NULL)) + "_" + std::to_string(k));
+    
+    // Look up all images in the cache; the tool is only run on the
+    // remaining images, copied to a separate directory if necessary.
+    std::vector<EvaluationSummary::ImageResult> cached_results;
+    std::map<std::string, std::string> keys;
+    boost::filesystem::path img_directory_run = img_directory_k;
+    
+    if (result_cache != NULL) {
+        // Image hashes refer to the full resolution images, so the scale
+        // needs to be part of the key.
+        std::string command_line_hash = ResultCache::hashString(ResultCache::hashCommandLine(
+                buildCommandLine(indices, boost::filesystem::path(), boost::filesystem::path(), scale)) 
+                + "\nparameter_optimization\n" + post_processing_command_line
+                + (scale != 1 ? "\nscale " + std::to_string(scale) : ""));
+        
+        std::multimap<std::string, boost::filesystem::path> img_files;
+        std::vector<std::string> extensions;
+        IOUtil::getImageExtensions(extensions);
+        IOUtil::readDirectory(img_directory_k, extensions, img_files);
+        
+        std::vector<boost::filesystem::path> missing_files;
+        for (std::multimap<std::string, boost::filesystem::path>::iterator it = img_files.begin();
+                it != img_files.end(); ++it) {
+            
+            std::map<std::string, std::string>::const_iterator hash 
+                    = image_hashes.find(it->second.filename().string());
+            std::string image_hash = (hash != image_hashes.end()) ? hash->second
+                    : ResultCache::hashImage(it->second, gt_directory_k);
+            
+            std::string key = result_cache->computeKey(command_line_hash, image_hash);
+            
+            EvaluationSummary::ImageResult image_result;
+            if (result_cache->read(key, image_result)) {
+                cached_results.push_back(image_result);
+            }
+            else {
+                keys[it->second.stem().string()] = key;
+                missing_files.push_back(it->second);
+            }
+        }
+        
+        if (!cached_results.empty() && !missing_files.empty()) {
+            img_directory_run = base_directory / boost::filesystem::path("missing_" 
+                    + std::to_string(time(NULL)) + "_" + std::to_string(k));
+            boost::filesystem::create_directories(img_directory_run);
+            
+            for (unsigned int m = 0; m < missing_files.size(); ++m) {
+                boost::filesystem::copy_file(missing_files[m], 
+                        img_directory_run / missing_files[m].filename());
+            }
+        }
+        
+        if (missing_files.empty()) {
+            boost::filesystem::create_directories(sp_directory);
+        }
+    }
+    
+    // Runtime is unknown if all images were served from the cache, otherwise
+    // it is averaged over the images actually segmented.
+    result.runtime_average = -1;
+    if (result_cache == NULL || !keys.empty()) {
+        runCommandLine(indices, img_directory_run, sp_directory, scale);
+        
+        // Lines are appended per run and start with the average wall time
+        // per image; some tools write further columns.
+        std::ifstream runtime_file((sp_directory / boost::filesystem::path("runtime.txt")).string());
+        std::string line;
+        while (std::getline(runtime_file, line)) {
+            std::istringstream stream(line);
+            float runtime;
+            if (stream >> runtime) {
+                result.runtime_average = runtime;
+            }
+        }
+    }
+    
+    // Evaluation:
+//    LOG(INFO) << "[" << k << "] Running evaluation.";
+    EvaluationSummary evaluation_summary(sp_directory, gt_directory_k, img_directory_k, 
+            evaluation_metrics, evaluation_statistics);
+    evaluation_summary.setEvaluationMemo(&evaluation_memo);
+
+    for (unsigned int m = 0; m < cached_results.size(); ++m) {
+        evaluation_summary.addImageResult(cached_results[m]);
+    }
+    
+    int gt_max = 0;
+    evaluation_summary.computeSummary(gt_max);
+    
+    if (result_cache != NULL) {
+        std::vector<EvaluationSummary::ImageResult> image_results;
+        evaluation_summary.getImageResults(image_results);
+        
+        for (unsigned int m = 0; m < image_results.size(); ++m) {
+            std::map<std::string, std::string>::const_iterator key = keys.find(
+                    boost::filesystem::path(image_results[m].name).stem().string());
+            
+            if (key != keys.end()) {
+                result_cache->write(key->second, image_results[m]);
+            }
+        }
+        
+        if (img_directory_run != img_directory_k) {
+            boost::filesystem::remove_all(img_directory_run);
+        }
+    }
+
+    cv::Mat results;
+    IOUtil::readMat(sp_directory / boost::filesystem::path("summary.csv.txt"), results);
+
+    // Compute average over all ground truths.
+    LOG_IF(FATAL, results.cols != (gt_max + 1) + 2) <<  "Invalid number of columns in evaluation results: " 
+            << results.cols << " != " << (gt_max + 1) + 2;
+    // Rec on first row, UE on second, superpixel number of third.
+    LOG_IF(FATAL, results.rows != 4) <<  "Invalid number of rows in evaluation results: " << results.rows << " != 4";
+
+    result.rec_average = 0;
+    result.ue_np_average = 0;
+    result.co_average = 0;
+    result.sp_average = 0;
+
+    for (int j = 0; j < gt_max + 1; ++j) {
+        result.rec_average += results.at<float>(0, j);
+        result.ue_np_average += results.at<float>(1, j);
+        result.co_average += results.at<float>(2, j);
+        result.sp_average += results.at<float>(3, j);
+    }
+
+    result.rec_average /= (gt_max + 1);
+    result.ue_np_average /= (gt_max + 1);
+    result.co_average /= (gt_max + 1);
+    result.sp_average /= (gt_max + 1);
+    
+    result.sp_directory = sp_directory.string();
+    
+    // Clean up superpixel directory!
+    this->cleanUp(sp_directory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// loadImageOrder
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::loadImageOrder() {
+    
+    if (!image_order.empty()) {
+        return;
+    }
+    
+    std::multimap<std::string, boost::filesystem::path> img_files;
+    std::vector<std::string> extensions;
+    IOUtil::getImageExtensions(extensions);
+    IOUtil::readDirectory(img_directory, extensions, img_files);
+    
+    image_order_files.clear();
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = img_files.begin();
+            it != img_files.end(); ++it) {
+        image_order_files.push_back(it->second);
+    }
+    
+    // Subsets are prefixes of a fixed random permutation such that they are
+    // nested and not biased by file names.
+    image_order.resize(image_order_files.size());
+    for (unsigned int n = 0; n < image_order.size(); ++n) {
+        image_order[n] = n;
+    }
+    
+    std::mt19937 generator(random_seed);
+    std::shuffle(image_order.begin(), image_order.end(), generator);
+    
+    // Images are hashed once; subsets contain copies of the same files.
+    if (result_cache != NULL) {
+        for (unsigned int n = 0; n < image_order_files.size(); ++n) {
+            image_hashes[image_order_files[n].filename().string()] 
+                    = ResultCache::hashImage(image_order_files[n], gt_directory);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// createImageSubset
+////////////////////////////////////////////////////////////////////////////////
+
+boost::filesystem::path ParameterOptimizationTool::createImageSubset(int subset, float scale,
+        boost::filesystem::path &gt_subset_directory) {
+    
+    std::string subset_name = "subset_" + std::to_string(subset);
+    if (scale != 1) {
+        subset_name += "_" + std::to_string((int) std::round(100*scale));
+    }
+    
+    boost::filesystem::path subset_directory = base_directory 
+            / boost::filesystem::path(subset_name);
+    
+    if (!boost::filesystem::is_directory(subset_directory)) {
+        boost::filesystem::create_directories(subset_directory);
+    }
+    
+    gt_subset_directory = gt_directory;
+    if (scale != 1) {
+        gt_subset_directory = base_directory / boost::filesystem::path(subset_name + "_gt");
+        if (!boost::filesystem::is_directory(gt_subset_directory)) {
+            boost::filesystem::create_directories(gt_subset_directory);
+        }
+    }
+    
+    std::vector<std::string> label_extensions;
+    IOUtil::getLabelExtensions(label_extensions);
+    
+    for (int m = 0; m < subset; ++m) {
+        boost::filesystem::path img_file = image_order_files[image_order[m]];
+        boost::filesystem::path subset_file = subset_directory / img_file.filename();
+        
+        if (boost::filesystem::exists(subset_file)) {
+            continue;
+        }
+        
+        if (scale == 1) {
+            boost::filesystem::copy_file(img_file, subset_file);
+            continue;
+        }
+        
+        cv::Mat image = cv::imread(img_file.string(), CV_LOAD_IMAGE_COLOR);
+        LOG_IF(FATAL, image.rows <= 0 || image.cols <= 0) << "Could not read image: " 
+                << img_file.string() << ".";
+        
+        cv::Mat scaled_image;
+        cv::resize(image, scaled_image, cv::Size(), scale, scale, cv::INTER_AREA);
+        
+        // Ground truths are looked up as by EvaluationSummary and written as
+        // binary label files, keeping the numbering.
+        for (int t = -1; t < 5; ++t) {
+            std::string stem = img_file.stem().string();
+            if (t >= 0) {
+                stem += "-" + std::to_string(t);
+            }
+            
+            for (unsigned int e = 0; e < label_extensions.size(); ++e) {
+                boost::filesystem::path gt_file = gt_directory / boost::filesystem::path(stem 
+                        + label_extensions[e]);
+                
+                if (boost::filesystem::is_regular_file(gt_file)) {
+                    cv::Mat gt_segmentation;
+                    IOUtil::readMatCSVInt(gt_file, image.rows, image.cols, gt_segmentation);
+                    
+                    cv::Mat scaled_gt_segmentation;
+                    cv::resize(gt_segmentation, scaled_gt_segmentation, scaled_image.size(), 
+                            0, 0, cv::INTER_NEAREST);
+                    
+                    IOUtil::writeLabels(gt_subset_directory / boost::filesystem::path(stem + ".lbl"),
+                            scaled_gt_segmentation);
+                    break;
+                }
+            }
+        }
+        
+        // Written last such that interrupted subsets are completed later.
+        cv::imwrite(subset_file.string(), scaled_image);
+    }
+    
+    return subset_directory;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// loadInProcessData
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::loadInProcessData() {
+    
+    if (!images.empty()) {
+        return;
+    }
+    
+    std::multimap<std::string, boost::filesystem::path> img_files;
+    std::vector<std::string> extensions;
+    IOUtil::getImageExtensions(extensions);
+    IOUtil::readDirectory(img_directory, extensions, img_files);
+    
+    std::vector<std::string> label_extensions;
+    IOUtil::getLabelExtensions(label_extensions);
+    
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = img_files.begin();
+            it != img_files.end(); ++it) {
+        
+        cv::Mat image = cv::imread(it->second.string(), CV_LOAD_IMAGE_COLOR);
+        LOG_IF(FATAL, image.rows <= 0 || image.cols <= 0) << "Could not read image: " 
+                << it->second.string() << ".";
+        
+        // Same lookup as EvaluationSummary: either a single ground truth
+        // or up to five numbered ground truths.
+        std::vector<cv::Mat> image_ground_truths;
+        std::vector<int> image_ground_truth_indices;
+        
+        for (int t = -1; t < 5; ++t) {
+            std::string stem = it->second.stem().string();
+            if (t >= 0) {
+                stem += "-" + std::to_string(t);
+            }
+            
+            for (unsigned int e = 0; e < label_extensions.size(); ++e) {
+                boost::filesystem::path gt_file = gt_directory / boost::filesystem::path(stem 
+                        + label_extensions[e]);
+                
+                if (boost::filesystem::is_regular_file(gt_file)) {
+                    cv::Mat gt_segmentation;
+                    IOUtil::readMatCSVInt(gt_file, image.rows, image.cols, gt_segmentation);
+                    
+                    image_ground_truths.push_back(gt_segmentation);
+                    image_ground_truth_indices.push_back(std::max(t, 0));
+                    break;
+                }
+            }
+            
+            if (t < 0 && !image_ground_truths.empty()) {
+                break;
+            }
+        }
+        
+        LOG_IF(ERROR, image_ground_truths.empty()) << "No ground truth found for " 
+                << it->second.string() << ".";
+        
+        images.push_back(image);
+        ground_truths.push_back(image_ground_truths);
+        ground_truth_indices.push_back(image_ground_truth_indices);
+        
+        if (screening_scale != 1) {
+            cv::Mat scaled_image;
+            cv::resize(image, scaled_image, cv::Size(), screening_scale, screening_scale, 
+                    cv::INTER_AREA);
+            
+            std::vector<cv::Mat> scaled_image_ground_truths(image_ground_truths.size());
+            for (unsigned int t = 0; t < image_ground_truths.size(); ++t) {
+                cv::resize(image_ground_truths[t], scaled_image_ground_truths[t], 
+                        scaled_image.size(), 0, 0, cv::INTER_NEAREST);
+            }
+            
+            scaled_images.push_back(scaled_image);
+            scaled_ground_truths.push_back(scaled_image_ground_truths);
+        }
+    }
+    
+    LOG_IF(FATAL, images.empty()) << "No images found in " << img_directory.string() << ".";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// evaluateInProcess
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::evaluateInProcess(int k, const std::vector<int> &indices, 
+        int subset, float scale, CombinationResult &result) {
+    
+    std::vector<float> values;
+    getParameterValues(indices, values, scale);
+    
+    LOG_IF(FATAL, scale != 1 && scale != screening_scale) << "Invalid scale for in-process evaluation.";
+    const std::vector<cv::Mat> &images_k = (scale != 1) ? scaled_images : images;
+    const std::vector< std::vector<cv::Mat> > &ground_truths_k = (scale != 1) 
+            ? scaled_ground_truths : ground_truths;
+    
+    // Means are computed per ground truth index and then averaged, as done
+    // by EvaluationSummary.
+    std::vector<float> rec(5, 0);
+    std::vector<float> ue_np(5, 0);
+    std::vector<float> co(5, 0);
+    std::vector<float> sp(5, 0);
+    std::vector<int> count(5, 0);
+    int gt_max = 0;
+    
+    // All images are evaluated in their natural order, subsets in the order
+    // given by image_order.
+    int N = images.size();
+    if (subset > 0 && subset < N) {
+        N = subset;
+    }
+    
+    float runtime = 0;
+    for (int m = 0; m < N; ++m) {
+        int n = (N < (int) images.size()) ? image_order[m] : m;
+        
+        // Wall time, as combinations may be evaluated in parallel.
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        
+        cv::Mat labels;
+        segmentation_function(images_k[n], values, labels);
+        
+        runtime += std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        
+        LOG_IF(FATAL, labels.rows != images_k[n].rows || labels.cols != images_k[n].cols) 
+                << "[" << k << "] Superpixel segmentation does not match image size.";
+        
+        FusedEvaluation fused(labels, images_k[n]);
+        if (!ground_truths_k[n].empty()) {
+            fused.setGroundTruths(ground_truths_k[n]);
+        }
+        
+        // Images and ground truths are identified by their index and scale.
+        std::string memo_key = "in_process:" + EvaluationMemo::hashMat(labels) 
+                + ":" + std::to_string(n) + ":" + (scale != 1 ? std::to_string(scale) + ":" : "");
+        
+        for (unsigned int t = 0; t < ground_truths_k[n].size(); ++t) {
+            cv::Mat row;
+            std::string csv;
+            
+            std::string key = memo_key + std::to_string(t);
+            if (!evaluation_memo.read(key, row, csv)) {
+                fused.selectGroundTruth(t);
+                
+                row.create(1, 4, CV_32FC1);
+                row.at<float>(0, 0) = fused.computeBoundaryRecall();
+                row.at<float>(0, 1) = fused.computeNPUndersegmentationError();
+                row.at<float>(0, 2) = fused.computeCompactness();
+                row.at<float>(0, 3) = fused.computeSuperpixels();
+                
+                evaluation_memo.write(key, row, csv);
+            }
+            
+            int gt = ground_truth_indices[n][t];
+            rec[gt] += row.at<float>(0, 0);
+            ue_np[gt] += row.at<float>(0, 1);
+            co[gt] += row.at<float>(0, 2);
+            sp[gt] += row.at<float>(0, 3);
+            ++count[gt];
+            
+            gt_max = std::max(gt_max, gt);
+        }
+    }
+    
+    result.rec_average = 0;
+    result.ue_np_average = 0;
+    result.co_average = 0;
+    result.sp_average = 0;
+    
+    for (int j = 0; j < gt_max + 1; ++j) {
+        if (count[j] > 0) {
+            result.rec_average += rec[j]/count[j];
+            result.ue_np_average += ue_np[j]/count[j];
+            result.co_average += co[j]/count[j];
+            result.sp_average += sp[j]/count[j];
+        }
+    }
+    
+    result.rec_average /= (gt_max + 1);
+    result.ue_np_average /= (gt_max + 1);
+    result.co_average /= (gt_max + 1);
+    result.sp_average /= (gt_max + 1);
+    result.runtime_average = runtime/std::max(N, 1);
+    
+    result.sp_directory = "in_process_" + std::to_string(k);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// evaluateCombinations
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::evaluateCombinations(const std::vector<int> &combinations, 
+        std::vector<CombinationResult> &results, int subset, float scale) {
+    
+    loadImageOrder();
+    
+    boost::filesystem::path img_directory_k = img_directory;
+    boost::filesystem::path gt_directory_k = gt_directory;
+    if (segmentation_function) {
+        loadInProcessData();
+    }
+    else if ((subset > 0 && subset < (int) image_order_files.size()) || scale != 1) {
+        int N = image_order_files.size();
+        img_directory_k = createImageSubset(subset > 0 ? std::min(subset, N) : N, 
+                scale, gt_directory_k);
+    }
+    
+    // Early rejection is only worthwhile before evaluating on all images.
+    int N = image_order_files.size();
+    bool early_reject = early_reject_images > 0 && early_reject_images < N
+            && (subset <= 0 || subset >= N) && scale == 1
+            && (superpixels_min > 0 || superpixels_max < std::numeric_limits<int>::max());
+    
+    boost::filesystem::path early_img_directory;
+    if (early_reject && !segmentation_function) {
+        boost::filesystem::path early_gt_directory;
+        early_img_directory = createImageSubset(early_reject_images, 1, early_gt_directory);
+    }
+    
+    int K = combinations.size();
+    results.resize(K);
+    
+    std::atomic<int> next(0);
+    std::atomic<int> done(0);
+    std::mutex progress_mutex;
+    
+    struct timeval start_tv;
+    gettimeofday(&start_tv, NULL);
+    
+    auto worker = [&]() {
+        for (int i = next++; i < K; i = next++) {
+            std::vector<int> indices;
+            decodeCombination(combinations[i], indices);
+            
+            if (early_reject && rejectEarly(combinations[i], indices, early_img_directory, results[i])) {
+                // Reported with the estimated number of superpixels only.
+            }
+            else if (segmentation_function) {
+                evaluateInProcess(combinations[i], indices, subset, scale, results[i]);
+            }
+            else {
+                evaluateCommandLine(combinations[i], indices, img_directory_k, gt_directory_k, 
+                        scale, results[i]);
+            }
+            
+            // For estimating remaining time:
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            int d = done++;
+            
+            struct timeval tv;
+            gettimeofday(&tv, NULL);
+            float elapsed = (tv.tv_sec - start_tv.tv_sec) +
+                    (tv.tv_usec - start_tv.tv_usec) / 1000000.0;
+            
+            if (d%10 == 0) {
+                if (d != 0) {
+                    std::cout << std::endl;
+                }
+
+                std::cout << "Time remaining: " << elapsed/(d + 1)*(K - d - 1) 
+                        << " (" << elapsed/(d + 1) << ") " << std::flush;
+            }
+
+            // Show progress ...
+            std::cout << "." << std::flush;
+        }
+    };
+    
+    int n_threads = std::max(1, std::min(threads, K));
+    if (n_threads <= 1) {
+        worker();
+    }
+    else {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < n_threads; ++t) {
+            workers.push_back(std::thread(worker));
+        }
+        
+        for (unsigned int t = 0; t < workers.size(); ++t) {
+            workers[t].join();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setSearchStrategy
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setSearchStrategy(int search_strategy_, int search_budget_, 
+        unsigned int random_seed_) {
+    
+    LOG_IF(FATAL, search_strategy_ < GRID_SEARCH || search_strategy_ > HYPERBAND) 
+            << "Invalid search strategy.";
+    LOG_IF(FATAL, search_budget_ < 0) << "Invalid search budget.";
+    
+    search_strategy = search_strategy_;
+    search_budget = search_budget_;
+    random_seed = random_seed_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setScreeningScale
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setScreeningScale(float screening_scale_) {
+    LOG_IF(FATAL, screening_scale_ <= 0 || screening_scale_ > 1) << "Invalid screening scale.";
+    screening_scale = screening_scale_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// scaleWithResolution
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::scaleWithResolution(std::string name, int exponent) {
+    LOG_IF(FATAL, exponent != 1 && exponent != 2) << "Invalid exponent for " << name << ".";
+    scaled_parameters[name] = exponent;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setShard
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setShard(int shard_, int shards_) {
+    LOG_IF(FATAL, shards_ <= 0 || shard_ < 0 || shard_ >= shards_) << "Invalid shard.";
+    
+    shard = shard_;
+    shards = shards_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setQualityThresholds
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setQualityThresholds(float rec_min_, float ue_np_max_) {
+    LOG_IF(FATAL, rec_min_ < 0 || rec_min_ > 1) << "Invalid minimum Boundary Recall.";
+    LOG_IF(FATAL, ue_np_max_ < 0 || ue_np_max_ > 1) << "Invalid maximum Undersegmentation Error.";
+    
+    rec_min = rec_min_;
+    ue_np_max = ue_np_max_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getParameterSize
+////////////////////////////////////////////////////////////////////////////////
+
+int ParameterOptimizationTool::getParameterSize(int p) {
+    
+    std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
+    switch (std::get<2>(parameter_tuple)) {
+        case FLOAT_PARAMETER:
+            return TUPLE(float_parameters[std::get<3>(parameter_tuple)], 0).size();
+        case INTEGER_PARAMETER:
+            return TUPLE(integer_parameters[std::get<3>(parameter_tuple)], 0).size();
+        default:
+            LOG(FATAL) << "Invalid parameter type.";
+            break;
+    }
+    
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// encodeCombination
+////////////////////////////////////////////////////////////////////////////////
+
+int ParameterOptimizationTool::encodeCombination(const std::vector<int> &indices) {
+    
+    int k = 0;
+    for (unsigned int p = 0; p < parameters.size(); ++p) {
+        k = k*getParameterSize(p) + indices[p];
+    }
+    
+    return k;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getSearchBudget
+////////////////////////////////////////////////////////////////////////////////
+
+int ParameterOptimizationTool::getSearchBudget() {
+    
+    int K = numCombinations();
+    if (search_budget > 0) {
+        return std::min(search_budget, K);
+    }
+    
+    // Default: a tenth of the grid, but at least 10 combinations.
+    return std::min(K, std::max(10, K/10));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeScore
+////////////////////////////////////////////////////////////////////////////////
+
+float ParameterOptimizationTool::computeScore(const CombinationResult &result, float weight) {
+    
+    // Combinations violating the superpixel tolerance are never preferred.
+    if (result.sp_average < superpixels_min || result.sp_average > superpixels_max) {
+        return -1;
+    }
+    
+    return (1 - weight)*result.rec_average + weight*(1 - result.ue_np_average);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// evaluateNewCombinations
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::evaluateNewCombinations(const std::vector<int> &candidates,
+        std::vector<int> &combinations, std::vector<CombinationResult> &results) {
+    
+    std::vector<int> new_combinations;
+    for (unsigned int i = 0; i < candidates.size(); ++i) {
+        if (std::find(combinations.begin(), combinations.end(), candidates[i]) == combinations.end()
+                && std::find(new_combinations.begin(), new_combinations.end(), candidates[i]) == new_combinations.end()) {
+            new_combinations.push_back(candidates[i]);
+        }
+    }
+    
+    std::vector<CombinationResult> new_results;
+    evaluateCombinations(new_combinations, new_results);
+    
+    combinations.insert(combinations.end(), new_combinations.begin(), new_combinations.end());
+    results.insert(results.end(), new_results.begin(), new_results.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// sampleCombinations
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::sampleCombinations(int n, std::vector<int> &combinations) {
+    
+    int K = numCombinations();
+    n = std::min(n, K);
+    
+    // Partial Fisher-Yates shuffle to sample without replacement.
+    std::vector<int> permutation(K);
+    for (int k = 0; k < K; ++k) {
+        permutation[k] = k;
+    }
+    
+    std::mt19937 generator(random_seed);
+    for (int i = 0; i < n; ++i) {
+        std::uniform_int_distribution<int> distribution(i, K - 1);
+        std::swap(permutation[i], permutation[distribution(generator)]);
+    }
+    
+    combinations.assign(permutation.begin(), permutation.begin() + n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// searchGrid
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::searchGrid(std::vector<int> &combinations, 
+        std::vector<CombinationResult> &results) {
+    
+    // Combinations are visited in the same order as the original sequential
+    // enumeration, which started with the second combination and wrapped around.
+    // A shard takes every shards-th combination such that interleaving the
+    // shards restores this order, see mergeShards.
+    int K = numCombinations();
+    combinations.clear();
+    for (int k = shard; k < K; k += shards) {
+        combinations.push_back((k + 1)%K);
+    }
+    
+    evaluateCombinations(combinations, results);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// searchRandom
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::searchRandom(std::vector<int> &combinations, 
+        std::vector<CombinationResult> &results) {
+    
+    sampleCombinations(getSearchBudget(), combinations);
+    evaluateCombinations(combinations, results);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// searchCoordinateDescent
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::searchCoordinateDescent(float weight, 
+        std::vector<int> &combinations, std::vector<CombinationResult> &results) {
+    
+    int budget = getSearchBudget();
+    
+    // Start in the middle of all value ranges.
+    std::vector<int> current(parameters.size());
+    for (unsigned int p = 0; p < parameters.size(); ++p) {
+        current[p] = getParameterSize(p)/2;
+    }
+    
+    evaluateNewCombinations(std::vector<int>{encodeCombination(current)}, 
+            combinations, results);
+    float current_score = computeScore(results[0], weight);
+    
+    bool improved = true;
+    while (improved && (int) combinations.size() < budget) {
+        improved = false;
+        
+        for (unsigned int p = 0; p < parameters.size() 
+                && (int) combinations.size() < budget; ++p) {
+            
+            // Evaluate all values of parameter p while keeping the others fixed.
+            std::vector<int> candidates;
+            std::vector<int> indices = current;
+            for (int v = 0; v < getParameterSize(p); ++v) {
+                indices[p] = v;
+                
+                int k = encodeCombination(indices);
+                if (std::find(combinations.begin(), combinations.end(), k) == combinations.end()
+                        && (int) (combinations.size() + candidates.size()) < budget) {
+                    candidates.push_back(k);
+                }
+            }
+            
+            evaluateNewCombinations(candidates, combinations, results);
+            
+            for (int v = 0; v < getParameterSize(p); ++v) {
+                indices[p] = v;
+                
+                int k = encodeCombination(indices);
+                std::vector<int>::iterator it = std::find(combinations.begin(), 
+                        combinations.end(), k);
+                
+                if (it != combinations.end()) {
+                    float score = computeScore(results[it - combinations.begin()], weight);
+                    if (score > current_score) {
+                        current_score = score;
+                        current[p] = v;
+                        improved = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// searchSuccessiveHalving
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::searchSuccessiveHalving(float weight, 
+        std::vector<int> &combinations, std::vector<CombinationResult> &results) {
+    
+    const int eta = 3;
+    
+    loadImageOrder();
+    int N = image_order_files.size();
+    LOG_IF(FATAL, N == 0) << "No images found in " << img_directory.string() << ".";
+    
+    // The initial candidates are sampled as for random search.
+    std::vector<int> candidates;
+    sampleCombinations(getSearchBudget(), candidates);
+    
+    // Number of rounds such that about eta candidates survive.
+    int rounds = 0;
+    for (int n = candidates.size(); n > eta; n = (n + eta - 1)/eta) {
+        ++rounds;
+    }
+    
+    int subset = N;
+    for (int r = 0; r < rounds; ++r) {
+        subset = std::max(1, subset/eta);
+    }
+    
+    halveCandidates(weight, subset, rounds, candidates);
+    
+    // Only evaluations on all images are reported.
+    evaluateNewCombinations(candidates, combinations, results);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// halveCandidates
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::halveCandidates(float weight, int subset, int rounds,
+        std::vector<int> &candidates) {
+    
+    const int eta = 3;
+    int N = image_order_files.size();
+    
+    for (int r = 0; r < rounds && subset < N; ++r) {
+        
+        // Screening rounds run on downscaled images, if requested.
+        std::vector<CombinationResult> subset_results;
+        evaluateCombinations(candidates, subset_results, subset, screening_scale);
+        
+        // Keep the best 1/eta of the candidates on the current subset.
+        std::vector<std::pair<float, int> > scores;
+        for (unsigned int i = 0; i < candidates.size(); ++i) {
+            scores.push_back(std::make_pair(-computeScore(subset_results[i], weight), i));
+        }
+        
+        std::stable_sort(scores.begin(), scores.end());
+        
+        int survivors = (candidates.size() + eta - 1)/eta;
+        std::vector<int> next_candidates;
+        for (int i = 0; i < survivors; ++i) {
+            next_candidates.push_back(candidates[scores[i].second]);
+        }
+        
+        candidates = next_candidates;
+        subset = std::min(N, subset*eta);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// searchHyperband
 ////////////////////////////////////////////////////////////////////////////////
 
-void ParameterOptimizationTool:: addIntegerParameter(std::string name, std::string parameter, 
-        std::vector<int> values) {
+void ParameterOptimizationTool::searchHyperband(float weight, std::vector<int> &combinations, 
+        std::vector<CombinationResult> &results) {
     
-    LOG_IF(FATAL, values.size() == 0) << "Not enough values.";
+    const int eta = 3;
     
-    // @see http://stackoverflow.com/questions/5391973/undefined-reference-to-static-const-int
-    int type = INTEGER_PARAMETER;
-    std::tuple<std::string, std::string, int, int> parameter_tuple(name, parameter, 
-            type, integer_parameters.size());
+    loadImageOrder();
+    int N = image_order_files.size();
+    LOG_IF(FATAL, N == 0) << "No images found in " << img_directory.string() << ".";
     
-    parameters.push_back(parameter_tuple);
+    // Bracket s starts on N/eta^s images; the most aggressive bracket starts
+    // on at least a single image.
+    int brackets = 1;
+    for (int n = N; n >= eta; n /= eta) {
+        ++brackets;
+    }
     
-//    std::tuple<std::vector<int>, int, int> integer_parameter = std::make_tuple<std::vector<int>, int, int>(values, 0, values[0]);
-    integer_parameters.push_back(std::make_tuple(values, 0, values[0], values[0]));
+    // As in Hyperband, brackets starting on fewer images get more candidates
+    // such that all brackets use about the same number of evaluations; the
+    // most aggressive bracket starts with the budget.
+    int budget = getSearchBudget();
+    std::vector<int> bracket_candidates(brackets);
+    int total = 0;
+    for (int s = 0; s < brackets; ++s) {
+        bracket_candidates[s] = std::max(1, (int) std::ceil(budget*brackets
+                *std::pow((float) eta, s - brackets + 1)/(s + 1)));
+        total += bracket_candidates[s];
+    }
     
-    std::cout << "Added integer parameter " << parameter << ": ";
-    for (unsigned int i = 0; i < values.size(); i++) {
-        std::cout << values[i];
-        
-        if (i < values.size() - 1) {
-            std::cout << ",";
+    // Candidates are sampled once so that brackets do not overlap.
+    std::vector<int> candidates;
+    sampleCombinations(total, candidates);
+    
+    std::vector<int>::iterator begin = candidates.begin();
+    for (int s = brackets - 1; s >= 0 && begin != candidates.end(); --s) {
+        std::vector<int>::iterator end = candidates.end();
+        if (end - begin > bracket_candidates[s]) {
+            end = begin + bracket_candidates[s];
         }
-        else {
-            std::cout << std::endl;
+        
+        std::vector<int> bracket(begin, end);
+        begin = end;
+        
+        int subset = N;
+        for (int r = 0; r < s; ++r) {
+            subset = std::max(1, subset/eta);
         }
+        
+        halveCandidates(weight, subset, s, bracket);
+        evaluateNewCombinations(bracket, combinations, results);
     }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// useDepth
-////////////////////////////////////////////////////////////////////////////////
-
-void ParameterOptimizationTool::useDepth(boost::filesystem::path depth_directory_) {
-    depth_directory = depth_directory_;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// useIntrinsics
-////////////////////////////////////////////////////////////////////////////////
-
-void ParameterOptimizationTool::useIntrinsics(boost::filesystem::path intrinsics_directory_) {
-    intrinsics_directory = intrinsics_directory_;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// optimize
+// searchTPE
 ////////////////////////////////////////////////////////////////////////////////
 
-int ParameterOptimizationTool::numCombinations() {
+void ParameterOptimizationTool::searchTPE(float weight, std::vector<int> &combinations, 
+        std::vector<CombinationResult> &results) {
     
-    int combinations = 1;
-    for (unsigned int p = 0; p < parameters.size(); ++p) {
-        std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
+    const float gamma = 0.25f;
+    const int samples = 64;
+    
+    int K = numCombinations();
+    int budget = getSearchBudget();
+    int P = parameters.size();
+    
+    std::mt19937 generator(random_seed);
+    
+    // Initial random proposals.
+    std::vector<int> candidates;
+    sampleCombinations(std::min(budget, std::max(P + 1, budget/4)), candidates);
+    
+    evaluateNewCombinations(candidates, combinations, results);
+    
+    int batch = std::max(1, threads);
+    while ((int) combinations.size() < budget) {
         
-        switch (std::get<2>(parameter_tuple)) {
-            case FLOAT_PARAMETER:
-            {
-                int float_parameter = std::get<3>(parameter_tuple);
-                combinations *= TUPLE(float_parameters[float_parameter], 0).size();
-                break;
+        // Split into good and bad combinations by score.
+        std::vector<std::pair<float, int> > scores;
+        for (unsigned int i = 0; i < combinations.size(); ++i) {
+            scores.push_back(std::make_pair(-computeScore(results[i], weight), i));
+        }
+        
+        std::stable_sort(scores.begin(), scores.end());
+        int good = std::max(1, (int) std::ceil(gamma*scores.size()));
+        
+        // Per-parameter categorical densities with add-one smoothing.
+        std::vector< std::vector<float> > l(P);
+        std::vector< std::vector<float> > g(P);
+        for (int p = 0; p < P; ++p) {
+            l[p].assign(getParameterSize(p), 1);
+            g[p].assign(getParameterSize(p), 1);
+        }
+        
+        for (unsigned int i = 0; i < scores.size(); ++i) {
+            std::vector<int> indices;
+            decodeCombination(combinations[scores[i].second], indices);
+            
+            for (int p = 0; p < P; ++p) {
+                if ((int) i < good) {
+                    l[p][indices[p]]++;
+                }
+                else {
+                    g[p][indices[p]]++;
+                }
             }
-            case INTEGER_PARAMETER:
-            {
-                int integer_parameter = std::get<3>(parameter_tuple);
-                combinations *= TUPLE(integer_parameters[integer_parameter], 0).size();
-                break;
+        }
+        
+        // Sample from the good density and rank by the ratio of densities.
+        std::vector<std::pair<float, int> > proposals;
+        for (int s = 0; s < samples; ++s) {
+            std::vector<int> indices(P);
+            float ratio = 1;
+            
+            for (int p = 0; p < P; ++p) {
+                std::discrete_distribution<int> distribution(l[p].begin(), l[p].end());
+                indices[p] = distribution(generator);
+                
+                float l_sum = std::accumulate(l[p].begin(), l[p].end(), 0.f);
+                float g_sum = std::accumulate(g[p].begin(), g[p].end(), 0.f);
+                ratio *= (l[p][indices[p]]/l_sum)/(g[p][indices[p]]/g_sum);
+            }
+            
+            int k = encodeCombination(indices);
+            if (std::find(combinations.begin(), combinations.end(), k) == combinations.end()) {
+                proposals.push_back(std::make_pair(-ratio, k));
+            }
+        }
+        
+        std::stable_sort(proposals.begin(), proposals.end());
+        
+        candidates.clear();
+        int remaining = std::min(batch, budget - (int) combinations.size());
+        for (unsigned int i = 0; i < proposals.size() && (int) candidates.size() < remaining; ++i) {
+            if (std::find(candidates.begin(), candidates.end(), proposals[i].second) == candidates.end()) {
+                candidates.push_back(proposals[i].second);
+            }
+        }
+        
+        // Fall back to a random unevaluated combination.
+        while (candidates.empty()) {
+            std::uniform_int_distribution<int> distribution(0, K - 1);
+            int k = distribution(generator);
+            
+            if (std::find(combinations.begin(), combinations.end(), k) == combinations.end()) {
+                candidates.push_back(k);
             }
-            default:
-                LOG(FATAL) << "Invalid parameter type.";
-                break;
         }
+        
+        evaluateNewCombinations(candidates, combinations, results);
     }
-    
-    return combinations;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -216,6 +1560,8 @@ int ParameterOptimizationTool::numCombinations() {
 void ParameterOptimizationTool::optimize(float weight, float weight_ue, float weight_co) {
     LOG_IF(FATAL, weight >= 1.0f) << "Invalid UE weight.";
     LOG_IF(FATAL, weight_ue + weight_co >= 1.0f) << "Invalid UE and CO weights.";
+    LOG_IF(FATAL, shards > 1 && search_strategy != GRID_SEARCH) 
+            << "Sharding is only supported for grid search.";
     
     int K = numCombinations();
 //    std::cout << "Initializing parameters: " << K << "." << std::endl;
@@ -229,175 +1575,69 @@ void ParameterOptimizationTool::optimize(float weight, float weight_ue, float we
     }
     output << "rec_average" << "," << "ue_np_average" << "," 
             << "co_average" << "," << "score" << ","
-            << "co_score" << "," << "sp_average" << "\n";
+            << "co_score" << "," << "sp_average" << "," << "runtime_average" << "\n";
+    std::string header = output.str();
+    header.erase(header.size() - 1);
     
     // To store results and parameters only (all are convertible to float).
-    int cols = parameters.size() + 6;
+    int cols = parameters.size() + 7;
+    std::vector<std::string> rows;
     cv::Mat mat_output(0, cols, CV_32FC1, cv::Scalar(0));
     
     float score_max = 0;
     float co_score_max = 0;
-    float average_time = 0;
     
-    for (int k = 0; k < K; ++k) {
+    std::vector<int> combinations;
+    std::vector<CombinationResult> combination_results;
+    
+    switch (search_strategy) {
+        case RANDOM_SEARCH:
+            searchRandom(combinations, combination_results);
+            break;
+        case COORDINATE_DESCENT:
+            searchCoordinateDescent(weight, combinations, combination_results);
+            break;
+        case SUCCESSIVE_HALVING:
+            searchSuccessiveHalving(weight, combinations, combination_results);
+            break;
+        case TPE_SEARCH:
+            searchTPE(weight, combinations, combination_results);
+            break;
+        case HYPERBAND:
+            searchHyperband(weight, combinations, combination_results);
+            break;
+        default:
+            searchGrid(combinations, combination_results);
+            break;
+    }
+    
+    for (unsigned int k = 0; k < combinations.size(); ++k) {
         
-        // For estimating remaining time:
-        struct timeval tv;
-        struct timeval start_tv;
-
-        gettimeofday(&start_tv, NULL);
+        std::vector<int> indices;
+        decodeCombination(combinations[k], indices);
         
-        bool done = false;
-        for (int p = parameters.size() - 1; p >= 0; --p) {
-            if (done) {
-                break;
-            }
-            
+        // Set current parameter indices.
+        for (unsigned int p = 0; p < parameters.size(); ++p) {
             std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
             switch (std::get<2>(parameter_tuple)) {
                 case FLOAT_PARAMETER:
-                {
-                    int float_parameter = std::get<3>(parameter_tuple);
-                    TUPLE(float_parameters[float_parameter], 1)++;
-                    
-                    if (TUPLE(float_parameters[float_parameter], 1) >= TUPLE(float_parameters[float_parameter], 0).size()) {
-                        TUPLE(float_parameters[float_parameter], 1) = 0;
-                    }
-                    else {
-                        done = true;
-                    }
-                    
+                    TUPLE(float_parameters[std::get<3>(parameter_tuple)], 1) = indices[p];
                     break;
-                }
                 case INTEGER_PARAMETER:
-                {
-                    int integer_parameter = std::get<3>(parameter_tuple);
-                    TUPLE(integer_parameters[integer_parameter], 1)++;
-                    
-                    if (TUPLE(integer_parameters[integer_parameter], 1) >= TUPLE(integer_parameters[integer_parameter], 0).size()) {
-                        TUPLE(integer_parameters[integer_parameter], 1) = 0;
-                    }
-                    else {
-                        done = true;
-                    }
-                    
+                    TUPLE(integer_parameters[std::get<3>(parameter_tuple)], 1) = indices[p];
                     break;
-                }
                 default:
                     LOG(FATAL) << "[" << k << "] Invalid parameter type (parameter update).";
                     break;
             }
         }
         
-        // Build command line.
-        boost::filesystem::path sp_directory = base_directory / 
-                boost::filesystem::path(std::to_string(time(NULL)));
-        std::string command_line_k = command_line + " -i " + img_directory.string();
-        
-        if (!depth_directory.empty()) {
-            command_line_k += " -d " + depth_directory.string();
-        }
-        
-        // When using different intrinsics, we assume this to be SUNRGBD data
-        // - those images have not been cropped!
-        if (!intrinsics_directory.empty()) {
-            command_line_k += " --intrinsics " + intrinsics_directory.string();
-            command_line_k += " --cropping-x 0";
-            command_line_k += " --cropping-y 0";
-        }
-        
-        command_line_k += " -o " + sp_directory.string();
-        
-        for (unsigned p = 0; p < parameters.size(); ++p) {
-            std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
-            
-            command_line_k += " " + std::get<1>(parameter_tuple);
-            switch (std::get<2>(parameter_tuple)) {
-                case FLOAT_PARAMETER:
-                {
-                    int float_parameter = std::get<3>(parameter_tuple);
-                    std::vector<float> float_parameter_values = TUPLE(float_parameters[float_parameter], 0);
-                    
-                    std::stringstream float_parameter_ss;
-                    float_parameter_ss << std::setprecision(6) << float_parameter_values[TUPLE(float_parameters[float_parameter], 1)];
-                    
-                    command_line_k += " " + float_parameter_ss.str();
-                    break;
-                }
-                case INTEGER_PARAMETER:
-                {
-                    int integer_parameter = std::get<3>(parameter_tuple);
-                    std::vector<int> integer_parameter_values = TUPLE(integer_parameters[integer_parameter], 0);
-                    
-                    std::stringstream integer_parameter_ss;
-                    integer_parameter_ss << std::setprecision(6) << integer_parameter_values[TUPLE(integer_parameters[integer_parameter], 1)];
-                    
-                    command_line_k += " " + integer_parameter_ss.str();
-                    break;
-                }
-                default:
-                    LOG(FATAL) << "Invalid parameter type.";
-                    break;
-            }
-        }
-        
-        if (!command_line_parameters.empty()) {
-            command_line_k += " " + command_line_parameters;
-        }
-        
-//        LOG(INFO) << "[" << k << "] " << command_line_k;
-        
-        // Run.
-        int status = system(command_line_k.c_str());
-        
-        if (status != 0) {
-            LOG(FATAL) << "Command line was not successful: " << command_line_k;
-        }
-        
-        // Post processing:
-        if (!post_processing_command_line.empty()) {
-            std::string post_processing_command_line_k = post_processing_command_line 
-                    + " -i " + sp_directory.string() + " -m " + img_directory.string();
-
-            int status = system(post_processing_command_line_k.c_str());
-            
-            if (status != 0) {
-                LOG(FATAL) << "Post processing command line was not successful: " << post_processing_command_line_k;
-            }
-        }
-        // Evaluation:
-//        LOG(INFO) << "[" << k << "] Running evaluation.";
-        EvaluationSummary evaluation_summary(sp_directory, gt_directory, img_directory, 
-                evaluation_metrics, evaluation_statistics);
-        
-        int gt_max = 0;
-        evaluation_summary.computeSummary(gt_max);
-        
-        cv::Mat results;
-        IOUtil::readMat(sp_directory / boost::filesystem::path("summary.csv.txt"), results);
-        
-        // Compute average over all ground truths.
-        LOG_IF(FATAL, results.cols != (gt_max + 1) + 2) <<  "Invalid number of columns in evaluation results: " 
-                << results.cols << " != " << (gt_max + 1) + 2;
-        // Rec on first row, UE on second, superpixel number of third.
-        LOG_IF(FATAL, results.rows != 4) <<  "Invalid number of rows in evaluation results: " << results.rows << " != 4";
-        
-        float rec_average = 0;
-        float ue_np_average = 0;
-        float co_average = 0;
-        float sp_average = 0;
-        
-        for (int j = 0; j < gt_max + 1; ++j) {
-            rec_average += results.at<float>(0, j);
-            ue_np_average += results.at<float>(1, j);
-            co_average += results.at<float>(2, j);
-            sp_average += results.at<float>(3, j);
-        }
-        
-        rec_average /= (gt_max + 1);
-        ue_np_average /= (gt_max + 1);
-        co_average /= (gt_max + 1);
-        sp_average /= (gt_max + 1);
+        std::string sp_directory = combination_results[k].sp_directory;
+        float rec_average = combination_results[k].rec_average;
+        float ue_np_average = combination_results[k].ue_np_average;
+        float co_average = combination_results[k].co_average;
+        float sp_average = combination_results[k].sp_average;
+        float runtime_average = combination_results[k].runtime_average;
         
         float score = 0;
         float co_score = 0;
@@ -477,7 +1717,8 @@ void ParameterOptimizationTool::optimize(float weight, float weight_ue, float we
         }
         
 //        LOG(INFO) << "[" << k << "] Updating CSV output.";
-        output << sp_directory.string() << ",";
+        std::stringstream row;
+        row << sp_directory << ",";
         cv::Mat mat_row(1, cols, CV_32FC1, cv::Scalar(0));
         
         for (unsigned p = 0; p < parameters.size(); ++p) {
@@ -489,7 +1730,7 @@ void ParameterOptimizationTool::optimize(float weight, float weight_ue, float we
                     int float_parameter = std::get<3>(parameter_tuple);
                     std::vector<float> float_parameter_values = TUPLE(float_parameters[float_parameter], 0);
                         
-                    output << float_parameter_values[TUPLE(float_parameters[float_parameter], 1)] << ",";
+                    row << float_parameter_values[TUPLE(float_parameters[float_parameter], 1)] << ",";
                     mat_row.at<float>(0, p) = float_parameter_values[TUPLE(float_parameters[float_parameter], 1)];
                     break;
                 }
@@ -498,7 +1739,7 @@ void ParameterOptimizationTool::optimize(float weight, float weight_ue, float we
                     int integer_parameter = std::get<3>(parameter_tuple);
                         std::vector<int> integer_parameter_values = TUPLE(integer_parameters[integer_parameter], 0);
                     
-                    output << integer_parameter_values[TUPLE(integer_parameters[integer_parameter], 1)] << ",";
+                    row << integer_parameter_values[TUPLE(integer_parameters[integer_parameter], 1)] << ",";
                     mat_row.at<float>(0, p) = integer_parameter_values[TUPLE(integer_parameters[integer_parameter], 1)];
                     break;
                 }
@@ -508,8 +1749,10 @@ void ParameterOptimizationTool::optimize(float weight, float weight_ue, float we
             }
         }
         
-        output << rec_average << "," << ue_np_average << "," << co_average << "," 
-                << score << "," << co_score << "," << sp_average << "\n";
+        row << rec_average << "," << ue_np_average << "," << co_average << "," 
+                << score << "," << co_score << "," << sp_average << "," << runtime_average;
+        output << row.str() << "\n";
+        rows.push_back(row.str());
         
         mat_row.at<float>(0, parameters.size()) = rec_average;
         mat_row.at<float>(0, parameters.size() + 1) = ue_np_average;
@@ -517,26 +1760,8 @@ void ParameterOptimizationTool::optimize(float weight, float weight_ue, float we
         mat_row.at<float>(0, parameters.size() + 3) = score;
         mat_row.at<float>(0, parameters.size() + 4) = co_score;
         mat_row.at<float>(0, parameters.size() + 5) = sp_average;
+        mat_row.at<float>(0, parameters.size() + 6) = runtime_average;
         mat_output.push_back(mat_row);
-        
-        // Clean up superpixel directory!
-        this->cleanUp(sp_directory);
-        
-        gettimeofday(&tv, NULL);
-        average_time += (tv.tv_sec - start_tv.tv_sec) +
-          (tv.tv_usec - start_tv.tv_usec) / 1000000.0;
-        
-        if (k%10 == 0) {
-            if (k != 0) {
-                std::cout << std::endl;
-            }
-            
-            std::cout << "Time remaining: " << average_time/(k + 1)*(K - k - 1) 
-                    << " (" << average_time/(k + 1) << ") " << std::flush;
-        }
-        
-        // Show progress ...
-        std::cout << "." << std::flush;
     }
     
     // Write best parameters.
@@ -586,20 +1811,228 @@ void ParameterOptimizationTool::optimize(float weight, float weight_ue, float we
         }
     }
     
+    // Parameter values are taken from the results, as for mergeShards.
+    int fastest = selectFastest(mat_output, rec_min, ue_np_max);
+    if (fastest >= 0) {
+        output << "\n" << "fast_best";
+        for (unsigned p = 0; p < parameters.size(); ++p) {
+            output << "," << mat_output.at<float>(fastest, p);
+        }
+    }
+    else {
+        std::cout << std::endl << "No combination meets the quality thresholds." << std::flush;
+    }
+    
 //    LOG(INFO) << "Writing output to CSV.";
+    std::string parameter_optimization_name = "parameter_optimization";
+    if (shards > 1) {
+        parameter_optimization_name += "-" + std::to_string(shard);
+    }
+    
+    writeParetoFront(header, rows, mat_output, base_directory 
+            / boost::filesystem::path(parameter_optimization_name + "_pareto.csv"));
+    
     boost::filesystem::path parameter_optimization_file = base_directory 
-            / boost::filesystem::path("parameter_optimization.csv");
+            / boost::filesystem::path(parameter_optimization_name + ".csv");
     std::ofstream csv_file(parameter_optimization_file.string());
     csv_file << output.str();
     csv_file.close();
     
     boost::filesystem::path parameter_optimization_mat = base_directory
-            / boost::filesystem::path("parameter_optimization.csv.txt");
+            / boost::filesystem::path(parameter_optimization_name + ".csv.txt");
     IOUtil::writeMat(parameter_optimization_mat, mat_output);
     
     std::cout << std::endl;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// mergeShards
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::mergeShards(const std::vector<boost::filesystem::path> &shard_files,
+        const boost::filesystem::path &output_file, float rec_min, float ue_np_max) {
+    
+    LOG_IF(FATAL, shard_files.empty()) << "No shards to merge.";
+    
+    // Rows of each shard as text and as written to the .csv.txt file.
+    // Without any combination meeting the superpixel tolerance, all shards
+    // report the same default parameters as best.
+    std::string header;
+    std::string best;
+    std::string co_best;
+    std::vector< std::vector<std::string> > rows(shard_files.size());
+    std::vector<cv::Mat> mats(shard_files.size());
+    
+    for (unsigned int i = 0; i < shard_files.size(); ++i) {
+        std::ifstream csv_file(shard_files[i].string());
+        LOG_IF(FATAL, !csv_file.is_open()) << "Could not open " << shard_files[i].string() << ".";
+        
+        std::string line;
+        std::getline(csv_file, line);
+        LOG_IF(FATAL, !header.empty() && line != header) << "Shard " 
+                << shard_files[i].string() << " has different parameters.";
+        header = line;
+        
+        while (std::getline(csv_file, line)) {
+            if (line.compare(0, 4, "best") == 0) {
+                best = line;
+                continue;
+            }
+            if (line.compare(0, 7, "co_best") == 0) {
+                co_best = line;
+                continue;
+            }
+            if (line.compare(0, 9, "fast_best") == 0) {
+                continue;
+            }
+            
+            rows[i].push_back(line);
+        }
+        
+        IOUtil::readMat(boost::filesystem::path(shard_files[i].string() + ".txt"), mats[i]);
+        LOG_IF(FATAL, mats[i].rows != (int) rows[i].size()) << "Shard " 
+                << shard_files[i].string() << " is incomplete.";
+    }
+    
+    // Shard i holds the combinations i, i + N, i + 2N, ... of the grid.
+    std::stringstream output;
+    output << header << "\n";
+    cv::Mat mat_output;
+    
+    int cols = mats[0].cols;
+    int parameters = cols - 7;
+    std::vector<std::string> merged_rows;
+    float score_max = 0;
+    float co_score_max = 0;
+    
+    bool remaining = true;
+    for (unsigned int r = 0; remaining; ++r) {
+        remaining = false;
+        for (unsigned int i = 0; i < rows.size(); ++i) {
+            if (r >= rows[i].size()) {
+                continue;
+            }
+            
+            remaining = true;
+            output << rows[i][r] << "\n";
+            merged_rows.push_back(rows[i][r]);
+            mat_output.push_back(mats[i].row(r));
+            
+            // Parameter values are copied as written, skipping sp_directory.
+            std::stringstream values;
+            std::stringstream row(rows[i][r]);
+            std::string value;
+            std::getline(row, value, ',');
+            for (int p = 0; p < parameters && std::getline(row, value, ','); ++p) {
+                values << "," << value;
+            }
+            
+            float score = mats[i].at<float>(r, parameters + 3);
+            float co_score = mats[i].at<float>(r, parameters + 4);
+            if (score > score_max) {
+                score_max = score;
+                best = "best" + values.str();
+            }
+            
+            if (co_score > co_score_max) {
+                co_score_max = co_score;
+                co_best = "co_best" + values.str();
+            }
+        }
+    }
+    
+    output << best << "\n" << co_best;
+    
+    int fastest = selectFastest(mat_output, rec_min, ue_np_max);
+    if (fastest >= 0) {
+        output << "\n" << "fast_best";
+        for (int p = 0; p < parameters; ++p) {
+            output << "," << mat_output.at<float>(fastest, p);
+        }
+    }
+    
+    std::ofstream csv_file(output_file.string());
+    csv_file << output.str();
+    csv_file.close();
+    
+    IOUtil::writeMat(boost::filesystem::path(output_file.string() + ".txt"), mat_output);
+    
+    writeParetoFront(header, merged_rows, mat_output, output_file.parent_path() 
+            / boost::filesystem::path(output_file.stem().string() + "_pareto.csv"));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// selectFastest
+////////////////////////////////////////////////////////////////////////////////
+
+int ParameterOptimizationTool::selectFastest(const cv::Mat &results, float rec_min, 
+        float ue_np_max) {
+    
+    // Results are followed by rec, ue_np, co, score, co_score, sp and runtime;
+    // the score is zero if the superpixel tolerance is not met.
+    int parameters = results.cols - 7;
+    
+    int fastest = -1;
+    for (int r = 0; r < results.rows; ++r) {
+        float runtime = results.at<float>(r, parameters + 6);
+        if (results.at<float>(r, parameters + 3) <= 0 || runtime < 0
+                || results.at<float>(r, parameters) < rec_min
+                || results.at<float>(r, parameters + 1) > ue_np_max) {
+            continue;
+        }
+        
+        if (fastest < 0 || runtime < results.at<float>(fastest, parameters + 6)) {
+            fastest = r;
+        }
+    }
+    
+    return fastest;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeParetoFront
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::writeParetoFront(const std::string &header, 
+        const std::vector<std::string> &rows, const cv::Mat &results, 
+        const boost::filesystem::path &pareto_file) {
+    
+    int parameters = results.cols - 7;
+    
+    std::vector<int> candidates;
+    for (int r = 0; r < results.rows; ++r) {
+        if (results.at<float>(r, parameters + 3) > 0 && results.at<float>(r, parameters + 6) >= 0) {
+            candidates.push_back(r);
+        }
+    }
+    
+    // Sorted by runtime and, for equal runtime, by descending score, a
+    // combination is on the front if it improves on the best score so far.
+    std::sort(candidates.begin(), candidates.end(), [&results, parameters](int a, int b) {
+        float runtime_a = results.at<float>(a, parameters + 6);
+        float runtime_b = results.at<float>(b, parameters + 6);
+        if (runtime_a != runtime_b) {
+            return runtime_a < runtime_b;
+        }
+        
+        return results.at<float>(a, parameters + 3) > results.at<float>(b, parameters + 3);
+    });
+    
+    std::ofstream csv_file(pareto_file.string());
+    csv_file << header;
+    
+    float score_max = 0;
+    for (unsigned int i = 0; i < candidates.size(); ++i) {
+        float score = results.at<float>(candidates[i], parameters + 3);
+        if (score > score_max) {
+            score_max = score;
+            csv_file << "\n" << rows[candidates[i]];
+        }
+    }
+    
+    csv_file.close();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // cleanUp
 ////////////////////////////////////////////////////////////////////////////////
@@ -32,8 +32,12 @@
 #ifndef PARAMETER_OPTIMIZATION_TOOL_H
 #define	PARAMETER_OPTIMIZATION_TOOL_H
 
+#include <map>
 #include <tuple>
+#include <functional>
 #include "evaluation_summary.h"
+#include "result_cache.h"
+#include "evaluation_memo.h"
 
 /** \brief Tool to guide parameter optimization using grid search.
  * \author David Stutz
@@ -46,6 +50,26 @@ public:
     /** \brief Constant to indicate an integer parameter. */
     static const int INTEGER_PARAMETER = 2;
     
+    /** \brief Evaluate the full grid of parameter combinations (default). */
+    static const int GRID_SEARCH = 0;
+    /** \brief Evaluate randomly sampled parameter combinations. */
+    static const int RANDOM_SEARCH = 1;
+    /** \brief Optimize one parameter at a time, starting from the middle of all ranges. */
+    static const int COORDINATE_DESCENT = 2;
+    /** \brief Successively halve randomly sampled combinations on growing image subsets. */
+    static const int SUCCESSIVE_HALVING = 3;
+    /** \brief Propose combinations using a Tree-structured Parzen Estimator over the value indices. */
+    static const int TPE_SEARCH = 4;
+    /** \brief Run successive halving brackets starting on different image subsets (Hyperband). */
+    static const int HYPERBAND = 5;
+    
+    /** \brief Function computing a superpixel segmentation in-process given
+     * the image and the parameter values in the order the parameters were added
+     * (integer parameters are converted to float).
+     */
+    typedef std::function<void(const cv::Mat &image, const std::vector<float> &values, 
+            cv::Mat &labels)> SegmentationFunction;
+    
     /** \brief Constructor.
      * 
      * The command line tool to use has to provide several options, including -i to
@@ -75,6 +99,20 @@ public:
      */
     void addSuperpixelTolerance(int superpixels, int tolerance);
     
+    /** \brief Reject combinations clearly missing the superpixel tolerance early.
+     * 
+     * Before a combination is evaluated on all images, it is run on the given
+     * number of images of the random image order, see loadImageOrder, and only
+     * the number of superpixels is computed. If the average lies outside the
+     * superpixel tolerance widened by the relative margin, the combination is
+     * reported with this estimate and never considered best. Only used if a
+     * superpixel tolerance was added.
+     * 
+     * \param[in] images number of images to check, 0 to disable
+     * \param[in] margin relative margin added to the tolerance
+     */
+    void setEarlyReject(int images, float margin = 0.25f);
+    
     /** \brief Add float parameter to optimize.
      * \param[in] name name of the parameter
      * \param[in] parameter parameter for the command line
@@ -107,6 +145,114 @@ public:
      */
     void setVerbose(std::ostream &stream = std::cout);
     
+    /** \brief Set the number of parameter combinations evaluated in parallel.
+     * \param[in] threads number of threads, 1 for sequential evaluation
+     */
+    void setThreads(int threads);
+    
+    /** \brief Evaluate parameter combinations in-process instead of running
+     * the command line tool.
+     * 
+     * Images and ground truth segmentations are loaded once and kept in memory;
+     * no superpixel segmentations are written to disk. Depth, intrinsics and
+     * post-processing are not supported in this mode. If more than one thread
+     * is used, the function needs to be thread-safe.
+     * 
+     * \param[in] segmentation_function function computing the superpixel segmentation
+     */
+    void setSegmentationFunction(SegmentationFunction segmentation_function);
+    
+    /** \brief Use a persistent cache of per-image results.
+     * 
+     * Before running the command line tool, the results of each image are
+     * looked up in the cache; the tool is only run on images without cached
+     * results, and their results are added to the cache afterwards. Not used
+     * for in-process evaluation.
+     * 
+     * \param[in] result_cache cache to use, needs to outlive the tool
+     */
+    void setResultCache(ResultCache* result_cache);
+    
+    /** \brief Set the search strategy used by optimize.
+     * 
+     * All strategies optimize the primary score of optimize, i.e. the weighted
+     * Boundary Recall and Undersegmentation Error, and only consider combinations
+     * meeting the superpixel tolerance. The budget is the number of combinations
+     * evaluated on all images; for SUCCESSIVE_HALVING it is the number of
+     * initial candidates, of which about a third is evaluated on three times as
+     * many images each round. Only evaluations on all images are reported.
+     * 
+     * HYPERBAND runs brackets ranging from SUCCESSIVE_HALVING starting on the
+     * fewest images to RANDOM_SEARCH on all images; the budget is the number of
+     * initial candidates of the former, the latter get fewer candidates.
+     * 
+     * \param[in] search_strategy one of GRID_SEARCH, RANDOM_SEARCH, COORDINATE_DESCENT, SUCCESSIVE_HALVING, TPE_SEARCH, HYPERBAND
+     * \param[in] search_budget number of evaluations, 0 for a tenth of all combinations but at least 10
+     * \param[in] random_seed seed for random sampling and image subsets
+     */
+    void setSearchStrategy(int search_strategy, int search_budget = 0, 
+            unsigned int random_seed = 0);
+    
+    /** \brief Screen combinations on downscaled images.
+     * 
+     * For SUCCESSIVE_HALVING and HYPERBAND, all rounds on image subsets are
+     * evaluated on images and ground truths downscaled by the given factor;
+     * the surviving combinations are evaluated on all images at full resolution.
+     * Parameters given in pixels need to be marked using scaleWithResolution.
+     * 
+     * \param[in] screening_scale factor in (0, 1], 1 to screen at full resolution
+     */
+    void setScreeningScale(float screening_scale);
+    
+    /** \brief Mark a parameter as depending on the image resolution, e.g. a
+     * region size or a minimum superpixel size, such that it is scaled when
+     * screening on downscaled images, see setScreeningScale.
+     * \param[in] name name of the parameter
+     * \param[in] exponent 1 for lengths, 2 for areas
+     */
+    void scaleWithResolution(std::string name, int exponent = 1);
+    
+    /** \brief Only evaluate one shard of the grid, e.g. to distribute grid
+     * search across machines.
+     * 
+     * The shard consists of every shards-th combination of the grid, starting
+     * with the shard-th one; results are written to parameter_optimization-<shard>.csv
+     * and can be merged using mergeShards. Only supported for GRID_SEARCH.
+     * 
+     * \param[in] shard index of the shard, between 0 and shards - 1
+     * \param[in] shards number of shards
+     */
+    void setShard(int shard, int shards);
+    
+    /** \brief Set the minimum quality required for the fastest combination.
+     * 
+     * Besides the best combinations, optimize reports the fastest combination
+     * meeting the superpixel tolerance, the minimum Boundary Recall and the
+     * maximum Undersegmentation Error as fast_best, and writes the combinations
+     * on the Pareto front of score and runtime to parameter_optimization_pareto.csv.
+     * Runtime is the average runtime per image as written to runtime.txt by
+     * the command line tool, or as measured for in-process evaluation.
+     * 
+     * \param[in] rec_min minimum Boundary Recall
+     * \param[in] ue_np_max maximum Undersegmentation Error
+     */
+    void setQualityThresholds(float rec_min, float ue_np_max);
+    
+    /** \brief Merge the parameter_optimization-<shard>.csv files of all shards
+     * into a single file as written by an unsharded grid search.
+     * 
+     * Rows are interleaved in the original grid order and the best parameters,
+     * the fastest parameters and the Pareto front are recomputed over all shards.
+     * 
+     * \param[in] shard_files files of all shards, ordered by shard index
+     * \param[in] output_file file to write, usually parameter_optimization.csv
+     * \param[in] rec_min minimum Boundary Recall, see setQualityThresholds
+     * \param[in] ue_np_max maximum Undersegmentation Error, see setQualityThresholds
+     */
+    static void mergeShards(const std::vector<boost::filesystem::path> &shard_files,
+            const boost::filesystem::path &output_file, float rec_min = 0, 
+            float ue_np_max = 1);
+    
     /** \brief Count parameter combinations.
      * \return the number of combinations of all parameter values
      */
@@ -121,6 +267,246 @@ public:
     
 protected:
     
+    /** \brief Averaged evaluation results of a single parameter combination. */
+    struct CombinationResult {
+        /** \brief Average Boundary Recall. */
+        float rec_average;
+        /** \brief Average Undersegmentation Error (Neubert and Protzel). */
+        float ue_np_average;
+        /** \brief Average Compactness. */
+        float co_average;
+        /** \brief Average number of superpixels. */
+        float sp_average;
+        /** \brief Average runtime per image in seconds, -1 if unknown. */
+        float runtime_average;
+        /** \brief Directory the superpixel segmentations were written to. */
+        std::string sp_directory;
+    };
+    
+    /** \brief Get the value indices of the k-th parameter combination; the
+     * last parameter changes fastest.
+     * \param[in] k index of the combination
+     * \param[out] indices value index for each parameter
+     */
+    void decodeCombination(int k, std::vector<int> &indices);
+    
+    /** \brief Get the index of the combination given the value indices, see decodeCombination.
+     * \param[in] indices value index for each parameter
+     * \return index of the combination
+     */
+    int encodeCombination(const std::vector<int> &indices);
+    
+    /** \brief Get the number of values of the p-th parameter.
+     * \param[in] p parameter
+     * \return number of values
+     */
+    int getParameterSize(int p);
+    
+    /** \brief Get the parameter values of a combination as float.
+     * \param[in] indices value index for each parameter
+     * \param[out] values values for each parameter
+     * \param[in] scale image scale to adapt resolution dependent parameters to
+     */
+    void getParameterValues(const std::vector<int> &indices, std::vector<float> &values,
+            float scale = 1);
+    
+    /** \brief Scale the value of a parameter to the given image scale, see
+     * scaleWithResolution.
+     * \param[in] p parameter
+     * \param[in] value value at full resolution
+     * \param[in] scale image scale
+     * \return scaled value, at least 1 for integer parameters
+     */
+    float scaleParameterValue(int p, float value, float scale);
+    
+    /** \brief Build the command line for the given combination.
+     * \param[in] indices value index for each parameter
+     * \param[in] img_directory_k image directory to use
+     * \param[in] sp_directory directory to write superpixel segmentations to
+     * \param[in] scale image scale, see setScreeningScale
+     * \return command line
+     */
+    std::string buildCommandLine(const std::vector<int> &indices, 
+            const boost::filesystem::path &img_directory_k, const boost::filesystem::path &sp_directory,
+            float scale = 1);
+    
+    /** \brief Evaluate a combination by running the command line tool and
+     * EvaluationSummary on its output.
+     * \param[in] k index of the combination
+     * \param[in] indices value index for each parameter
+     * \param[in] img_directory_k image directory to use
+     * \param[in] gt_directory_k ground truth directory to use
+     * \param[in] scale image scale, see setScreeningScale
+     * \param[out] result averaged results
+     */
+    void evaluateCommandLine(int k, const std::vector<int> &indices, 
+            const boost::filesystem::path &img_directory_k, const boost::filesystem::path &gt_directory_k,
+            float scale, CombinationResult &result);
+    
+    /** \brief Evaluate a combination in-process, see setSegmentationFunction.
+     * \param[in] k index of the combination
+     * \param[in] indices value index for each parameter
+     * \param[in] subset number of images to evaluate on, 0 for all
+     * \param[in] scale image scale, see setScreeningScale
+     * \param[out] result averaged results
+     */
+    void evaluateInProcess(int k, const std::vector<int> &indices, 
+            int subset, float scale, CombinationResult &result);
+    
+    /** \brief Estimate the number of superpixels of a combination on a few
+     * images, see setEarlyReject.
+     * \param[in] k index of the combination
+     * \param[in] indices value index for each parameter
+     * \param[in] img_directory_k directory containing the images to check
+     * \param[out] result result of a rejected combination
+     * \return whether the combination is rejected
+     */
+    bool rejectEarly(int k, const std::vector<int> &indices, 
+            const boost::filesystem::path &img_directory_k, CombinationResult &result);
+    
+    /** \brief Run the command line tool and post-processing.
+     * \param[in] indices value index for each parameter
+     * \param[in] img_directory_k image directory to use
+     * \param[in] sp_directory directory to write superpixel segmentations to
+     * \param[in] scale image scale, see setScreeningScale
+     */
+    void runCommandLine(const std::vector<int> &indices, 
+            const boost::filesystem::path &img_directory_k, const boost::filesystem::path &sp_directory,
+            float scale = 1);
+    
+    /** \brief Load images and ground truth segmentations for in-process evaluation,
+     * including their downscaled versions used for screening.
+     */
+    void loadInProcessData();
+    
+    /** \brief List the images and fix the random order used for image subsets.
+     */
+    void loadImageOrder();
+    
+    /** \brief Create a directory containing the first images of the random
+     * image order, see loadImageOrder.
+     * 
+     * If downscaled, the ground truth segmentations are downscaled as well
+     * and written to a separate directory.
+     * 
+     * \param[in] subset number of images
+     * \param[in] scale image scale
+     * \param[out] gt_subset_directory ground truth directory to use with the subset
+     * \return directory of the subset
+     */
+    boost::filesystem::path createImageSubset(int subset, float scale, 
+            boost::filesystem::path &gt_subset_directory);
+    
+    /** \brief Evaluate the given combinations, in parallel if requested.
+     * \param[in] combinations indices of combinations to evaluate
+     * \param[out] results results in the order of combinations
+     * \param[in] subset number of images to evaluate on, 0 for all
+     * \param[in] scale image scale, see setScreeningScale
+     */
+    void evaluateCombinations(const std::vector<int> &combinations, 
+            std::vector<CombinationResult> &results, int subset = 0, float scale = 1);
+    
+    /** \brief Evaluate those candidates not evaluated yet on all images and append
+     * them to the evaluated combinations.
+     * \param[in] candidates combinations to evaluate
+     * \param[in,out] combinations evaluated combinations
+     * \param[in,out] results results of evaluated combinations
+     */
+    void evaluateNewCombinations(const std::vector<int> &candidates,
+            std::vector<int> &combinations, std::vector<CombinationResult> &results);
+    
+    /** \brief Get the number of evaluations allowed, see setSearchStrategy.
+     * \return search budget
+     */
+    int getSearchBudget();
+    
+    /** \brief Compute the primary score of a combination.
+     * \param[in] result averaged results
+     * \param[in] weight weight between boundary recall and undersegmentation error
+     * \return score, -1 if the superpixel tolerance is not met
+     */
+    float computeScore(const CombinationResult &result, float weight);
+    
+    /** \brief Sample distinct combinations uniformly.
+     * \param[in] n number of combinations
+     * \param[out] combinations sampled combinations
+     */
+    void sampleCombinations(int n, std::vector<int> &combinations);
+    
+    /** \brief Evaluate all combinations.
+     * \param[out] combinations evaluated combinations
+     * \param[out] results results of evaluated combinations
+     */
+    void searchGrid(std::vector<int> &combinations, std::vector<CombinationResult> &results);
+    
+    /** \brief Evaluate randomly sampled combinations.
+     * \param[out] combinations evaluated combinations
+     * \param[out] results results of evaluated combinations
+     */
+    void searchRandom(std::vector<int> &combinations, std::vector<CombinationResult> &results);
+    
+    /** \brief Coordinate descent over the parameters.
+     * \param[in] weight weight between boundary recall and undersegmentation error
+     * \param[out] combinations evaluated combinations
+     * \param[out] results results of evaluated combinations
+     */
+    void searchCoordinateDescent(float weight, std::vector<int> &combinations, 
+            std::vector<CombinationResult> &results);
+    
+    /** \brief Successive halving on growing image subsets.
+     * \param[in] weight weight between boundary recall and undersegmentation error
+     * \param[out] combinations combinations evaluated on all images
+     * \param[out] results results of evaluated combinations
+     */
+    void searchSuccessiveHalving(float weight, std::vector<int> &combinations, 
+            std::vector<CombinationResult> &results);
+    
+    /** \brief Keep the best third of the candidates on growing image subsets
+     * until the subset covers all images or the rounds are exhausted; subsets
+     * are downscaled by the screening scale.
+     * \param[in] weight weight between boundary recall and undersegmentation error
+     * \param[in] subset initial number of images
+     * \param[in] rounds maximum number of rounds
+     * \param[in,out] candidates candidates, only the survivors are kept
+     */
+    void halveCandidates(float weight, int subset, int rounds, std::vector<int> &candidates);
+    
+    /** \brief Hyperband, i.e. successive halving brackets starting on different
+     * image subsets.
+     * \param[in] weight weight between boundary recall and undersegmentation error
+     * \param[out] combinations combinations evaluated on all images
+     * \param[out] results results of evaluated combinations
+     */
+    void searchHyperband(float weight, std::vector<int> &combinations, 
+            std::vector<CombinationResult> &results);
+    
+    /** \brief Tree-structured Parzen Estimator over the value indices.
+     * \param[in] weight weight between boundary recall and undersegmentation error
+     * \param[out] combinations evaluated combinations
+     * \param[out] results results of evaluated combinations
+     */
+    void searchTPE(float weight, std::vector<int> &combinations, 
+            std::vector<CombinationResult> &results);
+    
+    /** \brief Select the fastest combination meeting the superpixel tolerance
+     * and the quality thresholds, see setQualityThresholds.
+     * \param[in] results results as written to parameter_optimization.csv.txt
+     * \param[in] rec_min minimum Boundary Recall
+     * \param[in] ue_np_max maximum Undersegmentation Error
+     * \return row of the fastest combination, -1 if none qualifies
+     */
+    static int selectFastest(const cv::Mat &results, float rec_min, float ue_np_max);
+    
+    /** \brief Write the combinations meeting the superpixel tolerance that are
+     * not dominated in both score and runtime, sorted by runtime.
+     * \param[in] header header of parameter_optimization.csv
+     * \param[in] rows rows of parameter_optimization.csv
+     * \param[in] results results as written to parameter_optimization.csv.txt
+     * \param[in] pareto_file file to write
+     */
+    static void writeParetoFront(const std::string &header, const std::vector<std::string> &rows,
+            const cv::Mat &results, const boost::filesystem::path &pareto_file);
+    
     /** \brief Removes all unnecessary CSV files in base folder.
      * \param[in] so_directory clean up the directory containing the superpixel labels
      */
@@ -160,6 +546,56 @@ protected:
     int superpixels_min;
     /** brief Maximum number of superpixels. */
     int superpixels_max;
+    /** \brief Number of images to check the superpixel tolerance on, see setEarlyReject. */
+    int early_reject_images;
+    /** \brief Relative margin of the superpixel tolerance, see setEarlyReject. */
+    float early_reject_margin;
+    /** \brief Minimum Boundary Recall for fast_best, see setQualityThresholds. */
+    float rec_min;
+    /** \brief Maximum Undersegmentation Error for fast_best, see setQualityThresholds. */
+    float ue_np_max;
+    
+    /** \brief Number of combinations to evaluate in parallel. */
+    int threads;
+    /** \brief Search strategy, see setSearchStrategy. */
+    int search_strategy;
+    /** \brief Search budget, see setSearchStrategy. */
+    int search_budget;
+    /** \brief Random seed, see setSearchStrategy. */
+    unsigned int random_seed;
+    /** \brief Index of the shard to evaluate, see setShard. */
+    int shard;
+    /** \brief Number of shards, see setShard. */
+    int shards;
+    /** \brief Image scale used for screening, see setScreeningScale. */
+    float screening_scale;
+    /** \brief Exponents of parameters depending on the resolution, see scaleWithResolution. */
+    std::map<std::string, int> scaled_parameters;
+    
+    /** \brief All images, sorted by path. */
+    std::vector<boost::filesystem::path> image_order_files;
+    /** \brief Random order of the images used for subsets. */
+    std::vector<int> image_order;
+    /** \brief Hashes of images and ground truths by image file name, see ResultCache::hashImage. */
+    std::map<std::string, std::string> image_hashes;
+    /** \brief Result cache, if set. */
+    ResultCache* result_cache;
+    /** \brief Memo of evaluation results shared by all combinations, as
+     * saturated parameters often yield identical segmentations. */
+    EvaluationMemo evaluation_memo;
+    /** \brief In-process segmentation, if set. */
+    SegmentationFunction segmentation_function;
+    
+    /** \brief Images for in-process evaluation. */
+    std::vector<cv::Mat> images;
+    /** \brief Ground truth segmentations for each image for in-process evaluation. */
+    std::vector< std::vector<cv::Mat> > ground_truths;
+    /** \brief Ground truth indices for each image for in-process evaluation. */
+    std::vector< std::vector<int> > ground_truth_indices;
+    /** \brief Images downscaled for screening, see setScreeningScale. */
+    std::vector<cv::Mat> scaled_images;
+    /** \brief Ground truth segmentations downscaled for screening. */
+    std::vector< std::vector<cv::Mat> > scaled_ground_truths;
     
 };
 
@@ -0,0 +1,360 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <algorithm>
+#include <unistd.h>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include "performance_baseline.h"
+
+#ifndef SUPERPIXEL_BENCHMARK_COMMIT
+#define SUPERPIXEL_BENCHMARK_COMMIT "unknown"
+#endif
+
+/** \brief Escape a string for JSON.
+ * \param[in] string string to escape
+ * \return escaped string without quotes
+ */
+static std::string escapeJSON(const std::string &string) {
+    std::string escaped;
+    for (unsigned int i = 0; i < string.size(); ++i) {
+        if (string[i] == '"' || string[i] == '\\') {
+            escaped += '\\';
+        }
+        
+        escaped += string[i];
+    }
+    
+    return escaped;
+}
+
+/** \brief Compute ranks, averaged over ties, of the given values.
+ * \param[in] values values
+ * \param[out] ranks ranks starting at 1
+ * \return sum of t^3 - t over all groups of t ties
+ */
+static double computeRanks(const std::vector<double> &values, std::vector<double> &ranks) {
+    int n = values.size();
+    std::vector<int> order(n);
+    for (int i = 0; i < n; ++i) {
+        order[i] = i;
+    }
+    
+    std::sort(order.begin(), order.end(), [&values](int a, int b) {
+        return values[a] < values[b];
+    });
+    
+    ranks.resize(n);
+    double ties = 0;
+    for (int i = 0; i < n; ) {
+        int j = i;
+        while (j + 1 < n && values[order[j + 1]] == values[order[i]]) {
+            ++j;
+        }
+        
+        double t = j - i + 1;
+        for (int k = i; k <= j; ++k) {
+            ranks[order[k]] = 0.5*(i + j) + 1;
+        }
+        
+        ties += t*t*t - t;
+        i = j + 1;
+    }
+    
+    return ties;
+}
+
+/** \brief Upper tail of the standard normal distribution.
+ * \param[in] z z-score
+ * \return probability of values larger than z
+ */
+static double computeUpperTail(double z) {
+    return 0.5*std::erfc(z/std::sqrt(2.));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+PerformanceBaseline::PerformanceBaseline() 
+        : commit(SUPERPIXEL_BENCHMARK_COMMIT) {
+    
+    char buffer[256];
+    if (gethostname(buffer, sizeof(buffer)) == 0) {
+        buffer[sizeof(buffer) - 1] = '\0';
+        host = buffer;
+    }
+    
+    std::time_t now = std::time(NULL);
+    char time_buffer[32];
+    std::strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    date = time_buffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// add
+////////////////////////////////////////////////////////////////////////////////
+
+void PerformanceBaseline::add(const std::string &key, 
+        const std::vector<double> &samples, bool paired) {
+    
+    Entry entry;
+    entry.key = key;
+    entry.samples = samples;
+    entry.paired = paired;
+    
+    for (unsigned int i = 0; i < entries.size(); ++i) {
+        if (entries[i].key == key) {
+            entries[i] = entry;
+            return;
+        }
+    }
+    
+    entries.push_back(entry);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// write
+////////////////////////////////////////////////////////////////////////////////
+
+bool PerformanceBaseline::write(const boost::filesystem::path &file) const {
+    std::ofstream stream(file.string());
+    if (!stream.is_open()) {
+        return false;
+    }
+    
+    stream.precision(9);
+    stream << "{\n";
+    stream << "  \"commit\": \"" << escapeJSON(commit) << "\",\n";
+    stream << "  \"host\": \"" << escapeJSON(host) << "\",\n";
+    stream << "  \"date\": \"" << escapeJSON(date) << "\",\n";
+    stream << "  \"entries\": [";
+    
+    for (unsigned int i = 0; i < entries.size(); ++i) {
+        stream << (i > 0 ? "," : "") << "\n    {\"key\": \"" << escapeJSON(entries[i].key) 
+                << "\", \"paired\": " << (entries[i].paired ? "true" : "false") 
+                << ", \"samples\": [";
+        
+        for (unsigned int j = 0; j < entries[i].samples.size(); ++j) {
+            stream << (j > 0 ? ", " : "") << entries[i].samples[j];
+        }
+        
+        stream << "]}";
+    }
+    
+    stream << "\n  ]\n}\n";
+    return stream.good();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// read
+////////////////////////////////////////////////////////////////////////////////
+
+bool PerformanceBaseline::read(const boost::filesystem::path &file) {
+    boost::property_tree::ptree tree;
+    try {
+        boost::property_tree::read_json(file.string(), tree);
+    }
+    catch (const boost::property_tree::json_parser_error &e) {
+        return false;
+    }
+    
+    commit = tree.get<std::string>("commit", "unknown");
+    host = tree.get<std::string>("host", "");
+    date = tree.get<std::string>("date", "");
+    entries.clear();
+    
+    boost::optional<boost::property_tree::ptree&> list = tree.get_child_optional("entries");
+    if (!list) {
+        return true;
+    }
+    
+    for (boost::property_tree::ptree::iterator it = list->begin(); it != list->end(); ++it) {
+        Entry entry;
+        entry.key = it->second.get<std::string>("key", "");
+        entry.paired = it->second.get<bool>("paired", false);
+        
+        boost::optional<boost::property_tree::ptree&> samples = it->second.get_child_optional("samples");
+        if (samples) {
+            for (boost::property_tree::ptree::iterator jt = samples->begin(); 
+                    jt != samples->end(); ++jt) {
+                entry.samples.push_back(jt->second.get_value<double>());
+            }
+        }
+        
+        entries.push_back(entry);
+    }
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// compare
+////////////////////////////////////////////////////////////////////////////////
+
+void PerformanceBaseline::compare(const PerformanceBaseline &reference, 
+        const PerformanceBaseline &current, double alpha, double threshold,
+        std::vector<Comparison> &comparisons) {
+    
+    comparisons.clear();
+    for (unsigned int i = 0; i < current.entries.size(); ++i) {
+        const Entry &entry = current.entries[i];
+        
+        const Entry* reference_entry = NULL;
+        for (unsigned int j = 0; j < reference.entries.size(); ++j) {
+            if (reference.entries[j].key == entry.key) {
+                reference_entry = &reference.entries[j];
+                break;
+            }
+        }
+        
+        if (reference_entry == NULL || entry.samples.empty() 
+                || reference_entry->samples.empty()) {
+            continue;
+        }
+        
+        Comparison comparison;
+        comparison.key = entry.key;
+        comparison.reference_median = median(reference_entry->samples);
+        comparison.median = median(entry.samples);
+        comparison.ratio = comparison.reference_median > 0 
+                ? comparison.median/comparison.reference_median : 1;
+        
+        // Paired samples of different length (e.g. a changed image set) are 
+        // compared as unpaired samples.
+        if (entry.paired && reference_entry->paired 
+                && entry.samples.size() == reference_entry->samples.size()) {
+            comparison.p = testWilcoxon(reference_entry->samples, entry.samples);
+        }
+        else {
+            comparison.p = testMannWhitney(reference_entry->samples, entry.samples);
+        }
+        
+        comparison.slowdown = (comparison.p < alpha && comparison.ratio > threshold);
+        comparisons.push_back(comparison);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// testMannWhitney
+////////////////////////////////////////////////////////////////////////////////
+
+double PerformanceBaseline::testMannWhitney(const std::vector<double> &x, 
+        const std::vector<double> &y) {
+    
+    double n_x = x.size();
+    double n_y = y.size();
+    double n = n_x + n_y;
+    if (n_x == 0 || n_y == 0) {
+        return 1;
+    }
+    
+    std::vector<double> values(x);
+    values.insert(values.end(), y.begin(), y.end());
+    
+    std::vector<double> ranks;
+    double ties = computeRanks(values, ranks);
+    
+    double rank_sum = 0;
+    for (unsigned int i = x.size(); i < values.size(); ++i) {
+        rank_sum += ranks[i];
+    }
+    
+    double u = rank_sum - n_y*(n_y + 1)/2;
+    double mean = n_x*n_y/2;
+    double variance = n_x*n_y/12*((n + 1) - ties/(n*(n - 1)));
+    if (variance <= 0) {
+        return 1;
+    }
+    
+    // Continuity correction.
+    return computeUpperTail((u - mean - 0.5)/std::sqrt(variance));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// testWilcoxon
+////////////////////////////////////////////////////////////////////////////////
+
+double PerformanceBaseline::testWilcoxon(const std::vector<double> &x, 
+        const std::vector<double> &y) {
+    
+    // Zero differences are dropped.
+    std::vector<double> differences;
+    std::vector<double> magnitudes;
+    for (unsigned int i = 0; i < std::min(x.size(), y.size()); ++i) {
+        if (y[i] != x[i]) {
+            differences.push_back(y[i] - x[i]);
+            magnitudes.push_back(std::abs(y[i] - x[i]));
+        }
+    }
+    
+    double n = differences.size();
+    if (n == 0) {
+        return 1;
+    }
+    
+    std::vector<double> ranks;
+    double ties = computeRanks(magnitudes, ranks);
+    
+    double w = 0;
+    for (unsigned int i = 0; i < differences.size(); ++i) {
+        if (differences[i] > 0) {
+            w += ranks[i];
+        }
+    }
+    
+    double mean = n*(n + 1)/4;
+    double variance = n*(n + 1)*(2*n + 1)/24 - ties/48;
+    if (variance <= 0) {
+        return 1;
+    }
+    
+    return computeUpperTail((w - mean - 0.5)/std::sqrt(variance));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// median
+////////////////////////////////////////////////////////////////////////////////
+
+double PerformanceBaseline::median(const std::vector<double> &samples) {
+    if (samples.empty()) {
+        return 0;
+    }
+    
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    
+    int n = sorted.size();
+    return (n % 2 == 1) ? sorted[n/2] : 0.5*(sorted[n/2 - 1] + sorted[n/2]);
+}
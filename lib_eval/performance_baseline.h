@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PERFORMANCE_BASELINE_H
+#define	PERFORMANCE_BASELINE_H
+
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+/** \brief Runtime measurements keyed by git commit and host, stored as JSON,
+ * to detect performance regressions.
+ * 
+ * Each entry holds the samples of one kernel or algorithm, e.g. the timed
+ * repetitions of a microbenchmark (unpaired) or the per-image runtimes of an
+ * algorithm on a fixed set of images (paired, i.e. the i-th sample of two
+ * baselines refers to the same image). Two baselines are compared entry by 
+ * entry using the one-sided Mann-Whitney U test (unpaired) or Wilcoxon 
+ * signed-rank test (paired), both in their normal approximation.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   PerformanceBaseline baseline;
+ *   baseline.add("relabel_connected/480x640/1600", times, false);
+ *   baseline.write("baseline.json");
+ *   
+ *   PerformanceBaseline reference;
+ *   reference.read("reference.json");
+ *   std::vector<PerformanceBaseline::Comparison> comparisons;
+ *   PerformanceBaseline::compare(reference, baseline, 0.01, 1.05, comparisons);
+ * \endcode
+ * \author David Stutz
+ */
+class PerformanceBaseline {
+public:
+    
+    /** \brief Samples of a kernel or algorithm. */
+    struct Entry {
+        /** \brief Key, e.g. benchmark, size and number of superpixels. */
+        std::string key;
+        /** \brief Runtimes in seconds. */
+        std::vector<double> samples;
+        /** \brief Whether the samples are paired across baselines. */
+        bool paired;
+    };
+    
+    /** \brief Comparison of an entry present in both baselines. */
+    struct Comparison {
+        /** \brief Key of the entry. */
+        std::string key;
+        /** \brief Median of the reference. */
+        double reference_median;
+        /** \brief Median of the current baseline. */
+        double median;
+        /** \brief Ratio of the medians, > 1 for slowdowns. */
+        double ratio;
+        /** \brief One-sided p-value for the current baseline being slower. */
+        double p;
+        /** \brief Whether the slowdown is significant and above the threshold. */
+        bool slowdown;
+    };
+    
+    /** \brief Constructor, commit and host default to the current ones.
+     */
+    PerformanceBaseline();
+    
+    /** \brief Add an entry, replacing an entry with the same key.
+     * \param[in] key key of the entry
+     * \param[in] samples runtimes in seconds
+     * \param[in] paired whether the samples are paired across baselines
+     */
+    void add(const std::string &key, const std::vector<double> &samples, bool paired);
+    
+    /** \brief Write as JSON file.
+     * \param[in] file JSON file
+     * \return whether the file could be written
+     */
+    bool write(const boost::filesystem::path &file) const;
+    
+    /** \brief Read a JSON file written by write, replacing all entries.
+     * \param[in] file JSON file
+     * \return whether the file could be read
+     */
+    bool read(const boost::filesystem::path &file);
+    
+    /** \brief Compare all entries present in both baselines.
+     * \param[in] reference reference baseline, e.g. of the last release
+     * \param[in] current current baseline
+     * \param[in] alpha significance level
+     * \param[in] threshold minimum ratio of the medians to report a slowdown, e.g. 1.05
+     * \param[out] comparisons comparisons in the order of the current baseline
+     */
+    static void compare(const PerformanceBaseline &reference, 
+            const PerformanceBaseline &current, double alpha, double threshold,
+            std::vector<Comparison> &comparisons);
+    
+    /** \brief One-sided Mann-Whitney U test for the samples of y being larger.
+     * \param[in] x first samples
+     * \param[in] y second samples
+     * \return p-value
+     */
+    static double testMannWhitney(const std::vector<double> &x, 
+            const std::vector<double> &y);
+    
+    /** \brief One-sided Wilcoxon signed-rank test for y[i] being larger than x[i].
+     * \param[in] x first samples
+     * \param[in] y second samples, same size as x
+     * \return p-value
+     */
+    static double testWilcoxon(const std::vector<double> &x, 
+            const std::vector<double> &y);
+    
+    /** \brief Median of the samples.
+     * \param[in] samples samples
+     * \return median, 0 if empty
+     */
+    static double median(const std::vector<double> &samples);
+    
+    /** \brief Commit the code was built from, see CMakeLists.txt of lib_eval. */
+    std::string commit;
+    /** \brief Host name. */
+    std::string host;
+    /** \brief Time of the measurements as ISO 8601 string. */
+    std::string date;
+    /** \brief Entries. */
+    std::vector<Entry> entries;
+    
+};
+
+#endif	/* PERFORMANCE_BASELINE_H */
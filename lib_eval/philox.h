@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PHILOX_H
+#define	PHILOX_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/** \brief Counter-based Philox4x32-10 generator (Salmon et al., Parallel 
+ * Random Numbers: As Easy as 1, 2, 3, SC 2011).
+ * 
+ * Each counter maps to four independent 32 bit numbers under the given key,
+ * so the random numbers of a pixel can be computed from its position without
+ * any state: results do not depend on the order or the thread pixels are
+ * processed in. There are no branches, so loops over counters vectorize.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   uint32_t r[4];
+ *   Philox::generate(j, i, 0, 0, seed, 0, r);
+ *   float u = Philox::uniform(r[0]);
+ * \endcode
+ * \author David Stutz
+ */
+class Philox {
+public:
+    /** \brief Compute four random numbers for the given counter and key.
+     * \param[in] c0 first counter word
+     * \param[in] c1 second counter word
+     * \param[in] c2 third counter word
+     * \param[in] c3 fourth counter word
+     * \param[in] k0 first key word, e.g. the seed
+     * \param[in] k1 second key word, e.g. a stream
+     * \param[out] r four random numbers
+     */
+    static inline void generate(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, 
+            uint32_t k0, uint32_t k1, uint32_t r[4]) {
+        
+        for (int round = 0; round < 10; round++) {
+            uint64_t p0 = (uint64_t) 0xD2511F53u * c0;
+            uint64_t p1 = (uint64_t) 0xCD9E8D57u * c2;
+            
+            c0 = ((uint32_t) (p1 >> 32)) ^ c1 ^ k0;
+            c1 = (uint32_t) p1;
+            c2 = ((uint32_t) (p0 >> 32)) ^ c3 ^ k1;
+            c3 = (uint32_t) p0;
+            
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        
+        r[0] = c0;
+        r[1] = c1;
+        r[2] = c2;
+        r[3] = c3;
+    }
+    
+    /** \brief Uniform number in [0, 1) from the upper 24 bits.
+     * \param[in] r random number
+     * \return uniform number
+     */
+    static inline float uniform(uint32_t r) {
+        return (r >> 8)*(1.f/16777216.f);
+    }
+    
+    /** \brief Uniform number in (0, 1] from the upper 24 bits.
+     * \param[in] r random number
+     * \return uniform number
+     */
+    static inline float uniformPositive(uint32_t r) {
+        return ((r >> 8) + 1)*(1.f/16777216.f);
+    }
+    
+    /** \brief Two standard normal numbers using Box-Muller.
+     * 
+     * Logarithm, sine and cosine are evaluated using polynomials (relative 
+     * error below 1e-6) without branches, such that loops over pixels 
+     * vectorize; the libm calls would dominate the cost otherwise.
+     * 
+     * \param[in] r0 first random number
+     * \param[in] r1 second random number
+     * \param[out] n0 first normal number
+     * \param[out] n1 second normal number
+     */
+    static inline void normal(uint32_t r0, uint32_t r1, float &n0, float &n1) {
+        float radius = std::sqrt(-2.f*log(uniformPositive(r0)));
+        
+        // The angle 2*pi*u is split into quadrant q and the offset
+        // x in [-pi/4, pi/4) from the middle of the quadrant.
+        uint32_t q = r1 >> 30;
+        float x = ((r1 & 0x3FFFFFFFu) >> 6)*(1.5707963267948966f/16777216.f) 
+                - 0.78539816339744831f;
+        
+        float x2 = x*x;
+        float s = x*(1 + x2*(-1.f/6 + x2*(1.f/120 + x2*(-1.f/5040 + x2*(1.f/362880)))));
+        float c = 1 + x2*(-1.f/2 + x2*(1.f/24 + x2*(-1.f/720 + x2*(1.f/40320))));
+        
+        // Rotate by pi/4 and the quadrant.
+        float cq = 0.70710678118654752f*(c - s);
+        float sq = 0.70710678118654752f*(c + s);
+        
+        float cos = (q == 0) ? cq : ((q == 1) ? -sq : ((q == 2) ? -cq : sq));
+        float sin = (q == 0) ? sq : ((q == 1) ? cq : ((q == 2) ? -sq : -cq));
+        
+        n0 = radius*cos;
+        n1 = radius*sin;
+    }
+    
+private:
+    /** \brief Natural logarithm of a positive, normal float.
+     * \param[in] x number
+     * \return logarithm
+     */
+    static inline float log(float x) {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(float));
+        
+        // x = m*2^e with m in [sqrt(1/2), sqrt(2)).
+        int32_t e = ((int32_t) bits - 0x3F3504F3) >> 23;
+        uint32_t m_bits = bits - ((uint32_t) e << 23);
+        
+        float m;
+        std::memcpy(&m, &m_bits, sizeof(float));
+        
+        // log(m) = 2*atanh(t) with t = (m - 1)/(m + 1), |t| < 0.172.
+        float t = (m - 1)/(m + 1);
+        float t2 = t*t;
+        float log_m = 2*t*(1 + t2*(1.f/3 + t2*(1.f/5 + t2*(1.f/7 + t2*(1.f/9)))));
+        
+        return e*0.69314718055994531f + log_m;
+    }
+};
+
+#endif	/* PHILOX_H */
@@ -0,0 +1,334 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PLANAR_IMAGE_H
+#define	PLANAR_IMAGE_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <opencv2/opencv.hpp>
+#include "color_conversion.h"
+
+/** \brief Alignment of planes and padded rows in bytes, i.e. a cache line. */
+const size_t PLANAR_IMAGE_ALIGNMENT = 64;
+
+/** \brief Image stored as one plane per channel (e.g. L, a and b), with
+ * every plane, and every row of padded images, aligned to 64 bytes, such
+ * that the algorithms share one layout instead of converting cv::Mat into
+ * a private one each, and row kernels can use aligned SIMD loads.
+ * 
+ * Elements are unsigned char or float. The color space is converted while
+ * splitting the channels, in a single pass over the image: BGR and RGB keep
+ * the 8-bit values (0 to 255 also for float), LAB uses ColorConversion (as
+ * SLIC, SEEDS and LSC do; for unsigned char, L is scaled by 255/100 and 128
+ * is added to a and b as in OpenCV) and HSV uses cv::cvtColor on 8-bit
+ * images. Rows of padded images are stride elements apart, and the padding
+ * is zero; unpadded images have stride equal to the number of columns,
+ * i.e. pixel i of a plane is at y*cols + x, as most algorithms expect. 
+ * Memory is reused if the image is converted again with at most the same
+ * size.
+ * 
+ * The class is header-only such that the algorithm libraries can use it
+ * without linking against lib_eval.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   PlanarImage<float> planes;
+ *   planes.convert(image, PlanarImage<float>::LAB);
+ *   
+ *   for (int i = 0; i < planes.getRows(); ++i) {
+ *       const float* L = planes.getRow(0, i);
+ *       // ...
+ *   }
+ * \endcode
+ * \author David Stutz
+ */
+template<typename T>
+class PlanarImage {
+public:
+    
+    /** \brief Color spaces to convert BGR images to. */
+    enum ColorSpace {
+        BGR = 0,
+        RGB = 1,
+        LAB = 2,
+        HSV = 3,
+    };
+    
+    /** \brief Constructor, creates an empty image. */
+    PlanarImage() : data(NULL), rows(0), cols(0), channels(0), 
+            stride(0), plane_size(0) {
+        
+    }
+    
+    /** \brief Copy constructor; the planes are copied, as the aligned pointer
+     * cannot be copied along with the memory.
+     * \param[in] image image to copy
+     */
+    PlanarImage(const PlanarImage &image) : PlanarImage() {
+        *this = image;
+    }
+    
+    /** \brief Assignment, copies the planes.
+     * \param[in] image image to copy
+     * \return this image
+     */
+    PlanarImage& operator=(const PlanarImage &image) {
+        if (this != &image) {
+            create(image.rows, image.cols, image.channels, !image.isContinuous());
+            if (image.data != NULL) {
+                std::memcpy(data, image.data, plane_size*channels*sizeof(T));
+            }
+        }
+        
+        return *this;
+    }
+    
+    /** \brief Allocate an uninitialized image, reusing memory if possible.
+     * \param[in] rows number of rows
+     * \param[in] cols number of columns
+     * \param[in] channels number of channels, i.e. planes
+     * \param[in] padded whether rows are padded to 64 bytes
+     */
+    void create(int rows, int cols, int channels, bool padded = true) {
+        const size_t per_line = PLANAR_IMAGE_ALIGNMENT/sizeof(T);
+        
+        this->rows = rows;
+        this->cols = cols;
+        this->channels = channels;
+        this->stride = (padded ? (cols + per_line - 1)/per_line*per_line : cols);
+        this->plane_size = (stride*rows + per_line - 1)/per_line*per_line;
+        
+        size_t bytes = plane_size*channels*sizeof(T) + PLANAR_IMAGE_ALIGNMENT;
+        if (memory.size() < bytes) {
+            memory.resize(bytes);
+        }
+        
+        uintptr_t address = reinterpret_cast<uintptr_t>(memory.data());
+        data = reinterpret_cast<T*>(address + (PLANAR_IMAGE_ALIGNMENT 
+                - address % PLANAR_IMAGE_ALIGNMENT) % PLANAR_IMAGE_ALIGNMENT);
+    }
+    
+    /** \brief Convert rows of interleaved 8-bit BGR pixels.
+     * \param[in] bgr first row, three bytes per pixel
+     * \param[in] step bytes between rows
+     * \param[in] rows number of rows
+     * \param[in] cols number of columns
+     * \param[in] color_space color space to convert to
+     * \param[in] padded whether rows are padded to 64 bytes
+     */
+    void convert(const unsigned char* bgr, size_t step, int rows, int cols,
+            ColorSpace color_space, bool padded = true) {
+        
+        create(rows, cols, 3, padded);
+        
+        std::vector<float> lab;
+        if (color_space == LAB && !std::is_same<T, float>::value) {
+            lab.resize(3*cols);
+        }
+        
+        cv::Mat hsv;
+        if (color_space == HSV) {
+            cv::Mat image(rows, cols, CV_8UC3, const_cast<unsigned char*>(bgr), step);
+            cv::cvtColor(image, hsv, CV_BGR2HSV);
+        }
+        
+        for (int i = 0; i < rows; ++i) {
+            const unsigned char* row = (color_space == HSV ? hsv.ptr<unsigned char>(i) : bgr + i*step);
+            T* c0 = getRow(0, i);
+            T* c1 = getRow(1, i);
+            T* c2 = getRow(2, i);
+            
+            if (color_space == LAB) {
+                convertLABRow(row, c0, c1, c2, lab);
+            }
+            else {
+                // BGR and HSV keep the order, RGB swaps the first and last channel.
+                int first = (color_space == RGB ? 2 : 0);
+                for (int j = 0; j < cols; ++j) {
+                    c0[j] = row[3*j + first];
+                    c1[j] = row[3*j + 1];
+                    c2[j] = row[3*j + 2 - first];
+                }
+            }
+            
+            std::fill(c0 + cols, c0 + stride, T(0));
+            std::fill(c1 + cols, c1 + stride, T(0));
+            std::fill(c2 + cols, c2 + stride, T(0));
+        }
+    }
+    
+    /** \brief Convert a BGR image.
+     * \param[in] image CV_8UC3 image
+     * \param[in] color_space color space to convert to
+     * \param[in] padded whether rows are padded to 64 bytes
+     */
+    void convert(const cv::Mat &image, ColorSpace color_space, bool padded = true) {
+        CV_Assert(image.type() == CV_8UC3);
+        convert(image.ptr<unsigned char>(0), image.step[0], image.rows, image.cols,
+                color_space, padded);
+    }
+    
+    /** \brief Get the number of rows.
+     * \return number of rows
+     */
+    int getRows() const {
+        return rows;
+    }
+    
+    /** \brief Get the number of columns.
+     * \return number of columns
+     */
+    int getCols() const {
+        return cols;
+    }
+    
+    /** \brief Get the number of channels.
+     * \return number of channels
+     */
+    int getChannels() const {
+        return channels;
+    }
+    
+    /** \brief Get the distance between rows.
+     * \return distance between rows in elements
+     */
+    size_t getStride() const {
+        return stride;
+    }
+    
+    /** \brief Whether rows are not padded, i.e. pixel (y, x) is at y*cols + x.
+     * \return whether the planes are continuous
+     */
+    bool isContinuous() const {
+        return stride == (size_t) cols;
+    }
+    
+    /** \brief Get a plane.
+     * \param[in] channel channel
+     * \return first element of the plane, aligned to 64 bytes
+     */
+    T* getPlane(int channel) {
+        return data + channel*plane_size;
+    }
+    
+    /** \brief Get a plane.
+     * \param[in] channel channel
+     * \return first element of the plane, aligned to 64 bytes
+     */
+    const T* getPlane(int channel) const {
+        return data + channel*plane_size;
+    }
+    
+    /** \brief Get a row of a plane.
+     * \param[in] channel channel
+     * \param[in] i row
+     * \return first element of the row, aligned to 64 bytes if padded
+     */
+    T* getRow(int channel, int i) {
+        return getPlane(channel) + i*stride;
+    }
+    
+    /** \brief Get a row of a plane.
+     * \param[in] channel channel
+     * \param[in] i row
+     * \return first element of the row, aligned to 64 bytes if padded
+     */
+    const T* getRow(int channel, int i) const {
+        return getPlane(channel) + i*stride;
+    }
+    
+    /** \brief Get a plane as matrix without copying.
+     * \param[in] channel channel
+     * \return single-channel matrix referencing the plane
+     */
+    cv::Mat getMat(int channel) const {
+        return cv::Mat(rows, cols, cv::DataType<T>::type, 
+                const_cast<T*>(getPlane(channel)), stride*sizeof(T));
+    }
+    
+private:
+    
+    /** \brief Convert a row to LAB.
+     * \param[in] row interleaved BGR pixels
+     * \param[out] L lightness
+     * \param[out] A a channel
+     * \param[out] B b channel
+     * \param[in] buffer buffer of 3*cols floats for non-float planes
+     */
+    void convertLABRow(const unsigned char* row, float* L, float* A, float* B,
+            std::vector<float> &buffer) {
+        ColorConversion::convertBGRToLAB(row, cols, L, A, B);
+    }
+    
+    /** \brief Convert a row to LAB.
+     * \param[in] row interleaved BGR pixels
+     * \param[out] L lightness scaled to 0 to 255
+     * \param[out] A a channel plus 128
+     * \param[out] B b channel plus 128
+     * \param[in] buffer buffer of 3*cols floats
+     */
+    void convertLABRow(const unsigned char* row, unsigned char* L, unsigned char* A, 
+            unsigned char* B, std::vector<float> &buffer) {
+        
+        float* fL = buffer.data();
+        float* fA = fL + cols;
+        float* fB = fA + cols;
+        ColorConversion::convertBGRToLAB(row, cols, fL, fA, fB);
+        
+        for (int j = 0; j < cols; ++j) {
+            L[j] = cv::saturate_cast<unsigned char>(fL[j]*255.f/100.f);
+            A[j] = cv::saturate_cast<unsigned char>(fA[j] + 128.f);
+            B[j] = cv::saturate_cast<unsigned char>(fB[j] + 128.f);
+        }
+    }
+    
+    /** \brief Memory, including space for alignment. */
+    std::vector<char> memory;
+    /** \brief First plane, aligned. */
+    T* data;
+    /** \brief Number of rows. */
+    int rows;
+    /** \brief Number of columns. */
+    int cols;
+    /** \brief Number of channels. */
+    int channels;
+    /** \brief Distance between rows in elements. */
+    size_t stride;
+    /** \brief Distance between planes in elements, a multiple of 64 bytes. */
+    size_t plane_size;
+    
+};
+
+#endif	/* PLANAR_IMAGE_H */
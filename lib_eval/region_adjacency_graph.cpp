@@ -0,0 +1,325 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <glog/logging.h>
+#include "region_adjacency_graph.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+RegionAdjacencyGraph::RegionAdjacencyGraph(const cv::Mat &labels) 
+        : regions(0), color_moments(false) {
+    build(labels, cv::Mat());
+}
+
+RegionAdjacencyGraph::RegionAdjacencyGraph(const cv::Mat &labels, const cv::Mat &image) 
+        : regions(0), color_moments(false) {
+    
+    LOG_IF(FATAL, image.type() != CV_8UC3) << "Invalid image type.";
+    LOG_IF(FATAL, labels.rows != image.rows || labels.cols != image.cols) 
+            << "Superpixel segmentation does not match image size.";
+    
+    build(labels, image);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// build
+////////////////////////////////////////////////////////////////////////////////
+
+void RegionAdjacencyGraph::build(const cv::Mat &labels, const cv::Mat &image) {
+    
+    LOG_IF(FATAL, labels.type() != CV_32SC1) << "Invalid label type.";
+    
+    int max_label = -1;
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            LOG_IF(FATAL, labels_i[j] < 0) << "Labels need to be non-negative.";
+            max_label = std::max(max_label, labels_i[j]);
+        }
+    }
+    
+    regions = max_label + 1;
+    color_moments = !image.empty();
+    
+    areas.assign(regions, 0);
+    perimeters.assign(regions, 0);
+    
+    std::vector<int> min_i(regions, std::numeric_limits<int>::max());
+    std::vector<int> max_i(regions, std::numeric_limits<int>::min());
+    std::vector<int> min_j(regions, std::numeric_limits<int>::max());
+    std::vector<int> max_j(regions, std::numeric_limits<int>::min());
+    
+    if (color_moments) {
+        color_sums.assign(regions, cv::Vec3d(0, 0, 0));
+        color_squared_sums.assign(regions, cv::Vec3d(0, 0, 0));
+    }
+    
+    // Pixel pairs with differing labels, collected once from the right and
+    // bottom neighbor of each pixel and then counted per edge.
+    std::vector< std::pair<int, int> > pairs;
+    
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        const int* labels_ii = (i < labels.rows - 1) ? labels.ptr<int>(i + 1) : NULL;
+        const cv::Vec3b* image_i = color_moments ? image.ptr<cv::Vec3b>(i) : NULL;
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            int label = labels_i[j];
+            
+            areas[label]++;
+            min_i[label] = std::min(min_i[label], i);
+            max_i[label] = std::max(max_i[label], i);
+            min_j[label] = std::min(min_j[label], j);
+            max_j[label] = std::max(max_j[label], j);
+            
+            // The image border counts towards the perimeter.
+            if (i == 0 || i == labels.rows - 1) {
+                perimeters[label] += (labels.rows == 1) ? 2 : 1;
+            }
+            
+            if (j == 0 || j == labels.cols - 1) {
+                perimeters[label] += (labels.cols == 1) ? 2 : 1;
+            }
+            
+            if (j < labels.cols - 1 && labels_i[j + 1] != label) {
+                int neighbor = labels_i[j + 1];
+                perimeters[label]++;
+                perimeters[neighbor]++;
+                pairs.push_back(std::make_pair(std::min(label, neighbor), 
+                        std::max(label, neighbor)));
+            }
+            
+            if (labels_ii != NULL && labels_ii[j] != label) {
+                int neighbor = labels_ii[j];
+                perimeters[label]++;
+                perimeters[neighbor]++;
+                pairs.push_back(std::make_pair(std::min(label, neighbor), 
+                        std::max(label, neighbor)));
+            }
+            
+            if (color_moments) {
+                for (int c = 0; c < 3; ++c) {
+                    double value = image_i[j][c];
+                    color_sums[label][c] += value;
+                    color_squared_sums[label][c] += value*value;
+                }
+            }
+        }
+    }
+    
+    bounding_boxes.assign(regions, cv::Rect());
+    for (int k = 0; k < regions; ++k) {
+        if (areas[k] > 0) {
+            bounding_boxes[k] = cv::Rect(min_j[k], min_i[k], 
+                    max_j[k] - min_j[k] + 1, max_i[k] - min_i[k] + 1);
+        }
+    }
+    
+    std::sort(pairs.begin(), pairs.end());
+    
+    // Unique edges with their number of pixel pairs.
+    std::vector< std::pair<int, int> > edges;
+    std::vector<int> lengths;
+    for (unsigned int p = 0; p < pairs.size(); ++p) {
+        if (p == 0 || pairs[p] != pairs[p - 1]) {
+            edges.push_back(pairs[p]);
+            lengths.push_back(0);
+        }
+        
+        lengths.back()++;
+    }
+    
+    offsets.assign(regions + 1, 0);
+    for (unsigned int e = 0; e < edges.size(); ++e) {
+        offsets[edges[e].first + 1]++;
+        offsets[edges[e].second + 1]++;
+    }
+    
+    for (int k = 0; k < regions; ++k) {
+        offsets[k + 1] += offsets[k];
+    }
+    
+    // As edges are sorted, filling the rows in edge order keeps the
+    // neighbors of each region sorted.
+    neighbors.resize(2*edges.size());
+    boundary_lengths.resize(2*edges.size());
+    std::vector<int> positions(offsets.begin(), offsets.end() - 1);
+    
+    for (unsigned int e = 0; e < edges.size(); ++e) {
+        int first = edges[e].first;
+        int second = edges[e].second;
+        
+        neighbors[positions[first]] = second;
+        boundary_lengths[positions[first]] = lengths[e];
+        positions[first]++;
+        
+        neighbors[positions[second]] = first;
+        boundary_lengths[positions[second]] = lengths[e];
+        positions[second]++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getRegions
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::getRegions() const {
+    return regions;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getEdges
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::getEdges() const {
+    return neighbors.size()/2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getOffsets
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<int> &RegionAdjacencyGraph::getOffsets() const {
+    return offsets;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getNeighbors
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<int> &RegionAdjacencyGraph::getNeighbors() const {
+    return neighbors;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getBoundaryLengths
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<int> &RegionAdjacencyGraph::getBoundaryLengths() const {
+    return boundary_lengths;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getDegree
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::getDegree(int region) const {
+    return offsets[region + 1] - offsets[region];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getBoundaryLength
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::getBoundaryLength(int region, int neighbor) const {
+    
+    std::vector<int>::const_iterator begin = neighbors.begin() + offsets[region];
+    std::vector<int>::const_iterator end = neighbors.begin() + offsets[region + 1];
+    std::vector<int>::const_iterator it = std::lower_bound(begin, end, neighbor);
+    
+    if (it == end || *it != neighbor) {
+        return 0;
+    }
+    
+    return boundary_lengths[it - neighbors.begin()];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getArea
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::getArea(int region) const {
+    return areas[region];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getPerimeter
+////////////////////////////////////////////////////////////////////////////////
+
+float RegionAdjacencyGraph::getPerimeter(int region) const {
+    return perimeters[region];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getBoundingBox
+////////////////////////////////////////////////////////////////////////////////
+
+cv::Rect RegionAdjacencyGraph::getBoundingBox(int region) const {
+    return bounding_boxes[region];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getColorSum
+////////////////////////////////////////////////////////////////////////////////
+
+cv::Vec3d RegionAdjacencyGraph::getColorSum(int region) const {
+    LOG_IF(FATAL, !color_moments) << "Color moments not computed.";
+    return color_sums[region];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getMeanColor
+////////////////////////////////////////////////////////////////////////////////
+
+cv::Vec3d RegionAdjacencyGraph::getMeanColor(int region) const {
+    LOG_IF(FATAL, !color_moments) << "Color moments not computed.";
+    
+    if (areas[region] == 0) {
+        return cv::Vec3d(0, 0, 0);
+    }
+    
+    return color_sums[region]/areas[region];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getColorVariance
+////////////////////////////////////////////////////////////////////////////////
+
+cv::Vec3d RegionAdjacencyGraph::getColorVariance(int region) const {
+    LOG_IF(FATAL, !color_moments) << "Color moments not computed.";
+    
+    cv::Vec3d variance(0, 0, 0);
+    if (areas[region] == 0) {
+        return variance;
+    }
+    
+    for (int c = 0; c < 3; ++c) {
+        double mean = color_sums[region][c]/areas[region];
+        variance[c] = std::max(0., color_squared_sums[region][c]/areas[region] - mean*mean);
+    }
+    
+    return variance;
+}
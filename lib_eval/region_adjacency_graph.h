@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef REGION_ADJACENCY_GRAPH_H
+#define	REGION_ADJACENCY_GRAPH_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/** \brief Region adjacency graph of a superpixel segmentation, built in a
+ * single pass over the labels.
+ * 
+ * Regions correspond to labels \f$0, \ldots, L\f$ where \f$L\f$ is the maximum
+ * label; labels not present have zero area and no neighbors. Edges are stored
+ * in compressed sparse row format, i.e. the neighbors of region \f$k\f$ are
+ * neighbors[offsets[k]], ..., neighbors[offsets[k + 1] - 1] in ascending
+ * order, and carry the number of 4-connected pixel pairs shared by the
+ * two regions.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   RegionAdjacencyGraph graph(labels, image);
+ *   for (int k = 0; k < graph.getRegions(); ++k) {
+ *       for (int e = graph.getOffsets()[k]; e < graph.getOffsets()[k + 1]; ++e) {
+ *           int neighbor = graph.getNeighbors()[e];
+ *           int length = graph.getBoundaryLengths()[e];
+ *       }
+ *   }
+ * \endcode
+ * \author David Stutz
+ */
+class RegionAdjacencyGraph {
+public:
+    /** \brief Constructor, computes adjacency, areas, perimeters and bounding boxes.
+     * \param[in] labels superpixel labels as CV_32SC1
+     */
+    RegionAdjacencyGraph(const cv::Mat &labels);
+    
+    /** \brief Constructor, additionally computes color moments.
+     * \param[in] labels superpixel labels as CV_32SC1
+     * \param[in] image image as CV_8UC3
+     */
+    RegionAdjacencyGraph(const cv::Mat &labels, const cv::Mat &image);
+    
+    /** \brief Get the number of regions, i.e. maximum label plus one.
+     * \return number of regions
+     */
+    int getRegions() const;
+    
+    /** \brief Get the number of edges, each counted once.
+     * \return number of edges
+     */
+    int getEdges() const;
+    
+    /** \brief Get the row offsets, of size getRegions() + 1.
+     * \return offsets
+     */
+    const std::vector<int> &getOffsets() const;
+    
+    /** \brief Get the neighbors of all regions, see getOffsets().
+     * \return neighbors
+     */
+    const std::vector<int> &getNeighbors() const;
+    
+    /** \brief Get the number of 4-connected pixel pairs per edge, see getOffsets().
+     * \return boundary lengths
+     */
+    const std::vector<int> &getBoundaryLengths() const;
+    
+    /** \brief Get the number of neighbors of a region.
+     * \param[in] region region
+     * \return degree
+     */
+    int getDegree(int region) const;
+    
+    /** \brief Get the number of 4-connected pixel pairs shared by two regions.
+     * \param[in] region region
+     * \param[in] neighbor other region
+     * \return boundary length, zero if not adjacent
+     */
+    int getBoundaryLength(int region, int neighbor) const;
+    
+    /** \brief Get the number of pixels of a region.
+     * \param[in] region region
+     * \return area
+     */
+    int getArea(int region) const;
+    
+    /** \brief Get the perimeter of a region as used by Evaluation::computeCompactness,
+     * i.e. the number of 4-neighbors with different label including the image border.
+     * \param[in] region region
+     * \return perimeter
+     */
+    float getPerimeter(int region) const;
+    
+    /** \brief Get the bounding box of a region, empty for labels not present.
+     * \param[in] region region
+     * \return bounding box
+     */
+    cv::Rect getBoundingBox(int region) const;
+    
+    /** \brief Get the sum of colors of a region; only available if constructed with an image.
+     * \param[in] region region
+     * \return color sum
+     */
+    cv::Vec3d getColorSum(int region) const;
+    
+    /** \brief Get the mean color of a region; only available if constructed with an image.
+     * \param[in] region region
+     * \return mean color
+     */
+    cv::Vec3d getMeanColor(int region) const;
+    
+    /** \brief Get the per-channel color variance of a region; only available
+     * if constructed with an image.
+     * \param[in] region region
+     * \return color variance
+     */
+    cv::Vec3d getColorVariance(int region) const;
+    
+private:
+    /** \brief Build the graph.
+     * \param[in] labels superpixel labels as CV_32SC1
+     * \param[in] image image as CV_8UC3, may be empty
+     */
+    void build(const cv::Mat &labels, const cv::Mat &image);
+    
+    /** \brief Number of regions. */
+    int regions;
+    /** \brief Row offsets. */
+    std::vector<int> offsets;
+    /** \brief Neighbors. */
+    std::vector<int> neighbors;
+    /** \brief Boundary length per edge. */
+    std::vector<int> boundary_lengths;
+    /** \brief Area per region. */
+    std::vector<int> areas;
+    /** \brief Perimeter per region. */
+    std::vector<float> perimeters;
+    /** \brief Bounding box per region. */
+    std::vector<cv::Rect> bounding_boxes;
+    /** \brief Whether color moments are computed. */
+    bool color_moments;
+    /** \brief Sum of colors per region. */
+    std::vector<cv::Vec3d> color_sums;
+    /** \brief Sum of squared colors per region. */
+    std::vector<cv::Vec3d> color_squared_sums;
+};
+
+#endif	/* REGION_ADJACENCY_GRAPH_H */
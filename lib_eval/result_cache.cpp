@@ -0,0 +1,351 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <glog/logging.h>
+#include "io_util.h"
+#include "result_cache.h"
+
+/** \brief Magic bytes at the beginning of each cache entry. */
+static const char RESULT_CACHE_MAGIC[4] = {'S', 'P', 'R', 'C'};
+
+/** \brief FNV-1a offset basis. */
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+/** \brief FNV-1a prime. */
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+/** \brief Update a 64-bit FNV-1a hash.
+ * \param[in] hash current hash
+ * \param[in] data data to hash
+ * \param[in] size number of bytes
+ * \return updated hash
+ */
+static uint64_t updateHash(uint64_t hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= (unsigned char) data[i];
+        hash *= FNV_PRIME;
+    }
+    
+    return hash;
+}
+
+/** \brief Format a hash as hexadecimal string.
+ * \param[in] hash hash
+ * \return hexadecimal string
+ */
+static std::string formatHash(uint64_t hash) {
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long) hash);
+    return std::string(buffer);
+}
+
+/** \brief Write a length-prefixed string.
+ * \param[in] stream stream to write to
+ * \param[in] string string to write
+ */
+static void writeString(std::ostream &stream, const std::string &string) {
+    uint32_t size = string.size();
+    stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    stream.write(string.data(), size);
+}
+
+/** \brief Read a length-prefixed string.
+ * \param[in] stream stream to read from
+ * \param[out] string string read
+ * \return whether the string could be read
+ */
+static bool readString(std::istream &stream, std::string &string) {
+    uint32_t size = 0;
+    stream.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (!stream) {
+        return false;
+    }
+    
+    string.resize(size);
+    if (size > 0) {
+        stream.read(&string[0], size);
+    }
+    
+    return (bool) stream;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+ResultCache::ResultCache(boost::filesystem::path directory_, std::string version_) 
+        : directory(directory_), version(version_) {
+    
+    if (!boost::filesystem::is_directory(directory)) {
+        boost::filesystem::create_directories(directory);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hashFile
+////////////////////////////////////////////////////////////////////////////////
+
+std::string ResultCache::hashFile(const boost::filesystem::path &file) {
+    std::ifstream file_stream(file.c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!file_stream.is_open()) {
+        return "";
+    }
+    
+    uint64_t hash = FNV_OFFSET;
+    std::vector<char> buffer(1 << 16);
+    
+    while (file_stream) {
+        file_stream.read(buffer.data(), buffer.size());
+        hash = updateHash(hash, buffer.data(), file_stream.gcount());
+    }
+    
+    return formatHash(hash);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hashString
+////////////////////////////////////////////////////////////////////////////////
+
+std::string ResultCache::hashString(const std::string &string) {
+    return formatHash(updateHash(FNV_OFFSET, string.data(), string.size()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hashImage
+////////////////////////////////////////////////////////////////////////////////
+
+std::string ResultCache::hashImage(const boost::filesystem::path &img_file, 
+        const boost::filesystem::path &gt_directory) {
+    
+    std::string hashes = hashFile(img_file);
+    
+    std::vector<std::string> label_extensions;
+    IOUtil::getLabelExtensions(label_extensions);
+    
+    // Either a single ground truth or up to five numbered ground truths.
+    for (int t = -1; t < 5; ++t) {
+        std::string stem = img_file.stem().string();
+        if (t >= 0) {
+            stem += "-" + std::to_string(t);
+        }
+        
+        for (unsigned int e = 0; e < label_extensions.size(); ++e) {
+            boost::filesystem::path gt_file = gt_directory / boost::filesystem::path(stem 
+                    + label_extensions[e]);
+            
+            if (boost::filesystem::is_regular_file(gt_file)) {
+                hashes += "\n" + gt_file.filename().string() + ":" + hashFile(gt_file);
+                break;
+            }
+        }
+    }
+    
+    return hashString(hashes);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hashCommandLine
+////////////////////////////////////////////////////////////////////////////////
+
+std::string ResultCache::hashCommandLine(const std::string &command_line) {
+    
+    // Rebuilding the executable invalidates all its entries.
+    boost::filesystem::path executable(command_line.substr(0, command_line.find(' ')));
+    
+    std::string executable_hash;
+    if (boost::filesystem::is_regular_file(executable)) {
+        executable_hash = hashFile(executable);
+    }
+    
+    return hashString(command_line + "\n" + executable_hash);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeKey
+////////////////////////////////////////////////////////////////////////////////
+
+std::string ResultCache::computeKey(const std::string &command_line_hash, 
+        const std::string &image_hash) {
+    
+    return hashString(std::to_string(VERSION) + "\n" + version + "\n" 
+            + command_line_hash + "\n" + image_hash);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getFile
+////////////////////////////////////////////////////////////////////////////////
+
+boost::filesystem::path ResultCache::getFile(const std::string &key) {
+    return directory / boost::filesystem::path(key.substr(0, 2)) 
+            / boost::filesystem::path(key + ".bin");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// read
+////////////////////////////////////////////////////////////////////////////////
+
+bool ResultCache::read(const std::string &key, EvaluationSummary::ImageResult &image_result) {
+    
+    boost::filesystem::path file = getFile(key);
+    std::ifstream file_stream(file.c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!file_stream.is_open()) {
+        return false;
+    }
+    
+    if (!readImageResult(file_stream, image_result)) {
+        LOG(ERROR) << "Invalid cache entry (" << file.string() << ").";
+        return false;
+    }
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// write
+////////////////////////////////////////////////////////////////////////////////
+
+void ResultCache::write(const std::string &key, const EvaluationSummary::ImageResult &image_result) {
+    
+    LOG_IF(FATAL, !image_result.data.empty() && image_result.data.type() != CV_32FC1)
+            << "Only float results can be cached.";
+    
+    boost::filesystem::path file = getFile(key);
+    boost::system::error_code error;
+    boost::filesystem::create_directories(file.parent_path(), error);
+    
+    // Write to a unique temporary file first; renaming is atomic such that
+    // concurrent readers never see partial entries.
+    boost::filesystem::path tmp_file = boost::filesystem::unique_path(
+            file.parent_path() / boost::filesystem::path(key + "-%%%%-%%%%.tmp"));
+    
+    std::ofstream file_stream(tmp_file.c_str(), std::ofstream::out | std::ofstream::binary);
+    if (!file_stream.is_open()) {
+        LOG(ERROR) << "Could not write cache entry (" << file.string() << ").";
+        return;
+    }
+    
+    writeImageResult(file_stream, image_result);
+    
+    bool success = (bool) file_stream;
+    file_stream.close();
+    
+    if (success) {
+        boost::filesystem::rename(tmp_file, file, error);
+        success = !error;
+    }
+    
+    if (!success) {
+        LOG(ERROR) << "Could not write cache entry (" << file.string() << ").";
+        boost::filesystem::remove(tmp_file, error);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readImageResult
+////////////////////////////////////////////////////////////////////////////////
+
+bool ResultCache::readImageResult(std::istream &stream, EvaluationSummary::ImageResult &image_result) {
+    
+    char magic[4];
+    int32_t rows = 0;
+    int32_t cols = 0;
+    uint32_t gt_size = 0;
+    
+    stream.read(magic, sizeof(magic));
+    if (!stream || memcmp(magic, RESULT_CACHE_MAGIC, 4) != 0
+            || !readString(stream, image_result.name)
+            || !readString(stream, image_result.csv)) {
+        return false;
+    }
+    
+    stream.read(reinterpret_cast<char*>(&rows), sizeof(rows));
+    stream.read(reinterpret_cast<char*>(&cols), sizeof(cols));
+    if (!stream || rows < 0 || cols < 0) {
+        return false;
+    }
+    
+    image_result.data = cv::Mat();
+    if (rows > 0 && cols > 0) {
+        image_result.data.create(rows, cols, CV_32FC1);
+        stream.read(image_result.data.ptr<char>(0), rows*cols*sizeof(float));
+    }
+    
+    stream.read(reinterpret_cast<char*>(&gt_size), sizeof(gt_size));
+    if (!stream || gt_size != (uint32_t) rows) {
+        return false;
+    }
+    
+    std::vector<int32_t> gt(gt_size);
+    if (gt_size > 0) {
+        stream.read(reinterpret_cast<char*>(gt.data()), gt_size*sizeof(int32_t));
+    }
+    
+    if (!stream) {
+        return false;
+    }
+    
+    image_result.gt.assign(gt.begin(), gt.end());
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeImageResult
+////////////////////////////////////////////////////////////////////////////////
+
+void ResultCache::writeImageResult(std::ostream &stream, const EvaluationSummary::ImageResult &image_result) {
+    
+    LOG_IF(FATAL, !image_result.data.empty() && image_result.data.type() != CV_32FC1)
+            << "Only float results can be cached.";
+    
+    cv::Mat data = image_result.data.isContinuous() ? image_result.data : image_result.data.clone();
+    int32_t rows = data.rows;
+    int32_t cols = data.cols;
+    uint32_t gt_size = image_result.gt.size();
+    std::vector<int32_t> gt(image_result.gt.begin(), image_result.gt.end());
+    
+    stream.write(RESULT_CACHE_MAGIC, sizeof(RESULT_CACHE_MAGIC));
+    writeString(stream, image_result.name);
+    writeString(stream, image_result.csv);
+    stream.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+    stream.write(reinterpret_cast<const char*>(&cols), sizeof(cols));
+    if (rows > 0 && cols > 0) {
+        stream.write(data.ptr<char>(0), rows*cols*sizeof(float));
+    }
+    stream.write(reinterpret_cast<const char*>(&gt_size), sizeof(gt_size));
+    if (gt_size > 0) {
+        stream.write(reinterpret_cast<const char*>(gt.data()), gt_size*sizeof(int32_t));
+    }
+}
@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RESULT_CACHE_H
+#define	RESULT_CACHE_H
+
+#include <string>
+#include <iostream>
+#include <boost/filesystem.hpp>
+#include "evaluation_summary.h"
+
+/** \brief Persistent, content-addressed cache of per-image evaluation results.
+ * 
+ * Results are stored under a key computed from the command used to compute
+ * the superpixel segmentation (i.e. algorithm and parameters), the contents
+ * of the image and its ground truth segmentations and the code version.
+ * Entries are written atomically, such that the cache can be shared between
+ * threads and processes.
+ * \author David Stutz
+ */
+class ResultCache {
+public:
+    
+    /** \brief Version of the evaluation code; to be increased whenever metrics change. */
+    static const int VERSION = 1;
+    
+    /** \brief Constructor.
+     * \param[in] directory directory to store the cache in, created if necessary
+     * \param[in] version additional version string, e.g. of the algorithms evaluated
+     */
+    ResultCache(boost::filesystem::path directory, std::string version = "");
+    
+    /** \brief Hash the contents of a file.
+     * \param[in] file path to file
+     * \return hash as hexadecimal string, empty if the file cannot be read
+     */
+    static std::string hashFile(const boost::filesystem::path &file);
+    
+    /** \brief Hash a string.
+     * \param[in] string string to hash
+     * \return hash as hexadecimal string
+     */
+    static std::string hashString(const std::string &string);
+    
+    /** \brief Hash an image together with its ground truth segmentations, 
+     * looked up as done by EvaluationSummary.
+     * \param[in] img_file path to image
+     * \param[in] gt_directory directory containing ground truth segmentations
+     * \return hash as hexadecimal string
+     */
+    static std::string hashImage(const boost::filesystem::path &img_file, 
+            const boost::filesystem::path &gt_directory);
+    
+    /** \brief Hash a command line including the executable, i.e. the first 
+     * token of the command line if it is a file.
+     * \param[in] command_line command line
+     * \return hash as hexadecimal string
+     */
+    static std::string hashCommandLine(const std::string &command_line);
+    
+    /** \brief Compute the key of an entry.
+     * \param[in] command_line_hash hash of the command line, see hashCommandLine
+     * \param[in] image_hash hash of image and ground truth, see hashImage
+     * \return key
+     */
+    std::string computeKey(const std::string &command_line_hash, 
+            const std::string &image_hash);
+    
+    /** \brief Read an entry.
+     * \param[in] key key of the entry
+     * \param[out] image_result cached results
+     * \return whether the entry was found
+     */
+    bool read(const std::string &key, EvaluationSummary::ImageResult &image_result);
+    
+    /** \brief Write an entry, replacing existing entries.
+     * \param[in] key key of the entry
+     * \param[in] image_result results to cache
+     */
+    void write(const std::string &key, const EvaluationSummary::ImageResult &image_result);
+    
+    /** \brief Read results in the format of cache entries from a stream, 
+     * e.g. a checkpoint file of EvaluationSummary.
+     * \param[in] stream stream to read from
+     * \param[out] image_result results read
+     * \return whether complete and valid results were read
+     */
+    static bool readImageResult(std::istream &stream, EvaluationSummary::ImageResult &image_result);
+    
+    /** \brief Write results in the format of cache entries to a stream.
+     * \param[in] stream stream to write to
+     * \param[in] image_result results to write
+     */
+    static void writeImageResult(std::ostream &stream, const EvaluationSummary::ImageResult &image_result);
+    
+private:
+    
+    /** \brief Get the file of an entry.
+     * \param[in] key key of the entry
+     * \return path to file
+     */
+    boost::filesystem::path getFile(const std::string &key);
+    
+    /** \brief Directory of the cache. */
+    boost::filesystem::path directory;
+    /** \brief Additional version string. */
+    std::string version;
+    
+};
+
+#endif	/* RESULT_CACHE_H */
+
@@ -29,7 +29,11 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <map>
 #include <fstream>
+#include <thread>
+#include <atomic>
+#include <functional>
 #include <glog/logging.h>
 #include "transformation.h"
 #include "io_util.h"
@@ -42,7 +46,7 @@
 
 RobustnessTool::RobustnessTool(boost::filesystem::path& base_directory_, boost::filesystem::path& image_directory_, 
         boost::filesystem::path& gt_directory_, std::string command_line_, RobustnessToolDriver* driver_) : base_directory(base_directory_),
-        image_directory(image_directory_), gt_directory(gt_directory_), command_line(command_line_), driver(driver_) {
+        image_directory(image_directory_), gt_directory(gt_directory_), command_line(command_line_), driver(driver_), result_cache(NULL), threads(1) {
     
     
 }
@@ -55,6 +59,35 @@ void RobustnessTool::setFilesToKeep(const std::vector<std::string> &files_) {
     files = files_;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// RobustnessTool::setResultCache
+////////////////////////////////////////////////////////////////////////////////
+
+void RobustnessTool::setResultCache(ResultCache* result_cache_) {
+    result_cache = result_cache_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RobustnessTool::setThreads
+////////////////////////////////////////////////////////////////////////////////
+
+void RobustnessTool::setThreads(int threads_) {
+    LOG_IF(FATAL, threads_ <= 0) << "Number of threads needs to be positive.";
+    threads = threads_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RobustnessTool::setTransformationCache
+////////////////////////////////////////////////////////////////////////////////
+
+void RobustnessTool::setTransformationCache(boost::filesystem::path cache_directory) {
+    transformation_cache_directory = cache_directory;
+    
+    if (!boost::filesystem::is_directory(transformation_cache_directory)) {
+        boost::filesystem::create_directories(transformation_cache_directory);
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // RobustnessTool::evaluate
 ////////////////////////////////////////////////////////////////////////////////
@@ -74,119 +107,332 @@ void RobustnessTool::evaluate() {
     boost::filesystem::path append_file = base_directory 
             / boost::filesystem::path("summary.csv");
     
+    // The images are listed once for all transformations.
+    std::multimap<std::string, boost::filesystem::path> image_map;
+    IOUtil::readDirectory(image_directory, image_extensions, image_map);
+    
+    std::vector<boost::filesystem::path> images;
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = image_map.begin(); 
+            it != image_map.end(); it++) {
+        images.push_back(boost::filesystem::path(it->first));
+    }
+    
+    // Transformations are only shared for identical images and ground truths.
+    if (!transformation_cache_directory.empty()) {
+        std::string hashes;
+        for (unsigned int i = 0; i < images.size(); ++i) {
+            hashes += images[i].filename().string() + " " 
+                    + ResultCache::hashImage(images[i], gt_directory) + "\n";
+        }
+        
+        dataset_hash = ResultCache::hashString(hashes);
+    }
+    
     int k = 0;
-    do {
-        boost::filesystem::path current_directory = base_directory
-                / boost::filesystem::path(std::to_string(k) + "_" + driver->identify());
+    Step step;
+    transform(k, images, step);
+    
+    while (true) {
+        bool has_next = driver->next();
         
-        if (!boost::filesystem::is_directory(current_directory)) {
-            boost::filesystem::create_directories(current_directory);
+        // The algorithm only reads the directories of the current step, so
+        // the next transformation can be written meanwhile.
+        Step next_step;
+        if (has_next && threads > 1) {
+            std::thread worker([&]() {
+                transform(k + 1, images, next_step);
+            });
+            
+            run(step, append_file);
+            worker.join();
         }
-        
-        boost::filesystem::path current_image_directory = current_directory
-                / boost::filesystem::path("images");
-        if (!boost::filesystem::is_directory(current_image_directory)) {
-            boost::filesystem::create_directories(current_image_directory);
+        else {
+            run(step, append_file);
+            
+            if (has_next) {
+                transform(k + 1, images, next_step);
+            }
         }
         
-        boost::filesystem::path current_segmentation_directory = current_directory
-                / boost::filesystem::path("csv_groundTruth");
-        if (!boost::filesystem::is_directory(current_segmentation_directory)) {
-            boost::filesystem::create_directories(current_segmentation_directory);
+        if (!has_next) {
+            break;
         }
         
-        boost::filesystem::path current_superpixel_directory = current_directory
-                / boost::filesystem::path("sp");
-        if (!boost::filesystem::is_directory(current_superpixel_directory)) {
-            boost::filesystem::create_directories(current_superpixel_directory);
+        step = next_step;
+        k++;
+    }
+    
+    std::cout << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RobustnessTool::transform
+////////////////////////////////////////////////////////////////////////////////
+
+void RobustnessTool::transform(int k, const std::vector<boost::filesystem::path> &images, 
+        Step &step) {
+    
+    step.directory = base_directory
+            / boost::filesystem::path(std::to_string(k) + "_" + driver->identify());
+    
+    if (!boost::filesystem::is_directory(step.directory)) {
+        boost::filesystem::create_directories(step.directory);
+    }
+    
+    step.superpixel_directory = step.directory
+            / boost::filesystem::path("sp");
+    if (!boost::filesystem::is_directory(step.superpixel_directory)) {
+        boost::filesystem::create_directories(step.superpixel_directory);
+    }
+    
+    step.cached = !transformation_cache_directory.empty();
+    
+    boost::filesystem::path directory = step.directory;
+    if (step.cached) {
+        std::string identifier = driver->identify();
+        directory = transformation_cache_directory / boost::filesystem::path(identifier 
+                + "_" + ResultCache::hashString(dataset_hash + "\n" + identifier).substr(0, 16));
+    }
+    
+    step.image_directory = directory / boost::filesystem::path("images");
+    step.segmentation_directory = directory / boost::filesystem::path("csv_groundTruth");
+    
+    if (step.cached && boost::filesystem::is_directory(directory)) {
+        return;
+    }
+    
+    // Cached transformations are written to a temporary directory first such
+    // that concurrent runs never see incomplete transformations.
+    boost::filesystem::path write_directory = directory;
+    if (step.cached) {
+        write_directory = transformation_cache_directory / boost::filesystem::unique_path(
+                directory.filename().string() + "-%%%%%%%%");
+    }
+    
+    boost::filesystem::path image_directory = write_directory / boost::filesystem::path("images");
+    if (!boost::filesystem::is_directory(image_directory)) {
+        boost::filesystem::create_directories(image_directory);
+    }
+    
+    boost::filesystem::path segmentation_directory = write_directory 
+            / boost::filesystem::path("csv_groundTruth");
+    if (!boost::filesystem::is_directory(segmentation_directory)) {
+        boost::filesystem::create_directories(segmentation_directory);
+    }
+    
+    write(images, image_directory, segmentation_directory);
+    
+    if (step.cached) {
+        boost::system::error_code error;
+        boost::filesystem::rename(write_directory, directory, error);
+        
+        // Another run finished the same transformation first.
+        if (error) {
+            boost::filesystem::remove_all(write_directory);
         }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RobustnessTool::write
+////////////////////////////////////////////////////////////////////////////////
+
+void RobustnessTool::write(const std::vector<boost::filesystem::path> &images, 
+        const boost::filesystem::path &image_directory,
+        const boost::filesystem::path &segmentation_directory) {
+    
+    // Each image and its ground truths are read, transformed and written
+    // independently.
+    int n = images.size();
+    std::function<void(int)> process = [&](int i) {
+        cv::Mat image = cv::imread(images[i].string());
         
-        std::multimap<std::string, boost::filesystem::path> images;
-        IOUtil::readDirectory(image_directory, image_extensions, images);
+        bool multiple_segmentations = false;
+        boost::filesystem::path segmentation_file = gt_directory 
+                / boost::filesystem::path(images[i].stem().string() + ".csv");
         
-        for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
-                it != images.end(); it++) {
+        if (!boost::filesystem::is_regular_file(segmentation_file)) {
+            segmentation_file = gt_directory 
+                / boost::filesystem::path(images[i].stem().string() + "-0.csv");
             
-            cv::Mat image = cv::imread(it->first);
-            
-            bool multiple_segmentations = false;
-            boost::filesystem::path segmentation_file = gt_directory 
-                    / boost::filesystem::path(it->second.stem().string() + ".csv");
-            
-            if (!boost::filesystem::is_regular_file(segmentation_file)) {
-                segmentation_file = gt_directory 
-                    / boost::filesystem::path(it->second.stem().string() + "-0.csv");
+            LOG_IF(FATAL, !boost::filesystem::is_regular_file(segmentation_file)) << "Segmentation file not found for: " << images[i].string();
+            multiple_segmentations = true;
+        }
+        
+        if (multiple_segmentations) {
+            int j = 0;
+            while (boost::filesystem::is_regular_file(segmentation_file)) {
                 
-                LOG_IF(FATAL, !boost::filesystem::is_regular_file(segmentation_file)) << "Segmentation file not found for: " << it->first;
-                multiple_segmentations = true;
-            }
-            
-            if (multiple_segmentations) {
-                int i = 0;
-                while (boost::filesystem::is_regular_file(segmentation_file)) {
-                    
-                    cv::Mat segmentation;
-                    IOUtil::readMatCSVInt(segmentation_file, segmentation);
-                    
-                    cv::Mat computed_segmentation;
-                    driver->computeSegmentation(segmentation, computed_segmentation);
-                    
-                    boost::filesystem::path computed_segmentation_file = current_segmentation_directory
-                            / boost::filesystem::path(it->second.stem().string() + "-" + std::to_string(i) + ".csv");
-                    IOUtil::writeMatCSV<int>(computed_segmentation_file, computed_segmentation);
-                    
-                    i++;
-                    segmentation_file = gt_directory 
-                    / boost::filesystem::path(it->second.stem().string() + "-" + std::to_string(i) + ".csv");
-                }
-            }
-            else {
                 cv::Mat segmentation;
                 IOUtil::readMatCSVInt(segmentation_file, segmentation);
-
+                
                 cv::Mat computed_segmentation;
                 driver->computeSegmentation(segmentation, computed_segmentation);
-
-                boost::filesystem::path computed_segmentation_file = current_segmentation_directory
-                        / boost::filesystem::path(it->second.stem().string() + ".csv");
+                
+                boost::filesystem::path computed_segmentation_file = segmentation_directory
+                        / boost::filesystem::path(images[i].stem().string() + "-" + std::to_string(j) + ".csv");
                 IOUtil::writeMatCSV<int>(computed_segmentation_file, computed_segmentation);
+                
+                j++;
+                segmentation_file = gt_directory 
+                        / boost::filesystem::path(images[i].stem().string() + "-" + std::to_string(j) + ".csv");
             }
+        }
+        else {
+            cv::Mat segmentation;
+            IOUtil::readMatCSVInt(segmentation_file, segmentation);
+
+            cv::Mat computed_segmentation;
+            driver->computeSegmentation(segmentation, computed_segmentation);
+
+            boost::filesystem::path computed_segmentation_file = segmentation_directory
+                    / boost::filesystem::path(images[i].stem().string() + ".csv");
+            IOUtil::writeMatCSV<int>(computed_segmentation_file, computed_segmentation);
+        }
+        
+        cv::Mat computed_image;
+        driver->computeImage(image, computed_image);
+        
+        boost::filesystem::path computed_image_file = image_directory
+                / images[i].filename();
+        cv::imwrite(computed_image_file.string(), computed_image);
+    };
+    
+    int n_threads = std::max(1, std::min(threads, n));
+    if (n_threads <= 1) {
+        for (int i = 0; i < n; ++i) {
+            process(i);
+        }
+    }
+    else {
+        std::atomic<int> next(0);
+        std::vector<std::thread> workers;
+        
+        for (int t = 0; t < n_threads; ++t) {
+            workers.push_back(std::thread([&]() {
+                for (int i = next++; i < n; i = next++) {
+                    process(i);
+                }
+            }));
+        }
+        
+        for (unsigned int t = 0; t < workers.size(); ++t) {
+            workers[t].join();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RobustnessTool::run
+////////////////////////////////////////////////////////////////////////////////
+
+void RobustnessTool::run(const Step &step, const boost::filesystem::path &append_file) {
+    
+    std::vector<std::string> image_extensions;
+    IOUtil::getImageExtensions(image_extensions);
+    
+    // Look up the transformed images in the cache; the algorithm is only
+    // run on the remaining images, copied to a separate directory.
+    std::vector<EvaluationSummary::ImageResult> cached_results;
+    std::map<std::string, std::string> keys;
+    boost::filesystem::path current_run_directory = step.image_directory;
+    
+    if (result_cache != NULL) {
+        std::string command_line_hash = ResultCache::hashString(
+                ResultCache::hashCommandLine(command_line) + "\nrobustness");
+        
+        std::multimap<std::string, boost::filesystem::path> current_images;
+        IOUtil::readDirectory(step.image_directory, image_extensions, current_images);
+        
+        std::vector<boost::filesystem::path> missing_files;
+        for (std::multimap<std::string, boost::filesystem::path>::iterator it = current_images.begin(); 
+                it != current_images.end(); it++) {
             
-            cv::Mat computed_image;
-            driver->computeImage(image, computed_image);
+            std::string key = result_cache->computeKey(command_line_hash, 
+                    ResultCache::hashImage(it->second, step.segmentation_directory));
             
-            boost::filesystem::path computed_image_file = current_image_directory
-                    / it->second.filename();
-            cv::imwrite(computed_image_file.string(), computed_image);
+            EvaluationSummary::ImageResult image_result;
+            if (result_cache->read(key, image_result)) {
+                cached_results.push_back(image_result);
+            }
+            else {
+                keys[it->second.stem().string()] = key;
+                missing_files.push_back(it->second);
+            }
         }
         
+        if (!cached_results.empty()) {
+            current_run_directory = step.directory
+                    / boost::filesystem::path("missing");
+            if (!boost::filesystem::is_directory(current_run_directory)) {
+                boost::filesystem::create_directories(current_run_directory);
+            }
+            
+            for (unsigned int m = 0; m < missing_files.size(); ++m) {
+                boost::filesystem::copy_file(missing_files[m], 
+                        current_run_directory / missing_files[m].filename());
+            }
+        }
+    }
+    
+    if (result_cache == NULL || !keys.empty()) {
         std::string current_command_line = command_line 
-                + " -i " + current_image_directory.string() 
-                + " -o " + current_superpixel_directory.string();
-        
+                + " -i " + current_run_directory.string() 
+                + " -o " + step.superpixel_directory.string();
+
         int status = system(current_command_line.c_str());
-        
+
         if (status != 0) {
             LOG(FATAL) << "Command line was not successful: " << current_command_line;
         }
+    }
+    
+    EvaluationSummary summary(step.superpixel_directory, 
+            step.segmentation_directory, step.image_directory);
+    summary.setComputeCorrelation(true);
+    summary.setAppendFile(append_file);
+    summary.setEvaluationMemo(&evaluation_memo);
+    summary.setThreads(threads);
+    
+    for (unsigned int m = 0; m < cached_results.size(); ++m) {
+        summary.addImageResult(cached_results[m]);
+    }
+    
+    int gt_max = 0;
+    summary.computeSummary(gt_max);
+    
+    if (result_cache != NULL) {
+        std::vector<EvaluationSummary::ImageResult> image_results;
+        summary.getImageResults(image_results);
         
-        EvaluationSummary summary(current_superpixel_directory, 
-                current_segmentation_directory, current_image_directory);
-        summary.setComputeCorrelation(true);
-        summary.setAppendFile(append_file);
-        
-        int gt_max = 0;
-        summary.computeSummary(gt_max);
-        
-        cleanDirectory(current_segmentation_directory);
-        cleanDirectory(current_image_directory);
-        cleanDirectory(current_superpixel_directory);
+        for (unsigned int m = 0; m < image_results.size(); ++m) {
+            std::map<std::string, std::string>::const_iterator key = keys.find(
+                    boost::filesystem::path(image_results[m].name).stem().string());
+            
+            if (key != keys.end()) {
+                result_cache->write(key->second, image_results[m]);
+            }
+        }
         
-        std::cout << ".";
-        k++;
-    } while(driver->next());
+        if (current_run_directory != step.image_directory) {
+            boost::filesystem::remove_all(current_run_directory);
+        }
+    }
     
-    std::cout << std::endl;
+    if (step.cached) {
+        copyFilesToKeep(step.segmentation_directory, step.directory 
+                / boost::filesystem::path("csv_groundTruth"));
+        copyFilesToKeep(step.image_directory, step.directory 
+                / boost::filesystem::path("images"));
+    }
+    else {
+        cleanDirectory(step.segmentation_directory);
+        cleanDirectory(step.image_directory);
+    }
+    
+    cleanDirectory(step.superpixel_directory);
+    
+    std::cout << ".";
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -224,6 +470,36 @@ void RobustnessTool::cleanDirectory(boost::filesystem::path directory) {
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// RobustnessTool::copyFilesToKeep
+////////////////////////////////////////////////////////////////////////////////
+
+void RobustnessTool::copyFilesToKeep(boost::filesystem::path directory, 
+        boost::filesystem::path target_directory) {
+    
+    if (files.empty()) {
+        return;
+    }
+    
+    if (!boost::filesystem::is_directory(target_directory)) {
+        boost::filesystem::create_directories(target_directory);
+    }
+    
+    boost::filesystem::directory_iterator end;
+    for (boost::filesystem::directory_iterator it(directory); it != end; it++) {
+        for (unsigned int i = 0; i < files.size(); i++) {
+            if (it->path().stem().string().find(files[i]) != std::string::npos) {
+                // Cached files never change, so existing copies are up to date.
+                boost::filesystem::path target_file = target_directory / it->path().filename();
+                if (!boost::filesystem::exists(target_file)) {
+                    boost::filesystem::copy_file(it->path(), target_file);
+                }
+                break;
+            }
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // GaussianNoiseDriver::GaussianNoiseDriver
 ////////////////////////////////////////////////////////////////////////////////
@@ -275,7 +551,7 @@ bool GaussianNoiseDriver::next() {
 ////////////////////////////////////////////////////////////////////////////////
 
 std::string GaussianNoiseDriver::identify() {
-    return "gaussian_additive_" + std::to_string(variances[current]);
+    return "gaussian_" + type + "_" + std::to_string(variances[current]);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -34,6 +34,8 @@
 
 #include <boost/filesystem.hpp>
 #include <opencv2/opencv.hpp>
+#include "result_cache.h"
+#include "evaluation_memo.h"
 
 /** \brief Driver for different filters/enhancements/transformations.
  * \author David Stutz
@@ -58,6 +60,11 @@ public:
     virtual bool next() = 0;
     
     /** \brief Identify current parameter settings.
+     * 
+     * The identifier needs to determine the transformation, including the
+     * driver and all parameters, as it is used to share transformed images
+     * across runs, see RobustnessTool::setTransformationCache.
+     * 
      * \return identifier for current parameter setting
      */
     virtual std::string identify() = 0;
@@ -85,17 +92,97 @@ public:
      */
     void setFilesToKeep(const std::vector<std::string> &files);
     
+    /** \brief Use a persistent cache of per-image results.
+     * 
+     * The results of each transformed image are looked up in the cache before
+     * running the algorithm, which is only run on images without cached results.
+     * Note that runtime.txt then only reflects the images actually segmented.
+     * 
+     * \param[in] result_cache cache to use, needs to outlive the tool
+     */
+    void setResultCache(ResultCache* result_cache);
+    
+    /** \brief Set the number of threads.
+     * 
+     * Images are transformed and written in parallel, and the images of the
+     * next transformation are prepared while the algorithm runs on the current
+     * ones. The driver's computeImage and computeSegmentation are called
+     * concurrently and must not modify the driver.
+     * 
+     * \param[in] threads number of threads, 1 for sequential evaluation
+     */
+    void setThreads(int threads);
+    
+    /** \brief Share transformed images and ground truths across runs.
+     * 
+     * The transformed images and ground truths are written once to a
+     * subdirectory of the cache directory, keyed by the contents of the
+     * dataset and the driver's identifier, and reused by all subsequent
+     * robustness evaluations, e.g. of other algorithms. All noise is drawn
+     * with a fixed seed, see Transformation, such that cached transformations
+     * are reproducible. Files to keep are copied from the cache.
+     * 
+     * \param[in] cache_directory directory to cache transformations in, created if necessary
+     */
+    void setTransformationCache(boost::filesystem::path cache_directory);
+    
     /** \brief Evaluate.
      */
     void evaluate();
     
 private:
     
+    /** \brief Directories of a single transformation. */
+    struct Step {
+        /** \brief Directory of the transformation. */
+        boost::filesystem::path directory;
+        /** \brief Transformed images. */
+        boost::filesystem::path image_directory;
+        /** \brief Transformed ground truth segmentations. */
+        boost::filesystem::path segmentation_directory;
+        /** \brief Superpixel segmentations of the transformed images. */
+        boost::filesystem::path superpixel_directory;
+        /** \brief Whether images and ground truths are taken from the transformation cache. */
+        bool cached;
+    };
+    
+    /** \brief Prepare the transformed images and ground truths for the current
+     * parameters of the driver, from the transformation cache if set.
+     * \param[in] k index of the transformation
+     * \param[in] images images to transform
+     * \param[out] step directories of the transformation
+     */
+    void transform(int k, const std::vector<boost::filesystem::path> &images, 
+            Step &step);
+    
+    /** \brief Write the transformed images and ground truths for the current
+     * parameters of the driver.
+     * \param[in] images images to transform
+     * \param[in] image_directory directory to write transformed images to
+     * \param[in] segmentation_directory directory to write transformed ground truths to
+     */
+    void write(const std::vector<boost::filesystem::path> &images, 
+            const boost::filesystem::path &image_directory,
+            const boost::filesystem::path &segmentation_directory);
+    
+    /** \brief Run the algorithm on and evaluate a transformation.
+     * \param[in] step directories of the transformation
+     * \param[in] append_file summary file to append the results to
+     */
+    void run(const Step &step, const boost::filesystem::path &append_file);
+    
     /** \brief Clean the given directory.
      * \param[in] directory directory to clean up
      */
     void cleanDirectory(boost::filesystem::path directory);
     
+    /** \brief Copy the files to keep, see setFilesToKeep.
+     * \param[in] directory directory to copy from
+     * \param[in] target_directory directory to copy to
+     */
+    void copyFilesToKeep(boost::filesystem::path directory, 
+            boost::filesystem::path target_directory);
+    
     /** \brief Base directory to evaluate in. */
     boost::filesystem::path base_directory;
     /** \brief Directory containing images. */
@@ -112,6 +199,17 @@ private:
     /** \brief Names of the files to keep. */
     std::vector<std::string> files;
     
+    /** \brief Result cache, if set. */
+    ResultCache* result_cache;
+    /** \brief Memo of evaluation results shared by all transformations. */
+    EvaluationMemo evaluation_memo;
+    /** \brief Number of threads. */
+    int threads;
+    /** \brief Directory to cache transformations in, if set. */
+    boost::filesystem::path transformation_cache_directory;
+    /** \brief Hash of images and ground truths, computed by evaluate if the transformation cache is set. */
+    std::string dataset_hash;
+    
 };
 
 /** \brief Additive Gaussian noise and Gaussian sampling error driver.
@@ -0,0 +1,254 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "runtime_harness.h"
+
+/** \brief Read a field given in kB from /proc/self/status.
+ * \param[in] field name of the field including the colon, e.g. "VmRSS:"
+ * \return value in KiB, -1 if not available
+ */
+static long readStatusField(const std::string &field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size(), field) == 0) {
+            std::istringstream stream(line.substr(field.size()));
+            long value = -1;
+            stream >> value;
+            return value;
+        }
+    }
+    
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Timer::Timer
+////////////////////////////////////////////////////////////////////////////////
+
+RuntimeHarness::Timer::Timer() 
+        : start(std::chrono::steady_clock::now()) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Timer::restart
+////////////////////////////////////////////////////////////////////////////////
+
+void RuntimeHarness::Timer::restart() {
+    start = std::chrono::steady_clock::now();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Timer::elapsed
+////////////////////////////////////////////////////////////////////////////////
+
+double RuntimeHarness::Timer::elapsed() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+RuntimeHarness::RuntimeHarness(int warmup, int repetitions) 
+        : warmup(std::max(0, warmup)), repetitions(std::max(1, repetitions)) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// measure
+////////////////////////////////////////////////////////////////////////////////
+
+RuntimeHarness::Record RuntimeHarness::measure(const std::string &name, 
+        const std::function<void()> &function) {
+    
+    for (int i = 0; i < warmup; ++i) {
+        function();
+    }
+    
+    Record record;
+    record.name = name;
+    record.rss = getRSS();
+    
+    bool reset = resetPeakRSS();
+    for (int i = 0; i < repetitions; ++i) {
+        Timer timer;
+        function();
+        record.times.push_back(timer.elapsed());
+    }
+    
+    // Without reset, the peak may stem from earlier measurements.
+    record.peak_rss = reset ? getPeakRSS() : -1;
+    
+    summarize(record.times, record.min, record.median, record.p95);
+    records.push_back(record);
+    
+    return record;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getRecords
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<RuntimeHarness::Record>& RuntimeHarness::getRecords() const {
+    return records;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeRecords
+////////////////////////////////////////////////////////////////////////////////
+
+bool RuntimeHarness::writeRecords(const boost::filesystem::path &file, 
+        const std::vector<Record> &records) {
+    
+    std::ofstream stream(file.string());
+    if (!stream.is_open()) {
+        return false;
+    }
+    
+    stream << "name,repetitions,min,median,p95,rss,peak_rss\n";
+    for (unsigned int i = 0; i < records.size(); ++i) {
+        stream << records[i].name << "," << records[i].times.size() << "," 
+                << records[i].min << "," << records[i].median << "," 
+                << records[i].p95 << "," << records[i].rss << "," 
+                << records[i].peak_rss << "\n";
+    }
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// summarize
+////////////////////////////////////////////////////////////////////////////////
+
+void RuntimeHarness::summarize(const std::vector<double> &times, double &min,
+        double &median, double &p95) {
+    
+    min = 0;
+    median = 0;
+    p95 = 0;
+    
+    if (times.empty()) {
+        return;
+    }
+    
+    std::vector<double> sorted(times);
+    std::sort(sorted.begin(), sorted.end());
+    
+    int n = sorted.size();
+    min = sorted[0];
+    median = (n % 2 == 1) ? sorted[n/2] : 0.5*(sorted[n/2 - 1] + sorted[n/2]);
+    
+    int rank = (int) std::ceil(0.95*n);
+    p95 = sorted[std::max(0, std::min(n - 1, rank - 1))];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// pinThread
+////////////////////////////////////////////////////////////////////////////////
+
+bool RuntimeHarness::pinThread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getRSS
+////////////////////////////////////////////////////////////////////////////////
+
+long RuntimeHarness::getRSS() {
+    return readStatusField("VmRSS:");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getPeakRSS
+////////////////////////////////////////////////////////////////////////////////
+
+long RuntimeHarness::getPeakRSS() {
+    long peak = readStatusField("VmHWM:");
+    if (peak >= 0) {
+        return peak;
+    }
+    
+    // ru_maxrss is given in KiB on Linux, but in bytes on Mac OS.
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+    
+#ifdef __APPLE__
+    return usage.ru_maxrss/1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// resetPeakRSS
+////////////////////////////////////////////////////////////////////////////////
+
+bool RuntimeHarness::resetPeakRSS() {
+#ifdef __linux__
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (!clear_refs.is_open()) {
+        return false;
+    }
+    
+    clear_refs << "5";
+    clear_refs.close();
+    
+    return !clear_refs.fail();
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUNTIME_HARNESS_H
+#define	RUNTIME_HARNESS_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+#include <boost/filesystem.hpp>
+
+/** \brief Runtime measurement with warm-up, repetitions and memory sampling.
+ * 
+ * Each measurement runs the function warmup times without timing (e.g. to 
+ * fault in pages and warm caches), then repetitions times measuring wall time.
+ * The resident set size is sampled before the first timed run, the peak
+ * resident set size is measured over the timed runs; on Linux, the peak is
+ * reset before each measurement such that it refers to the measured function
+ * only. Memory is process-wide, i.e. only meaningful if a single thread
+ * measures at a time.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   RuntimeHarness harness(1, 5);
+ *   RuntimeHarness::Record record = harness.measure("image", [&]() {
+ *       SLIC_OpenCV::computeSuperpixels(image, region_size, ..., labels);
+ *   });
+ *   std::cout << record.median << " " << record.p95 << std::endl;
+ *   RuntimeHarness::writeRecords("runtime.csv", harness.getRecords());
+ * \endcode
+ * \author David Stutz
+ */
+class RuntimeHarness {
+public:
+    
+    /** \brief Timings and memory of a single measurement. */
+    struct Record {
+        /** \brief Name of the measurement, e.g. the image. */
+        std::string name;
+        /** \brief Wall time of each timed repetition in seconds. */
+        std::vector<double> times;
+        /** \brief Minimum time. */
+        double min;
+        /** \brief Median time. */
+        double median;
+        /** \brief 95th percentile of the time (nearest rank). */
+        double p95;
+        /** \brief Resident set size before the timed repetitions in KiB, -1 if unknown. */
+        long rss;
+        /** \brief Peak resident set size during the timed repetitions in KiB, -1 if unknown. */
+        long peak_rss;
+    };
+    
+    /** \brief Wall clock timer with the interface of boost::timer; boost::timer
+     * measures CPU time, which adds up the time of all threads.
+     */
+    class Timer {
+    public:
+        
+        /** \brief Constructor, starts the timer. */
+        Timer();
+        
+        /** \brief Restart the timer. */
+        void restart();
+        
+        /** \brief Get the time since construction or the last restart.
+         * \return elapsed wall time in seconds
+         */
+        double elapsed() const;
+        
+    private:
+        
+        /** \brief Start time. */
+        std::chrono::steady_clock::time_point start;
+        
+    };
+    
+    /** \brief Constructor.
+     * \param[in] warmup number of untimed runs before the timed ones
+     * \param[in] repetitions number of timed runs, at least one
+     */
+    RuntimeHarness(int warmup = 0, int repetitions = 1);
+    
+    /** \brief Measure the given function.
+     * \param[in] name name of the measurement
+     * \param[in] function function to measure
+     * \return record of the measurement, also kept for getRecords
+     */
+    Record measure(const std::string &name, const std::function<void()> &function);
+    
+    /** \brief Get all records measured so far.
+     * \return records
+     */
+    const std::vector<Record>& getRecords() const;
+    
+    /** \brief Write records as CSV file with one line per measurement.
+     * \param[in] file CSV file to write
+     * \param[in] records records to write, e.g. gathered from several harnesses
+     * \return whether the file could be written
+     */
+    static bool writeRecords(const boost::filesystem::path &file, 
+            const std::vector<Record> &records);
+    
+    /** \brief Compute min, median and 95th percentile of the given times.
+     * \param[in] times times
+     * \param[out] min minimum
+     * \param[out] median median
+     * \param[out] p95 95th percentile
+     */
+    static void summarize(const std::vector<double> &times, double &min,
+            double &median, double &p95);
+    
+    /** \brief Pin the calling thread to the given CPU; only supported on Linux.
+     * \param[in] cpu index of CPU
+     * \return whether the thread was pinned
+     */
+    static bool pinThread(int cpu);
+    
+    /** \brief Current resident set size of the process.
+     * \return resident set size in KiB, -1 if unknown
+     */
+    static long getRSS();
+    
+    /** \brief Peak resident set size of the process since start or the last
+     * call to resetPeakRSS.
+     * \return peak resident set size in KiB, -1 if unknown
+     */
+    static long getPeakRSS();
+    
+    /** \brief Reset the peak resident set size to the current one, requires
+     * Linux 4.0 or later.
+     * \return whether the peak was reset
+     */
+    static bool resetPeakRSS();
+    
+private:
+    
+    /** \brief Number of untimed runs. */
+    int warmup;
+    /** \brief Number of timed runs. */
+    int repetitions;
+    /** \brief Records of all measurements. */
+    std::vector<Record> records;
+    
+};
+
+#endif	/* RUNTIME_HARNESS_H */
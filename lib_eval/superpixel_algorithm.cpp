@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include "superpixel_algorithm.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// parseParameters
+////////////////////////////////////////////////////////////////////////////////
+
+SuperpixelAlgorithm::Parameters SuperpixelAlgorithm::parseParameters(
+        const std::string &string) {
+    
+    std::vector<std::string> entries;
+    boost::split(entries, string, boost::is_any_of(","));
+    
+    Parameters parameters;
+    for (unsigned int i = 0; i < entries.size(); ++i) {
+        std::string entry = boost::trim_copy(entries[i]);
+        if (entry.empty()) {
+            continue;
+        }
+        
+        size_t position = entry.find('=');
+        if (position == std::string::npos) {
+            parameters[entry] = "1";
+        }
+        else {
+            parameters[boost::trim_copy(entry.substr(0, position))] 
+                    = boost::trim_copy(entry.substr(position + 1));
+        }
+    }
+    
+    return parameters;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getInt
+////////////////////////////////////////////////////////////////////////////////
+
+int SuperpixelAlgorithm::getInt(const Parameters &parameters, 
+        const std::string &name, int value) {
+    
+    Parameters::const_iterator it = parameters.find(name);
+    if (it == parameters.end()) {
+        return value;
+    }
+    
+    return boost::lexical_cast<int>(it->second);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getDouble
+////////////////////////////////////////////////////////////////////////////////
+
+double SuperpixelAlgorithm::getDouble(const Parameters &parameters, 
+        const std::string &name, double value) {
+    
+    Parameters::const_iterator it = parameters.find(name);
+    if (it == parameters.end()) {
+        return value;
+    }
+    
+    return boost::lexical_cast<double>(it->second);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getBool
+////////////////////////////////////////////////////////////////////////////////
+
+bool SuperpixelAlgorithm::getBool(const Parameters &parameters, 
+        const std::string &name, bool value) {
+    
+    return getInt(parameters, name, value ? 1 : 0) > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SuperpixelAlgorithmRegistry::factories
+////////////////////////////////////////////////////////////////////////////////
+
+std::map<std::string, SuperpixelAlgorithmRegistry::Factory>& 
+        SuperpixelAlgorithmRegistry::factories() {
+    
+    static std::map<std::string, Factory> factories;
+    return factories;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SuperpixelAlgorithmRegistry::add
+////////////////////////////////////////////////////////////////////////////////
+
+void SuperpixelAlgorithmRegistry::add(const std::string &name, Factory factory) {
+    factories()[name] = factory;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SuperpixelAlgorithmRegistry::create
+////////////////////////////////////////////////////////////////////////////////
+
+SuperpixelAlgorithm* SuperpixelAlgorithmRegistry::create(const std::string &name, 
+        const SuperpixelAlgorithm::Parameters &parameters) {
+    
+    std::map<std::string, Factory>::iterator it = factories().find(name);
+    if (it == factories().end()) {
+        return NULL;
+    }
+    
+    return it->second(parameters);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SuperpixelAlgorithmRegistry::has
+////////////////////////////////////////////////////////////////////////////////
+
+bool SuperpixelAlgorithmRegistry::has(const std::string &name) {
+    return factories().find(name) != factories().end();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SuperpixelAlgorithmRegistry::list
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> SuperpixelAlgorithmRegistry::list() {
+    std::vector<std::string> names;
+    for (std::map<std::string, Factory>::iterator it = factories().begin();
+            it != factories().end(); ++it) {
+        names.push_back(it->first);
+    }
+    
+    return names;
+}
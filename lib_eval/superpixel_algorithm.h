@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SUPERPIXEL_ALGORITHM_H
+#define	SUPERPIXEL_ALGORITHM_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <functional>
+#include <opencv2/opencv.hpp>
+
+/** \brief Common interface of all superpixel algorithms.
+ * 
+ * An algorithm is configured once on construction, usually through
+ * SuperpixelAlgorithmRegistry::create, and then segments any number of images;
+ * state that can be reused across images (e.g. buffers or warm starts) is
+ * kept by the instance. An instance is not meant to be shared between threads.
+ * 
+ * Usage:
+ * 
+ *     SuperpixelAlgorithm::Parameters parameters = 
+ *             SuperpixelAlgorithm::parseParameters("superpixels=1200,compactness=20");
+ *     SuperpixelAlgorithm* algorithm = SuperpixelAlgorithmRegistry::create("slic", parameters);
+ * 
+ *     cv::Mat labels;
+ *     algorithm->segment(image, labels);
+ *     delete algorithm;
+ * 
+ * \author David Stutz
+ */
+class SuperpixelAlgorithm {
+public:
+    
+    /** \brief Parameters by name, the names follow the long options of the
+     * corresponding command line tools. */
+    typedef std::map<std::string, std::string> Parameters;
+    
+    /** \brief Destructor. */
+    virtual ~SuperpixelAlgorithm() {};
+    
+    /** \brief Compute superpixels on the given image.
+     * \param[in] image CV_8UC3 image to compute superpixels on
+     * \param[out] labels superpixel labels as CV_32SC1
+     */
+    virtual void segment(const cv::Mat &image, cv::Mat &labels) = 0;
+    
+    /** \brief Parse parameters of the form "name=value,name=value"; entries
+     * without value are interpreted as flags and set to "1".
+     * \param[in] string string to parse
+     * \return parameters
+     */
+    static Parameters parseParameters(const std::string &string);
+    
+    /** \brief Get an integer parameter.
+     * \param[in] parameters parameters
+     * \param[in] name name of parameter
+     * \param[in] value default value if the parameter is not given
+     * \return value, throws boost::bad_lexical_cast if the value is invalid
+     */
+    static int getInt(const Parameters &parameters, const std::string &name, 
+            int value);
+    
+    /** \brief Get a floating point parameter.
+     * \param[in] parameters parameters
+     * \param[in] name name of parameter
+     * \param[in] value default value if the parameter is not given
+     * \return value, throws boost::bad_lexical_cast if the value is invalid
+     */
+    static double getDouble(const Parameters &parameters, const std::string &name, 
+            double value);
+    
+    /** \brief Get a boolean parameter, any integer > 0 is true.
+     * \param[in] parameters parameters
+     * \param[in] name name of parameter
+     * \param[in] value default value if the parameter is not given
+     * \return value, throws boost::bad_lexical_cast if the value is invalid
+     */
+    static bool getBool(const Parameters &parameters, const std::string &name, 
+            bool value);
+    
+};
+
+/** \brief Registry of superpixel algorithms by name.
+ * 
+ * Algorithms are registered with a factory taking the parameters; the
+ * algorithms built with the benchmark are registered by 
+ * SuperpixelAlgorithms::registerAll in lib_algorithms.
+ * \author David Stutz
+ */
+class SuperpixelAlgorithmRegistry {
+public:
+    
+    /** \brief Factory creating a configured algorithm. */
+    typedef std::function<SuperpixelAlgorithm*(const SuperpixelAlgorithm::Parameters&)> Factory;
+    
+    /** \brief Register an algorithm, replacing any algorithm of the same name.
+     * \param[in] name name of the algorithm
+     * \param[in] factory factory for the algorithm
+     */
+    static void add(const std::string &name, Factory factory);
+    
+    /** \brief Create an algorithm; the caller takes ownership.
+     * \param[in] name name of the algorithm
+     * \param[in] parameters parameters, missing parameters take the defaults 
+     * of the command line tools
+     * \return algorithm, NULL if no algorithm of this name is registered
+     */
+    static SuperpixelAlgorithm* create(const std::string &name, 
+            const SuperpixelAlgorithm::Parameters &parameters);
+    
+    /** \brief Check whether an algorithm is registered.
+     * \param[in] name name of the algorithm
+     * \return whether the algorithm is registered
+     */
+    static bool has(const std::string &name);
+    
+    /** \brief Names of all registered algorithms.
+     * \return names in lexicographic order
+     */
+    static std::vector<std::string> list();
+    
+private:
+    
+    /** \brief Registered factories, constructed on first use.
+     * \return factories by name
+     */
+    static std::map<std::string, Factory>& factories();
+    
+};
+
+#endif	/* SUPERPIXEL_ALGORITHM_H */
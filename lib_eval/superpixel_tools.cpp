@@ -29,9 +29,17 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <limits>
 #include <glog/logging.h>
-#include "connected_components.h"
+#include "region_adjacency_graph.h"
+#include "thread_pool.h"
 #include "superpixel_tools.h"
+#include "evaluation.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // computeRegionSizeFromSuperpixels
@@ -44,6 +52,68 @@ int SuperpixelTools::computeRegionSizeFromSuperpixels(const cv::Mat &image,
     return (int) (0.5f + std::sqrt(image.rows*image.cols / (float) superpixels));
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// computeComplexity
+////////////////////////////////////////////////////////////////////////////////
+
+float SuperpixelTools::computeComplexity(const cv::Mat &image) {
+    
+    const float GRADIENT_THRESHOLD = 0.1f;
+    const float MAX_GRADIENT_ENERGY = 0.25f;
+    const int BINS = 32;
+    
+    cv::Mat gradient_magnitude;
+    Evaluation::computeGradientMagnitude(image, gradient_magnitude);
+    
+    int edges = 0;
+    for (int i = 0; i < gradient_magnitude.rows; ++i) {
+        const float* row = gradient_magnitude.ptr<float>(i);
+        for (int j = 0; j < gradient_magnitude.cols; ++j) {
+            edges += (row[j] > GRADIENT_THRESHOLD);
+        }
+    }
+    
+    float gradient_energy = edges/((float) image.rows*image.cols);
+    gradient_energy = std::min(1.f, gradient_energy/MAX_GRADIENT_ENERGY);
+    
+    // Entropy of the per-channel histograms normalized by the entropy of a
+    // uniform histogram.
+    const int channels = image.channels();
+    std::vector<int> histograms(channels*BINS, 0);
+    for (int i = 0; i < image.rows; ++i) {
+        const unsigned char* row = image.ptr<unsigned char>(i);
+        for (int j = 0; j < image.cols*channels; ++j) {
+            histograms[(j%channels)*BINS + row[j]*BINS/256]++;
+        }
+    }
+    
+    float spread = 0;
+    for (int c = 0; c < channels; ++c) {
+        float entropy = 0;
+        for (int b = 0; b < BINS; ++b) {
+            if (histograms[c*BINS + b] > 0) {
+                float p = histograms[c*BINS + b]/((float) image.rows*image.cols);
+                entropy -= p*std::log(p);
+            }
+        }
+        
+        spread += entropy/std::log((float) BINS)/channels;
+    }
+    
+    return 0.5f*(gradient_energy + spread);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeAdaptiveSuperpixels
+////////////////////////////////////////////////////////////////////////////////
+
+int SuperpixelTools::computeAdaptiveSuperpixels(int superpixels, 
+        float min_fraction, float complexity) {
+    
+    float fraction = min_fraction + (1 - min_fraction)*std::max(0.f, std::min(1.f, complexity));
+    return std::max(1, (int) (0.5f + fraction*superpixels));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // computeHeightWidthFromSuperpixels
 ////////////////////////////////////////////////////////////////////////////////
@@ -129,36 +199,85 @@ void SuperpixelTools::computeHeightWidthLevelsFromSuperpixels(const cv::Mat &ima
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// relabelSuperpixels
+// computeLabelRange
 ////////////////////////////////////////////////////////////////////////////////
 
-void SuperpixelTools::relabelSuperpixels(cv::Mat &labels) {
+/** \brief Compute minimum and maximum label in a single pass over the rows.
+ * \param[in] labels superpixel labels as CV_32SC1 (T = int) or CV_16UC1 (T = unsigned short)
+ * \param[out] min_label minimum label
+ * \param[out] max_label maximum label
+ */
+template<typename T>
+static void computeLabelRange(const cv::Mat &labels, int &min_label, int &max_label) {
+    min_label = labels.at<T>(0, 0);
+    max_label = labels.at<T>(0, 0);
     
-    int max_label = 0;
     for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            if (labels.at<int>(i, j) > max_label) {
-                max_label = labels.at<int>(i, j);
-            }
+        const T* row = labels.ptr<T>(i);
+        
+        // Branch-free such that the compiler can vectorize the loop.
+        T row_min = row[0];
+        T row_max = row[0];
+        for (int j = 1; j < labels.cols; j++) {
+            row_min = std::min(row_min, row[j]);
+            row_max = std::max(row_max, row[j]);
         }
+        
+        min_label = std::min(min_label, (int) row_min);
+        max_label = std::max(max_label, (int) row_max);
     }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// relabelSuperpixels
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Relabel superpixels in order of first occurrence.
+ * \param[in,out] labels superpixel labels as CV_32SC1 (T = int) or CV_16UC1 (T = unsigned short)
+ */
+template<typename T>
+static void relabelSuperpixelsInPlace(cv::Mat &labels) {
+    int min_label = 0;
+    int max_label = 0;
+    computeLabelRange<T>(labels, min_label, max_label);
     
+    // Labels are numbered in order of first occurrence using a flat table
+    // over the label range.
     int current_label = 0;
-    std::vector<int> label_correspondence(max_label + 1, -1);
+    std::vector<int> label_correspondence(max_label - min_label + 1, -1);
     
     for (int i = 0; i < labels.rows; i++) {
+        T* row = labels.ptr<T>(i);
+        
         for (int j = 0; j < labels.cols; j++) {
-            int label = labels.at<int>(i, j);
+            int label = row[j] - min_label;
             
             if (label_correspondence[label] < 0) {
                 label_correspondence[label] = current_label++;
             }
             
-            labels.at<int>(i, j) = label_correspondence[label];
+            row[j] = label_correspondence[label];
         }
     }
 }
 
+void SuperpixelTools::relabelSuperpixels(cv::Mat &labels) {
+    LOG_IF(FATAL, labels.type() != CV_32SC1 && labels.type() != CV_16UC1) 
+            << "Invalid label type.";
+    
+    if (labels.rows <= 0 || labels.cols <= 0) {
+        return;
+    }
+    
+    // Relabeling never increases the maximum label, so 16-bit labels stay valid.
+    if (labels.type() == CV_16UC1) {
+        relabelSuperpixelsInPlace<unsigned short>(labels);
+    }
+    else {
+        relabelSuperpixelsInPlace<int>(labels);
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // computeDistance
 ////////////////////////////////////////////////////////////////////////////////
@@ -169,6 +288,108 @@ float computeDistance(const cv::Vec3b &x, const cv::Vec3b &y) {
             + (x[2] - y[2])*(x[2] - y[2]);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// computeMeanColors
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Mean color of each label, boundary pixels are skipped.
+ * \param[in] image image as CV_8UC3
+ * \param[in] labels labels as CV_32SC1 in [offset, offset + count)
+ * \param[in] count number of labels
+ * \param[in] offset smallest label
+ * \param[in] BOUNDARY_VALUE value of boundary pixels
+ * \param[out] means mean color of label offset + k at k
+ */
+static void computeMeanColors(const cv::Mat &image, const cv::Mat &labels, 
+        int count, int offset, int BOUNDARY_VALUE, std::vector<cv::Vec3b> &means) {
+    
+    std::vector<cv::Vec3i> sums(count, cv::Vec3i(0, 0, 0));
+    std::vector<int> counts(count, 0);
+    
+    for (int i = 0; i < labels.rows; i++) {
+        const int* labels_ptr = labels.ptr<int>(i);
+        const cv::Vec3b* image_ptr = image.ptr<cv::Vec3b>(i);
+        
+        for (int j = 0; j < labels.cols; j++) {
+            if (labels_ptr[j] != BOUNDARY_VALUE) {
+                int k = labels_ptr[j] - offset;
+                sums[k][0] += image_ptr[j][0];
+                sums[k][1] += image_ptr[j][1];
+                sums[k][2] += image_ptr[j][2];
+                counts[k]++;
+            }
+        }
+    }
+    
+    means.assign(count, cv::Vec3b(0, 0, 0));
+    for (int k = 0; k < count; k++) {
+        if (counts[k] > 0) {
+            means[k][0] = sums[k][0]/counts[k];
+            means[k][1] = sums[k][1]/counts[k];
+            means[k][2] = sums[k][2]/counts[k];
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// assignBoundaryPixels
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Assign each boundary pixel of source to the 4-neighbor (bottom, right,
+ * top, left) in source whose superpixel has the closest mean color.
+ * 
+ * Source and target may be the same, boundary pixels are then assigned in
+ * raster order using the assignments made so far.
+ * 
+ * \param[in] image image as CV_8UC3
+ * \param[in] source labels to read neighbors from
+ * \param[out] target labels to write boundary pixels to
+ * \param[in] means mean colors, see computeMeanColors
+ * \param[in] offset smallest label
+ * \param[in] BOUNDARY_VALUE value of boundary pixels
+ */
+static void assignBoundaryPixels(const cv::Mat &image, const cv::Mat &source, 
+        cv::Mat &target, const std::vector<cv::Vec3b> &means, int offset, 
+        int BOUNDARY_VALUE) {
+    
+    for (int i = 0; i < source.rows; i++) {
+        const int* row = source.ptr<int>(i);
+        const int* row_above = (i > 0) ? source.ptr<int>(i - 1) : NULL;
+        const int* row_below = (i + 1 < source.rows) ? source.ptr<int>(i + 1) : NULL;
+        const cv::Vec3b* image_ptr = image.ptr<cv::Vec3b>(i);
+        int* target_ptr = target.ptr<int>(i);
+        
+        for (int j = 0; j < source.cols; j++) {
+            if (row[j] != BOUNDARY_VALUE) {
+                continue;
+            }
+            
+            int neighbors[4] = {
+                row_below != NULL ? row_below[j] : BOUNDARY_VALUE,
+                j + 1 < source.cols ? row[j + 1] : BOUNDARY_VALUE,
+                row_above != NULL ? row_above[j] : BOUNDARY_VALUE,
+                j > 0 ? row[j - 1] : BOUNDARY_VALUE
+            };
+            
+            int min_label = BOUNDARY_VALUE;
+            float min_distance = std::numeric_limits<float>::max();
+            
+            for (int n = 0; n < 4; n++) {
+                if (neighbors[n] != BOUNDARY_VALUE) {
+                    float distance = computeDistance(image_ptr[j], means[neighbors[n] - offset]);
+                    
+                    if (distance < min_distance) {
+                        min_distance = distance;
+                        min_label = neighbors[n];
+                    }
+                }
+            }
+            
+            target_ptr[j] = min_label;
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // computeLabelsFromBoundaries
 ////////////////////////////////////////////////////////////////////////////////
@@ -185,156 +406,66 @@ void SuperpixelTools::computeLabelsFromBoundaries(const cv::Mat &image,
             << image.rows << "," << image.cols << " != " << boundaries.rows << "," << boundaries.cols;
     LOG_IF(FATAL, boundaries.type() != CV_32S) << "Invalid boundaries type!";
     
-    cv::Mat tmp_labels(boundaries.rows, boundaries.cols, CV_32FC1, cv::Scalar(0));
-    for (int i = 0; i < tmp_labels.rows; i++) {
-        for (int j = 0; j < tmp_labels.cols; j++) {
-            if (boundaries.at<int>(i, j) > 0) {
-                tmp_labels.at<float>(i,j) = BOUNDARY_VALUE;
-            }
-            else {
-                tmp_labels.at<float>(i,j) = INNER_VALUE;
-            }
-        }
-    }
-    
-    int label = 1;
-    for (int i = 0; i < tmp_labels.rows; i++) {
-        for (int j = 0; j < tmp_labels.cols; j++) {
-            if (tmp_labels.at<float>(i, j) == INNER_VALUE) {
-                cv::floodFill(tmp_labels, cv::Point(j, i), cv::Scalar(label), 
-                        0, cv::Scalar(0), cv::Scalar(0));
-                label++;
-            }
+    // Boundary and inner regions are labeled in one union-find pass; the inner
+    // components are then numbered from 1 in raster order of their first pixel,
+    // as flood filling them one after the other would.
+    cv::Mat components(boundaries.rows, boundaries.cols, CV_32SC1);
+    for (int i = 0; i < boundaries.rows; i++) {
+        const int* boundaries_ptr = boundaries.ptr<int>(i);
+        int* components_ptr = components.ptr<int>(i);
+        
+        for (int j = 0; j < boundaries.cols; j++) {
+            components_ptr[j] = (boundaries_ptr[j] > 0) ? 1 : 0;
         }
     }
     
-    tmp_labels.convertTo(tmp_labels, CV_32SC1);
-    std::vector<cv::Vec3b> means(label + 1, cv::Vec3b(0, 0, 0));
-    std::vector<int> counts(label + 1, 0);
+    relabelConnectedSuperpixels(components);
     
-    for (int i = 0; i < tmp_labels.rows; i++) {
-        for (int j = 0; j < tmp_labels.cols; j++) {
-            if (tmp_labels.at<int>(i, j) != BOUNDARY_VALUE) {
-                means[tmp_labels.at<int>(i, j) - 1][0] += image.at<cv::Vec3b>(i, j)[0];
-                means[tmp_labels.at<int>(i, j) - 1][1] += image.at<cv::Vec3b>(i, j)[1];
-                means[tmp_labels.at<int>(i, j) - 1][2] += image.at<cv::Vec3b>(i, j)[2];
-                counts[tmp_labels.at<int>(i, j) - 1]++;
-            }
+    int component_count = 0;
+    for (int i = 0; i < components.rows; i++) {
+        const int* components_ptr = components.ptr<int>(i);
+        for (int j = 0; j < components.cols; j++) {
+            component_count = std::max(component_count, components_ptr[j] + 1);
         }
     }
     
-    for (int k = 0; k < label + 1; k++) {
-        if (counts[k] > 0) {
-            means[k][0] /= counts[k];
-            means[k][1] /= counts[k];
-            means[k][2] /= counts[k];
-        }
-    }
+    std::vector<int> inner_labels(component_count, 0);
+    cv::Mat tmp_labels(boundaries.rows, boundaries.cols, CV_32SC1);
     
-    labels.create(image.rows, image.cols, CV_32SC1);
-    for (int i = 0; i < tmp_labels.rows; i++) {
-        for (int j = 0; j < tmp_labels.cols; j++) {
-            if (tmp_labels.at<int>(i, j) == BOUNDARY_VALUE) {
-
-                int min_label = BOUNDARY_VALUE;
-                float min_distance = std::numeric_limits<float>::max();
-
-                if (i + 1 < image.rows && tmp_labels.at<int>(i + 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[tmp_labels.at<int>(i + 1, j) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = tmp_labels.at<int>(i + 1, j);
-                    }
-                }
-
-                if (j + 1 < image.cols && tmp_labels.at<int>(i, j + 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[tmp_labels.at<int>(i, j + 1) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = tmp_labels.at<int>(i, j + 1);
-                    }
-                }
-
-                if (i > 0 && tmp_labels.at<int>(i - 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[tmp_labels.at<int>(i - 1, j) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = tmp_labels.at<int>(i - 1, j);
-                    }
-                }
-
-                if (j > 0 && tmp_labels.at<int>(i, j - 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[tmp_labels.at<int>(i, j - 1) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = tmp_labels.at<int>(i, j - 1);
-                    }
-                }
-
-                labels.at<int>(i, j) = min_label;
+    int label = 1;
+    for (int i = 0; i < boundaries.rows; i++) {
+        const int* boundaries_ptr = boundaries.ptr<int>(i);
+        const int* components_ptr = components.ptr<int>(i);
+        int* tmp_ptr = tmp_labels.ptr<int>(i);
+        
+        for (int j = 0; j < boundaries.cols; j++) {
+            if (boundaries_ptr[j] > 0) {
+                tmp_ptr[j] = BOUNDARY_VALUE;
             }
             else {
-                labels.at<int>(i, j) = tmp_labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    // Second pass to resolve diagonal issues.
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            if (labels.at<int>(i, j) == BOUNDARY_VALUE) {
-
-                int min_label = BOUNDARY_VALUE;
-                float min_distance = std::numeric_limits<float>::max();
-
-                if (i + 1 < image.rows && labels.at<int>(i + 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i + 1, j) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = labels.at<int>(i + 1, j);
-                    }
-                }
-
-                if (j + 1 < image.cols && labels.at<int>(i, j + 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i, j + 1) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = labels.at<int>(i, j + 1);
-                    }
-                }
-
-                if (i > 0 && labels.at<int>(i - 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i - 1, j) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = labels.at<int>(i - 1, j);
-                    }
-                }
-
-                if (j > 0 && labels.at<int>(i, j - 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i, j - 1) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = labels.at<int>(i, j - 1);
-                    }
+                int &inner_label = inner_labels[components_ptr[j]];
+                if (inner_label == 0) {
+                    inner_label = label++;
                 }
-
-                labels.at<int>(i, j) = min_label;
+                
+                tmp_ptr[j] = inner_label;
             }
         }
     }
     
+    std::vector<cv::Vec3b> means;
+    computeMeanColors(image, tmp_labels, label, 1, BOUNDARY_VALUE, means);
+    
+    // The first pass only considers inner pixels, the second pass resolves 
+    // diagonal issues using the first pass' assignments.
+    labels = tmp_labels.clone();
+    assignBoundaryPixels(image, tmp_labels, labels, means, 1, BOUNDARY_VALUE);
+    assignBoundaryPixels(image, labels, labels, means, 1, BOUNDARY_VALUE);
+    
     for (int i = 0; i < labels.rows; i++) {
+        int* labels_ptr = labels.ptr<int>(i);
         for (int j = 0; j < labels.cols; j++) {
-            labels.at<int>(i, j)--;
+            labels_ptr[j]--;
         }
     }
 }
@@ -348,260 +479,508 @@ void SuperpixelTools::assignBoundariesToSuperpixels(const cv::Mat &image,
     
     int label = 0;
     for (int i = 0; i < boundaries.rows; i++) {
+        const int* boundaries_ptr = boundaries.ptr<int>(i);
         for (int j = 0; j < boundaries.cols; j++) {
-            if (boundaries.at<int>(i, j) > label) {
-                label = boundaries.at<int>(i, j);
-            }
+            label = std::max(label, boundaries_ptr[j]);
         }
     }
     
-    std::vector<cv::Vec3b> means(label + 1, cv::Vec3b(0, 0, 0));
-    std::vector<int> counts(label + 1, 0);
+    std::vector<cv::Vec3b> means;
+    computeMeanColors(image, boundaries, label + 1, 0, BOUNDARY_VALUE, means);
     
-    for (int i = 0; i < boundaries.rows; i++) {
-        for (int j = 0; j < boundaries.cols; j++) {
-            if (boundaries.at<int>(i, j) != BOUNDARY_VALUE) {
-                means[boundaries.at<int>(i, j)][0] += image.at<cv::Vec3b>(i, j)[0];
-                means[boundaries.at<int>(i, j)][1] += image.at<cv::Vec3b>(i, j)[1];
-                means[boundaries.at<int>(i, j)][2] += image.at<cv::Vec3b>(i, j)[2];
-                counts[boundaries.at<int>(i, j)]++;
-            }
+    labels = boundaries.clone();
+    assignBoundaryPixels(image, boundaries, labels, means, 0, BOUNDARY_VALUE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// countSuperpixels
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Mark the labels used.
+ * \param[in] labels superpixel labels as CV_32SC1 (T = int) or CV_16UC1 (T = unsigned short)
+ * \param[out] superpixels 1 for each used label minus the minimum label
+ */
+template<typename T>
+static void markSuperpixels(const cv::Mat &labels, std::vector<unsigned char> &superpixels) {
+    int min_label = 0;
+    int max_label = 0;
+    computeLabelRange<T>(labels, min_label, max_label);
+    
+    superpixels.assign(max_label - min_label + 1, 0);
+    
+    for (int i = 0; i < labels.rows; ++i) {
+        const T* row = labels.ptr<T>(i);
+        for (int j = 0; j < labels.cols; ++j) {
+            superpixels[row[j] - min_label] = 1;
         }
     }
+}
+
+int SuperpixelTools::countSuperpixels(const cv::Mat &labels) {
+    LOG_IF(FATAL, labels.type() != CV_32SC1 && labels.type() != CV_16UC1) 
+            << "Invalid label type.";
+    
+    if (labels.rows <= 0 || labels.cols <= 0) {
+        return 0;
+    }
     
-    for (int k = 0; k < label + 1; k++) {
-        if (counts[k] > 0) {
-            means[k][0] /= counts[k];
-            means[k][1] /= counts[k];
-            means[k][2] /= counts[k];
-        }
+    std::vector<unsigned char> superpixels;
+    if (labels.type() == CV_16UC1) {
+        markSuperpixels<unsigned short>(labels, superpixels);
+    }
+    else {
+        markSuperpixels<int>(labels, superpixels);
     }
     
-    labels.create(image.rows, image.cols, CV_32SC1);
-    for (int i = 0; i < boundaries.rows; i++) {
-        for (int j = 0; j < boundaries.cols; j++) {
-            if (boundaries.at<int>(i, j) == BOUNDARY_VALUE) {
+    int sum = 0;
+    for (unsigned int i = 0; i < superpixels.size(); i++) {
+        sum += superpixels[i];
+    }
+    
+    return sum;
+}
 
-                int min_label = BOUNDARY_VALUE;
-                float min_distance = std::numeric_limits<float>::max();
+////////////////////////////////////////////////////////////////////////////////
+// ConnectedStrip
+////////////////////////////////////////////////////////////////////////////////
 
-                if (i + 1 < image.rows && boundaries.at<int>(i + 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[boundaries.at<int>(i + 1, j)]);
+/** \brief Provisional connected component labeling of a horizontal strip of
+ * rows, see relabelConnectedSuperpixels.
+ * 
+ * Pixels are labeled with local nodes; a node is either created within the
+ * strip or refers to the pixel in the given column of the row above the strip.
+ */
+struct ConnectedStrip {
+    /** \brief First row of the strip. */
+    int begin;
+    /** \brief Row after the last row of the strip. */
+    int end;
+    /** \brief Creation index of each node, or -(column + 1) for nodes referring to the row above. */
+    std::vector<int> nodes;
+    /** \brief Union-find forest over the nodes. */
+    std::vector<int> parent;
+    /** \brief Original label of each created node. */
+    std::vector<int> created_labels;
+    /** \brief Effective merges, in the order they were made. */
+    std::vector< std::pair<int, int> > merges;
+    /** \brief Global provisional label of each node. */
+    std::vector<int> global;
+};
+
+/** \brief Find the root of a node in a union-find forest, halving the path.
+ * \param[in,out] parent union-find forest
+ * \param[in] id node
+ * \return root
+ */
+static int findRoot(std::vector<int> &parent, int id) {
+    while (parent[id] != id) {
+        parent[id] = parent[parent[id]];
+        id = parent[id];
+    }
+    
+    return id;
+}
 
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = boundaries.at<int>(i + 1, j);
-                    }
+/** \brief Label the connected components (4-connectivity) of a strip in place.
+ * 
+ * This is the labeling pass of ConnectedComponents: a pixel inherits the
+ * label of its left neighbor, or else of its top neighbor, if they share its
+ * label; if both do, their components are merged by linking the root of the
+ * left one to the root of the top one.
+ * 
+ * \param[in,out] labels superpixel labels, the rows of the strip are overwritten with nodes
+ * \param[in] above original labels of the row above the strip, NULL for the first strip
+ * \param[in,out] strip strip to label
+ */
+static void labelConnectedStrip(cv::Mat &labels, const int* above, ConnectedStrip &strip) {
+    std::vector<int> previous(labels.cols);
+    std::vector<int> current(labels.cols);
+    std::vector<int> above_nodes(above != NULL ? labels.cols : 0, -1);
+    
+    for (int i = strip.begin; i < strip.end; ++i) {
+        int* row = labels.ptr<int>(i);
+        const int* previous_row = (i > strip.begin) ? labels.ptr<int>(i - 1) : NULL;
+        const int* previous_labels = (i > strip.begin) ? previous.data() : above;
+        std::copy(row, row + labels.cols, current.begin());
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            int id = -1;
+            
+            if (j > 0 && current[j] == current[j - 1]) {
+                id = row[j - 1];
+            }
+            
+            if (previous_labels != NULL && current[j] == previous_labels[j]) {
+                int above_id = 0;
+                if (previous_row != NULL) {
+                    above_id = previous_row[j];
                 }
-
-                if (j + 1 < image.cols && boundaries.at<int>(i, j + 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[boundaries.at<int>(i, j + 1)]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = boundaries.at<int>(i, j + 1);
+                else {
+                    if (above_nodes[j] < 0) {
+                        above_nodes[j] = strip.nodes.size();
+                        strip.nodes.push_back(-(j + 1));
+                        strip.parent.push_back(above_nodes[j]);
                     }
+                    
+                    above_id = above_nodes[j];
                 }
-
-                if (i > 0 && boundaries.at<int>(i - 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[boundaries.at<int>(i - 1, j)]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = boundaries.at<int>(i - 1, j);
+                
+                if (id >= 0) {
+                    int id_root = findRoot(strip.parent, id);
+                    int above_root = findRoot(strip.parent, above_id);
+                    
+                    if (id_root != above_root) {
+                        strip.parent[id_root] = above_root;
+                        strip.merges.push_back(std::make_pair(id, above_id));
                     }
                 }
-
-                if (j > 0 && boundaries.at<int>(i, j - 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[boundaries.at<int>(i, j - 1)]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = boundaries.at<int>(i, j - 1);
-                    }
+                else {
+                    id = above_id;
                 }
-
-                labels.at<int>(i, j) = min_label;
             }
-            else {
-                labels.at<int>(i, j) = boundaries.at<int>(i, j);
+            
+            if (id < 0) {
+                id = strip.nodes.size();
+                strip.nodes.push_back(strip.created_labels.size());
+                strip.parent.push_back(id);
+                strip.created_labels.push_back(current[j]);
             }
+            
+            row[j] = id;
         }
+        
+        std::swap(previous, current);
     }
-    
-    // Second pass to resolve diagonal issues.
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            if (labels.at<int>(i, j) == BOUNDARY_VALUE) {
+}
 
-                int min_label = BOUNDARY_VALUE;
-                float min_distance = std::numeric_limits<float>::max();
+////////////////////////////////////////////////////////////////////////////////
+// relabelConnectedSuperpixels
+////////////////////////////////////////////////////////////////////////////////
 
-                if (i + 1 < image.rows && labels.at<int>(i + 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i + 1, j)]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = labels.at<int>(i + 1, j);
-                    }
-                }
-
-                if (j + 1 < image.cols && labels.at<int>(i, j + 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i, j + 1)]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = labels.at<int>(i, j + 1);
-                    }
-                }
-
-                if (i > 0 && labels.at<int>(i - 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i - 1, j)]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = labels.at<int>(i - 1, j);
-                    }
-                }
-
-                if (j > 0 && labels.at<int>(i, j - 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i, j - 1)]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = labels.at<int>(i, j - 1);
-                    }
-                }
-
-                labels.at<int>(i, j) = min_label;
-            }
+int SuperpixelTools::relabelConnectedSuperpixels(cv::Mat &labels, int threads) {
+    LOG_IF(FATAL, labels.type() != CV_32SC1 && labels.type() != CV_16UC1) 
+            << "Invalid label type.";
+    LOG_IF(FATAL, threads <= 0) << "Number of threads needs to be positive.";
+    
+    // Components may exceed the 16-bit range, so 16-bit labels are labeled
+    // as int and narrowed again if possible.
+    if (labels.type() == CV_16UC1) {
+        cv::Mat wide_labels;
+        widenLabels(labels, wide_labels);
+        
+        int count = relabelConnectedSuperpixels(wide_labels, threads);
+        if (!narrowLabels(wide_labels, labels)) {
+            labels = wide_labels;
         }
+        
+        return count;
     }
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// countSuperpixels
-////////////////////////////////////////////////////////////////////////////////
-
-int SuperpixelTools::countSuperpixels(const cv::Mat &labels) {
     
-    int max = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > max) {
-                max = labels.at<int>(i, j);
+    if (labels.rows <= 0 || labels.cols <= 0) {
+        return 0;
+    }
+    
+    // Strips are labeled independently; the original labels of the row
+    // above each strip are kept to connect them.
+    int n_strips = std::max(1, std::min(threads, labels.rows/16));
+    std::vector<ConnectedStrip> strips(n_strips);
+    std::vector< std::vector<int> > above(n_strips);
+    
+    for (int s = 0; s < n_strips; ++s) {
+        strips[s].begin = (s*labels.rows)/n_strips;
+        strips[s].end = ((s + 1)*labels.rows)/n_strips;
+        
+        if (s > 0) {
+            const int* row = labels.ptr<int>(strips[s].begin - 1);
+            above[s].assign(row, row + labels.cols);
+        }
+    }
+    
+    auto forStrips = [&strips](std::function<void(int)> function) {
+        if (strips.size() <= 1) {
+            function(0);
+            return;
+        }
+        
+        ThreadPool::parallelFor(0, strips.size(), function, strips.size());
+    };
+    
+    forStrips([&](int s) {
+        labelConnectedStrip(labels, (s > 0) ? above[s].data() : NULL, strips[s]);
+    });
+    
+    // The first strip is labeled exactly as in a sequential pass. The merges
+    // of the remaining strips are replayed in order on global provisional
+    // labels, created in raster order; skipped merges were already implied.
+    // This yields the same forest, and numbering, as a sequential pass.
+    std::vector<int> parent(strips[0].parent);
+    std::vector<int> component_labels(strips[0].created_labels);
+    strips[0].global.resize(strips[0].nodes.size());
+    for (unsigned int k = 0; k < strips[0].nodes.size(); ++k) {
+        strips[0].global[k] = k;
+    }
+    
+    for (int s = 1; s < n_strips; ++s) {
+        ConnectedStrip &strip = strips[s];
+        const int* previous_row = labels.ptr<int>(strip.begin - 1);
+        int offset = parent.size();
+        
+        strip.global.resize(strip.nodes.size());
+        for (unsigned int k = 0; k < strip.nodes.size(); ++k) {
+            if (strip.nodes[k] >= 0) {
+                strip.global[k] = offset + strip.nodes[k];
+            }
+            else {
+                strip.global[k] = strips[s - 1].global[previous_row[-strip.nodes[k] - 1]];
+            }
+        }
+        
+        for (unsigned int k = 0; k < strip.created_labels.size(); ++k) {
+            parent.push_back(offset + k);
+            component_labels.push_back(strip.created_labels[k]);
+        }
+        
+        for (unsigned int m = 0; m < strip.merges.size(); ++m) {
+            int id_root = findRoot(parent, strip.global[strip.merges[m].first]);
+            int above_root = findRoot(parent, strip.global[strip.merges[m].second]);
+            
+            if (id_root != above_root) {
+                parent[id_root] = above_root;
             }
         }
     }
     
-    std::vector<int> superpixels(max + 1, 0);
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            LOG_IF(FATAL, labels.at<int>(i, j) > max) << "Invalid label: " << labels.at<int>(i, j);
-            superpixels[labels.at<int>(i, j)] = 1;
+    // Components are numbered in the order of their roots.
+    std::vector<int> tags(parent.size());
+    std::vector<int> root_labels;
+    
+    int component_count = 0;
+    for (unsigned int id = 0; id < parent.size(); ++id) {
+        if (parent[id] == (int) id) {
+            tags[id] = component_count++;
+            root_labels.push_back(component_labels[id]);
         }
     }
     
-    int sum = 0;
-    for (unsigned int i = 0; i < superpixels.size(); i++) {
-        sum += superpixels[i];
+    for (unsigned int id = 0; id < parent.size(); ++id) {
+        tags[id] = tags[findRoot(parent, id)];
     }
     
-    return sum;
+    forStrips([&](int s) {
+        const std::vector<int> &global = strips[s].global;
+        for (int i = strips[s].begin; i < strips[s].end; ++i) {
+            int* row = labels.ptr<int>(i);
+            for (int j = 0; j < labels.cols; ++j) {
+                row[j] = tags[global[row[j]]];
+            }
+        }
+    });
+    
+    // Number of components exceeding the number of original superpixels.
+    std::sort(root_labels.begin(), root_labels.end());
+    int label_count = std::unique(root_labels.begin(), root_labels.end()) - root_labels.begin();
+    
+    return component_count - label_count;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// relabelConnectedSuperpixels
+// mergeSmallSuperpixels
 ////////////////////////////////////////////////////////////////////////////////
 
-int SuperpixelTools::relabelConnectedSuperpixels(cv::Mat &labels) {
-    LOG_IF(FATAL, labels.type() != CV_32SC1) << "Invalid label type.";
+/** \brief Merge superpixels, smallest first, into their most similar neighbor
+ * in terms of mean color.
+ * 
+ * Region sizes, color sums and adjacency are taken from the RegionAdjacencyGraph;
+ * merges update them in O(degree) and are applied to the labels in a single
+ * final pass.
+ * 
+ * \param[in] image image as CV_8UC3
+ * \param[in,out] labels superpixel labels as CV_32SC1
+ * \param[in] size superpixels smaller than this size are merged
+ * \param[in] number maximum number of merges
+ * \return number of merged superpixels
+ */
+static int mergeSmallSuperpixels(const cv::Mat &image, cv::Mat &labels, 
+        int size, int number) {
     
-    SuperpixelTools::relabelSuperpixels(labels);
+    if (labels.rows <= 0 || labels.cols <= 0 || number <= 0) {
+        return 0;
+    }
     
-    int max = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > max) {
-                max = labels.at<int>(i, j);
-            }
+    RegionAdjacencyGraph graph(labels, image);
+    int regions = graph.getRegions();
+    
+    std::vector<int> counts(regions);
+    std::vector<cv::Vec3d> sums(regions);
+    std::vector< std::vector<int> > neighbors(regions);
+    
+    for (int k = 0; k < regions; k++) {
+        counts[k] = graph.getArea(k);
+        if (counts[k] > 0) {
+            sums[k] = graph.getColorSum(k);
+            neighbors[k].assign(graph.getNeighbors().begin() + graph.getOffsets()[k], 
+                    graph.getNeighbors().begin() + graph.getOffsets()[k + 1]);
         }
     }
     
-    ConnectedComponents cc(2*max);
+    // Smallest superpixels are popped first; entries with outdated sizes are
+    // skipped.
+    typedef std::pair<int, int> HeapEntry;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry> > heap;
+    std::vector<int> parent(regions);
+    
+    for (int k = 0; k < regions; k++) {
+        parent[k] = k;
+        if (counts[k] > 0) {
+            heap.push(std::make_pair(counts[k], k));
+        }
+    }
+    
+    int count = 0;
+    while (!heap.empty() && count < number) {
+        HeapEntry entry = heap.top();
+        heap.pop();
+        
+        int label = entry.second;
+        if (parent[label] != label || counts[label] != entry.first) {
+            continue;
+        }
+        
+        if (counts[label] >= size) {
+            break;
+        }
+        
+        if (neighbors[label].empty()) {
+            continue;
+        }
+        
+        cv::Vec3d mean = sums[label]/counts[label];
+        
+        int target = -1;
+        double min_distance = std::numeric_limits<double>::max();
+        for (unsigned int kk = 0; kk < neighbors[label].size(); kk++) {
+            int neighbor = neighbors[label][kk];
+            cv::Vec3d difference = mean - sums[neighbor]/counts[neighbor];
+            double distance = difference.dot(difference);
             
-    cv::Mat components(labels.rows, labels.cols, CV_32SC1, cv::Scalar(0));
-    int component_count = cc.connected<int, int, std::equal_to<int>, bool>((int*) labels.data, (int*) components.data, labels.cols, 
-            labels.rows, std::equal_to<int>(), false);
+            if (distance < min_distance) {
+                min_distance = distance;
+                target = neighbor;
+            }
+        }
+        
+        // Neighbors of the merged superpixel become neighbors of the target.
+        for (unsigned int kk = 0; kk < neighbors[label].size(); kk++) {
+            int neighbor = neighbors[label][kk];
+            std::vector<int> &neighbor_neighbors = neighbors[neighbor];
+            
+            neighbor_neighbors.erase(std::find(neighbor_neighbors.begin(), 
+                    neighbor_neighbors.end(), label));
+            
+            if (neighbor != target) {
+                if (std::find(neighbor_neighbors.begin(), neighbor_neighbors.end(), 
+                        target) == neighbor_neighbors.end()) {
+                    neighbor_neighbors.push_back(target);
+                    neighbors[target].push_back(neighbor);
+                }
+            }
+        }
+        
+        std::vector<int>().swap(neighbors[label]);
+        
+        parent[label] = target;
+        counts[target] += counts[label];
+        sums[target] += sums[label];
+        heap.push(std::make_pair(counts[target], target));
+        
+        count++;
+    }
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    for (int k = 0; k < regions; k++) {
+        parent[k] = findRoot(parent, k);
+    }
     
     for (int i = 0; i < labels.rows; i++) {
+        int* row = labels.ptr<int>(i);
         for (int j = 0; j < labels.cols; j++) {
-            labels.at<int>(i, j) = components.at<int>(i, j);
+            row[j] = parent[row[j]];
         }
     }
     
-    // component_count would be the NEXT label index, max is the current highest!
-    return component_count - max - 1;
+    return count;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// enforceMinimumSuperpixelSize
+// mergeSuperpixelsOnce
 ////////////////////////////////////////////////////////////////////////////////
 
-int SuperpixelTools::enforceMinimumSuperpixelSize(const cv::Mat &image, cv::Mat &labels, int size) {
+/** \brief Merge the given superpixels into their most similar neighbor, with
+ * all merges decided on the initial superpixels.
+ * 
+ * This is the original merging of enforceMinimumSuperpixelSize and
+ * enforceMinimumSuperpixelSizeUpTo, reproduced exactly: mean colors are
+ * computed from 8-bit (wrapping) color sums, neighbors are compared in the
+ * order they are first encountered (below, above, right, left in raster
+ * order) and neighbors which are merged themselves are skipped. Each label
+ * is replaced by its chosen neighbor only, i.e. chains are not followed.
+ * Neighbors are collected in a single pass over row pointers and the labels
+ * are written in a single final pass.
+ * 
+ * \param[in] image image as CV_8UC3
+ * \param[in,out] labels superpixel labels as CV_32SC1
+ * \param[in] size superpixels smaller than this size are merged if number < 0
+ * \param[in] number if non-negative, the number of smallest superpixels
+ * (including empty labels) to merge instead
+ * \return number of merged superpixels
+ */
+static int mergeSuperpixelsOnce(const cv::Mat &image, cv::Mat &labels, 
+        int size, int number) {
+    
     int max_label = 0;
     for (int i = 0; i < labels.rows; i++) {
+        const int* row = labels.ptr<int>(i);
         for (int j = 0; j < labels.cols; j++) {
-            if (labels.at<int>(i, j) > max_label) {
-                max_label = labels.at<int>(i, j);
-            }
+            max_label = std::max(max_label, row[j]);
         }
     }
     
+    // As originally, colors are summed in cv::Vec3b, i.e. modulo 256.
     std::vector<cv::Vec3b> means(max_label + 1, cv::Vec3b(0, 0, 0));
     std::vector<int> counts(max_label + 1, 0);
-    
     std::vector< std::vector<int> > neighbors(max_label + 1);
-    for (unsigned int k = 0; k < neighbors.size(); k++) {
-        neighbors[k] = std::vector<int>(0);
-    }
+    
+    auto addNeighbor = [&neighbors](int label, int neighbor_label) {
+        if (neighbor_label != label) {
+            std::vector<int> &label_neighbors = neighbors[label];
+            if (std::find(label_neighbors.begin(), label_neighbors.end(), 
+                    neighbor_label) == label_neighbors.end()) {
+                label_neighbors.push_back(neighbor_label);
+            }
+        }
+    };
     
     for (int i = 0; i < labels.rows; i++) {
+        const int* row = labels.ptr<int>(i);
+        const int* below = labels.ptr<int>(std::min(i + 1, labels.rows - 1));
+        const int* above = labels.ptr<int>(std::max(0, i - 1));
+        const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+        
         for (int j = 0; j < labels.cols; j++) {
-            int label = labels.at<int>(i, j);
+            int label = row[j];
             
-            means[label][0] += image.at<cv::Vec3b>(i, j)[0];
-            means[label][1] += image.at<cv::Vec3b>(i, j)[1];
-            means[label][2] += image.at<cv::Vec3b>(i, j)[2];
+            means[label][0] += image_row[j][0];
+            means[label][1] += image_row[j][1];
+            means[label][2] += image_row[j][2];
             counts[label]++;
             
-            int neighbor_label = labels.at<int>(std::min(i + 1, labels.rows - 1), j);
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
-            
-            neighbor_label = labels.at<int>(std::max(0, i - 1), j);
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
-            
-            neighbor_label = labels.at<int>(i, std::min(j + 1, labels.cols - 1));
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
-            
-            neighbor_label = labels.at<int>(i, std::max(0, j - 1));
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
+            addNeighbor(label, below[j]);
+            addNeighbor(label, above[j]);
+            addNeighbor(label, row[std::min(j + 1, labels.cols - 1)]);
+            addNeighbor(label, row[std::max(0, j - 1)]);
         }
     }
     
@@ -613,165 +992,581 @@ int SuperpixelTools::enforceMinimumSuperpixelSize(const cv::Mat &image, cv::Mat
         }
     }
     
-    int count = 0;
-    std::vector<int> new_labels(max_label + 1, -1);
+    // Superpixels to merge, in the order their merges are decided.
+    std::vector<int> ids;
+    if (number < 0) {
+        for (unsigned int k = 0; k < counts.size(); k++) {
+            if (counts[k] < size) {
+                ids.push_back(k);
+            }
+        }
+    }
+    else {
+        ids.resize(max_label + 1);
+        for (unsigned int k = 0; k < ids.size(); k++) {
+            ids[k] = k;
+        }
+        
+        std::sort(ids.begin(), ids.end(), [&counts](int i, int j) {
+            return counts[i] < counts[j];
+        });
+        
+        ids.resize(std::min((int) ids.size(), number));
+    }
     
-    for (unsigned int k = 0; k < counts.size(); k++) {
-        if (counts[k] < size) {
+    std::vector<int> new_labels(max_label + 1, -1);
+    for (unsigned int k = 0; k < ids.size(); k++) {
+        int label = ids[k];
+        
+        float min_distance = std::numeric_limits<float>::max();
+        for (unsigned int kk = 0; kk < neighbors[label].size(); kk++) {
+            int neighbor = neighbors[label][kk];
+            float distance = (means[label][0] - means[neighbor][0])*(means[label][0] - means[neighbor][0])
+                    + (means[label][1] - means[neighbor][1])*(means[label][1] - means[neighbor][1])
+                    + (means[label][2] - means[neighbor][2])*(means[label][2] - means[neighbor][2]);
             
-            float min_distance = std::numeric_limits<float>::max();
-            for (unsigned int kk = 0; kk < neighbors[k].size(); kk++) {
-                float distance = (means[k][0] - means[neighbors[k][kk]][0])*(means[k][0] - means[neighbors[k][kk]][0])
-                        + (means[k][1] - means[neighbors[k][kk]][1])*(means[k][1] - means[neighbors[k][kk]][1])
-                        + (means[k][2] - means[neighbors[k][kk]][2])*(means[k][2] - means[neighbors[k][kk]][2]);
-                
-                if (distance < min_distance && new_labels[neighbors[k][kk]] < 0) {
-                    min_distance = distance;
-                    new_labels[k] = neighbors[k][kk];
-                }
+            if (distance < min_distance && new_labels[neighbor] < 0) {
+                min_distance = distance;
+                new_labels[label] = neighbor;
             }
-            
-            count++;
         }
     }
     
     for (int i = 0; i < labels.rows; i++) {
+        int* row = labels.ptr<int>(i);
         for (int j = 0; j < labels.cols; j++) {
-            
-            int label = labels.at<int>(i, j);
-            if (new_labels[label] >= 0) {
-                
-                int new_label = new_labels[label];
-                while (new_labels[new_label] >= 0) {
-                    new_label = new_labels[new_label];
-                }
-                
-                labels.at<int>(i, j) = new_labels[label];
+            if (new_labels[row[j]] >= 0) {
+                row[j] = new_labels[row[j]];
             }
         }
     }
     
-    return count;
+    return ids.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// enforceMinimumSuperpixelSize
+////////////////////////////////////////////////////////////////////////////////
+
+int SuperpixelTools::enforceMinimumSuperpixelSize(const cv::Mat &image, cv::Mat &labels, 
+        int size, bool track_merges) {
+    
+    if (track_merges) {
+        return mergeSmallSuperpixels(image, labels, size, std::numeric_limits<int>::max());
+    }
+    
+    return mergeSuperpixelsOnce(image, labels, size, -1);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // enforceMinimumSuperpixelSizeUpTo
 ////////////////////////////////////////////////////////////////////////////////
 
-int SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(const cv::Mat &image, cv::Mat &labels, int number) {
-    int max_label = 0;
+int SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(const cv::Mat &image, cv::Mat &labels, 
+        int number, bool track_merges) {
+    
+    if (track_merges) {
+        return mergeSmallSuperpixels(image, labels, std::numeric_limits<int>::max(), number);
+    }
+    
+    return mergeSuperpixelsOnce(image, labels, 0, std::max(0, number));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeHierarchy
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Edge between two superpixels of the hierarchy. */
+struct HierarchyEdge {
+    HierarchyEdge() : length(0), strength(0) {}
+    /** \brief Number of 4-connected pixel pairs across the boundary. */
+    int length;
+    /** \brief Sum of color differences across the boundary. */
+    double strength;
+};
+
+/** \brief Candidate merge; outdated if either superpixel changed since. */
+struct HierarchyMerge {
+    /** \brief Cost of the merge. */
+    double cost;
+    /** \brief Superpixels. */
+    int a, b;
+    /** \brief Versions of the superpixels when the merge was pushed. */
+    int version_a, version_b;
+    
+    bool operator>(const HierarchyMerge &other) const {
+        return cost > other.cost;
+    }
+};
+
+/** \brief Cost of merging two adjacent superpixels.
+ * \param[in] count_a size of first superpixel
+ * \param[in] sum_a color sum of first superpixel
+ * \param[in] count_b size of second superpixel
+ * \param[in] sum_b color sum of second superpixel
+ * \param[in] edge shared boundary
+ * \return cost
+ */
+static double computeMergeCost(int count_a, const cv::Vec3d &sum_a, 
+        int count_b, const cv::Vec3d &sum_b, const HierarchyEdge &edge) {
+    
+    cv::Vec3d difference = sum_a/count_a - sum_b/count_b;
+    double boundary = edge.strength/edge.length;
+    
+    return std::min(count_a, count_b)*(difference.dot(difference) + boundary*boundary);
+}
+
+void SuperpixelTools::computeHierarchy(const cv::Mat &image, const cv::Mat &labels, 
+        const std::vector<int> &superpixels, std::vector<cv::Mat> &hierarchy) {
+    
+    LOG_IF(FATAL, labels.type() != CV_32SC1) << "Invalid label type.";
+    LOG_IF(FATAL, image.type() != CV_8UC3) << "Image needs to be of type CV_8UC3.";
+    LOG_IF(FATAL, image.rows != labels.rows || image.cols != labels.cols) 
+            << "Image and labels need to be of the same size.";
+    
+    hierarchy.clear();
+    hierarchy.resize(superpixels.size());
+    
+    if (superpixels.empty() || labels.rows <= 0 || labels.cols <= 0) {
+        return;
+    }
+    
+    RegionAdjacencyGraph graph(labels, image);
+    int regions = graph.getRegions();
+    
+    std::vector<int> counts(regions);
+    std::vector<cv::Vec3d> sums(regions);
+    std::vector< std::map<int, HierarchyEdge> > edges(regions);
+    
+    int remaining = 0;
+    for (int k = 0; k < regions; k++) {
+        counts[k] = graph.getArea(k);
+        if (counts[k] > 0) {
+            sums[k] = graph.getColorSum(k);
+            remaining++;
+        }
+    }
+    
+    // Boundary lengths and strengths, counting each pixel pair once per side.
     for (int i = 0; i < labels.rows; i++) {
+        const int* labels_i = labels.ptr<int>(i);
+        const int* labels_ii = (i + 1 < labels.rows ? labels.ptr<int>(i + 1) : NULL);
+        const cv::Vec3b* image_i = image.ptr<cv::Vec3b>(i);
+        const cv::Vec3b* image_ii = (i + 1 < labels.rows ? image.ptr<cv::Vec3b>(i + 1) : NULL);
+        
         for (int j = 0; j < labels.cols; j++) {
-            if (labels.at<int>(i, j) > max_label) {
-                max_label = labels.at<int>(i, j);
+            if (j + 1 < labels.cols && labels_i[j] != labels_i[j + 1]) {
+                double strength = std::sqrt(computeDistance(image_i[j], image_i[j + 1]));
+                
+                HierarchyEdge &edge = edges[labels_i[j]][labels_i[j + 1]];
+                edge.length++;
+                edge.strength += strength;
+                
+                HierarchyEdge &reverse = edges[labels_i[j + 1]][labels_i[j]];
+                reverse.length++;
+                reverse.strength += strength;
+            }
+            
+            if (labels_ii != NULL && labels_i[j] != labels_ii[j]) {
+                double strength = std::sqrt(computeDistance(image_i[j], image_ii[j]));
+                
+                HierarchyEdge &edge = edges[labels_i[j]][labels_ii[j]];
+                edge.length++;
+                edge.strength += strength;
+                
+                HierarchyEdge &reverse = edges[labels_ii[j]][labels_i[j]];
+                reverse.length++;
+                reverse.strength += strength;
             }
         }
     }
     
-    std::vector<cv::Vec3b> means(max_label + 1, cv::Vec3b(0, 0, 0));
-    std::vector<int> counts(max_label + 1, 0);
+    std::vector<int> parent(regions);
+    std::vector<int> versions(regions, 0);
+    std::priority_queue<HierarchyMerge, std::vector<HierarchyMerge>, 
+            std::greater<HierarchyMerge> > heap;
     
-    std::vector< std::vector<int> > neighbors(max_label + 1);
-    for (unsigned int k = 0; k < neighbors.size(); k++) {
-        neighbors[k] = std::vector<int>(0);
+    for (int k = 0; k < regions; k++) {
+        parent[k] = k;
+        for (std::map<int, HierarchyEdge>::const_iterator it = edges[k].begin(); 
+                it != edges[k].end(); ++it) {
+            
+            if (k < it->first) {
+                HierarchyMerge merge;
+                merge.cost = computeMergeCost(counts[k], sums[k], counts[it->first], 
+                        sums[it->first], it->second);
+                merge.a = k;
+                merge.b = it->first;
+                merge.version_a = 0;
+                merge.version_b = 0;
+                heap.push(merge);
+            }
+        }
     }
     
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            int label = labels.at<int>(i, j);
+    // Numbers of superpixels are reached from the largest to the smallest.
+    std::vector<int> order(superpixels.size());
+    for (unsigned int k = 0; k < order.size(); k++) {
+        order[k] = k;
+    }
+    
+    std::sort(order.begin(), order.end(), [&superpixels](int a, int b) {
+        return superpixels[a] > superpixels[b];
+    });
+    
+    unsigned int next = 0;
+    while (next < order.size()) {
+        bool exhausted = heap.empty();
+        if (superpixels[order[next]] >= remaining || exhausted) {
+            std::vector<int> compact(regions, -1);
+            int count = 0;
             
-            means[label][0] += image.at<cv::Vec3b>(i, j)[0];
-            means[label][1] += image.at<cv::Vec3b>(i, j)[1];
-            means[label][2] += image.at<cv::Vec3b>(i, j)[2];
-            counts[label]++;
+            cv::Mat &result = hierarchy[order[next]];
+            result.create(labels.rows, labels.cols, CV_32SC1);
             
-            int neighbor_label = labels.at<int>(std::min(i + 1, labels.rows - 1), j);
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
+            for (int i = 0; i < labels.rows; i++) {
+                const int* labels_i = labels.ptr<int>(i);
+                int* result_i = result.ptr<int>(i);
+                
+                for (int j = 0; j < labels.cols; j++) {
+                    int root = findRoot(parent, labels_i[j]);
+                    if (compact[root] < 0) {
+                        compact[root] = count;
+                        count++;
+                    }
+                    
+                    result_i[j] = compact[root];
                 }
             }
             
-            neighbor_label = labels.at<int>(std::max(0, i - 1), j);
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
+            next++;
+            continue;
+        }
+        
+        HierarchyMerge merge = heap.top();
+        heap.pop();
+        
+        if (versions[merge.a] != merge.version_a || versions[merge.b] != merge.version_b) {
+            continue;
+        }
+        
+        // The smaller superpixel is merged into the larger one.
+        int into = (counts[merge.a] >= counts[merge.b] ? merge.a : merge.b);
+        int from = (into == merge.a ? merge.b : merge.a);
+        
+        for (std::map<int, HierarchyEdge>::const_iterator it = edges[from].begin(); 
+                it != edges[from].end(); ++it) {
             
-            neighbor_label = labels.at<int>(i, std::min(j + 1, labels.cols - 1));
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
+            if (it->first == into) {
+                continue;
             }
             
-            neighbor_label = labels.at<int>(i, std::max(0, j - 1));
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
+            HierarchyEdge &edge = edges[into][it->first];
+            edge.length += it->second.length;
+            edge.strength += it->second.strength;
+            
+            edges[it->first].erase(from);
+            edges[it->first][into] = edge;
+        }
+        
+        edges[into].erase(from);
+        std::map<int, HierarchyEdge>().swap(edges[from]);
+        
+        parent[from] = into;
+        counts[into] += counts[from];
+        sums[into] += sums[from];
+        versions[into]++;
+        versions[from]++;
+        remaining--;
+        
+        for (std::map<int, HierarchyEdge>::const_iterator it = edges[into].begin(); 
+                it != edges[into].end(); ++it) {
+            
+            HierarchyMerge updated;
+            updated.cost = computeMergeCost(counts[into], sums[into], counts[it->first], 
+                    sums[it->first], it->second);
+            updated.a = into;
+            updated.b = it->first;
+            updated.version_a = versions[into];
+            updated.version_b = versions[it->first];
+            heap.push(updated);
         }
     }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// narrowLabels
+////////////////////////////////////////////////////////////////////////////////
+
+bool SuperpixelTools::narrowLabels(const cv::Mat &labels, cv::Mat &narrowed) {
+    LOG_IF(FATAL, labels.type() != CV_32SC1 && labels.type() != CV_16UC1) 
+            << "Invalid label type.";
     
-    for (unsigned int k = 0; k < counts.size(); k++) {
-        if (counts[k] > 0) {
-            means[k][0] /= counts[k];
-            means[k][1] /= counts[k];
-            means[k][2] /= counts[k];
-        }
+    if (labels.type() == CV_16UC1) {
+        narrowed = labels;
+        return true;
     }
     
-    std::vector<int> ids(max_label + 1, 0);
-    for (unsigned int k = 0; k < ids.size(); k++) {
-        ids[k] = k;
+    if (labels.rows <= 0 || labels.cols <= 0) {
+        return false;
     }
     
-    std::sort(ids.begin(), ids.end(), [&counts](int i, int j) {
-        return counts[i] < counts[j];
-    });
+    int min_label = 0;
+    int max_label = 0;
+    computeLabelRange<int>(labels, min_label, max_label);
     
-//    for (unsigned int k = 0; k < counts.size(); k++) {
-//        std::cout << ids[k] << ": " << counts[ids[k]] << std::endl;
-//    }
+    if (min_label < 0 || max_label > std::numeric_limits<unsigned short>::max()) {
+        return false;
+    }
     
-    int count = 0;
-    std::vector<int> new_labels(max_label + 1, -1);
+    cv::Mat result(labels.rows, labels.cols, CV_16UC1);
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        unsigned short* result_i = result.ptr<unsigned short>(i);
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            result_i[j] = labels_i[j];
+        }
+    }
     
-    for (unsigned int k = 0; k < std::min((int) counts.size(), number); k++) {
-        int label = ids[k];
+    narrowed = result;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// widenLabels
+////////////////////////////////////////////////////////////////////////////////
+
+void SuperpixelTools::widenLabels(const cv::Mat &labels, cv::Mat &widened) {
+    LOG_IF(FATAL, labels.type() != CV_32SC1 && labels.type() != CV_16UC1) 
+            << "Invalid label type.";
+    
+    if (labels.type() == CV_32SC1) {
+        widened = labels;
+        return;
+    }
+    
+    widened.create(labels.rows, labels.cols, CV_32SC1);
+    for (int i = 0; i < labels.rows; ++i) {
+        const unsigned short* labels_i = labels.ptr<unsigned short>(i);
+        int* widened_i = widened.ptr<int>(i);
         
-        float min_distance = std::numeric_limits<float>::max();
-        for (unsigned int kk = 0; kk < neighbors[label].size(); kk++) {
-            float distance = (means[label][0] - means[neighbors[label][kk]][0])*(means[label][0] - means[neighbors[label][kk]][0])
-                    + (means[label][1] - means[neighbors[label][kk]][1])*(means[label][1] - means[neighbors[label][kk]][1])
-                    + (means[label][2] - means[neighbors[label][kk]][2])*(means[label][2] - means[neighbors[label][kk]][2]);
+        for (int j = 0; j < labels.cols; ++j) {
+            widened_i[j] = labels_i[j];
+        }
+    }
+}
 
-            if (distance < min_distance && new_labels[neighbors[label][kk]] < 0) {
-                min_distance = distance;
-                new_labels[label] = neighbors[label][kk];
+////////////////////////////////////////////////////////////////////////////////
+// computeFeatures
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Run function(s) for all strips, in parallel if there is more than one.
+ * \param[in] strips number of strips
+ * \param[in] function function to run
+ */
+static void forFeatureStrips(int strips, const std::function<void(int)> &function) {
+    if (strips <= 1) {
+        function(0);
+        return;
+    }
+    
+    ThreadPool::parallelFor(0, strips, function, strips);
+}
+
+void SuperpixelTools::computeFeatures(const cv::Mat &image, const cv::Mat &labels, 
+        int bins, Features &features, int threads) {
+    
+    LOG_IF(FATAL, image.type() != CV_8UC3) << "Invalid image type.";
+    LOG_IF(FATAL, labels.type() != CV_32SC1) << "Invalid label type.";
+    LOG_IF(FATAL, labels.rows != image.rows || labels.cols != image.cols) 
+            << "Superpixel segmentation does not match image size.";
+    LOG_IF(FATAL, bins < 1 || bins > 256) << "Number of bins needs to be within [1, 256].";
+    LOG_IF(FATAL, threads <= 0) << "Number of threads needs to be positive.";
+    
+    RegionAdjacencyGraph graph(labels);
+    int S = graph.getRegions();
+    
+    features.superpixels = S;
+    features.bins = bins;
+    features.areas.resize(S);
+    features.bounding_boxes.resize(S);
+    features.offsets = graph.getOffsets();
+    features.neighbors = graph.getNeighbors();
+    
+    for (int k = 0; k < S; ++k) {
+        features.areas[k] = graph.getArea(k);
+        features.bounding_boxes[k] = graph.getBoundingBox(k);
+    }
+    
+    // Each strip accumulates into its own sums, which are added up afterwards.
+    int n_strips = std::max(1, std::min(threads, labels.rows/16));
+    std::vector< std::vector<double> > color_sums(n_strips);
+    std::vector< std::vector<double> > position_sums(n_strips);
+    std::vector< std::vector<int> > histograms(n_strips);
+    
+    // Bin of each intensity, avoiding a division per pixel.
+    int bin_of[256];
+    for (int v = 0; v < 256; ++v) {
+        bin_of[v] = (v*bins)/256;
+    }
+    
+    forFeatureStrips(n_strips, [&](int s) {
+        color_sums[s].assign(3*S, 0);
+        position_sums[s].assign(2*S, 0);
+        histograms[s].assign(3*bins*S, 0);
+        
+        double* color_sums_s = color_sums[s].data();
+        double* position_sums_s = position_sums[s].data();
+        int* histograms_s = histograms[s].data();
+        
+        int begin = (s*labels.rows)/n_strips;
+        int end = ((s + 1)*labels.rows)/n_strips;
+        
+        for (int i = begin; i < end; ++i) {
+            const int* labels_i = labels.ptr<int>(i);
+            const cv::Vec3b* image_i = image.ptr<cv::Vec3b>(i);
+            
+            for (int j = 0; j < labels.cols; ++j) {
+                int label = labels_i[j];
+                
+                for (int c = 0; c < 3; ++c) {
+                    color_sums_s[3*label + c] += image_i[j][c];
+                    histograms_s[(3*label + c)*bins + bin_of[image_i[j][c]]]++;
+                }
+                
+                position_sums_s[2*label + 0] += i;
+                position_sums_s[2*label + 1] += j;
             }
         }
+    });
+    
+    for (int s = 1; s < n_strips; ++s) {
+        for (int k = 0; k < 3*S; ++k) {
+            color_sums[0][k] += color_sums[s][k];
+        }
+        for (int k = 0; k < 2*S; ++k) {
+            position_sums[0][k] += position_sums[s][k];
+        }
+        for (int k = 0; k < 3*bins*S; ++k) {
+            histograms[0][k] += histograms[s][k];
+        }
+    }
+    
+    features.mean_colors.assign(3*S, 0);
+    features.centroids.assign(2*S, 0);
+    features.histograms.assign(3*bins*S, 0);
+    
+    for (int k = 0; k < S; ++k) {
+        if (features.areas[k] <= 0) {
+            continue;
+        }
         
-        count++;
+        double area = features.areas[k];
+        for (int c = 0; c < 3; ++c) {
+            features.mean_colors[3*k + c] = color_sums[0][3*k + c]/area;
+        }
+        for (int c = 0; c < 2; ++c) {
+            features.centroids[2*k + c] = position_sums[0][2*k + c]/area;
+        }
+        for (int b = 0; b < 3*bins; ++b) {
+            features.histograms[3*bins*k + b] = histograms[0][3*bins*k + b]/area;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// poolFeatures
+////////////////////////////////////////////////////////////////////////////////
+
+void SuperpixelTools::poolFeatures(const cv::Mat &features, const cv::Mat &labels, 
+        bool max_pooling, cv::Mat &pooled, int threads) {
+    
+    LOG_IF(FATAL, features.depth() != CV_32F) << "Invalid feature type.";
+    LOG_IF(FATAL, features.empty() || labels.empty()) << "Features and labels need to be non-empty.";
+    LOG_IF(FATAL, labels.type() != CV_32SC1) << "Invalid label type.";
+    LOG_IF(FATAL, threads <= 0) << "Number of threads needs to be positive.";
+    
+    int S = 0;
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            LOG_IF(FATAL, labels_i[j] < 0) << "Labels need to be non-negative.";
+            S = std::max(S, labels_i[j] + 1);
+        }
     }
     
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
+    int C = features.channels();
+    
+    // Nearest feature row and column of each label row and column.
+    std::vector<int> feature_rows(labels.rows);
+    std::vector<int> feature_cols(labels.cols);
+    for (int i = 0; i < labels.rows; ++i) {
+        feature_rows[i] = (int) (((int64_t) i*features.rows)/labels.rows);
+    }
+    for (int j = 0; j < labels.cols; ++j) {
+        feature_cols[j] = (int) (((int64_t) j*features.cols)/labels.cols);
+    }
+    
+    int n_strips = std::max(1, std::min(threads, labels.rows/16));
+    std::vector< std::vector<float> > values(n_strips);
+    std::vector< std::vector<int> > counts(n_strips);
+    float initial = (max_pooling ? -std::numeric_limits<float>::max() : 0.f);
+    
+    forFeatureStrips(n_strips, [&](int s) {
+        values[s].assign(S*C, initial);
+        counts[s].assign(S, 0);
+        
+        int begin = (s*labels.rows)/n_strips;
+        int end = ((s + 1)*labels.rows)/n_strips;
+        
+        for (int i = begin; i < end; ++i) {
+            const int* labels_i = labels.ptr<int>(i);
+            const float* features_i = features.ptr<float>(feature_rows[i]);
             
-            int label = labels.at<int>(i, j);
-            if (new_labels[label] >= 0) {
+            for (int j = 0; j < labels.cols; ++j) {
+                int label = labels_i[j];
+                const float* feature = features_i + feature_cols[j]*C;
+                float* value = values[s].data() + label*C;
                 
-                int new_label = new_labels[label];
-                while (new_labels[new_label] >= 0) {
-                    new_label = new_labels[new_label];
+                if (max_pooling) {
+                    for (int c = 0; c < C; ++c) {
+                        value[c] = std::max(value[c], feature[c]);
+                    }
+                }
+                else {
+                    for (int c = 0; c < C; ++c) {
+                        value[c] += feature[c];
+                    }
                 }
                 
-                labels.at<int>(i, j) = new_labels[label];
+                counts[s][label]++;
             }
         }
+    });
+    
+    for (int s = 1; s < n_strips; ++s) {
+        for (int k = 0; k < S; ++k) {
+            counts[0][k] += counts[s][k];
+        }
+        for (int k = 0; k < S*C; ++k) {
+            values[0][k] = (max_pooling ? std::max(values[0][k], values[s][k]) 
+                    : values[0][k] + values[s][k]);
+        }
     }
     
-    return count;
-}
\ No newline at end of file
+    pooled.create(S, C, CV_32FC1);
+    for (int k = 0; k < S; ++k) {
+        float* pooled_k = pooled.ptr<float>(k);
+        
+        for (int c = 0; c < C; ++c) {
+            if (counts[0][k] <= 0) {
+                pooled_k[c] = 0;
+            }
+            else {
+                pooled_k[c] = (max_pooling ? values[0][k*C + c] : values[0][k*C + c]/counts[0][k]);
+            }
+        }
+    }
+}
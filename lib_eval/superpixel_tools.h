@@ -32,6 +32,7 @@
 #ifndef SUPERPIXEL_TOOLS_H
 #define	SUPERPIXEL_TOOLS_H
 
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 /** \brief Superpixel utilities.
@@ -39,6 +40,35 @@
  */
 class SuperpixelTools {
 public:
+    /** \brief Per-superpixel features as computed by computeFeatures.
+     * 
+     * Superpixels correspond to labels \f$0, \ldots, L\f$ where \f$L\f$ is
+     * the maximum label; labels not present have zero area and zero features.
+     * All per-superpixel arrays are flat and in label order. Neighbors are
+     * stored in compressed sparse row format as in RegionAdjacencyGraph.
+     */
+    struct Features {
+        /** \brief Number of superpixels, i.e. maximum label plus one. */
+        int superpixels;
+        /** \brief Number of histogram bins per channel. */
+        int bins;
+        /** \brief Number of pixels per superpixel. */
+        std::vector<int> areas;
+        /** \brief Mean color, 3 values per superpixel in image channel order. */
+        std::vector<float> mean_colors;
+        /** \brief Centroid as row and column, 2 values per superpixel. */
+        std::vector<float> centroids;
+        /** \brief Bounding box per superpixel, empty for labels not present. */
+        std::vector<cv::Rect> bounding_boxes;
+        /** \brief Color histograms normalized by area, 3*bins values per 
+         * superpixel, the bins of the first channel first. */
+        std::vector<float> histograms;
+        /** \brief Row offsets into neighbors, of size superpixels + 1. */
+        std::vector<int> offsets;
+        /** \brief 4-connected neighbors of all superpixels in ascending order. */
+        std::vector<int> neighbors;
+    };
+    
     /** \brief Compute region size from desired number of superpixels.
      * \param[in] image image for number of rows and cols
      * \param[in] superpixels number of desired superpixels
@@ -46,6 +76,29 @@ public:
      */
     static int computeRegionSizeFromSuperpixels(const cv::Mat &image, int superpixels);
     
+    /** \brief Estimate how complex an image is to segment, e.g. to choose the
+     * number of superpixels per image using computeAdaptiveSuperpixels.
+     * 
+     * Averages the gradient energy, i.e. the fraction of pixels with normalized
+     * gradient magnitude (Evaluation::computeGradientMagnitude) above 0.1
+     * relative to 25% of the pixels, and the spread of the per-channel color
+     * histograms of the whole image (the top-level histograms of HHTS), i.e.
+     * their normalized entropy.
+     * \param[in] image image to estimate the complexity of
+     * \return complexity in [0,1]
+     */
+    static float computeComplexity(const cv::Mat &image);
+    
+    /** \brief Scale the number of superpixels by complexity such that simple
+     * images use fewer superpixels.
+     * \param[in] superpixels number of superpixels used for the most complex images
+     * \param[in] min_fraction fraction of superpixels used for the simplest images
+     * \param[in] complexity complexity as computed by computeComplexity
+     * \return number of superpixels, at least one
+     */
+    static int computeAdaptiveSuperpixels(int superpixels, float min_fraction, 
+            float complexity);
+    
     /** \brief Compute width and height for the given number of superpixels.
      * \param[in] image image for the number of rows and cols
      * \param[in] superpixels number of desired superpixels
@@ -75,7 +128,7 @@ public:
             int superpixels, int &region_size, int &levels);
     
     /** \brief Relabel superpixel segmentation.
-     * \param[in] labels superpixel labels to relabel
+     * \param[in] labels superpixel labels to relabel as CV_32SC1 or CV_16UC1
      */
     static void relabelSuperpixels(cv::Mat &labels);
     
@@ -100,35 +153,129 @@ public:
             const cv::Mat &boundaries, cv::Mat &labels, int BOUNDARY_VALUE = -1);
     
     /** \brief Count number of superpixels.
-     * \param[in] labels superpixel labels
+     * \param[in] labels superpixel labels as CV_32SC1 or CV_16UC1
      * \return number of superpixels
      */
     static int countSuperpixels(const cv::Mat &labels);
     
+    /** \brief Convert labels to CV_16UC1 if all labels are within [0, 65535],
+     * halving memory and storage of the label map.
+     * \param[in] labels superpixel labels as CV_32SC1 or CV_16UC1
+     * \param[out] narrowed labels as CV_16UC1, only set if narrowing is possible
+     * \return whether the labels could be narrowed
+     */
+    static bool narrowLabels(const cv::Mat &labels, cv::Mat &narrowed);
+    
+    /** \brief Convert labels to CV_32SC1 as expected by most functions in Evaluation.
+     * \param[in] labels superpixel labels as CV_32SC1 or CV_16UC1
+     * \param[out] widened labels as CV_32SC1, shares data if already CV_32SC1
+     */
+    static void widenLabels(const cv::Mat &labels, cv::Mat &widened);
+    
     /** \brief Relabel superpixels based on connected components.
-     * \param[in] labels superpixel labels to relabel as connected
+     * 
+     * Works in place in a single labeling pass and a single relabeling pass;
+     * components are numbered as by ConnectedComponents. With multiple threads,
+     * horizontal strips are labeled in parallel and connected afterwards; the
+     * result does not depend on the number of threads.
+     * 
+     * \param[in,out] labels superpixel labels to relabel as connected; CV_16UC1
+     * labels stay CV_16UC1 unless the components exceed the 16-bit range
+     * \param[in] threads number of threads, at most those of ThreadPool::getGlobal
+     * \return number of components exceeding the number of original superpixels
      */
-    static int relabelConnectedSuperpixels(cv::Mat &labels);
+    static int relabelConnectedSuperpixels(cv::Mat &labels, int threads = 1);
     
     /** \brief Enforce the minimum segment size by merging small superpixels
      * with similar neighboring superpixels.
+     * 
+     * By default, every superpixel below the given size is merged into the
+     * neighbor with the most similar mean color, deciding all merges on the
+     * initial superpixels (in label order, skipping neighbors which are merged
+     * themselves). With track_merges, superpixels are instead merged smallest
+     * first and sizes and mean colors are updated after each merge, until all
+     * superpixels have at least the given size; labels then differ from the
+     * default.
+     * 
      * \param[in] image image to enforce minimum superpixel size for
      * \param[in] labels superpixel labels
      * \param[in] size minimum superpixel size
-     * \return new number of superpixels
+     * \param[in] track_merges whether to update sizes and mean colors after
+     * each merge
+     * \return number of merged superpixels
      */
     static int enforceMinimumSuperpixelSize(const cv::Mat &image, cv::Mat &labels, 
-            int size);
+            int size, bool track_merges = false);
     
     /** \brief Enforce the minimum segment size by merging small superpixels
      * with similar neighboring superpixels such that the given number of
      * superpixels is merged.
+     * 
+     * Superpixels are merged smallest first into the neighbor with the most
+     * similar mean color; as for enforceMinimumSuperpixelSize, the merges are
+     * decided on the initial superpixels unless track_merges is set.
+     * 
      * \param[in] image image to enforce minimum superpixels on
      * \param[in] labels superpixel labels
-     * \param[in] number number of desired superpixels after enforcing minimum size
+     * \param[in] number number of superpixels to merge
+     * \param[in] track_merges whether to update sizes and mean colors after
+     * each merge
+     * \return number of merged superpixels
      */
     static int enforceMinimumSuperpixelSizeUpTo(const cv::Mat &image, cv::Mat &labels, 
-            int number);
+            int number, bool track_merges = false);
+    
+    /** \brief Derive coarser segmentations from a fine one by greedily merging
+     * adjacent superpixels.
+     * 
+     * Superpixels are nodes of the region adjacency graph; the adjacent pair
+     * with the lowest cost is merged first, where the cost is the area of the
+     * smaller superpixel times the sum of the squared difference of the mean
+     * colors and the squared mean color difference across the shared boundary.
+     * Merges are taken from a heap, costs of the merged superpixel are updated
+     * lazily. The segmentation is recorded whenever the number of superpixels 
+     * reaches one of the given numbers, such that a single fine segmentation 
+     * approximates segmentations for all numbers.
+     * 
+     * \param[in] image image as CV_8UC3
+     * \param[in] labels fine superpixel labels as CV_32SC1
+     * \param[in] superpixels numbers of superpixels, in any order; numbers
+     * above the number of fine superpixels yield the fine segmentation
+     * \param[out] hierarchy superpixel labels as CV_32SC1 for each number
+     */
+    static void computeHierarchy(const cv::Mat &image, const cv::Mat &labels, 
+            const std::vector<int> &superpixels, std::vector<cv::Mat> &hierarchy);
+    
+    /** \brief Compute mean color, color histogram, centroid, bounding box and
+     * neighbors of all superpixels.
+     * 
+     * Neighbors and bounding boxes are taken from RegionAdjacencyGraph; colors,
+     * histograms and centroids are accumulated in a single pass over the
+     * pixels, split into horizontal strips when using multiple threads.
+     * 
+     * \param[in] image image as CV_8UC3
+     * \param[in] labels superpixel labels as CV_32SC1
+     * \param[in] bins number of histogram bins per channel, within [1, 256]
+     * \param[out] features computed features
+     * \param[in] threads number of threads, at most those of ThreadPool::getGlobal
+     */
+    static void computeFeatures(const cv::Mat &image, const cv::Mat &labels, 
+            int bins, Features &features, int threads = 1);
+    
+    /** \brief Average or max pool a feature map over superpixels.
+     * 
+     * The feature map may have a lower resolution than the labels, e.g. CNN
+     * activations; each pixel then takes the nearest feature vector.
+     * 
+     * \param[in] features feature map of depth CV_32F with any number of channels
+     * \param[in] labels superpixel labels as CV_32SC1
+     * \param[in] max_pooling whether to use max pooling instead of average pooling
+     * \param[out] pooled pooled features as CV_32FC1 with one row per superpixel
+     * and one column per channel; zero for labels not present
+     * \param[in] threads number of threads, at most those of ThreadPool::getGlobal
+     */
+    static void poolFeatures(const cv::Mat &features, const cv::Mat &labels, 
+            bool max_pooling, cv::Mat &pooled, int threads = 1);
 
 };
 
@@ -0,0 +1,318 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <glog/logging.h>
+#include "numa_topology.h"
+#include "thread_pool.h"
+
+/** \brief Pool the calling thread is a worker of, if any. */
+static thread_local ThreadPool* worker_pool = NULL;
+/** \brief Index of the calling worker in worker_pool. */
+static thread_local int worker_index = -1;
+
+/** \brief Protects global_pool. */
+static std::mutex global_mutex;
+/** \brief Global pool, created on first use. */
+static std::unique_ptr<ThreadPool> global_pool;
+
+////////////////////////////////////////////////////////////////////////////////
+// TaskGroup
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::TaskGroup::TaskGroup(ThreadPool &pool) 
+        : pool(pool), pending(0) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ~TaskGroup
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::TaskGroup::~TaskGroup() {
+    wait();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// TaskGroup::run
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::TaskGroup::run(const std::function<void()> &task) {
+    ++pending;
+    
+    Task pool_task;
+    pool_task.function = task;
+    pool_task.group = this;
+    pool.submit(pool_task);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// TaskGroup::wait
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::TaskGroup::wait() {
+    // Executing other tasks while waiting makes nested parallelism safe.
+    while (pending > 0) {
+        if (!pool.execute()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ThreadPool
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::ThreadPool(int threads, bool numa) 
+        : queued(0), next_queue(0), stopping(false) {
+    
+    // Thread t (the calling thread being 0) runs on node t*nodes/threads, 
+    // i.e. consecutive threads share a node.
+    int nodes = NumaTopology::getNodes();
+    if (numa && !NumaTopology::pinThreadToNode(0)) {
+        LOG(WARNING) << "Could not pin the calling thread to NUMA node 0.";
+    }
+    
+    for (int k = 1; k < threads; ++k) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+        queues.back()->node = (numa ? k*nodes/threads : -1);
+    }
+    
+    // Own deque first (see execute), then the deques of the same node, then
+    // all others, each starting with the next worker.
+    int n = queues.size();
+    steal_order.resize(n);
+    for (int own = 0; own < n; ++own) {
+        for (int same = 1; same >= 0; --same) {
+            for (int k = 1; k < n; ++k) {
+                int index = (own + k) % n;
+                if ((queues[index]->node == queues[own]->node) == (same == 1)) {
+                    steal_order[own].push_back(index);
+                }
+            }
+        }
+    }
+    
+    for (int k = 1; k < threads; ++k) {
+        workers.push_back(std::thread(&ThreadPool::work, this, k - 1));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ~ThreadPool
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    
+    sleep_condition.notify_all();
+    for (unsigned int k = 0; k < workers.size(); ++k) {
+        workers[k].join();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getThreads
+////////////////////////////////////////////////////////////////////////////////
+
+int ThreadPool::getThreads() const {
+    return workers.size() + 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// run
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::run(int begin, int end, const std::function<void(int)> &function, 
+        int threads) {
+    
+    int n_threads = (threads <= 0) ? getThreads() : std::min(threads, getThreads());
+    n_threads = std::min(n_threads, end - begin);
+    
+    if (n_threads <= 1) {
+        for (int i = begin; i < end; ++i) {
+            function(i);
+        }
+        
+        return;
+    }
+    
+    // The calling thread takes part; tasks that start after all indices are
+    // claimed return immediately.
+    std::atomic<int> next(begin);
+    std::function<void()> loop = [&]() {
+        for (int i = next++; i < end; i = next++) {
+            function(i);
+        }
+    };
+    
+    TaskGroup group(*this);
+    for (int k = 1; k < n_threads; ++k) {
+        group.run(loop);
+    }
+    
+    loop();
+    group.wait();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setGlobalThreads
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::setGlobalThreads(int threads, bool numa) {
+    std::lock_guard<std::mutex> lock(global_mutex);
+    global_pool.reset(new ThreadPool(std::max(1, threads), numa));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getGlobal
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool& ThreadPool::getGlobal() {
+    std::lock_guard<std::mutex> lock(global_mutex);
+    if (!global_pool) {
+        global_pool.reset(new ThreadPool(std::max(1u, std::thread::hardware_concurrency())));
+    }
+    
+    return *global_pool;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// parallelFor
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int)> &function, 
+        int threads) {
+    
+    getGlobal().run(begin, end, function, threads);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// submit
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::submit(const Task &task) {
+    if (queues.empty()) {
+        task.function();
+        --task.group->pending;
+        return;
+    }
+    
+    unsigned int index = (worker_pool == this) ? worker_index : next_queue++ % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(task);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        ++queued;
+    }
+    
+    sleep_condition.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// execute
+////////////////////////////////////////////////////////////////////////////////
+
+bool ThreadPool::execute() {
+    int n = queues.size();
+    int own = (worker_pool == this) ? worker_index : -1;
+    
+    Task task;
+    bool found = false;
+    
+    // Own tasks are taken from the back, i.e. most recent first.
+    if (own >= 0) {
+        std::lock_guard<std::mutex> lock(queues[own]->mutex);
+        if (!queues[own]->tasks.empty()) {
+            task = queues[own]->tasks.back();
+            queues[own]->tasks.pop_back();
+            found = true;
+        }
+    }
+    
+    // Other tasks are stolen from the front, i.e. oldest first; workers
+    // prefer deques of their own node.
+    for (int k = 0; k < (own >= 0 ? n - 1 : n) && !found; ++k) {
+        int index = (own >= 0 ? steal_order[own][k] : k);
+        
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        if (!queues[index]->tasks.empty()) {
+            task = queues[index]->tasks.front();
+            queues[index]->tasks.pop_front();
+            found = true;
+        }
+    }
+    
+    if (!found) {
+        return false;
+    }
+    
+    --queued;
+    task.function();
+    --task.group->pending;
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// work
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::work(int index) {
+    worker_pool = this;
+    worker_index = index;
+    
+    if (queues[index]->node >= 0 && !NumaTopology::pinThreadToNode(queues[index]->node)) {
+        LOG(WARNING) << "Could not pin worker " << index << " to NUMA node " 
+                << queues[index]->node << ".";
+    }
+    
+    while (true) {
+        if (execute()) {
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleep_condition.wait(lock, [this]() {
+            return queued > 0 || stopping;
+        });
+        
+        if (stopping && queued <= 0) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,208 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef THREAD_POOL_H
+#define	THREAD_POOL_H
+
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+/** \brief Work-stealing thread pool shared by evaluation, command line tools
+ * and algorithms instead of spawning threads per call.
+ * 
+ * Each worker owns a deque of tasks: tasks submitted by a worker are pushed to
+ * and popped from the back of its own deque, idle workers steal from the front 
+ * of other deques. A thread waiting for a task group executes pending tasks
+ * instead of blocking, such that parallel loops can be nested (e.g. images in
+ * parallel, rows of each image in parallel) without deadlocks and without 
+ * running more threads than the pool has.
+ * 
+ * The global pool is sized by setGlobalThreads, usually from --threads of
+ * the command line tools; the calling thread counts as one of the threads.
+ * 
+ * On multi-socket machines, the threads can be spread evenly over the NUMA
+ * nodes (see NumaTopology), the calling thread on the first node; idle
+ * workers then steal from workers of the same node first, such that tasks
+ * and the memory they first touch tend to stay on one node.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   ThreadPool::setGlobalThreads(4);
+ *   
+ *   // Images in parallel, each relabeled using up to 4 threads as well.
+ *   ThreadPool::parallelFor(0, n, [&](int i) {
+ *       SuperpixelTools::relabelConnectedSuperpixels(labels[i], 4);
+ *   });
+ * \endcode
+ * \author David Stutz
+ */
+class ThreadPool {
+public:
+    
+    /** \brief Group of tasks that can be waited for. */
+    class TaskGroup {
+    public:
+        
+        /** \brief Constructor.
+         * \param[in] pool pool to run the tasks on
+         */
+        TaskGroup(ThreadPool &pool);
+        
+        /** \brief Destructor, waits for all tasks. */
+        ~TaskGroup();
+        
+        /** \brief Submit a task.
+         * \param[in] task task
+         */
+        void run(const std::function<void()> &task);
+        
+        /** \brief Wait for all tasks, executing pending tasks meanwhile. */
+        void wait();
+        
+    private:
+        
+        friend class ThreadPool;
+        
+        /** \brief Pool. */
+        ThreadPool &pool;
+        /** \brief Number of submitted tasks not yet finished. */
+        std::atomic<int> pending;
+    };
+    
+    /** \brief Constructor.
+     * \param[in] threads number of threads including the calling thread, i.e.
+     * threads - 1 workers are started
+     * \param[in] numa whether to pin the threads, including the calling
+     * thread, to NUMA nodes
+     */
+    ThreadPool(int threads, bool numa = false);
+    
+    /** \brief Destructor, finishes pending tasks and joins the workers. */
+    ~ThreadPool();
+    
+    /** \brief Get the number of threads including the calling thread.
+     * \return number of threads
+     */
+    int getThreads() const;
+    
+    /** \brief Run function(i) for all i in [begin, end); indices are claimed
+     * one at a time by up to the given number of threads.
+     * \param[in] begin first index
+     * \param[in] end end index
+     * \param[in] function function to call
+     * \param[in] threads maximum number of threads, 0 for all threads of the pool
+     */
+    void run(int begin, int end, const std::function<void(int)> &function, int threads = 0);
+    
+    /** \brief Set the number of threads of the global pool; must not be called
+     * while the global pool is in use.
+     * \param[in] threads number of threads including the calling thread
+     * \param[in] numa whether to pin the threads to NUMA nodes
+     */
+    static void setGlobalThreads(int threads, bool numa = false);
+    
+    /** \brief Get the global pool, by default with one thread per core.
+     * \return global pool
+     */
+    static ThreadPool& getGlobal();
+    
+    /** \brief Run function(i) for all i in [begin, end) on the global pool, see run.
+     * \param[in] begin first index
+     * \param[in] end end index
+     * \param[in] function function to call
+     * \param[in] threads maximum number of threads, 0 for all threads of the pool
+     */
+    static void parallelFor(int begin, int end, const std::function<void(int)> &function, 
+            int threads = 0);
+    
+private:
+    
+    /** \brief A submitted task. */
+    struct Task {
+        /** \brief Function to run. */
+        std::function<void()> function;
+        /** \brief Group of the task. */
+        TaskGroup* group;
+    };
+    
+    /** \brief Deque of a worker. */
+    struct Queue {
+        /** \brief Tasks. */
+        std::deque<Task> tasks;
+        /** \brief Protects tasks. */
+        std::mutex mutex;
+        /** \brief NUMA node of the worker, -1 if not pinned. */
+        int node;
+    };
+    
+    /** \brief Submit a task to the deque of the calling worker or, for other
+     * threads, to the deques in turn.
+     * \param[in] task task
+     */
+    void submit(const Task &task);
+    
+    /** \brief Execute a single pending task, own tasks first.
+     * \return whether a task was executed
+     */
+    bool execute();
+    
+    /** \brief Main loop of a worker.
+     * \param[in] index index of the worker
+     */
+    void work(int index);
+    
+    /** \brief Deques of the workers. */
+    std::vector<std::unique_ptr<Queue> > queues;
+    /** \brief Per worker, the deques to steal from in order: deques of the
+     * same node first. */
+    std::vector<std::vector<int> > steal_order;
+    /** \brief Workers. */
+    std::vector<std::thread> workers;
+    /** \brief Number of tasks in all deques. */
+    std::atomic<int> queued;
+    /** \brief Deque to submit the next task of a non-worker thread to. */
+    std::atomic<unsigned int> next_queue;
+    /** \brief Whether the workers should exit. */
+    bool stopping;
+    /** \brief Protects stopping and sleeping workers. */
+    std::mutex sleep_mutex;
+    /** \brief Wakes sleeping workers. */
+    std::condition_variable sleep_condition;
+    
+};
+
+#endif	/* THREAD_POOL_H */
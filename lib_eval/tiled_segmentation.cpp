@@ -0,0 +1,285 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <glog/logging.h>
+#include <boost/lexical_cast.hpp>
+#include "superpixel_tools.h"
+#include "thread_pool.h"
+#include "tiled_segmentation.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// computeTiles
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Distribute tiles evenly along one dimension such that neighboring
+ * tiles overlap by at least the given overlap.
+ * \param[in] size size of the dimension
+ * \param[in] tile_size size of the tiles
+ * \param[in] overlap minimum overlap
+ * \param[out] starts first index of each tile
+ * \param[out] ends end index of each tile
+ */
+static void computeTiles(int size, int tile_size, int overlap, 
+        std::vector<int> &starts, std::vector<int> &ends) {
+    
+    starts.clear();
+    ends.clear();
+    
+    if (size <= tile_size) {
+        starts.push_back(0);
+        ends.push_back(size);
+        return;
+    }
+    
+    int step = tile_size - overlap;
+    int count = 1 + (size - tile_size + step - 1)/step;
+    
+    for (int k = 0; k < count; k++) {
+        int start = (int) (((long long) k*(size - tile_size))/(count - 1));
+        starts.push_back(start);
+        ends.push_back(start + tile_size);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// TiledSegmentation
+////////////////////////////////////////////////////////////////////////////////
+
+TiledSegmentation::TiledSegmentation(const std::string &algorithm_, 
+        const Parameters &parameters_, int tile_size_, int overlap_) 
+        : algorithm(algorithm_), parameters(parameters_), tile_size(tile_size_), 
+        overlap(overlap_) {
+    
+    LOG_IF(FATAL, !SuperpixelAlgorithmRegistry::has(algorithm)) 
+            << "Algorithm not registered: " << algorithm << ".";
+    LOG_IF(FATAL, overlap < 0 || 2*overlap >= tile_size) 
+            << "Overlap needs to be non-negative and less than half the tile size.";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// segment
+////////////////////////////////////////////////////////////////////////////////
+
+void TiledSegmentation::segment(const cv::Mat &image, cv::Mat &labels) {
+    labels.create(image.rows, image.cols, CV_32SC1);
+    segment(image, [&labels](int row, const cv::Mat &rows) {
+        cv::Mat destination = labels.rowRange(row, row + rows.rows);
+        rows.copyTo(destination);
+    });
+}
+
+int TiledSegmentation::segment(const cv::Mat &image, const RowsCallback &callback) {
+    LOG_IF(FATAL, image.type() != CV_8UC3) << "Image needs to be of type CV_8UC3.";
+    
+    if (image.rows <= 0 || image.cols <= 0) {
+        return 0;
+    }
+    
+    std::vector<int> row_starts;
+    std::vector<int> row_ends;
+    computeTiles(image.rows, tile_size, overlap, row_starts, row_ends);
+    
+    std::vector<int> col_starts;
+    std::vector<int> col_ends;
+    computeTiles(image.cols, tile_size, overlap, col_starts, col_ends);
+    
+    int superpixels = getInt(parameters, "superpixels", 400);
+    double area = image.rows*(double) image.cols;
+    
+    parents.clear();
+    
+    // Consecutive output label of each root, -1 if not yet emitted.
+    std::vector<int> compact;
+    int count = 0;
+    int emitted = 0;
+    
+    cv::Mat previous;
+    for (unsigned int i = 0; i < row_starts.size(); i++) {
+        int r0 = row_starts[i];
+        int r1 = row_ends[i];
+        
+        std::vector<cv::Mat> tiles(col_starts.size());
+        ThreadPool::parallelFor(0, col_starts.size(), [&](int j) {
+            cv::Rect rect(col_starts[j], r0, col_ends[j] - col_starts[j], r1 - r0);
+            
+            Parameters tile_parameters = parameters;
+            tile_parameters["superpixels"] = boost::lexical_cast<std::string>(
+                    std::max(1, (int) (superpixels*(rect.width*(double) rect.height)/area + 0.5)));
+            
+            std::unique_ptr<SuperpixelAlgorithm> instance(
+                    SuperpixelAlgorithmRegistry::create(algorithm, tile_parameters));
+            
+            // Most algorithms expect continuous images.
+            cv::Mat tile_image = image(rect).clone();
+            instance->segment(tile_image, tiles[j]);
+            SuperpixelTools::relabelSuperpixels(tiles[j]);
+        });
+        
+        cv::Mat current(r1 - r0, image.cols, CV_32SC1, cv::Scalar(0));
+        for (unsigned int j = 0; j < col_starts.size(); j++) {
+            const cv::Mat &tile = tiles[j];
+            int c0 = col_starts[j];
+            int c1 = col_ends[j];
+            
+            int tile_superpixels = 0;
+            for (int y = 0; y < tile.rows; y++) {
+                const int* row = tile.ptr<int>(y);
+                for (int x = 0; x < tile.cols; x++) {
+                    tile_superpixels = std::max(tile_superpixels, row[x] + 1);
+                }
+            }
+            
+            int offset = parents.size();
+            for (int k = 0; k < tile_superpixels; k++) {
+                parents.push_back(offset + k);
+            }
+            
+            // Votes of the tile's superpixels for the stitched superpixels
+            // in the overlaps with the tiles above and to the left.
+            std::map<std::pair<int, int>, int> votes;
+            std::vector<int> tile_counts(tile_superpixels, 0);
+            std::map<int, int> stitched_counts;
+            
+            int top_end = (i > 0 ? row_ends[i - 1] : r0);
+            int left_end = (j > 0 ? col_ends[j - 1] : c0);
+            for (int y = r0; y < r1; y++) {
+                bool top = (y < top_end);
+                int x_end = (top ? c1 : std::min(left_end, c1));
+                
+                const int* tile_row = tile.ptr<int>(y - r0);
+                const int* stitched_row = (top ? previous.ptr<int>(y - row_starts[i - 1]) 
+                        : current.ptr<int>(y - r0));
+                
+                for (int x = c0; x < x_end; x++) {
+                    int label = tile_row[x - c0];
+                    int stitched = find(stitched_row[x]);
+                    
+                    votes[std::make_pair(label, stitched)]++;
+                    tile_counts[label]++;
+                    stitched_counts[stitched]++;
+                }
+            }
+            
+            std::vector<int> best(tile_superpixels, -1);
+            std::vector<int> best_votes(tile_superpixels, 0);
+            for (std::map<std::pair<int, int>, int>::const_iterator it = votes.begin(); 
+                    it != votes.end(); ++it) {
+                
+                if (it->second > best_votes[it->first.first]) {
+                    best[it->first.first] = it->first.second;
+                    best_votes[it->first.first] = it->second;
+                }
+            }
+            
+            // Mutual majority, so each stitched superpixel absorbs at most
+            // one superpixel of the tile.
+            for (int k = 0; k < tile_superpixels; k++) {
+                if (best[k] >= 0 && 2*best_votes[k] > tile_counts[k] 
+                        && 2*best_votes[k] > stitched_counts[best[k]]) {
+                    parents[offset + k] = best[k];
+                }
+            }
+            
+            // Within the overlap, pixels are taken from the nearer tile.
+            int own_c0 = (j > 0 ? (c0 + col_ends[j - 1])/2 : 0);
+            for (int y = r0; y < r1; y++) {
+                const int* tile_row = tile.ptr<int>(y - r0);
+                int* current_row = current.ptr<int>(y - r0);
+                
+                for (int x = own_c0; x < c1; x++) {
+                    current_row[x] = offset + tile_row[x - c0];
+                }
+            }
+        }
+        
+        compact.resize(parents.size(), -1);
+        
+        // As superpixels are only merged into previous ones, the rows owned
+        // by this band are final.
+        int end = (i + 1 < row_starts.size() ? (row_starts[i + 1] + r1)/2 : image.rows);
+        cv::Mat rows(end - emitted, image.cols, CV_32SC1);
+        for (int y = emitted; y < end; y++) {
+            const int* current_row = current.ptr<int>(y - r0);
+            int* row = rows.ptr<int>(y - emitted);
+            
+            for (int x = 0; x < image.cols; x++) {
+                int root = find(current_row[x]);
+                if (compact[root] < 0) {
+                    compact[root] = count;
+                    count++;
+                }
+                
+                row[x] = compact[root];
+            }
+        }
+        
+        callback(emitted, rows);
+        emitted = end;
+        previous = current;
+    }
+    
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// create
+////////////////////////////////////////////////////////////////////////////////
+
+SuperpixelAlgorithm* TiledSegmentation::create(const Parameters &parameters) {
+    Parameters::const_iterator it = parameters.find("algorithm");
+    if (it == parameters.end() || !SuperpixelAlgorithmRegistry::has(it->second)) {
+        return NULL;
+    }
+    
+    Parameters algorithm_parameters = parameters;
+    algorithm_parameters.erase("algorithm");
+    algorithm_parameters.erase("tile-size");
+    algorithm_parameters.erase("overlap");
+    
+    return new TiledSegmentation(it->second, algorithm_parameters, 
+            getInt(parameters, "tile-size", 1024), getInt(parameters, "overlap", 64));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// find
+////////////////////////////////////////////////////////////////////////////////
+
+int TiledSegmentation::find(int label) {
+    while (parents[label] != label) {
+        parents[label] = parents[parents[label]];
+        label = parents[label];
+    }
+    
+    return label;
+}
@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TILED_SEGMENTATION_H
+#define	TILED_SEGMENTATION_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include "superpixel_algorithm.h"
+
+/** \brief Segments large images in overlapping tiles using any registered
+ * algorithm and stitches the tiles into one label map.
+ * 
+ * The image is processed in bands of tiles of the given size, overlapping by
+ * the given number of pixels; the tiles of a band are segmented in parallel
+ * on the global ThreadPool, each by its own instance of the algorithm with the
+ * number of superpixels scaled to the tile's area. Within an overlap, each
+ * pixel is taken from the nearer tile. Superpixels are reconciled along the
+ * seams by voting in the overlaps: a superpixel of the new tile is merged 
+ * (using union-find) into the superpixel of the previous tiles it overlaps
+ * most if both cover at least half of each other's pixels in the overlap.
+ * 
+ * As a superpixel is only ever merged into previous superpixels, the rows
+ * of a band are final once the band is stitched; they are passed to a
+ * callback as soon as possible, such that only two bands of labels are kept
+ * in memory and the label map can be streamed to disk.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   SuperpixelAlgorithms::registerAll();
+ *   TiledSegmentation tiled("slic", 
+ *           SuperpixelAlgorithm::parseParameters("superpixels=100000"), 2048, 64);
+ *   
+ *   tiled.segment(image, [&](int row, const cv::Mat &labels) {
+ *       // labels holds rows row to row + labels.rows - 1 of the label map.
+ *   });
+ * \endcode
+ * 
+ * Registered by SuperpixelAlgorithms::registerAll as "tiled", see
+ * create.
+ * \author David Stutz
+ */
+class TiledSegmentation : public SuperpixelAlgorithm {
+public:
+    
+    /** \brief Callback receiving consecutive rows of the stitched labels. */
+    typedef std::function<void(int, const cv::Mat&)> RowsCallback;
+    
+    /** \brief Constructor.
+     * \param[in] algorithm name of the registered algorithm
+     * \param[in] parameters parameters of the algorithm, "superpixels" refers
+     * to the whole image
+     * \param[in] tile_size size of the (quadratic) tiles
+     * \param[in] overlap overlap of neighboring tiles in pixels
+     */
+    TiledSegmentation(const std::string &algorithm, const Parameters &parameters, 
+            int tile_size = 1024, int overlap = 64);
+    
+    /** \brief Compute the stitched superpixels of the whole image.
+     * \param[in] image CV_8UC3 image to compute superpixels on
+     * \param[out] labels superpixel labels as CV_32SC1
+     */
+    void segment(const cv::Mat &image, cv::Mat &labels);
+    
+    /** \brief Compute the stitched superpixels, passing rows as they are
+     * final; labels are consecutive in the order of first occurrence.
+     * \param[in] image CV_8UC3 image to compute superpixels on
+     * \param[in] callback called with the first row and the labels of 
+     * consecutive rows, top to bottom
+     * \return number of superpixels
+     */
+    int segment(const cv::Mat &image, const RowsCallback &callback);
+    
+    /** \brief Create from parameters: "algorithm" names the algorithm, 
+     * "tile-size" and "overlap" configure the tiles (default 1024 and 64),
+     * all other parameters are passed to the algorithm.
+     * \param[in] parameters parameters
+     * \return algorithm, the caller takes ownership
+     */
+    static SuperpixelAlgorithm* create(const Parameters &parameters);
+    
+private:
+    
+    /** \brief Find the root of a superpixel, compressing the path.
+     * \param[in] label superpixel
+     * \return root
+     */
+    int find(int label);
+    
+    /** \brief Name of the algorithm. */
+    std::string algorithm;
+    /** \brief Parameters of the algorithm. */
+    Parameters parameters;
+    /** \brief Size of the tiles. */
+    int tile_size;
+    /** \brief Overlap of the tiles. */
+    int overlap;
+    /** \brief Union-find parents of all superpixels of the current image. */
+    std::vector<int> parents;
+    
+};
+
+#endif	/* TILED_SEGMENTATION_H */
@@ -29,35 +29,88 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <random>
+#include <algorithm>
+#include <limits>
+#include <vector>
 #include <glog/logging.h>
+#include "philox.h"
 #include "transformation.h"
 
+/** \brief Streams (second key word) of the noise functions, so that different
+ * noise types do not share random numbers for the same seed.
+ */
+enum NoiseStream {
+    GAUSSIAN_ADDITIVE = 1,
+    GAUSSIAN_SAMPLING = 2,
+    SALT_AND_PEPPER = 3,
+    POISSON = 4
+};
+
+/** \brief Fill the four random numbers of each pixel in the given row.
+ */
+inline void generateRow(int i, int cols, unsigned int seed, NoiseStream stream, 
+        std::vector<uint32_t> &r) {
+    
+    r.resize(4*cols);
+    for (int j = 0; j < cols; j++) {
+        Philox::generate(j, i, 0, 0, seed, stream, &r[4*j]);
+    }
+}
+
+/** \brief Poisson CDF tables for means 0 to 255, truncated at 255.
+ */
+const std::vector<float>& poissonTables() {
+    
+    static const std::vector<float> tables = []() {
+        std::vector<float> cdf(256*256);
+        for (int lambda = 0; lambda < 256; lambda++) {
+            // Probabilities in log space; exp(-lambda) underflows in float.
+            double sum = 0;
+            for (int k = 0; k < 256; k++) {
+                double log_p = (lambda > 0) ? k*std::log((double) lambda) - lambda - std::lgamma(k + 1.0) 
+                        : (k == 0 ? 0 : -std::numeric_limits<double>::infinity());
+                sum += std::exp(log_p);
+                cdf[256*lambda + k] = sum;
+            }
+            
+            cdf[256*lambda + 255] = 1;
+        }
+        
+        return cdf;
+    }();
+    
+    return tables;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Transformation::applyGaussianAdditiveNoise
 ////////////////////////////////////////////////////////////////////////////////
 
 void Transformation::applyGaussianAdditiveNoise(const cv::Mat &image, float variance, 
-        cv::Mat &noisy_image) {
+        cv::Mat &noisy_image, unsigned int seed) {
     
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only color images are supported.";
     LOG_IF(FATAL, variance <= 0) << "Invalid variance.";
     
-    std::random_device random;
-    std::mt19937 gen(random());
-    std::normal_distribution<float> g(0, variance);
+    std::vector<uint32_t> r;
+    std::vector<float> g(4*image.cols);
     
     noisy_image.create(image.rows, image.cols, image.type());
     for (int i = 0; i < image.rows; i++) {
+        generateRow(i, image.cols, seed, GAUSSIAN_ADDITIVE, r);
+        for (int j = 0; j < 2*image.cols; j++) {
+            Philox::normal(r[2*j], r[2*j + 1], g[2*j], g[2*j + 1]);
+        }
+        
+        const unsigned char* image_ptr = image.ptr<unsigned char>(i);
+        unsigned char* noisy_ptr = noisy_image.ptr<unsigned char>(i);
+        
         for (int j = 0; j < image.cols; j++) {
-            
-            cv::Vec3b noisy_color = image.at<cv::Vec3b>(i, j);
-            noisy_color[0] = std::max(0, std::min(255, (int) (noisy_color[0] + g(gen))));
-            noisy_color[1] = std::max(0, std::min(255, (int) (noisy_color[1] + g(gen))));
-            noisy_color[2] = std::max(0, std::min(255, (int) (noisy_color[2] + g(gen))));
-            
-            noisy_image.at<cv::Vec3b>(i, j) = noisy_color;
+            for (int c = 0; c < 3; c++) {
+                noisy_ptr[3*j + c] = std::max(0, std::min(255, 
+                        (int) (image_ptr[3*j + c] + variance*g[4*j + c])));
+            }
         }
     }
 }
@@ -67,16 +120,12 @@ void Transformation::applyGaussianAdditiveNoise(const cv::Mat &image, float vari
 ////////////////////////////////////////////////////////////////////////////////
 
 void Transformation::applyGaussianSamplingErrors(const cv::Mat &image, float variance, 
-        cv::Mat &noisy_image) {
+        cv::Mat &noisy_image, unsigned int seed) {
     
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only color images are supported.";
     LOG_IF(FATAL, variance <= 0) << "Invalid variance.";
     
-    std::random_device random;
-    std::mt19937 gen(random());
-    std::normal_distribution<float> g(0, variance);
-    
     cv::Mat image_gray;
     cv::cvtColor(image, image_gray, CV_BGR2GRAY);
     
@@ -90,18 +139,26 @@ void Transformation::applyGaussianSamplingErrors(const cv::Mat &image, float var
     cv::convertScaleAbs(grad_y, grad_y);
     cv::addWeighted(grad_x, 0.5, grad_y, 0.5, 0, magnitude);
     
+    std::vector<uint32_t> r;
+    std::vector<float> g(2*image.cols);
+    
     noisy_image.create(image.rows, image.cols, image.type());
     for (int i = 0; i < image.rows; i++) {
+        generateRow(i, image.cols, seed, GAUSSIAN_SAMPLING, r);
         for (int j = 0; j < image.cols; j++) {
-            
-            cv::Vec3b noisy_color = image.at<cv::Vec3b>(i, j);
-            float r = g(gen);
-            
-            noisy_color[0] = std::max(0, std::min(255, (int) (noisy_color[0] + r*magnitude.at<unsigned char>(i, j))));
-            noisy_color[1] = std::max(0, std::min(255, (int) (noisy_color[1] + r*magnitude.at<unsigned char>(i, j))));
-            noisy_color[2] = std::max(0, std::min(255, (int) (noisy_color[2] + r*magnitude.at<unsigned char>(i, j))));
-            
-            noisy_image.at<cv::Vec3b>(i, j) = noisy_color;
+            Philox::normal(r[4*j], r[4*j + 1], g[2*j], g[2*j + 1]);
+        }
+        
+        const unsigned char* image_ptr = image.ptr<unsigned char>(i);
+        const unsigned char* magnitude_ptr = magnitude.ptr<unsigned char>(i);
+        unsigned char* noisy_ptr = noisy_image.ptr<unsigned char>(i);
+        
+        for (int j = 0; j < image.cols; j++) {
+            float e = variance*g[2*j]*magnitude_ptr[j];
+            for (int c = 0; c < 3; c++) {
+                noisy_ptr[3*j + c] = std::max(0, std::min(255, 
+                        (int) (image_ptr[3*j + c] + e)));
+            }
         }
     }
 }
@@ -111,34 +168,27 @@ void Transformation::applyGaussianSamplingErrors(const cv::Mat &image, float var
 ////////////////////////////////////////////////////////////////////////////////
 
 void Transformation::applySaltAndPepperNoise(const cv::Mat &image, float p,
-        cv::Mat &noisy_image) {
+        cv::Mat &noisy_image, unsigned int seed) {
     
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only color images are supported.";
     
+    std::vector<uint32_t> r;
+    
     noisy_image.create(image.rows, image.cols, image.type());
     for (int i = 0; i < image.rows; i++) {
+        generateRow(i, image.cols, seed, SALT_AND_PEPPER, r);
+        
+        const unsigned char* image_ptr = image.ptr<unsigned char>(i);
+        unsigned char* noisy_ptr = noisy_image.ptr<unsigned char>(i);
+        
         for (int j = 0; j < image.cols; j++) {
+            bool noisy = Philox::uniform(r[4*j]) < p;
+            unsigned char value = (Philox::uniform(r[4*j + 1]) < 0.5f) ? 0 : 255;
             
-            cv::Vec3b noisy_color = image.at<cv::Vec3b>(i, j);
-            
-            float r = (float) std::rand() / RAND_MAX;
-            if (r <= p) {
-                
-                r = (float) std::rand() / RAND_MAX;
-                if (r <= 0.5) {
-                    noisy_color[0] = 0;
-                    noisy_color[1] = 0;
-                    noisy_color[2] = 0;
-                }
-                else {
-                    noisy_color[0] = 255;
-                    noisy_color[1] = 255;
-                    noisy_color[2] = 255;
-                }
+            for (int c = 0; c < 3; c++) {
+                noisy_ptr[3*j + c] = noisy ? value : image_ptr[3*j + c];
             }
-            
-            noisy_image.at<cv::Vec3b>(i, j) = noisy_color;
         }
     }
 }
@@ -147,28 +197,30 @@ void Transformation::applySaltAndPepperNoise(const cv::Mat &image, float p,
 // Transformation::applyPoissonNoise
 ////////////////////////////////////////////////////////////////////////////////
 
-void Transformation::applyPoissonNoise(const cv::Mat &image, cv::Mat &noisy_image) {
+void Transformation::applyPoissonNoise(const cv::Mat &image, cv::Mat &noisy_image, 
+        unsigned int seed) {
     
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only color images are supported.";
     
-    std::random_device random;
-    std::mt19937 gen(random());
+    // Inversion sampling on the tabulated CDF of the pixel value.
+    const std::vector<float> &cdf = poissonTables();
+    std::vector<uint32_t> r;
     
     noisy_image.create(image.rows, image.cols, image.type());
     for (int i = 0; i < image.rows; i++) {
+        generateRow(i, image.cols, seed, POISSON, r);
+        
+        const unsigned char* image_ptr = image.ptr<unsigned char>(i);
+        unsigned char* noisy_ptr = noisy_image.ptr<unsigned char>(i);
+        
         for (int j = 0; j < image.cols; j++) {
-            
-            cv::Vec3b noisy_color = image.at<cv::Vec3b>(i, j);
-            std::poisson_distribution<unsigned char> p0(noisy_color[0]);
-            std::poisson_distribution<unsigned char> p1(noisy_color[1]);
-            std::poisson_distribution<unsigned char> p2(noisy_color[2]);
-            
-            noisy_color[0] = p0(gen);
-            noisy_color[1] = p1(gen);
-            noisy_color[2] = p2(gen);
-            
-            noisy_image.at<cv::Vec3b>(i, j) = noisy_color;
+            for (int c = 0; c < 3; c++) {
+                const float* table = &cdf[256*image_ptr[3*j + c]];
+                float u = Philox::uniform(r[4*j + c]);
+                
+                noisy_ptr[3*j + c] = std::upper_bound(table, table + 255, u) - table;
+            }
         }
     }
 }
@@ -40,33 +40,45 @@
 class Transformation {
 public:
     /** \brief Add Gaussian additive noise to image with the given variance on all channels.
+     * 
+     * All noise functions draw the random numbers of a pixel from a Philox
+     * generator keyed by the seed and counted by the pixel's position, i.e.
+     * the noise is reproducible and equally sized images get the same noise
+     * for the same seed.
+     * 
      * \param[in] image image to add Gaussian additive noise to
      * \param[in] variance variance of the Gaussian
      * \param[out] noisy_image noisy image
+     * \param[in] seed seed of the noise
      */
     static void applyGaussianAdditiveNoise(const cv::Mat &image, float variance, 
-            cv::Mat &noisy_image);
+            cv::Mat &noisy_image, unsigned int seed = 0);
     
     /** \brief Add Gaussian sampling errors with given variance.
      * \param[in] image image to add Gaussian sampling errors to
      * \param[in] variance variance of the Gaussian
      * \param[out] noisy_image
+     * \param[in] seed seed of the noise
      */
     static void applyGaussianSamplingErrors(const cv::Mat &image, float variance, 
-            cv::Mat &noisy_image);
+            cv::Mat &noisy_image, unsigned int seed = 0);
     
     /** \brief Add salt and pepper noise.
      * \param[in] image image to add salt and pepper noise to
      * \param[in] p probability of salt or pepper
      * \param[out] noisy_image noisy image
+     * \param[in] seed seed of the noise
      */
-    static void applySaltAndPepperNoise(const cv::Mat &image, float p, cv::Mat &noisy_image);
+    static void applySaltAndPepperNoise(const cv::Mat &image, float p, cv::Mat &noisy_image, 
+            unsigned int seed = 0);
     
-    /** \brief Add poisson noise.
+    /** \brief Add poisson noise, values are clamped to 255.
      * \param[in] image image to add Poisson noise to
      * \param[out] noisy_image noisy image
+     * \param[in] seed seed of the noise
      */
-    static void applyPoissonNoise(const cv::Mat &image, cv::Mat &noisy_image);
+    static void applyPoissonNoise(const cv::Mat &image, cv::Mat &noisy_image, 
+            unsigned int seed = 0);
     
     /** \brief Apply blur (box filter).
      * \param[in] image image to apply blur filter to
@@ -34,6 +34,79 @@
 #include "evaluation.h"
 #include "visualization.h"
 
+
+/** \brief Number of superpixels, i.e. the maximum label plus one.
+ * \param[in] labels superpixel labels
+ * \return number of superpixels
+ */
+static int countSuperpixels(const cv::Mat &labels) {
+    
+    int max_label = 0;
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            max_label = std::max(max_label, labels_i[j]);
+        }
+    }
+    
+    return max_label + 1;
+}
+
+void Visualization::computeContext(const cv::Mat &image, const cv::Mat &labels, 
+        Context &context, bool compute_means, float d) {
+    
+    LOG_IF(FATAL, labels.empty()) << "Given labels are empty.";
+    LOG_IF(FATAL, !image.empty() && (image.rows != labels.rows || image.cols != labels.cols)) 
+            << "Image size and superpixel segmentation size do not match: " 
+            << image.size() << "!=" << labels.size();
+    LOG_IF(FATAL, !image.empty() && image.type() != CV_8UC3) 
+            << "Currently only three-channel images are supported.";
+    LOG_IF(FATAL, compute_means && image.empty()) << "Given image is empty.";
+    
+    context.image = image;
+    context.labels = labels;
+    context.superpixels = countSuperpixels(labels);
+    
+    Evaluation::computeBoundaryMap(labels, context.boundaries);
+    
+    context.dilation_radius = -1;
+    context.dilated_boundaries.release();
+    if (d > 0) {
+        context.dilation_radius = std::round(d*std::sqrt(labels.rows*labels.rows 
+                + labels.cols*labels.cols));
+        Evaluation::dilateBoundaryMap(context.boundaries, context.dilation_radius, 
+                context.dilated_boundaries);
+    }
+    
+    context.means.clear();
+    context.counts.clear();
+    if (compute_means) {
+        context.means.resize(context.superpixels, cv::Vec3f(0, 0, 0));
+        context.counts.resize(context.superpixels, 0);
+        
+        for (int i = 0; i < image.rows; ++i) {
+            const int* labels_i = labels.ptr<int>(i);
+            const cv::Vec3b* image_i = image.ptr<cv::Vec3b>(i);
+            
+            for (int j = 0; j < image.cols; ++j) {
+                cv::Vec3f &mean = context.means[labels_i[j]];
+                mean[0] += image_i[j][0];
+                mean[1] += image_i[j][1];
+                mean[2] += image_i[j][2];
+                
+                context.counts[labels_i[j]]++;
+            }
+        }
+        
+        for (int k = 0; k < context.superpixels; ++k) {
+            if (context.counts[k] > 0) {
+                context.means[k] /= context.counts[k];
+            }
+        }
+    }
+}
+
 void Visualization::drawContours(const cv::Mat &image, const cv::Mat &labels, cv::Mat &contours,
             bool eight_connected) {
     
@@ -43,18 +116,42 @@ void Visualization::drawContours(const cv::Mat &image, const cv::Mat &labels, cv
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only three-channel images are supported.";
     
-    contours.create(image.rows, image.cols, CV_8UC3);
-    cv::Vec3b color(0, 0, 0);
+    Context context;
+    computeContext(image, labels, context, false);
+    drawContours(context, contours, eight_connected);
+}
+
+void Visualization::drawContours(const Context &context, cv::Mat &contours, 
+        bool eight_connected) {
+    
+    LOG_IF(FATAL, context.image.empty()) << "Given image is empty.";
+    
+    // Copying first allows to paint the contours in place, e.g. for 
+    // contours drawn on the image itself.
+    if (contours.data != context.image.data) {
+        context.image.copyTo(contours);
+    }
+    
+    overlayContours(context, contours, eight_connected);
+}
+
+void Visualization::overlayContours(const Context &context, cv::Mat &image, 
+        bool eight_connected) {
+    
+    LOG_IF(FATAL, image.rows != context.labels.rows || image.cols != context.labels.cols
+            || image.type() != CV_8UC3) << "Image size and superpixel segmentation size do not match: " 
+            << image.size() << "!=" << context.labels.size();
     
-    for (int i = 0; i < contours.rows; ++i) {
-        for (int j = 0; j < contours.cols; ++j) {
-            if (Evaluation::is4ConnectedBoundaryPixel(labels, i, j) 
-                    || (eight_connected && Evaluation::is8Minus4ConnectedBoundaryPixel(labels, i, j))) {
+    cv::Vec3b color(0, 0, 0);
+    for (int i = 0; i < image.rows; ++i) {
+        const unsigned char* boundaries_i = context.boundaries.ptr<unsigned char>(i);
+        cv::Vec3b* image_i = image.ptr<cv::Vec3b>(i);
+        
+        for (int j = 0; j < image.cols; ++j) {
+            if (boundaries_i[j] > 0
+                    || (eight_connected && Evaluation::is8Minus4ConnectedBoundaryPixel(context.labels, i, j))) {
                 
-                contours.at<cv::Vec3b>(i, j) = color;
-            }
-            else {
-                contours.at<cv::Vec3b>(i, j) = image.at<cv::Vec3b>(i, j);
+                image_i[j] = color;
             }
         }
     }
@@ -80,15 +177,16 @@ void Visualization::drawRandom(const cv::Mat &labels, cv::Mat &random) {
     
     LOG_IF(FATAL, labels.empty()) << "Given labels are empty.";
     
-    int max_label = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > max_label) {
-                max_label = labels.at<int>(i, j);
-            }
-        }
-    }
+    // Random colors do not need boundaries.
+    Context context;
+    context.labels = labels;
+    context.superpixels = countSuperpixels(labels);
+    drawRandom(context, random);
+}
+
+void Visualization::drawRandom(const Context &context, cv::Mat &random) {
     
+    int max_label = context.superpixels - 1;
     int discretization = 1;
     int number = std::pow(256/discretization, 3);
     
@@ -97,11 +195,20 @@ void Visualization::drawRandom(const cv::Mat &labels, cv::Mat &random) {
         number = std::pow(256/discretization, 3);
     }
     
+    // Colors only depend on the label and are looked up per pixel.
+    std::vector<cv::Vec3b> colors(context.superpixels);
+    for (int k = 0; k < context.superpixels; ++k) {
+        colors[k] = getRandomColor(k, discretization);
+    }
+    
+    const cv::Mat &labels = context.labels;
     random.create(labels.rows, labels.cols, CV_8UC3);
     for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        cv::Vec3b* random_i = random.ptr<cv::Vec3b>(i);
+        
         for (int j = 0; j < labels.cols; ++j) {
-            random.at<cv::Vec3b>(i, j) = getRandomColor(labels.at<int>(i, j), 
-                    discretization);
+            random_i[j] = colors[labels_i[j]];
         }
     }
 }
@@ -115,58 +222,49 @@ void Visualization::drawPerturbedMeans(const cv::Mat &image, const cv::Mat &labe
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only three-channel images are supported.";
     
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
+    Context context;
+    computeContext(image, labels, context);
+    drawPerturbedMeans(context, mean_image);
+}
+
+void Visualization::drawPerturbedMeans(const Context &context, cv::Mat &mean_image) {
     
-    std::vector<cv::Vec3f> means(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<cv::Vec3f> perturbation(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<int> counts(superpixels, 0);
+    LOG_IF(FATAL, context.means.empty()) << "Means have not been computed.";
     
     std::random_device rd;
     std::mt19937 gen(rd());
     std::normal_distribution<> gaussian(0, 8);
     
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            means[labels.at<int>(i, j)][0] += image.at<cv::Vec3b>(i, j)[0];
-            means[labels.at<int>(i, j)][1] += image.at<cv::Vec3b>(i, j)[1];
-            means[labels.at<int>(i, j)][2] += image.at<cv::Vec3b>(i, j)[2];
-            
-            while (perturbation[labels.at<int>(i, j)][0] == 0
-                    && perturbation[labels.at<int>(i, j)][1] == 0
-                    && perturbation[labels.at<int>(i, j)][2] == 0) {
-                
-                perturbation[labels.at<int>(i, j)][0] += gaussian(gen);
-                perturbation[labels.at<int>(i, j)][1] += gaussian(gen);
-                perturbation[labels.at<int>(i, j)][2] += gaussian(gen);
-            }
-            
-            counts[labels.at<int>(i, j)]++;
+    // Perturbed colors are computed once per superpixel.
+    std::vector<cv::Vec3b> colors(context.superpixels);
+    for (int k = 0; k < context.superpixels; ++k) {
+        if (context.counts[k] == 0) {
+            continue;
         }
+        
+        cv::Vec3f perturbation(0, 0, 0);
+        while (perturbation[0] == 0 && perturbation[1] == 0 && perturbation[2] == 0) {
+            perturbation[0] += gaussian(gen);
+            perturbation[1] += gaussian(gen);
+            perturbation[2] += gaussian(gen);
+        }
+        
+        cv::Vec3f color = context.means[k] + perturbation;
+        color[0] = std::max(0.f, std::min(255.f, color[0]));
+        color[1] = std::max(0.f, std::min(255.f, color[1]));
+        color[2] = std::max(0.f, std::min(255.f, color[2]));
+        
+        colors[k] = color;
     }
     
-    for (int k = 0; k < superpixels; ++k) {
-        means[k] /= counts[k];
-    }
-    
-    mean_image.create(image.rows, image.cols, CV_8UC3);
-    for (int i = 0; i < mean_image.rows; ++i) {
-        for (int j = 0; j < mean_image.cols; ++j) {
-            
-            cv::Vec3f color = means[labels.at<int>(i, j)] + perturbation[labels.at<int>(i, j)];
-            color[0] = std::max(0.f, std::min(255.f, color[0]));
-            color[1] = std::max(0.f, std::min(255.f, color[1]));
-            color[2] = std::max(0.f, std::min(255.f, color[2]));
-            
-            mean_image.at<cv::Vec3b>(i, j) = color;
+    const cv::Mat &labels = context.labels;
+    mean_image.create(labels.rows, labels.cols, CV_8UC3);
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        cv::Vec3b* mean_image_i = mean_image.ptr<cv::Vec3b>(i);
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            mean_image_i[j] = colors[labels_i[j]];
         }
     }
 }
@@ -180,38 +278,28 @@ void Visualization::drawMeans(const cv::Mat &image, const cv::Mat &labels,
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only three-channel images are supported.";
     
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
+    Context context;
+    computeContext(image, labels, context);
+    drawMeans(context, mean_image);
+}
+
+void Visualization::drawMeans(const Context &context, cv::Mat &mean_image) {
     
-    std::vector<cv::Vec3f> means(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<int> counts(superpixels, 0);
+    LOG_IF(FATAL, context.means.empty()) << "Means have not been computed.";
     
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            means[labels.at<int>(i, j)][0] += image.at<cv::Vec3b>(i, j)[0];
-            means[labels.at<int>(i, j)][1] += image.at<cv::Vec3b>(i, j)[1];
-            means[labels.at<int>(i, j)][2] += image.at<cv::Vec3b>(i, j)[2];
-            
-            counts[labels.at<int>(i, j)]++;
-        }
+    std::vector<cv::Vec3b> colors(context.superpixels);
+    for (int k = 0; k < context.superpixels; ++k) {
+        colors[k] = context.means[k];
     }
     
-    for (int k = 0; k < superpixels; ++k) {
-        means[k] /= counts[k];
-    }
-    
-    mean_image.create(image.rows, image.cols, CV_8UC3);
-    for (int i = 0; i < mean_image.rows; ++i) {
-        for (int j = 0; j < mean_image.cols; ++j) {
-            mean_image.at<cv::Vec3b>(i, j) = means[labels.at<int>(i, j)];
+    const cv::Mat &labels = context.labels;
+    mean_image.create(labels.rows, labels.cols, CV_8UC3);
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_i = labels.ptr<int>(i);
+        cv::Vec3b* mean_image_i = mean_image.ptr<cv::Vec3b>(i);
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            mean_image_i[j] = colors[labels_i[j]];
         }
     }
 }
@@ -228,45 +316,56 @@ void Visualization::drawPrecisionRecall(const cv::Mat &image, const cv::Mat &lab
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only three-channel images are supported.";
     
-    int H = image.rows;
-    int W = image.cols;
-    int r = std::round(d*std::sqrt(H*H + W*W));
+    Context context;
+    computeContext(image, labels, context, false, d);
     
     pre_rec = image.clone();
-    for (int i = 0; i < image.rows; i++)
-    {
-        for (int j = 0; j < image.cols; j++)
-        {
-            if (Evaluation::is4ConnectedBoundaryPixel(gt, i, j)) {
-
-                bool pos = false;
-                for (int k = std::max(0, i - r); k < std::min(H - 1, i + r) + 1; k++) {
-                    for (int l = std::max(0, j - r); l < std::min(W - 1, j + r) + 1; l++) {
-                        if (Evaluation::is4ConnectedBoundaryPixel(labels, k, l)) {
-                            pos = true;
-                        }
-                    }
-                }
+    overlayPrecisionRecall(context, gt, pre_rec, d);
+}
 
-                if (!pos) {
+void Visualization::overlayPrecisionRecall(const Context &context, const cv::Mat &gt, 
+        cv::Mat &image, float d) {
+    
+    LOG_IF(FATAL, context.labels.rows != gt.rows || context.labels.cols != gt.cols) 
+            << "Superpixel segmentation size and ground truth size do not match: " 
+            << context.labels.size() << "!=" << gt.size();
+    LOG_IF(FATAL, image.rows != gt.rows || image.cols != gt.cols || image.type() != CV_8UC3) 
+            << "Image size and ground truth size do not match: " 
+            << image.size() << "!=" << gt.size();
+    
+    int H = gt.rows;
+    int W = gt.cols;
+    int r = std::round(d*std::sqrt(H*H + W*W));
+    
+    // The dilated superpixel boundaries are shared by all ground truths.
+    cv::Mat dilated_boundaries = context.dilated_boundaries;
+    if (context.dilation_radius != r) {
+        Evaluation::dilateBoundaryMap(context.boundaries, r, dilated_boundaries);
+    }
+    
+    cv::Mat gt_boundaries;
+    cv::Mat gt_dilated_boundaries;
+    Evaluation::computeBoundaryMap(gt, gt_boundaries);
+    Evaluation::dilateBoundaryMap(gt_boundaries, r, gt_dilated_boundaries);
+    
+    for (int i = 0; i < H; i++) {
+        const unsigned char* boundaries_i = context.boundaries.ptr<unsigned char>(i);
+        const unsigned char* dilated_boundaries_i = dilated_boundaries.ptr<unsigned char>(i);
+        const unsigned char* gt_boundaries_i = gt_boundaries.ptr<unsigned char>(i);
+        const unsigned char* gt_dilated_boundaries_i = gt_dilated_boundaries.ptr<unsigned char>(i);
+        cv::Vec3b* image_i = image.ptr<cv::Vec3b>(i);
+        
+        for (int j = 0; j < W; j++) {
+            if (gt_boundaries_i[j] > 0) {
+                if (dilated_boundaries_i[j] == 0) {
                     // This is a false negative!
-                    pre_rec.at<cv::Vec3b>(i, j) = cv::Vec3b(0, 0, 255);
+                    image_i[j] = cv::Vec3b(0, 0, 255);
                 }
             }
-            else if (Evaluation::is4ConnectedBoundaryPixel(labels, i, j)) {
-                
-                bool pos = false;
-                for (int k = std::max(0, i - r); k < std::min(H - 1, i + r) + 1; k++) {
-                    for (int l = std::max(0, j - r); l < std::min(W - 1, j + r) + 1; l++) {
-                        if (Evaluation::is4ConnectedBoundaryPixel(gt, k, l)) {
-                            pos = true;
-                        }
-                    }
-                }
-
-                if (!pos) {
+            else if (boundaries_i[j] > 0) {
+                if (gt_dilated_boundaries_i[j] == 0) {
                     // This is a false positive!
-                    pre_rec.at<cv::Vec3b>(i, j) = cv::Vec3b(0, 255, 0);
+                    image_i[j] = cv::Vec3b(0, 255, 0);
                 }
             }
         }
@@ -276,33 +375,50 @@ void Visualization::drawPrecisionRecall(const cv::Mat &image, const cv::Mat &lab
 void Visualization::drawUndersegmentationError(const cv::Mat &image, const cv::Mat &labels, 
         const cv::Mat &gt, cv::Mat &ue)
 {
-    cv::Mat intersection_matrix;
+    // Only the labels are needed.
+    Context context;
+    context.labels = labels;
+    context.superpixels = countSuperpixels(labels);
+    
+    ue = image.clone ();
+    overlayUndersegmentationError(context, gt, ue);
+}
+
+void Visualization::overlayUndersegmentationError(const Context &context, 
+        const cv::Mat &gt, cv::Mat &image) {
+    
+    const cv::Mat &labels = context.labels;
+    
+    Evaluation::SparseIntersectionMatrix intersections;
     std::vector<int> superpixel_sizes;
     std::vector<int> gt_sizes;
-    Evaluation::computeIntersectionMatrix(labels, gt, intersection_matrix, superpixel_sizes,
+    Evaluation::computeSparseIntersectionMatrix(labels, gt, intersections, superpixel_sizes,
             gt_sizes);
     
     std::vector<int> superpixel_labels(superpixel_sizes.size(), 0);
-    for (int j = 0; j < intersection_matrix.cols; ++j) {
+    for (unsigned int j = 0; j < intersections.size(); ++j) {
         
+        // Ties are resolved towards the smaller ground truth label.
         int max_intersection = 0;
-        for (int i = 0; i < intersection_matrix.rows; ++i) {
-            if (intersection_matrix.at<int>(i, j) > max_intersection) {
-                max_intersection = intersection_matrix.at<int>(i, j);
-                superpixel_labels[j] = i;
+        for (unsigned int k = 0; k < intersections[j].size(); ++k) {
+            if (intersections[j][k].second > max_intersection
+                    || (intersections[j][k].second == max_intersection 
+                        && intersections[j][k].first < superpixel_labels[j])) {
+                max_intersection = intersections[j][k].second;
+                superpixel_labels[j] = intersections[j][k].first;
             }
         }
     }
     
-    ue = image.clone ();
     for (int i = 0; i < image.rows; i++) {
+        const int* labels_i = labels.ptr<int>(i);
+        const int* gt_i = gt.ptr<int>(i);
+        cv::Vec3b* image_i = image.ptr<cv::Vec3b>(i);
+        
         for (int j = 0; j < image.cols; j++) {
-            int gt_label = gt.at<int>(i, j);
-            int sp_label = labels.at<int>(i, j);
-            
-            if (gt_label != superpixel_labels[sp_label]) {
-                ue.at<cv::Vec3b>(i, j) = cv::Vec3b(0, 0, 255);
+            if (gt_i[j] != superpixel_labels[labels_i[j]]) {
+                image_i[j] = cv::Vec3b(0, 0, 255);
             }
         }
     }
-}
\ No newline at end of file
+}
@@ -32,6 +32,7 @@
 #ifndef VISUALIZATION_H
 #define	VISUALIZATION_H
 
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 /** \brief Some basic visualizations of superpixel segmentations.
@@ -39,6 +40,39 @@
  */
 class Visualization {
 public:
+    /** \brief Boundaries and mean colors of a superpixel segmentation shared
+     * by all visualizations of the segmentation, see computeContext.
+     */
+    struct Context {
+        /** \brief Image the segmentation belongs to, may be empty. */
+        cv::Mat image;
+        /** \brief Superpixel labels. */
+        cv::Mat labels;
+        /** \brief Boundary map of the labels, see Evaluation::computeBoundaryMap. */
+        cv::Mat boundaries;
+        /** \brief Boundary map dilated by dilation_radius, if computed. */
+        cv::Mat dilated_boundaries;
+        /** \brief Radius of dilated_boundaries, -1 if not computed. */
+        int dilation_radius;
+        /** \brief Number of superpixels, i.e. the maximum label plus one. */
+        int superpixels;
+        /** \brief Mean color per superpixel, empty if not computed. */
+        std::vector<cv::Vec3f> means;
+        /** \brief Number of pixels per superpixel, empty if not computed. */
+        std::vector<int> counts;
+    };
+    
+    /** \brief Compute boundaries and, optionally, mean colors once for all
+     * visualizations of a segmentation.
+     * \param[in] image image to visualize, may be empty if no means are computed
+     * \param[in] labels superpixel labels
+     * \param[out] context context to render visualizations from
+     * \param[in] compute_means whether to compute the mean color of each superpixel
+     * \param[in] d if positive, also dilate the boundaries as needed by drawPrecisionRecall
+     */
+    static void computeContext(const cv::Mat &image, const cv::Mat &labels, 
+            Context &context, bool compute_means = true, float d = 0);
+    
     /** \brief Draw contours.
      * \param[in] image image to draw contours in
      * \param[in] labels superpixel labels
@@ -89,6 +123,57 @@ public:
     static void drawUndersegmentationError(const cv::Mat &image, const 
             cv::Mat &labels, const cv::Mat &gt, cv::Mat &ue);
     
+    /** \brief Draw contours, see drawContours.
+     * \param[in] context context of the segmentation, including the image
+     * \param[out] contours copy of the images with painted contours
+     * \param[in] eight_connected whether to use eight connected graph
+     */
+    static void drawContours(const Context &context, cv::Mat &contours, 
+            bool eight_connected = false);
+    
+    /** \brief Color superpixels randomly, see drawRandom.
+     * \param[in] context context of the segmentation
+     * \param[out] random image with randomly colored superpixels
+     */
+    static void drawRandom(const Context &context, cv::Mat &random);
+    
+    /** \brief Draw mean colored superpixels, see drawMeans.
+     * \param[in] context context of the segmentation including means
+     * \param[out] means image with superpixels colored by the mean color
+     */
+    static void drawMeans(const Context &context, cv::Mat &means);
+    
+    /** \brief Draw perturbed mean colored superpixels, see drawPerturbedMeans.
+     * \param[in] context context of the segmentation including means
+     * \param[out] means image with superpixels colored by the mean color plus a small noise term
+     */
+    static void drawPerturbedMeans(const Context &context, cv::Mat &means);
+    
+    /** \brief Paint the contours into the given image.
+     * \param[in] context context of the segmentation
+     * \param[in,out] image image to paint the contours in, of the size of the segmentation
+     * \param[in] eight_connected whether to use eight connected graph
+     */
+    static void overlayContours(const Context &context, cv::Mat &image, 
+            bool eight_connected = false);
+    
+    /** \brief Indicate false negatives and false positives in the given image.
+     * \param[in] context context of the segmentation
+     * \param[in] gt ground truth segmentation
+     * \param[in,out] image image to indicate false negatives and positives in
+     * \param[in] d fraction of diagonal to use as tolerance
+     */
+    static void overlayPrecisionRecall(const Context &context, const cv::Mat &gt, 
+            cv::Mat &image, float d = 0.0025);
+    
+    /** \brief Indicate Undersegmentation Error in the given image.
+     * \param[in] context context of the segmentation
+     * \param[in] gt ground truth segmentation
+     * \param[in,out] image image to indicate undersegmentation error in red
+     */
+    static void overlayUndersegmentationError(const Context &context, 
+            const cv::Mat &gt, cv::Mat &image);
+    
 };
 
 #endif	/* VISUALIZATION_H */
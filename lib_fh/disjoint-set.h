@@ -73,6 +73,8 @@ void universe::join(int x, int y) {
     if (elts[x].rank == elts[y].rank)
       elts[y].rank++;
   }
+  // atomic for segment_image_labels_tiled, where tiles are joined in parallel
+#pragma omp atomic
   num--;
 }
 
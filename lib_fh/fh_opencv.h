@@ -48,9 +48,11 @@ public:
      * \param[in] threshold threshold to stop merging segments
      * \param[in] minimum_size minimum superpixel size to enforce
      * \param[out] labels superpixel labels
+     * \param[in] tile_size if positive, tiles of this size are segmented in parallel
+     *  and merged along their borders (approximate, see segment_image_labels_tiled)
      */
     static int computeSuperpixels(const cv::Mat &mat, float sigma, 
-            float threshold, int minimum_size, cv::Mat &labels) {
+            float threshold, int minimum_size, cv::Mat &labels, int tile_size = 0) {
         
         image<rgb>* rgbImage = new image<rgb>(mat.cols, mat.rows);
         
@@ -63,7 +65,15 @@ public:
         }
         
         int superpixels = 0;
-        image<int> *segmentation = segment_image_labels(rgbImage, sigma, threshold, minimum_size, &superpixels);
+        image<int> *segmentation = 0;
+        if (tile_size > 0) {
+            segmentation = segment_image_labels_tiled(rgbImage, sigma, threshold, 
+                    minimum_size, tile_size, &superpixels);
+        }
+        else {
+            segmentation = segment_image_labels(rgbImage, sigma, threshold, 
+                    minimum_size, &superpixels);
+        }
 
         labels.create(mat.rows, mat.cols, CV_32SC1);
         for (int i = 0; i < mat.rows; ++i) {
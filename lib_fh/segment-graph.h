@@ -21,6 +21,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <stdint.h>
 #include "disjoint-set.h"
 
 // threshold function
@@ -35,29 +37,76 @@ bool operator<(const edge &a, const edge &b) {
   return a.w < b.w;
 }
 
+// maps a float to an unsigned integer with the same order
+static inline uint32_t edge_key(float w) {
+  uint32_t bits;
+  memcpy(&bits, &w, sizeof(bits));
+  return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
 /*
- * Segment a graph
+ * Sort edges by weight (stable LSD radix sort on the bits of the weights,
+ * three passes of 11 bits; passes where all edges share a digit are skipped).
  *
- * Returns a disjoint-set forest representing the segmentation.
- *
- * num_vertices: number of vertices in graph.
- * num_edges: number of edges in graph
+ * num_edges: number of edges.
  * edges: array of edges.
- * c: constant for treshold function.
  */
-universe *segment_graph(int num_vertices, int num_edges, edge *edges, 
-			float c) { 
-  // sort edges by weight
-  std::sort(edges, edges + num_edges);
+void sort_edges(int num_edges, edge *edges) {
+  const int bits = 11;
+  const int buckets = 1 << bits;
 
-  // make a disjoint-set forest
-  universe *u = new universe(num_vertices);
+  if (num_edges == 0)
+    return;
 
-  // init thresholds
-  float *threshold = new float[num_vertices];
-  for (int i = 0; i < num_vertices; i++)
-    threshold[i] = THRESHOLD(1,c);
+  int *counts = new int[3*buckets];
+  memset(counts, 0, 3*buckets*sizeof(int));
+  for (int i = 0; i < num_edges; i++) {
+    uint32_t key = edge_key(edges[i].w);
+    counts[key & (buckets-1)]++;
+    counts[buckets + ((key >> bits) & (buckets-1))]++;
+    counts[2*buckets + (key >> 2*bits)]++;
+  }
+
+  edge *tmp = new edge[num_edges];
+  edge *src = edges;
+  edge *dst = tmp;
+  for (int pass = 0; pass < 3; pass++) {
+    int *count = counts + pass*buckets;
+    if (count[(edge_key(src[0].w) >> pass*bits) & (buckets-1)] == num_edges)
+      continue;
+
+    int sum = 0;
+    for (int k = 0; k < buckets; k++) {
+      int n = count[k];
+      count[k] = sum;
+      sum += n;
+    }
+    for (int i = 0; i < num_edges; i++) {
+      int k = (edge_key(src[i].w) >> pass*bits) & (buckets-1);
+      dst[count[k]++] = src[i];
+    }
+    std::swap(src, dst);
+  }
+  if (src != edges)
+    std::copy(src, src + num_edges, edges);
 
+  delete [] tmp;
+  delete [] counts;
+}
+
+/*
+ * Merge components along edges, the main loop of segment_graph.
+ *
+ * Edges touching disjoint sets of vertices can be merged in parallel.
+ *
+ * u: disjoint-set forest (may already contain merged components).
+ * threshold: thresholds of the components, indexed by their roots.
+ * num_edges: number of edges.
+ * edges: array of edges, sorted by weight.
+ * c: constant for treshold function.
+ */
+void merge_graph(universe *u, float *threshold, int num_edges, edge *edges,
+		 float c) {
   // for each edge, in non-decreasing weight order...
   for (int i = 0; i < num_edges; i++) {
     edge *pedge = &edges[i];
@@ -74,9 +123,35 @@ universe *segment_graph(int num_vertices, int num_edges, edge *edges,
       }
     }
   }
+}
+
+/*
+ * Segment a graph
+ *
+ * Returns a disjoint-set forest representing the segmentation.
+ *
+ * num_vertices: number of vertices in graph.
+ * num_edges: number of edges in graph
+ * edges: array of edges.
+ * c: constant for treshold function.
+ */
+universe *segment_graph(int num_vertices, int num_edges, edge *edges, 
+			float c) { 
+  // sort edges by weight
+  sort_edges(num_edges, edges);
+
+  // make a disjoint-set forest
+  universe *u = new universe(num_vertices);
+
+  // init thresholds
+  float *threshold = new float[num_vertices];
+  for (int i = 0; i < num_vertices; i++)
+    threshold[i] = THRESHOLD(1,c);
+
+  merge_graph(u, threshold, num_edges, edges, c);
 
   // free up
-  delete threshold;
+  delete [] threshold;
   return u;
 }
 
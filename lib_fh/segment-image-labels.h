@@ -1,6 +1,8 @@
 #ifndef SEGMENT_IMAGE_LABELS_H
 #define	SEGMENT_IMAGE_LABELS_H
 
+#include <vector>
+#include <algorithm>
 #include "image.h"
 #include "misc.h"
 #include "filter.h"
@@ -44,39 +46,9 @@ image<int> *segment_image_labels(image<rgb> *im, float sigma, float c, int min_s
   delete b;
  
   // build graph
-  edge *edges = new edge[width*height*4];
-  int num = 0;
-  for (int y = 0; y < height; y++) {
-    for (int x = 0; x < width; x++) {
-      if (x < width-1) {
-	edges[num].a = y * width + x;
-	edges[num].b = y * width + (x+1);
-	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x+1, y);
-	num++;
-      }
-
-      if (y < height-1) {
-	edges[num].a = y * width + x;
-	edges[num].b = (y+1) * width + x;
-	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x, y+1);
-	num++;
-      }
-
-      if ((x < width-1) && (y < height-1)) {
-	edges[num].a = y * width + x;
-	edges[num].b = (y+1) * width + (x+1);
-	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x+1, y+1);
-	num++;
-      }
-
-      if ((x < width-1) && (y > 0)) {
-	edges[num].a = y * width + x;
-	edges[num].b = (y-1) * width + (x+1);
-	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x+1, y-1);
-	num++;
-      }
-    }
-  }
+  int num = graph_edges_before_row(width, height, height);
+  edge *edges = new edge[num];
+  build_graph(smooth_r, smooth_g, smooth_b, edges);
   delete smooth_r;
   delete smooth_g;
   delete smooth_b;
@@ -108,5 +80,139 @@ image<int> *segment_image_labels(image<rgb> *im, float sigma, float c, int min_s
   return output;
 }
 
+/*
+ * Approximate, parallel version of segment_image_labels.
+ *
+ * Tiles of tile_size x tile_size pixels are segmented independently (and in
+ * parallel) with the same criterion, then the edges crossing tile borders
+ * are merged in a single sorted pass, using the thresholds of the tile
+ * components. Differs from segment_image_labels where merging would have
+ * depended on the order of edges from different tiles.
+ *
+ * im: image to segment.
+ * sigma: to smooth the image.
+ * c: constant for treshold function.
+ * min_size: minimum component size (enforced by post-processing stage).
+ * tile_size: width and height of the tiles.
+ * num_ccs: number of connected components in the segmentation.
+ */
+image<int> *segment_image_labels_tiled(image<rgb> *im, float sigma, float c, int min_size,
+			  int tile_size, int *num_ccs) {
+  int width = im->width();
+  int height = im->height();
+
+  image<float> *r = new image<float>(width, height);
+  image<float> *g = new image<float>(width, height);
+  image<float> *b = new image<float>(width, height);
+
+  // smooth each color channel  
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      imRef(r, x, y) = imRef(im, x, y).r;
+      imRef(g, x, y) = imRef(im, x, y).g;
+      imRef(b, x, y) = imRef(im, x, y).b;
+    }
+  }
+  image<float> *smooth_r = smooth(r, sigma);
+  image<float> *smooth_g = smooth(g, sigma);
+  image<float> *smooth_b = smooth(b, sigma);
+  delete r;
+  delete g;
+  delete b;
+
+  // same neighbors as build_graph
+  const int nx[] = {1, 0, 1, 1};
+  const int ny[] = {0, 1, 1, -1};
+
+  int tiles_x = (width + tile_size - 1) / tile_size;
+  int tiles_y = (height + tile_size - 1) / tile_size;
+  int tiles = tiles_x * tiles_y;
+  std::vector< std::vector<edge> > tile_edges(tiles);
+  std::vector< std::vector<edge> > seam_edges(tiles);
+
+  universe *u = new universe(width*height);
+  float *threshold = new float[width*height];
+  for (int i = 0; i < width*height; i++)
+    threshold[i] = THRESHOLD(1,c);
+
+  // build, sort and segment the graph of each tile, edges leaving the tile
+  // are kept for the seams
+#pragma omp parallel for schedule(dynamic)
+  for (int t = 0; t < tiles; t++) {
+    int x0 = (t % tiles_x) * tile_size;
+    int y0 = (t / tiles_x) * tile_size;
+    int x1 = std::min(x0 + tile_size, width);
+    int y1 = std::min(y0 + tile_size, height);
+
+    std::vector<edge> &inner = tile_edges[t];
+    std::vector<edge> &seam = seam_edges[t];
+    inner.reserve(4*(x1 - x0)*(y1 - y0));
+    for (int y = y0; y < y1; y++) {
+      for (int x = x0; x < x1; x++) {
+	for (int k = 0; k < 4; k++) {
+	  int xx = x + nx[k];
+	  int yy = y + ny[k];
+	  if (xx >= width || yy < 0 || yy >= height)
+	    continue;
+
+	  edge e;
+	  e.a = y * width + x;
+	  e.b = yy * width + xx;
+	  e.w = diff(smooth_r, smooth_g, smooth_b, x, y, xx, yy);
+	  if (xx < x1 && yy >= y0 && yy < y1)
+	    inner.push_back(e);
+	  else
+	    seam.push_back(e);
+	}
+      }
+    }
+
+    if (!inner.empty()) {
+      sort_edges(inner.size(), &inner[0]);
+      merge_graph(u, threshold, inner.size(), &inner[0], c);
+    }
+  }
+  delete smooth_r;
+  delete smooth_g;
+  delete smooth_b;
+
+  // merge along the seams
+  std::vector<edge> seams;
+  for (int t = 0; t < tiles; t++) {
+    seams.insert(seams.end(), seam_edges[t].begin(), seam_edges[t].end());
+    std::vector<edge>().swap(seam_edges[t]);
+  }
+  if (!seams.empty()) {
+    sort_edges(seams.size(), &seams[0]);
+    merge_graph(u, threshold, seams.size(), &seams[0], c);
+  }
+  delete [] threshold;
+
+  // post process small components
+  for (int t = 0; t <= tiles; t++) {
+    std::vector<edge> &edges = (t < tiles) ? tile_edges[t] : seams;
+    for (unsigned int i = 0; i < edges.size(); i++) {
+      int a = u->find(edges[i].a);
+      int b = u->find(edges[i].b);
+      if ((a != b) && ((u->size(a) < min_size) || (u->size(b) < min_size)))
+	u->join(a, b);
+    }
+  }
+  *num_ccs = u->num_sets();
+
+  image<int> *output = new image<int>(width, height);
+  
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      int comp = u->find(y * width + x);
+      imRef(output, x, y) = comp;
+    }
+  }  
+ 
+  delete u;
+
+  return output;
+}
+
 #endif	/* SEGMENT_IMAGE_LABELS_H */
 
@@ -45,6 +45,64 @@ static inline float diff(image<float> *r, image<float> *g, image<float> *b,
 	      square(imRef(b, x1, y1)-imRef(b, x2, y2)));
 }
 
+// number of edges of the rows above row y in the grid graph of build_graph
+static inline int graph_edges_before_row(int width, int height, int y) {
+  int edges = y * (width-1) + std::min(y, height-1) * (2*width-1);
+  if (y > 1)
+    edges += (y-1) * (width-1);
+  return edges;
+}
+
+/*
+ * Build the grid graph (right, down, down-right and up-right neighbors) of
+ * a smoothed image.
+ *
+ * The rows are filled in parallel, each starting at its own offset, so the
+ * edges are in the same order as when built sequentially.
+ *
+ * smooth_r, smooth_g, smooth_b: smoothed color channels.
+ * edges: array of graph_edges_before_row(width, height, height) edges.
+ */
+void build_graph(image<float> *smooth_r, image<float> *smooth_g, image<float> *smooth_b,
+		 edge *edges) {
+  int width = smooth_r->width();
+  int height = smooth_r->height();
+
+#pragma omp parallel for
+  for (int y = 0; y < height; y++) {
+    int num = graph_edges_before_row(width, height, y);
+    for (int x = 0; x < width; x++) {
+      if (x < width-1) {
+	edges[num].a = y * width + x;
+	edges[num].b = y * width + (x+1);
+	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x+1, y);
+	num++;
+      }
+
+      if (y < height-1) {
+	edges[num].a = y * width + x;
+	edges[num].b = (y+1) * width + x;
+	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x, y+1);
+	num++;
+      }
+
+      if ((x < width-1) && (y < height-1)) {
+	edges[num].a = y * width + x;
+	edges[num].b = (y+1) * width + (x+1);
+	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x+1, y+1);
+	num++;
+      }
+
+      if ((x < width-1) && (y > 0)) {
+	edges[num].a = y * width + x;
+	edges[num].b = (y-1) * width + (x+1);
+	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x+1, y-1);
+	num++;
+      }
+    }
+  }
+}
+
 /*
  * Segment an image
  *
@@ -99,39 +157,9 @@ image<rgb> *segment_image(image<rgb> *im, float sigma, float c, int min_size,
   }
   
   // build graph
-  edge *edges = new edge[width*height*4];
-  int num = 0;
-  for (int y = 0; y < height; y++) {
-    for (int x = 0; x < width; x++) {
-      if (x < width-1) {
-	edges[num].a = y * width + x;
-	edges[num].b = y * width + (x+1);
-	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x+1, y);
-	num++;
-      }
-
-      if (y < height-1) {
-	edges[num].a = y * width + x;
-	edges[num].b = (y+1) * width + x;
-	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x, y+1);
-	num++;
-      }
-
-      if ((x < width-1) && (y < height-1)) {
-	edges[num].a = y * width + x;
-	edges[num].b = (y+1) * width + (x+1);
-	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x+1, y+1);
-	num++;
-      }
-
-      if ((x < width-1) && (y > 0)) {
-	edges[num].a = y * width + x;
-	edges[num].b = (y-1) * width + (x+1);
-	edges[num].w = diff(smooth_r, smooth_g, smooth_b, x, y, x+1, y-1);
-	num++;
-      }
-    }
-  }
+  int num = graph_edges_before_row(width, height, height);
+  edge *edges = new edge[num];
+  build_graph(smooth_r, smooth_g, smooth_b, edges);
   delete smooth_r;
   delete smooth_g;
   delete smooth_b;
@@ -2,13 +2,39 @@
 #define DOSUPERPIXEL
 
 #include<vector>
+#include<cstring>
+#include<float.h>
+#include<stdint.h>
 #include"preEnforceConnectivity.h"
 #include<algorithm>
 #include"EnforceConnectivity.h"
 #include"point.h"
+#ifdef _OPENMP
+#include<omp.h>
+#endif
 using namespace std;
 
 
+//Squared distances to a center of count consecutive pixels of a row of the
+//feature planes (planeSize floats apart), vectorized over the pixels.
+
+static inline void RowDistances(const float* row,int planeSize,const float* center,int count,float* D)
+{
+	for(int n=0;n<count;n++)
+		D[n]=0;
+	for(int k=0;k<10;k++)
+	{
+		const float* f=row+k*planeSize;
+		const float c=center[k];
+		for(int n=0;n<count;n++)
+		{
+			float d=f[n]-c;
+			D[n]+=d*d;
+		}
+	}
+}
+
+
 //Perform weighted kmeans iteratively in the ten dimensional feature space.
 
 void DoSuperpixel(
@@ -35,37 +61,43 @@ void DoSuperpixel(
 	)
 {
 	//Pre-treatment
-	double** dist=new double*[nRows];
-	for(int i=0;i<nRows;i++)
-		dist[i]=new double[nCols];
-	double* centerL1=new double[seedNum];
-	double* centerL2=new double[seedNum];
-	double* centera1=new double[seedNum];
-	double* centera2=new double[seedNum];
-	double* centerb1=new double[seedNum];
-	double* centerb2=new double[seedNum];
-	double* centerx1=new double[seedNum];
-	double* centerx2=new double[seedNum];
-	double* centery1=new double[seedNum];
-	double* centery2=new double[seedNum];
+	//The features are copied to one float plane per dimension (SoA), rows
+	//padded to multiples of 8 floats and aligned to 32 bytes for SIMD.
+	const int dims=10;
+	float** features[dims]={L1,L2,a1,a2,b1,b2,x1,x2,y1,y2};
+	int stride=(nCols+7)/8*8;
+	int planeSize=nRows*stride;
+	float* planeData=new float[dims*planeSize+8];
+	float* planes=(float*)(((uintptr_t)planeData+31)/32*32);
+	memset(planes,0,dims*planeSize*sizeof(float));
+	for(int k=0;k<dims;k++)
+		for(int i=0;i<nRows;i++)
+			memcpy(planes+k*planeSize+i*stride,features[k][i],nCols*sizeof(float));
+
+	float* dist=new float[nRows*nCols];
+	double* center=new double[seedNum*dims];
+	float* centerF=new float[seedNum*dims];
 	double* WSum=new double[seedNum];
 	int* clusterSize=new int[seedNum];
 
+	int threadNum=1;
+#ifdef _OPENMP
+	threadNum=omp_get_max_threads();
+#endif
+	//per-thread accumulators of the update step (weighted features and weight,
+	//size and coordinates per seed)
+	vector<double> threadSums(threadNum*seedNum*(dims+1));
+	vector<int> threadCounts(threadNum*seedNum*3);
+	vector< vector<int> > rowSeeds(nRows);
+
 
 
 //Initialization
 	for(int i=0;i<seedNum;i++)
 	{
-		centerL1[i]=0;
-		centerL2[i]=0;
-		centera1[i]=0;
-		centera2[i]=0;
-		centerb1[i]=0;
-		centerb2[i]=0;
-		centerx1[i]=0;
-		centerx2[i]=0;
-		centery1[i]=0;
-		centery2[i]=0;
+		double* c=center+i*dims;
+		for(int k=0;k<dims;k++)
+			c[k]=0;
 		int x=seedArray[i].x;
 		int y=seedArray[i].y;
 		int minX=(x-StepX/4<=0)?0:x-StepX/4;
@@ -77,27 +109,11 @@ void DoSuperpixel(
 			for(int k=minY;k<=maxY;k++)
 			{
 				Count++;
-				centerL1[i]+=L1[j][k];
-				centerL2[i]+=L2[j][k];
-				centera1[i]+=a1[j][k];
-				centera2[i]+=a2[j][k];
-				centerb1[i]+=b1[j][k];
-				centerb2[i]+=b2[j][k];
-				centerx1[i]+=x1[j][k];
-				centerx2[i]+=x2[j][k];
-				centery1[i]+=y1[j][k];
-				centery2[i]+=y2[j][k];
+				for(int d=0;d<dims;d++)
+					c[d]+=features[d][j][k];
 			}
-		centerL1[i]/=Count;
-		centerL2[i]/=Count;
-		centera1[i]/=Count;
-		centera2[i]/=Count;
-		centerb1[i]/=Count;
-		centerb2[i]/=Count;
-		centerx1[i]/=Count;
-		centerx2[i]/=Count;
-		centery1[i]/=Count;
-		centery2[i]/=Count;
+		for(int k=0;k<dims;k++)
+			c[k]/=Count;
 	}
 
 
@@ -105,86 +121,105 @@ void DoSuperpixel(
 	//K-means
 	for(int iteration=0;iteration<=iterationNum;iteration++)
 	{
+		//seeds whose window covers each row, in seed order
 		for(int i=0;i<nRows;i++)
-			for(int j=0;j<nCols;j++)
-				dist[i][j]=DBL_MAX;
-
-
-
-
-		int minX,minY,maxX,maxY;double D;
+			rowSeeds[i].clear();
 		for(int i=0;i<seedNum;i++)
 		{
 			int x=seedArray[i].x;
-			int y=seedArray[i].y;
-			minX=(x-(StepX)<=0)?0:x-StepX;
-			minY=(y-(StepY)<=0)?0:y-StepY;
-			maxX=(x+(StepX)>=nRows-1)?nRows-1:x+StepX;
-			maxY=(y+(StepY)>=nCols-1)?nCols-1:y+StepY;
+			int minX=(x-(StepX)<=0)?0:x-StepX;
+			int maxX=(x+(StepX)>=nRows-1)?nRows-1:x+StepX;
 			for(int m=minX;m<=maxX;m++)
-				for(int n=minY;n<=maxY;n++)
+				rowSeeds[m].push_back(i);
+		}
+		for(int i=0;i<seedNum*dims;i++)
+			centerF[i]=(float)center[i];
+
+
+
+		//assignment, rows in parallel; each pixel sees the seeds in the same
+		//order as when looping over the seed windows
+#pragma omp parallel
+		{
+			float* D=new float[nCols];
+#pragma omp for schedule(dynamic,8)
+			for(int m=0;m<nRows;m++)
+			{
+				float* distRow=dist+m*nCols;
+				unsigned short int* labelRow=label+m*nCols;
+				for(int n=0;n<nCols;n++)
+					distRow[n]=FLT_MAX;
+				for(unsigned int s=0;s<rowSeeds[m].size();s++)
 				{
-					D=  (L1[m][n]-centerL1[i])*(L1[m][n]-centerL1[i])+
-						(L2[m][n]-centerL2[i])*(L2[m][n]-centerL2[i])+
-						(a1[m][n]-centera1[i])*(a1[m][n]-centera1[i])+
-						(a2[m][n]-centera2[i])*(a2[m][n]-centera2[i])+
-						(b1[m][n]-centerb1[i])*(b1[m][n]-centerb1[i])+
-						(b2[m][n]-centerb2[i])*(b2[m][n]-centerb2[i])+
-						(x1[m][n]-centerx1[i])*(x1[m][n]-centerx1[i])+
-						(x2[m][n]-centerx2[i])*(x2[m][n]-centerx2[i])+
-						(y1[m][n]-centery1[i])*(y1[m][n]-centery1[i])+
-						(y2[m][n]-centery2[i])*(y2[m][n]-centery2[i]);
-					if(D<dist[m][n])
-					{
-						label[m*nCols+n]=i;
-						dist[m][n]=D;
-					}
+					int i=rowSeeds[m][s];
+					int y=seedArray[i].y;
+					int minY=(y-(StepY)<=0)?0:y-StepY;
+					int maxY=(y+(StepY)>=nCols-1)?nCols-1:y+StepY;
+					RowDistances(planes+m*stride+minY,planeSize,centerF+i*dims,maxY-minY+1,D);
+					for(int n=minY;n<=maxY;n++)
+						if(D[n-minY]<distRow[n])
+						{
+							labelRow[n]=i;
+							distRow[n]=D[n-minY];
+						}
 				}
+			}
+			delete []D;
 		}
 
 
 
+		//update, rows in parallel with per-thread accumulators
+		std::fill(threadSums.begin(),threadSums.end(),0.0);
+		std::fill(threadCounts.begin(),threadCounts.end(),0);
+#pragma omp parallel num_threads(threadNum)
+		{
+			int t=0;
+#ifdef _OPENMP
+			t=omp_get_thread_num();
+#endif
+			double* sums=&threadSums[t*seedNum*(dims+1)];
+			int* counts=&threadCounts[t*seedNum*3];
+#pragma omp for schedule(static)
+			for(int i=0;i<nRows;i++)
+			{
+				for(int j=0;j<nCols;j++)
+				{
+					int L=label[i*nCols+j];
+					if (L >= seedNum) std::cout << L << " " << seedNum << std::endl;
+					double Weight=W[i][j];
+					double* sum=sums+L*(dims+1);
+					for(int k=0;k<dims;k++)
+						sum[k]+=Weight*features[k][i][j];
+					sum[dims]+=Weight;
+					counts[L*3]++;
+					counts[L*3+1]+=i;
+					counts[L*3+2]+=j;
+				}
+			}
+		}
+
 		for(int i=0;i<seedNum;i++)
 		{
-			centerL1[i]=0;
-			centerL2[i]=0;
-			centera1[i]=0;
-			centera2[i]=0;
-			centerb1[i]=0;
-			centerb2[i]=0;
-			centerx1[i]=0;
-			centerx2[i]=0;
-			centery1[i]=0;
-			centery2[i]=0;
+			for(int k=0;k<dims;k++)
+				center[i*dims+k]=0;
 			WSum[i]=0;
 			clusterSize[i]=0;
 			seedArray[i].x=0;
 			seedArray[i].y=0;
 		}
-
-
-
-		for(int i=0;i<nRows;i++)
+		for(int t=0;t<threadNum;t++)
 		{
-			for(int j=0;j<nCols;j++)
+			const double* sums=&threadSums[t*seedNum*(dims+1)];
+			const int* counts=&threadCounts[t*seedNum*3];
+			for(int i=0;i<seedNum;i++)
 			{
-				int L=label[i*nCols+j];
-                                if (L >= seedNum) std::cout << L << " " << seedNum << std::endl;
-				double Weight=W[i][j];
-				centerL1[L]+=Weight*L1[i][j];
-				centerL2[L]+=Weight*L2[i][j];
-				centera1[L]+=Weight*a1[i][j];
-				centera2[L]+=Weight*a2[i][j];
-				centerb1[L]+=Weight*b1[i][j];
-				centerb2[L]+=Weight*b2[i][j];
-				centerx1[L]+=Weight*x1[i][j];
-				centerx2[L]+=Weight*x2[i][j];
-				centery1[L]+=Weight*y1[i][j];
-				centery2[L]+=Weight*y2[i][j];
-				clusterSize[L]++;
-				WSum[L]+=Weight;
-				seedArray[L].x+=i;
-				seedArray[L].y+=j;
+				for(int k=0;k<dims;k++)
+					center[i*dims+k]+=sums[i*(dims+1)+k];
+				WSum[i]+=sums[i*(dims+1)+dims];
+				clusterSize[i]+=counts[i*3];
+				seedArray[i].x+=counts[i*3+1];
+				seedArray[i].y+=counts[i*3+2];
 			}
 		}
 		for(int i=0;i<seedNum;i++)
@@ -194,16 +229,8 @@ void DoSuperpixel(
 		}
 		for(int i=0;i<seedNum;i++)
 		{
-			centerL1[i]/=WSum[i];
-			centerL2[i]/=WSum[i];
-			centera1[i]/=WSum[i];
-			centera2[i]/=WSum[i];
-			centerb1[i]/=WSum[i];
-			centerb2[i]/=WSum[i];
-			centerx1[i]/=WSum[i];
-			centerx2[i]/=WSum[i];
-			centery1[i]/=WSum[i];
-			centery2[i]/=WSum[i];
+			for(int k=0;k<dims;k++)
+				center[i*dims+k]/=WSum[i];
 			seedArray[i].x/=clusterSize[i];
 			seedArray[i].y/=clusterSize[i];
 		}
@@ -219,20 +246,11 @@ void DoSuperpixel(
 
 
 	//Clear Memory
-	delete []centerL1;
-	delete []centerL2;
-	delete []centera1;
-	delete []centera2;
-	delete []centerb1;
-	delete []centerb2;
-	delete []centerx1;
-	delete []centerx2;
-	delete []centery1;
-	delete []centery2;
+	delete []planeData;
+	delete []center;
+	delete []centerF;
 	delete []WSum;
 	delete []clusterSize;
-	for(int i=0;i<nRows;i++)
-		delete [] dist[i];
 	delete []dist;
 	return;
 }
@@ -4,10 +4,11 @@
 #include<cmath>
 using namespace std;
 
-//map pixels into ten dimensional feature space
+//map the colors into the six color dimensions of the feature space; this
+//does not depend on the grid steps and can be shared between runs
 
 const double PI=3.1415926;
-void Initialize(
+void InitializeColor(
 		unsigned char* L,
 		unsigned char* a,
 		unsigned char* b,
@@ -17,50 +18,99 @@ void Initialize(
 		float** a2,
 		float** b1,
 		float** b2,
-		float** x1,
-		float** x2,
-		float** y1,
-		float** y2,
-		double** W,
 		int nRows,
 		int nCols,
-		int StepX,
-		int StepY,
-		float Color,
-		float Distance
+		float Color
 	)
 {
-	float thetaL,thetaa,thetab,thetax,thetay;
+	float thetaL,thetaa,thetab;
 	for(int i=0;i<nRows;i++)
 		for(int j=0;j<nCols;j++)
 		{
 			thetaL=((float)L[i*nCols+j]/(float)255)*PI/2;
 			thetaa=((float)a[i*nCols+j]/(float)255)*PI/2;
 			thetab=((float)b[i*nCols+j]/(float)255)*PI/2;
-			thetax=((float)i/(float)StepX)*PI/2;
-			thetay=((float)j/(float)StepY)*PI/2;
 			L1[i][j]=Color*cos(thetaL);
 			L2[i][j]=Color*sin(thetaL);
 			a1[i][j]=Color*cos(thetaa)*2.55;
 			a2[i][j]=Color*sin(thetaa)*2.55;
 			b1[i][j]=Color*cos(thetab)*2.55;
 			b2[i][j]=Color*sin(thetab)*2.55;
-			x1[i][j]=Distance*cos(thetax);
-			x2[i][j]=Distance*sin(thetax);
-			y1[i][j]=Distance*cos(thetay);
-			y2[i][j]=Distance*sin(thetay);
 		}
+	return;
+}
+
+//map the coordinates into the four spatial dimensions and normalize all ten
+//dimensions by the weights W; the color dimensions are read from cL1 to cb2,
+//which may be the same arrays as L1 to b2
+
+void InitializeSpatial(
+		float** cL1,
+		float** cL2,
+		float** ca1,
+		float** ca2,
+		float** cb1,
+		float** cb2,
+		float** L1,
+		float** L2,
+		float** a1,
+		float** a2,
+		float** b1,
+		float** b2,
+		float** x1,
+		float** x2,
+		float** y1,
+		float** y2,
+		double** W,
+		int nRows,
+		int nCols,
+		int StepX,
+		int StepY,
+		float Distance
+	)
+{
+	//the spatial dimensions only vary along one axis each
+	float* X1=new float[nRows];
+	float* X2=new float[nRows];
+	float* Y1=new float[nCols];
+	float* Y2=new float[nCols];
+	float thetax,thetay;
+	for(int i=0;i<nRows;i++)
+	{
+		thetax=((float)i/(float)StepX)*PI/2;
+		X1[i]=Distance*cos(thetax);
+		X2[i]=Distance*sin(thetax);
+	}
+	for(int j=0;j<nCols;j++)
+	{
+		thetay=((float)j/(float)StepY)*PI/2;
+		Y1[j]=Distance*cos(thetay);
+		Y2[j]=Distance*sin(thetay);
+	}
+	for(int i=0;i<nRows;i++)
+		for(int j=0;j<nCols;j++)
+		{
+			x1[i][j]=X1[i];
+			x2[i][j]=X2[i];
+			y1[i][j]=Y1[j];
+			y2[i][j]=Y2[j];
+		}
+	delete []X1;
+	delete []X2;
+	delete []Y1;
+	delete []Y2;
+
 	double sigmaL1=0,sigmaL2=0,sigmaa1=0,sigmaa2=0,sigmab1=0,sigmab2=0,sigmax1=0,sigmax2=0,sigmay1=0,sigmay2=0;
 	double size=nRows*nCols;
 	for(int i=0;i<nRows;i++)
 		for(int j=0;j<nCols;j++)
 		{
-			sigmaL1+=L1[i][j];
-			sigmaL2+=L2[i][j];
-			sigmaa1+=a1[i][j];
-			sigmaa2+=a2[i][j];
-			sigmab1+=b1[i][j];
-			sigmab2+=b2[i][j];
+			sigmaL1+=cL1[i][j];
+			sigmaL2+=cL2[i][j];
+			sigmaa1+=ca1[i][j];
+			sigmaa2+=ca2[i][j];
+			sigmab1+=cb1[i][j];
+			sigmab2+=cb2[i][j];
 			sigmax1+=x1[i][j];
 			sigmax2+=x2[i][j];
 			sigmay1+=y1[i][j];
@@ -79,22 +129,22 @@ void Initialize(
 	for(int i=0;i<nRows;i++)
 		for(int j=0;j<nCols;j++)
 		{
-			W[i][j]=L1[i][j]*sigmaL1+
-					L2[i][j]*sigmaL2+
-					a1[i][j]*sigmaa1+
-					a2[i][j]*sigmaa2+
-					b1[i][j]*sigmab1+
-					b2[i][j]*sigmab2+
+			W[i][j]=cL1[i][j]*sigmaL1+
+					cL2[i][j]*sigmaL2+
+					ca1[i][j]*sigmaa1+
+					ca2[i][j]*sigmaa2+
+					cb1[i][j]*sigmab1+
+					cb2[i][j]*sigmab2+
 					x1[i][j]*sigmax1+
 					x2[i][j]*sigmax2+
 					y1[i][j]*sigmay1+
 					y2[i][j]*sigmay2;
-			L1[i][j]/=W[i][j];
-			L2[i][j]/=W[i][j];
-			a1[i][j]/=W[i][j];
-			a2[i][j]/=W[i][j];
-			b1[i][j]/=W[i][j];
-			b2[i][j]/=W[i][j];
+			L1[i][j]=cL1[i][j]/W[i][j];
+			L2[i][j]=cL2[i][j]/W[i][j];
+			a1[i][j]=ca1[i][j]/W[i][j];
+			a2[i][j]=ca2[i][j]/W[i][j];
+			b1[i][j]=cb1[i][j]/W[i][j];
+			b2[i][j]=cb2[i][j]/W[i][j];
 			x1[i][j]/=W[i][j];
 			x2[i][j]/=W[i][j];
 			y1[i][j]/=W[i][j];
@@ -102,4 +152,34 @@ void Initialize(
 		}
 	return;
 }
+
+//map pixels into ten dimensional feature space
+
+void Initialize(
+		unsigned char* L,
+		unsigned char* a,
+		unsigned char* b,
+		float** L1,
+		float** L2,
+		float** a1,
+		float** a2,
+		float** b1,
+		float** b2,
+		float** x1,
+		float** x2,
+		float** y1,
+		float** y2,
+		double** W,
+		int nRows,
+		int nCols,
+		int StepX,
+		int StepY,
+		float Color,
+		float Distance
+	)
+{
+	InitializeColor(L,a,b,L1,L2,a1,a2,b1,b2,nRows,nCols,Color);
+	InitializeSpatial(L1,L2,a1,a2,b1,b2,L1,L2,a1,a2,b1,b2,x1,x2,y1,y2,W,nRows,nCols,StepX,StepY,Distance);
+	return;
+}
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef LSCSUPERPIXEL
 #define LSCSUPERPIXEL
 
+#include<vector>
 #include"Initialize.h"
 #include"Seeds.h"
 #include"DoSuperpixel.h"
@@ -9,19 +10,15 @@
 #include "countSuperpixel.h"
 using namespace std;
 
-//LSC superpixel segmentation algorithm
+//LSC superpixel segmentation algorithm for several grid steps on the same
+//image; the color conversion and the color part of the feature mapping are
+//computed once and label[k] receives the segmentation for StepY[k], StepX[k]
 
-void LSC(unsigned char* R,unsigned char* G,unsigned char* B,int nRows,int nCols,int StepY,int StepX,double ratio,int iterationNum,int thresholdCoef,int color_space,unsigned short* label)
+void LSC(unsigned char* R,unsigned char* G,unsigned char* B,int nRows,int nCols,const vector<int>& StepY,const vector<int>& StepX,double ratio,int iterationNum,int thresholdCoef,int color_space,const vector<unsigned short*>& label)
 {
-        int RowNum=nRows/StepY;
-        int ColNum=nCols/StepX;
-        int superpixelnum=RowNum*ColNum;    
         //Setting Parameter
 	float colorCoefficient=20;
 	float distCoefficient=colorCoefficient*ratio;
-	int seedNum=superpixelnum;
-//	int iterationNum=20;
-//	int thresholdCoef=4;
 
 	unsigned char *L, *a, *b;
         
@@ -40,17 +37,31 @@ void LSC(unsigned char* R,unsigned char* G,unsigned char* B,int nRows,int nCols,
                 b=B;
         }
 
-	//Produce Seeds
-//	int ColNum,RowNum;
-//        int StepY,StepX;
-//	ColNum=sqrt(float(seedNum*nCols/nRows));
-//	RowNum=seedNum/ColNum;
-//	StepX=nRows/RowNum;
-//	StepY=nCols/ColNum;
-	point *seedArray=new point[seedNum];
-	int newSeedNum=Seeds(nRows,nCols,RowNum,ColNum,StepY,StepX,seedNum,seedArray);
+	//Color part of the feature mapping, shared by all steps
+	float **cL1,**cL2,**ca1,**ca2,**cb1,**cb2;
+	cL1=new float*[nRows];
+	cL2=new float*[nRows];
+	ca1=new float*[nRows];
+	ca2=new float*[nRows];
+	cb1=new float*[nRows];
+	cb2=new float*[nRows];
+	for(int i=0;i<nRows;i++)
+	{
+		cL1[i]=new float[nCols];
+		cL2[i]=new float[nCols];
+		ca1[i]=new float[nCols];
+		ca2[i]=new float[nCols];
+		cb1[i]=new float[nCols];
+		cb2[i]=new float[nCols];
+	}
+	InitializeColor(L,a,b,cL1,cL2,ca1,ca2,cb1,cb2,nRows,nCols,colorCoefficient);
+	if(color_space>0)
+	{
+		delete [] L;
+		delete [] a;
+		delete [] b;
+	}
 
-	//Initialization
 	float **L1,**L2,**a1,**a2,**b1,**b2,**x1,**x2,**y1,**y2;
 	double **W;
 	L1=new float*[nRows];
@@ -78,22 +89,37 @@ void LSC(unsigned char* R,unsigned char* G,unsigned char* B,int nRows,int nCols,
 		y2[i]=new float[nCols];
 		W[i]=new double[nCols];
 	}
-	Initialize(L,a,b,L1,L2,a1,a2,b1,b2,x1,x2,y1,y2,W,nRows,nCols,StepX,StepY,colorCoefficient,distCoefficient);
-	delete [] L;
-	delete [] a;
-	delete [] b;
 
+	for(unsigned int k=0;k<StepY.size();k++)
+	{
+		int RowNum=nRows/StepY[k];
+		int ColNum=nCols/StepX[k];
+		int seedNum=RowNum*ColNum;
 
-	//Produce Superpixel
-	DoSuperpixel(L1,L2,a1,a2,b1,b2,x1,x2,y1,y2,W,label,seedArray,newSeedNum,nRows,nCols,StepX,StepY,iterationNum,thresholdCoef);
-	delete []seedArray;
-        
-//        preEnforceConnectivity(label, nRows, nCols);
-	countSuperpixel(label,nRows,nCols);
+		//Produce Seeds
+		point *seedArray=new point[seedNum];
+		int newSeedNum=Seeds(nRows,nCols,RowNum,ColNum,StepY[k],StepX[k],seedNum,seedArray);
+
+		//Initialization
+		InitializeSpatial(cL1,cL2,ca1,ca2,cb1,cb2,L1,L2,a1,a2,b1,b2,x1,x2,y1,y2,W,nRows,nCols,StepX[k],StepY[k],distCoefficient);
+
+		//Produce Superpixel
+		DoSuperpixel(L1,L2,a1,a2,b1,b2,x1,x2,y1,y2,W,label[k],seedArray,newSeedNum,nRows,nCols,StepX[k],StepY[k],iterationNum,thresholdCoef);
+		delete []seedArray;
+
+//	        preEnforceConnectivity(label[k], nRows, nCols);
+		countSuperpixel(label[k],nRows,nCols);
+	}
 
 	//Clear Memory
 	for(int i=0;i<nRows;i++)
 	{
+		delete [] cL1[i];
+		delete [] cL2[i];
+		delete [] ca1[i];
+		delete [] ca2[i];
+		delete [] cb1[i];
+		delete [] cb2[i];
 		delete [] L1[i];
 		delete [] L2[i];
 		delete [] a1[i];
@@ -107,6 +133,12 @@ void LSC(unsigned char* R,unsigned char* G,unsigned char* B,int nRows,int nCols,
 		delete [] W[i];
 
 	}
+	delete []cL1;
+	delete []cL2;
+	delete []ca1;
+	delete []ca2;
+	delete []cb1;
+	delete []cb2;
 	delete []L1;
 	delete []L2;
 	delete []a1;
@@ -120,6 +152,13 @@ void LSC(unsigned char* R,unsigned char* G,unsigned char* B,int nRows,int nCols,
 	delete []W;
 }
 
+//LSC superpixel segmentation algorithm
+
+void LSC(unsigned char* R,unsigned char* G,unsigned char* B,int nRows,int nCols,int StepY,int StepX,double ratio,int iterationNum,int thresholdCoef,int color_space,unsigned short* label)
+{
+	LSC(R,G,B,nRows,nCols,vector<int>(1,StepY),vector<int>(1,StepX),ratio,iterationNum,thresholdCoef,color_space,vector<unsigned short*>(1,label));
+}
+
 void LSC(unsigned char* R,unsigned char* G,unsigned char* B,int nRows,int nCols,int StepY,int StepX,double ratio,unsigned short* label)
 {
         int RowNum=nRows/StepY;
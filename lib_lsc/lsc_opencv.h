@@ -53,6 +53,29 @@ public:
     static void computeSuperpixels(const cv::Mat &image, int region_height, 
             int region_width, double ratio, int iterations, int threshold, 
             int color_space, cv::Mat &labels)
+    {
+        std::vector<cv::Mat> all_labels;
+        computeSuperpixels(image, std::vector<int>(1, region_height), 
+                std::vector<int>(1, region_width), ratio, iterations, threshold, 
+                color_space, all_labels);
+        labels = all_labels[0];
+    }
+    
+    /** \brief Compute superpixels using LSC for several region sizes; the color
+     * conversion and the color part of the feature mapping are computed once.
+     * \param[in] image image to computer superpixels on
+     * \param[in] region_heights horizontal steps between superpixel centers
+     * \param[in] region_widths vertical steps between superpixel centers
+     * \param[in] ration compactness parameter
+     * \param[in] iterations number of iterations
+     * \param[in] threshold threshold for enforcing connectivity
+     * \param[in] color space, >0 for Lab, 0 for RGB
+     * \param[out] labels superpixel labels, one per region size
+     */
+    static void computeSuperpixels(const cv::Mat &image, 
+            const std::vector<int> &region_heights, const std::vector<int> &region_widths, 
+            double ratio, int iterations, int threshold, int color_space, 
+            std::vector<cv::Mat> &labels)
     {
         unsigned char* R = new unsigned char[image.rows*image.cols];
         unsigned char* G = new unsigned char[image.rows*image.cols];
@@ -66,20 +89,32 @@ public:
             }
         }
         
-        unsigned short* labeling = new unsigned short[image.rows*image.cols];
-        for (int i = 0; i < image.rows*image.cols; i++) {
-            labeling[i] = 0;
+        std::vector<unsigned short*> labelings(region_heights.size());
+        for (unsigned int k = 0; k < labelings.size(); k++) {
+            labelings[k] = new unsigned short[image.rows*image.cols];
+            for (int i = 0; i < image.rows*image.cols; i++) {
+                labelings[k][i] = 0;
+            }
         }
         
-        LSC(R, G, B, image.rows, image.cols, region_height, region_width, ratio, 
-                iterations, threshold, color_space, labeling);
+        LSC(R, G, B, image.rows, image.cols, region_heights, region_widths, ratio, 
+                iterations, threshold, color_space, labelings);
         
-        labels.create(image.rows, image.cols, CV_32SC1);
-        for (int i = 0; i < image.rows; i++) {
-            for (int j = 0; j < image.cols; j++) {
-                labels.at<int>(i, j) = labeling[i*image.cols + j];
+        labels.resize(labelings.size());
+        for (unsigned int k = 0; k < labelings.size(); k++) {
+            labels[k].create(image.rows, image.cols, CV_32SC1);
+            for (int i = 0; i < image.rows; i++) {
+                for (int j = 0; j < image.cols; j++) {
+                    labels[k].at<int>(i, j) = labelings[k][i*image.cols + j];
+                }
             }
+            
+            delete[] labelings[k];
         }
+        
+        delete[] R;
+        delete[] G;
+        delete[] B;
     }
 };
 
@@ -1,81 +1,101 @@
 #ifndef ENFORCECONNECTIVITY
 #define ENFORCECONNECTIVITY
 
-#include<queue>
 #include<vector>
+#include<algorithm>
+#include<functional>
+#include"connected_components.h"
 using namespace std;
 
-//Enforce Connectivity by merging very small superpixels with their neighbors
+//8-connected components of the label image in a single union-find pass,
+//numbered from 0; returns the number of components
 
-void preEnforceConnectivity(unsigned short int* label, int nRows,int nCols)
+static inline int LabelComponents(const unsigned short int* label,int nRows,int nCols,vector<int>& comp)
+{
+	comp.resize(nRows*nCols);
+	ConnectedComponents cc(nRows*nCols/16+1);
+	return cc.connected(label,&comp[0],nCols,nRows,equal_to<unsigned short int>(),true);
+}
+
+//Neighbors of the components with less than limit pixels (8-neighborhood),
+//visiting only the pixels of these components
+
+static inline void SmallComponentNeighbors(const vector<int>& comp,const vector<int>& Size,int limit,int nRows,int nCols,vector< vector<int> >& Neighbor)
 {
 	const int dx8[8] = {-1, -1,  0,  1, 1, 1, 0, -1};
 	const int dy8[8] = { 0, -1, -1, -1, 0, 1, 1,  1};
-	int adj=0;
-	int Bond=20;
-	bool **mask=new bool* [nRows];
+	Neighbor.assign(Size.size(),vector<int>());
 	for(int i=0;i<nRows;i++)
-	{
-		mask[i]=new bool[nCols];
 		for(int j=0;j<nCols;j++)
-			mask[i][j]=0;
+		{
+			int L=comp[i*nCols+j];
+			if(Size[L]>=limit)
+				continue;
+			for(int k=0;k<8;k++)
+			{
+				int x=i+dx8[k];
+				int y=j+dy8[k];
+				if(x>=0&&x<=nRows-1&&y>=0&&y<=nCols-1)
+				{
+					int N=comp[x*nCols+y];
+					if(N!=L&&(Neighbor[L].empty()||Neighbor[L].back()!=N))
+						Neighbor[L].push_back(N);
+				}
+			}
+		}
+	for(int L=0;L<Neighbor.size();L++)
+	{
+		sort(Neighbor[L].begin(),Neighbor[L].end());
+		Neighbor[L].erase(unique(Neighbor[L].begin(),Neighbor[L].end()),Neighbor[L].end());
 	}
-	vector<unsigned short> xLoc;
-	vector<unsigned short> yLoc;
+}
+
+//Enforce Connectivity by merging very small superpixels with their neighbors
+//(the largest adjacent one)
+
+void preEnforceConnectivity(unsigned short int* label, int nRows,int nCols)
+{
+	int Bond=20;
+	vector<int> comp;
+	int num=LabelComponents(label,nRows,nCols,comp);
+
+	vector<int> Size(num,0);
+	vector<unsigned short int> oldLabel(num);
+	for(int i=0;i<nRows*nCols;i++)
+	{
+		Size[comp[i]]++;
+		oldLabel[comp[i]]=label[i];
+	}
+
+	const int dx8[8] = {-1, -1,  0,  1, 1, 1, 0, -1};
+	const int dy8[8] = { 0, -1, -1, -1, 0, 1, 1,  1};
+	vector<int> best(num,-1);
 	for(int i=0;i<nRows;i++)
 		for(int j=0;j<nCols;j++)
 		{
-			if(mask[i][j]==0)
+			int L=comp[i*nCols+j];
+			if(Size[L]>=Bond)
+				continue;
+			for(int k=0;k<8;k++)
 			{
-				int L=label[i*nCols+j];
-				for(int k=0;k<8;k++)
-				{
-					int x=i+dx8[k];
-					int y=j+dy8[k];
-					if(x>=0&&x<=nRows-1&&y>=0&&y<=nCols-1)
-					{
-						if(mask[x][y]==1&&label[x*nCols+y]!=L)
-							adj=label[x*nCols+y];break;
-					}
-				}
-				mask[i][j]=1;
-				xLoc.insert(xLoc.end(),i);
-				yLoc.insert(yLoc.end(),j);
-				int indexMarker=0;
-				while(indexMarker<xLoc.size())
-				{
-					int x=xLoc[indexMarker];int y=yLoc[indexMarker];
-					indexMarker++;
-					int minX=(x-1<=0)?0:x-1;
-					int maxX=(x+1>=nRows-1)?nRows-1:x+1;
-					int minY=(y-1<=0)?0:y-1;
-					int maxY=(y+1>=nCols-1)?nCols-1:y+1;
-					for(int m=minX;m<=maxX;m++)
-						for(int n=minY;n<=maxY;n++)
-						{
-							if(mask[m][n]==0&&label[m*nCols+n]==L)
-							{
-								mask[m][n]=1;
-								xLoc.insert(xLoc.end(),m);
-								yLoc.insert(yLoc.end(),n);
-							}
-						}
-				}
-				if(indexMarker<Bond)
+				int x=i+dx8[k];
+				int y=j+dy8[k];
+				if(x>=0&&x<=nRows-1&&y>=0&&y<=nCols-1)
 				{
-					for(int k=0;k<xLoc.size();k++)
-					{
-						int x=xLoc[k];int y=yLoc[k];
-						label[x*nCols+y]=adj;
-					}
+					int N=comp[x*nCols+y];
+					if(N!=L&&(best[L]<0||Size[N]>Size[best[L]]))
+						best[L]=N;
 				}
-				xLoc.clear();
-				yLoc.clear();
 			}
 		}
-	for(int i=0;i<nRows;i++)
-		delete [] mask[i];
-	delete [] mask;
+
+	vector<unsigned short int> newLabel(oldLabel);
+	for(int L=0;L<num;L++)
+		if(best[L]>=0)
+			newLabel[L]=oldLabel[best[L]];
+
+	for(int i=0;i<nRows*nCols;i++)
+		label[i]=newLabel[comp[i]];
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -3,6 +3,7 @@
 
 #include <opencv2/opencv.hpp>
 #include <queue>
+#include <vector>
 
 struct Pixel {
 	int row;
@@ -128,4 +129,101 @@ template<typename T> void ImageReconstruct(Mat& marker, Mat& mask)
 	tempMaskImage.release();
 }
 
+// Hybrid raster/anti-raster + FIFO reconstruction by dilation (Vincent, 1993)
+// on 8-connected neighborhoods, producing the same result as ImageReconstruct.
+// The padded marker/mask buffers and the pixel queue are kept between calls,
+// so one instance should be reused for images of the same size.
+template<typename T> class ImageReconstructor
+{
+public:
+	// Reconstructs marker under mask and writes the result to result, which
+	// may be marker or mask.
+	void reconstruct(const Mat& marker, const Mat& mask, Mat& result)
+	{
+		CV_Assert(marker.size() == mask.size() && marker.type() == mask.type());
+		CV_Assert(marker.channels() == 1 && marker.elemSize() == sizeof(T));
+
+		const int rows = marker.rows;
+		const int cols = marker.cols;
+		const int stride = cols + 2;
+		const size_t size = (size_t) (rows + 2) * stride;
+
+		// A one pixel border of zeros in both images never propagates.
+		markerBuffer.assign(size, 0);
+		maskBuffer.assign(size, 0);
+		for(int row = 0; row < rows; row++) {
+			const T* markerRow = marker.ptr<T>(row);
+			const T* maskRow = mask.ptr<T>(row);
+			T* m = &markerBuffer[(row + 1) * stride + 1];
+			T* k = &maskBuffer[(row + 1) * stride + 1];
+			for(int col = 0; col < cols; col++) {
+				m[col] = markerRow[col];
+				k[col] = maskRow[col];
+			}
+		}
+
+		T* m = &markerBuffer[0];
+		const T* k = &maskBuffer[0];
+
+		for(int row = 1; row <= rows; row++) {
+			for(int p = row * stride + 1; p <= row * stride + cols; p++) {
+				T currentPixel = m[p];
+				currentPixel = std::max(currentPixel, m[p - 1]);
+				currentPixel = std::max(currentPixel, m[p - stride - 1]);
+				currentPixel = std::max(currentPixel, m[p - stride]);
+				currentPixel = std::max(currentPixel, m[p - stride + 1]);
+				m[p] = std::min(currentPixel, k[p]);
+			}
+		}
+
+		pixelQueue.clear();
+		for(int row = rows; row >= 1; row--) {
+			for(int p = row * stride + cols; p >= row * stride + 1; p--) {
+				T currentPixel = m[p];
+				currentPixel = std::max(currentPixel, m[p + 1]);
+				currentPixel = std::max(currentPixel, m[p + stride + 1]);
+				currentPixel = std::max(currentPixel, m[p + stride]);
+				currentPixel = std::max(currentPixel, m[p + stride - 1]);
+				currentPixel = std::min(currentPixel, k[p]);
+				m[p] = currentPixel;
+
+				if((m[p + 1] < currentPixel && m[p + 1] < k[p + 1])
+						|| (m[p + stride + 1] < currentPixel && m[p + stride + 1] < k[p + stride + 1])
+						|| (m[p + stride] < currentPixel && m[p + stride] < k[p + stride])
+						|| (m[p + stride - 1] < currentPixel && m[p + stride - 1] < k[p + stride - 1])) {
+					pixelQueue.push_back(p);
+				}
+			}
+		}
+
+		const int offsets[8] = {-stride - 1, -stride, -stride + 1, -1, 1,
+			stride - 1, stride, stride + 1};
+		for(size_t head = 0; head < pixelQueue.size(); head++) {
+			const int p = pixelQueue[head];
+			const T currentPixel = m[p];
+			for(int i = 0; i < 8; i++) {
+				const int q = p + offsets[i];
+				if(m[q] < currentPixel && k[q] != m[q]) {
+					m[q] = std::min(currentPixel, k[q]);
+					pixelQueue.push_back(q);
+				}
+			}
+		}
+
+		result.create(rows, cols, marker.type());
+		for(int row = 0; row < rows; row++) {
+			const T* src = &markerBuffer[(row + 1) * stride + 1];
+			T* dst = result.ptr<T>(row);
+			for(int col = 0; col < cols; col++) {
+				dst[col] = src[col];
+			}
+		}
+	}
+
+private:
+	std::vector<T> markerBuffer;
+	std::vector<T> maskBuffer;
+	std::vector<int> pixelQueue;
+};
+
 #endif
@@ -32,8 +32,107 @@
 #ifndef MSS_H
 #define	MSS_H
 
+#include <vector>
+#include <algorithm>
 #include "imagereconstruct.hpp"
 
+/** \brief Rectangle with anchor, part of a structuring element decomposition. */
+struct StructElemRect {
+    cv::Mat element;
+    cv::Point anchor;
+};
+
+/** \brief Decompose a structuring element whose rows are runs centered on
+ * the anchor column (e.g. ellipses and crosses) into rectangles whose union
+ * is the element; erosion/dilation by the element is the minimum/maximum over
+ * the rectangles, and OpenCV filters rectangles separably with SIMD.
+ * \return the rectangles, empty if the element cannot be decomposed this way
+ */
+inline std::vector<StructElemRect> DecomposeStructElem(const cv::Mat& StructElem) {
+    
+    std::vector<StructElemRect> rects;
+    cv::Point anchor(StructElem.cols/2, StructElem.rows/2);
+    
+    std::vector<int> halfWidths(StructElem.rows, -1);
+    for (int r = 0; r < StructElem.rows; r++) {
+        int d = -1;
+        while (anchor.x + d + 1 < StructElem.cols && anchor.x - d - 1 >= 0
+                && StructElem.at<uchar>(r, anchor.x + d + 1) != 0
+                && StructElem.at<uchar>(r, anchor.x - d - 1) != 0) {
+            d++;
+        }
+        halfWidths[r] = d;
+    }
+    
+    std::vector<int> distinct(halfWidths.begin(), halfWidths.end());
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+    
+    cv::Mat Union = cv::Mat::zeros(StructElem.size(), CV_8U);
+    for (unsigned int i = 0; i < distinct.size(); i++) {
+        int d = distinct[i];
+        if (d < 0) {
+            continue;
+        }
+        
+        // The rows at least 2d + 1 wide have to be a band around the anchor.
+        int top = anchor.y;
+        int bottom = anchor.y;
+        if (halfWidths[anchor.y] < d) {
+            return std::vector<StructElemRect>();
+        }
+        while (top > 0 && halfWidths[top - 1] >= d) {
+            top--;
+        }
+        while (bottom < StructElem.rows - 1 && halfWidths[bottom + 1] >= d) {
+            bottom++;
+        }
+        
+        StructElemRect rect;
+        rect.anchor = cv::Point(d, anchor.y - top);
+        rect.element = cv::getStructuringElement(cv::MORPH_RECT, 
+                cv::Size(2*d + 1, bottom - top + 1), rect.anchor);
+        rects.push_back(rect);
+        
+        Union(cv::Rect(anchor.x - d, top, 2*d + 1, bottom - top + 1)).setTo(1);
+    }
+    
+    cv::Mat Element = StructElem != 0;
+    if (rects.empty() || cv::countNonZero((Union != 0) != Element) > 0) {
+        return std::vector<StructElemRect>();
+    }
+    
+    return rects;
+}
+
+/** \brief Erosion (cv::MORPH_ERODE) or dilation (cv::MORPH_DILATE) by a
+ * structuring element, using its decomposition if available.
+ */
+inline void MorphStructElem(int op, const cv::Mat& src, cv::Mat& dst, 
+        const cv::Mat& StructElem, const std::vector<StructElemRect>& rects) {
+    
+    if (rects.empty()) {
+        cv::morphologyEx(src, dst, op, StructElem);
+        return;
+    }
+    
+    cv::Mat result;
+    cv::Mat part;
+    for (unsigned int i = 0; i < rects.size(); i++) {
+        cv::morphologyEx(src, i == 0 ? result : part, op, rects[i].element, rects[i].anchor);
+        if (i > 0) {
+            if (op == cv::MORPH_ERODE) {
+                result = cv::min(result, part);
+            }
+            else {
+                result = cv::max(result, part);
+            }
+        }
+    }
+    
+    dst = result;
+}
+
 int MSP(const cv::Mat& InpImg3C, cv::Mat& ImgMarker, int SizeStructElem = 7, 
         double Noise = 3.0f, double TolerRange = 7.0f, 
         int SPsizeX = 30, int SPsizeY = 30, int maxNoOfIter = 3) {
@@ -42,6 +141,11 @@ int MSP(const cv::Mat& InpImg3C, cv::Mat& ImgMarker, int SizeStructElem = 7,
 
     cv::Mat StructElem = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(SizeStructElem,SizeStructElem));
     cv::Mat StructElem3 = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3,3));
+    std::vector<StructElemRect> StructElemRects = DecomposeStructElem(StructElem);
+    std::vector<StructElemRect> StructElem3Rects = DecomposeStructElem(StructElem3);
+    
+    // Reused for all reconstructions, all images have the same size.
+    ImageReconstructor<unsigned char> Reconstructor;
 
     /////////////////////////////////////////////////////////////////////////////////
     //Image preprocessing using Morphological grayscale reconstruct
@@ -56,16 +160,14 @@ int MSP(const cv::Mat& InpImg3C, cv::Mat& ImgMarker, int SizeStructElem = 7,
     cv::split(InpImg3Ccopy,channels);
     for(int ch = 0; ch < 3; ch++) {
         cv::bitwise_not(channels[ch],channels[ch]);
-        cv::erode(channels[ch], sourceReconstr,StructElem);
+        MorphStructElem(cv::MORPH_ERODE, channels[ch], sourceReconstr, StructElem, StructElemRects);
 
-        ImageReconstruct < unsigned char > ( sourceReconstr, channels[ch]);
-        sourceReconstr.copyTo(channels[ch]);
+        Reconstructor.reconstruct(sourceReconstr, channels[ch], channels[ch]);
 
         cv::bitwise_not(channels[ch],channels[ch]);
-        cv::erode(channels[ch], sourceReconstr,StructElem);
+        MorphStructElem(cv::MORPH_ERODE, channels[ch], sourceReconstr, StructElem, StructElemRects);
 
-        ImageReconstruct < unsigned char > ( sourceReconstr, channels[ch]);
-        sourceReconstr.copyTo(channels[ch]);
+        Reconstructor.reconstruct(sourceReconstr, channels[ch], channels[ch]);
     }
     cv::merge(channels, InpImg3Ccopy);
     //cvtColor(InpImg3Ccopy,FilterInpIm,cv::COLOR_Lab2BGR);
@@ -106,8 +208,8 @@ int MSP(const cv::Mat& InpImg3C, cv::Mat& ImgMarker, int SizeStructElem = 7,
         cv::Mat blurIm;
         cv::Mat BlurImWide;
 
-        cv::erode(chnls[ch],BlurImWide,StructElem3);
-        cv::dilate(chnls[ch],blurIm,StructElem3);
+        MorphStructElem(cv::MORPH_ERODE, chnls[ch], BlurImWide, StructElem3, StructElem3Rects);
+        MorphStructElem(cv::MORPH_DILATE, chnls[ch], blurIm, StructElem3, StructElem3Rects);
         DifBlurIm =  blurIm-BlurImWide;
         if(ch == 0) { 
             DifBlurIm.copyTo(edgeAll);
@@ -122,11 +224,8 @@ int MSP(const cv::Mat& InpImg3C, cv::Mat& ImgMarker, int SizeStructElem = 7,
     cv::Mat edgeAllMask = edgeAll.clone();
     edgeAllMask.setTo(0,MaskNot);
 
-    cv::Mat edgeAll16, edgeAllMask16;
-    edgeAll.convertTo(edgeAll16, CV_16UC1);
-    edgeAllMask.convertTo(edgeAllMask16, CV_16UC1);
-    ImageReconstruct<unsigned short>(edgeAllMask16, edgeAll16);
-    edgeAllMask16.convertTo(edge,CV_8U);
+    // The reconstruction only takes values of edgeAll, so it is exact in 8 bit.
+    Reconstructor.reconstruct(edgeAllMask, edgeAll, edge);
 
 
     cv::Mat Seeds = edge.clone();\
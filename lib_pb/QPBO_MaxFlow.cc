@@ -99,4 +99,163 @@ MaxFlowQPBO::MaxFlowQPBO( const Matrix< float >& A,
             Seg[i][j] = g.what_segment( this->node(i,j) );
 }
 
+MaxFlowQPBOSolver::MaxFlowQPBOSolver() :
+    graph_( NULL ),
+    idim_( 0 ),
+    jdim_( 0 ),
+    solved_( false )
+{
+}
+
+MaxFlowQPBOSolver::~MaxFlowQPBOSolver()
+{
+    delete this->graph_;
+}
+
+void
+MaxFlowQPBOSolver::build( int idim, int jdim )
+{
+    delete this->graph_;
+    
+    this->idim_ = idim;
+    this->jdim_ = jdim;
+    this->solved_ = false;
+    
+    this->graph_ = new GraphType( idim * jdim,
+                                  idim * ( jdim - 1 ) + jdim * ( idim - 1 ) );
+    this->graph_->add_node( idim * jdim );
+    
+    // All edges are added (in the order used by MaxFlowQPBO), truncated ones 
+    // get zero capacities in solve().  add_edge() skips edges without any
+    // capacity, so a placeholder is used.
+    for (int i=0; i<idim; ++i)
+        for (int j=0; j<jdim-1; ++j)
+            this->graph_->add_edge( this->node( i, j ), this->node( i, j + 1 ), 1.0f, 1.0f );
+    
+    for (int i=0; i<idim-1; ++i)
+        for (int j=0; j<jdim; ++j)
+            this->graph_->add_edge( this->node( i, j ), this->node( i + 1, j ), 1.0f, 1.0f );
+    
+    this->tcap_.assign( idim * jdim, 0.0f );
+    this->right_.assign( idim * jdim, 0.0f );
+    this->down_.assign( idim * jdim, 0.0f );
+}
 
+void
+MaxFlowQPBOSolver::solve( const Matrix< float >& A, 
+                          const Matrix< float >& B_right, 
+                          const Matrix< float >& B_down, 
+                          Matrix< unsigned char >& Seg,
+                          bool warm_start )
+{
+    assert( B_right.rows() == A.rows() && B_right.cols() == A.cols() );
+    assert( B_down.rows() == A.rows() && B_down.cols() == A.cols() );
+    Seg.fill(0);
+    
+    if ( !this->graph_ || this->idim_ != (int) A.rows() || this->jdim_ != (int) A.cols() )
+        this->build( A.rows(), A.cols() );
+    
+    const bool warm = warm_start && this->solved_;
+    
+    // Capacities as in MaxFlowQPBO, summed in the same order.
+    std::vector< float > tcap( this->idim_ * this->jdim_ );
+    std::vector< float > right( this->idim_ * this->jdim_, 0.0f );
+    std::vector< float > down( this->idim_ * this->jdim_, 0.0f );
+    
+    for (int i=0; i<this->idim_; ++i)
+        for (int j=0; j<this->jdim_; ++j)
+            tcap[this->node(i,j)] = A[i][j];
+    
+    for (int i=0; i<this->idim_; ++i)
+        for (int j=0; j<this->jdim_-1; ++j)
+            if ( B_right[i][j] < 0.0f )
+            {
+                right[this->node(i,j)] = -B_right[i][j];
+                tcap[this->node(i,j+1)] += B_right[i][j];
+            }
+    
+    for (int i=0; i<this->idim_-1; ++i)
+        for (int j=0; j<this->jdim_; ++j)
+            if ( B_down[i][j] < 0.0f )
+            {
+                down[this->node(i,j)] = -B_down[i][j];
+                tcap[this->node(i+1,j)] += B_down[i][j];
+            }
+    
+    // Set the arcs; in warm start mode, keep the flow f on the arc i->j 
+    // (whose reverse capacity is always zero) if the new capacity allows it, 
+    // otherwise saturate the arc and move the excess to the terminal links.
+    GraphType::arc_id a = this->graph_->get_first_arc();
+    for (int d=0; d<2; ++d)
+    {
+        const std::vector< float >& cap = ( d == 0 ) ? right : down;
+        const std::vector< float >& old_cap = ( d == 0 ) ? this->right_ : this->down_;
+        const int di = ( d == 0 ) ? 0 : 1;
+        const int dj = ( d == 0 ) ? 1 : 0;
+        
+        for (int i=0; i<this->idim_-di; ++i)
+            for (int j=0; j<this->jdim_-dj; ++j)
+            {
+                const int p = this->node( i, j );
+                const int q = this->node( i + di, j + dj );
+                GraphType::arc_id a_rev = this->graph_->get_next_arc( a );
+                
+                if ( warm )
+                {
+                    float flow = old_cap[p] - this->graph_->get_rcap( a );
+                    if ( flow <= cap[p] )
+                    {
+                        this->graph_->set_rcap( a, cap[p] - flow );
+                        this->graph_->set_rcap( a_rev, flow );
+                    }
+                    else
+                    {
+                        this->graph_->set_rcap( a, 0.0f );
+                        this->graph_->set_rcap( a_rev, cap[p] );
+                        this->graph_->set_trcap( p, this->graph_->get_trcap( p ) + flow - cap[p] );
+                        this->graph_->set_trcap( q, this->graph_->get_trcap( q ) - flow + cap[p] );
+                    }
+                    
+                    if ( cap[p] != old_cap[p] )
+                    {
+                        this->graph_->mark_node( p );
+                        this->graph_->mark_node( q );
+                    }
+                }
+                else
+                {
+                    this->graph_->set_rcap( a, cap[p] );
+                    this->graph_->set_rcap( a_rev, 0.0f );
+                }
+                
+                a = this->graph_->get_next_arc( a_rev );
+            }
+    }
+    
+    for (int p=0; p<this->idim_*this->jdim_; ++p)
+    {
+        if ( warm )
+        {
+            if ( tcap[p] != this->tcap_[p] )
+            {
+                this->graph_->set_trcap( p, this->graph_->get_trcap( p ) + tcap[p] - this->tcap_[p] );
+                this->graph_->mark_node( p );
+            }
+        }
+        else
+            this->graph_->set_trcap( p, tcap[p] );
+    }
+    
+    // solve
+    this->graph_->maxflow( warm );
+    this->solved_ = true;
+    
+    this->tcap_.swap( tcap );
+    this->right_.swap( right );
+    this->down_.swap( down );
+    
+    // record the answer
+    for (int i=0; i<this->idim_; ++i)
+        for (int j=0; j<this->jdim_; ++j)
+            Seg[i][j] = this->graph_->what_segment( this->node(i,j) );
+}
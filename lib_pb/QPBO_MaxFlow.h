@@ -6,7 +6,9 @@
 // terms must be negative for a valid flow graph representation.  If positive
 // coefficients are encountered, the method will simply ignore them.
 
+#include <vector>
 #include "QPBO_Generic.h"
+#include "graph.h"
 
 class MaxFlowQPBO : public GenericQPBO
 {
@@ -28,4 +30,46 @@ class MaxFlowQPBO : public GenericQPBO
                      Matrix< unsigned char >& Seg );
 };
 
+// Max-Flow solver for successive problems on lattices of the same size.
+// The graph (nodes, arcs and the maxflow allocator) is built once and only
+// the capacities are reset for the next problem.  With warm_start, the flow
+// of the previous problem is kept: arcs whose new capacity is below their
+// flow are saturated and the excess is moved to the terminal links, the
+// changed nodes are marked and maxflow() reuses the search trees.
+class MaxFlowQPBOSolver
+{
+    protected:
+        typedef Graph< float, float, float > GraphType;
+
+        GraphType* graph_;
+        int idim_;
+        int jdim_;
+        bool solved_;
+        
+        // Capacities of the last problem: terminal capacity (source minus
+        // sink) per node, and capacity of the right/down arc per node.
+        std::vector< float > tcap_;
+        std::vector< float > right_;
+        std::vector< float > down_;
+
+        int
+        node( int i, int j )
+        {
+            return i * this->jdim_ + j;
+        }
+        
+        void build( int idim, int jdim );
+
+    public:
+        MaxFlowQPBOSolver();
+        ~MaxFlowQPBOSolver();
+
+        // See QPBO_Generic.h for details about these parameters.
+        void solve( const Matrix< float >& A, 
+                    const Matrix< float >& B_right, 
+                    const Matrix< float >& B_down, 
+                    Matrix< unsigned char >& Seg,
+                    bool warm_start = false );
+};
+
 #endif
@@ -591,7 +591,10 @@ template <typename captype, typename tcaptype, typename flowtype>
     }
     // test_consistency();
 
-    if (!reuse_trees || (maxflow_iteration % 64) == 0)
+    // All orphans are freed at this point, so the allocator is kept for the
+    // next call (reset() and the destructor free it); when reusing trees it
+    // is recreated every 64 iterations as before.
+    if (reuse_trees && (maxflow_iteration % 64) == 0)
     {
         delete nodeptr_block; 
         nodeptr_block = NULL; 
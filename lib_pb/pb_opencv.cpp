@@ -29,6 +29,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <thread>
 #include "graph.h"
 #include "QPBO_MaxFlow.h"
 #include "Elimination.h"
@@ -120,23 +121,17 @@ void smoothcost(const cv::Mat &im, int i1, int i2, int j1, int j2, int hsize, in
     }
 }
 
-void PB_OpenCV::computeSuperpixels(const cv::Mat& image, int region_size, 
-        float sigma, bool max_flow, cv::Mat& labels) {
+/** \brief Data and smoothness costs of the horizontal (1) and vertical (2)
+ * strip problems.
+ */
+void computeCosts(const cv::Mat &image, int strip_size, float sigma,
+        Matrix<float> &U1, Matrix<float> &Bh1, Matrix<float> &Bv1,
+        Matrix<float> &U2, Matrix<float> &Bh2, Matrix<float> &Bv2) {
     
     int width = image.cols;
     int height = image.rows;
-    int strip_size = region_size;
-    
-    if (!max_flow) {
-        strip_size *= 2;
-    }
     
-    Matrix<float> U1(height, width), U2(height, width); //to hold data cost
-    Matrix<float> Bh1(height, width), Bh2(height, width); //horizontal smooth cost
-    Matrix<float> Bv1(height, width), Bv2(height, width); //vertical smooth cost
-    Matrix<unsigned char> solution1(height, width), solution2(height, width);
-
-    struct scost *sc = (struct scost*)malloc(sizeof(struct scost));
+    struct scost sc;
 
     U1.fill(0);
     Bh1.fill(0);
@@ -148,62 +143,133 @@ void PB_OpenCV::computeSuperpixels(const cv::Mat& image, int region_size,
     for(int i = 0; i < width; i++) {
         for(int j = 0; j < height; j++) {
             if(i<width-1) {
-                smoothcost(image, i, i + 1, j, j, strip_size, strip_size, sigma, sc);
-                Bh1[j][i]   = sc->h00-sc->h01-sc->h10+sc->h11;
-                U1[j][i]   += sc->h10-sc->h00;
-                U1[j][i+1] += sc->h01-sc->h00;
-                Bh2[j][i]   = sc->v00-sc->v01-sc->v10+sc->v11;
-                U2[j][i]   += sc->v10-sc->v00;
-                U2[j][i+1] += sc->v01-sc->v00;
+                smoothcost(image, i, i + 1, j, j, strip_size, strip_size, sigma, &sc);
+                Bh1[j][i]   = sc.h00-sc.h01-sc.h10+sc.h11;
+                U1[j][i]   += sc.h10-sc.h00;
+                U1[j][i+1] += sc.h01-sc.h00;
+                Bh2[j][i]   = sc.v00-sc.v01-sc.v10+sc.v11;
+                U2[j][i]   += sc.v10-sc.v00;
+                U2[j][i+1] += sc.v01-sc.v00;
             }
 
             if(j<height-1) {
-                smoothcost(image, i, i, j, j + 1, strip_size, strip_size, sigma, sc);
-
-                Bv1[j][i]   = sc->h00-sc->h01-sc->h10+sc->h11;
-                U1[j][i]   += sc->h10-sc->h00;
-                U1[j+1][i] += sc->h01-sc->h00;
-                Bv2[j][i]   = sc->v00-sc->v01-sc->v10+sc->v11;
-                U2[j][i]   += sc->v10-sc->v00;
-                U2[j+1][i] += sc->v01-sc->v00;
+                smoothcost(image, i, i, j, j + 1, strip_size, strip_size, sigma, &sc);
+
+                Bv1[j][i]   = sc.h00-sc.h01-sc.h10+sc.h11;
+                U1[j][i]   += sc.h10-sc.h00;
+                U1[j+1][i] += sc.h01-sc.h00;
+                Bv2[j][i]   = sc.v00-sc.v01-sc.v10+sc.v11;
+                U2[j][i]   += sc.v10-sc.v00;
+                U2[j+1][i] += sc.v01-sc.v00;
             }
         }
     }
+}
 
-    if(max_flow) {
-        MaxFlowQPBO solve1(U1,Bh1,Bv1,solution1);
-        MaxFlowQPBO solve2(U2,Bh2,Bv2,solution2);
-    }
-    else {
-        Elimination< float >::solve(U1, Bh1, Bv1, solution1);
-        Elimination< float >::solve(U2, Bh2, Bv2, solution2);
-    }
-
-    cv::Mat imh(height, width, CV_16UC1);
-    cv::Mat imv(height, width, CV_16UC1);
-
-    for(int i = 0; i < width; i++) {
-        for(int j = 0; j < height; j++) {
+/** \brief Combine the solutions of the strip problems to labels.
+ */
+void computeLabels(const Matrix<unsigned char> &solution1, 
+        const Matrix<unsigned char> &solution2, int strip_size, cv::Mat &labels) {
+    
+    int width = solution1.cols();
+    int height = solution1.rows();
+    
+    labels.create(height, width, CV_32SC1);
+    for(int j = 0; j < height; j++) {
+        for(int i = 0; i < width; i++) {
+            int h;
             if(solution1[j][i] == 0) {
-                imh.at<unsigned short>(j,i) = myfloor((float) i/strip_size)*2;
+                h = myfloor((float) i/strip_size)*2;
             }
             else {
-                imh.at<unsigned short>(j,i) = myfloor((float) (i + strip_size/2)/strip_size)*2 + 1;
+                h = myfloor((float) (i + strip_size/2)/strip_size)*2 + 1;
             }
 
+            int v;
             if(solution2[j][i] == 0) {
-                imv.at<unsigned short>(j,i) = myfloor((float) j/strip_size)*2;
+                v = myfloor((float) j/strip_size)*2;
             }
             else {
-                imv.at<unsigned short>(j,i) = myfloor((float) (j + strip_size/2)/strip_size)*2 + 1;
+                v = myfloor((float) (j + strip_size/2)/strip_size)*2 + 1;
             }
+            
+            labels.at<int>(j, i) = h*width + v;
         }
     }
+}
 
-    labels.create(image.rows, image.cols, CV_32SC1);
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            labels.at<int>(i, j) = imh.at<unsigned short>(i, j)*width + imv.at<unsigned short>(i, j);
+void PB_OpenCV::computeSuperpixels(const cv::Mat& image, int region_size, 
+        float sigma, bool max_flow, cv::Mat& labels, int threads) {
+    
+    if (max_flow) {
+        if (threads > 1) {
+            MaxFlowQPBOSolver horizontal;
+            MaxFlowQPBOSolver vertical;
+            computeSuperpixels(image, region_size, sigma, horizontal, vertical, 
+                    false, labels, threads);
+            return;
         }
+        
+        // Both strip problems share the graph.
+        MaxFlowQPBOSolver solver;
+        computeSuperpixels(image, region_size, sigma, solver, solver, false, labels);
+        return;
+    }
+    
+    int width = image.cols;
+    int height = image.rows;
+    int strip_size = 2*region_size;
+    
+    Matrix<float> U1(height, width), U2(height, width); //to hold data cost
+    Matrix<float> Bh1(height, width), Bh2(height, width); //horizontal smooth cost
+    Matrix<float> Bv1(height, width), Bv2(height, width); //vertical smooth cost
+    Matrix<unsigned char> solution1(height, width), solution2(height, width);
+    
+    computeCosts(image, strip_size, sigma, U1, Bh1, Bv1, U2, Bh2, Bv2);
+    
+    // The strip problems are independent.
+    if (threads > 1) {
+        std::thread thread([&]() {
+            Elimination< float >::solve(U2, Bh2, Bv2, solution2);
+        });
+        Elimination< float >::solve(U1, Bh1, Bv1, solution1);
+        thread.join();
+    }
+    else {
+        Elimination< float >::solve(U1, Bh1, Bv1, solution1);
+        Elimination< float >::solve(U2, Bh2, Bv2, solution2);
+    }
+    
+    computeLabels(solution1, solution2, strip_size, labels);
+}
+
+void PB_OpenCV::computeSuperpixels(const cv::Mat& image, int region_size, 
+        float sigma, MaxFlowQPBOSolver& horizontal, MaxFlowQPBOSolver& vertical,
+        bool warm_start, cv::Mat& labels, int threads) {
+    
+    int width = image.cols;
+    int height = image.rows;
+    int strip_size = region_size;
+    
+    Matrix<float> U1(height, width), U2(height, width); //to hold data cost
+    Matrix<float> Bh1(height, width), Bh2(height, width); //horizontal smooth cost
+    Matrix<float> Bv1(height, width), Bv2(height, width); //vertical smooth cost
+    Matrix<unsigned char> solution1(height, width), solution2(height, width);
+    
+    computeCosts(image, strip_size, sigma, U1, Bh1, Bv1, U2, Bh2, Bv2);
+    
+    // The strip problems are independent, but a shared solver holds one graph.
+    if (threads > 1 && &horizontal != &vertical) {
+        std::thread thread([&]() {
+            vertical.solve(U2, Bh2, Bv2, solution2, warm_start);
+        });
+        horizontal.solve(U1, Bh1, Bv1, solution1, warm_start);
+        thread.join();
     }
-}
\ No newline at end of file
+    else {
+        horizontal.solve(U1, Bh1, Bv1, solution1, warm_start);
+        vertical.solve(U2, Bh2, Bv2, solution2, warm_start);
+    }
+    
+    computeLabels(solution1, solution2, strip_size, labels);
+}
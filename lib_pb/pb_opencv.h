@@ -34,6 +34,8 @@
 
 #include <opencv2/opencv.hpp>
 
+class MaxFlowQPBOSolver;
+
 /** \brief Wrapper for running PB on OpenCV images.
  * \author David Stutz
  */
@@ -45,9 +47,28 @@ public:
      * \param[in] sigma sigma parameter, see paper
      * \param[in] max_flow whether to use max flow for solving, alternative is elimination
      * \param[out] labels superpixel labels
+     * \param[in] threads number of threads, with more than one the horizontal and
+     * vertical strip problems are solved concurrently; the labels do not depend on it
+     */
+    static void computeSuperpixels(const cv::Mat &image, int region_size, float sigma, 
+            bool max_flow, cv::Mat &labels, int threads = 1);
+    
+    /** \brief Compute superpixels using PB with max flow, reusing the graphs
+     * of the given solvers (e.g. across images of the same size); the same
+     * solver may be passed for both strip problems.
+     * \param[in] image image to computer superpixels on
+     * \param[in] region_size region size between superpixels, implicitly defines number of superpixels
+     * \param[in] sigma sigma parameter, see paper
+     * \param[in,out] horizontal solver for the horizontal strips
+     * \param[in,out] vertical solver for the vertical strips
+     * \param[in] warm_start whether to start from the flow of the solvers' previous problems
+     * \param[out] labels superpixel labels
+     * \param[in] threads number of threads, with more than one and different
+     * solvers the horizontal and vertical strip problems are solved concurrently
      */
     static void computeSuperpixels(const cv::Mat &image, int region_size, float sigma, 
-            bool max_flow, cv::Mat &labels);
+            MaxFlowQPBOSolver &horizontal, MaxFlowQPBOSolver &vertical, 
+            bool warm_start, cv::Mat &labels, int threads = 1);
 };
 
 #endif	/* PB_OPENCV_H */
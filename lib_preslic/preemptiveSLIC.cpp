@@ -36,6 +36,8 @@
 
 #include <cfloat>
 #include <cmath>
+#include <atomic>
+#include <thread>
 #include <iostream>
 #include <fstream>
 #include "preemptiveSLIC.h"
@@ -53,6 +55,7 @@ PreemptiveSLIC::PreemptiveSLIC()
 	m_lvec = NULL;
 	m_avec = NULL;
 	m_bvec = NULL;
+	m_threads = 1;
 }
 
 PreemptiveSLIC::~PreemptiveSLIC()
@@ -62,6 +65,14 @@ PreemptiveSLIC::~PreemptiveSLIC()
 	if(m_bvec) delete [] m_bvec;
 }
 
+//===========================================================================
+///	SetThreads
+//===========================================================================
+void PreemptiveSLIC::SetThreads(const int threads)
+{
+	m_threads = max(1, threads);
+}
+
 
 
 
@@ -402,13 +413,6 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
     
     double invwt = 1.0/((m_sx/M)*(m_sy/M));
     
-    int x1, y1, x2, y2;
-    double l, a, b;
-    double dist;
-    double distxy;
-    double dl, da, db, dx, dy;
-    unsigned int callCount=0;
-    
     std::vector<int> klabels_new(sz, 1);
     
     // assign each pixel to the nearest cluster
@@ -424,7 +428,7 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
     int nSkippedClusters;
 
     // main iteration loop 
-    vector<double> dist_n((2*m_sx+1)*(2*m_sy+1));
+    vector<int> active;
     for( int itr = 0; itr < maxIter; itr++ )
     {      
       
@@ -435,7 +439,8 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
         nSkippedClusters = 0;
 //         distvec.assign(sz, DBL_MAX); // TODO CHANGED: uncommented
                 
-        // for each cluster
+        // collect the clusters with enough changes in their area
+        active.clear();
         for( int n = 0; n < numk; n++ )
         {
           // skip if there are too few changes in the area of this cluster
@@ -445,84 +450,209 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
             continue;
           }
           nChangesVec[n]=0;
-          
-          
-          y1 = max(0.0,           kseedsy[n]-m_sy);
-          y2 = min((double)m_height,  kseedsy[n]+m_sy);
-          x1 = max(0.0,           kseedsx[n]-m_sx);
-          x2 = min((double)m_width,   kseedsx[n]+m_sx);
-
-          // for each pixel in the area of the cluster, update label and distance
-          int i=0;          
-          
-          double kseedsl_n = kseedsl[n];
-          double kseedsa_n = kseedsa[n];
-          double kseedsb_n = kseedsb[n];
-          
-          double kseedsy_n = kseedsy[n];
-          double kseedsx_n = kseedsx[n];          
-          
-          int dist_n_idx=0;
-          
-          // compute distance for each near pixel
-          for( int y = y1; y < y2; y++ )
-          {
-            i = y*m_width + x1;
-            
-            dy = y-kseedsy_n;
+          active.push_back(n);
+        }
+        
+        // for each active cluster, update label and distance of the near pixels
+        AssignSuperpixelSLIC_preemptive(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy,
+                active, klabels_new, distvec, invwt);
+
+        //-----------------------------------------------------------------
+        // Collect number of changes per cluster
+        //-----------------------------------------------------------------
+        nChanges = CollectChanges_preemptive(klabels, klabels_new, nChangesVec, numk);
+         
+        //-----------------------------------------------------------------
+        // Recalculate the centroid and store in the seed values
+        //-----------------------------------------------------------------
+        //instead of reassigning memory on each iteration, just reset.
+    
+        sigmal.assign(numk, 0);
+        sigmaa.assign(numk, 0);
+        sigmab.assign(numk, 0);
+        sigmax.assign(numk, 0);
+        sigmay.assign(numk, 0);
+        clustersize.assign(numk, 0);
+        //------------------------------------
+        //edgesum.assign(numk, 0);
+        //------------------------------------
+        
+        AccumulateSuperpixelSLIC_preemptive(klabels, sigmal, sigmaa, sigmab, sigmax, sigmay, clustersize);
+        
+        // iterate over cluster and compute inverse of size
+        {for( int k = 0; k < numk; k++ )
+        {
+            if( clustersize[k] <= 0 ) clustersize[k] = 1;
+            inv[k] = 1.0/clustersize[k];//computing inverse now to multiply, than divide later
+        }}      
+
+        // iterate over cluster and update
+        {for( int k = 0; k < numk; k++ )
+        {
+            kseedsl[k] = sigmal[k]*inv[k];
+            kseedsa[k] = sigmaa[k]*inv[k];
+            kseedsb[k] = sigmab[k]*inv[k];
+            kseedsx[k] = sigmax[k]*inv[k];
+            kseedsy[k] = sigmay[k]*inv[k];
+            //------------------------------------
+            //edgesum[k] *= inv[k];
+            //------------------------------------
+        }}      
+        
+    } // main loop
+}
+
+//===========================================================================
+///	AssignSuperpixelSLIC_preemptive
+///
+/// Updates label and distance of the pixels in the windows of the active
+/// clusters. The seeds are bucketed into tiles of 4*max(m_sx, m_sy) by their
+/// position and the tiles are colored by the parity of their row and column.
+/// Windows of seeds in different tiles of the same color never overlap, so
+/// the tiles of one color are distributed over m_threads threads, one color
+/// after the other. Ties are resolved towards the smaller cluster index, so
+/// the labels are the same for any number of threads.
+//===========================================================================
+void PreemptiveSLIC::AssignSuperpixelSLIC_preemptive(
+    const vector<double>&       kseedsl,
+    const vector<double>&       kseedsa,
+    const vector<double>&       kseedsb,
+    const vector<double>&       kseedsx,
+    const vector<double>&       kseedsy,
+    const vector<int>&          active,
+    vector<int>&                klabels_new,
+    vector<double>&             distvec,
+    const double&               invwt)
+{
+    const double tile = 4*max(m_sx, m_sy);
+    
+    int tiles_per_row = m_width/tile + 1;
+    int tiles_per_column = m_height/tile + 1;
+    vector< vector<int> > tiles(tiles_per_row*tiles_per_column);
+    for( int k = 0; k < (int) active.size(); k++ )
+    {
+        const int n = active[k];
+        const int tx = min(tiles_per_row - 1, int(max(0.0, kseedsx[n])/tile));
+        const int ty = min(tiles_per_column - 1, int(max(0.0, kseedsy[n])/tile));
+        tiles[ty*tiles_per_row + tx].push_back(n);
+    }
+    
+    auto assign = [&](const int n)
+    {
+        const int y1 = max(0.0,                 kseedsy[n]-m_sy);
+        const int y2 = min((double)m_height,    kseedsy[n]+m_sy);
+        const int x1 = max(0.0,                 kseedsx[n]-m_sx);
+        const int x2 = min((double)m_width,     kseedsx[n]+m_sx);
+        
+        const double kseedsl_n = kseedsl[n];
+        const double kseedsa_n = kseedsa[n];
+        const double kseedsb_n = kseedsb[n];
+        const double kseedsx_n = kseedsx[n];
+        const double kseedsy_n = kseedsy[n];
+        
+        for( int y = y1; y < y2; y++ )
+        {
+            const double dy = y-kseedsy_n;
             
+            int i = y*m_width + x1;
             for( int x = x1; x < x2; x++ )
             {
-                callCount++;                
-                
-                dl = m_lvec[i]-kseedsl_n;
-                da = m_avec[i]-kseedsa_n;
-                db = m_bvec[i]-kseedsb_n;
-                dx = x-kseedsx_n;
-                                    
-                dist = dl*dl + da*da + db*db;
-                distxy = dx*dx + dy*dy;
+                const double dl = m_lvec[i]-kseedsl_n;
+                const double da = m_avec[i]-kseedsa_n;
+                const double db = m_bvec[i]-kseedsb_n;
+                const double dx = x-kseedsx_n;
                 
-                //------------------------------------------------------------------------
-                dist += distxy*invwt;//dist = sqrt(dist) + sqrt(distxy*invwt);//this is more exact
+                double dist = dl*dl + da*da + db*db;
+                const double distxy = dx*dx + dy*dy;
+                dist += distxy*invwt;
                 
-                dist_n[dist_n_idx] = dist;
-                dist_n_idx++;
-                //------------------------------------------------------------------------
+                if( dist < distvec[i] || (dist == distvec[i] && n < klabels_new[i]) )
+                {
+                    distvec[i] = dist;
+                    klabels_new[i] = n;
+                }
                 i++;
             }
-          }
-          
-          // check for each near pixel, if distance is smaller than the prior best
-          dist_n_idx=0;
-          for( int y = y1; y < y2; y++ )
-          {
-            i = y*m_width + x1;
-            for( int x = x1; x < x2; x++ )
+        }
+    };
+    
+    if( m_threads <= 1 )
+    {
+        for( int t = 0; t < (int) tiles.size(); t++ )
+        {
+            for( int k = 0; k < (int) tiles[t].size(); k++ )
             {
-              if( dist_n[dist_n_idx] < distvec[i] ) 
-              {
-                distvec[i] = dist_n[dist_n_idx];
-                klabels_new[i]  = n;
-              }
-              dist_n_idx++;
-              i++;
+                assign(tiles[t][k]);
             }
-          }
-        }  // for each cluster
+        }
+        return;
+    }
+    
+    for( int color = 0; color < 4; color++ )
+    {
+        vector<int> colored;
+        for( int ty = color/2; ty < tiles_per_column; ty += 2 )
+        {
+            for( int tx = color%2; tx < tiles_per_row; tx += 2 )
+            {
+                if( !tiles[ty*tiles_per_row + tx].empty() )
+                {
+                    colored.push_back(ty*tiles_per_row + tx);
+                }
+            }
+        }
         
- 
-
-
-        //-----------------------------------------------------------------
-        // Collect number of changes per cluster
-        //-----------------------------------------------------------------
-        int ind(0);
+        std::atomic<int> next(0);
+        auto worker = [&]()
+        {
+            for( int t = next++; t < (int) colored.size(); t = next++ )
+            {
+                const vector<int>& seeds = tiles[colored[t]];
+                for( int k = 0; k < (int) seeds.size(); k++ )
+                {
+                    assign(seeds[k]);
+                }
+            }
+        };
+        
+        const int n_threads = min(m_threads, (int) colored.size());
+        vector<std::thread> threads;
+        for( int i = 1; i < n_threads; i++ )
+        {
+            threads.push_back(std::thread(worker));
+        }
+        worker();
+        for( int i = 0; i < (int) threads.size(); i++ )
+        {
+            threads[i].join();
+        }
+    }
+}
 
+//===========================================================================
+///	CollectChanges_preemptive
+///
+/// Copies the changed labels from klabels_new to klabels and counts the
+/// changes for the new cluster and the 3x3 clusters of the seed grid around
+/// each changed pixel. With more than one thread, each thread counts the
+/// changes of a band of rows in its own vector; the counts are added up in
+/// thread order afterwards. Returns the number of changed pixels.
+//===========================================================================
+int PreemptiveSLIC::CollectChanges_preemptive(
+    int*                        klabels,
+    const vector<int>&          klabels_new,
+    vector<unsigned int>&       nChangesVec,
+    const int                   numk)
+{
+    auto collect = [&](const int r1, const int r2, unsigned int* counts) -> int
+    {
+        int nChanges = 0;
+        
         // for each pixel
         int x_seed, y_seed;
-        for( int r = 0; r < m_height; r++ )
+        for( int r = r1; r < r2; r++ )
         {
+            int ind = r*m_width;
             for( int c = 0; c < m_width; c++ )
             {
               
@@ -536,7 +666,7 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
                   // increase change counter
                   nChanges++;
   
-                  nChangesVec[ klabels[ind] ]++;
+                  counts[ klabels[ind] ]++;
                   
                   // TODO This will potentially not work for non grid like seeds
                   // Dirty fix for allowing integer valued m_sx and m_sy
@@ -545,41 +675,84 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
                   y_seed = int(r-m_pixel_offset)/int(m_sy + 1);
                   
                   // center
-                  nChangesVec[ y_seed*m_nx + x_seed ]++; // center
+                  counts[ y_seed*m_nx + x_seed ]++; // center
                     
                   // 4 neighborhoud
-                  if(x_seed>0)          nChangesVec[ y_seed*m_nx + x_seed - 1]++; // left
-                  if(x_seed<m_nx-1)     nChangesVec[ y_seed*m_nx + x_seed + 1]++; // right
-                  if(y_seed>0)          nChangesVec[ (y_seed-1)*m_nx + x_seed]++; // top
-                  if(y_seed<m_ny-1)     nChangesVec[ (y_seed+1)*m_nx + x_seed]++; // bottom
+                  if(x_seed>0)          counts[ y_seed*m_nx + x_seed - 1]++; // left
+                  if(x_seed<m_nx-1)     counts[ y_seed*m_nx + x_seed + 1]++; // right
+                  if(y_seed>0)          counts[ (y_seed-1)*m_nx + x_seed]++; // top
+                  if(y_seed<m_ny-1)     counts[ (y_seed+1)*m_nx + x_seed]++; // bottom
                     
                   // rest of 8 neighborhoud
-                  if(x_seed<m_nx-1 &&  y_seed>0)       nChangesVec[ (y_seed-1)*m_nx + x_seed + 1]++; // 
-                  if(x_seed<m_nx-1 &&  y_seed<m_ny-1)  nChangesVec[ (y_seed+1)*m_nx + x_seed + 1]++; // 
-                  if(x_seed>0 && y_seed>0)             nChangesVec[ (y_seed-1)*m_nx + x_seed - 1]++; // 
-                  if(x_seed>0 && y_seed<m_ny-1)        nChangesVec[ (y_seed+1)*m_nx + x_seed - 1]++; // 
+                  if(x_seed<m_nx-1 &&  y_seed>0)       counts[ (y_seed-1)*m_nx + x_seed + 1]++; // 
+                  if(x_seed<m_nx-1 &&  y_seed<m_ny-1)  counts[ (y_seed+1)*m_nx + x_seed + 1]++; // 
+                  if(x_seed>0 && y_seed>0)             counts[ (y_seed-1)*m_nx + x_seed - 1]++; // 
+                  if(x_seed>0 && y_seed<m_ny-1)        counts[ (y_seed+1)*m_nx + x_seed - 1]++; // 
                     
               }
               ind++;
             }
         }
-         
-        //-----------------------------------------------------------------
-        // Recalculate the centroid and store in the seed values
-        //-----------------------------------------------------------------
-        //instead of reassigning memory on each iteration, just reset.
-    
-        sigmal.assign(numk, 0);
-        sigmaa.assign(numk, 0);
-        sigmab.assign(numk, 0);
-        sigmax.assign(numk, 0);
-        sigmay.assign(numk, 0);
-        clustersize.assign(numk, 0);
-        //------------------------------------
-        //edgesum.assign(numk, 0);
-        //------------------------------------
         
-        ind=0;
+        return nChanges;
+    };
+    
+    const int n_threads = min(m_threads, m_height);
+    if( n_threads <= 1 )
+    {
+        return collect(0, m_height, nChangesVec.data());
+    }
+    
+    vector< vector<unsigned int> > counts(n_threads, vector<unsigned int>(max(numk, m_nx*m_ny), 0));
+    vector<int> nChanges(n_threads, 0);
+    vector<std::thread> threads;
+    for( int t = 0; t < n_threads; t++ )
+    {
+        const int r1 = (t*m_height)/n_threads;
+        const int r2 = ((t + 1)*m_height)/n_threads;
+        threads.push_back(std::thread([&, t, r1, r2]()
+        {
+            nChanges[t] = collect(r1, r2, counts[t].data());
+        }));
+    }
+    
+    int total = 0;
+    for( int t = 0; t < n_threads; t++ )
+    {
+        threads[t].join();
+        for( int k = 0; k < (int) counts[t].size(); k++ )
+        {
+            nChangesVec[k] += counts[t][k];
+        }
+        total += nChanges[t];
+    }
+    
+    return total;
+}
+
+//===========================================================================
+///	AccumulateSuperpixelSLIC_preemptive
+///
+/// With more than one thread, the pixels are first sorted by label (keeping
+/// the raster order within each superpixel) and the superpixels are then
+/// distributed over the threads, so the centroids are the same for any number
+/// of threads.
+//===========================================================================
+void PreemptiveSLIC::AccumulateSuperpixelSLIC_preemptive(
+    const int*                  klabels,
+    vector<double>&             sigmal,
+    vector<double>&             sigmaa,
+    vector<double>&             sigmab,
+    vector<double>&             sigmax,
+    vector<double>&             sigmay,
+    vector<double>&             clustersize)
+{
+    const int sz = m_width*m_height;
+    const int numk = clustersize.size();
+    
+    if( m_threads <= 1 )
+    {
+        int ind(0);
         for( int r = 0; r < m_height; r++ )
         {
           for( int c = 0; c < m_width; c++ )
@@ -592,34 +765,62 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
               //------------------------------------
               //edgesum[klabels[ind]] += edgemag[ind];
               //------------------------------------
-              clustersize[klabels[ind]] += 1.0;                 
-
-           
-            ind++;
-          }            
+              clustersize[klabels[ind]] += 1.0;
+              ind++;
+          }
         }
-        
-        // iterate over cluster and compute inverse of size
-        {for( int k = 0; k < numk; k++ )
-        {
-            if( clustersize[k] <= 0 ) clustersize[k] = 1;
-            inv[k] = 1.0/clustersize[k];//computing inverse now to multiply, than divide later
-        }}      
-
-        // iterate over cluster and update
-        {for( int k = 0; k < numk; k++ )
+        return;
+    }
+    
+    vector<int> first(numk + 1, 0);
+    for( int i = 0; i < sz; i++ )
+    {
+        first[klabels[i] + 1]++;
+    }
+    for( int k = 0; k < numk; k++ )
+    {
+        first[k + 1] += first[k];
+    }
+    
+    vector<int> pixels(sz);
+    vector<int> fill(first.begin(), first.end() - 1);
+    for( int i = 0; i < sz; i++ )
+    {
+        pixels[fill[klabels[i]]++] = i;
+    }
+    
+    std::atomic<int> next(0);
+    auto worker = [&]()
+    {
+        for( int k = next++; k < numk; k = next++ )
         {
-            kseedsl[k] = sigmal[k]*inv[k];
-            kseedsa[k] = sigmaa[k]*inv[k];
-            kseedsb[k] = sigmab[k]*inv[k];
-            kseedsx[k] = sigmax[k]*inv[k];
-            kseedsy[k] = sigmay[k]*inv[k];
-            //------------------------------------
-            //edgesum[k] *= inv[k];
-            //------------------------------------
-        }}      
-        
-    } // main loop
+            for( int p = first[k]; p < first[k + 1]; p++ )
+            {
+                const int i = pixels[p];
+                const int r = i/m_width;
+                const int c = i - r*m_width;
+                
+                sigmal[k] += m_lvec[i];
+                sigmaa[k] += m_avec[i];
+                sigmab[k] += m_bvec[i];
+                sigmax[k] += c;
+                sigmay[k] += r;
+                clustersize[k] += 1.0;
+            }
+        }
+    };
+    
+    const int n_threads = min(m_threads, numk);
+    vector<std::thread> threads;
+    for( int i = 1; i < n_threads; i++ )
+    {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for( int i = 0; i < (int) threads.size(); i++ )
+    {
+        threads[i].join();
+    }
 }
 
 //===========================================================================
@@ -628,6 +829,9 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
 ///		1. finding an adjacent label for each new component at the start
 ///		2. if a certain component is too small, assigning the previously found
 ///		    adjacent label to this component, and not incrementing the label.
+///
+/// Uses the scanline flood fill of LabelConnectivity with the buffers in
+/// m_connectivity, which are kept across calls.
 //===========================================================================
 void PreemptiveSLIC::EnforceLabelConnectivity(
 	const int*					labels,//input labels that need to be corrected to remove stray labels
@@ -637,92 +841,7 @@ void PreemptiveSLIC::EnforceLabelConnectivity(
 	int&						numlabels,//the number of labels changes in the end if segments are removed
 	const int&					K) //the number of superpixels desired by the user
 {
-//	const int dx8[8] = {-1, -1,  0,  1, 1, 1, 0, -1};
-//	const int dy8[8] = { 0, -1, -1, -1, 0, 1, 1,  1};
-
-	const int dx4[4] = {-1,  0,  1,  0};
-	const int dy4[4] = { 0, -1,  0,  1};
-
-	const int sz = width*height;
-	const int SUPSZ = sz/K;
-	//nlabels.resize(sz, -1);
-	for( int i = 0; i < sz; i++ ) nlabels[i] = -1;
-	int label(0);
-	int* xvec = new int[sz];
-	int* yvec = new int[sz];
-	int oindex(0);
-	int adjlabel(0);//adjacent label
-	for( int j = 0; j < height; j++ )
-	{
-		for( int k = 0; k < width; k++ )
-		{
-			if( 0 > nlabels[oindex] )
-			{
-				nlabels[oindex] = label;
-				//--------------------
-				// Start a new segment
-				//--------------------
-				xvec[0] = k;
-				yvec[0] = j;
-				//-------------------------------------------------------
-				// Quickly find an adjacent label for use later if needed
-				//-------------------------------------------------------
-				{for( int n = 0; n < 4; n++ )
-				{
-					int x = xvec[0] + dx4[n];
-					int y = yvec[0] + dy4[n];
-					if( (x >= 0 && x < width) && (y >= 0 && y < height) )
-					{
-						int nindex = y*width + x;
-						if(nlabels[nindex] >= 0) adjlabel = nlabels[nindex];
-					}
-				}}
-
-				int count(1);
-				for( int c = 0; c < count; c++ )
-				{
-					for( int n = 0; n < 4; n++ )
-					{
-						int x = xvec[c] + dx4[n];
-						int y = yvec[c] + dy4[n];
-
-						if( (x >= 0 && x < width) && (y >= 0 && y < height) )
-						{
-							int nindex = y*width + x;
-
-							if( 0 > nlabels[nindex] && labels[oindex] == labels[nindex] )
-							{
-								xvec[count] = x;
-								yvec[count] = y;
-								nlabels[nindex] = label;
-								count++;
-							}
-						}
-
-					}
-				}
-				//-------------------------------------------------------
-				// If segment size is less then a limit, assign an
-				// adjacent label found before, and decrement label count.
-				//-------------------------------------------------------
-				if(count <= SUPSZ >> 2)
-				{
-					for( int c = 0; c < count; c++ )
-					{
-						int ind = yvec[c]*width+xvec[c];
-						nlabels[ind] = adjlabel;
-					}
-					label--;
-				}
-				label++;
-			}
-			oindex++;
-		}
-	}
-	numlabels = label;
-
-	if(xvec) delete [] xvec;
-	if(yvec) delete [] yvec;
+	LabelConnectivity::enforce(labels, width, height, K, nlabels, numlabels, m_connectivity);
 }
 
 /*
@@ -1011,14 +1130,7 @@ void PreemptiveSLIC::preemptiveSLIC(const Mat& I_rgb, const int k, const double
   PerformSuperpixelSLIC_preemptive(m_kseedsl, m_kseedsa, m_kseedsb, m_kseedsx, m_kseedsy, klabels, compactness, 10);
   
   int numlabels = m_kseedsl.size();
-  int* nlabels = new int[sz];
-  EnforceLabelConnectivity(klabels, m_width, m_height, nlabels, numlabels, double(sz)/double(m_sx*m_sy));
-
-  int* swapV = klabels;
-  klabels = nlabels;
-  nlabels = swapV;  
-  
-  if(nlabels) delete [] nlabels;
+  EnforceLabelConnectivity(klabels, m_width, m_height, klabels, numlabels, double(sz)/double(m_sx*m_sy));
   
 }
 
@@ -1080,13 +1192,6 @@ void PreemptiveSLIC::preemptiveSLIC(const Mat& I_rgb, const int region_size, con
   PerformSuperpixelSLIC_preemptive(m_kseedsl, m_kseedsa, m_kseedsb, m_kseedsx, m_kseedsy, klabels, compactness, iterations);
   
   int numlabels = m_kseedsl.size();
-  int* nlabels = new int[sz];
-  EnforceLabelConnectivity(klabels, m_width, m_height, nlabels, numlabels, double(sz)/double(m_sx*m_sy));
-
-  int* swapV = klabels;
-  klabels = nlabels;
-  nlabels = swapV;  
-  
-  if(nlabels) delete [] nlabels;
+  EnforceLabelConnectivity(klabels, m_width, m_height, klabels, numlabels, double(sz)/double(m_sx*m_sy));
   
 }
\ No newline at end of file
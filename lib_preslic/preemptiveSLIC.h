@@ -44,6 +44,7 @@
 #include <string>
 #include <algorithm>
 #include "opencv2/opencv.hpp"
+#include "label_connectivity.h"
 
 using namespace std;
 
@@ -64,6 +65,9 @@ public:
 	PreemptiveSLIC();
 	virtual ~PreemptiveSLIC();
     
+    // number of threads used in the iterations of preemptive SLIC, defaults to 1
+    void SetThreads(const int threads);
+    
     // currently seed should be an empty cv::Mat --> otherwise the number of changes in the clusters is potentially not computed correctly
     void preemptiveSLIC(const cv::Mat& I_rgb, const int k, const double compactness, int*& klabels, cv::Mat& seeds);
     void preemptiveSLIC(const cv::Mat& I_rgb, const int region_size, const double compactness, bool perturbseeds, int iterations, bool rgb, int*& klabels, cv::Mat& seeds);
@@ -107,6 +111,32 @@ private:
         int*&                       klabels,
         const double&               m = 10.0,
         const int&                  maxIter = 10);
+    
+    void AssignSuperpixelSLIC_preemptive(
+        const vector<double>&       kseedsl,
+        const vector<double>&       kseedsa,
+        const vector<double>&       kseedsb,
+        const vector<double>&       kseedsx,
+        const vector<double>&       kseedsy,
+        const vector<int>&          active,
+        vector<int>&                klabels_new,
+        vector<double>&             distvec,
+        const double&               invwt);
+    
+    int CollectChanges_preemptive(
+        int*                        klabels,
+        const vector<int>&          klabels_new,
+        vector<unsigned int>&       nChangesVec,
+        const int                   numk);
+    
+    void AccumulateSuperpixelSLIC_preemptive(
+        const int*                  klabels,
+        vector<double>&             sigmal,
+        vector<double>&             sigmaa,
+        vector<double>&             sigmab,
+        vector<double>&             sigmax,
+        vector<double>&             sigmay,
+        vector<double>&             clustersize);
 	//============================================================================
 	// Pick seeds for superpixels when step size of superpixels is given.
 	//============================================================================
@@ -143,7 +173,8 @@ private:
 		vector<double>&				edges);
 
 	//============================================================================
-	// Post-processing of SLIC segmentation, to avoid stray labels.
+	// Post-processing of SLIC segmentation, to avoid stray labels; labels and
+	// nlabels may be the same buffer, the buffers are reused across calls
 	//============================================================================
 	void EnforceLabelConnectivity(
 		const int*					labels,
@@ -174,6 +205,10 @@ private:
     
     int m_w_seed;
     int m_h_seed;
+    
+    LabelConnectivity::Workspace m_connectivity;
+    
+    int m_threads;
 };
 
 #endif // !defined(_SLIC_H_INCLUDED_)
@@ -0,0 +1,347 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include "evaluation.h"
+#include "superpixel_algorithms.h"
+#include "superpixel_tools.h"
+
+namespace py = pybind11;
+
+/** \brief Python module superpixel_benchmark.
+ * 
+ * Exposes all algorithms registered by SuperpixelAlgorithms::registerAll and
+ * the metrics of Evaluation on NumPy arrays. C-contiguous arrays of the 
+ * expected type (uint8 HxWx3 images in BGR order as read by cv2.imread, int32
+ * HxW labels and ground truths) are wrapped as cv::Mat without copying; label
+ * arrays returned by segment share memory with the cv::Mat computed by the
+ * algorithm. The GIL is released while segmenting or evaluating.
+ * 
+ * Usage:
+ * 
+ *     import cv2
+ *     import superpixel_benchmark as sb
+ * 
+ *     algorithm = sb.Algorithm('slic', superpixels=1200, compactness=20)
+ *     labels = algorithm.segment(cv2.imread('data/BSDS500/images/test/3096.jpg'))
+ *     print(sb.undersegmentation_error(labels, gt))
+ * 
+ * \author David Stutz
+ */
+
+namespace {
+
+typedef py::array_t<unsigned char, py::array::c_style> ImageArray;
+typedef py::array_t<int, py::array::c_style> LabelArray;
+
+/** \brief Wrap a HxWx3 uint8 array without copying.
+ * \param[in] array image array
+ * \return CV_8UC3 image pointing to the array's data
+ */
+cv::Mat wrapImage(const ImageArray &array) {
+    if (array.ndim() != 3 || array.shape(2) != 3) {
+        throw std::invalid_argument("Expected image of shape (H, W, 3).");
+    }
+    
+    return cv::Mat(array.shape(0), array.shape(1), CV_8UC3, 
+            const_cast<unsigned char*>(array.data()));
+}
+
+/** \brief Wrap a HxW int32 array without copying.
+ * \param[in] array label array
+ * \return CV_32SC1 labels pointing to the array's data
+ */
+cv::Mat wrapLabels(const LabelArray &array) {
+    if (array.ndim() != 2) {
+        throw std::invalid_argument("Expected labels of shape (H, W).");
+    }
+    
+    return cv::Mat(array.shape(0), array.shape(1), CV_32SC1, 
+            const_cast<int*>(array.data()));
+}
+
+/** \brief Hand the labels over to a NumPy array; the array keeps the 
+ * (reference counted) cv::Mat alive instead of copying it.
+ * \param[in] labels CV_32SC1 labels
+ * \return int32 array of shape (H, W)
+ */
+LabelArray shareLabels(const cv::Mat &labels) {
+    cv::Mat* owner = new cv::Mat(labels.isContinuous() ? labels : labels.clone());
+    py::capsule capsule(owner, [](void* pointer) {
+        delete static_cast<cv::Mat*>(pointer);
+    });
+    
+    return LabelArray({owner->rows, owner->cols}, owner->ptr<int>(0), capsule);
+}
+
+/** \brief Python-facing algorithm, the keyword arguments are the parameters
+ * as accepted by SuperpixelAlgorithmRegistry::create. */
+class Algorithm {
+public:
+    
+    Algorithm(const std::string &name, py::kwargs kwargs) : name(name) {
+        SuperpixelAlgorithms::registerAll();
+        
+        SuperpixelAlgorithm::Parameters parameters;
+        for (auto item : kwargs) {
+            // Parameters follow the long options, e.g. warm_start for warm-start.
+            std::string key = py::str(item.first);
+            std::replace(key.begin(), key.end(), '_', '-');
+            
+            if (py::isinstance<py::bool_>(item.second)) {
+                parameters[key] = item.second.cast<bool>() ? "1" : "0";
+            }
+            else {
+                parameters[key] = py::str(item.second);
+            }
+        }
+        
+        algorithm.reset(SuperpixelAlgorithmRegistry::create(name, parameters));
+        if (!algorithm) {
+            throw std::invalid_argument("Algorithm " + name + " is not registered.");
+        }
+    }
+    
+    LabelArray segment(const ImageArray &image) {
+        cv::Mat mat = wrapImage(image);
+        cv::Mat labels;
+        
+        {
+            // The instance is not shared between threads, see SuperpixelAlgorithm.
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(mutex);
+            algorithm->segment(mat, labels);
+        }
+        
+        return shareLabels(labels);
+    }
+    
+    std::string name;
+    
+private:
+    
+    std::unique_ptr<SuperpixelAlgorithm> algorithm;
+    std::mutex mutex;
+    
+};
+
+/** \brief Move a vector into a NumPy array of the given shape without copying.
+ * \param[in,out] values values, empty afterwards
+ * \param[in] shape shape of the array
+ * \return array owning the values
+ */
+template<typename T>
+py::array_t<T> shareVector(std::vector<T> &values, const std::vector<py::ssize_t> &shape) {
+    std::vector<T>* owner = new std::vector<T>();
+    owner->swap(values);
+    py::capsule capsule(owner, [](void* pointer) {
+        delete static_cast<std::vector<T>*>(pointer);
+    });
+    
+    return py::array_t<T>(shape, owner->data(), capsule);
+}
+
+/** \brief Bind a metric on labels and ground truth with the GIL released. */
+template<typename Metric>
+std::function<float(const LabelArray&, const LabelArray&)> bindGroundTruthMetric(Metric metric) {
+    return [metric](const LabelArray &labels, const LabelArray &gt) {
+        cv::Mat labels_mat = wrapLabels(labels);
+        cv::Mat gt_mat = wrapLabels(gt);
+        if (labels_mat.rows != gt_mat.rows || labels_mat.cols != gt_mat.cols) {
+            throw std::invalid_argument("Labels and ground truth differ in shape.");
+        }
+        
+        py::gil_scoped_release release;
+        return metric(labels_mat, gt_mat);
+    };
+}
+
+/** \brief Bind a metric on labels and image with the GIL released. */
+template<typename Metric>
+std::function<float(const LabelArray&, const ImageArray&)> bindImageMetric(Metric metric) {
+    return [metric](const LabelArray &labels, const ImageArray &image) {
+        cv::Mat labels_mat = wrapLabels(labels);
+        cv::Mat image_mat = wrapImage(image);
+        if (labels_mat.rows != image_mat.rows || labels_mat.cols != image_mat.cols) {
+            throw std::invalid_argument("Labels and image differ in shape.");
+        }
+        
+        py::gil_scoped_release release;
+        return metric(labels_mat, image_mat);
+    };
+}
+
+}
+
+PYBIND11_MODULE(superpixel_benchmark, m) {
+    m.doc() = "Superpixel algorithms and evaluation metrics of the superpixel benchmark.";
+    
+    m.def("algorithms", []() {
+        SuperpixelAlgorithms::registerAll();
+        return SuperpixelAlgorithmRegistry::list();
+    }, "Names of the algorithms built with the benchmark.");
+    
+    py::class_<Algorithm>(m, "Algorithm")
+        .def(py::init<const std::string&, py::kwargs>(), py::arg("name"))
+        .def("segment", &Algorithm::segment, py::arg("image"),
+            "Segment a uint8 BGR image of shape (H, W, 3) into int32 labels of shape (H, W).")
+        .def_readonly("name", &Algorithm::name);
+    
+    m.def("compute_features", [](const LabelArray &labels, const ImageArray &image, 
+            int bins, int threads) {
+        cv::Mat labels_mat = wrapLabels(labels);
+        cv::Mat image_mat = wrapImage(image);
+        if (labels_mat.rows != image_mat.rows || labels_mat.cols != image_mat.cols) {
+            throw std::invalid_argument("Labels and image differ in shape.");
+        }
+        if (bins < 1 || bins > 256) {
+            throw std::invalid_argument("Number of bins needs to be within [1, 256].");
+        }
+        
+        SuperpixelTools::Features features;
+        {
+            py::gil_scoped_release release;
+            SuperpixelTools::computeFeatures(image_mat, labels_mat, bins, features, threads);
+        }
+        
+        py::ssize_t S = features.superpixels;
+        std::vector<int> bounding_boxes(4*S);
+        for (int k = 0; k < S; ++k) {
+            bounding_boxes[4*k + 0] = features.bounding_boxes[k].x;
+            bounding_boxes[4*k + 1] = features.bounding_boxes[k].y;
+            bounding_boxes[4*k + 2] = features.bounding_boxes[k].width;
+            bounding_boxes[4*k + 3] = features.bounding_boxes[k].height;
+        }
+        
+        py::dict result;
+        result["areas"] = shareVector(features.areas, {S});
+        result["mean_colors"] = shareVector(features.mean_colors, {S, 3});
+        result["centroids"] = shareVector(features.centroids, {S, 2});
+        result["bounding_boxes"] = shareVector(bounding_boxes, {S, 4});
+        result["histograms"] = shareVector(features.histograms, {S, 3, (py::ssize_t) bins});
+        result["offsets"] = shareVector(features.offsets, {S + 1});
+        result["neighbors"] = shareVector(features.neighbors, {(py::ssize_t) features.neighbors.size()});
+        return result;
+    }, py::arg("labels"), py::arg("image"), py::arg("bins") = 16, py::arg("threads") = 1,
+        "Per-superpixel areas, mean colors, centroids (row, column), bounding boxes "
+        "(x, y, width, height), histograms and neighbors (offsets into neighbors), "
+        "see SuperpixelTools::computeFeatures.");
+    
+    m.def("pool_features", [](const py::array_t<float, py::array::c_style> &features, 
+            const LabelArray &labels, bool max_pooling, int threads) {
+        if (features.ndim() != 3 || features.shape(2) > CV_CN_MAX) {
+            throw std::invalid_argument("Expected features of shape (H, W, C) with C <= 512.");
+        }
+        
+        // The channels are interleaved as expected by OpenCV for CV_32FC(C).
+        cv::Mat features_mat(features.shape(0), features.shape(1)*features.shape(2), CV_32FC1, 
+                const_cast<float*>(features.data()));
+        features_mat = features_mat.reshape(features.shape(2), features.shape(0));
+        cv::Mat labels_mat = wrapLabels(labels);
+        
+        cv::Mat pooled;
+        {
+            py::gil_scoped_release release;
+            SuperpixelTools::poolFeatures(features_mat, labels_mat, max_pooling, pooled, threads);
+        }
+        
+        cv::Mat* owner = new cv::Mat(pooled);
+        py::capsule capsule(owner, [](void* pointer) {
+            delete static_cast<cv::Mat*>(pointer);
+        });
+        return py::array_t<float>({owner->rows, owner->cols}, owner->ptr<float>(0), capsule);
+    }, py::arg("features"), py::arg("labels"), py::arg("max_pooling") = false, py::arg("threads") = 1,
+        "Average or max pool float features of shape (H', W', C) over superpixels, "
+        "see SuperpixelTools::poolFeatures.");
+    
+    m.def("undersegmentation_error", bindGroundTruthMetric([](const cv::Mat &labels, const cv::Mat &gt) {
+        return Evaluation::computeUndersegmentationError(labels, gt);
+    }), py::arg("labels"), py::arg("gt"));
+    m.def("oversegmentation_error", bindGroundTruthMetric([](const cv::Mat &labels, const cv::Mat &gt) {
+        return Evaluation::computeOversegmentationError(labels, gt);
+    }), py::arg("labels"), py::arg("gt"));
+    m.def("np_undersegmentation_error", bindGroundTruthMetric([](const cv::Mat &labels, const cv::Mat &gt) {
+        return Evaluation::computeNPUndersegmentationError(labels, gt);
+    }), py::arg("labels"), py::arg("gt"));
+    m.def("levin_undersegmentation_error", bindGroundTruthMetric([](const cv::Mat &labels, const cv::Mat &gt) {
+        return Evaluation::computeLevinUndersegmentationError(labels, gt);
+    }), py::arg("labels"), py::arg("gt"));
+    m.def("achievable_segmentation_accuracy", bindGroundTruthMetric([](const cv::Mat &labels, const cv::Mat &gt) {
+        return Evaluation::computeAchievableSegmentationAccuracy(labels, gt);
+    }), py::arg("labels"), py::arg("gt"));
+    m.def("mean_distance_to_edge", bindGroundTruthMetric([](const cv::Mat &labels, const cv::Mat &gt) {
+        return Evaluation::computeMeanDistanceToEdge(labels, gt);
+    }), py::arg("labels"), py::arg("gt"));
+    
+    m.def("boundary_recall", [](const LabelArray &labels, const LabelArray &gt, float d) {
+        return bindGroundTruthMetric([d](const cv::Mat &labels, const cv::Mat &gt) {
+            return Evaluation::computeBoundaryRecall(labels, gt, d);
+        })(labels, gt);
+    }, py::arg("labels"), py::arg("gt"), py::arg("d") = 0.0025f);
+    m.def("boundary_precision", [](const LabelArray &labels, const LabelArray &gt, float d) {
+        return bindGroundTruthMetric([d](const cv::Mat &labels, const cv::Mat &gt) {
+            return Evaluation::computeBoundaryPrecision(labels, gt, d);
+        })(labels, gt);
+    }, py::arg("labels"), py::arg("gt"), py::arg("d") = 0.0025f);
+    
+    m.def("explained_variation", bindImageMetric([](const cv::Mat &labels, const cv::Mat &image) {
+        return Evaluation::computeExplainedVariation(labels, image);
+    }), py::arg("labels"), py::arg("image"));
+    m.def("intra_cluster_variation", bindImageMetric([](const cv::Mat &labels, const cv::Mat &image) {
+        return Evaluation::computeIntraClusterVariation(labels, image);
+    }), py::arg("labels"), py::arg("image"));
+    m.def("sum_of_squared_error_rgb", bindImageMetric([](const cv::Mat &labels, const cv::Mat &image) {
+        return Evaluation::computeSumOfSquaredErrorRGB(labels, image);
+    }), py::arg("labels"), py::arg("image"));
+    
+    m.def("compactness", [](const LabelArray &labels) {
+        cv::Mat labels_mat = wrapLabels(labels);
+        py::gil_scoped_release release;
+        return Evaluation::computeCompactness(labels_mat);
+    }, py::arg("labels"));
+    m.def("contour_density", [](const LabelArray &labels) {
+        cv::Mat labels_mat = wrapLabels(labels);
+        py::gil_scoped_release release;
+        return Evaluation::computeContourDensity(labels_mat);
+    }, py::arg("labels"));
+    m.def("superpixels", [](const LabelArray &labels) {
+        cv::Mat labels_mat = wrapLabels(labels);
+        py::gil_scoped_release release;
+        return Evaluation::computeSuperpixels(labels_mat);
+    }, py::arg("labels"));
+}
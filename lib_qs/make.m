@@ -31,8 +31,12 @@
 % Note that some //-style comments were removed
 % VL_DISABLE_AVX needs to be set if the compiler does not support AVX
 % VL_DISABLE_SSE2 needs to be set if the compiler does not support SSE2
+% Only mathop_avx.c is compiled with -mavx, the AVX functions are
+% selected at runtime (vl_cpu_has_avx) such that the MEX file still runs
+% on CPUs without AVX.
 %
 % David Stutz <david.stutz@rwth-aachen.de>
         
 mex vl_binsum.c
-mex array.c generic.c host.c mathop.c mathop_sse2.c quickshift.c random.c stringop.c vl_quickshift.c -DVL_DISABLE_AVX -output vl_quickshift
\ No newline at end of file
+mex -c mathop_avx.c CFLAGS='$CFLAGS -mavx'
+mex array.c generic.c host.c mathop.c mathop_sse2.c quickshift.c random.c stringop.c vl_quickshift.c mathop_avx.o -output vl_quickshift
\ No newline at end of file
@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <random>
+#include <vector>
+#include "quickshift.h"
+#include "quickshift_fast.h"
+#include "qs_opencv.h"
+
+/** \brief vl_rgb2xyz (CIE) followed by vl_xyz2lab (illuminant E).
+ */
+void rgb2lab(double R, double G, double B, double &L, double &a, double &b) {
+    
+    R = std::pow(R, 2.2);
+    G = std::pow(G, 2.2);
+    B = std::pow(B, 2.2);
+    
+    // White point of illuminant E, Xw = Yw = Zw = 1.
+    double xyz[3] = {
+        0.488718*R + 0.310680*G + 0.200602*B,
+        0.176204*R + 0.812985*G + 0.0108109*B,
+        0.0102048*G + 0.989795*B
+    };
+    
+    for (int k = 0; k < 3; k++) {
+        if (xyz[k] > 0.00856) {
+            xyz[k] = std::pow(xyz[k], 1.0/3.0);
+        }
+        else {
+            xyz[k] = (903.3*xyz[k] + 16)/116;
+        }
+    }
+    
+    L = 116*xyz[1] - 16;
+    a = 500*(xyz[0] - xyz[1]);
+    b = 200*(xyz[1] - xyz[2]);
+}
+
+/** \brief Follow the parents to the roots (vl_flatmap.m) and number the
+ * roots in the order of their linear index.
+ */
+void flatmap(const int* parents, int height, int width, cv::Mat &labels) {
+    
+    int N = height*width;
+    std::vector<int> root(N, -1);
+    std::vector<int> path;
+    
+    for (int i = 0; i < N; i++) {
+        int j = i;
+        while (root[j] < 0 && parents[j] != j) {
+            path.push_back(j);
+            j = parents[j];
+        }
+        
+        int r = (root[j] < 0) ? j : root[j];
+        root[j] = r;
+        for (unsigned int p = 0; p < path.size(); p++) {
+            root[path[p]] = r;
+        }
+        path.clear();
+    }
+    
+    std::vector<int> label(N, -1);
+    int count = 0;
+    for (int i = 0; i < N; i++) {
+        if (root[i] == i) {
+            label[i] = count++;
+        }
+    }
+    
+    labels.create(height, width, CV_32SC1);
+    for (int i2 = 0; i2 < width; i2++) {
+        for (int i1 = 0; i1 < height; i1++) {
+            labels.at<int>(i1, i2) = label[root[i1 + height*i2]];
+        }
+    }
+}
+
+void QS_OpenCV::computeSuperpixels(const cv::Mat &image, double ratio, 
+        double kernel_size, double max_distance, bool rgb, bool fast, 
+        cv::Mat &labels) {
+    
+    int height = image.rows;
+    int width = image.cols;
+    int N = height*width;
+    
+    // Feature image as in vl_quickseg.m with the layout of vl_quickshift_new 
+    // (column major, one plane per channel); less than one gray level of 
+    // noise breaks ties in constant regions.
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<double> noise(0, 1/2550.);
+    
+    std::vector<double> features(3*N);
+    for (int i1 = 0; i1 < height; i1++) {
+        for (int i2 = 0; i2 < width; i2++) {
+            const cv::Vec3b &bgr = image.at<cv::Vec3b>(i1, i2);
+            double R = bgr[2]/255. + noise(generator);
+            double G = bgr[1]/255. + noise(generator);
+            double B = bgr[0]/255. + noise(generator);
+            
+            if (!rgb) {
+                rgb2lab(R, G, B, R, G, B);
+            }
+            
+            features[i1 + height*i2] = ratio*R;
+            features[i1 + height*i2 + N] = ratio*G;
+            features[i1 + height*i2 + 2*N] = ratio*B;
+        }
+    }
+    
+    if (fast) {
+        std::vector<float> features_float(features.begin(), features.end());
+        std::vector<int> parents(N);
+        std::vector<float> dists(N);
+        std::vector<float> density(N);
+        
+        vl_quickshift_fast_process(&features_float[0], height, width, 3, 
+                kernel_size, max_distance, &parents[0], &dists[0], &density[0]);
+        
+        flatmap(&parents[0], height, width, labels);
+    }
+    else {
+        VlQS* qs = vl_quickshift_new(&features[0], height, width, 3);
+        vl_quickshift_set_kernel_size(qs, kernel_size);
+        vl_quickshift_set_max_dist(qs, max_distance);
+        vl_quickshift_process(qs);
+        
+        flatmap(vl_quickshift_get_parents(qs), height, width, labels);
+        vl_quickshift_delete(qs);
+    }
+}
@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef QS_OPENCV_H
+#define	QS_OPENCV_H
+
+#include <opencv2/opencv.hpp>
+
+/** \brief Wrapper for running QS on OpenCV images, following vl_quickseg.m.
+ * \author David Stutz
+ */
+class QS_OpenCV {
+public:
+    /** \brief Compute superpixels using QS.
+     * \param[in] image image to compute superpixels on
+     * \param[in] ratio tradeoff between color and spatial consistency
+     * \param[in] kernel_size standard deviation of the Parzen window density estimator
+     * \param[in] max_distance maximum distance between nodes in the quick shift tree
+     * \param[in] rgb whether to use RGB instead of Lab
+     * \param[in] fast whether to use the float, vectorized and parallel quick shift
+     * \param[out] labels superpixel labels
+     */
+    static void computeSuperpixels(const cv::Mat &image, double ratio, 
+            double kernel_size, double max_distance, bool rgb, bool fast, 
+            cv::Mat &labels);
+};
+
+#endif	/* QS_OPENCV_H */
@@ -0,0 +1,227 @@
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#ifndef VL_QUICKSHIFT_FAST_H
+#define VL_QUICKSHIFT_FAST_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/** @brief exp(x) for -87 < x <= 0 in float, as a polynomial in 2^f so
+ ** that the window loops can be vectorized (relative error below 1e-6).
+ **/
+static inline float
+vl_quickshift_fast_exp (float x)
+{
+  const float t = x * 1.44269504f ;
+  /* t <= 0, truncation rounds t - 0.5 to the nearest integer of t */
+  const int n = (int) (t - 0.5f) ;
+  const float f = t - (float) n ;
+  const float f2 = 0.693147181f * f ;
+  float p = 1.0f + f2 * (1.0f + f2 * (0.5f + f2 * (0.166666667f
+    + f2 * (0.0416666667f + f2 * (0.00833333333f + f2 * 0.00138888889f))))) ;
+  const int bits = (n + 127) << 23 ;
+  float scale ;
+  std::memcpy (&scale, &bits, sizeof (float)) ;
+  return p * scale ;
+}
+
+/** @brief Parzen density for one pixel over a window of columns j2 and
+ ** rows j1, with the spatial term taken from the table @a w. The kernel
+ ** values of a window column are written to @a buffer in one vectorized
+ ** pass and summed afterwards.
+ **/
+template <int K>
+static inline float
+vl_quickshift_fast_density (float const * I, int N1, int N2, int channels,
+                            int i1, int i2, int R, float const * w, float inv,
+                            float Dmax, float * buffer)
+{
+  const int KK = (K > 0) ? K : channels ;
+  float center [16] ;
+  const int j1min = (i1 - R > 0) ? i1 - R : 0 ;
+  const int j1max = (i1 + R < N1 - 1) ? i1 + R : N1 - 1 ;
+  const int j2min = (i2 - R > 0) ? i2 - R : 0 ;
+  const int j2max = (i2 + R < N2 - 1) ? i2 + R : N2 - 1 ;
+  float E = 0 ;
+  int j1, j2, k ;
+
+  for (k = 0 ; k < KK ; ++k) {
+    center [k] = I [i1 + N1 * i2 + (N1*N2) * k] ;
+  }
+
+  for (j2 = j2min ; j2 <= j2max ; ++j2) {
+    const float w2 = w [j2 - i2 + R] ;
+    float const * column = I + N1 * j2 ;
+    float Ecol = 0 ;
+#pragma omp simd
+    for (j1 = j1min ; j1 <= j1max ; ++j1) {
+      float D = 0 ;
+      for (int k = 0 ; k < KK ; ++k) {
+        const float diff = column [j1 + (N1*N2) * k] - center [k] ;
+        D += diff * diff ;
+      }
+      D = std::min (D, Dmax) ;
+      buffer [j1 - j1min] = w [j1 - i1 + R] * vl_quickshift_fast_exp (- D * inv) ;
+    }
+    for (j1 = 0 ; j1 <= j1max - j1min ; ++j1) {
+      Ecol += buffer [j1] ;
+    }
+    E += w2 * Ecol ;
+  }
+
+  return E ;
+}
+
+/** @brief Nearest pixel of higher density within distance tau; the
+ ** masked distances of a window column are computed in one vectorized
+ ** pass and scanned afterwards in the order of vl_quickshift_process.
+ **/
+template <int K>
+static inline void
+vl_quickshift_fast_parent (float const * I, float const * E, int N1, int N2,
+                           int channels, int i1, int i2, int tR, float tau2,
+                           float * buffer, int * parent, float * dist)
+{
+  const int KK = (K > 0) ? K : channels ;
+  const float inf = std::numeric_limits<float>::infinity () ;
+  float center [16] ;
+  const int j1min = (i1 - tR > 0) ? i1 - tR : 0 ;
+  const int j1max = (i1 + tR < N1 - 1) ? i1 + tR : N1 - 1 ;
+  const int j2min = (i2 - tR > 0) ? i2 - tR : 0 ;
+  const int j2max = (i2 + tR < N2 - 1) ? i2 + tR : N2 - 1 ;
+  const float E0 = E [i1 + N1 * i2] ;
+  float d_best = inf ;
+  int j_best = i1 + N1 * i2 ;
+  int j1, j2, k ;
+
+  for (k = 0 ; k < KK ; ++k) {
+    center [k] = I [i1 + N1 * i2 + (N1*N2) * k] ;
+  }
+
+  for (j2 = j2min ; j2 <= j2max ; ++j2) {
+    float const * column = I + N1 * j2 ;
+    float const * Ecolumn = E + N1 * j2 ;
+    const float d2 = (float) ((j2 - i2) * (j2 - i2)) ;
+#pragma omp simd
+    for (j1 = j1min ; j1 <= j1max ; ++j1) {
+      float D = d2 + (float) ((j1 - i1) * (j1 - i1)) ;
+      for (int k = 0 ; k < KK ; ++k) {
+        const float diff = column [j1 + (N1*N2) * k] - center [k] ;
+        D += diff * diff ;
+      }
+      const bool candidate = (Ecolumn [j1] > E0) & (D <= tau2) ;
+      buffer [j1 - j1min] = candidate ? D : inf ;
+    }
+    for (j1 = j1min ; j1 <= j1max ; ++j1) {
+      if (buffer [j1 - j1min] < d_best) {
+        d_best = buffer [j1 - j1min] ;
+        j_best = j1 + N1 * j2 ;
+      }
+    }
+  }
+
+  *parent = j_best ;
+  *dist = std::sqrt (d_best) ;
+}
+
+template <int K>
+static void
+vl_quickshift_fast_process_channels (float const * I, int N1, int N2,
+                                     int channels, float sigma, float tau,
+                                     int * parents, float * dists, float * E)
+{
+  const int R = (int) std::ceil (3 * sigma) ;
+  const int tR = (int) std::ceil (tau) ;
+  const float inv = 1.0f / (2 * sigma * sigma) ;
+  /* color distances beyond Dmax contribute exp(-60) at most */
+  const float Dmax = 60.0f / inv ;
+  std::vector<float> w (2 * R + 1) ;
+  int i2 ;
+
+  /* exp(-(d1^2 + d2^2 + D)/(2 sigma^2)) = w[d1] w[d2] exp(-D/(2 sigma^2)) */
+  for (int d = -R ; d <= R ; ++d) {
+    w [d + R] = std::exp (- (float) (d * d) * inv) ;
+  }
+
+#pragma omp parallel
+  {
+    std::vector<float> buffer (2 * R + 1) ;
+#pragma omp for schedule(dynamic, 4)
+    for (i2 = 0 ; i2 < N2 ; ++i2) {
+      for (int i1 = 0 ; i1 < N1 ; ++i1) {
+        E [i1 + N1 * i2] = vl_quickshift_fast_density<K> (I, N1, N2, channels,
+                                                          i1, i2, R, &w[0], inv,
+                                                          Dmax, &buffer[0]) ;
+      }
+    }
+  }
+
+#pragma omp parallel
+  {
+    std::vector<float> buffer (2 * tR + 1) ;
+#pragma omp for schedule(dynamic, 4)
+    for (i2 = 0 ; i2 < N2 ; ++i2) {
+      for (int i1 = 0 ; i1 < N1 ; ++i1) {
+        vl_quickshift_fast_parent<K> (I, E, N1, N2, channels, i1, i2, tR,
+                                      tau * tau, &buffer[0],
+                                      parents + i1 + N1 * i2,
+                                      dists + i1 + N1 * i2) ;
+      }
+    }
+  }
+}
+
+/** -----------------------------------------------------------------
+ ** @brief Quick shift in float (the fast mode)
+ ** @param I image with the layout of ::vl_quickshift_new, at most 16 channels.
+ ** @param height the height (number of rows) of the image.
+ ** @param width the width (number of columns) of the image.
+ ** @param channels the number of channels of the image.
+ ** @param sigma kernel size of the Parzen density.
+ ** @param tau maximum distance between a pixel and its parent.
+ ** @param parents (out) height x width parents.
+ ** @param dists (out) height x width distances to the parents.
+ ** @param density (out) height x width density.
+ **
+ ** Computes the quick shift (not medoid shift) tree of
+ ** ::vl_quickshift_process. The spatial factor of the Gaussian kernel is
+ ** separable and tabulated, the color factor uses a vectorizable
+ ** float exponential, and the columns of the image are processed in
+ ** parallel. Results differ from ::vl_quickshift_process only by
+ ** float rounding.
+ **/
+
+static void
+vl_quickshift_fast_process (float const * I, int height, int width, int channels,
+                            float sigma, float tau,
+                            int * parents, float * dists, float * density)
+{
+  switch (channels) {
+    case 1:
+      vl_quickshift_fast_process_channels<1> (I, height, width, channels, sigma, tau,
+                                              parents, dists, density) ;
+      break ;
+    case 3:
+      vl_quickshift_fast_process_channels<3> (I, height, width, channels, sigma, tau,
+                                              parents, dists, density) ;
+      break ;
+    default:
+      vl_quickshift_fast_process_channels<0> (I, height, width, channels, sigma, tau,
+                                              parents, dists, density) ;
+      break ;
+  }
+}
+
+#endif
@@ -0,0 +1,223 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <Eigen/Sparse>
+#include "rw_opencv.h"
+
+void RW_OpenCV::computeSuperpixels(const cv::Mat &image, int region_height, 
+        int region_width, double beta, cv::Mat &labels, int threads) {
+    
+    int height = image.rows;
+    int width = image.cols;
+    int N = height*width;
+    
+    // Pixels are indexed column major as in random_walker.m.
+    std::vector<cv::Vec3d> vals(N);
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            const cv::Vec3b &bgr = image.at<cv::Vec3b>(i, j);
+            vals[i + height*j] = cv::Vec3d(bgr[2]/255., bgr[1]/255., bgr[0]/255.);
+        }
+    }
+    
+    // Seeds as in random_walker_superpixels.m, which uses 1-based positions.
+    std::vector<int> seeds;
+    for (int i = std::max(1, region_height/2); i < height; i += region_height) {
+        for (int j = std::max(1, region_width/2); j < width; j += region_width) {
+            seeds.push_back((i - 1) + height*(j - 1));
+        }
+    }
+    
+    int K = seeds.size();
+    if (K == 0) {
+        labels = cv::Mat::zeros(height, width, CV_32SC1);
+        return;
+    }
+    
+    // makeweights.m: Euclidean color distances normalized to [0,1],
+    // weights exp(-beta*d) + 1e-5. Edge e = 2*p links p to p + 1 (down),
+    // e = 2*p + 1 links p to p + height (right).
+    std::vector<double> weights(2*N, 0);
+    std::vector<bool> valid(2*N, false);
+    
+    double min_distance = std::numeric_limits<double>::max();
+    double max_distance = 0;
+    for (int p = 0; p < N; p++) {
+        int i = p % height;
+        int j = p / height;
+        
+        if (i + 1 < height) {
+            weights[2*p] = cv::norm(vals[p] - vals[p + 1]);
+            valid[2*p] = true;
+        }
+        
+        if (j + 1 < width) {
+            weights[2*p + 1] = cv::norm(vals[p] - vals[p + height]);
+            valid[2*p + 1] = true;
+        }
+    }
+    
+    for (int e = 0; e < 2*N; e++) {
+        if (valid[e]) {
+            min_distance = std::min(min_distance, weights[e]);
+            max_distance = std::max(max_distance, weights[e]);
+        }
+    }
+    
+    for (int e = 0; e < 2*N; e++) {
+        if (valid[e]) {
+            double distance = min_distance;
+            if (max_distance > min_distance) {
+                distance = (weights[e] - min_distance)/(max_distance - min_distance);
+            }
+            
+            weights[e] = std::exp(-beta*distance) + 1e-5;
+        }
+    }
+    
+    // dirichletboundary.m: the Laplacian restricted to the unseeded pixels;
+    // the seeds only enter through the degrees and the right hand sides.
+    std::vector<int> index(N, 0);
+    for (int k = 0; k < K; k++) {
+        index[seeds[k]] = -1;
+    }
+    
+    int M = 0;
+    for (int p = 0; p < N; p++) {
+        if (index[p] >= 0) {
+            index[p] = M++;
+        }
+    }
+    
+    std::vector<double> degrees(N, 0);
+    std::vector< Eigen::Triplet<double> > triplets;
+    triplets.reserve(3*M);
+    
+    for (int p = 0; p < N; p++) {
+        for (int d = 0; d < 2; d++) {
+            if (!valid[2*p + d]) {
+                continue;
+            }
+            
+            int q = (d == 0) ? p + 1 : p + height;
+            double w = weights[2*p + d];
+            
+            degrees[p] += w;
+            degrees[q] += w;
+            
+            if (index[p] >= 0 && index[q] >= 0) {
+                // Lower triangle suffices for the LDLT.
+                triplets.push_back(Eigen::Triplet<double>(std::max(index[p], index[q]), 
+                        std::min(index[p], index[q]), -w));
+            }
+        }
+    }
+    
+    for (int p = 0; p < N; p++) {
+        if (index[p] >= 0) {
+            triplets.push_back(Eigen::Triplet<double>(index[p], index[p], degrees[p]));
+        }
+    }
+    
+    Eigen::SparseMatrix<double> L(M, M);
+    L.setFromTriplets(triplets.begin(), triplets.end());
+    
+    Eigen::SimplicialLDLT< Eigen::SparseMatrix<double>, Eigen::Lower > solver;
+    solver.compute(L);
+    
+    // The seeds are solved for one at a time instead of forming the M x K 
+    // probabilities; each thread keeps the maximum over a contiguous block 
+    // of seeds so that merging in block order keeps the first maximum.
+    threads = std::max(1, std::min(threads, K));
+    std::vector< std::vector<double> > best(threads, 
+            std::vector<double>(M, -std::numeric_limits<double>::infinity()));
+    std::vector< std::vector<int> > argbest(threads, std::vector<int>(M, 0));
+    
+    #pragma omp parallel for num_threads(threads)
+    for (int t = 0; t < threads; t++) {
+        Eigen::VectorXd b(M);
+        Eigen::VectorXd x(M);
+        
+        for (int k = (long) K*t/threads; k < (long) K*(t + 1)/threads; k++) {
+            int s = seeds[k];
+            int i = s % height;
+            int j = s / height;
+            
+            // b = -L(antiIndex, seed), i.e. the weights to the seed.
+            b.setZero();
+            if (i > 0 && index[s - 1] >= 0) {
+                b(index[s - 1]) += weights[2*(s - 1)];
+            }
+            if (i + 1 < height && index[s + 1] >= 0) {
+                b(index[s + 1]) += weights[2*s];
+            }
+            if (j > 0 && index[s - height] >= 0) {
+                b(index[s - height]) += weights[2*(s - height) + 1];
+            }
+            if (j + 1 < width && index[s + height] >= 0) {
+                b(index[s + height]) += weights[2*s + 1];
+            }
+            
+            x = solver.solve(b);
+            
+            for (int m = 0; m < M; m++) {
+                if (x(m) > best[t][m]) {
+                    best[t][m] = x(m);
+                    argbest[t][m] = k;
+                }
+            }
+        }
+    }
+    
+    for (int t = 1; t < threads; t++) {
+        for (int m = 0; m < M; m++) {
+            if (best[t][m] > best[0][m]) {
+                best[0][m] = best[t][m];
+                argbest[0][m] = argbest[t][m];
+            }
+        }
+    }
+    
+    labels.create(height, width, CV_32SC1);
+    for (int k = 0; k < K; k++) {
+        labels.at<int>(seeds[k] % height, seeds[k] / height) = k;
+    }
+    
+    for (int p = 0; p < N; p++) {
+        if (index[p] >= 0) {
+            labels.at<int>(p % height, p / height) = argbest[0][index[p]];
+        }
+    }
+}
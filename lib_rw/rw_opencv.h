@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RW_OPENCV_H
+#define	RW_OPENCV_H
+
+#include <opencv2/opencv.hpp>
+
+/** \brief Wrapper for running RW on OpenCV images, following 
+ * random_walker_superpixels.m.
+ * \author David Stutz
+ */
+class RW_OpenCV {
+public:
+    /** \brief Compute superpixels using RW.
+     * 
+     * Seeds are placed on a regular grid; each pixel is assigned to the seed
+     * the random walker reaches first with highest probability.
+     * 
+     * \param[in] image image to compute superpixels on
+     * \param[in] region_height vertical distance of seeds
+     * \param[in] region_width horizontal distance of seeds
+     * \param[in] beta scale of the color differences in the edge weights
+     * \param[out] labels superpixel labels
+     * \param[in] threads number of threads to solve for the seeds in parallel
+     */
+    static void computeSuperpixels(const cv::Mat &image, int region_height, 
+            int region_width, double beta, cv::Mat &labels, int threads = 1);
+};
+
+#endif	/* RW_OPENCV_H */
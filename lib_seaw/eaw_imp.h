@@ -12,7 +12,58 @@
 
 #define TABLE_LEN 1024
 
-double *dist_table ;
+double *dist_table = 0 ;
+
+#ifdef EAW_NATIVE
+
+/*************************************/
+/*        Owned grid (no MATLAB)     */
+/*************************************/
+
+// Same column-major layout as the mxArray wrapper below, i.e. len_x is
+// the number of image rows.
+
+struct Grid {
+    int len_x ;
+    int len_y ;
+    double *data ;
+    std::vector<double> storage ;
+    
+    Grid() { data = 0 ; len_x = 0 ; len_y = 0 ; }
+    
+    Grid(int lx, int ly) {
+        set(lx,ly) ;
+    }
+    
+    Grid(const Grid& A) {
+        data = 0 ;
+        set(A.len_x,A.len_y) ;
+        for(int i = 0 ; i < len_x*len_y ; i++)
+            data[i] = A.data[i] ;
+    }
+    
+    void operator=(const Grid& A) {        
+        set(A.len_x,A.len_y);
+        for(int i = 0 ; i < len_x*len_y ; i++)
+            data[i] = A.data[i] ;
+    }
+    
+    double& operator()(int x, int y) {
+        return data[x+y*len_x] ;
+    }
+    
+    double& operator[](int i) { return data[i] ; }
+    
+    // Zeroed; reuses the storage if it is large enough.
+    void set(int lx, int ly) {
+        len_x = lx ;
+        len_y = ly ;
+        storage.assign(len_x*len_y, 0.0) ;
+        data = storage.empty() ? 0 : &storage[0] ;
+    }
+}  ;
+
+#else
 
 /*************************************/
 /*        Warp for mxArray           */
@@ -58,10 +109,13 @@ struct Grid {
     }
 }  ;
 
+#endif
+
 
 // initiates distance table (1/d)
 
 void init(double alpha, double eps=0.0001) {
+    delete[] dist_table ;
     dist_table = new double[TABLE_LEN] ;
     
     for(int i = 0 ; i < TABLE_LEN ; i++) {
@@ -75,6 +129,7 @@ void init(double alpha, double eps=0.0001) {
 
 void init_exp(double alpha, double eps=0.001) {
     
+    delete[] dist_table ;
     dist_table = new double[TABLE_LEN] ;
     
     for(int i = 0 ; i < TABLE_LEN ; i++) {
@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "seaw_opencv.h"
+
+#define EAW_NATIVE
+#include "eaw_imp.h"
+
+/** \brief Scaling functions of coefficients [begin, end) of the coarsest level,
+ * keeping the per-pixel maximum and its coefficient as in max(m, [], 3), i.e.
+ * the first coefficient wins ties.
+ */
+void assignScalingFunctions(int begin, int end, std::vector<Grid> &W, 
+        const std::vector<int> &len_x, const std::vector<int> &len_y,
+        std::vector<double> &best, std::vector<int> &argbest) {
+    
+    int level = W.size();
+    Grid im;
+    Grid up;
+    
+    for (int k = begin; k < end; k++) {
+        im.set(len_x[level], len_y[level]);
+        im[k] = 1;
+        
+        // igEAW with zero details, one octave at a time.
+        for (int l = level - 1; l >= 0; l--) {
+            up.set(len_x[l], len_y[l]);
+            for (int y = 0; y < im.len_y; y++) {
+                for (int x = 0; x < im.len_x; x++) {
+                    up(2*x, 2*y) = im(x, y);
+                }
+            }
+            
+            iWRBg(up, im, W[l]);
+        }
+        
+        for (int i = 0; i < im.len_x*im.len_y; i++) {
+            if (im[i] > best[i]) {
+                best[i] = im[i];
+                argbest[i] = k;
+            }
+        }
+    }
+}
+
+void SEAW_OpenCV::computeSuperpixels(const cv::Mat &image, int level, 
+        int dist_func, double sigma, cv::Mat &labels, int threads) {
+    
+    int rows = image.rows;
+    int cols = image.cols;
+    int N = rows*cols;
+    
+    // First channel as read by imread (red) in [0,1], column major.
+    Grid J(rows, cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            if (image.channels() == 3) {
+                J(i, j) = image.at<cv::Vec3b>(i, j)[2]/255.;
+            }
+            else {
+                J(i, j) = image.at<unsigned char>(i, j)/255.;
+            }
+        }
+    }
+    
+    int levels = std::floor(std::log2(std::min(rows, cols)));
+    level = std::max(1, std::min(level, levels));
+    
+    if (dist_func) {
+        init(sigma);
+    }
+    else {
+        init_exp(sigma);
+    }
+    
+    // Only the first level octaves of EAW.m are needed for the scaling
+    // functions of the given level.
+    std::vector<Grid> W(level);
+    std::vector<int> len_x(level + 1);
+    std::vector<int> len_y(level + 1);
+    
+    Grid A;
+    for (int l = 0; l < level; l++) {
+        len_x[l] = J.len_x;
+        len_y[l] = J.len_y;
+        
+        WRB(J, A, W[l]);
+        
+        J.set((A.len_x + 1)/2, (A.len_y + 1)/2);
+        for (int y = 0; y < J.len_y; y++) {
+            for (int x = 0; x < J.len_x; x++) {
+                J(x, y) = A(2*x, 2*y);
+            }
+        }
+    }
+    
+    len_x[level] = J.len_x;
+    len_y[level] = J.len_y;
+    
+    // The scaling functions are independent; each thread takes a contiguous 
+    // block of coefficients, merging in block order keeps the tie breaking.
+    int K = len_x[level]*len_y[level];
+    threads = std::max(1, std::min(threads, K));
+    
+    std::vector< std::vector<double> > best(threads, 
+            std::vector<double>(N, -std::numeric_limits<double>::infinity()));
+    std::vector< std::vector<int> > argbest(threads, std::vector<int>(N, 0));
+    
+    #pragma omp parallel for num_threads(threads)
+    for (int t = 0; t < threads; t++) {
+        assignScalingFunctions((long) K*t/threads, (long) K*(t + 1)/threads, 
+                W, len_x, len_y, best[t], argbest[t]);
+    }
+    
+    for (int t = 1; t < threads; t++) {
+        for (int i = 0; i < N; i++) {
+            if (best[t][i] > best[0][i]) {
+                best[0][i] = best[t][i];
+                argbest[0][i] = argbest[t][i];
+            }
+        }
+    }
+    
+    labels.create(rows, cols, CV_32SC1);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            labels.at<int>(i, j) = argbest[0][i + rows*j];
+        }
+    }
+}
@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SEAW_OPENCV_H
+#define	SEAW_OPENCV_H
+
+#include <opencv2/opencv.hpp>
+
+/** \brief Wrapper for running SEAW on OpenCV images, following seaw_cli.m.
+ * \author David Stutz
+ */
+class SEAW_OpenCV {
+public:
+    /** \brief Compute superpixels using SEAW.
+     * 
+     * The red channel is transformed using red-black edge-avoiding wavelets;
+     * each pixel is assigned to the scaling function of the given level with
+     * highest response.
+     * 
+     * \param[in] image image to compute superpixels on
+     * \param[in] level level of the scaling functions, the number of superpixels
+     * is roughly (rows/2^level)*(cols/2^level)
+     * \param[in] dist_func 0 for exp(-(I-J)^2/sigma^2), 1 for 1/(|I-J|^sigma + eps)
+     * \param[in] sigma range scale of the distance function
+     * \param[out] labels superpixel labels
+     * \param[in] threads number of threads to compute scaling functions in parallel
+     */
+    static void computeSuperpixels(const cv::Mat &image, int level, 
+            int dist_func, double sigma, cv::Mat &labels, int threads = 1);
+};
+
+#endif	/* SEAW_OPENCV_H */
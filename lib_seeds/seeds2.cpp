@@ -23,10 +23,13 @@
  */
 
 #include "seeds2.h"
+#include "color_conversion.h"
 #include "math.h"
 #include <cstdio>
 #include <algorithm>
 #include <vector>
+#include <atomic>
+#include <thread>
 #include <iostream>
 #include <fstream>
 
@@ -55,8 +58,48 @@
  * 
  * The iterative nature of SEEDS described in the paper is "lost" because the user
  * can not simply abort after each iteration without loosing too much quality.
+ * See the overload below for a time budgeted variant.
  */
 void SEEDS::iterate(int iterations) 
+{
+	has_deadline = false;
+	run_iterations(iterations);
+}
+
+/**
+ * Same as above, but stops once the time budget (in milliseconds) is exceeded,
+ * checking between block updates and between pixel sweeps. The labels at the top
+ * level are valid after each of these steps, so the labeling computed so far is
+ * returned. A further call to iterate continues where the previous one stopped.
+ * 
+ * @param iterations
+ * @param time_budget
+ */
+void SEEDS::iterate(int iterations, double time_budget)
+{
+	has_deadline = true;
+	deadline = std::chrono::steady_clock::now() 
+                + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double, std::milli>(time_budget));
+	run_iterations(iterations);
+}
+
+/**
+ * Whether the deadline of a time budgeted iterate call has passed.
+ * 
+ * @return 
+ */
+bool SEEDS::deadline_passed()
+{
+	return has_deadline && std::chrono::steady_clock::now() >= deadline;
+}
+
+/**
+ * Block updates on all levels followed by pixel updates, used by iterate.
+ * 
+ * @param iterations
+ */
+void SEEDS::run_iterations(int iterations)
 {
 	// Begin with block updates at each level.
         // update_blocks moves every block at the current level to the neighbouring
@@ -64,6 +107,10 @@ void SEEDS::iterate(int iterations)
 	while (seeds_current_level >= 0)
 	{
                 for (int iteration = 0; iteration < iterations; ++iteration) {
+                        if (deadline_passed()) {
+                                return;
+                        }
+                        
                         update_blocks(seeds_current_level);
                 }
                 
@@ -76,11 +123,19 @@ void SEEDS::iterate(int iterations)
 		compute_means();
                 
                 for (int iteration = 0; iteration < iterations; ++iteration) {
+                        if (deadline_passed()) {
+                                return;
+                        }
+                        
                         update_pixels_means();
                 }
 	}
         else {
                 for (int iteration = 0; iteration < iterations; ++iteration) {
+                        if (deadline_passed()) {
+                                return;
+                        }
+                        
                         update_pixels();
                 }
         }
@@ -119,9 +174,32 @@ SEEDS::SEEDS(int width, int height, int nr_channels, int nr_bins, int min_size,
 	edge_h = new float[width*height];
 	forwardbackward = true;
 	histogram_size = nr_bins*nr_bins*nr_bins;
+	histogram_stride = (histogram_size + 15)/16*16;
+	bin_cutoff1 = NULL;
+	bin_cutoff2 = NULL;
+	bin_cutoff3 = NULL;
+	L_channel = NULL;
+	A_channel = NULL;
+	B_channel = NULL;
+	block_histogram = NULL;
+	block_histogram_buffer = NULL;
+	compact_histograms = false;
+	threads = 1;
+	has_deadline = false;
 	initialized = false;
 }
 
+/**
+ * Set the number of threads used for the pixel updates. With more than one
+ * thread, pixels are updated on a checkerboard of tiles, see sweep_pixels_tiled.
+ * 
+ * @param threads
+ */
+void SEEDS::set_threads(int threads)
+{
+	this->threads = max(1, threads);
+}
+
 /**
  * Destructor.
  */
@@ -135,56 +213,69 @@ SEEDS::~SEEDS()
 	delete[] edge_w;
 	delete[] edge_h;
 
+	delete[] bin_cutoff1;
+	delete[] bin_cutoff2;
+	delete[] bin_cutoff3;
+
+	release();
+}
+
+/**
+ * Free all structures depending on the block layout, i.e. on seeds_w, seeds_h
+ * and the number of levels.
+ */
+void SEEDS::release()
+{
 	if (initialized)
 	{
 		for (int level=0; level<seeds_nr_levels; level++)
 		{
-			for (int label=0; label<nr_labels[level]; label++)
-			{
-				delete[] histogram[level][label];
-			}
-			delete[]  histogram[level];
-			delete[] T[level];
 			delete[] labels[level];
-			delete[] parent[level];
-			delete[] nr_partitions[level];
-
 		}
-		delete[] histogram;
+		delete[] histogram_buffer;
+		delete[] block_histogram_buffer;
+		delete[] T_data;
 		delete[] T;
 		delete[] labels;
+		delete[] parent_data;
 		delete[] parent;
+		delete[] nr_partitions_data;
 		delete[] nr_partitions;
+		delete[] label_offset;
 		delete[] nr_labels;
 		delete[] nr_w;
 		delete[] nr_h;
-		if (color == 0 || color == 1) delete[] bin_cutoff1;
-		if (color == 0 || color == 1) delete[] bin_cutoff2;
-		if (color == 0 || color == 1) delete[] bin_cutoff3;
-
-		if (means) {
-                        delete[] L_channel;
-                        delete[] A_channel;
-                        delete[] B_channel;
-		}
+
+		delete[] L_channel;
+		delete[] A_channel;
+		delete[] B_channel;
+		L_channel = NULL;
+		A_channel = NULL;
+		B_channel = NULL;
+
+		initialized = false;
 	}
 }
 
 /**
- * Initialize the algorithm.
- * 
- * The initial superpixel size is defined by (seed_w*2^(nr_levels-1) x seed_h*2^(nr_levels-1)),
- * such that nr_levels defines how often the size of the smallest blocks are doubled to
- * get the superpixel size.
+ * Prepare the labels on all levels for a new image. When called again with the
+ * same block layout, e.g. for the frames of a video, all structures are reused
+ * instead of being reallocated.
  * 
- * @param image
  * @param seeds_w
  * @param seeds_h
  * @param nr_levels
  */
-void SEEDS::initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels)
+void SEEDS::setup(int seeds_w, int seeds_h, int nr_levels)
 {
+	if (initialized && (seeds_w != this->seeds_w || seeds_h != this->seeds_h 
+                || nr_levels != this->seeds_nr_levels))
+	{
+		release();
+	}
+
 	iteration = 0;
+	forwardbackward = true;
 
 	this->seeds_w = seeds_w;
 	this->seeds_h = seeds_h;
@@ -198,6 +289,23 @@ void SEEDS::initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels)
 	// Assign the labels and set up arrays to manage the labels
         // at each level.
 	assign_labels();
+}
+
+/**
+ * Initialize the algorithm.
+ * 
+ * The initial superpixel size is defined by (seed_w*2^(nr_levels-1) x seed_h*2^(nr_levels-1)),
+ * such that nr_levels defines how often the size of the smallest blocks are doubled to
+ * get the superpixel size.
+ * 
+ * @param image
+ * @param seeds_w
+ * @param seeds_h
+ * @param nr_levels
+ */
+void SEEDS::initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels)
+{
+	setup(seeds_w, seeds_h, nr_levels);
 	
 //	#ifdef LAB_COLORSPACE
         if (color == 0)
@@ -210,48 +318,22 @@ void SEEDS::initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels)
         }
 //	#endif
 
-	// Convert the image into LAB or
-	for (int x=0; x<width; x++)
-		for (int y=0; y<height; y++)
+	// Convert the image into LAB or RGB bins; natural images contain few
+	// distinct colors compared to their number of pixels, so the conversion
+	// is done once per color, see convert_pixel.
+	color_cache.assign(COLOR_CACHE_SIZE, ColorCacheEntry());
+	for (int y=0; y<height; y++)
+		for (int x=0; x<width; x++)
 		{
 			int i = y*width + x;
 			int r = (image[i] >> 16) & 0xFF;
 			int g = (image[i] >>  8) & 0xFF;
 			int b = (image[i]      ) & 0xFF;
-			float L;
-			float A;
-			float B;
-                        
-                        if (color == 0) // RGB
-                        {
-                                image_bins[i] = RGB_special(r, g, b, &L, &A, &B);
-				image_l[i] = r/255.0;
-				image_a[i] = g/255.0;
-				image_b[i] = b/255.0;
-                        }
-                        else if (color == 1) // Lab
-                        {
-//			#ifdef LAB_COLORSPACE
-				image_bins[i] = RGB2LAB_special(r, g, b, &L, &A, &B);
-				image_l[i] = L/100.0;
-				image_a[i] = (A+128.0)/255.0;
-				image_b[i] = (B+128.0)/255.0;
-//			#endif
-                        }
-                        else if (color == 2) // HSV
-                        {
-//			#ifdef HSV_COLORSPACE
-				image_bins[i] = RGB2HSV(r, g, b, &L, &A, &B);
-                                image_l[i] = L;
-				image_a[i] = A;
-				image_b[i] = B;
-//			#endif
-                        }
-                        else
-                        {
-                            std::cout << "Invalid color space!" << std::endl;
-                            return;
-                        }
+			if (!convert_pixel(i, r, g, b))
+			{
+				std::cout << "Invalid color space!" << std::endl;
+				return;
+			}
 		}
 
 	compute_histograms();
@@ -269,20 +351,7 @@ void SEEDS::initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels)
  */
 void SEEDS::initialize(const cv::Mat &image, int seeds_w, int seeds_h, int nr_levels)
 {
-	iteration = 0;
-
-	this->seeds_w = seeds_w;
-	this->seeds_h = seeds_h;
-        
-        // Minimum number of levels used for testing on BSDS500 is 4, at least 3
-        // levels are necessary not including the pixel level.
-	this->seeds_nr_levels = nr_levels;
-	this->seeds_top_level = nr_levels - 1;
-	this->seeds_current_level = nr_levels - 2;
-
-	// Assign the labels and set up arrays to manage the labels
-        // at each level.
-	assign_labels();
+	setup(seeds_w, seeds_h, nr_levels);
 	
 //	#ifdef LAB_COLORSPACE
         if (color == 0)
@@ -295,47 +364,22 @@ void SEEDS::initialize(const cv::Mat &image, int seeds_w, int seeds_h, int nr_le
         }
 //	#endif
 
-	// Convert the image into LAB or
-	for (int x=0; x<width; x++)
-		for (int y=0; y<height; y++)
+	// Convert the image into LAB or RGB bins; natural images contain few
+	// distinct colors compared to their number of pixels, so the conversion
+	// is done once per color, see convert_pixel.
+	color_cache.assign(COLOR_CACHE_SIZE, ColorCacheEntry());
+	for (int y=0; y<height; y++)
+		for (int x=0; x<width; x++)
 		{
 			int i = y*width + x;
 			int b = image.at<cv::Vec3b>(y, x)[0];
 			int g = image.at<cv::Vec3b>(y, x)[0];
 			int r = image.at<cv::Vec3b>(y, x)[0];
-			float L;
-			float A;
-			float B;
-			if (color == 0) // RGB
-                        {
-                                image_bins[i] = RGB_special(r, g, b, &L, &A, &B);
-				image_l[i] = r/255.0;
-				image_a[i] = g/255.0;
-				image_b[i] = b/255.0;
-                        }
-                        else if (color == 1) // Lab
-                        {
-//			#ifdef LAB_COLORSPACE
-				image_bins[i] = RGB2LAB_special(r, g, b, &L, &A, &B);
-				image_l[i] = L/100.0;
-				image_a[i] = (A+128.0)/255.0;
-				image_b[i] = (B+128.0)/255.0;
-//			#endif
-                        }
-                        else if (color == 2) // HSV
-                        {
-//			#ifdef HSV_COLORSPACE
-				image_bins[i] = RGB2HSV(r, g, b, &L, &A, &B);
-                                image_l[i] = L;
-				image_a[i] = A;
-				image_b[i] = B;
-//			#endif
-                        }
-                        else
-                        {
-                            std::cout << "Invalid color space!" << std::endl;
-                            return;
-                        }
+			if (!convert_pixel(i, r, g, b))
+			{
+				std::cout << "Invalid color space!" << std::endl;
+				return;
+			}
 		}
 
 	compute_histograms();
@@ -343,6 +387,65 @@ void SEEDS::initialize(const cv::Mat &image, int seeds_w, int seeds_h, int nr_le
 	initialized = true;
 }
 
+/**
+ * Set the bin and the normalized color channels of pixel i from its RGB color.
+ * The results are kept in a direct mapped cache of recent colors, as the
+ * color conversion and binning dominate initialization otherwise; the cache
+ * is reset in initialize as the bin cutoffs depend on the image.
+ * 
+ * @param i
+ * @param r
+ * @param g
+ * @param b
+ * @return false if the color space is invalid
+ */
+bool SEEDS::convert_pixel(int i, int r, int g, int b)
+{
+	UINT key = (r << 16) | (g << 8) | b;
+	ColorCacheEntry &entry = color_cache[(key*2654435761u) >> (32 - COLOR_CACHE_BITS)];
+	
+	if (entry.key != key)
+	{
+		float L;
+		float A;
+		float B;
+		
+		if (color == 0) // RGB
+		{
+			entry.bin = RGB_special(r, g, b, &L, &A, &B);
+			entry.l = r/255.0;
+			entry.a = g/255.0;
+			entry.b = b/255.0;
+		}
+		else if (color == 1) // Lab
+		{
+			entry.bin = RGB2LAB_special(r, g, b, &L, &A, &B);
+			entry.l = L/100.0;
+			entry.a = (A+128.0)/255.0;
+			entry.b = (B+128.0)/255.0;
+		}
+		else if (color == 2) // HSV
+		{
+			entry.bin = RGB2HSV(r, g, b, &L, &A, &B);
+			entry.l = L;
+			entry.a = A;
+			entry.b = B;
+		}
+		else
+		{
+			return false;
+		}
+		
+		entry.key = key;
+	}
+	
+	image_bins[i] = entry.bin;
+	image_l[i] = entry.l;
+	image_a[i] = entry.a;
+	image_b[i] = entry.b;
+	return true;
+}
+
 /**
  * Called in initialize, the method initializes all arrays needed to managing the labels 
  * on all levels:
@@ -356,23 +459,50 @@ void SEEDS::initialize(const cv::Mat &image, int seeds_w, int seeds_h, int nr_le
  */
 void SEEDS::assign_labels()
 {
-        // Two dimensional array to assign each pixel a label at each level: labels[seeds_nr_levels][width*height].
-	labels = new UINT*[seeds_nr_levels];
-        
-        // Two dimensional array containing the superpixel label for each pixel on the current level.
-	parent = new UINT*[seeds_nr_levels];
-        
-        // Counts the number of subblocks a label at level l can be divided into.
-        // This is managed in add_block and delete_block.
-	nr_partitions = new UINT*[seeds_nr_levels];
-        
-        // Contains the total number of labels at each level.
-	nr_labels = new UINT[seeds_nr_levels];
+	// All arrays are kept if the block layout did not change, see setup.
+	if (!initialized)
+	{
+                // Two dimensional array to assign each pixel a label at each level: labels[seeds_nr_levels][width*height].
+		labels = new UINT*[seeds_nr_levels];
+		for (int level = 0; level < seeds_nr_levels; level++)
+		{
+			labels[level] = new UINT[width*height];
+		}
+                
+                // Two dimensional array containing the superpixel label for each pixel on the current level.
+		parent = new UINT*[seeds_nr_levels];
+                
+                // Counts the number of subblocks a label at level l can be divided into.
+                // This is managed in add_block and delete_block.
+		nr_partitions = new UINT*[seeds_nr_levels];
+                
+                // Contains the total number of labels at each level.
+		nr_labels = new UINT[seeds_nr_levels];
+                
+                // Arrays to contain the number of blocks in x and y direction, respectively.
+		nr_w = new int[seeds_nr_levels];
+		nr_h = new int[seeds_nr_levels];
+                
+                // The labels of all levels are stored contiguously, such that parent,
+                // nr_partitions, T and the histograms need one allocation each.
+		label_offset = new UINT[seeds_nr_levels];
+		UINT total_nr_labels = 0;
+		for (int level = 0, w = floor(width/seeds_w), h = floor(height/seeds_h); 
+                        level < seeds_nr_levels; level++, w /= 2, h /= 2)
+		{
+			label_offset[level] = total_nr_labels;
+			total_nr_labels += w*h;
+		}
+                
+		parent_data = new UINT[total_nr_labels];
+		nr_partitions_data = new UINT[total_nr_labels];
+		for (int level = 0; level < seeds_nr_levels; level++)
+		{
+			parent[level] = parent_data + label_offset[level];
+			nr_partitions[level] = nr_partitions_data + label_offset[level];
+		}
+	}
         
-        // Arrays to contain the number of blocks in x and y direction, respectively.
-	nr_w = new int[seeds_nr_levels];
-	nr_h = new int[seeds_nr_levels];
-
 	// Base level: 0.
 	int level = 0;
 	int nr_seeds_w = floor(width/seeds_w);
@@ -386,9 +516,6 @@ void SEEDS::assign_labels()
 	nr_labels[level] = nr_seeds;
 	nr_w[level] = nr_seeds_w;
 	nr_h[level] = nr_seeds_h;
-	labels[level] = new UINT[width*height];
-	parent[level] = new UINT[nr_seeds];
-	nr_partitions[level] = new UINT[nr_seeds];
         
         // At base level there is no further partitioning, each pixel
         // contains exactly one pixel.
@@ -422,9 +549,6 @@ void SEEDS::assign_labels()
 		nr_labels[level] = nr_seeds;
 		nr_w[level] = nr_seeds_w;
 		nr_h[level] = nr_seeds_h;
-		labels[level] = new UINT[width*height];
-		parent[level] = new UINT[nr_seeds];
-		nr_partitions[level] = new UINT[nr_seeds];
                 
                 // nr_partitions is managed in add_block and delete_block, so
                 // just initialize with zero.
@@ -472,9 +596,9 @@ void SEEDS::lab_get_histogram_cutoff_values(UINT* image)
 			list_channel3.push_back(B);
 			ctr++;
 		}
-	bin_cutoff1 = new float[nr_bins];
-	bin_cutoff2 = new float[nr_bins];
-	bin_cutoff3 = new float[nr_bins];
+	if (bin_cutoff1 == NULL) bin_cutoff1 = new float[nr_bins];
+	if (bin_cutoff2 == NULL) bin_cutoff2 = new float[nr_bins];
+	if (bin_cutoff3 == NULL) bin_cutoff3 = new float[nr_bins];
 	for (int i=1; i<nr_bins; i++)
 	{
 		int N = (int) floor((float) (i*ctr)/ (float)nr_bins);
@@ -518,9 +642,9 @@ void SEEDS::lab_get_histogram_cutoff_values(const cv::Mat &image)
 			list_channel3.push_back(B);
 			ctr++;
 		}
-	bin_cutoff1 = new float[nr_bins];
-	bin_cutoff2 = new float[nr_bins];
-	bin_cutoff3 = new float[nr_bins];
+	if (bin_cutoff1 == NULL) bin_cutoff1 = new float[nr_bins];
+	if (bin_cutoff2 == NULL) bin_cutoff2 = new float[nr_bins];
+	if (bin_cutoff3 == NULL) bin_cutoff3 = new float[nr_bins];
 	for (int i=1; i<nr_bins; i++)
 	{
 		int N = (int) floor((float) (i*ctr)/ (float)nr_bins);
@@ -560,9 +684,9 @@ void SEEDS::rgb_get_histogram_cutoff_values(UINT* image)
 			list_channel3.push_back(r);
 			ctr++;
 		}
-	bin_cutoff1 = new float[nr_bins];
-	bin_cutoff2 = new float[nr_bins];
-	bin_cutoff3 = new float[nr_bins];
+	if (bin_cutoff1 == NULL) bin_cutoff1 = new float[nr_bins];
+	if (bin_cutoff2 == NULL) bin_cutoff2 = new float[nr_bins];
+	if (bin_cutoff3 == NULL) bin_cutoff3 = new float[nr_bins];
 	for (int i=1; i<nr_bins; i++)
 	{
 		int N = (int) floor((float) (i*ctr)/ (float)nr_bins);
@@ -602,9 +726,9 @@ void SEEDS::rgb_get_histogram_cutoff_values(const cv::Mat &image)
 			list_channel3.push_back(r);
 			ctr++;
 		}
-	bin_cutoff1 = new float[nr_bins];
-	bin_cutoff2 = new float[nr_bins];
-	bin_cutoff3 = new float[nr_bins];
+	if (bin_cutoff1 == NULL) bin_cutoff1 = new float[nr_bins];
+	if (bin_cutoff2 == NULL) bin_cutoff2 = new float[nr_bins];
+	if (bin_cutoff3 == NULL) bin_cutoff3 = new float[nr_bins];
 	for (int i=1; i<nr_bins; i++)
 	{
 		int N = (int) floor((float) (i*ctr)/ (float)nr_bins);
@@ -631,9 +755,12 @@ void SEEDS::rgb_get_histogram_cutoff_values(const cv::Mat &image)
  */
 void SEEDS::compute_means()
 {
-	L_channel = new float[nr_labels[seeds_top_level]];
-	A_channel = new float[nr_labels[seeds_top_level]];
-	B_channel = new float[nr_labels[seeds_top_level]];
+	if (L_channel == NULL)
+	{
+		L_channel = new float[nr_labels[seeds_top_level]];
+		A_channel = new float[nr_labels[seeds_top_level]];
+		B_channel = new float[nr_labels[seeds_top_level]];
+	}
 
 	// clear counted LAB values
 	for (int label=0; label<nr_labels[seeds_top_level]; label++)
@@ -670,54 +797,49 @@ void SEEDS::compute_histograms(int until_level)
 	if (until_level == -1) until_level = seeds_nr_levels - 1;
 	until_level++;
 
-	// Initialize the histrograms in the first iteration.
-	if (iteration == 0)
+	// Initialize the histrograms unless kept from a previous image, see setup.
+	if (!initialized)
 	{
-                // Histograms are initialized for each label in each level: histogram[level][label][bin].
-		histogram = new int**[seeds_nr_levels];
-                
+                // Histograms are initialized for each label in each level: the superpixel
+                // histograms histogram[label][bin] and the block histograms
+                // block_histogram[level][label][bin], each stored as one slab with rows
+                // of histogram_stride bins, see get_histogram and get_block_histogram.
+		int total_nr_labels = label_offset[seeds_nr_levels - 1] + nr_labels[seeds_nr_levels - 1];
+		histogram_buffer = new int[(size_t) nr_labels[seeds_top_level]*histogram_stride + 15];
+		histogram = (int*) (((size_t) histogram_buffer + 63) & ~((size_t) 63));
+		
+		// The largest blocks below the top level are the ones at the right and
+		// bottom border of the level just below the top level, these also
+		// cover the remaining pixels.
+		int step_w = seeds_w << (seeds_top_level - 1);
+		int step_h = seeds_h << (seeds_top_level - 1);
+		int max_block_size = (width - (nr_w[seeds_top_level - 1] - 1)*step_w)
+                        *(height - (nr_h[seeds_top_level - 1] - 1)*step_h);
+		compact_histograms = (max_block_size <= 65535);
+		
+		size_t count_size = (compact_histograms ? sizeof(unsigned short) : sizeof(int));
+		block_histogram_buffer = new char[(size_t) label_offset[seeds_top_level]*histogram_stride*count_size + 63];
+		block_histogram = (void*) (((size_t) block_histogram_buffer + 63) & ~((size_t) 63));
                 
+		T_data = new int[total_nr_labels];
 		T = new int*[seeds_nr_levels]; // block sizes are kept at each level [level][label]
 		for (int level=0; level<seeds_nr_levels; level++)
 		{
-			histogram[level] = new int*[nr_labels[level]];
-                        
                         // Block sizes are kept at each level: T[level][label].
-			T[level] = new int[nr_labels[level]]; 
-			for (int label=0; label<nr_labels[level]; label++)
-			{
-				histogram[level][label] = new int[histogram_size]; // histogram bins
-			}
+			T[level] = T_data + label_offset[level];
 		}
 	}
 
 	// Initialize empty histograms - this could also be done in the for loop before.
-	for (int level=0; level<seeds_nr_levels; level++)
-		for (int label=0; label<nr_labels[level]; label++)
-		{
-			for (int j=0; j<histogram_size; j++)
-				histogram[level][label][j] = 0;
-			T[level][label] = 0;
-		}
-
-	// Histograms are built in a level-wise manner, that is first the histograms
-        // for the first level are built using the pixels, then the histograms
-        // can simply be added to for the histogram of blocks at the next level.
-        // The histograms are built using the add_pxiel and add_block methods
-        // which automatically update the histograms.
-	for (int x=0; x<width; x++)
-		for (int y=0; y<height; y++)
-		{					
-			int i = y*width +x;
-			add_pixel(0, labels[0][i], x, y);
-		}
+	clear_histograms();
 
-	for (int level=1; level<until_level; level++)
+	if (compact_histograms)
 	{
-		for (int label=0; label<nr_labels[level-1]; label++)
-		{
-			add_block(level, parent[level-1][label], level-1, label);
-		}
+		compute_block_histograms<unsigned short>(until_level, false);
+	}
+	else
+	{
+		compute_block_histograms<int>(until_level, false);
 	}
 }
 
@@ -728,24 +850,71 @@ void SEEDS::compute_histograms(int until_level)
 void SEEDS::compute_histograms_ex()
 {
 	// clear histograms
-	for (int level=0; level<seeds_nr_levels; level++)
-		for (int label=0; label<nr_labels[level]; label++)
-		{
-			for (int j=0; j<histogram_size; j++)
-				histogram[level][label][j] = 0;
-			T[level][label] = 0;
-		}
+	clear_histograms();
+
+	if (compact_histograms)
+	{
+		compute_block_histograms<unsigned short>(seeds_nr_levels, true);
+	}
+	else
+	{
+		compute_block_histograms<int>(seeds_nr_levels, true);
+	}
+}
 
-	for (int level=0; level<seeds_nr_levels; level++)
+/**
+ * Build the histograms of the first until_level levels with the block histograms
+ * stored as COUNT. Unless explicitly is set, the histograms are built in a
+ * level-wise manner, that is first the histograms for the first level are built
+ * using the pixels, then the histograms can simply be added to for the histogram
+ * of blocks at the next level; this also sets up nr_partitions. 
+ * 
+ * @param until_level
+ * @param explicitly
+ */
+template<typename COUNT>
+void SEEDS::compute_block_histograms(int until_level, bool explicitly)
+{
+	for (int level=0; level<(explicitly ? until_level : 1); level++)
 		for (int x=0; x<width; x++)
 			for (int y=0; y<height; y++)
-			{					
-				int i = y*width +x;
-				//add_pixel(level, labels[level][i], x, y);
-				histogram[level][labels[level][i]][image_bins[y*width+x]]++;
-				T[level][labels[level][i]]++;
+			{
+				int i = y*width + x;
+				int label = labels[level][i];
+				if (level == seeds_top_level)
+				{
+					get_histogram(label)[image_bins[i]]++;
+				}
+				else
+				{
+					get_block_histogram<COUNT>(level, label)[image_bins[i]]++;
+				}
+				T[level][label]++;
 			}
 
+	if (explicitly) return;
+
+	for (int level=1; level<until_level; level++)
+	{
+		for (int label=0; label<nr_labels[level-1]; label++)
+		{
+			add_block(level, parent[level-1][label], level-1, label);
+		}
+	}
+}
+
+/**
+ * Clear all histograms and block sizes; as all labels of all levels are stored
+ * contiguously, this clears each slab at once.
+ */
+void SEEDS::clear_histograms()
+{
+	int total_nr_labels = label_offset[seeds_nr_levels - 1] + nr_labels[seeds_nr_levels - 1];
+	size_t count_size = (compact_histograms ? sizeof(unsigned short) : sizeof(int));
+	std::fill(histogram, histogram + (size_t) nr_labels[seeds_top_level]*histogram_stride, 0);
+	std::fill((char*) block_histogram, (char*) block_histogram 
+                + (size_t) label_offset[seeds_top_level]*histogram_stride*count_size, 0);
+	std::fill(T_data, T_data + total_nr_labels, 0);
 }
 
 void SEEDS::compute_edges()
@@ -841,12 +1010,9 @@ void SEEDS::update_blocks(int level, float req_confidence)
 						// Delete the block from label A and compute the intersection of 
                                                 // the sublabel with both label A and B.
 						delete_block(seeds_top_level, labelA, level, sublabel);
-						float intA = intersection(seeds_top_level, labelA, level, sublabel);
-						float intB = intersection(seeds_top_level, labelB, level, sublabel);
-						float confidence = fabs(intA - intB);
 						
                                                 // Add the block to the label with the highest intersection.
-						if ((intB > intA) && (confidence > req_confidence))
+						if (intersection_exceeds(seeds_top_level, labelB, labelA, level, sublabel, req_confidence))
 						{
 							add_block(seeds_top_level, labelB, level, sublabel);
 							done = true;
@@ -866,12 +1032,9 @@ void SEEDS::update_blocks(int level, float req_confidence)
 							// As with only 2 partitions, delete block from label A
                                                         // and check the intersection with label A and B.
 							delete_block(seeds_top_level, labelA, level, sublabel);
-							float intA = intersection(seeds_top_level, labelA, level, sublabel);
-							float intB = intersection(seeds_top_level, labelB, level, sublabel);
-							float confidence = fabs(intA - intB);
 							
                                                         // Assign to label with higher intersection.
-							if ((intB > intA) && (confidence > req_confidence))
+							if (intersection_exceeds(seeds_top_level, labelB, labelA, level, sublabel, req_confidence))
 							{
 								add_block(seeds_top_level, labelB, level, sublabel);
 								done = true;
@@ -895,10 +1058,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 					if (nr_partitions[seeds_top_level][labelB] <= 2) // == 2
 					{
 						delete_block(seeds_top_level, labelB, level, sublabel);
-						float intA = intersection(seeds_top_level, labelA, level, sublabel);
-						float intB = intersection(seeds_top_level, labelB, level, sublabel);
-						float confidence = fabs(intA - intB);
-						if ((intA > intB) && (confidence > req_confidence))
+						if (intersection_exceeds(seeds_top_level, labelA, labelB, level, sublabel, req_confidence))
 						{
 							add_block(seeds_top_level, labelA, level, sublabel);
 							x++;
@@ -913,10 +1073,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 						if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
 						{
 							delete_block(seeds_top_level, labelB, level, sublabel);
-							float intA = intersection(seeds_top_level, labelA, level, sublabel);
-							float intB = intersection(seeds_top_level, labelB, level, sublabel);
-							float confidence = fabs(intA - intB);
-							if ((intA > intB) && (confidence > req_confidence))
+							if (intersection_exceeds(seeds_top_level, labelA, labelB, level, sublabel, req_confidence))
 							{
 								add_block(seeds_top_level, labelA, level, sublabel);
 								x++;
@@ -966,11 +1123,8 @@ void SEEDS::update_blocks(int level, float req_confidence)
 					if (nr_partitions[seeds_top_level][labelA] <= 2)
 					{
 						delete_block(seeds_top_level, labelA, level, sublabel);
-						float intA = intersection(seeds_top_level, labelA, level, sublabel);
-						float intB = intersection(seeds_top_level, labelB, level, sublabel);
-						float confidence = fabs(intA - intB);
                                                 
-						if ((intB > intA) && (confidence > req_confidence))
+						if (intersection_exceeds(seeds_top_level, labelB, labelA, level, sublabel, req_confidence))
 						{
 							add_block(seeds_top_level, labelB, level, sublabel);
 							//y++;
@@ -986,11 +1140,8 @@ void SEEDS::update_blocks(int level, float req_confidence)
 						if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
 						{
 							delete_block(seeds_top_level, labelA, level, sublabel);
-							float intA = intersection(seeds_top_level, labelA, level, sublabel);
-							float intB = intersection(seeds_top_level, labelB, level, sublabel);
-							float confidence = fabs(intA - intB);
                                                         
-							if ((intB > intA) && (confidence > req_confidence))
+							if (intersection_exceeds(seeds_top_level, labelB, labelA, level, sublabel, req_confidence))
 							{
 								add_block(seeds_top_level, labelB, level, sublabel);
 								//y++;
@@ -1011,11 +1162,8 @@ void SEEDS::update_blocks(int level, float req_confidence)
 					if (nr_partitions[seeds_top_level][labelB] <= 2) // == 2
 					{
 						delete_block(seeds_top_level, labelB, level, sublabel);
-						float intA = intersection(seeds_top_level, labelA, level, sublabel);
-						float intB = intersection(seeds_top_level, labelB, level, sublabel);
-						float confidence = fabs(intA - intB);
                                                 
-						if ((intA > intB) && (confidence > req_confidence))
+						if (intersection_exceeds(seeds_top_level, labelA, labelB, level, sublabel, req_confidence))
 						{
 							add_block(seeds_top_level, labelA, level, sublabel);
 							y++;
@@ -1030,11 +1178,8 @@ void SEEDS::update_blocks(int level, float req_confidence)
 						if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
 						{
 							delete_block(seeds_top_level, labelB, level, sublabel);
-							float intA = intersection(seeds_top_level, labelA, level, sublabel);
-							float intB = intersection(seeds_top_level, labelB, level, sublabel);
-							float confidence = fabs(intA - intB);
                                                         
-							if ((intA > intB) && (confidence > req_confidence))
+							if (intersection_exceeds(seeds_top_level, labelA, labelB, level, sublabel, req_confidence))
 							{
 								add_block(seeds_top_level, labelA, level, sublabel);
 								y++;
@@ -1096,201 +1241,45 @@ int SEEDS::go_down_one_level()
  */
 void SEEDS::update_pixels()
 {
-	int labelA, labelA1, labelA2, labelA3;
-	int labelB, labelB1, labelB2, labelB3;
-	int priorA;
-	int priorB;
-	float edgeA;
-	float edgeB;
-
-	if (forwardbackward)
-	{
-		forwardbackward = false;
-		for (int y=1; y<height-1; y++)
-			for (int x=1; x<width-1; x++) 
-			{
-                                // Get all labels in a three by four neighbourhood.
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a14 = labels[seeds_top_level][(y-1)*width+(x+2)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a24 = labels[seeds_top_level][(y)*width+(x+2)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)];
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a34 = labels[seeds_top_level][(y+1)*width+(x+2)];
-
-				// Label A is the current label, label B is the
-                                // label to move the current pixel to.
-				labelA = a22;
-				labelB = a23;
-				if (labelA != labelB)
-				{
-					if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, true, true))
-					{
-                                                // Incorporate a simple prior based on the
-                                                // labels of the local neighbourhood of the pixel.
-                                                if (prior) {
-                                                        priorA = threebyfour(x,y,labelA);
-                                                        priorB = threebyfour(x,y,labelB);
-                                                }
-
-						if (probability(image_bins[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-						{
-							update(seeds_top_level, labelB, x, y);
-						}
-						else if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
-						{
-							if (probability(image_bins[y*width+x+1], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-							{
-								update(seeds_top_level, labelA, x+1, y);
-								x++;
-							}
-						}
-					}
-				}
-			}
+	sweep_pixels(false);
+}
 
-                // Same procedure for vertical movements of the current pixel.
-		for (int x=1; x<width-1; x++)
-			for (int y=1; y<height-1; y++)
-			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)]; 
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a41 = labels[seeds_top_level][(y+2)*width+(x-1)];
-				int a42 = labels[seeds_top_level][(y+2)*width+(x)];
-				int a43 = labels[seeds_top_level][(y+2)*width+(x+1)];
-
-				labelA = a22;
-				labelB = a32;
-				if (labelA != labelB)
-				{
-					if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
-					{
-                                                if (prior) {
-                                                        priorA = fourbythree(x,y,labelA);
-                                                        priorB =  fourbythree(x,y,labelB);
-                                                }
+/**
+ * Update pixels mean-based as described in [2] similar to SLIC.
+ */
+void SEEDS::update_pixels_means()
+{
+	sweep_pixels(true);
+}
 
-						if (probability(image_bins[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-						{
-							update(seeds_top_level, labelB, x, y);
-						} 
-						else if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
-						{
-							if (probability(image_bins[(y+1)*width+x], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-							{
-								update(seeds_top_level, labelA, x, y+1);
-								y++;
-							}
-						}
-					}
-				}
-			}
+/**
+ * Runs the pixel updates for update_pixels (histogram-based) or 
+ * update_pixels_means (mean-based): a horizontal and a vertical sweep, whose
+ * direction alternates between calls, followed by the image border.
+ * 
+ * With more than one thread, the sweeps are scheduled on tiles, see
+ * sweep_pixels_tiled.
+ * 
+ * @param use_means
+ */
+void SEEDS::sweep_pixels(bool use_means)
+{
+	int labelA;
+	int labelB;
+	
+	bool forward = forwardbackward;
+	forwardbackward = !forwardbackward;
+	
+	if (threads > 1)
+	{
+		sweep_pixels_tiled(true, forward, use_means);
+		sweep_pixels_tiled(false, forward, use_means);
 	}
 	else
 	{
-		forwardbackward = true;
-		for (int y=1; y<height-1; y++)
-			for (int x=1; x<width-1; x++) 
-			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a14 = labels[seeds_top_level][(y-1)*width+(x+2)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a24 = labels[seeds_top_level][(y)*width+(x+2)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)];
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a34 = labels[seeds_top_level][(y+1)*width+(x+2)];
-
-				// horizontal bidirectional
-				labelA = a22;
-				labelB = a23;
-				if (labelA != labelB)
-				{
-					if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
-					{
-                                                if (prior) {
-                                                        priorA = threebyfour(x,y,labelA);
-                                                        priorB = threebyfour(x,y,labelB);
-                                                }
-
-						if (probability(image_bins[y*width+x+1], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-						{
-							update(seeds_top_level, labelA, x+1, y);
-							x++;
-						}
-						else if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, true, true))
-						{
-							if (probability(image_bins[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-							{
-								update(seeds_top_level, labelB, x, y);
-							}
-						}
-					}
-				}
-			}
-
-
-		for (int x=1; x<width-1; x++)
-			for (int y=1; y<height-1; y++)
-			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)]; 
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a41 = labels[seeds_top_level][(y+2)*width+(x-1)];
-				int a42 = labels[seeds_top_level][(y+2)*width+(x)];
-				int a43 = labels[seeds_top_level][(y+2)*width+(x+1)];
-
-				// vertical bidirectional
-				labelA = a22;
-				labelB = a32;
-				if (labelA != labelB)
-				{
-					if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
-					{
-						if (prior) {					
-                                                        priorA = fourbythree(x,y,labelA);
-                                                        priorB =  fourbythree(x,y,labelB);
-						}
-
-						if (probability(image_bins[(y+1)*width+x], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-						{
-							update(seeds_top_level, labelA, x, y+1);
-							y++;
-						}
-						else if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
-						{
-							if (probability(image_bins[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-							{
-								update(seeds_top_level, labelB, x, y);
-							}
-						}
-					}
-				}
-			}
-
-	}
+		sweep_pixels_horizontal(forward, use_means, 1, width - 1, 1, height - 1, NULL);
+		sweep_pixels_vertical(forward, use_means, 1, width - 1, 1, height - 1, NULL);
+	}
 
 	// Update the border pixels, here we do not have to check the entire
         // neighbourhood, instead just check right and left or above and below.
@@ -1327,247 +1316,315 @@ void SEEDS::update_pixels()
 }
 
 /**
- * Update pixels mean-based as described in [2] similar to SLIC.
+ * Schedules a horizontal or vertical sweep on a checkerboard of tiles with four
+ * colors. Tiles of the same color are at least one tile apart, such that the
+ * 3 by 4 and 4 by 3 neighbourhoods of their pixels never touch and they can be
+ * updated concurrently; colors are processed one after another.
+ * 
+ * While a color is processed, the histograms and means are not modified and
+ * the moves of each tile are recorded instead. They are applied in tile order
+ * before the next color, so the result does not depend on the number of threads
+ * (but differs slightly from the sequential sweep).
+ * 
+ * @param horizontal
+ * @param forward
+ * @param use_means
  */
-void SEEDS::update_pixels_means()
+void SEEDS::sweep_pixels_tiled(bool horizontal, bool forward, bool use_means)
 {
-	int labelA, labelA1, labelA2, labelA3;
-	int labelB, labelB1, labelB2, labelB3;
-	int priorA;
-	int priorB;
-	float edgeA;
-	float edgeB;
-
-	if (forwardbackward)
+	const int TILE_SIZE = 64;
+	const int nr_tiles_w = (width - 2 + TILE_SIZE - 1)/TILE_SIZE;
+	const int nr_tiles_h = (height - 2 + TILE_SIZE - 1)/TILE_SIZE;
+	
+	vector< vector<PixelMove> > moves(nr_tiles_w*nr_tiles_h);
+	for (int color = 0; color < 4; color++)
 	{
-		forwardbackward = false;
-		for (int y=1; y<height-1; y++)
-			for (int x=1; x<width-1; x++) 
+		vector<int> tiles;
+		for (int ty = color/2; ty < nr_tiles_h; ty += 2)
+			for (int tx = color%2; tx < nr_tiles_w; tx += 2)
+			{
+				tiles.push_back(ty*nr_tiles_w + tx);
+			}
+		
+		std::atomic<int> next(0);
+		auto worker = [&]() {
+			for (int t = next++; t < (int) tiles.size(); t = next++)
 			{
-                                // 3 by 4 neighbourhood of current pixel.
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a14 = labels[seeds_top_level][(y-1)*width+(x+2)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)];
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)]; 
-				int a24 = labels[seeds_top_level][(y)*width+(x+2)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)];
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a34 = labels[seeds_top_level][(y+1)*width+(x+2)];
-
-				// a22 is the label of the current pixel,
-                                // a23 is the label of the neighbouring superpixel.
-				labelA = a22;
-				labelB = a23;
-				if (labelA != labelB)
+				int tile = tiles[t];
+				int x0 = 1 + (tile%nr_tiles_w)*TILE_SIZE;
+				int y0 = 1 + (tile/nr_tiles_w)*TILE_SIZE;
+				int x1 = min(x0 + TILE_SIZE, width - 1);
+				int y1 = min(y0 + TILE_SIZE, height - 1);
+				
+				moves[tile].clear();
+				if (horizontal)
 				{
-                                        // Only exchange pixel to neighbouring superpixel if the superpixel is
-                                        // not going to be split up.
-					if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, true, true))
-					{
-                                                // Compute a simple prior whether the current pixel
-                                                // should be exchanged or not.
-                                                if (prior) {
-                                                    priorA = threebyfour(x,y,labelA); // Label A is the current label of pixel (x,y).
-                                                    priorB = threebyfour(x,y,labelB);
-						}
-
-                                                // Check whether it is probable that the current pixel belongs to label B.
-						if (probability_means(image_l[y*width+x], image_a[y*width+x], image_b[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-						{
-							update(seeds_top_level, labelB, x, y);
-						}
-                                                // At the same point check the next pixel given by x+1 whether to move, as well.
-						else if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
-						{
-							if (probability_means(image_l[y*width+x+1], image_a[y*width+x+1], image_b[y*width+x+1], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-							{
-								update(seeds_top_level, labelA, x+1, y);
-								x++;
-							}
-						}
-					}
+					sweep_pixels_horizontal(forward, use_means, x0, x1, y0, y1, &moves[tile]);
+				}
+				else
+				{
+					sweep_pixels_vertical(forward, use_means, x0, x1, y0, y1, &moves[tile]);
 				}
 			}
+		};
+		
+		vector<std::thread> workers;
+		for (int i = 1; i < min(threads, (int) tiles.size()); i++)
+		{
+			workers.push_back(std::thread(worker));
+		}
+		worker();
+		for (unsigned int i = 0; i < workers.size(); i++)
+		{
+			workers[i].join();
+		}
+		
+		for (unsigned int t = 0; t < tiles.size(); t++)
+		{
+			const vector<PixelMove> &tile_moves = moves[tiles[t]];
+			for (unsigned int m = 0; m < tile_moves.size(); m++)
+			{
+				delete_pixel_m(seeds_top_level, tile_moves[m].label_old, tile_moves[m].x, tile_moves[m].y);
+				add_pixel_m(seeds_top_level, tile_moves[m].label_new, tile_moves[m].x, tile_moves[m].y);
+			}
+		}
+	}
+}
 
-                // Same procedure for vertical moving of pixels.
-		for (int x=1; x<width-1; x++)
-			for (int y=1; y<height-1; y++)
+/**
+ * Horizontal sweep over the pixels in [x0,x1) x [y0,y1), checking whether to
+ * move each pixel to its right neighbour's superpixel or vice versa.
+ * 
+ * @param forward whether to first try moving the current pixel (forward) or
+ * the right neighbour (backward)
+ * @param use_means whether to decide using the means or the histograms
+ * @param x0
+ * @param x1
+ * @param y0
+ * @param y1
+ * @param moves if not NULL, moves are recorded instead of updating histograms
+ * and means, see move_pixel
+ */
+void SEEDS::sweep_pixels_horizontal(bool forward, bool use_means, int x0, int x1, int y0, int y1, vector<PixelMove>* moves)
+{
+	int priorA;
+	int priorB;
+	
+	for (int y=y0; y<y1; y++)
+		for (int x=x0; x<x1; x++) 
+		{
+                        // Get all labels in a three by four neighbourhood.
+			int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
+			int a12 = labels[seeds_top_level][(y-1)*width+(x)];
+			int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
+			int a14 = labels[seeds_top_level][(y-1)*width+(x+2)];
+			int a21 = labels[seeds_top_level][(y)*width+(x-1)];
+			int a22 = labels[seeds_top_level][(y)*width+(x)]; 
+			int a23 = labels[seeds_top_level][(y)*width+(x+1)];
+			int a24 = labels[seeds_top_level][(y)*width+(x+2)];
+			int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
+			int a32 = labels[seeds_top_level][(y+1)*width+(x)];
+			int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
+			int a34 = labels[seeds_top_level][(y+1)*width+(x+2)];
+
+			// Label A is the current label, label B is the
+                        // label to move the current pixel to.
+			int labelA = a22;
+			int labelB = a23;
+			if (labelA == labelB)
 			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)]; 
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a41 = labels[seeds_top_level][(y+2)*width+(x-1)];
-				int a42 = labels[seeds_top_level][(y+2)*width+(x)];
-				int a43 = labels[seeds_top_level][(y+2)*width+(x+1)];
-
-				// Label A is the current label of the pixel,
-                                // label B the label to move the pixel to.
-				labelA = a22;
-				labelB = a32;
-                                
-                                // The approach is the same as with the horizontal exchanging of pixels - 
-                                // use the probability estimate to check whether to move the pixel.
-				if (labelA != labelB)
+				continue;
+			}
+			
+			if (forward)
+			{
+				if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, true, true))
 				{
-					if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
+                                        // Incorporate a simple prior based on the
+                                        // labels of the local neighbourhood of the pixel.
+                                        if (prior) {
+                                                priorA = threebyfour(x,y,labelA);
+                                                priorB = threebyfour(x,y,labelB);
+                                        }
+
+					if (probability_pixel(y*width+x, labelA, labelB, priorA, priorB, use_means)) 
 					{
-                                                if (prior) {
-                                                        priorA = fourbythree(x,y,labelA);
-                                                        priorB =  fourbythree(x,y,labelB);
-                                                }
-
-						if (probability_means(image_l[y*width+x], image_a[y*width+x], image_b[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-						{
-							update(seeds_top_level, labelB, x, y);
-						} 
-						else if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
+						move_pixel(labelB, x, y, moves);
+					}
+					else if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
+					{
+						if (probability_pixel(y*width+x+1, labelB, labelA, priorB, priorA, use_means)) 
 						{
-							if (probability_means(image_l[(y+1)*width+x], image_a[(y+1)*width+x], image_b[(y+1)*width+x], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-							{
-								update(seeds_top_level, labelA, x, y+1);
-								y++;
-							}
+							move_pixel(labelA, x+1, y, moves);
+							x++;
 						}
 					}
 				}
 			}
-	}
-	else
-	{
-		forwardbackward = true;
-		for (int y=1; y<height-1; y++)
-			for (int x=1; x<width-1; x++) 
+			else
 			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a14 = labels[seeds_top_level][(y-1)*width+(x+2)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)]; 
-				int a24 = labels[seeds_top_level][(y)*width+(x+2)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)];
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a34 = labels[seeds_top_level][(y+1)*width+(x+2)];
-
-				// horizontal bidirectional
-				labelA = a22;
-				labelB = a23;
-				if (labelA != labelB)
+				if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
 				{
-					if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
-					{
-                                                if (prior) {
-                                                        priorA = threebyfour(x,y,labelA);
-                                                        priorB = threebyfour(x,y,labelB);
-                                                }
+                                        if (prior) {
+                                                priorA = threebyfour(x,y,labelA);
+                                                priorB = threebyfour(x,y,labelB);
+                                        }
 
-						if (probability_means(image_l[y*width+x+1], image_a[y*width+x+1], image_b[y*width+x+1], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-						{
-							update(seeds_top_level, labelA, x+1, y);
-							x++;
-						}
-						else if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, true, true))
+					if (probability_pixel(y*width+x+1, labelB, labelA, priorB, priorA, use_means)) 
+					{
+						move_pixel(labelA, x+1, y, moves);
+						x++;
+					}
+					else if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, true, true))
+					{
+						if (probability_pixel(y*width+x, labelA, labelB, priorA, priorB, use_means)) 
 						{
-							if (probability_means(image_l[y*width+x], image_a[y*width+x], image_b[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-							{
-								update(seeds_top_level, labelB, x, y);
-							}
+							move_pixel(labelB, x, y, moves);
 						}
 					}
 				}
 			}
+		}
+}
 
-
-		for (int x=1; x<width-1; x++)
-			for (int y=1; y<height-1; y++)
+/**
+ * Vertical sweep over the pixels in [x0,x1) x [y0,y1), checking whether to
+ * move each pixel to its lower neighbour's superpixel or vice versa.
+ * 
+ * @param forward
+ * @param use_means
+ * @param x0
+ * @param x1
+ * @param y0
+ * @param y1
+ * @param moves
+ */
+void SEEDS::sweep_pixels_vertical(bool forward, bool use_means, int x0, int x1, int y0, int y1, vector<PixelMove>* moves)
+{
+	int priorA;
+	int priorB;
+	
+	for (int x=x0; x<x1; x++)
+		for (int y=y0; y<y1; y++)
+		{
+			int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
+			int a12 = labels[seeds_top_level][(y-1)*width+(x)];
+			int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
+			int a21 = labels[seeds_top_level][(y)*width+(x-1)];
+			int a22 = labels[seeds_top_level][(y)*width+(x)]; 
+			int a23 = labels[seeds_top_level][(y)*width+(x+1)];
+			int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
+			int a32 = labels[seeds_top_level][(y+1)*width+(x)]; 
+			int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
+			int a41 = labels[seeds_top_level][(y+2)*width+(x-1)];
+			int a42 = labels[seeds_top_level][(y+2)*width+(x)];
+			int a43 = labels[seeds_top_level][(y+2)*width+(x+1)];
+
+			int labelA = a22;
+			int labelB = a32;
+			if (labelA == labelB)
+			{
+				continue;
+			}
+			
+			if (forward)
 			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)]; 
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a41 = labels[seeds_top_level][(y+2)*width+(x-1)];
-				int a42 = labels[seeds_top_level][(y+2)*width+(x)];
-				int a43 = labels[seeds_top_level][(y+2)*width+(x+1)];
-
-				// vertical bidirectional
-				labelA = a22;
-				labelB = a32;
-				if (labelA != labelB)
+				if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
 				{
-					if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
-					{
-                                                if (prior) {
-                                                        priorA = fourbythree(x,y,labelA);
-                                                        priorB =  fourbythree(x,y,labelB);
-						}
+                                        if (prior) {
+                                                priorA = fourbythree(x,y,labelA);
+                                                priorB = fourbythree(x,y,labelB);
+                                        }
 
-						if (probability_means(image_l[(y+1)*width+x], image_a[(y+1)*width+x], image_b[(y+1)*width+x], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
+					if (probability_pixel(y*width+x, labelA, labelB, priorA, priorB, use_means)) 
+					{
+						move_pixel(labelB, x, y, moves);
+					} 
+					else if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
+					{
+						if (probability_pixel((y+1)*width+x, labelB, labelA, priorB, priorA, use_means)) 
 						{
-							update(seeds_top_level, labelA, x, y+1);
+							move_pixel(labelA, x, y+1, moves);
 							y++;
 						}
-						else if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
+					}
+				}
+			}
+			else
+			{
+				if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
+				{
+					if (prior) {
+                                                priorA = fourbythree(x,y,labelA);
+                                                priorB = fourbythree(x,y,labelB);
+					}
+
+					if (probability_pixel((y+1)*width+x, labelB, labelA, priorB, priorA, use_means)) 
+					{
+						move_pixel(labelA, x, y+1, moves);
+						y++;
+					}
+					else if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
+					{
+						if (probability_pixel(y*width+x, labelA, labelB, priorA, priorB, use_means)) 
 						{
-							if (probability_means(image_l[y*width+x], image_a[y*width+x], image_b[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-							{
-								update(seeds_top_level, labelB, x, y);
-							}
+							move_pixel(labelB, x, y, moves);
 						}
 					}
 				}
 			}
+		}
+}
 
-	}
-
-	// For border pixels we have not to check the entire neighbourhood,
-        // simply check above and below or left and right.
-	for (int x=0; x<width; x++)
+/**
+ * Move the given pixel to label_new at the top level. If moves is given, only
+ * the label is changed and the move is recorded, the histograms and means are
+ * updated later (see sweep_pixels_tiled).
+ * 
+ * @param label_new
+ * @param x
+ * @param y
+ * @param moves
+ */
+void SEEDS::move_pixel(int label_new, int x, int y, vector<PixelMove>* moves)
+{
+	if (moves == NULL)
 	{
-		labelA = labels[seeds_top_level][x];
-		labelB = labels[seeds_top_level][width+x];
-		if (labelA != labelB)
-		{
-				update(seeds_top_level, labelB, x, 0);	
-		}
-		labelA = labels[seeds_top_level][(height-1)*width + x];
-		labelB = labels[seeds_top_level][(height-2)*width + x];
-		if (labelA != labelB)
-		{
-				update(seeds_top_level, labelB, x, height-1);			
-		}
+		update(seeds_top_level, label_new, x, y);
+		return;
 	}
-	for (int y=0; y<height; y++)
+	
+	PixelMove move;
+	move.x = x;
+	move.y = y;
+	move.label_old = labels[seeds_top_level][y*width+x];
+	move.label_new = label_new;
+	moves->push_back(move);
+	
+	labels[seeds_top_level][y*width+x] = label_new;
+}
+
+/**
+ * Whether pixel i should rather belong to label2 than label1, based on the
+ * means or the histograms.
+ * 
+ * @param i
+ * @param label1
+ * @param label2
+ * @param prior1
+ * @param prior2
+ * @param use_means
+ * @return 
+ */
+bool SEEDS::probability_pixel(int i, int label1, int label2, int prior1, int prior2, bool use_means)
+{
+	// The edge terms are not used by either probability.
+	if (use_means)
 	{
-		labelA = labels[seeds_top_level][y*width];
-		labelB = labels[seeds_top_level][y*width+1];
-		if (labelA != labelB)
-		{
-				update(seeds_top_level, labelB, 0, y);	
-		}
-		labelA = labels[seeds_top_level][y*width + width - 1];
-		labelB = labels[seeds_top_level][y*width + width - 2];
-		if (labelA != labelB)
-		{
-				update(seeds_top_level, labelB, width-1, y);			
-		}
+		return probability_means(image_l[i], image_a[i], image_b[i], label1, label2, prior1, prior2, 0, 0);
 	}
+	
+	return probability(image_bins[i], label1, label2, prior1, prior2, 0, 0);
 }
 
 /**
@@ -1597,7 +1654,7 @@ void SEEDS::update(int level, int label_new, int x, int y)
  */
 void SEEDS::add_pixel(int level, int label, int x, int y)
 {
-	histogram[level][label][image_bins[y*width+x]]++;
+	get_histogram(label)[image_bins[y*width+x]]++;
 	T[level][label]++;
 }
 
@@ -1612,7 +1669,7 @@ void SEEDS::add_pixel(int level, int label, int x, int y)
  */
 void SEEDS::add_pixel_m(int level, int label, int x, int y)
 {
-	histogram[level][label][image_bins[y*width+x]]++;
+	get_histogram(label)[image_bins[y*width+x]]++;
 	T[level][label]++;
 
 	if (means) {
@@ -1633,7 +1690,7 @@ void SEEDS::add_pixel_m(int level, int label, int x, int y)
  */
 void SEEDS::delete_pixel(int level, int label, int x, int y)
 {
-	histogram[level][label][image_bins[y*width+x]]--;
+	get_histogram(label)[image_bins[y*width+x]]--;
 	T[level][label]--;
 }
 
@@ -1646,7 +1703,7 @@ void SEEDS::delete_pixel(int level, int label, int x, int y)
  */
 void SEEDS::delete_pixel_m(int level, int label, int x, int y)
 {
-	histogram[level][label][image_bins[y*width+x]]--;
+	get_histogram(label)[image_bins[y*width+x]]--;
 	T[level][label]--;
 	
 	if (means) {
@@ -1669,9 +1726,13 @@ void SEEDS::add_block(int level, int label, int sublevel, int sublabel)
 {
 	parent[sublevel][sublabel] = label;
 
-	for (int n=0; n<histogram_size; n++)
+	if (compact_histograms)
 	{
-		histogram[level][label][n] += histogram[sublevel][sublabel][n];
+		move_block<unsigned short>(level, label, sublevel, sublabel, 1);
+	}
+	else
+	{
+		move_block<int>(level, label, sublevel, sublabel, 1);
 	}
 	T[level][label] += T[sublevel][sublabel];
 
@@ -1691,15 +1752,53 @@ void SEEDS::delete_block(int level, int label, int sublevel, int sublabel)
 {
 	parent[sublevel][sublabel] = -1;
 
-	for (int n=0; n<histogram_size; n++)
+	if (compact_histograms)
 	{
-		histogram[level][label][n] -= histogram[sublevel][sublabel][n];
+		move_block<unsigned short>(level, label, sublevel, sublabel, -1);
+	}
+	else
+	{
+		move_block<int>(level, label, sublevel, sublabel, -1);
 	}
 	T[level][label] -= T[sublevel][sublabel];
 
 	nr_partitions[level][label]--;
 }
 
+/**
+ * Adds (sign = 1) or subtracts (sign = -1) the histogram of the block sublabel at
+ * sublevel to/from the histogram of label at level; level is either the top level
+ * or a block level when building the block histograms in compute_histograms.
+ * 
+ * @param level
+ * @param label
+ * @param sublevel
+ * @param sublabel
+ * @param sign
+ */
+template<typename COUNT>
+void SEEDS::move_block(int level, int label, int sublevel, int sublabel, int sign)
+{
+	// The padding bins are zero, looping over the full stride leaves no remainder.
+	const COUNT* src = get_block_histogram<COUNT>(sublevel, sublabel);
+	if (level == seeds_top_level)
+	{
+		int* dst = get_histogram(label);
+		for (int n=0; n<histogram_stride; n++)
+		{
+			dst[n] += sign*src[n];
+		}
+	}
+	else
+	{
+		COUNT* dst = get_block_histogram<COUNT>(level, label);
+		for (int n=0; n<histogram_stride; n++)
+		{
+			dst[n] += sign*src[n];
+		}
+	}
+}
+
 /**
  * Moving blocks using add_block and delete_block only affects the parent array.
  * In a subsequent step, the labels in the labels array need to be updated.
@@ -1733,16 +1832,16 @@ bool SEEDS::probability(int color, int label1, int label2, int prior1, int prior
 {
         // T saves the number of pixels for each block/superpixel at each level and 
         // can therefore be used for normalization.
-	float P_label1 = (float)histogram[seeds_top_level][label1][color] / (float)T[seeds_top_level][label1];
-	float P_label2 = (float)histogram[seeds_top_level][label2][color] / (float)T[seeds_top_level][label2];
+	float P_label1 = (float)get_histogram(label1)[color] / (float)T[seeds_top_level][label1];
+	float P_label2 = (float)get_histogram(label2)[color] / (float)T[seeds_top_level][label2];
 
 	if (prior) {
 		P_label1 *= (float) prior1;
 		P_label2 *= (float) prior2;
         }
         else {
-		P_label1 = (float)histogram[seeds_top_level][label1][color] / (float)T[seeds_top_level][label1];
-		P_label2 = (float)histogram[seeds_top_level][label2][color] / (float)T[seeds_top_level][label2];
+		P_label1 = (float)get_histogram(label1)[color] / (float)T[seeds_top_level][label1];
+		P_label2 = (float)get_histogram(label2)[color] / (float)T[seeds_top_level][label2];
 	}
 
 	return (P_label2 > P_label1);
@@ -1835,14 +1934,14 @@ int SEEDS::RGB2LAB(const int& r, const int& g, const int& b, float* lval, float*
 	bool YT = (yVal > T);
 	bool ZT = (zVal > T);
 
-	fX = XT * pow(xVal,1.0/3.0) + (!XT) * (7.787 * xVal + 16.0/116.0);
+	fX = XT * ColorConversion::cubeRoot(xVal) + (!XT) * (7.787 * xVal + 16.0/116.0);
 
 	// Compute L
-	float Y3 = pow(yVal,1.0/3.0); 
+	float Y3 = ColorConversion::cubeRoot(yVal); 
 	fY = YT*Y3 + (!YT)*(7.787*yVal + 16.0/116.0);
 	lVal  = YT * (116 * Y3 - 16.0) + (!YT)*(903.3*yVal);
 
-	fZ = ZT*pow(zVal,1.0/3.0) + (!ZT)*(7.787*zVal + 16.0/116.0);
+	fZ = ZT*ColorConversion::cubeRoot(zVal) + (!ZT)*(7.787*zVal + 16.0/116.0);
 
 	// Compute a and b
 	aVal = 500 * (fX - fY);
@@ -1948,14 +2047,14 @@ int SEEDS::RGB2LAB_special(int r, int g, int b, float* lval, float* aval, float*
 	bool YT = (yVal > T);
 	bool ZT = (zVal > T);
 
-	fX = XT * pow(xVal,1.0/3.0) + (!XT) * (7.787 * xVal + 16/116);
+	fX = XT * ColorConversion::cubeRoot(xVal) + (!XT) * (7.787 * xVal + 16/116);
 
 	// Compute L
-	float Y3 = pow(yVal,1.0/3.0); 
+	float Y3 = ColorConversion::cubeRoot(yVal); 
 	fY = YT*Y3 + (!YT)*(7.787*yVal + 16/116);
 	lVal  = YT * (116 * Y3 - 16.0) + (!YT)*(903.3*yVal);
 
-	fZ = ZT*pow(zVal,1.0/3.0) + (!ZT)*(7.787*zVal + 16/116);
+	fZ = ZT*ColorConversion::cubeRoot(zVal) + (!ZT)*(7.787*zVal + 16/116);
 
 	// Compute a and b
 	aVal = 500 * (fX - fY);
@@ -2019,14 +2118,14 @@ int SEEDS::RGB2LAB_special(int r, int g, int b, int* bin_l, int* bin_a, int* bin
 	bool YT = (yVal > T);
 	bool ZT = (zVal > T);
 
-	fX = XT * pow(xVal,1.0/3.0) + (!XT) * (7.787 * xVal + 16/116);
+	fX = XT * ColorConversion::cubeRoot(xVal) + (!XT) * (7.787 * xVal + 16/116);
 
 	// Compute L
-	float Y3 = pow(yVal,1.0/3.0); 
+	float Y3 = ColorConversion::cubeRoot(yVal); 
 	fY = YT*Y3 + (!YT)*(7.787*yVal + 16/116);
 	lVal  = YT * (116 * Y3 - 16.0) + (!YT)*(903.3*yVal);
 
-	fZ = ZT*pow(zVal,1.0/3.0) + (!ZT)*(7.787*zVal + 16/116);
+	fZ = ZT*ColorConversion::cubeRoot(zVal) + (!ZT)*(7.787*zVal + 16/116);
 
 	// Compute a and b
 	aVal = 500 * (fX - fY);
@@ -2150,27 +2249,160 @@ float SEEDS::geometric_distance(int label1, int label2)
 }
 
 /**
- * Compute the intersection distance between the histograms of label1 and label2
- * at level1 and level2.
+ * Compute the intersection distance between the histograms of the superpixel
+ * label at the top level and the block sublabel at sublevel.
  * 
- * @param level1
- * @param label1
- * @param level2
- * @param label2
+ * @param level
+ * @param label
+ * @param sublevel
+ * @param sublabel
  * @return 
  */
-float SEEDS::intersection(int level1, int label1, int level2, int label2)
+float SEEDS::intersection(int level, int label, int sublevel, int sublabel)
+{
+	if (compact_histograms)
+	{
+		return block_intersection<unsigned short>(level, label, sublevel, sublabel);
+	}
+	
+	return block_intersection<int>(level, label, sublevel, sublabel);
+}
+
+/**
+ * Intersection with the block histograms stored as COUNT, see intersection.
+ * The counts are only normalized here.
+ * 
+ * @param level
+ * @param label
+ * @param sublevel
+ * @param sublabel
+ * @return 
+ */
+template<typename COUNT>
+float SEEDS::block_intersection(int level, int label, int sublevel, int sublabel)
 {
     float intersect = 0.0;
 	
+	const int* histogram1 = get_histogram(label);
+	const COUNT* histogram2 = get_block_histogram<COUNT>(sublevel, sublabel);
 	for (int n=0; n<histogram_size; n++)
 	{
-		intersect += min((float)histogram[level1][label1][n]/T[level1][label1], (float)histogram[level2][label2][n]/T[level2][label2]);
+		intersect += min((float)histogram1[n]/T[level][label], (float)histogram2[n]/T[sublevel][sublabel]);
 	}
 
 	return intersect;
 }
 
+/**
+ * Checks whether the intersection of the given block with label1 exceeds its
+ * intersection with label2 by more than threshold, i.e. whether the block
+ * should be moved to label1.
+ * 
+ * Both intersections are computed in a single pass over the bins using 16
+ * independent partial sums (which the compiler vectorizes). As each
+ * intersection grows by at most the remaining mass of the block, the pass
+ * stops as soon as the remaining bins cannot change the decision anymore.
+ * Near ties fall back to intersection() to keep the decisions unchanged.
+ * 
+ * @param level
+ * @param label1
+ * @param label2
+ * @param sublevel
+ * @param sublabel
+ * @param threshold
+ * @return 
+ */
+bool SEEDS::intersection_exceeds(int level, int label1, int label2, int sublevel, int sublabel, float threshold)
+{
+	if (compact_histograms)
+	{
+		return block_intersection_exceeds<unsigned short>(level, label1, label2, sublevel, sublabel, threshold);
+	}
+	
+	return block_intersection_exceeds<int>(level, label1, label2, sublevel, sublabel, threshold);
+}
+
+/**
+ * See intersection_exceeds, with the block histograms stored as COUNT.
+ * 
+ * @param level
+ * @param label1
+ * @param label2
+ * @param sublevel
+ * @param sublabel
+ * @param threshold
+ * @return 
+ */
+template<typename COUNT>
+bool SEEDS::block_intersection_exceeds(int level, int label1, int label2, int sublevel, int sublabel, float threshold)
+{
+	const int LANES = 16;
+	// Margin for early decisions, larger than the rounding error of the sums.
+	const float MARGIN = 1e-4;
+	
+	const int* histogram1 = get_histogram(label1);
+	const int* histogram2 = get_histogram(label2);
+	const COUNT* subhistogram = get_block_histogram<COUNT>(sublevel, sublabel);
+	const float T1 = T[level][label1];
+	const float T2 = T[level][label2];
+	const float Tsub = T[sublevel][sublabel];
+	
+	float acc1[LANES] = {0};
+	float acc2[LANES] = {0};
+	int remaining = T[sublevel][sublabel];
+	
+	for (int n=0; n<histogram_stride; n += LANES)
+	{
+		int mass = 0;
+		for (int j=0; j<LANES; j++)
+		{
+			float sub = (float)subhistogram[n + j]/Tsub;
+			acc1[j] += min((float)histogram1[n + j]/T1, sub);
+			acc2[j] += min((float)histogram2[n + j]/T2, sub);
+			mass += subhistogram[n + j];
+		}
+		remaining -= mass;
+		
+		// Check every fourth block, summing up the lanes is not free.
+		if ((n/LANES) % 4 == 3 && n + LANES < histogram_stride)
+		{
+			float difference = 0;
+			for (int j=0; j<LANES; j++)
+			{
+				difference += acc1[j] - acc2[j];
+			}
+			
+			float bound = remaining/Tsub;
+			if (difference - bound > max(threshold, 0.0f) + MARGIN)
+			{
+				return true;
+			}
+			if (difference + bound < max(threshold, 0.0f) - MARGIN)
+			{
+				return false;
+			}
+		}
+	}
+	
+	float int1 = 0;
+	float int2 = 0;
+	for (int j=0; j<LANES; j++)
+	{
+		int1 += acc1[j];
+		int2 += acc2[j];
+	}
+	
+	// Near ties depend on the order of summation, so decide on the
+	// intersections as computed by intersection().
+	if (fabs(int1 - int2 - max(threshold, 0.0f)) <= MARGIN)
+	{
+		int1 = block_intersection<COUNT>(level, label1, sublevel, sublabel);
+		int2 = block_intersection<COUNT>(level, label2, sublevel, sublabel);
+	}
+	
+	return (int1 > int2) && (fabs(int1 - int2) > threshold);
+}
+
 /**
  * Check whether moving a given block or pixel would result in a superpixel beign splittet. 
  * 
@@ -16,6 +16,8 @@
 #define _SEEDS_H_INCLUDED_
 
 #include <string>
+#include <vector>
+#include <chrono>
 #include <opencv2/opencv.hpp>
 
 using namespace std;
@@ -29,12 +31,17 @@ public:
 	SEEDS(int width, int height, int nr_channels, int nr_bins, int min_size, float confidence, bool prior, bool means, int color);
 	~SEEDS();
 
-	// initialize with an image
+	// initialize with an image; can be called again for further images of
+	// the same size, reusing all buffers if the block layout is unchanged
 	void initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels);
 	void initialize(const cv::Mat &image, int seeds_w, int seeds_h, int nr_levels);
         
-	// go through iterations
+	// go through iterations, optionally within a time budget in milliseconds
 	void iterate(int iterations);
+	void iterate(int iterations, double time_budget);
+	
+	// number of threads for the pixel updates
+	void set_threads(int threads);
 
 	// output labels
 	UINT** labels;	 
@@ -73,15 +80,27 @@ private:
 
 	// keep one labeling for each level
 	UINT* nr_labels;
+	// first label of each level when all labels of all levels are stored
+	// contiguously, used to index parent, nr_partitions, T and the block histograms
+	UINT* label_offset;
 	UINT** parent;
 	UINT** nr_partitions;
 	int** T;
+	// single allocations behind the level pointers above
+	UINT* parent_data;
+	UINT* nr_partitions_data;
+	int* T_data;
 	int go_down_one_level();
 
 	// initialization
+	void setup(int seeds_w, int seeds_h, int nr_levels);
+	void release();
 	void assign_labels();
 	void compute_histograms(int until_level = -1);
 	void compute_histograms_ex();
+	template<typename COUNT>
+	void compute_block_histograms(int until_level, bool explicitly);
+	void clear_histograms();
 	void compute_means();
 	void compute_edges();
 	void lab_get_histogram_cutoff_values(UINT* image);
@@ -97,11 +116,51 @@ private:
 	int RGB2LAB_special(int r, int g, int b, float* lval, float* aval, float* bval);
 	int RGB2LAB_special(int r, int g, int b, int* bin_l, int* bin_a, int* bin_b);
 	void LAB2RGB(float L, float a, float b, int* R, int* G, int* B);
+	bool convert_pixel(int i, int r, int g, int b);
+
+	// direct mapped cache of bins and color channels by RGB color, see convert_pixel
+	struct ColorCacheEntry
+	{
+		ColorCacheEntry() : key(0xFFFFFFFF) {}
+		UINT key;
+		UINT bin;
+		float l;
+		float a;
+		float b;
+	};
+	
+	static const int COLOR_CACHE_BITS = 16;
+	static const int COLOR_CACHE_SIZE = 1 << COLOR_CACHE_BITS;
+	vector<ColorCacheEntry> color_cache;
 
 	int histogram_size;
-	int*** histogram;
+	// histogram_size rounded up to a multiple of 64 bytes
+	int histogram_stride;
+	// histograms of the superpixels, i.e. of the labels at the top level, as
+	// a single 64-byte aligned slab laid out as [label][bin]
+	int* histogram;
+	int* histogram_buffer;
+	// histograms of the blocks at all levels below the top level, laid out as
+	// [level][label][bin]; these do not change after compute_histograms and
+	// are bounded by the block sizes, so they are stored as 16-bit counts
+	// unless a block has more than 65535 pixels, see compute_histograms
+	void* block_histogram;
+	char* block_histogram_buffer;
+	bool compact_histograms;
 	//int** subhistogram;
 	
+	inline int* get_histogram(int label)
+	{
+		return histogram + (size_t) label*histogram_stride;
+	}
+	
+	// COUNT is unsigned short if compact_histograms is set and int otherwise
+	template<typename COUNT>
+	inline COUNT* get_block_histogram(int level, int label)
+	{
+		return (COUNT*) block_histogram + (size_t) (label_offset[level] + label)*histogram_stride;
+	}
+	
 
     void update(int level, int label_new, int x, int y);
 	void add_pixel(int level, int label, int x, int y);
@@ -110,6 +169,8 @@ private:
 	void delete_pixel_m(int level, int label, int x, int y);
 	void add_block(int level, int label, int sublevel, int sublabel);
 	void delete_block(int level, int label, int sublevel, int sublabel);
+	template<typename COUNT>
+	void move_block(int level, int label, int sublevel, int sublabel, int sign);
 	void update_labels(int level);
 
 
@@ -125,13 +186,33 @@ private:
 	// block updating
 	void update_blocks(int level, float req_confidence = 0.0);
 	float merge_threshold;
-	float intersection(int level1, int label1, int level2, int label2);
+	float intersection(int level, int label, int sublevel, int sublabel);
+	template<typename COUNT>
+	float block_intersection(int level, int label, int sublevel, int sublabel);
+	bool intersection_exceeds(int level, int label1, int label2, int sublevel, int sublabel, float threshold);
+	template<typename COUNT>
+	bool block_intersection_exceeds(int level, int label1, int label2, int sublevel, int sublabel, float threshold);
 	float geometric_distance(int label1, int label2);
 	int min_size;
 
 	// border updating
+	struct PixelMove
+	{
+		int x;
+		int y;
+		UINT label_old;
+		UINT label_new;
+	};
+	
 	void update_pixels();
 	void update_pixels_means();
+	void sweep_pixels(bool use_means);
+	void sweep_pixels_tiled(bool horizontal, bool forward, bool use_means);
+	void sweep_pixels_horizontal(bool forward, bool use_means, int x0, int x1, int y0, int y1, vector<PixelMove>* moves);
+	void sweep_pixels_vertical(bool forward, bool use_means, int x0, int x1, int y0, int y1, vector<PixelMove>* moves);
+	void move_pixel(int label_new, int x, int y, vector<PixelMove>* moves);
+	bool probability_pixel(int i, int label1, int label2, int prior1, int prior2, bool use_means);
+	int threads;
 	bool forwardbackward;
 	int threebythree_upperbound;
 	int threebythree_lowerbound;
@@ -164,6 +245,12 @@ private:
         
 	int iteration;
 	int step;
+	
+	// time budgeted iterations
+	bool has_deadline;
+	std::chrono::steady_clock::time_point deadline;
+	bool deadline_passed();
+	void run_iterations(int iterations);
 };
 
 
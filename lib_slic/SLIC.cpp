@@ -9,7 +9,11 @@
 #include <iostream>
 #include <fstream>
 #include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include "SLIC.h"
+#include "color_conversion.h"
 
 
 //////////////////////////////////////////////////////////////////////
@@ -18,9 +22,19 @@
 
 SLIC::SLIC()
 {
+	m_threads = 1;
+	m_displacement = 0;
+	m_changed = 0;
+	m_preemption = 0;
+	m_gpu = false;
+	m_fixedpoint = false;
+	m_half = false;
+	m_iterations = 0;
+
 	m_lvec = NULL;
 	m_avec = NULL;
 	m_bvec = NULL;
+	m_ownsplanes = true;
 
     m_xvec = NULL;
     m_yvec = NULL;
@@ -33,9 +47,7 @@ SLIC::SLIC()
 
 SLIC::~SLIC()
 {
-	if(m_lvec) delete [] m_lvec;
-	if(m_avec) delete [] m_avec;
-	if(m_bvec) delete [] m_bvec;
+	ReleasePlanes();
 
     if(m_xvec) delete [] m_xvec;
 	if(m_yvec) delete [] m_yvec;
@@ -71,18 +83,11 @@ void SLIC::RGB2XYZ(
 	float&			Y,
 	float&			Z)
 {
-	float R = sR/255.0;
-	float G = sG/255.0;
-	float B = sB/255.0;
-
-	float r, g, b;
-
-	if(R <= 0.04045)	r = R/12.92;
-	else				r = pow((R+0.055)/1.055,2.4);
-	if(G <= 0.04045)	g = G/12.92;
-	else				g = pow((G+0.055)/1.055,2.4);
-	if(B <= 0.04045)	b = B/12.92;
-	else				b = pow((B+0.055)/1.055,2.4);
+	// Inverse gamma is looked up, see ColorConversion.
+	const float* linear = ColorConversion::getLinearRGBTable<float>();
+	float r = linear[sR];
+	float g = linear[sG];
+	float b = linear[sB];
 
 	X = r*0.4124564 + g*0.3575761 + b*0.1804375;
 	Y = r*0.2126729 + g*0.7151522 + b*0.0721750;
@@ -103,9 +108,6 @@ void SLIC::RGB2LAB(const int& sR, const int& sG, const int& sB, float& lval, flo
 	//------------------------
 	// XYZ to LAB conversion
 	//------------------------
-	float epsilon = 0.008856;	//actual CIE standard
-	float kappa   = 903.3;		//actual CIE standard
-
 	float Xr = 0.950456;	//reference white
 	float Yr = 1.0;		//reference white
 	float Zr = 1.088754;	//reference white
@@ -114,13 +116,10 @@ void SLIC::RGB2LAB(const int& sR, const int& sG, const int& sB, float& lval, flo
 	float yr = Y/Yr;
 	float zr = Z/Zr;
 
-	float fx, fy, fz;
-	if(xr > epsilon)	fx = pow(xr, 1.0/3.0);
-	else				fx = (kappa*xr + 16.0)/116.0;
-	if(yr > epsilon)	fy = pow(yr, 1.0/3.0);
-	else				fy = (kappa*yr + 16.0)/116.0;
-	if(zr > epsilon)	fz = pow(zr, 1.0/3.0);
-	else				fz = (kappa*zr + 16.0)/116.0;
+	// CIE transfer with epsilon = 0.008856 and kappa = 903.3.
+	float fx = ColorConversion::labTransfer<float>(xr);
+	float fy = ColorConversion::labTransfer<float>(yr);
+	float fz = ColorConversion::labTransfer<float>(zr);
 
 	lval = 116.0*fy-16.0;
 	aval = 500.0*(fx-fy);
@@ -143,14 +142,7 @@ void SLIC::DoRGBtoLABConversion(
 	avec = new float[sz];
 	bvec = new float[sz];
 
-	for( int j = 0; j < sz; j++ )
-	{
-		int r = (ubuff[j] >> 16) & 0xFF;
-		int g = (ubuff[j] >>  8) & 0xFF;
-		int b = (ubuff[j]      ) & 0xFF;
-
-		RGB2LAB( r, g, b, lvec[j], avec[j], bvec[j] );
-	}
+	ColorConversion::convertRGBToLAB(ubuff, sz, lvec, avec, bvec);
 }
 
 //===========================================================================
@@ -167,14 +159,7 @@ void SLIC::DoRGBtoLABConversion(
 	int sz = m_width*m_height;
 	for( int d = 0; d < m_depth; d++ )
 	{
-		for( int j = 0; j < sz; j++ )
-		{
-			int r = (ubuff[d][j] >> 16) & 0xFF;
-			int g = (ubuff[d][j] >>  8) & 0xFF;
-			int b = (ubuff[d][j]      ) & 0xFF;
-
-			RGB2LAB( r, g, b, lvec[d][j], avec[d][j], bvec[d][j] );
-		}
+		ColorConversion::convertRGBToLAB(ubuff[d], sz, lvec[d], avec[d], bvec[d]);
 	}
 }
 
@@ -785,11 +770,400 @@ void SLIC::GetKValues_LABXYZ(
 	}
 }
 
+//===========================================================================
+///	AppendKValues_LABXYZ
+///
+/// Used by DoStreamingSupervoxelSegmentation for the frames entering the
+/// window. The grid has at least one strip per dimension and the strips
+/// are at most 1.5*STEP wide, so every voxel is within STEP of a seed.
+//===========================================================================
+void SLIC::AppendKValues_LABXYZ(
+	vector<float>&				kseedsl,
+	vector<float>&				kseedsa,
+	vector<float>&				kseedsb,
+	vector<float>&				kseedsx,
+	vector<float>&				kseedsy,
+	vector<float>&				kseedsz,
+	const int&					STEP,
+	const int					zbegin,
+	const int					zend)
+{
+	const int xstrips = max(1, int(0.5+float(m_width)/float(STEP)));
+	const int ystrips = max(1, int(0.5+float(m_height)/float(STEP)));
+	const int zstrips = max(1, int(0.5+float(zend - zbegin)/float(STEP)));
+
+	for( int z = 0; z < zstrips; z++ )
+	{
+		const int d = zbegin + int((z + 0.5f)*(zend - zbegin)/zstrips);
+		for( int y = 0; y < ystrips; y++ )
+		{
+			const int sy = int((y + 0.5f)*m_height/ystrips);
+			for( int x = 0; x < xstrips; x++ )
+			{
+				const int sx = int((x + 0.5f)*m_width/xstrips);
+				const int i = sy*m_width + sx;
+
+				kseedsl.push_back(m_lvecvec[d][i]);
+				kseedsa.push_back(m_avecvec[d][i]);
+				kseedsb.push_back(m_bvecvec[d][i]);
+				kseedsx.push_back(sx);
+				kseedsy.push_back(sy);
+				kseedsz.push_back(d);
+			}
+		}
+	}
+}
+
+//===========================================================================
+///	SetThreads
+//===========================================================================
+void SLIC::SetThreads(const int threads)
+{
+	m_threads = max(1, threads);
+}
+
+//===========================================================================
+///	SetConvergence
+//===========================================================================
+void SLIC::SetConvergence(const float displacement, const float changed)
+{
+	m_displacement = max(0.0f, displacement);
+	m_changed = max(0.0f, changed);
+}
+
+//===========================================================================
+///	SetPreemption
+//===========================================================================
+void SLIC::SetPreemption(const float threshold)
+{
+	m_preemption = max(0.0f, threshold);
+}
+
+//===========================================================================
+///	SetDevice
+//===========================================================================
+void SLIC::SetDevice(const bool gpu)
+{
+	m_gpu = gpu;
+}
+
+//===========================================================================
+///	GetIterations
+//===========================================================================
+int SLIC::GetIterations() const
+{
+	return m_iterations;
+}
+
+//===========================================================================
+///	AssignSuperpixelSLIC
+///
+/// Seeds are visited in tiles of 4x4 grid cells such that the rows of
+/// distvec and klabels touched by neighboring seeds stay in cache; ties are
+/// resolved towards the smaller seed index, so the labels are the same as
+/// when visiting the seeds in order. The distances of a window row are
+/// computed in a branch-free loop over the LAB planes that the compiler can
+/// vectorize.
+///
+/// The tiles are colored by the parity of their row and column. The 2*STEP
+/// windows of seeds in different tiles of the same color never overlap, so
+/// the tiles of one color are distributed over m_threads threads, one color
+/// after the other. As ties do not depend on the visiting order, the labels
+/// are the same for any number of threads.
+///
+/// If active is not empty, only the seeds with active[n] != 0 are visited.
+//===========================================================================
+void SLIC::AssignSuperpixelSLIC(
+	const vector<float>&		kseedsl,
+	const vector<float>&		kseedsa,
+	const vector<float>&		kseedsb,
+	const vector<float>&		kseedsx,
+	const vector<float>&		kseedsy,
+	int*&						klabels,
+	vector<float>&				distvec,
+	const int&					STEP,
+	const float&				invwt,
+	const vector<char>&			active)
+{
+	const int numk = kseedsl.size();
+	const int offset = STEP;
+	const float tile = 4*STEP;
+
+	int tiles_per_row = m_width/tile + 1;
+	int tiles_per_column = m_height/tile + 1;
+	vector< vector<int> > tiles(tiles_per_row*tiles_per_column);
+	for( int n = 0; n < numk; n++ )
+	{
+		if( !active.empty() && !active[n] ) continue;
+
+		const int tx = min(tiles_per_row - 1, int(max(0.0f, kseedsx[n])/tile));
+		const int ty = min(tiles_per_column - 1, int(max(0.0f, kseedsy[n])/tile));
+		tiles[ty*tiles_per_row + tx].push_back(n);
+	}
+
+	float* dist_ptr = distvec.data();
+	int* label_ptr = klabels;
+	const int sz = m_width*m_height;
+	const uint16_t* lhalf = m_half ? m_halfplanes.data() : NULL;
+	const uint16_t* ahalf = m_half ? m_halfplanes.data() + sz : NULL;
+	const uint16_t* bhalf = m_half ? m_halfplanes.data() + 2*sz : NULL;
+	auto assign = [&](const int n)
+	{
+		const int y1 = max(0.0f,			kseedsy[n]-offset);
+		const int y2 = min((float)m_height,	kseedsy[n]+offset);
+		const int x1 = max(0.0f,			kseedsx[n]-offset);
+		const int x2 = min((float)m_width,	kseedsx[n]+offset);
+
+		const float sl = kseedsl[n];
+		const float sa = kseedsa[n];
+		const float sb = kseedsb[n];
+		const float sx = kseedsx[n];
+		const float sy = kseedsy[n];
+
+		// Pixels x0 to x0 + count - 1 of a row, the pointers start at x0.
+		auto assignRow = [&](const float* lrow, const float* arow, const float* brow,
+			float* drow, int* krow, const int x0, const int count, const float dy2)
+		{
+			for( int i = 0; i < count; i++ )
+			{
+				const float dl = lrow[i] - sl;
+				const float da = arow[i] - sa;
+				const float db = brow[i] - sb;
+				const float dx = x0 + i - sx;
+
+				float dist = dl*dl + da*da + db*db;
+				const float distxy = dx*dx + dy2;
+				dist += distxy*invwt;
+
+				const bool closer = dist < drow[i] || (dist == drow[i] && n < krow[i]);
+				drow[i] = closer ? dist : drow[i];
+				krow[i] = closer ? n : krow[i];
+			}
+		};
+
+		for( int y = y1; y < y2; y++ )
+		{
+			const int row = y*m_width;
+			const float dy = y - sy;
+			const float dy2 = dy*dy;
+
+			if( !m_half )
+			{
+				assignRow(m_lvec + row + x1, m_avec + row + x1, m_bvec + row + x1,
+					dist_ptr + row + x1, label_ptr + row + x1, x1, x2 - x1, dy2);
+				continue;
+			}
+
+			// Half precision planes are converted in chunks small enough
+			// to stay in L1.
+			const int chunk = 64;
+			float l[chunk];
+			float a[chunk];
+			float b[chunk];
+			for( int x0 = x1; x0 < x2; x0 += chunk )
+			{
+				const int count = min(chunk, x2 - x0);
+				ConvertHalfToFloat(lhalf + row + x0, l, count);
+				ConvertHalfToFloat(ahalf + row + x0, a, count);
+				ConvertHalfToFloat(bhalf + row + x0, b, count);
+				assignRow(l, a, b, dist_ptr + row + x0, label_ptr + row + x0, x0, count, dy2);
+			}
+		}
+	};
+
+	if( m_threads <= 1 )
+	{
+		for( int t = 0; t < (int) tiles.size(); t++ )
+		{
+			for( int k = 0; k < (int) tiles[t].size(); k++ )
+			{
+				assign(tiles[t][k]);
+			}
+		}
+		return;
+	}
+
+	for( int color = 0; color < 4; color++ )
+	{
+		vector<int> colored;
+		for( int ty = color/2; ty < tiles_per_column; ty += 2 )
+		{
+			for( int tx = color%2; tx < tiles_per_row; tx += 2 )
+			{
+				if( !tiles[ty*tiles_per_row + tx].empty() )
+				{
+					colored.push_back(ty*tiles_per_row + tx);
+				}
+			}
+		}
+
+		std::atomic<int> next(0);
+		auto worker = [&]()
+		{
+			for( int t = next++; t < (int) colored.size(); t = next++ )
+			{
+				const vector<int>& seeds = tiles[colored[t]];
+				for( int k = 0; k < (int) seeds.size(); k++ )
+				{
+					assign(seeds[k]);
+				}
+			}
+		};
+
+		const int n_threads = min(m_threads, (int) colored.size());
+		vector<std::thread> threads;
+		for( int i = 1; i < n_threads; i++ )
+		{
+			threads.push_back(std::thread(worker));
+		}
+		worker();
+		for( int i = 0; i < (int) threads.size(); i++ )
+		{
+			threads[i].join();
+		}
+	}
+}
+
+//===========================================================================
+///	AccumulateSuperpixelSLIC
+///
+/// With more than one thread, the pixels are first sorted by label (keeping
+/// the raster order within each superpixel) and the superpixels are then
+/// distributed over the threads. Each sum is accumulated over the same pixels
+/// in the same order as in the sequential loop, so the centroids are the
+/// same for any number of threads.
+//===========================================================================
+void SLIC::AccumulateSuperpixelSLIC(
+	const int*					klabels,
+	vector<float>&				sigmal,
+	vector<float>&				sigmaa,
+	vector<float>&				sigmab,
+	vector<float>&				sigmax,
+	vector<float>&				sigmay,
+	vector<float>&				clustersize)
+{
+	const int sz = m_width*m_height;
+	const int numk = clustersize.size();
+
+	// With half precision planes, rows are converted to float first.
+	vector<float> lrow(m_half ? m_width : 0);
+	vector<float> arow(m_half ? m_width : 0);
+	vector<float> brow(m_half ? m_width : 0);
+
+	if( m_threads <= 1 )
+	{
+		int ind(0);
+		for( int r = 0; r < m_height; r++ )
+		{
+			const float* lvec = m_lvec + m_width*r;
+			const float* avec = m_avec + m_width*r;
+			const float* bvec = m_bvec + m_width*r;
+			if( m_half )
+			{
+				ConvertHalfToFloat(m_halfplanes.data() + m_width*r, lrow.data(), m_width);
+				ConvertHalfToFloat(m_halfplanes.data() + sz + m_width*r, arow.data(), m_width);
+				ConvertHalfToFloat(m_halfplanes.data() + 2*sz + m_width*r, brow.data(), m_width);
+				lvec = lrow.data();
+				avec = arow.data();
+				bvec = brow.data();
+			}
+
+			for( int c = 0; c < m_width; c++ )
+			{
+				sigmal[klabels[ind]] += lvec[c];
+				sigmaa[klabels[ind]] += avec[c];
+				sigmab[klabels[ind]] += bvec[c];
+				sigmax[klabels[ind]] += c;
+				sigmay[klabels[ind]] += r;
+				//------------------------------------
+				//edgesum[klabels[ind]] += edgemag[ind];
+				//------------------------------------
+				clustersize[klabels[ind]] += 1.0;
+				ind++;
+			}
+		}
+		return;
+	}
+
+	vector<int> first(numk + 1, 0);
+	for( int i = 0; i < sz; i++ )
+	{
+		if( klabels[i] >= 0 && klabels[i] < numk ) first[klabels[i] + 1]++;
+	}
+	for( int k = 0; k < numk; k++ )
+	{
+		first[k + 1] += first[k];
+	}
+
+	vector<int> pixels(first[numk]);
+	vector<int> fill(first.begin(), first.end() - 1);
+	for( int i = 0; i < sz; i++ )
+	{
+		if( klabels[i] >= 0 && klabels[i] < numk ) pixels[fill[klabels[i]]++] = i;
+	}
+
+	std::atomic<int> next(0);
+	auto worker = [&]()
+	{
+		for( int k = next++; k < numk; k = next++ )
+		{
+			for( int p = first[k]; p < first[k + 1]; p++ )
+			{
+				const int i = pixels[p];
+				const int r = i/m_width;
+				const int c = i - r*m_width;
+
+				if( m_half )
+				{
+					sigmal[k] += ConvertHalfToFloat(m_halfplanes[i]);
+					sigmaa[k] += ConvertHalfToFloat(m_halfplanes[sz + i]);
+					sigmab[k] += ConvertHalfToFloat(m_halfplanes[2*sz + i]);
+				}
+				else
+				{
+					sigmal[k] += m_lvec[i];
+					sigmaa[k] += m_avec[i];
+					sigmab[k] += m_bvec[i];
+				}
+				sigmax[k] += c;
+				sigmay[k] += r;
+				clustersize[k] += 1.0;
+			}
+		}
+	};
+
+	const int n_threads = min(m_threads, numk);
+	vector<std::thread> threads;
+	for( int i = 1; i < n_threads; i++ )
+	{
+		threads.push_back(std::thread(worker));
+	}
+	worker();
+	for( int i = 0; i < (int) threads.size(); i++ )
+	{
+		threads[i].join();
+	}
+}
+
 //===========================================================================
 ///	PerformSuperpixelSLIC
 ///
 ///	Performs k mean segmentation. It is fast because it looks locally, not
 /// over the entire image.
+///
+/// With SetConvergence, the iterations stop early once the seeds move less
+/// than the given mean displacement and few labels change; GetIterations returns
+/// the number of iterations run.
+///
+/// With SetPreemption, the distances are kept across iterations and only
+/// seeds with enough label changes within their 2*STEP window are assigned
+/// again, as in PreemptiveSLIC::PerformSuperpixelSLIC_preemptive. The changes
+/// are counted using an integral image such that seeds need not lie on a
+/// grid.
+///
+/// With SetHalfPrecision, the planes are converted to m_halfplanes once and
+/// the assignment and update steps read those instead of m_lvec, m_avec and
+/// m_bvec.
 //===========================================================================
 void SLIC::PerformSuperpixelSLIC(
 	vector<float>&				kseedsl,
@@ -821,50 +1195,35 @@ void SLIC::PerformSuperpixelSLIC(
 	vector<float> distvec(sz, DBL_MAX);
         
 	float invwt = 1.0/((STEP/M)*(STEP/M));
-        
-	int x1, y1, x2, y2;
-	float l, a, b;
-	float dist;
-	float distxy;
-	for( int itr = 0; itr < iterations; itr++ )
-	{
-		distvec.assign(sz, DBL_MAX);
-		for( int n = 0; n < numk; n++ )
-		{
-                        y1 = max(0.0f,			kseedsy[n]-offset);
-                        y2 = min((float)m_height,	kseedsy[n]+offset);
-                        x1 = max(0.0f,			kseedsx[n]-offset);
-                        x2 = min((float)m_width,	kseedsx[n]+offset);
 
+	// For the convergence check and the active seeds, the labels of the
+	// previous iteration are compared to the new ones.
+	const bool converge = (m_displacement > 0);
+	const bool preemptive = (m_preemption > 0);
+	vector<int> previous(0);
+	if( converge || preemptive ) previous.assign(klabels, klabels + sz);
 
-			for( int y = y1; y < y2; y++ )
-			{
-				for( int x = x1; x < x2; x++ )
-				{
-					int i = y*m_width + x;
-
-					l = m_lvec[i];
-					a = m_avec[i];
-					b = m_bvec[i];
+	vector<char> active(0);
+	vector<int> integral(0);
+	if( preemptive )
+	{
+		active.assign(numk, 1);
+		integral.assign((m_width + 1)*(m_height + 1), 0);
+	}
+	const float minchanges = m_preemption*4*STEP*STEP;
 
-					dist =			(l - kseedsl[n])*(l - kseedsl[n]) +
-								(a - kseedsa[n])*(a - kseedsa[n]) +
-								(b - kseedsb[n])*(b - kseedsb[n]);
+	if( m_half ) ConvertPlanesToHalf();
 
-					distxy =		(x - kseedsx[n])*(x - kseedsx[n]) +
-								(y - kseedsy[n])*(y - kseedsy[n]);
-					
-					//------------------------------------------------------------------------
-					dist += distxy*invwt;//dist = sqrt(dist) + sqrt(distxy*invwt);//this is more exact
-					//------------------------------------------------------------------------
-					if( dist < distvec[i] )
-					{
-						distvec[i] = dist;
-						klabels[i]  = n;
-					}
-				}
-			}
-		}
+	m_iterations = 0;
+	for( int itr = 0; itr < iterations; itr++ )
+	{
+		if( !preemptive ) distvec.assign(sz, DBL_MAX);
+		m_iterations++;
+		//------------------------------------------------------------------------
+		// dist = dist_lab + distxy*invwt;//dist = sqrt(dist) + sqrt(distxy*invwt);//this is more exact
+		//------------------------------------------------------------------------
+		AssignSuperpixelSLIC(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy,
+			klabels, distvec, offset, invwt, active);
 		//-----------------------------------------------------------------
 		// Recalculate the centroid and store in the seed values
 		//-----------------------------------------------------------------
@@ -880,23 +1239,8 @@ void SLIC::PerformSuperpixelSLIC(
 		//edgesum.assign(numk, 0);
 		//------------------------------------
 
-		{int ind(0);
-		for( int r = 0; r < m_height; r++ )
-		{
-			for( int c = 0; c < m_width; c++ )
-			{
-				sigmal[klabels[ind]] += m_lvec[c + m_width*r];
-				sigmaa[klabels[ind]] += m_avec[c + m_width*r];
-				sigmab[klabels[ind]] += m_bvec[c + m_width*r];
-				sigmax[klabels[ind]] += c;
-				sigmay[klabels[ind]] += r;
-				//------------------------------------
-				//edgesum[klabels[ind]] += edgemag[ind];
-				//------------------------------------
-				clustersize[klabels[ind]] += 1.0;
-				ind++;
-			}
-		}}
+		AccumulateSuperpixelSLIC(klabels, sigmal, sigmaa, sigmab, sigmax, sigmay,
+			clustersize);
 
 		{for( int k = 0; k < numk; k++ )
 		{
@@ -904,6 +1248,18 @@ void SLIC::PerformSuperpixelSLIC(
 			inv[k] = 1.0/clustersize[k];//computing inverse now to multiply, than divide later
 		}}
 		
+		float displacement = 0;
+		if( converge )
+		{
+			for( int k = 0; k < numk; k++ )
+			{
+				const float dx = sigmax[k]*inv[k] - kseedsx[k];
+				const float dy = sigmay[k]*inv[k] - kseedsy[k];
+				displacement += sqrt(dx*dx + dy*dy);
+			}
+			displacement /= numk;
+		}
+
 		{for( int k = 0; k < numk; k++ )
 		{
 			kseedsl[k] = sigmal[k]*inv[k];
@@ -915,6 +1271,48 @@ void SLIC::PerformSuperpixelSLIC(
 			//edgesum[k] *= inv[k];
 			//------------------------------------
 		}}
+
+		//-----------------------------------------------------------------
+		// Stop once seeds and labels do not change anymore
+		//-----------------------------------------------------------------
+		if( converge || preemptive )
+		{
+			int changed = 0;
+			for( int y = 0; y < m_height; y++ )
+			{
+				int row = 0;
+				for( int x = 0; x < m_width; x++ )
+				{
+					const int i = y*m_width + x;
+					row += (klabels[i] != previous[i]);
+					previous[i] = klabels[i];
+
+					if( preemptive ) integral[(y + 1)*(m_width + 1) + x + 1] = integral[y*(m_width + 1) + x + 1] + row;
+				}
+				changed += row;
+			}
+
+			if( converge && itr > 0 && displacement <= m_displacement && changed <= m_changed*sz ) break;
+			if( preemptive && changed < m_preemption*sz ) break;
+		}
+
+		//-----------------------------------------------------------------
+		// Deactivate seeds with few label changes in their window
+		//-----------------------------------------------------------------
+		if( preemptive )
+		{
+			for( int k = 0; k < numk; k++ )
+			{
+				const int y1 = max(0.0f,			kseedsy[k]-offset);
+				const int y2 = min((float)m_height,	kseedsy[k]+offset);
+				const int x1 = max(0.0f,			kseedsx[k]-offset);
+				const int x2 = min((float)m_width,	kseedsx[k]+offset);
+
+				const int changes = integral[y2*(m_width + 1) + x2] - integral[y1*(m_width + 1) + x2]
+					- integral[y2*(m_width + 1) + x1] + integral[y1*(m_width + 1) + x1];
+				active[k] = (changes >= minchanges);
+			}
+		}
 	}
 }
 
@@ -970,54 +1368,52 @@ void SLIC::Perform3DSupervoxelSLIC(
 	for( int itr = 0; itr < iterations; itr++ )
 	{
 		distvec.assign(sz, DBL_MAX);
+		float* dist_ptr = distvec.data();
 		for( int n = 0; n < numk; n++ )
 		{
                         y1 = max(0.0f,			kseedsoy[n]-offset);
                         y2 = min((float)m_height,	kseedsoy[n]+offset);
                         x1 = max(0.0f,			kseedsox[n]-offset);
                         x2 = min((float)m_width,	kseedsox[n]+offset);
-                        
-//                        widthx = abs(m_xvec[y1*m_width + x1] - m_xvec[y1*m_width + x2 - 1]);
-//                        widthy = abs(m_yvec[y1*m_width + x1] - m_yvec[(y2 - 1)*m_width + x1]);
-//                        
-//                        invwt = 1.0/((widthx/M)*(widthy/M));
-                        
+
+			const float sl = kseedsl[n];
+			const float sa = kseedsa[n];
+			const float sb = kseedsb[n];
+			const float sx = kseedsx[n];
+			const float sy = kseedsy[n];
+			const float sd = kseedsz[n];
+
+			// Branch-free over the planes of a row, such that the compiler
+			// can vectorize; visiting seeds in order keeps the labels.
 			for( int y = y1; y < y2; y++ )
 			{
+				const float* lrow = m_lvec + y*m_width;
+				const float* arow = m_avec + y*m_width;
+				const float* brow = m_bvec + y*m_width;
+				const float* xrow = m_xvec + y*m_width;
+				const float* yrow = m_yvec + y*m_width;
+				const float* zrow = m_zvec + y*m_width;
+				float* drow = dist_ptr + y*m_width;
+				int* krow = klabels + y*m_width;
+
 				for( int x = x1; x < x2; x++ )
 				{
-					int i = y*m_width + x;
-
-					l = m_lvec[i];
-					a = m_avec[i];
-					b = m_bvec[i];
-
-					dist =	(l - kseedsl[n])*(l - kseedsl[n]) +
-						(a - kseedsa[n])*(a - kseedsa[n]) +
-						(b - kseedsb[n])*(b - kseedsb[n]);
-                    
-//                    distxy =        (x - kseedsox[n])*(x - kseedsox[n]) + 
-//                                    (y - kseedsoy[n])*(y - kseedsoy[n]) +
-//                                    (m_zvec[i] - kseedsx[n])*(m_zvec[i] - kseedsx[n]);
-//                    
-//                    dist += distxy*invwt;
-                    
-					distxyz =	(m_xvec[i] - kseedsx[n])*(m_xvec[i] - kseedsx[n]) +
-							(m_yvec[i] - kseedsy[n])*(m_yvec[i] - kseedsy[n]) +
-                                                        (m_zvec[i] - kseedsz[n])*(m_zvec[i] - kseedsz[n]);
-					
+					const float dl = lrow[x] - sl;
+					const float da = arow[x] - sa;
+					const float db = brow[x] - sb;
+					const float dx = xrow[x] - sx;
+					const float dy = yrow[x] - sy;
+					const float dz = zrow[x] - sd;
+
+					dist = dl*dl + da*da + db*db;
+					distxyz = dx*dx + dy*dy + dz*dz;
 					//------------------------------------------------------------------------
 					dist += distxyz*invwt;//dist = sqrt(dist) + sqrt(distxy*invwt);//this is more exact
 					//------------------------------------------------------------------------
-                    
-                                        assert(i < sz);
-                                        assert(!std::isinf(dist));
-                                        
-					if( dist < distvec[i])
-					{
-						distvec[i] = dist;
-						klabels[i]  = n;
-					}
+
+					const bool closer = dist < drow[x];
+					drow[x] = closer ? dist : drow[x];
+					krow[x] = closer ? n : krow[x];
 				}
 			}
 		}
@@ -1318,6 +1714,9 @@ void SLIC::SaveSupervoxelLabels(
 ///		1. finding an adjacent label for each new component at the start
 ///		2. if a certain component is too small, assigning the previously found
 ///		    adjacent label to this component, and not incrementing the label.
+///
+/// Uses the scanline flood fill of LabelConnectivity with the buffers in
+/// m_connectivity, which are kept across calls.
 //===========================================================================
 void SLIC::EnforceLabelConnectivity(
 	const int*					labels,//input labels that need to be corrected to remove stray labels
@@ -1327,92 +1726,7 @@ void SLIC::EnforceLabelConnectivity(
 	int&						numlabels,//the number of labels changes in the end if segments are removed
 	const int&					K) //the number of superpixels desired by the user
 {
-//	const int dx8[8] = {-1, -1,  0,  1, 1, 1, 0, -1};
-//	const int dy8[8] = { 0, -1, -1, -1, 0, 1, 1,  1};
-
-	const int dx4[4] = {-1,  0,  1,  0};
-	const int dy4[4] = { 0, -1,  0,  1};
-
-	const int sz = width*height;
-	const int SUPSZ = sz/K;
-	//nlabels.resize(sz, -1);
-	for( int i = 0; i < sz; i++ ) nlabels[i] = -1;
-	int label(0);
-	int* xvec = new int[sz];
-	int* yvec = new int[sz];
-	int oindex(0);
-	int adjlabel(0);//adjacent label
-	for( int j = 0; j < height; j++ )
-	{
-		for( int k = 0; k < width; k++ )
-		{
-			if( 0 > nlabels[oindex] )
-			{
-				nlabels[oindex] = label;
-				//--------------------
-				// Start a new segment
-				//--------------------
-				xvec[0] = k;
-				yvec[0] = j;
-				//-------------------------------------------------------
-				// Quickly find an adjacent label for use later if needed
-				//-------------------------------------------------------
-				{for( int n = 0; n < 4; n++ )
-				{
-					int x = xvec[0] + dx4[n];
-					int y = yvec[0] + dy4[n];
-					if( (x >= 0 && x < width) && (y >= 0 && y < height) )
-					{
-						int nindex = y*width + x;
-						if(nlabels[nindex] >= 0) adjlabel = nlabels[nindex];
-					}
-				}}
-
-				int count(1);
-				for( int c = 0; c < count; c++ )
-				{
-					for( int n = 0; n < 4; n++ )
-					{
-						int x = xvec[c] + dx4[n];
-						int y = yvec[c] + dy4[n];
-
-						if( (x >= 0 && x < width) && (y >= 0 && y < height) )
-						{
-							int nindex = y*width + x;
-
-							if( 0 > nlabels[nindex] && labels[oindex] == labels[nindex] )
-							{
-								xvec[count] = x;
-								yvec[count] = y;
-								nlabels[nindex] = label;
-								count++;
-							}
-						}
-
-					}
-				}
-				//-------------------------------------------------------
-				// If segment size is less then a limit, assign an
-				// adjacent label found before, and decrement label count.
-				//-------------------------------------------------------
-				if(count <= SUPSZ >> 2)
-				{
-					for( int c = 0; c < count; c++ )
-					{
-						int ind = yvec[c]*width+xvec[c];
-						nlabels[ind] = adjlabel;
-					}
-					label--;
-				}
-				label++;
-			}
-			oindex++;
-		}
-	}
-	numlabels = label;
-
-	if(xvec) delete [] xvec;
-	if(yvec) delete [] yvec;
+	LabelConnectivity::enforce(labels, width, height, K, nlabels, numlabels, m_connectivity);
 }
 
 
@@ -1602,6 +1916,7 @@ void SLIC::DoDepthSuperpixelSegmentation_ForGivenSeedProbabilities(
 	klabels = new int[sz];
 	for( int s = 0; s < sz; s++ ) klabels[s] = -1;
     //--------------------------------------------------
+    ReleasePlanes();
     if(color > 0)//LAB, the default option
     {
         DoRGBtoLABConversion(ubuff, m_lvec, m_avec, m_bvec);
@@ -1624,10 +1939,7 @@ void SLIC::DoDepthSuperpixelSegmentation_ForGivenSeedProbabilities(
 	PerformSuperpixelSLIC(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy, klabels, STEP, edgemag, compactness, iterations);
 	numlabels = kseedsl.size();
 
-	int* nlabels = new int[sz];
-	EnforceLabelConnectivity(klabels, m_width, m_height, nlabels, numlabels, float(sz)/float(STEP*STEP));
-	{for(int i = 0; i < sz; i++ ) klabels[i] = nlabels[i];}
-	if(nlabels) delete [] nlabels;
+	EnforceLabelConnectivity(klabels, m_width, m_height, klabels, numlabels, float(sz)/float(STEP*STEP));
 }
 
 //===========================================================================
@@ -1680,6 +1992,7 @@ void SLIC::DoSuperpixelSegmentation_ForGivenSuperpixelSize(
 	klabels = new int[sz];
 	for( int s = 0; s < sz; s++ ) klabels[s] = -1;
     //--------------------------------------------------
+    ReleasePlanes();
     if(color > 0)//LAB, the default option
     {
         DoRGBtoLABConversion(ubuff, m_lvec, m_avec, m_bvec);
@@ -1702,10 +2015,7 @@ void SLIC::DoSuperpixelSegmentation_ForGivenSuperpixelSize(
 	PerformSuperpixelSLIC(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy, klabels, STEP, edgemag, compactness, iterations);
 	numlabels = kseedsl.size();
 
-	int* nlabels = new int[sz];
-	EnforceLabelConnectivity(klabels, m_width, m_height, nlabels, numlabels, float(sz)/float(STEP*STEP));
-	{for(int i = 0; i < sz; i++ ) klabels[i] = nlabels[i];}
-	if(nlabels) delete [] nlabels;
+	EnforceLabelConnectivity(klabels, m_width, m_height, klabels, numlabels, float(sz)/float(STEP*STEP));
 }
 
 //===========================================================================
@@ -1740,15 +2050,6 @@ void SLIC::DoSuperpixelSegmentation_ForGivenSuperpixelStep(
         const int                                       iterations,
         const int                                       color)
 {
-    //------------------------------------------------
-    const int STEP = superpixelstep;
-    //------------------------------------------------
-	vector<float> kseedsl(0);
-	vector<float> kseedsa(0);
-	vector<float> kseedsb(0);
-	vector<float> kseedsx(0);
-	vector<float> kseedsy(0);
-
 	//--------------------------------------------------
 	m_width  = width;
 	m_height = height;
@@ -1756,8 +2057,8 @@ void SLIC::DoSuperpixelSegmentation_ForGivenSuperpixelStep(
 	//klabels.resize( sz, -1 );
 	//--------------------------------------------------
 	klabels = new int[sz];
-	for( int s = 0; s < sz; s++ ) klabels[s] = -1;
     //--------------------------------------------------
+    ReleasePlanes();
     if(color > 0)//LAB, the default option
     {
         DoRGBtoLABConversion(ubuff, m_lvec, m_avec, m_bvec);
@@ -1772,18 +2073,174 @@ void SLIC::DoSuperpixelSegmentation_ForGivenSuperpixelStep(
                 m_bvec[i] = ubuff[i]       & 0xff;
         }
     }
+	//--------------------------------------------------
+	PerformSegmentation_ForGivenSuperpixelStep(klabels, numlabels, superpixelstep,
+		compactness, perturbseeds, iterations, color);
+}
+
+//===========================================================================
+///	DoSuperpixelSegmentation_ForGivenSuperpixelStep
+///
+/// Same as above, but reads the pixels from interleaved 8-bit BGR rows, as
+/// stored in a CV_8UC3 image, converting them directly to the LAB (or RGB)
+/// planes. The final labels are written into labels, which needs to hold
+/// width*height integers, so no packed copy of the image and no label buffer
+/// is allocated for the caller.
+//===========================================================================
+void SLIC::DoSuperpixelSegmentation_ForGivenSuperpixelStep(
+	const unsigned char*		bgr,
+	const int					rowstep,
+	const int					width,
+	const int					height,
+	int*						labels,
+	int&						numlabels,
+	const int&					superpixelstep,
+	const float&				compactness,
+	const bool&					perturbseeds,
+	const int					iterations,
+	const int					color)
+{
+	//--------------------------------------------------
+	m_width  = width;
+	m_height = height;
+	//--------------------------------------------------
+	ConvertBGRRows(bgr, rowstep, color);
+	//--------------------------------------------------
+	PerformSegmentation_ForGivenSuperpixelStep(labels, numlabels, superpixelstep,
+		compactness, perturbseeds, iterations, color);
+}
+
+//===========================================================================
+///	DoSuperpixelSegmentation_ForGivenSuperpixelStep
+///
+/// The planes are used directly if not padded, i.e. the conversion from
+/// the image is left to the caller.
+//===========================================================================
+void SLIC::DoSuperpixelSegmentation_ForGivenSuperpixelStep(
+	const PlanarImage<float>&	planes,
+	int*						labels,
+	int&						numlabels,
+	const int&					superpixelstep,
+	const float&				compactness,
+	const bool&					perturbseeds,
+	const int					iterations,
+	const int					color)
+{
+	//--------------------------------------------------
+	m_width  = planes.getCols();
+	m_height = planes.getRows();
+	//--------------------------------------------------
+	UsePlanes(planes);
+	//--------------------------------------------------
+	PerformSegmentation_ForGivenSuperpixelStep(labels, numlabels, superpixelstep,
+		compactness, perturbseeds, iterations, color);
+}
+
+//===========================================================================
+///	ConvertBGRRows
+///
+/// Converts interleaved 8-bit BGR rows directly to the LAB (or RGB)
+/// planes, kept in m_planes such that their memory is reused.
+//===========================================================================
+void SLIC::ConvertBGRRows(
+	const unsigned char*		bgr,
+	const int					rowstep,
+	const int					color)
+{
+	m_planes.convert(bgr, rowstep, m_height, m_width,
+		color > 0 ? PlanarImage<float>::LAB : PlanarImage<float>::RGB, false);
+	UsePlanes(m_planes);
+}
+
+//===========================================================================
+///	UsePlanes
+//===========================================================================
+void SLIC::UsePlanes(
+	const PlanarImage<float>&	planes)
+{
+	ReleasePlanes();
+
+	const PlanarImage<float>* source = &planes;
+	if( !planes.isContinuous() )
+	{
+		// The iterations index pixels as y*m_width + x.
+		m_planes.create(planes.getRows(), planes.getCols(), 3, false);
+		for( int c = 0; c < 3; c++ )
+		{
+			for( int y = 0; y < planes.getRows(); y++ )
+			{
+				std::copy(planes.getRow(c, y), planes.getRow(c, y) + planes.getCols(),
+					m_planes.getRow(c, y));
+			}
+		}
+		source = &m_planes;
+	}
+
+	// The planes are only read.
+	m_lvec = const_cast<float*>(source->getPlane(0));
+	m_avec = const_cast<float*>(source->getPlane(1));
+	m_bvec = const_cast<float*>(source->getPlane(2));
+	m_ownsplanes = false;
+}
+
+//===========================================================================
+///	ReleasePlanes
+//===========================================================================
+void SLIC::ReleasePlanes()
+{
+	if( m_ownsplanes )
+	{
+		if(m_lvec) delete [] m_lvec;
+		if(m_avec) delete [] m_avec;
+		if(m_bvec) delete [] m_bvec;
+	}
+	m_lvec = NULL;
+	m_avec = NULL;
+	m_bvec = NULL;
+	m_ownsplanes = true;
+}
+
+//===========================================================================
+///	PerformSegmentation_ForGivenSuperpixelStep
+///
+/// Runs seeding, PerformSuperpixelSLIC and EnforceLabelConnectivity on the
+/// planes m_lvec, m_avec and m_bvec; the connected labels are written into
+/// labels.
+//===========================================================================
+void SLIC::PerformSegmentation_ForGivenSuperpixelStep(
+	int*						labels,
+	int&						numlabels,
+	const int&					STEP,
+	const float&				compactness,
+	const bool&					perturbseeds,
+	const int					iterations,
+	const int					color)
+{
+	vector<float> kseedsl(0);
+	vector<float> kseedsa(0);
+	vector<float> kseedsb(0);
+	vector<float> kseedsx(0);
+	vector<float> kseedsy(0);
+
+	int sz = m_width*m_height;
+	int* klabels = labels;
+	for( int s = 0; s < sz; s++ ) klabels[s] = -1;
 	//--------------------------------------------------
 	vector<float> edgemag(0);
 	if(perturbseeds) DetectLabEdges(m_lvec, m_avec, m_bvec, m_width, m_height, edgemag);
 	GetLABXYSeeds_ForGivenStepSize(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy, STEP, perturbseeds, edgemag);
 
-	PerformSuperpixelSLIC(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy, klabels, STEP, edgemag, compactness, iterations);
+	if( m_fixedpoint )
+	{
+		PerformSuperpixelSLIC_FixedPoint(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy, klabels, STEP, compactness, iterations, color);
+	}
+	else if( !m_gpu || !PerformSuperpixelSLIC_GPU(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy, klabels, STEP, compactness, iterations) )
+	{
+		PerformSuperpixelSLIC(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy, klabels, STEP, edgemag, compactness, iterations);
+	}
 	numlabels = kseedsl.size();
 
-	int* nlabels = new int[sz];
-	EnforceLabelConnectivity(klabels, m_width, m_height, nlabels, numlabels, float(sz)/float(STEP*STEP));
-	{for(int i = 0; i < sz; i++ ) klabels[i] = nlabels[i];}
-	if(nlabels) delete [] nlabels;
+	EnforceLabelConnectivity(klabels, m_width, m_height, klabels, numlabels, float(sz)/float(STEP*STEP));
 }
 
 //===========================================================================
@@ -1846,6 +2303,7 @@ void SLIC::Do3DSupervoxelSegmentation_ForGivenSupervoxelSize(
 	klabels = new int[sz];
 	for( int s = 0; s < sz; s++ ) klabels[s] = -1;
     //--------------------------------------------------
+    ReleasePlanes();
     if(color > 0)//LAB, the default option
     {
         DoRGBtoLABConversion(ubuff, m_lvec, m_avec, m_bvec);
@@ -1879,10 +2337,7 @@ void SLIC::Do3DSupervoxelSegmentation_ForGivenSupervoxelSize(
 	Perform3DSupervoxelSLIC(kseedsl, kseedsa, kseedsb, kseedsox, kseedsoy, kseedsx, kseedsy, kseedsz, klabels, STEP, edgemag, compactness, iterations);
 	numlabels = kseedsl.size();
 
-	int* nlabels = new int[sz];
-	EnforceLabelConnectivity(klabels, m_width, m_height, nlabels, numlabels, float(sz)/float(STEP*STEP));
-	{for(int i = 0; i < sz; i++ ) klabels[i] = nlabels[i];}
-	if(nlabels) delete [] nlabels;
+	EnforceLabelConnectivity(klabels, m_width, m_height, klabels, numlabels, float(sz)/float(STEP*STEP));
 }
 
 //===========================================================================
@@ -1945,6 +2400,7 @@ void SLIC::Do3DSupervoxelSegmentation_ForGivenSupervoxelStep(
 	klabels = new int[sz];
 	for( int s = 0; s < sz; s++ ) klabels[s] = -1;
     //--------------------------------------------------
+    ReleasePlanes();
     if(color > 0)//LAB, the default option
     {
         DoRGBtoLABConversion(ubuff, m_lvec, m_avec, m_bvec);
@@ -1978,10 +2434,82 @@ void SLIC::Do3DSupervoxelSegmentation_ForGivenSupervoxelStep(
 	Perform3DSupervoxelSLIC(kseedsl, kseedsa, kseedsb, kseedsox, kseedsoy, kseedsx, kseedsy, kseedsz, klabels, STEP, edgemag, compactness, iterations);
 	numlabels = kseedsl.size();
 
-	int* nlabels = new int[sz];
-	EnforceLabelConnectivity(klabels, m_width, m_height, nlabels, numlabels, float(sz)/float(STEP*STEP));
-	{for(int i = 0; i < sz; i++ ) klabels[i] = nlabels[i];}
-	if(nlabels) delete [] nlabels;
+	EnforceLabelConnectivity(klabels, m_width, m_height, klabels, numlabels, float(sz)/float(STEP*STEP));
+}
+
+//===========================================================================
+///	Do3DSupervoxelSegmentation_ForGivenSupervoxelStep
+///
+/// Same as above, but reads interleaved 8-bit BGR rows and an interleaved
+/// XYZ point cloud (as computed by DepthTools::computeCloudFromDepth),
+/// splitting both directly into planes. The labels are written into labels,
+/// which needs to hold width*height integers.
+//===========================================================================
+void SLIC::Do3DSupervoxelSegmentation_ForGivenSupervoxelStep(
+	const unsigned char*		bgr,
+	const int					rowstep,
+	const float*				cloud,
+	const int					cloudstep,
+	const int					width,
+	const int					height,
+	int*						labels,
+	int&						numlabels,
+	const int&					superpixelstep,
+	const float&				compactness,
+	const bool&					perturbseeds,
+	const int					iterations,
+	const int					color)
+{
+	//------------------------------------------------
+	const int STEP = superpixelstep;
+	//------------------------------------------------
+	vector<float> kseedsl(0);
+	vector<float> kseedsa(0);
+	vector<float> kseedsb(0);
+	vector<float> kseedsox(0);
+	vector<float> kseedsoy(0);
+	vector<float> kseedsx(0);
+	vector<float> kseedsy(0);
+	vector<float> kseedsz(0);
+
+	//--------------------------------------------------
+	m_width  = width;
+	m_height = height;
+	int sz = m_width*m_height;
+	//--------------------------------------------------
+	int* klabels = labels;
+	for( int s = 0; s < sz; s++ ) klabels[s] = -1;
+
+	ConvertBGRRows(bgr, rowstep, color);
+
+	if(m_xvec) delete [] m_xvec;
+	if(m_yvec) delete [] m_yvec;
+	if(m_zvec) delete [] m_zvec;
+
+	m_xvec = new float[sz];
+	m_yvec = new float[sz];
+	m_zvec = new float[sz];
+	for( int y = 0; y < m_height; y++ )
+	{
+		const float* row = (const float*) ((const unsigned char*) cloud + y*cloudstep);
+		const int i = y*m_width;
+		for( int x = 0; x < m_width; x++ )
+		{
+			m_xvec[i + x] = row[3*x];
+			m_yvec[i + x] = row[3*x + 1];
+			m_zvec[i + x] = row[3*x + 2];
+		}
+	}
+
+	//--------------------------------------------------
+	vector<float> edgemag(0);
+	if(perturbseeds) DetectLabEdges(m_lvec, m_avec, m_bvec, m_width, m_height, edgemag);
+	GetLABXYZSeeds_ForGivenStepSize(kseedsl, kseedsa, kseedsb, kseedsox, kseedsoy, kseedsx, kseedsy, kseedsz, STEP, perturbseeds, edgemag);
+
+	Perform3DSupervoxelSLIC(kseedsl, kseedsa, kseedsb, kseedsox, kseedsoy, kseedsx, kseedsy, kseedsz, klabels, STEP, edgemag, compactness, iterations);
+	numlabels = kseedsl.size();
+
+	EnforceLabelConnectivity(klabels, m_width, m_height, klabels, numlabels, float(sz)/float(STEP*STEP));
 }
 
 //===========================================================================
@@ -2143,3 +2671,186 @@ void SLIC::DoSupervoxelSegmentation(
 	EnforceSupervoxelLabelConnectivity(klabels, width, height, depth, numlabels, STEP);
 }
 
+//===========================================================================
+///	DoStreamingSupervoxelSegmentation
+///
+/// Same as DoSupervoxelSegmentation, but only chunk frames are kept: the
+/// LAB planes and labels live in ring buffers indexed by frame modulo chunk.
+/// After segmenting a window, all but the last overlap frames are written
+/// and dropped. The seeds owning voxels of the overlap frames carry over
+/// together with the labels of these frames. New grid seeds
+/// are placed only in the frames entering the window. Each seed keeps a
+/// global id across windows, which is the label written for its voxels.
+///
+/// As the volume is never complete, no 3D connectivity is enforced.
+//===========================================================================
+void SLIC::DoStreamingSupervoxelSegmentation(
+	const std::function<bool(unsigned int*)>&				nextframe,
+	const std::function<void(const int, const int*)>&	writeframe,
+	const int					width,
+	const int					height,
+	const int&					supervoxelsize,
+	const float&				compactness,
+	const int					chunk,
+	const int					overlap,
+	int&						numlabels)
+{
+    //---------------------------------------------------------
+    const int STEP = 0.5 + pow(float(supervoxelsize),1.0/3.0);
+    //---------------------------------------------------------
+	const int window = max(1, chunk);
+	const int carry = max(0, min(overlap, window - 1));
+
+	m_width  = width;
+	m_height = height;
+	int sz = m_width*m_height;
+
+	vector< vector<float> > lplanes(window, vector<float>(sz));
+	vector< vector<float> > aplanes(window, vector<float>(sz));
+	vector< vector<float> > bplanes(window, vector<float>(sz));
+	vector< vector<int> > labelplanes(window, vector<int>(sz));
+	vector<float*> lvecvec(window);
+	vector<float*> avecvec(window);
+	vector<float*> bvecvec(window);
+	vector<int*> labelvec(window);
+	vector<unsigned int> ubuff(sz);
+	vector<int> output(sz);
+
+	vector<float> kseedsl(0);
+	vector<float> kseedsa(0);
+	vector<float> kseedsb(0);
+	vector<float> kseedsx(0);
+	vector<float> kseedsy(0);
+	vector<float> kseedsz(0);
+	vector<int> ids(0);
+
+	int first = 0;//index of the first frame in the window
+	int loaded = 0;//frames in the window
+	int seeded = 0;//frames of the window covered by carried seeds
+	int nextid = 0;
+	bool end = false;
+
+	while( true )
+	{
+		//--------------------------------------------------
+		// Read and convert frames until the window is full
+		//--------------------------------------------------
+		while( loaded < window && !end )
+		{
+			if( !nextframe(ubuff.data()) )
+			{
+				end = true;
+				break;
+			}
+
+			const int slot = (first + loaded)%window;
+			ColorConversion::convertRGBToLAB(ubuff.data(), sz, lplanes[slot].data(),
+				aplanes[slot].data(), bplanes[slot].data());
+			loaded++;
+		}
+
+		if( loaded == 0 ) break;
+
+		for( int d = 0; d < loaded; d++ )
+		{
+			const int slot = (first + d)%window;
+			lvecvec[d] = lplanes[slot].data();
+			avecvec[d] = aplanes[slot].data();
+			bvecvec[d] = bplanes[slot].data();
+			labelvec[d] = labelplanes[slot].data();
+			if( d >= seeded ) labelplanes[slot].assign(sz, -1);
+		}
+
+		m_depth = loaded;
+		m_lvecvec = lvecvec.data();
+		m_avecvec = avecvec.data();
+		m_bvecvec = bvecvec.data();
+
+		//--------------------------------------------------
+		// Seed the new frames and segment the window
+		//--------------------------------------------------
+		const int numcarried = kseedsl.size();
+		if( seeded < loaded )
+		{
+			AppendKValues_LABXYZ(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy, kseedsz, STEP, seeded, loaded);
+		}
+		for( int n = numcarried; n < (int) kseedsl.size(); n++ ) ids.push_back(nextid++);
+
+		int** klabels = labelvec.data();
+		PerformSupervoxelSLIC(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy, kseedsz, klabels, STEP, compactness);
+
+		m_lvecvec = NULL;
+		m_avecvec = NULL;
+		m_bvecvec = NULL;
+
+		//--------------------------------------------------
+		// Write the frames leaving the window
+		//--------------------------------------------------
+		const int emit = end ? loaded : loaded - carry;
+		for( int d = 0; d < emit; d++ )
+		{
+			for( int i = 0; i < sz; i++ )
+			{
+				output[i] = (klabels[d][i] >= 0 ? ids[klabels[d][i]] : -1);
+			}
+			writeframe(first + d, output.data());
+		}
+
+		first += emit;
+		loaded -= emit;
+		if( loaded == 0 )
+		{
+			if( end ) break;
+			kseedsl.clear(); kseedsa.clear(); kseedsb.clear();
+			kseedsx.clear(); kseedsy.clear(); kseedsz.clear();
+			ids.clear();
+			seeded = 0;
+			continue;
+		}
+
+		//--------------------------------------------------
+		// Carry the seeds owning voxels of the overlap frames
+		//--------------------------------------------------
+		const int numk = kseedsl.size();
+		vector<int> remap(numk, -1);
+		for( int d = emit; d < emit + loaded; d++ )
+		{
+			for( int i = 0; i < sz; i++ )
+			{
+				if( klabels[d][i] >= 0 ) remap[klabels[d][i]] = 0;
+			}
+		}
+
+		int k = 0;
+		for( int n = 0; n < numk; n++ )
+		{
+			if( remap[n] < 0 ) continue;
+
+			remap[n] = k;
+			kseedsl[k] = kseedsl[n];
+			kseedsa[k] = kseedsa[n];
+			kseedsb[k] = kseedsb[n];
+			kseedsx[k] = kseedsx[n];
+			kseedsy[k] = kseedsy[n];
+			kseedsz[k] = kseedsz[n] - emit;
+			ids[k] = ids[n];
+			k++;
+		}
+		kseedsl.resize(k); kseedsa.resize(k); kseedsb.resize(k);
+		kseedsx.resize(k); kseedsy.resize(k); kseedsz.resize(k);
+		ids.resize(k);
+
+		for( int d = emit; d < emit + loaded; d++ )
+		{
+			for( int i = 0; i < sz; i++ )
+			{
+				if( klabels[d][i] >= 0 ) klabels[d][i] = remap[klabels[d][i]];
+			}
+		}
+		seeded = loaded;
+	}
+
+	m_depth = 0;
+	numlabels = nextid;
+}
+
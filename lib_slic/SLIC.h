@@ -18,7 +18,11 @@
 
 #include <vector>
 #include <string>
+#include <stdint.h>
 #include <algorithm>
+#include <functional>
+#include "label_connectivity.h"
+#include "planar_image.h"
 using namespace std;
 
 class SLIC  
@@ -26,6 +30,50 @@ class SLIC
 public:
 	SLIC();
 	virtual ~SLIC();
+	//============================================================================
+	// Number of threads used for the assignment and update steps of
+	// PerformSuperpixelSLIC; the labels do not depend on the number of threads
+	//============================================================================
+	void SetThreads(const int threads);
+	//============================================================================
+	// Stop PerformSuperpixelSLIC before the given number of iterations once
+	// seeds moved at most displacement pixels on average and at most the fraction
+	// changed of the pixels changed their label; displacement 0 disables it
+	//============================================================================
+	void SetConvergence(const float displacement, const float changed);
+	//============================================================================
+	// Active seed mode as in preSLIC: seeds with less than the fraction
+	// threshold of changed labels in their window are not re-assigned, and
+	// iterations stop once less than this fraction of all labels changed;
+	// threshold 0 disables it
+	//============================================================================
+	void SetPreemption(const float threshold);
+	//============================================================================
+	// Run the assignment and update steps of PerformSuperpixelSLIC on the GPU
+	// (OpenCL, see SLIC_OpenCL.cpp); convergence and preemption are not used
+	// on the GPU and the CPU is used if no GPU is available
+	//============================================================================
+	void SetDevice(const bool gpu);
+	//============================================================================
+	// Whether lib_slic was built with OpenCL and a GPU device was found
+	//============================================================================
+	static bool GPUAvailable();
+	//============================================================================
+	// Run the iterations on 8-bit quantized planes with integer distances
+	// (see SLIC_FixedPoint.cpp); convergence, preemption and threads are not
+	// used in this mode
+	//============================================================================
+	void SetFixedPoint(const bool fixedpoint);
+	//============================================================================
+	// Keep the planes in half precision (16 bit) during the iterations of
+	// PerformSuperpixelSLIC, halving their memory traffic (see
+	// SLIC_HalfPrecision.cpp); not used in fixed point mode or on the GPU
+	//============================================================================
+	void SetHalfPrecision(const bool half);
+	//============================================================================
+	// Number of iterations actually run by the last segmentation
+	//============================================================================
+	int GetIterations() const;
         //============================================================================
 	// Superpixel segmentation for a given step size (superpixel size ~= step*step)
 	//============================================================================
@@ -71,6 +119,36 @@ public:
                 const int                                       iterations = 10,
                 const int                                       color = 1);
 	//============================================================================
+	// Superpixel segmentation for a given step size on interleaved BGR rows
+	// (e.g. a CV_8UC3 image) writing the labels into the caller's buffer
+	//============================================================================
+	void DoSuperpixelSegmentation_ForGivenSuperpixelStep(
+		const unsigned char*		bgr,//3 bytes per pixel, rows rowstep bytes apart
+		const int					rowstep,
+		const int					width,
+		const int					height,
+		int*						labels,//width*height labels, allocated by the caller
+		int&						numlabels,
+		const int&					superpixelstep,
+		const float&				compactness,
+		const bool&					perturbseeds = false,
+		const int					iterations = 10,
+		const int					color = 1);
+	//============================================================================
+	// Superpixel segmentation for a given step size on planes converted by the
+	// caller (LAB for color > 0, RGB otherwise), which are used without copying
+	// if not padded; writes the labels into the caller's buffer
+	//============================================================================
+	void DoSuperpixelSegmentation_ForGivenSuperpixelStep(
+		const PlanarImage<float>&	planes,
+		int*						labels,//width*height labels, allocated by the caller
+		int&						numlabels,
+		const int&					superpixelstep,
+		const float&				compactness,
+		const bool&					perturbseeds = false,
+		const int					iterations = 10,
+		const int					color = 1);
+	//============================================================================
 	// Superpixel segmentation for a given number of superpixels
 	//============================================================================
         void DoSuperpixelSegmentation_ForGivenNumberOfSuperpixels(
@@ -119,6 +197,25 @@ public:
                 const bool&                                     perturbseeds = false,
                 const int                                       iterations = 10,
                 const int                                       color = 1);
+	//============================================================================
+	// 3D Supervoxel segmentation for a given step size on interleaved BGR rows
+	// and an interleaved XYZ point cloud (e.g. CV_8UC3 and CV_32FC3 images),
+	// writing the labels into the caller's buffer
+	//============================================================================
+	void Do3DSupervoxelSegmentation_ForGivenSupervoxelStep(
+		const unsigned char*		bgr,//3 bytes per pixel, rows rowstep bytes apart
+		const int					rowstep,
+		const float*				cloud,//3 floats per pixel, rows cloudstep bytes apart
+		const int					cloudstep,
+		const int					width,
+		const int					height,
+		int*						labels,//width*height labels, allocated by the caller
+		int&						numlabels,
+		const int&					superpixelstep,
+		const float&				compactness,
+		const bool&					perturbseeds = false,
+		const int					iterations = 10,
+		const int					color = 1);
         //============================================================================
 	// 3D Supervoxel segmentation for a given step size (supervoxel size projected to
         // image plane ~= step*step)
@@ -150,6 +247,23 @@ public:
                 const int&					supervoxelsize,
                 const float&                                   compactness);
 	//============================================================================
+	// Supervoxel segmentation of a video of any length with bounded memory:
+	// nextframe fills one ARGB frame and returns false after the last frame;
+	// frames are segmented in chunks of chunk frames overlapping by overlap
+	// frames, carrying the seeds of the overlap forward; writeframe receives
+	// the labels of each frame (in order) once it leaves the window
+	//============================================================================
+	void DoStreamingSupervoxelSegmentation(
+		const std::function<bool(unsigned int*)>&				nextframe,
+		const std::function<void(const int, const int*)>&	writeframe,
+		const int					width,
+		const int					height,
+		const int&					supervoxelsize,
+		const float&				compactness,
+		const int					chunk,
+		const int					overlap,
+		int&						numlabels);
+	//============================================================================
 	// Save superpixel labels in a text file in raster scan order
 	//============================================================================
 	void SaveSuperpixelLabels(
@@ -181,6 +295,34 @@ public:
 
 private:
 	//============================================================================
+	// Fill m_lvec, m_avec and m_bvec from interleaved BGR rows
+	//============================================================================
+	void ConvertBGRRows(
+		const unsigned char*		bgr,
+		const int					rowstep,
+		const int					color);
+	//============================================================================
+	// Point m_lvec, m_avec and m_bvec to the planes, copied to m_planes first
+	// if padded
+	//============================================================================
+	void UsePlanes(
+		const PlanarImage<float>&	planes);
+	//============================================================================
+	// Free m_lvec, m_avec and m_bvec unless they point to planes
+	//============================================================================
+	void ReleasePlanes();
+	//============================================================================
+	// Seeding, SLIC and connectivity enforcement on m_lvec, m_avec and m_bvec
+	//============================================================================
+	void PerformSegmentation_ForGivenSuperpixelStep(
+		int*						labels,
+		int&						numlabels,
+		const int&					STEP,
+		const float&				compactness,
+		const bool&					perturbseeds,
+		const int					iterations,
+		const int					color);
+	//============================================================================
 	// The main SLIC algorithm for generating superpixels
 	//============================================================================
 	void PerformSuperpixelSLIC(
@@ -194,6 +336,74 @@ private:
                 const vector<float>&                   edgemag,
 		const float&				m = 10.0,
                 const int                               iterations = 10);
+	//============================================================================
+	// PerformSuperpixelSLIC on the GPU for seeds on the grid of
+	// GetLABXYSeeds_ForGivenStepSize; returns false if the GPU cannot be used
+	//============================================================================
+	bool PerformSuperpixelSLIC_GPU(
+		vector<float>&				kseedsl,
+		vector<float>&				kseedsa,
+		vector<float>&				kseedsb,
+		vector<float>&				kseedsx,
+		vector<float>&				kseedsy,
+		int*&						klabels,
+		const int&					STEP,
+		const float&				M,
+		const int					iterations);
+	//============================================================================
+	// PerformSuperpixelSLIC on quantized planes using integer arithmetic
+	//============================================================================
+	void PerformSuperpixelSLIC_FixedPoint(
+		vector<float>&				kseedsl,
+		vector<float>&				kseedsa,
+		vector<float>&				kseedsb,
+		vector<float>&				kseedsx,
+		vector<float>&				kseedsy,
+		int*&						klabels,
+		const int&					STEP,
+		const float&				M,
+		const int					iterations,
+		const int					color);
+	//============================================================================
+	// Fill m_halfplanes from m_lvec, m_avec and m_bvec
+	//============================================================================
+	void ConvertPlanesToHalf();
+	//============================================================================
+	// Half precision to float, for a single value and for n values
+	//============================================================================
+	static float ConvertHalfToFloat(
+		const uint16_t				half);
+	static void ConvertHalfToFloat(
+		const uint16_t*				half,
+		float*						values,
+		const int					n);
+	//============================================================================
+	// Assignment step of PerformSuperpixelSLIC: assigns each pixel to the
+	// closest seed within the 2*STEP window around the seed
+	//============================================================================
+	void AssignSuperpixelSLIC(
+		const vector<float>&		kseedsl,
+		const vector<float>&		kseedsa,
+		const vector<float>&		kseedsb,
+		const vector<float>&		kseedsx,
+		const vector<float>&		kseedsy,
+		int*&						klabels,
+		vector<float>&				distvec,
+		const int&					STEP,
+		const float&				invwt,
+		const vector<char>&			active);//empty to assign all seeds
+	//============================================================================
+	// Update step of PerformSuperpixelSLIC: accumulates the LAB values,
+	// positions and sizes of all superpixels
+	//============================================================================
+	void AccumulateSuperpixelSLIC(
+		const int*					klabels,
+		vector<float>&				sigmal,
+		vector<float>&				sigmaa,
+		vector<float>&				sigmab,
+		vector<float>&				sigmax,
+		vector<float>&				sigmay,
+		vector<float>&				clustersize);
         //============================================================================
 	// The main SLIC algorithm for generating 3D supervoxels
 	//============================================================================
@@ -277,6 +487,19 @@ private:
 		vector<float>&				kseedsz,
 		const int&					STEP);
 	//============================================================================
+	// Append supervoxel seeds on a grid covering the frames [zbegin, zend)
+	//============================================================================
+	void AppendKValues_LABXYZ(
+		vector<float>&				kseedsl,
+		vector<float>&				kseedsa,
+		vector<float>&				kseedsb,
+		vector<float>&				kseedsx,
+		vector<float>&				kseedsy,
+		vector<float>&				kseedsz,
+		const int&					STEP,
+		const int					zbegin,
+		const int					zend);
+	//============================================================================
 	// Move the superpixel seeds to low gradient positions to avoid putting seeds
 	// at region boundaries.
 	//============================================================================
@@ -348,7 +571,8 @@ private:
 		float**&					avec,
 		float**&					bvec);
 	//============================================================================
-	// Post-processing of SLIC segmentation, to avoid stray labels.
+	// Post-processing of SLIC segmentation, to avoid stray labels; labels and
+	// nlabels may be the same buffer, the buffers are reused across calls
 	//============================================================================
 	void EnforceLabelConnectivity(
 		const int*					labels,
@@ -369,6 +593,15 @@ private:
 		const int&					STEP);
 
 private:
+        int							m_threads;
+        float							m_displacement;
+        float							m_changed;
+        float							m_preemption;
+        bool							m_gpu;
+        bool							m_fixedpoint;
+        bool							m_half;
+        int							m_iterations;
+        LabelConnectivity::Workspace		m_connectivity;
         int							m_width;
         int							m_height;
         int							m_depth;
@@ -376,6 +609,9 @@ private:
 	float*							m_lvec;
 	float*							m_avec;
 	float*							m_bvec;
+	bool							m_ownsplanes;//m_lvec, m_avec and m_bvec allocated by new
+	PlanarImage<float>				m_planes;
+	vector<uint16_t>				m_halfplanes;//L, a and b planes in half precision, see SetHalfPrecision
 
         float*                                                 m_xvec;
         float*                                                 m_yvec;
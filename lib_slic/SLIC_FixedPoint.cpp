@@ -0,0 +1,252 @@
+// SLIC_FixedPoint.cpp: integer implementation of the SLIC iterations.
+//
+// For targets without a fast FPU: the LAB (or RGB) planes are quantized to
+// 8 bit, seeds are kept as 8-bit colors and 16-bit positions, and the
+// distances are accumulated in 32-bit integers using integer weights in Q8
+// fixed point. On ARM, rows of the assignment step use NEON.
+//////////////////////////////////////////////////////////////////////
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include "SLIC.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SLIC_NEON
+#endif
+
+namespace {
+
+//===========================================================================
+///	AssignRowFixed
+///
+/// Distances of pixels x1 to x2 - 1 of one row to the seed (sl, sa, sb, sx)
+/// given the squared row distance dy2; pixels with a smaller distance are
+/// assigned to seed n.
+//===========================================================================
+void AssignRowFixed(
+	const uint8_t*				lrow,
+	const uint8_t*				arow,
+	const uint8_t*				brow,
+	uint32_t*					drow,
+	int*						krow,
+	const int					x1,
+	const int					x2,
+	const int					sl,
+	const int					sa,
+	const int					sb,
+	const int					sx,
+	const uint32_t				dy2,
+	const uint32_t				wl,
+	const uint32_t				wab,
+	const uint32_t				wxy,
+	const int					n)
+{
+	int x = x1;
+#ifdef SLIC_NEON
+	const uint8x8_t vsl = vdup_n_u8(sl);
+	const uint8x8_t vsa = vdup_n_u8(sa);
+	const uint8x8_t vsb = vdup_n_u8(sb);
+	const uint32x4_t vwl = vdupq_n_u32(wl);
+	const uint32x4_t vwab = vdupq_n_u32(wab);
+	const uint32x4_t vwxy = vdupq_n_u32(wxy);
+	const uint32x4_t vdy2 = vdupq_n_u32(dy2);
+	const int32x4_t vn = vdupq_n_s32(n);
+	const int32x4_t vstep = vdupq_n_s32(4);
+	int32x4_t vx = {x - sx, x - sx + 1, x - sx + 2, x - sx + 3};
+
+	for( ; x + 8 <= x2; x += 8 )
+	{
+		// |difference|^2 of 8-bit values fits into 16 bit.
+		const uint8x8_t dl = vabd_u8(vld1_u8(lrow + x), vsl);
+		const uint8x8_t da = vabd_u8(vld1_u8(arow + x), vsa);
+		const uint8x8_t db = vabd_u8(vld1_u8(brow + x), vsb);
+		const uint16x8_t dl2 = vmull_u8(dl, dl);
+		const uint16x8_t dab2 = vmull_u8(da, da);
+		const uint16x8_t db2 = vmull_u8(db, db);
+
+		for( int h = 0; h < 2; h++ )
+		{
+			const uint32x4_t l2 = vmovl_u16(h == 0 ? vget_low_u16(dl2) : vget_high_u16(dl2));
+			const uint32x4_t ab2 = vaddl_u16(h == 0 ? vget_low_u16(dab2) : vget_high_u16(dab2),
+				h == 0 ? vget_low_u16(db2) : vget_high_u16(db2));
+			const uint32x4_t dx2 = vreinterpretq_u32_s32(vmulq_s32(vx, vx));
+
+			uint32x4_t dist = vmulq_u32(l2, vwl);
+			dist = vmlaq_u32(dist, ab2, vwab);
+			dist = vmlaq_u32(dist, vaddq_u32(dx2, vdy2), vwxy);
+
+			// Seeds are visited in increasing order, ties stay with the smaller index.
+			const int xi = x + 4*h;
+			const uint32x4_t old = vld1q_u32(drow + xi);
+			const uint32x4_t closer = vcltq_u32(dist, old);
+			vst1q_u32(drow + xi, vbslq_u32(closer, dist, old));
+			vst1q_s32(krow + xi, vbslq_s32(closer, vn, vld1q_s32(krow + xi)));
+
+			vx = vaddq_s32(vx, vstep);
+		}
+	}
+#endif
+	for( ; x < x2; x++ )
+	{
+		const int dl = int(lrow[x]) - sl;
+		const int da = int(arow[x]) - sa;
+		const int db = int(brow[x]) - sb;
+		const int dx = x - sx;
+
+		const uint32_t dist = wl*uint32_t(dl*dl) + wab*uint32_t(da*da + db*db)
+			+ wxy*(uint32_t(dx*dx) + dy2);
+		if( dist < drow[x] )
+		{
+			drow[x] = dist;
+			krow[x] = n;
+		}
+	}
+}
+
+} // namespace
+
+//===========================================================================
+///	SetFixedPoint
+//===========================================================================
+void SLIC::SetFixedPoint(const bool fixedpoint)
+{
+	m_fixedpoint = fixedpoint;
+}
+
+//===========================================================================
+///	PerformSuperpixelSLIC_FixedPoint
+///
+/// Same steps as PerformSuperpixelSLIC without convergence check and
+/// preemption. The colors are quantized such that L (0 to 100) and a, b
+/// (about -128 to 127) use the full 8 bit; with the scaling of L by 2.55
+/// the weights are chosen such that the distance equals the float distance
+/// times 2.55^2*256. The distances fit into 32 bit for compactness up to
+/// about 1000.
+//===========================================================================
+void SLIC::PerformSuperpixelSLIC_FixedPoint(
+	vector<float>&				kseedsl,
+	vector<float>&				kseedsa,
+	vector<float>&				kseedsb,
+	vector<float>&				kseedsx,
+	vector<float>&				kseedsy,
+	int*&						klabels,
+	const int&					STEP,
+	const float&				M,
+	const int					iterations,
+	const int					color)
+{
+	const int sz = m_width*m_height;
+	const int numk = kseedsl.size();
+
+	// Quantization of the planes, RGB is already 8 bit.
+	const float scalel = (color > 0 ? 2.55f : 1.0f);
+	const float offsetab = (color > 0 ? 128.0f : 0.0f);
+	auto quantize = [](const float value) -> uint8_t
+	{
+		return uint8_t(max(0.0f, min(255.0f, value + 0.5f)));
+	};
+
+	vector<uint8_t> lplane(sz);
+	vector<uint8_t> aplane(sz);
+	vector<uint8_t> bplane(sz);
+	for( int i = 0; i < sz; i++ )
+	{
+		lplane[i] = quantize(m_lvec[i]*scalel);
+		aplane[i] = quantize(m_avec[i] + offsetab);
+		bplane[i] = quantize(m_bvec[i] + offsetab);
+	}
+
+	vector<uint8_t> seedsl(numk), seedsa(numk), seedsb(numk);
+	vector<int16_t> seedsx(numk), seedsy(numk);
+	for( int n = 0; n < numk; n++ )
+	{
+		seedsl[n] = quantize(kseedsl[n]*scalel);
+		seedsa[n] = quantize(kseedsa[n] + offsetab);
+		seedsb[n] = quantize(kseedsb[n] + offsetab);
+		seedsx[n] = int16_t(kseedsx[n] + 0.5f);
+		seedsy[n] = int16_t(kseedsy[n] + 0.5f);
+	}
+
+	// Q8 weights, relative to the squared (scaled) L difference.
+	const float invwt = 1.0/((STEP/M)*(STEP/M));
+	const uint32_t wl = 256;
+	const uint32_t wab = uint32_t(scalel*scalel*256 + 0.5f);
+	const uint32_t wxy = uint32_t(scalel*scalel*invwt*256 + 0.5f);
+
+	vector<uint32_t> distvec(sz);
+	vector<int64_t> sigmal(numk), sigmaa(numk), sigmab(numk), sigmax(numk), sigmay(numk);
+	vector<int> clustersize(numk);
+
+	const int offset = STEP;
+	m_iterations = 0;
+	for( int itr = 0; itr < iterations; itr++ )
+	{
+		distvec.assign(sz, std::numeric_limits<uint32_t>::max());
+		m_iterations++;
+
+		for( int n = 0; n < numk; n++ )
+		{
+			const int y1 = max(0,			seedsy[n]-offset);
+			const int y2 = min(m_height,	seedsy[n]+offset);
+			const int x1 = max(0,			seedsx[n]-offset);
+			const int x2 = min(m_width,		seedsx[n]+offset);
+
+			for( int y = y1; y < y2; y++ )
+			{
+				const int i = y*m_width;
+				const int dy = y - seedsy[n];
+
+				AssignRowFixed(&lplane[i], &aplane[i], &bplane[i], &distvec[i], klabels + i,
+					x1, x2, seedsl[n], seedsa[n], seedsb[n], seedsx[n], uint32_t(dy*dy),
+					wl, wab, wxy, n);
+			}
+		}
+
+		sigmal.assign(numk, 0);
+		sigmaa.assign(numk, 0);
+		sigmab.assign(numk, 0);
+		sigmax.assign(numk, 0);
+		sigmay.assign(numk, 0);
+		clustersize.assign(numk, 0);
+		for( int y = 0; y < m_height; y++ )
+		{
+			for( int x = 0; x < m_width; x++ )
+			{
+				const int i = y*m_width + x;
+				const int k = klabels[i];
+				if( k < 0 ) continue;
+
+				sigmal[k] += lplane[i];
+				sigmaa[k] += aplane[i];
+				sigmab[k] += bplane[i];
+				sigmax[k] += x;
+				sigmay[k] += y;
+				clustersize[k]++;
+			}
+		}
+
+		// Rounded integer means; empty clusters keep their seed.
+		for( int k = 0; k < numk; k++ )
+		{
+			const int64_t size = clustersize[k];
+			if( size <= 0 ) continue;
+
+			seedsl[k] = uint8_t((sigmal[k] + size/2)/size);
+			seedsa[k] = uint8_t((sigmaa[k] + size/2)/size);
+			seedsb[k] = uint8_t((sigmab[k] + size/2)/size);
+			seedsx[k] = int16_t((sigmax[k] + size/2)/size);
+			seedsy[k] = int16_t((sigmay[k] + size/2)/size);
+		}
+	}
+
+	for( int n = 0; n < numk; n++ )
+	{
+		kseedsl[n] = seedsl[n]/scalel;
+		kseedsa[n] = seedsa[n] - offsetab;
+		kseedsb[n] = seedsb[n] - offsetab;
+		kseedsx[n] = seedsx[n];
+		kseedsy[n] = seedsy[n];
+	}
+}
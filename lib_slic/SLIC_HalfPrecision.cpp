@@ -0,0 +1,177 @@
+// SLIC_HalfPrecision.cpp: half precision planes for the SLIC iterations.
+//
+// The iterations of PerformSuperpixelSLIC are bound by memory bandwidth on
+// large images. With SetHalfPrecision, the LAB (or RGB) planes are stored as
+// IEEE half precision floats (16 bit) and converted back to float in chunks
+// of a row while assigning and accumulating. With F16C (build with
+// SLIC_F16C) or on 64-bit ARM, the conversion uses vector instructions.
+//////////////////////////////////////////////////////////////////////
+#include <cstring>
+#include "SLIC.h"
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#define SLIC_F16C
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define SLIC_NEON_FP16
+#endif
+
+namespace {
+
+//===========================================================================
+///	FloatToHalf
+///
+/// Rounds to nearest even; values beyond the half range become infinity.
+//===========================================================================
+uint16_t FloatToHalf(const float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(float));
+
+	const uint16_t sign = (bits >> 16) & 0x8000;
+	const uint32_t exponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if( exponent == 0xFF )
+	{
+		return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+	}
+
+	const int e = int(exponent) - 127 + 15;
+	if( e >= 31 )
+	{
+		return sign | 0x7C00;
+	}
+	if( e <= 0 )
+	{
+		// Subnormal half or zero.
+		if( e < -10 ) return sign;
+		mantissa |= 0x800000;
+		const int shift = 14 - e;
+		uint32_t half = mantissa >> shift;
+		const uint32_t rest = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		if( rest > halfway || (rest == halfway && (half & 1)) ) half++;
+		return sign | half;
+	}
+
+	uint32_t half = (uint32_t(e) << 10) | (mantissa >> 13);
+	const uint32_t rest = mantissa & 0x1FFF;
+	if( rest > 0x1000 || (rest == 0x1000 && (half & 1)) ) half++;// may carry into the exponent
+	return sign | half;
+}
+
+} // namespace
+
+//===========================================================================
+///	SetHalfPrecision
+//===========================================================================
+void SLIC::SetHalfPrecision(const bool half)
+{
+	m_half = half;
+}
+
+//===========================================================================
+///	ConvertHalfToFloat
+//===========================================================================
+float SLIC::ConvertHalfToFloat(const uint16_t half)
+{
+	const uint32_t sign = uint32_t(half & 0x8000) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+
+	uint32_t bits;
+	if( exponent == 0x1F )
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if( exponent == 0 )
+	{
+		if( mantissa == 0 )
+		{
+			bits = sign;
+		}
+		else
+		{
+			// Normalize the subnormal half.
+			int e = -1;
+			do
+			{
+				e++;
+				mantissa <<= 1;
+			} while( (mantissa & 0x400) == 0 );
+			bits = sign | (uint32_t(127 - 15 - e) << 23) | ((mantissa & 0x3FF) << 13);
+		}
+	}
+	else
+	{
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+
+	float value;
+	std::memcpy(&value, &bits, sizeof(float));
+	return value;
+}
+
+//===========================================================================
+///	ConvertHalfToFloat
+//===========================================================================
+void SLIC::ConvertHalfToFloat(
+	const uint16_t*				half,
+	float*						values,
+	const int					n)
+{
+	int i = 0;
+#if defined(SLIC_F16C)
+	for( ; i + 8 <= n; i += 8 )
+	{
+		_mm256_storeu_ps(values + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (half + i))));
+	}
+#elif defined(SLIC_NEON_FP16)
+	for( ; i + 4 <= n; i += 4 )
+	{
+		vst1q_f32(values + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(half + i))));
+	}
+#endif
+	for( ; i < n; i++ )
+	{
+		values[i] = ConvertHalfToFloat(half[i]);
+	}
+}
+
+//===========================================================================
+///	ConvertPlanesToHalf
+///
+/// Fills m_halfplanes with the planes m_lvec, m_avec and m_bvec, one after
+/// the other.
+//===========================================================================
+void SLIC::ConvertPlanesToHalf()
+{
+	const int sz = m_width*m_height;
+	m_halfplanes.resize(3*sz);
+
+	const float* planes[3] = {m_lvec, m_avec, m_bvec};
+	for( int c = 0; c < 3; c++ )
+	{
+		const float* values = planes[c];
+		uint16_t* half = m_halfplanes.data() + c*sz;
+
+		int i = 0;
+#if defined(SLIC_F16C)
+		for( ; i + 8 <= sz; i += 8 )
+		{
+			_mm_storeu_si128((__m128i*) (half + i), _mm256_cvtps_ph(_mm256_loadu_ps(values + i), _MM_FROUND_TO_NEAREST_INT));
+		}
+#elif defined(SLIC_NEON_FP16)
+		for( ; i + 4 <= sz; i += 4 )
+		{
+			vst1_u16(half + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(values + i))));
+		}
+#endif
+		for( ; i < sz; i++ )
+		{
+			half[i] = FloatToHalf(values[i]);
+		}
+	}
+}
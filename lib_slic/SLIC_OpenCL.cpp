@@ -0,0 +1,369 @@
+// SLIC_OpenCL.cpp: GPU implementation of the SLIC iterations.
+//
+// The assignment step is computed per pixel over the seeds of the 3x3 grid
+// cells around the pixel (as in gSLIC), the update step per seed over its
+// 2*STEP window. Seeding and EnforceLabelConnectivity stay on the CPU.
+// Only compiled with OpenCL if SLIC_OPENCL is defined (see CMakeLists.txt).
+//////////////////////////////////////////////////////////////////////
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include "SLIC.h"
+
+#ifdef SLIC_OPENCL
+#define CL_USE_DEPRECATED_OPENCL_1_2_APIS
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+namespace {
+
+//===========================================================================
+///	Kernels
+///
+/// Seeds are stored interleaved as l, a, b, x, y. Windows are computed as
+/// in AssignSuperpixelSLIC such that the labels match the CPU except for
+/// seeds moving more than one grid cell away from their initial position.
+/// Pixels not covered by any window keep their label and are, unlike on the
+/// CPU, not used in the update step.
+//===========================================================================
+const char* SLIC_KERNELS =
+"__kernel void slic_assign(__global const float* l, __global const float* a,\n"
+"		__global const float* b, __global const float* seeds, const int width,\n"
+"		const int height, const int xstrips, const int ystrips, const int step,\n"
+"		const float invwt, __global int* labels)\n"
+"{\n"
+"	const int x = get_global_id(0);\n"
+"	const int y = get_global_id(1);\n"
+"	if (x >= width || y >= height) return;\n"
+"\n"
+"	const int i = y*width + x;\n"
+"	const int gx = min(xstrips - 1, (int) (x*xstrips/(float) width));\n"
+"	const int gy = min(ystrips - 1, (int) (y*ystrips/(float) height));\n"
+"	const float pl = l[i];\n"
+"	const float pa = a[i];\n"
+"	const float pb = b[i];\n"
+"\n"
+"	float best = FLT_MAX;\n"
+"	int label = labels[i];\n"
+"	for (int cy = max(0, gy - 1); cy <= min(ystrips - 1, gy + 1); cy++) {\n"
+"		for (int cx = max(0, gx - 1); cx <= min(xstrips - 1, gx + 1); cx++) {\n"
+"			const int n = cy*xstrips + cx;\n"
+"			const float sx = seeds[5*n + 3];\n"
+"			const float sy = seeds[5*n + 4];\n"
+"			if (x < (int) fmax(0.0f, sx - step) || x >= (int) fmin((float) width, sx + step)\n"
+"					|| y < (int) fmax(0.0f, sy - step) || y >= (int) fmin((float) height, sy + step)) {\n"
+"				continue;\n"
+"			}\n"
+"\n"
+"			const float dl = pl - seeds[5*n];\n"
+"			const float da = pa - seeds[5*n + 1];\n"
+"			const float db = pb - seeds[5*n + 2];\n"
+"			const float dx = x - sx;\n"
+"			const float dy = y - sy;\n"
+"			const float dist = dl*dl + da*da + db*db + (dx*dx + dy*dy)*invwt;\n"
+"\n"
+"			// Seeds are visited in increasing order, ties go to the smaller index.\n"
+"			if (dist < best) {\n"
+"				best = dist;\n"
+"				label = n;\n"
+"			}\n"
+"		}\n"
+"	}\n"
+"	labels[i] = label;\n"
+"}\n"
+"\n"
+"__kernel void slic_update(__global const float* l, __global const float* a,\n"
+"		__global const float* b, __global const int* labels, __global float* seeds,\n"
+"		const int width, const int height, const int step, const int numk)\n"
+"{\n"
+"	const int n = get_global_id(0);\n"
+"	if (n >= numk) return;\n"
+"\n"
+"	const float sx = seeds[5*n + 3];\n"
+"	const float sy = seeds[5*n + 4];\n"
+"	const int x1 = (int) fmax(0.0f, sx - step);\n"
+"	const int x2 = (int) fmin((float) width, sx + step);\n"
+"	const int y1 = (int) fmax(0.0f, sy - step);\n"
+"	const int y2 = (int) fmin((float) height, sy + step);\n"
+"\n"
+"	float sigmal = 0, sigmaa = 0, sigmab = 0, sigmax = 0, sigmay = 0, size = 0;\n"
+"	for (int y = y1; y < y2; y++) {\n"
+"		for (int x = x1; x < x2; x++) {\n"
+"			const int i = y*width + x;\n"
+"			if (labels[i] == n) {\n"
+"				sigmal += l[i];\n"
+"				sigmaa += a[i];\n"
+"				sigmab += b[i];\n"
+"				sigmax += x;\n"
+"				sigmay += y;\n"
+"				size += 1;\n"
+"			}\n"
+"		}\n"
+"	}\n"
+"\n"
+"	// As in PerformSuperpixelSLIC, empty clusters count as size 1.\n"
+"	const float inv = 1.0f/fmax(1.0f, size);\n"
+"	seeds[5*n] = sigmal*inv;\n"
+"	seeds[5*n + 1] = sigmaa*inv;\n"
+"	seeds[5*n + 2] = sigmab*inv;\n"
+"	seeds[5*n + 3] = sigmax*inv;\n"
+"	seeds[5*n + 4] = sigmay*inv;\n"
+"}\n";
+
+//===========================================================================
+///	OpenCLState
+///
+/// Device, queue and compiled kernels are shared by all SLIC instances and
+/// created on first use; kernels are not re-entrant, calls are serialized.
+//===========================================================================
+struct OpenCLState
+{
+	OpenCLState() : initialized(false), available(false), context(0), queue(0),
+		program(0), assign(0), update(0) {}
+
+	bool initialized;
+	bool available;
+	cl_context context;
+	cl_command_queue queue;
+	cl_program program;
+	cl_kernel assign;
+	cl_kernel update;
+	std::mutex mutex;
+};
+
+OpenCLState& GetOpenCLState()
+{
+	static OpenCLState state;
+	return state;
+}
+
+//===========================================================================
+///	InitializeOpenCL
+///
+/// Picks the first GPU device of all platforms and builds the kernels;
+/// requires state.mutex to be locked.
+//===========================================================================
+bool InitializeOpenCL(OpenCLState& state)
+{
+	if( state.initialized ) return state.available;
+	state.initialized = true;
+
+	cl_uint num_platforms = 0;
+	if( clGetPlatformIDs(0, NULL, &num_platforms) != CL_SUCCESS || num_platforms == 0 ) return false;
+
+	vector<cl_platform_id> platforms(num_platforms);
+	clGetPlatformIDs(num_platforms, platforms.data(), NULL);
+
+	cl_device_id device = 0;
+	for( cl_uint p = 0; p < num_platforms && device == 0; p++ )
+	{
+		cl_uint num_devices = 0;
+		if( clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_GPU, 1, &device, &num_devices) != CL_SUCCESS )
+		{
+			device = 0;
+		}
+	}
+	if( device == 0 ) return false;
+
+	cl_int error = CL_SUCCESS;
+	state.context = clCreateContext(NULL, 1, &device, NULL, NULL, &error);
+	if( error != CL_SUCCESS ) return false;
+
+	state.queue = clCreateCommandQueue(state.context, device, 0, &error);
+	if( error != CL_SUCCESS ) return false;
+
+	state.program = clCreateProgramWithSource(state.context, 1, &SLIC_KERNELS, NULL, &error);
+	if( error != CL_SUCCESS ) return false;
+
+	if( clBuildProgram(state.program, 1, &device, "-cl-fast-relaxed-math", NULL, NULL) != CL_SUCCESS )
+	{
+		size_t length = 0;
+		clGetProgramBuildInfo(state.program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &length);
+		string log(length, ' ');
+		clGetProgramBuildInfo(state.program, device, CL_PROGRAM_BUILD_LOG, length, &log[0], NULL);
+		std::cerr << "SLIC: building OpenCL kernels failed:" << std::endl << log << std::endl;
+		return false;
+	}
+
+	state.assign = clCreateKernel(state.program, "slic_assign", &error);
+	if( error != CL_SUCCESS ) return false;
+
+	state.update = clCreateKernel(state.program, "slic_update", &error);
+	if( error != CL_SUCCESS ) return false;
+
+	state.available = true;
+	return true;
+}
+
+} // namespace
+
+//===========================================================================
+///	GPUAvailable
+//===========================================================================
+bool SLIC::GPUAvailable()
+{
+	OpenCLState& state = GetOpenCLState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+	return InitializeOpenCL(state);
+}
+
+//===========================================================================
+///	PerformSuperpixelSLIC_GPU
+///
+/// Uploads the LAB planes and seeds once, runs all iterations on the GPU and
+/// reads back seeds and labels at the end.
+//===========================================================================
+bool SLIC::PerformSuperpixelSLIC_GPU(
+	vector<float>&				kseedsl,
+	vector<float>&				kseedsa,
+	vector<float>&				kseedsb,
+	vector<float>&				kseedsx,
+	vector<float>&				kseedsy,
+	int*&						klabels,
+	const int&					STEP,
+	const float&				M,
+	const int					iterations)
+{
+	OpenCLState& state = GetOpenCLState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+	if( !InitializeOpenCL(state) ) return false;
+
+	// Same grid as in GetLABXYSeeds_ForGivenStepSize.
+	int xstrips = (0.5+float(m_width)/float(STEP));
+	int ystrips = (0.5+float(m_height)/float(STEP));
+	if( m_width  - STEP*xstrips < 0 ) xstrips--;
+	if( m_height - STEP*ystrips < 0 ) ystrips--;
+
+	const int numk = kseedsl.size();
+	if( numk != xstrips*ystrips ) return false;
+
+	const int sz = m_width*m_height;
+	vector<float> seeds(5*numk);
+	for( int n = 0; n < numk; n++ )
+	{
+		seeds[5*n] = kseedsl[n];
+		seeds[5*n + 1] = kseedsa[n];
+		seeds[5*n + 2] = kseedsb[n];
+		seeds[5*n + 3] = kseedsx[n];
+		seeds[5*n + 4] = kseedsy[n];
+	}
+
+	const size_t sizes[5] = {sz*sizeof(float), sz*sizeof(float), sz*sizeof(float), 5*numk*sizeof(float), sz*sizeof(int)};
+	void* data[5] = {m_lvec, m_avec, m_bvec, seeds.data(), klabels};
+
+	cl_int error = CL_SUCCESS;
+	cl_mem buffers[5] = {0, 0, 0, 0, 0};
+	for( int i = 0; i < 5 && error == CL_SUCCESS; i++ )
+	{
+		const cl_mem_flags flags = (i < 3 ? CL_MEM_READ_ONLY : CL_MEM_READ_WRITE) | CL_MEM_COPY_HOST_PTR;
+		buffers[i] = clCreateBuffer(state.context, flags, sizes[i], data[i], &error);
+	}
+
+	const float invwt = 1.0/((STEP/M)*(STEP/M));
+	const int step = STEP;
+
+	clSetKernelArg(state.assign, 0, sizeof(cl_mem), &buffers[0]);
+	clSetKernelArg(state.assign, 1, sizeof(cl_mem), &buffers[1]);
+	clSetKernelArg(state.assign, 2, sizeof(cl_mem), &buffers[2]);
+	clSetKernelArg(state.assign, 3, sizeof(cl_mem), &buffers[3]);
+	clSetKernelArg(state.assign, 4, sizeof(int), &m_width);
+	clSetKernelArg(state.assign, 5, sizeof(int), &m_height);
+	clSetKernelArg(state.assign, 6, sizeof(int), &xstrips);
+	clSetKernelArg(state.assign, 7, sizeof(int), &ystrips);
+	clSetKernelArg(state.assign, 8, sizeof(int), &step);
+	clSetKernelArg(state.assign, 9, sizeof(float), &invwt);
+	clSetKernelArg(state.assign, 10, sizeof(cl_mem), &buffers[4]);
+
+	clSetKernelArg(state.update, 0, sizeof(cl_mem), &buffers[0]);
+	clSetKernelArg(state.update, 1, sizeof(cl_mem), &buffers[1]);
+	clSetKernelArg(state.update, 2, sizeof(cl_mem), &buffers[2]);
+	clSetKernelArg(state.update, 3, sizeof(cl_mem), &buffers[4]);
+	clSetKernelArg(state.update, 4, sizeof(cl_mem), &buffers[3]);
+	clSetKernelArg(state.update, 5, sizeof(int), &m_width);
+	clSetKernelArg(state.update, 6, sizeof(int), &m_height);
+	clSetKernelArg(state.update, 7, sizeof(int), &step);
+	clSetKernelArg(state.update, 8, sizeof(int), &numk);
+
+	const size_t local_assign[2] = {16, 16};
+	const size_t global_assign[2] = {
+		(size_t) (m_width + 15)/16*16,
+		(size_t) (m_height + 15)/16*16
+	};
+	const size_t local_update = 64;
+	const size_t global_update = (size_t) (numk + 63)/64*64;
+
+	// The queue is in order, no events needed between the steps.
+	for( int itr = 0; itr < iterations && error == CL_SUCCESS; itr++ )
+	{
+		error = clEnqueueNDRangeKernel(state.queue, state.assign, 2, NULL, global_assign, local_assign, 0, NULL, NULL);
+		if( error == CL_SUCCESS )
+		{
+			error = clEnqueueNDRangeKernel(state.queue, state.update, 1, NULL, &global_update, &local_update, 0, NULL, NULL);
+		}
+	}
+
+	if( error == CL_SUCCESS )
+	{
+		error = clEnqueueReadBuffer(state.queue, buffers[4], CL_TRUE, 0, sz*sizeof(int), klabels, 0, NULL, NULL);
+	}
+	if( error == CL_SUCCESS )
+	{
+		error = clEnqueueReadBuffer(state.queue, buffers[3], CL_TRUE, 0, 5*numk*sizeof(float), seeds.data(), 0, NULL, NULL);
+	}
+
+	for( int i = 0; i < 5; i++ )
+	{
+		if( buffers[i] ) clReleaseMemObject(buffers[i]);
+	}
+
+	if( error != CL_SUCCESS )
+	{
+		std::cerr << "SLIC: OpenCL error " << error << ", falling back to the CPU." << std::endl;
+		return false;
+	}
+
+	for( int n = 0; n < numk; n++ )
+	{
+		kseedsl[n] = seeds[5*n];
+		kseedsa[n] = seeds[5*n + 1];
+		kseedsb[n] = seeds[5*n + 2];
+		kseedsx[n] = seeds[5*n + 3];
+		kseedsy[n] = seeds[5*n + 4];
+	}
+
+	m_iterations = iterations;
+	return true;
+}
+
+#else
+
+//===========================================================================
+///	GPUAvailable
+//===========================================================================
+bool SLIC::GPUAvailable()
+{
+	return false;
+}
+
+//===========================================================================
+///	PerformSuperpixelSLIC_GPU
+//===========================================================================
+bool SLIC::PerformSuperpixelSLIC_GPU(
+	vector<float>&				kseedsl,
+	vector<float>&				kseedsa,
+	vector<float>&				kseedsb,
+	vector<float>&				kseedsx,
+	vector<float>&				kseedsy,
+	int*&						klabels,
+	const int&					STEP,
+	const float&				M,
+	const int					iterations)
+{
+	return false;
+}
+
+#endif
@@ -34,43 +34,80 @@
 
 void SLIC_OpenCV::computeSuperpixels(const cv::Mat &mat, int region_size, 
         double compactness, int iterations, bool perturb_seeds, 
-        int color_space, cv::Mat &labels) {
+        int color_space, cv::Mat &labels, int threads, 
+        float displacement, float changed, int* used_iterations, 
+        float preemption, bool gpu, bool fixed_point, bool half) {
     
-    // Convert matrix to unsigned int array.
-    unsigned int* image = new unsigned int[mat.rows*mat.cols];
-    unsigned int value = 0x0000;
-
-    for (int i = 0; i < mat.rows; ++i) {
-        for (int j = 0; j < mat.cols; ++j) {
-
-            int b = mat.at<cv::Vec3b>(i,j)[0];
-            int g = mat.at<cv::Vec3b>(i,j)[1];
-            int r = mat.at<cv::Vec3b>(i,j)[2];
-
-            value = 0x0000;
-            value |= (0xFF000000);
-            value |= (0x00FF0000 & (r << 16));
-            value |= (0x0000FF00 & (g << 8));
-            value |= (0x000000FF & b);
-
-            image[j + mat.cols*i] = value;
-        }
+    // SLIC reads the BGR rows directly and writes into the label storage.
+    labels.create(mat.rows, mat.cols, CV_32SC1);
+    if (!labels.isContinuous()) {
+        labels = cv::Mat(mat.rows, mat.cols, CV_32SC1);
     }
-
+    
     SLIC slic;
+    slic.SetThreads(threads);
+    slic.SetConvergence(displacement, changed);
+    slic.SetPreemption(preemption);
+    slic.SetDevice(gpu);
+    slic.SetFixedPoint(fixed_point);
+    slic.SetHalfPrecision(half);
+    
+    int number_of_labels = 0;
+    slic.DoSuperpixelSegmentation_ForGivenSuperpixelStep(mat.ptr<unsigned char>(0), 
+            mat.step[0], mat.cols, mat.rows, labels.ptr<int>(0), number_of_labels, 
+            region_size, compactness, perturb_seeds, iterations, color_space);
+    
+    if (used_iterations != NULL) {
+        *used_iterations = slic.GetIterations();
+    }
+}
 
-    int* segmentation = new int[mat.rows*mat.cols];
+void SLIC_OpenCV::computeSuperpixels(const PlanarImage<float> &planes, int region_size, 
+        double compactness, int iterations, bool perturb_seeds, 
+        int color_space, cv::Mat &labels, int threads, 
+        float displacement, float changed, int* used_iterations, 
+        float preemption, bool gpu, bool fixed_point, bool half) {
+    
+    labels.create(planes.getRows(), planes.getCols(), CV_32SC1);
+    if (!labels.isContinuous()) {
+        labels = cv::Mat(planes.getRows(), planes.getCols(), CV_32SC1);
+    }
+    
+    SLIC slic;
+    slic.SetThreads(threads);
+    slic.SetConvergence(displacement, changed);
+    slic.SetPreemption(preemption);
+    slic.SetDevice(gpu);
+    slic.SetFixedPoint(fixed_point);
+    slic.SetHalfPrecision(half);
+    
     int number_of_labels = 0;
+    slic.DoSuperpixelSegmentation_ForGivenSuperpixelStep(planes, labels.ptr<int>(0), 
+            number_of_labels, region_size, compactness, perturb_seeds, iterations, 
+            color_space);
+    
+    if (used_iterations != NULL) {
+        *used_iterations = slic.GetIterations();
+    }
+}
 
-    slic.DoSuperpixelSegmentation_ForGivenSuperpixelStep(image, mat.cols, 
-            mat.rows, segmentation, number_of_labels, region_size, 
-            compactness, perturb_seeds, iterations, color_space);
+bool SLIC_OpenCV::gpuAvailable() {
+    return SLIC::GPUAvailable();
+}
 
-    // Convert labels.
+void SLIC_OpenCV::computeDepthSuperpixels(const cv::Mat &mat, const cv::Mat &cloud, 
+        int region_size, double compactness, int iterations, bool perturb_seeds, 
+        int color_space, cv::Mat &labels) {
+    
     labels.create(mat.rows, mat.cols, CV_32SC1);
-    for (int i = 0; i < mat.rows; ++i) {
-        for (int j = 0; j < mat.cols; ++j) {
-            labels.at<int>(i, j) = segmentation[j + i*mat.cols];
-        }
+    if (!labels.isContinuous()) {
+        labels = cv::Mat(mat.rows, mat.cols, CV_32SC1);
     }
-}
\ No newline at end of file
+    
+    SLIC slic;
+    int number_of_labels = 0;
+    slic.Do3DSupervoxelSegmentation_ForGivenSupervoxelStep(mat.ptr<unsigned char>(0), 
+            mat.step[0], cloud.ptr<float>(0), cloud.step[0], mat.cols, mat.rows, 
+            labels.ptr<int>(0), number_of_labels, region_size, compactness, 
+            perturb_seeds, iterations, color_space);
+}
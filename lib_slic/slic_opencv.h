@@ -33,6 +33,7 @@
 #define	SLIC_OPENCV_H
 
 #include <opencv2/opencv.hpp>
+#include "planar_image.h"
 
 /** \brief Wrapper for running SLIC on OpenCV images.
  * \author David Stutz
@@ -40,16 +41,83 @@
 class SLIC_OpenCV {
 public:
     /** \brief Compute superpixels using SLIC.
-     * \param[in] image image to compute superpixels on
+     * \param[in] image CV_8UC3 image to compute superpixels on, rows are read
+     * without copying the image
      * \param[in] region_size size between superpixels implicitly defining number of superpixels
      * \param[in] compactness compactness parameter
      * \param[in] iterations number of iterations
      * \param[in] perturb_seeds whether to perturb seeds for better performance
      * \param[in] color_space color space to use, > 0 for Lab, 0 for RGB
-     * \param[out] labels superpixel labels
+     * \param[out] labels superpixel labels, written in place
+     * \param[in] threads number of threads, the labels do not depend on it
+     * \param[in] displacement stop before iterations once seeds move at most
+     * this many pixels on average, 0 to always run all iterations
+     * \param[in] changed fraction of pixels allowed to change their label
+     * when stopping early
+     * \param[out] used_iterations if not NULL, number of iterations run
+     * \param[in] preemption fraction of changed labels below which seeds are
+     * not re-assigned (as in preSLIC), 0 to assign all seeds
+     * \param[in] gpu whether to run the iterations on the GPU (see gpuAvailable),
+     * displacement, changed and preemption are ignored on the GPU
+     * \param[in] fixed_point whether to use integer arithmetic on 8-bit
+     * quantized colors, e.g. for targets without fast floating point; 
+     * displacement, changed, preemption and threads are ignored
+     * \param[in] half whether to keep the colors in half precision during
+     * the iterations, halving their memory traffic; ignored with gpu or
+     * fixed_point
      */
     static void computeSuperpixels(const cv::Mat &image, int region_size, 
             double compactness, int iterations, bool perturb_seeds, 
+            int color_space, cv::Mat &labels, int threads = 1, 
+            float displacement = 0, float changed = 0, int* used_iterations = NULL, 
+            float preemption = 0, bool gpu = false, bool fixed_point = false, 
+            bool half = false);
+    
+    /** \brief Compute superpixels using SLIC on planes converted by the caller,
+     * e.g. to reuse one PlanarImage across algorithms or frames.
+     * \param[in] planes LAB planes (RGB for color_space 0), used without copying
+     * if not padded
+     * \param[in] region_size size between superpixels implicitly defining number of superpixels
+     * \param[in] compactness compactness parameter
+     * \param[in] iterations number of iterations
+     * \param[in] perturb_seeds whether to perturb seeds for better performance
+     * \param[in] color_space color space of the planes, > 0 for Lab, 0 for RGB
+     * \param[out] labels superpixel labels, written in place
+     * \param[in] threads number of threads, the labels do not depend on it
+     * \param[in] displacement see above
+     * \param[in] changed see above
+     * \param[out] used_iterations if not NULL, number of iterations run
+     * \param[in] preemption see above
+     * \param[in] gpu see above
+     * \param[in] fixed_point see above
+     * \param[in] half see above
+     */
+    static void computeSuperpixels(const PlanarImage<float> &planes, int region_size, 
+            double compactness, int iterations, bool perturb_seeds, 
+            int color_space, cv::Mat &labels, int threads = 1, 
+            float displacement = 0, float changed = 0, int* used_iterations = NULL, 
+            float preemption = 0, bool gpu = false, bool fixed_point = false, 
+            bool half = false);
+    
+    /** \brief Whether SLIC was built with OpenCL (SLIC_OPENCL) and a GPU was found.
+     * \return whether computeSuperpixels can run on the GPU
+     */
+    static bool gpuAvailable();
+    
+    /** \brief Compute RGB-D superpixels using SLIC on color and point cloud.
+     * \param[in] image CV_8UC3 image to compute superpixels on
+     * \param[in] cloud CV_32FC3 point cloud of the same size, e.g. from
+     * DepthTools::computeCloudFromDepth
+     * \param[in] region_size size between superpixels implicitly defining number of superpixels
+     * \param[in] compactness compactness parameter, weighting the metric
+     * 3D distance against the color distance
+     * \param[in] iterations number of iterations
+     * \param[in] perturb_seeds whether to perturb seeds for better performance
+     * \param[in] color_space color space to use, > 0 for Lab, 0 for RGB
+     * \param[out] labels superpixel labels, written in place
+     */
+    static void computeDepthSuperpixels(const cv::Mat &image, const cv::Mat &cloud, 
+            int region_size, double compactness, int iterations, bool perturb_seeds, 
             int color_space, cv::Mat &labels);
 };
 
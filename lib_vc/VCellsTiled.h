@@ -0,0 +1,720 @@
+#ifndef VCELLS_TILED_H
+#define	VCELLS_TILED_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/** \brief VCells on flat per-pixel arrays with tiled, parallel relabeling
+ * of boundary pixels.
+ *
+ * Runs the same steps as VCells (random initialization, Voronoi region,
+ * classic CVT and EWCVT on boundary pixels) with a different memory layout:
+ * labels and colors are separate arrays, pixels are visited by row and column,
+ * and the counts of neighboring clusters are computed from the labels inside
+ * the disk when a pixel is visited instead of being kept in per-pixel
+ * histograms (which take several KB per pixel in VCells).
+ *
+ * The image is divided into tiles colored in a 2x2 pattern, so tiles of the
+ * same color are one tile apart. The tiles of one color are processed in
+ * parallel. The generators are fixed while one color is processed. Afterwards
+ * the transfers are applied to the generators in tile order, so the result
+ * does not depend on the number of threads.
+ *
+ * After compute, recompute continues from the superpixels found for a
+ * different number of superpixels, such that sweeps over the number of
+ * superpixels do not start from random seeds for every value.
+ * \author David Stutz
+ */
+class VCellsTiled {
+public:
+
+    /** \brief Constructor.
+     * \param[in] num_cluster number of superpixels
+     * \param[in] weight_length weight of the edge energy
+     * \param[in] radius radius of the neighborhood for the edge energy
+     * \param[in] threshold iterate while at least this many pixels are transferred
+     * \param[in] tile_size side length of the tiles, at least radius + 1
+     */
+    VCellsTiled(int num_cluster, double weight_length, int radius, int threshold, int tile_size) :
+            NUM_CLUSTER(num_cluster), WEIGHT_LENGTH(weight_length), RADIUS(radius),
+            THRESHOLD(threshold), TILE_SIZE(tile_size < radius + 1 ? radius + 1 : tile_size),
+            MAX_ITERATIONS(0), PATIENCE(0) {
+
+        if (TILE_SIZE < 2) {
+            TILE_SIZE = 2;
+        }
+    }
+
+    /** \brief Limit the number of iterations of classic CVT and EWCVT each,
+     * in case boundary pixels keep oscillating between superpixels.
+     * \param[in] max_iterations maximum number of iterations, 0 for no limit
+     */
+    void setMaxIterations(int max_iterations) {
+        MAX_ITERATIONS = max_iterations;
+    }
+
+    /** \brief Stop classic CVT and EWCVT early once the number of transferred
+     * pixels has not reached a new minimum for the given number of
+     * iterations; towards the end, a few hundred boundary pixels may keep
+     * oscillating for hundreds of iterations without reaching the threshold.
+     * \param[in] patience number of iterations, 0 to only use the threshold
+     */
+    void setPatience(int patience) {
+        PATIENCE = patience;
+    }
+
+    /** \brief Number of transferred pixels in each iteration of the last call
+     * of compute or recompute, classic CVT iterations first.
+     * \return transferred pixels per iteration
+     */
+    const std::vector<int>& getTransfers() const {
+        return numTransfers;
+    }
+
+    /** \brief Compute superpixels.
+     * \param[in] image interleaved 3-channel image, row major
+     * \param[in] height height of the image
+     * \param[in] width width of the image
+     * \param[out] labels superpixel labels, height*width entries
+     */
+    void compute(const unsigned char* image, int height, int width, int* labels) {
+
+        bmpHeight = height;
+        bmpWidth = width;
+
+        int numPixels = bmpHeight*bmpWidth;
+        label.assign(numPixels, -1);
+        color.resize(3*numPixels);
+        for (int i = 0; i < 3*numPixels; i++) {
+            color[i] = image[i];
+        }
+
+        initializeDisk();
+        initializeTiles();
+        initializeGenerators();
+        VoronoiRegion();
+
+        numTransfers.clear();
+        iterate(false);
+        iterate(true);
+
+        for (int i = 0; i < numPixels; i++) {
+            labels[i] = label[i];
+        }
+    }
+
+    /** \brief Compute superpixels on the image of the last call of compute,
+     * starting from its (or the last recompute's) superpixels. The largest
+     * superpixels are split along their principal axis or the smallest are
+     * merged into their neighbor with the closest mean color; then only
+     * EWCVT is iterated.
+     * \param[in] num_cluster number of superpixels
+     * \param[out] labels superpixel labels, height*width entries
+     */
+    void recompute(int num_cluster, int* labels) {
+
+        if (num_cluster < 1) {
+            num_cluster = 1;
+        }
+
+        while (NUM_CLUSTER < num_cluster) {
+            if (!split(num_cluster - NUM_CLUSTER)) {
+                break;
+            }
+        }
+
+        while (NUM_CLUSTER > num_cluster) {
+            if (!merge(NUM_CLUSTER - num_cluster)) {
+                break;
+            }
+        }
+
+        numTransfers.clear();
+        iterate(true);
+
+        int numPixels = bmpHeight*bmpWidth;
+        for (int i = 0; i < numPixels; i++) {
+            labels[i] = label[i];
+        }
+    }
+
+private:
+
+    /** \brief Sums over the pixels of a generator. */
+    struct Generator {
+        double row;
+        double column;
+        double color[3];
+        int numPixels;
+    };
+
+    /** \brief A pixel moved from one generator to another. */
+    struct Transfer {
+        int row;
+        int column;
+        int oldCluster;
+        int newCluster;
+    };
+
+    /** \brief Offsets of the disk around a pixel, without the pixel itself. */
+    void initializeDisk() {
+        diskRow.clear();
+        diskColumn.clear();
+        diskOffset.clear();
+        for (int i = -RADIUS; i <= RADIUS; i++) {
+            for (int j = -RADIUS; j <= RADIUS; j++) {
+                if ((i != 0 || j != 0) && sqrt((double) i*i + (double) j*j) <= RADIUS) {
+                    diskRow.push_back(i);
+                    diskColumn.push_back(j);
+                    diskOffset.push_back(i*bmpWidth + j);
+                }
+            }
+        }
+    }
+
+    /** \brief Distribute the tiles into the four colors of the 2x2 pattern. */
+    void initializeTiles() {
+        int tilesY = (bmpHeight + TILE_SIZE - 1)/TILE_SIZE;
+        int tilesX = (bmpWidth + TILE_SIZE - 1)/TILE_SIZE;
+
+        for (int c = 0; c < 4; c++) {
+            tiles[c].clear();
+        }
+
+        for (int ty = 0; ty < tilesY; ty++) {
+            for (int tx = 0; tx < tilesX; tx++) {
+                tiles[2*(ty%2) + tx%2].push_back(ty*tilesX + tx);
+            }
+        }
+
+        transfers.resize(tilesY*tilesX);
+    }
+
+    /** \brief Random seeds; the pixels inside a disk around a seed are assigned
+     * to the closest seed covering them. */
+    void initializeGenerators() {
+        int gradius = (int)2*sqrt((double)bmpHeight*bmpWidth/(2*3.1415926*NUM_CLUSTER));
+
+        std::vector<int> refRow;
+        std::vector<int> refColumn;
+        for (int i = -gradius; i <= gradius; i++) {
+            for (int j = -gradius; j <= gradius; j++) {
+                if (sqrt((double) i*i + (double) j*j) <= gradius) {
+                    refRow.push_back(i);
+                    refColumn.push_back(j);
+                }
+            }
+        }
+
+        srand(time(NULL));
+        seedRow.resize(NUM_CLUSTER);
+        seedColumn.resize(NUM_CLUSTER);
+        std::vector<int> tempDist2(bmpHeight*bmpWidth);
+        for (int k = 0; k < NUM_CLUSTER; k++) {
+            seedRow[k] = rand()%bmpHeight;
+            seedColumn[k] = rand()%bmpWidth;
+
+            for (unsigned int n = 0; n < refRow.size(); n++) {
+                int row = seedRow[k] + refRow[n];
+                int column = seedColumn[k] + refColumn[n];
+                if (row < 0 || row >= bmpHeight || column < 0 || column >= bmpWidth) {
+                    continue;
+                }
+
+                int index = row*bmpWidth + column;
+                int dist2 = refRow[n]*refRow[n] + refColumn[n]*refColumn[n];
+                if (label[index] < 0 || dist2 < tempDist2[index]) {
+                    label[index] = k;
+                    tempDist2[index] = dist2;
+                }
+            }
+        }
+    }
+
+    /** \brief Assign the remaining pixels to the nearest seed and compute the
+     * generators. */
+    void VoronoiRegion() {
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int i = 0; i < bmpHeight; i++) {
+            for (int j = 0; j < bmpWidth; j++) {
+                int index = i*bmpWidth + j;
+                if (label[index] >= 0) {
+                    continue;
+                }
+
+                int nearest = 0;
+                int nearestDist2 = -1;
+                for (int k = 0; k < NUM_CLUSTER; k++) {
+                    int dist2 = (i - seedRow[k])*(i - seedRow[k]) + (j - seedColumn[k])*(j - seedColumn[k]);
+                    if (nearestDist2 < 0 || dist2 < nearestDist2) {
+                        nearest = k;
+                        nearestDist2 = dist2;
+                    }
+                }
+
+                label[index] = nearest;
+            }
+        }
+
+        computeGenerators();
+    }
+
+    /** \brief Compute the generators from the labels. */
+    void computeGenerators() {
+        Generator zero = {0, 0, {0, 0, 0}, 0};
+        generators.assign(NUM_CLUSTER, zero);
+        for (int i = 0; i < bmpHeight; i++) {
+            for (int j = 0; j < bmpWidth; j++) {
+                int index = i*bmpWidth + j;
+                Generator &g = generators[label[index]];
+                g.row += i;
+                g.column += j;
+                g.color[0] += color[3*index + 0];
+                g.color[1] += color[3*index + 1];
+                g.color[2] += color[3*index + 2];
+                g.numPixels++;
+            }
+        }
+    }
+
+    /** \brief Split up to count of the largest superpixels in two halves
+     * along their principal axis.
+     * \param[in] count number of superpixels to add
+     * \return whether any superpixel was split
+     */
+    bool split(int count) {
+        std::vector<int> order;
+        for (int k = 0; k < NUM_CLUSTER; k++) {
+            if (generators[k].numPixels > 1) {
+                order.push_back(k);
+            }
+        }
+
+        count = std::min(count, (int) order.size());
+        if (count <= 0) {
+            return false;
+        }
+
+        std::partial_sort(order.begin(), order.begin() + count, order.end(), 
+                LargerCluster(generators));
+
+        // Second moments of the chosen superpixels.
+        std::vector<int> slot(NUM_CLUSTER, -1);
+        std::vector<double> moments(3*count, 0);
+        for (int n = 0; n < count; n++) {
+            slot[order[n]] = n;
+        }
+
+        for (int i = 0; i < bmpHeight; i++) {
+            for (int j = 0; j < bmpWidth; j++) {
+                int n = slot[label[i*bmpWidth + j]];
+                if (n >= 0) {
+                    const Generator &g = generators[order[n]];
+                    double row = i - g.row/g.numPixels;
+                    double column = j - g.column/g.numPixels;
+                    moments[3*n + 0] += row*row;
+                    moments[3*n + 1] += row*column;
+                    moments[3*n + 2] += column*column;
+                }
+            }
+        }
+
+        std::vector<double> axisRow(count);
+        std::vector<double> axisColumn(count);
+        for (int n = 0; n < count; n++) {
+            double angle = 0.5*atan2(2*moments[3*n + 1], moments[3*n + 0] - moments[3*n + 2]);
+            axisRow[n] = cos(angle);
+            axisColumn[n] = sin(angle);
+        }
+
+        // Pixels on the positive side of the axis form the new superpixel.
+        for (int i = 0; i < bmpHeight; i++) {
+            for (int j = 0; j < bmpWidth; j++) {
+                int index = i*bmpWidth + j;
+                int n = slot[label[index]];
+                if (n >= 0) {
+                    const Generator &g = generators[order[n]];
+                    double projection = (i - g.row/g.numPixels)*axisRow[n] 
+                            + (j - g.column/g.numPixels)*axisColumn[n];
+                    if (projection > 0) {
+                        label[index] = NUM_CLUSTER + n;
+                    }
+                }
+            }
+        }
+
+        NUM_CLUSTER += count;
+        computeGenerators();
+        return true;
+    }
+
+    /** \brief Merge up to count of the smallest superpixels into their
+     * neighbor with the closest mean color.
+     * \param[in] count number of superpixels to remove
+     * \return whether any superpixel was merged
+     */
+    bool merge(int count) {
+        count = std::min(count, NUM_CLUSTER/2);
+        if (count <= 0) {
+            return false;
+        }
+
+        std::vector<int> order(NUM_CLUSTER);
+        for (int k = 0; k < NUM_CLUSTER; k++) {
+            order[k] = k;
+        }
+
+        std::partial_sort(order.begin(), order.begin() + count, order.end(), 
+                SmallerCluster(generators));
+
+        // Neighbors of the chosen superpixels.
+        std::vector<int> slot(NUM_CLUSTER, -1);
+        std::vector< std::vector<int> > neighbors(count);
+        for (int n = 0; n < count; n++) {
+            slot[order[n]] = n;
+        }
+
+        for (int i = 0; i < bmpHeight; i++) {
+            for (int j = 0; j < bmpWidth; j++) {
+                int index = i*bmpWidth + j;
+                int current = label[index];
+                int right = j < bmpWidth - 1 ? label[index + 1] : current;
+                int bottom = i < bmpHeight - 1 ? label[index + bmpWidth] : current;
+
+                if (right != current) {
+                    addNeighbor(neighbors, slot, current, right);
+                    addNeighbor(neighbors, slot, right, current);
+                }
+
+                if (bottom != current) {
+                    addNeighbor(neighbors, slot, current, bottom);
+                    addNeighbor(neighbors, slot, bottom, current);
+                }
+            }
+        }
+
+        // Smallest first; chains of merged superpixels are followed.
+        std::vector<int> mergedInto(NUM_CLUSTER);
+        for (int k = 0; k < NUM_CLUSTER; k++) {
+            mergedInto[k] = k;
+        }
+
+        bool merged = false;
+        for (int n = 0; n < count; n++) {
+            int k = order[n];
+            int nearest = -1;
+            double nearestDist = 0;
+            for (unsigned int m = 0; m < neighbors[n].size(); m++) {
+                int neighbor = neighbors[n][m];
+                while (mergedInto[neighbor] != neighbor) {
+                    neighbor = mergedInto[neighbor];
+                }
+
+                if (neighbor == k) {
+                    continue;
+                }
+
+                double dist = 0;
+                for (int d = 0; d < 3; d++) {
+                    double difference = generators[k].color[d]/std::max(1, generators[k].numPixels)
+                            - generators[neighbor].color[d]/std::max(1, generators[neighbor].numPixels);
+                    dist += difference*difference;
+                }
+
+                if (nearest < 0 || dist < nearestDist) {
+                    nearest = neighbor;
+                    nearestDist = dist;
+                }
+            }
+
+            if (nearest >= 0) {
+                mergedInto[k] = nearest;
+                merged = true;
+            }
+        }
+
+        if (!merged) {
+            return false;
+        }
+
+        // Consecutive labels for the remaining superpixels.
+        std::vector<int> relabel(NUM_CLUSTER, -1);
+        int numCluster = 0;
+        for (int k = 0; k < NUM_CLUSTER; k++) {
+            if (mergedInto[k] == k) {
+                relabel[k] = numCluster++;
+            }
+        }
+
+        for (int k = 0; k < NUM_CLUSTER; k++) {
+            int root = k;
+            while (mergedInto[root] != root) {
+                root = mergedInto[root];
+            }
+
+            relabel[k] = relabel[root];
+        }
+
+        int numPixels = bmpHeight*bmpWidth;
+        for (int i = 0; i < numPixels; i++) {
+            label[i] = relabel[label[i]];
+        }
+
+        NUM_CLUSTER = numCluster;
+        computeGenerators();
+        return true;
+    }
+
+    /** \brief Remember neighbor as neighbor of current if current is one of
+     * the superpixels to merge. */
+    void addNeighbor(std::vector< std::vector<int> > &neighbors, 
+            const std::vector<int> &slot, int current, int neighbor) {
+        int n = slot[current];
+        if (n >= 0 && std::find(neighbors[n].begin(), neighbors[n].end(), neighbor) == neighbors[n].end()) {
+            neighbors[n].push_back(neighbor);
+        }
+    }
+
+    /** \brief Orders superpixels by decreasing size. */
+    struct LargerCluster {
+        LargerCluster(const std::vector<Generator> &generators) : generators(generators) {}
+        bool operator()(int k, int l) const {
+            return generators[k].numPixels > generators[l].numPixels;
+        }
+        const std::vector<Generator> &generators;
+    };
+
+    /** \brief Orders superpixels by increasing size. */
+    struct SmallerCluster {
+        SmallerCluster(const std::vector<Generator> &generators) : generators(generators) {}
+        bool operator()(int k, int l) const {
+            return generators[k].numPixels < generators[l].numPixels;
+        }
+        const std::vector<Generator> &generators;
+    };
+
+    /** \brief Sweep until fewer than THRESHOLD pixels are transferred, no new
+     * minimum was reached for PATIENCE sweeps or MAX_ITERATIONS is reached,
+     * recording the transfers of each sweep.
+     * \param[in] ew use the edge-weighted distance (EWCVT) instead of the
+     * spatial distance (classic CVT)
+     */
+    void iterate(bool ew) {
+        int minTransfer = -1;
+        int minIteration = 0;
+        for (int iteration = 0; MAX_ITERATIONS <= 0 || iteration < MAX_ITERATIONS; iteration++) {
+            int numTransfer = sweep(ew);
+            numTransfers.push_back(numTransfer);
+            if (numTransfer < THRESHOLD) {
+                break;
+            }
+
+            if (minTransfer < 0 || numTransfer < minTransfer) {
+                minTransfer = numTransfer;
+                minIteration = iteration;
+            }
+            else if (PATIENCE > 0 && iteration - minIteration >= PATIENCE) {
+                break;
+            }
+        }
+    }
+
+    /** \brief Visit all boundary pixels once, one tile color after the other.
+     * \param[in] ew use the edge-weighted distance (EWCVT) instead of the
+     * spatial distance (classic CVT)
+     * \return number of transferred pixels
+     */
+    int sweep(bool ew) {
+        int numTransfer = 0;
+        for (int c = 0; c < 4; c++) {
+
+#pragma omp parallel
+            {
+                // Transfers of the current tile, added to the shared generators
+                Generator zero = {0, 0, {0, 0, 0}, 0};
+                std::vector<Generator> local(NUM_CLUSTER, zero);
+
+#pragma omp for schedule(dynamic)
+                for (int t = 0; t < (int) tiles[c].size(); t++) {
+                    relabelTile(tiles[c][t], ew, local);
+                }
+            }
+
+            for (unsigned int t = 0; t < tiles[c].size(); t++) {
+                const std::vector<Transfer> &tileTransfers = transfers[tiles[c][t]];
+                for (unsigned int n = 0; n < tileTransfers.size(); n++) {
+                    updateGenerator(generators, tileTransfers[n]);
+                }
+
+                numTransfer += tileTransfers.size();
+            }
+        }
+
+        return numTransfer;
+    }
+
+    /** \brief Relabel the boundary pixels of a tile in raster order; the
+     * generators are read from the shared sums and the tile's own transfers
+     * in local, which is zero again on return. */
+    void relabelTile(int tile, bool ew, std::vector<Generator> &local) {
+
+        int tilesX = (bmpWidth + TILE_SIZE - 1)/TILE_SIZE;
+        int iFrom = (tile/tilesX)*TILE_SIZE;
+        int jFrom = (tile%tilesX)*TILE_SIZE;
+        int iTo = iFrom + TILE_SIZE < bmpHeight ? iFrom + TILE_SIZE : bmpHeight;
+        int jTo = jFrom + TILE_SIZE < bmpWidth ? jFrom + TILE_SIZE : bmpWidth;
+
+        std::vector<Transfer> &tileTransfers = transfers[tile];
+        tileTransfers.clear();
+
+        // Clusters inside the disk, current cluster first, and their
+        // number of pixels (without the pixel itself).
+        int numDisk = diskRow.size();
+        std::vector<int> candidates(numDisk + 1);
+        std::vector<int> counts(numDisk + 1);
+
+        for (int i = iFrom; i < iTo; i++) {
+            bool rowInside = (i >= RADIUS && i < bmpHeight - RADIUS);
+            for (int j = jFrom; j < jTo; j++) {
+                int index = i*bmpWidth + j;
+                int current = label[index];
+
+                bool isOnBoundary = (i > 0 && label[index - bmpWidth] != current)
+                        || (j < bmpWidth - 1 && label[index + 1] != current)
+                        || (i < bmpHeight - 1 && label[index + bmpWidth] != current)
+                        || (j > 0 && label[index - 1] != current);
+                if (!isOnBoundary) {
+                    continue;
+                }
+
+                candidates[0] = current;
+                counts[0] = 0;
+                int numCandidates = 1;
+                int numNeiPixels = 0;
+                bool inside = rowInside && j >= RADIUS && j < bmpWidth - RADIUS;
+                for (int n = 0; n < numDisk; n++) {
+                    int neiCluster;
+                    if (inside) {
+                        neiCluster = label[index + diskOffset[n]];
+                    } else {
+                        int row = i + diskRow[n];
+                        int column = j + diskColumn[n];
+                        if (row < 0 || row >= bmpHeight || column < 0 || column >= bmpWidth) {
+                            continue;
+                        }
+
+                        neiCluster = label[row*bmpWidth + column];
+                    }
+
+                    numNeiPixels++;
+                    int m = 0;
+                    while (m < numCandidates && candidates[m] != neiCluster) {
+                        m++;
+                    }
+
+                    if (m == numCandidates) {
+                        candidates[m] = neiCluster;
+                        counts[m] = 0;
+                        numCandidates++;
+                    }
+
+                    counts[m]++;
+                }
+
+                if (numCandidates == 1) {
+                    continue;
+                }
+
+                int nearest = current;
+                double nearestDist = 0;
+                for (int m = 0; m < numCandidates; m++) {
+                    const Generator &g = generators[candidates[m]];
+                    const Generator &l = local[candidates[m]];
+                    int numPixels = g.numPixels + l.numPixels;
+
+                    double dist;
+                    if (ew) {
+                        dist = 2*WEIGHT_LENGTH*(numNeiPixels - counts[m]);
+                        for (int d = 0; d < 3; d++) {
+                            double mean = numPixels > 0 ? (g.color[d] + l.color[d])/numPixels : 0;
+                            dist += (mean - color[3*index + d])*(mean - color[3*index + d]);
+                        }
+                    } else {
+                        double row = numPixels > 0 ? (g.row + l.row)/numPixels : -1;
+                        double column = numPixels > 0 ? (g.column + l.column)/numPixels : -1;
+                        dist = (i - row)*(i - row) + (j - column)*(j - column);
+                    }
+
+                    if (m == 0 || dist < nearestDist) {
+                        nearest = candidates[m];
+                        nearestDist = dist;
+                    }
+                }
+
+                if (nearest != current) {
+                    label[index] = nearest;
+
+                    Transfer transfer = {i, j, current, nearest};
+                    tileTransfers.push_back(transfer);
+                    updateGenerator(local, transfer);
+                }
+            }
+        }
+
+        Generator zero = {0, 0, {0, 0, 0}, 0};
+        for (unsigned int n = 0; n < tileTransfers.size(); n++) {
+            local[tileTransfers[n].oldCluster] = zero;
+            local[tileTransfers[n].newCluster] = zero;
+        }
+    }
+
+    /** \brief Move the pixel of a transfer between the generators. */
+    void updateGenerator(std::vector<Generator> &g, const Transfer &transfer) {
+        int index = transfer.row*bmpWidth + transfer.column;
+        Generator &from = g[transfer.oldCluster];
+        Generator &to = g[transfer.newCluster];
+
+        from.row -= transfer.row;
+        from.column -= transfer.column;
+        to.row += transfer.row;
+        to.column += transfer.column;
+        for (int d = 0; d < 3; d++) {
+            from.color[d] -= color[3*index + d];
+            to.color[d] += color[3*index + d];
+        }
+
+        from.numPixels--;
+        to.numPixels++;
+    }
+
+    int NUM_CLUSTER;
+    double WEIGHT_LENGTH;
+    int RADIUS;
+    int THRESHOLD;
+    int TILE_SIZE;
+    int MAX_ITERATIONS;
+    int PATIENCE;
+
+    int bmpHeight;
+    int bmpWidth;
+
+    std::vector<int> label;
+    std::vector<double> color;
+    std::vector<int> diskRow;
+    std::vector<int> diskColumn;
+    std::vector<int> diskOffset;
+    std::vector<int> seedRow;
+    std::vector<int> seedColumn;
+    std::vector<Generator> generators;
+    std::vector<int> tiles[4];
+    std::vector< std::vector<Transfer> > transfers;
+    std::vector<int> numTransfers;
+};
+
+#endif	/* VCELLS_TILED_H */
@@ -33,6 +33,7 @@
 #define	VC_OPENCV__H
 
 #include "VCells.h"
+#include "VCellsTiled.h"
 #include <opencv2/opencv.hpp>
 
 /** \brief Wrapper for running VC on OpenCV images.
@@ -97,6 +98,63 @@ public:
 	delete[] pixelArray;
 	delete[] generators;
     }
+    
+    /** \brief Compute superpixels using VCellsTiled, boundary pixels are
+     * relabeled tile by tile in parallel.
+     * \param[in] image image to compute superpixels on
+     * \param[in] superpixels numberof superpixels
+     * \param[in] weight_length weight length parameter, see paper
+     * \param[in] radius radius parameter, see paper
+     * \param[in] threshold see paper
+     * \param[in] tile_size side length of the tiles
+     * \param[in] patience stop iterating once the number of relabeled pixels
+     * did not reach a new minimum for this many iterations, 0 to only use
+     * the threshold
+     * \param[out] labels superpixel labels
+     */
+    static void computeSuperpixelsTiled(const cv::Mat &image, int superpixels, 
+            double weight_length, int radius, int threshold, int tile_size, 
+            int patience, cv::Mat &labels) {
+        
+        VCellsTiled vc(superpixels, weight_length, radius, threshold, tile_size);
+        vc.setPatience(patience);
+        computeSuperpixelsTiled(vc, image, labels);
+    }
+    
+    /** \brief Compute superpixels using the given VCellsTiled, which can
+     * afterwards continue with a different number of superpixels using
+     * recomputeSuperpixelsTiled.
+     * \param[in] vc VCellsTiled with the number of superpixels and parameters
+     * \param[in] image image to compute superpixels on
+     * \param[out] labels superpixel labels
+     */
+    static void computeSuperpixelsTiled(VCellsTiled &vc, const cv::Mat &image, 
+            cv::Mat &labels) {
+        
+        cv::Mat continuous_image = image;
+        if (!image.isContinuous()) {
+            continuous_image = image.clone();
+        }
+        
+        labels.create(image.rows, image.cols, CV_32SC1);
+        vc.compute(continuous_image.ptr<unsigned char>(0), image.rows, image.cols, 
+                labels.ptr<int>(0));
+    }
+    
+    /** \brief Continue from the previous superpixels of vc with a different
+     * number of superpixels, see VCellsTiled::recompute; for sweeps over the
+     * number of superpixels.
+     * \param[in] vc VCellsTiled used on image before
+     * \param[in] image image the superpixels were computed on
+     * \param[in] superpixels number of superpixels
+     * \param[out] labels superpixel labels
+     */
+    static void recomputeSuperpixelsTiled(VCellsTiled &vc, const cv::Mat &image, 
+            int superpixels, cv::Mat &labels) {
+        
+        labels.create(image.rows, image.cols, CV_32SC1);
+        vc.recompute(superpixels, labels.ptr<int>(0));
+    }
 };
 
 #endif	/* VC_OPENCV__H */
@@ -33,58 +33,69 @@
 #include <pcl/point_types.h>
 #include <pcl/features/normal_3d.h>
 #include <pcl/features/integral_image_normal.h>
-#include <pcl/visualization/pcl_visualizer.h>
 #include <pcl/segmentation/supervoxel_clustering.h>
 #include "vccs_opencv_pcl.h"
 
+/** \brief PCL point cloud reused across frames by VCCS_OpenCV_PCL. */
+struct VCCS_OpenCV_PCL_Cloud {
+    pcl::PointCloud<pcl::PointXYZRGBA>::Ptr cloud;
+};
+
+VCCS_OpenCV_PCL::VCCS_OpenCV_PCL(float voxel_resolution_, float seed_resolution_, 
+        float spatial_weight_, float normal_weight_, bool use_transform_) :
+        voxel_resolution(voxel_resolution_), seed_resolution(seed_resolution_),
+        spatial_weight(spatial_weight_), normal_weight(normal_weight_),
+        use_transform(use_transform_), point_cloud(new VCCS_OpenCV_PCL_Cloud()) {
+    
+    point_cloud->cloud.reset(new pcl::PointCloud<pcl::PointXYZRGBA>);
+}
+
+VCCS_OpenCV_PCL::~VCCS_OpenCV_PCL() {
+    delete point_cloud;
+}
+
 void VCCS_OpenCV_PCL::computeSuperpixels(const cv::Mat &image, const cv::Mat &cloud, 
         float voxel_resolution, float seed_resolution, float spatial_weight, 
         float normal_weight, bool use_transform, cv::Mat &labels) {
     
-    // Convert to point cloud:
-//    pcl::PointCloud<pcl::PointXYZRGBA>::Ptr point_cloud(new pcl::PointCloud<pcl::PointXYZRGBA>);
-//    point_cloud->height = cloud.rows;
-//    point_cloud->width = cloud.cols;
-//    point_cloud->is_dense = true;
-//    point_cloud->resize(point_cloud->height*point_cloud->width);
-//    
-//    for (int i = 0; i < cloud.rows; ++i) {
-//        for (int j = 0; j < cloud.cols; ++j) {
-//            pcl::PointXYZRGBA point;
-//            
-//            // x,y,z coordinates are in meters, but depth is given in meters*1000.
-//            point.x = cloud.at<cv::Vec3f>(i, j)[0];
-//            point.y = cloud.at<cv::Vec3f>(i, j)[1];
-//            point.z = cloud.at<cv::Vec3f>(i, j)[2];
-//            
-//            point.r = image.at<cv::Vec3b>(i, j)[2];
-//            point.g = image.at<cv::Vec3b>(i, j)[1];
-//            point.b = image.at<cv::Vec3b>(i, j)[0];
-//            
-//            // Note that row and column are switched here.
-//            (*point_cloud)(j, i) = point;
-//        }
-//    }
+    VCCS_OpenCV_PCL vccs(voxel_resolution, seed_resolution, spatial_weight, 
+            normal_weight, use_transform);
+    vccs.computeNextSuperpixels(image, cloud, labels);
+}
 
-    pcl::PointCloud<pcl::PointXYZRGBA>::Ptr point_cloud(new pcl::PointCloud<pcl::PointXYZRGBA>);
+void VCCS_OpenCV_PCL::computeNextSuperpixels(const cv::Mat &image, 
+        const cv::Mat &cloud, cv::Mat &labels) {
+    
+    // The cloud is unorganized with one point per pixel in row major order,
+    // as if the points were pushed back one by one; resize is a no-op
+    // as long as the frame size does not change.
+    pcl::PointCloud<pcl::PointXYZRGBA>::Ptr point_cloud = this->point_cloud->cloud;
+    point_cloud->resize(cloud.rows*cloud.cols);
+    point_cloud->width = cloud.rows*cloud.cols;
+    point_cloud->height = 1;
+    point_cloud->is_dense = true;
+    
+    pcl::PointXYZRGBA* points = &point_cloud->points[0];
     for (int i = 0; i < cloud.rows; ++i) {
+        const cv::Vec3f* cloud_row = cloud.ptr<cv::Vec3f>(i);
+        const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+        
         for (int j = 0; j < cloud.cols; ++j) {
-            pcl::PointXYZRGBA point;
-
+            pcl::PointXYZRGBA &point = points[i*cloud.cols + j];
+            
             // x,y,z coordinates are in meters, but depth is given in meters*1000.
-            point.x = cloud.at<cv::Vec3f>(i, j)[0];
-            point.y = cloud.at<cv::Vec3f>(i, j)[1];
-            point.z = cloud.at<cv::Vec3f>(i, j)[2];
-
-            point.r = image.at<cv::Vec3b>(i, j)[2];
-            point.g = image.at<cv::Vec3b>(i, j)[1];
-            point.b = image.at<cv::Vec3b>(i, j)[0];
-
-            // Note that row and column are switched here.
-            point_cloud->push_back(point);
+            point.x = cloud_row[j][0];
+            point.y = cloud_row[j][1];
+            point.z = cloud_row[j][2];
+            
+            point.r = image_row[j][2];
+            point.g = image_row[j][1];
+            point.b = image_row[j][0];
         }
     }
     
+    // The clustering is not reused: its adjacency octree would keep the 
+    // voxels of earlier frames.
     pcl::SupervoxelClustering<pcl::PointXYZRGBA> super(voxel_resolution, seed_resolution, 
             use_transform);
     super.setInputCloud(point_cloud);
@@ -96,41 +107,16 @@ void VCCS_OpenCV_PCL::computeSuperpixels(const cv::Mat &image, const cv::Mat &cl
     
     std::map<uint32_t, pcl::Supervoxel<pcl::PointXYZRGBA>::Ptr> supervoxel_clusters;
     super.extract(supervoxel_clusters);
-
-    int index = 0;
+    
+    // The labeled cloud has the order of the input cloud, i.e. row major.
     pcl::PointCloud<pcl::PointXYZL>::Ptr label_cloud = super.getLabeledCloud();
-    pcl::PointXYZL label;
-
-        labels.create(cloud.rows, cloud.cols, CV_32SC1);
-        for (int i = 0; i < image.rows; ++i) {
-            for (int j = 0; j < image.cols; ++j) {
-//                if (depth.at<unsigned short>(i, j) > 0) {
-                    label = (*label_cloud).at(index);
-//                    label = (*label_cloud)(j, i);
-                    labels.at<int>(i, j) = label.label;
-                    index++;
-                    
-//                    if (labels[i][j] > maxLabel) {
-//                        maxLabel = labels[i][j];
-//                    }
-//                }
-            }
+    const pcl::PointXYZL* label_points = &label_cloud->points[0];
+    
+    labels.create(cloud.rows, cloud.cols, CV_32SC1);
+    for (int i = 0; i < cloud.rows; ++i) {
+        int* labels_row = labels.ptr<int>(i);
+        for (int j = 0; j < cloud.cols; ++j) {
+            labels_row[j] = label_points[i*cloud.cols + j].label;
         }
-
-//z    boost::shared_ptr<pcl::visualization::PCLVisualizer> viewer(new pcl::visualization::PCLVisualizer ("3D Viewer"));
-//    viewer->setBackgroundColor(0, 0, 0);
-//    viewer->addPointCloud(point_cloud, "point cloud");
-//
-//    pcl::PointCloud<pcl::PointXYZRGBA>::Ptr voxel_centroid_cloud = super.getVoxelCentroidCloud();
-//    viewer->addPointCloud(voxel_centroid_cloud, "voxel centroids");
-//    viewer->setPointCloudRenderingProperties(pcl::visualization::PCL_VISUALIZER_POINT_SIZE,2.0, "voxel centroids");
-//    viewer->setPointCloudRenderingProperties(pcl::visualization::PCL_VISUALIZER_OPACITY,0.95, "voxel centroids");
-//
-//    pcl::PointCloud<pcl::PointXYZRGBA>::Ptr colored_voxel_cloud = super.getColoredCloud();
-//    viewer->addPointCloud(colored_voxel_cloud, "colored voxels");
-//    viewer->setPointCloudRenderingProperties (pcl::visualization::PCL_VISUALIZER_OPACITY,0.8, "colored voxels");
-//
-//    while (!viewer->wasStopped()) {
-//        viewer->spinOnce(100);
-//    }
-}
\ No newline at end of file
+    }
+}
@@ -34,11 +34,35 @@
 
 #include <opencv2/opencv.hpp>
 
+struct VCCS_OpenCV_PCL_Cloud;
+
 /** \brief Wrapper for running PCL on OpenCV images given the point cloud as OpenCV image.
+ * 
+ * Besides the static computeSuperpixels, an instance can be used for a sequence
+ * of frames: the PCL point cloud is allocated once and overwritten in place as 
+ * long as the frame size does not change.
  * \author David Stutz
  */
 class VCCS_OpenCV_PCL {
 public:
+    /** \brief Constructor, see computeSuperpixels for the parameters.
+     */
+    VCCS_OpenCV_PCL(float voxel_resolution, float seed_resolution, 
+            float spatial_weight, float normal_weight, bool use_transform);
+    
+    /** \brief Destructor.
+     */
+    ~VCCS_OpenCV_PCL();
+    
+    /** \brief Compute superpixels on the next frame, reusing the point cloud
+     * of the previous frame.
+     * \param[in] image image to compute superpixels on
+     * \param[in] cloud point cloud to compute superpixels in
+     * \param[out] labels superpixel labels after backprojection to the image plane
+     */
+    void computeNextSuperpixels(const cv::Mat &image, const cv::Mat &cloud, 
+            cv::Mat &labels);
+    
     /** \brief Compute superpixels using VCCS. 
      * \param[in] image image to compute superpixels on
      * \param[in] cloud point cloud to compute superpixels in
@@ -52,6 +76,21 @@ public:
     static void computeSuperpixels(const cv::Mat &image, const cv::Mat &cloud, 
             float voxel_resolution, float seed_resolution, float spatial_weight, 
             float normal_weight, bool use_transform, cv::Mat &labels);
+    
+private:
+    
+    VCCS_OpenCV_PCL(const VCCS_OpenCV_PCL&);
+    VCCS_OpenCV_PCL& operator=(const VCCS_OpenCV_PCL&);
+    
+    /** \brief Parameters of the clustering. */
+    float voxel_resolution;
+    float seed_resolution;
+    float spatial_weight;
+    float normal_weight;
+    bool use_transform;
+    
+    /** \brief PCL point cloud of the previous frame, kept out of the header. */
+    VCCS_OpenCV_PCL_Cloud* point_cloud;
 };
 
 #endif	/* VCCS_OPENCV_PCL_H */
@@ -189,6 +189,35 @@ vl_slic_segment_t (vl_uint32 * segmentation,
                  float regularization,
                  vl_size minRegionSize,
                  vl_size maxNumIterations)
+{
+    vl_slic_segment_p(segmentation, image, width, height, numChannels, regionSize, regularization, minRegionSize, maxNumIterations, 0) ;
+}
+
+/** @brief SLIC superpixel segmentation with active regions
+ ** @param maxNumIterations maximum number of k-means iterations.
+ ** @param preemption fraction of changed labels below which regions are
+ ** not updated, 0 to update all regions.
+ **
+ ** Same as ::vl_slic_segment, with the preemption (active region) scheme
+ ** of preSLIC: after each iteration, the changed labels in the 3 x 3 tiles
+ ** around each region are counted; if they are less than @a preemption
+ ** times the area of these tiles, the region is inactive and pixels all
+ ** of whose 2 x 2 candidate regions are inactive keep their label and
+ ** distance. The iterations stop once less than @a preemption times the
+ ** number of pixels changed their label.
+ **/
+
+void
+vl_slic_segment_p (vl_uint32 * segmentation,
+                 float const * image,
+                 vl_size width,
+                 vl_size height,
+                 vl_size numChannels,
+                 vl_size regionSize,
+                 float regularization,
+                 vl_size minRegionSize,
+                 vl_size maxNumIterations,
+                 float preemption)
 {
   vl_index i, x, y, u, v, k, region ;
   vl_uindex iter ;
@@ -201,6 +230,10 @@ vl_slic_segment_t (vl_uint32 * segmentation,
   float previousEnergy = VL_INFINITY_F ;
   float startingEnergy ;
   vl_uint32 * masses ;
+  float * distances = NULL ;
+  vl_uint32 * changes = NULL ;
+  vl_bool * active = NULL ;
+  vl_size numChanges ;
 //  vl_size const maxNumIterations = 100 ;
 
   assert(segmentation) ;
@@ -210,6 +243,7 @@ vl_slic_segment_t (vl_uint32 * segmentation,
   assert(numChannels >= 1) ;
   assert(regionSize >= 1) ;
   assert(regularization >= 0) ;
+  assert(preemption >= 0) ;
 
 #define atimage(x,y,k) image[(x)+(y)*width+(k)*width*height]
 #define atEdgeMap(x,y) edgeMap[(x)+(y)*width]
@@ -218,6 +252,13 @@ vl_slic_segment_t (vl_uint32 * segmentation,
   masses = vl_malloc(sizeof(vl_uint32) * numPixels) ;
   centers = vl_malloc(sizeof(float) * (2 + numChannels) * numRegions) ;
 
+  if (preemption > 0) {
+    distances = vl_malloc(sizeof(float) * numPixels) ;
+    changes = vl_malloc(sizeof(vl_uint32) * numRegions) ;
+    active = vl_malloc(sizeof(vl_bool) * numRegions) ;
+    for (region = 0 ; region < (signed)numRegions ; ++region) active[region] = VL_TRUE ;
+  }
+
   /* compute edge map (gradient strength) */
   for (k = 0 ; k < (signed)numChannels ; ++k) {
     for (y = 1 ; y < (signed)height-1 ; ++y) {
@@ -272,6 +313,10 @@ vl_slic_segment_t (vl_uint32 * segmentation,
   for (iter = 0 ; iter < maxNumIterations ; ++iter) {
     float factor = regularization / (regionSize * regionSize) ;
     float energy = 0 ;
+    numChanges = 0 ;
+    if (preemption > 0) {
+      memset(changes, 0, sizeof(vl_uint32) * numRegions) ;
+    }
     
     /* assign pixels to centers */
     for (y = 0 ; y < (signed)height ; ++y) {
@@ -280,6 +325,21 @@ vl_slic_segment_t (vl_uint32 * segmentation,
         vl_index v = floor((double)y / regionSize - 0.5) ;
         vl_index up, vp ;
         float minDistance = VL_INFINITY_F ;
+        vl_uint32 previousRegion = (preemption > 0 && iter > 0) ? segmentation[x + y * width] : 0 ;
+
+        /* skip pixels whose candidate regions are all inactive */
+        if (preemption > 0 && iter > 0) {
+          vl_bool skip = VL_TRUE ;
+          for (vp = VL_MAX(0, v) ; vp <= VL_MIN((signed)numRegionsY-1, v+1) ; ++vp) {
+            for (up = VL_MAX(0, u) ; up <= VL_MIN((signed)numRegionsX-1, u+1) ; ++up) {
+              if (active[up + vp * numRegionsX]) skip = VL_FALSE ;
+            }
+          }
+          if (skip) {
+            energy += distances[x + y * width] ;
+            continue ;
+          }
+        }
 
         for (vp = VL_MAX(0, v) ; vp <= VL_MIN((signed)numRegionsY-1, v+1) ; ++vp) {
           for (up = VL_MAX(0, u) ; up <= VL_MIN((signed)numRegionsX-1, u+1) ; ++up) {
@@ -302,6 +362,15 @@ vl_slic_segment_t (vl_uint32 * segmentation,
           }
         }
         energy += minDistance ;
+
+        if (preemption > 0) {
+          distances[x + y * width] = minDistance ;
+          if (iter == 0 || segmentation[x + y * width] != previousRegion) {
+            changes[VL_MIN(x / (signed)regionSize, (signed)numRegionsX-1)
+                    + VL_MIN(y / (signed)regionSize, (signed)numRegionsY-1) * numRegionsX] ++ ;
+            numChanges ++ ;
+          }
+        }
       }
     }
 
@@ -344,6 +413,32 @@ vl_slic_segment_t (vl_uint32 * segmentation,
         centers[i] /= mass ;
       }
     }
+
+    /* deactivate regions with few changes in the 3 x 3 neighbouring tiles */
+    if (preemption > 0) {
+      vl_index const minChanges = preemption * 9 * regionSize * regionSize ;
+      if (numChanges < preemption * numPixels) {
+        break ;
+      }
+      for (v = 0 ; v < (signed)numRegionsY ; ++v) {
+        for (u = 0 ; u < (signed)numRegionsX ; ++u) {
+          vl_index up, vp ;
+          vl_size neighbourChanges = 0 ;
+          for (vp = VL_MAX(0, v-1) ; vp <= VL_MIN((signed)numRegionsY-1, v+1) ; ++vp) {
+            for (up = VL_MAX(0, u-1) ; up <= VL_MIN((signed)numRegionsX-1, u+1) ; ++up) {
+              neighbourChanges += changes[up + vp * numRegionsX] ;
+            }
+          }
+          active[u + v * numRegionsX] = ((signed)neighbourChanges >= minChanges) ;
+        }
+      }
+    }
+  }
+
+  if (preemption > 0) {
+    vl_free(distances) ;
+    vl_free(changes) ;
+    vl_free(active) ;
   }
 
   vl_free(masses) ;
@@ -37,5 +37,17 @@ vl_slic_segment_t (vl_uint32 * segmentation,
                  vl_size minRegionSize,
                  vl_size maxNumIterations) ;
 
+VL_EXPORT void
+vl_slic_segment_p (vl_uint32 * segmentation,
+                 float const * image,
+                 vl_size width,
+                 vl_size height,
+                 vl_size numChannels,
+                 vl_size regionSize,
+                 float regularization,
+                 vl_size minRegionSize,
+                 vl_size maxNumIterations,
+                 float preemption) ;
+
 /* VL_SLIC_H */
 #endif
@@ -46,9 +46,12 @@ public:
      * \param[in] regularization compactness parameter
      * \param[in] min_region_size minimum size of superpixels
      * \param[out] superpixel labels
+     * \param[in] preemption fraction of changed labels below which regions
+     * are not updated (as in preSLIC), 0 to update all regions
      */
     static void computeSuperpixels(const cv::Mat &mat, int region_size, 
-            double regularization, int min_region_size, int iterations, cv::Mat &labels)
+            double regularization, int min_region_size, int iterations, cv::Mat &labels, 
+            double preemption = 0)
     {
         // Convert image to one-dimensional array.
         float* image = new float[mat.rows*mat.cols*mat.channels()];
@@ -70,8 +73,8 @@ public:
         vl_size width = mat.cols;
         vl_size channels = mat.channels();
         
-        vl_slic_segment_t(segmentation, image, width, height, channels, region_size, 
-                regularization, min_region_size, iterations);
+        vl_slic_segment_p(segmentation, image, width, height, channels, region_size, 
+                regularization, min_region_size, iterations, preemption);
         
         // Convert segmentation.
         labels.create(mat.rows, mat.cols, CV_32SC1);
@@ -0,0 +1,293 @@
+#ifndef WP_OPENCV_H
+#define	WP_OPENCV_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/** \brief Waterpixels (m-waterpixels on square cells) in C++ following
+ * demo_waterpixels_smil_with_parser.py:
+ *
+ * - morphological gradient (3x3 cross) of the green channel;
+ * - one marker per grid cell (cells shrunk by a margin of step/6): the flat
+ *   zone of the lowest gradient value in the cell;
+ * - the gradient is regularized by adding weight*2/step times the chessboard
+ *   distance to the markers;
+ * - watershed from the markers on the regularized uint8 gradient using a
+ *   hierarchical queue with 256 levels and 4-connectivity.
+ *
+ * Unlike the demo, the input image is not area filtered and the marker of a
+ * cell is its lowest minimum instead of the minimum with the largest area
+ * extinction value.
+ * \author David Stutz
+ */
+class WP_OpenCV {
+public:
+    /** \brief Compute waterpixels.
+     * \param[in] image image to compute superpixels on, CV_8UC3
+     * \param[in] step grid step, i.e. distance between two cell centers
+     * \param[in] weight weight of the distance function, 0 for no regularization
+     * \param[out] labels superpixel labels, CV_32SC1
+     */
+    static void computeSuperpixels(const cv::Mat &image, int step,
+            double weight, cv::Mat &labels) {
+
+        cv::Mat gradient;
+        computeGradient(image, gradient);
+
+        cv::Mat markers;
+        computeMarkers(gradient, step, markers);
+
+        if (weight > 0) {
+            regularizeGradient(markers, weight*2/step, gradient);
+        }
+
+        computeWatershed(gradient, markers, labels);
+    }
+
+    /** \brief Morphological gradient with a 3x3 cross of the green channel.
+     * \param[in] image image, CV_8UC3 or CV_8UC1
+     * \param[out] gradient gradient, CV_8UC1
+     */
+    static void computeGradient(const cv::Mat &image, cv::Mat &gradient) {
+
+        cv::Mat gray;
+        if (image.channels() == 3) {
+            cv::extractChannel(image, gray, 1);
+        }
+        else {
+            gray = image;
+        }
+
+        cv::Mat cross = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(3, 3));
+        cv::morphologyEx(gray, gradient, cv::MORPH_GRADIENT, cross);
+    }
+
+    /** \brief Select one marker per grid cell.
+     * \param[in] gradient gradient, CV_8UC1
+     * \param[in] step grid step
+     * \param[out] markers labels of the markers starting at 1, 0 elsewhere, CV_32SC1
+     */
+    static void computeMarkers(const cv::Mat &gradient, int step, cv::Mat &markers) {
+
+        markers.create(gradient.rows, gradient.cols, CV_32SC1);
+        markers.setTo(0);
+
+        int margin = step/6;
+        std::vector<int> stack;
+
+        int label = 1;
+        for (int y = 0; y < gradient.rows; y += step) {
+            for (int x = 0; x < gradient.cols; x += step) {
+                int x0 = x + margin;
+                int y0 = y + margin;
+                int x1 = std::min(x + step - margin, gradient.cols);
+                int y1 = std::min(y + step - margin, gradient.rows);
+
+                if (x0 >= x1 || y0 >= y1) {
+                    continue;
+                }
+
+                int min_x = x0;
+                int min_y = y0;
+                uchar min = gradient.at<uchar>(y0, x0);
+                for (int i = y0; i < y1; i++) {
+                    const uchar* row = gradient.ptr<uchar>(i);
+                    for (int j = x0; j < x1; j++) {
+                        if (row[j] < min) {
+                            min = row[j];
+                            min_x = j;
+                            min_y = i;
+                        }
+                    }
+                }
+
+                // Flat zone of the minimum inside the cell, 4-connected.
+                markers.at<int>(min_y, min_x) = label;
+                stack.push_back(min_y*gradient.cols + min_x);
+                while (!stack.empty()) {
+                    int i = stack.back()/gradient.cols;
+                    int j = stack.back()%gradient.cols;
+                    stack.pop_back();
+
+                    const int di[4] = {-1, 1, 0, 0};
+                    const int dj[4] = {0, 0, -1, 1};
+                    for (int k = 0; k < 4; k++) {
+                        int ii = i + di[k];
+                        int jj = j + dj[k];
+                        if (ii >= y0 && ii < y1 && jj >= x0 && jj < x1
+                                && markers.at<int>(ii, jj) == 0
+                                && gradient.at<uchar>(ii, jj) == min) {
+                            markers.at<int>(ii, jj) = label;
+                            stack.push_back(ii*gradient.cols + jj);
+                        }
+                    }
+                }
+
+                label++;
+            }
+        }
+    }
+
+    /** \brief Add the weighted chessboard distance to the markers to the gradient,
+     * saturating at 255.
+     * \param[in] markers markers, CV_32SC1
+     * \param[in] weight factor of the distance
+     * \param[in,out] gradient gradient, CV_8UC1
+     */
+    static void regularizeGradient(const cv::Mat &markers, double weight,
+            cv::Mat &gradient) {
+
+        const int rows = markers.rows;
+        const int cols = markers.cols;
+        const int unreached = rows + cols;
+
+        // Two pass chessboard distance transform.
+        std::vector<int> distance(rows*cols);
+        for (int i = 0; i < rows; i++) {
+            const int* markers_row = markers.ptr<int>(i);
+            int* row = &distance[i*cols];
+            for (int j = 0; j < cols; j++) {
+                if (markers_row[j] > 0) {
+                    row[j] = 0;
+                    continue;
+                }
+
+                int d = unreached;
+                if (j > 0) {
+                    d = std::min(d, row[j - 1] + 1);
+                }
+                if (i > 0) {
+                    const int* above = row - cols;
+                    d = std::min(d, above[j] + 1);
+                    if (j > 0) {
+                        d = std::min(d, above[j - 1] + 1);
+                    }
+                    if (j < cols - 1) {
+                        d = std::min(d, above[j + 1] + 1);
+                    }
+                }
+                row[j] = d;
+            }
+        }
+
+        for (int i = rows - 1; i >= 0; i--) {
+            int* row = &distance[i*cols];
+            for (int j = cols - 1; j >= 0; j--) {
+                int d = row[j];
+                if (j < cols - 1) {
+                    d = std::min(d, row[j + 1] + 1);
+                }
+                if (i < rows - 1) {
+                    const int* below = row + cols;
+                    d = std::min(d, below[j] + 1);
+                    if (j > 0) {
+                        d = std::min(d, below[j - 1] + 1);
+                    }
+                    if (j < cols - 1) {
+                        d = std::min(d, below[j + 1] + 1);
+                    }
+                }
+                row[j] = d;
+            }
+        }
+
+        // As in the demo, the distance is an 8 bit image before weighting.
+        uchar lookup[256];
+        for (int d = 0; d < 256; d++) {
+            lookup[d] = cv::saturate_cast<uchar>(d*weight);
+        }
+
+        for (int i = 0; i < rows; i++) {
+            const int* row = &distance[i*cols];
+            uchar* gradient_row = gradient.ptr<uchar>(i);
+            for (int j = 0; j < cols; j++) {
+                gradient_row[j] = cv::saturate_cast<uchar>(gradient_row[j]
+                        + lookup[std::min(row[j], 255)]);
+            }
+        }
+    }
+
+    /** \brief Watershed from markers (flooding without watershed lines) using
+     * a hierarchical queue.
+     * \param[in] gradient gradient, CV_8UC1
+     * \param[in] markers markers starting at 1, 0 elsewhere, CV_32SC1
+     * \param[out] labels labels starting at 0, CV_32SC1
+     */
+    static void computeWatershed(const cv::Mat &gradient, const cv::Mat &markers,
+            cv::Mat &labels) {
+
+        const int rows = markers.rows;
+        const int cols = markers.cols;
+
+        std::vector<int> label(rows*cols);
+        std::vector<uchar> level(rows*cols);
+        for (int i = 0; i < rows; i++) {
+            const int* markers_row = markers.ptr<int>(i);
+            const uchar* gradient_row = gradient.ptr<uchar>(i);
+            for (int j = 0; j < cols; j++) {
+                label[i*cols + j] = markers_row[j] - 1;
+                level[i*cols + j] = gradient_row[j];
+            }
+        }
+
+        // One FIFO per gray level; a pixel is labeled when it is queued, so
+        // every pixel is queued at most once.
+        std::vector< std::vector<int> > queues(256);
+        for (int p = 0; p < rows*cols; p++) {
+            if (label[p] < 0) {
+                continue;
+            }
+
+            int i = p/cols;
+            int j = p%cols;
+            if ((i > 0 && label[p - cols] < 0) || (i < rows - 1 && label[p + cols] < 0)
+                    || (j > 0 && label[p - 1] < 0) || (j < cols - 1 && label[p + 1] < 0)) {
+                queues[level[p]].push_back(p);
+            }
+        }
+
+        for (int current = 0; current < 256; current++) {
+            std::vector<int> &queue = queues[current];
+            for (unsigned int head = 0; head < queue.size(); head++) {
+                int p = queue[head];
+                int i = p/cols;
+                int j = p%cols;
+
+                int neighbors[4];
+                int count = 0;
+                if (i > 0) {
+                    neighbors[count++] = p - cols;
+                }
+                if (i < rows - 1) {
+                    neighbors[count++] = p + cols;
+                }
+                if (j > 0) {
+                    neighbors[count++] = p - 1;
+                }
+                if (j < cols - 1) {
+                    neighbors[count++] = p + 1;
+                }
+
+                for (int k = 0; k < count; k++) {
+                    int q = neighbors[k];
+                    if (label[q] < 0) {
+                        label[q] = label[p];
+                        queues[std::max<int>(level[q], current)].push_back(q);
+                    }
+                }
+            }
+
+            std::vector<int>().swap(queue);
+        }
+
+        labels.create(rows, cols, CV_32SC1);
+        for (int i = 0; i < rows; i++) {
+            int* labels_row = labels.ptr<int>(i);
+            for (int j = 0; j < cols; j++) {
+                labels_row[j] = std::max(label[i*cols + j], 0);
+            }
+        }
+    }
+};
+
+#endif	/* WP_OPENCV_H */
@@ -30,13 +30,16 @@
  */
 
 #include <fstream>
+#include <algorithm>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "lsc_opencv.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
+#include "thread_pool.h"
 #include "visualization.h"
 
 /** \brief Command line tool for running LSC.
@@ -46,7 +49,11 @@
  *   Allowed options:
  *     -h [ --help ]                         produce help message
  *     -i [ --input ] arg                    the folder to process
- *     -s [ --superpixels ] arg (=400)       number of superpixels
+ *     -s [ --superpixels ] arg (=400)       numbers of superpixels, the
+ *                                           feature mapping of the colors is
+ *                                           shared between them; with several
+ *                                           numbers the outputs go to one
+ *                                           subdirectory per number
  *     -c [ --ratio ] arg (=0.074999999999999997)
  *                                           compactness ratio = color weight / 
  *                                           spatial weight
@@ -59,6 +66,18 @@
  *     -o [ --csv ] arg                      save segmentation as CSV file
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
+ *     --memory                              write per image allocations and
+ *                                           peak memory to memory.csv next to
+ *                                           runtime.txt
+ *     --png                                 write segmentations as 16-bit
+ *                                           PNG instead of CSV
+ *     --hierarchy arg                       numbers of superpixels derived by
+ *                                           merging superpixels hierarchically,
+ *                                           written to one subdirectory of
+ *                                           --csv per number
+ *     -j [ --threads ] arg (=1)             number of threads to relabel
+ *                                           connected components on the shared
+ *                                           pool
  *     -w [ --wordy ]                        verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -69,7 +88,7 @@ int main(int argc, const char** argv) {
     desc.add_options()
         ("help,h", "produce help message")
         ("input,i", boost::program_options::value<std::string>(), "the folder to process")
-        ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixels")
+        ("superpixels,s", boost::program_options::value<std::vector<int>>()->multitoken()->default_value(std::vector<int>{400}, "400"), "numbers of superpixels, the feature mapping of the colors is shared between them; with several numbers the outputs go to one subdirectory per number")
         ("ratio,c", boost::program_options::value<double>()->default_value(0.075), "compactness ratio = color weight / spatial weight")
         ("iterations,t", boost::program_options::value<int>()->default_value(20), "number of iterations to perform")
         ("threshold,g", boost::program_options::value<int>()->default_value(4), "threshold coefficient")
@@ -78,6 +97,10 @@ int main(int argc, const char** argv) {
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("hierarchy", boost::program_options::value<std::vector<int>>()->multitoken(), "numbers of superpixels derived by merging superpixels hierarchically, written to one subdirectory of --csv per number")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads to relabel connected components on the shared pool")
         ("wordy,w", "verbose/wordy/debug");
 
     boost::program_options::positional_options_description positionals;
@@ -92,6 +115,14 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -113,13 +144,53 @@ int main(int argc, const char** argv) {
     }
     
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
         wordy = true;
     }
     
-    int superpixels = parameters["superpixels"].as<int>();
+    std::vector<int> hierarchy;
+    if (parameters.find("hierarchy") != parameters.end()) {
+        hierarchy = parameters["hierarchy"].as<std::vector<int>>();
+    }
+    
+    for (unsigned int k = 0; k < hierarchy.size(); ++k) {
+        if (hierarchy[k] <= 0) {
+            std::cout << "Numbers of superpixels for --hierarchy need to be positive." << std::endl;
+            return 1;
+        }
+        
+        if (!output_dir.empty() && !boost::filesystem::is_directory(output_dir / std::to_string(hierarchy[k]))) {
+            boost::filesystem::create_directories(output_dir / std::to_string(hierarchy[k]));
+        }
+    }
+    
+    std::vector<int> superpixels = parameters["superpixels"].as<std::vector<int>>();
+    for (unsigned int k = 0; k < superpixels.size(); ++k) {
+        if (superpixels[k] <= 0) {
+            std::cout << "Number of superpixels needs to be positive." << std::endl;
+            return 1;
+        }
+    }
+    
+    // A single number keeps the flat output layout
+    std::vector<std::string> sub_dirs(superpixels.size(), "");
+    if (superpixels.size() > 1) {
+        for (unsigned int k = 0; k < superpixels.size(); ++k) {
+            sub_dirs[k] = std::to_string(superpixels[k]);
+            
+            if (!output_dir.empty() && !boost::filesystem::is_directory(output_dir / sub_dirs[k])) {
+                boost::filesystem::create_directories(output_dir / sub_dirs[k]);
+            }
+            
+            if (!vis_dir.empty() && !boost::filesystem::is_directory(vis_dir / sub_dirs[k])) {
+                boost::filesystem::create_directories(vis_dir / sub_dirs[k]);
+            }
+        }
+    }
+    
     double ratio = parameters["ratio"].as<double>();
     int iterations = parameters["iterations"].as<int>();
     int threshold = parameters["threshold"].as<int>();
@@ -136,54 +207,77 @@ int main(int argc, const char** argv) {
     IOUtil::readDirectory(input_dir, extensions, images);
     
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
-        cv::Mat image = cv::imread(it->first);
-        cv::Mat labels;
+        memory_profile.begin(prefix + it->second.stem().string());
         
-        int region_width;
-        int region_height;
-        SuperpixelTools::computeHeightWidthFromSuperpixels(image, superpixels,
-                region_height, region_width);
+        cv::Mat image = cv::imread(it->first);
         
-        // If a fair comparison is requested:
-        if (parameters.find("fair") != parameters.end()) {
-            region_width = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
-                    superpixels);
-            region_height = region_width;
+        std::vector<int> region_widths(superpixels.size());
+        std::vector<int> region_heights(superpixels.size());
+        for (unsigned int k = 0; k < superpixels.size(); ++k) {
+            SuperpixelTools::computeHeightWidthFromSuperpixels(image, superpixels[k],
+                    region_heights[k], region_widths[k]);
+
+            // If a fair comparison is requested:
+            if (parameters.find("fair") != parameters.end()) {
+                region_widths[k] = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                        superpixels[k]);
+                region_heights[k] = region_widths[k];
+            }
         }
         
-        boost::timer timer;
-        LSC_OpenCV::computeSuperpixels(image, region_height, region_width, ratio, 
+        RuntimeHarness::Timer timer;
+        std::vector<cv::Mat> labels;
+        LSC_OpenCV::computeSuperpixels(image, region_heights, region_widths, ratio, 
                 iterations, threshold, color_space, labels);
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
-        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
-//        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
-        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
-        SuperpixelTools::relabelSuperpixels(labels);
-        
-        if (wordy) {
-            std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
-                    << " (" << unconnected_components << " not connected; " 
-                    << merged_components << " merged; "
-                    << elapsed <<")." << std::endl;
-        }
-        
-        if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+        for (unsigned int k = 0; k < labels.size(); ++k) {
+            int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels[k], threads);
+//            int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels[k], 5);
+            int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels[k], unconnected_components);
+            SuperpixelTools::relabelSuperpixels(labels[k]);
+
+            if (wordy) {
+                std::cout << SuperpixelTools::countSuperpixels(labels[k]) << " superpixels for " << it->first 
+                        << " (" << unconnected_components << " not connected; " 
+                        << merged_components << " merged; "
+                        << elapsed <<")." << std::endl;
+            }
+
+            if (!output_dir.empty()) {
+                boost::filesystem::path label_file(output_dir / sub_dirs[k]
+                        / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+                IOUtil::writeLabels(label_file, labels[k]);
+            }
+
+            if (!vis_dir.empty()) {
+                boost::filesystem::path contours_file(vis_dir / sub_dirs[k]
+                        / boost::filesystem::path(prefix + it->second.stem().string() + ".png"));
+                cv::Mat image_contours;
+                Visualization::drawContours(image, labels[k], image_contours);
+                cv::imwrite(contours_file.string(), image_contours);
+            }
         }
         
-        if (!vis_dir.empty()) {
-            boost::filesystem::path contours_file(vis_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".png"));
-            cv::Mat image_contours;
-            Visualization::drawContours(image, labels, image_contours);
-            cv::imwrite(contours_file.string(), image_contours);
+        if (!output_dir.empty() && !hierarchy.empty()) {
+            // Merging starts from the finest segmentation.
+            unsigned int finest = std::max_element(superpixels.begin(), superpixels.end()) 
+                    - superpixels.begin();
+            
+            std::vector<cv::Mat> hierarchy_labels;
+            SuperpixelTools::computeHierarchy(image, labels[finest], hierarchy, hierarchy_labels);
+            
+            for (unsigned int k = 0; k < hierarchy.size(); ++k) {
+                boost::filesystem::path hierarchy_file(output_dir / std::to_string(hierarchy[k])
+                        / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+                IOUtil::writeLabels(hierarchy_file, hierarchy_labels[k]);
+            }
         }
     }
     
@@ -197,6 +291,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
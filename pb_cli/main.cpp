@@ -33,9 +33,11 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "pb_opencv.h"
+#include "QPBO_MaxFlow.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -51,10 +53,19 @@
  *     -g [ --sigma ] arg (=20)        balancing the weight between regular shape 
  *                                     and accurate edge
  *     -m [ --max-flow ] arg (=0)      use max flow algorithm instead of elimination
+ *     -f [ --warm-start ]             with max flow, start from the flow of the 
+ *                                     previous image (of the same size)
+ *     -j [ --threads ] arg (=1)       number of threads per image, with more 
+ *                                     than one the horizontal and vertical 
+ *                                     strip problems are solved concurrently
  *     -o [ --csv ] arg                specify the output directory (default is 
  *                                     ./output)
  *     -v [ --vis ] arg                visualize contours
  *     -x [ --prefix ] arg             output file prefix
+ *     --memory                        write per image allocations and peak
+ *                                     memory to memory.csv next to runtime.txt
+ *     --png                           write segmentations as 16-bit PNG
+ *                                     instead of CSV
  *     -w [ --wordy ]                  verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -68,9 +79,13 @@ int main(int argc, const char** argv) {
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixels")
         ("sigma,g", boost::program_options::value<float>()->default_value(20), "balancing the weight between regular shape and accurate edge")
         ("max-flow,m", boost::program_options::value<int>()->default_value(0), "use max flow algorithm instead of elimination")
+        ("warm-start,f", "with max flow, start from the flow of the previous image (of the same size)")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads per image, with more than one the horizontal and vertical strip problems are solved concurrently")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "specify the output directory (default is ./output)")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
         ("wordy,w", "verbose/wordy/debug");
         
     boost::program_options::positional_options_description positionals;
@@ -106,6 +121,7 @@ int main(int argc, const char** argv) {
     }
 
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
@@ -117,25 +133,51 @@ int main(int argc, const char** argv) {
     int max_flow_int = parameters["max-flow"].as<int>();
     bool max_flow = max_flow_int > 0 ? true : false;
     
+    bool warm_start = false;
+    if (parameters.find("warm-start") != parameters.end()) {
+        warm_start = true;
+    }
+    
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    // The max flow graphs are kept across images of the same size.
+    MaxFlowQPBOSolver horizontal;
+    MaxFlowQPBOSolver vertical;
+    
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(input_dir, extensions, images);
     
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         cv::Mat labels;
         
         int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
                 superpixels);
         
-        boost::timer timer;
-        PB_OpenCV::computeSuperpixels(image, region_size, sigma, max_flow, labels);
+        RuntimeHarness::Timer timer;
+        if (max_flow) {
+            PB_OpenCV::computeSuperpixels(image, region_size, sigma, horizontal, 
+                    vertical, warm_start, labels, threads);
+        }
+        else {
+            PB_OpenCV::computeSuperpixels(image, region_size, sigma, max_flow, 
+                    labels, threads);
+        }
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
         int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
 //        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
@@ -150,9 +192,9 @@ int main(int argc, const char** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
         }
         
         if (!vis_dir.empty()) {
@@ -174,6 +216,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
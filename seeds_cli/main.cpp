@@ -33,9 +33,11 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "seeds2.h"
 #include "io_util.h"
+#include "frame_stream.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -57,13 +59,30 @@
  *     -m [ --means ] arg (=1)               use mean pixel updates: > 0 for yes, = 
  *                                           0 for no
  *     -t [ --iterations ] arg (=2)          iterations at each level
+ *     --time-budget-ms arg (=0)             time budget per image in 
+ *                                           milliseconds, iterations stop once 
+ *                                           it is exceeded; 0 = unlimited
  *     -r [ --color-space ] arg (=1)         color space: 0 = RGB, 1 = Lab, 2 = HSV
+ *     -j [ --threads ] arg (=1)             number of threads for pixel updates,
+ *                                           > 1 updates tiles concurrently
  *     -f [ --fair ]                         for a fair comparison with other 
  *                                           algorithms, quadratic blocks are used 
  *                                           for initialization
  *     -o [ --csv ] arg                      save segmentation as CSV file
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
+ *     --memory                              write per image allocations and
+ *                                           peak memory to memory.csv next to
+ *                                           runtime.txt
+ *     --png                                 write segmentations as 16-bit
+ *                                           PNG instead of CSV
+ *     --stream arg                          read raw BGR frames of size WIDTHxHEIGHT
+ *                                           instead of images and write label maps
+ *                                           in the binary label format
+ *     --stream-input arg (=-)               frames: - for stdin or shm:name for a
+ *                                           shared memory ring
+ *     --stream-output arg (=-)              label maps: - for stdout or shm:name for
+ *                                           a shared memory ring
  *     -w [ --wordy ]                        verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -80,11 +99,18 @@ int main(int argc, const char** argv) {
         ("prior,p", boost::program_options::value<int>()->default_value(1), "use prior: > 0 for prior, = 0 for non prior")
         ("means,m", boost::program_options::value<int>()->default_value(1), "use mean pixel updates: > 0 for yes, = 0 for no")
         ("iterations,t", boost::program_options::value<int>()->default_value(2), "iterations at each level")
+        ("time-budget-ms", boost::program_options::value<double>()->default_value(0), "time budget per image in milliseconds, iterations stop once it is exceeded; 0 = unlimited")
         ("color-space,r", boost::program_options::value<int>()->default_value(1), "color space: 0 = RGB, 1 = Lab, 2 = HSV")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads for pixel updates, > 1 updates tiles concurrently")
         ("fair,f", "for a fair comparison with other algorithms, quadratic blocks are used for initialization")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("stream", boost::program_options::value<std::string>(), "read raw BGR frames of size WIDTHxHEIGHT instead of images and write label maps in the binary label format")
+        ("stream-input", boost::program_options::value<std::string>()->default_value("-"), "frames: - for stdin or shm:name for a shared memory ring")
+        ("stream-output", boost::program_options::value<std::string>()->default_value("-"), "label maps: - for stdout or shm:name for a shared memory ring")
         ("wordy,w", "verbose/wordy/debug");
         
     boost::program_options::positional_options_description positionals;
@@ -113,13 +139,21 @@ int main(int argc, const char** argv) {
         }
     }
     
-    boost::filesystem::path input_dir(parameters["input"].as<std::string>());
-    if (!boost::filesystem::is_directory(input_dir)) {
+    // Frames are read from --stream-input instead of the image directory.
+    bool stream_frames = (parameters.find("stream") != parameters.end());
+    
+    boost::filesystem::path input_dir;
+    if (parameters.find("input") != parameters.end()) {
+        input_dir = boost::filesystem::path(parameters["input"].as<std::string>());
+    }
+    
+    if (!stream_frames && !boost::filesystem::is_directory(input_dir)) {
         std::cout << "Image directory not found ..." << std::endl;
         return 1;
     }
     
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
@@ -141,15 +175,115 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    double time_budget = parameters["time-budget-ms"].as<double>();
+    if (time_budget < 0) {
+        std::cout << "Time budget needs to be non-negative." << std::endl;
+        return 1;
+    }
+    
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    if (stream_frames) {
+        cv::Size frame_size;
+        if (!FrameStream::parseSize(parameters["stream"].as<std::string>(), frame_size)) {
+            std::cout << "Frame size for --stream needs to be given as WIDTHxHEIGHT." << std::endl;
+            return 1;
+        }
+        
+        std::string stream_input = parameters["stream-input"].as<std::string>();
+        std::string stream_output = parameters["stream-output"].as<std::string>();
+        
+        FrameStream stream;
+        if (!stream.open(stream_input, stream_output, frame_size)) {
+            std::cout << "Could not open " << stream_input << " or " << stream_output << "." << std::endl;
+            return 1;
+        }
+        
+        // Label maps may go to stdout, so messages go to stderr.
+        std::ostream &log = (FrameStream::isStdout(stream_output) ? std::cerr : std::cout);
+        
+        // All frames have the same size, so one SEEDS instance is used throughout.
+        SEEDS stream_seeds(frame_size.width, frame_size.height, 3, bins, 0, 
+                confidence, prior, means, color_space);
+        stream_seeds.set_threads(threads);
+        
+        float stream_total = 0;
+        cv::Mat frame;
+        cv::Mat labels(frame_size.height, frame_size.width, CV_32SC1);
+        while (stream.read(frame)) {
+            int region_width = 2;
+            int region_height = 2;
+            int levels = 2;
+            
+            if (parameters.find("fair") != parameters.end()) {
+                SuperpixelTools::computeRegionSizeLevels(frame, superpixels, 
+                        region_width, levels);
+                region_height = region_width;
+            }
+            else {
+                SuperpixelTools::computeHeightWidthLevelsFromSuperpixels(frame, 
+                        superpixels, region_height, region_width, levels);
+            }
+            
+            RuntimeHarness::Timer timer;
+            stream_seeds.initialize(frame, region_width, region_height, levels);
+            if (time_budget > 0) {
+                double used = 1000*timer.elapsed();
+                stream_seeds.iterate(iterations, time_budget - used);
+            }
+            else {
+                stream_seeds.iterate(iterations);
+            }
+            float elapsed = timer.elapsed();
+            stream_total += elapsed;
+            
+            for (int i = 0; i < frame.rows; ++i) {
+                for (int j = 0; j < frame.cols; ++j) {
+                    labels.at<int>(i, j) = stream_seeds.labels[levels - 1][j + frame.cols*i];
+                }
+            }
+            
+            SuperpixelTools::relabelConnectedSuperpixels(labels);
+            if (!stream.write(labels)) {
+                log << "Could not write labels of frame " << stream.getCount() << "." << std::endl;
+                return 1;
+            }
+            
+            if (wordy) {
+                log << SuperpixelTools::countSuperpixels(labels) << " superpixels for frame " 
+                        << stream.getCount() << " (" << elapsed << ")." << std::endl;
+            }
+        }
+        
+        if (wordy && stream.getCount() > 0) {
+            log << "Average time: " << stream_total / stream.getCount() << "." << std::endl;
+        }
+        
+        return 0;
+    }
+    
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(input_dir, extensions, images);
     
+    // One SEEDS instance is kept as long as the image size does not change,
+    // such that all its buffers are reused.
+    SEEDS* seeds = NULL;
+    int seeds_cols = 0;
+    int seeds_rows = 0;
+    
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         
         int region_width = 2;
@@ -166,18 +300,33 @@ int main(int argc, const char** argv) {
                     superpixels, region_height, region_width, levels);
         }
         
-        boost::timer timer;
-        SEEDS seeds(image.cols, image.rows, image.channels(), bins, 0, 
-                confidence, prior, means, color_space);
-        seeds.initialize(image, region_width, region_height, levels);
-        seeds.iterate(iterations);
+        RuntimeHarness::Timer timer;
+        if (seeds == NULL || seeds_cols != image.cols || seeds_rows != image.rows) {
+            delete seeds;
+            seeds = new SEEDS(image.cols, image.rows, image.channels(), bins, 0, 
+                    confidence, prior, means, color_space);
+            seeds_cols = image.cols;
+            seeds_rows = image.rows;
+            seeds->set_threads(threads);
+        }
+        
+        seeds->initialize(image, region_width, region_height, levels);
+        if (time_budget > 0) {
+            // The budget includes the initialization.
+            double used = 1000*timer.elapsed();
+            seeds->iterate(iterations, time_budget - used);
+        }
+        else {
+            seeds->iterate(iterations);
+        }
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
         cv::Mat labels(image.rows, image.cols, CV_32SC1, cv::Scalar(0));
         for (int i = 0; i < image.rows; ++i) {
             for (int j = 0; j < image.cols; ++j) {
-                labels.at<int>(i, j) = seeds.labels[levels - 1][j + image.cols*i];
+                labels.at<int>(i, j) = seeds->labels[levels - 1][j + image.cols*i];
             }
         }
         
@@ -190,9 +339,9 @@ int main(int argc, const char** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
         }
         
         if (!vis_dir.empty()) {
@@ -204,6 +353,8 @@ int main(int argc, const char** argv) {
         }
     }
     
+    delete seeds;
+    
     if (wordy) {
         std::cout << "Average time: " << total / images.size() << "." << std::endl;
     }
@@ -214,6 +365,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
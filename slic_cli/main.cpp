@@ -33,11 +33,14 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include <bitset>
 #include "slic_opencv.h"
 #include "io_util.h"
+#include "frame_stream.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
+#include "depth_tools.h"
 #include "visualization.h"
 
 /** \brief Command line tool for running SEEDS.
@@ -48,15 +51,66 @@
  *     -h [ --help ]                   produce help message
  *     -i [ --input ] arg              the folder to process (can also be passed as 
  *                                     positional argument)
+ *     -d [ --depth ] arg              the depth folder to process, runs RGB-D 
+ *                                     SLIC on the point clouds when given
+ *     --intrinsics arg                directory containing intrinsic matrices
+ *                                     (as CSV files); when set, 
+ *                                     --principal-x/y and --focal are 
+ *                                     overwritten
+ *     --principal-x arg (=325.582458) principal point x coordinate (default 
+ *                                     for NYUV2)
+ *     --principal-y arg (=253.73616)  principal point y coordinate (default 
+ *                                     for NYUV2)
+ *     --cropping-x arg (=16)          size of cropped border in x (default 
+ *                                     for cropped NYUV2)
+ *     --cropping-y arg (=16)          size of cropped border in x (default 
+ *                                     for cropped NYUV2)
+ *     --focal-x arg (=518.85791)      focal length in x (default for NYUV2)
+ *     --focal-y arg (=519.469604)     focal length in y (default for NYUV2)
  *     -s [ --superpixels ] arg (=400) number of superpixles
  *     -c [ --compactness ] arg (=40)  compactness
  *     -p [ --perturb-seeds ] arg (=1) perturb seeds: > 0 yes, = 0 no
  *     -t [ --iterations ] arg (=10)   iterations
+ *     --tolerance arg (=0)            stop early once seeds move at most this 
+ *                                     many pixels on average, 0 = fixed 
+ *                                     iterations
+ *     --label-tolerance arg (=0.01)   fraction of labels allowed to change when 
+ *                                     stopping early
+ *     --preemption arg (=0)           skip seeds with less than this fraction of 
+ *                                     changed labels, 0 = off
  *     -r [ --color-space ] arg (=1)   color space: 0 = RGB, > 0 = Lab
+ *     -j [ --threads ] arg (=1)       number of threads per image
+ *     --device arg (=cpu)             device for the iterations: cpu or gpu 
+ *                                     (requires lib_slic built with 
+ *                                     SLIC_OPENCL)
+ *     --fixed-point                   use integer arithmetic on 8-bit 
+ *                                     quantized colors (e.g. for embedded 
+ *                                     targets)
+ *     --half                          store the color planes in half 
+ *                                     precision during the iterations
  *     -o [ --csv ] arg                specify the output directory (default is 
  *                                     ./output)
  *     -v [ --vis ] arg                visualize contours
  *     -x [ --prefix ] arg             output file prefix
+ *     --memory                        write per image allocations and peak
+ *                                     memory to memory.csv next to runtime.txt
+ *     --png                           write segmentations as 16-bit PNG
+ *                                     instead of CSV
+ *     --adaptive arg (=0)             use between this fraction of 
+ *                                     --superpixels (simple images) and 
+ *                                     --superpixels (complex images) per image,
+ *                                     written to superpixels.csv next to 
+ *                                     runtime.txt; 0 = off
+ *     --hierarchy arg                 numbers of superpixels derived by merging
+ *                                     superpixels hierarchically, written to
+ *                                     one subdirectory of --csv per number
+ *     --stream arg                    read raw BGR frames of size WIDTHxHEIGHT
+ *                                     instead of images and write label maps
+ *                                     in the binary label format
+ *     --stream-input arg (=-)         frames: - for stdin or shm:name for a
+ *                                     shared memory ring
+ *     --stream-output arg (=-)        label maps: - for stdout or shm:name for
+ *                                     a shared memory ring
  *     -w [ --wordy ]                  verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -67,14 +121,36 @@ int main(int argc, const char** argv) {
     desc.add_options()
         ("help,h", "produce help message")
         ("input,i", boost::program_options::value<std::string>(), "the folder to process (can also be passed as positional argument)")
+        ("depth,d", boost::program_options::value<std::string>()->default_value(""), "the depth folder to process, runs RGB-D SLIC on the point clouds when given")
+        ("intrinsics", boost::program_options::value<std::string>()->default_value(""), "directory containing intrinsic matrices (as CSV files); when set, --principal-x/y and --focal are overwritten")
+        ("principal-x", boost::program_options::value<float>()->default_value(325.582449), "principal point x coordinate (default for NYUV2)")
+        ("principal-y", boost::program_options::value<float>()->default_value(253.736166), "principal point y coordinate (default for NYUV2)")
+        ("cropping-x", boost::program_options::value<float>()->default_value(16), "size of cropped border in x (default for cropped NYUV2)")
+        ("cropping-y", boost::program_options::value<float>()->default_value(16), "size of cropped border in x (default for cropped NYUV2)")
+        ("focal-x", boost::program_options::value<float>()->default_value(518.857901), "focal length in x (default for NYUV2)")
+        ("focal-y", boost::program_options::value<float>()->default_value(519.469611), "focal length in y (default for NYUV2)")
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixles")
         ("compactness,c", boost::program_options::value<double>()->default_value(40.), "compactness")
         ("perturb-seeds,p", boost::program_options::value<int>()->default_value(1), "perturb seeds: > 0 yes, = 0 no")
         ("iterations,t", boost::program_options::value<int>()->default_value(10), "iterations")
+        ("tolerance", boost::program_options::value<float>()->default_value(0.f), "stop early once seeds move at most this many pixels on average, 0 = fixed iterations")
+        ("label-tolerance", boost::program_options::value<float>()->default_value(0.01f), "fraction of labels allowed to change when stopping early")
+        ("preemption", boost::program_options::value<float>()->default_value(0.f), "skip seeds with less than this fraction of changed labels, 0 = off")
         ("color-space,r", boost::program_options::value<int>()->default_value(1), "color space: 0 = RGB, > 0 = Lab")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads per image")
+        ("device", boost::program_options::value<std::string>()->default_value("cpu"), "device for the iterations: cpu or gpu (requires lib_slic built with SLIC_OPENCL)")
+        ("fixed-point", "use integer arithmetic on 8-bit quantized colors (e.g. for embedded targets)")
+        ("half", "store the color planes in half precision during the iterations")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "specify the output directory (default is ./output)")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("adaptive", boost::program_options::value<float>()->default_value(0.f), "use between this fraction of --superpixels (simple images) and --superpixels (complex images) per image, written to superpixels.csv next to runtime.txt; 0 = off")
+        ("hierarchy", boost::program_options::value<std::vector<int>>()->multitoken(), "numbers of superpixels derived by merging superpixels hierarchically, written to one subdirectory of --csv per number")
+        ("stream", boost::program_options::value<std::string>(), "read raw BGR frames of size WIDTHxHEIGHT instead of images and write label maps in the binary label format")
+        ("stream-input", boost::program_options::value<std::string>()->default_value("-"), "frames: - for stdin or shm:name for a shared memory ring")
+        ("stream-output", boost::program_options::value<std::string>()->default_value("-"), "label maps: - for stdout or shm:name for a shared memory ring")
         ("wordy,w", "verbose/wordy/debug");
         
     boost::program_options::positional_options_description positionals;
@@ -103,59 +179,311 @@ int main(int argc, const char** argv) {
         }
     }
     
-    boost::filesystem::path input_dir(parameters["input"].as<std::string>());
-    if (!boost::filesystem::is_directory(input_dir)) {
+    // Frames are read from --stream-input instead of the image directory.
+    bool stream_frames = (parameters.find("stream") != parameters.end());
+    
+    boost::filesystem::path input_dir;
+    if (parameters.find("input") != parameters.end()) {
+        input_dir = boost::filesystem::path(parameters["input"].as<std::string>());
+    }
+    
+    if (!stream_frames && !boost::filesystem::is_directory(input_dir)) {
         std::cout << "Image directory not found ..." << std::endl;
         return 1;
     }
     
+    boost::filesystem::path depth_dir(parameters["depth"].as<std::string>());
+    if (!depth_dir.empty() && !boost::filesystem::is_directory(depth_dir)) {
+        std::cout << "Depth directory not found ..." << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path intrinsics_dir(parameters["intrinsics"].as<std::string>());
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
         wordy = true;
     }
     
+    std::vector<int> hierarchy;
+    if (parameters.find("hierarchy") != parameters.end()) {
+        hierarchy = parameters["hierarchy"].as<std::vector<int>>();
+    }
+    
+    for (unsigned int k = 0; k < hierarchy.size(); ++k) {
+        if (hierarchy[k] <= 0) {
+            std::cout << "Numbers of superpixels for --hierarchy need to be positive." << std::endl;
+            return 1;
+        }
+        
+        if (!output_dir.empty() && !boost::filesystem::is_directory(output_dir / std::to_string(hierarchy[k]))) {
+            boost::filesystem::create_directories(output_dir / std::to_string(hierarchy[k]));
+        }
+    }
+    
     int superpixels = parameters["superpixels"].as<int>();
+    
+    // The number of superpixels is scaled per image by its complexity.
+    float adaptive = parameters["adaptive"].as<float>();
+    if (adaptive < 0 || adaptive > 1) {
+        std::cout << "--adaptive needs to be in [0,1]." << std::endl;
+        return 1;
+    }
+    
     double compactness = parameters["compactness"].as<double>();
     int iterations = parameters["iterations"].as<int>();
     int perturb_seeds_int = parameters["perturb-seeds"].as<int>();
     bool perturb_seeds = perturb_seeds_int > 0 ? true : false;
     int color_space = parameters["color-space"].as<int> ();
     
+    float tolerance = parameters["tolerance"].as<float>();
+    float label_tolerance = parameters["label-tolerance"].as<float>();
+    float preemption = parameters["preemption"].as<float>();
+    if (tolerance < 0 || label_tolerance < 0 || preemption < 0) {
+        std::cout << "Tolerances and preemption threshold need to be non-negative." << std::endl;
+        return 1;
+    }
+    
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    std::string device = parameters["device"].as<std::string>();
+    if (device != "cpu" && device != "gpu") {
+        std::cout << "Device needs to be cpu or gpu." << std::endl;
+        return 1;
+    }
+    
+    bool gpu = (device == "gpu");
+    if (gpu && !SLIC_OpenCV::gpuAvailable()) {
+        std::cout << "No GPU available, build lib_slic with SLIC_OPENCL." << std::endl;
+        return 1;
+    }
+    
+    bool fixed_point = (parameters.find("fixed-point") != parameters.end());
+    if (fixed_point && gpu) {
+        std::cout << "--fixed-point cannot be combined with --device gpu." << std::endl;
+        return 1;
+    }
+    
+    bool half = (parameters.find("half") != parameters.end());
+    if (half && (fixed_point || gpu)) {
+        std::cout << "--half cannot be combined with --fixed-point or --device gpu." << std::endl;
+        return 1;
+    }
+    
+    if (gpu && !depth_dir.empty()) {
+        std::cout << "RGB-D SLIC is not available on the GPU." << std::endl;
+        return 1;
+    }
+    
+    if (stream_frames) {
+        if (!depth_dir.empty()) {
+            std::cout << "--stream cannot be combined with --depth." << std::endl;
+            return 1;
+        }
+        
+        cv::Size frame_size;
+        if (!FrameStream::parseSize(parameters["stream"].as<std::string>(), frame_size)) {
+            std::cout << "Frame size for --stream needs to be given as WIDTHxHEIGHT." << std::endl;
+            return 1;
+        }
+        
+        std::string stream_input = parameters["stream-input"].as<std::string>();
+        std::string stream_output = parameters["stream-output"].as<std::string>();
+        
+        FrameStream stream;
+        if (!stream.open(stream_input, stream_output, frame_size)) {
+            std::cout << "Could not open " << stream_input << " or " << stream_output << "." << std::endl;
+            return 1;
+        }
+        
+        // Label maps may go to stdout, so messages go to stderr.
+        std::ostream &log = (FrameStream::isStdout(stream_output) ? std::cerr : std::cout);
+        
+        float stream_total = 0;
+        cv::Mat frame;
+        while (stream.read(frame)) {
+            cv::Mat labels;
+            int used_iterations = 0;
+            
+            RuntimeHarness::Timer timer;
+            int frame_superpixels = superpixels;
+            if (adaptive > 0) {
+                frame_superpixels = SuperpixelTools::computeAdaptiveSuperpixels(superpixels, 
+                        adaptive, SuperpixelTools::computeComplexity(frame));
+            }
+            
+            int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(frame, 
+                    frame_superpixels);
+            SLIC_OpenCV::computeSuperpixels(frame, region_size, compactness, 
+                    iterations, perturb_seeds, color_space, labels, threads, 
+                    tolerance, label_tolerance, &used_iterations, preemption, gpu, fixed_point, 
+                    half);
+            float elapsed = timer.elapsed();
+            stream_total += elapsed;
+            
+            SuperpixelTools::relabelConnectedSuperpixels(labels);
+            if (!stream.write(labels)) {
+                log << "Could not write labels of frame " << stream.getCount() << "." << std::endl;
+                return 1;
+            }
+            
+            if (wordy) {
+                log << SuperpixelTools::countSuperpixels(labels) << " superpixels for frame " 
+                        << stream.getCount() << " (" << elapsed << "; " << used_iterations 
+                        << " iterations)." << std::endl;
+            }
+        }
+        
+        if (wordy && stream.getCount() > 0) {
+            log << "Average time: " << stream_total / stream.getCount() << "." << std::endl;
+        }
+        
+        return 0;
+    }
+    
+    // Set up camera parameters for cloud computation.
+    DepthTools::Camera camera;
+    camera.principal_x = parameters["principal-x"].as<float>();
+    camera.principal_y = parameters["principal-y"].as<float>();
+    camera.focal_x = parameters["focal-x"].as<float>();
+    camera.focal_y = parameters["focal-y"].as<float>();
+    camera.cropping_x = parameters["cropping-x"].as<float>();
+    camera.cropping_y = parameters["cropping-y"].as<float>();
+    
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(input_dir, extensions, images);
     
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
+    int total_iterations = 0;
+    std::vector<std::string> adaptive_names;
+    std::vector<float> adaptive_complexities;
+    std::vector<int> adaptive_superpixels;
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         cv::Mat labels;
+        int used_iterations = 0;
+        
+        // Estimating the complexity is part of the timed segmentation.
+        RuntimeHarness::Timer adaptive_timer;
+        int image_superpixels = superpixels;
+        if (adaptive > 0) {
+            float complexity = SuperpixelTools::computeComplexity(image);
+            image_superpixels = SuperpixelTools::computeAdaptiveSuperpixels(superpixels, 
+                    adaptive, complexity);
+            
+            adaptive_names.push_back(it->second.stem().string());
+            adaptive_complexities.push_back(complexity);
+            adaptive_superpixels.push_back(image_superpixels);
+        }
+        float adaptive_elapsed = adaptive_timer.elapsed();
         
         int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
-                superpixels);
+                image_superpixels);
+        
+        cv::Mat cloud;
+        if (!depth_dir.empty()) {
+            boost::filesystem::path depth_file = depth_dir 
+                    / boost::filesystem::path(it->second.stem().string() + ".png");
+            if (!boost::filesystem::is_regular_file(depth_file)) {
+                depth_file = depth_dir 
+                    / boost::filesystem::path(it->second.stem().string() + ".jpg");
+
+                if (!boost::filesystem::is_regular_file(depth_file)) {
+                    std::cout << "Depth file not found for: " << it->first << "." 
+                            << std::endl;
+                    return 1;
+                }
+            }
+            
+            cv::Mat depth = cv::imread(depth_file.string(), CV_LOAD_IMAGE_ANYDEPTH);
+            
+            if (depth.rows != image.rows || depth.cols != image.cols) {
+                std::cout << "Image and depth dimensions do not match for: " 
+                        << it->first << std::endl;
+                return 1;
+            }
+            
+            if (!intrinsics_dir.empty()) {
+                boost::filesystem::path intrinsics_file = intrinsics_dir 
+                        / boost::filesystem::path(it->second.stem().string() + ".csv");
+                
+                if (!boost::filesystem::is_regular_file(intrinsics_file)) {
+                    std::cout << "Intrinsics directory given but file not found for: "
+                            << it->first << "." << std::endl;
+                    return 1;
+                }
+                
+                cv::Mat intrinsics;
+                IOUtil::readMatCSVFloat(intrinsics_file, intrinsics);
+                if (intrinsics.rows != intrinsics.cols || intrinsics.rows != 3) {
+                    std::cout << "Invalid intrinsics CSV file for: " << it->first << "." 
+                            << std::endl;
+                    return 1;
+                }
+                
+                camera.principal_x = intrinsics.at<float>(0, 2);
+                camera.principal_y = intrinsics.at<float>(1, 2);
+                camera.focal_x = intrinsics.at<float>(0, 0);
+                camera.focal_y = intrinsics.at<float>(1, 1);
+            }
+            
+            // The cloud is computed once per image, outside of the timing.
+            DepthTools::computeCloudFromDepth(depth, camera, cloud);
+        }
         
-        boost::timer timer;
-        SLIC_OpenCV::computeSuperpixels(image, region_size, compactness, 
-                iterations, perturb_seeds, color_space, labels);
-        float elapsed = timer.elapsed();
+        RuntimeHarness::Timer timer;
+        if (!depth_dir.empty()) {
+            SLIC_OpenCV::computeDepthSuperpixels(image, cloud, region_size, 
+                    compactness, iterations, perturb_seeds, color_space, labels);
+            used_iterations = iterations;
+        }
+        else {
+            SLIC_OpenCV::computeSuperpixels(image, region_size, compactness, 
+                    iterations, perturb_seeds, color_space, labels, threads, 
+                    tolerance, label_tolerance, &used_iterations, preemption, gpu, fixed_point, 
+                    half);
+        }
+        float elapsed = adaptive_elapsed + timer.elapsed();
         total += elapsed;
+        memory_profile.end();
+        total_iterations += used_iterations;
         
         int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
         
         if (wordy) {
             std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
                     << " (" << unconnected_components << " not connected; " 
-                    << elapsed <<")." << std::endl;
+                    << elapsed << "; " << used_iterations << " iterations)." << std::endl;
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
+            
+            if (!hierarchy.empty()) {
+                std::vector<cv::Mat> hierarchy_labels;
+                SuperpixelTools::computeHierarchy(image, labels, hierarchy, hierarchy_labels);
+                
+                for (unsigned int k = 0; k < hierarchy.size(); ++k) {
+                    boost::filesystem::path hierarchy_file(output_dir / std::to_string(hierarchy[k])
+                            / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+                    IOUtil::writeLabels(hierarchy_file, hierarchy_labels[k]);
+                }
+            }
         }
         
         if (!vis_dir.empty()) {
@@ -169,6 +497,7 @@ int main(int argc, const char** argv) {
     
     if (wordy) {
         std::cout << "Average time: " << total / images.size() << "." << std::endl;
+        std::cout << "Average iterations: " << float(total_iterations) / images.size() << "." << std::endl;
     }
     
     if (!output_dir.empty()) {
@@ -177,6 +506,21 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (adaptive > 0) {
+            std::ofstream superpixels_file(output_dir.string() + "/" + prefix + "superpixels.csv");
+            superpixels_file << "name,complexity,superpixels\n";
+            for (unsigned int n = 0; n < adaptive_names.size(); ++n) {
+                superpixels_file << adaptive_names[n] << "," << adaptive_complexities[n] 
+                        << "," << adaptive_superpixels[n] << "\n";
+            }
+            superpixels_file.close();
+        }
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
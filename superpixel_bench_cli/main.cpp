@@ -0,0 +1,458 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cctype>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <glog/logging.h>
+#include "io_util.h"
+#include "superpixel_tools.h"
+#include "evaluation_summary.h"
+#include "runtime_harness.h"
+#include "performance_baseline.h"
+#include "dataset_pack.h"
+#include "thread_pool.h"
+#include "superpixel_algorithm.h"
+#include "superpixel_algorithms.h"
+
+/** \brief An image of the dataset together with its ground truth, decoded once
+ * for all algorithms.
+ */
+struct Sample {
+    /** \brief Name of the superpixel segmentation, i.e. image name with .csv. */
+    boost::filesystem::path sp_file;
+    /** \brief Image. */
+    cv::Mat image;
+    /** \brief Ground truth files, only the names are used. */
+    std::vector<boost::filesystem::path> gt_files;
+    /** \brief Index of each ground truth. */
+    std::vector<int> gt_indices;
+    /** \brief Ground truth segmentations. */
+    std::vector<cv::Mat> gt_segmentations;
+    /** \brief Edge map for edge recall, shared by all algorithms; empty if not evaluated. */
+    cv::Mat edges;
+    /** \brief Whether a single ground truth of the same name is used. */
+    bool single_gt;
+};
+
+/** \brief Run several superpixel algorithms and parameter sets on a dataset 
+ * and evaluate them in-process.
+ * 
+ * The images and ground truths are read once, either from directories or
+ * from a pack written by eval_pack_cli (given instead of the image directory,
+ * the ground truth directory is then not needed); each algorithm is given as 
+ * name, optionally followed by parameters as in "slic:superpixels=400,compactness=20",
+ * see superpixel_algorithms.h. For each algorithm, a subdirectory of the
+ * output directory named after the algorithm and parameters receives the
+ * results.csv and summary.csv as written by eval_summary_cli, as well as
+ * runtime.txt as written by the command line tools of the algorithms.
+ * Only the segmentation is timed, see RuntimeHarness: with --warmup and 
+ * --repetitions each image is segmented several times and runtime.txt reports
+ * the average of the per-image medians; runtime.csv lists min, median and 95th
+ * percentile as well as the (peak) resident set size per image. Memory is
+ * process-wide, i.e. only meaningful with a single thread. With --json, the 
+ * per-image medians of all algorithms are written as PerformanceBaseline, 
+ * keyed by algorithm and parameters, to be compared with benchmarks_compare.
+ * 
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/superpixel_bench --help
+ *   Allowed options:
+ *     --img-directory arg       image directory or pack file (.spds)
+ *     --gt-directory arg        ground truth directory
+ *     --output arg (=output)    output directory, one subdirectory per 
+ *                               algorithm
+ *     --algorithms arg          algorithms to run, as name:parameter=value,...
+ *     --threads arg (=1)        number of threads to segment and evaluate 
+ *                               images in parallel
+ *     --warmup arg (=0)         number of untimed runs per image
+ *     --repetitions arg (=1)    number of timed runs per image
+ *     --cpu arg (=-1)           pin the i-th thread to this CPU plus i, -1 to 
+ *                               not pin threads
+ *     --numa                    spread the threads over the NUMA nodes, each 
+ *                               segmenting into memory of its node
+ *     --json arg                JSON baseline to write the runtimes to
+ *     --commit arg              commit stored in the JSON baseline, defaults 
+ *                               to the commit built from
+ *     --append-file arg         append file
+ *     --online                  summarize in one pass with bounded memory 
+ *                               (approximate median and quartiles)
+ *     --merge                   merge unconnected components into their 
+ *                               neighbors (as done by e.g. qs_cli) instead of 
+ *                               only relabeling them
+ *     --edge-recall             also evaluate edge recall on Canny edges of 
+ *                               the images
+ *     --csv                     also save the superpixel segmentations as CSV 
+ *                               files
+ *     --vis                     visualize results
+ *     --list                    list the available algorithms
+ *     --wordy                   verbose/wordy/debug
+ *     --help                    produce help message
+ * \endcode
+ * \author David Stutz
+ */
+int main(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("img-directory", boost::program_options::value<std::string>(), "image directory or pack file (.spds)")
+        ("gt-directory", boost::program_options::value<std::string>(), "ground truth directory")
+        ("output", boost::program_options::value<std::string>()->default_value("output"), "output directory, one subdirectory per algorithm")
+        ("algorithms", boost::program_options::value< std::vector<std::string> >()->multitoken(), "algorithms to run, as name:parameter=value,...")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of threads to segment and evaluate images in parallel")
+        ("warmup", boost::program_options::value<int>()->default_value(0), "number of untimed runs per image")
+        ("repetitions", boost::program_options::value<int>()->default_value(1), "number of timed runs per image")
+        ("cpu", boost::program_options::value<int>()->default_value(-1), "pin the i-th thread to this CPU plus i, -1 to not pin threads")
+        ("numa", "spread the threads over the NUMA nodes, each segmenting into memory of its node")
+        ("json", boost::program_options::value<std::string>()->default_value(""), "JSON baseline to write the runtimes to")
+        ("commit", boost::program_options::value<std::string>()->default_value(""), "commit stored in the JSON baseline, defaults to the commit built from")
+        ("append-file", boost::program_options::value<std::string>()->default_value(""), "append file")
+        ("online", "summarize in one pass with bounded memory (approximate median and quartiles)")
+        ("merge", "merge unconnected components into their neighbors (as done by e.g. qs_cli) instead of only relabeling them")
+        ("edge-recall", "also evaluate edge recall on Canny edges of the images")
+        ("csv", "also save the superpixel segmentations as CSV files")
+        ("vis", "visualize results")
+        ("list", "list the available algorithms")
+        ("wordy", "verbose/wordy/debug")
+        ("help", "produce help message");
+
+    boost::program_options::positional_options_description positionals;
+    positionals.add("img-directory", 1);
+    positionals.add("gt-directory", 1);
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    SuperpixelAlgorithms::registerAll();
+    
+    if (parameters.find("list") != parameters.end()) {
+        std::vector<std::string> names = SuperpixelAlgorithmRegistry::list();
+        for (unsigned int i = 0; i < names.size(); ++i) {
+            std::cout << names[i] << std::endl;
+        }
+        
+        return 0;
+    }
+    
+    if (parameters.find("img-directory") == parameters.end()) {
+        std::cout << "No image directory given." << std::endl;
+        return 1;
+    }
+    
+    // A pack contains the ground truths, which are then not read from the 
+    // ground truth directory.
+    boost::filesystem::path img_directory(parameters["img-directory"].as<std::string>());
+    bool packed = DatasetPack::isPackFile(img_directory);
+    if (!packed && !boost::filesystem::is_directory(img_directory)) {
+        std::cout << "Image directory does not exist." << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path gt_directory;
+    if (parameters.find("gt-directory") != parameters.end()) {
+        gt_directory = boost::filesystem::path(parameters["gt-directory"].as<std::string>());
+    }
+    
+    if (!packed && !boost::filesystem::is_directory(gt_directory)) {
+        std::cout << "Ground truth directory does not exist." << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path output_dir(parameters["output"].as<std::string>());
+    boost::filesystem::path append_file(parameters["append-file"].as<std::string>());
+    
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    // With --cpu, threads are pinned to individual CPUs instead.
+    bool numa = parameters.find("numa") != parameters.end();
+    ThreadPool::setGlobalThreads(threads, numa && parameters["cpu"].as<int>() < 0);
+    
+    int warmup = parameters["warmup"].as<int>();
+    int repetitions = parameters["repetitions"].as<int>();
+    if (warmup < 0 || repetitions <= 0) {
+        std::cout << "Number of repetitions needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    int cpu = parameters["cpu"].as<int>();
+    
+    bool online = parameters.find("online") != parameters.end();
+    bool merge = parameters.find("merge") != parameters.end();
+    bool csv = parameters.find("csv") != parameters.end();
+    bool wordy = parameters.find("wordy") != parameters.end();
+    
+    EvaluationSummary::EvaluationMetrics metrics;
+    metrics.er = parameters.find("edge-recall") != parameters.end();
+    
+    EvaluationSummary::EvaluationStatistics statistics;
+    EvaluationSummary::SuperpixelVisualizations visualizations;
+    if (parameters.find("vis") != parameters.end()) {
+        visualizations.contour = true;
+        visualizations.mean = true;
+        visualizations.pre_rec = true;
+        visualizations.ue = true;
+        visualizations.random = true;
+        visualizations.perturbed_mean = true;
+    }
+    
+    // Algorithms are validated before the dataset is read.
+    if (parameters.find("algorithms") == parameters.end()) {
+        std::cout << "No algorithms given, see --list." << std::endl;
+        return 1;
+    }
+    
+    std::vector<std::string> specs = parameters["algorithms"].as< std::vector<std::string> >();
+    std::vector<std::string> names(specs.size());
+    std::vector<SuperpixelAlgorithm::Parameters> algorithm_parameters(specs.size());
+    std::vector<std::string> directories(specs.size());
+    
+    for (unsigned int a = 0; a < specs.size(); ++a) {
+        size_t position = specs[a].find(':');
+        names[a] = specs[a].substr(0, position);
+        if (position != std::string::npos) {
+            algorithm_parameters[a] = SuperpixelAlgorithm::parseParameters(
+                    specs[a].substr(position + 1));
+        }
+        
+        if (!SuperpixelAlgorithmRegistry::has(names[a])) {
+            std::cout << "Algorithm not available: " << names[a] << "." << std::endl;
+            return 1;
+        }
+        
+        // The subdirectory is named after algorithm and parameters.
+        directories[a] = specs[a];
+        for (unsigned int i = 0; i < directories[a].size(); ++i) {
+            if (!std::isalnum(directories[a][i]) && directories[a][i] != '.' 
+                    && directories[a][i] != '-') {
+                directories[a][i] = '_';
+            }
+        }
+    }
+    
+    // Samples of a pack reference the mapped file, which therefore stays
+    // open until all algorithms are evaluated.
+    DatasetPack pack;
+    std::vector<Sample> samples;
+    
+    if (packed) {
+        if (!pack.open(img_directory)) {
+            std::cout << "Could not open pack " << img_directory << "." << std::endl;
+            return 1;
+        }
+        
+        for (int i = 0; i < pack.getSize(); ++i) {
+            DatasetPack::Sample pack_sample;
+            pack.getSample(i, pack_sample);
+            
+            Sample sample;
+            sample.sp_file = boost::filesystem::path(pack_sample.name + ".csv");
+            sample.image = pack_sample.image;
+            sample.single_gt = pack_sample.single_gt;
+            sample.gt_indices = pack_sample.gt_indices;
+            sample.gt_segmentations = pack_sample.gt_segmentations;
+            
+            for (unsigned int k = 0; k < pack_sample.gt_names.size(); ++k) {
+                sample.gt_files.push_back(boost::filesystem::path(pack_sample.gt_names[k]));
+            }
+            
+            samples.push_back(sample);
+        }
+    }
+    
+    std::multimap<std::string, boost::filesystem::path> images;
+    if (!packed) {
+        std::vector<std::string> extensions;
+        IOUtil::getImageExtensions(extensions);
+        IOUtil::readDirectory(img_directory, extensions, images);
+    }
+    
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
+            it != images.end(); ++it) {
+        
+        Sample sample;
+        sample.sp_file = boost::filesystem::path(it->second.stem().string() + ".csv");
+        sample.image = cv::imread(it->first, CV_LOAD_IMAGE_COLOR);
+        
+        LOG_IF(FATAL, sample.image.rows <= 0 || sample.image.cols <= 0) 
+                << "Could not read image: " << it->first << ".";
+        
+        sample.single_gt = EvaluationSummary::findGroundTruths(gt_directory, 
+                sample.sp_file, sample.gt_files, sample.gt_indices);
+        
+        sample.gt_segmentations.resize(sample.gt_files.size());
+        for (unsigned int k = 0; k < sample.gt_files.size(); ++k) {
+            IOUtil::readMatCSVInt(sample.gt_files[k], sample.image.rows, 
+                    sample.image.cols, sample.gt_segmentations[k]);
+            
+            LOG_IF(FATAL, sample.gt_segmentations[k].rows != sample.image.rows 
+                    || sample.gt_segmentations[k].cols != sample.image.cols) 
+                    << "Ground truth does not match image size.";
+        }
+        
+        samples.push_back(sample);
+    }
+    
+    int n = samples.size();
+    if (n == 0) {
+        std::cout << "No images found." << std::endl;
+        return 1;
+    }
+    
+    // Edge maps only depend on the image and are shared by all algorithms.
+    if (metrics.er) {
+        ThreadPool::parallelFor(0, n, [&samples](int i) {
+            EvaluationSummary::computeEdges(samples[i].image, samples[i].edges);
+        });
+    }
+    
+    if (wordy) {
+        std::cout << "Read " << n << " images." << std::endl;
+    }
+    
+    // Images are sorted by path, so the per-image runtimes are paired across
+    // baselines on the same dataset.
+    PerformanceBaseline baseline;
+    if (!parameters["commit"].as<std::string>().empty()) {
+        baseline.commit = parameters["commit"].as<std::string>();
+    }
+    
+    for (unsigned int a = 0; a < specs.size(); ++a) {
+        
+        boost::filesystem::path sp_directory = output_dir / boost::filesystem::path(directories[a]);
+        if (!boost::filesystem::is_directory(sp_directory)) {
+            boost::filesystem::create_directories(sp_directory);
+        }
+        
+        EvaluationSummary summary(sp_directory, gt_directory, img_directory,
+                metrics, statistics, visualizations);
+        summary.setComputeCorrelation(true);
+        summary.setThreads(threads);
+        summary.setOnlineStatistics(online);
+        
+        if (!append_file.empty()) {
+            summary.setAppendFile(append_file);
+        }
+        
+        std::vector<EvaluationSummary::ImageResult> image_results(n);
+        std::vector<RuntimeHarness::Record> records(n);
+        
+        // Each thread uses its own instance, as algorithms may keep state
+        // across images. Threads are taken from the global pool such that
+        // algorithms and evaluation using it do not oversubscribe.
+        int n_threads = std::max(1, std::min(threads, n));
+        std::atomic<int> next(0);
+        
+        ThreadPool::parallelFor(0, n_threads, [&](int k) {
+            if (cpu >= 0 && !RuntimeHarness::pinThread(cpu + k)) {
+                LOG(WARNING) << "Could not pin thread " << k << " to CPU " << (cpu + k) << ".";
+            }
+            
+            RuntimeHarness harness(warmup, repetitions);
+            SuperpixelAlgorithm* algorithm = SuperpixelAlgorithmRegistry::create(
+                    names[a], algorithm_parameters[a]);
+            
+            for (int i = next++; i < n; i = next++) {
+                const Sample &sample = samples[i];
+                cv::Mat labels;
+                
+                records[i] = harness.measure(sample.sp_file.stem().string(), [&]() {
+                    algorithm->segment(sample.image, labels);
+                });
+                
+                int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+                if (merge) {
+                    SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(sample.image, 
+                            labels, unconnected_components);
+                    SuperpixelTools::relabelSuperpixels(labels);
+                }
+                
+                if (csv) {
+                    IOUtil::writeLabels(sp_directory / sample.sp_file, labels);
+                }
+                
+                summary.evaluateSegmentation(sample.sp_file, sample.image, 
+                        labels, sample.gt_files, sample.gt_indices, 
+                        sample.gt_segmentations, sample.single_gt, 
+                        image_results[i], NULL, 
+                        (!sample.edges.empty() ? &sample.edges : NULL));
+            }
+            
+            delete algorithm;
+        });
+        
+        double total = 0;
+        std::vector<double> medians(n);
+        for (int i = 0; i < n; ++i) {
+            summary.addImageResult(image_results[i]);
+            total += records[i].median;
+            medians[i] = records[i].median;
+        }
+        
+        baseline.add(specs[a], medians, true);
+        
+        int gt_max = 0;
+        summary.computeSummary(gt_max);
+        
+        std::ofstream runtime_file((sp_directory / boost::filesystem::path("runtime.txt")).string(), 
+                std::ofstream::out | std::ofstream::app);
+        runtime_file << total / n << "\n";
+        runtime_file.close();
+        
+        RuntimeHarness::writeRecords(sp_directory / boost::filesystem::path("runtime.csv"), 
+                records);
+        
+        if (wordy) {
+            std::cout << specs[a] << ": average time " << total / n << "." << std::endl;
+        }
+    }
+    
+    boost::filesystem::path json_file(parameters["json"].as<std::string>());
+    if (!json_file.empty() && !baseline.write(json_file)) {
+        std::cout << "Could not write " << json_file << "." << std::endl;
+        return 1;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <map>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include "io_util.h"
+#include "segmentation_protocol.h"
+
+/** \brief Client of superpixel_server: sends all images of a directory and
+ * writes the returned label maps in the binary label format (.lbl).
+ * 
+ * All requests are sent before the responses are read such that the server
+ * can batch them. By default, the image files are sent as is and decoded by
+ * the server; with --raw they are decoded by the client and sent as pixels.
+ * 
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/superpixel_client --help
+ *   Allowed options:
+ *     --img-directory arg       image directory
+ *     --algorithm arg           algorithm, as name:parameter=value,...
+ *     --socket arg (=superpixel_server.sock)
+ *                               Unix domain socket of the server
+ *     --output arg              output directory for label maps, not written 
+ *                               if empty
+ *     --raw                     send decoded pixels instead of image files
+ *     --wordy                   verbose/wordy/debug
+ *     --help                    produce help message
+ * \endcode
+ * \author David Stutz
+ */
+int main(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("img-directory", boost::program_options::value<std::string>(), "image directory")
+        ("algorithm", boost::program_options::value<std::string>()->default_value("slic"), "algorithm, as name:parameter=value,...")
+        ("socket", boost::program_options::value<std::string>()->default_value("superpixel_server.sock"), "Unix domain socket of the server")
+        ("output", boost::program_options::value<std::string>()->default_value(""), "output directory for label maps, not written if empty")
+        ("raw", "send decoded pixels instead of image files")
+        ("wordy", "verbose/wordy/debug")
+        ("help", "produce help message");
+
+    boost::program_options::positional_options_description positionals;
+    positionals.add("img-directory", 1);
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path img_directory(parameters["img-directory"].as<std::string>());
+    if (!boost::filesystem::is_directory(img_directory)) {
+        std::cout << "Image directory does not exist." << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path output_dir(parameters["output"].as<std::string>());
+    if (!output_dir.empty() && !boost::filesystem::is_directory(output_dir)) {
+        boost::filesystem::create_directories(output_dir);
+    }
+    
+    std::string algorithm = parameters["algorithm"].as<std::string>();
+    bool raw = parameters.find("raw") != parameters.end();
+    bool wordy = parameters.find("wordy") != parameters.end();
+    
+    std::string socket_path = parameters["socket"].as<std::string>();
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cout << "Socket path too long: " << socket_path << "." << std::endl;
+        return 1;
+    }
+    
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0 || connect(server, (struct sockaddr*) &address, sizeof(address)) != 0) {
+        std::cout << "Could not connect to " << socket_path << "." << std::endl;
+        return 1;
+    }
+    
+    std::multimap<std::string, boost::filesystem::path> images;
+    std::vector<std::string> extensions;
+    IOUtil::getImageExtensions(extensions);
+    IOUtil::readDirectory(img_directory, extensions, images);
+    
+    std::vector<boost::filesystem::path> files;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
+            it != images.end(); ++it) {
+        
+        bool written = false;
+        if (raw) {
+            cv::Mat image = cv::imread(it->first, CV_LOAD_IMAGE_COLOR);
+            written = SegmentationProtocol::writeRequest(server, files.size(), algorithm, image);
+        }
+        else {
+            std::ifstream file(it->first.c_str(), std::ifstream::in | std::ifstream::binary);
+            std::vector<char> buffer((std::istreambuf_iterator<char>(file)), 
+                    std::istreambuf_iterator<char>());
+            written = SegmentationProtocol::writeRequest(server, files.size(), algorithm, buffer);
+        }
+        
+        if (!written) {
+            std::cout << "Could not send " << it->first << "." << std::endl;
+            close(server);
+            return 1;
+        }
+        
+        files.push_back(it->second);
+    }
+    
+    int errors = 0;
+    for (unsigned int i = 0; i < files.size(); ++i) {
+        SegmentationProtocol::ResponseHeader header;
+        std::vector<char> data;
+        
+        if (!SegmentationProtocol::readResponse(server, header, data) || header.id >= files.size()) {
+            std::cout << "Invalid response." << std::endl;
+            close(server);
+            return 1;
+        }
+        
+        if (header.status != SegmentationProtocol::STATUS_OK) {
+            std::cout << files[header.id] << ": " << std::string(data.begin(), data.end()) << std::endl;
+            ++errors;
+            continue;
+        }
+        
+        if (!output_dir.empty()) {
+            boost::filesystem::path lbl_file = output_dir 
+                    / boost::filesystem::path(files[header.id].stem().string() + ".lbl");
+            std::ofstream lbl_stream(lbl_file.c_str(), std::ofstream::out | std::ofstream::binary);
+            lbl_stream.write(data.data(), data.size());
+        }
+        
+        if (wordy) {
+            std::cout << files[header.id] << ": queue " << header.queue_time*1000 
+                    << "ms, segmentation " << header.segmentation_time*1000 
+                    << "ms." << std::endl;
+        }
+    }
+    
+    close(server);
+    
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << files.size() << " images in " << total << "s." << std::endl;
+    
+    return (errors > 0) ? 1 : 0;
+}
@@ -0,0 +1,522 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <poll.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <map>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <fstream>
+#include <algorithm>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <glog/logging.h>
+#include "io_util.h"
+#include "superpixel_tools.h"
+#include "runtime_harness.h"
+#include "superpixel_algorithm.h"
+#include "superpixel_algorithms.h"
+#include "segmentation_protocol.h"
+
+/** \brief Set by SIGINT and SIGTERM to shut down the server. */
+static volatile sig_atomic_t stop = 0;
+
+/** \brief Signal handler requesting shutdown.
+ * \param[in] signal signal
+ */
+static void handleSignal(int signal) {
+    stop = 1;
+}
+
+/** \brief A client connection; the socket is closed once the reader and all
+ * pending requests have released it.
+ */
+struct Connection {
+    /** \brief Constructor.
+     * \param[in] fd socket
+     */
+    Connection(int fd) : fd(fd) {}
+    
+    /** \brief Destructor, closes the socket. */
+    ~Connection() {
+        close(fd);
+    }
+    
+    /** \brief Socket. */
+    int fd;
+    /** \brief Serializes responses of different workers. */
+    std::mutex write_mutex;
+};
+
+/** \brief A request waiting for a worker. */
+struct Request {
+    /** \brief Connection to answer on. */
+    std::shared_ptr<Connection> connection;
+    /** \brief Header as received. */
+    SegmentationProtocol::RequestHeader header;
+    /** \brief Algorithm and parameters. */
+    std::string algorithm;
+    /** \brief Encoded image or raw pixels. */
+    std::vector<char> image;
+    /** \brief Time the request was received completely. */
+    std::chrono::steady_clock::time_point received;
+};
+
+/** \brief Latency of an answered request. */
+struct Latency {
+    /** \brief Algorithm and parameters. */
+    std::string algorithm;
+    /** \brief Status of the response. */
+    int status;
+    /** \brief Rows of the image. */
+    int rows;
+    /** \brief Columns of the image. */
+    int cols;
+    /** \brief Time waiting for a worker in seconds. */
+    double queue_time;
+    /** \brief Time to decode and segment the image in seconds. */
+    double segmentation_time;
+    /** \brief Time from receiving the request to sending the response in seconds. */
+    double total_time;
+};
+
+/** \brief Queue of requests shared by connections and workers. */
+struct RequestQueue {
+    /** \brief Requests in order of arrival. */
+    std::deque<Request> requests;
+    /** \brief Protects requests. */
+    std::mutex mutex;
+    /** \brief Signals new requests and shutdown. */
+    std::condition_variable condition;
+};
+
+/** \brief Percentile of the given times using the nearest rank.
+ * \param[in] times times, sorted ascending
+ * \param[in] percentile percentile in [0,100]
+ * \return percentile, 0 if empty
+ */
+static double getPercentile(const std::vector<double> &times, double percentile) {
+    if (times.empty()) {
+        return 0;
+    }
+    
+    int rank = std::ceil(percentile/100*times.size());
+    return times[std::max(0, std::min((int) times.size() - 1, rank - 1))];
+}
+
+/** \brief Split algorithm and parameters as in "slic:superpixels=400".
+ * \param[in] spec algorithm and parameters
+ * \param[out] name name of the algorithm
+ * \param[out] parameters parameters
+ */
+static void parseAlgorithm(const std::string &spec, std::string &name,
+        SuperpixelAlgorithm::Parameters &parameters) {
+    
+    size_t position = spec.find(':');
+    name = spec.substr(0, position);
+    
+    parameters.clear();
+    if (position != std::string::npos) {
+        parameters = SuperpixelAlgorithm::parseParameters(spec.substr(position + 1));
+    }
+}
+
+/** \brief Long-running segmentation server: keeps algorithm instances and 
+ * their workspaces alive across requests to avoid process start-up, dynamic
+ * linking and cold caches per image.
+ * 
+ * Clients connect to a Unix domain socket and send images, see 
+ * SegmentationProtocol and superpixel_client; each request names the 
+ * algorithm and parameters as for superpixel_bench. Requests of all 
+ * connections are queued and answered by a pool of workers, each taking up
+ * to --batch requests at once and keeping one instance per algorithm and
+ * parameters. Label maps are relabeled to be connected and returned in the 
+ * binary label format. The time waiting for a worker and the time to decode
+ * and segment are returned with each response; on shutdown (SIGINT or SIGTERM)
+ * the median and 99th percentile latency are reported and all latencies can
+ * be written to --metrics as CSV.
+ * 
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/superpixel_server --help
+ *   Allowed options:
+ *     --socket arg (=superpixel_server.sock)
+ *                               Unix domain socket to listen on
+ *     --threads arg (=1)        number of workers
+ *     --batch arg (=8)          maximum number of requests a worker takes at 
+ *                               once
+ *     --algorithms arg          algorithms to create on start-up, as 
+ *                               name:parameter=value,...
+ *     --cpu arg (=-1)           pin the i-th worker to this CPU plus i, -1 to 
+ *                               not pin workers
+ *     --merge                   merge unconnected components into their 
+ *                               neighbors instead of only relabeling them
+ *     --metrics arg             CSV file to write the latency of all requests 
+ *                               to on shutdown
+ *     --list                    list the available algorithms
+ *     --wordy                   verbose/wordy/debug
+ *     --help                    produce help message
+ * \endcode
+ * \author David Stutz
+ */
+int main(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("socket", boost::program_options::value<std::string>()->default_value("superpixel_server.sock"), "Unix domain socket to listen on")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of workers")
+        ("batch", boost::program_options::value<int>()->default_value(8), "maximum number of requests a worker takes at once")
+        ("algorithms", boost::program_options::value< std::vector<std::string> >()->multitoken(), "algorithms to create on start-up, as name:parameter=value,...")
+        ("cpu", boost::program_options::value<int>()->default_value(-1), "pin the i-th worker to this CPU plus i, -1 to not pin workers")
+        ("merge", "merge unconnected components into their neighbors instead of only relabeling them")
+        ("metrics", boost::program_options::value<std::string>()->default_value(""), "CSV file to write the latency of all requests to on shutdown")
+        ("list", "list the available algorithms")
+        ("wordy", "verbose/wordy/debug")
+        ("help", "produce help message");
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    SuperpixelAlgorithms::registerAll();
+    
+    if (parameters.find("list") != parameters.end()) {
+        std::vector<std::string> names = SuperpixelAlgorithmRegistry::list();
+        for (unsigned int i = 0; i < names.size(); ++i) {
+            std::cout << names[i] << std::endl;
+        }
+        
+        return 0;
+    }
+    
+    int threads = parameters["threads"].as<int>();
+    int batch = parameters["batch"].as<int>();
+    if (threads <= 0 || batch <= 0) {
+        std::cout << "Number of threads and batch size need to be positive." << std::endl;
+        return 1;
+    }
+    
+    std::vector<std::string> warm;
+    if (parameters.find("algorithms") != parameters.end()) {
+        warm = parameters["algorithms"].as< std::vector<std::string> >();
+    }
+    
+    for (unsigned int a = 0; a < warm.size(); ++a) {
+        std::string name;
+        SuperpixelAlgorithm::Parameters algorithm_parameters;
+        parseAlgorithm(warm[a], name, algorithm_parameters);
+        
+        if (!SuperpixelAlgorithmRegistry::has(name)) {
+            std::cout << "Algorithm not available: " << name << "." << std::endl;
+            return 1;
+        }
+    }
+    
+    int cpu = parameters["cpu"].as<int>();
+    bool merge = parameters.find("merge") != parameters.end();
+    bool wordy = parameters.find("wordy") != parameters.end();
+    
+    std::string socket_path = parameters["socket"].as<std::string>();
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cout << "Socket path too long: " << socket_path << "." << std::endl;
+        return 1;
+    }
+    
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path.c_str());
+    
+    if (server < 0 || bind(server, (struct sockaddr*) &address, sizeof(address)) != 0
+            || listen(server, 64) != 0) {
+        std::cout << "Could not listen on " << socket_path << "." << std::endl;
+        return 1;
+    }
+    
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+    signal(SIGPIPE, SIG_IGN);
+    
+    RequestQueue queue;
+    std::atomic<bool> done(false);
+    
+    std::mutex latencies_mutex;
+    std::vector<Latency> latencies;
+    
+    std::vector<std::thread> workers;
+    for (int k = 0; k < threads; ++k) {
+        workers.push_back(std::thread([&, k]() {
+            if (cpu >= 0 && !RuntimeHarness::pinThread(cpu + k)) {
+                LOG(WARNING) << "Could not pin worker " << k << " to CPU " << (cpu + k) << ".";
+            }
+            
+            // Instances are kept per worker as algorithms may keep state.
+            std::map<std::string, SuperpixelAlgorithm*> algorithms;
+            for (unsigned int a = 0; a < warm.size(); ++a) {
+                std::string name;
+                SuperpixelAlgorithm::Parameters algorithm_parameters;
+                parseAlgorithm(warm[a], name, algorithm_parameters);
+                algorithms[warm[a]] = SuperpixelAlgorithmRegistry::create(name, algorithm_parameters);
+            }
+            
+            std::vector<Latency> worker_latencies;
+            std::vector<Request> requests;
+            
+            while (true) {
+                requests.clear();
+                
+                {
+                    std::unique_lock<std::mutex> lock(queue.mutex);
+                    queue.condition.wait(lock, [&]() {
+                        return !queue.requests.empty() || done;
+                    });
+                    
+                    if (queue.requests.empty()) {
+                        break;
+                    }
+                    
+                    while (!queue.requests.empty() && (int) requests.size() < batch) {
+                        requests.push_back(std::move(queue.requests.front()));
+                        queue.requests.pop_front();
+                    }
+                }
+                
+                for (unsigned int r = 0; r < requests.size(); ++r) {
+                    Request &request = requests[r];
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    
+                    SegmentationProtocol::ResponseHeader header;
+                    header.id = request.header.id;
+                    header.status = SegmentationProtocol::STATUS_OK;
+                    header.queue_time = std::chrono::duration<double>(start - request.received).count();
+                    header.segmentation_time = 0;
+                    
+                    std::vector<char> data;
+                    cv::Mat image;
+                    cv::Mat labels;
+                    
+                    SuperpixelAlgorithm* algorithm = NULL;
+                    std::map<std::string, SuperpixelAlgorithm*>::iterator it = algorithms.find(request.algorithm);
+                    if (it != algorithms.end()) {
+                        algorithm = it->second;
+                    }
+                    else {
+                        std::string name;
+                        SuperpixelAlgorithm::Parameters algorithm_parameters;
+                        parseAlgorithm(request.algorithm, name, algorithm_parameters);
+                        
+                        algorithm = SuperpixelAlgorithmRegistry::create(name, algorithm_parameters);
+                        if (algorithm != NULL) {
+                            algorithms[request.algorithm] = algorithm;
+                        }
+                    }
+                    
+                    if (algorithm == NULL) {
+                        header.status = SegmentationProtocol::STATUS_UNKNOWN_ALGORITHM;
+                        std::string message = "Algorithm not available: " + request.algorithm + ".";
+                        data.assign(message.begin(), message.end());
+                    }
+                    else if (!SegmentationProtocol::decodeImage(request.header, request.image, image)) {
+                        header.status = SegmentationProtocol::STATUS_INVALID_IMAGE;
+                        std::string message = "Could not decode image.";
+                        data.assign(message.begin(), message.end());
+                    }
+                    else {
+                        algorithm->segment(image, labels);
+                        
+                        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+                        if (merge) {
+                            SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, 
+                                    labels, unconnected_components);
+                            SuperpixelTools::relabelSuperpixels(labels);
+                        }
+                        
+                        header.segmentation_time = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start).count();
+                        IOUtil::encodeMatBinaryInt(labels, data);
+                    }
+                    
+                    {
+                        std::lock_guard<std::mutex> lock(request.connection->write_mutex);
+                        SegmentationProtocol::writeResponse(request.connection->fd, header, data);
+                    }
+                    
+                    Latency latency;
+                    latency.algorithm = request.algorithm;
+                    latency.status = header.status;
+                    latency.rows = image.rows;
+                    latency.cols = image.cols;
+                    latency.queue_time = header.queue_time;
+                    latency.segmentation_time = header.segmentation_time;
+                    latency.total_time = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - request.received).count();
+                    worker_latencies.push_back(latency);
+                }
+                
+                // Release connections before waiting again.
+                requests.clear();
+            }
+            
+            for (std::map<std::string, SuperpixelAlgorithm*>::iterator it = algorithms.begin();
+                    it != algorithms.end(); ++it) {
+                delete it->second;
+            }
+            
+            std::lock_guard<std::mutex> lock(latencies_mutex);
+            latencies.insert(latencies.end(), worker_latencies.begin(), worker_latencies.end());
+        }));
+    }
+    
+    if (wordy) {
+        std::cout << "Listening on " << socket_path << " with " << threads 
+                << " workers." << std::endl;
+    }
+    
+    // Readers of all connections, the sockets are shut down for reading on
+    // exit to unblock them.
+    std::mutex connections_mutex;
+    std::vector<std::weak_ptr<Connection> > connections;
+    std::vector<std::thread> readers;
+    
+    while (!stop) {
+        struct pollfd poll_fd;
+        poll_fd.fd = server;
+        poll_fd.events = POLLIN;
+        
+        if (poll(&poll_fd, 1, 200) <= 0 || !(poll_fd.revents & POLLIN)) {
+            continue;
+        }
+        
+        int client = accept(server, NULL, NULL);
+        if (client < 0) {
+            continue;
+        }
+        
+        std::shared_ptr<Connection> connection(new Connection(client));
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            connections.push_back(connection);
+        }
+        
+        readers.push_back(std::thread([&queue, connection]() {
+            while (true) {
+                Request request;
+                if (!SegmentationProtocol::readRequest(connection->fd, request.header, 
+                        request.algorithm, request.image)) {
+                    break;
+                }
+                
+                request.connection = connection;
+                request.received = std::chrono::steady_clock::now();
+                
+                {
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                    queue.requests.push_back(std::move(request));
+                }
+                
+                queue.condition.notify_one();
+            }
+        }));
+    }
+    
+    close(server);
+    unlink(socket_path.c_str());
+    
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        for (unsigned int i = 0; i < connections.size(); ++i) {
+            std::shared_ptr<Connection> connection = connections[i].lock();
+            if (connection) {
+                shutdown(connection->fd, SHUT_RD);
+            }
+        }
+    }
+    
+    for (unsigned int i = 0; i < readers.size(); ++i) {
+        readers[i].join();
+    }
+    
+    // Workers answer all queued requests before exiting.
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        done = true;
+    }
+    
+    queue.condition.notify_all();
+    for (unsigned int k = 0; k < workers.size(); ++k) {
+        workers[k].join();
+    }
+    
+    boost::filesystem::path metrics_file(parameters["metrics"].as<std::string>());
+    if (!metrics_file.empty()) {
+        std::ofstream metrics(metrics_file.string());
+        metrics << "algorithm,status,rows,cols,queue_time,segmentation_time,total_time" << std::endl;
+        
+        for (unsigned int i = 0; i < latencies.size(); ++i) {
+            metrics << latencies[i].algorithm << "," << latencies[i].status << "," 
+                    << latencies[i].rows << "," << latencies[i].cols << "," 
+                    << latencies[i].queue_time << "," << latencies[i].segmentation_time 
+                    << "," << latencies[i].total_time << std::endl;
+        }
+    }
+    
+    std::vector<double> total_times;
+    for (unsigned int i = 0; i < latencies.size(); ++i) {
+        total_times.push_back(latencies[i].total_time);
+    }
+    
+    std::sort(total_times.begin(), total_times.end());
+    std::cout << "Answered " << total_times.size() << " requests, latency median " 
+            << getPercentile(total_times, 50)*1000 << "ms, p99 " 
+            << getPercentile(total_times, 99)*1000 << "ms." << std::endl;
+    
+    return 0;
+}
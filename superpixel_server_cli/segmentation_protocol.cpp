@@ -0,0 +1,230 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "segmentation_protocol.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+const char REQUEST_MAGIC[4] = {'S', 'P', 'R', 'Q'};
+const char RESPONSE_MAGIC[4] = {'S', 'P', 'R', 'S'};
+
+////////////////////////////////////////////////////////////////////////////////
+// readAll
+////////////////////////////////////////////////////////////////////////////////
+
+bool SegmentationProtocol::readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = read(fd, data, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        if (n <= 0) {
+            return false;
+        }
+        
+        data += n;
+        size -= n;
+    }
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeAll
+////////////////////////////////////////////////////////////////////////////////
+
+bool SegmentationProtocol::writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        // MSG_NOSIGNAL avoids SIGPIPE if the peer closed the connection.
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        if (n <= 0) {
+            return false;
+        }
+        
+        data += n;
+        size -= n;
+    }
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readRequest
+////////////////////////////////////////////////////////////////////////////////
+
+bool SegmentationProtocol::readRequest(int fd, RequestHeader &header, 
+        std::string &algorithm, std::vector<char> &image) {
+    
+    if (!readAll(fd, reinterpret_cast<char*>(&header), sizeof(header))) {
+        return false;
+    }
+    
+    if (memcmp(header.magic, REQUEST_MAGIC, 4) != 0 
+            || header.algorithm_size > MAX_ALGORITHM_SIZE
+            || header.image_size > MAX_IMAGE_SIZE
+            || header.rows < 0 || header.cols < 0) {
+        return false;
+    }
+    
+    algorithm.resize(header.algorithm_size);
+    if (header.algorithm_size > 0 && !readAll(fd, &algorithm[0], header.algorithm_size)) {
+        return false;
+    }
+    
+    image.resize(header.image_size);
+    if (header.image_size > 0 && !readAll(fd, image.data(), header.image_size)) {
+        return false;
+    }
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeRequest
+////////////////////////////////////////////////////////////////////////////////
+
+bool SegmentationProtocol::writeRequest(int fd, uint32_t id, 
+        const std::string &algorithm, const std::vector<char> &image) {
+    
+    RequestHeader header;
+    memcpy(header.magic, REQUEST_MAGIC, 4);
+    header.id = id;
+    header.algorithm_size = algorithm.size();
+    header.rows = 0;
+    header.cols = 0;
+    header.image_size = image.size();
+    
+    return writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header))
+            && writeAll(fd, algorithm.data(), algorithm.size())
+            && writeAll(fd, image.data(), image.size());
+}
+
+bool SegmentationProtocol::writeRequest(int fd, uint32_t id, 
+        const std::string &algorithm, const cv::Mat &image) {
+    
+    if (image.type() != CV_8UC3) {
+        return false;
+    }
+    
+    RequestHeader header;
+    memcpy(header.magic, REQUEST_MAGIC, 4);
+    header.id = id;
+    header.algorithm_size = algorithm.size();
+    header.rows = image.rows;
+    header.cols = image.cols;
+    header.image_size = image.rows*image.cols*3;
+    
+    if (!writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header))
+            || !writeAll(fd, algorithm.data(), algorithm.size())) {
+        return false;
+    }
+    
+    for (int i = 0; i < image.rows; ++i) {
+        if (!writeAll(fd, image.ptr<char>(i), image.cols*3)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// decodeImage
+////////////////////////////////////////////////////////////////////////////////
+
+bool SegmentationProtocol::decodeImage(const RequestHeader &header, 
+        const std::vector<char> &image, cv::Mat &result) {
+    
+    if (header.rows > 0 && header.cols > 0) {
+        if (image.size() != (size_t) header.rows*header.cols*3) {
+            return false;
+        }
+        
+        result.create(header.rows, header.cols, CV_8UC3);
+        for (int i = 0; i < result.rows; ++i) {
+            memcpy(result.ptr<char>(i), image.data() + (size_t) i*result.cols*3, 
+                    result.cols*3);
+        }
+        
+        return true;
+    }
+    
+    if (image.empty()) {
+        return false;
+    }
+    
+    result = cv::imdecode(image, CV_LOAD_IMAGE_COLOR);
+    return result.rows > 0 && result.cols > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readResponse
+////////////////////////////////////////////////////////////////////////////////
+
+bool SegmentationProtocol::readResponse(int fd, ResponseHeader &header, 
+        std::vector<char> &data) {
+    
+    if (!readAll(fd, reinterpret_cast<char*>(&header), sizeof(header))) {
+        return false;
+    }
+    
+    if (memcmp(header.magic, RESPONSE_MAGIC, 4) != 0) {
+        return false;
+    }
+    
+    data.resize(header.size);
+    return header.size == 0 || readAll(fd, data.data(), header.size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeResponse
+////////////////////////////////////////////////////////////////////////////////
+
+bool SegmentationProtocol::writeResponse(int fd, ResponseHeader header, 
+        const std::vector<char> &data) {
+    
+    memcpy(header.magic, RESPONSE_MAGIC, 4);
+    header.size = data.size();
+    
+    return writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header))
+            && writeAll(fd, data.data(), data.size());
+}
@@ -0,0 +1,179 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SEGMENTATION_PROTOCOL_H
+#define	SEGMENTATION_PROTOCOL_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/** \brief Wire format between superpixel_server and its clients over a local
+ * (Unix domain) stream socket.
+ * 
+ * A client sends any number of requests on a connection, each consisting of a
+ * RequestHeader followed by the algorithm (as "name:parameter=value,..." as
+ * for superpixel_bench) and the image. The image is either an encoded image 
+ * file (e.g. PNG or JPG, decoded by the server) or, if rows and cols are
+ * given, raw BGR pixels as CV_8UC3 in row-major order. The server answers
+ * each request with a ResponseHeader followed by the label map in the binary
+ * label format (see IOUtil::writeMatBinaryInt) or an error message. Responses
+ * may arrive out of order and are matched to requests by id. All integers
+ * are in native byte order.
+ * 
+ * \author David Stutz
+ */
+class SegmentationProtocol {
+public:
+    
+    /** \brief Status of a response. */
+    enum Status {
+        /** \brief Label map follows. */
+        STATUS_OK = 0,
+        /** \brief Unknown algorithm, error message follows. */
+        STATUS_UNKNOWN_ALGORITHM = 1,
+        /** \brief Image could not be decoded, error message follows. */
+        STATUS_INVALID_IMAGE = 2
+    };
+    
+    /** \brief Header of a request. */
+    struct RequestHeader {
+        /** \brief Magic, always "SPRQ". */
+        char magic[4];
+        /** \brief Id chosen by the client, returned in the response. */
+        uint32_t id;
+        /** \brief Size of the algorithm string in bytes. */
+        uint32_t algorithm_size;
+        /** \brief Rows of raw pixels, 0 for an encoded image. */
+        int32_t rows;
+        /** \brief Columns of raw pixels, 0 for an encoded image. */
+        int32_t cols;
+        /** \brief Size of the image in bytes. */
+        uint32_t image_size;
+    };
+    
+    /** \brief Header of a response. */
+    struct ResponseHeader {
+        /** \brief Magic, always "SPRS". */
+        char magic[4];
+        /** \brief Id of the request. */
+        uint32_t id;
+        /** \brief Status, see Status. */
+        int32_t status;
+        /** \brief Size of the label map or error message in bytes. */
+        uint32_t size;
+        /** \brief Time the request waited for a worker in seconds. */
+        double queue_time;
+        /** \brief Time to decode and segment the image in seconds. */
+        double segmentation_time;
+    };
+    
+    /** \brief Maximum size of an image in bytes accepted by the server. */
+    static const uint32_t MAX_IMAGE_SIZE = 1u << 30;
+    
+    /** \brief Maximum size of the algorithm string in bytes. */
+    static const uint32_t MAX_ALGORITHM_SIZE = 1u << 16;
+    
+    /** \brief Read exactly the given number of bytes, retrying on interrupts.
+     * \param[in] fd socket
+     * \param[out] data buffer
+     * \param[in] size number of bytes
+     * \return whether all bytes were read, false on error or end of stream
+     */
+    static bool readAll(int fd, char* data, size_t size);
+    
+    /** \brief Write exactly the given number of bytes, retrying on interrupts.
+     * \param[in] fd socket
+     * \param[in] data buffer
+     * \param[in] size number of bytes
+     * \return whether all bytes were written
+     */
+    static bool writeAll(int fd, const char* data, size_t size);
+    
+    /** \brief Read a request.
+     * \param[in] fd socket
+     * \param[out] header header of the request
+     * \param[out] algorithm algorithm and parameters
+     * \param[out] image encoded image or raw pixels
+     * \return whether a valid request was read
+     */
+    static bool readRequest(int fd, RequestHeader &header, std::string &algorithm,
+            std::vector<char> &image);
+    
+    /** \brief Write a request with an encoded image.
+     * \param[in] fd socket
+     * \param[in] id id of the request
+     * \param[in] algorithm algorithm and parameters
+     * \param[in] image encoded image, e.g. contents of a PNG file
+     * \return whether the request was written
+     */
+    static bool writeRequest(int fd, uint32_t id, const std::string &algorithm,
+            const std::vector<char> &image);
+    
+    /** \brief Write a request with raw pixels.
+     * \param[in] fd socket
+     * \param[in] id id of the request
+     * \param[in] algorithm algorithm and parameters
+     * \param[in] image image as CV_8UC3
+     * \return whether the request was written
+     */
+    static bool writeRequest(int fd, uint32_t id, const std::string &algorithm,
+            const cv::Mat &image);
+    
+    /** \brief Decode the image of a request.
+     * \param[in] header header of the request
+     * \param[in] image encoded image or raw pixels
+     * \param[out] result image as CV_8UC3
+     * \return whether the image could be decoded
+     */
+    static bool decodeImage(const RequestHeader &header, const std::vector<char> &image,
+            cv::Mat &result);
+    
+    /** \brief Read a response.
+     * \param[in] fd socket
+     * \param[out] header header of the response
+     * \param[out] data label map in binary label format or error message
+     * \return whether a valid response was read
+     */
+    static bool readResponse(int fd, ResponseHeader &header, std::vector<char> &data);
+    
+    /** \brief Write a response.
+     * \param[in] fd socket
+     * \param[in] header header of the response, magic and size are set
+     * \param[in] data label map in binary label format or error message
+     * \return whether the response was written
+     */
+    static bool writeResponse(int fd, ResponseHeader header, const std::vector<char> &data);
+    
+};
+
+#endif	/* SEGMENTATION_PROTOCOL_H */
@@ -33,10 +33,12 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "vc_opencv.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
+#include "thread_pool.h"
 #include "visualization.h"
 
 /** \brief Command line tool for running VC.
@@ -55,9 +57,29 @@
  *     -t [ --threshold ] arg (=10)          threshold influencing the number of 
  *                                           iterations
  *     -r [ --color-space ] arg (=1)         color space; 0 for RGB, > 0 for Lab
+ *     -l [ --tile-size ] arg (=0)           relabel boundary pixels in parallel on 
+ *                                           tiles of this size, 0 for the original 
+ *                                           sequential implementation
+ *     --patience arg (=0)                   with --tile-size, stop iterating once
+ *                                           the number of relabeled pixels did 
+ *                                           not reach a new minimum for this many
+ *                                           iterations, 0 to only use the 
+ *                                           threshold
+ *     --sweep arg                           with --tile-size, numbers of 
+ *                                           superpixels computed by continuing 
+ *                                           from the previous number, written to
+ *                                           one subdirectory of --csv per number
  *     -o [ --csv ] arg                      save segmentation as CSV file
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
+ *     --memory                              write per image allocations and
+ *                                           peak memory to memory.csv next to
+ *                                           runtime.txt
+ *     --png                                 write segmentations as 16-bit
+ *                                           PNG instead of CSV
+ *     -j [ --threads ] arg (=1)             number of threads to relabel
+ *                                           connected components on the shared
+ *                                           pool
  *     -w [ --wordy ]                        verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -75,9 +97,15 @@ int main (int argc, char ** argv) {
         ("direct-neighbors,d", boost::program_options::value<int>()->default_value(4), "number of direct neighbors")
         ("threshold,t", boost::program_options::value<int>()->default_value(10), "threshold influencing the number of iterations")
         ("color-space,r", boost::program_options::value<int>()->default_value(1), "color space; 0 for RGB, > 0 for Lab")
+        ("tile-size,l", boost::program_options::value<int>()->default_value(0), "relabel boundary pixels in parallel on tiles of this size, 0 for the original sequential implementation")
+        ("patience", boost::program_options::value<int>()->default_value(0), "with --tile-size, stop iterating once the number of relabeled pixels did not reach a new minimum for this many iterations, 0 to only use the threshold")
+        ("sweep", boost::program_options::value<std::vector<int>>()->multitoken(), "with --tile-size, numbers of superpixels computed by continuing from the previous number, written to one subdirectory of --csv per number")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads to relabel connected components on the shared pool")
         ("wordy,w", "verbose/wordy/debug");
     
     boost::program_options::positional_options_description positionals;
@@ -92,6 +120,14 @@ int main (int argc, char ** argv) {
         return 1;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -113,6 +149,7 @@ int main (int argc, char ** argv) {
     }
     
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
@@ -125,6 +162,40 @@ int main (int argc, char ** argv) {
     int neighboring_clusters = parameters["neighboring-clusters"].as<int>();
     int direct_neighbors = parameters["direct-neighbors"].as<int>();
     int threshold = parameters["threshold"].as<int>();
+    int tile_size = parameters["tile-size"].as<int>();
+    
+    int patience = parameters["patience"].as<int>();
+    
+    if (tile_size < 0) {
+        std::cout << "Tile size needs to be non-negative." << std::endl;
+        return 1;
+    }
+    
+    if (patience < 0) {
+        std::cout << "Patience needs to be non-negative." << std::endl;
+        return 1;
+    }
+    
+    std::vector<int> sweep;
+    if (parameters.find("sweep") != parameters.end()) {
+        sweep = parameters["sweep"].as<std::vector<int>>();
+    }
+    
+    if (!sweep.empty() && tile_size == 0) {
+        std::cout << "Sweeps over the number of superpixels need --tile-size." << std::endl;
+        return 1;
+    }
+    
+    for (unsigned int k = 0; k < sweep.size(); ++k) {
+        if (sweep[k] <= 0) {
+            std::cout << "Numbers of superpixels for --sweep need to be positive." << std::endl;
+            return 1;
+        }
+        
+        if (!output_dir.empty() && !boost::filesystem::is_directory(output_dir / std::to_string(sweep[k]))) {
+            boost::filesystem::create_directories(output_dir / std::to_string(sweep[k]));
+        }
+    }
     
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
@@ -132,19 +203,31 @@ int main (int argc, char ** argv) {
     IOUtil::readDirectory(input_dir, extensions, images);
     
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         cv::Mat labels;
         
-        boost::timer timer;
-        VC_OpenCV::computeSuperpixels(image, superpixels, weight, radius, 
-                neighboring_clusters, direct_neighbors, threshold, labels);
+        VCellsTiled tiled(superpixels, weight, radius, threshold, tile_size);
+        tiled.setPatience(patience);
+        
+        RuntimeHarness::Timer timer;
+        if (tile_size > 0) {
+            VC_OpenCV::computeSuperpixelsTiled(tiled, image, labels);
+        }
+        else {
+            VC_OpenCV::computeSuperpixels(image, superpixels, weight, radius, 
+                    neighboring_clusters, direct_neighbors, threshold, labels);
+        }
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
-        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels, threads);
         int merged_unconnected_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
         
         int size = (float) (image.rows*image.cols)/superpixels/10;
@@ -159,9 +242,28 @@ int main (int argc, char ** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
+        }
+        
+        // The sweep continues from the superpixels before post-processing.
+        for (unsigned int k = 0; k < sweep.size(); ++k) {
+            cv::Mat sweep_labels;
+            VC_OpenCV::recomputeSuperpixelsTiled(tiled, image, sweep[k], sweep_labels);
+            
+            int sweep_unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(sweep_labels, threads);
+            SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, sweep_labels, sweep_unconnected_components);
+            
+            int sweep_size = (float) (image.rows*image.cols)/sweep[k]/10;
+            SuperpixelTools::enforceMinimumSuperpixelSize(image, sweep_labels, sweep_size);
+            SuperpixelTools::relabelSuperpixels(sweep_labels);
+            
+            if (!output_dir.empty()) {
+                boost::filesystem::path sweep_file(output_dir / std::to_string(sweep[k])
+                        / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+                IOUtil::writeLabels(sweep_file, sweep_labels);
+            }
         }
         
         if (!vis_dir.empty()) {
@@ -183,6 +285,11 @@ int main (int argc, char ** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
@@ -1,9 +1,11 @@
 #include <fstream>
 #include <opencv2/opencv.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
+#include "thread_pool.h"
 #include "visualization.h"
 #include "vlslic_opencv.h"
 
@@ -20,10 +22,20 @@
  *     -c [ --compactness ] arg (=40)        compactness = regularization trades off
  *                                           color for spatial closeness
  *     -t [ --iterations ] arg (=10)         iterations
+ *     --preemption arg (=0)                 skip regions with less than this 
+ *                                           fraction of changed labels, 0 = off
  *     -o [ --csv ] arg                      specify the output directory (default 
  *                                           is ./output)
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
+ *     --memory                              write per image allocations and
+ *                                           peak memory to memory.csv next to
+ *                                           runtime.txt
+ *     --png                                 write segmentations as 16-bit
+ *                                           PNG instead of CSV
+ *     -j [ --threads ] arg (=1)             number of threads to relabel
+ *                                           connected components on the shared
+ *                                           pool
  *     -w [ --wordy ]                        verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -38,9 +50,13 @@ int main(int argc, const char** argv) {
         ("minimum-region-size,m", boost::program_options::value<int>()->default_value(1), "minimum region size allowed")
         ("compactness,c", boost::program_options::value<double>()->default_value(40.0), "compactness = regularization trades off color for spatial closeness")
         ("iterations,t", boost::program_options::value<int>()->default_value(10), "iterations")
+        ("preemption", boost::program_options::value<double>()->default_value(0.), "skip regions with less than this fraction of changed labels, 0 = off")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "specify the output directory (default is ./output)")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads to relabel connected components on the shared pool")
         ("wordy,w", "verbose/wordy/debug");
         
     boost::program_options::positional_options_description positionals;
@@ -55,6 +71,14 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -76,6 +100,7 @@ int main(int argc, const char** argv) {
     }
     
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
@@ -86,6 +111,11 @@ int main(int argc, const char** argv) {
     double regularization = parameters["compactness"].as<double>();
     int iterations = parameters["iterations"].as<int>();
     int min_region_size = parameters["minimum-region-size"].as<int>();
+    double preemption = parameters["preemption"].as<double>();
+    if (preemption < 0) {
+        std::cout << "Preemption threshold needs to be non-negative." << std::endl;
+        return 1;
+    }
     
     // To be comparable to oriSLIC, see lib_slic/README.md and lib_vlfeat/README2.md!
     regularization *= regularization;
@@ -96,22 +126,26 @@ int main(int argc, const char** argv) {
     IOUtil::readDirectory(input_dir, extensions, images);
     
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
+        memory_profile.begin(prefix + it->second.stem().string());
+        
         cv::Mat image = cv::imread(it->first);
         cv::Mat labels;
         
         int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
                 superpixels);
         
-        boost::timer timer;
+        RuntimeHarness::Timer timer;
         VLSLIC_OpenCV::computeSuperpixels(image, region_size, regularization, 
-                min_region_size, iterations, labels);
+                min_region_size, iterations, labels, preemption);
         float elapsed = timer.elapsed();
         total += elapsed;
+        memory_profile.end();
         
-        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels, threads);
         
         if (wordy) {
             std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
@@ -120,9 +154,9 @@ int main(int argc, const char** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
         }
         
         if (!vis_dir.empty()) {
@@ -144,6 +178,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;
@@ -33,11 +33,15 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include <bitset>
+#include "image_loader.h"
 #include "io_util.h"
+#include "memory_profile.h"
+#include "runtime_harness.h"
 #include "superpixel_tools.h"
+#include "thread_pool.h"
 #include "visualization.h"
+#include "wp_opencv.h"
 
 /** \brief Command line tool for running W.
  * Usage:
@@ -48,10 +52,23 @@
  *     -i [ --input ] arg              the folder to process (can also be passed as 
  *                                     positional argument)
  *     -s [ --superpixels ] arg (=400) number of superpixles
+ *     -p [ --waterpixels ]            watershed on the regularized gradient 
+ *                                     (waterpixels) instead of cv::watershed
+ *     -r [ --weight ] arg (=10)       regularization weight for --waterpixels
  *     -o [ --csv ] arg                specify the output directory (default is 
  *                                     ./output)
  *     -v [ --vis ] arg                visualize contours
  *     -x [ --prefix ] arg             output file prefix
+ *     --memory                        write per image allocations and peak
+ *                                     memory to memory.csv next to runtime.txt
+ *     --png                           write segmentations as 16-bit PNG
+ *                                     instead of CSV
+ *     --reduce arg (=1)               decode images at 1/2, 1/4 or 1/8
+ *                                     resolution, labels are upsampled
+ *     --prefetch arg (=0)             number of images decoded ahead on
+ *                                     background threads
+ *     -j [ --threads ] arg (=1)       number of threads to relabel connected
+ *                                     components on the shared pool
  *     -w [ --wordy ]                  verbose/wordy/debug
  * \endcode
  * \author David Stutz
@@ -63,9 +80,16 @@ int main(int argc, const char** argv) {
         ("help,h", "produce help message")
         ("input,i", boost::program_options::value<std::string>(), "the folder to process (can also be passed as positional argument)")
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixles")
+        ("waterpixels,p", "watershed on the regularized gradient (waterpixels) instead of cv::watershed")
+        ("weight,r", boost::program_options::value<double>()->default_value(10), "regularization weight for --waterpixels")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "specify the output directory (default is ./output)")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("memory", "write per image allocations and peak memory to memory.csv next to runtime.txt")
+        ("png", "write segmentations as 16-bit PNG instead of CSV")
+        ("reduce", boost::program_options::value<int>()->default_value(1), "decode images at 1/2, 1/4 or 1/8 resolution, labels are upsampled")
+        ("prefetch", boost::program_options::value<int>()->default_value(0), "number of images decoded ahead on background threads")
+        ("threads,j", boost::program_options::value<int>()->default_value(1), "number of threads to relabel connected components on the shared pool")
         ("wordy,w", "verbose/wordy/debug");
         
     boost::program_options::positional_options_description positionals;
@@ -80,6 +104,14 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    int threads = parameters["threads"].as<int>();
+    if (threads <= 0) {
+        std::cout << "Number of threads needs to be positive." << std::endl;
+        return 1;
+    }
+    
+    ThreadPool::setGlobalThreads(threads);
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -101,46 +133,94 @@ int main(int argc, const char** argv) {
     }
     
     std::string prefix = parameters["prefix"].as<std::string>();
+    std::string label_extension = (parameters.find("png") != parameters.end() ? ".png" : ".csv");
     
     bool wordy = false;
     if (parameters.find("wordy") != parameters.end()) {
         wordy = true;
     }
     
+    int reduction = parameters["reduce"].as<int>();
+    if (!ImageLoader::isValidReduction(reduction)) {
+        std::cout << "Reduction needs to be 1, 2, 4 or 8 ..." << std::endl;
+        return 1;
+    }
+    
+    int prefetch = parameters["prefetch"].as<int>();
+    if (prefetch < 0) {
+        std::cout << "Number of prefetched images cannot be negative ..." << std::endl;
+        return 1;
+    }
+    
     int superpixels = parameters["superpixels"].as<int>();
     
+    bool waterpixels = false;
+    if (parameters.find("waterpixels") != parameters.end()) {
+        waterpixels = true;
+    }
+    
+    double weight = parameters["weight"].as<double>();
+    if (weight < 0) {
+        std::cout << "Weight needs to be non-negative ..." << std::endl;
+        return 1;
+    }
+    
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(input_dir, extensions, images);
     
+    std::vector<std::string> files;
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
+            it != images.end(); ++it) {
+        files.push_back(it->first);
+    }
+    
+    // Images are returned in the order of images.
+    ImageLoader loader(files, reduction, prefetch);
+    
     float total = 0;
+    MemoryProfile memory_profile(parameters.find("memory") != parameters.end());
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
-        cv::Mat image = cv::imread(it->first);
+        memory_profile.begin(prefix + it->second.stem().string());
+        
+        cv::Mat image;
+        cv::Size size;
+        loader.next(image, size);
         
         int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
                 superpixels);
-        cv::Mat markers(image.rows, image.cols, CV_32SC1, cv::Scalar(0));
         
-        int label = 1;
-        for (int i = region_size/2; i < image.rows; i += region_size) {
-            for (int j = region_size/2; j < image.cols; j += region_size) {
-                markers.at<int>(i, j) = label;
-                label++;
-            }
-        }
-
         cv::Mat labels;
+        float elapsed = 0;
         
-        boost::timer timer;
-        cv::watershed(image, markers);
-        SuperpixelTools::assignBoundariesToSuperpixels(image, markers, labels);    
-        float elapsed = timer.elapsed();
+        if (waterpixels) {
+            RuntimeHarness::Timer timer;
+            WP_OpenCV::computeSuperpixels(image, region_size, weight, labels);
+            elapsed = timer.elapsed();
+        }
+        else {
+            cv::Mat markers(image.rows, image.cols, CV_32SC1, cv::Scalar(0));
+
+            int label = 1;
+            for (int i = region_size/2; i < image.rows; i += region_size) {
+                for (int j = region_size/2; j < image.cols; j += region_size) {
+                    markers.at<int>(i, j) = label;
+                    label++;
+                }
+            }
+
+            RuntimeHarness::Timer timer;
+            cv::watershed(image, markers);
+            SuperpixelTools::assignBoundariesToSuperpixels(image, markers, labels);    
+            elapsed = timer.elapsed();
+        }
         total += elapsed;
+        memory_profile.end();
         
-        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels, threads);
         
         if (wordy) {
             std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
@@ -149,9 +229,12 @@ int main(int argc, const char** argv) {
         }
         
         if (!output_dir.empty()) {
-            boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            boost::filesystem::path label_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            
+            cv::Mat output_labels;
+            ImageLoader::upsampleLabels(labels, size, output_labels);
+            IOUtil::writeLabels(label_file, output_labels);
         }
         
         if (!vis_dir.empty()) {
@@ -173,6 +256,11 @@ int main(int argc, const char** argv) {
         
         runtime_file << total / images.size() << "\n";
         runtime_file.close();
+        
+        if (memory_profile.isEnabled()) {
+            MemoryProfile::writeRecords(output_dir / boost::filesystem::path(prefix + "memory.csv"), 
+                    memory_profile.getRecords());
+        }
     }
     
     return 0;